@@ -38,6 +38,7 @@ class VROARCamera;
 class VROARAnchor;
 class VROARHitTestResult;
 class VROMatrix4f;
+class VROSphericalHarmonics;
 enum class VROARHitTestResultType;
 enum class VROCameraOrientation;
 
@@ -105,6 +106,14 @@ public:
      */
     virtual VROVector3f getAmbientLightColor() const = 0;
 
+    /*
+     Return the estimated ambient light of the physical scene as spherical
+     harmonics in world space, or nullptr if the session does not estimate it.
+     */
+    virtual std::shared_ptr<VROSphericalHarmonics> getAmbientSphericalHarmonics() const {
+        return nullptr;
+    }
+
     /*
      Get all the anchors representing tracked positions and objects in the
      scene.
@@ -0,0 +1,96 @@
+//
+//  VROARImageDatabase.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include "VROARImageDatabase.h"
+#include "VROLog.h"
+#include <stdio.h>
+
+static const uint32_t kImageDatabaseCacheMagic = 0x56524f44; // 'VROD'
+static const uint32_t kImageDatabaseCacheVersion = 1;
+
+// Databases larger than this are assumed to be corrupt
+static const uint64_t kMaxImageDatabaseSize = 512ULL * 1024 * 1024;
+
+struct VROImageDatabaseHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint64_t length;
+};
+
+uint64_t VROARImageDatabase::getContentHash() const {
+    return VROPlatformHashCacheKey(_data.data(), _data.size());
+}
+
+std::string VROARImageDatabase::getCachePath(std::string directory, uint64_t key) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.imgdb", (unsigned long long) key);
+    return directory + "/" + name;
+}
+
+std::shared_ptr<VROARImageDatabase> VROARImageDatabase::loadCached(std::string directory, uint64_t key) {
+    if (directory.empty()) {
+        return nullptr;
+    }
+
+    std::string path = getCachePath(directory, key);
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return nullptr;
+    }
+
+    VROImageDatabaseHeader header;
+    std::vector<uint8_t> data;
+    bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+                 header.magic == kImageDatabaseCacheMagic &&
+                 header.version == kImageDatabaseCacheVersion &&
+                 header.key == key &&
+                 header.length > 0 && header.length <= kMaxImageDatabaseSize;
+    if (valid) {
+        data.resize(header.length);
+        valid = fread(data.data(), 1, data.size(), file) == data.size();
+    }
+    fclose(file);
+
+    if (!valid) {
+        pinfo("Discarding corrupt AR image database cache file %s", path.c_str());
+        remove(path.c_str());
+        return nullptr;
+    }
+    return std::make_shared<VROARImageDatabase>(std::move(data));
+}
+
+bool VROARImageDatabase::storeCached(std::string directory, uint64_t key, std::shared_ptr<VROARImageDatabase> database) {
+    if (directory.empty() || !database || database->_data.empty()) {
+        return false;
+    }
+    return VROPlatformWriteCacheFile(getCachePath(directory, key), [key, &database](FILE *file) {
+        VROImageDatabaseHeader header = { kImageDatabaseCacheMagic, kImageDatabaseCacheVersion, key,
+                                          (uint64_t) database->_data.size() };
+        return fwrite(&header, sizeof(header), 1, file) == 1 &&
+               fwrite(database->_data.data(), 1, database->_data.size(), file) == database->_data.size();
+    });
+}
@@ -27,27 +27,64 @@
 #define VROARImageDatabase_h
 
 #include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
 #include "VROPlatformUtil.h"
 
+/*
+ A serialized AR image database: a set of image targets along with the features
+ extracted from them, in the AR platform's own format (e.g. a serialized
+ ArAugmentedImageDatabase on ARCore).
+
+ Extracting features from large target sets takes seconds, so databases built at
+ runtime are cached on disk, keyed by the content of the targets they were built
+ from: subsequent sessions load the database in one call.
+ */
 class VROARImageDatabase {
 public:
-    VROARImageDatabase(uint8_t *fileData, int64_t length) :
-        _fileData(fileData),
-        _length(length) {}
+    
+    /*
+     Create a database from the given serialized bytes, which are copied.
+     */
+    VROARImageDatabase(const uint8_t *fileData, int64_t length) :
+        _data(fileData, fileData + length) {}
+    VROARImageDatabase(std::vector<uint8_t> data) :
+        _data(std::move(data)) {}
 
     ~VROARImageDatabase() {}
 
     uint8_t *getFileData() {
-        return _fileData;
+        return _data.data();
     }
 
     int64_t getLength() {
-        return _length;
+        return (int64_t) _data.size();
     }
 
+    /*
+     Hash of the serialized bytes, used to key the databases built on top of this
+     one.
+     */
+    uint64_t getContentHash() const;
+
+    /*
+     Load the database cached in the given directory under the given key. Returns
+     nullptr if there is no such database, or if its file is corrupt.
+     */
+    static std::shared_ptr<VROARImageDatabase> loadCached(std::string directory, uint64_t key);
+
+    /*
+     Write the given database to the given directory under the given key. The file
+     is written in full or not at all. Performs blocking I/O, so this should not be
+     invoked on the rendering thread.
+     */
+    static bool storeCached(std::string directory, uint64_t key, std::shared_ptr<VROARImageDatabase> database);
+
 private:
-    uint8_t *_fileData;
-    int64_t _length;
+    std::vector<uint8_t> _data;
+
+    static std::string getCachePath(std::string directory, uint64_t key);
 };
 
 #endif //VROARImageDatabase_h
@@ -78,12 +78,14 @@ public:
         _extent = extent;
     }
 
+    /*
+     The vertices of the boundary of the detected plane, if any.
+     */
     void setBoundaryVertices(std::vector<VROVector3f> points) {
-        _boundaryVertices = points;
+        _boundaryVertices = std::move(points);
     }
-
-    std::vector<VROVector3f> getBoundaryVertices() {
-        return  _boundaryVertices;
+    const std::vector<VROVector3f> &getBoundaryVertices() const {
+        return _boundaryVertices;
     }
     
 private:
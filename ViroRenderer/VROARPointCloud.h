@@ -46,7 +46,7 @@ public:
      Retrieves the point that make up this point cloud. Note: the 4th value in the
      vector is a "confidence" value only available on Android.
      */
-    std::vector<VROVector4f> getPoints() {
+    const std::vector<VROVector4f> &getPoints() const {
         return _points;
     }
     
@@ -54,7 +54,7 @@ public:
      Retrieves the identifiers corresponding to each point. Note: iOS only (it's empty
      on Android).
      */
-    std::vector<uint64_t> getIdentifiers() {
+    const std::vector<uint64_t> &getIdentifiers() const {
         return _identifiers;
     }
     
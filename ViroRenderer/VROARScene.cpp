@@ -115,9 +115,9 @@ void VROARScene::setDriver(std::shared_ptr<VRODriver> driver) {
     }
 }
 
-void VROARScene::updateParticles(const VRORenderContext &context) {
+void VROARScene::updateParticles(const VRORenderContext &context, std::shared_ptr<VROJobSystem> &jobs) {
     updatePointCloud();
-    VROScene::updateParticles(context);
+    VROScene::updateParticles(context, jobs);
 }
 
 void VROARScene::updatePointCloud(){
@@ -135,8 +135,13 @@ void VROARScene::updatePointCloud(){
         return;
     }
 
-    std::vector<VROVector4f> pointCloudPoints = frame->getPointCloud()->getPoints();
-    _pointCloudEmitter->setParticleTransforms(pointCloudPoints);
+    // The frame caches its point cloud, so the emitter is only updated once per AR frame
+    std::shared_ptr<VROARPointCloud> pointCloud = frame->getPointCloud();
+    if (pointCloud == _lastPointCloud) {
+        return;
+    }
+    _pointCloudEmitter->setParticleTransforms(pointCloud->getPoints());
+    _lastPointCloud = pointCloud;
 }
 
 void VROARScene::displayPointCloud(bool displayPointCloud) {
@@ -37,6 +37,7 @@ class VROARAnchor;
 class VROARDeclarativeSession;
 class VROARImperativeSession;
 class VROFixedParticleEmitter;
+class VROARPointCloud;
 
 class VROARSceneDelegate {
 public:
@@ -140,7 +141,7 @@ public:
         return _imperativeSession;
     }
 
-    void updateParticles(const VRORenderContext &context);
+    void updateParticles(const VRORenderContext &context, std::shared_ptr<VROJobSystem> &jobs);
     
 private:
     
@@ -158,6 +159,7 @@ private:
 
     std::shared_ptr<VRONode> _pointCloudNode;
     std::shared_ptr<VROFixedParticleEmitter> _pointCloudEmitter;
+    std::shared_ptr<VROARPointCloud> _lastPointCloud;
     std::weak_ptr<VROARSceneDelegate> _delegate;
     
     /*
@@ -27,16 +27,14 @@
 #include "VROARShadow.h"
 #include "VROShaderModifier.h"
 #include "VROMaterial.h"
+#include "VROLight.h"
+#include "VROBoundingBox.h"
 
 static thread_local std::shared_ptr<VROShaderModifier> sShadowARSurfaceModifier;
 static thread_local std::shared_ptr<VROShaderModifier> sShadowARLightingModifier;
 static thread_local std::shared_ptr<VROShaderModifier> sShadowARFragmentModifier;
 
 void VROARShadow::apply(std::shared_ptr<VROMaterial> material) {
-    createSurfaceModifier();
-    createLightingModifier();
-    createFragmentModifier();
-
     // Set the lighting model to PBR because we want to take irradiance
     // (PBR ambient light) into account when computing how much to diminish
     // the shadow on the transparent surface. Note that for non-PBR devices
@@ -44,19 +42,13 @@ void VROARShadow::apply(std::shared_ptr<VROMaterial> material) {
     material->setLightingModel(VROLightingModel::PhysicallyBased);
     material->setWritesToDepthBuffer(false);
     material->setCastsShadows(false);
-
-    if (!material->hasShaderModifier(sShadowARSurfaceModifier)) {
-        material->addShaderModifier(sShadowARSurfaceModifier);
-    }
-    if (!material->hasShaderModifier(sShadowARLightingModifier)) {
-        material->addShaderModifier(sShadowARLightingModifier);
-    }
-    if (!material->hasShaderModifier(sShadowARFragmentModifier)) {
-        material->addShaderModifier(sShadowARFragmentModifier);
-    }
+    material->setShadowCatcher(true);
 }
 
 void VROARShadow::remove(std::shared_ptr<VROMaterial> material) {
+    material->setShadowCatcher(false);
+    
+    // Also strip the modifiers in case they were added to the material directly
     if (sShadowARFragmentModifier != nullptr) {
         material->removeShaderModifier(sShadowARFragmentModifier);
     }
@@ -68,6 +60,27 @@ void VROARShadow::remove(std::shared_ptr<VROMaterial> material) {
     }
 }
 
+bool VROARShadow::isShadowed(const VROBoundingBox &bounds,
+                             const std::vector<std::shared_ptr<VROLight>> &lights) {
+    for (const std::shared_ptr<VROLight> &light : lights) {
+        if (!light->getCastsShadow() || light->getShadowMapIndex() < 0) {
+            continue;
+        }
+        
+        // Caster bounds with min > max are empty: no caster was rendered
+        VROVector4f casters = light->getShadowCasterBounds();
+        if (casters.x > casters.z || casters.y > casters.w) {
+            continue;
+        }
+        VROVector4f catcher = light->computeShadowMapBounds(bounds);
+        if (casters.x <= catcher.z && catcher.x <= casters.z &&
+            casters.y <= catcher.w && catcher.y <= casters.w) {
+            return true;
+        }
+    }
+    return false;
+}
+
 std::shared_ptr<VROShaderModifier> VROARShadow::createSurfaceModifier() {
     if (!sShadowARSurfaceModifier) {
         std::vector<std::string> modifierCode = {
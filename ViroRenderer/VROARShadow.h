@@ -28,9 +28,12 @@
 #define VROARTShadow_h
 
 #include <memory>
+#include <vector>
 
 class VROMaterial;
 class VROShaderModifier;
+class VROLight;
+class VROBoundingBox;
 
 /*
  Apply this to any material to turn it into a "transparent shadow"
@@ -43,6 +46,12 @@ class VROShaderModifier;
  2. Increase the alpha if the surface is in shadow.
  
  This is used to cast virtual shadows on real-world scenes.
+ 
+ The material is flagged as a shadow catcher, and VROShaderFactory builds a
+ dedicated shader for it that skips the lighting model and only evaluates the
+ shadow lookups. The output (0, 0, 0, alpha) under standard alpha blending is
+ a multiplicative darkening of the real-world background, so no extra pass is
+ needed.
  */
 class VROARShadow {
 public:
@@ -50,8 +59,19 @@ public:
     static void apply(std::shared_ptr<VROMaterial> material);
     static void remove(std::shared_ptr<VROMaterial> material);
     
-private:
+    /*
+     Returns true if the given world-space bounds of a shadow catcher overlap the
+     region of any of the given lights' shadow maps that holds shadow casters.
+     Catchers that return false cannot receive a shadow this frame, and need not
+     be drawn.
+     */
+    static bool isShadowed(const VROBoundingBox &bounds,
+                           const std::vector<std::shared_ptr<VROLight>> &lights);
     
+    /*
+     The modifiers that compose the shadow catcher shader. These run after the
+     shadow map modifiers.
+     */
     static std::shared_ptr<VROShaderModifier> createSurfaceModifier();
     static std::shared_ptr<VROShaderModifier> createFragmentModifier();
     static std::shared_ptr<VROShaderModifier> createLightingModifier();
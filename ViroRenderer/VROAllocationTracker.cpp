@@ -31,30 +31,152 @@
 #include <map>
 #include <limits>
 #include <atomic>
+#include <sstream>
 #include "VROTaskQueue.h"
+#include "VROTexture.h"
 
 #define ALLOCATION_TRACKING_FREQUENCY 1 // in Hz
 
-static std::atomic<uint32_t> sBytesAllocated[static_cast<int>(VROAllocationBucket::NUM_BUCKETS)];
+static const int kNumBuckets = static_cast<int>(VROAllocationBucket::NUM_BUCKETS);
+static const int kNumTextureFormats = static_cast<int>(VROTextureFormat::RG16F) + 1;
+
+struct VROAllocationCounter {
+    std::atomic<int64_t> current;
+    std::atomic<int64_t> peak;
+    std::atomic<int64_t> scenePeak;
+    std::atomic<int64_t> sceneStart;
+};
+
+static VROAllocationCounter sCounters[kNumBuckets];
+static VROAllocationCounter sTextureCounters[kNumTextureFormats];
+
+static const char *const kBucketNames[kNumBuckets] = {
+    "Scenes", "Nodes", "Geometry", "Materials", "MaterialSubstrates", "Textures",
+    "TextureSubstrates", "Shaders", "ShaderModifiers", "VideoTextures", "VideoTextureCaches",
+    "Typefaces", "Glyphs", "GlyphAtlases", "RenderTargets", "VBO", "TaskQueues", "Anchors",
+    "StreamedTexturesResident", "StreamedTexturesRequested", "GeometryArenaReserved",
+    "GeometryArenaUsed", "GeometryArenaFragments", "TextureMemory", "VertexBufferMemory",
+    "IndexBufferMemory", "RenderTargetMemory", "GlyphAtlasMemory", "DataMemory",
+};
+
+static const char *const kTextureFormatNames[kNumTextureFormats] = {
+    "ETC2_RGBA8_EAC", "ASTC_4x4_LDR", "RGBA8", "RGB565", "RGB8", "RGB9_E5", "RGB16F", "RGBA16F", "RG16F",
+};
 
 static double sTimeLastLogged = 0.0;
 static std::mutex sTimeLastLoggedMutex;
 
-void VROAllocationTracker::set(VROAllocationBucket bucket, uint32_t bytes) {
-    sBytesAllocated[static_cast<int>(bucket)].store(bytes);
+static void raise(std::atomic<int64_t> &mark, int64_t value) {
+    int64_t previous = mark.load(std::memory_order_relaxed);
+    while (value > previous && !mark.compare_exchange_weak(previous, value, std::memory_order_relaxed)) {}
+}
+
+static void update(VROAllocationCounter &counter, int64_t value) {
+    raise(counter.peak, value);
+    raise(counter.scenePeak, value);
+}
+
+static void add(VROAllocationCounter &counter, int64_t value) {
+    update(counter, counter.current.fetch_add(value, std::memory_order_relaxed) + value);
+}
+
+static VROAllocationStats getStats(const VROAllocationCounter &counter) {
+    VROAllocationStats stats;
+    stats.current = counter.current.load(std::memory_order_relaxed);
+    stats.peak = counter.peak.load(std::memory_order_relaxed);
+    stats.scenePeak = counter.scenePeak.load(std::memory_order_relaxed);
+    stats.sceneDelta = stats.current - counter.sceneStart.load(std::memory_order_relaxed);
+    return stats;
+}
+
+static void writeJSON(std::stringstream &ss, const char *name, const VROAllocationCounter &counter) {
+    VROAllocationStats stats = getStats(counter);
+    ss << "\"" << name << "\":{\"current\":" << stats.current << ",\"peak\":" << stats.peak
+       << ",\"scenePeak\":" << stats.scenePeak << ",\"sceneDelta\":" << stats.sceneDelta << "}";
+}
+
+void VROAllocationTracker::set(VROAllocationBucket bucket, int64_t value) {
+    VROAllocationCounter &counter = sCounters[static_cast<int>(bucket)];
+    counter.current.store(value, std::memory_order_relaxed);
+    update(counter, value);
+}
+
+void VROAllocationTracker::add(VROAllocationBucket bucket, int64_t value) {
+    ::add(sCounters[static_cast<int>(bucket)], value);
+}
+
+void VROAllocationTracker::subtract(VROAllocationBucket bucket, int64_t value) {
+    sCounters[static_cast<int>(bucket)].current.fetch_sub(value, std::memory_order_relaxed);
+}
+
+void VROAllocationTracker::resize(VROAllocationBucket bucket, int64_t valueOld, int64_t valueNew) {
+    ::add(sCounters[static_cast<int>(bucket)], valueNew - valueOld);
 }
 
-void VROAllocationTracker::add(VROAllocationBucket bucket, uint32_t bytes) {
-    sBytesAllocated[static_cast<int>(bucket)] += bytes;
+void VROAllocationTracker::addTextureMemory(VROTextureFormat format, int64_t bytes) {
+    ::add(sTextureCounters[static_cast<int>(format)], bytes);
+    add(VROAllocationBucket::TextureMemory, bytes);
 }
 
-void VROAllocationTracker::subtract(VROAllocationBucket bucket, uint32_t bytes) {
-    sBytesAllocated[static_cast<int>(bucket)] -= bytes;
+void VROAllocationTracker::subtractTextureMemory(VROTextureFormat format, int64_t bytes) {
+    sTextureCounters[static_cast<int>(format)].current.fetch_sub(bytes, std::memory_order_relaxed);
+    subtract(VROAllocationBucket::TextureMemory, bytes);
 }
 
-void VROAllocationTracker::resize(VROAllocationBucket bucket, uint32_t bytesOld, uint32_t bytesNew) {
-    subtract(bucket, bytesOld);
-    add(bucket, bytesNew);
+VROAllocationStats VROAllocationTracker::getStats(VROAllocationBucket bucket) {
+    return ::getStats(sCounters[static_cast<int>(bucket)]);
+}
+
+VROAllocationStats VROAllocationTracker::getTextureStats(VROTextureFormat format) {
+    return ::getStats(sTextureCounters[static_cast<int>(format)]);
+}
+
+const char *VROAllocationTracker::getBucketName(VROAllocationBucket bucket) {
+    return kBucketNames[static_cast<int>(bucket)];
+}
+
+void VROAllocationTracker::beginScene() {
+    for (int i = 0; i < kNumBuckets; i++) {
+        int64_t current = sCounters[i].current.load(std::memory_order_relaxed);
+        sCounters[i].sceneStart.store(current, std::memory_order_relaxed);
+        sCounters[i].scenePeak.store(current, std::memory_order_relaxed);
+    }
+    for (int i = 0; i < kNumTextureFormats; i++) {
+        int64_t current = sTextureCounters[i].current.load(std::memory_order_relaxed);
+        sTextureCounters[i].sceneStart.store(current, std::memory_order_relaxed);
+        sTextureCounters[i].scenePeak.store(current, std::memory_order_relaxed);
+    }
+}
+
+void VROAllocationTracker::resetPeaks() {
+    for (int i = 0; i < kNumBuckets; i++) {
+        int64_t current = sCounters[i].current.load(std::memory_order_relaxed);
+        sCounters[i].peak.store(current, std::memory_order_relaxed);
+        sCounters[i].scenePeak.store(current, std::memory_order_relaxed);
+    }
+    for (int i = 0; i < kNumTextureFormats; i++) {
+        int64_t current = sTextureCounters[i].current.load(std::memory_order_relaxed);
+        sTextureCounters[i].peak.store(current, std::memory_order_relaxed);
+        sTextureCounters[i].scenePeak.store(current, std::memory_order_relaxed);
+    }
+}
+
+std::string VROAllocationTracker::toJSON() {
+    std::stringstream ss;
+    ss << "{";
+    for (int i = 0; i < kNumBuckets; i++) {
+        writeJSON(ss, kBucketNames[i], sCounters[i]);
+        ss << ",";
+    }
+    ss << "\"TextureMemoryByFormat\":{";
+    for (int i = 0; i < kNumTextureFormats; i++) {
+        if (i > 0) {
+            ss << ",";
+        }
+        writeJSON(ss, kTextureFormatNames[i], sTextureCounters[i]);
+    }
+    ss << "}}";
+    return ss.str();
 }
 
 void VROAllocationTracker::print() {
@@ -71,24 +193,16 @@ void VROAllocationTracker::print() {
 }
 
 void VROAllocationTracker::printNow() {
-    pinfo("Allocation tracking");
-    pinfo("    Scenes:              %d", (sBytesAllocated[static_cast<int>(VROAllocationBucket::Scenes)].load()));
-    pinfo("    Nodes:               %d", (sBytesAllocated[static_cast<int>(VROAllocationBucket::Nodes)].load()));
-    pinfo("    Geometry:            %d", (sBytesAllocated[static_cast<int>(VROAllocationBucket::Geometry)].load()));
-    pinfo("    Materials:           %d", (sBytesAllocated[static_cast<int>(VROAllocationBucket::Materials)].load()));
-    pinfo("    Material Substrates: %d", (sBytesAllocated[static_cast<int>(VROAllocationBucket::MaterialSubstrates)].load()));
-    pinfo("    Textures:            %d", (sBytesAllocated[static_cast<int>(VROAllocationBucket::Textures)].load()));
-    pinfo("    Texture Substrates:  %d", (sBytesAllocated[static_cast<int>(VROAllocationBucket::TextureSubstrates)].load()));
-    pinfo("    Shaders:             %d", (sBytesAllocated[static_cast<int>(VROAllocationBucket::Shaders)].load()));
-    pinfo("    Shader Modifiers:    %d", (sBytesAllocated[static_cast<int>(VROAllocationBucket::ShaderModifiers)].load()));
-    pinfo("    Video Textures:      %d", (sBytesAllocated[static_cast<int>(VROAllocationBucket::VideoTextures)].load()));
-    pinfo("    Video Tex Caches:    %d", (sBytesAllocated[static_cast<int>(VROAllocationBucket::VideoTextureCaches)].load()));
-    pinfo("    Typefaces:           %d", (sBytesAllocated[static_cast<int>(VROAllocationBucket::Typefaces)].load()));
-    pinfo("    Glyphs:              %d", (sBytesAllocated[static_cast<int>(VROAllocationBucket::Glyphs)].load()));
-    pinfo("    Glyph Atlases:       %d", (sBytesAllocated[static_cast<int>(VROAllocationBucket::GlyphAtlases)].load()));
-    pinfo("    Render Targets:      %d", (sBytesAllocated[static_cast<int>(VROAllocationBucket::RenderTargets)].load()));
-    pinfo("    VBO:                 %d", (sBytesAllocated[static_cast<int>(VROAllocationBucket::VBO)].load()));
-    pinfo("    Task Queues:         %d", (sBytesAllocated[static_cast<int>(VROAllocationBucket::TaskQueues)].load()));
-    pinfo("    Anchors:             %d", (sBytesAllocated[static_cast<int>(VROAllocationBucket::Anchors)].load()));
+    pinfo("Allocation tracking (current / peak)");
+    for (int i = 0; i < kNumBuckets; i++) {
+        VROAllocationStats stats = ::getStats(sCounters[i]);
+        pinfo("    %-26s %lld / %lld", kBucketNames[i], (long long) stats.current, (long long) stats.peak);
+    }
+    for (int i = 0; i < kNumTextureFormats; i++) {
+        VROAllocationStats stats = ::getStats(sTextureCounters[i]);
+        if (stats.peak > 0) {
+            pinfo("    Texture %-18s %lld / %lld", kTextureFormatNames[i], (long long) stats.current, (long long) stats.peak);
+        }
+    }
     VROTaskQueue::printTaskQueues();
 }
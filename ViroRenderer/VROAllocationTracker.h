@@ -28,14 +28,21 @@
 #define __VROAllocationTracker__
 
 #include <iostream>
+#include <string>
+#include <stdint.h>
 
+/*
+ The allocation counters are always maintained; this flag only enables the
+ periodic printing of the counters to the log, and the tracked malloc macros.
+ */
 #define TRACK_MEMORY_ALLOCATIONS 0
 
+#define ALLOCATION_TRACKER_SET(x, bytes) VROAllocationTracker::set(VROAllocationBucket::x, bytes)
+#define ALLOCATION_TRACKER_ADD(x, bytes) VROAllocationTracker::add(VROAllocationBucket::x, bytes)
+#define ALLOCATION_TRACKER_SUB(x, bytes) VROAllocationTracker::subtract(VROAllocationBucket::x, bytes)
+#define ALLOCATION_TRACKER_RESIZE(x, bytesOld, bytesNew) VROAllocationTracker::resize(VROAllocationBucket::x, bytesOld, bytesNew)
+
 #if TRACK_MEMORY_ALLOCATIONS
-    #define ALLOCATION_TRACKER_SET(x, bytes) VROAllocationTracker::set(VROAllocationBucket::x, bytes)
-    #define ALLOCATION_TRACKER_ADD(x, bytes) VROAllocationTracker::add(VROAllocationBucket::x, bytes)
-    #define ALLOCATION_TRACKER_SUB(x, bytes) VROAllocationTracker::subtract(VROAllocationBucket::x, bytes)
-    #define ALLOCATION_TRACKER_RESIZE(x, bytesOld, bytesNew) VROAllocationTracker::resize(VROAllocationBucket::x, bytesOld, bytesNew)
     #define ALLOCATION_TRACKER_PRINT() VROAllocationTracker::print()
     #define ALLOCATION_TRACKER_PRINT_NOW() VROAllocationTracker::printNow()
 
@@ -43,10 +50,6 @@
     #define VRO_FREE(x, ptr, bytes) free(ptr), ALLOCATION_TRACKER_SUB(x, bytes)
     #define VRO_REALLOC(x, ptr, bytesOld, bytesNew) realloc(ptr, bytesNew), ALLOCATION_TRACKER_RESIZE(x, bytesOld, bytesNew)
 #else
-    #define ALLOCATION_TRACKER_SET(x, bytes) ((void)0)
-    #define ALLOCATION_TRACKER_ADD(x, bytes) ((void)0)
-    #define ALLOCATION_TRACKER_SUB(x, bytes) ((void)0)
-    #define ALLOCATION_TRACKER_RESIZE(x, bytesOld, bytesNew) ((void)0)
     #define ALLOCATION_TRACKER_PRINT() ((void)0)
     #define ALLOCATION_TRACKER_PRINT_NOW() ((void)0)
     #define VRO_MALLOC(x, bytes) malloc(bytes)
@@ -54,6 +57,11 @@
     #define VRO_REALLOC(x, ptr, bytesOld, bytesNew) realloc(ptr, bytesNew)
 #endif
 
+/*
+ Buckets up to GeometryArenaFragments count objects (or streamer state); the
+ Memory buckets count bytes. GPU sizes are estimates derived from the allocated
+ dimensions and formats, since GL does not report actual usage.
+ */
 enum class VROAllocationBucket {
     Scenes,
     Nodes,
@@ -73,18 +81,73 @@ enum class VROAllocationBucket {
     VBO,
     TaskQueues,
     Anchors,
+    StreamedTexturesResident,
+    StreamedTexturesRequested,
+    GeometryArenaReserved,
+    GeometryArenaUsed,
+    GeometryArenaFragments,
+    TextureMemory,
+    VertexBufferMemory,
+    IndexBufferMemory,
+    RenderTargetMemory,
+    GlyphAtlasMemory,
+    DataMemory,
     NUM_BUCKETS
 };
 
 enum class VROLayerType : int8_t;
+enum class VROTextureFormat;
+
+/*
+ Snapshot of a single counter. The scene values are relative to the last call
+ to VROAllocationTracker::beginScene(), which the renderer invokes whenever a
+ new scene is presented.
+ */
+struct VROAllocationStats {
+    int64_t current;
+    int64_t peak;
+    int64_t scenePeak;
+    int64_t sceneDelta;
+};
 
+/*
+ Lock-free counters of live objects and memory, with high-water marks. Safe
+ to update and query from any thread.
+ */
 class VROAllocationTracker {
 
 public:
-    static void set(VROAllocationBucket bucket, uint32_t bytes);
-    static void add(VROAllocationBucket bucket, uint32_t bytes);
-    static void subtract(VROAllocationBucket bucket, uint32_t bytes);
-    static void resize(VROAllocationBucket bucket, uint32_t bytesOld, uint32_t bytesNew);
+    static void set(VROAllocationBucket bucket, int64_t value);
+    static void add(VROAllocationBucket bucket, int64_t value);
+    static void subtract(VROAllocationBucket bucket, int64_t value);
+    static void resize(VROAllocationBucket bucket, int64_t valueOld, int64_t valueNew);
+
+    /*
+     Texture memory is additionally broken down by source format. These update
+     both the per-format counter and TextureMemory.
+     */
+    static void addTextureMemory(VROTextureFormat format, int64_t bytes);
+    static void subtractTextureMemory(VROTextureFormat format, int64_t bytes);
+
+    static VROAllocationStats getStats(VROAllocationBucket bucket);
+    static VROAllocationStats getTextureStats(VROTextureFormat format);
+    static const char *getBucketName(VROAllocationBucket bucket);
+
+    /*
+     Start attributing allocations to a new scene: the scene deltas are reset
+     to zero and the scene peaks to the current values.
+     */
+    static void beginScene();
+
+    /*
+     Reset all high-water marks (global and scene) to the current values.
+     */
+    static void resetPeaks();
+
+    /*
+     All counters as a JSON object keyed by bucket name, for telemetry.
+     */
+    static std::string toJSON();
 
     static void print();
     static void printNow();
@@ -29,9 +29,12 @@
 #include "VROAnimation.h"
 #include "VROThreadRestricted.h"
 #include "VROLog.h"
+#include "VRORenderInvalidation.h"
+#include <cstring>
 
 void VROAnimatable::animate(std::shared_ptr<VROAnimation> animation) {
     animation->setAnimatable(shared_from_this());
+    VRORenderInvalidation::invalidate();
 
     // If we're not on the rendering thread, or if there is no current transaction,
     // then do not animate: skip straight to the final value.
@@ -47,3 +50,33 @@ void VROAnimatable::animate(std::shared_ptr<VROAnimation> animation) {
         animation->onTermination();
     }
 }
+
+void VROAnimatable::animateFloats(float *values, const float *targets, int count, VROAnimatableApply apply) {
+    VRORenderInvalidation::invalidate();
+    if (VROThreadRestricted::isThread(VROThreadName::Renderer)) {
+        std::shared_ptr<VROTransaction> transaction = VROTransaction::get();
+        if (transaction && !transaction->isDegenerate()) {
+            transaction->getAnimationBatch().addFloats(shared_from_this(), values, targets, count, apply);
+            return;
+        }
+    }
+
+    memcpy(values, targets, count * sizeof(float));
+    apply(this);
+    onAnimationFinished();
+}
+
+void VROAnimatable::animateQuaternion(VROQuaternion *value, VROQuaternion target, VROAnimatableApply apply) {
+    VRORenderInvalidation::invalidate();
+    if (VROThreadRestricted::isThread(VROThreadName::Renderer)) {
+        std::shared_ptr<VROTransaction> transaction = VROTransaction::get();
+        if (transaction && !transaction->isDegenerate()) {
+            transaction->getAnimationBatch().addQuaternion(shared_from_this(), value, target, apply);
+            return;
+        }
+    }
+
+    *value = target;
+    apply(this);
+    onAnimationFinished();
+}
@@ -34,6 +34,14 @@
 #include <memory>
 
 class VROAnimation;
+class VROAnimatable;
+class VROQuaternion;
+
+/*
+ Invoked after a batched animation writes a new value into a property of the
+ animatable, to apply side effects such as marking transforms dirty.
+ */
+typedef void (*VROAnimatableApply)(VROAnimatable *const animatable);
 
 /*
  Marker class for objects that have animatable properties.
@@ -43,6 +51,16 @@ public:
     
     void animate(std::shared_ptr<VROAnimation> animation);
 
+    /*
+     Animate the count floats (1 to 4) at values, which must be members of this
+     object, to the given targets; or the quaternion at value to target. These
+     are equivalent to animate() with a VROAnimationFloat or VROAnimationQuaternion,
+     but are evaluated in bulk with the rest of the transaction's properties.
+     The apply function is invoked after each new value is written.
+     */
+    void animateFloats(float *values, const float *targets, int count, VROAnimatableApply apply);
+    void animateQuaternion(VROQuaternion *value, VROQuaternion target, VROAnimatableApply apply);
+
     virtual void onAnimationFinished(){
         //No-op
     }
@@ -32,14 +32,223 @@
 #include "VROFrameSynchronizer.h"
 #include <giflib/gif_lib.h>
 #include "VRODriver.h"
+#include "VRODriverOpenGL.h"
 #include "VROTextureSubstrate.h"
 #include "VROFrameScheduler.h"
 #include "VROStringUtil.h"
 #include "VROTextureSubstrateOpenGL.h"
+#include "VROTextureAtlasPool.h"
 #include "VROPlatformUtil.h"
+#include <deque>
+#include <mutex>
+
+/*
+ Bounds on the size of sprite sheets, in pixels on a side. Each sheet is sized to
+ the smallest power of two in this range that holds every frame.
+ */
+static const int kGIFSpriteSheetMinSize = 128;
+static const int kGIFSpriteSheetMaxSize = 1024;
+
+/*
+ Converts the frames of a slurped GIF to RGBA. Transparent pixels are filled from
+ the frames before them, so frames are converted in order, wrapping back to the
+ first frame when the animation loops; each is identified by its sequence number,
+ the count of frames converted before it.
+
+ decodeAhead() converts frames on a worker thread into a ring holding at most
+ kGIFDecodeAheadFrames of them, from which the rendering thread pops the frame it
+ needs. Only one worker task converts frames at a time.
+ */
+class VROGIFFrameDecoder : public std::enable_shared_from_this<VROGIFFrameDecoder> {
+public:
+    
+    VROGIFFrameDecoder(GifFileType *gifFile) :
+        _gifFile(gifFile),
+        _lastFrameCache(gifFile->SWidth * gifFile->SHeight, 0),
+        _canvas(gifFile->SWidth * gifFile->SHeight, 0),
+        _nextSequence(0),
+        _decoding(false) {}
+    
+    virtual ~VROGIFFrameDecoder() {
+        int error;
+        DGifCloseFile(_gifFile, &error);
+    }
+    
+    void setGraphicsControlBlocks(std::vector<GraphicsControlBlock> gcbs) {
+        _gcbs = gcbs;
+    }
+    
+    /*
+     Convert the next frame in sequence, returning the RGBA pixels of the region it
+     covers. The region is also composited onto the canvas.
+     */
+    std::shared_ptr<VROData> decodeNextFrame();
+    
+    /*
+     Copy of the canvas: the full image shown once the last converted frame is
+     displayed.
+     */
+    std::shared_ptr<VROData> copyCanvas() const;
+    
+    /*
+     Refill the ring on a worker thread, if it has room and is not already being
+     refilled.
+     */
+    void decodeAhead();
+    
+    /*
+     Remove and return the frame with the given sequence number from the ring,
+     discarding the frames before it. Returns nullptr if the frame has not been
+     converted yet.
+     */
+    std::shared_ptr<VROData> popFrame(int64_t sequence);
+    
+private:
+    
+    GifFileType *_gifFile;
+    std::vector<GraphicsControlBlock> _gcbs;
+    
+    /*
+     Conversion state, touched only by the thread converting frames.
+     */
+    std::vector<uint32_t> _lastFrameCache;
+    std::vector<uint32_t> _canvas;
+    int64_t _nextSequence;
+    
+    /*
+     The ring of converted frames, keyed by sequence number, guarded by _mutex.
+     */
+    std::mutex _mutex;
+    std::deque<std::pair<int64_t, std::shared_ptr<VROData>>> _ring;
+    bool _decoding;
+    
+};
+
+std::shared_ptr<VROData> VROGIFFrameDecoder::decodeNextFrame() {
+    int frameIndex = (int) (_nextSequence % _gifFile->ImageCount);
+    _nextSequence++;
+    
+    const GraphicsControlBlock &gcb = _gcbs[frameIndex];
+    SavedImage *frame = &_gifFile->SavedImages[frameIndex];
+    
+    // Per frame image data is stored in a color map. Thus, attempt to grab the current
+    // local color map, else grab the global one.
+    ColorMapObject *colorMap = frame->ImageDesc.ColorMap;
+    if (colorMap == NULL){
+        colorMap = _gifFile->SColorMap;
+    }
+    
+    // Finally, with the color map, parse out the current frame's raw image.
+    int frameWidth   = frame->ImageDesc.Width;
+    int frameHeight  = frame->ImageDesc.Height;
+    unsigned int *frameColorData = (unsigned int *) malloc(frameWidth * frameHeight * sizeof(unsigned int));
+    for (int py = 0; py < frameHeight; py++) {
+        for (int px = 0; px < frameWidth; px++) {
+            unsigned int color = 0;
+            int currentPixelIndex = py * frameWidth + px;
+            auto clrIndex = frame->RasterBits[currentPixelIndex];
+            if (clrIndex < colorMap->ColorCount) {
+                auto &clrObj = colorMap->Colors[clrIndex];
+                auto r = clrObj.Red;
+                auto g = clrObj.Green;
+                auto b = clrObj.Blue;
+                auto alpha = clrIndex == gcb.TransparentColor ? 0x00 : 0xFF;
+                color = (alpha << 24) | (b << 16) | (g << 8) | r;
+            } else {
+                pwarn("Viro: Invalid Color pallete found in Animated Texture.");
+            }
+            
+            /*
+             In GIFs, individual frames with transparent regions can be used to reveal
+             pixel color data from previously rendered frames. This is often used as an
+             optimization in compressing GIF data. Unfortunately, we currently update frames
+             via glTexSubImage2D that effectively replaces the entire image region's pixel,
+             causing a visual defect when animating gifs (previous color data is lost).
+             
+             To get around this, we simply keep a single "last frame cache" that at first
+             encompases the entire GIF image. We then update this cache with new pixel data
+             with each new parsed GIF frame - if and only if the pixel data of that
+             current sub frame is NOT transparent. We can then use this cache to render
+             future gif-transparent pixels, thereby effectively copying the behavior of
+             rendering previous frames as desired by GIF.
+             */
+            int masterIndex = (py + frame->ImageDesc.Top) * _gifFile->SWidth
+                              + (px + frame->ImageDesc.Left);
+            if (frameIndex == 0) {
+                _lastFrameCache[masterIndex] = color;
+            }
+            
+            if (clrIndex == gcb.TransparentColor) {
+                if (gcb.DisposalMode == 2) {
+                    // Restore to background color.
+                    color = clrIndex == _gifFile->SBackGroundColor;
+                } else  {
+                    // Restore to Previous color.
+                    color = _lastFrameCache[masterIndex];
+                }
+            } else {
+                _lastFrameCache[masterIndex] = color;
+            }
+            
+            frameColorData[currentPixelIndex] = color;
+        }
+        
+        memcpy(&_canvas[(py + frame->ImageDesc.Top) * _gifFile->SWidth + frame->ImageDesc.Left],
+               &frameColorData[py * frameWidth], frameWidth * sizeof(unsigned int));
+    }
+    
+    return std::make_shared<VROData>((void *) frameColorData, frameWidth * frameHeight * sizeof(unsigned int),
+                                     VRODataOwnership::Move);
+}
+
+std::shared_ptr<VROData> VROGIFFrameDecoder::copyCanvas() const {
+    return std::make_shared<VROData>((void *) _canvas.data(), _canvas.size() * sizeof(uint32_t),
+                                     VRODataOwnership::Copy);
+}
+
+void VROGIFFrameDecoder::decodeAhead() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_decoding || _ring.size() >= kGIFDecodeAheadFrames) {
+            return;
+        }
+        _decoding = true;
+    }
+    
+    std::shared_ptr<VROGIFFrameDecoder> decoder = shared_from_this();
+    VROPlatformDispatchAsyncWorker([decoder] {
+        while (true) {
+            int64_t sequence = decoder->_nextSequence;
+            std::shared_ptr<VROData> frame = decoder->decodeNextFrame();
+            
+            std::lock_guard<std::mutex> lock(decoder->_mutex);
+            decoder->_ring.push_back({ sequence, frame });
+            if (decoder->_ring.size() >= kGIFDecodeAheadFrames) {
+                decoder->_decoding = false;
+                return;
+            }
+        }
+    });
+}
+
+std::shared_ptr<VROData> VROGIFFrameDecoder::popFrame(int64_t sequence) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    while (!_ring.empty() && _ring.front().first < sequence) {
+        _ring.pop_front();
+    }
+    if (_ring.empty() || _ring.front().first != sequence) {
+        return nullptr;
+    }
+    std::shared_ptr<VROData> frame = _ring.front().second;
+    _ring.pop_front();
+    return frame;
+}
+
+#pragma mark - VROAnimatedTextureOpenGL
 
 VROAnimatedTextureOpenGL::VROAnimatedTextureOpenGL(VROStereoMode state):
-        VROTexture(VROTextureType::Texture2D, VROTextureInternalFormat::RGBA8, state) {
+        VROTexture(VROTextureType::Texture2D, VROTextureInternalFormat::RGBA8, state),
+        _spriteSheetSubstrate(nullptr) {
     // No-op
 }
 
@@ -112,13 +321,43 @@ void VROAnimatedTextureOpenGL::animateTexture(double globalCurrentTimeMs) {
         return;
     }
 
-    // Else, render the sub-section of the animated image as needed.
+    // Sprite sheets only need to sample the frame's region of the sheet.
+    if (_spriteSheetSubstrate) {
+        _currentAnimFrame = i;
+        _spriteSheetSubstrate->setAtlasRect(_animatedFrameData[i].spriteSheetRect);
+        return;
+    }
+
+    // Without a decoder (the sprite sheet could not be created), upload the entire frame.
+    if (!_decoder) {
+        _currentAnimFrame = i;
+        GL( glBindTexture(GL_TEXTURE_2D, _initTexture) );
+        GL( glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, _width, _height,
+                            GL_RGBA, GL_UNSIGNED_BYTE, _compositedFrames[i]->getData()) );
+        GL( glBindTexture(GL_TEXTURE_2D, 0) );
+        return;
+    }
+
+    /*
+     Else, pop the frame from the decode-ahead ring and render the sub-section of
+     the animated image. If the frame is not ready yet, keep showing the current
+     frame and try again next frame.
+     */
+    int numFrames = (int) _animatedFrameData.size();
+    int64_t sequence = _currentAnimSequence + (i - _currentAnimFrame + numFrames) % numFrames;
+    std::shared_ptr<VROData> rawData = _decoder->popFrame(sequence);
+    _decoder->decodeAhead();
+    if (!rawData) {
+        return;
+    }
+
     _currentAnimFrame = i;
+    _currentAnimSequence = sequence;
     GL( glBindTexture(GL_TEXTURE_2D, _initTexture) );
     GL( glTexSubImage2D(GL_TEXTURE_2D, 0,
                         _animatedFrameData[i].left, _animatedFrameData[i].top,
                         _animatedFrameData[i].width, _animatedFrameData[i].height,
-                        GL_RGBA, GL_UNSIGNED_BYTE, _animatedFrameData[i].rawData->getData()) );
+                        GL_RGBA, GL_UNSIGNED_BYTE, rawData->getData()) );
     GL( glBindTexture(GL_TEXTURE_2D, 0) );
 }
 
@@ -200,20 +439,32 @@ bool VROAnimatedTextureOpenGL::parseGIFFile(std::string path, std::string &error
     // Process the source into a GIFLIB format for us to parse through.
     if(DGifSlurp(gifFile) == GIF_ERROR) {
         errorOut = "Invalid GIF file: " + path;
+        DGifCloseFile(gifFile, &error);
         return false;
     }
 
     // TODO VIRO-4167: Support Interlaced GIFS.
     if (gifFile->Image.Interlace){
         errorOut = "Interlaced GIFs are not currently supported.";
+        DGifCloseFile(gifFile, &error);
+        return false;
+    }
+    if (gifFile->ImageCount < 1) {
+        errorOut = "GIF file contains no frames: " + path;
+        DGifCloseFile(gifFile, &error);
         return false;
     }
     _height = gifFile->SHeight;
     _width = gifFile->SWidth;
 
-    // Start iterating through each GIF frame and processing its data.
+    // The decoder owns the GIF from here on, closing it once it's released
+    std::shared_ptr<VROGIFFrameDecoder> decoder = std::make_shared<VROGIFFrameDecoder>(gifFile);
+    _animatedFrameData.clear();
+    _compositedFrames.clear();
+
+    // Start iterating through each GIF frame and validating its data.
     double totalDuration = 0;
-    unsigned int *lastFrameCache = new unsigned int[_width * _height];
+    std::vector<GraphicsControlBlock> gcbs;
     for (int frameIndex = 0; frameIndex < gifFile->ImageCount; frameIndex ++) {
         GraphicsControlBlock gcb;
         int ret = DGifSavedExtensionToGCB(gifFile, frameIndex, &gcb);
@@ -221,6 +472,7 @@ bool VROAnimatedTextureOpenGL::parseGIFFile(std::string path, std::string &error
             errorOut = "Invalid GIF Graphics Control Block for multi-frame animation";
             return false;
         }
+        gcbs.push_back(gcb);
 
         // Process the current timestamp representing this GIF frame.
         int delayMs = gcb.DelayTime * 10;
@@ -231,103 +483,78 @@ bool VROAnimatedTextureOpenGL::parseGIFFile(std::string path, std::string &error
         animFrame.timeStamp = totalDuration;
         totalDuration = totalDuration + delayMs;
 
-        // Per frame image data is stored in a color map. Thus, attempt to grab the current
-        // local color map, else grab the global one.
-        ColorMapObject *colorMap = gifFile->SavedImages[frameIndex].ImageDesc.ColorMap;
-        if (colorMap == NULL){
-            colorMap = gifFile->SColorMap;
-        }
-
-        if (colorMap == NULL){
+        SavedImage *frame = &gifFile->SavedImages[frameIndex];
+        if (frame->ImageDesc.ColorMap == NULL && gifFile->SColorMap == NULL){
             errorOut = "Malformed GIF Color Palete detected in image!";
             return false;
         }
-
-        // Finally, with the color map, parse out the current frame's raw image.
-        SavedImage *frame = &gifFile->SavedImages[frameIndex];
-        int frameWidth   = frame->ImageDesc.Width;
-        int frameHeight  = frame->ImageDesc.Height;
-        unsigned int *frameColorData = new unsigned int[frameWidth*frameHeight];
-        for (int py = 0; py < frameHeight; py++) {
-            for (int px = 0; px < frameWidth; px++) {
-                unsigned int color = 0;
-                int currentPixelIndex = py * frameWidth + px;
-                auto clrIndex = frame->RasterBits[currentPixelIndex];
-                if (clrIndex <= colorMap->ColorCount) {
-                    auto &clrObj = colorMap->Colors[clrIndex];
-                    auto r = clrObj.Red;
-                    auto g = clrObj.Green;
-                    auto b = clrObj.Blue;
-                    auto alpha = clrIndex == gcb.TransparentColor ? 0x00 : 0xFF;
-                    color = (alpha << 24) | (b << 16) | (g << 8) | r;
-                } else {
-                    pwarn("Viro: Invalid Color pallete found in Animated Texture.");
-                }
-
-                /*
-                 In GIFs, individual frames with transparent regions can be used to reveal
-                 pixel color data from previously rendered frames. This is often used as an
-                 optimization in compressing GIF data. Unfortunately, we currently update frames
-                 via glTexSubImage2D that effectively replaces the entire image region's pixel,
-                 causing a visual defect when animating gifs (previous color data is lost).
-
-                 To get around this, we simply keep a single "last frame cache" that at first
-                 encompases the entire GIF image. We then update this cache with new pixel data
-                 with each new parsed GIF frame - if and only if the pixel data of that
-                 current sub frame is NOT transparent. We can then use this cache to render
-                 future gif-transparent pixels, thereby effectively copying the behavior of
-                 rendering previous frames as desired by GIF.
-                 */
-                int masterIndex = (py + gifFile->SavedImages[frameIndex].ImageDesc.Top) * gifFile->SWidth
-                                  + (px + gifFile->SavedImages[frameIndex].ImageDesc.Left);
-                if (frameIndex == 0) {
-                    lastFrameCache[masterIndex] = color;
-                }
-
-                if (clrIndex == gcb.TransparentColor) {
-                    if (gcb.DisposalMode == 2) {
-                        // Restore to background color.
-                        color = clrIndex == gifFile->SBackGroundColor;
-                    } else  {
-                        // Restore to Previous color.
-                        color = lastFrameCache[masterIndex];
-                    }
-                } else {
-                    lastFrameCache[masterIndex] = color;
-                }
-
-                frameColorData[currentPixelIndex] = color;
-            }
+        if (frame->ImageDesc.Left < 0 || frame->ImageDesc.Top < 0 ||
+            frame->ImageDesc.Left + frame->ImageDesc.Width  > _width ||
+            frame->ImageDesc.Top  + frame->ImageDesc.Height > _height) {
+            errorOut = "Malformed GIF frame extends outside of the image!";
+            return false;
         }
 
-        std::vector<uint32_t> mipSizes;
-        std::shared_ptr<VROData> texData = std::make_shared<VROData>((void *)frameColorData,
-                                                                     frameWidth*frameHeight*sizeof(unsigned int),
-                                                                     VRODataOwnership::Move);
-        animFrame.rawData = texData;
-        animFrame.top = gifFile->SavedImages[frameIndex].ImageDesc.Top;
-        animFrame.left = gifFile->SavedImages[frameIndex].ImageDesc.Left;
-        animFrame.width = frameWidth;
-        animFrame.height = frameHeight;
+        animFrame.spriteSheetRect = VROVector4f(0, 0, 1, 1);
+        animFrame.top = frame->ImageDesc.Top;
+        animFrame.left = frame->ImageDesc.Left;
+        animFrame.width = frame->ImageDesc.Width;
+        animFrame.height = frame->ImageDesc.Height;
         _animatedFrameData.push_back(animFrame);
     }
-
+    decoder->setGraphicsControlBlocks(gcbs);
     _animatedTotalDuration = totalDuration;
-    DGifCloseFile(gifFile, &error);
+
+    /*
+     Short animations are composited up front, to be placed on a sprite sheet. Longer
+     animations only composite their first frame here; the rest are converted ahead
+     of playback.
+     */
+    if (getSpriteSheetSize() > 0) {
+        for (int frameIndex = 0; frameIndex < gifFile->ImageCount; frameIndex++) {
+            decoder->decodeNextFrame();
+            _compositedFrames.push_back(decoder->copyCanvas());
+        }
+        _decoder = nullptr;
+    } else {
+        decoder->decodeNextFrame();
+        _compositedFrames.push_back(decoder->copyCanvas());
+        decoder->decodeAhead();
+        _decoder = decoder;
+    }
     return true;
 }
 
+int VROAnimatedTextureOpenGL::getSpriteSheetSize() const {
+    int numFrames = (int) _animatedFrameData.size();
+    for (int size = kGIFSpriteSheetMinSize; size <= kGIFSpriteSheetMaxSize; size *= 2) {
+        int framesPerRow = size / (_width  + kTextureAtlasPadding * 2);
+        int rows         = size / (_height + kTextureAtlasPadding * 2);
+        if (framesPerRow * rows >= numFrames) {
+            return size;
+        }
+    }
+    return 0;
+}
+
 void VROAnimatedTextureOpenGL::init(std::shared_ptr<VRODriver> driver) {
     _processedAnimationStartTime = 0;
     _currentAnimFrame = 0;
+    _currentAnimSequence = 0;
     _processedTimeWhenPaused = 0;
     _loop = true;
     _paused = false;
+    _spriteSheetSubstrate = nullptr;
+
+    if (!_decoder && initSpriteSheet(driver)) {
+        _compositedFrames.clear();
+        return;
+    }
 
     // Initialize a single texture substrate for swapping and updating animation frames
     // via it's textureID that will be stored in _initTexture.
     std::vector<uint32_t> mipSizes;
-    std::vector<std::shared_ptr<VROData>> data = {_animatedFrameData[0].rawData};
+    std::vector<std::shared_ptr<VROData>> data = {_compositedFrames[0]};
     VROTextureSubstrate *textureSub = driver->newTextureSubstrate(VROTextureType::Texture2D,
                                                                   VROTextureFormat::RGBA8,
                                                                   VROTextureInternalFormat::RGBA8,
@@ -343,9 +570,39 @@ void VROAnimatedTextureOpenGL::init(std::shared_ptr<VRODriver> driver) {
                                                                   VROFilterMode::Linear,
                                                                   VROFilterMode::Linear);
     _initTexture = ((VROTextureSubstrateOpenGL *) textureSub)->getTexture().second;
+    if (_decoder) {
+        _compositedFrames.clear();
+    }
 
     // Configure the substrate to show the first animated frame.
     std::unique_ptr<VROTextureSubstrate> uniqueTextureSub = std::unique_ptr<VROTextureSubstrate>(textureSub);
     setSubstrate(0, std::move(uniqueTextureSub));
 }
 
+bool VROAnimatedTextureOpenGL::initSpriteSheet(std::shared_ptr<VRODriver> driver) {
+    std::shared_ptr<VRODriverOpenGL> driverGL = std::dynamic_pointer_cast<VRODriverOpenGL>(driver);
+    int size = getSpriteSheetSize();
+    if (!driverGL || size == 0) {
+        return false;
+    }
+
+    GLenum internalFormat = VROTextureSubstrateOpenGL::getInternalFormat(VROTextureInternalFormat::RGBA8,
+                                                                         driver->isLinearRenderingEnabled());
+    if (internalFormat == GL_RGBA) {
+        internalFormat = GL_RGBA8;
+    }
+
+    // The sheet is a private atlas page, so no other texture's materials share its ID
+    std::shared_ptr<VROTextureAtlas> sheet = std::make_shared<VROTextureAtlas>(internalFormat, GL_LINEAR, GL_LINEAR,
+                                                                               driverGL, size);
+    for (int i = 0; i < _animatedFrameData.size(); i++) {
+        if (!sheet->insert(_compositedFrames[i]->getData(), _width, _height,
+                           &_animatedFrameData[i].spriteSheetRect)) {
+            return false;
+        }
+    }
+
+    _spriteSheetSubstrate = new VROTextureSubstrateOpenGL(sheet, _animatedFrameData[0].spriteSheetRect, driverGL);
+    setSubstrate(0, std::unique_ptr<VROTextureSubstrate>(_spriteSheetSubstrate));
+    return true;
+}
@@ -29,17 +29,31 @@
 #include "VROFrameListener.h"
 #include "VROTexture.h"
 #include "VROOpenGL.h"
+#include "VROVector4f.h"
 #include <memory>
 
 class VRORenderContext;
 class VROFrameSynchronizer;
 class VRODriver;
+class VROTextureSubstrateOpenGL;
+class VROGIFFrameDecoder;
+
+/*
+ Number of frames the GIF decoder keeps converted ahead of playback, for
+ animations too long to fit on a sprite sheet.
+ */
+static const int kGIFDecodeAheadFrames = 4;
 
 /*
  VROAnimatedTextureOpenGL handles the construction and playing of animated texture
  files. These files contain textured data with series of images / frames separated
  by a set of predefined time delays, that when played in rapid succession is viewed
  as an animated texture. Currently, we only support GIF-formatted animated textures.
+ 
+ Short animations are composited once into a sprite sheet (a private atlas page),
+ and playback simply moves the region sampled by the diffuse atlas shader. Longer
+ animations are uploaded frame by frame, from a small ring of frames converted
+ ahead of playback on a worker thread.
  */
 class VROAnimatedTextureOpenGL : public VROTexture, public VROFrameListener {
 public:
@@ -56,6 +70,8 @@ public:
                                  std::function<void(bool, std::string)> callback);
     void onFrameWillRender(const VRORenderContext &context);
     void onFrameDidRender(const VRORenderContext &context);
+    bool isAnimating() { return !_paused; }
+    const char *getFrameListenerName() const { return "animatedTexture"; }
 
     /*
      Plays the animated texture. The animation automatically restarts if had previously
@@ -95,6 +111,18 @@ private:
      */
     void animateTexture(double globalCurrentTimeMs);
 
+    /*
+     Upload the composited frames of a short animation onto a private atlas page.
+     Returns false if the page could not be created.
+     */
+    bool initSpriteSheet(std::shared_ptr<VRODriver> driver);
+
+    /*
+     Size of the smallest sprite sheet that holds every frame, or 0 if the animation
+     is too long or too large to be placed on a sprite sheet.
+     */
+    int getSpriteSheetSize() const;
+
     /*
      Properties for pausing / playing the animated texture.
      */
@@ -107,10 +135,16 @@ private:
     double _animatedTotalDuration;
 
     /*
-     The index of the current frame in _animatedFrameRawData that is being rendered.
+     The index of the current frame in _animatedFrameData that is being rendered.
      */
     int _currentAnimFrame;
 
+    /*
+     The number of frames decoded before the current one since the animation began,
+     counting across loops. Identifies the current frame in the decode-ahead ring.
+     */
+    int64_t _currentAnimSequence;
+
     /*
      Time at which the animation had started, in milliseconds. It is redefined as the texture
      is paused / resumed.
@@ -129,10 +163,28 @@ private:
     GLuint _initTexture;
 
     /*
-     Struct for storing raw image data properties, per frame.
+     The substrate of the sprite sheet, if this animation was short enough to be
+     placed on one. Owned by this texture's substrates.
+     */
+    VROTextureSubstrateOpenGL *_spriteSheetSubstrate;
+
+    /*
+     Converts frames ahead of playback when there is no sprite sheet.
+     */
+    std::shared_ptr<VROGIFFrameDecoder> _decoder;
+
+    /*
+     The fully composited first frame, which initializes the texture. For sprite
+     sheets, holds the composited image of every frame until the sheet is created.
+     */
+    std::vector<std::shared_ptr<VROData>> _compositedFrames;
+
+    /*
+     Struct for storing image data properties, per frame. The rect is the frame's
+     region of the sprite sheet, if any.
      */
     struct AnimatedFrame{
-        std::shared_ptr<VROData> rawData;
+        VROVector4f spriteSheetRect;
         double timeStamp;
         int top;
         int left;
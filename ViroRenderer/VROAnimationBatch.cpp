@@ -0,0 +1,115 @@
+//
+//  VROAnimationBatch.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include "VROAnimationBatch.h"
+#include <algorithm>
+#include <cstring>
+
+// Unaligned vector type, so that the float arrays can be interpolated with
+// vector instructions (NEON or SSE) on every platform
+typedef float float4 __attribute__((__vector_size__(16), __aligned__(4)));
+
+void VROAnimationBatch::addFloats(std::shared_ptr<VROAnimatable> animatable, float *values, const float *targets,
+                                  int count, VROAnimatableApply apply) {
+    int offset = (int) _floatStarts.size();
+    _floatStarts.insert(_floatStarts.end(), values, values + count);
+    _floatEnds.insert(_floatEnds.end(), targets, targets + count);
+    _floatValues.resize(_floatStarts.size());
+    _entries.push_back({ animatable, values, apply, offset, count });
+}
+
+void VROAnimationBatch::addQuaternion(std::shared_ptr<VROAnimatable> animatable, VROQuaternion *value,
+                                      VROQuaternion target, VROAnimatableApply apply) {
+    int offset = (int) _quaternionStarts.size();
+    _quaternionStarts.push_back(*value);
+    _quaternionEnds.push_back(target);
+    _quaternionValues.resize(_quaternionStarts.size());
+    _quaternionTimes.resize(_quaternionStarts.size());
+    _entries.push_back({ animatable, value, apply, offset, 0 });
+}
+
+void VROAnimationBatch::process(float t) {
+    if (t <= 0) {
+        write(_floatStarts, _quaternionStarts, false);
+        return;
+    }
+    if (t >= 1) {
+        write(_floatEnds, _quaternionEnds, false);
+        return;
+    }
+
+    const float *starts = _floatStarts.data();
+    const float *ends = _floatEnds.data();
+    float *values = _floatValues.data();
+    size_t numFloats = _floatStarts.size();
+
+    size_t i = 0;
+    float4 t4 = { t, t, t, t };
+    for (; i + 4 <= numFloats; i += 4) {
+        float4 start, end;
+        memcpy(&start, starts + i, sizeof(float4));
+        memcpy(&end, ends + i, sizeof(float4));
+
+        float4 value = start + (end - start) * t4;
+        memcpy(values + i, &value, sizeof(float4));
+    }
+    for (; i < numFloats; i++) {
+        values[i] = starts[i] + (ends[i] - starts[i]) * t;
+    }
+
+    if (!_quaternionStarts.empty()) {
+        std::fill(_quaternionTimes.begin(), _quaternionTimes.end(), t);
+        VROQuaternion::slerp(_quaternionStarts.data(), _quaternionEnds.data(), _quaternionTimes.data(),
+                             (int) _quaternionStarts.size(), _quaternionValues.data());
+    }
+    write(_floatValues, _quaternionValues, false);
+}
+
+void VROAnimationBatch::finish() {
+    write(_floatEnds, _quaternionEnds, true);
+}
+
+void VROAnimationBatch::write(const std::vector<float> &floats, const std::vector<VROQuaternion> &quaternions,
+                              bool finished) {
+    for (const Entry &entry : _entries) {
+        std::shared_ptr<VROAnimatable> animatable = entry.animatable.lock();
+        if (!animatable) {
+            continue;
+        }
+
+        if (entry.count > 0) {
+            memcpy(entry.destination, floats.data() + entry.offset, entry.count * sizeof(float));
+        }
+        else {
+            *((VROQuaternion *) entry.destination) = quaternions[entry.offset];
+        }
+        entry.apply(animatable.get());
+
+        if (finished) {
+            animatable->onAnimationFinished();
+        }
+    }
+}
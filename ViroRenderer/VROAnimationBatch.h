@@ -0,0 +1,108 @@
+//
+//  VROAnimationBatch.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef VROAnimationBatch_h
+#define VROAnimationBatch_h
+
+#include <memory>
+#include <vector>
+#include "VROAnimatable.h"
+#include "VROQuaternion.h"
+
+/*
+ Property animations of a transaction that are evaluated in bulk, instead of
+ one VROAnimation (and one std::function setter) per property. Because every
+ animation in a transaction shares its T value and timing function, the
+ batch keeps their start and end values in flat typed arrays: float
+ properties are interpolated four values at a time with vector instructions,
+ and quaternions with the batched VROQuaternion::slerp. The results are then
+ written straight into the animated members, after which each property's
+ apply function (e.g. to mark transforms dirty) is invoked.
+
+ Properties are written in the order they were added, so a property animated
+ twice in one transaction ends at the later target, as with VROAnimation.
+ */
+class VROAnimationBatch {
+public:
+
+    VROAnimationBatch() {}
+
+    bool empty() const {
+        return _entries.empty();
+    }
+
+    /*
+     Animate the count floats (1 to 4) at values, which must be members of the
+     given animatable, from their current values to the given targets.
+     */
+    void addFloats(std::shared_ptr<VROAnimatable> animatable, float *values, const float *targets,
+                   int count, VROAnimatableApply apply);
+
+    /*
+     Animate the quaternion at value, a member of the given animatable, from its
+     current value to the given target.
+     */
+    void addQuaternion(std::shared_ptr<VROAnimatable> animatable, VROQuaternion *value,
+                       VROQuaternion target, VROAnimatableApply apply);
+
+    /*
+     Move every property to its value at the given (timing function transformed)
+     T. As with VROAnimation, T values outside [0, 1] hold the start or end.
+     */
+    void process(float t);
+
+    /*
+     Move every property to its end value, and notify each animatable that its
+     animation finished.
+     */
+    void finish();
+
+private:
+
+    /*
+     One animated property. Its values are at offset in the float arrays, or in
+     the quaternion arrays if count is 0. The destination is only written while
+     the animatable is alive.
+     */
+    struct Entry {
+        std::weak_ptr<VROAnimatable> animatable;
+        void *destination;
+        VROAnimatableApply apply;
+        int offset;
+        int count;
+    };
+
+    std::vector<Entry> _entries;
+    std::vector<float> _floatStarts, _floatEnds, _floatValues;
+    std::vector<VROQuaternion> _quaternionStarts, _quaternionEnds, _quaternionValues;
+    std::vector<float> _quaternionTimes;
+
+    void write(const std::vector<float> &floats, const std::vector<VROQuaternion> &quaternions,
+               bool finished);
+
+};
+
+#endif /* VROAnimationBatch_h */
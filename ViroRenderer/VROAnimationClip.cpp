@@ -0,0 +1,357 @@
+//
+//  VROAnimationClip.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROAnimationClip.h"
+#include "VROSkeletalAnimation.h"
+#include "VROLog.h"
+#include "VROMath.h"
+#include <map>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+
+// Maximum error introduced by removing keys: in model units for translation and
+// scale, and in radians for rotation
+static const float kTranslationTolerance = 1e-4;
+static const float kScaleTolerance = 1e-4;
+static const float kRotationTolerance = 1e-3;
+
+// Transforms whose recomposed translation, rotation and scale differ from the
+// original by more than this (relative to the largest element) are stored as matrices
+static const float kDecompositionTolerance = 1e-3;
+
+// Maximum number of keys a removed run may span. This bounds the cost of fitting,
+// which is quadratic in the span.
+static const int kMaxReducedKeySpan = 64;
+
+// Range of the smallest three components of a unit quaternion
+static const float kSmallestThreeRange = 0.70710678f;
+
+#pragma mark - Quantization
+
+static uint16_t quantize(float value, float min, float extent) {
+    if (extent <= 0) {
+        return 0;
+    }
+    float normalized = std::max(0.0f, std::min(1.0f, (value - min) / extent));
+    return (uint16_t) lroundf(normalized * 65535.0f);
+}
+
+static float dequantize(uint16_t value, float min, float extent) {
+    return min + (value / 65535.0f) * extent;
+}
+
+static float getKeyTime(const VROAnimationChannel &channel, int key) {
+    return channel.times[key] / 65535.0f;
+}
+
+static VROVector3f decodeVector(const VROAnimationChannel &channel, int key) {
+    const uint16_t *v = &channel.values[key * 3];
+    return { dequantize(v[0], channel.min.x, channel.extent.x),
+             dequantize(v[1], channel.min.y, channel.extent.y),
+             dequantize(v[2], channel.min.z, channel.extent.z) };
+}
+
+static VROQuaternion decodeRotation(const VROAnimationChannel &channel, int key) {
+    const uint16_t *v = &channel.values[key * 3];
+    int largest = channel.largest[key];
+
+    float c[4];
+    float sumSquares = 0;
+    for (int i = 0, j = 0; i < 4; i++) {
+        if (i == largest) {
+            continue;
+        }
+        c[i] = dequantize(v[j++], -kSmallestThreeRange, 2 * kSmallestThreeRange);
+        sumSquares += c[i] * c[i];
+    }
+    c[largest] = sqrtf(std::max(0.0f, 1.0f - sumSquares));
+    return VROQuaternion(c[0], c[1], c[2], c[3]);
+}
+
+static void encodeRotation(VROQuaternion q, VROAnimationChannel *channel) {
+    q.normalize();
+    float c[4] = { q.X, q.Y, q.Z, q.W };
+
+    int largest = 0;
+    for (int i = 1; i < 4; i++) {
+        if (fabs(c[i]) > fabs(c[largest])) {
+            largest = i;
+        }
+    }
+
+    // q and -q are the same rotation, so flip the quaternion to make the omitted
+    // component positive
+    float sign = c[largest] < 0 ? -1 : 1;
+    for (int i = 0; i < 4; i++) {
+        if (i != largest) {
+            channel->values.push_back(quantize(c[i] * sign, -kSmallestThreeRange, 2 * kSmallestThreeRange));
+        }
+    }
+    channel->largest.push_back((uint8_t) largest);
+}
+
+#pragma mark - Key Reduction
+
+/*
+ Return the indices of the keys to keep out of count keys. The fits function returns
+ true if interpolating between keys a and b reproduces key i within tolerance.
+ */
+static std::vector<int> reduceKeys(int count, std::function<bool(int, int, int)> fits) {
+    std::vector<int> kept = { 0 };
+
+    // Constant channels need only a single key
+    bool constant = true;
+    for (int i = 1; i < count && constant; i++) {
+        constant = fits(0, 0, i);
+    }
+    if (constant) {
+        return kept;
+    }
+
+    int anchor = 0;
+    for (int candidate = 2; candidate < count; candidate++) {
+        bool removable = candidate - anchor <= kMaxReducedKeySpan;
+        for (int i = anchor + 1; i < candidate && removable; i++) {
+            removable = fits(anchor, candidate, i);
+        }
+
+        if (!removable) {
+            anchor = candidate - 1;
+            kept.push_back(anchor);
+        }
+    }
+    kept.push_back(count - 1);
+    return kept;
+}
+
+static float interpolationFactor(const std::vector<float> &times, int a, int b, int i) {
+    float span = times[b] - times[a];
+    return span > 0 ? (times[i] - times[a]) / span : 0;
+}
+
+static VROAnimationChannel buildVectorChannel(const std::vector<float> &times, const std::vector<VROVector3f> &values,
+                                              float tolerance) {
+    std::vector<int> keys = reduceKeys((int) values.size(), [&times, &values, tolerance] (int a, int b, int i) {
+        VROVector3f interpolated = values[a].interpolate(values[b], interpolationFactor(times, a, b, i));
+        return interpolated.distanceSquared(values[i]) <= tolerance * tolerance;
+    });
+
+    VROVector3f min = values[keys[0]];
+    VROVector3f max = values[keys[0]];
+    for (int key : keys) {
+        const VROVector3f &v = values[key];
+        min = { std::min(min.x, v.x), std::min(min.y, v.y), std::min(min.z, v.z) };
+        max = { std::max(max.x, v.x), std::max(max.y, v.y), std::max(max.z, v.z) };
+    }
+
+    VROAnimationChannel channel;
+    channel.min = min;
+    channel.extent = max - min;
+    for (int key : keys) {
+        const VROVector3f &v = values[key];
+        channel.times.push_back(quantize(times[key], 0, 1));
+        channel.values.push_back(quantize(v.x, channel.min.x, channel.extent.x));
+        channel.values.push_back(quantize(v.y, channel.min.y, channel.extent.y));
+        channel.values.push_back(quantize(v.z, channel.min.z, channel.extent.z));
+    }
+    return channel;
+}
+
+static VROAnimationChannel buildRotationChannel(const std::vector<float> &times, std::vector<VROQuaternion> values) {
+    // Keep consecutive keys in the same hemisphere so that no key is fit across
+    // the long way around
+    for (size_t i = 1; i < values.size(); i++) {
+        if (values[i - 1].dotProduct(values[i]) < 0) {
+            values[i] *= -1.0f;
+        }
+    }
+
+    std::vector<int> keys = reduceKeys((int) values.size(), [&times, &values] (int a, int b, int i) {
+        VROQuaternion interpolated = VROQuaternion::slerp(values[a], values[b], interpolationFactor(times, a, b, i));
+        interpolated.normalize();
+        float dot = std::min(1.0f, (float) fabs(interpolated.dotProduct(values[i])));
+        return 2 * acosf(dot) <= kRotationTolerance;
+    });
+
+    VROAnimationChannel channel;
+    for (int key : keys) {
+        channel.times.push_back(quantize(times[key], 0, 1));
+        encodeRotation(values[key], &channel);
+    }
+    return channel;
+}
+
+static VROMatrix4f composeTransform(const VROVector3f &translation, const VROQuaternion &rotation,
+                                    const VROVector3f &scale) {
+    VROMatrix4f transform;
+    transform.scale(scale.x, scale.y, scale.z);
+    transform = rotation.getMatrix() * transform;
+    transform.translate(translation);
+    return transform;
+}
+
+static VROAnimationTrack buildTrack(int target, const std::vector<float> &times,
+                                    const std::vector<VROMatrix4f> &transforms) {
+    VROAnimationTrack track;
+    track.target = target;
+    track.compressed = true;
+
+    std::vector<VROVector3f> translations;
+    std::vector<VROQuaternion> rotations;
+    std::vector<VROVector3f> scales;
+
+    for (const VROMatrix4f &transform : transforms) {
+        VROVector3f scale = transform.extractScale();
+        VROQuaternion rotation = transform.extractRotation(scale);
+        rotation.normalize();
+        VROVector3f translation = transform.extractTranslation();
+
+        // Verify the transform is reproduced by its decomposition
+        VROMatrix4f recomposed = composeTransform(translation, rotation, scale);
+        float largest = 1.0;
+        float error = 0;
+        for (int i = 0; i < 16; i++) {
+            largest = std::max(largest, (float) fabs(transform[i]));
+            error = std::max(error, (float) fabs(transform[i] - recomposed[i]));
+        }
+        if (error > kDecompositionTolerance * largest) {
+            track.compressed = false;
+            break;
+        }
+
+        translations.push_back(translation);
+        rotations.push_back(rotation);
+        scales.push_back(scale);
+    }
+
+    if (track.compressed) {
+        track.translation = buildVectorChannel(times, translations, kTranslationTolerance);
+        track.rotation = buildRotationChannel(times, rotations);
+        track.scale = buildVectorChannel(times, scales, kScaleTolerance);
+    } else {
+        track.matrixTimes = times;
+        track.matrices = transforms;
+    }
+    return track;
+}
+
+std::shared_ptr<VROAnimationClip> VROAnimationClip::createSkeletalClip(const std::vector<std::unique_ptr<VROSkeletalAnimationFrame>> &frames) {
+    std::map<int, std::vector<float>> boneKeyTimes;
+    std::map<int, std::vector<VROMatrix4f>> boneKeyValues;
+
+    for (const std::unique_ptr<VROSkeletalAnimationFrame> &frame : frames) {
+        passert (frame->boneIndices.size() == frame->boneTransforms.size());
+
+        for (int i = 0; i < frame->boneIndices.size(); i++) {
+            int boneIndex = frame->boneIndices[i];
+            boneKeyTimes[boneIndex].push_back(frame->time);
+            boneKeyValues[boneIndex].push_back(frame->boneTransforms[i]);
+        }
+    }
+
+    std::vector<VROAnimationTrack> tracks;
+    for (auto &kv : boneKeyTimes) {
+        tracks.push_back(buildTrack(kv.first, kv.second, boneKeyValues[kv.first]));
+    }
+    return std::make_shared<VROAnimationClip>(std::move(tracks));
+}
+
+#pragma mark - Sampling
+
+/*
+ Find the key at or before t, resuming from the given cursor. Seeking backward
+ (e.g. when the animation loops) falls back to a binary search.
+ */
+static int findKey(const VROAnimationChannel &channel, float t, int *cursor) {
+    int count = (int) channel.times.size();
+    uint16_t time = quantize(t, 0, 1);
+
+    int key = cursor ? std::min(*cursor, count - 1) : 0;
+    if (!cursor || channel.times[key] > time) {
+        key = (int) (std::upper_bound(channel.times.begin(), channel.times.end(), time) - channel.times.begin()) - 1;
+        key = std::max(key, 0);
+    }
+    while (key + 1 < count && channel.times[key + 1] <= time) {
+        key++;
+    }
+
+    if (cursor) {
+        *cursor = key;
+    }
+    return key;
+}
+
+static float keyFactor(const VROAnimationChannel &channel, int key, float t) {
+    if (key + 1 >= channel.times.size()) {
+        return 0;
+    }
+    float start = getKeyTime(channel, key);
+    float span = getKeyTime(channel, key + 1) - start;
+    return span > 0 ? std::max(0.0f, std::min(1.0f, (t - start) / span)) : 0;
+}
+
+static VROVector3f sampleVector(const VROAnimationChannel &channel, float t, int *cursor) {
+    int key = findKey(channel, t, cursor);
+    VROVector3f value = decodeVector(channel, key);
+    if (key + 1 >= channel.times.size()) {
+        return value;
+    }
+    return value.interpolate(decodeVector(channel, key + 1), keyFactor(channel, key, t));
+}
+
+static VROQuaternion sampleRotation(const VROAnimationChannel &channel, float t, int *cursor) {
+    int key = findKey(channel, t, cursor);
+    VROQuaternion value = decodeRotation(channel, key);
+    if (key + 1 < channel.times.size()) {
+        value = VROQuaternion::slerp(value, decodeRotation(channel, key + 1), keyFactor(channel, key, t));
+    }
+    value.normalize();
+    return value;
+}
+
+VROMatrix4f VROAnimationClip::sample(int trackIndex, float t, VROAnimationClipCursor *cursor) const {
+    const VROAnimationTrack &track = _tracks[trackIndex];
+    if (!track.compressed) {
+        return VROMathInterpolateKeyFrameMatrix4f(t, track.matrixTimes, track.matrices);
+    }
+
+    VROVector3f translation = sampleVector(track.translation, t, cursor ? &cursor->translation : nullptr);
+    VROQuaternion rotation = sampleRotation(track.rotation, t, cursor ? &cursor->rotation : nullptr);
+    VROVector3f scale = sampleVector(track.scale, t, cursor ? &cursor->scale : nullptr);
+    return composeTransform(translation, rotation, scale);
+}
+
+size_t VROAnimationClip::getMemorySize() const {
+    size_t size = 0;
+    for (const VROAnimationTrack &track : _tracks) {
+        for (const VROAnimationChannel *channel : { &track.translation, &track.rotation, &track.scale }) {
+            size += channel->times.size() * sizeof(uint16_t) + channel->values.size() * sizeof(uint16_t) +
+                    channel->largest.size() * sizeof(uint8_t);
+        }
+        size += track.matrixTimes.size() * sizeof(float) + track.matrices.size() * sizeof(VROMatrix4f);
+    }
+    return size;
+}
@@ -0,0 +1,138 @@
+//
+//  VROAnimationClip.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROAnimationClip_h
+#define VROAnimationClip_h
+
+#include <memory>
+#include <vector>
+#include <stdint.h>
+#include "VROMatrix4f.h"
+#include "VROVector3f.h"
+#include "VROQuaternion.h"
+
+struct VROSkeletalAnimationFrame;
+
+/*
+ A single animated property of a track (translation, rotation, or scale), stored as
+ a reduced set of quantized keys. Each channel has its own key times, so properties
+ that rarely change cost a single key.
+ */
+struct VROAnimationChannel {
+
+    /*
+     Key times, quantized to 16 bits over the normalized [0, 1] duration of the clip.
+     */
+    std::vector<uint16_t> times;
+
+    /*
+     Three 16-bit components per key. Vectors are quantized over [min, min + extent].
+     Rotations store the smallest three components of the (unit) quaternion, and
+     largest holds the index of the omitted component, which is reconstructed.
+     */
+    std::vector<uint16_t> values;
+    std::vector<uint8_t> largest;
+    VROVector3f min;
+    VROVector3f extent;
+
+};
+
+/*
+ The keys that animate one target (for skeletal clips, one bone). Transforms that
+ decompose into translation, rotation and scale are stored in compressed channels;
+ others (e.g. with shear) keep their full matrices.
+ */
+struct VROAnimationTrack {
+
+    int target;
+    bool compressed;
+
+    VROAnimationChannel translation;
+    VROAnimationChannel rotation;
+    VROAnimationChannel scale;
+
+    std::vector<float> matrixTimes;
+    std::vector<VROMatrix4f> matrices;
+
+};
+
+/*
+ The last key sampled from each channel of a track. Animations normally advance
+ forward in time, so sampling resumes from the cursor instead of searching the
+ keys, making each sample O(1).
+ */
+struct VROAnimationClipCursor {
+    int translation;
+    int rotation;
+    int scale;
+
+    VROAnimationClipCursor() : translation(0), rotation(0), scale(0) {}
+};
+
+/*
+ Compact, immutable storage for the keyframes of an animation. Keys are curve-fit
+ at construction, removing those that linear interpolation of their neighbors
+ reproduces within tolerance, and then quantized. Clips are shared by all copies
+ of an animation.
+ */
+class VROAnimationClip {
+
+public:
+
+    /*
+     Compress the bone transforms of the given skeletal animation frames into a clip
+     with one track per animated bone.
+     */
+    static std::shared_ptr<VROAnimationClip> createSkeletalClip(const std::vector<std::unique_ptr<VROSkeletalAnimationFrame>> &frames);
+
+    VROAnimationClip(std::vector<VROAnimationTrack> tracks) :
+        _tracks(std::move(tracks)) {}
+    virtual ~VROAnimationClip() {}
+
+    int getNumTracks() const {
+        return (int) _tracks.size();
+    }
+    int getTrackTarget(int track) const {
+        return _tracks[track].target;
+    }
+
+    /*
+     Sample the given track at normalized time t in [0, 1]. If a cursor is provided,
+     it is used to find the keys surrounding t and updated.
+     */
+    VROMatrix4f sample(int track, float t, VROAnimationClipCursor *cursor = nullptr) const;
+
+    /*
+     The number of bytes used by the keys of this clip.
+     */
+    size_t getMemorySize() const;
+
+private:
+
+    std::vector<VROAnimationTrack> _tracks;
+
+};
+
+#endif /* VROAnimationClip_h */
@@ -0,0 +1,76 @@
+//
+//  VROAnimationClipTrack.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROAnimationClipTrack_h
+#define VROAnimationClipTrack_h
+
+#include "VROAnimation.h"
+#include "VROAnimatable.h"
+#include "VROAnimationClip.h"
+
+/*
+ Animates a transform by sampling one track of a VROAnimationClip. Each animation
+ keeps its own cursor into the track, so that any number of animations can share
+ the same clip.
+ */
+class VROAnimationClipTrack : public VROAnimation {
+
+public:
+
+    VROAnimationClipTrack(std::function<void(VROAnimatable *const, VROMatrix4f)> method,
+                          std::shared_ptr<VROAnimationClip> clip,
+                          int track) :
+        VROAnimation(),
+        _clip(clip),
+        _track(track),
+        _method(method)
+    {}
+
+    void processAnimationFrame(float t) {
+        VROMatrix4f value = _clip->sample(_track, t, &_cursor);
+
+        std::shared_ptr<VROAnimatable> animatable = _animatable.lock();
+        if (animatable) {
+            _method(animatable.get(), value);
+        }
+    }
+
+    void finish() {
+        std::shared_ptr<VROAnimatable> animatable = _animatable.lock();
+        if (animatable) {
+            _method(animatable.get(), _clip->sample(_track, 1.0, &_cursor));
+        }
+    }
+
+private:
+
+    std::shared_ptr<VROAnimationClip> _clip;
+    int _track;
+    VROAnimationClipCursor _cursor;
+    std::function<void(VROAnimatable *const, VROMatrix4f)> _method;
+
+};
+
+#endif /* VROAnimationClipTrack_h */
@@ -40,7 +40,8 @@ public:
         VROAnimation(),
         _keyTimes({ 0, 1 }),
         _keyValues({ start, end }),
-        _method(method)
+        _method(method),
+        _keyCursor(0)
     {}
     
     VROAnimationFloat(std::function<void(VROAnimatable *const, float)> method,
@@ -50,7 +51,8 @@ public:
         VROAnimation(finishCallback),
         _keyTimes({ 0, 1 }),
         _keyValues({ start, end }),
-        _method(method)
+        _method(method),
+        _keyCursor(0)
     {}
     
     VROAnimationFloat(std::function<void(VROAnimatable *const, float)> method,
@@ -58,7 +60,8 @@ public:
         VROAnimation(),
         _keyTimes(keyTimes),
         _keyValues(keyValues),
-        _method(method)
+        _method(method),
+        _keyCursor(0)
     {}
     
     VROAnimationFloat(std::function<void(VROAnimatable *const, float)> method,
@@ -68,11 +71,12 @@ public:
         VROAnimation(finishCallback),
         _keyTimes(keyTimes),
         _keyValues(keyValues),
-        _method(method)
+        _method(method),
+        _keyCursor(0)
     {}
     
     void processAnimationFrame(float t) {
-        float value = VROMathInterpolateKeyFrame(t, _keyTimes, _keyValues);
+        float value = VROMathInterpolateKeyFrame(t, _keyTimes, _keyValues, &_keyCursor);
         
         std::shared_ptr<VROAnimatable> animatable = _animatable.lock();
         if (animatable) {
@@ -92,6 +96,9 @@ private:
     std::vector<float> _keyTimes;
     std::vector<float> _keyValues;
     std::function<void(VROAnimatable *const, float)>  _method;
+
+    // The last key found when sampling, so sampling resumes from there
+    int _keyCursor;
     
 };
 
@@ -21,7 +21,8 @@ public:
                               std::vector<float> keyTimes) :
     VROAnimation(),
     _keyTimes(keyTimes),
-    _method(method)
+    _method(method),
+    _keyCursor(0)
     {}
     
     VROAnimationKeyframeIndex(std::function<void(VROAnimatable *const, int)> method,
@@ -29,11 +30,12 @@ public:
                               std::function<void(VROAnimatable *const)> finishCallback) :
     VROAnimation(finishCallback),
     _keyTimes(keyTimes),
-    _method(method)
+    _method(method),
+    _keyCursor(0)
     {}
     
     void processAnimationFrame(float t) {
-        int frame = VROMathInterpolateKeyFrameIndex(t, _keyTimes);
+        int frame = VROMathInterpolateKeyFrameIndex(t, _keyTimes, &_keyCursor);
         
         std::shared_ptr<VROAnimatable> animatable = _animatable.lock();
         if (animatable) {
@@ -52,6 +54,9 @@ private:
     
     std::vector<float> _keyTimes;
     std::function<void(VROAnimatable *const, int)>  _method;
+
+    // The last key found when sampling, so sampling resumes from there
+    int _keyCursor;
     
 };
 
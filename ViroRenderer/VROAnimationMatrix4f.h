@@ -42,7 +42,8 @@ public:
         VROAnimation(),
         _keyTimes({ 0, 1 }),
         _keyValues({ start, end }),
-        _method(method)
+        _method(method),
+        _keyCursor(0)
     {}
     
     VROAnimationMatrix4f(std::function<void(VROAnimatable *const, VROMatrix4f)> method,
@@ -52,7 +53,8 @@ public:
         VROAnimation(finishCallback),
         _keyTimes({ 0, 1 }),
         _keyValues({ start, end }),
-        _method(method)
+        _method(method),
+        _keyCursor(0)
     {}
     
     VROAnimationMatrix4f(std::function<void(VROAnimatable *const, VROMatrix4f)> method,
@@ -61,7 +63,8 @@ public:
         VROAnimation(),
         _keyTimes(keyTimes),
         _keyValues(keyValues),
-        _method(method)
+        _method(method),
+        _keyCursor(0)
     {}
     
     VROAnimationMatrix4f(std::function<void(VROAnimatable *const, VROMatrix4f)> method,
@@ -71,11 +74,12 @@ public:
         VROAnimation(finishCallback),
         _keyTimes(keyTimes),
         _keyValues(keyValues),
-        _method(method)
+        _method(method),
+        _keyCursor(0)
     {}
     
     void processAnimationFrame(float t) {
-        VROMatrix4f value = VROMathInterpolateKeyFrameMatrix4f(t, _keyTimes, _keyValues);
+        VROMatrix4f value = VROMathInterpolateKeyFrameMatrix4f(t, _keyTimes, _keyValues, &_keyCursor);
         
         std::shared_ptr<VROAnimatable> animatable = _animatable.lock();
         if (animatable) {
@@ -95,6 +99,9 @@ private:
     std::vector<float> _keyTimes;
     std::vector<VROMatrix4f> _keyValues;
     std::function<void(VROAnimatable *const, VROMatrix4f)> _method;
+
+    // The last key found when sampling, so sampling resumes from there
+    int _keyCursor;
     
 };
 
@@ -43,7 +43,8 @@ public:
         VROAnimation(),
         _keyTimes({ 0, 1 }),
         _keyValues({ start, end }),
-        _method(method)
+        _method(method),
+        _keyCursor(0)
     {}
     
     VROAnimationVector3f(std::function<void(VROAnimatable *const, VROVector3f)> method,
@@ -53,7 +54,8 @@ public:
         VROAnimation(finishCallback),
         _keyTimes({ 0, 1 }),
         _keyValues({ start, end }),
-        _method(method)
+        _method(method),
+        _keyCursor(0)
     {}
     
     VROAnimationVector3f(std::function<void(VROAnimatable *const, VROVector3f)> method,
@@ -62,7 +64,8 @@ public:
         VROAnimation(),
         _keyTimes(keyTimes),
         _keyValues(keyValues),
-        _method(method)
+        _method(method),
+        _keyCursor(0)
     {}
     
     VROAnimationVector3f(std::function<void(VROAnimatable *const, VROVector3f)> method,
@@ -72,11 +75,12 @@ public:
         VROAnimation(finishCallback),
         _keyTimes(keyTimes),
         _keyValues(keyValues),
-        _method(method)
+        _method(method),
+        _keyCursor(0)
     {}
     
     void processAnimationFrame(float t) {
-        VROVector3f value = VROMathInterpolateKeyFrameVector3f(t, _keyTimes, _keyValues);
+        VROVector3f value = VROMathInterpolateKeyFrameVector3f(t, _keyTimes, _keyValues, &_keyCursor);
         
         std::shared_ptr<VROAnimatable> animatable = _animatable.lock();
         if (animatable) {
@@ -96,6 +100,9 @@ private:
     std::vector<float> _keyTimes;
     std::vector<VROVector3f> _keyValues;
     std::function<void(VROAnimatable *const, VROVector3f)> _method;
+
+    // The last key found when sampling, so sampling resumes from there
+    int _keyCursor;
     
 };
 
@@ -0,0 +1,439 @@
+//
+//  VROAssetCache.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROAssetCache.h"
+#include "VROPlatformUtil.h"
+#include "VROStringUtil.h"
+#include "VROLog.h"
+#include <future>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <dirent.h>
+#include <utime.h>
+#include <sys/stat.h>
+
+// The most downloads performed at once
+static const int kMaxConcurrentDownloads = 4;
+
+// Blobs are evicted, least recently used first, once the cache exceeds this size
+static const int64_t kMaxCacheBytes = 512ll * 1024 * 1024;
+
+// Blobs used this recently are never evicted, as loaders may still be reading them
+static const int64_t kEvictionGraceSeconds = 5 * 60;
+
+/*
+ The metadata stored for each URL. The partial ETag identifies the version of
+ an interrupted download whose body so far is stored in the URL's .part file.
+ */
+struct VROAssetMetadata {
+    std::string blob;
+    std::string etag;
+    std::string lastModified;
+    std::string partialETag;
+    int64_t expires = 0;
+};
+
+static std::string toHex(uint64_t value) {
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long) value);
+    return hex;
+}
+
+static int64_t getFileSize(const std::string &path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 ? (int64_t) info.st_size : -1;
+}
+
+/*
+ Blobs keep the extension of their URL, as loaders dispatch on it.
+ */
+static std::string getExtension(const std::string &url) {
+    std::string path = url.substr(0, url.find_first_of("?#"));
+    size_t slash = path.find_last_of('/');
+    size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash) || path.size() - dot > 8) {
+        return "";
+    }
+    return path.substr(dot);
+}
+
+static bool readMetadata(const std::string &path, VROAssetMetadata *outMetadata) {
+    FILE *file = fopen(path.c_str(), "r");
+    if (!file) {
+        return false;
+    }
+
+    char line[4096];
+    while (fgets(line, sizeof(line), file)) {
+        std::string entry(line);
+        if (!entry.empty() && entry.back() == '\n') {
+            entry.pop_back();
+        }
+        size_t space = entry.find(' ');
+        if (space == std::string::npos) {
+            continue;
+        }
+
+        std::string key = entry.substr(0, space);
+        std::string value = entry.substr(space + 1);
+        if (key == "blob") {
+            outMetadata->blob = value;
+        } else if (key == "etag") {
+            outMetadata->etag = value;
+        } else if (key == "modified") {
+            outMetadata->lastModified = value;
+        } else if (key == "partial") {
+            outMetadata->partialETag = value;
+        } else if (key == "expires") {
+            outMetadata->expires = strtoll(value.c_str(), nullptr, 10);
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+static void writeMetadata(const std::string &path, const VROAssetMetadata &metadata) {
+    VROPlatformWriteCacheFile(path, [&metadata](FILE *file) {
+        return fprintf(file, "blob %s\netag %s\nmodified %s\npartial %s\nexpires %lld\n",
+                       metadata.blob.c_str(), metadata.etag.c_str(), metadata.lastModified.c_str(),
+                       metadata.partialETag.c_str(), (long long) metadata.expires) >= 0;
+    });
+}
+
+/*
+ Read the freshness lifetime of a response from its Cache-Control header. A
+ response without max-age is revalidated on every use.
+ */
+static void parseCacheControl(const std::map<std::string, std::string> &headers, bool *outNoStore, int64_t *outMaxAge) {
+    *outNoStore = false;
+    *outMaxAge = 0;
+
+    auto cacheControl = headers.find("cache-control");
+    if (cacheControl == headers.end()) {
+        return;
+    }
+    std::string value = cacheControl->second;
+    VROStringUtil::toLowerCase(value);
+
+    for (std::string directive : VROStringUtil::split(value, ",", false)) {
+        directive = VROStringUtil::trim(directive);
+        if (directive == "no-store") {
+            *outNoStore = true;
+        } else if (directive == "no-cache") {
+            *outMaxAge = 0;
+        } else if (VROStringUtil::startsWith(directive, "max-age=")) {
+            *outMaxAge = std::max(0ll, strtoll(directive.c_str() + 8, nullptr, 10));
+        }
+    }
+}
+
+static std::string getHeader(const std::map<std::string, std::string> &headers, const std::string &name) {
+    auto it = headers.find(name);
+    return it == headers.end() ? "" : it->second;
+}
+
+VROAssetCache::VROAssetCache(std::string directory) :
+    _directory(directory),
+    _directoryCreated(false),
+    _activeDownloads(0) {
+
+}
+
+VROAssetCache::~VROAssetCache() {
+
+}
+
+#pragma mark - Requests
+
+std::string VROAssetCache::fetch(std::string url, bool *success) {
+    std::shared_ptr<std::promise<std::pair<std::string, bool>>> promise = std::make_shared<std::promise<std::pair<std::string, bool>>>();
+    std::future<std::pair<std::string, bool>> result = promise->get_future();
+
+    // If the URL is already downloading on another thread, wait for it there;
+    // otherwise download it on this thread
+    if (addRequest(url, [promise](std::string path, bool downloaded) {
+        promise->set_value({ path, downloaded });
+    })) {
+        bool downloaded;
+        std::string path = download(url, &downloaded);
+        completeRequest(url, path, downloaded);
+    }
+
+    std::pair<std::string, bool> fetched = result.get();
+    *success = fetched.second;
+    return fetched.first;
+}
+
+void VROAssetCache::fetchAsync(std::string url, std::function<void(std::string)> onSuccess,
+                               std::function<void()> onFailure) {
+    bool first = addRequest(url, [onSuccess, onFailure](std::string path, bool success) {
+        VROPlatformDispatchAsyncRenderer([onSuccess, onFailure, path, success] {
+            if (success) {
+                onSuccess(path);
+            } else {
+                onFailure();
+            }
+        });
+    });
+
+    if (first) {
+        VROPlatformDispatchAsyncBackground([this, url] {
+            bool success;
+            std::string path = download(url, &success);
+            completeRequest(url, path, success);
+        });
+    }
+}
+
+bool VROAssetCache::addRequest(std::string url, std::function<void(std::string, bool)> callback) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _requests.find(url);
+    if (it != _requests.end()) {
+        it->second->callbacks.push_back(callback);
+        return false;
+    }
+
+    std::shared_ptr<VROAssetRequest> request = std::make_shared<VROAssetRequest>();
+    request->callbacks.push_back(callback);
+    _requests[url] = request;
+    return true;
+}
+
+void VROAssetCache::completeRequest(std::string url, std::string path, bool success) {
+    std::shared_ptr<VROAssetRequest> request;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _requests.find(url);
+        if (it == _requests.end()) {
+            return;
+        }
+        request = it->second;
+        _requests.erase(it);
+    }
+
+    for (std::function<void(std::string, bool)> &callback : request->callbacks) {
+        callback(path, success);
+    }
+}
+
+#pragma mark - Downloading
+
+std::string VROAssetCache::download(std::string url, bool *success) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_directoryCreated) {
+            mkdir(_directory.c_str(), 0700);
+            _directoryCreated = true;
+        }
+    }
+
+    std::string key = toHex(VROPlatformHashCacheKey(url.data(), url.size()));
+    std::string metadataPath = _directory + "/" + key + ".meta";
+    std::string partPath = _directory + "/" + key + ".part";
+    int64_t now = (int64_t) time(nullptr);
+
+    VROAssetMetadata metadata;
+    bool cached = readMetadata(metadataPath, &metadata) && !metadata.blob.empty();
+    std::string blobPath = cached ? _directory + "/" + metadata.blob : "";
+    if (cached && getFileSize(blobPath) < 0) {
+        cached = false;
+    }
+
+    // Fresh entries are used without a request
+    if (cached && now < metadata.expires) {
+        utime(blobPath.c_str(), nullptr);
+        *success = true;
+        return blobPath;
+    }
+
+    std::map<std::string, std::string> requestHeaders;
+    if (cached) {
+        if (!metadata.etag.empty()) {
+            requestHeaders["If-None-Match"] = metadata.etag;
+        }
+        if (!metadata.lastModified.empty()) {
+            requestHeaders["If-Modified-Since"] = metadata.lastModified;
+        }
+    }
+    else if (!metadata.partialETag.empty() && getFileSize(partPath) > 0) {
+        // Resume the interrupted download, unless the asset has since changed
+        requestHeaders["Range"] = "bytes=" + VROStringUtil::toString64(getFileSize(partPath)) + "-";
+        requestHeaders["If-Range"] = metadata.partialETag;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _slotCondition.wait(lock, [this] { return _activeDownloads < kMaxConcurrentDownloads; });
+        _activeDownloads++;
+    }
+    std::map<std::string, std::string> responseHeaders;
+    int status = VROPlatformDownloadURLWithHeaders(url, partPath, requestHeaders, &responseHeaders);
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _activeDownloads--;
+    }
+    _slotCondition.notify_one();
+
+    bool noStore;
+    int64_t maxAge;
+    parseCacheControl(responseHeaders, &noStore, &maxAge);
+
+    if (status == 304 && cached) {
+        metadata.expires = noStore ? 0 : now + maxAge;
+        writeMetadata(metadataPath, metadata);
+        utime(blobPath.c_str(), nullptr);
+        *success = true;
+        return blobPath;
+    }
+
+    if (status == 200 || status == 206) {
+        size_t length;
+        const void *data = VROPlatformMapFile(partPath, &length);
+        if (data == nullptr && getFileSize(partPath) != 0) {
+            remove(partPath.c_str());
+            *success = false;
+            return "";
+        }
+        metadata.blob = toHex(VROPlatformHashCacheKey(data, data ? length : 0)) + getExtension(url);
+        if (data) {
+            VROPlatformUnmapFile(data, length);
+        }
+
+        // Identical content is stored once
+        blobPath = _directory + "/" + metadata.blob;
+        if (getFileSize(blobPath) >= 0) {
+            remove(partPath.c_str());
+            utime(blobPath.c_str(), nullptr);
+        } else {
+            rename(partPath.c_str(), blobPath.c_str());
+        }
+
+        // No-store responses are never reused: without validators or a
+        // lifetime, the next fetch downloads the asset again
+        metadata.etag = noStore ? "" : getHeader(responseHeaders, "etag");
+        metadata.lastModified = noStore ? "" : getHeader(responseHeaders, "last-modified");
+        metadata.partialETag = "";
+        metadata.expires = noStore ? 0 : now + maxAge;
+        writeMetadata(metadataPath, metadata);
+        evict();
+
+        *success = true;
+        return blobPath;
+    }
+
+    // Keep the body received so far if the server can resume it
+    std::string etag = getHeader(responseHeaders, "etag");
+    if (status == 0 && !etag.empty() && getHeader(responseHeaders, "accept-ranges") == "bytes" &&
+        getFileSize(partPath) > 0) {
+        metadata.partialETag = etag;
+        writeMetadata(metadataPath, metadata);
+    }
+    else {
+        remove(partPath.c_str());
+    }
+
+    // Serve stale content rather than failing, e.g. when offline
+    if (cached) {
+        pwarn("Failed to revalidate [%s] (status %d), using cached copy", url.c_str(), status);
+        *success = true;
+        return blobPath;
+    }
+    pwarn("Failed to download [%s] (status %d)", url.c_str(), status);
+    *success = false;
+    return "";
+}
+
+#pragma mark - Derived Assets
+
+std::string VROAssetCache::getDerivedPath(std::string blobPath, std::string suffix, bool *outExists) {
+    *outExists = false;
+
+    std::string prefix = _directory + "/";
+    if (!VROStringUtil::startsWith(blobPath, prefix) ||
+        blobPath.find('/', prefix.size()) != std::string::npos ||
+        VROStringUtil::endsWith(blobPath, ".meta") || VROStringUtil::endsWith(blobPath, ".part")) {
+        return "";
+    }
+
+    std::string derivedPath = blobPath + suffix;
+    if (getFileSize(derivedPath) > 0) {
+        utime(derivedPath.c_str(), nullptr);
+        *outExists = true;
+    }
+    return derivedPath;
+}
+
+bool VROAssetCache::storeDerived(std::string derivedPath, const void *data, size_t length) {
+    if (!VROPlatformWriteCacheFile(derivedPath, data, length)) {
+        return false;
+    }
+
+    evict();
+    return true;
+}
+
+void VROAssetCache::evict() {
+    DIR *dir = opendir(_directory.c_str());
+    if (!dir) {
+        return;
+    }
+
+    std::vector<std::pair<int64_t, std::pair<std::string, int64_t>>> blobs;
+    int64_t totalBytes = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        std::string name = entry->d_name;
+        if (name == "." || name == ".." || VROStringUtil::endsWith(name, ".meta") ||
+            VROStringUtil::endsWith(name, ".part") || VROStringUtil::endsWith(name, ".tmp")) {
+            continue;
+        }
+
+        std::string path = _directory + "/" + name;
+        struct stat info;
+        if (stat(path.c_str(), &info) == 0) {
+            blobs.push_back({ (int64_t) info.st_mtime, { path, (int64_t) info.st_size } });
+            totalBytes += info.st_size;
+        }
+    }
+    closedir(dir);
+
+    if (totalBytes <= kMaxCacheBytes) {
+        return;
+    }
+
+    // Hits refresh the modification time of blobs, so the oldest are least recently used
+    std::sort(blobs.begin(), blobs.end());
+    int64_t now = (int64_t) time(nullptr);
+    for (auto &blob : blobs) {
+        if (totalBytes <= kMaxCacheBytes || blob.first > now - kEvictionGraceSeconds) {
+            break;
+        }
+        if (remove(blob.second.first.c_str()) == 0) {
+            totalBytes -= blob.second.second;
+        }
+    }
+}
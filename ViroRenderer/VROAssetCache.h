@@ -0,0 +1,127 @@
+//
+//  VROAssetCache.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROAssetCache_h
+#define VROAssetCache_h
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <stdint.h>
+
+/*
+ Persistent cache of assets downloaded over HTTP. Each URL's metadata (its
+ validators and expiry) is stored under a hash of the URL, and points to a
+ blob named by a hash of the downloaded content, so identical assets served
+ from different URLs share one file.
+
+ Fresh entries (per Cache-Control max-age) are returned without a request;
+ stale entries are revalidated with If-None-Match / If-Modified-Since, so an
+ unchanged asset costs a 304. Responses marked no-store are not reused.
+ Concurrent fetches of the same URL are coalesced into one download, at most
+ kMaxConcurrentDownloads downloads run at once, and interrupted downloads of
+ servers that accept byte ranges resume where they left off.
+
+ Paths returned by the cache are owned by the cache and must not be deleted.
+ The least recently used blobs are evicted once the cache exceeds its size
+ limit.
+ */
+class VROAssetCache {
+public:
+
+    VROAssetCache(std::string directory);
+    virtual ~VROAssetCache();
+
+    /*
+     Fetch the given URL in a blocking fashion, returning the path of the cached
+     file. Must be invoked on a background thread.
+     */
+    std::string fetch(std::string url, bool *success);
+
+    /*
+     Fetch the given URL on a background thread, and invoke the given callbacks
+     on the rendering thread. The success callback receives the path of the
+     cached file.
+     */
+    void fetchAsync(std::string url, std::function<void(std::string)> onSuccess,
+                    std::function<void()> onFailure);
+
+    /*
+     Derived assets are files computed from a cached blob, such as images
+     compressed for the GPU. They are named by their blob (itself named by its
+     content) and a suffix identifying the derivation, and are evicted like
+     blobs. Returns the path of the given blob's derived asset, or an empty
+     string if the path is not a blob of this cache. If the derived asset
+     exists, outExists is set and the asset is marked as recently used.
+     */
+    std::string getDerivedPath(std::string blobPath, std::string suffix, bool *outExists);
+
+    /*
+     Write the given derived asset (at a path returned by getDerivedPath), in
+     full or not at all. Must be invoked on a background thread.
+     */
+    bool storeDerived(std::string derivedPath, const void *data, size_t length);
+
+private:
+
+    /*
+     A download in flight, and the callbacks waiting on it.
+     */
+    struct VROAssetRequest {
+        std::vector<std::function<void(std::string, bool)>> callbacks;
+    };
+
+    std::string _directory;
+    bool _directoryCreated;
+
+    std::mutex _mutex;
+    std::map<std::string, std::shared_ptr<VROAssetRequest>> _requests;
+
+    /*
+     Slots bounding the number of concurrent downloads.
+     */
+    std::condition_variable _slotCondition;
+    int _activeDownloads;
+
+    /*
+     Register a callback for the given URL. Returns true if the caller is the
+     first to request the URL, and must perform the download.
+     */
+    bool addRequest(std::string url, std::function<void(std::string, bool)> callback);
+    void completeRequest(std::string url, std::string path, bool success);
+
+    /*
+     Download or revalidate the given URL, returning the path of its blob.
+     */
+    std::string download(std::string url, bool *success);
+    void evict();
+
+};
+
+#endif /* VROAssetCache_h */
@@ -29,7 +29,7 @@
 
 #include "VRODefines.h"
 
-#if VRO_PLATFORM_IOS || VRO_PLATFORM_MACOS || VRO_PLATFORM_ANDROID
+#if VRO_THREADS
 #include <atomic>
 
 template <typename T>
@@ -37,7 +37,7 @@ using VROAtomic = std::atomic<T>;
 
 #else
 
-// WebAssembly does not support atomic, and is single-threaded
+// WebAssembly without pthreads does not support atomic, and is single-threaded
 template <typename T>
 using VROAtomic = T;
 
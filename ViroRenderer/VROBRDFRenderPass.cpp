@@ -64,13 +64,30 @@ void VROBRDFRenderPass::render(std::shared_ptr<VROScene> scene,
                                std::shared_ptr<VROScene> outgoingScene,
                                VRORenderPassInputOutput &output,
                                VRORenderContext *context, std::shared_ptr<VRODriver> &driver) {
+    for (int slice = 0; slice < getNumSlices(); slice++) {
+        renderSlice(slice, output, driver);
+    }
+}
+
+void VROBRDFRenderPass::renderSlice(int slice, VRORenderPassInputOutput &output, std::shared_ptr<VRODriver> &driver) {
     if (!_shader) {
         init(driver);
     }
     pglpush("BRDF");
 
-    // Bind the destination render target
-    driver->bindRenderTarget(_BRDFRenderTarget, VRORenderTargetUnbindOp::Invalidate);
+    // Bind the destination render target. Only the first band may discard the target's
+    // contents; the others must preserve the bands rendered before them
+    VRORenderTargetActions actions = VRORenderTargetActions::overwrite();
+    if (slice > 0) {
+        actions = VRORenderTargetActions(VROLoadAction::Load, VROLoadAction::DontCare, VROLoadAction::DontCare,
+                                         VROStoreAction::Store, VROStoreAction::Discard, VROStoreAction::Discard);
+    }
+    driver->bindRenderTarget(_BRDFRenderTarget, actions, VRORenderTargetUnbindOp::Invalidate);
+    
+    // Restrict rendering (and the clear) to this slice's band of rows
+    int width = _BRDFRenderTarget->getWidth();
+    int bandHeight = _BRDFRenderTarget->getHeight() / kBRDFSlices;
+    _BRDFRenderTarget->setRenderRegion({ 0, slice * bandHeight, width, bandHeight });
 
     // Setup for rendering the quad
     VRORenderUtil::prepareForBlit(driver, true, false);
@@ -81,10 +98,15 @@ void VROBRDFRenderPass::render(std::shared_ptr<VROScene> scene,
     }
     driver->bindShader(_shader);
 
-    // Render our brdf convolution
+    // Render our brdf convolution. The quad covers the full target, so the texcoords
+    // of each band are unchanged
     GL( glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT) );
-    VRORenderUtil::renderQuad(&_quadVAO, &_quadVBO);
+    VRORenderUtil::renderQuad(&_quadVAO, &_quadVBO, driver);
     driver->unbindShader();
     pglpop();
     output.outputTarget = _BRDFRenderTarget;
 }
+
+int VROBRDFRenderPass::getNumSlices() const {
+    return kBRDFSlices;
+}
@@ -33,6 +33,12 @@ class VROTexture;
 class VROShaderProgram;
 class VROImagePostProcess;
 
+/*
+ The number of slices (bands of rows) the BRDF map is rendered in, when
+ rendered slice by slice.
+ */
+const int kBRDFSlices = 8;
+
 /*
  Pre-computes and stores an irradiance BRDF map into a 2D lookup texture.
  */
@@ -46,6 +52,14 @@ public:
                 std::shared_ptr<VROScene> outgoingScene,
                 VRORenderPassInputOutput &inputs,
                 VRORenderContext *context, std::shared_ptr<VRODriver> &driver);
+    
+    /*
+     Render a single slice (one band of rows) of the BRDF map. Slices may be
+     rendered on separate frames, so that the work can be time-sliced; render()
+     renders all of them at once.
+     */
+    void renderSlice(int slice, VRORenderPassInputOutput &output, std::shared_ptr<VRODriver> &driver);
+    int getNumSlices() const;
 
 private:
     unsigned int _quadVAO = 0;
@@ -0,0 +1,120 @@
+//
+//  VROBackgroundQuad.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROBackgroundQuad.h"
+#include "VROData.h"
+#include "VROMaterial.h"
+#include "VROTexture.h"
+#include "VROGeometrySource.h"
+#include "VROGeometryElement.h"
+#include "VROShaderModifier.h"
+#include "VROShapeUtils.h"
+
+static const int kNumQuadVertices = 4;
+static const int kNumQuadIndices = 6;
+static const int kQuadStride = sizeof(VROShapeVertexLayout);
+
+// Positions are in normalized device coordinates; the view ray modifier places the
+// quad on the far plane regardless of the transforms
+static const VROShapeVertexLayout vertices[] = {
+    { -1.0, -1.0,  1.0,  0.0, 0.0,  0.0, 0.0, -1.0,  1.0, 0.0, 0.0, 1.0 },
+    {  1.0, -1.0,  1.0,  1.0, 0.0,  0.0, 0.0, -1.0,  1.0, 0.0, 0.0, 1.0 },
+    {  1.0,  1.0,  1.0,  1.0, 1.0,  0.0, 0.0, -1.0,  1.0, 0.0, 0.0, 1.0 },
+    { -1.0,  1.0,  1.0,  0.0, 1.0,  0.0, 0.0, -1.0,  1.0, 0.0, 0.0, 1.0 },
+};
+
+static uint32_t indices[] = {
+    0, 1, 2, 2, 3, 0,
+};
+
+static thread_local std::shared_ptr<VROShaderModifier> sViewRayModifier;
+
+std::shared_ptr<VROBackgroundQuad> VROBackgroundQuad::createEquirectangular(std::shared_ptr<VROTexture> texture) {
+    std::shared_ptr<VROBackgroundQuad> quad = buildQuadGeometry(texture);
+    quad->getMaterials().front()->setEquirectangularDiffuse(true);
+    return quad;
+}
+
+std::shared_ptr<VROBackgroundQuad> VROBackgroundQuad::createCube(std::shared_ptr<VROTexture> textureCube) {
+    // The cube shader samples along the surface position, which is already the view ray
+    return buildQuadGeometry(textureCube);
+}
+
+std::shared_ptr<VROBackgroundQuad> VROBackgroundQuad::createScreen(std::shared_ptr<VROTexture> texture) {
+    // The texture coordinates of the quad span the screen, so the view ray is unused
+    std::shared_ptr<VROBackgroundQuad> quad = buildQuadGeometry(texture);
+    quad->setName("Background Compositor");
+    return quad;
+}
+
+VROBackgroundQuad::~VROBackgroundQuad() {
+    
+}
+
+std::shared_ptr<VROBackgroundQuad> VROBackgroundQuad::buildQuadGeometry(std::shared_ptr<VROTexture> texture) {
+    std::shared_ptr<VROData> vertexData = std::make_shared<VROData>((void *) vertices, kQuadStride * kNumQuadVertices);
+    std::vector<std::shared_ptr<VROGeometrySource>> sources = VROShapeUtilBuildGeometrySources(vertexData, kNumQuadVertices);
+    
+    std::shared_ptr<VROData> indexData = std::make_shared<VROData>((void *) indices, sizeof(int32_t) * kNumQuadIndices);
+    std::shared_ptr<VROGeometryElement> element = std::make_shared<VROGeometryElement>(indexData,
+                                                                                       VROGeometryPrimitiveType::Triangle,
+                                                                                       kNumQuadIndices / 3,
+                                                                                       sizeof(int32_t));
+    std::vector<std::shared_ptr<VROGeometryElement>> elements = { element };
+    std::shared_ptr<VROBackgroundQuad> quad = std::shared_ptr<VROBackgroundQuad>(new VROBackgroundQuad(sources, elements));
+    
+    std::shared_ptr<VROMaterial> material = std::make_shared<VROMaterial>();
+    material->setWritesToDepthBuffer(false);
+    material->setCullMode(VROCullMode::None);
+    material->getDiffuse().setTexture(texture);
+    material->setLightingModel(VROLightingModel::Constant);
+    material->setNeedsToneMapping(false);
+    material->addShaderModifier(getViewRayModifier());
+    
+    quad->setMaterials({ material });
+    quad->setCameraEnclosure(true);
+    return quad;
+}
+
+std::shared_ptr<VROShaderModifier> VROBackgroundQuad::getViewRayModifier() {
+    /*
+     Modifier that pins the quad to the far plane, and replaces the surface position with
+     the point on the far plane seen through each vertex, in the background's own space.
+     Interpolated, this gives each fragment its view ray (from the camera, since
+     backgrounds use the enclosure view matrix).
+     */
+    if (!sViewRayModifier) {
+        std::vector<std::string> modifierCode = {
+            "highp mat4 background_inverse = inverse(_transforms.projection_matrix * _transforms.view_matrix * _transforms.model_matrix);",
+            "highp vec4 background_ray = background_inverse * vec4(_geometry.position.xy, 1.0, 1.0);",
+            "v_surface_position = background_ray.xyz / background_ray.w;",
+            "_vertex.position = vec4(_geometry.position.xy, 1.0, 1.0);",
+        };
+        sViewRayModifier = std::make_shared<VROShaderModifier>(VROShaderEntryPoint::Vertex,
+                                                               modifierCode);
+        sViewRayModifier->setName("background_ray");
+    }
+    return sViewRayModifier;
+}
@@ -0,0 +1,71 @@
+//
+//  VROBackgroundQuad.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROBackgroundQuad_h
+#define VROBackgroundQuad_h
+
+#include "VROGeometry.h"
+
+class VROTexture;
+class VROShaderModifier;
+
+/*
+ A background drawn as a single full-screen quad. Each fragment reconstructs its view
+ ray from the inverse view-projection, and samples the background texture along it: a
+ cube texture directly, or an equirectangular (360) texture with texture coordinates
+ derived from the ray. This replaces the tessellated VROSphere behind 360 images and
+ videos, and the VROSkybox cube, with four vertices, and lets equirectangular sources
+ be shown without converting them to a cube map.
+
+ The equirectangular mapping matches the texture coordinates of VROSphere, so
+ stereo modes and background rotation apply as before.
+ */
+class VROBackgroundQuad : public VROGeometry {
+    
+public:
+    
+    static std::shared_ptr<VROBackgroundQuad> createEquirectangular(std::shared_ptr<VROTexture> texture);
+    static std::shared_ptr<VROBackgroundQuad> createCube(std::shared_ptr<VROTexture> textureCube);
+    
+    /*
+     Create a quad that maps the given 2D texture onto the screen, at the far plane.
+     Used to composite backgrounds rendered offscreen (e.g. at reduced resolution).
+     */
+    static std::shared_ptr<VROBackgroundQuad> createScreen(std::shared_ptr<VROTexture> texture);
+    virtual ~VROBackgroundQuad();
+    
+private:
+    
+    VROBackgroundQuad(std::vector<std::shared_ptr<VROGeometrySource>> sources,
+                      std::vector<std::shared_ptr<VROGeometryElement>> elements) :
+        VROGeometry(sources, elements)
+    {}
+    
+    static std::shared_ptr<VROBackgroundQuad> buildQuadGeometry(std::shared_ptr<VROTexture> texture);
+    static std::shared_ptr<VROShaderModifier> getViewRayModifier();
+    
+};
+
+#endif /* VROBackgroundQuad_h */
@@ -0,0 +1,114 @@
+//
+//  VROBakedSkeletalAnimation.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROBakedSkeletalAnimation.h"
+#include "VROSkeletalAnimation.h"
+#include "VROAnimationClip.h"
+#include "VROSkeleton.h"
+#include "VROSkinner.h"
+#include "VROBone.h"
+#include "VROLog.h"
+#include <atomic>
+#include <cmath>
+
+static std::atomic_int sBakedAnimationId;
+
+std::shared_ptr<VROBakedSkeletalAnimation> VROBakedSkeletalAnimation::bake(std::shared_ptr<VROSkeletalAnimation> animation,
+                                                                          std::shared_ptr<VROSkinner> skinner,
+                                                                          float frameRate) {
+    const std::shared_ptr<VROAnimationClip> &clip = animation->getClip();
+    std::shared_ptr<VROSkeleton> skeleton = skinner->getSkeleton();
+    float duration = animation->getDuration();
+    if (!clip || clip->getNumTracks() == 0 || duration <= 0 || frameRate <= 0) {
+        return nullptr;
+    }
+    
+    int numFrames = std::max(1, std::min((int) ceil(duration * frameRate), kMaxBakedAnimationFrames));
+    int numBones = std::min(skinner->getNumPaletteBones(), kMaxBakedAnimationBones);
+    if (numBones < skinner->getNumPaletteBones()) {
+        pwarn("Skinner has %d bones, only the first %d will be baked", skinner->getNumPaletteBones(), numBones);
+    }
+    
+    // Remember the current pose, which we overwrite as we sample the clip
+    std::vector<VROMatrix4f> pose;
+    pose.reserve(skeleton->getNumBones());
+    for (int i = 0; i < skeleton->getNumBones(); i++) {
+        pose.push_back(skeleton->getBone(i)->getTransform());
+    }
+    
+    int floatsPerFrame = numBones * kBakedAnimationTexelsPerBone * 4;
+    std::vector<float> data((numFrames + 1) * floatsPerFrame);
+    std::vector<VROAnimationClipCursor> cursors(clip->getNumTracks());
+    
+    for (int frame = 0; frame <= numFrames; frame++) {
+        float t = frame / (float) numFrames;
+        for (int track = 0; track < clip->getNumTracks(); track++) {
+            const std::shared_ptr<VROBone> &bone = skeleton->getBone(clip->getTrackTarget(track));
+            bone->setTransform(clip->sample(track, t, &cursors[track]), bone->getTransformType());
+        }
+        
+        // Write the first three rows of each bone's model transform; the last row
+        // of an affine transform is always (0, 0, 0, 1)
+        float *row = &data[frame * floatsPerFrame];
+        for (int b = 0; b < numBones; b++) {
+            VROMatrix4f transform = skinner->getModelTransform(skinner->getPaletteBone(b));
+            const float *m = transform.getArray();
+            for (int r = 0; r < kBakedAnimationTexelsPerBone; r++) {
+                row[0] = m[r];
+                row[1] = m[4 + r];
+                row[2] = m[8 + r];
+                row[3] = m[12 + r];
+                row += 4;
+            }
+        }
+    }
+    
+    for (int i = 0; i < skeleton->getNumBones(); i++) {
+        const std::shared_ptr<VROBone> &bone = skeleton->getBone(i);
+        bone->setTransform(pose[i], bone->getTransformType());
+    }
+    return std::make_shared<VROBakedSkeletalAnimation>(numBones, numFrames, duration, std::move(data));
+}
+
+VROBakedSkeletalAnimation::VROBakedSkeletalAnimation(int numBones, int numFrames, float duration,
+                                                     std::vector<float> data) :
+    _id(++sBakedAnimationId),
+    _numBones(numBones),
+    _numFrames(numFrames),
+    _duration(duration),
+    _data(std::move(data)) {
+    passert (_data.size() == (size_t) (numFrames + 1) * numBones * kBakedAnimationTexelsPerBone * 4);
+}
+
+float VROBakedSkeletalAnimation::getFramePosition(double seconds) const {
+    double t = fmod(seconds, (double) _duration);
+    if (t < 0) {
+        t += _duration;
+    }
+    
+    // Clamp below the final row, so the shader can always read the next frame
+    float position = (float) (t / _duration) * _numFrames;
+    return std::min(std::max(position, 0.0f), std::nextafter((float) _numFrames, 0.0f));
+}
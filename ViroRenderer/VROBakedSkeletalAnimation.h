@@ -0,0 +1,131 @@
+//
+//  VROBakedSkeletalAnimation.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROBakedSkeletalAnimation_h
+#define VROBakedSkeletalAnimation_h
+
+#include <memory>
+#include <vector>
+
+class VROSkinner;
+class VROSkeletalAnimation;
+
+/*
+ Frame rate at which skeletal animations are baked by default.
+ */
+static const float kBakedAnimationDefaultFrameRate = 30;
+
+/*
+ Each bone of each frame occupies this many RGBA texels of the bone-animation
+ texture, holding the first three rows of the bone's model transform. Keep in
+ sync with baked_skinning_vsh.glsl.
+ */
+static const int kBakedAnimationTexelsPerBone = 3;
+
+/*
+ The bone-animation texture has one row per frame, plus one, and three texels
+ per bone. These limits keep it within the 2048 texel size GLES 3.0
+ guarantees; longer animations are baked at a lower frame rate.
+ */
+static const int kMaxBakedAnimationFrames = 2047;
+static const int kMaxBakedAnimationBones = 682;
+
+/*
+ A skeletal animation baked into a bone-animation texture, so that crowds of
+ identical skinned characters can be animated entirely on the GPU.
+ 
+ Skinned geometries normally upload their bones to a VROBoneUBO, and so cannot
+ be instanced: every character is its own draw. When a skinner is given a baked
+ animation (VROSkinner::setBakedAnimation), its geometry instead samples each
+ vertex's bones from this texture, at the frame of each instance. Nodes sharing
+ the geometry are then batched by automatic instancing (see
+ VROPortal::renderContents), and each can play the animation at its own time
+ offset (VRONode::setBakedAnimationTimeOffset). The baked animation loops.
+ */
+class VROBakedSkeletalAnimation {
+    
+public:
+    
+    /*
+     Bake the given animation for the bones of the given skinner, sampling it at
+     the given frame rate. The skinner's skeleton is animated to each frame to
+     compute the bone transforms, and afterward restored to its current pose.
+     Returns nullptr if the animation has no frames to bake.
+     */
+    static std::shared_ptr<VROBakedSkeletalAnimation> bake(std::shared_ptr<VROSkeletalAnimation> animation,
+                                                          std::shared_ptr<VROSkinner> skinner,
+                                                          float frameRate = kBakedAnimationDefaultFrameRate);
+    
+    VROBakedSkeletalAnimation(int numBones, int numFrames, float duration, std::vector<float> data);
+    virtual ~VROBakedSkeletalAnimation() {}
+    
+    /*
+     Unique identifier of this baked animation, used to detect when its texture
+     must be uploaded.
+     */
+    int getId() const {
+        return _id;
+    }
+    
+    /*
+     The number of bones and frames in the texture, and the duration of the
+     animation in seconds. The texture is getNumBones() * kBakedAnimationTexelsPerBone
+     texels wide and getNumFrames() + 1 texels tall: the last row holds the final
+     pose, so that interpolation from the last frame needs no wrapping.
+     */
+    int getNumBones() const {
+        return _numBones;
+    }
+    int getNumFrames() const {
+        return _numFrames;
+    }
+    float getDuration() const {
+        return _duration;
+    }
+    
+    /*
+     The texels of the bone-animation texture, as RGBA floats in row order.
+     */
+    const std::vector<float> &getData() const {
+        return _data;
+    }
+    
+    /*
+     Get the position of the animation, in frames, at the given time in seconds.
+     The fractional part is used to interpolate between frames.
+     */
+    float getFramePosition(double seconds) const;
+    
+private:
+    
+    int _id;
+    int _numBones;
+    int _numFrames;
+    float _duration;
+    std::vector<float> _data;
+    
+};
+
+#endif /* VROBakedSkeletalAnimation_h */
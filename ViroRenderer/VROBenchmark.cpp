@@ -0,0 +1,135 @@
+//
+//  VROBenchmark.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROBenchmark.h"
+#include "VROTime.h"
+#include "VRODefines.h"
+#include "VROLog.h"
+#include <algorithm>
+#include <sstream>
+#include <cstdio>
+
+static const int kBenchmarkRepetitions = 5;
+
+static volatile float sBenchmarkFloatSink;
+static const void * volatile sBenchmarkPointerSink;
+
+VROBenchmark::VROBenchmark(std::string suite) :
+    _suite(suite) {
+    
+}
+
+VROBenchmark::~VROBenchmark() {
+    
+}
+
+void VROBenchmark::run(std::string name, int iterations, std::function<void(int)> body) {
+    // Warm up caches and lazily initialized state
+    body(0);
+    
+    std::vector<double> times;
+    for (int r = 0; r < kBenchmarkRepetitions; r++) {
+        uint64_t start = VRONanoTime();
+        for (int i = 0; i < iterations; i++) {
+            body(i);
+        }
+        times.push_back((double) (VRONanoTime() - start) / iterations);
+    }
+    std::sort(times.begin(), times.end());
+    
+    VROBenchmarkResult result;
+    result.name = name;
+    result.iterations = iterations;
+    result.repetitions = kBenchmarkRepetitions;
+    result.medianNs = times[times.size() / 2];
+    result.minNs = times.front();
+    _results.push_back(result);
+    
+    pinfo("Benchmark [%s] %.1f ns/iteration (min %.1f)", name.c_str(), result.medianNs, result.minNs);
+}
+
+void VROBenchmark::record(std::string name, int iterations, double totalMs) {
+    VROBenchmarkResult result;
+    result.name = name;
+    result.iterations = iterations;
+    result.repetitions = 1;
+    result.medianNs = totalMs * 1000000.0 / std::max(iterations, 1);
+    result.minNs = result.medianNs;
+    _results.push_back(result);
+    
+    pinfo("Benchmark [%s] %.3f ms/iteration", name.c_str(), result.medianNs / 1000000.0);
+}
+
+std::string VROBenchmark::toJSON() const {
+#if VRO_PLATFORM_IOS
+    const char *platform = "ios";
+#elif VRO_PLATFORM_MACOS
+    const char *platform = "macos";
+#elif VRO_PLATFORM_ANDROID
+    const char *platform = "android";
+#else
+    const char *platform = "wasm";
+#endif
+    
+    // Benchmark and suite names are identifiers, so they need no escaping
+    std::stringstream ss;
+    ss << "{\n";
+    ss << "  \"suite\": \"" << _suite << "\",\n";
+    ss << "  \"platform\": \"" << platform << "\",\n";
+    ss << "  \"time\": " << VROTimeGetCalendarTime() << ",\n";
+    ss << "  \"benchmarks\": [";
+    for (size_t i = 0; i < _results.size(); i++) {
+        const VROBenchmarkResult &result = _results[i];
+        ss << (i == 0 ? "\n" : ",\n");
+        ss << "    { \"name\": \"" << result.name << "\""
+           << ", \"iterations\": " << result.iterations
+           << ", \"repetitions\": " << result.repetitions
+           << ", \"median_ns\": " << result.medianNs
+           << ", \"min_ns\": " << result.minNs << " }";
+    }
+    ss << "\n  ]\n}\n";
+    return ss.str();
+}
+
+bool VROBenchmark::writeJSON(std::string path) const {
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file) {
+        pwarn("Failed to open benchmark results file %s", path.c_str());
+        return false;
+    }
+    
+    std::string json = toJSON();
+    bool success = fwrite(json.data(), 1, json.size(), file) == json.size();
+    fclose(file);
+    return success;
+}
+
+void VROBenchmark::consume(float value) {
+    sBenchmarkFloatSink = value;
+}
+
+void VROBenchmark::consume(const void *value) {
+    sBenchmarkPointerSink = value;
+}
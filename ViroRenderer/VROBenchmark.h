@@ -0,0 +1,97 @@
+//
+//  VROBenchmark.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROBenchmark_h
+#define VROBenchmark_h
+
+#include <string>
+#include <vector>
+#include <functional>
+
+/*
+ The timing of one benchmark. Times are per iteration, in nanoseconds: the median
+ and minimum over the repetitions of the benchmark.
+ */
+struct VROBenchmarkResult {
+    std::string name;
+    int iterations;
+    int repetitions;
+    double medianNs;
+    double minNs;
+};
+
+/*
+ Runs microbenchmarks and reports their timings as JSON, so that results can be
+ compared from one release to the next. Each benchmark is run once to warm up, then
+ repeated kBenchmarkRepetitions times, each repetition timing the given number of
+ iterations of the body.
+ */
+class VROBenchmark {
+public:
+    
+    VROBenchmark(std::string suite);
+    virtual ~VROBenchmark();
+    
+    /*
+     Time the given body, which receives the iteration index. Bodies should pass
+     each computed value to consume() so the compiler can't discard the work.
+     */
+    void run(std::string name, int iterations, std::function<void(int)> body);
+    
+    /*
+     Record a timing measured outside of run(), e.g. for asynchronous operations
+     like model loading.
+     */
+    void record(std::string name, int iterations, double totalMs);
+    
+    const std::vector<VROBenchmarkResult> &getResults() const {
+        return _results;
+    }
+    
+    /*
+     Serialize the results, along with the suite name, platform, and time of the
+     run, to JSON.
+     */
+    std::string toJSON() const;
+    
+    /*
+     Write the JSON results to the given file. Returns false on failure.
+     */
+    bool writeJSON(std::string path) const;
+    
+    /*
+     Prevent the compiler from optimizing away the computation of the given value.
+     */
+    static void consume(float value);
+    static void consume(const void *value);
+    
+private:
+    
+    std::string _suite;
+    std::vector<VROBenchmarkResult> _results;
+    
+};
+
+#endif /* VROBenchmark_h */
@@ -0,0 +1,278 @@
+//
+//  VROBenchmarkTest.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROBenchmarkTest.h"
+#include "VROBenchmark.h"
+#include "VROTestUtil.h"
+#include "VROMath.h"
+#include "VROFrustum.h"
+#include "VROFrustumBoxIntersectionMetadata.h"
+#include "VROSortKey.h"
+#include "VROTriangle.h"
+#include "VROMorpher.h"
+#include "VROGeometrySource.h"
+#include "VROData.h"
+#include "VROTime.h"
+#include "VROPlatformUtil.h"
+#include "VROGLTFLoader.h"
+
+// Number of distinct inputs each benchmark cycles through
+static const int kBenchmarkInputs = 1024;
+static const int kBenchmarkInputMask = kBenchmarkInputs - 1;
+static const int kBenchmarkSortKeys = 2048;
+static const int kBenchmarkMorphVertices = 10000;
+static const int kBenchmarkMorphTargets = 4;
+
+VROBenchmarkTest::VROBenchmarkTest() :
+    VRORendererTest(VRORendererTestType::Benchmark) {
+        
+}
+
+VROBenchmarkTest::~VROBenchmarkTest() {
+    
+}
+
+void VROBenchmarkTest::build(std::shared_ptr<VRORenderer> renderer,
+                             std::shared_ptr<VROFrameSynchronizer> frameSynchronizer,
+                             std::shared_ptr<VRODriver> driver) {
+    _sceneController = std::make_shared<VROSceneController>();
+    std::shared_ptr<VROScene> scene = _sceneController->getScene();
+    
+    std::shared_ptr<VROPortal> rootNode = scene->getRootNode();
+    rootNode->setPosition({0, 0, 0});
+    
+    std::shared_ptr<VRONodeCamera> camera = std::make_shared<VRONodeCamera>();
+    std::shared_ptr<VRONode> cameraNode = std::make_shared<VRONode>();
+    cameraNode->setCamera(camera);
+    rootNode->addChildNode(cameraNode);
+    _pointOfView = cameraNode;
+    
+    std::shared_ptr<VROBenchmark> benchmark = std::make_shared<VROBenchmark>("ViroRenderer");
+    VROPlatformDispatchAsyncBackground([benchmark, driver] {
+        runCoreBenchmarks(benchmark);
+        
+        VROPlatformDispatchAsyncRenderer([benchmark, driver] {
+            runLoaderBenchmarks(benchmark, driver, [benchmark] {
+                std::string path = VROPlatformGetCacheDirectory() + "/viro_benchmarks.json";
+                if (benchmark->writeJSON(path)) {
+                    pinfo("Wrote %d benchmark results to %s", (int) benchmark->getResults().size(), path.c_str());
+                }
+            });
+        });
+    });
+}
+
+void VROBenchmarkTest::runCoreBenchmarks(std::shared_ptr<VROBenchmark> benchmark) {
+    /*
+     Matrix operations.
+     */
+    std::vector<VROMatrix4f> matrices(kBenchmarkInputs);
+    std::vector<VROMatrix4f> products(kBenchmarkInputs);
+    std::vector<VROVector3f> points(kBenchmarkInputs);
+    for (int i = 0; i < kBenchmarkInputs; i++) {
+        matrices[i].rotate(random(0, M_PI * 2), { 0, 0, 0 }, VROVector3f(random(-1, 1), random(-1, 1), random(-1, 1)).normalize());
+        matrices[i].scale(random(0.5, 2), random(0.5, 2), random(0.5, 2));
+        matrices[i].translate(random(-10, 10), random(-10, 10), random(-10, 10));
+        points[i] = { random(-10, 10), random(-10, 10), random(-10, 10) };
+    }
+    
+    benchmark->run("matrix_multiply", 100000, [&matrices](int i) {
+        VROBenchmark::consume(matrices[i & kBenchmarkInputMask].multiply(matrices[(i + 1) & kBenchmarkInputMask])[0]);
+    });
+    benchmark->run("matrix_invert", 100000, [&matrices](int i) {
+        VROBenchmark::consume(matrices[i & kBenchmarkInputMask].invert()[0]);
+    });
+    benchmark->run("matrix_transpose", 100000, [&matrices](int i) {
+        VROBenchmark::consume(matrices[i & kBenchmarkInputMask].transpose()[1]);
+    });
+    benchmark->run("matrix_transform_point", 100000, [&matrices, &points](int i) {
+        VROBenchmark::consume(matrices[i & kBenchmarkInputMask].multiply(points[i & kBenchmarkInputMask]).x);
+    });
+    benchmark->run("matrix_multiply_batch_1024", 100, [&matrices, &products](int i) {
+        VROMatrix4f::multiply(matrices.data(), matrices.data(), products.data(), kBenchmarkInputs);
+        VROBenchmark::consume(products.data());
+    });
+    std::vector<VROVector3f> transformed(kBenchmarkInputs);
+    benchmark->run("matrix_transform_points_batch_1024", 1000, [&matrices, &points, &transformed](int i) {
+        matrices[i & kBenchmarkInputMask].multiply(points.data(), kBenchmarkInputs, transformed.data());
+        VROBenchmark::consume(transformed.data());
+    });
+    
+    /*
+     Frustum culling against boxes scattered around the camera.
+     */
+    VROMatrix4f view = VROMathComputeLookAtMatrix({ 0, 0, 0 }, { 0, 0, -1 }, { 0, 1, 0 });
+    VROMatrix4f projection = VROMathComputePerspectiveProjection(60, 1.5, 0.01, 50);
+    VROFrustum frustum;
+    frustum.fitToModelView(view.getArray(), projection.getArray(), 0, 0, 0);
+    
+    std::vector<VROBoundingBox> boxes(kBenchmarkInputs);
+    std::vector<VROFrustumBoxIntersectionMetadata> metadata(kBenchmarkInputs);
+    for (int i = 0; i < kBenchmarkInputs; i++) {
+        VROVector3f center(random(-40, 40), random(-40, 40), random(-60, 20));
+        float extent = random(0.1, 3);
+        boxes[i] = VROBoundingBox(center.x - extent, center.x + extent, center.y - extent, center.y + extent,
+                                  center.z - extent, center.z + extent);
+    }
+    benchmark->run("frustum_intersect_all_opt", 100000, [&frustum, &boxes, &metadata](int i) {
+        VROBenchmark::consume((float) frustum.intersectAllOpt(boxes[i & kBenchmarkInputMask], &metadata[i & kBenchmarkInputMask]));
+    });
+    benchmark->run("frustum_intersect_no_opt", 100000, [&frustum, &boxes](int i) {
+        VROBenchmark::consume((float) frustum.intersectNoOpt(boxes[i & kBenchmarkInputMask]));
+    });
+    
+    /*
+     Ray intersection against boxes and triangles.
+     */
+    std::vector<VROVector3f> rays(kBenchmarkInputs);
+    std::vector<VROTriangle> triangles;
+    for (int i = 0; i < kBenchmarkInputs; i++) {
+        rays[i] = VROVector3f(random(-1, 1), random(-1, 1), -1).normalize();
+        triangles.push_back(VROTriangle({ random(-5, 0), random(-5, 0), random(-10, -1) },
+                                        { random(0, 5),  random(-5, 0), random(-10, -1) },
+                                        { random(-2, 2), random(0, 5),  random(-10, -1) }));
+    }
+    VROVector3f origin;
+    benchmark->run("bounding_box_ray", 100000, [&boxes, &rays, &origin](int i) {
+        VROVector3f intersection;
+        VROBenchmark::consume((float) boxes[i & kBenchmarkInputMask].intersectsRay(rays[i & kBenchmarkInputMask], origin, &intersection));
+    });
+    benchmark->run("triangle_ray", 100000, [&triangles, &rays, &origin](int i) {
+        VROVector3f intersection;
+        VROBenchmark::consume((float) triangles[i & kBenchmarkInputMask].intersectsRay(rays[i & kBenchmarkInputMask], origin, &intersection));
+    });
+    
+    /*
+     Sort keys: a fresh sorter each iteration measures the radix sort, while a
+     retained sorter measures the frame-to-frame path where the order is unchanged.
+     */
+    std::vector<VROSortKey> keys(kBenchmarkSortKeys);
+    for (int i = 0; i < kBenchmarkSortKeys; i++) {
+        VROSortKey &key = keys[i];
+        key.renderingOrder = 0;
+        key.hierarchyDepth = 0;
+        key.hierarchyId = 0;
+        key.transparent = (i % 8) == 0;
+        key.distanceFromCamera = random(0.1, 50);
+        key.incoming = false;
+        key.materialRenderingOrder = 0;
+        key.shader = rand() % 16;
+        key.textures = rand() % 64;
+        key.lights = rand() % 4;
+        key.material = rand() % 128;
+        key.node = (uintptr_t) (i + 1);
+        key.elementIndex = 0;
+    }
+    benchmark->run("sort_keys_radix_2048", 200, [&keys](int i) {
+        std::vector<VROSortKey> sorted = keys;
+        VROSortKeySorter sorter;
+        sorter.sort(sorted);
+        VROBenchmark::consume(sorted.data());
+    });
+    VROSortKeySorter coherentSorter;
+    benchmark->run("sort_keys_coherent_2048", 200, [&keys, &coherentSorter](int i) {
+        std::vector<VROSortKey> sorted = keys;
+        coherentSorter.sort(sorted);
+        VROBenchmark::consume(sorted.data());
+    });
+    benchmark->run("sort_keys_std_sort_2048", 200, [&keys](int i) {
+        std::vector<VROSortKey> sorted = keys;
+        std::sort(sorted.begin(), sorted.end());
+        VROBenchmark::consume(sorted.data());
+    });
+    
+    /*
+     CPU morph target blending, with every target animating each iteration.
+     */
+    std::function<std::vector<std::shared_ptr<VROGeometrySource>>(float)> createSources = [](float displacement) {
+        std::vector<std::shared_ptr<VROGeometrySource>> sources;
+        for (VROGeometrySourceSemantic semantic : { VROGeometrySourceSemantic::Vertex, VROGeometrySourceSemantic::Normal }) {
+            std::vector<float> values(kBenchmarkMorphVertices * 3);
+            for (float &value : values) {
+                value = random(-displacement, displacement);
+            }
+            std::shared_ptr<VROData> data = std::make_shared<VROData>((void *) values.data(), (int) (values.size() * sizeof(float)));
+            sources.push_back(std::make_shared<VROGeometrySource>(data, semantic, kBenchmarkMorphVertices, true, 3,
+                                                                  sizeof(float), 0, sizeof(float) * 3));
+        }
+        return sources;
+    };
+    
+    std::vector<std::shared_ptr<VROGeometrySource>> baseSources = createSources(1);
+    std::shared_ptr<VROMorpher> morpher = std::make_shared<VROMorpher>(baseSources, std::make_shared<VROMaterial>());
+    for (int t = 0; t < kBenchmarkMorphTargets; t++) {
+        morpher->addTarget(createSources(0.1), "target_" + std::to_string(t), 0);
+    }
+    morpher->setComputeLocation(VROMorpher::ComputeLocation::CPU);
+    
+    std::vector<std::shared_ptr<VROGeometrySource>> geometrySources = baseSources;
+    std::vector<std::shared_ptr<VROGeometrySource>> updatedSources;
+    benchmark->run("morpher_blend_cpu_10k", 100, [&morpher, &geometrySources, &updatedSources](int i) {
+        for (int t = 0; t < kBenchmarkMorphTargets; t++) {
+            morpher->setWeightForTarget("target_" + std::to_string(t), (float) ((i + t) % 10) / 10.0f, false);
+        }
+        updatedSources.clear();
+        morpher->update(geometrySources, nullptr, &updatedSources);
+        VROBenchmark::consume(updatedSources.data());
+    });
+}
+
+void VROBenchmarkTest::runLoaderBenchmarks(std::shared_ptr<VROBenchmark> benchmark,
+                                           std::shared_ptr<VRODriver> driver,
+                                           std::function<void()> onFinish) {
+    /*
+     Each load is timed from the load request to its completion callback, so these
+     include file IO and the hop back to the rendering thread. Loads run one at a
+     time so they don't compete for the background threads.
+     */
+    double objStart = VROTimeCurrentMillis();
+    std::shared_ptr<VRONode> objNode = std::make_shared<VRONode>();
+    VROOBJLoader::loadOBJFromResource(VROTestUtil::getURLForResource("cupcake", "obj"), VROResourceType::URL, objNode, driver,
+                                      [benchmark, driver, onFinish, objStart](std::shared_ptr<VRONode> node, bool success) {
+        if (success) {
+            benchmark->record("load_obj_cupcake", 1, VROTimeCurrentMillis() - objStart);
+        }
+        
+        double fbxStart = VROTimeCurrentMillis();
+        std::shared_ptr<VRONode> fbxNode = std::make_shared<VRONode>();
+        VROFBXLoader::loadFBXFromResource(VROTestUtil::getURLForResource("pug", "vrx"), VROResourceType::URL, fbxNode, driver,
+                                          [benchmark, driver, onFinish, fbxStart](std::shared_ptr<VRONode> node, bool success) {
+            if (success) {
+                benchmark->record("load_fbx_pug", 1, VROTimeCurrentMillis() - fbxStart);
+            }
+            
+            double gltfStart = VROTimeCurrentMillis();
+            std::shared_ptr<VRONode> gltfNode = std::make_shared<VRONode>();
+            VROGLTFLoader::loadGLTFFromResource(VROTestUtil::getURLForResource("CesiumMan", "glb"), {}, VROResourceType::URL,
+                                                gltfNode, true, driver,
+                                                [benchmark, onFinish, gltfStart](std::shared_ptr<VRONode> node, bool success) {
+                if (success) {
+                    benchmark->record("load_gltf_cesium_man", 1, VROTimeCurrentMillis() - gltfStart);
+                }
+                onFinish();
+            });
+        });
+    });
+}
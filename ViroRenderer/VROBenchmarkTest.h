@@ -0,0 +1,67 @@
+//
+//  VROBenchmarkTest.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROBenchmarkTest_h
+#define VROBenchmarkTest_h
+
+#include "VRORendererTest.h"
+
+class VROBenchmark;
+
+/*
+ Runs the renderer's microbenchmarks instead of displaying a scene: core math,
+ frustum culling, sort key sorting, ray intersection, and morph blending run on a
+ background thread, followed by OBJ, FBX, and glTF load times. The results are
+ logged and written as JSON to viro_benchmarks.json in the cache directory.
+ */
+class VROBenchmarkTest : public VRORendererTest {
+public:
+    
+    VROBenchmarkTest();
+    virtual ~VROBenchmarkTest();
+    
+    void build(std::shared_ptr<VRORenderer> renderer,
+               std::shared_ptr<VROFrameSynchronizer> frameSynchronizer,
+               std::shared_ptr<VRODriver> driver);
+    std::shared_ptr<VRONode> getPointOfView() {
+        return _pointOfView;
+    }
+    std::shared_ptr<VROSceneController> getSceneController() {
+        return _sceneController;
+    }
+    
+private:
+
+    std::shared_ptr<VRONode> _pointOfView;
+    std::shared_ptr<VROSceneController> _sceneController;
+    
+    static void runCoreBenchmarks(std::shared_ptr<VROBenchmark> benchmark);
+    static void runLoaderBenchmarks(std::shared_ptr<VROBenchmark> benchmark,
+                                    std::shared_ptr<VRODriver> driver,
+                                    std::function<void()> onFinish);
+    
+};
+
+#endif /* VROBenchmarkTest_h */
@@ -30,6 +30,7 @@
 #include "VROQuaternion.h"
 #include "VROCamera.h"
 #include "VRONode.h"
+#include "VROShaderModifier.h"
 
 VROMatrix4f VROBillboardConstraint::getTransform(const VRORenderContext &context,
                                                  VROMatrix4f transform) {
@@ -98,6 +99,37 @@ VROMatrix4f VROBillboardConstraint::getTransform(const VRORenderContext &context
     }
 }
 
+std::shared_ptr<VROShaderModifier> VROBillboardConstraint::getShaderModifier() {
+    if (!isShaderBillboarding()) {
+        return nullptr;
+    }
+    return getBillboardShaderModifier();
+}
+
+std::shared_ptr<VROShaderModifier> VROBillboardConstraint::getBillboardShaderModifier() {
+    /*
+     The rows of the view matrix are the camera's right, up and back vectors, so the
+     transpose of its upper 3x3 turns the geometry's X and Y axes to the view plane.
+     Normals and tangents are transformed by the normal matrix of the unrotated model
+     matrix M, which is inverse(transpose(M)). We want them transformed by the
+     billboarded normal matrix B * inverse(S) instead, so we premultiply them by
+     transpose(M), the inverse of the normal matrix.
+     */
+    static std::shared_ptr<VROShaderModifier> sBillboardModifier = std::make_shared<VROShaderModifier>(VROShaderEntryPoint::Geometry,
+        std::vector<std::string> {
+            "highp mat3 billboard_model = mat3(_transforms.model_matrix);",
+            "highp mat3 billboard_basis = transpose(mat3(_transforms.view_matrix));",
+            "highp vec3 billboard_scale = vec3(length(billboard_model[0]), length(billboard_model[1]), length(billboard_model[2]));",
+            "_geometry.normal = transpose(billboard_model) * (billboard_basis * (_geometry.normal / billboard_scale));",
+            "_geometry.tangent.xyz = transpose(billboard_model) * (billboard_basis * (_geometry.tangent.xyz / billboard_scale));",
+            "_transforms.model_matrix = mat4(vec4(billboard_basis[0] * billboard_scale.x, 0.0),",
+            "                                vec4(billboard_basis[1] * billboard_scale.y, 0.0),",
+            "                                vec4(billboard_basis[2] * billboard_scale.z, 0.0),",
+            "                                _transforms.model_matrix[3]);",
+        });
+    return sBillboardModifier;
+}
+
 VROQuaternion VROBillboardConstraint::computeAxisRotation(VROVector3f lookAt, VROVector3f defaultAxis,
                                                           VROVector3f objToCamProj) {
     
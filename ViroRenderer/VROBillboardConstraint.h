@@ -41,14 +41,43 @@ class VROBillboardConstraint : public VROConstraint {
 public:
     
     VROBillboardConstraint(VROBillboardAxis freeAxis) :
-        _freeAxis(freeAxis) {}
+        _freeAxis(freeAxis),
+        _shaderBillboarding(false) {}
     
     VROMatrix4f getTransform(const VRORenderContext &context,
                                      VROMatrix4f transform);
+    
+    /*
+     Billboard in the vertex shader instead of on the CPU. This is only supported for
+     VROBillboardAxis::All, and must be set before the constraint is added to a node.
+     Nodes with children are still billboarded on the CPU, since their children
+     inherit the rotation.
+     
+     The shader faces the geometry to the view plane, using the camera's right and up
+     vectors, rather than rotating it toward the camera's position. The node's world
+     transform stays unrotated, so hit tests use the unrotated geometry. Note the
+     modifier is installed on the geometry's materials, so every node sharing those
+     materials is billboarded.
+     */
+    void setShaderBillboarding(bool enabled) {
+        _shaderBillboarding = enabled;
+    }
+    bool isShaderBillboarding() const {
+        return _shaderBillboarding && _freeAxis == VROBillboardAxis::All;
+    }
+    std::shared_ptr<VROShaderModifier> getShaderModifier();
+    
+    /*
+     The geometry modifier that billboards to the view plane. It replaces the model
+     matrix's rotation, keeping its scale and translation, and counter-rotates the
+     normals and tangents so that lighting follows the billboarded geometry.
+     */
+    static std::shared_ptr<VROShaderModifier> getBillboardShaderModifier();
 
 private:
     
     VROBillboardAxis _freeAxis;
+    bool _shaderBillboarding;
     
     VROQuaternion computeAxisRotation(VROVector3f lookAt, VROVector3f defaultAxis,
                                       VROVector3f objToCamProj);
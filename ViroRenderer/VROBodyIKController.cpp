@@ -36,6 +36,7 @@
 #include "VROBillboardConstraint.h"
 #include "VROTime.h"
 #include "VROARFrame.h"
+#include "VROPlatformUtil.h"
 
 #if VRO_PLATFORM_IOS
 #include "VRODriverOpenGLiOS.h"
@@ -88,6 +89,8 @@ static const bool kAutomaticResizing = true;
 static const VROVector3f kInitialModelPos = VROVector3f(-10, -10, 10);
 static const bool kUseTorsoClusteredDepth = false;
 static const float kUsePresetDepthDistanceMeter = 1;
+static const double kTorsoDepthMaxAgeMs = 500;
+static const int kTorsoDepthMinPoints = 6;
 
 // Required joints needed for basic controller functionality (Scale / Root motion alignment)
 static const VROBodyJointType kRequiredJoints[] = { VROBodyJointType::Neck,
@@ -136,6 +139,9 @@ VROBodyIKController::VROBodyIKController(std::shared_ptr<VRORenderer> renderer,
     _displayDebugCubes = true;
     _shouldCalibrateRigWithResults = false;
     _hasValidProjectedPlane = false;
+    _torsoDepthPending = false;
+    _hasTorsoDepth = false;
+    _torsoDepthTimeMs = 0;
 #if VRO_PLATFORM_IOS
     _view = (VROViewAR *) std::dynamic_pointer_cast<VRODriverOpenGLiOS>(driver)->getView();
 #endif
@@ -622,7 +628,7 @@ void VROBodyIKController::onBodyJointsFound(const VROPoseFrame &inferredJoints)
     for (int i = 0; i < kNumBodyJoints; i++) {
         auto &kv = inferredJoints[i];
         if (!kv.empty()) {
-            VROInferredBodyJoint inferred = kv[0];
+            const VROInferredBodyJoint &inferred = kv[0];
             
             VROBodyJoint joint = { inferred.getType(), inferred.getConfidence() };
             joint.setScreenCoords({ inferred.getBounds().getX(), inferred.getBounds().getY(), 0 });
@@ -744,13 +750,7 @@ std::string VROBodyIKController::stopRecording() {
     return (_animDataRecorder->toJSON());
 }
 
-void VROBodyIKController::processJoints(const std::map<VROBodyJointType, VROBodyJoint> &joints) {
-    // Grab all the 2D joints of high confidence for the targets we want.
-    std::map<VROBodyJointType, VROBodyJoint> latestJoints;
-    for (auto &kv : joints) {
-        latestJoints[kv.first] = kv.second;
-    }
-
+void VROBodyIKController::processJoints(std::map<VROBodyJointType, VROBodyJoint> &latestJoints) {
     // First, convert the joints into 3d space.
     projectJointsInto3DSpace(latestJoints);
 
@@ -895,10 +895,8 @@ void VROBodyIKController::findDampenedTorsoClusteredDepth(std::map<VROBodyJointT
 }
 
 void VROBodyIKController::updateCachedJoints(std::map<VROBodyJointType, VROBodyJoint> &latestJoints) {
-    _cachedTrackedJoints.clear();
-    for (auto &latestjointPair : latestJoints) {
-        _cachedTrackedJoints[latestjointPair.first] = latestjointPair.second;
-    }
+    // Assignment reuses the nodes of the previous cache
+    _cachedTrackedJoints = latestJoints;
 }
 
 void VROBodyIKController::restoreMissingJoints(std::vector<VROBodyJoint> expiredJoints) {
@@ -1084,6 +1082,35 @@ void VROBodyIKController::updateModel() {
     }
 }
 
+/*
+ Return the feature points in front of the camera that project into the given
+ normalized screen rectangle. Runs on a worker thread, so it only operates on
+ copies of the frame's data.
+ */
+static std::vector<VROVector3f> VROFindPointsInScreenRect(const std::vector<VROVector4f> &points,
+                                                          const VROMatrix4f &viewProjection, const int *viewport,
+                                                          VROVector3f cameraPos, VROVector3f cameraForward,
+                                                          float minX, float maxX, float minY, float maxY) {
+    std::vector<VROVector3f> rectPoints;
+    for (const VROVector4f &point : points) {
+        VROVector3f world(point.x, point.y, point.z);
+        if ((world - cameraPos).dot(cameraForward) <= 0) {
+            continue;
+        }
+
+        VROVector3f screen;
+        if (!VROProjector::project(world, viewProjection.getArray(), viewport, &screen)) {
+            continue;
+        }
+        float x = screen.x / viewport[2];
+        float y = screen.y / viewport[3];
+        if (x >= minX && x <= maxX && y >= minY && y <= maxY) {
+            rectPoints.push_back(world);
+        }
+    }
+    return rectPoints;
+}
+
 bool VROBodyIKController::findTorsoClusteredDepth(std::map<VROBodyJointType, VROBodyJoint> &latestJoints, VROMatrix4f &matOut) {
     std::shared_ptr<VROARSession> arSession;
     
@@ -1094,10 +1121,6 @@ bool VROBodyIKController::findTorsoClusteredDepth(std::map<VROBodyJointType, VRO
         return false;
     }
     
-    std::unique_ptr<VROARFrame> &lastFrame = arSession->getLastFrame();
-    std::vector<VROVector4f> pointCloudPoints = lastFrame->getPointCloud()->getPoints();
-    
-    
     // get the "box" around the user's torso based on a diagonal pair of hip & shoulders
     float maxX;
     float minX;
@@ -1124,27 +1147,56 @@ bool VROBodyIKController::findTorsoClusteredDepth(std::map<VROBodyJointType, VRO
         return false;
     }
 
-    float torsoWidth = maxX - minX;
-    float torsoHeight = maxY - minY;
-    
-    std::vector<VROVector3f> hitTestResults;
-    
-    for (int i = 0; i < 10; i++) {
-        VROMatrix4f estimate;
-        if (performDepthTest(minX + (torsoWidth * ((float) rand()) / RAND_MAX), minY + (torsoHeight * ((float) rand()) / RAND_MAX), estimate)) {
-            hitTestResults.push_back(estimate.extractTranslation());
+    /*
+     Instead of a series of synchronous AR hit tests, the feature points of the
+     frame are handed to a worker thread, which finds those that fall within the
+     torso. The result is applied when the next set of joints arrives.
+     */
+    if (!_torsoDepthPending) {
+        std::unique_ptr<VROARFrame> &lastFrame = arSession->getLastFrame();
+        if (lastFrame) {
+            const VROCamera &camera = _renderer->getCamera();
+            std::vector<VROVector4f> points = lastFrame->getPointCloud()->getPoints();
+            VROMatrix4f viewProjection = camera.getProjection().multiply(camera.getLookAtMatrix());
+            std::vector<int> viewport = { 0, 0, camera.getViewport().getWidth(), camera.getViewport().getHeight() };
+            VROVector3f cameraPos = camera.getPosition();
+            VROVector3f cameraForward = camera.getForward();
+            double requestTimeMs = VROTimeCurrentMillis();
+
+            _torsoDepthPending = true;
+            std::weak_ptr<VROBodyIKController> controller_w = shared_from_this();
+            VROPlatformDispatchAsyncWorker([controller_w, points, viewProjection, viewport, cameraPos, cameraForward,
+                                            minX, maxX, minY, maxY, requestTimeMs] {
+                std::vector<VROVector3f> torsoPoints = VROFindPointsInScreenRect(points, viewProjection, viewport.data(),
+                                                                                 cameraPos, cameraForward,
+                                                                                 minX, maxX, minY, maxY);
+                bool found = torsoPoints.size() >= kTorsoDepthMinPoints;
+                VROVector3f depth = found ? findClusterInPoints(torsoPoints, cameraPos) : VROVector3f();
+
+                VROPlatformDispatchAsyncRenderer([controller_w, found, depth, requestTimeMs] {
+                    std::shared_ptr<VROBodyIKController> controller = controller_w.lock();
+                    if (!controller) {
+                        return;
+                    }
+                    controller->_torsoDepthPending = false;
+                    if (found) {
+                        controller->_hasTorsoDepth = true;
+                        controller->_torsoDepth = depth;
+                        controller->_torsoDepthTimeMs = requestTimeMs;
+                    }
+                });
+            });
         }
     }
-    
-    if (hitTestResults.size() <= 5) {
+
+    if (!_hasTorsoDepth || VROTimeCurrentMillis() - _torsoDepthTimeMs > kTorsoDepthMaxAgeMs) {
         return false;
     }
-    
-    matOut.translate(findClusterInPoints(hitTestResults));
+    matOut.translate(_torsoDepth);
     return true;
 }
 
-VROVector3f VROBodyIKController::findClusterInPoints(std::vector<VROVector3f> points) {
+VROVector3f VROBodyIKController::findClusterInPoints(std::vector<VROVector3f> points, VROVector3f cameraPos) {
     /*
      The algorithm we use here isn't difficult... we just grab the median value and ignore
      all points that are more than .3 meters from it. This is because we're getting values like:
@@ -1153,28 +1205,25 @@ VROVector3f VROBodyIKController::findClusterInPoints(std::vector<VROVector3f> po
      
      So by sorting all the values and grabbing the median value, we "throw" away all the artifacts at the edges
      */
-    VROVector3f cameraPos = _renderer->getCamera().getPosition();
-
     std::vector<float> distances;
     for (int i = 0; i < points.size(); i++) {
         distances.push_back(cameraPos.distance(points[i]));
     }
     
-    std::sort(distances.begin(), distances.end());
-    float midpoint = distances[distances.size() / 2];
+    std::vector<float> sorted = distances;
+    std::sort(sorted.begin(), sorted.end());
+    float midpoint = sorted[sorted.size() / 2];
     
     VROVector3f totalPosition = {0,0,0};
-    for (int i = 0; i < distances.size();) {
-        if (abs(midpoint - distances[i]) > .3) {
-            distances.erase(distances.begin() + i);
-            points.erase(points.begin() + i);
-        } else {
+    int count = 0;
+    for (int i = 0; i < distances.size(); i++) {
+        if (fabs(midpoint - distances[i]) <= .3) {
             totalPosition += points[i];
-            i++;
+            count++;
         }
     }
     
-    totalPosition /= distances.size();
+    totalPosition /= count;
     return totalPosition;
 }
 
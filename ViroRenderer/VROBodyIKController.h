@@ -209,6 +209,17 @@ private:
     VROVector3f _projectedPlaneNormal;
     bool _hasValidProjectedPlane;
 
+    /*
+     The latest torso depth estimated by findTorsoClusteredDepth, and the time
+     it was requested. Estimates are computed on a worker thread and arrive
+     about a frame after they are requested; the pending flag ensures at most
+     one is in flight.
+     */
+    bool _torsoDepthPending;
+    bool _hasTorsoDepth;
+    VROVector3f _torsoDepth;
+    double _torsoDepthTimeMs;
+
     /*
      The rig, skeleton and node associated with the currently bound model.
      */
@@ -298,9 +309,11 @@ private:
 
     /*
      Process, filter and update this controller's latest known set of _cachedTrackedJoints
-     with the latest found ML 2D points given by VROBodyTracker.
+     with the latest found ML 2D points given by VROBodyTracker. The joints are projected
+     in place: on return they hold their 3D transforms, and joints that failed projection
+     are removed.
      */
-    void processJoints(const std::map<VROBodyJointType, VROBodyJoint> &joints);
+    void processJoints(std::map<VROBodyJointType, VROBodyJoint> &joints);
     void projectJointsInto3DSpace(std::map<VROBodyJointType, VROBodyJoint> &joints);
     void updateCachedJoints(std::map<VROBodyJointType, VROBodyJoint> &joints);
     void restoreMissingJoints(std::vector<VROBodyJoint> expiredJoints);
@@ -326,7 +339,7 @@ private:
      */
     bool findTorsoClusteredDepth(std::map<VROBodyJointType, VROBodyJoint> &latestJoints,
                                  VROMatrix4f &matOut);
-    VROVector3f findClusterInPoints(std::vector<VROVector3f> points);
+    static VROVector3f findClusterInPoints(std::vector<VROVector3f> points, VROVector3f cameraPos);
     bool performDepthTest(float x, float y, VROMatrix4f &matOut);
     bool performWindowDepthTest(float x, float y, VROMatrix4f &matOut);
     bool performUnprojectionToPlane(float x, float y, VROMatrix4f &matOut);
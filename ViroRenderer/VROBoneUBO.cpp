@@ -29,81 +29,109 @@
 #include "VROLog.h"
 #include "VROMath.h"
 #include "VROSkinner.h"
+#include "VROGeometry.h"
 #include "VROSkeleton.h"
 #include "VROShaderProgram.h"
 #include "VROShaderModifier.h"
 #include "VRODriverOpenGL.h"
 #include "VRODualQuaternion.h"
+#include "VROBakedSkeletalAnimation.h"
 
 static thread_local std::shared_ptr<VROShaderModifier> sSkinningShaderModifier;
-static thread_local std::shared_ptr<VROShaderModifier> sSkinningShaderModifierWithScale;
+static thread_local std::shared_ptr<VROShaderModifier> sBakedSkinningShaderModifier;
 
-std::shared_ptr<VROShaderModifier> VROBoneUBO::createSkinningShaderModifier(bool hasScale) {
-    if (kDualQuaternionEnabled) {
+// Values of the skinning_mode uniform in the skinning modifier
+static const int kSkinningModeCached = 0;
+static const int kSkinningModeMatrix = 1;
+static const int kSkinningModeDualQuaternion = 2;
+
+// Bones scaled by more than this fall back from dual-quaternion to matrix skinning
+static const float kDualQuaternionScaleTolerance = 0.001;
+
+std::shared_ptr<VROShaderModifier> VROBoneUBO::createSkinningShaderModifier() {
+    if (!sSkinningShaderModifier) {
         /*
-         Modifier that performs skeletal animation in the vertex shader. Uses dual-quaternion
-         skinning, with functions provided in skinning_vsh.glsl. We have an optimized path if
-         there are no scale transforms.
+         Modifier that performs skeletal animation in the vertex shader, using either
+         matrix or dual-quaternion skinning (with functions provided in skinning_vsh.glsl),
+         depending on the layout the skinner's bones were written in. When the geometry's
+         skinning is cached, its position attribute already holds the skinned positions
+         (see VROSkinningCache), so skinning is skipped.
          */
-        if (hasScale) {
-            if (!sSkinningShaderModifierWithScale) {
-                std::vector<std::string> modifierCode =  {
-                    "#include skinning_vsh",
-                    "vec4 blended_s = get_blended_scale(_geometry.bone_indices, _geometry.bone_weights);",
-                    "_geometry.position = _geometry.position * blended_s.xyz;",
-                    "_geometry.normal = _geometry.normal / blended_s.xyz;", // Equivalent to multiplying by inverse-transpose of scale matrix
-                    
-                    "mat2x4 blended_dq = get_blended_dual_quaternion(_geometry.bone_indices, _geometry.bone_weights);",
-                    "_geometry.position = dual_quat_transform_point(_geometry.position.xyz, blended_dq[0], blended_dq[1]);",
-                    "_geometry.normal = quat_rotate_vector(_geometry.normal.xyz, blended_dq[0]);"
-                };
-                sSkinningShaderModifierWithScale = std::make_shared<VROShaderModifier>(VROShaderEntryPoint::Geometry,
-                                                                                       modifierCode);
-                sSkinningShaderModifierWithScale->setName("skindqs");
-                sSkinningShaderModifierWithScale->setAttributes((int) VROShaderMask::BoneIndex | (int) VROShaderMask::BoneWeight);
-            }
-            
-            return sSkinningShaderModifierWithScale;
-        }
-        else {
-            if (!sSkinningShaderModifier) {
-                std::vector<std::string> modifierCode =  {
-                    "#include skinning_vsh",
-                    "mat2x4 blended_dq = get_blended_dual_quaternion(_geometry.bone_indices, _geometry.bone_weights);",
-                    "_geometry.position = dual_quat_transform_point(_geometry.position.xyz, blended_dq[0], blended_dq[1]);",
-                    "_geometry.normal = quat_rotate_vector(_geometry.normal.xyz, blended_dq[0]);"
-                };
-                sSkinningShaderModifier = std::make_shared<VROShaderModifier>(VROShaderEntryPoint::Geometry,
-                                                                              modifierCode);
-                sSkinningShaderModifier->setName("skindq");
-                sSkinningShaderModifier->setAttributes((int) VROShaderMask::BoneIndex | (int) VROShaderMask::BoneWeight);
-            }
-            
-            return sSkinningShaderModifier;
-        }
-    }
-    else {
-        if (!sSkinningShaderModifier) {
-            std::vector<std::string> modifierCode =  {
-                    "#include skinning_vsh",
-                    "vec4 pos_h = vec4(_geometry.position, 1.0);",
-                    "vec4 pos_blended = (bone_matrices[_geometry.bone_indices.x] * pos_h) * _geometry.bone_weights.x + "
+        std::vector<std::string> modifierCode =  {
+                "#include skinning_vsh",
+                "uniform int skinning_mode;",
+                "if (skinning_mode == 1) {",
+                "    vec4 pos_h = vec4(_geometry.position, 1.0);",
+                "    vec4 pos_blended = (bone_matrices[_geometry.bone_indices.x] * pos_h) * _geometry.bone_weights.x + "
                                        "(bone_matrices[_geometry.bone_indices.y] * pos_h) * _geometry.bone_weights.y + "
                                        "(bone_matrices[_geometry.bone_indices.z] * pos_h) * _geometry.bone_weights.z + "
                                        "(bone_matrices[_geometry.bone_indices.w] * pos_h) * _geometry.bone_weights.w;",
-                    "_geometry.position = pos_blended.xyz;"
-            };
-            sSkinningShaderModifier = std::make_shared<VROShaderModifier>(VROShaderEntryPoint::Geometry,
-                                                                          modifierCode);
-            sSkinningShaderModifier->setName("skin");
-            sSkinningShaderModifier->setAttributes((int) VROShaderMask::BoneIndex | (int) VROShaderMask::BoneWeight);
-        }
-        
-        return sSkinningShaderModifier;
+                "    _geometry.position = pos_blended.xyz;",
+                "} else if (skinning_mode == 2) {",
+                "    mat2x4 blended_dq = get_blended_dual_quaternion(_geometry.bone_indices, _geometry.bone_weights);",
+                "    _geometry.position = dual_quat_transform_point(_geometry.position.xyz, blended_dq[0], blended_dq[1]);",
+                "    _geometry.normal = quat_rotate_vector(_geometry.normal.xyz, blended_dq[0]);",
+                "}"
+        };
+        sSkinningShaderModifier = std::make_shared<VROShaderModifier>(VROShaderEntryPoint::Geometry,
+                                                                      modifierCode);
+        sSkinningShaderModifier->setUniformBinder("skinning_mode", VROShaderProperty::Int,
+                                                  [](VROUniform *uniform,
+                                                     const VROGeometry *geometry, const VROMaterial *material) {
+            int mode = kSkinningModeMatrix;
+            if (geometry != nullptr && geometry->getSkinner()) {
+                const std::shared_ptr<VROSkinner> &skinner = geometry->getSkinner();
+                if (skinner->isSkinningCacheValid()) {
+                    mode = kSkinningModeCached;
+                }
+                else if (skinner->getActiveSkinningMode() == VROSkinningMode::DualQuaternion) {
+                    mode = kSkinningModeDualQuaternion;
+                }
+            }
+            uniform->setInt(mode);
+        });
+        sSkinningShaderModifier->setName("skin");
+        sSkinningShaderModifier->setAttributes((int) VROShaderMask::BoneIndex | (int) VROShaderMask::BoneWeight);
+    }
+    return sSkinningShaderModifier;
+}
+
+std::shared_ptr<VROShaderModifier> VROBoneUBO::createBakedSkinningShaderModifier() {
+    if (!sBakedSkinningShaderModifier) {
+        /*
+         Blends the baked transforms of each vertex's bones at the instance's frame
+         (with functions provided in baked_skinning_vsh.glsl). The instance data is
+         declared by the instance modifier, which follows this one.
+         */
+        std::vector<std::string> modifierCode =  {
+                "uniform highp sampler2D baked_bone_texture;",
+                "#include baked_skinning_vsh",
+                "highp mat3x4 baked_rows = get_baked_blended_bone_rows(_geometry.bone_indices, _geometry.bone_weights, "
+                                                                       "instanced_normal_matrix[v_instance_id][3][2]);",
+                "_geometry.position = vec4(_geometry.position, 1.0) * baked_rows;",
+                "_geometry.normal = vec4(_geometry.normal, 0.0) * baked_rows;",
+                "_geometry.tangent.xyz = vec4(_geometry.tangent.xyz, 0.0) * baked_rows;",
+        };
+        sBakedSkinningShaderModifier = std::make_shared<VROShaderModifier>(VROShaderEntryPoint::Geometry,
+                                                                           modifierCode);
+        sBakedSkinningShaderModifier->setUniformBinder("baked_bone_texture", VROShaderProperty::Int,
+                                                       [](VROUniform *uniform,
+                                                          const VROGeometry *geometry, const VROMaterial *material) {
+            uniform->setInt(kBakedAnimationTextureUnit);
+        });
+        sBakedSkinningShaderModifier->setName("skin_baked");
+        sBakedSkinningShaderModifier->setAttributes((int) VROShaderMask::BoneIndex | (int) VROShaderMask::BoneWeight);
     }
+    return sBakedSkinningShaderModifier;
+}
+
+int VROBoneUBO::getMaxBones(VROSkinningMode mode) {
+    return mode == VROSkinningMode::DualQuaternion ? kMaxBonesDualQuaternion : kMaxBones;
 }
 
 VROBoneUBO::VROBoneUBO(std::shared_ptr<VRODriverOpenGL> driver) :
+    _bakedAnimationTexture(0),
+    _bakedAnimationId(-1),
     _driver(driver) {
     
     GL( glGenBuffers(1, &_bonesUBO) );
@@ -124,6 +152,9 @@ VROBoneUBO::~VROBoneUBO() {
     std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
     if (driver) {
         driver->deleteBuffer(_bonesUBO);
+        if (_bakedAnimationTexture != 0) {
+            driver->deleteTexture(_bakedAnimationTexture);
+        }
     }
 }
 
@@ -133,44 +164,66 @@ void VROBoneUBO::bind() {
 
 void VROBoneUBO::update(const std::shared_ptr<VROSkinner> &skinner) {
     pglpush("Bones");
+    int numBones = skinner->getNumPaletteBones();
     
-    VROBonesData data;
-    int numBones = skinner->getSkeleton()->getNumBones();
+    std::vector<VROMatrix4f> transforms;
+    transforms.reserve(numBones);
     for (int i = 0; i < numBones; i++) {
-        if (i >= kMaxBones) {
-            break;
+        transforms.push_back(skinner->getModelTransform(skinner->getPaletteBone(i)));
+    }
+    
+    /*
+     Dual quaternions cannot represent scale, so if any bone is currently scaled
+     we fall back to matrices.
+     */
+    VROSkinningMode mode = skinner->getSkinningMode();
+    if (mode == VROSkinningMode::DualQuaternion) {
+        for (const VROMatrix4f &transform : transforms) {
+            VROVector3f scale = transform.extractScale();
+            if (fabs(scale.x - 1) > kDualQuaternionScaleTolerance ||
+                fabs(scale.y - 1) > kDualQuaternionScaleTolerance ||
+                fabs(scale.z - 1) > kDualQuaternionScaleTolerance) {
+                mode = VROSkinningMode::Matrix;
+                break;
+            }
         }
-        
-        VROMatrix4f transform = skinner->getModelTransform(i);
-        if (kDualQuaternionEnabled) {
-            VROVector3f   translation = transform.extractTranslation();
-            VROVector3f   scale = transform.extractScale();
-            VROQuaternion rotation = transform.extractRotation(scale);
+    }
+    skinner->setActiveSkinningMode(mode);
+    
+    VROBonesData data;
+    int floatsPerBone = 0;
+    numBones = std::min(numBones, getMaxBones(mode));
+    
+    if (mode == VROSkinningMode::DualQuaternion) {
+        floatsPerBone = kFloatsPerBoneDualQuaternion;
+        for (int i = 0; i < numBones; i++) {
+            const VROMatrix4f &transform = transforms[i];
+            VROVector3f translation = transform.extractTranslation();
+            VROQuaternion rotation = transform.extractRotation(VROVector3f(1, 1, 1));
             
             /*
-             Convert the rotation and translation to a dual quaternion. The scale
-             is included separately. Load all into the UBO.
+             Convert the rotation and translation to a dual quaternion, and load
+             the real and dual parts into the UBO.
              */
             VRODualQuaternion dq(translation, rotation);
             VROQuaternion real = dq.getReal();
             VROQuaternion dual = dq.getDual();
             
-            int floatsPerBone = kFloatsPerBone;
-            data.bone_transforms[i * floatsPerBone + 0] = real.X;
-            data.bone_transforms[i * floatsPerBone + 1] = real.Y;
-            data.bone_transforms[i * floatsPerBone + 2] = real.Z;
-            data.bone_transforms[i * floatsPerBone + 3] = real.W;
-            data.bone_transforms[i * floatsPerBone + 4] = dual.X;
-            data.bone_transforms[i * floatsPerBone + 5] = dual.Y;
-            data.bone_transforms[i * floatsPerBone + 6] = dual.Z;
-            data.bone_transforms[i * floatsPerBone + 7] = dual.W;
-            data.bone_transforms[i * floatsPerBone + 8] = scale.x;
-            data.bone_transforms[i * floatsPerBone + 9] = scale.y;
-            data.bone_transforms[i * floatsPerBone + 10] = scale.z;
-            data.bone_transforms[i * floatsPerBone + 11] = 1.0;
+            float *bone = &data.bone_transforms[i * floatsPerBone];
+            bone[0] = real.X;
+            bone[1] = real.Y;
+            bone[2] = real.Z;
+            bone[3] = real.W;
+            bone[4] = dual.X;
+            bone[5] = dual.Y;
+            bone[6] = dual.Z;
+            bone[7] = dual.W;
         }
-        else {
-            memcpy(&data.bone_transforms[i * kFloatsPerBone], transform.getArray(), kFloatsPerBone * sizeof(float));
+    }
+    else {
+        floatsPerBone = kFloatsPerBone;
+        for (int i = 0; i < numBones; i++) {
+            memcpy(&data.bone_transforms[i * floatsPerBone], transforms[i].getArray(), floatsPerBone * sizeof(float));
         }
     }
     
@@ -178,8 +231,37 @@ void VROBoneUBO::update(const std::shared_ptr<VROSkinner> &skinner) {
 #if VRO_AVOID_BUFFER_SUB_DATA
     GL( glBufferData(GL_UNIFORM_BUFFER, sizeof(VROBonesData), &data, GL_DYNAMIC_DRAW) );
 #else
-    GL( glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(VROBonesData), &data) );
+    // Only upload the bones in use; the remainder are never indexed
+    if (numBones > 0) {
+        GL( glBufferSubData(GL_UNIFORM_BUFFER, 0, numBones * floatsPerBone * sizeof(float), &data) );
+    }
 #endif
     
     pglpop();
 }
+
+void VROBoneUBO::bindBakedAnimation(const VROBakedSkeletalAnimation &animation) {
+    std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
+    if (!driver) {
+        return;
+    }
+    if (_bakedAnimationTexture == 0) {
+        GL( glGenTextures(1, &_bakedAnimationTexture) );
+    }
+    driver->bindTexture(GL_TEXTURE0 + kBakedAnimationTextureUnit, GL_TEXTURE_2D, _bakedAnimationTexture);
+    if (_bakedAnimationId == animation.getId()) {
+        return;
+    }
+    
+    // Float textures can't be filtered; the shader fetches texels and interpolates
+    // between frames itself
+    pglpush("Baked Animation");
+    GL( glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST) );
+    GL( glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST) );
+    GL( glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE) );
+    GL( glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE) );
+    GL( glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, animation.getNumBones() * kBakedAnimationTexelsPerBone,
+                     animation.getNumFrames() + 1, 0, GL_RGBA, GL_FLOAT, animation.getData().data()) );
+    _bakedAnimationId = animation.getId();
+    pglpop();
+}
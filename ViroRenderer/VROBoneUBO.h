@@ -32,17 +32,21 @@
 #include <memory>
 #include "VRODefines.h"
 
-// True to use dual-quaternion skinning, which has more realistic movement and uses less memory
-// TODO VIRO-1472: DQS skinning is malforming meshes during animation
-static const bool kDualQuaternionEnabled = false;
+// Keep in sync with ViroFBX::VROFBXExporter.h and skinning_vsh.glsl. Matrix skinning
+// uses a 4x4 matrix per bone. Dual-quaternion skinning uses a real and a dual quaternion
+// per bone, fitting twice as many bones into the same UBO.
+static const int kMaxBones = 192;
+static const int kFloatsPerBone = 16;
+static const int kMaxBonesDualQuaternion = 384;
+static const int kFloatsPerBoneDualQuaternion = 8;
 
-// Keep in sync with ViroFBX::VROFBXExporter.h and skinning_vsh.glsl
-static const int kMaxBones = kDualQuaternionEnabled ? 192 : 192;
+// Texture unit of the bone-animation texture of baked animations. Material textures are
+// bound from unit 0 up, and GLES 3.0 guarantees 16 units to vertex shaders, so the last of
+// those is reserved for baked animations.
+static const int kBakedAnimationTextureUnit = 15;
 
-// 8 floats for dual quaternions, 4 for scale
-static const int kFloatsPerBone = kDualQuaternionEnabled ? 12 : 16;
-
-// Grouped in 4N slots, matching skinning_vsh.glsl
+// Grouped in 4N slots, matching skinning_vsh.glsl. Holds either kMaxBones matrices
+// or kMaxBonesDualQuaternion dual quaternions.
 typedef struct {
     float bone_transforms[kMaxBones * kFloatsPerBone];
 } VROBonesData;
@@ -51,6 +55,8 @@ class VROShaderProgram;
 class VRODriverOpenGL;
 class VROSkinner;
 class VROShaderModifier;
+class VROBakedSkeletalAnimation;
+enum class VROSkinningMode;
 
 /*
  Bones transformation matrices are written into UBOs. This way we 
@@ -68,7 +74,26 @@ class VROBoneUBO {
     
 public:
     
-    static std::shared_ptr<VROShaderModifier> createSkinningShaderModifier(bool hasScaling);
+    /*
+     Get the modifier that skins geometries in the vertex shader. The modifier
+     reads the active skinning mode of each geometry's skinner, and skips
+     skinning entirely for geometries whose skinning is cached.
+     */
+    static std::shared_ptr<VROShaderModifier> createSkinningShaderModifier();
+    
+    /*
+     Get the modifier that replaces the skinning modifier in instanced shaders.
+     It skins each instance with the skinner's baked animation, sampling the
+     bone-animation texture at the frame encoded in the instance's normal matrix
+     (see VROInstancedTransformUBO::encodeBakedAnimationFrame).
+     */
+    static std::shared_ptr<VROShaderModifier> createBakedSkinningShaderModifier();
+    
+    /*
+     The maximum number of bones a skinner may have in the given mode. Geometries
+     with more bones must be split (see VROGeometryUtilSplitByBoneLimit).
+     */
+    static int getMaxBones(VROSkinningMode mode);
 
     VROBoneUBO(std::shared_ptr<VRODriverOpenGL> driver);
     virtual ~VROBoneUBO();
@@ -80,10 +105,18 @@ public:
     
     /*
      Update the data in this UBO with the latest transformation 
-     matrices in the provided skinner.
+     matrices in the provided skinner, in the layout of the skinner's
+     skinning mode. Only the skinner's bones are uploaded.
      */
     void update(const std::shared_ptr<VROSkinner> &skinner);
     
+    /*
+     Bind the bone-animation texture of the given baked animation to
+     kBakedAnimationTextureUnit, uploading it first if this UBO last bound a
+     different animation.
+     */
+    void bindBakedAnimation(const VROBakedSkeletalAnimation &animation);
+    
 private:
     
     /*
@@ -91,6 +124,12 @@ private:
      */
     GLuint _bonesUBO;
     
+    /*
+     The bone-animation texture, and the ID of the baked animation it holds.
+     */
+    GLuint _bakedAnimationTexture;
+    int _bakedAnimationId;
+    
     /*
      The driver that created this UBO.
      */
@@ -27,6 +27,7 @@
 #include <algorithm>
 
 #include "VROByteBuffer.h"
+#include "VROData.h"
 #include "VROLog.h"
 #include <sys/mman.h>
 #include <sys/types.h>
@@ -83,6 +84,14 @@ VROByteBuffer::VROByteBuffer(const std::string &byteString) :
     _freeOnDealloc(false) {
 }
 
+VROByteBuffer::VROByteBuffer(std::shared_ptr<VROData> data) :
+    _pos(0),
+    _capacity(data->getDataLength()),
+    _buffer((char *) data->getData()),
+    _freeOnDealloc(false),
+    _source(data) {
+}
+
 VROByteBuffer::VROByteBuffer(VROByteBuffer *toCopy) :
     _pos(0),
     _capacity(toCopy->_capacity),
@@ -96,7 +105,8 @@ VROByteBuffer::VROByteBuffer(VROByteBuffer&& moveFrom) :
     _pos(0),
     _capacity(moveFrom._capacity),
     _buffer(moveFrom._buffer),
-    _freeOnDealloc(moveFrom._freeOnDealloc) {
+    _freeOnDealloc(moveFrom._freeOnDealloc),
+    _source(std::move(moveFrom._source)) {
 
     moveFrom._capacity = 0;
     moveFrom._buffer = nullptr;
@@ -109,6 +119,7 @@ VROByteBuffer::operator=(VROByteBuffer&& moveFrom) {
     _capacity = moveFrom._capacity;
     _buffer = moveFrom._buffer;
     _freeOnDealloc = moveFrom._freeOnDealloc;
+    _source = std::move(moveFrom._source);
 
     moveFrom._buffer = nullptr;
     moveFrom._capacity = 0;
@@ -456,6 +467,28 @@ signed char *VROByteBuffer::readNumChars(int numChars) {
     return dest;
 }
 
+std::shared_ptr<VROData> VROByteBuffer::readData(int length) {
+    passert(length >= 0);
+#if k_bufferDebugOverruns
+    if (_pos + length > _capacity) {
+        perr("Overrun! readData newPos=%zu > _capacity=%zu", _pos + length, _capacity);
+#if k_bufferAbortOverruns
+        pabort();
+#endif
+        return nullptr;
+    }
+#endif
+
+    std::shared_ptr<VROData> data;
+    if (_source) {
+        data = std::make_shared<VROData>(_source, (int) _pos, length);
+    } else {
+        data = std::make_shared<VROData>((const void *) (_buffer + _pos), length);
+    }
+    _pos += length;
+    return data;
+}
+
 short* VROByteBuffer::readNumShorts(int numShorts) {
     passert(numShorts >= 0);
     short *dest = (short*) (_buffer + _pos);
@@ -34,6 +34,9 @@
 #include <string.h>
 #include <math.h>
 #include <string>
+#include <memory>
+
+class VROData;
 
 class VROByteBuffer final {
 public:
@@ -67,6 +70,13 @@ public:
      */
     VROByteBuffer(const std::string &byteString);
 
+    /*
+     Read constructor that wraps the given data without copying it, retaining it
+     for the lifetime of this buffer. Data read with readData() is then sliced
+     from it rather than copied.
+     */
+    VROByteBuffer(std::shared_ptr<VROData> data);
+
     /*
      Copy semantics
      */
@@ -152,6 +162,13 @@ public:
     signed char *readNumChars(int numChars);
     short *readNumShorts(int numShorts);
 
+    /*
+     Read the given number of bytes into a VROData. If this buffer wraps a
+     VROData the result is a slice of it, sharing its bytes; otherwise the bytes
+     are copied.
+     */
+    std::shared_ptr<VROData> readData(int length);
+
     /*
      Grow the byte-buffer to fit the given number of additional bytes PAST the
      current position of the buffer. If the buffer has space remaining, do not
@@ -251,6 +268,11 @@ private:
      True if the underlying bytes should be freed when this buffer is deallocated.
      */
     bool _freeOnDealloc;
+
+    /*
+     The data wrapped by this buffer, if constructed from a VROData.
+     */
+    std::shared_ptr<VROData> _source;
     
 };
 
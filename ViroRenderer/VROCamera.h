@@ -60,7 +60,7 @@ public:
     void setFOV(VROFieldOfView fov);
     void setProjection(VROMatrix4f projection);
     
-    VROVector3f getPosition() const {
+    const VROVector3f &getPosition() const {
         return _position;
     }
     VROVector3f getForward() const {
@@ -45,9 +45,12 @@
 #include "VROCharmapCoverage.h"
 #include <algorithm>
 #include <vector>
+#include <map>
+#include <mutex>
 using std::vector;
 
 #include "VROLog.h"
+#include "VROPlatformUtil.h"
 #include "VROFontUtil.h"
 #include "VROSparseBitSet.h"
 
@@ -564,3 +567,157 @@ VROSparseBitSet VROCharmapCoverage::getCoverage(const uint8_t* cmap_data, size_t
     }
     return coverage;
 }
+
+#pragma mark - Coverage Cache
+
+static const uint32_t kCoverageCacheMagic = 0x5652434d; // 'VRCM'
+static const uint32_t kCoverageCacheVersion = 1;
+
+// Variation selectors whose coverage is absent are stored with this count
+static const uint32_t kAbsentCoverage = UINT32_MAX;
+
+// Upper bound on the values stored for any one coverage, to reject corrupt files
+static const uint32_t kMaxCoverageValues = 2 * (MAX_UNICODE_CODE_POINT + 1);
+
+struct VROCoverageCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t numVariations;
+};
+
+/*
+ The ranges of a cmap's base and variation selector coverage.
+ */
+struct VROCoverageRanges {
+    std::vector<uint32_t> base;
+    std::vector<std::vector<uint32_t>> variations;
+    std::vector<bool> variationsPresent;
+};
+
+/*
+ Coverage of the cmaps loaded by this process, by key. There are few distinct
+ faces, and their ranges are small next to the faces themselves.
+ */
+static std::mutex sCoverageCacheMutex;
+static std::map<uint64_t, std::shared_ptr<VROCoverageRanges>> sCoverageCache;
+
+static std::string getCoverageCachePath(const std::string &directory, uint64_t key) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.cmap", (unsigned long long) key);
+    return directory + "/" + name;
+}
+
+static bool readRanges(FILE *file, std::vector<uint32_t> *outRanges, bool *outPresent) {
+    uint32_t count = 0;
+    if (fread(&count, sizeof(count), 1, file) != 1) {
+        return false;
+    }
+    *outPresent = (count != kAbsentCoverage);
+    if (!*outPresent) {
+        return true;
+    }
+    if (count > kMaxCoverageValues || count % 2 != 0) {
+        return false;
+    }
+    outRanges->resize(count);
+    if (count > 0 && fread(outRanges->data(), sizeof(uint32_t), count, file) != count) {
+        return false;
+    }
+    
+    // The bit-set requires nonempty ranges of code points in ascending order
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t value = (*outRanges)[i];
+        if (value > MAX_UNICODE_CODE_POINT + 1 || (i > 0 && value < (*outRanges)[i - 1] + (i % 2))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static std::shared_ptr<VROCoverageRanges> readCoverage(const std::string &directory, uint64_t key) {
+    FILE *file = fopen(getCoverageCachePath(directory, key).c_str(), "rb");
+    if (!file) {
+        return nullptr;
+    }
+    
+    std::shared_ptr<VROCoverageRanges> ranges = std::make_shared<VROCoverageRanges>();
+    VROCoverageCacheHeader header;
+    bool present;
+    bool success = fread(&header, sizeof(header), 1, file) == 1 &&
+                   header.magic == kCoverageCacheMagic && header.version == kCoverageCacheVersion &&
+                   header.key == key && header.numVariations <= MAX_UNICODE_CODE_POINT &&
+                   readRanges(file, &ranges->base, &present);
+    if (success) {
+        ranges->variations.resize(header.numVariations);
+        ranges->variationsPresent.resize(header.numVariations);
+    }
+    for (uint32_t v = 0; success && v < header.numVariations; v++) {
+        success = readRanges(file, &ranges->variations[v], &present);
+        ranges->variationsPresent[v] = present;
+    }
+    fclose(file);
+    return success ? ranges : nullptr;
+}
+
+static bool writeRanges(FILE *file, const std::vector<uint32_t> &ranges, bool present) {
+    uint32_t count = present ? (uint32_t) ranges.size() : kAbsentCoverage;
+    return fwrite(&count, sizeof(count), 1, file) == 1 &&
+           (!present || ranges.empty() || fwrite(ranges.data(), sizeof(uint32_t), ranges.size(), file) == ranges.size());
+}
+
+static void writeCoverage(const std::string &directory, uint64_t key, const VROCoverageRanges &ranges) {
+    VROPlatformWriteCacheFile(getCoverageCachePath(directory, key), [key, &ranges](FILE *file) {
+        VROCoverageCacheHeader header = { kCoverageCacheMagic, kCoverageCacheVersion, key,
+                                          (uint32_t) ranges.variations.size() };
+        bool success = fwrite(&header, sizeof(header), 1, file) == 1 && writeRanges(file, ranges.base, true);
+        for (size_t v = 0; v < ranges.variations.size(); v++) {
+            success = success && writeRanges(file, ranges.variations[v], ranges.variationsPresent[v]);
+        }
+        return success;
+    });
+}
+
+VROSparseBitSet VROCharmapCoverage::getCachedCoverage(const uint8_t *cmap_data, size_t cmap_size,
+                                                      const std::string &directory,
+                                                      std::vector<std::unique_ptr<VROSparseBitSet>> *out) {
+    uint64_t key = VROPlatformHashCacheKey(cmap_data, cmap_size);
+    std::shared_ptr<VROCoverageRanges> ranges;
+    {
+        std::lock_guard<std::mutex> lock(sCoverageCacheMutex);
+        auto it = sCoverageCache.find(key);
+        if (it != sCoverageCache.end()) {
+            ranges = it->second;
+        }
+    }
+    
+    if (!ranges) {
+        ranges = readCoverage(directory, key);
+        if (!ranges) {
+            // Parse the cmap, and store its coverage for later launches
+            std::vector<std::unique_ptr<VROSparseBitSet>> variations;
+            VROSparseBitSet coverage = getCoverage(cmap_data, cmap_size, &variations);
+            
+            ranges = std::make_shared<VROCoverageRanges>();
+            ranges->base = coverage.getRanges();
+            for (const std::unique_ptr<VROSparseBitSet> &variation : variations) {
+                ranges->variations.push_back(variation ? variation->getRanges() : std::vector<uint32_t>());
+                ranges->variationsPresent.push_back(variation != nullptr);
+            }
+            writeCoverage(directory, key, *ranges);
+        }
+        
+        std::lock_guard<std::mutex> lock(sCoverageCacheMutex);
+        sCoverageCache[key] = ranges;
+    }
+    
+    out->clear();
+    out->resize(ranges->variations.size());
+    for (size_t v = 0; v < ranges->variations.size(); v++) {
+        if (ranges->variationsPresent[v]) {
+            const std::vector<uint32_t> &variation = ranges->variations[v];
+            (*out)[v].reset(new VROSparseBitSet(variation.data(), variation.size() >> 1));
+        }
+    }
+    return VROSparseBitSet(ranges->base.data(), ranges->base.size() >> 1);
+}
@@ -29,6 +29,7 @@
 
 #include "VROSparseBitSet.h"
 #include <memory>
+#include <string>
 #include <vector>
 
 /*
@@ -47,6 +48,16 @@ public:
      */
     static VROSparseBitSet getCoverage(const uint8_t *cmap_data, size_t cmap_size,
                                        std::vector<std::unique_ptr<VROSparseBitSet>> *out);
+    
+    /*
+     As getCoverage, but reuses coverage parsed before from the same cmap data,
+     identified by its hash: first that of faces already loaded by this process,
+     which is kept for the life of the process, then that of earlier launches,
+     stored in the given directory. Newly parsed coverage is stored there.
+     */
+    static VROSparseBitSet getCachedCoverage(const uint8_t *cmap_data, size_t cmap_size,
+                                             const std::string &directory,
+                                             std::vector<std::unique_ptr<VROSparseBitSet>> *out);
 };
 
 #endif  // VROCharmapCoverage_h
@@ -36,21 +36,56 @@
 #include "VROEye.h"
 #include "VROToneMappingRenderPass.h"
 #include "VROGaussianBlurRenderPass.h"
+#include "VRODualFilterBloomRenderPass.h"
+#include "VROTemporalAntialiasingRenderPass.h"
+#include "VRORenderTargetPool.h"
+#include "VRORenderGraph.h"
+#include "VROStringUtil.h"
 #include "VROPostProcessEffectFactory.h"
 #include "VRORenderMetadata.h"
 #include "VRORenderToTextureDelegate.h"
 #include "VROPreprocess.h"
 #include "VROShadowPreprocess.h"
 #include "VROIBLPreprocess.h"
+#include "VROLightClusterGrid.h"
+#include "VROOcclusionCuller.h"
 #include "VRORenderer.h"
+#include "VROProfiler.h"
+#include "VRODynamicResolution.h"
+#include "VROImpostor.h"
+#include "VROGeometry.h"
+#include "VRONode.h"
 #include <vector>
+#include <algorithm>
+
+// The resources of the render graph
+static const std::string kRenderGraphDisplay = "Display";
+static const std::string kRenderGraphRTT = "RTT";
+static const std::string kRenderGraphHDR = "HDR";
+static const std::string kRenderGraphBloom = "Bloom";
+static const std::string kRenderGraphBloomComposite = "BloomComposite";
+static const std::string kRenderGraphPostProcessA = "PostProcessA";
+static const std::string kRenderGraphPostProcessB = "PostProcessB";
+static const std::string kRenderGraphPostProcessed = "PostProcessed";
+static const std::string kRenderGraphCustom = "Custom";
+static const std::string kRenderGraphTemporalAA = "TemporalAA";
+
+// The features that determine the structure of the render graph
+static const int kRenderGraphKeyHDR = 1 << 0;
+static const int kRenderGraphKeyBloom = 1 << 1;
+static const int kRenderGraphKeyPostProcessMask = 1 << 2;
+static const int kRenderGraphKeyRenderToTexture = 1 << 3;
+static const int kRenderGraphKeyTransparency = 1 << 4;
+static const int kRenderGraphKeyResolveDisplay = 1 << 5;
+static const int kRenderGraphKeyTemporalAA = 1 << 6;
 
 #pragma mark - Initialization
 
 VROChoreographer::VROChoreographer(VRORendererConfiguration config, std::shared_ptr<VRODriver> driver) :
     _driver(driver),
     _clearColor({ 0, 0, 0, 1 }),
-    _renderTargetsChanged(false) {
+    _renderTargetsChanged(false),
+    _renderGraphKey(-1) {
 
     // Derive supported features on this GPU
     _mrtSupported = driver->getGPUType() != VROGPUType::Adreno330OrOlder;
@@ -58,20 +93,55 @@ VROChoreographer::VROChoreographer(VRORendererConfiguration config, std::shared_
     _pbrSupported = _hdrSupported;
     _bloomSupported = _mrtSupported && _hdrSupported && driver->isBloomSupported();
     _postProcessMaskSupported = _mrtSupported;
+    _clusteredLightingSupported = _mrtSupported;
+    _occlusionCullingSupported = driver->isOcclusionQuerySupported();
+    _orderIndependentTransparencySupported = _hdrSupported && _mrtSupported;
+    _multiviewSupported = _hdrSupported && driver->isMultiviewSupported();
+    _foveationSupported = _hdrSupported && driver->isFoveationSupported();
+    _temporalAASupported = _hdrSupported && _mrtSupported && driver->getMaxDrawBuffers() > kTemporalAAVelocityAttachment;
         
     // Enable defaults based on input flags and and support
     _shadowsEnabled = _mrtSupported && config.enableShadows;
     _hdrEnabled = _hdrSupported && config.enableHDR;
     _pbrEnabled = _hdrSupported && config.enablePBR;
+    _sphericalHarmonicsIrradianceEnabled = config.enableSphericalHarmonicsIrradiance;
     _bloomEnabled = _bloomSupported && config.enableBloom;
+    _bloomMethod = config.bloomMethod;
     _postProcessMaskEnabled = false;
+    _clusteredLightingEnabled = _clusteredLightingSupported && config.enableClusteredLighting;
+    _depthPrepassMode = config.depthPrepassMode;
+    _occlusionCullingEnabled = false;
+    setOcclusionCullingEnabled(config.enableOcclusionCulling);
+    _orderIndependentTransparencyEnabled = _orderIndependentTransparencySupported && config.enableOrderIndependentTransparency;
+    _multiviewEnabled = _multiviewSupported && config.enableMultiview;
+    _multiviewFrame = -1;
+    _temporalAAEnabled = _temporalAASupported && config.enableTemporalAntialiasing;
+    _hdrSampleCount = config.enableMultisampling ? kHDRMultisampleCount : 1;
+    _foveationLevel = config.foveationLevel;
+    _foveationFocalPoints = { { 0, 0, 0 }, { 0, 0, 0 } };
+    _shadingRateSupported = driver->isVariableRateShadingSupported();
+    _shadingRateLevel = config.shadingRateLevel;
+    _dynamicResolution = std::make_shared<VRODynamicResolution>(config.dynamicResolutionMinScale,
+                                                                config.dynamicResolutionMaxScale,
+                                                                1000.0 / config.dynamicResolutionTargetFPS);
+    _dynamicResolutionEnabled = false;
+    _resolutionScaleLimit = 1.0;
+    _renderOnDemandEnabled = false;
+    _lastFrameRetained = false;
+    setDynamicResolutionEnabled(config.enableDynamicResolution);
+    setRenderOnDemandEnabled(config.enableRenderOnDemand);
     _renderToTextureDelegate = nullptr;
+    _displayResolveSupported = true;
         
     // This is always created so that it can be configured even if HDR is off. Useful
     // for applications that dynamically turn HDR on and off.
     _gaussianBlurPass = std::make_shared<VROGaussianBlurRenderPass>();
     _postProcessEffectFactory = std::make_shared<VROPostProcessEffectFactory>();
     _postProcessEffectFactory->setGaussianBlurPass(_gaussianBlurPass);
+    _dualFilterBloomPass = std::make_shared<VRODualFilterBloomRenderPass>();
+    _temporalAAPass = std::make_shared<VROTemporalAntialiasingRenderPass>();
+    _targetPool = std::make_shared<VRORenderTargetPool>();
+    _renderGraph = std::make_shared<VRORenderGraph>(_targetPool);
     createRenderTargets();
 }
 
@@ -89,31 +159,38 @@ void VROChoreographer::createRenderTargets() {
     pinfo("[Shadows enabled: %d]", _shadowsEnabled);
     pinfo("[HDR supported:   %d, HDR enabled:   %d]", _hdrSupported, _hdrEnabled);
     pinfo("[PBR supported:   %d, PBR enabled:   %d]", _pbrSupported, _pbrEnabled);
-    pinfo("[Bloom supported: %d, Bloom enabled: %d]", _bloomSupported, _bloomEnabled);
+    pinfo("[Clustered lighting supported: %d, enabled: %d]", _clusteredLightingSupported, _clusteredLightingEnabled);
+    pinfo("[Occlusion culling supported:  %d, enabled: %d]", _occlusionCullingSupported, _occlusionCullingEnabled);
+    pinfo("[OIT supported:                %d, enabled: %d]", _orderIndependentTransparencySupported,
+          _orderIndependentTransparencyEnabled);
+    pinfo("[Multiview supported:          %d, enabled: %d]", _multiviewSupported, _multiviewEnabled);
+    pinfo("[Foveation supported:          %d, level:   %d]", _foveationSupported, (int) _foveationLevel);
+    pinfo("[Shading rate supported:       %d, level:   %d]", _shadingRateSupported, (int) _shadingRateLevel);
+    pinfo("[Dynamic resolution enabled:   %d]", _dynamicResolutionEnabled);
+    pinfo("[Temporal AA supported:        %d, enabled: %d]", _temporalAASupported, _temporalAAEnabled);
+    pinfo("[Bloom supported: %d, Bloom enabled: %d, method: %d]", _bloomSupported, _bloomEnabled, (int) _bloomMethod);
     
     _blitPostProcess.reset();
-    _blitTarget.reset();
     _rttTarget.reset();
-    _postProcessTargetA.reset();
-    _postProcessTargetB.reset();
+    _lastFrameRetained = false;
+    _renderGraph->clear();
+    _renderGraphKey = -1;
+    _targetPool->clear();
     _hdrTarget.reset();
+    _multiviewTarget.reset();
+    _multiviewFrame = -1;
     _additiveBlendPostProcess.reset();
     _toneMappingPass.reset();
     _preprocesses.clear();
     _gaussianBlurPass->resetRenderTargets();
-
-    VRORenderTargetType colorType = _hdrEnabled ? VRORenderTargetType::ColorTextureHDR16 : VRORenderTargetType::ColorTexture;
+    _dualFilterBloomPass->resetRenderTargets();
+    _temporalAAPass->resetRenderTargets();
 
     if (_mrtSupported) {
-        std::vector<std::string> blitSamplers = { "source_texture" };
-        std::vector<std::string> blitCode = {
-            "uniform sampler2D source_texture;",
-            "frag_color = texture(source_texture, v_texcoord);"
-        };
-        std::shared_ptr<VROShaderProgram> blitShader = VROImageShaderProgram::create(blitSamplers, blitCode, driver);
-        _blitPostProcess = driver->newImagePostProcess(blitShader);
-        _blitTarget = driver->newRenderTarget(colorType, 1, 1, false, true);
-        _rttTarget = driver->newRenderTarget(VRORenderTargetType::ColorTexture, 1, 1, false, true);
+        // The render-to-texture target is otherwise created on first use
+        if (_renderToTextureDelegate || _renderOnDemandEnabled) {
+            createRenderToTextureTarget(driver);
+        }
 
         _preprocesses.clear();
         if (_shadowsEnabled) {
@@ -121,14 +198,11 @@ void VROChoreographer::createRenderTargets() {
         }
         
         if (_pbrEnabled) {
-            _preprocesses.push_back(std::make_shared<VROIBLPreprocess>());
+            _preprocesses.push_back(std::make_shared<VROIBLPreprocess>(_sphericalHarmonicsIrradianceEnabled));
         }
     }
     
     if (_hdrEnabled) {
-        _postProcessTargetA = driver->newRenderTarget(VRORenderTargetType::ColorTextureHDR16, 1, 1, false, false);
-        _postProcessTargetB = driver->newRenderTarget(VRORenderTargetType::ColorTextureHDR16, 1, 1, false, false);
-
         // Configure the number of render targets.
         // TODO: Consider making the assignment of render target attachments more dynamic.
         int renderTargetNum;
@@ -137,10 +211,22 @@ void VROChoreographer::createRenderTargets() {
             _gaussianBlurPass->createRenderTargets(driver);
         } else if (_bloomEnabled) {
             renderTargetNum = 3;
-            _gaussianBlurPass->createRenderTargets(driver);
+            if (_bloomMethod == VROBloomMethod::Gaussian) {
+                _gaussianBlurPass->createRenderTargets(driver);
+            }
         } else {
             renderTargetNum = 2;
         }
+        if (_bloomEnabled && _bloomMethod == VROBloomMethod::DualFilter) {
+            _dualFilterBloomPass->createRenderTargets(driver);
+        }
+        
+        // Temporal anti-aliasing writes velocities to a further attachment, following
+        // the masks (which are allocated, though unused, if their effects are off)
+        if (_temporalAAEnabled) {
+            renderTargetNum = kTemporalAAVelocityAttachment + 1;
+            _temporalAAPass->createRenderTargets(driver);
+        }
 
         if (_bloomEnabled) {
             // The HDR target includes an additional attachment to which we render a tone-mapping mask
@@ -156,7 +242,8 @@ void VROChoreographer::createRenderTargets() {
                 "highp vec4 base = texture(hdr_texture, v_texcoord);",
                 "base.rgb *= base.a;",
 
-                // The bloom input is already premultiplied (see VROGaussianBlurRenderPass)
+                // The bloom input is already premultiplied (see VROGaussianBlurRenderPass and
+                // VRODualFilterBloomRenderPass)
                 "highp vec4 bloom = texture(bloom_texture, v_texcoord);",
                 "frag_color = base + bloom;",
                 "frag_color.a = frag_color.a > 1.0 ? 1.0 : frag_color.a;"
@@ -168,6 +255,19 @@ void VROChoreographer::createRenderTargets() {
             _hdrTarget = driver->newRenderTarget(VRORenderTargetType::ColorTextureHDR16, renderTargetNum, 1, false, true);
         }
 
+        // Multisample the HDR target when multisampling is requested, since the scene is
+        // not rendered directly into the (multisampled) display. Multiview frames are blit
+        // into the HDR target, which is not possible into a multisampled framebuffer.
+        if (!_multiviewEnabled) {
+            _hdrTarget->setSampleCount(_hdrSampleCount);
+        }
+
+        // The multiview target receives the same attachments as the HDR target, for both eyes
+        if (_multiviewEnabled) {
+            _multiviewTarget = driver->newRenderTarget(VRORenderTargetType::ColorTextureHDR16Multiview, renderTargetNum,
+                                                       kMultiviewNumViews, false, true);
+        }
+
         bool needsSoftwareGammaPass = driver->getColorRenderingMode() == VROColorRenderingMode::LinearSoftware;
         _toneMappingPass = std::make_shared<VROToneMappingRenderPass>(VROToneMappingMethod::HableLuminanceOnly,
                                                                       needsSoftwareGammaPass, driver);
@@ -185,6 +285,21 @@ void VROChoreographer::createRenderTargets() {
     setClearColor(_clearColor, driver);
 }
         
+void VROChoreographer::createRenderToTextureTarget(std::shared_ptr<VRODriver> driver) {
+    std::vector<std::string> blitSamplers = { "source_texture" };
+    std::vector<std::string> blitCode = {
+        "uniform sampler2D source_texture;",
+        "frag_color = texture(source_texture, v_texcoord);"
+    };
+    std::shared_ptr<VROShaderProgram> blitShader = VROImageShaderProgram::create(blitSamplers, blitCode, driver);
+    _blitPostProcess = driver->newImagePostProcess(blitShader);
+    _rttTarget = driver->newRenderTarget(VRORenderTargetType::ColorTexture, 1, 1, false, true);
+    _rttTarget->setClearColor(_clearColor);
+    if (_viewport) {
+        _rttTarget->setViewport(VROViewport(0, 0, _viewport->getWidth(), _viewport->getHeight()));
+    }
+}
+        
 void VROChoreographer::setViewport(VROViewport viewport, std::shared_ptr<VRODriver> &driver) {
     _viewport = viewport;
     
@@ -202,36 +317,45 @@ void VROChoreographer::setViewport(VROViewport viewport, std::shared_ptr<VRODriv
      */
     VROViewport rtViewport = VROViewport(0, 0, viewport.getWidth(), viewport.getHeight());
 
+    /*
+     With dynamic resolution, the scene and post-processes render at a reduced
+     size, and the tone-mapping pass upscales them into the display (or the RTT
+     target, which remains at full size).
+     */
+    float scale = getResolutionScale();
+    int scaledWidth  = std::max(1, (int) (viewport.getWidth()  * scale));
+    int scaledHeight = std::max(1, (int) (viewport.getHeight() * scale));
+    VROViewport scaledViewport = VROViewport(0, 0, scaledWidth, scaledHeight);
+
     /*
      We immediately hydrate only core render targets, and disable HDR if any of them
      fail. Other (non-core) render targets are only hydrated when used, in order to
      conserve memory.
      */
     bool failed = false;
-    if (_blitTarget) {
-        _blitTarget->setViewport(rtViewport);
-        if (!_blitTarget->hydrate()) {
-            pwarn("Blit target creation failed");
-            failed = true;
-        }
-    }
     if (_rttTarget) {
         _rttTarget->setViewport(rtViewport);
     }
-    if (_postProcessTargetA) {
-        _postProcessTargetA->setViewport(rtViewport);
-    }
-    if (_postProcessTargetB) {
-        _postProcessTargetB->setViewport(rtViewport);
-    }
     if (_hdrTarget) {
-        _hdrTarget->setViewport(rtViewport);
+        _hdrTarget->setViewport(scaledViewport);
         if (!_hdrTarget->hydrate()) {
             pwarn("HDR render target creation failed");
             failed = true;
         }
     }
-    _gaussianBlurPass->setViewPort(viewport, driver);
+    if (_multiviewTarget) {
+        if (_multiviewTarget->setViewport(scaledViewport)) {
+            _multiviewFrame = -1;
+        }
+        if (!_multiviewTarget->hydrate()) {
+            pwarn("Multiview render target creation failed: disabling multiview");
+            _multiviewTarget.reset();
+            _multiviewEnabled = false;
+        }
+    }
+    _gaussianBlurPass->setViewPort({ viewport.getX(), viewport.getY(), scaledWidth, scaledHeight }, driver);
+    _dualFilterBloomPass->setViewport(scaledViewport);
+    _temporalAAPass->setViewport(rtViewport);
 
     if (failed) {
         pwarn("One or more render targets failed creation: disabling HDR and retrying");
@@ -252,108 +376,437 @@ void VROChoreographer::render(VROEyeType eye,
         _renderTargetsChanged = false;
     }
     
-    if (eye == VROEyeType::Left || eye == VROEyeType::Monocular) {        
+    // Preprocesses have already run for this frame if the base pass was multiview
+    bool multiviewRendered = _multiviewFrame == context->getFrame() && isMultiviewAvailable();
+    if ((eye == VROEyeType::Left || eye == VROEyeType::Monocular) && !multiviewRendered) {
+        VRO_PROFILE_GPU_SCOPE("preprocess", driver);
         for (std::shared_ptr<VROPreprocess> &preprocess : _preprocesses) {
             preprocess->execute(scene, context, driver);
         }
+        captureImpostors(metadata, context, driver);
+    }
+    
+    // The cluster grid is built in view space, so it's rebuilt for each eye
+    if (_clusteredLightingEnabled) {
+        VRO_PROFILE_SCOPE("updateLightClusters");
+        if (!_lightClusters) {
+            _lightClusters = std::make_shared<VROLightClusterGrid>();
+        }
+        std::vector<std::shared_ptr<VROLight>> lights = scene->getLights();
+        if (outgoingScene) {
+            lights.insert(lights.end(), outgoingScene->getLights().begin(), outgoingScene->getLights().end());
+        }
+        _lightClusters->update(lights, context->getViewMatrix(), context->getProjectionMatrix(),
+                               context->getZNear(), context->getZFar());
+        context->setLightClusters(_lightClusters);
+    }
+    else {
+        context->setLightClusters(nullptr);
+    }
+    
+    context->setShadingRateLevel(_shadingRateSupported ? _shadingRateLevel : VROShadingRateLevel::None);
+    
+    // Jitter the projection for the scene, restoring it for the passes that follow
+    if (_hdrEnabled && _temporalAAEnabled) {
+        VROMatrix4f projection = context->getProjectionMatrix();
+        _temporalAAPass->beginFrame(context, _hdrTarget->getWidth(), _hdrTarget->getHeight());
+        context->setTemporalAAEnabled(true);
+        renderScene(scene, outgoingScene, metadata, context, driver);
+        context->setTemporalAAEnabled(false);
+        context->setProjectionMatrix(projection);
+    }
+    else {
+        renderScene(scene, outgoingScene, metadata, context, driver);
     }
-    renderScene(scene, outgoingScene, metadata, context, driver);
+}
+
+bool VROChoreographer::renderMultiview(std::shared_ptr<VROScene> scene,
+                                       std::shared_ptr<VROScene> outgoingScene,
+                                       const std::shared_ptr<VRORenderMetadata> &metadata,
+                                       VRORenderContext *context,
+                                       std::shared_ptr<VRODriver> &driver) {
+    if (_renderTargetsChanged) {
+        createRenderTargets();
+        _renderTargetsChanged = false;
+    }
+    if (!isMultiviewAvailable()) {
+        return false;
+    }
+
+    {
+        VRO_PROFILE_GPU_SCOPE("preprocess", driver);
+        for (std::shared_ptr<VROPreprocess> &preprocess : _preprocesses) {
+            preprocess->execute(scene, context, driver);
+        }
+        captureImpostors(metadata, context, driver);
+    }
+    context->setLightClusters(nullptr);
+
+    // Only the base pass renders with multiview shaders; the preprocesses above
+    // and the per-eye post-processing render to ordinary targets
+    VRORenderPassInputOutput inputs;
+    inputs.outputTarget = _multiviewTarget;
+    context->setMultiviewEnabled(true);
+    updateFoveation(_multiviewTarget, context);
+    {
+        VRO_PROFILE_GPU_SCOPE("multiviewBasePass", driver);
+        _baseRenderPass->render(scene, outgoingScene, inputs, context, driver);
+    }
+    context->setMultiviewEnabled(false);
+    
+    _multiviewFrame = context->getFrame();
+    return true;
+}
+
+void VROChoreographer::captureImpostors(const std::shared_ptr<VRORenderMetadata> &metadata,
+                                        VRORenderContext *context, std::shared_ptr<VRODriver> &driver) {
+    const std::vector<VRONode *> &nodes = metadata->getImpostorCaptures();
+    if (nodes.empty()) {
+        return;
+    }
+    
+    VRO_PROFILE_GPU_SCOPE("impostors", driver);
+    for (int i = 0; i < nodes.size(); i++) {
+        const std::shared_ptr<VROGeometry> &geometry = nodes[i]->getGeometry();
+        if (!geometry || !geometry->getImpostor()) {
+            continue;
+        }
+        const std::shared_ptr<VROImpostor> &impostor = geometry->getImpostor();
+        if (i < kMaxImpostorCapturesPerFrame) {
+            impostor->capture(*nodes[i], context, driver);
+        }
+        else {
+            impostor->invalidate();
+        }
+    }
+}
+
+bool VROChoreographer::isMultiviewAvailable() const {
+    return _multiviewEnabled && _hdrEnabled && !_clusteredLightingEnabled && !_orderIndependentTransparencyEnabled &&
+           !_temporalAAEnabled && _multiviewTarget;
+}
+
+void VROChoreographer::renderBasePass(std::shared_ptr<VROScene> scene,
+                                      std::shared_ptr<VROScene> outgoingScene,
+                                      VRORenderPassInputOutput &inputs,
+                                      VRORenderContext *context, std::shared_ptr<VRODriver> &driver) {
+    if (_multiviewFrame == context->getFrame() && isMultiviewAvailable()) {
+        int view = context->getEyeType() == VROEyeType::Right ? 1 : 0;
+        driver->bindRenderTarget(inputs.outputTarget, VRORenderTargetActions::overwrite(), VRORenderTargetUnbindOp::Invalidate);
+        _multiviewTarget->blitImage(view, inputs.outputTarget, driver);
+    }
+    else {
+        updateFoveation(inputs.outputTarget, context);
+        updatePeripheralShadingRate(inputs.outputTarget, context);
+        _baseRenderPass->render(scene, outgoingScene, inputs, context, driver);
+    }
+    
+    // Post-processes are always shaded per-pixel
+    driver->setShadingRate(VROShadingRate::Rate1x1);
+}
+
+void VROChoreographer::updateFoveation(std::shared_ptr<VRORenderTarget> target, VRORenderContext *context) {
+    if (!_foveationSupported || !target) {
+        return;
+    }
+    
+    /*
+     Gain sets how quickly density falls off with distance from the focal point,
+     beyond the fovea area (both in normalized device coordinates). Foveation is
+     disabled with zero gain for monocular rendering, which is not viewed through
+     a lens.
+     */
+    float gain = 0;
+    float foveaArea = 0;
+    if (context->getEyeType() != VROEyeType::Monocular) {
+        switch (_foveationLevel) {
+            case VROFoveationLevel::Low:
+                gain = 2.0;
+                foveaArea = 1.0;
+                break;
+            case VROFoveationLevel::Medium:
+                gain = 3.0;
+                foveaArea = 1.0;
+                break;
+            case VROFoveationLevel::High:
+                gain = 4.0;
+                foveaArea = 0.5;
+                break;
+            default:
+                break;
+        }
+    }
+    
+    if (context->isMultiviewEnabled()) {
+        target->setFoveation(gain, foveaArea, _foveationFocalPoints);
+    }
+    else {
+        int view = context->getEyeType() == VROEyeType::Right ? 1 : 0;
+        target->setFoveation(gain, foveaArea, { _foveationFocalPoints[view] });
+    }
+}
+
+void VROChoreographer::updatePeripheralShadingRate(std::shared_ptr<VRORenderTarget> target, VRORenderContext *context) {
+    if (!_shadingRateSupported || !target) {
+        return;
+    }
+    
+    // The periphery is only reduced for stereo rendering, which is viewed through a
+    // lens; the radius is in normalized device coordinates
+    float radius = 0;
+    VROShadingRate rate = VROShadingRate::Rate2x2;
+    if (context->getEyeType() != VROEyeType::Monocular) {
+        switch (context->getShadingRateLevel()) {
+            case VROShadingRateLevel::Low:
+                radius = 0.8;
+                break;
+            case VROShadingRateLevel::High:
+                radius = 0.6;
+                rate = VROShadingRate::Rate4x4;
+                break;
+            default:
+                break;
+        }
+    }
+    int view = context->getEyeType() == VROEyeType::Right ? 1 : 0;
+    target->setPeripheralShadingRate(radius, rate, _foveationFocalPoints[view]);
 }
 
 void VROChoreographer::renderScene(std::shared_ptr<VROScene> scene,
                                    std::shared_ptr<VROScene> outgoingScene,
                                    const std::shared_ptr<VRORenderMetadata> &metadata,
                                    VRORenderContext *context, std::shared_ptr<VRODriver> &driver) {
-    VRORenderPassInputOutput inputs;
+    _targetPool->purge(context->getFrame());
+    
+    // The graph is only rebuilt when the passes required by the frame change
+    bool renderToTexture = (_renderToTextureDelegate || _renderOnDemandEnabled) && (_hdrEnabled || _mrtSupported);
+    int key = 0;
     if (_hdrEnabled) {
+        key |= kRenderGraphKeyHDR;
         if (_bloomEnabled && metadata->requiresBloomPass()) {
+            key |= kRenderGraphKeyBloom;
+        }
+        if (_postProcessMaskEnabled && metadata->requiresPostProcessMaskPass()) {
+            key |= kRenderGraphKeyPostProcessMask;
+        }
+        if (_orderIndependentTransparencyEnabled) {
+            key |= kRenderGraphKeyTransparency;
+        }
+        if (_temporalAAEnabled) {
+            key |= kRenderGraphKeyTemporalAA;
+        }
+    }
+    if (renderToTexture) {
+        key |= kRenderGraphKeyRenderToTexture;
+        if (_displayResolveSupported) {
+            key |= kRenderGraphKeyResolveDisplay;
+        }
+    }
+    if (key != _renderGraphKey) {
+        buildRenderGraph(key);
+        _renderGraphKey = key;
+    }
+    
+    _renderGraph->setImportedTarget(kRenderGraphDisplay, driver->getDisplay());
+    if (renderToTexture) {
+        if (!_rttTarget) {
+            createRenderToTextureTarget(driver);
+        }
+        _rttTarget->hydrate();
+        _renderGraph->setImportedTarget(kRenderGraphRTT, _rttTarget);
+    }
+    if (_hdrEnabled) {
+        _renderGraph->setImportedTarget(kRenderGraphHDR, _hdrTarget);
+        _renderGraph->setTransientSize(_hdrTarget->getWidth(), _hdrTarget->getHeight());
+    }
+    
+    VRORenderGraphFrame frame;
+    frame.scene = scene;
+    frame.outgoingScene = outgoingScene;
+    frame.metadata = metadata;
+    frame.context = context;
+    frame.driver = driver;
+    _renderGraph->execute(frame);
+    _lastFrameRetained = renderToTexture && _renderOnDemandEnabled;
+}
 
-            // Render the scene + bloom to the floating point HDR MRT target
-            inputs.outputTarget = _hdrTarget;
-            _baseRenderPass->render(scene, outgoingScene, inputs, context, driver);
-
-            // Blur the image. The finished result will reside in _blurTargetB.
-            inputs.textures[kGaussianInput] = _hdrTarget->getTexture(2);
-            _gaussianBlurPass->render(scene, outgoingScene, inputs, context, driver);
-
-            // Additively blend the bloom back into the image, store in _blitTarget. Note we
-            // have to set the blend mode to PremultiplyAlpha because the input texture (the blur
-            // texture) has alpha premultiplied -- so we don't want OpenGL to multiply its colors
-            // by alpha *again*.
-            driver->bindRenderTarget(_blitTarget, VRORenderTargetUnbindOp::Invalidate);
-            driver->setBlendingMode(VROBlendMode::PremultiplyAlpha);
-            _additiveBlendPostProcess->blit({ _hdrTarget->getTexture(0), inputs.outputTarget->getTexture(0) }, driver);
-            driver->setBlendingMode(VROBlendMode::Alpha);
-
-            // Run additional post-processing on the normal HDR image
-            bool canProcessMask = metadata->requiresPostProcessMaskPass() && _postProcessMaskEnabled;
-            std::shared_ptr<VROTexture> postProcessMask = canProcessMask  ? _hdrTarget->getTexture(3) : nullptr;
-            std::shared_ptr<VRORenderTarget> postProcessTarget = _postProcessEffectFactory->handlePostProcessing(_blitTarget,
-                                                                                                                 _postProcessTargetA,
-                                                                                                                 _postProcessTargetB,
-                                                                                                                 postProcessMask,
-                                                                                                                 context,
-                                                                                                                 driver);
-            passert (postProcessTarget->getTexture(0) != nullptr);
-            // Blend, tone map, and gamma correct
-            inputs.textures[kToneMappingHDRInput] = postProcessTarget->getTexture(0);
-            inputs.textures[kToneMappingMaskInput] = _hdrTarget->getTexture(1);
+void VROChoreographer::buildRenderGraph(int key) {
+    bool hdr = key & kRenderGraphKeyHDR;
+    bool bloom = key & kRenderGraphKeyBloom;
+    bool postProcessMask = key & kRenderGraphKeyPostProcessMask;
+    bool renderToTexture = key & kRenderGraphKeyRenderToTexture;
+    bool transparency = key & kRenderGraphKeyTransparency;
+    bool resolveDisplay = key & kRenderGraphKeyResolveDisplay;
+    bool temporalAA = key & kRenderGraphKeyTemporalAA;
+    
+    _renderGraph->clear();
+    _renderGraph->importTarget(kRenderGraphDisplay);
+    _renderGraph->markOutput(kRenderGraphDisplay);
+    if (renderToTexture) {
+        _renderGraph->importTarget(kRenderGraphRTT);
+    }
+    
+    // When the display can be resolved into the RTT target, the scene is rendered
+    // straight to the display and resolved afterward, avoiding a full-screen pass
+    std::string finalTarget = (renderToTexture && !resolveDisplay) ? kRenderGraphRTT : kRenderGraphDisplay;
+    
+    if (!hdr) {
+        // Render the scene directly to the display (or to the RTT target)
+        _renderGraph->addPass("basePass", {}, { finalTarget },
+                              [this, finalTarget](VRORenderGraph &graph, VRORenderGraphFrame &frame) {
+            VRO_PROFILE_GPU_SCOPE("basePass", frame.driver);
+            VRORenderPassInputOutput inputs;
+            inputs.outputTarget = graph.getTarget(finalTarget);
+            _baseRenderPass->render(frame.scene, frame.outgoingScene, inputs, frame.context, frame.driver);
+            frame.driver->setShadingRate(VROShadingRate::Rate1x1);
+        });
+    }
+    else {
+        // Render the scene to the floating point HDR MRT target
+        _renderGraph->importTarget(kRenderGraphHDR);
+        _renderGraph->addPass("basePass", {}, { kRenderGraphHDR },
+                              [this](VRORenderGraph &graph, VRORenderGraphFrame &frame) {
+            VRO_PROFILE_GPU_SCOPE("basePass", frame.driver);
+            VRORenderPassInputOutput inputs;
+            inputs.outputTarget = graph.getTarget(kRenderGraphHDR);
+            renderBasePass(frame.scene, frame.outgoingScene, inputs, frame.context, frame.driver);
+        });
+        std::string color = kRenderGraphHDR;
+        
+        if (bloom) {
+            // Blur the bloom attachment. The blurred result resides in a target owned by
+            // the bloom pass.
+            _renderGraph->declareAlias(kRenderGraphBloom, {});
+            _renderGraph->addPass("bloomPass", { kRenderGraphHDR }, { kRenderGraphBloom },
+                                  [this](VRORenderGraph &graph, VRORenderGraphFrame &frame) {
+                VRORenderPassInputOutput inputs;
+                if (_bloomMethod == VROBloomMethod::DualFilter) {
+                    VRO_PROFILE_GPU_SCOPE("dualFilterBloomPass", frame.driver);
+                    inputs.textures[kDualFilterBloomInput] = graph.getTexture(kRenderGraphHDR, 2);
+                    _dualFilterBloomPass->render(frame.scene, frame.outgoingScene, inputs, frame.context, frame.driver);
+                }
+                else {
+                    VRO_PROFILE_GPU_SCOPE("gaussianBlurPass", frame.driver);
+                    inputs.textures[kGaussianInput] = graph.getTexture(kRenderGraphHDR, 2);
+                    _gaussianBlurPass->render(frame.scene, frame.outgoingScene, inputs, frame.context, frame.driver);
+                }
+                graph.setAliasTarget(kRenderGraphBloom, inputs.outputTarget);
+            });
             
-            if (_renderToTextureDelegate) {
-                _rttTarget->hydrate();
-                
-                inputs.outputTarget = _rttTarget;
-                _toneMappingPass->render(scene, outgoingScene, inputs, context, driver);
-                renderToTextureAndDisplay(_rttTarget, driver);
-            }
-            else {
-                inputs.outputTarget = driver->getDisplay();
-                _toneMappingPass->render(scene, outgoingScene, inputs, context, driver);
-            }
+            // Additively blend the bloom back into the image. Note we have to set the blend
+            // mode to PremultiplyAlpha because the input texture (the blur texture) has alpha
+            // premultiplied -- so we don't want OpenGL to multiply its colors by alpha *again*.
+            _renderGraph->declareTarget(kRenderGraphBloomComposite, VRORenderTargetType::ColorTextureHDR16, 1);
+            _renderGraph->addPass("bloomBlendPass", { kRenderGraphHDR, kRenderGraphBloom }, { kRenderGraphBloomComposite },
+                                  [this](VRORenderGraph &graph, VRORenderGraphFrame &frame) {
+                VRO_PROFILE_GPU_SCOPE("bloomBlendPass", frame.driver);
+                frame.driver->bindRenderTarget(graph.getTarget(kRenderGraphBloomComposite), VRORenderTargetActions::clearColorOnly(),
+                                               VRORenderTargetUnbindOp::Invalidate);
+                frame.driver->setBlendingMode(VROBlendMode::PremultiplyAlpha);
+                _additiveBlendPostProcess->blit({ graph.getTexture(kRenderGraphHDR), graph.getTexture(kRenderGraphBloom) },
+                                                frame.driver);
+                frame.driver->setBlendingMode(VROBlendMode::Alpha);
+            });
+            color = kRenderGraphBloomComposite;
         }
-        else {
-            // Render the scene to the floating point HDR target
-            inputs.outputTarget = _hdrTarget;
-            _baseRenderPass->render(scene, outgoingScene, inputs, context, driver);
-            
-            // Run additional post-processing on the HDR image
-            bool canProcessMask = metadata->requiresPostProcessMaskPass() && _postProcessMaskEnabled;
-            std::shared_ptr<VROTexture> postProcessMask = canProcessMask  ? _hdrTarget->getTexture(3) : nullptr;
-            std::shared_ptr<VRORenderTarget> postProcessTarget = _postProcessEffectFactory->handlePostProcessing(_hdrTarget,
-                                                                                                                 _postProcessTargetA,
-                                                                                                                 _postProcessTargetB,
-                                                                                                                 postProcessMask,
-                                                                                                                 context,
-                                                                                                                 driver);
+        
+        /*
+         Run additional post-processing on the HDR image. The ping-pong targets are only
+         allocated if effects are enabled. If the source is transient and will not be
+         read after the effects run, it is reused as the second ping-pong target.
+         */
+        _renderGraph->declareTarget(kRenderGraphPostProcessA, VRORenderTargetType::ColorTextureHDR16, 1);
+        _renderGraph->declareTarget(kRenderGraphPostProcessB, VRORenderTargetType::ColorTextureHDR16, 1);
+        _renderGraph->declareAlias(kRenderGraphPostProcessed, { color, kRenderGraphPostProcessA, kRenderGraphPostProcessB });
+        _renderGraph->addPass("postProcessPass", { color, kRenderGraphHDR },
+                              { kRenderGraphPostProcessA, kRenderGraphPostProcessB, kRenderGraphPostProcessed },
+                              [this, color, postProcessMask](VRORenderGraph &graph, VRORenderGraphFrame &frame) {
+            std::shared_ptr<VRORenderTarget> source = graph.getTarget(color);
+            std::shared_ptr<VROTexture> mask = postProcessMask ? graph.getTexture(kRenderGraphHDR, 3) : nullptr;
             
-            // Perform tone-mapping with gamma correction
-            inputs.textures[kToneMappingHDRInput] = postProcessTarget->getTexture(0);
-            inputs.textures[kToneMappingMaskInput] = _hdrTarget->getTexture(1);
-
-            if (_renderToTextureDelegate) {
-                _rttTarget->hydrate();
-                
-                inputs.outputTarget = _rttTarget;
-                _toneMappingPass->render(scene, outgoingScene, inputs, context, driver);
-                renderToTextureAndDisplay(_rttTarget, driver);
-            }
-            else {
-                inputs.outputTarget = driver->getDisplay();
-                _toneMappingPass->render(scene, outgoingScene, inputs, context, driver);
+            std::shared_ptr<VRORenderTarget> targetA, targetB;
+            if (_postProcessEffectFactory->hasEffects()) {
+                targetA = graph.getTarget(kRenderGraphPostProcessA, false);
+                if (color != kRenderGraphHDR && !_postProcessEffectFactory->isSourceReadAfterEffects(mask)) {
+                    targetB = source;
+                }
+                else {
+                    targetB = graph.getTarget(kRenderGraphPostProcessB, false);
+                }
             }
+            std::shared_ptr<VRORenderTarget> result = _postProcessEffectFactory->handlePostProcessing(source, targetA, targetB,
+                                                                                                      mask, frame.context,
+                                                                                                      frame.driver,
+                                                                                                      _toneMappingPass);
+            passert (result->getTexture(0) != nullptr);
+            graph.setAliasTarget(kRenderGraphPostProcessed, result);
+        });
+        color = kRenderGraphPostProcessed;
+        
+        // Custom passes are chained on the post-processed image, each into a new transient
+        for (int i = 0; i < (int) _customRenderPasses.size(); i++) {
+            std::string output = kRenderGraphCustom + VROStringUtil::toString(i);
+            std::shared_ptr<VRORenderPass> pass = _customRenderPasses[i].second;
+            
+            _renderGraph->declareTarget(output, VRORenderTargetType::ColorTextureHDR16, 1);
+            _renderGraph->addPass(_customRenderPasses[i].first, { color }, { output },
+                                  [pass, color, output](VRORenderGraph &graph, VRORenderGraphFrame &frame) {
+                VRORenderPassInputOutput inputs;
+                inputs.textures[kCustomRenderPassInput] = graph.getTexture(color);
+                inputs.outputTarget = graph.getTarget(output);
+                pass->render(frame.scene, frame.outgoingScene, inputs, frame.context, frame.driver);
+            });
+            color = output;
         }
-    }
-    else if (_mrtSupported && _renderToTextureDelegate) {
-        _rttTarget->hydrate();
         
-        inputs.outputTarget = _rttTarget;
-        _baseRenderPass->render(scene, outgoingScene, inputs, context, driver);
-        renderToTextureAndDisplay(_rttTarget, driver);
+        // Resolve the jittered, reduced resolution image against the full resolution
+        // history. The result resides in a target owned by the temporal AA pass.
+        if (temporalAA) {
+            _renderGraph->declareAlias(kRenderGraphTemporalAA, {});
+            _renderGraph->addPass("temporalAAPass", { color, kRenderGraphHDR }, { kRenderGraphTemporalAA },
+                                  [this, color](VRORenderGraph &graph, VRORenderGraphFrame &frame) {
+                VRO_PROFILE_GPU_SCOPE("temporalAAPass", frame.driver);
+                VRORenderPassInputOutput inputs;
+                inputs.textures[kTemporalAAInput] = graph.getTexture(color);
+                inputs.textures[kTemporalAAVelocityInput] = graph.getTexture(kRenderGraphHDR, kTemporalAAVelocityAttachment);
+                _temporalAAPass->render(frame.scene, frame.outgoingScene, inputs, frame.context, frame.driver);
+                graph.setAliasTarget(kRenderGraphTemporalAA, inputs.outputTarget);
+            });
+            color = kRenderGraphTemporalAA;
+        }
+        
+        // Blend, tone map, and gamma correct. Accumulated transparency is composited here,
+        // after bloom and post-processing
+        _renderGraph->addPass("toneMappingPass", { color, kRenderGraphHDR }, { finalTarget },
+                              [this, color, finalTarget, transparency](VRORenderGraph &graph, VRORenderGraphFrame &frame) {
+            VRORenderPassInputOutput inputs;
+            inputs.textures[kToneMappingHDRInput] = graph.getTexture(color);
+            inputs.textures[kToneMappingMaskInput] = graph.getTexture(kRenderGraphHDR, 1);
+            if (transparency) {
+                std::shared_ptr<VRORenderTarget> hdr = graph.getTarget(kRenderGraphHDR, false);
+                inputs.textures[kToneMappingTransparencyInput] = hdr->getTransparencyTexture(0);
+                inputs.textures[kToneMappingTransparencyWeightInput] = hdr->getTransparencyTexture(1);
+            }
+            inputs.outputTarget = graph.getTarget(finalTarget);
+            _toneMappingPass->render(frame.scene, frame.outgoingScene, inputs, frame.context, frame.driver);
+        });
     }
-    else {
-        // Render to the display directly
-        inputs.outputTarget = driver->getDisplay();
-        _baseRenderPass->render(scene, outgoingScene, inputs, context, driver);
+    
+    if (renderToTexture && resolveDisplay) {
+        _renderGraph->addPass("resolveDisplayPass", { kRenderGraphDisplay }, { kRenderGraphRTT },
+                              [this](VRORenderGraph &graph, VRORenderGraphFrame &frame) {
+            resolveDisplayToTexture(graph.getTarget(kRenderGraphDisplay), graph.getTarget(kRenderGraphRTT), frame.driver);
+        }, true);
+    }
+    else if (renderToTexture) {
+        _renderGraph->addPass("renderToTexturePass", { kRenderGraphRTT }, { kRenderGraphDisplay },
+                              [this](VRORenderGraph &graph, VRORenderGraphFrame &frame) {
+            renderToTextureAndDisplay(graph.getTarget(kRenderGraphRTT), frame.driver);
+        }, true);
+    }
+    
+    if (!_renderGraph->compile()) {
+        pwarn("Render graph compiled with no passes");
     }
 }
 
@@ -361,40 +814,93 @@ void VROChoreographer::setClearColor(VROVector4f color, std::shared_ptr<VRODrive
     _clearColor = color;
     // Set the default clear color for the following targets
     driver->getDisplay()->setClearColor(color);
-    if (_blitTarget) {
-        _blitTarget->setClearColor(color);
-    }
     if (_rttTarget) {
         _rttTarget->setClearColor(color);
     }
     if (_hdrTarget) {
         _hdrTarget->setClearColor(color);
     }
-    if (_postProcessTargetA) {
-        _postProcessTargetA->setClearColor(color);
-    }
-    if (_postProcessTargetB) {
-        _postProcessTargetB->setClearColor(color);
+    updateHDRAttachmentFormats(driver);
+    _targetPool->setClearColor(color);
+    if (_dualFilterBloomPass) {
+        _dualFilterBloomPass->setClearColor(color);
     }
     if (_gaussianBlurPass) {
         _gaussianBlurPass->setClearColor(color);
     }
 }
 
+void VROChoreographer::updateHDRAttachmentFormats(std::shared_ptr<VRODriver> driver) {
+    if (!_hdrTarget) {
+        return;
+    }
+    
+    // Attachments are color, tone-mapping mask, bloom, post-process mask, and velocity,
+    // in that order. The masks are only read from their red channel. Alpha is sampled as 1.0
+    // from R11G11B10F attachments, which is correct for an opaque background.
+    VROAttachmentFormat colorFormat = VROAttachmentFormat::Default;
+    if (_clearColor.w == 1.0 && driver->isPackedFloatRenderTargetSupported()) {
+        colorFormat = VROAttachmentFormat::R11G11B10F;
+    }
+    std::vector<VROAttachmentFormat> formats = { colorFormat, VROAttachmentFormat::R8,
+                                                 _bloomEnabled ? colorFormat : VROAttachmentFormat::R8,
+                                                 VROAttachmentFormat::R8, VROAttachmentFormat::RG16F };
+    
+    // The multiview target is blit into the HDR target, so their formats must match
+    std::vector<std::shared_ptr<VRORenderTarget>> targets = { _hdrTarget, _multiviewTarget };
+    for (std::shared_ptr<VRORenderTarget> &target : targets) {
+        if (!target) {
+            continue;
+        }
+        bool changed = false;
+        for (int i = 0; i < target->getNumAttachments(); i++) {
+            changed |= target->setAttachmentFormat(i, formats[i]);
+        }
+        if (!changed) {
+            continue;
+        }
+        if (target == _multiviewTarget) {
+            _multiviewFrame = -1;
+        }
+        if (target->getWidth() > 0 && !target->hydrate()) {
+            pwarn("Failed to re-create HDR render target with new attachment formats");
+        }
+    }
+}
+
 #pragma mark - Render to Texture
 
 void VROChoreographer::renderToTextureAndDisplay(std::shared_ptr<VRORenderTarget> input,
                                                  std::shared_ptr<VRODriver> driver) {
 
-    _renderToTextureDelegate->didRenderFrame(input, driver);
+    if (_renderToTextureDelegate) {
+        _renderToTextureDelegate->didRenderFrame(input, driver);
+    }
 
     // Blit direct to the display. We can't use the blitColor method here
     // because the display is multisampled (blitting to a multisampled buffer
     // is not supported).
-    driver->bindRenderTarget(driver->getDisplay(), VRORenderTargetUnbindOp::Invalidate);
+    driver->bindRenderTarget(driver->getDisplay(), VRORenderTargetActions::clearAll(), VRORenderTargetUnbindOp::Invalidate);
     _blitPostProcess->blit({ input->getTexture(0) }, driver);
 }
 
+void VROChoreographer::resolveDisplayToTexture(std::shared_ptr<VRORenderTarget> display,
+                                               std::shared_ptr<VRORenderTarget> target,
+                                               std::shared_ptr<VRODriver> driver) {
+    
+    // The display is not invalidated on unbind, as it still has to be presented
+    driver->bindRenderTarget(target, VRORenderTargetActions::overwrite(), VRORenderTargetUnbindOp::None);
+    if (!display->resolveColor(target, driver)) {
+        pinfo("Display resolve unsupported, falling back to render-to-texture blit");
+        _displayResolveSupported = false;
+        _renderGraphKey = -1;
+        return;
+    }
+    if (_renderToTextureDelegate) {
+        _renderToTextureDelegate->didRenderFrame(target, driver);
+    }
+}
+
 std::shared_ptr<VROToneMappingRenderPass> VROChoreographer::getToneMapping() {
     return _toneMappingPass;
 }
@@ -407,6 +913,44 @@ void VROChoreographer::setRenderToTextureDelegate(std::shared_ptr<VRORenderToTex
     _renderToTextureDelegate = delegate;
 }
 
+#pragma mark - Render on Demand
+
+void VROChoreographer::setRenderOnDemandEnabled(bool enableRenderOnDemand) {
+    _renderOnDemandEnabled = enableRenderOnDemand;
+    _lastFrameRetained = false;
+}
+
+bool VROChoreographer::presentLastFrame(std::shared_ptr<VRODriver> driver) {
+    if (!_renderOnDemandEnabled || !_lastFrameRetained || _renderTargetsChanged || !_rttTarget) {
+        return false;
+    }
+    driver->bindRenderTarget(driver->getDisplay(), VRORenderTargetActions::clearAll(), VRORenderTargetUnbindOp::Invalidate);
+    _blitPostProcess->blit({ _rttTarget->getTexture(0) }, driver);
+    return true;
+}
+
+#pragma mark - Custom Render Passes
+
+void VROChoreographer::addCustomRenderPass(std::string name, std::shared_ptr<VRORenderPass> pass) {
+    for (auto &customPass : _customRenderPasses) {
+        if (customPass.first == name) {
+            customPass.second = pass;
+            _renderGraphKey = -1;
+            return;
+        }
+    }
+    _customRenderPasses.push_back({ name, pass });
+    _renderGraphKey = -1;
+}
+
+void VROChoreographer::removeCustomRenderPass(std::string name) {
+    _customRenderPasses.erase(std::remove_if(_customRenderPasses.begin(), _customRenderPasses.end(),
+                                             [name](const std::pair<std::string, std::shared_ptr<VRORenderPass>> &customPass) {
+                                                 return customPass.first == name;
+                                             }), _customRenderPasses.end());
+    _renderGraphKey = -1;
+}
+
 #pragma mark - Renderer Settings
 
 bool VROChoreographer::setHDREnabled(bool enableHDR) {
@@ -469,7 +1013,7 @@ bool VROChoreographer::setShadowsEnabled(bool enableShadows) {
     }
 }
 
-bool VROChoreographer::setBloomEnabled(bool enableBloom) {
+bool VROChoreographer::setBloomEnabled(bool enableBloom, VROBloomMethod method) {
     if (!enableBloom) {
         if (_bloomEnabled) {
             _bloomEnabled = false;
@@ -481,14 +1025,120 @@ bool VROChoreographer::setBloomEnabled(bool enableBloom) {
         if (!_bloomSupported) {
             return false;
         }
-        else if (!_bloomEnabled) {
+        else if (!_bloomEnabled || _bloomMethod != method) {
             _bloomEnabled = true;
+            _bloomMethod = method;
             _renderTargetsChanged = true;
         }
         return true;
     }
 }
 
+bool VROChoreographer::setClusteredLightingEnabled(bool enableClusteredLighting) {
+    if (enableClusteredLighting && !_clusteredLightingSupported) {
+        return false;
+    }
+    _clusteredLightingEnabled = enableClusteredLighting;
+    if (!_clusteredLightingEnabled) {
+        _lightClusters.reset();
+    }
+    return true;
+}
+
+bool VROChoreographer::setOcclusionCullingEnabled(bool enableOcclusionCulling) {
+    if (enableOcclusionCulling && !_occlusionCullingSupported) {
+        return false;
+    }
+    _occlusionCullingEnabled = enableOcclusionCulling;
+    if (_occlusionCullingEnabled && !_occlusionCuller) {
+        _occlusionCuller = std::make_shared<VROOcclusionCuller>();
+    }
+    else if (!_occlusionCullingEnabled && _occlusionCuller) {
+        std::shared_ptr<VRODriver> driver = _driver.lock();
+        if (driver) {
+            _occlusionCuller->reset(*driver);
+        }
+        _occlusionCuller.reset();
+    }
+    return true;
+}
+
+bool VROChoreographer::setOrderIndependentTransparencyEnabled(bool enableOrderIndependentTransparency) {
+    if (enableOrderIndependentTransparency && !_orderIndependentTransparencySupported) {
+        return false;
+    }
+    _orderIndependentTransparencyEnabled = enableOrderIndependentTransparency;
+    return true;
+}
+
+bool VROChoreographer::setMultiviewEnabled(bool enableMultiview) {
+    if (enableMultiview && !_multiviewSupported) {
+        return false;
+    }
+    if (_multiviewEnabled != enableMultiview) {
+        _multiviewEnabled = enableMultiview;
+        _renderTargetsChanged = true;
+    }
+    return true;
+}
+
+bool VROChoreographer::setTemporalAntialiasingEnabled(bool enableTemporalAntialiasing) {
+    if (enableTemporalAntialiasing && !_temporalAASupported) {
+        return false;
+    }
+    if (_temporalAAEnabled != enableTemporalAntialiasing) {
+        _temporalAAEnabled = enableTemporalAntialiasing;
+        _renderTargetsChanged = true;
+    }
+    return true;
+}
+
+void VROChoreographer::setDynamicResolutionEnabled(bool enableDynamicResolution) {
+    _dynamicResolutionEnabled = enableDynamicResolution;
+    std::shared_ptr<VRODriver> driver = _driver.lock();
+    if (driver) {
+        driver->setGPUFrameTimerEnabled(enableDynamicResolution);
+    }
+}
+
+void VROChoreographer::updateResolutionScale(double frameInterval, std::shared_ptr<VRODriver> &driver) {
+    if (!_dynamicResolutionEnabled || !_hdrEnabled) {
+        return;
+    }
+    if (_dynamicResolution->update(driver->getGPUFrameTime(), frameInterval)) {
+        pinfo("Dynamic resolution scale changed to %f", _dynamicResolution->getScale());
+    }
+}
+
+float VROChoreographer::getResolutionScale() const {
+    if (!_hdrEnabled) {
+        return 1.0;
+    }
+    if (!_dynamicResolutionEnabled) {
+        return _resolutionScaleLimit;
+    }
+    return std::min(_dynamicResolution->getScale(), _resolutionScaleLimit);
+}
+
+void VROChoreographer::setResolutionScaleLimit(float limit) {
+    _resolutionScaleLimit = VROMathClamp(limit, kDynamicResolutionScaleStep, 1.0f);
+}
+
+bool VROChoreographer::setFoveationLevel(VROFoveationLevel level) {
+    _foveationLevel = level;
+    return _foveationSupported || level == VROFoveationLevel::None;
+}
+
+bool VROChoreographer::setShadingRateLevel(VROShadingRateLevel level) {
+    _shadingRateLevel = level;
+    return _shadingRateSupported || level == VROShadingRateLevel::None;
+}
+
+void VROChoreographer::setFoveationFocalPoints(VROVector3f left, VROVector3f right) {
+    _foveationFocalPoints[0] = left;
+    _foveationFocalPoints[1] = right;
+}
+
 bool VROChoreographer::setPostProcessMaskEnabled(bool enablePostProcessMask) {
     if (!enablePostProcessMask) {
         if (_postProcessMaskEnabled) {
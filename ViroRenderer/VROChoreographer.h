@@ -30,30 +30,53 @@
 #include <memory>
 #include <map>
 #include <vector>
+#include <string>
 #include <functional>
 #include "optional.hpp"
+#include "VROVector3f.h"
 #include "VROVector4f.h"
 #include "VROViewport.h"
+#include "VRORendererConfiguration.h"
 
 class VROScene;
 class VRODriver;
 class VROLight;
 class VROTexture;
 class VRORenderPass;
+class VRORenderPassInputOutput;
 class VRORenderTarget;
 class VRORenderContext;
 class VROImagePostProcess;
 class VROShaderProgram;
+class VRODynamicResolution;
+class VRORenderTargetPool;
+class VRORenderGraph;
 class VROToneMappingRenderPass;
 class VROGaussianBlurRenderPass;
+class VRODualFilterBloomRenderPass;
+class VROTemporalAntialiasingRenderPass;
 class VROPostProcessEffectFactory;
 class VRORenderMetadata;
 class VRORenderToTextureDelegate;
 class VROPreprocess;
 class VRORendererConfiguration;
+class VROLightClusterGrid;
+class VROOcclusionCuller;
 enum class VROPostProcessEffect;
 enum class VROEyeType;
 
+/*
+ Key of the scene color texture passed to each custom render pass (see
+ VROChoreographer::addCustomRenderPass).
+ */
+const std::string kCustomRenderPassInput = "CP_Input";
+
+/*
+ Samples per pixel of the HDR target when multisampling is enabled in the
+ renderer configuration.
+ */
+static const int kHDRMultisampleCount = 4;
+
 class VROChoreographer {
 public:
     
@@ -66,6 +89,20 @@ public:
                         const std::shared_ptr<VRORenderMetadata> &metadata,
                         VRORenderContext *context,
                         std::shared_ptr<VRODriver> &driver);
+
+    /*
+     Render the base pass for both eyes in a single pass, into the multiview HDR
+     target, using the per-eye matrices set on the context. The following render()
+     of each eye in this frame copies its layer out of the multiview target instead
+     of rendering the base pass again, then post-processes and tone-maps it as usual.
+     Returns false without rendering if multiview is unavailable in the current
+     configuration, in which case each eye is rendered in full by render().
+     */
+    bool renderMultiview(std::shared_ptr<VROScene> scene,
+                         std::shared_ptr<VROScene> outgoingScene,
+                         const std::shared_ptr<VRORenderMetadata> &metadata,
+                         VRORenderContext *context,
+                         std::shared_ptr<VRODriver> &driver);
     
     void setBaseRenderPass(std::shared_ptr<VRORenderPass> pass) {
         _baseRenderPass = pass;
@@ -99,18 +136,138 @@ public:
      supported by the device.
      */
     bool setShadowsEnabled(bool enableShadows);
+    bool isShadowsEnabled() const { return _shadowsEnabled; }
     
     /*
      Enable or disable rendering bloom. If bloom is not supported, this will
-     return false. Defaults to true if supported by the device.
+     return false. Defaults to true if supported by the device. The method
+     selects the blur used to spread the bloom.
      */
-    bool setBloomEnabled(bool enableBloom);
+    bool setBloomEnabled(bool enableBloom, VROBloomMethod method = VROBloomMethod::DualFilter);
+    bool isBloomEnabled() const { return _bloomEnabled; }
+    VROBloomMethod getBloomMethod() const {
+        return _bloomMethod;
+    }
 
     /*
      Enable or disable the additional rendering texture attachement needed
      for a post processing mask.
      */
     bool setPostProcessMaskEnabled(bool enableMask);
+    
+    /*
+     Enable or disable clustered lighting. When enabled, omni and spot lights that
+     do not cast shadows are binned each frame into a view frustum cluster grid,
+     and evaluated per fragment from that grid instead of being culled per node.
+     This lifts the per-object limit of kMaxLights for these lights. If clustered
+     lighting is not supported, this will return false. Defaults to false.
+     */
+    bool setClusteredLightingEnabled(bool enableClusteredLighting);
+    bool isClusteredLightingEnabled() const { return _clusteredLightingEnabled; }
+
+    /*
+     Set the depth pre-pass mode for the base render pass. See VRODepthPrepassMode.
+     Defaults to Disabled.
+     */
+    void setDepthPrepassMode(VRODepthPrepassMode mode) { _depthPrepassMode = mode; }
+    VRODepthPrepassMode getDepthPrepassMode() const { return _depthPrepassMode; }
+
+    /*
+     Enable or disable occlusion culling. When enabled, the bounds of visible
+     subtrees are tested against the depth pre-pass with hardware occlusion
+     queries, and subtrees found hidden are culled in subsequent frames. If
+     occlusion queries are not supported, this will return false. Defaults to false.
+     */
+    bool setOcclusionCullingEnabled(bool enableOcclusionCulling);
+    bool isOcclusionCullingEnabled() const { return _occlusionCullingEnabled; }
+    std::shared_ptr<VROOcclusionCuller> getOcclusionCuller() const { return _occlusionCuller; }
+
+    /*
+     Enable or disable weighted blended order independent transparency. When
+     enabled, alpha blended objects in the root portal are not sorted back to
+     front; they are accumulated in a separate pass and composited over the
+     scene when tone mapping. This requires HDR: while HDR is disabled, objects
+     are sorted as usual. If order independent transparency is not supported,
+     this will return false. Defaults to false.
+     */
+    bool setOrderIndependentTransparencyEnabled(bool enableOrderIndependentTransparency);
+    bool isOrderIndependentTransparencyEnabled() const {
+        return _orderIndependentTransparencyEnabled && _hdrEnabled;
+    }
+
+    /*
+     Enable or disable multiview rendering, in which renderMultiview draws the
+     base pass for both eyes with a single set of draw calls via OVR_multiview2.
+     Multiview requires HDR and is not used while clustered lighting, order
+     independent transparency, or temporal anti-aliasing is enabled (the cluster
+     grid is built for a single eye, the transparency accumulation targets are not
+     layered, and the jitter is applied per eye). If multiview
+     is not supported, this will return false. Defaults to true if supported by the
+     device.
+     */
+    bool setMultiviewEnabled(bool enableMultiview);
+    bool isMultiviewEnabled() const { return _multiviewEnabled; }
+
+    /*
+     Set the level of foveated rendering, which renders the periphery of each eye's
+     HDR target at reduced pixel density via QCOM_texture_foveated. Foveation only
+     applies to stereo (VR) rendering. If foveation is not supported, this will
+     return false; the level is retained regardless, so that VR runtimes with
+     their own foveation can read it. Defaults to the configured level.
+     */
+    bool setFoveationLevel(VROFoveationLevel level);
+    VROFoveationLevel getFoveationLevel() const { return _foveationLevel; }
+
+    /*
+     Set the level of variable rate shading. Each draw of the base pass selects its
+     rate from its content, and in VR the periphery of each eye (around the foveation
+     focal points) is shaded coarsely as well, where shading rate attachments are
+     supported. If variable rate shading is not supported, this will return false; the
+     level is retained regardless. Defaults to the configured level.
+     */
+    bool setShadingRateLevel(VROShadingRateLevel level);
+    VROShadingRateLevel getShadingRateLevel() const { return _shadingRateLevel; }
+
+    /*
+     Set the focal point of each eye in normalized device coordinates, around which
+     full pixel density is retained. Defaults to the center of each eye (fixed
+     foveation); platforms with eye tracking update these with the gaze each frame.
+     */
+    void setFoveationFocalPoints(VROVector3f left, VROVector3f right);
+
+    /*
+     Enable or disable dynamic resolution, which scales the resolution of the
+     HDR render targets according to recent GPU frame times (or frame intervals,
+     if GPU timers are unsupported). The scale is updated once per frame by
+     updateResolutionScale, and applied by the next setViewport. Only applies
+     when HDR is enabled. Defaults to the configured setting.
+     */
+    void setDynamicResolutionEnabled(bool enableDynamicResolution);
+    bool isDynamicResolutionEnabled() const { return _dynamicResolutionEnabled; }
+
+    /*
+     Enable or disable temporal anti-aliasing, which jitters the projection each
+     frame and accumulates the results into full (display) resolution history
+     (see VROTemporalAntialiasingRenderPass). Paired with dynamic resolution, this
+     reconstructs a full resolution image from a reduced scene resolution.
+     Requires HDR and a fifth draw buffer for velocities; if not supported, this
+     will return false. Defaults to the configured setting.
+     */
+    bool setTemporalAntialiasingEnabled(bool enableTemporalAntialiasing);
+    bool isTemporalAntialiasingEnabled() const { return _temporalAAEnabled; }
+    void updateResolutionScale(double frameInterval, std::shared_ptr<VRODriver> &driver);
+    
+    /*
+     Get the scale of the render targets relative to the viewport, which is 1.0
+     unless dynamic resolution is active.
+     */
+    float getResolutionScale() const;
+
+    /*
+     Cap the render scale (with HDR enabled) regardless of dynamic resolution. Used
+     by the VROQualityGovernor; 1.0 by default.
+     */
+    void setResolutionScaleLimit(float limit);
 
     /*
      Sets a delegate that is invoked each time a frame has been rendered. The delegate
@@ -120,6 +277,33 @@ public:
      Set to nullptr to disable render to texture.
      */
     void setRenderToTextureDelegate(std::shared_ptr<VRORenderToTextureDelegate> delegate);
+
+    /*
+     When render-on-demand is enabled, the final image of each frame is rendered to the
+     RTT target and blitted to the display, so that it can be presented again by
+     presentLastFrame() on frames where nothing has changed. Requires MRT support.
+     */
+    void setRenderOnDemandEnabled(bool enableRenderOnDemand);
+    bool isRenderOnDemandEnabled() const { return _renderOnDemandEnabled; }
+
+    /*
+     Blit the last rendered frame to the display without rendering the scene. Returns
+     false if there is no retained frame to present (e.g. render-on-demand is disabled,
+     or the render targets were recreated since the last frame), in which case the
+     frame must be rendered normally.
+     */
+    bool presentLastFrame(std::shared_ptr<VRODriver> driver);
+    
+    /*
+     Add a custom render pass, which runs on the HDR scene after post-processing and
+     before tone mapping. The pass receives the scene color in
+     inputs.textures[kCustomRenderPassInput], and must render its result to
+     inputs.outputTarget, a transient HDR target. Custom passes run in the order they
+     were added; adding a pass under an existing name replaces that pass. Custom
+     passes only run when HDR is enabled.
+     */
+    void addCustomRenderPass(std::string name, std::shared_ptr<VRORenderPass> pass);
+    void removeCustomRenderPass(std::string name);
     
     /*
      Render targets need to be recreated when the viewport size is changed. They
@@ -177,12 +361,19 @@ private:
      */
     bool _pbrSupported, _pbrEnabled;
     
+    /*
+     True if image-based diffuse lighting is computed as spherical harmonics rather
+     than as an irradiance map (see VROIBLPreprocess).
+     */
+    bool _sphericalHarmonicsIrradianceEnabled;
+    
     /*
      True if Bloom is supported/enabled. When Bloom is enabled, an additional
      color buffer is bound that receives bright colors via a special bloom shader
      modifier. This buffer is blurred and added back to the scene.
      */
     bool _bloomSupported, _bloomEnabled;
+    VROBloomMethod _bloomMethod;
 
     /*
      True if PostProcessMask is enabled. When enabled, materials targeting the
@@ -190,6 +381,70 @@ private:
      considered in the post-processing pass.
      */
     bool _postProcessMaskSupported, _postProcessMaskEnabled;
+    
+    /*
+     True if clustered lighting is supported/enabled. When enabled, the light
+     cluster grid is rebuilt for each eye and set on the render context.
+     */
+    bool _clusteredLightingSupported, _clusteredLightingEnabled;
+    VRODepthPrepassMode _depthPrepassMode;
+    std::shared_ptr<VROLightClusterGrid> _lightClusters;
+
+    /*
+     True if occlusion culling is supported/enabled. The culler retains the
+     outstanding queries and results across frames.
+     */
+    bool _occlusionCullingSupported, _occlusionCullingEnabled;
+    std::shared_ptr<VROOcclusionCuller> _occlusionCuller;
+
+    /*
+     True if order independent transparency is supported/enabled. The accumulation
+     buffers are owned by the HDR target.
+     */
+    bool _orderIndependentTransparencySupported, _orderIndependentTransparencyEnabled;
+
+    /*
+     True if multiview is supported/enabled. The multiview target mirrors the
+     HDR target's attachments with one layer per eye. The multiview frame is the
+     frame whose base pass it currently holds, or -1 if none.
+     */
+    bool _multiviewSupported, _multiviewEnabled;
+    std::shared_ptr<VRORenderTarget> _multiviewTarget;
+    int _multiviewFrame;
+    
+    /*
+     True if temporal anti-aliasing is supported/enabled. While enabled the HDR
+     target carries a velocity attachment (kTemporalAAVelocityAttachment).
+     */
+    bool _temporalAASupported, _temporalAAEnabled;
+    
+    /*
+     The number of samples per pixel of the HDR target. Multisampled rendering is
+     resolved on-tile where supported (see VRORenderTarget::setSampleCount).
+     */
+    int _hdrSampleCount;
+
+    /*
+     True if foveation is supported, the current foveation level, and the focal
+     point of each eye.
+     */
+    bool _foveationSupported;
+    VROFoveationLevel _foveationLevel;
+    std::vector<VROVector3f> _foveationFocalPoints;
+    
+    /*
+     True if variable rate shading is supported, and the current shading rate level.
+     */
+    bool _shadingRateSupported;
+    VROShadingRateLevel _shadingRateLevel;
+
+    /*
+     True if dynamic resolution is enabled, and the controller that chooses the
+     render scale.
+     */
+    bool _dynamicResolutionEnabled;
+    std::shared_ptr<VRODynamicResolution> _dynamicResolution;
+    float _resolutionScaleLimit;
 
     /*
      True if for the next frame render targets need to be recreated.
@@ -209,24 +464,95 @@ private:
     std::shared_ptr<VROImagePostProcess> _blitPostProcess;
     
     /*
-     Intermediate render target used for various post processes.
+     Pool from which the transient, full-screen intermediate targets of each frame
+     (the bloom composite, post-processing ping-pong and custom pass targets) are
+     acquired by the render graph. Targets whose lifetimes do not overlap share
+     memory, and targets for features that are not in use are never allocated.
      */
-    std::shared_ptr<VRORenderTarget> _blitTarget;
+    std::shared_ptr<VRORenderTargetPool> _targetPool;
+    
+    /*
+     The render graph that sequences the passes of each frame, and the key of the
+     features it was built for (-1 if it needs to be rebuilt).
+     */
+    std::shared_ptr<VRORenderGraph> _renderGraph;
+    int _renderGraphKey;
+    
+    /*
+     Custom render passes, with their names, in the order they run.
+     */
+    std::vector<std::pair<std::string, std::shared_ptr<VRORenderPass>>> _customRenderPasses;
     
     /*
      Created the required render targets given the current settings (e.g. _hdrEnabled,
      _pbrEnabled, etc.).
      */
     void createRenderTargets();
+
+    /*
+     Create the target to which frames are rendered when rendering to texture
+     or for render-on-demand, and the post-process that blits it to the
+     display. Only created when either is in use.
+     */
+    void createRenderToTextureTarget(std::shared_ptr<VRODriver> driver);
+
+    /*
+     Select the storage format of each attachment of the HDR (and multiview) targets,
+     given the current clear color. Masks are stored in R8, and when the clear color
+     is opaque (so alpha is not needed) the color and bloom attachments are stored in
+     R11G11B10F where the driver supports it.
+     */
+    void updateHDRAttachmentFormats(std::shared_ptr<VRODriver> driver);
     
     /*
-     Render the 3D scene (and an optional outgoing scene), and perform post-processing.
+     Render the 3D scene (and an optional outgoing scene), and perform post-processing,
+     by executing the render graph.
      */
     void renderScene(std::shared_ptr<VROScene> scene,
                      std::shared_ptr<VROScene> outgoingScene,
                      const std::shared_ptr<VRORenderMetadata> &metadata,
                      VRORenderContext *context, std::shared_ptr<VRODriver> &driver);
     
+    /*
+     Capture the impostors requested while updating the sort keys for this
+     frame, up to kMaxImpostorCapturesPerFrame. The rest are requested again
+     on later frames.
+     */
+    void captureImpostors(const std::shared_ptr<VRORenderMetadata> &metadata,
+                          VRORenderContext *context, std::shared_ptr<VRODriver> &driver);
+
+    /*
+     Rebuild the render graph for the features in the given key: the passes, the
+     resources they read and write, and the transient targets between them.
+     */
+    void buildRenderGraph(int key);
+
+    /*
+     Render the base pass to the given inputs' output target, or if this frame's base
+     pass was already rendered by renderMultiview, copy the current eye's layer into it.
+     */
+    void renderBasePass(std::shared_ptr<VROScene> scene,
+                        std::shared_ptr<VROScene> outgoingScene,
+                        VRORenderPassInputOutput &inputs,
+                        VRORenderContext *context, std::shared_ptr<VRODriver> &driver);
+
+    /*
+     True if renderMultiview can be used with the current settings.
+     */
+    bool isMultiviewAvailable() const;
+
+    /*
+     Update the foveation of the given base pass target for the eye (or eyes, when
+     multiview) currently being rendered.
+     */
+    void updateFoveation(std::shared_ptr<VRORenderTarget> target, VRORenderContext *context);
+    
+    /*
+     Update the peripheral shading rate of the given base pass target for the eye
+     currently being rendered.
+     */
+    void updatePeripheralShadingRate(std::shared_ptr<VRORenderTarget> target, VRORenderContext *context);
+    
 #pragma mark - Render to Texture
     
     /*
@@ -241,6 +567,13 @@ private:
      */
     std::shared_ptr<VRORenderToTextureDelegate> _renderToTextureDelegate;
 
+    /*
+     True if the final image is retained in the RTT target for render-on-demand, and
+     true once that target holds a complete frame that can be presented again.
+     */
+    bool _renderOnDemandEnabled;
+    bool _lastFrameRetained;
+
     /*
      Render the given tone-mapped and gamma-corrected input to the
      video texture and display.
@@ -248,6 +581,22 @@ private:
     void renderToTextureAndDisplay(std::shared_ptr<VRORenderTarget> input,
                                    std::shared_ptr<VRODriver> driver);
     
+    /*
+     True until the display fails to resolve into the RTT target. While true, the
+     scene is rendered directly to the display and its color is resolved into the
+     RTT target for the delegate, instead of blitting the RTT target to the display.
+     */
+    bool _displayResolveSupported;
+    
+    /*
+     Resolve the rendered display into the given RTT target and notify the delegate.
+     On failure, the render graph falls back to renderToTextureAndDisplay from the
+     next frame.
+     */
+    void resolveDisplayToTexture(std::shared_ptr<VRORenderTarget> display,
+                                 std::shared_ptr<VRORenderTarget> target,
+                                 std::shared_ptr<VRODriver> driver);
+    
 #pragma mark - Shadows
     
     /*
@@ -274,6 +623,18 @@ private:
      */
     std::shared_ptr<VROGaussianBlurRenderPass> _gaussianBlurPass;
     
+    /*
+     Render pass that blurs bloom through a downsampled mip chain, used when the
+     bloom method is DualFilter.
+     */
+    std::shared_ptr<VRODualFilterBloomRenderPass> _dualFilterBloomPass;
+    
+    /*
+     Render pass that resolves the jittered scene against its history, when
+     temporal anti-aliasing is enabled.
+     */
+    std::shared_ptr<VROTemporalAntialiasingRenderPass> _temporalAAPass;
+    
     /*
      Additive blending post process for mapping the blur texture back onto the
      main texture.
@@ -286,12 +647,6 @@ private:
      Factory that coordinates the creation and application of post processing effects.
      */
     std::shared_ptr<VROPostProcessEffectFactory> _postProcessEffectFactory;
-
-    /*
-     Intermediate targets used for post-processing effects.
-     */
-    std::shared_ptr<VRORenderTarget> _postProcessTargetA;
-    std::shared_ptr<VRORenderTarget> _postProcessTargetB;
     
 #pragma mark - Preprocessing
     
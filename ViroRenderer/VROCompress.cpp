@@ -30,6 +30,10 @@
 #include <iomanip>
 #include <sstream>
 #include <cstring>
+#include <climits>
+#include <algorithm>
+#include "VROAtomic.h"
+#include "VROJobSystem.h"
 
 std::string VROCompress::compress(const std::string &str, int compressionlevel) {
     z_stream zs;
@@ -69,41 +73,426 @@ std::string VROCompress::compress(const std::string &str, int compressionlevel)
     return outstring;
 }
 
-std::string VROCompress::decompress(const std::string &str) {
+/*
+ Inflation runs in parallel only for multi-member data at least this large,
+ batching this many members per job.
+ */
+static const size_t kParallelInflateMinLength = 256 * 1024;
+static const int kParallelInflateMembersPerJob = 8;
+
+/*
+ Minimum initial output capacity when the output size is not recorded.
+ */
+static const size_t kMinInflateCapacity = 4096;
+
+/*
+ The largest initial output capacity, as a multiple of the input length. Recorded
+ output sizes are only hints (they may be corrupt, or cover only the last member),
+ so beyond this the output buffer grows as it is filled.
+ */
+static const size_t kMaxInflateCapacityRatio = 16;
+
+/*
+ Deflate cannot expand data by more than this ratio. Members that record larger
+ output sizes are corrupt.
+ */
+static const size_t kMaxDeflateRatio = 1032;
+
+/*
+ Size and number of the chunks VROInflateStream inflates ahead of its consumer.
+ */
+static const int kInflateStreamChunkSize = 256 * 1024;
+static const int kInflateStreamNumChunks = 4;
+
+/*
+ A member of a gzip file: the range of its deflate data, and the size and
+ checksum of its output.
+ */
+struct VROGzipMember {
+    size_t dataOffset;
+    size_t dataLength;
+    size_t outputOffset;
+    uint32_t outputLength;
+    uint32_t crc;
+};
+
+static uint32_t VROReadLE32(const Bytef *data) {
+    return (uint32_t) data[0] | ((uint32_t) data[1] << 8) | ((uint32_t) data[2] << 16) | ((uint32_t) data[3] << 24);
+}
+
+static uint16_t VROReadLE16(const Bytef *data) {
+    return (uint16_t) (data[0] | (data[1] << 8));
+}
+
+static bool VROIsGzip(const Bytef *data, size_t length) {
+    return length >= 18 && data[0] == 0x1f && data[1] == 0x8b && data[2] == Z_DEFLATED;
+}
+
+/*
+ Parse the header of the gzip member at the given offset, returning the offset
+ of its deflate data. The member's total length is returned if it's recorded
+ in a BGZF ('BC') extra subfield, and zero otherwise. Returns false if the
+ header is invalid.
+ */
+static bool VROParseGzipHeader(const Bytef *data, size_t length, size_t offset,
+                               size_t *outDataOffset, size_t *outMemberLength) {
+    if (!VROIsGzip(data + offset, length - offset)) {
+        return false;
+    }
+    uint8_t flags = data[offset + 3];
+    size_t p = offset + 10;
+    *outMemberLength = 0;
+    
+    if (flags & 0x04) { // FEXTRA
+        if (p + 2 > length) {
+            return false;
+        }
+        size_t extraEnd = p + 2 + VROReadLE16(data + p);
+        if (extraEnd > length) {
+            return false;
+        }
+        p += 2;
+        while (p + 4 <= extraEnd) {
+            uint16_t subfieldLength = VROReadLE16(data + p + 2);
+            if (data[p] == 'B' && data[p + 1] == 'C' && subfieldLength == 2 && p + 6 <= extraEnd) {
+                *outMemberLength = (size_t) VROReadLE16(data + p + 4) + 1;
+            }
+            p += 4 + subfieldLength;
+        }
+        p = extraEnd;
+    }
+    for (uint8_t field = 0x08; field <= 0x10; field <<= 1) { // FNAME, FCOMMENT
+        if (flags & field) {
+            while (p < length && data[p] != 0) {
+                ++p;
+            }
+            if (++p > length) {
+                return false;
+            }
+        }
+    }
+    if (flags & 0x02) { // FHCRC
+        p += 2;
+    }
+    *outDataOffset = p;
+    return p <= length;
+}
+
+/*
+ Find the members of the given gzip data. Returns false unless they all record
+ their lengths, and there is more than one.
+ */
+static bool VROFindGzipMembers(const Bytef *data, size_t length, std::vector<VROGzipMember> *outMembers) {
+    size_t offset = 0;
+    size_t outputOffset = 0;
+    while (offset < length) {
+        size_t dataOffset, memberLength;
+        if (!VROParseGzipHeader(data, length, offset, &dataOffset, &memberLength) ||
+            memberLength == 0 || offset + memberLength > length || dataOffset + 8 > offset + memberLength) {
+            return false;
+        }
+        const Bytef *trailer = data + offset + memberLength - 8;
+        
+        VROGzipMember member;
+        member.dataOffset = dataOffset;
+        member.dataLength = offset + memberLength - 8 - dataOffset;
+        member.outputOffset = outputOffset;
+        member.crc = VROReadLE32(trailer);
+        member.outputLength = VROReadLE32(trailer + 4);
+        if (member.outputLength > member.dataLength * kMaxDeflateRatio + kMinInflateCapacity) {
+            return false;
+        }
+        outMembers->push_back(member);
+        
+        outputOffset += member.outputLength;
+        offset += memberLength;
+    }
+    return outMembers->size() > 1;
+}
+
+/*
+ Inflate the given raw deflate data, which must produce exactly the given output.
+ */
+static bool VROInflateMember(const Bytef *data, const VROGzipMember &member, Bytef *output) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, -MAX_WBITS) != Z_OK) {
+        return false;
+    }
+    zs.next_in = (Bytef *) data + member.dataOffset;
+    zs.avail_in = (unsigned int) member.dataLength;
+    zs.next_out = output;
+    zs.avail_out = member.outputLength;
+    
+    int ret = inflate(&zs, Z_FINISH);
+    bool success = ret == Z_STREAM_END && zs.total_out == member.outputLength &&
+                   crc32(0, output, member.outputLength) == member.crc;
+    inflateEnd(&zs);
+    return success;
+}
+
+/*
+ Inflate zlib or (possibly multi-member) gzip data in sequence, directly into the
+ output string.
+ */
+static bool VROInflateSequential(const Bytef *data, size_t length, std::string *outData) {
     z_stream zs;
     memset(&zs, 0, sizeof(zs));
     
-    if (inflateInit(&zs) != Z_OK) {
+    // Detect the zlib or gzip header automatically
+    if (inflateInit2(&zs, MAX_WBITS + 32) != Z_OK) {
         pwarn("inflateInit failed while decompressing");
-        return "";
+        return false;
     }
     
-    zs.next_in = (Bytef*)str.data();
-    zs.avail_in = (unsigned int)str.size();
+    // Gzip records the output size of its last member, which for the usual single
+    // member is the size of the whole output. It is only trusted up to a bound, so
+    // that a corrupt size cannot force a huge allocation
+    bool gzip = VROIsGzip(data, length);
+    size_t capacity = gzip ? VROReadLE32(data + length - 4) : length * 4;
+    capacity = std::min(capacity, length * kMaxInflateCapacityRatio);
+    outData->resize(std::max(capacity, kMinInflateCapacity));
     
+    size_t consumed = 0;
+    size_t produced = 0;
     int ret;
-    char outbuffer[32768];
+    while (true) {
+        if (produced == outData->size()) {
+            outData->resize(outData->size() * 2);
+        }
+        unsigned int availIn = (unsigned int) std::min(length - consumed, (size_t) UINT_MAX);
+        unsigned int availOut = (unsigned int) std::min(outData->size() - produced, (size_t) UINT_MAX);
+        zs.next_in = (Bytef *) data + consumed;
+        zs.avail_in = availIn;
+        zs.next_out = (Bytef *) &(*outData)[produced];
+        zs.avail_out = availOut;
+        
+        ret = inflate(&zs, Z_NO_FLUSH);
+        consumed += availIn - zs.avail_in;
+        produced += availOut - zs.avail_out;
+        
+        if (ret == Z_STREAM_END) {
+            // Inflate concatenated gzip members one after the other
+            if (gzip && VROIsGzip(data + consumed, length - consumed)) {
+                inflateReset(&zs);
+                continue;
+            }
+            break;
+        }
+        if (ret != Z_OK && !(ret == Z_BUF_ERROR && zs.avail_out == 0)) {
+            break;
+        }
+        if (ret == Z_OK && consumed == length && zs.avail_out > 0) {
+            ret = Z_DATA_ERROR; // Truncated
+            break;
+        }
+    }
+    
+    inflateEnd(&zs);
+    if (ret != Z_STREAM_END) {
+        pwarn("Error during zlib decompression [ret: %d, message: %s]", ret, zs.msg ? zs.msg : "");
+        outData->clear();
+        return false;
+    }
+    outData->resize(produced);
+    return true;
+}
+
+std::string VROCompress::decompress(const std::string &str) {
     std::string outstring;
+    decompress(str.data(), str.size(), &outstring);
+    return outstring;
+}
+
+bool VROCompress::decompress(const void *data, size_t length, std::string *outData) {
+    const Bytef *bytes = (const Bytef *) data;
     
-    do {
-        zs.next_out = reinterpret_cast<Bytef*>(outbuffer);
-        zs.avail_out = sizeof(outbuffer);
+    std::vector<VROGzipMember> members;
+    if (length < kParallelInflateMinLength || !VROIsGzip(bytes, length) ||
+        !VROFindGzipMembers(bytes, length, &members)) {
+        return VROInflateSequential(bytes, length, outData);
+    }
+    
+    // Each member inflates into its own range of the output
+    const VROGzipMember &last = members.back();
+    outData->resize(last.outputOffset + last.outputLength);
+    Bytef *output = (Bytef *) &(*outData)[0];
+    
+    VROAtomic<bool> failed(false);
+    VROJobSystem::getShared()->parallelFor(0, (int) members.size(), kParallelInflateMembersPerJob,
+                                     [bytes, output, &members, &failed] (int i) {
+        if (!VROInflateMember(bytes, members[i], output + members[i].outputOffset)) {
+            failed = true;
+        }
+    });
+    if (failed) {
+        pwarn("Error during parallel gzip decompression");
+        outData->clear();
+        return false;
+    }
+    return true;
+}
+
+bool VROCompress::isParallelDecompressible(const void *data, size_t length) {
+    std::vector<VROGzipMember> members;
+    return length >= kParallelInflateMinLength && VROIsGzip((const Bytef *) data, length) &&
+           VROFindGzipMembers((const Bytef *) data, length, &members);
+}
+
+#pragma mark - VROInflateStream
+
+VROInflateStream::VROInflateStream(const void *data, size_t length) :
+    _data((const Bytef *) data),
+    _length(length),
+    _gzip(VROIsGzip((const Bytef *) data, length)),
+    _finished(false),
+    _error(false),
+    _heldBuffer(-1) {
+    
+    memset(&_zs, 0, sizeof(_zs));
+    if (inflateInit2(&_zs, MAX_WBITS + 32) != Z_OK) {
+        pwarn("inflateInit failed while decompressing");
+        _finished = true;
+        _error = true;
+        return;
+    }
+    _zs.next_in = (Bytef *) data;
+    _zs.avail_in = (unsigned int) std::min(length, (size_t) UINT_MAX);
+    
+#if VRO_THREADS
+    int numBuffers = kInflateStreamNumChunks;
+#else
+    int numBuffers = 1;
+#endif
+    _buffers.resize(numBuffers);
+    for (int i = 0; i < numBuffers; i++) {
+        _buffers[i].resize(kInflateStreamChunkSize);
+        _freeBuffers.push_back(i);
+    }
+    
+#if VRO_THREADS
+    _cancelled = false;
+    _producer = std::thread(&VROInflateStream::produce, this);
+#endif
+}
+
+VROInflateStream::~VROInflateStream() {
+#if VRO_THREADS
+    if (_producer.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _cancelled = true;
+        }
+        _condition.notify_all();
+        _producer.join();
+    }
+#endif
+    inflateEnd(&_zs);
+}
+
+int VROInflateStream::inflateChunk(std::vector<Bytef> &buffer, bool *outEnd) {
+    _zs.next_out = buffer.data();
+    _zs.avail_out = (unsigned int) buffer.size();
+    *outEnd = false;
+    
+    while (_zs.avail_out > 0) {
+        // Refill the input, for data beyond the range of a single z_stream
+        if (_zs.avail_in == 0) {
+            size_t consumed = _zs.next_in - _data;
+            _zs.avail_in = (unsigned int) std::min(_length - consumed, (size_t) UINT_MAX);
+        }
         
-        ret = inflate(&zs, 0);
+        int ret = inflate(&_zs, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END) {
+            size_t consumed = _zs.next_in - _data;
+            if (_gzip && VROIsGzip(_data + consumed, _length - consumed)) {
+                inflateReset(&_zs);
+                continue;
+            }
+            *outEnd = true;
+            break;
+        }
+        if (ret != Z_OK || (_zs.avail_in == 0 && (size_t) (_zs.next_in - _data) == _length && _zs.avail_out > 0)) {
+            pwarn("Error during zlib stream decompression [ret: %d, message: %s]", ret, _zs.msg ? _zs.msg : "");
+            return -1;
+        }
+    }
+    return (int) (buffer.size() - _zs.avail_out);
+}
+
+#if VRO_THREADS
+
+void VROInflateStream::produce() {
+    while (true) {
+        int index;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _condition.wait(lock, [this] { return _cancelled || !_freeBuffers.empty(); });
+            if (_cancelled) {
+                return;
+            }
+            index = _freeBuffers.front();
+            _freeBuffers.pop_front();
+        }
         
-        if (outstring.size() < zs.total_out) {
-            outstring.append(outbuffer,
-                             zs.total_out - outstring.size());
+        bool end;
+        int size = inflateChunk(_buffers[index], &end);
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (size > 0) {
+                _filledBuffers.push_back({ index, size });
+            } else {
+                _freeBuffers.push_back(index);
+            }
+            _finished = end || size < 0;
+            _error = size < 0;
         }
+        _condition.notify_all();
         
-    } while (ret == Z_OK);
-    
-    inflateEnd(&zs);
+        if (end || size < 0) {
+            return;
+        }
+    }
+}
+
+bool VROInflateStream::next(const void **outData, int *outSize) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (_heldBuffer >= 0) {
+        _freeBuffers.push_back(_heldBuffer);
+        _heldBuffer = -1;
+        _condition.notify_all();
+    }
+    _condition.wait(lock, [this] { return _finished || !_filledBuffers.empty(); });
     
-    if (ret != Z_STREAM_END) {          // an error occurred that was not EOF
-        pwarn("Error during zlib decompression [ret: %d, message: %s]", ret, zs.msg);
-        return "";
+    // Chunks inflated before an error are withheld, as the data is invalid
+    if (_filledBuffers.empty() || _error) {
+        return false;
     }
+    std::pair<int, int> filled = _filledBuffers.front();
+    _filledBuffers.pop_front();
     
-    return outstring;
+    _heldBuffer = filled.first;
+    *outData = _buffers[filled.first].data();
+    *outSize = filled.second;
+    return true;
 }
+
+#else
+
+bool VROInflateStream::next(const void **outData, int *outSize) {
+    if (_finished) {
+        return false;
+    }
+    bool end;
+    int size = inflateChunk(_buffers[0], &end);
+    _finished = end || size < 0;
+    _error = size < 0;
+    if (size <= 0) {
+        return false;
+    }
+    *outData = _buffers[0].data();
+    *outSize = size;
+    return true;
+}
+
+#endif
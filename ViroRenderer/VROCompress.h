@@ -29,7 +29,16 @@
 
 #include <stdio.h>
 #include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
 #include <zlib.h>
+#include "VRODefines.h"
+
+#if VRO_THREADS
+#include <thread>
+#endif
 
 class VROCompress {
     
@@ -48,6 +57,84 @@ public:
      */
     static std::string decompress(const std::string &str);
     
+    /*
+     Decompress zlib or gzip data into the given string, returning false on error.
+     The output is inflated in place, sized up front from the gzip trailer when
+     present. Concatenated (multi-member) gzip is supported; if every member records
+     its size in a BGZF extra subfield, as written by our export tools (and bgzip),
+     the members are inflated in parallel.
+     */
+    static bool decompress(const void *data, size_t length, std::string *outData);
+    
+    /*
+     Returns true if the given data is multi-member gzip whose members can be
+     inflated in parallel by decompress().
+     */
+    static bool isParallelDecompressible(const void *data, size_t length);
+    
+};
+
+/*
+ Inflates zlib or gzip data a few chunks ahead of its consumer on a background
+ thread, so that decompression overlaps with the consumer's work (e.g. parsing).
+ Chunks are returned in order by next(), and each remains valid until the next
+ call. Without threads, each chunk is inflated on demand within next(). The
+ compressed data must outlive the stream.
+ */
+class VROInflateStream {
+    
+public:
+    
+    VROInflateStream(const void *data, size_t length);
+    virtual ~VROInflateStream();
+    
+    /*
+     Get the next chunk of output. Returns false at the end of the data, or on
+     error.
+     */
+    bool next(const void **outData, int *outSize);
+    
+    /*
+     True if the data failed to inflate. Only valid once next() returns false.
+     */
+    bool hasError() const {
+        return _error;
+    }
+    
+private:
+    
+    z_stream _zs;
+    const Bytef *_data;
+    size_t _length;
+    bool _gzip;
+    bool _finished;
+    bool _error;
+    
+    /*
+     The chunk buffers, the indices of those free to be filled, and those filled
+     (with their sizes) awaiting the consumer. The consumer holds at most one
+     chunk at a time, returning it on its next call.
+     */
+    std::vector<std::vector<Bytef>> _buffers;
+    std::deque<int> _freeBuffers;
+    std::deque<std::pair<int, int>> _filledBuffers;
+    int _heldBuffer;
+    
+    /*
+     Inflate the next chunk into the given buffer, returning its size, or -1 on
+     error. Sets outEnd once the end of the data is reached.
+     */
+    int inflateChunk(std::vector<Bytef> &buffer, bool *outEnd);
+    
+#if VRO_THREADS
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    bool _cancelled;
+    std::thread _producer;
+    
+    void produce();
+#endif
+    
 };
 
 #endif /* VROCompress_hpp */
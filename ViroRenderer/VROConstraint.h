@@ -35,6 +35,8 @@ class VROMatrix4f;
 class VROQuaternion;
 class VROVector3f;
 class VRORenderContext;
+class VROShaderModifier;
+
 enum class VROConstraintType {
     Billboard,
     Bone
@@ -49,6 +51,16 @@ public:
     virtual VROConstraintType getConstraintType() {
         return VROConstraintType::Billboard;
     }
+    
+    /*
+     If this constraint can instead be applied by the vertex shader, returns the
+     geometry shader modifier that applies it. VRONode installs the modifier on its
+     geometry's materials when the constraint is added, and skips getTransform()
+     for nodes without children whose materials carry the modifier.
+     */
+    virtual std::shared_ptr<VROShaderModifier> getShaderModifier() {
+        return nullptr;
+    }
 };
 
 #endif /* VROConstraint_h */
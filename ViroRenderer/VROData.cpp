@@ -25,9 +25,12 @@
 //  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "VROData.h"
+#include "VROAllocationTracker.h"
+#include "VROPlatformUtil.h"
 
 VROData::VROData(void *data, int dataLength, VRODataOwnership ownership) :
-    _ownership(ownership) {
+    _ownership(ownership),
+    _string(nullptr) {
         
     if (ownership == VRODataOwnership::Copy) {
         _data = malloc(dataLength);
@@ -38,19 +41,65 @@ VROData::VROData(void *data, int dataLength, VRODataOwnership ownership) :
         _data = data;
         _dataLength = dataLength;
     }
+    if (ownership != VRODataOwnership::Wrap) {
+        ALLOCATION_TRACKER_ADD(DataMemory, _dataLength);
+    }
 }
 
 VROData::VROData(const void *data, int dataLength, int byteOffset) :
-    _ownership(VRODataOwnership::Copy) {
+    _ownership(VRODataOwnership::Copy),
+    _string(nullptr) {
     _data = malloc(dataLength);
     _dataLength = dataLength;
 
     const void *startingDataPoint = ((char*)data) + byteOffset;
     memcpy(_data, startingDataPoint, dataLength);
+    ALLOCATION_TRACKER_ADD(DataMemory, _dataLength);
+}
+
+VROData::VROData(std::string *string) :
+    _ownership(VRODataOwnership::Wrap),
+    _string(string) {
+    _data = &(*string)[0];
+    _dataLength = (int) string->length();
+    ALLOCATION_TRACKER_ADD(DataMemory, _dataLength);
+}
+
+VROData::VROData(const void *data, int dataLength, std::shared_ptr<const void> owner) :
+    _data((void *) data),
+    _dataLength(dataLength),
+    _ownership(VRODataOwnership::Wrap),
+    _string(nullptr),
+    _owner(owner) {
+}
+
+VROData::VROData(std::shared_ptr<VROData> parent, int byteOffset, int dataLength) :
+    _data((char *) parent->getData() + byteOffset),
+    _dataLength(dataLength),
+    _ownership(VRODataOwnership::Wrap),
+    _string(nullptr),
+    _owner(parent) {
+}
+
+std::shared_ptr<VROData> VROData::mapFile(std::string path) {
+    size_t length = 0;
+    const void *data = VROPlatformMapFile(path, &length);
+    if (!data) {
+        return nullptr;
+    }
+    std::shared_ptr<const void> mapping(data, [length](const void *mapped) {
+        VROPlatformUnmapFile(mapped, length);
+    });
+    return std::make_shared<VROData>(data, (int) length, mapping);
 }
 
 VROData::~VROData() {
     if (_ownership == VRODataOwnership::Copy || _ownership == VRODataOwnership::Move) {
         free (_data);
+        ALLOCATION_TRACKER_SUB(DataMemory, _dataLength);
+    }
+    else if (_string) {
+        ALLOCATION_TRACKER_SUB(DataMemory, _dataLength);
     }
+    delete (_string);
 }
@@ -30,6 +30,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <string>
+#include <memory>
 
 /*
  Defines how the VROData holds onto its underlying data.
@@ -63,6 +65,33 @@ public:
      */
     VROData(const void *data, int dataLength, int byteOffset = 0);
 
+    /*
+     Construct a new VROData that takes ownership of the given string, holding its
+     contents without copying them. The string is deleted on destruction.
+     */
+    VROData(std::string *string);
+
+    /*
+     Construct a new VROData that wraps the given data, which is owned by the
+     given object (e.g. a memory mapping). The owner is retained until this
+     VROData is destroyed.
+     */
+    VROData(const void *data, int dataLength, std::shared_ptr<const void> owner);
+
+    /*
+     Construct a new VROData that is a slice of the given parent: it reads the
+     dataLength bytes starting at byteOffset in the parent, without copying them,
+     and retains the parent until this VROData is destroyed.
+     */
+    VROData(std::shared_ptr<VROData> parent, int byteOffset, int dataLength);
+
+    /*
+     Memory map the file at the given path into a VROData, which unmaps it when
+     destroyed (slices retain the mapping). Returns nullptr if the file could
+     not be mapped.
+     */
+    static std::shared_ptr<VROData> mapFile(std::string path);
+
     ~VROData();
     
     void *const getData() {
@@ -78,6 +107,8 @@ private:
     int _dataLength;
     
     VRODataOwnership _ownership;
+    std::string *_string;
+    std::shared_ptr<const void> _owner;
     
 };
 
@@ -29,18 +29,51 @@
 #include "VROLog.h"
 #include "VROMaterial.h"
 #include "VROGeometry.h"
+#include "VROGeometrySource.h"
+#include "VROGeometryElement.h"
+#include "VROSurface.h"
 #include "VROText.h"
 #include "VROTypeface.h"
 #include "VROStringUtil.h"
 #include "VRORenderMetadata.h"
 #include "VROTypefaceCollection.h"
+#include "VROProfiler.h"
+#include "VROAllocationTracker.h"
+#include "VROFrameScheduler.h"
+#include "VRODriver.h"
+#include "VROData.h"
+#include <algorithm>
 
-// Frames between FPS text refresh
-static const int kFPSRefreshRate = 60;
+// Number of samples displayed by each graph
+static const int kHUDHistory = 90;
+
+// Frames between graph and label refreshes
+static const int kHUDBarRefreshRate = 5;
+static const int kHUDTextRefreshRate = 30;
+
+// Layout of the HUD, in world units (before the HUD is positioned)
+static const VROVector3f kHUDPosition = { -0.6, 0.55, -2.5 };
+static const int kHUDFontSize = 24;
+static const float kHUDTextScale = 0.25;
+static const float kHUDLabelWidth = 3.2;
+static const float kHUDRowHeight = 0.07;
+static const float kHUDGraphWidth = 0.6;
+static const float kHUDGraphHeight = 0.05;
+static const float kHUDGraphSpacing = 0.04;
+static const float kHUDBarFill = 0.8;
+
+static const VROVector4f kHUDTimeColor   = { 0.6, 1.0, 0.6, 1.0 };
+static const VROVector4f kHUDCountColor  = { 0.6, 0.8, 1.0, 1.0 };
+static const VROVector4f kHUDMemoryColor = { 1.0, 0.8, 0.5, 1.0 };
+
+static const double kBytesPerMB = 1024.0 * 1024.0;
 
 VRODebugHUD::VRODebugHUD() :
-    _enabled(false) {
-    
+    _enabled(false),
+    _enabledProfiler(false),
+    _enabledGPUTimer(false),
+    _lastTransformFrame(-1) {
+    std::fill(_phaseNanoseconds, _phaseNanoseconds + 3, 0);
 }
 
 VRODebugHUD::~VRODebugHUD() {
@@ -49,56 +82,285 @@ VRODebugHUD::~VRODebugHUD() {
 
 void VRODebugHUD::initRenderer(std::shared_ptr<VRODriver> driver) {
     _node = std::make_shared<VRONode>();
-
+    _node->setPosition(kHUDPosition);
+    
+    std::vector<int> indices;
+    indices.reserve(kHUDHistory * 6);
+    for (int i = 0; i < kHUDHistory; i++) {
+        int v = i * 4;
+        indices.insert(indices.end(), { v, v + 1, v + 2, v, v + 2, v + 3 });
+    }
+    std::shared_ptr<VROData> indexData = std::make_shared<VROData>((void *) indices.data(),
+                                                                   (int) (indices.size() * sizeof(int)));
+    _barElement = std::make_shared<VROGeometryElement>(indexData, VROGeometryPrimitiveType::Triangle,
+                                                       kHUDHistory * 2, sizeof(int));
+    
+    addGraph("Prepare",         "ms", 2, kHUDTimeColor,   driver);
+    addGraph("Render",          "ms", 2, kHUDTimeColor,   driver);
+    addGraph("End",             "ms", 2, kHUDTimeColor,   driver);
+    addGraph("GPU",             "ms", 2, kHUDTimeColor,   driver);
+    addGraph("Draw calls",      "",   0, kHUDCountColor,  driver);
+    addGraph("Triangles",       "k",  1, kHUDCountColor,  driver);
+    addGraph("State changes",   "",   0, kHUDCountColor,  driver);
+    addGraph("Shader compiles", "",   0, kHUDCountColor,  driver);
+    addGraph("Texture uploads", "",   0, kHUDCountColor,  driver);
+    addGraph("Task backlog",    "",   0, kHUDCountColor,  driver);
+    addGraph("GPU memory",      "MB", 1, kHUDMemoryColor, driver);
+    addGraph("CPU data",        "MB", 1, kHUDMemoryColor, driver);
+    
     /*
-     We have to preload all glyphs that will be used for displaying FPS
-     because VROTypeface cannot load new glyphs in the midst of a render-cycle
-     (loading glyphs modifies the OpenGL context).
+     We have to preload all glyphs that will be used by the labels because
+     VROTypeface cannot load new glyphs in the midst of a render-cycle (loading
+     glyphs modifies the OpenGL context).
      */
-    _text = VROText::createSingleLineText(L"0.0",
-                                          "Helvetica", 26, VROFontStyle::Normal, VROFontWeight::Regular,
-                                          { 0.6, 1.0, 0.6, 1.0 }, 0, driver);
-    for (const std::shared_ptr<VROTypeface> &typeface : _text->getTypefaceCollection()->getTypefaces()) {
-        typeface->preloadGlyphs("0123456789.");
+    std::string glyphs = "0123456789.-() kMBms";
+    for (VRODebugHUDGraph &graph : _graphs) {
+        glyphs += graph.label;
+    }
+    for (const std::shared_ptr<VROTypeface> &typeface : _graphs.front().text->getTypefaceCollection()->getTypefaces()) {
+        typeface->preloadGlyphs(glyphs);
+    }
+    for (VRODebugHUDGraph &graph : _graphs) {
+        updateText(graph);
+    }
+    
+    // A translucent backdrop behind the rows keeps the HUD legible over bright scenes
+    float width = kHUDLabelWidth * kHUDTextScale + kHUDGraphSpacing + kHUDGraphWidth;
+    float height = _graphs.size() * kHUDRowHeight;
+    std::shared_ptr<VROSurface> surface = VROSurface::createSurface(width + 0.04, height + 0.02);
+    const std::shared_ptr<VROMaterial> &material = surface->getMaterials().front();
+    material->setLightingModel(VROLightingModel::Constant);
+    material->getDiffuse().setColor({ 0.0, 0.0, 0.0, 0.5 });
+    material->setWritesToDepthBuffer(false);
+    material->setReadsFromDepthBuffer(false);
+    material->setCullMode(VROCullMode::None);
+    
+    _backdrop = std::make_shared<VRONode>();
+    _backdrop->setGeometry(surface);
+    _backdrop->setPosition({ width / 2.0f, -height / 2.0f + kHUDRowHeight / 2.0f, -0.01 });
+    _node->addChildNode(_backdrop);
+    
+    for (VRODebugHUDGraph &graph : _graphs) {
+        _node->addChildNode(graph.textNode);
+        _node->addChildNode(graph.barsNode);
     }
-    _node->setPosition({-.5, .5, -2.5});
+}
+
+void VRODebugHUD::addGraph(std::string label, std::string unit, int precision, VROVector4f color,
+                           std::shared_ptr<VRODriver> driver) {
+    float y = -(float) _graphs.size() * kHUDRowHeight;
+    
+    VRODebugHUDGraph graph;
+    graph.label = label;
+    graph.unit = unit;
+    graph.precision = precision;
+    graph.color = color;
+    graph.samples.resize(kHUDHistory, 0);
+    graph.head = 0;
+    
+    graph.text = VROText::createSingleLineText(std::wstring(label.begin(), label.end()),
+                                               "Helvetica", kHUDFontSize, VROFontStyle::Normal, VROFontWeight::Regular,
+                                               color, 0, kHUDLabelWidth, VROTextHorizontalAlignment::Left,
+                                               VROTextClipMode::None, driver);
+    graph.textNode = std::make_shared<VRONode>();
+    graph.textNode->setScale({ kHUDTextScale, kHUDTextScale, kHUDTextScale });
+    graph.textNode->setPosition({ kHUDLabelWidth * kHUDTextScale / 2.0f, y, 0 });
+    
+    std::shared_ptr<VROMaterial> material = std::make_shared<VROMaterial>();
+    material->setLightingModel(VROLightingModel::Constant);
+    material->getDiffuse().setColor(color);
+    material->setWritesToDepthBuffer(false);
+    material->setReadsFromDepthBuffer(false);
+    material->setCullMode(VROCullMode::None);
+    
+    graph.bars = std::make_shared<VROGeometry>(std::vector<std::shared_ptr<VROGeometrySource>>(),
+                                               std::vector<std::shared_ptr<VROGeometryElement>>{ _barElement });
+    graph.bars->setDynamic(true);
+    graph.bars->setMaterials({ material });
+    graph.barsNode = std::make_shared<VRONode>();
+    graph.barsNode->setPosition({ kHUDLabelWidth * kHUDTextScale + kHUDGraphSpacing,
+                                  y - kHUDGraphHeight / 2.0f, 0 });
+    graph.barsNode->setGeometry(graph.bars);
+    
+    _graphs.push_back(graph);
+    updateBars(_graphs.back());
 }
 
 void VRODebugHUD::setEnabled(bool enabled) {
+    if (enabled == _enabled) {
+        return;
+    }
     _enabled = enabled;
+    
+    // The HUD reads its counters from the profiler, which only counts while enabled
+    if (enabled && !VROProfiler::isEnabled()) {
+        VROProfiler::setEnabled(true);
+        _enabledProfiler = true;
+    }
+    else if (!enabled && _enabledProfiler) {
+        VROProfiler::setEnabled(false);
+        _enabledProfiler = false;
+    }
 }
 
-void VRODebugHUD::prepare(const VRORenderContext &context) {
+void VRODebugHUD::addPhaseTime(VRODebugHUDPhase phase, uint64_t nanoseconds) {
     if (!_enabled) {
         return;
     }
-    if (context.getFrame() % kFPSRefreshRate == 0) {
-        _text->setText(VROStringUtil::toWString(context.getFPS(), 2));
-        _node->setGeometry(_text);
+    _phaseNanoseconds[(int) phase] += nanoseconds;
+}
+
+void VRODebugHUD::prepare(const VRORenderContext &context) {
+    if (!_enabled || !_node) {
+        return;
+    }
+    int frame = context.getFrame();
+    if (frame % kHUDBarRefreshRate == 0) {
+        for (VRODebugHUDGraph &graph : _graphs) {
+            updateBars(graph);
+        }
+    }
+    if (frame % kHUDTextRefreshRate == 0) {
+        for (VRODebugHUDGraph &graph : _graphs) {
+            updateText(graph);
+        }
     }
 }
 
 void VRODebugHUD::renderEye(VROEyeType eye, const VRORenderContext &context, std::shared_ptr<VRODriver> &driver) {
-    if (!_enabled || !_node->getGeometry()) {
+    if (!_enabled || !_node) {
+        if (_enabledGPUTimer) {
+            driver->setGPUFrameTimerEnabled(false);
+            _enabledGPUTimer = false;
+        }
         return;
     }
+    if (!_enabledGPUTimer) {
+        driver->setGPUFrameTimerEnabled(true);
+        _enabledGPUTimer = true;
+    }
     if (kDebugSortOrder && context.getFrame() % kDebugSortOrderFrameFrequency == 0) {
         pinfo("Updating Debug HUD");
     }
     
-    VROMatrix4f identity;
-    VRORenderParameters renderParams;
-    std::shared_ptr<VRORenderMetadata> metadata = std::make_shared<VRORenderMetadata>();
-    _node->computeTransforms(identity, {});
-    _node->applyConstraints(context, identity, false);
-    _node->updateSortKeys(0, renderParams, metadata, context, driver);
-    _node->syncAppThreadProperties();
+    // The HUD is head-locked, so its transforms are shared by every eye
+    if (context.getFrame() != _lastTransformFrame) {
+        VROMatrix4f identity;
+        VRORenderParameters renderParams;
+        std::shared_ptr<VRORenderMetadata> metadata = std::make_shared<VRORenderMetadata>();
+        _node->computeTransforms(identity, {});
+        _node->applyConstraints(context, identity, false);
+        _node->updateSortKeys(0, renderParams, metadata, context, driver);
+        _lastTransformFrame = context.getFrame();
+    }
+    
+    renderNode(_backdrop, context, driver);
+    for (VRODebugHUDGraph &graph : _graphs) {
+        renderNode(graph.textNode, context, driver);
+        renderNode(graph.barsNode, context, driver);
+    }
+}
 
-    for (int i = 0; i < _node->getGeometry()->getGeometryElements().size(); i++) {
-        std::shared_ptr<VROMaterial> &material = _node->getGeometry()->getMaterialForElement(i);
+void VRODebugHUD::renderNode(const std::shared_ptr<VRONode> &node, const VRORenderContext &context,
+                             std::shared_ptr<VRODriver> &driver) {
+    const std::shared_ptr<VROGeometry> &geometry = node->getGeometry();
+    if (!geometry) {
+        return;
+    }
+    for (int i = 0; i < geometry->getGeometryElements().size(); i++) {
+        std::shared_ptr<VROMaterial> &material = geometry->getMaterialForElement(i);
         material->bindShader(0, {}, context, driver);
         material->bindProperties(driver);
+        
+        node->render(i, material, context, driver);
+    }
+}
 
-        _node->render(i, material, context, driver);
+void VRODebugHUD::endFrame(std::shared_ptr<VRODriver> &driver) {
+    if (!_enabled || _graphs.empty()) {
+        return;
     }
+    
+    double gpuMs = driver->getGPUFrameTime();
+    int64_t gpuMemory = VROAllocationTracker::getStats(VROAllocationBucket::TextureMemory).current +
+                        VROAllocationTracker::getStats(VROAllocationBucket::VertexBufferMemory).current +
+                        VROAllocationTracker::getStats(VROAllocationBucket::IndexBufferMemory).current +
+                        VROAllocationTracker::getStats(VROAllocationBucket::RenderTargetMemory).current +
+                        VROAllocationTracker::getStats(VROAllocationBucket::GlyphAtlasMemory).current;
+    int64_t cpuMemory = VROAllocationTracker::getStats(VROAllocationBucket::DataMemory).current;
+    
+    // Samples are listed in the order the graphs were added
+    float samples[] = {
+        (float) (_phaseNanoseconds[(int) VRODebugHUDPhase::Prepare] / 1e6),
+        (float) (_phaseNanoseconds[(int) VRODebugHUDPhase::Render] / 1e6),
+        (float) (_phaseNanoseconds[(int) VRODebugHUDPhase::End] / 1e6),
+        (float) std::max(gpuMs, 0.0),
+        (float) (VROProfiler::getCount(VROProfilerCounter::DrawCalls) +
+                 VROProfiler::getCount(VROProfilerCounter::InstancedDrawCalls) +
+                 VROProfiler::getCount(VROProfilerCounter::MultiDrawCalls)),
+        (float) (VROProfiler::getCount(VROProfilerCounter::Triangles) / 1000.0),
+        (float) VROProfiler::getCount(VROProfilerCounter::StateChanges),
+        (float) VROProfiler::getCount(VROProfilerCounter::ShaderCompiles),
+        (float) VROProfiler::getCount(VROProfilerCounter::TextureUploads),
+        (float) driver->getFrameScheduler()->getQueuedTaskCount(),
+        (float) (gpuMemory / kBytesPerMB),
+        (float) (cpuMemory / kBytesPerMB),
+    };
+    passert (sizeof(samples) / sizeof(float) == _graphs.size());
+    
+    for (int i = 0; i < _graphs.size(); i++) {
+        _graphs[i].addSample(samples[i]);
+    }
+    std::fill(_phaseNanoseconds, _phaseNanoseconds + 3, 0);
+}
+
+void VRODebugHUD::updateBars(VRODebugHUDGraph &graph) {
+    float max = std::max(graph.getMax(), 0.0001f);
+    float barWidth = kHUDGraphWidth / kHUDHistory;
+    
+    // Bars are written oldest to newest, so the graph scrolls to the left
+    std::vector<float> vertices(kHUDHistory * 4 * 3);
+    for (int i = 0; i < kHUDHistory; i++) {
+        float sample = graph.samples[(graph.head + i) % kHUDHistory];
+        float x0 = i * barWidth;
+        float x1 = x0 + barWidth * kHUDBarFill;
+        float y1 = std::min(sample / max, 1.0f) * kHUDGraphHeight;
+        
+        float *v = &vertices[i * 12];
+        v[0] = x0; v[1]  = 0;  v[2]  = 0;
+        v[3] = x1; v[4]  = 0;  v[5]  = 0;
+        v[6] = x1; v[7]  = y1; v[8]  = 0;
+        v[9] = x0; v[10] = y1; v[11] = 0;
+    }
+    
+    std::shared_ptr<VROData> data = std::make_shared<VROData>((void *) vertices.data(),
+                                                              (int) (vertices.size() * sizeof(float)));
+    std::shared_ptr<VROGeometrySource> source = std::make_shared<VROGeometrySource>(data,
+                                                                                   VROGeometrySourceSemantic::Vertex,
+                                                                                   kHUDHistory * 4, true, 3,
+                                                                                   sizeof(float), 0, sizeof(float) * 3);
+    graph.bars->setSources({ source });
+}
+
+void VRODebugHUD::updateText(VRODebugHUDGraph &graph) {
+    std::string unit = graph.unit.empty() ? "" : " " + graph.unit;
+    std::string text = graph.label + " " + VROStringUtil::toString(graph.getLatest(), graph.precision) + unit +
+                       " (max " + VROStringUtil::toString(graph.getMax(), graph.precision) + ")";
+    graph.text->setText(std::wstring(text.begin(), text.end()));
+    graph.textNode->setGeometry(graph.text);
+}
+
+#pragma mark - Graphs
+
+void VRODebugHUD::VRODebugHUDGraph::addSample(float sample) {
+    samples[head] = sample;
+    head = (head + 1) % samples.size();
+}
+
+float VRODebugHUD::VRODebugHUDGraph::getLatest() const {
+    return samples[(head + samples.size() - 1) % samples.size()];
+}
+
+float VRODebugHUD::VRODebugHUDGraph::getMax() const {
+    return *std::max_element(samples.begin(), samples.end());
 }
@@ -28,14 +28,39 @@
 #define VRODebugHUD_h
 
 #include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "VROVector4f.h"
 
 class VRONode;
 class VRORenderContext;
 class VRODriver;
 class VROText;
+class VROGeometry;
+class VROGeometryElement;
 class VROTypefaceCollection;
 enum class VROEyeType;
 
+/*
+ The CPU phases of a frame timed by the HUD.
+ */
+enum class VRODebugHUDPhase {
+    Prepare,
+    Render,
+    End,
+};
+
+/*
+ The debug HUD is a head-locked performance overlay. Each row of the HUD shows
+ the current and maximum value of a metric, alongside a rolling bar graph of its
+ recent history: CPU frame phase times, GPU frame time, draw calls, triangles,
+ state changes, shader compiles, texture uploads, the frame scheduler backlog,
+ and GPU and CPU memory.
+
+ The counters are read from VROProfiler, which the HUD enables while it is
+ visible. When the HUD is hidden, every entry point returns immediately.
+ */
 class VRODebugHUD {
     
 public:
@@ -44,26 +69,97 @@ public:
     virtual ~VRODebugHUD();
   
     /*
-     Renderer thread initialization.
+     Renderer thread initialization. The renderer defers this until the HUD is
+     first enabled.
      */
     void initRenderer(std::shared_ptr<VRODriver> driver);
+    bool isInitialized() const {
+        return _node != nullptr;
+    }
   
     /*
      Enable or disable the HUD.
      */
     void setEnabled(bool enabled);
+    bool isEnabled() const {
+        return _enabled;
+    }
+  
+    /*
+     Add the given CPU time, in nanoseconds, to the given phase of the current
+     frame. Phases may be added to multiple times per frame (e.g. once per eye).
+     */
+    void addPhaseTime(VRODebugHUDPhase phase, uint64_t nanoseconds);
   
     /*
-     Render-loop functions.
+     Render-loop functions. The endFrame function records the metrics of the
+     frame that just finished.
      */
     void prepare(const VRORenderContext &context);
     void renderEye(VROEyeType eye, const VRORenderContext &context, std::shared_ptr<VRODriver> &driver);
+    void endFrame(std::shared_ptr<VRODriver> &driver);
     
 private:
     
+    /*
+     A single row of the HUD: a label displaying the current and maximum
+     value of the metric, and a bar graph of its last kHUDHistory samples,
+     held in a ring buffer.
+     */
+    struct VRODebugHUDGraph {
+        std::string label;
+        std::string unit;
+        int precision;
+        VROVector4f color;
+        
+        std::vector<float> samples;
+        int head;
+        
+        std::shared_ptr<VROText> text;
+        std::shared_ptr<VRONode> textNode;
+        std::shared_ptr<VROGeometry> bars;
+        std::shared_ptr<VRONode> barsNode;
+        
+        void addSample(float sample);
+        float getLatest() const;
+        float getMax() const;
+    };
+    
     bool _enabled;
-    std::shared_ptr<VROText> _text;
     std::shared_ptr<VRONode> _node;
+    std::shared_ptr<VRONode> _backdrop;
+    std::vector<VRODebugHUDGraph> _graphs;
+    
+    /*
+     The index element shared by every bar graph. Bars are drawn as two
+     triangles each.
+     */
+    std::shared_ptr<VROGeometryElement> _barElement;
+    
+    /*
+     CPU time accumulated for each phase of the current frame.
+     */
+    uint64_t _phaseNanoseconds[3];
+    
+    /*
+     True if the HUD enabled the profiler or the GPU frame timer, in which case
+     it disables them again when hidden.
+     */
+    bool _enabledProfiler;
+    bool _enabledGPUTimer;
+    
+    /*
+     The last frame for which transforms were computed, so that they are
+     computed once per frame and not once per eye.
+     */
+    int _lastTransformFrame;
+    
+    void addGraph(std::string label, std::string unit, int precision, VROVector4f color,
+                  std::shared_ptr<VRODriver> driver);
+    void updateBars(VRODebugHUDGraph &graph);
+    void updateText(VRODebugHUDGraph &graph);
+    void renderNode(const std::shared_ptr<VRONode> &node, const VRORenderContext &context,
+                    std::shared_ptr<VRODriver> &driver);
     
 };
 
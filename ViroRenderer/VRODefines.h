@@ -62,6 +62,14 @@
 
 #define VRO_METAL 0
 
+// True if native threads are available. WebAssembly only has threads when
+// built with -pthread (see VIRO_WASM_THREADS in wasm/CMakeLists.txt).
+#if VRO_PLATFORM_WASM && !defined(__EMSCRIPTEN_PTHREADS__)
+#define VRO_THREADS 0
+#else
+#define VRO_THREADS 1
+#endif
+
 // True if building for Posemoji
 #define VRO_POSEMOJI 1
 
@@ -28,6 +28,7 @@
 #define VRODriver_h
 
 #include <vector>
+#include <functional>
 #include "VRODefines.h"
 #include "VROSoundData.h"
 
@@ -45,12 +46,18 @@ class VROAudioPlayer;
 class VROTypefaceCollection;
 class VROFrameTimer;
 class VRORenderTarget;
+class VRORenderTargetActions;
 class VRORenderContext;
 class VROShaderProgram;
 class VROImagePostProcess;
 class VROFrameScheduler;
+class VROIBLCache;
+class VROGeometryCache;
+class VROTextureStreamer;
+class VROResidencyManager;
 
 enum class VROSoundType;
+enum class VROMemoryPressure;
 enum class VROTextureType;
 enum class VROTextureFormat;
 enum class VROTextureInternalFormat;
@@ -61,6 +68,7 @@ enum class VRORenderTargetType;
 enum class VROFace;
 enum class VROCullMode;
 enum class VROBlendMode;
+enum class VROShadingRate;
 enum class VROResourceType;
 enum class VROFontStyle;
 enum class VROFontWeight;
@@ -177,6 +185,140 @@ public:
      */
     virtual void willRenderEye(const VRORenderContext &context) = 0;
     virtual void didRenderEye(const VRORenderContext &context) = 0;
+
+    /*
+     Bracket a sequence of GPU commands with a timer, for the profiler. Timers
+     do not nest; a begin issued while another timer is open is ignored. Drivers
+     without GPU timer support leave these as no-ops.
+     */
+    virtual void beginGPUTimer(const char *name) {}
+    virtual void endGPUTimer() {}
+
+    /*
+     Open a GPU timer whose elapsed time, in nanoseconds, is delivered to the
+     given callback a few frames later instead of to the profiler. Returns false
+     if the timer could not be opened (e.g. another timer is open), in which case
+     endGPUTimer must not be invoked for it.
+     */
+    virtual bool beginGPUSample(std::function<void(uint64_t)> callback) { return false; }
+
+    /*
+     Enable timing the GPU work of each entire frame, from willRenderFrame to
+     didRenderFrame. The GPU frame time is that of a recent frame in ms (results
+     lag a few frames behind), or negative if unknown or unsupported.
+     */
+    virtual void setGPUFrameTimerEnabled(bool enabled) {}
+    virtual double getGPUFrameTime() { return -1; }
+
+    /*
+     Count the samples that pass the depth test over a sequence of draws
+     covering the given number of pixels, reporting the resulting overdraw to
+     the profiler. Drivers without sample-counting queries leave these as
+     no-ops.
+     */
+    virtual void beginOverdrawQuery(int numPixels) {}
+    virtual void endOverdrawQuery() {}
+
+    /*
+     Boolean occlusion queries, used for occlusion culling. A query brackets
+     the draws issued between begin and end, and reports whether any of their
+     samples passed the depth test. beginOcclusionQuery returns 0 if no query
+     could be started. Results are polled without blocking: getOcclusionQueryResult
+     returns false while the result is pending, and otherwise writes the result
+     and releases the query. Queries abandoned before their result arrives must
+     be released with releaseOcclusionQuery.
+     */
+    virtual bool isOcclusionQuerySupported() { return false; }
+    virtual uint32_t beginOcclusionQuery() { return 0; }
+    virtual void endOcclusionQuery() {}
+    virtual bool getOcclusionQueryResult(uint32_t query, bool *outVisible) { return false; }
+    virtual void releaseOcclusionQuery(uint32_t query) {}
+
+    /*
+     True if the driver can render multiple views (e.g. both eyes) with a single
+     draw call, via OVR_multiview2.
+     */
+    virtual bool isMultiviewSupported() { return false; }
+
+    /*
+     True if render targets can be rendered with reduced pixel density away from
+     a focal point, via QCOM_texture_foveated.
+     */
+    virtual bool isFoveationSupported() { return false; }
+
+    /*
+     True if the rate at which fragments are shaded can be reduced per draw call,
+     via EXT_fragment_shading_rate or QCOM_shading_rate. The rate set applies to
+     all subsequent draws until changed; setting it is a no-op if unsupported.
+     */
+    virtual bool isVariableRateShadingSupported() { return false; }
+    virtual void setShadingRate(VROShadingRate rate) {}
+    
+    /*
+     True if fragment shaders can read the depth already in the render target at
+     their own pixel, via ARM_shader_framebuffer_fetch_depth_stencil. On tiled GPUs
+     this reads tile memory, so no depth copy or extra pass is required.
+     */
+    virtual bool isFramebufferFetchDepthSupported() { return false; }
+
+    /*
+     True if ASTC compressed textures can be uploaded, via KHR_texture_compression_astc_ldr.
+     ETC2 textures are supported by all OpenGL ES 3.0 devices.
+     */
+    virtual bool isASTCSupported() { return false; }
+
+    /*
+     True if materials transitioning between compatible states can blend their
+     incoming and outgoing properties in a single draw (see VROMaterial::isCrossfading),
+     rather than rendering both materials with alpha blending.
+     */
+    virtual bool isMaterialCrossfadeSupported() { return false; }
+    
+    /*
+     Get the on-disk cache of image-based lighting maps, or nullptr if this
+     platform does not persist them.
+     */
+    virtual std::shared_ptr<VROIBLCache> getIBLCache() { return nullptr; }
+
+    /*
+     Get the on-disk cache of processed model geometry, or nullptr if this
+     platform does not persist it. The returned cache may be used from any
+     thread, so that loaders can use it while building models.
+     */
+    virtual std::shared_ptr<VROGeometryCache> getGeometryCache() { return nullptr; }
+
+    /*
+     Get the manager of streamed textures, or nullptr if this driver does not
+     stream textures (see VROTexture::setStreamingSource).
+     */
+    virtual std::shared_ptr<VROTextureStreamer> getTextureStreamer() { return nullptr; }
+
+    /*
+     Get the manager that evicts GPU resources under memory pressure, or nullptr
+     if this driver does not evict resources.
+     */
+    virtual std::shared_ptr<VROResidencyManager> getResidencyManager() { return nullptr; }
+
+    /*
+     Signal that the platform is low on memory. The driver evicts the resources
+     that the given pressure calls for, and purges unused shaders, at the end of
+     the next frame. Must be invoked on the rendering thread.
+     */
+    virtual void onMemoryPressure(VROMemoryPressure pressure) {}
+
+    /*
+     True if shaders requested by rendered or prewarmed materials are still
+     being compiled, so that the materials that use them are not yet drawn.
+     */
+    virtual bool hasPendingShaderCompiles() { return false; }
+    
+    /*
+     Get a manifest of the shaders this driver has built, and queue the shaders of a
+     previously recorded manifest to be built ahead of use. See
+     VROShaderFactory::getShaderManifest.
+     */
+    virtual std::string getShaderManifest() { return ""; }
+    virtual void prewarmShaders(const std::string &manifest) {}
     
     /*
      Invoked when the renderer is paused and resumed.
@@ -219,6 +361,7 @@ public:
     virtual void setMaterialColorWritingMask(VROColorMask mask) = 0;
     virtual void bindShader(std::shared_ptr<VROShaderProgram> program) = 0;
     virtual void unbindShader() = 0;
+    virtual const std::shared_ptr<VROShaderProgram> &getBoundShader() const = 0;
     
     /*
      Bind the given render target, and perform the given operation when unbinding
@@ -226,6 +369,16 @@ public:
      if the designated target was *already* bound.
      */
     virtual bool bindRenderTarget(std::shared_ptr<VRORenderTarget> target, VRORenderTargetUnbindOp unbindOp) = 0;
+    
+    /*
+     Bind the given render target with the given load and store actions for its
+     attachments. Each render pass should declare the minimal actions it needs: on
+     tiled GPUs every Clear or Load and every Store costs a full transfer between tile
+     memory and shared memory. The store actions are applied when the target is
+     unbound with VRORenderTargetUnbindOp::Invalidate.
+     */
+    virtual bool bindRenderTarget(std::shared_ptr<VRORenderTarget> target, const VRORenderTargetActions &actions,
+                                  VRORenderTargetUnbindOp unbindOp) = 0;
     virtual void unbindRenderTarget() = 0;
     
     /*
@@ -265,6 +418,18 @@ public:
      */
     virtual bool isBloomSupported() = 0;
     
+    /*
+     Return true if packed float (R11G11B10F) color attachments can be rendered
+     to. See VROAttachmentFormat.
+     */
+    virtual bool isPackedFloatRenderTargetSupported() { return false; }
+    
+    /*
+     Return the maximum number of color attachments a fragment shader can write
+     to at once. OpenGL ES 3.0 guarantees at least four.
+     */
+    virtual int getMaxDrawBuffers() { return 4; }
+    
     virtual VROGeometrySubstrate *newGeometrySubstrate(const VROGeometry &geometry) = 0;
     virtual VROMaterialSubstrate *newMaterialSubstrate(VROMaterial &material) = 0;
     virtual VROTextureSubstrate *newTextureSubstrate(VROTextureType type,
@@ -275,6 +440,36 @@ public:
                                                      int width, int height, std::vector<uint32_t> mipSizes,
                                                      VROWrapMode wrapS, VROWrapMode wrapT,
                                                      VROFilterMode minFilter, VROFilterMode magFilter, VROFilterMode mipFilter) = 0;
+    
+    /*
+     Create a substrate for the given 2D texture data within a layer of a shared
+     texture array, so that materials using the texture can be batched with those
+     using other layers. Returns nullptr if the texture cannot be packed, or if
+     texture arrays are not supported by this driver.
+     */
+    virtual VROTextureSubstrate *newTextureArrayLayerSubstrate(VROTextureFormat format,
+                                                               VROTextureInternalFormat internalFormat, bool sRGB,
+                                                               VROMipmapMode mipmapMode,
+                                                               std::shared_ptr<VROData> data,
+                                                               int width, int height,
+                                                               VROWrapMode wrapS, VROWrapMode wrapT,
+                                                               VROFilterMode minFilter, VROFilterMode magFilter,
+                                                               VROFilterMode mipFilter) {
+        return nullptr;
+    }
+    
+    /*
+     Create a substrate for the given small 2D texture data within a region of
+     a shared texture atlas page. Returns nullptr if the texture cannot be
+     packed, or if atlases are not supported by this driver.
+     */
+    virtual VROTextureSubstrate *newTextureAtlasRegionSubstrate(VROTextureFormat format,
+                                                                VROTextureInternalFormat internalFormat, bool sRGB,
+                                                                std::shared_ptr<VROData> data,
+                                                                int width, int height,
+                                                                VROFilterMode minFilter, VROFilterMode magFilter) {
+        return nullptr;
+    }
     virtual std::shared_ptr<VRORenderTarget> newRenderTarget(VRORenderTargetType type, int numAttachments, int numImages,
                                                              bool enableMipmaps, bool needsDepthStencil) = 0;
     virtual std::shared_ptr<VROVertexBuffer> newVertexBuffer(std::shared_ptr<VROData> data) = 0;
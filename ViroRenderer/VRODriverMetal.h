@@ -38,6 +38,8 @@
 #include "VROMatrix4f.h"
 #include "VROSoundEffectiOS.h"
 #include <memory>
+#include <map>
+#include <string>
 #include "VROGeometrySubstrateMetal.h"
 #include "VROMaterialSubstrateMetal.h"
 #include "VROTextureSubstrateMetal.h"
@@ -58,6 +60,9 @@ public:
         NSString *shaders = [bundle pathForResource:@"default" ofType:@"metallib"];
         
         _library = [device newLibraryWithFile:shaders error:nil];
+        for (int i = 0; i < 4; i++) {
+            _depthStencilStates[i] = nil;
+        }
     }
     
     void willRenderFrame(VRORenderContext &context) {
@@ -84,6 +89,91 @@ public:
         return _renderTarget;
     }
     
+    /*
+     Get the pipeline state for the given functions and vertex layout, rendering with
+     alpha blending into a target of the given formats. Pipeline states are costly to
+     compile, so each is created once and shared by every geometry and material that
+     match it; in particular, updating a material no longer recompiles its pipelines.
+     */
+    id <MTLRenderPipelineState> getRenderPipelineState(id <MTLFunction> vertexFunction,
+                                                       id <MTLFunction> fragmentFunction,
+                                                       MTLVertexDescriptor *vertexDescriptor,
+                                                       MTLPixelFormat colorFormat,
+                                                       MTLPixelFormat depthStencilFormat,
+                                                       int sampleCount) {
+        std::string key = std::string([vertexFunction.name UTF8String]) + "|" + std::string([fragmentFunction.name UTF8String]) +
+                          "|" + std::to_string(colorFormat) + "|" + std::to_string(depthStencilFormat) + "|" + std::to_string(sampleCount);
+        for (int i = 0; i < kMaxVertexAttributes; i++) {
+            MTLVertexAttributeDescriptor *attribute = vertexDescriptor.attributes[i];
+            if (attribute.format != MTLVertexFormatInvalid) {
+                key += "|a" + std::to_string(i) + ":" + std::to_string(attribute.format) + ":" +
+                       std::to_string(attribute.offset) + ":" + std::to_string(attribute.bufferIndex);
+            }
+        }
+        for (int i = 0; i < kMaxVertexBufferLayouts; i++) {
+            MTLVertexBufferLayoutDescriptor *layout = vertexDescriptor.layouts[i];
+            if (layout.stride != 0) {
+                key += "|l" + std::to_string(i) + ":" + std::to_string(layout.stride) + ":" + std::to_string(layout.stepFunction);
+            }
+        }
+        
+        auto it = _pipelineStates.find(key);
+        if (it != _pipelineStates.end()) {
+            return it->second;
+        }
+        
+        MTLRenderPipelineDescriptor *pipelineStateDescriptor = [[MTLRenderPipelineDescriptor alloc] init];
+        pipelineStateDescriptor.label = @"VROLayerPipeline";
+        pipelineStateDescriptor.sampleCount = sampleCount;
+        pipelineStateDescriptor.vertexFunction = vertexFunction;
+        pipelineStateDescriptor.fragmentFunction = fragmentFunction;
+        pipelineStateDescriptor.vertexDescriptor = vertexDescriptor;
+        pipelineStateDescriptor.colorAttachments[0].pixelFormat = colorFormat;
+        pipelineStateDescriptor.colorAttachments[0].blendingEnabled = YES;
+        pipelineStateDescriptor.colorAttachments[0].rgbBlendOperation = MTLBlendOperationAdd;
+        pipelineStateDescriptor.colorAttachments[0].alphaBlendOperation = MTLBlendOperationAdd;
+        pipelineStateDescriptor.colorAttachments[0].sourceRGBBlendFactor = MTLBlendFactorSourceAlpha;
+        pipelineStateDescriptor.colorAttachments[0].sourceAlphaBlendFactor = MTLBlendFactorSourceAlpha;
+        pipelineStateDescriptor.colorAttachments[0].destinationRGBBlendFactor = MTLBlendFactorOneMinusSourceAlpha;
+        pipelineStateDescriptor.colorAttachments[0].destinationAlphaBlendFactor = MTLBlendFactorOneMinusSourceAlpha;
+        pipelineStateDescriptor.depthAttachmentPixelFormat = depthStencilFormat;
+        pipelineStateDescriptor.stencilAttachmentPixelFormat = depthStencilFormat;
+        
+        NSError *error = NULL;
+        id <MTLRenderPipelineState> pipelineState = [_device newRenderPipelineStateWithDescriptor:pipelineStateDescriptor
+                                                                                            error:&error];
+        if (!pipelineState) {
+            NSLog(@"Failed to created pipeline state, error %@", error);
+            return nil;
+        }
+        _pipelineStates[key] = pipelineState;
+        return pipelineState;
+    }
+    
+    /*
+     Get the depth-stencil state for the given depth settings, created once per
+     combination.
+     */
+    id <MTLDepthStencilState> getDepthStencilState(bool writesDepth, bool readsDepth) {
+        int index = (writesDepth ? 1 : 0) | (readsDepth ? 2 : 0);
+        if (_depthStencilStates[index]) {
+            return _depthStencilStates[index];
+        }
+        
+        MTLDepthStencilDescriptor *depthStateDesc = [[MTLDepthStencilDescriptor alloc] init];
+        depthStateDesc.depthWriteEnabled = writesDepth;
+        
+        /*
+         Using LessEqual ensures that outgoing material transitions work correctly,
+         in that we can render the same face twice (once outgoing, once incoming), and
+         the incoming will not fail the depth test despite having the same depth as
+         the outgoing.
+         */
+        depthStateDesc.depthCompareFunction = readsDepth ? MTLCompareFunctionLessEqual : MTLCompareFunctionAlways;
+        _depthStencilStates[index] = [_device newDepthStencilStateWithDescriptor:depthStateDesc];
+        return _depthStencilStates[index];
+    }
+    
     VROGeometrySubstrate *newGeometrySubstrate(const VROGeometry &geometry) {
         return new VROGeometrySubstrateMetal(geometry, *this);
     }
@@ -132,6 +222,20 @@ private:
     
     std::shared_ptr<VRORenderTarget> _renderTarget;
     
+    /*
+     Pipeline states by a key of their functions, vertex layout and target formats,
+     and depth-stencil states by their depth settings (see getDepthStencilState).
+     */
+    std::map<std::string, id <MTLRenderPipelineState>> _pipelineStates;
+    id <MTLDepthStencilState> _depthStencilStates[4];
+    
+    /*
+     The number of vertex attributes and buffer layouts considered when keying
+     pipeline states.
+     */
+    static const int kMaxVertexAttributes = 16;
+    static const int kMaxVertexBufferLayouts = 8;
+    
 };
 
 #endif
@@ -33,20 +33,65 @@
 // See here: https://github.com/android-ndk/ndk/issues/533#issuecomment-335977747
 VRODriverOpenGL::VRODriverOpenGL() :
         _gpuType(VROGPUType::Normal),
+        _parallelShaderCompile(false),
+        _gpuTimerSupported(false),
+        // Samples-passed queries are core in desktop GL
+        _sampleCounterSupported(VRO_PLATFORM_MACOS),
+        _multiviewSupported(false),
+        _foveationSupported(false),
+        _framebufferFetchDepthSupported(false),
+        _astcSupported(false),
+        // R11F_G11F_B10F is color-renderable in desktop GL
+        _packedFloatRenderTargetSupported(VRO_PLATFORM_MACOS),
+        _maxDrawBuffers(4),
+        _shadingRate(VROShadingRate::Rate1x1),
+        _shadingRateAttachmentSupported(false),
+        _shadingRateTexelWidth(kShadingRateTexelSize),
+        _shadingRateTexelHeight(kShadingRateTexelSize),
+        _maxMultisampledRenderToTextureSamples(1),
+        _multisampledRenderToTextureMRTSupported(false),
+        _bufferStorageSupported(false),
+        _bufferStorageEXT(nullptr),
+        _gpuFrameTimerEnabled(false),
+        _pixelUnpackBuffer(0),
         _lastPurgeFrame(0),
         _softwareGammaPass(false),
+        _boundVertexArray(0),
         _depthWritingEnabled(true),
         _depthReadingEnabled(true),
         _materialColorWritingMask(VROColorMaskAll),
         _renderTargetColorWritingMask(VROColorMaskAll),
         _aggregateColorWritingMask(VROColorMaskAll),
         _cullMode(VROCullMode::None),
-        _blendMode(VROBlendMode::Alpha) {
+        _blendMode(VROBlendMode::Alpha),
+        _memoryPressurePending(false),
+        _memoryPressure(VROMemoryPressure::Low) {
 
     _shaderFactory = std::unique_ptr<VROShaderFactory>(new VROShaderFactory());
     _scheduler = std::make_shared<VROFrameScheduler>();
+    _textureStreamer = std::make_shared<VROTextureStreamer>();
+    _residencyManager = std::make_shared<VROResidencyManager>();
+#if VRO_PLATFORM_ANDROID
+    _framebufferTextureMultiviewOVR = nullptr;
+    _textureFoveationParametersQCOM = nullptr;
+    _shadingRateEXT = nullptr;
+    _shadingRateCombinerOpsEXT = nullptr;
+    _framebufferShadingRateEXT = nullptr;
+    _shadingRateQCOM = nullptr;
+    _multiDrawElementsIndirectEXT = nullptr;
+    _baseInstanceSupported = false;
+    _dispatchCompute = nullptr;
+    _memoryBarrier = nullptr;
+    _framebufferTexture2DMultisampleEXT = nullptr;
+    _renderbufferStorageMultisampleEXT = nullptr;
+#endif
 }
 
 VRODriverOpenGL::~VRODriverOpenGL() {
-
+    if (!_freeOcclusionQueries.empty()) {
+        GL( glDeleteQueries((GLsizei) _freeOcclusionQueries.size(), _freeOcclusionQueries.data()) );
+    }
+    if (_pixelUnpackBuffer != 0) {
+        GL( glDeleteBuffers(1, &_pixelUnpackBuffer) );
+    }
 }
@@ -38,12 +38,26 @@
 #include "VRODisplayOpenGL.h"
 #include "VROShaderProgram.h"
 #include "VROLightingUBO.h"
+#include "VROInstancedTransformUBO.h"
+#include "VROLightClusterUBO.h"
+#include "VROSkinningCache.h"
 #include "VROShaderModifier.h"
 #include "VRORenderContext.h"
 #include "VROGeometrySource.h"
 #include "VROImagePostProcessOpenGL.h"
 #include "VROLight.h"
 #include "VROShaderFactory.h"
+#include "VROShaderBinaryCache.h"
+#include "VROGPUTimerOpenGL.h"
+#include "VROSampleCounterOpenGL.h"
+#include "VROProfiler.h"
+#include "VROTextureStreamer.h"
+#include "VROResidencyManager.h"
+#include "VROUniformRingBuffer.h"
+#include "VROGeometryBufferArena.h"
+#include "VROGPUCullerOpenGL.h"
+#include "VROTextureArrayPool.h"
+#include "VROTextureAtlasPool.h"
 #include <list>
 
 static const bool kEnableStencilCopy = true;
@@ -51,6 +65,23 @@ static const int kResourcePurgeFrameInterval = 120;
 static const int kResourcePurgeForceFrameInterval = 1200;
 static const int kMaxTextureUnits = 32;
 
+// The preferred size, in pixels, of each texel of a shading rate attachment
+static const int kShadingRateTexelSize = 16;
+
+#ifndef GL_ANY_SAMPLES_PASSED_CONSERVATIVE
+#define GL_ANY_SAMPLES_PASSED_CONSERVATIVE 0x8D6A
+#endif
+
+/*
+ Boolean occlusion queries are core in GLES 3.0 and WebGL 2; the desktop GL
+ profile used on macOS only guarantees samples-passed queries.
+ */
+#if VRO_PLATFORM_MACOS
+static const GLenum kOcclusionQueryTarget = GL_SAMPLES_PASSED;
+#else
+static const GLenum kOcclusionQueryTarget = GL_ANY_SAMPLES_PASSED_CONSERVATIVE;
+#endif
+
 class VRODriverOpenGL : public VRODriver, public std::enable_shared_from_this<VRODriverOpenGL> {
 
 public:
@@ -71,6 +102,13 @@ public:
         _aggregateColorWritingMask = VROColorMaskAll;
         GL( glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE) );
         
+        _boundVertexArray = 0;
+        GL( glBindVertexArray(0) );
+        
+        if (_uniformRing) {
+            _uniformRing->beginFrame(context.getFrame());
+        }
+
         _activeTextureUnit = 0;
         GL( glActiveTexture(GL_TEXTURE0) );
         for (int i = 0; i < kMaxTextureUnits; i++) {
@@ -95,6 +133,14 @@ public:
         GL( glBlendEquation(GL_FUNC_ADD) );
         GL( glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA) );
 
+        // The frame timer is closed when the timer advances in didRenderFrame
+        if (_gpuFrameTimerEnabled && _gpuTimerSupported) {
+            if (!_gpuTimer) {
+                _gpuTimer = std::unique_ptr<VROGPUTimerOpenGL>(new VROGPUTimerOpenGL());
+            }
+            _gpuTimer->beginFrame();
+        }
+
         // Delete all moribund GL objects
         {
             std::lock_guard<std::recursive_mutex> lock(_deletionMutex);
@@ -141,6 +187,37 @@ public:
     }
     
     void didRenderFrame(const VROFrameTimer &timer, const VRORenderContext &context) {
+        // Leave no vertex array bound for rendering outside the driver
+        unbindVertexArray();
+        if (_uniformRing) {
+            _uniformRing->endFrame();
+        }
+
+        // Use any time left in the frame to build shaders requested via prewarmShaders
+        std::shared_ptr<VRODriverOpenGL> driver = shared_from_this();
+        _shaderFactory->hydratePrewarmShaders(timer, driver);
+
+        if (_gpuTimer) {
+            _gpuTimer->nextFrame();
+        }
+        if (_sampleCounter) {
+            _sampleCounter->nextFrame();
+        }
+        _textureStreamer->update(context.getFrame(), driver);
+
+        // Memory warnings evict resources and purge every unused shader at once,
+        // irrespective of time remaining
+        if (_memoryPressurePending) {
+            _memoryPressurePending = false;
+            _residencyManager->evict(_memoryPressure, context.getFrame());
+            if (_memoryPressure != VROMemoryPressure::Low) {
+                _shaderFactory->releasePrewarmedShaders();
+            }
+            _shaderFactory->purgeUnusedShaders(timer, true);
+            _lastPurgeFrame = context.getFrame();
+            return;
+        }
+
         if (context.getFrame() - _lastPurgeFrame < kResourcePurgeFrameInterval) {
             return;
         }
@@ -168,7 +245,138 @@ public:
          */
         unbindRenderTarget();
     }
+
+    void beginGPUTimer(const char *name) {
+        if (!_gpuTimerSupported) {
+            return;
+        }
+        if (!_gpuTimer) {
+            _gpuTimer = std::unique_ptr<VROGPUTimerOpenGL>(new VROGPUTimerOpenGL());
+        }
+        _gpuTimer->begin(name);
+    }
+
+    bool beginGPUSample(std::function<void(uint64_t)> callback) {
+        if (!_gpuTimerSupported) {
+            return false;
+        }
+        if (!_gpuTimer) {
+            _gpuTimer = std::unique_ptr<VROGPUTimerOpenGL>(new VROGPUTimerOpenGL());
+        }
+        return _gpuTimer->begin(callback);
+    }
+
+    void endGPUTimer() {
+        if (_gpuTimer) {
+            _gpuTimer->end();
+        }
+    }
+
+    void setGPUFrameTimerEnabled(bool enabled) {
+        _gpuFrameTimerEnabled = enabled;
+    }
+
+    double getGPUFrameTime() {
+        if (!_gpuFrameTimerEnabled || !_gpuTimer) {
+            return -1;
+        }
+        return _gpuTimer->getFrameTime();
+    }
+
+    void beginOverdrawQuery(int numPixels) {
+        if (!_sampleCounterSupported) {
+            return;
+        }
+        if (!_sampleCounter) {
+            _sampleCounter = std::unique_ptr<VROSampleCounterOpenGL>(new VROSampleCounterOpenGL());
+        }
+        _sampleCounter->begin(numPixels);
+    }
+
+    void endOverdrawQuery() {
+        if (_sampleCounter) {
+            _sampleCounter->end();
+        }
+    }
+
+    bool isOcclusionQuerySupported() {
+        return true;
+    }
+
+    bool isMaterialCrossfadeSupported() {
+        return true;
+    }
+
+    uint32_t beginOcclusionQuery() {
+        GLuint query;
+        if (_freeOcclusionQueries.empty()) {
+            GL( glGenQueries(1, &query) );
+        }
+        else {
+            query = _freeOcclusionQueries.back();
+            _freeOcclusionQueries.pop_back();
+        }
+        GL( glBeginQuery(kOcclusionQueryTarget, query) );
+        return query;
+    }
+
+    void endOcclusionQuery() {
+        GL( glEndQuery(kOcclusionQueryTarget) );
+    }
+
+    bool getOcclusionQueryResult(uint32_t query, bool *outVisible) {
+        GLuint available = 0;
+        GL( glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available) );
+        if (!available) {
+            return false;
+        }
+
+        GLuint result = 0;
+        GL( glGetQueryObjectuiv(query, GL_QUERY_RESULT, &result) );
+        *outVisible = result != 0;
+        _freeOcclusionQueries.push_back(query);
+        return true;
+    }
+
+    void releaseOcclusionQuery(uint32_t query) {
+        _freeOcclusionQueries.push_back(query);
+    }
+
+    /*
+     The pixel unpack buffer through which texture rows are staged during
+     incremental uploads. Created on first use.
+     */
+    GLuint getPixelUnpackBuffer() {
+        if (_pixelUnpackBuffer == 0) {
+            GL( glGenBuffers(1, &_pixelUnpackBuffer) );
+        }
+        return _pixelUnpackBuffer;
+    }
     
+    /*
+     Bind the given vertex array, skipping the bind if it is already bound.
+     Geometry leaves its vertex array bound after drawing, so consecutive draws
+     of the same element do not rebind. Code that binds vertex arrays or
+     element buffers directly must first call unbindVertexArray(), so that it
+     neither modifies the bound vertex array nor invalidates this cache.
+     */
+    void bindVertexArray(GLuint vao) {
+        if (_boundVertexArray == vao) {
+            VRO_PROFILE_COUNT(StateChangesAvoided, 1);
+            return;
+        }
+        _boundVertexArray = vao;
+        GL( glBindVertexArray(vao) );
+        VRO_PROFILE_COUNT(VertexArrayBinds, 1);
+    }
+
+    void unbindVertexArray() {
+        if (_boundVertexArray != 0) {
+            _boundVertexArray = 0;
+            GL( glBindVertexArray(0) );
+        }
+    }
+
     void setActiveTextureUnit(int unit) {
         int unitInt = unit - GL_TEXTURE0;
         if (_activeTextureUnit == unitInt) {
@@ -176,6 +384,7 @@ public:
         }
         _activeTextureUnit = unitInt;
         GL( glActiveTexture(unit) );
+        VRO_PROFILE_COUNT(StateChanges, 1);
     }
     
     bool isTextureBound(int unit, int target, int texture) {
@@ -189,6 +398,7 @@ public:
         if (!isTextureBound(_activeTextureUnit, target, texture)) {
             _activeTextures[_activeTextureUnit][target] = texture;
             GL (glBindTexture(target, texture) );
+            VRO_PROFILE_COUNT(TextureBinds, 1);
         }
     }
     
@@ -212,6 +422,7 @@ public:
         }
         
         _depthWritingEnabled = enabled;
+        VRO_PROFILE_COUNT(StateChanges, 1);
         if (enabled) {
             GL( glDepthMask(GL_TRUE) );
         }
@@ -226,6 +437,7 @@ public:
         }
         
         _depthReadingEnabled = enabled;
+        VRO_PROFILE_COUNT(StateChanges, 1);
         if (_depthReadingEnabled) {
             GL( glDepthFunc(GL_LEQUAL) );
         }
@@ -240,6 +452,7 @@ public:
         }
         
         _stencilTestEnabled = enabled;
+        VRO_PROFILE_COUNT(StateChanges, 1);
         if (_stencilTestEnabled) {
             GL( glEnable(GL_STENCIL_TEST) );
         }
@@ -254,6 +467,7 @@ public:
         }
         
         _cullMode = cullMode;
+        VRO_PROFILE_COUNT(StateChanges, 1);
         if (cullMode == VROCullMode::None) {
             GL( glDisable(GL_CULL_FACE) );
             GL( glCullFace(GL_BACK) );
@@ -304,11 +518,18 @@ public:
                 GL( glBlendEquation(GL_FUNC_ADD) );
                 GL( glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA) );
             }
+            else if (mode == VROBlendMode::WeightedTransparency) {
+                // Color and weights accumulate additively, while alpha accumulates
+                // the product of (1 - alpha), or revealage
+                GL( glBlendEquation(GL_FUNC_ADD) );
+                GL( glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA) );
+            }
             else {
                 pwarn("Warn: Attempted to use an unsupported blend mode. No blending is applied.");
             }
         }
         _blendMode = mode;
+        VRO_PROFILE_COUNT(StateChanges, 1);
     }
     
     void setRenderTargetColorWritingMask(VROColorMask mask) {
@@ -316,6 +537,7 @@ public:
             return;
         }
         _renderTargetColorWritingMask = mask;
+        VRO_PROFILE_COUNT(StateChanges, 1);
         updateColorMask();
     }
     
@@ -324,6 +546,7 @@ public:
             return;
         }
         _materialColorWritingMask = mask;
+        VRO_PROFILE_COUNT(StateChanges, 1);
         updateColorMask();
     }
     
@@ -343,6 +566,11 @@ public:
             VROShaderProgram::unbind();
         }
         _boundShader = program;
+        VRO_PROFILE_COUNT(ShaderBinds, 1);
+    }
+    
+    const std::shared_ptr<VROShaderProgram> &getBoundShader() const {
+        return _boundShader;
     }
     
     void unbindShader() {
@@ -353,6 +581,23 @@ public:
         }
     }
     
+    bool bindRenderTarget(std::shared_ptr<VRORenderTarget> target, const VRORenderTargetActions &actions,
+                          VRORenderTargetUnbindOp unbindOp) {
+        std::shared_ptr<VRORenderTarget> boundRenderTarget = _boundRenderTarget.lock();
+        if (boundRenderTarget == target) {
+            // Still update the actions so the new store actions apply on unbind
+            target->setActions(actions);
+            return false;
+        }
+        
+        /*
+         The previous target is unbound (and invalidated) with its own actions before
+         the new target's load actions are performed.
+         */
+        target->setActions(actions);
+        return bindRenderTarget(target, unbindOp);
+    }
+    
     bool bindRenderTarget(std::shared_ptr<VRORenderTarget> target, VRORenderTargetUnbindOp unbindOp) {
         std::shared_ptr<VRORenderTarget> boundRenderTarget = _boundRenderTarget.lock();
         if (boundRenderTarget == target) {
@@ -385,6 +630,7 @@ public:
             target->bind();
         }
         _boundRenderTarget = target;
+        VRO_PROFILE_COUNT(RenderTargetBinds, 1);
         return true;
     }
     
@@ -403,6 +649,14 @@ public:
     virtual bool isBloomSupported() {
         return true;
     }
+    
+    bool isPackedFloatRenderTargetSupported() {
+        return _packedFloatRenderTargetSupported;
+    }
+    
+    int getMaxDrawBuffers() {
+        return _maxDrawBuffers;
+    }
 
     VROGeometrySubstrate *newGeometrySubstrate(const VROGeometry &geometry) {
         std::shared_ptr<VRODriverOpenGL> driver = shared_from_this();
@@ -429,6 +683,27 @@ public:
                                              driver);
     }
     
+    VROTextureSubstrate *newTextureArrayLayerSubstrate(VROTextureFormat format,
+                                                       VROTextureInternalFormat internalFormat, bool sRGB,
+                                                       VROMipmapMode mipmapMode,
+                                                       std::shared_ptr<VROData> data,
+                                                       int width, int height,
+                                                       VROWrapMode wrapS, VROWrapMode wrapT,
+                                                       VROFilterMode minFilter, VROFilterMode magFilter,
+                                                       VROFilterMode mipFilter) {
+        return getTextureArrayPool()->newLayerSubstrate(format, internalFormat, sRGB, mipmapMode, data, width, height,
+                                                        wrapS, wrapT, minFilter, magFilter, mipFilter);
+    }
+    
+    VROTextureSubstrate *newTextureAtlasRegionSubstrate(VROTextureFormat format,
+                                                        VROTextureInternalFormat internalFormat, bool sRGB,
+                                                        std::shared_ptr<VROData> data,
+                                                        int width, int height,
+                                                        VROFilterMode minFilter, VROFilterMode magFilter) {
+        return getTextureAtlasPool()->newRegionSubstrate(format, internalFormat, sRGB, data, width, height,
+                                                         minFilter, magFilter);
+    }
+    
     std::shared_ptr<VRORenderTarget> newRenderTarget(VRORenderTargetType type, int numAttachments, int numImages, bool enableMipmaps,
                                                      bool needsDepthStencil) {
         std::shared_ptr<VRODriverOpenGL> driver = shared_from_this();
@@ -471,6 +746,314 @@ public:
             }
 
         }
+
+        GLint maxDrawBuffers = 4;
+        GL( glGetIntegerv(GL_MAX_DRAW_BUFFERS, &maxDrawBuffers) );
+        _maxDrawBuffers = std::max(1, (int) maxDrawBuffers);
+
+        GLint numExtensions = 0;
+        GL( glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions) );
+        for (int i = 0; i < numExtensions; i++) {
+            const char *extension = (const char *) GL( glGetStringi(GL_EXTENSIONS, i) );
+            if (extension && strcmp(extension, "GL_KHR_parallel_shader_compile") == 0) {
+                pinfo("   Detected parallel shader compilation support");
+                _parallelShaderCompile = true;
+            }
+            if (extension && (strcmp(extension, "GL_EXT_disjoint_timer_query") == 0 ||
+                              strcmp(extension, "GL_EXT_disjoint_timer_query_webgl2") == 0 ||
+                              strcmp(extension, "GL_ARB_timer_query") == 0)) {
+                pinfo("   Detected GPU timer query support");
+                _gpuTimerSupported = true;
+            }
+            if (extension && strcmp(extension, "GL_ARB_occlusion_query") == 0) {
+                _sampleCounterSupported = true;
+            }
+            if (extension && strcmp(extension, "GL_ARM_shader_framebuffer_fetch_depth_stencil") == 0) {
+                pinfo("   Detected framebuffer depth fetch support");
+                _framebufferFetchDepthSupported = true;
+            }
+            if (extension && strcmp(extension, "GL_KHR_texture_compression_astc_ldr") == 0) {
+                pinfo("   Detected ASTC texture support");
+                _astcSupported = true;
+            }
+            if (extension && (strcmp(extension, "GL_EXT_color_buffer_float") == 0 ||
+                              strcmp(extension, "GL_APPLE_color_buffer_packed_float") == 0)) {
+                pinfo("   Detected packed float render target support");
+                _packedFloatRenderTargetSupported = true;
+            }
+#if VRO_PLATFORM_ANDROID
+            if (extension && strcmp(extension, "GL_OVR_multiview2") == 0) {
+                _framebufferTextureMultiviewOVR = (PFNGLFRAMEBUFFERTEXTUREMULTIVIEWOVRPROC)
+                        eglGetProcAddress("glFramebufferTextureMultiviewOVR");
+                if (_framebufferTextureMultiviewOVR != nullptr) {
+                    pinfo("   Detected multiview support");
+                    _multiviewSupported = true;
+                }
+            }
+            if (extension && strcmp(extension, "GL_EXT_buffer_storage") == 0 &&
+                _gpuType != VROGPUType::Adreno330OrOlder) {
+                _bufferStorageEXT = (PFNGLBUFFERSTORAGEEXTPROC) eglGetProcAddress("glBufferStorageEXT");
+                if (_bufferStorageEXT != nullptr) {
+                    pinfo("   Detected persistent buffer mapping support");
+                    _bufferStorageSupported = true;
+                }
+            }
+            if (extension && strcmp(extension, "GL_EXT_multi_draw_indirect") == 0) {
+                _multiDrawElementsIndirectEXT = (PFNGLMULTIDRAWELEMENTSINDIRECTEXTPROC)
+                        eglGetProcAddress("glMultiDrawElementsIndirectEXT");
+            }
+            if (extension && strcmp(extension, "GL_EXT_base_instance") == 0) {
+                _baseInstanceSupported = true;
+            }
+            if (extension && strcmp(extension, "GL_EXT_multisampled_render_to_texture") == 0) {
+                _framebufferTexture2DMultisampleEXT = (PFNGLFRAMEBUFFERTEXTURE2DMULTISAMPLEEXTPROC)
+                        eglGetProcAddress("glFramebufferTexture2DMultisampleEXT");
+                _renderbufferStorageMultisampleEXT = (PFNGLRENDERBUFFERSTORAGEMULTISAMPLEEXTPROC)
+                        eglGetProcAddress("glRenderbufferStorageMultisampleEXT");
+                if (_framebufferTexture2DMultisampleEXT != nullptr && _renderbufferStorageMultisampleEXT != nullptr) {
+                    GLint maxSamples = 1;
+                    GL( glGetIntegerv(GL_MAX_SAMPLES_EXT, &maxSamples) );
+                    pinfo("   Detected multisampled render to texture support [max samples %d]", maxSamples);
+                    _maxMultisampledRenderToTextureSamples = std::max(1, (int) maxSamples);
+                }
+            }
+            if (extension && strcmp(extension, "GL_EXT_multisampled_render_to_texture2") == 0) {
+                _multisampledRenderToTextureMRTSupported = true;
+            }
+            if (extension && strcmp(extension, "GL_EXT_fragment_shading_rate") == 0) {
+                _shadingRateEXT = (PFNGLSHADINGRATEEXTPROC) eglGetProcAddress("glShadingRateEXT");
+                _shadingRateCombinerOpsEXT = (PFNGLSHADINGRATECOMBINEROPSEXTPROC)
+                        eglGetProcAddress("glShadingRateCombinerOpsEXT");
+                _framebufferShadingRateEXT = (PFNGLFRAMEBUFFERSHADINGRATEEXTPROC)
+                        eglGetProcAddress("glFramebufferShadingRateEXT");
+            }
+            if (extension && strcmp(extension, "GL_EXT_fragment_shading_rate_attachment") == 0) {
+                _shadingRateAttachmentSupported = true;
+            }
+            if (extension && strcmp(extension, "GL_QCOM_shading_rate") == 0) {
+                _shadingRateQCOM = (PFNGLSHADINGRATEQCOMPROC) eglGetProcAddress("glShadingRateQCOM");
+            }
+            if (extension && strcmp(extension, "GL_QCOM_texture_foveated") == 0) {
+                _textureFoveationParametersQCOM = (PFNGLTEXTUREFOVEATIONPARAMETERSQCOMPROC)
+                        eglGetProcAddress("glTextureFoveationParametersQCOM");
+                if (_textureFoveationParametersQCOM != nullptr) {
+                    pinfo("   Detected foveation support");
+                    _foveationSupported = true;
+                }
+            }
+#endif
+        }
+        
+#if VRO_PLATFORM_ANDROID
+        // Multi-draw commands select their per-draw data by base instance
+        if (_multiDrawElementsIndirectEXT != nullptr && _baseInstanceSupported) {
+            pinfo("   Detected multi-draw indirect support");
+        }
+        
+        if (isVariableRateShadingSupported()) {
+            pinfo("   Detected variable rate shading support");
+        }
+        
+        // Shading rate attachments are combined with the rate of each draw, taking the
+        // coarser of the two. The attachment texel size is kept near kShadingRateTexelSize.
+        _shadingRateAttachmentSupported &= _shadingRateEXT != nullptr && _shadingRateCombinerOpsEXT != nullptr &&
+                                            _framebufferShadingRateEXT != nullptr;
+        if (_shadingRateAttachmentSupported) {
+            GLint minWidth = 1, maxWidth = 1, minHeight = 1, maxHeight = 1;
+            GL( glGetIntegerv(GL_MIN_FRAGMENT_SHADING_RATE_ATTACHMENT_TEXEL_WIDTH_EXT, &minWidth) );
+            GL( glGetIntegerv(GL_MAX_FRAGMENT_SHADING_RATE_ATTACHMENT_TEXEL_WIDTH_EXT, &maxWidth) );
+            GL( glGetIntegerv(GL_MIN_FRAGMENT_SHADING_RATE_ATTACHMENT_TEXEL_HEIGHT_EXT, &minHeight) );
+            GL( glGetIntegerv(GL_MAX_FRAGMENT_SHADING_RATE_ATTACHMENT_TEXEL_HEIGHT_EXT, &maxHeight) );
+            _shadingRateTexelWidth  = std::max(1, std::min(std::max(kShadingRateTexelSize, (int) minWidth), (int) maxWidth));
+            _shadingRateTexelHeight = std::max(1, std::min(std::max(kShadingRateTexelSize, (int) minHeight), (int) maxHeight));
+            GL( _shadingRateCombinerOpsEXT(GL_FRAGMENT_SHADING_RATE_COMBINER_OP_KEEP_EXT,
+                                           GL_FRAGMENT_SHADING_RATE_COMBINER_OP_MAX_EXT) );
+            pinfo("   Detected shading rate attachment support [texel %d x %d]",
+                  _shadingRateTexelWidth, _shadingRateTexelHeight);
+        }
+        
+        // Compute shaders are core in GLES 3.1
+        GLint majorVersion = 0, minorVersion = 0;
+        GL( glGetIntegerv(GL_MAJOR_VERSION, &majorVersion) );
+        GL( glGetIntegerv(GL_MINOR_VERSION, &minorVersion) );
+        if (majorVersion > 3 || (majorVersion == 3 && minorVersion >= 1)) {
+            _dispatchCompute = (PFNGLDISPATCHCOMPUTEPROC) eglGetProcAddress("glDispatchCompute");
+            _memoryBarrier = (PFNGLMEMORYBARRIERPROC) eglGetProcAddress("glMemoryBarrier");
+            if (_dispatchCompute != nullptr && _memoryBarrier != nullptr) {
+                pinfo("   Detected compute shader support");
+            }
+        }
+#endif
+    }
+
+    /*
+     True if the driver supports KHR_parallel_shader_compile, in which case
+     material shaders are compiled without blocking the rendering thread.
+     */
+    bool isParallelShaderCompileSupported() const {
+        return _parallelShaderCompile;
+    }
+
+    /*
+     True if runs of arena geometry can be submitted with a single
+     glMultiDrawElementsIndirectEXT. Requires EXT_multi_draw_indirect, and
+     EXT_base_instance to select each command's per-draw data.
+     */
+    bool isMultiDrawIndirectSupported() const {
+#if VRO_PLATFORM_ANDROID
+        return _multiDrawElementsIndirectEXT != nullptr && _baseInstanceSupported;
+#else
+        return false;
+#endif
+    }
+    
+    /*
+     True if compute shaders and shader storage buffers (GLES 3.1) are
+     supported.
+     */
+    bool isComputeSupported() const {
+#if VRO_PLATFORM_ANDROID
+        return _dispatchCompute != nullptr && _memoryBarrier != nullptr;
+#else
+        return false;
+#endif
+    }
+
+    bool isMultiviewSupported() {
+        return _multiviewSupported;
+    }
+
+    /*
+     Attach numViews consecutive layers of the given texture array to the bound
+     framebuffer, so that each draw renders to all of them. Requires multiview
+     support.
+     */
+    void framebufferTextureMultiview(GLenum attachment, GLuint texture, int numViews) {
+        passert (_multiviewSupported);
+#if VRO_PLATFORM_ANDROID
+        GL( _framebufferTextureMultiviewOVR(GL_FRAMEBUFFER, attachment, texture, 0, 0, numViews) );
+#endif
+    }
+
+    /*
+     Get the maximum number of samples with which a texture target with the given
+     number of color attachments can be rendered, resolving on-tile into its
+     textures (EXT_multisampled_render_to_texture). Returns 1 if multisampled
+     render to texture is not supported; targets with more than one color
+     attachment additionally require EXT_multisampled_render_to_texture2.
+     */
+    int getMaxMultisampledRenderToTextureSamples(int numAttachments) const {
+        if (numAttachments > 1 && !_multisampledRenderToTextureMRTSupported) {
+            return 1;
+        }
+        return _maxMultisampledRenderToTextureSamples;
+    }
+
+    /*
+     Attach the given texture to the bound framebuffer, rendering into an implicit
+     multisampled buffer that is resolved into the texture when the framebuffer's
+     contents are flushed from tile memory. Requires multisampled render to texture
+     support.
+     */
+    void framebufferTexture2DMultisample(GLenum attachment, GLenum textarget, GLuint texture, int samples) {
+        passert (_maxMultisampledRenderToTextureSamples > 1);
+#if VRO_PLATFORM_ANDROID
+        GL( _framebufferTexture2DMultisampleEXT(GL_FRAMEBUFFER, attachment, textarget, texture, 0, samples) );
+#endif
+    }
+
+    /*
+     Allocate multisampled storage for the bound renderbuffer, for use alongside
+     textures attached with framebufferTexture2DMultisample.
+     */
+    void renderbufferStorageMultisample(GLenum internalFormat, int width, int height, int samples) {
+        passert (_maxMultisampledRenderToTextureSamples > 1);
+#if VRO_PLATFORM_ANDROID
+        GL( _renderbufferStorageMultisampleEXT(GL_RENDERBUFFER, samples, internalFormat, width, height) );
+#endif
+    }
+
+    bool isFoveationSupported() {
+        return _foveationSupported;
+    }
+
+    bool isVariableRateShadingSupported() {
+#if VRO_PLATFORM_ANDROID
+        return _shadingRateEXT != nullptr || _shadingRateQCOM != nullptr;
+#else
+        return false;
+#endif
+    }
+
+    void setShadingRate(VROShadingRate rate) {
+        if (rate == _shadingRate || !isVariableRateShadingSupported()) {
+            return;
+        }
+        _shadingRate = rate;
+#if VRO_PLATFORM_ANDROID
+        GLenum glRate = GL_SHADING_RATE_1X1_PIXELS_EXT;
+        if (rate == VROShadingRate::Rate2x2) {
+            glRate = GL_SHADING_RATE_2X2_PIXELS_EXT;
+        }
+        else if (rate == VROShadingRate::Rate4x4) {
+            glRate = GL_SHADING_RATE_4X4_PIXELS_EXT;
+        }
+        if (_shadingRateEXT != nullptr) {
+            GL( _shadingRateEXT(glRate) );
+        }
+        else {
+            GL( _shadingRateQCOM(glRate) );
+        }
+#endif
+    }
+
+    /*
+     True if render targets can carry a shading rate attachment (see
+     VRORenderTarget::setPeripheralShadingRate), each texel of which covers the
+     given number of pixels.
+     */
+    bool isShadingRateAttachmentSupported() const {
+        return _shadingRateAttachmentSupported;
+    }
+    int getShadingRateTexelWidth() const {
+        return _shadingRateTexelWidth;
+    }
+    int getShadingRateTexelHeight() const {
+        return _shadingRateTexelHeight;
+    }
+
+    /*
+     Attach the given R8UI texture as the shading rate attachment of the bound
+     framebuffer. Requires shading rate attachment support.
+     */
+    void framebufferShadingRate(GLuint texture) {
+        passert (_shadingRateAttachmentSupported);
+#if VRO_PLATFORM_ANDROID
+        GL( _framebufferShadingRateEXT(GL_DRAW_FRAMEBUFFER, GL_SHADING_RATE_ATTACHMENT_EXT, texture, 0, 1,
+                                       _shadingRateTexelWidth, _shadingRateTexelHeight) );
+#endif
+    }
+
+    bool isFramebufferFetchDepthSupported() {
+        return _framebufferFetchDepthSupported;
+    }
+
+    bool isASTCSupported() {
+        return _astcSupported;
+    }
+
+    /*
+     Set the focal point of the given layer of a foveated texture. The focal point
+     is in normalized device coordinates; pixel density falls off with distance
+     from it according to the gain, outside of the fovea area. Requires foveation
+     support.
+     */
+    void textureFoveationParameters(GLuint texture, GLuint layer, float focalX, float focalY,
+                                    float gainX, float gainY, float foveaArea) {
+        passert (_foveationSupported);
+#if VRO_PLATFORM_ANDROID
+        GL( _textureFoveationParametersQCOM(texture, layer, 0, focalX, focalY, gainX, gainY, foveaArea) );
+#endif
     }
 
     void setHasSoftwareGammaPass(bool gammaPass) {
@@ -518,10 +1101,126 @@ public:
         return lightingUBO;
     }
     
+    /*
+     Get the UBO used to batch per-instance transforms for automatic instancing.
+     */
+    std::shared_ptr<VROInstancedTransformUBO> getInstancedTransformUBO() {
+        if (!_instancedTransformUBO) {
+            _instancedTransformUBO = std::make_shared<VROInstancedTransformUBO>(shared_from_this());
+        }
+        return _instancedTransformUBO;
+    }
+    
+    /*
+     Get the ring buffer through which per-draw and per-view transforms are
+     streamed to material shaders, or nullptr if persistently mapped buffers
+     are not supported.
+     */
+    VROUniformRingBuffer *getUniformRing() {
+        if (!_uniformRing && _bufferStorageSupported) {
+            _uniformRing = std::unique_ptr<VROUniformRingBuffer>(
+                    new VROUniformRingBuffer(_bufferStorageEXT, shared_from_this()));
+        }
+        return _uniformRing.get();
+    }
+    
+    /*
+     Get the arena from which small static geometries allocate their vertex and
+     index buffers.
+     */
+    VROGeometryBufferArena *getGeometryArena() {
+        if (!_geometryArena) {
+            PFNGLMULTIDRAWELEMENTSINDIRECTEXTPROC multiDraw = nullptr;
+#if VRO_PLATFORM_ANDROID
+            if (isMultiDrawIndirectSupported()) {
+                multiDraw = _multiDrawElementsIndirectEXT;
+            }
+#endif
+            _geometryArena = std::unique_ptr<VROGeometryBufferArena>(
+                    new VROGeometryBufferArena(shared_from_this(), multiDraw));
+        }
+        return _geometryArena.get();
+    }
+    
+    /*
+     Get the culler that frustum culls multi-draw commands on the GPU, or
+     nullptr if compute shaders or multi-draw indirect are not supported.
+     */
+    VROGPUCullerOpenGL *getGPUCuller() {
+#if VRO_PLATFORM_ANDROID
+        if (!_gpuCuller && isComputeSupported() && isMultiDrawIndirectSupported()) {
+            _gpuCuller = std::unique_ptr<VROGPUCullerOpenGL>(
+                    new VROGPUCullerOpenGL(shared_from_this(), _dispatchCompute, _memoryBarrier));
+        }
+#endif
+        return (_gpuCuller && _gpuCuller->isReady()) ? _gpuCuller.get() : nullptr;
+    }
+    
+    /*
+     Get the pool of texture arrays into which batchable textures are packed.
+     */
+    VROTextureArrayPool *getTextureArrayPool() {
+        if (!_textureArrayPool) {
+            _textureArrayPool = std::unique_ptr<VROTextureArrayPool>(new VROTextureArrayPool(shared_from_this()));
+        }
+        return _textureArrayPool.get();
+    }
+    
+    /*
+     Get the pool of atlas pages onto which small textures are packed.
+     */
+    VROTextureAtlasPool *getTextureAtlasPool() {
+        if (!_textureAtlasPool) {
+            _textureAtlasPool = std::unique_ptr<VROTextureAtlasPool>(new VROTextureAtlasPool(shared_from_this()));
+        }
+        return _textureAtlasPool.get();
+    }
+    
+    /*
+     Get the transform feedback program through which skinned geometries write
+     their skinned vertices into their VROSkinningCache.
+     */
+    std::shared_ptr<VROShaderProgram> getSkinningCacheProgram() {
+        if (!_skinningCacheProgram) {
+            _skinningCacheProgram = VROSkinningCache::createSkinningProgram(shared_from_this());
+        }
+        return _skinningCacheProgram;
+    }
+    
+    /*
+     Get the UBO through which the light cluster grid is uploaded for
+     clustered forward lighting.
+     */
+    std::shared_ptr<VROLightClusterUBO> getLightClusterUBO() {
+        if (!_lightClusterUBO) {
+            _lightClusterUBO = std::make_shared<VROLightClusterUBO>(shared_from_this());
+        }
+        return _lightClusterUBO;
+    }
+    
     std::unique_ptr<VROShaderFactory> &getShaderFactory() {
         return _shaderFactory;
     }
 
+    bool hasPendingShaderCompiles() {
+        return _shaderFactory->hasPendingShaders();
+    }
+    
+    std::string getShaderManifest() {
+        return _shaderFactory->getShaderManifest();
+    }
+    void prewarmShaders(const std::string &manifest) {
+        _shaderFactory->prewarmShaders(manifest);
+    }
+
+    /*
+     Get the on-disk cache of linked shader program binaries, or nullptr if
+     this platform does not persist shader binaries.
+     */
+    virtual std::shared_ptr<VROShaderBinaryCache> getShaderBinaryCache() {
+        return nullptr;
+    }
+
     std::shared_ptr<VROTypefaceCollection> newTypefaceCollection(std::string typefaces, int size, VROFontStyle style,
                                                                  VROFontWeight weight) {
         std::string key = typefaces + "_" + VROStringUtil::toString(size) + "_" +
@@ -550,6 +1249,22 @@ public:
         return _scheduler;
     }
 
+    std::shared_ptr<VROTextureStreamer> getTextureStreamer() {
+        return _textureStreamer;
+    }
+
+    std::shared_ptr<VROResidencyManager> getResidencyManager() {
+        return _residencyManager;
+    }
+
+    void onMemoryPressure(VROMemoryPressure pressure) {
+        // Keep the most severe of the warnings received since the last frame
+        if (!_memoryPressurePending || pressure > _memoryPressure) {
+            _memoryPressure = pressure;
+        }
+        _memoryPressurePending = true;
+    }
+
     /*
      Queue various GL objects for deletion in a thread-safe manner. This ensures that we only
      delete these objects when the GL context is bound, on the rendering thread.
@@ -606,12 +1321,80 @@ protected:
 private:
 
     VROGPUType _gpuType;
+    bool _parallelShaderCompile;
+    bool _gpuTimerSupported;
+    bool _sampleCounterSupported;
+    bool _multiviewSupported;
+    bool _foveationSupported;
+    bool _framebufferFetchDepthSupported;
+    bool _astcSupported;
+    bool _packedFloatRenderTargetSupported;
+    int _maxDrawBuffers;
+    VROShadingRate _shadingRate;
+    bool _shadingRateAttachmentSupported;
+    int _shadingRateTexelWidth, _shadingRateTexelHeight;
+    int _maxMultisampledRenderToTextureSamples;
+    bool _multisampledRenderToTextureMRTSupported;
+#if VRO_PLATFORM_ANDROID
+    PFNGLFRAMEBUFFERTEXTUREMULTIVIEWOVRPROC _framebufferTextureMultiviewOVR;
+    PFNGLTEXTUREFOVEATIONPARAMETERSQCOMPROC _textureFoveationParametersQCOM;
+    PFNGLSHADINGRATEEXTPROC _shadingRateEXT;
+    PFNGLSHADINGRATECOMBINEROPSEXTPROC _shadingRateCombinerOpsEXT;
+    PFNGLFRAMEBUFFERSHADINGRATEEXTPROC _framebufferShadingRateEXT;
+    PFNGLSHADINGRATEQCOMPROC _shadingRateQCOM;
+    PFNGLMULTIDRAWELEMENTSINDIRECTEXTPROC _multiDrawElementsIndirectEXT;
+    bool _baseInstanceSupported;
+    PFNGLDISPATCHCOMPUTEPROC _dispatchCompute;
+    PFNGLMEMORYBARRIERPROC _memoryBarrier;
+    PFNGLFRAMEBUFFERTEXTURE2DMULTISAMPLEEXTPROC _framebufferTexture2DMultisampleEXT;
+    PFNGLRENDERBUFFERSTORAGEMULTISAMPLEEXTPROC _renderbufferStorageMultisampleEXT;
+#endif
+    bool _bufferStorageSupported;
+    PFNGLBUFFERSTORAGEEXTPROC _bufferStorageEXT;
+
+    /*
+     Times render passes on the GPU for VROProfiler, and entire frames when the
+     frame timer is enabled, when timer queries are supported. Created on first use.
+     */
+    std::unique_ptr<VROGPUTimerOpenGL> _gpuTimer;
+    bool _gpuFrameTimerEnabled;
+
+    /*
+     Measures overdraw for VROProfiler where GL_SAMPLES_PASSED is supported.
+     Created on first use.
+     */
+    std::unique_ptr<VROSampleCounterOpenGL> _sampleCounter;
+
+    /*
+     Occlusion query objects that have been released, pooled for reuse.
+     */
+    std::vector<GLuint> _freeOcclusionQueries;
+
+    /*
+     Staging buffer for incremental texture uploads, or 0 if not yet created.
+     */
+    GLuint _pixelUnpackBuffer;
     
     /*
      Map of light hashes to corresponding lighting UBOs.
      */
     std::map<int, std::weak_ptr<VROLightingUBO>> _lightingUBOs;
     
+    /*
+     UBO shared by all automatically instanced draws.
+     */
+    std::shared_ptr<VROInstancedTransformUBO> _instancedTransformUBO;
+    
+    /*
+     Program shared by all skinning caches.
+     */
+    std::shared_ptr<VROShaderProgram> _skinningCacheProgram;
+    
+    /*
+     UBO shared by all clustered lighting draws.
+     */
+    std::shared_ptr<VROLightClusterUBO> _lightClusterUBO;
+    
     /*
      Creates and caches shaders.
      */
@@ -635,6 +1418,11 @@ private:
     int _activeTextureUnit;
     std::map<int, int> _activeTextures[kMaxTextureUnits];
     
+    /*
+     The currently bound vertex array, or 0 if none.
+     */
+    GLuint _boundVertexArray;
+    
     /*
      Current context-wide state.
      */
@@ -666,6 +1454,45 @@ private:
      */
     std::shared_ptr<VROFrameScheduler> _scheduler;
 
+    /*
+     Raises and lowers the resolution of streamed textures.
+     */
+    std::shared_ptr<VROTextureStreamer> _textureStreamer;
+
+    /*
+     Evicts GPU resources when the platform signals memory pressure. The most
+     severe pressure signaled since the last frame is pending until the end of
+     the next frame.
+     */
+    std::shared_ptr<VROResidencyManager> _residencyManager;
+    bool _memoryPressurePending;
+    VROMemoryPressure _memoryPressure;
+    
+    /*
+     Streams per-draw and per-view transforms, when supported.
+     */
+    std::unique_ptr<VROUniformRingBuffer> _uniformRing;
+    
+    /*
+     Shared vertex and index buffers for small geometries.
+     */
+    std::unique_ptr<VROGeometryBufferArena> _geometryArena;
+    
+    /*
+     Culls multi-draw commands with a compute shader, when supported.
+     */
+    std::unique_ptr<VROGPUCullerOpenGL> _gpuCuller;
+
+    /*
+     Texture arrays holding textures packed for batching.
+     */
+    std::unique_ptr<VROTextureArrayPool> _textureArrayPool;
+
+    /*
+     Atlas pages holding small textures packed for batching.
+     */
+    std::unique_ptr<VROTextureAtlasPool> _textureAtlasPool;
+
     /*
      ID of the backbuffer.
      */
@@ -0,0 +1,216 @@
+//
+//  VRODualFilterBloomRenderPass.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VRODualFilterBloomRenderPass.h"
+#include "VRODriver.h"
+#include "VROImagePostProcess.h"
+#include "VROImageShaderProgram.h"
+#include "VRORenderContext.h"
+#include "VROOpenGL.h"
+#include "VRORenderTarget.h"
+#include "VROMaterial.h"
+#include "VROStringUtil.h"
+#include "VROViewport.h"
+#include "VROLog.h"
+#include <algorithm>
+
+VRODualFilterBloomRenderPass::VRODualFilterBloomRenderPass() :
+    _numLevels(kDualFilterBloomNumLevels),
+    _sampleOffset(1.0),
+    _considerTransparentPixels(false),
+    _packedFloatSupported(false) {
+}
+
+VRODualFilterBloomRenderPass::~VRODualFilterBloomRenderPass() {
+}
+
+void VRODualFilterBloomRenderPass::createRenderTargets(std::shared_ptr<VRODriver> &driver) {
+    _levels.clear();
+    for (int i = 0; i < kDualFilterBloomNumLevels; i++) {
+        _levels.push_back(driver->newRenderTarget(VRORenderTargetType::ColorTextureHDR16, 1, 1, false, false));
+    }
+    _packedFloatSupported = driver->isPackedFloatRenderTargetSupported();
+    updateTargetFormats();
+}
+
+void VRODualFilterBloomRenderPass::resetRenderTargets() {
+    _levels.clear();
+}
+
+void VRODualFilterBloomRenderPass::setViewport(VROViewport rtViewport) {
+    for (int i = 0; i < _levels.size(); i++) {
+        _levels[i]->setViewport({ 0, 0,
+                                  std::max(1, rtViewport.getWidth()  >> (i + 1)),
+                                  std::max(1, rtViewport.getHeight() >> (i + 1)) });
+    }
+}
+
+void VRODualFilterBloomRenderPass::setClearColor(VROVector4f color) {
+    for (std::shared_ptr<VRORenderTarget> &level : _levels) {
+        level->setClearColor(color);
+    }
+    
+    bool considerTransparentPixels = color.w != 1.0;
+    if (considerTransparentPixels != _considerTransparentPixels) {
+        _considerTransparentPixels = considerTransparentPixels;
+        updateTargetFormats();
+        resetShaders();
+    }
+}
+
+void VRODualFilterBloomRenderPass::updateTargetFormats() {
+    // Alpha is only carried through the mip chain when compositing onto transparent pixels
+    VROAttachmentFormat format = (_packedFloatSupported && !_considerTransparentPixels) ?
+                                  VROAttachmentFormat::R11G11B10F : VROAttachmentFormat::Default;
+    for (std::shared_ptr<VRORenderTarget> &level : _levels) {
+        level->setAttachmentFormat(0, format);
+    }
+}
+
+void VRODualFilterBloomRenderPass::setNumLevels(int numLevels) {
+    _numLevels = std::max(1, std::min(numLevels, kDualFilterBloomNumLevels));
+}
+
+void VRODualFilterBloomRenderPass::setSampleOffset(float offset) {
+    _sampleOffset = offset;
+    resetShaders();
+}
+
+void VRODualFilterBloomRenderPass::resetShaders() {
+    _prefilterDownsample = nullptr;
+    _downsample = nullptr;
+    _upsample = nullptr;
+}
+
+void VRODualFilterBloomRenderPass::initPostProcesses(std::shared_ptr<VRODriver> driver) {
+    _prefilterDownsample = createDownsample(true, driver);
+    _downsample = createDownsample(false, driver);
+    _upsample = createUpsample(driver);
+}
+
+std::shared_ptr<VROImagePostProcess> VRODualFilterBloomRenderPass::createDownsample(bool prefilter,
+                                                                                    std::shared_ptr<VRODriver> driver) {
+    // Each fragment of the destination lies on the corner of four source texels. The
+    // center tap averages those four, and the diagonal taps average the 2x2 blocks
+    // surrounding them, so each fragment filters a 4x4 block weighted toward its center.
+    std::string offset = VROStringUtil::toString(_sampleOffset, 3);
+    std::vector<std::string> samplers = { "image" };
+    std::vector<std::string> code = {
+        "uniform sampler2D image;",
+        "highp vec2 texel = " + offset + " / vec2(textureSize(image, 0));",
+        "highp vec4 t0 = texture(image, v_texcoord);",
+        "highp vec4 t1 = texture(image, v_texcoord - texel);",
+        "highp vec4 t2 = texture(image, v_texcoord + texel);",
+        "highp vec4 t3 = texture(image, v_texcoord + vec2(texel.x, -texel.y));",
+        "highp vec4 t4 = texture(image, v_texcoord - vec2(texel.x, -texel.y));",
+    };
+    
+    // The first downsample also pre-processes the bloom input in the same manner as
+    // VROGaussianBlurRenderPass: when compositing onto a semi-transparent renderer we
+    // premultiply each tap by its alpha, otherwise we ignore alpha entirely so that the
+    // blur does not 'eat into' and weaken the bloom.
+    if (prefilter && _considerTransparentPixels) {
+        for (int i = 0; i < 5; i++) {
+            std::string t = "t" + VROStringUtil::toString(i);
+            code.push_back(t + ".rgb *= " + t + ".a;");
+        }
+    }
+    code.push_back("highp vec4 sum = t0 * 4.0 + t1 + t2 + t3 + t4;");
+    if (prefilter && !_considerTransparentPixels) {
+        code.push_back("frag_color = vec4(sum.rgb / 8.0, 1.0);");
+    }
+    else {
+        code.push_back("frag_color = sum / 8.0;");
+    }
+    return driver->newImagePostProcess(VROImageShaderProgram::create(samplers, code, driver));
+}
+
+std::shared_ptr<VROImagePostProcess> VRODualFilterBloomRenderPass::createUpsample(std::shared_ptr<VRODriver> driver) {
+    // A tent filter over the smaller source: four taps along the axes and four (doubly
+    // weighted) taps on the diagonals, at half the distance.
+    std::string offset = VROStringUtil::toString(_sampleOffset * 0.5, 3);
+    std::vector<std::string> samplers = { "image" };
+    std::vector<std::string> code = {
+        "uniform sampler2D image;",
+        "highp vec2 hp = " + offset + " / vec2(textureSize(image, 0));",
+        "highp vec4 sum = texture(image, v_texcoord + vec2(-hp.x * 2.0, 0.0));",
+        "sum += texture(image, v_texcoord + vec2(-hp.x, hp.y)) * 2.0;",
+        "sum += texture(image, v_texcoord + vec2(0.0, hp.y * 2.0));",
+        "sum += texture(image, v_texcoord + vec2(hp.x, hp.y)) * 2.0;",
+        "sum += texture(image, v_texcoord + vec2(hp.x * 2.0, 0.0));",
+        "sum += texture(image, v_texcoord + vec2(hp.x, -hp.y)) * 2.0;",
+        "sum += texture(image, v_texcoord + vec2(0.0, -hp.y * 2.0));",
+        "sum += texture(image, v_texcoord + vec2(-hp.x, -hp.y)) * 2.0;",
+        "frag_color = sum / 12.0;",
+    };
+    return driver->newImagePostProcess(VROImageShaderProgram::create(samplers, code, driver));
+}
+
+void VRODualFilterBloomRenderPass::render(std::shared_ptr<VROScene> scene,
+                                          std::shared_ptr<VROScene> outgoingScene,
+                                          VRORenderPassInputOutput &inputs,
+                                          VRORenderContext *context, std::shared_ptr<VRODriver> &driver) {
+    passert (!_levels.empty());
+    if (!_downsample) {
+        initPostProcesses(driver);
+    }
+    
+    int numLevels = std::min(_numLevels, (int) _levels.size());
+    for (int i = 0; i < numLevels; i++) {
+        _levels[i]->hydrate();
+    }
+    std::shared_ptr<VROTexture> input = inputs.textures[kDualFilterBloomInput];
+    
+    pglpush("Bloom");
+    driver->setBlendingMode(VROBlendMode::None);
+    
+    // Pre-process and downsample the input into the first (half resolution) level
+    _prefilterDownsample->begin(driver);
+    driver->bindRenderTarget(_levels[0], VRORenderTargetActions::overwrite(), VRORenderTargetUnbindOp::Invalidate);
+    _prefilterDownsample->blitOpt({ input }, driver);
+    _prefilterDownsample->end(driver);
+    
+    // Progressively downsample to the bottom of the chain
+    if (numLevels > 1) {
+        _downsample->begin(driver);
+        for (int i = 1; i < numLevels; i++) {
+            driver->bindRenderTarget(_levels[i], VRORenderTargetActions::overwrite(), VRORenderTargetUnbindOp::Invalidate);
+            _downsample->blitOpt({ _levels[i - 1]->getTexture(0) }, driver);
+        }
+        _downsample->end(driver);
+        
+        // Then upsample back up the chain, overwriting the downsampled contents of each
+        // level (which are no longer needed) with the upsampled result
+        _upsample->begin(driver);
+        for (int i = numLevels - 2; i >= 0; i--) {
+            driver->bindRenderTarget(_levels[i], VRORenderTargetActions::overwrite(), VRORenderTargetUnbindOp::Invalidate);
+            _upsample->blitOpt({ _levels[i + 1]->getTexture(0) }, driver);
+        }
+        _upsample->end(driver);
+    }
+    pglpop();
+    
+    inputs.outputTarget = _levels[0];
+}
@@ -0,0 +1,137 @@
+//
+//  VRODualFilterBloomRenderPass.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VRODualFilterBloomRenderPass_h
+#define VRODualFilterBloomRenderPass_h
+
+#include <vector>
+#include "VRORenderPass.h"
+#include "VROVector4f.h"
+
+class VRODriver;
+class VROImagePostProcess;
+class VROViewport;
+
+/*
+ Keys for the dual filter bloom render pass.
+ */
+const std::string kDualFilterBloomInput = "DFB_Input";
+
+/*
+ The number of levels in the bloom mip chain. The first level is half the
+ resolution of the input, and each subsequent level halves it again, down
+ to 1/32.
+ */
+static const int kDualFilterBloomNumLevels = 5;
+
+/*
+ Implements bloom with the dual filter (dual Kawase) blur. The input is
+ progressively downsampled through a chain of render targets, then upsampled
+ back up the same chain. Each step reads only a handful of bilinear taps from
+ a target a quarter the size of the last, so the blur is far cheaper in
+ bandwidth than a full-resolution Gaussian, and spreads wider.
+
+ The result resides in the first (half resolution) level of the chain, and is
+ output through inputs.outputTarget.
+ */
+class VRODualFilterBloomRenderPass : public VRORenderPass {
+public:
+    
+    VRODualFilterBloomRenderPass();
+    virtual ~VRODualFilterBloomRenderPass();
+    
+    void render(std::shared_ptr<VROScene> scene,
+                std::shared_ptr<VROScene> outgoingScene,
+                VRORenderPassInputOutput &inputs,
+                VRORenderContext *context, std::shared_ptr<VRODriver> &driver);
+    
+    /*
+     Functions for handling the render targets of the mip chain.
+     */
+    void createRenderTargets(std::shared_ptr<VRODriver> &driver);
+    void resetRenderTargets();
+    void setViewport(VROViewport viewport);
+    
+    /*
+     Notifies this pass of the current background color configuration of the
+     renderer (and more importantly, if there are any semi-transparent pixels).
+     */
+    void setClearColor(VROVector4f color);
+    
+    /*
+     Set the number of levels of the mip chain to use, from 1 to
+     kDualFilterBloomNumLevels. More levels produce a wider glow.
+     */
+    void setNumLevels(int numLevels);
+    
+    /*
+     Set the distance, in texels, of the blur taps from the center of each
+     fragment. Larger offsets spread the blur further at the cost of quality.
+     */
+    void setSampleOffset(float offset);
+    
+private:
+    
+    /*
+     The render targets of the mip chain, from largest to smallest.
+     */
+    std::vector<std::shared_ptr<VRORenderTarget>> _levels;
+    
+    int _numLevels;
+    float _sampleOffset;
+    
+    /*
+     True if we are compositing onto a renderer that has transparent pixels. In
+     this case the first downsample premultiplies each tap by its alpha.
+     */
+    bool _considerTransparentPixels;
+    
+    /*
+     True if the driver can render to R11G11B10F, in which case the mip chain uses
+     that format when there are no transparent pixels to consider.
+     */
+    bool _packedFloatSupported;
+    
+    /*
+     The first downsample (which also pre-processes the input), the remaining
+     downsamples, and the upsamples.
+     */
+    std::shared_ptr<VROImagePostProcess> _prefilterDownsample;
+    std::shared_ptr<VROImagePostProcess> _downsample;
+    std::shared_ptr<VROImagePostProcess> _upsample;
+    
+    void initPostProcesses(std::shared_ptr<VRODriver> driver);
+    std::shared_ptr<VROImagePostProcess> createDownsample(bool prefilter, std::shared_ptr<VRODriver> driver);
+    std::shared_ptr<VROImagePostProcess> createUpsample(std::shared_ptr<VRODriver> driver);
+    void resetShaders();
+    
+    /*
+     Set the attachment format of the mip chain given the current settings.
+     */
+    void updateTargetFormats();
+    
+};
+
+#endif /* VRODualFilterBloomRenderPass_h */
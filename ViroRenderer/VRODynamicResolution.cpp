@@ -0,0 +1,129 @@
+//
+//  VRODynamicResolution.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VRODynamicResolution.h"
+#include "VROMath.h"
+#include <cmath>
+
+// Weight of each new sample in the moving average of frame time
+static const double kFrameTimeSmoothing = 0.1;
+
+// Fraction of the frame budget the GPU is targeted to use, leaving headroom
+// for variation between frames
+static const double kGPUBudgetFraction = 0.85;
+
+// Frame interval, relative to the target, beyond which frames are considered missed
+static const double kMissedFrameTolerance = 1.2;
+
+// Minimum frames between reductions and between increases of the scale. Without
+// GPU times, increases are probes, and wait for a longer run of frames on time
+static const int kFramesBeforeDecrease = 10;
+static const int kFramesBeforeIncrease = 60;
+static const int kFramesBeforeProbe = 180;
+
+VRODynamicResolution::VRODynamicResolution(float minScale, float maxScale, double targetFrameTime) :
+    _targetFrameTime(targetFrameTime),
+    _scale(1.0),
+    _averageFrameTime(0),
+    _averageIsGPUTime(false),
+    _framesSinceChange(0) {
+    setBounds(minScale, maxScale);
+    _scale = _maxScale;
+}
+
+VRODynamicResolution::~VRODynamicResolution() {
+    
+}
+
+void VRODynamicResolution::setBounds(float minScale, float maxScale) {
+    _minScale = VROMathClamp(minScale, kDynamicResolutionScaleStep, 1.0f);
+    _maxScale = VROMathClamp(maxScale, _minScale, 1.0f);
+    _scale = VROMathClamp(_scale, _minScale, _maxScale);
+}
+
+bool VRODynamicResolution::update(double gpuFrameTime, double frameInterval) {
+    bool isGPUTime = gpuFrameTime > 0;
+    double frameTime = isGPUTime ? gpuFrameTime : frameInterval;
+    if (frameTime <= 0 || _targetFrameTime <= 0) {
+        return false;
+    }
+    ++_framesSinceChange;
+    
+    // Restart the average whenever the source of the frame time changes
+    if (isGPUTime != _averageIsGPUTime || _averageFrameTime <= 0) {
+        _averageFrameTime = frameTime;
+        _averageIsGPUTime = isGPUTime;
+    }
+    else {
+        _averageFrameTime += (frameTime - _averageFrameTime) * kFrameTimeSmoothing;
+    }
+    
+    float scale = _scale;
+    if (isGPUTime) {
+        // Pixel count, and so (roughly) GPU time, goes with the square of the scale
+        float idealScale = _scale * sqrt(_targetFrameTime * kGPUBudgetFraction / _averageFrameTime);
+        idealScale = floor(idealScale / kDynamicResolutionScaleStep) * kDynamicResolutionScaleStep;
+        
+        if (idealScale < _scale && _framesSinceChange >= kFramesBeforeDecrease) {
+            scale = idealScale;
+        }
+        else if (idealScale > _scale && _framesSinceChange >= kFramesBeforeIncrease) {
+            scale = idealScale;
+        }
+    }
+    else {
+        bool missingFrames = _averageFrameTime > _targetFrameTime * kMissedFrameTolerance;
+        if (missingFrames && _framesSinceChange >= kFramesBeforeDecrease) {
+            scale = _scale - kDynamicResolutionScaleStep;
+        }
+        else if (!missingFrames && _framesSinceChange >= kFramesBeforeProbe) {
+            scale = _scale + kDynamicResolutionScaleStep;
+        }
+    }
+    return setScale(scale);
+}
+
+bool VRODynamicResolution::setScale(float scale) {
+    scale = round(scale / kDynamicResolutionScaleStep) * kDynamicResolutionScaleStep;
+    scale = VROMathClamp(scale, _minScale, _maxScale);
+    if (fabs(scale - _scale) < kDynamicResolutionScaleStep / 2) {
+        return false;
+    }
+    
+    /*
+     The GPU times of the next few frames predate the change, so predict the
+     average at the new scale instead of waiting for it to converge; this keeps
+     the scale from overshooting.
+     */
+    if (_averageIsGPUTime) {
+        _averageFrameTime *= (scale * scale) / (_scale * _scale);
+    }
+    else {
+        _averageFrameTime = _targetFrameTime;
+    }
+    _scale = scale;
+    _framesSinceChange = 0;
+    return true;
+}
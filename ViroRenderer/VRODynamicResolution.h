@@ -0,0 +1,102 @@
+//
+//  VRODynamicResolution.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VRODynamicResolution_h
+#define VRODynamicResolution_h
+
+/*
+ The render scale is quantized to this step, so that render targets are only
+ reallocated when the scale changes meaningfully.
+ */
+static const float kDynamicResolutionScaleStep = 0.05;
+
+/*
+ Chooses the scale at which the scene is rendered, relative to the display, to
+ hold a target frame time. The scale applies to each axis of the render targets
+ and is kept within the given bounds.
+ 
+ Each frame is fed the GPU time of a recent frame, from timer queries, or where
+ timer queries are unavailable, the CPU interval between frames. With GPU times
+ the scale is driven toward the resolution that would use a fixed fraction of
+ the frame budget, assuming GPU time is proportional to the number of pixels
+ rendered. Frame intervals only reveal missed frames, so in that case the scale
+ steps down while frames are missed, and probes back up after a sustained run
+ of frames on time. Reductions respond faster than increases, to recover from
+ load spikes quickly without oscillating.
+ */
+class VRODynamicResolution {
+public:
+    
+    VRODynamicResolution(float minScale, float maxScale, double targetFrameTime);
+    virtual ~VRODynamicResolution();
+    
+    /*
+     Update the scale from the timing of the last frame, in milliseconds. The GPU
+     frame time is negative if unknown. Returns true if the scale changed.
+     */
+    bool update(double gpuFrameTime, double frameInterval);
+    
+    /*
+     Get the current scale, which begins at the maximum.
+     */
+    float getScale() const {
+        return _scale;
+    }
+    
+    /*
+     Set the bounds on the scale, and the target frame time in milliseconds.
+     */
+    void setBounds(float minScale, float maxScale);
+    void setTargetFrameTime(double targetFrameTime) {
+        _targetFrameTime = targetFrameTime;
+    }
+    
+private:
+    
+    float _minScale, _maxScale;
+    double _targetFrameTime;
+    float _scale;
+    
+    /*
+     Moving average of the frame time, which tracks either GPU time or frame
+     interval depending on which was last available.
+     */
+    double _averageFrameTime;
+    bool _averageIsGPUTime;
+    
+    /*
+     Frames elapsed since the scale last changed.
+     */
+    int _framesSinceChange;
+    
+    /*
+     Move to the given scale, quantized and clamped to the bounds. Returns true
+     if the scale changed.
+     */
+    bool setScale(float scale);
+    
+};
+
+#endif /* VRODynamicResolution_h */
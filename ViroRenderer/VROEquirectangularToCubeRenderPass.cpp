@@ -65,6 +65,12 @@ void VROEquirectangularToCubeRenderPass::render(std::shared_ptr<VROScene> scene,
                                                 std::shared_ptr<VROScene> outgoingScene,
                                                 VRORenderPassInputOutput &inputs,
                                                 VRORenderContext *context, std::shared_ptr<VRODriver> &driver) {
+    for (int slice = 0; slice < getNumSlices(); slice++) {
+        renderSlice(slice, inputs, driver);
+    }
+}
+
+void VROEquirectangularToCubeRenderPass::renderSlice(int slice, VRORenderPassInputOutput &inputs, std::shared_ptr<VRODriver> &driver) {
     if (!_shader) {
         init(driver);
     }
@@ -73,8 +79,12 @@ void VROEquirectangularToCubeRenderPass::render(std::shared_ptr<VROScene> scene,
     // Bind the HDR texture to texture unit 0
     VRORenderUtil::bindTexture(0, inputs.textures[kEquirectangularToCubeHDRTextureInput], driver);
     
-    // Bind the destination render target
-    driver->bindRenderTarget(_cubeRenderTarget, VRORenderTargetUnbindOp::Invalidate);
+    int face = slice;
+    
+    // Attach the face before binding the target, so that the bind only discards the
+    // face being rendered (the others may have been rendered by earlier slices)
+    _cubeRenderTarget->setTextureCubeFace(face, 0, 0);
+    driver->bindRenderTarget(_cubeRenderTarget, VRORenderTargetActions::overwrite(), VRORenderTargetUnbindOp::Invalidate);
     
     // Setup for rendering the cube
     VRORenderUtil::prepareForBlit(driver, true, false);
@@ -96,15 +106,23 @@ void VROEquirectangularToCubeRenderPass::render(std::shared_ptr<VROScene> scene,
     };
     
     _shader->getUniform("projection_matrix")->setMat4(captureProjection);
+    _shader->getUniform("view_matrix")->setMat4(captureViews[face]);
+    
+    GL( glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT) );
+    VRORenderUtil::renderUnitCube(&_cubeVAO, &_cubeVBO, driver);
     
-    for (int i = 0; i < 6; ++i) {
-        _shader->getUniform("view_matrix")->setMat4(captureViews[i]);
-        _cubeRenderTarget->setTextureCubeFace(i, 0, 0);
-        GL( glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT) );
-        VRORenderUtil::renderUnitCube(&_cubeVAO, &_cubeVBO);
-    }
     driver->unbindShader();
     pglpop();
     inputs.outputTarget = _cubeRenderTarget;
 }
 
+int VROEquirectangularToCubeRenderPass::getNumSlices() const {
+    return 6;
+}
+
+void VROEquirectangularToCubeRenderPass::beginNewOutput() {
+    if (_cubeRenderTarget) {
+        _cubeRenderTarget->attachNewTextures();
+    }
+}
+
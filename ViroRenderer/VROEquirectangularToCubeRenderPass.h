@@ -50,6 +50,20 @@ public:
                 VRORenderPassInputOutput &inputs,
                 VRORenderContext *context, std::shared_ptr<VRODriver> &driver);
     
+    /*
+     Render a single slice (one face) of the cubemap. Slices may be rendered on
+     separate frames, so that the work can be time-sliced; render() renders all of
+     them at once.
+     */
+    void renderSlice(int slice, VRORenderPassInputOutput &inputs, std::shared_ptr<VRODriver> &driver);
+    int getNumSlices() const;
+    
+    /*
+     Render subsequent slices to a new cubemap texture, so that the texture of the
+     last render remains intact for those still using it.
+     */
+    void beginNewOutput();
+    
 private:
    
     unsigned int _cubeVAO = 0;
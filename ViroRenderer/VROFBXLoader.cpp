@@ -35,12 +35,14 @@
 #include "VROSkeleton.h"
 #include "VROBone.h"
 #include "VROSkeletalAnimation.h"
+#include "VROAnimationClip.h"
 #include "VROBoneUBO.h"
+#include "VROGeometryUtil.h"
 #include "VROKeyframeAnimation.h"
 #include "VROTaskQueue.h"
+#include "VROCompress.h"
 #include "Nodes.pb.h"
-#include <google/protobuf/io/gzip_stream.h>
-#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <google/protobuf/io/zero_copy_stream.h>
 
 #include "VRODefines.h"
 #if VRO_PLATFORM_IOS || VRO_PLATFORM_MACOS
@@ -49,6 +51,68 @@
 
 static bool kDebugFBXLoading = false;
 
+/*
+ Adapts a VROInflateStream to a protobuf input stream, so that the FBX protobuf
+ is parsed while the chunks that follow are inflated.
+ */
+class VROInflateInputStream : public google::protobuf::io::ZeroCopyInputStream {
+public:
+    
+    VROInflateInputStream(const void *data, size_t length) :
+        _stream(data, length), _chunk(nullptr), _chunkSize(0), _backedUp(0), _byteCount(0) {}
+    virtual ~VROInflateInputStream() {}
+    
+    bool Next(const void **data, int *size) {
+        if (_backedUp > 0) {
+            *data = _chunk + _chunkSize - _backedUp;
+            *size = _backedUp;
+        }
+        else {
+            const void *chunk;
+            if (!_stream.next(&chunk, &_chunkSize)) {
+                return false;
+            }
+            _chunk = (const uint8_t *) chunk;
+            *data = chunk;
+            *size = _chunkSize;
+        }
+        _byteCount += *size;
+        _backedUp = 0;
+        return true;
+    }
+    
+    void BackUp(int count) {
+        _backedUp = count;
+        _byteCount -= count;
+    }
+    
+    bool Skip(int count) {
+        const void *data;
+        int size;
+        while (count > 0 && Next(&data, &size)) {
+            if (size > count) {
+                BackUp(size - count);
+                return true;
+            }
+            count -= size;
+        }
+        return count == 0;
+    }
+    
+    google::protobuf::int64 ByteCount() const {
+        return _byteCount;
+    }
+    
+private:
+    
+    VROInflateStream _stream;
+    const uint8_t *_chunk;
+    int _chunkSize;
+    int _backedUp;
+    google::protobuf::int64 _byteCount;
+    
+};
+
 VROGeometrySourceSemantic convert(viro::Node_Geometry_Source_Semantic semantic) {
     switch (semantic) {
         case viro::Node_Geometry_Source_Semantic_Vertex:
@@ -134,6 +198,17 @@ VROFilterMode convert(viro::Node_Geometry_Material_Visual_FilterMode filterMode)
     }
 }
 
+/*
+ Move a bytes field out of its protobuf message into a VROData, without copying it.
+ The field is left empty.
+ */
+static std::shared_ptr<VROData> releaseData(std::string *data) {
+    if (data == nullptr) {
+        data = new std::string();
+    }
+    return std::make_shared<VROData>(data);
+}
+
 void setTextureProperties(VROLightingModel lightingModel, const viro::Node::Geometry::Material::Visual &pb, std::shared_ptr<VROTexture> &texture) {
     // Temporary check: there is no way to set wrap modes and filters in FBX with PBR currently,
     // so force PBR materials to use the default (linear, linear, linear, clamp, clamp).
@@ -183,6 +258,8 @@ void VROFBXLoader::injectFBX(std::shared_ptr<VRONode> fbxNode,
                              std::shared_ptr<VRODriver> driver,
                              std::function<void(std::shared_ptr<VRONode> node, bool success)> onFinish) {
     if (fbxNode) {
+        VROModelIOUtil::deduplicateMaterials(fbxNode);
+
         // The top-level fbxNode is a dummy; all of the data is stored in the children, so we
         // simply transfer those children over to the destination node
         for (std::shared_ptr<VRONode> child : fbxNode->getChildNodes()) {
@@ -231,13 +308,26 @@ void VROFBXLoader::readFBXProtobufAsync(std::string resource, VROResourceType ty
     VROPlatformDispatchAsyncBackground([resource, type, node, path, resourceMap, driver, onFinish, isTemp, loadingTexturesFromResourceMap] {
         pinfo("Loading FBX from file %s", path.c_str());
 
-        std::string data_pb_gzip = VROPlatformLoadFileAsString(path);
-        if (!data_pb_gzip.empty()) {
-            google::protobuf::io::ArrayInputStream input(data_pb_gzip.data(), (int) data_pb_gzip.size());
-            google::protobuf::io::GzipInputStream gzipIn(&input);
-            
+        // Map the compressed file instead of reading it. Files whose gzip members record
+        // their sizes are inflated in parallel, then parsed; others are inflated on a
+        // separate thread as they're parsed
+        size_t length = 0;
+        const void *data_pb_gzip = VROPlatformMapFile(path, &length);
+        if (data_pb_gzip) {
             std::shared_ptr<viro::Node> node_pb = std::make_shared<viro::Node>();
-            if (node_pb->ParseFromZeroCopyStream(&gzipIn)) {
+            bool parsed;
+            if (VROCompress::isParallelDecompressible(data_pb_gzip, length)) {
+                std::string data_pb;
+                parsed = VROCompress::decompress(data_pb_gzip, length, &data_pb) &&
+                         node_pb->ParseFromString(data_pb);
+            }
+            else {
+                VROInflateInputStream inflateIn(data_pb_gzip, length);
+                parsed = node_pb->ParseFromZeroCopyStream(&inflateIn);
+            }
+            VROPlatformUnmapFile(data_pb_gzip, length);
+
+            if (parsed) {
                 if (kDebugFBXLoading) {
                     pinfo("Read FBX protobuf");
                 }
@@ -251,32 +341,31 @@ void VROFBXLoader::readFBXProtobufAsync(std::string resource, VROResourceType ty
                 if (loadingTexturesFromResourceMap) {
                     fileMap = VROModelIOUtil::createResourceMap(resourceMap, type);
                 }
+                std::string base = resource.substr(0, resource.find_last_of('/'));
+
+                // Build the FBX from the protobuf here in the background, accumulating additional
+                // tasks (e.g. async texture download) in the task queue
+                std::shared_ptr<VROTaskQueue> taskQueue = std::make_shared<VROTaskQueue>(
+                        "fbx", VROTaskExecutionOrder::Concurrent);
+                std::shared_ptr<std::map<std::string, std::shared_ptr<VROTexture>>> textureCache = std::make_shared<std::map<std::string, std::shared_ptr<VROTexture>>>();
+                std::shared_ptr<VRONode> fbxNode = loadFBX(*node_pb, base,
+                                                           loadingTexturesFromResourceMap
+                                                           ? VROResourceType::LocalFile
+                                                           : type,
+                                                           loadingTexturesFromResourceMap
+                                                           ? fileMap : nullptr,
+                                                           textureCache, taskQueue, driver);
 
                 VROPlatformDispatchAsyncRenderer(
-                        [node, node_pb, resource, type, loadingTexturesFromResourceMap, fileMap, driver, onFinish] {
-                            std::string base = resource.substr(0, resource.find_last_of('/'));
-
-                            // Load the FBX from the protobuf on the rendering thread, accumulating additional
-                            // tasks (e.g. async texture download) in the task queue
-                            std::shared_ptr<VROTaskQueue> taskQueue = std::make_shared<VROTaskQueue>(
-                                    "fbx", VROTaskExecutionOrder::Serial);
-                            
+                        [node, node_pb, fbxNode, taskQueue, textureCache, driver, onFinish] {
+                            restoreThreadRestrictions(fbxNode);
+
                             // Add the task queue to the node so it doesn't get deleted until the model
                             // is loaded
                             node->addTaskQueue(taskQueue);
 
-
-                            std::shared_ptr<std::map<std::string, std::shared_ptr<VROTexture>>> textureCache = std::make_shared<std::map<std::string, std::shared_ptr<VROTexture>>>();
-                            std::shared_ptr<VRONode> fbxNode = loadFBX(*node_pb, node, base,
-                                                                       loadingTexturesFromResourceMap
-                                                                       ? VROResourceType::LocalFile
-                                                                       : type,
-                                                                       loadingTexturesFromResourceMap
-                                                                       ? fileMap : nullptr,
-                                                                       textureCache, taskQueue, driver);
-
                             // Run all the async tasks. When they're complete, inject the finished FBX into the
-                            // node
+                            // node. The tasks refer to the protobuf, so it is retained until then.
                             std::weak_ptr<VRONode> node_w = node;
                             std::weak_ptr<VROTaskQueue> taskQueue_w = taskQueue;
                             taskQueue->processTasksAsync(
@@ -307,8 +396,7 @@ void VROFBXLoader::readFBXProtobufAsync(std::string resource, VROResourceType ty
     });
 }
 
-std::shared_ptr<VRONode> VROFBXLoader::loadFBX(viro::Node &node_pb, std::shared_ptr<VRONode> finalRootNode,
-                                               std::string base, VROResourceType type,
+std::shared_ptr<VRONode> VROFBXLoader::loadFBX(viro::Node &node_pb, std::string base, VROResourceType type,
                                                std::shared_ptr<std::map<std::string, std::string>> resourceMap,
                                                std::shared_ptr<std::map<std::string, std::shared_ptr<VROTexture>>> textureCache,
                                                std::shared_ptr<VROTaskQueue> taskQueue,
@@ -325,8 +413,9 @@ std::shared_ptr<VRONode> VROFBXLoader::loadFBX(viro::Node &node_pb, std::shared_
     // FBX mesh. We use our outer VRONode for the same purpose, to
     // contain the root nodes of the FBX file
     std::shared_ptr<VRONode> tempRootNode = std::make_shared<VRONode>();
+    tempRootNode->setThreadRestrictionEnabled(false);
     for (int i = 0; i < node_pb.subnode_size(); i++) {
-        std::shared_ptr<VRONode> node = loadFBXNode(node_pb.subnode(i), skeleton, base, type,
+        std::shared_ptr<VRONode> node = loadFBXNode(*node_pb.mutable_subnode(i), skeleton, base, type,
                                                     resourceMap, textureCache, taskQueue, driver);
         tempRootNode->addChildNode(node);
     }
@@ -335,7 +424,7 @@ std::shared_ptr<VRONode> VROFBXLoader::loadFBX(viro::Node &node_pb, std::shared_
     return tempRootNode;
 }
 
-std::shared_ptr<VRONode> VROFBXLoader::loadFBXNode(const viro::Node &node_pb,
+std::shared_ptr<VRONode> VROFBXLoader::loadFBXNode(viro::Node &node_pb,
                                                    std::shared_ptr<VROSkeleton> skeleton,
                                                    std::string base, VROResourceType type,
                                                    std::shared_ptr<std::map<std::string, std::string>> resourceMap,
@@ -348,6 +437,7 @@ std::shared_ptr<VRONode> VROFBXLoader::loadFBXNode(const viro::Node &node_pb,
     }
     
     std::shared_ptr<VRONode> node = std::make_shared<VRONode>();
+    node->setThreadRestrictionEnabled(false);
     node->setName(node_pb.name());
     node->setPosition({ node_pb.position(0), node_pb.position(1), node_pb.position(2) });
     node->setScale({ node_pb.scale(0), node_pb.scale(1), node_pb.scale(2) });
@@ -358,23 +448,18 @@ std::shared_ptr<VRONode> VROFBXLoader::loadFBXNode(const viro::Node &node_pb,
     node->setOpacity(node_pb.opacity());
     
     if (node_pb.has_geometry()) {
-        const viro::Node_Geometry &geo_pb = node_pb.geometry();
+        viro::Node_Geometry &geo_pb = *node_pb.mutable_geometry();
         std::shared_ptr<VROGeometry> geo = loadFBXGeometry(geo_pb, base, type, resourceMap, textureCache, taskQueue, driver);
         geo->setName(node_pb.name());
         
         if (geo_pb.has_skin() && skeleton) {
-            std::shared_ptr<VROSkinner> skinner = loadFBXSkinner(geo_pb.skin(), skeleton, driver);
+            std::shared_ptr<VROSkinner> skinner = loadFBXSkinner(*geo_pb.mutable_skin(), skeleton, driver);
             geo->setSkinner(skinner);
             skinner->setSkinnerNode(node);
             skeleton->setSkinnerRootNode(node);
             
-            bool hasScaling = false;
             for (int i = 0; i < node_pb.skeletal_animation_size(); i++) {
                 const viro::Node::SkeletalAnimation &animation_pb = node_pb.skeletal_animation(i);
-                if (animation_pb.has_scaling()) {
-                    hasScaling = true;
-                }
-                
                 std::shared_ptr<VROSkeletalAnimation> animation = loadFBXSkeletalAnimation(animation_pb, skinner);
                 if (animation->getName().empty()) {
                     animation->setName("fbx_skel_animation_" + VROStringUtil::toString(i));
@@ -390,25 +475,24 @@ std::shared_ptr<VRONode> VROFBXLoader::loadFBXNode(const viro::Node &node_pb,
                 // default to identity, which can give odd results).
                 if (i == 0 && !animation->getFrames().empty()) {
                     const std::unique_ptr<VROSkeletalAnimationFrame> &frame = animation->getFrames().front();
-                    for (int f = 0; f < frame->boneIndices.size(); f++) {
-                        std::shared_ptr<VROBone> bone = skeleton->getBone(frame->boneIndices[f]);
-                        bone->setTransform(frame->boneTransforms[f], frame->boneTransformsLegacy ? VROBoneTransformType::Legacy : VROBoneTransformType::Concatenated);
+                    const std::shared_ptr<VROAnimationClip> &clip = animation->getClip();
+                    for (int track = 0; track < clip->getNumTracks(); track++) {
+                        std::shared_ptr<VROBone> bone = skeleton->getBone(clip->getTrackTarget(track));
+                        bone->setTransform(clip->sample(track, frame->time),
+                                           frame->boneTransformsLegacy ? VROBoneTransformType::Legacy : VROBoneTransformType::Concatenated);
                     }
                 }
             }
             
-            if (hasScaling) {
-                if (kDebugFBXLoading) {
-                    pinfo("   At least 1 animation has scaling: using DQ+S modifier");
-                }
-            }
-            
             for (const std::shared_ptr<VROMaterial> &material : geo->getMaterials()) {
-                material->addShaderModifier(VROBoneUBO::createSkinningShaderModifier(hasScaling));
+                material->addShaderModifier(VROBoneUBO::createSkinningShaderModifier());
             }
         }
         
         node->setGeometry(geo);
+        if (geo->getSkinner()) {
+            VROGeometryUtilSplitNodeByBoneLimit(node, VROBoneUBO::getMaxBones(VROSkinningMode::Matrix));
+        }
     }
     
     for (int i = 0; i < node_pb.keyframe_animation_size(); i++) {
@@ -426,7 +510,7 @@ std::shared_ptr<VRONode> VROFBXLoader::loadFBXNode(const viro::Node &node_pb,
     }
     
     for (int i = 0; i < node_pb.subnode_size(); i++) {
-        std::shared_ptr<VRONode> subnode = loadFBXNode(node_pb.subnode(i), skeleton, base, type,
+        std::shared_ptr<VRONode> subnode = loadFBXNode(*node_pb.mutable_subnode(i), skeleton, base, type,
                                                        resourceMap, textureCache, taskQueue, driver);
         node->addChildNode(subnode);
     }
@@ -434,13 +518,13 @@ std::shared_ptr<VRONode> VROFBXLoader::loadFBXNode(const viro::Node &node_pb,
     return node;
 }
 
-std::shared_ptr<VROGeometry> VROFBXLoader::loadFBXGeometry(const viro::Node_Geometry &geo_pb,
+std::shared_ptr<VROGeometry> VROFBXLoader::loadFBXGeometry(viro::Node_Geometry &geo_pb,
                                                            std::string base, VROResourceType type,
                                                            std::shared_ptr<std::map<std::string, std::string>> resourceMap,
                                                            std::shared_ptr<std::map<std::string, std::shared_ptr<VROTexture>>> textureCache,
                                                            std::shared_ptr<VROTaskQueue> taskQueue,
                                                            std::shared_ptr<VRODriver> driver) {
-    std::shared_ptr<VROData> varData = std::make_shared<VROData>(geo_pb.data().c_str(), geo_pb.data().length());
+    std::shared_ptr<VROData> varData = releaseData(geo_pb.release_data());
     std::shared_ptr<VROVertexBuffer> vertexBuffer = driver->newVertexBuffer(varData);
     
     std::vector<std::shared_ptr<VROGeometrySource>> sources;
@@ -459,9 +543,9 @@ std::shared_ptr<VROGeometry> VROFBXLoader::loadFBXGeometry(const viro::Node_Geom
     
     std::vector<std::shared_ptr<VROGeometryElement>> elements;
     for (int i = 0; i < geo_pb.element_size(); i++) {
-        const viro::Node::Geometry::Element &element_pb = geo_pb.element(i);
+        viro::Node::Geometry::Element &element_pb = *geo_pb.mutable_element(i);
         
-        std::shared_ptr<VROData> data = std::make_shared<VROData>(element_pb.data().c_str(), element_pb.data().length());
+        std::shared_ptr<VROData> data = releaseData(element_pb.release_data());
         std::shared_ptr<VROGeometryElement> element = std::make_shared<VROGeometryElement>(data,
                                                                                            convert(element_pb.primitive()),
                                                                                            element_pb.primitive_count(),
@@ -724,7 +808,7 @@ std::shared_ptr<VROSkeleton> VROFBXLoader::loadFBXSkeleton(const viro::Node_Skel
     return std::make_shared<VROSkeleton>(bones);
 }
 
-std::shared_ptr<VROSkinner> VROFBXLoader::loadFBXSkinner(const viro::Node_Geometry_Skin &skin_pb,
+std::shared_ptr<VROSkinner> VROFBXLoader::loadFBXSkinner(viro::Node_Geometry_Skin &skin_pb,
                                                          std::shared_ptr<VROSkeleton> skeleton,
                                                          std::shared_ptr<VRODriver> driver) {
     
@@ -750,8 +834,8 @@ std::shared_ptr<VROSkinner> VROFBXLoader::loadFBXSkinner(const viro::Node_Geomet
         }
     }
     
-    const viro::Node::Geometry::Source &bone_indices_pb = skin_pb.bone_indices();
-    std::shared_ptr<VROData> boneIndicesData = std::make_shared<VROData>(bone_indices_pb.data().c_str(), bone_indices_pb.data().length());
+    viro::Node::Geometry::Source &bone_indices_pb = *skin_pb.mutable_bone_indices();
+    std::shared_ptr<VROData> boneIndicesData = releaseData(bone_indices_pb.release_data());
     std::shared_ptr<VROGeometrySource> boneIndices = std::make_shared<VROGeometrySource>(driver->newVertexBuffer(boneIndicesData),
                                                                                          convert(bone_indices_pb.semantic()),
                                                                                          bone_indices_pb.vertex_count(),
@@ -761,8 +845,8 @@ std::shared_ptr<VROSkinner> VROFBXLoader::loadFBXSkinner(const viro::Node_Geomet
                                                                                          bone_indices_pb.data_offset(),
                                                                                          bone_indices_pb.data_stride());
     
-    const viro::Node::Geometry::Source &bone_weights_pb = skin_pb.bone_weights();
-    std::shared_ptr<VROData> boneWeightsData = std::make_shared<VROData>(bone_weights_pb.data().c_str(), bone_weights_pb.data().length());
+    viro::Node::Geometry::Source &bone_weights_pb = *skin_pb.mutable_bone_weights();
+    std::shared_ptr<VROData> boneWeightsData = releaseData(bone_weights_pb.release_data());
     std::shared_ptr<VROGeometrySource> boneWeights = std::make_shared<VROGeometrySource>(driver->newVertexBuffer(boneWeightsData),
                                                                                          convert(bone_weights_pb.semantic()),
                                                                                          bone_weights_pb.vertex_count(),
@@ -854,6 +938,13 @@ std::shared_ptr<VROKeyframeAnimation> VROFBXLoader::loadFBXKeyframeAnimation(con
     return animation;
 }
 
+void VROFBXLoader::restoreThreadRestrictions(std::shared_ptr<VRONode> node) {
+    node->setThreadRestrictionEnabled(true);
+    for (std::shared_ptr<VRONode> &child : node->getChildNodes()) {
+        restoreThreadRestrictions(child);
+    }
+}
+
 void VROFBXLoader::trimEmptyNodes(std::shared_ptr<VRONode> node) {
     std::vector<std::shared_ptr<VRONode>> toRemove;
     for (std::shared_ptr<VRONode> &child : node->getChildNodes()) {
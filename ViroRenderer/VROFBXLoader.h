@@ -93,15 +93,17 @@ private:
     
     /*
      Load the FBX subgraph for the given file. The top-level node returned here is a dummy; all the
-     data is stored in its children.
+     data is stored in its children. This runs on a background thread: the nodes are
+     built with their thread restriction lifted, until restoreThreadRestrictions is invoked on
+     the rendering thread. Geometry data is moved out of the protobuf, which is left without it.
      */
-    static std::shared_ptr<VRONode> loadFBX(viro::Node &node_pb, std::shared_ptr<VRONode> node, std::string base, VROResourceType type,
+    static std::shared_ptr<VRONode> loadFBX(viro::Node &node_pb, std::string base, VROResourceType type,
                                             std::shared_ptr<std::map<std::string, std::string>> resourceMap,
                                             std::shared_ptr<std::map<std::string, std::shared_ptr<VROTexture>>> textureCache,
                                             std::shared_ptr<VROTaskQueue> taskQueue,
                                             std::shared_ptr<VRODriver> driver);
     
-    static std::shared_ptr<VRONode> loadFBXNode(const viro::Node &node_pb,
+    static std::shared_ptr<VRONode> loadFBXNode(viro::Node &node_pb,
                                                 std::shared_ptr<VROSkeleton> skeleton,
                                                 std::string base, VROResourceType type,
                                                 std::shared_ptr<std::map<std::string, std::string>> resourceMap,
@@ -109,7 +111,7 @@ private:
                                                 std::shared_ptr<VROTaskQueue> taskQueue,
                                                 std::shared_ptr<VRODriver> driver);
     
-    static std::shared_ptr<VROGeometry> loadFBXGeometry(const viro::Node_Geometry &geo_pb,
+    static std::shared_ptr<VROGeometry> loadFBXGeometry(viro::Node_Geometry &geo_pb,
                                                         std::string base, VROResourceType type,
                                                         std::shared_ptr<std::map<std::string, std::string>> resourceMap,
                                                         std::shared_ptr<std::map<std::string, std::shared_ptr<VROTexture>>> textureCache,
@@ -117,7 +119,7 @@ private:
                                                         std::shared_ptr<VRODriver> driver);
     
     static std::shared_ptr<VROSkeleton> loadFBXSkeleton(const viro::Node_Skeleton &skeleton_pb);
-    static std::shared_ptr<VROSkinner> loadFBXSkinner(const viro::Node_Geometry_Skin &skin_pb,
+    static std::shared_ptr<VROSkinner> loadFBXSkinner(viro::Node_Geometry_Skin &skin_pb,
                                                       std::shared_ptr<VROSkeleton> skeleton,
                                                       std::shared_ptr<VRODriver> driver);
     static std::shared_ptr<VROSkeletalAnimation> loadFBXSkeletalAnimation(const viro::Node_SkeletalAnimation &animation_pb,
@@ -131,6 +133,7 @@ private:
      them each frame).
      */
     static void trimEmptyNodes(std::shared_ptr<VRONode> node);
+    static void restoreThreadRestrictions(std::shared_ptr<VRONode> node);
     static bool nodeHasGeometryRecursive(std::shared_ptr<VRONode> node);
     
 };
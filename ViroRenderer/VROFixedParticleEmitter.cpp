@@ -30,12 +30,12 @@
 #include "VROARSession.h"
 #include "VROARFrame.h"
 #include "VRONode.h"
-#include "VROBillboardConstraint.h"
 #include "VROParticleUBO.h"
 
-VROFixedParticleEmitter::VROFixedParticleEmitter(){}
+VROFixedParticleEmitter::VROFixedParticleEmitter() : _positionsChanged(false) {}
 VROFixedParticleEmitter::~VROFixedParticleEmitter(){}
-VROFixedParticleEmitter::VROFixedParticleEmitter(std::shared_ptr<VRODriver> driver) {
+VROFixedParticleEmitter::VROFixedParticleEmitter(std::shared_ptr<VRODriver> driver) :
+    _positionsChanged(false) {
     initEmitter(driver, nullptr);
 }
 
@@ -61,82 +61,62 @@ void VROFixedParticleEmitter::initEmitter(std::shared_ptr<VRODriver> driver,
 void VROFixedParticleEmitter::forceClearParticles() {
     _particles.clear();
     _zombieParticles.clear();
+    _positionsChanged = true;
     updateUBO(VROBoundingBox(0, 0, 0, 0, 0, 0));
 }
 
-void VROFixedParticleEmitter::setParticleTransforms(std::vector<VROVector4f> particleTransforms) {
+void VROFixedParticleEmitter::setParticleTransforms(const std::vector<VROVector4f> &particleTransforms) {
     _particleComputedPositions = particleTransforms;
+    _positionsChanged = true;
 }
 
 void VROFixedParticleEmitter::update(const VRORenderContext &context, const VROMatrix4f &computedTransform) {
     if (_particleComputedPositions.size() <= 0) {
         return;
     }
+    if (!_positionsChanged && computedTransform == _lastComputedTransform) {
+        return;
+    }
 
     VROBoundingBox boundingBox = updateParticles(_particleComputedPositions, computedTransform, context);
     updateUBO(boundingBox);
+    _positionsChanged = false;
+    _lastComputedTransform = computedTransform;
 }
 
-VROBoundingBox VROFixedParticleEmitter::updateParticles(std::vector<VROVector4f> particleTransforms,
+VROBoundingBox VROFixedParticleEmitter::updateParticles(const std::vector<VROVector4f> &particleTransforms,
                                                         const VROMatrix4f &baseTransform,
                                                         const VRORenderContext &context) {
-    int pointCloudIndex = 0;
-    int increment = 0;
-
-    std::shared_ptr<VROBillboardConstraint> constraint = std::make_shared<VROBillboardConstraint>(VROBillboardAxis::All);
     VROBoundingBox boundingBox = VROBoundingBox(FLT_MAX, -FLT_MAX, FLT_MAX, -FLT_MAX, FLT_MAX, -FLT_MAX);
-    
-    // repurpose existing particles in _particles array
-    if (_particles.size() > 0) {
-        increment = (int) std::min(particleTransforms.size(), _particles.size());
+    int count = std::min(_maxParticles, (int) particleTransforms.size());
 
-        for (int i = pointCloudIndex; i < pointCloudIndex + increment; i++) {
-            computeParticleTransform(&_particles[i], particleTransforms[i], constraint, &boundingBox, baseTransform, context);
-        }
-
-        // if there were more _particles than point cloud points, zombify the rest and return
-        if (_particles.size() >= particleTransforms.size()) {
-            zombifyParticles(pointCloudIndex + increment);
-            return boundingBox;
-        }
+    // If there are more _particles than points, zombify the rest
+    if (_particles.size() > count) {
+        zombifyParticles(count);
     }
 
-    // reuse zombie particles in _zombie particles
-    if (_zombieParticles.size() > 0) {
-        pointCloudIndex += increment;
-        increment = (int) std::min(particleTransforms.size(), pointCloudIndex + _zombieParticles.size()) - pointCloudIndex;
-
-        for (int i = pointCloudIndex; i < pointCloudIndex + increment; i++) {
-            std::vector<VROParticle>::iterator it = _zombieParticles.end() - 1;
-            VROParticle particle = *it;
-            computeParticleTransform(&_particles[i], particleTransforms[i], constraint, &boundingBox, baseTransform, context);
+    // Resurrect zombie particles to meet the demand, and create more particles once
+    // those are used up
+    while (_particles.size() < count) {
+        if (!_zombieParticles.empty()) {
+            _particles.push_back(_zombieParticles.back());
+            _particles.back().isZombie = false;
+            _zombieParticles.pop_back();
+        } else {
+            VROParticle particle;
+            particle.colorCurrent = VROVector4f(1, 1, 1, 1);
             _particles.push_back(particle);
-            _zombieParticles.erase(it);
-        }
-
-        // if each point cloud point has a corresponding particle, then return.
-        if (particleTransforms.size() == _particles.size()) {
-            return boundingBox;
         }
     }
 
-    // at this point we've used up ALL zombies & particles, so we should create more particles!
-    pointCloudIndex += increment;
-    increment = std::min(_maxParticles, (int)particleTransforms.size()) - pointCloudIndex;
-
-    for (int i = pointCloudIndex; i < pointCloudIndex + increment; i++) {
-        VROParticle particle;
-        computeParticleTransform(&particle, particleTransforms[i], constraint, &boundingBox, baseTransform, context);
-        particle.colorCurrent = VROVector4f(1, 1, 1, 1);
-        _particles.push_back(particle);
+    for (int i = 0; i < count; i++) {
+        computeParticleTransform(&_particles[i], particleTransforms[i], &boundingBox, baseTransform, context);
     }
-
     return boundingBox;
 }
 
 void VROFixedParticleEmitter::computeParticleTransform(VROParticle *particle,
                                                     VROVector4f position,
-                                                    std::shared_ptr<VROBillboardConstraint> constraint,
                                                     VROBoundingBox *boundingBox,
                                                     const VROMatrix4f &baseTransform,
                                                     const VRORenderContext &context) {
@@ -149,11 +129,8 @@ void VROFixedParticleEmitter::computeParticleTransform(VROParticle *particle,
     VROMatrix4f worldTransform = baseTransform.multiply(particle->currentWorldTransform);
     particle->currentWorldTransform = worldTransform;
 
-    VROMatrix4f billboardRotation = constraint->getTransform(context, particle->currentWorldTransform);
+    // The particle is billboarded by the vertex shader (see VROParticleUBO)
     VROVector3f computedPos = particle->currentWorldTransform.extractTranslation();
-    particle->currentWorldTransform.translate(computedPos.scale(-1));
-    particle->currentWorldTransform = billboardRotation.multiply(particle->currentWorldTransform);
-    particle->currentWorldTransform.translate(computedPos);
 
     boundingBox->setMinX(std::min(boundingBox->getMinX(), computedPos.x));
     boundingBox->setMinY(std::min(boundingBox->getMinY(), computedPos.y));
@@ -172,11 +149,9 @@ void VROFixedParticleEmitter::updateUBO(VROBoundingBox boundingBox) {
 }
 
 void VROFixedParticleEmitter::zombifyParticles(int startIndex) {
-    std::vector<VROParticle>::iterator it = _particles.begin() + startIndex;
-    while (it != _particles.end()) {
-        VROParticle particle = *it;
-        particle.isZombie = true;
-        _zombieParticles.push_back(particle);
-        _particles.erase(it);
+    for (auto it = _particles.begin() + startIndex; it != _particles.end(); ++it) {
+        it->isZombie = true;
+        _zombieParticles.push_back(*it);
     }
+    _particles.erase(_particles.begin() + startIndex, _particles.end());
 }
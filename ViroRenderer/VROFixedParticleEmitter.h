@@ -33,7 +33,6 @@ class VRODriver;
 class VRONode;
 class VROSurface;
 class VROARSession;
-class VROBillboardConstraint;
 
 /*
  Class that inherits from VROParticleEmitter that uses the particle system to draw
@@ -59,6 +58,7 @@ public:
      */
     void setParticleScale(VROVector3f scale) {
         _particleScale = scale;
+        _positionsChanged = true;
     }
 
     void setMaxParticles(int maxParticles) {
@@ -69,7 +69,7 @@ public:
     /*
      Sets a vector of positions representing each particle in world coordinates.
      */
-    void setParticleTransforms(std::vector<VROVector4f> particlesPosition);
+    void setParticleTransforms(const std::vector<VROVector4f> &particlesPosition);
 
     /*
      Clears any existing particles from being rendered in the scene.
@@ -98,7 +98,7 @@ private:
      creating new ones to meet the demand. It also computes the boundingbox that contains all
      the points.
      */
-    VROBoundingBox updateParticles(std::vector<VROVector4f> particleTransforms,
+    VROBoundingBox updateParticles(const std::vector<VROVector4f> &particleTransforms,
                                    const VROMatrix4f &baseTransform,
                                    const VRORenderContext &context);
 
@@ -107,18 +107,24 @@ private:
      */
     std::vector<VROVector4f> _particleComputedPositions;
 
+    /*
+     The particles are only recomputed and re-uploaded when their positions, their
+     scale, or the emitter's transform change.
+     */
+    bool _positionsChanged;
+    VROMatrix4f _lastComputedTransform;
+
     /*
      This function updates the UBO w/ the particles in _particles.
      */
     void updateUBO(VROBoundingBox boundingBox);
 
     /*
-     Computes the transform for the given particle with the given position, constraint
-     and also updates the given boundingBox.
+     Computes the transform for the given particle with the given position, and also
+     updates the given boundingBox.
      */
     void computeParticleTransform(VROParticle *particle,
                                   VROVector4f position,
-                                  std::shared_ptr<VROBillboardConstraint> constraint,
                                   VROBoundingBox *boundingBox,
                                   const VROMatrix4f &baseTransform,
                                   const VRORenderContext &context);
@@ -0,0 +1,87 @@
+//
+//  VROFrameArena.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROFrameArena.h"
+#include "VROLog.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <algorithm>
+
+VROFrameArena::VROFrameArena(size_t initialCapacity) :
+    _offset(0),
+    _bytesAllocated(0),
+    _capacity(0) {
+    addBlock(std::max(initialCapacity, (size_t) 1));
+}
+
+VROFrameArena::~VROFrameArena() {
+    freeBlocks();
+}
+
+void VROFrameArena::addBlock(size_t capacity) {
+    char *block = (char *) malloc(capacity);
+    passert (block != nullptr);
+
+    _blocks.push_back(block);
+    _blockCapacities.push_back(capacity);
+    _capacity += capacity;
+    _offset = 0;
+}
+
+void VROFrameArena::freeBlocks() {
+    for (char *block : _blocks) {
+        free(block);
+    }
+    _blocks.clear();
+    _blockCapacities.clear();
+    _capacity = 0;
+}
+
+void *VROFrameArena::allocate(size_t size, size_t alignment) {
+    uintptr_t base = (uintptr_t) _blocks.back();
+    size_t offset = ((base + _offset + alignment - 1) & ~(uintptr_t) (alignment - 1)) - base;
+
+    if (offset + size > _blockCapacities.back()) {
+        // Each additional block at least doubles the arena, so a frame needs few blocks
+        addBlock(std::max(_capacity, size + alignment));
+        base = (uintptr_t) _blocks.back();
+        offset = ((base + alignment - 1) & ~(uintptr_t) (alignment - 1)) - base;
+    }
+
+    _offset = offset + size;
+    _bytesAllocated += size;
+    return _blocks.back() + offset;
+}
+
+void VROFrameArena::reset() {
+    // Merge the blocks, so that a frame like this one fits in a single block
+    if (_blocks.size() > 1) {
+        size_t capacity = _capacity;
+        freeBlocks();
+        addBlock(capacity);
+    }
+    _offset = 0;
+    _bytesAllocated = 0;
+}
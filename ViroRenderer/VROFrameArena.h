@@ -0,0 +1,146 @@
+//
+//  VROFrameArena.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROFrameArena_h
+#define VROFrameArena_h
+
+#include <stddef.h>
+#include <vector>
+#include <new>
+
+/*
+ The capacity, in bytes, with which a frame arena starts.
+ */
+static const size_t kFrameArenaInitialCapacity = 64 * 1024;
+
+/*
+ VROFrameArena is a linear (bump) allocator for scratch data that lives for a
+ single frame, such as the stacks used while traversing the scene graph.
+ Allocations advance a pointer through the arena's memory, and individual
+ allocations are never freed: the entire arena is reset by the renderer at the
+ end of each frame. Nothing allocated from the arena may outlive the frame.
+
+ When a frame outgrows the arena, it continues in an additional block. On the
+ next reset the blocks are merged into a single block large enough for the
+ whole frame, so steady-state frames allocate nothing from the heap.
+
+ The arena is not thread-safe, and must only be used on the rendering thread.
+ */
+class VROFrameArena {
+public:
+
+    VROFrameArena(size_t initialCapacity = kFrameArenaInitialCapacity);
+    virtual ~VROFrameArena();
+
+    /*
+     Allocate the given number of bytes, aligned to the given alignment (which
+     must be a power of two).
+     */
+    void *allocate(size_t size, size_t alignment);
+
+    /*
+     Release every allocation made since the last reset.
+     */
+    void reset();
+
+    /*
+     The bytes allocated since the last reset, and the capacity of the arena.
+     */
+    size_t getBytesAllocated() const {
+        return _bytesAllocated;
+    }
+    size_t getCapacity() const {
+        return _capacity;
+    }
+
+private:
+
+    /*
+     The blocks of memory in the arena. Allocations are made from the last
+     block, at the given offset.
+     */
+    std::vector<char *> _blocks;
+    std::vector<size_t> _blockCapacities;
+    size_t _offset;
+
+    size_t _bytesAllocated;
+    size_t _capacity;
+
+    void addBlock(size_t capacity);
+    void freeBlocks();
+
+};
+
+/*
+ STL allocator that allocates from a VROFrameArena, so that standard containers
+ can be used for frame-scoped data. Deallocation is a no-op. An allocator with
+ no arena allocates from the heap, for containers used outside of a frame.
+ */
+template <typename T>
+class VROFrameAllocator {
+public:
+    typedef T value_type;
+
+    VROFrameAllocator() : _arena(nullptr) {}
+    VROFrameAllocator(VROFrameArena *arena) : _arena(arena) {}
+    template <typename U>
+    VROFrameAllocator(const VROFrameAllocator<U> &other) : _arena(other.getArena()) {}
+
+    T *allocate(size_t n) {
+        if (_arena) {
+            return (T *) _arena->allocate(n * sizeof(T), alignof(T));
+        }
+        return (T *) ::operator new(n * sizeof(T));
+    }
+    void deallocate(T *p, size_t n) {
+        if (!_arena) {
+            ::operator delete(p);
+        }
+    }
+
+    VROFrameArena *getArena() const {
+        return _arena;
+    }
+
+    template <typename U>
+    bool operator== (const VROFrameAllocator<U> &other) const {
+        return _arena == other.getArena();
+    }
+    template <typename U>
+    bool operator!= (const VROFrameAllocator<U> &other) const {
+        return _arena != other.getArena();
+    }
+
+private:
+    VROFrameArena *_arena;
+};
+
+/*
+ A vector whose storage is allocated from a VROFrameArena.
+ */
+template <typename T>
+using VROFrameVector = std::vector<T, VROFrameAllocator<T>>;
+
+#endif /* VROFrameArena_h */
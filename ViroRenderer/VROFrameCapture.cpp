@@ -0,0 +1,227 @@
+//
+//  VROFrameCapture.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include "VROFrameCapture.h"
+#include "VROSceneArchive.h"
+#include "VROGeometryCache.h"
+#include "VROCamera.h"
+#include "VRONode.h"
+#include "VROTime.h"
+#include "VROPlatformUtil.h"
+#include "VROLog.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+bool VROFrameCapture::readFrames(std::string directory, std::vector<VROFrameCaptureFrame> *outFrames,
+                                 std::vector<VROFrameCaptureEvent> *outEvents) {
+    std::string path = getFramesPath(directory);
+    size_t length = 0;
+    const void *data = VROPlatformMapFile(path, &length);
+    if (!data) {
+        return false;
+    }
+
+    const uint8_t *bytes = (const uint8_t *) data;
+    Header header;
+    bool success = false;
+    if (length >= sizeof(header)) {
+        memcpy(&header, bytes, sizeof(header));
+        size_t framesLength = (size_t) header.numFrames * sizeof(VROFrameCaptureFrame);
+        size_t eventsLength = (size_t) header.numEvents * sizeof(VROFrameCaptureEvent);
+        success = header.magic == kMagic && header.version == kVersion &&
+                  length == sizeof(header) + framesLength + eventsLength;
+        if (success) {
+            outFrames->resize(header.numFrames);
+            outEvents->resize(header.numEvents);
+            if (framesLength > 0) {
+                memcpy(outFrames->data(), bytes + sizeof(header), framesLength);
+            }
+            if (eventsLength > 0) {
+                memcpy(outEvents->data(), bytes + sizeof(header) + framesLength, eventsLength);
+            }
+        }
+    }
+    VROPlatformUnmapFile(data, length);
+
+    if (!success) {
+        pwarn("Frame capture %s is corrupt or from another version", path.c_str());
+    }
+    return success;
+}
+
+VROFrameCapture::VROFrameCapture(std::string directory, int frameCount) :
+    _directory(directory),
+    _frameCount(std::max(frameCount, 1)),
+    _finished(false) {
+    _frames.reserve(_frameCount);
+}
+
+VROFrameCapture::~VROFrameCapture() {
+
+}
+
+void VROFrameCapture::recordFrame(const VROCamera &camera, std::shared_ptr<VRONode> root,
+                                  std::shared_ptr<VRODriver> driver) {
+    if (_finished) {
+        return;
+    }
+
+    if (_frames.empty()) {
+        pinfo("Capturing %d frames to %s", _frameCount, _directory.c_str());
+        if (root) {
+            std::shared_ptr<VROGeometryCache> meshes = std::make_shared<VROGeometryCache>(getMeshesPath(_directory));
+            VROSceneArchive::save(root, getScenePath(_directory), driver, meshes);
+        }
+    }
+
+    VROFrameCaptureFrame frame;
+    frame.time = VROTimeCurrentSeconds();
+
+    VROViewport viewport = camera.getViewport();
+    frame.viewport[0] = viewport.getX();
+    frame.viewport[1] = viewport.getY();
+    frame.viewport[2] = viewport.getWidth();
+    frame.viewport[3] = viewport.getHeight();
+
+    VROFieldOfView fov = camera.getFieldOfView();
+    frame.fov[0] = fov.getLeft();
+    frame.fov[1] = fov.getRight();
+    frame.fov[2] = fov.getBottom();
+    frame.fov[3] = fov.getTop();
+
+    memcpy(frame.projection, camera.getProjection().getArray(), sizeof(frame.projection));
+
+    VROVector3f position = camera.getPosition();
+    frame.position[0] = position.x;
+    frame.position[1] = position.y;
+    frame.position[2] = position.z;
+
+    VROQuaternion rotation = camera.getRotation();
+    frame.rotation[0] = rotation.X;
+    frame.rotation[1] = rotation.Y;
+    frame.rotation[2] = rotation.Z;
+    frame.rotation[3] = rotation.W;
+
+    _frames.push_back(frame);
+    if ((int) _frames.size() >= _frameCount) {
+        write();
+        _finished = true;
+    }
+}
+
+#pragma mark - Input Events
+
+void VROFrameCapture::recordEvent(VROFrameCaptureEventType type, int source, int state,
+                                  std::initializer_list<float> values) {
+    if (_finished) {
+        return;
+    }
+
+    // Events arriving after a frame was prepared are delivered before the next
+    VROFrameCaptureEvent event;
+    memset(&event, 0, sizeof(event));
+    event.frame = (int32_t) _frames.size();
+    event.type = type;
+    event.source = source;
+    event.state = state;
+
+    int i = 0;
+    for (float value : values) {
+        event.values[i++] = value;
+    }
+    _events.push_back(event);
+}
+
+void VROFrameCapture::recordControllerStatus(int source, VROEventDelegate::ControllerStatus status) {
+    recordEvent(VROFrameCaptureEventType::ControllerStatus, source, (int) status, {});
+}
+
+void VROFrameCapture::recordButton(int source, VROEventDelegate::ClickState clickState) {
+    recordEvent(VROFrameCaptureEventType::Button, source, (int) clickState, {});
+}
+
+void VROFrameCapture::recordTouchpad(int source, VROEventDelegate::TouchState touchState, float x, float y) {
+    recordEvent(VROFrameCaptureEventType::Touchpad, source, (int) touchState, { x, y });
+}
+
+void VROFrameCapture::recordMove(int source, VROVector3f position, VROQuaternion rotation, VROVector3f forward) {
+    recordEvent(VROFrameCaptureEventType::Move, source, 0,
+                { position.x, position.y, position.z,
+                  rotation.X, rotation.Y, rotation.Z, rotation.W,
+                  forward.x, forward.y, forward.z });
+}
+
+void VROFrameCapture::recordSwipe(int source, VROEventDelegate::SwipeState swipeState) {
+    recordEvent(VROFrameCaptureEventType::Swipe, source, (int) swipeState, {});
+}
+
+void VROFrameCapture::recordScroll(int source, float x, float y) {
+    recordEvent(VROFrameCaptureEventType::Scroll, source, 0, { x, y });
+}
+
+void VROFrameCapture::recordPinch(int source, float scaleFactor, VROEventDelegate::PinchState pinchState) {
+    recordEvent(VROFrameCaptureEventType::Pinch, source, (int) pinchState, { scaleFactor });
+}
+
+void VROFrameCapture::recordRotate(int source, float rotationRadians, VROEventDelegate::RotateState rotateState) {
+    recordEvent(VROFrameCaptureEventType::Rotate, source, (int) rotateState, { rotationRadians });
+}
+
+#pragma mark - Writing
+
+void VROFrameCapture::write() {
+    Header header = { kMagic, kVersion, (uint32_t) _frames.size(), (uint32_t) _events.size() };
+    size_t framesLength = _frames.size() * sizeof(VROFrameCaptureFrame);
+    size_t eventsLength = _events.size() * sizeof(VROFrameCaptureEvent);
+
+    std::shared_ptr<std::vector<uint8_t>> file = std::make_shared<std::vector<uint8_t>>(sizeof(header) + framesLength + eventsLength);
+    memcpy(file->data(), &header, sizeof(header));
+    if (framesLength > 0) {
+        memcpy(file->data() + sizeof(header), _frames.data(), framesLength);
+    }
+    if (eventsLength > 0) {
+        memcpy(file->data() + sizeof(header) + framesLength, _events.data(), eventsLength);
+    }
+
+    std::string path = getFramesPath(_directory);
+    VROPlatformDispatchAsyncWorker([path, file] {
+        FILE *out = fopen(path.c_str(), "wb");
+        if (!out) {
+            pwarn("Failed to open frame capture %s for writing", path.c_str());
+            return;
+        }
+        bool success = fwrite(file->data(), 1, file->size(), out) == file->size();
+        success = (fclose(out) == 0) && success;
+        if (success) {
+            pinfo("Wrote frame capture %s", path.c_str());
+        }
+        else {
+            pwarn("Failed to write frame capture %s", path.c_str());
+            remove(path.c_str());
+        }
+    }, VROTaskPriority::Low);
+}
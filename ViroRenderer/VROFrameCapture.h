@@ -0,0 +1,185 @@
+//
+//  VROFrameCapture.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef VROFrameCapture_h
+#define VROFrameCapture_h
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <initializer_list>
+#include <stdint.h>
+#include "VROEventDelegate.h"
+#include "VROVector3f.h"
+#include "VROQuaternion.h"
+
+class VRONode;
+class VROCamera;
+class VRODriver;
+
+/*
+ The types of input event recorded in a frame capture, one per event method of
+ VROInputControllerBase.
+ */
+enum class VROFrameCaptureEventType : int32_t {
+    ControllerStatus = 0,
+    Button = 1,
+    Touchpad = 2,
+    Move = 3,
+    Swipe = 4,
+    Scroll = 5,
+    Pinch = 6,
+    Rotate = 7,
+};
+
+/*
+ One captured frame: the renderer clock when the frame was prepared, and the
+ camera it was rendered from. The rotation is the camera's full rotation (base
+ and head rotation combined).
+ */
+struct VROFrameCaptureFrame {
+    double time;
+    int32_t viewport[4];
+    float fov[4];
+    float projection[16];
+    float position[3];
+    float rotation[4];
+};
+
+/*
+ One captured input event, delivered before the prepareFrame of the given
+ captured frame. The values depend on the type: x, y for touchpad and scroll
+ events; the scale factor or rotation for pinch and rotate events; and
+ position, rotation (as a quaternion), and forward for move events.
+ */
+struct VROFrameCaptureEvent {
+    int32_t frame;
+    VROFrameCaptureEventType type;
+    int32_t source;
+    int32_t state;
+    float values[10];
+};
+
+/*
+ Records the input of a run of frames, so that they can be re-rendered
+ deterministically elsewhere by VROFrameReplay, e.g. to profile a customer's
+ slow scene on the exact same content across builds and devices.
+
+ A capture is a directory holding a snapshot of the scene graph as it was at
+ the first captured frame (a VROSceneArchive, with its meshes in a geometry
+ cache inside the directory, so the capture can be copied to another device),
+ and a file of flat records with the clock and camera of each captured frame
+ and the input events delivered to the input controller in between.
+
+ The scene graph is only snapshotted once, so changes the application makes
+ to the scene during the capture are not replayed; nor are the node
+ subclasses, lights, and animations that scene archives do not store (see
+ VROSceneArchive). AR camera poses are captured as the camera they produced.
+
+ Captures are started with VRORenderer::captureFrames. All methods must be
+ invoked on the rendering thread.
+ */
+class VROFrameCapture {
+public:
+
+    static const uint32_t kMagic = 0x43524F56; // 'VROC'
+    static const uint32_t kVersion = 1;
+
+    /*
+     The file layout: the header, then the frame records, then the event
+     records.
+     */
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t numFrames;
+        uint32_t numEvents;
+    };
+
+    static std::string getScenePath(std::string directory) {
+        return directory + "/scene.vroa";
+    }
+    static std::string getFramesPath(std::string directory) {
+        return directory + "/frames.vrfc";
+    }
+    static std::string getMeshesPath(std::string directory) {
+        return directory + "/meshes";
+    }
+
+    /*
+     Read the frames and events of the capture in the given directory. Returns
+     false if the capture is missing or corrupt.
+     */
+    static bool readFrames(std::string directory, std::vector<VROFrameCaptureFrame> *outFrames,
+                           std::vector<VROFrameCaptureEvent> *outEvents);
+
+    /*
+     Create a capture of the given number of frames, written to the given
+     directory, which must exist.
+     */
+    VROFrameCapture(std::string directory, int frameCount);
+    virtual ~VROFrameCapture();
+
+    /*
+     Record the frame being prepared, from the scene graph rooted at the given
+     node, viewed by the given camera. The scene is snapshotted on the first
+     frame. Once the last frame is recorded the capture is written and
+     isFinished() returns true.
+     */
+    void recordFrame(const VROCamera &camera, std::shared_ptr<VRONode> root, std::shared_ptr<VRODriver> driver);
+
+    bool isFinished() const {
+        return _finished;
+    }
+
+    /*
+     Record input events, as delivered to VROInputControllerBase.
+     */
+    void recordControllerStatus(int source, VROEventDelegate::ControllerStatus status);
+    void recordButton(int source, VROEventDelegate::ClickState clickState);
+    void recordTouchpad(int source, VROEventDelegate::TouchState touchState, float x, float y);
+    void recordMove(int source, VROVector3f position, VROQuaternion rotation, VROVector3f forward);
+    void recordSwipe(int source, VROEventDelegate::SwipeState swipeState);
+    void recordScroll(int source, float x, float y);
+    void recordPinch(int source, float scaleFactor, VROEventDelegate::PinchState pinchState);
+    void recordRotate(int source, float rotationRadians, VROEventDelegate::RotateState rotateState);
+
+private:
+
+    std::string _directory;
+    int _frameCount;
+    bool _finished;
+
+    std::vector<VROFrameCaptureFrame> _frames;
+    std::vector<VROFrameCaptureEvent> _events;
+
+    void recordEvent(VROFrameCaptureEventType type, int source, int state,
+                     std::initializer_list<float> values);
+    void write();
+
+};
+
+#endif /* VROFrameCapture_h */
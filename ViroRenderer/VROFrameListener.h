@@ -41,6 +41,26 @@ public:
     
     virtual void onFrameWillRender(const VRORenderContext &context) = 0;
     virtual void onFrameDidRender(const VRORenderContext &context) = 0;
+
+    /*
+     Return true if this listener changes the rendered image on its own each frame
+     (e.g. a playing video). The renderer does not skip idle frames in render-on-demand
+     mode while any listener is animating.
+     */
+    virtual bool isAnimating() { return false; }
+
+    /*
+     The rate, in frames per second, at which this listener's content changes while
+     animating (e.g. a video's frame rate), or 0 if it changes every display refresh.
+     Used to lower the refresh rate of adaptive refresh rate displays.
+     */
+    virtual float getContentFrameRate() { return 0; }
+
+    /*
+     The name under which this listener's callbacks are timed by VROProfiler.
+     Must outlive the profiler, e.g. a string literal.
+     */
+    virtual const char *getFrameListenerName() const { return "frameListener"; }
     
 };
 
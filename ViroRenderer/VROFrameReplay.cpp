@@ -0,0 +1,340 @@
+//
+//  VROFrameReplay.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include "VROFrameReplay.h"
+#include "VROSceneArchive.h"
+#include "VROGeometryCache.h"
+#include "VROSceneController.h"
+#include "VROScene.h"
+#include "VRONode.h"
+#include "VRONodeCamera.h"
+#include "VRORenderer.h"
+#include "VRODriver.h"
+#include "VROInputControllerBase.h"
+#include "VROProfiler.h"
+#include "VROViewport.h"
+#include "VROFieldOfView.h"
+#include "VROEye.h"
+#include "VROTime.h"
+#include "VRODefines.h"
+#include "VROLog.h"
+#include <sstream>
+#include <thread>
+#include <cstdio>
+
+// Real time given to background loads between warm-up frames
+static const int kWarmupSleepMs = 8;
+
+/*
+ Result of the asynchronous scene load, shared with its callback.
+ */
+struct VROFrameReplayLoad {
+    bool finished = false;
+    std::shared_ptr<VRONode> root;
+};
+
+template <typename T>
+static double mean(const std::vector<T> &values) {
+    if (values.empty()) {
+        return 0;
+    }
+    double sum = 0;
+    for (T value : values) {
+        sum += value;
+    }
+    return sum / values.size();
+}
+
+static double percentile(std::vector<double> values, double p) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, (size_t) (p * values.size()))];
+}
+
+VROFrameReplay::VROFrameReplay(std::shared_ptr<VRORenderer> renderer, std::shared_ptr<VRODriver> driver,
+                               std::string directory) :
+    _renderer(renderer),
+    _driver(driver),
+    _directory(directory),
+    _warmupFrames(60),
+    _repetitions(1),
+    _started(false),
+    _finished(false),
+    _wasProfiling(false),
+    _frame(0),
+    _loadedFrame(0),
+    _replayedFrames(0),
+    _nextEvent(0),
+    _clock(0) {
+
+    if (!VROFrameCapture::readFrames(directory, &_frames, &_events)) {
+        _frames.clear();
+        _events.clear();
+    }
+}
+
+VROFrameReplay::~VROFrameReplay() {
+
+}
+
+int VROFrameReplay::getWidth() const {
+    return _frames.empty() ? 0 : _frames.front().viewport[2];
+}
+
+int VROFrameReplay::getHeight() const {
+    return _frames.empty() ? 0 : _frames.front().viewport[3];
+}
+
+bool VROFrameReplay::renderFrame() {
+    if (_finished) {
+        return false;
+    }
+    if (!_started) {
+        if (!isValid()) {
+            _finished = true;
+            return false;
+        }
+        start();
+    }
+
+    // Keep rendering the first captured frame while the scene loads, so that
+    // the renderer processes the load's tasks
+    if (!_sceneController) {
+        if (_load->finished) {
+            if (!_load->root) {
+                perr("Frame replay failed to restore the scene of %s", _directory.c_str());
+                finish();
+                return false;
+            }
+            loadScene(_load->root);
+        }
+        render(_frames.front(), false);
+        return true;
+    }
+
+    if (_loadedFrame < _warmupFrames) {
+        render(_frames.front(), false);
+        ++_loadedFrame;
+#if !VRO_PLATFORM_WASM
+        std::this_thread::sleep_for(std::chrono::milliseconds(kWarmupSleepMs));
+#endif
+        return true;
+    }
+
+    int index = _replayedFrames % (int) _frames.size();
+    if (index == 0) {
+        // Each repetition restarts the clock at the first captured frame
+        VROTimeSetFixedClock(true, _frames.front().time);
+        _clock = _frames.front().time;
+        _nextEvent = 0;
+        if (_replayedFrames == 0) {
+            VROProfiler::clear();
+            VROProfiler::setEnabled(true);
+        }
+    }
+    else {
+        VROTimeAdvanceFixedClock(_frames[index].time - _clock);
+        _clock = _frames[index].time;
+    }
+
+    while (_nextEvent < _events.size() && _events[_nextEvent].frame <= index) {
+        dispatchEvent(_events[_nextEvent]);
+        ++_nextEvent;
+    }
+
+    render(_frames[index], true);
+    ++_loadedFrame;
+    ++_replayedFrames;
+
+    if (_replayedFrames >= (int) _frames.size() * _repetitions) {
+        finish();
+    }
+    return true;
+}
+
+void VROFrameReplay::start() {
+    _started = true;
+    _wasProfiling = VROProfiler::isEnabled();
+    VROProfiler::setEnabled(false);
+    _driver->setGPUFrameTimerEnabled(true);
+    VROTimeSetFixedClock(true, _frames.front().time);
+    _clock = _frames.front().time;
+
+    pinfo("Replaying %d captured frames from %s", (int) _frames.size(), _directory.c_str());
+
+    _load = std::make_shared<VROFrameReplayLoad>();
+    std::shared_ptr<VROFrameReplayLoad> load = _load;
+    std::shared_ptr<VROGeometryCache> meshes = std::make_shared<VROGeometryCache>(VROFrameCapture::getMeshesPath(_directory));
+    VROSceneArchive::loadAsync(VROFrameCapture::getScenePath(_directory), _driver, [load](std::shared_ptr<VRONode> root) {
+        load->root = root;
+        load->finished = true;
+    }, meshes);
+}
+
+void VROFrameReplay::finish() {
+    _finished = true;
+    VROTimeSetFixedClock(false);
+    _driver->setGPUFrameTimerEnabled(false);
+    VROProfiler::setEnabled(_wasProfiling);
+
+    if (!_frameMs.empty()) {
+        pinfo("Replayed %d frames: CPU %.2f ms (p95 %.2f), GPU %.2f ms, %.0f draw calls",
+              (int) _frameMs.size(), percentile(_frameMs, 0.5), percentile(_frameMs, 0.95),
+              _gpuMs.empty() ? -1 : mean(_gpuMs), mean(_drawCalls));
+    }
+}
+
+void VROFrameReplay::loadScene(std::shared_ptr<VRONode> root) {
+    _sceneController = std::make_shared<VROSceneController>();
+    std::shared_ptr<VRONode> sceneRoot = _sceneController->getScene()->getRootNode();
+    sceneRoot->addChildNode(root);
+
+    // The captured camera carries the full rotation, so the point of view stays
+    // at the origin and unrotated
+    _camera = std::make_shared<VRONode>();
+    _camera->setCamera(std::make_shared<VRONodeCamera>());
+    sceneRoot->addChildNode(_camera);
+
+    _renderer->setSceneController(_sceneController, _driver);
+    _renderer->setPointOfView(_camera);
+    _loadedFrame = 0;
+}
+
+void VROFrameReplay::render(const VROFrameCaptureFrame &frame, bool measuring) {
+    VROViewport viewport(frame.viewport[0], frame.viewport[1], frame.viewport[2], frame.viewport[3]);
+    VROFieldOfView fov(frame.fov[0], frame.fov[1], frame.fov[2], frame.fov[3]);
+    VROMatrix4f projection(frame.projection);
+    VROMatrix4f rotation = VROQuaternion(frame.rotation[0], frame.rotation[1],
+                                         frame.rotation[2], frame.rotation[3]).getMatrix();
+    if (_camera) {
+        _camera->getCamera()->setPosition({ frame.position[0], frame.position[1], frame.position[2] });
+    }
+
+    uint64_t startNs = VRONanoTime();
+    _renderer->prepareFrame(_frame, viewport, fov, rotation, projection, _driver);
+    uint64_t preparedNs = VRONanoTime();
+    _renderer->renderEye(VROEyeType::Monocular, _renderer->getLookAtMatrix(), projection, viewport, _driver);
+    _renderer->renderHUD(VROEyeType::Monocular, VROMatrix4f::identity(), projection, _driver);
+    uint64_t renderedNs = VRONanoTime();
+    _renderer->endFrame(_driver);
+    uint64_t endNs = VRONanoTime();
+    ++_frame;
+
+    if (measuring) {
+        _prepareMs.push_back((preparedNs - startNs) / 1000000.0);
+        _renderMs.push_back((renderedNs - preparedNs) / 1000000.0);
+        _endMs.push_back((endNs - renderedNs) / 1000000.0);
+        _frameMs.push_back((endNs - startNs) / 1000000.0);
+
+        double gpuMs = _driver->getGPUFrameTime();
+        if (gpuMs >= 0) {
+            _gpuMs.push_back(gpuMs);
+        }
+        _drawCalls.push_back(VROProfiler::getCount(VROProfilerCounter::DrawCalls));
+    }
+}
+
+void VROFrameReplay::dispatchEvent(const VROFrameCaptureEvent &event) {
+    std::shared_ptr<VROInputControllerBase> input = _renderer->getInputController();
+    if (!input) {
+        return;
+    }
+
+    const float *v = event.values;
+    switch (event.type) {
+        case VROFrameCaptureEventType::ControllerStatus:
+            input->onControllerStatus(event.source, (VROEventDelegate::ControllerStatus) event.state);
+            break;
+        case VROFrameCaptureEventType::Button:
+            input->onButtonEvent(event.source, (VROEventDelegate::ClickState) event.state);
+            break;
+        case VROFrameCaptureEventType::Touchpad:
+            input->onTouchpadEvent(event.source, (VROEventDelegate::TouchState) event.state, v[0], v[1]);
+            break;
+        case VROFrameCaptureEventType::Move:
+            input->onMove(event.source, { v[0], v[1], v[2] }, VROQuaternion(v[3], v[4], v[5], v[6]),
+                          { v[7], v[8], v[9] });
+            break;
+        case VROFrameCaptureEventType::Swipe:
+            input->onSwipe(event.source, (VROEventDelegate::SwipeState) event.state);
+            break;
+        case VROFrameCaptureEventType::Scroll:
+            input->onScroll(event.source, v[0], v[1]);
+            break;
+        case VROFrameCaptureEventType::Pinch:
+            input->onPinch(event.source, v[0], (VROEventDelegate::PinchState) event.state);
+            break;
+        case VROFrameCaptureEventType::Rotate:
+            input->onRotate(event.source, v[0], (VROEventDelegate::RotateState) event.state);
+            break;
+        default:
+            pwarn("Frame replay skipping unknown input event type %d", (int) event.type);
+            break;
+    }
+}
+
+std::string VROFrameReplay::toJSON() const {
+    std::stringstream ss;
+    ss << "{\n";
+    ss << "  \"capture\": \"" << _directory << "\",\n";
+    ss << "  \"width\": " << getWidth() << ",\n";
+    ss << "  \"height\": " << getHeight() << ",\n";
+    ss << "  \"captured_frames\": " << _frames.size() << ",\n";
+    ss << "  \"repetitions\": " << _repetitions << ",\n";
+    ss << "  \"time\": " << VROTimeGetCalendarTime() << ",\n";
+    ss << "  \"prepare_ms\": " << mean(_prepareMs) << ",\n";
+    ss << "  \"render_ms\": " << mean(_renderMs) << ",\n";
+    ss << "  \"end_ms\": " << mean(_endMs) << ",\n";
+    ss << "  \"frame_median_ms\": " << percentile(_frameMs, 0.5) << ",\n";
+    ss << "  \"frame_p95_ms\": " << percentile(_frameMs, 0.95) << ",\n";
+    ss << "  \"gpu_ms\": " << (_gpuMs.empty() ? -1 : mean(_gpuMs)) << ",\n";
+    ss << "  \"draw_calls\": " << mean(_drawCalls) << ",\n";
+    ss << "  \"frame_ms\": [";
+    for (size_t i = 0; i < _frameMs.size(); i++) {
+        ss << (i == 0 ? "" : ", ") << _frameMs[i];
+    }
+    ss << "]\n}\n";
+    return ss.str();
+}
+
+bool VROFrameReplay::writeJSON(std::string path) const {
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file) {
+        pwarn("Failed to open frame replay results file %s", path.c_str());
+        return false;
+    }
+
+    std::string json = toJSON();
+    bool success = fwrite(json.data(), 1, json.size(), file) == json.size();
+    fclose(file);
+    return success;
+}
+
+bool VROFrameReplay::writeTrace(std::string path) const {
+    return VROProfiler::writeChromeTrace(path);
+}
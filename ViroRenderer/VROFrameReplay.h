@@ -0,0 +1,156 @@
+//
+//  VROFrameReplay.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef VROFrameReplay_h
+#define VROFrameReplay_h
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "VROFrameCapture.h"
+
+class VRONode;
+class VRODriver;
+class VRORenderer;
+class VROSceneController;
+struct VROFrameReplayLoad;
+
+/*
+ Re-renders a frame capture (see VROFrameCapture) deterministically, with the
+ profiler enabled, so that the same content can be compared across builds and
+ devices. The captured scene is restored from its archive and viewed from each
+ captured camera in turn, against a fixed clock that steps exactly as the
+ captured clock did, and the captured input events are delivered to the input
+ controller before the frames they preceded.
+
+ As with VROSceneBenchmark, the replay renders into whatever surface is current
+ on the calling thread, which should be at least as large as the captured
+ viewport (see getWidth() and getHeight()). Captured frames are rendered
+ monocularly. The clock is frozen at the first captured frame while the scene
+ loads and warms up, and the captured frames may then be replayed several
+ times; the profiler is cleared when measurement begins, so its trace holds
+ only the measured frames.
+
+ The platform drives the replay by calling renderFrame() once per frame on the
+ rendering thread until it returns false.
+ */
+class VROFrameReplay {
+public:
+
+    VROFrameReplay(std::shared_ptr<VRORenderer> renderer, std::shared_ptr<VRODriver> driver,
+                   std::string directory);
+    virtual ~VROFrameReplay();
+
+    /*
+     Returns false if the capture could not be read, in which case nothing is
+     replayed.
+     */
+    bool isValid() const {
+        return !_frames.empty();
+    }
+
+    /*
+     The size of the captured viewport.
+     */
+    int getWidth() const;
+    int getHeight() const;
+
+    void setFrameCounts(int warmupFrames, int repetitions) {
+        _warmupFrames = warmupFrames;
+        _repetitions = std::max(repetitions, 1);
+    }
+
+    /*
+     Render the next frame of the replay. Returns false once every repetition of
+     the captured frames has been rendered, or the capture failed to load.
+     */
+    bool renderFrame();
+
+    bool isFinished() const {
+        return _finished;
+    }
+
+    /*
+     The measured CPU times of each replayed frame, in milliseconds, in the
+     order rendered.
+     */
+    const std::vector<double> &getFrameTimes() const {
+        return _frameMs;
+    }
+
+    /*
+     Write the results (summary statistics and per-frame CPU times) as JSON,
+     or the profiler's Chrome trace of the measured frames.
+     */
+    std::string toJSON() const;
+    bool writeJSON(std::string path) const;
+    bool writeTrace(std::string path) const;
+
+private:
+
+    std::shared_ptr<VRORenderer> _renderer;
+    std::shared_ptr<VRODriver> _driver;
+    std::string _directory;
+
+    std::vector<VROFrameCaptureFrame> _frames;
+    std::vector<VROFrameCaptureEvent> _events;
+    int _warmupFrames;
+    int _repetitions;
+
+    /*
+     Replay progress. _loadedFrame counts the frames rendered since the scene
+     loaded, including warm-up. _replayedFrames counts the measured frames, and
+     _nextEvent indexes the next event to deliver in this repetition.
+     */
+    std::shared_ptr<VROFrameReplayLoad> _load;
+    bool _started;
+    bool _finished;
+    bool _wasProfiling;
+    int _frame;
+    int _loadedFrame;
+    int _replayedFrames;
+    size_t _nextEvent;
+    double _clock;
+
+    std::shared_ptr<VROSceneController> _sceneController;
+    std::shared_ptr<VRONode> _camera;
+
+    /*
+     Per-frame samples of the measured frames.
+     */
+    std::vector<double> _prepareMs, _renderMs, _endMs, _frameMs, _gpuMs;
+    std::vector<int> _drawCalls;
+
+    void start();
+    void finish();
+    void loadScene(std::shared_ptr<VRONode> root);
+    void render(const VROFrameCaptureFrame &frame, bool measuring);
+    void dispatchEvent(const VROFrameCaptureEvent &event);
+
+};
+
+#endif /* VROFrameReplay_h */
@@ -26,10 +26,19 @@
 
 #include "VROFrameScheduler.h"
 #include "VROLog.h"
+#include "VROProfiler.h"
+#include "VROTime.h"
 
-// Block and process all tasks when we reach this number
-// of starvation frames
-static const int kStarvationPurgeFrameCount = 60;
+// After this many frames without progress while tasks are queued, we run
+// one task per frame regardless of the remaining frame time
+static const int kStarvationFrameCount = 60;
+
+// Number of tasks at the front of each queue searched for one that fits in
+// the remaining frame time
+static const int kMaxTaskLookahead = 8;
+
+// Weight of the most recent run in each task class's moving average cost
+static const double kCostEstimateWeight = 0.25;
 
 VROFrameScheduler::VROFrameScheduler() :
     _starvationFrameCount(0) {
@@ -45,66 +54,178 @@ bool VROFrameScheduler::isTaskQueued(std::string key) {
     return _queuedTasks.find(key) != _queuedTasks.end();
 }
 
+int VROFrameScheduler::getQueuedTaskCount() {
+    std::lock_guard<std::recursive_mutex> lock(_taskQueueMutex);
+    return (int) _queuedTasks.size();
+}
+
 void VROFrameScheduler::scheduleTask(std::string key, std::function<void()> task) {
+    scheduleTask(key, task, VROFrameTaskPriority::Normal);
+}
+
+void VROFrameScheduler::scheduleTask(std::string key, std::function<void()> task,
+                                     VROFrameTaskPriority priority, double deadline) {
+    enqueue({ key, task, nullptr, deadline }, priority);
+}
+
+void VROFrameScheduler::scheduleResumableTask(std::string key, std::function<bool()> slice,
+                                              VROFrameTaskPriority priority, double deadline) {
+    enqueue({ key, nullptr, slice, deadline }, priority);
+}
+
+void VROFrameScheduler::enqueue(VROFrameTask task, VROFrameTaskPriority priority) {
     std::lock_guard<std::recursive_mutex> lock(_taskQueueMutex);
     
-    if (_queuedTasks.find(key) != _queuedTasks.end()) {
+    if (_queuedTasks.find(task.key) != _queuedTasks.end()) {
         // Task is already queued
         return;
     }
     
-    _taskQueue.push({ key, task });
-    _queuedTasks.insert(key);
+    _queuedTasks.insert(task.key);
+    _taskQueues[(int) priority].push_back(std::move(task));
+}
+
+#pragma mark - Processing
+
+static bool fitsInFrame(const VROFrameTimer &timer, double cost) {
+    // The iOS simulator is so slow (due to GPU emulation) we don't bother with waiting
+#if TARGET_OS_SIMULATOR
+    return true;
+#else
+    return timer.hasTimeRemainingFor(cost);
+#endif
 }
 
 void VROFrameScheduler::processTasks(const VROFrameTimer &timer) {
+    bool starved = _starvationFrameCount >= kStarvationFrameCount;
     bool processedAnyTask = false;
     
-    while (!_taskQueue.empty()) {
-        // The iOS simulator is so slow (due to GPU emulation) we don't bother with waiting
-#if !TARGET_OS_SIMULATOR
-        if (!timer.isTimeRemainingInFrame()) {
-            break;
-        }
-#endif
+    while (true) {
         VROFrameTask task;
+        int priority;
         
         // Lock the mutex while retrieving the task from the queue
         {
             std::lock_guard<std::recursive_mutex> lock(_taskQueueMutex);
-            if (!_taskQueue.empty()) {
-                task = _taskQueue.front();
-                _taskQueue.pop();
+            if (!dequeue(timer, starved && !processedAnyTask, &task, &priority)) {
+                break;
             }
         }
         
         // Process the task outside of the lock
-        if (task.functor) {
-            task.functor();
-            processedAnyTask = true;
+        bool complete = runTask(task);
+        processedAnyTask = true;
+
+        std::lock_guard<std::recursive_mutex> lock(_taskQueueMutex);
+        if (complete) {
+            _queuedTasks.erase(task.key);
+        }
+        else {
+            // Resumable tasks keep their place at the front of their queue
+            _taskQueues[priority].push_front(std::move(task));
         }
     }
-    
-    if (!_taskQueue.empty() && !processedAnyTask) {
-        _starvationFrameCount++;
+
+    if (processedAnyTask) {
+        if (starved) {
+            pinfo("Tasks starved for %d frames: forced one task", _starvationFrameCount);
+        }
+        _starvationFrameCount = 0;
     }
-    
-    /*
-     If we've been unable to process tasks for this number of frames, 
-     block and process them all.
-     */
-    if (_starvationFrameCount >= kStarvationPurgeFrameCount) {
-        pinfo("Tasks starved for %d frames: processing all", _starvationFrameCount);
-        
+    else {
         std::lock_guard<std::recursive_mutex> lock(_taskQueueMutex);
-        while (!_taskQueue.empty()) {
-            VROFrameTask task = _taskQueue.front();
-            _taskQueue.pop();
-            
-            if (task.functor) {
-                task.functor();
+        if (!_queuedTasks.empty()) {
+            _starvationFrameCount++;
+        }
+    }
+}
+
+bool VROFrameScheduler::dequeue(const VROFrameTimer &timer, bool force, VROFrameTask *outTask, int *outPriority) {
+    // Overdue tasks run first, whether or not there is time for them
+    double now = VROTimeCurrentMillis();
+    for (int p = 0; p < kNumFrameTaskPriorities; p++) {
+        std::deque<VROFrameTask> &queue = _taskQueues[p];
+        for (auto it = queue.begin(); it != queue.end(); ++it) {
+            if (it->deadline > 0 && it->deadline <= now) {
+                *outTask = std::move(*it);
+                *outPriority = p;
+                queue.erase(it);
+                return true;
             }
         }
-        _starvationFrameCount = 0;
     }
+
+    // Otherwise take the highest priority task whose estimated cost fits in the
+    // remaining time; looking past the front of each queue keeps one expensive
+    // task from blocking cheaper ones behind it
+    for (int p = 0; p < kNumFrameTaskPriorities; p++) {
+        std::deque<VROFrameTask> &queue = _taskQueues[p];
+        int lookahead = std::min((int) queue.size(), kMaxTaskLookahead);
+        for (int i = 0; i < lookahead; i++) {
+            if (fitsInFrame(timer, getEstimatedCost(queue[i].key))) {
+                *outTask = std::move(queue[i]);
+                *outPriority = p;
+                queue.erase(queue.begin() + i);
+                return true;
+            }
+        }
+    }
+
+    if (force) {
+        for (int p = 0; p < kNumFrameTaskPriorities; p++) {
+            std::deque<VROFrameTask> &queue = _taskQueues[p];
+            if (!queue.empty()) {
+                *outTask = std::move(queue.front());
+                *outPriority = p;
+                queue.pop_front();
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool VROFrameScheduler::runTask(VROFrameTask &task) {
+    uint64_t startNs = VRONanoTime();
+
+    bool complete = true;
+    if (task.slice) {
+        complete = task.slice();
+    }
+    else if (task.functor) {
+        task.functor();
+    }
+
+    uint64_t endNs = VRONanoTime();
+    if (VROProfiler::isEnabled()) {
+        VROProfiler::addCPUEvent("Task " + task.key, startNs, endNs);
+    }
+
+    double elapsedMs = (endNs - startNs) / 1000000.0;
+    std::lock_guard<std::recursive_mutex> lock(_taskQueueMutex);
+
+    auto estimate = _costEstimates.find(getCostClass(task.key));
+    if (estimate == _costEstimates.end()) {
+        _costEstimates[getCostClass(task.key)] = elapsedMs;
+    }
+    else {
+        estimate->second += (elapsedMs - estimate->second) * kCostEstimateWeight;
+    }
+    return complete;
+}
+
+#pragma mark - Cost Estimation
+
+double VROFrameScheduler::getEstimatedCost(const std::string &key) {
+    std::lock_guard<std::recursive_mutex> lock(_taskQueueMutex);
+    auto estimate = _costEstimates.find(getCostClass(key));
+    return estimate == _costEstimates.end() ? 0 : estimate->second;
+}
+
+std::string VROFrameScheduler::getCostClass(const std::string &key) {
+    size_t separator = key.find_last_of('_');
+    if (separator == std::string::npos || separator == 0) {
+        return key;
+    }
+    return key.substr(0, separator);
 }
@@ -29,14 +29,39 @@
 
 #include "VROFrameTimer.h"
 #include <functional>
-#include <queue>
+#include <deque>
 #include <mutex>
 #include <string>
-#include <set>
+#include <unordered_set>
+#include <unordered_map>
+
+/*
+ Priority classes for frame tasks. All queued tasks of a higher priority are
+ considered before any task of a lower priority.
+ */
+enum class VROFrameTaskPriority {
+    High = 0,
+    Normal = 1,
+    Low = 2
+};
+static const int kNumFrameTaskPriorities = 3;
 
 struct VROFrameTask {
     std::string key;
+
+    /*
+     One-shot tasks set functor. Resumable tasks instead set slice, which
+     performs one bounded increment of work per invocation and returns true
+     once the task is complete.
+     */
     std::function<void()> functor;
+    std::function<bool()> slice;
+
+    /*
+     The time (in ms, as VROTimeCurrentMillis()) by which the task must run,
+     regardless of the frame budget. Zero if the task has no deadline.
+     */
+    double deadline;
 };
 
 /*
@@ -45,6 +70,16 @@ struct VROFrameTask {
  queue; they are scheduled to run only when time is available in
  the current frame. Time remaining in a frame is determined by a
  set milliseconds-per-frame (mpf) target.
+
+ Each task (or slice of a resumable task) is only started if its estimated
+ cost fits in the time remaining. Costs are learned from previous runs of
+ tasks of the same class, where the class is the portion of the key before
+ its last underscore (so "th_12" and "th_40" share the estimate of "th"). A
+ task whose deadline has passed runs even if the frame is out of time.
+
+ If tasks have been queued without any making progress for a number of
+ frames, the scheduler runs exactly one task (or slice) per frame past the
+ budget, bounding the overrun instead of flushing the whole queue.
  */
 class VROFrameScheduler {
     
@@ -58,18 +93,41 @@ public:
      */
     bool isTaskQueued(std::string key);
     
+    /*
+     Return the number of tasks waiting to be processed.
+     */
+    int getQueuedTaskCount();
+    
     /*
      Schedule a new task to be completed in the time-limited 
      queue. The key should uniquely identify the task, and is used
      to de-dupe tasks that are scheduled multiple times.
      */
     void scheduleTask(std::string key, std::function<void()> task);
+    void scheduleTask(std::string key, std::function<void()> task,
+                      VROFrameTaskPriority priority, double deadline = 0);
+
+    /*
+     Schedule a resumable task. The slice function is invoked repeatedly, as
+     frame time allows, until it returns true. Each invocation should do a
+     bounded amount of work (e.g. upload a band of texture rows), so that the
+     scheduler can fill the remaining frame time without overrunning it.
+     */
+    void scheduleResumableTask(std::string key, std::function<bool()> slice,
+                               VROFrameTaskPriority priority = VROFrameTaskPriority::Normal,
+                               double deadline = 0);
     
     /*
      Process as many tasks as allowed given the remaining frame
      time.
      */
     void processTasks(const VROFrameTimer &timer);
+
+    /*
+     Get the learned cost estimate, in ms, for tasks with the given key's
+     class. Returns zero if no task of this class has run.
+     */
+    double getEstimatedCost(const std::string &key);
     
 private:
     
@@ -80,20 +138,45 @@ private:
     int _starvationFrameCount;
     
     /*
-     Guards the _taskQueue and _queuedTasks set.
+     Guards the task queues, the _queuedTasks set, and the cost
+     estimates.
      */
     std::recursive_mutex _taskQueueMutex;
     
     /*
-     The actual queue we use to process tasks in FIFO order.
+     The queues of each priority class, each processed in FIFO order
+     (a resumable task keeps its place while it has slices remaining).
      */
-    std::queue<VROFrameTask> _taskQueue;
+    std::deque<VROFrameTask> _taskQueues[kNumFrameTaskPriorities];
     
     /*
      Set used to prevent the same task from being queued
      multiple times, based on its ID.
      */
-    std::set<std::string> _queuedTasks;
+    std::unordered_set<std::string> _queuedTasks;
+
+    /*
+     Exponential moving average of the run time (ms) of each task
+     class.
+     */
+    std::unordered_map<std::string, double> _costEstimates;
+
+    void enqueue(VROFrameTask task, VROFrameTaskPriority priority);
+
+    /*
+     Remove the next task to run from the queues, given the time remaining.
+     If force is true, the first task is returned even if it does not fit.
+     Returns false if no task can run.
+     */
+    bool dequeue(const VROFrameTimer &timer, bool force, VROFrameTask *outTask, int *outPriority);
+
+    /*
+     Run the given task (or one slice of it), updating its class's cost
+     estimate. Returns true if the task is complete.
+     */
+    bool runTask(VROFrameTask &task);
+
+    static std::string getCostClass(const std::string &key);
     
 };
 
@@ -28,17 +28,37 @@
 #define VROFrameSynchronizer_h
 
 #include <memory>
+#include <stdint.h>
 
 class VROFrameListener;
 
+/*
+ Identifies a frame listener registration. Handles are never reused, so a
+ handle that has been removed stays invalid.
+ */
+typedef uint64_t VROFrameListenerHandle;
+static const VROFrameListenerHandle kInvalidFrameListenerHandle = 0;
+
 class VROFrameSynchronizer {
     
 public:
     
     virtual ~VROFrameSynchronizer() {}
     
-    virtual void addFrameListener(std::shared_ptr<VROFrameListener> listener) = 0;
+    /*
+     Register a listener to be notified around each frame, returning the handle
+     of the registration. Listeners are held weakly. Registration and removal
+     may be invoked from any thread (including from within a listener's
+     callbacks), and take effect at the next frame boundary.
+     */
+    virtual VROFrameListenerHandle addFrameListener(std::shared_ptr<VROFrameListener> listener) = 0;
+    
+    /*
+     Remove every registration of the given listener, or the registration with
+     the given handle.
+     */
     virtual void removeFrameListener(std::shared_ptr<VROFrameListener> listener) = 0;
+    virtual void removeFrameListener(VROFrameListenerHandle handle) = 0;
     
 };
 
@@ -26,51 +26,118 @@
 
 #include "VROFrameSynchronizerInternal.h"
 #include "VROFrameListener.h"
+#include "VROProfiler.h"
 #include <algorithm>
 
-void VROFrameSynchronizerInternal::addFrameListener(std::shared_ptr<VROFrameListener> listener) {
-    _frameListeners.push_back(listener);
+VROFrameSynchronizerInternal::VROFrameSynchronizerInternal() :
+    _hasExpiredListeners(false),
+    _nextHandle(kInvalidFrameListenerHandle) {
+    
+}
+
+VROFrameListenerHandle VROFrameSynchronizerInternal::addFrameListener(std::shared_ptr<VROFrameListener> listener) {
+    if (!listener) {
+        return kInvalidFrameListenerHandle;
+    }
+    VROFrameListenerHandle handle = ++_nextHandle;
+    _commands.push({ true, { handle, listener } });
+    return handle;
 }
 
 void VROFrameSynchronizerInternal::removeFrameListener(std::shared_ptr<VROFrameListener> listener) {
-    _frameListeners.erase(
-                          std::remove_if(_frameListeners.begin(), _frameListeners.end(),
-                                         [this, listener](std::weak_ptr<VROFrameListener> l) {
-                                             std::shared_ptr<VROFrameListener> locked = l.lock();
-                                             return locked && locked == listener;
-                                         }), _frameListeners.end());
+    if (listener) {
+        _commands.push({ false, { kInvalidFrameListenerHandle, listener } });
+    }
+}
+
+void VROFrameSynchronizerInternal::removeFrameListener(VROFrameListenerHandle handle) {
+    if (handle != kInvalidFrameListenerHandle) {
+        _commands.push({ false, { handle, std::weak_ptr<VROFrameListener>() } });
+    }
+}
+
+void VROFrameSynchronizerInternal::applyCommands() {
+    Command command;
+    while (_commands.pop(&command)) {
+        if (command.add) {
+            _frameListeners.push_back(std::move(command.registration));
+            continue;
+        }
+        
+        const Registration &removal = command.registration;
+        _frameListeners.erase(std::remove_if(_frameListeners.begin(), _frameListeners.end(),
+                                             [&removal](const Registration &registration) {
+                                                 if (removal.handle != kInvalidFrameListenerHandle) {
+                                                     return registration.handle == removal.handle;
+                                                 }
+                                                 return !registration.listener.owner_before(removal.listener) &&
+                                                        !removal.listener.owner_before(registration.listener);
+                                             }), _frameListeners.end());
+    }
+    
+    if (_hasExpiredListeners) {
+        _frameListeners.erase(std::remove_if(_frameListeners.begin(), _frameListeners.end(),
+                                             [](const Registration &registration) {
+                                                 return registration.listener.expired();
+                                             }), _frameListeners.end());
+        _hasExpiredListeners = false;
+    }
 }
 
 void VROFrameSynchronizerInternal::notifyFrameStart(const VRORenderContext &context) {
-    auto it = _frameListeners.begin();
+    applyCommands();
     
-    while (it != _frameListeners.end()) {
-        std::weak_ptr<VROFrameListener> listener = *it;
-        std::shared_ptr<VROFrameListener> locked = listener.lock();
-        
-        if (locked) {
-            locked->onFrameWillRender(context);
-            ++it;
+    // Registrations made by the callbacks are queued, so the array never
+    // changes while it is iterated
+    for (const Registration &registration : _frameListeners) {
+        std::shared_ptr<VROFrameListener> locked = registration.listener.lock();
+        if (!locked) {
+            _hasExpiredListeners = true;
+            continue;
         }
-        else {
-            it = _frameListeners.erase(it);
+        VROProfilerScope scope(locked->getFrameListenerName());
+        locked->onFrameWillRender(context);
+    }
+}
+
+bool VROFrameSynchronizerInternal::hasAnimatingListeners() {
+    applyCommands();
+    for (const Registration &registration : _frameListeners) {
+        std::shared_ptr<VROFrameListener> locked = registration.listener.lock();
+        if (locked && locked->isAnimating()) {
+            return true;
         }
     }
+    return false;
+}
+
+float VROFrameSynchronizerInternal::getAnimatingContentFrameRate() {
+    applyCommands();
+    float rate = 0;
+    for (const Registration &registration : _frameListeners) {
+        std::shared_ptr<VROFrameListener> locked = registration.listener.lock();
+        if (!locked || !locked->isAnimating()) {
+            continue;
+        }
+        float listenerRate = locked->getContentFrameRate();
+        if (listenerRate <= 0) {
+            return -1;
+        }
+        rate = std::max(rate, listenerRate);
+    }
+    return rate;
 }
 
 void VROFrameSynchronizerInternal::notifyFrameEnd(const VRORenderContext &context) {
-    auto it = _frameListeners.begin();
+    applyCommands();
     
-    while (it != _frameListeners.end()) {
-        std::weak_ptr<VROFrameListener> listener = *it;
-        std::shared_ptr<VROFrameListener> locked = listener.lock();
-        
-        if (locked) {
-            locked->onFrameDidRender(context);
-            ++it;
-        }
-        else {
-            it = _frameListeners.erase(it);
+    for (const Registration &registration : _frameListeners) {
+        std::shared_ptr<VROFrameListener> locked = registration.listener.lock();
+        if (!locked) {
+            _hasExpiredListeners = true;
+            continue;
         }
+        VROProfilerScope scope(locked->getFrameListenerName());
+        locked->onFrameDidRender(context);
     }
 }
@@ -28,28 +28,82 @@
 #define VROFrameSynchronizerInternal_h
 
 #include "VROFrameSynchronizer.h"
+#include "VROMPSCQueue.h"
+#include "VROAtomic.h"
 #include <vector>
 
 class VRORenderContext;
 
+/*
+ Dispatches frame notifications to the registered listeners. Registrations and
+ removals are pushed onto a lock-free queue by any thread, and applied by the
+ rendering thread at the start of each notification pass; the listeners
+ themselves are kept in a flat array that only the rendering thread touches,
+ so dispatch takes no locks and makes no allocations. Removal is deferred in
+ the same way, and listeners that have been destroyed are swept out after the
+ pass that finds them. When the profiler is enabled each callback is timed
+ under the listener's name (see VROFrameListener::getFrameListenerName()).
+ */
 class VROFrameSynchronizerInternal : public VROFrameSynchronizer {
     
 public:
     
+    VROFrameSynchronizerInternal();
     virtual ~VROFrameSynchronizerInternal() {}
     
-    void addFrameListener(std::shared_ptr<VROFrameListener> listener);
+    VROFrameListenerHandle addFrameListener(std::shared_ptr<VROFrameListener> listener);
     void removeFrameListener(std::shared_ptr<VROFrameListener> listener);
+    void removeFrameListener(VROFrameListenerHandle handle);
     
+    /*
+     Notify the listeners of the start and end of a frame. Rendering thread
+     only, as are the queries below.
+     */
     void notifyFrameStart(const VRORenderContext &context);
     void notifyFrameEnd(const VRORenderContext &context);
+
+    /*
+     True if any registered listener is animating (see VROFrameListener::isAnimating()).
+     */
+    bool hasAnimatingListeners();
+
+    /*
+     The highest content frame rate among the animating listeners: 0 if no listener
+     is animating, or -1 if any listener changes every display refresh.
+     */
+    float getAnimatingContentFrameRate();
     
 private:
     
+    struct Registration {
+        VROFrameListenerHandle handle;
+        std::weak_ptr<VROFrameListener> listener;
+    };
+    
+    /*
+     A pending registration or removal. Removals carry either the handle or the
+     listener to remove (matched by ownership, so destroyed listeners compare
+     correctly).
+     */
+    struct Command {
+        bool add;
+        Registration registration;
+    };
+    
+    /*
+     Listeners that receive an update each frame, in registration order.
+     Rendering thread only.
+     */
+    std::vector<Registration> _frameListeners;
+    bool _hasExpiredListeners;
+    
+    VROMPSCQueue<Command> _commands;
+    VROAtomic<VROFrameListenerHandle> _nextHandle;
+    
     /*
-     Listeners that receive an update each frame.
+     Apply the pending commands, and sweep out destroyed listeners.
      */
-    std::vector<std::weak_ptr<VROFrameListener>> _frameListeners;
+    void applyCommands();
     
 };
 
@@ -0,0 +1,213 @@
+//
+//  VROFrameTelemetry.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include "VROFrameTelemetry.h"
+#include "VROTime.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+// Upper bounds of the histogram buckets in ms; a final bucket holds the rest
+static const double kHistogramBuckets[] = { 4, 8, 12, 16.7, 20, 25, 33.4, 50, 66.7, 100, 250 };
+static const int kNumHistogramBuckets = sizeof(kHistogramBuckets) / sizeof(double) + 1;
+
+// Default jank threshold, as a multiple of the expected frame interval
+static const double kDefaultJankMultiplier = 1.5;
+
+// Intervals at or above which the renderer is considered paused
+static const double kPauseInterval = 1000;
+
+// Frames captured before and after each jank frame
+static const int kTracesBeforeJank = 4;
+static const int kTracesAfterJank = 2;
+
+// Jank events retained between polls; older events are dropped
+static const int kMaxJankEvents = 16;
+
+static void writeEscaped(std::stringstream &ss, const std::string &str) {
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            ss << '\\' << c;
+        }
+        else if ((unsigned char) c >= 0x20) {
+            ss << c;
+        }
+    }
+}
+
+void VROFrameTelemetry::VROFrameTelemetryHistogram::add(double value) {
+    int bucket = 0;
+    while (bucket < kNumHistogramBuckets - 1 && value > kHistogramBuckets[bucket]) {
+        bucket++;
+    }
+    counts[bucket]++;
+    samples++;
+    sum += value;
+    max = std::max(max, value);
+}
+
+void VROFrameTelemetry::VROFrameTelemetryHistogram::reset() {
+    counts.assign(kNumHistogramBuckets, 0);
+    samples = 0;
+    sum = 0;
+    max = 0;
+}
+
+VROFrameTelemetry::VROFrameTelemetry() :
+    _jankThreshold(0) {
+    resetLocked();
+}
+
+VROFrameTelemetry::~VROFrameTelemetry() {
+    
+}
+
+void VROFrameTelemetry::setJankThreshold(double threshold) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _jankThreshold = threshold;
+}
+
+void VROFrameTelemetry::recordFrame(VROFrameTelemetryTrace trace, double expectedInterval) {
+    if (trace.interval <= 0 || trace.interval >= kPauseInterval || expectedInterval <= 0) {
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(_mutex);
+    double threshold = _jankThreshold > 0 ? _jankThreshold : expectedInterval * kDefaultJankMultiplier;
+    
+    // Frames within half an interval of the expected vsync were presented on time
+    trace.missedVsyncs = std::max((int) std::floor(trace.interval / expectedInterval + 0.5) - 1, 0);
+    trace.jank = trace.interval > threshold;
+    
+    _frames++;
+    _missedVsyncs += trace.missedVsyncs;
+    _intervalHistogram.add(trace.interval);
+    _cpuHistogram.add(trace.prepare + trace.render + trace.end);
+    if (trace.gpu >= 0) {
+        _gpuHistogram.add(trace.gpu);
+    }
+    
+    if (trace.jank) {
+        _jankFrames++;
+        
+        // Jank while the last event is still capturing extends that event
+        if (_pendingTraces > 0 && !_jankEvents.empty()) {
+            _jankEvents.back().traces.push_back(trace);
+            _jankEvents.back().jankFrames++;
+        }
+        else {
+            VROFrameTelemetryJankEvent event;
+            event.traces.assign(_recentTraces.begin(), _recentTraces.end());
+            event.traces.push_back(trace);
+            event.jankFrames = 1;
+            _jankEvents.push_back(std::move(event));
+            
+            if ((int) _jankEvents.size() > kMaxJankEvents) {
+                _jankEvents.pop_front();
+                _droppedJankEvents++;
+            }
+        }
+        _pendingTraces = kTracesAfterJank;
+    }
+    else if (_pendingTraces > 0 && !_jankEvents.empty()) {
+        _jankEvents.back().traces.push_back(trace);
+        _pendingTraces--;
+    }
+    
+    _recentTraces.push_back(std::move(trace));
+    if ((int) _recentTraces.size() > kTracesBeforeJank) {
+        _recentTraces.pop_front();
+    }
+}
+
+std::string VROFrameTelemetry::toJSON(bool reset) {
+    auto writeHistogram = [](std::stringstream &ss, const VROFrameTelemetryHistogram &histogram) {
+        ss << "{\"samples\":" << histogram.samples
+           << ",\"mean\":" << (histogram.samples > 0 ? histogram.sum / histogram.samples : 0)
+           << ",\"max\":" << histogram.max << ",\"counts\":[";
+        for (int i = 0; i < kNumHistogramBuckets; i++) {
+            ss << (i > 0 ? "," : "") << histogram.counts[i];
+        }
+        ss << "]}";
+    };
+    
+    std::stringstream ss;
+    std::lock_guard<std::mutex> lock(_mutex);
+    ss << "{\"duration\":" << (VROTimeCurrentMillis() - _sessionStartTime)
+       << ",\"frames\":" << _frames << ",\"missedVsyncs\":" << _missedVsyncs
+       << ",\"jankFrames\":" << _jankFrames << ",\"droppedJankEvents\":" << _droppedJankEvents
+       << ",\"buckets\":[";
+    for (int i = 0; i < kNumHistogramBuckets - 1; i++) {
+        ss << (i > 0 ? "," : "") << kHistogramBuckets[i];
+    }
+    ss << "],\"interval\":";
+    writeHistogram(ss, _intervalHistogram);
+    ss << ",\"cpu\":";
+    writeHistogram(ss, _cpuHistogram);
+    ss << ",\"gpu\":";
+    writeHistogram(ss, _gpuHistogram);
+    
+    ss << ",\"jankEvents\":[";
+    for (size_t i = 0; i < _jankEvents.size(); i++) {
+        const VROFrameTelemetryJankEvent &event = _jankEvents[i];
+        ss << (i > 0 ? "," : "") << "{\"jankFrames\":" << event.jankFrames << ",\"traces\":[";
+        for (size_t t = 0; t < event.traces.size(); t++) {
+            const VROFrameTelemetryTrace &trace = event.traces[t];
+            ss << (t > 0 ? "," : "") << "{\"frame\":" << trace.frame << ",\"scene\":\"";
+            writeEscaped(ss, trace.scene);
+            ss << "\",\"interval\":" << trace.interval << ",\"prepare\":" << trace.prepare
+               << ",\"render\":" << trace.render << ",\"end\":" << trace.end << ",\"gpu\":" << trace.gpu
+               << ",\"missedVsyncs\":" << trace.missedVsyncs << ",\"jank\":" << (trace.jank ? "true" : "false")
+               << "}";
+        }
+        ss << "]}";
+    }
+    ss << "]}";
+    
+    if (reset) {
+        resetLocked();
+    }
+    return ss.str();
+}
+
+void VROFrameTelemetry::reset() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    resetLocked();
+}
+
+void VROFrameTelemetry::resetLocked() {
+    _sessionStartTime = VROTimeCurrentMillis();
+    _frames = 0;
+    _missedVsyncs = 0;
+    _jankFrames = 0;
+    _droppedJankEvents = 0;
+    _intervalHistogram.reset();
+    _cpuHistogram.reset();
+    _gpuHistogram.reset();
+    _recentTraces.clear();
+    _jankEvents.clear();
+    _pendingTraces = 0;
+}
@@ -0,0 +1,153 @@
+//
+//  VROFrameTelemetry.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef VROFrameTelemetry_h
+#define VROFrameTelemetry_h
+
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/*
+ The timing of a single frame, in ms. The phases are the CPU time spent in
+ VRORenderer's prepareFrame, eye and HUD rendering, and endFrame. The interval
+ is the time since the previous frame was prepared, which is what the user
+ perceives; the GPU time is that of a recent frame (see
+ VRODriver::getGPUFrameTime), or negative if unknown.
+ */
+struct VROFrameTelemetryTrace {
+    int frame;
+    double interval;
+    double prepare;
+    double render;
+    double end;
+    double gpu;
+    int missedVsyncs;
+    bool jank;
+    
+    /*
+     The name of the root node of the scene rendered by the frame.
+     */
+    std::string scene;
+};
+
+/*
+ Distributional frame timing for analytics, complementing the average FPS.
+ Maintains histograms of frame interval, CPU time, and GPU time; counts the
+ vsyncs missed since the last reset; and whenever a frame's interval exceeds
+ the jank threshold, captures the traces of the frames leading up to and
+ following it, so that jank can be attributed to a phase and scene. Jank
+ frames close together are captured as a single event.
+ 
+ Frames are recorded on the rendering thread and the telemetry may be queried
+ from any thread.
+ */
+class VROFrameTelemetry {
+public:
+    
+    VROFrameTelemetry();
+    virtual ~VROFrameTelemetry();
+    
+    /*
+     Set the interval above which a frame is jank, in ms. If zero or negative,
+     frames are jank when they exceed 1.5 times their expected interval.
+     */
+    void setJankThreshold(double threshold);
+    
+    /*
+     Record the given frame, which was expected to take expectedInterval ms.
+     The trace's missed vsyncs and jank are computed here. Intervals of a second
+     or more are pauses (the app was backgrounded, or rendering on demand) and
+     are not recorded.
+     */
+    void recordFrame(VROFrameTelemetryTrace trace, double expectedInterval);
+    
+    /*
+     Get the telemetry as JSON, optionally resetting it at the same time so that
+     no frame is lost between polls.
+     */
+    std::string toJSON(bool reset);
+    
+    /*
+     Clear all telemetry, starting a new session.
+     */
+    void reset();
+    
+private:
+    
+    /*
+     Frame counts by time, over the fixed ms buckets of kHistogramBuckets, the
+     last for anything longer.
+     */
+    struct VROFrameTelemetryHistogram {
+        std::vector<int> counts;
+        int samples;
+        double sum;
+        double max;
+        
+        void add(double value);
+        void reset();
+    };
+    
+    /*
+     The traces captured around one or more jank frames.
+     */
+    struct VROFrameTelemetryJankEvent {
+        std::vector<VROFrameTelemetryTrace> traces;
+        int jankFrames;
+    };
+    
+    std::mutex _mutex;
+    double _jankThreshold;
+    double _sessionStartTime;
+    
+    int _frames;
+    int _missedVsyncs;
+    int _jankFrames;
+    int _droppedJankEvents;
+    VROFrameTelemetryHistogram _intervalHistogram;
+    VROFrameTelemetryHistogram _cpuHistogram;
+    VROFrameTelemetryHistogram _gpuHistogram;
+    
+    /*
+     The most recent frames, from which the frames preceding jank are taken.
+     */
+    std::deque<VROFrameTelemetryTrace> _recentTraces;
+    
+    /*
+     Captured jank events, oldest first. The last event is still capturing the
+     frames following its jank while _pendingTraces is positive.
+     */
+    std::deque<VROFrameTelemetryJankEvent> _jankEvents;
+    int _pendingTraces;
+    
+    void resetLocked();
+    
+};
+
+#endif /* VROFrameTelemetry_h */
@@ -61,6 +61,14 @@ public:
         return _frameType == VROFrameType::Startup || getTimeRemainingInFrame() > 0;
     }
     
+    /*
+     Returns true if an operation of the given estimated cost (in ms) can
+     complete within the time remaining in the current frame.
+     */
+    bool hasTimeRemainingFor(double costMillis) const {
+        return _frameType == VROFrameType::Startup || getTimeRemainingInFrame() > costMillis;
+    }
+    
     double getTimeRemainingInFrame() const {
         return _timeForProcessing - (VROTimeCurrentMillis() - _lastFrameEndTime);
     }
@@ -28,6 +28,12 @@
 #include "VROFrustumPlane.h"
 #include "VROMath.h"
 #include <limits>
+#include <algorithm>
+
+/*
+ Number of boxes tested per iteration of intersectBatch.
+ */
+static const int kFrustumBatchWidth = 4;
 
 /////////////////////////////////////////////////////////////////////////////////
 //
@@ -311,6 +317,76 @@ VROFrustumResult VROFrustum::intersectNoOpt(const VROBoundingBox &box) const {
     }
 }
 
+/*
+ Test four boxes, given as six arrays of box planes in VROBoxPlane order, against
+ the six frustum planes. Returns in the low four bits of *outOutside the boxes
+ outside any plane, and in *outStraddling the boxes that cross any plane. Uses
+ the compiler's vector extensions, which map to NEON on ARM and SSE on x86.
+ */
+static __attribute__((__always_inline__)) void intersect4_simd(const VROFrustumPlane *planes,
+                                                               const float boxPlanes[6][kFrustumBatchWidth],
+                                                               uint32_t *outOutside, uint32_t *outStraddling) {
+    typedef float float4 __attribute__((__vector_size__(16)));
+    typedef int int4 __attribute__((__vector_size__(16)));
+    
+    const float4 *rows = (const float4 *) boxPlanes;
+    int4 outside = { 0, 0, 0, 0 };
+    int4 straddling = { 0, 0, 0, 0 };
+    
+    for (int i = 0; i < 6; i++) {
+        const VROFrustumPlane &plane = planes[i];
+        const VROBoxPlane *farPoints = plane.farPoints;
+        
+        float4 inner = rows[farPoints[VROFarPointPosX]] * plane.normal.x
+                     + rows[farPoints[VROFarPointPosY]] * plane.normal.y
+                     + rows[farPoints[VROFarPointPosZ]] * plane.normal.z
+                     + plane.d;
+        float4 outer = rows[farPoints[VROFarPointNegX]] * plane.normal.x
+                     + rows[farPoints[VROFarPointNegY]] * plane.normal.y
+                     + rows[farPoints[VROFarPointNegZ]] * plane.normal.z
+                     + plane.d;
+        outside |= (int4) (inner < 0.0f);
+        straddling |= (int4) (outer < 0.0f);
+    }
+    
+    *outOutside = (outside[0] & 1) | (outside[1] & 2) | (outside[2] & 4) | (outside[3] & 8);
+    *outStraddling = (straddling[0] & 1) | (straddling[1] & 2) | (straddling[2] & 4) | (straddling[3] & 8);
+}
+
+void VROFrustum::intersectBatch(const VROBoundingBox *boxes, int count,
+                                uint32_t *outIntersecting, uint32_t *outInside) const {
+    int numWords = getBatchMaskSize(count);
+    for (int w = 0; w < numWords; w++) {
+        outIntersecting[w] = 0;
+        if (outInside) {
+            outInside[w] = 0;
+        }
+    }
+    
+    // Transpose each group of four boxes so that each box plane is contiguous
+    // across the group. The final group is padded by repeating its last box
+    alignas(16) float boxPlanes[6][kFrustumBatchWidth];
+    for (int i = 0; i < count; i += kFrustumBatchWidth) {
+        int groupSize = std::min(kFrustumBatchWidth, count - i);
+        for (int b = 0; b < kFrustumBatchWidth; b++) {
+            const float *planes = boxes[i + std::min(b, groupSize - 1)].getPlanes();
+            for (int p = 0; p < 6; p++) {
+                boxPlanes[p][b] = planes[p];
+            }
+        }
+        
+        uint32_t outside, straddling;
+        intersect4_simd(_planes, boxPlanes, &outside, &straddling);
+        
+        // Groups are four-aligned, so they never span two mask words
+        uint32_t groupMask = (1 << groupSize) - 1;
+        outIntersecting[i >> 5] |= (~outside & groupMask) << (i & 31);
+        if (outInside) {
+            outInside[i >> 5] |= (~(outside | straddling) & groupMask) << (i & 31);
+        }
+    }
+}
+
 bool VROFrustum::containsPoint(const VROVector3f &pt) const {
     for (int i = 0; i < 6; i++) {
         if (_planes[i].distanceToPoint(pt) < 0) {
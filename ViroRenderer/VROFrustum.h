@@ -30,6 +30,7 @@
 #include "VROFrustumPlane.h"
 #include "VROVector3f.h"
 #include "VROFrustumBoxIntersectionMetadata.h"
+#include <stdint.h>
 
 /*
  Plane identifiers.
@@ -96,6 +97,23 @@ public:
      */
     VROFrustumResult intersectNoOpt(const VROBoundingBox &box) const;
 
+    /*
+     Batched frustum intersection, for testing a contiguous array of boxes. Uses the
+     far point test of intersectWithFarPointsOpt, vectorized to test four boxes at a
+     time with SIMD vector extensions. Bit i of outIntersecting is set if box i
+     is inside or intersects the frustum, and bit i of outInside (if not null) is set
+     if box i is entirely inside. Each mask must hold getBatchMaskSize(count) words.
+     */
+    void intersectBatch(const VROBoundingBox *boxes, int count,
+                        uint32_t *outIntersecting, uint32_t *outInside) const;
+
+    static int getBatchMaskSize(int count) {
+        return (count + 31) / 32;
+    }
+    static bool isBatchMaskSet(const uint32_t *mask, int index) {
+        return (mask[index >> 5] >> (index & 31)) & 1;
+    }
+
     /*
      Check if the given point is contained by this frustum.
      */
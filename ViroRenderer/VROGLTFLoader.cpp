@@ -46,30 +46,28 @@
 #include "VROSkeletalAnimation.h"
 #include "VROSkeleton.h"
 #include "VROBoneUBO.h"
+#include "VROSkinner.h"
 #include "VROLog.h"
 #include "VROShaderFactory.h"
 #include "VROShaderModifier.h"
 #include "VROShaderProgram.h"
 #include "VROMorpher.h"
+#include "VROImage.h"
+#include "VROData.h"
+#include "VROMeshoptDecoder.h"
+#include "VROMeshOptimizer.h"
+#include "VROTextureUtil.h"
+#include "VROImageDecoder.h"
 
 static std::string kVROGLTFInputSamplerKey = "timeInput";
-std::map<std::string, std::shared_ptr<VROVertexBuffer>> VROGLTFLoader::_dataCache;
-std::map<std::string, std::shared_ptr<VROTexture>> VROGLTFLoader::_textureCache;
-std::map<int, std::shared_ptr<VROSkeleton>> VROGLTFLoader::_skinIndexToSkeleton;
-std::map<int, std::map<int, std::vector<std::shared_ptr<VROKeyframeAnimation>>>> VROGLTFLoader::_nodeKeyFrameAnims;
-std::map<int, std::vector<std::shared_ptr<VROSkeletalAnimation>>> VROGLTFLoader::_skinSkeletalAnims;
-std::map<int, std::shared_ptr<VROSkinner>> VROGLTFLoader::_skinMap;
 
-// An map of all skinner joint index to its corresponding node index (provided by tinygLTF).
-std::map<int, std::map<int,int>> VROGLTFLoader::_skinIndexToJointNodeIndex;
+// Longest side, in pixels, of the preview textures shown while progressive loads
+// upload full resolution textures
+static const int kPreviewTextureSize = 64;
 
-// An map of all skinner joint index to its skinner child joint indexes (Not Nodes).
-// Note: the first joint index at 0 is not necessairly the root joint. This is only the
-// order of which the inverse bind data is provided in the gLTF JSON structure.
-std::map<int, std::map<int,std::vector<int>>> VROGLTFLoader::_skinIndexToJointChildJoints;
-
-// An map of all root skeleton joint indexes.
-std::map<int, int> VROGLTFLoader::_skinIndexToSkeletonRootJoint;
+// Incremented whenever the processing of mesh geometry changes, invalidating the
+// geometry previously stored in the geometry cache
+static const uint32_t kGLTFGeometryCacheVersion = 1;
 
 static int getTypeSize(GLTFType type) {
     switch (type) {
@@ -247,23 +245,28 @@ VROWrapMode VROGLTFLoader::getWrappingMode(int mode) {
 
 void VROGLTFLoader::loadGLTFFromResource(std::string gltfManifestFilePath, const std::map<std::string, std::string> overwriteResourceMap,
                                          VROResourceType resourceType, std::shared_ptr<VRONode> rootNode, bool isGLTFBinary,
-                                         std::shared_ptr<VRODriver> driver, std::function<void(std::shared_ptr<VRONode>, bool)> onFinish) {
+                                         std::shared_ptr<VRODriver> driver, std::function<void(std::shared_ptr<VRONode>, bool)> onFinish,
+                                         bool progressive, bool optimizeGeometry) {
       // First, retrieve the main GLTF 'json manifest' file (either .gltf or .glb)
       VROModelIOUtil::retrieveResourceAsync(gltfManifestFilePath, resourceType,
-                                            [gltfManifestFilePath, overwriteResourceMap, isGLTFBinary, rootNode, driver, onFinish]
+                                            [gltfManifestFilePath, overwriteResourceMap, isGLTFBinary, rootNode, driver, onFinish, progressive,
+                                             optimizeGeometry]
                                             (std::string cachedFilePath, bool isTemp) {
                 // Then use TinyGltf to parse the GTLF structure, and corresponding auxiliary resource files.
-                VROPlatformDispatchAsyncBackground([gltfManifestFilePath, overwriteResourceMap, isGLTFBinary, cachedFilePath, rootNode, driver, onFinish] {
-                    tinygltf::Model gModel;
+                std::shared_ptr<VROGeometryCache> geometryCache = driver->getGeometryCache();
+                VROPlatformDispatchAsyncBackground([gltfManifestFilePath, overwriteResourceMap, isGLTFBinary, cachedFilePath, rootNode, driver, onFinish, progressive,
+                                                    geometryCache, optimizeGeometry] {
+                    // Shared, so that geometry can slice the model's buffers rather than copy them
+                    std::shared_ptr<tinygltf::Model> gModel = std::make_shared<tinygltf::Model>();
                     tinygltf::TinyGLTF gLoader;
                     std::string err;
 
                     // If we've successfully retrieved the GLTF Manifest, start parsing the file with tinyGLTF.
                     bool ret = false;
                     if (isGLTFBinary) {
-                        ret = gLoader.LoadBinaryFromFile(&gModel, &err, cachedFilePath, overwriteResourceMap);
+                        ret = gLoader.LoadBinaryFromFile(gModel.get(), &err, cachedFilePath, overwriteResourceMap);
                     } else {
-                        ret = gLoader.LoadASCIIFromFile(&gModel, &err, cachedFilePath, gltfManifestFilePath, overwriteResourceMap);
+                        ret = gLoader.LoadASCIIFromFile(gModel.get(), &err, cachedFilePath, gltfManifestFilePath, overwriteResourceMap);
                     }
 
                     // Fail fast if any errors were encountered.
@@ -280,57 +283,29 @@ void VROGLTFLoader::loadGLTFFromResource(std::string gltfManifestFilePath, const
                     }
 
                     // Ensure that we are only processing GLTF 2.0 models.
-                    std::string version = gModel.asset.version;
+                    std::string version = gModel->asset.version;
                     if (VROStringUtil::toFloat(version) < 2) {
                         pwarn("Error parsing GLTF model: Only GLTF 2.0 models are supported!");
                         onFinish(nullptr, false);
                         return;
                     }
 
-                    // Once the manifest has been parsed, start constructing our Viro 3D Model.
-                    const tinygltf::Model &model = gModel;
-                    VROPlatformDispatchAsyncRenderer([rootNode, model, driver, onFinish] {
-                        clearCachedData();
-
-                        // Process and cache skinner and skeletal data needed for skeletal animation
-                        // and skinner geometry to be set later on our nodes.
-                        if (!processSkinner(model)) {
-                            perr("Error when processing the skinner of GLTF model!");
-                            onFinish(nullptr, false);
-                            return;
-                        }
-
-                        // Now generate our KeyFrame and skeletal animations and cache them to be
-                        // set later on our nodes (when we iterate through the scene hierarchy).
-                        if (!processAnimations(model)) {
-                            pwarn("Error when processing animation data of the GLTF model!");
-                            onFinish(nullptr, false);
-                            return;
-                        }
-
-                        // Finally, iterate through gLTF model data and build out our VRONodes that
-                        // represent our 3D Model scene, setting cached animations / skinners on
-                        // those nodes along the way.
-                        bool success = true;
-                        std::shared_ptr<VRONode> gltfRootNode = std::make_shared<VRONode>();
-                        for (const tinygltf::Scene &gScene : model.scenes) {
-                            if (!processScene(model, gltfRootNode, gScene, driver)) {
-                                success = false;
-                                break;
-                            }
-                        }
-
-                        for (auto &skeletonPair : _skinIndexToSkeleton) {
-                            std::shared_ptr<VROSkinner> skin = _skinMap[skeletonPair.first];
-                            skeletonPair.second->setSkinnerRootNode(skin->getSkinnerNode());
-                        }
-
-                        // Once we have processed the model, injected it into the scene.
-                        injectGLTF(success ? gltfRootNode : nullptr, rootNode, driver, onFinish);
-
-                        // Clean up our cached resources.
-                        clearCachedData();
+                    // Once the manifest has been parsed, construct our Viro 3D Model here, off the
+                    // rendering thread, with a loader dedicated to this model.
+                    std::shared_ptr<VROGLTFLoader> loader = std::shared_ptr<VROGLTFLoader>(new VROGLTFLoader(progressive, optimizeGeometry,
+                                                                                                             geometryCache));
+                    std::shared_ptr<VRONode> gltfRootNode = loader->buildModel(gModel, driver);
+
+                    // Only hand the finished model to the renderer for injection into the scene.
+                    VROPlatformDispatchAsyncRenderer([loader, gltfRootNode, rootNode, driver, onFinish, progressive] {
+                        loader->restoreThreadRestrictions();
+                        injectGLTF(gltfRootNode, rootNode, driver, onFinish, progressive);
                     });
+
+                    // In progressive mode the textures follow the model, in priority order.
+                    if (progressive && gltfRootNode) {
+                        loader->streamTextures(*gModel, driver);
+                    }
                 });
             },
             [gltfManifestFilePath, rootNode, onFinish]() {
@@ -340,16 +315,300 @@ void VROGLTFLoader::loadGLTFFromResource(std::string gltfManifestFilePath, const
             });
 }
 
-void VROGLTFLoader::clearCachedData() {
-    _dataCache.clear();
-    _textureCache.clear();
-    _skinIndexToSkeleton.clear();
-    _skinIndexToJointNodeIndex.clear();
-    _skinIndexToJointChildJoints.clear();
-    _skinMap.clear();
-    _nodeKeyFrameAnims.clear();
-    _skinSkeletalAnims.clear();
-    _skinIndexToSkeletonRootJoint.clear();
+std::shared_ptr<VRONode> VROGLTFLoader::buildModel(std::shared_ptr<const tinygltf::Model> model, std::shared_ptr<VRODriver> driver) {
+    _modelOwner = model;
+    for (const tinygltf::Image &gImage : model->images) {
+        if (gImage.bufferView >= 0 && gImage.bufferView < model->bufferViews.size()) {
+            _imageBuffers.insert(model->bufferViews[gImage.bufferView].buffer);
+        }
+    }
+
+    std::shared_ptr<VRONode> root = buildModel(*model, driver);
+
+    // Slices made during the build retain the model; the loader does not
+    _modelOwner.reset();
+    _imageBuffers.clear();
+    _bufferData.clear();
+    return root;
+}
+
+std::shared_ptr<VROData> VROGLTFLoader::getBufferSlice(const tinygltf::Model &gModel, int bufferIndex,
+                                                       size_t byteOffset, size_t byteLength) {
+    const std::vector<unsigned char> &buffer = gModel.buffers[bufferIndex].data;
+    if (!_modelOwner || _imageBuffers.count(bufferIndex) > 0) {
+        return std::make_shared<VROData>((const void *) buffer.data(), (int) byteLength, (int) byteOffset);
+    }
+
+    auto it = _bufferData.find(bufferIndex);
+    if (it == _bufferData.end()) {
+        std::shared_ptr<VROData> data = std::make_shared<VROData>((const void *) buffer.data(), (int) buffer.size(), _modelOwner);
+        it = _bufferData.insert({ bufferIndex, data }).first;
+    }
+    return std::make_shared<VROData>(it->second, (int) byteOffset, (int) byteLength);
+}
+
+std::shared_ptr<VRONode> VROGLTFLoader::buildModel(const tinygltf::Model &model, std::shared_ptr<VRODriver> driver) {
+    if (requiresUnsupportedExtension(model)) {
+        return nullptr;
+    }
+    _astcSupported = driver->isASTCSupported();
+
+    // Decompress geometry first, so all further processing reads decoded bufferViews
+    if (!decodeCompressedBufferViews(model)) {
+        perr("Error when decoding the compressed geometry of GLTF model!");
+        return nullptr;
+    }
+
+    // Read back the processed geometry of the model's meshes, if an earlier load
+    // stored it
+    if (_geometryCache) {
+        _geometryCacheKey = hashMeshData(model);
+        _geometryCacheHit = _geometryCache->loadMeshes(_geometryCacheKey, driver, &_cachedMeshes) &&
+                            _cachedMeshes.size() == model.meshes.size();
+        if (!_geometryCacheHit) {
+            _cachedMeshes.clear();
+            _cachedMeshes.resize(model.meshes.size());
+        }
+    }
+
+    // Process and cache skinner and skeletal data needed for skeletal animation
+    // and skinner geometry to be set later on our nodes.
+    if (!processSkinner(model)) {
+        perr("Error when processing the skinner of GLTF model!");
+        return nullptr;
+    }
+
+    // Now generate our KeyFrame and skeletal animations and cache them to be
+    // set later on our nodes (when we iterate through the scene hierarchy).
+    if (!processAnimations(model)) {
+        pwarn("Error when processing animation data of the GLTF model!");
+        return nullptr;
+    }
+
+    // Decode the model's images in parallel; progressive loads decode them later,
+    // while streaming
+    if (!_progressive) {
+        decodeImages(model);
+    }
+
+    // Finally, iterate through gLTF model data and build out our VRONodes that
+    // represent our 3D Model scene, setting cached animations / skinners on
+    // those nodes along the way.
+    std::shared_ptr<VRONode> gltfRootNode = makeUnrestricted<VRONode>();
+    for (const tinygltf::Scene &gScene : model.scenes) {
+        if (!processScene(model, gltfRootNode, gScene, driver)) {
+            return nullptr;
+        }
+    }
+    _decodedImages.clear();
+    
+    if (!_tangentJobs.empty()) {
+        if (!VROTangentGenerator::generate(_tangentJobs)) {
+            pwarn("Unable to generate tangents for this model");
+        }
+        _tangentJobs.clear();
+    }
+
+    if (_geometryCache && !_geometryCacheHit) {
+        _geometryCache->storeMeshes(_geometryCacheKey, _cachedMeshes);
+    }
+    _cachedMeshes.clear();
+
+    for (auto &skeletonPair : _skinIndexToSkeleton) {
+        std::shared_ptr<VROSkinner> skin = _skinMap[skeletonPair.first];
+        skeletonPair.second->setSkinnerRootNode(skin->getSkinnerNode());
+    }
+
+    if (_progressive) {
+        prioritizeTextures(gltfRootNode);
+    }
+    return gltfRootNode;
+}
+
+void VROGLTFLoader::restoreThreadRestrictions() {
+    for (std::shared_ptr<VROThreadRestricted> &object : _unrestrictedObjects) {
+        object->setThreadRestrictionEnabled(true);
+    }
+    _unrestrictedObjects.clear();
+}
+
+#pragma mark - Compressed Geometry
+
+static const std::string kMeshoptExtension = "EXT_meshopt_compression";
+static const std::string kDracoExtension = "KHR_draco_mesh_compression";
+
+static double getExtensionNumber(const tinygltf::Value &extension, const std::string &key, double defaultValue) {
+    if (!extension.Has(key)) {
+        return defaultValue;
+    }
+    const tinygltf::Value &value = extension.Get(key);
+    if (value.IsInt()) {
+        return value.Get<int>();
+    } else if (value.IsNumber()) {
+        return value.Get<double>();
+    }
+    return defaultValue;
+}
+
+static std::string getExtensionString(const tinygltf::Value &extension, const std::string &key,
+                                      const std::string &defaultValue) {
+    if (!extension.Has(key) || !extension.Get(key).IsString()) {
+        return defaultValue;
+    }
+    return extension.Get(key).Get<std::string>();
+}
+
+bool VROGLTFLoader::requiresUnsupportedExtension(const tinygltf::Model &gModel) {
+    // Other extensions degrade gracefully when ignored, but geometry compressed with
+    // Draco has no uncompressed fallback when the extension is required
+    for (const std::string &extension : gModel.extensionsRequired) {
+        if (extension == kDracoExtension) {
+            perr("GLTF model requires unsupported extension %s", extension.c_str());
+            return true;
+        }
+    }
+    return false;
+}
+
+bool VROGLTFLoader::decodeCompressedBufferViews(const tinygltf::Model &gModel) {
+    for (int i = 0; i < gModel.bufferViews.size(); i++) {
+        const tinygltf::BufferView &gBufferView = gModel.bufferViews[i];
+        auto it = gBufferView.extensions.find(kMeshoptExtension);
+        if (it == gBufferView.extensions.end()) {
+            continue;
+        }
+
+        // The extension points to the compressed data; the bufferView itself refers to a
+        // fallback buffer that only reserves space for the decoded data
+        const tinygltf::Value &extension = it->second;
+        int bufferIndex = (int) getExtensionNumber(extension, "buffer", -1);
+        size_t byteOffset = (size_t) getExtensionNumber(extension, "byteOffset", 0);
+        size_t byteLength = (size_t) getExtensionNumber(extension, "byteLength", 0);
+        size_t byteStride = (size_t) getExtensionNumber(extension, "byteStride", 0);
+        size_t count = (size_t) getExtensionNumber(extension, "count", 0);
+        std::string modeName = getExtensionString(extension, "mode", "");
+        std::string filterName = getExtensionString(extension, "filter", "NONE");
+
+        if (bufferIndex < 0 || bufferIndex >= gModel.buffers.size() ||
+            byteOffset + byteLength > gModel.buffers[bufferIndex].data.size()) {
+            perr("Invalid compressed data range for bufferView %d", i);
+            return false;
+        }
+
+        VROMeshoptMode mode;
+        if (modeName == "ATTRIBUTES") {
+            mode = VROMeshoptMode::Attributes;
+        } else if (modeName == "TRIANGLES") {
+            mode = VROMeshoptMode::Triangles;
+        } else if (modeName == "INDICES") {
+            mode = VROMeshoptMode::Indices;
+        } else {
+            perr("Unsupported meshopt compression mode %s for bufferView %d", modeName.c_str(), i);
+            return false;
+        }
+
+        VROMeshoptFilter filter;
+        if (filterName == "NONE") {
+            filter = VROMeshoptFilter::None;
+        } else if (filterName == "OCTAHEDRAL") {
+            filter = VROMeshoptFilter::Octahedral;
+        } else if (filterName == "QUATERNION") {
+            filter = VROMeshoptFilter::Quaternion;
+        } else if (filterName == "EXPONENTIAL") {
+            filter = VROMeshoptFilter::Exponential;
+        } else {
+            perr("Unsupported meshopt compression filter %s for bufferView %d", filterName.c_str(), i);
+            return false;
+        }
+
+        // Decode straight into the data that will back the bufferView's vertex buffer
+        // or geometry element
+        size_t decodedLength = count * byteStride;
+        if (decodedLength == 0 || decodedLength < gBufferView.byteLength) {
+            perr("Invalid decoded size for compressed bufferView %d", i);
+            return false;
+        }
+        void *decoded = malloc(decodedLength);
+        const unsigned char *source = gModel.buffers[bufferIndex].data.data() + byteOffset;
+        if (!VROMeshoptDecoder::decode(mode, filter, decoded, count, byteStride, source, byteLength)) {
+            perr("Failed to decode compressed bufferView %d", i);
+            free(decoded);
+            return false;
+        }
+        _decodedBufferViews[i] = std::make_shared<VROData>(decoded, decodedLength, VRODataOwnership::Move);
+    }
+    return true;
+}
+
+uint64_t VROGLTFLoader::hashMeshData(const tinygltf::Model &gModel) const {
+    uint64_t h = VROGeometryCache::hash(&kGLTFGeometryCacheVersion, sizeof(kGLTFGeometryCacheVersion));
+    auto hashInt = [&h](int64_t value) {
+        h = VROGeometryCache::hash(&value, sizeof(value), h);
+    };
+    hashInt(_optimizeGeometry);
+
+    // The geometry of each mesh depends on its primitives, the accessors they
+    // reference, and the contents of the (decoded) bufferViews behind those
+    std::set<int> accessors;
+    for (const tinygltf::Mesh &gMesh : gModel.meshes) {
+        hashInt(gMesh.primitives.size());
+        for (const tinygltf::Primitive &gPrimitive : gMesh.primitives) {
+            hashInt(gPrimitive.mode);
+            hashInt(gPrimitive.indices);
+            accessors.insert(gPrimitive.indices);
+            for (auto const &gAttribute : gPrimitive.attributes) {
+                h = VROGeometryCache::hash(gAttribute.first.data(), gAttribute.first.size(), h);
+                hashInt(gAttribute.second);
+                accessors.insert(gAttribute.second);
+            }
+        }
+    }
+
+    std::set<int> bufferViews;
+    for (int accessorIndex : accessors) {
+        if (accessorIndex < 0 || accessorIndex >= gModel.accessors.size()) {
+            continue;
+        }
+        const tinygltf::Accessor &gAccessor = gModel.accessors[accessorIndex];
+        hashInt(accessorIndex);
+        hashInt(gAccessor.bufferView);
+        hashInt(gAccessor.byteOffset);
+        hashInt(gAccessor.componentType);
+        hashInt(gAccessor.count);
+        hashInt(gAccessor.type);
+        hashInt(gAccessor.normalized);
+        bufferViews.insert(gAccessor.bufferView);
+    }
+
+    for (int bufferViewIndex : bufferViews) {
+        if (bufferViewIndex < 0 || bufferViewIndex >= gModel.bufferViews.size()) {
+            continue;
+        }
+        const tinygltf::BufferView &gBufferView = gModel.bufferViews[bufferViewIndex];
+        hashInt(bufferViewIndex);
+        hashInt(gBufferView.byteStride);
+
+        auto decoded = _decodedBufferViews.find(bufferViewIndex);
+        if (decoded != _decodedBufferViews.end()) {
+            h = VROGeometryCache::hash(decoded->second->getData(), decoded->second->getDataLength(), h);
+        } else if (gBufferView.buffer >= 0 && gBufferView.buffer < gModel.buffers.size()) {
+            const std::vector<unsigned char> &data = gModel.buffers[gBufferView.buffer].data;
+            if (gBufferView.byteOffset <= data.size() && gBufferView.byteLength <= data.size() - gBufferView.byteOffset) {
+                h = VROGeometryCache::hash(data.data() + gBufferView.byteOffset, gBufferView.byteLength, h);
+            }
+        }
+    }
+    return h;
+}
+
+const unsigned char *VROGLTFLoader::getBufferViewData(const tinygltf::Model &gModel, int bufferViewIndex) const {
+    auto it = _decodedBufferViews.find(bufferViewIndex);
+    if (it != _decodedBufferViews.end()) {
+        return (const unsigned char *) it->second->getData();
+    }
+
+    const tinygltf::BufferView &gBufferView = gModel.bufferViews[bufferViewIndex];
+    return gModel.buffers[gBufferView.buffer].data.data() + gBufferView.byteOffset;
 }
 
 bool VROGLTFLoader::processSkinner(const tinygltf::Model &model) {
@@ -670,7 +929,7 @@ bool VROGLTFLoader::processRawChannelData(const tinygltf::Model &gModel,
 
     // Determine offsets and data sizes representing the 'window of data' in the buffer
     size_t elementCount = gDataAcessor.count;
-    size_t dataOffset = gDataAcessor.byteOffset + gIndiceBufferView.byteOffset;
+    size_t dataOffset = gDataAcessor.byteOffset;
     size_t dataLength = elementCount * bufferViewStride;
 
     if (VROStringUtil::strcmpinsensitive(channelProperty, kVROGLTFInputSamplerKey)) {
@@ -695,10 +954,10 @@ bool VROGLTFLoader::processRawChannelData(const tinygltf::Model &gModel,
     }
 
     // Now process that buffer to produce the right output data.
-    const tinygltf::Buffer &gBuffer = gModel.buffers[gIndiceBufferView.buffer];
+    const unsigned char *bufferViewData = getBufferViewData(gModel, gDataAcessor.bufferView);
     std::vector<float> tempVec;
     int morphIndex = 0;
-    VROByteBuffer buffer((char *)gBuffer.data.data() + dataOffset, dataLength, false);
+    VROByteBuffer buffer((char *) bufferViewData + dataOffset, dataLength, false);
     for (int elementIndex = 0; elementIndex < elementCount; elementIndex++) {
 
         // Set the buffer position to begin at each element index - Ex: Each Vec4.
@@ -1072,8 +1331,15 @@ bool VROGLTFLoader::processSkeletalTransformsForFrame(const tinygltf::Model &gMo
 void VROGLTFLoader::injectGLTF(std::shared_ptr<VRONode> gltfNode,
                              std::shared_ptr<VRONode> rootNode,
                              std::shared_ptr<VRODriver> driver,
-                             std::function<void(std::shared_ptr<VRONode> node, bool success)> onFinish) {
+                             std::function<void(std::shared_ptr<VRONode> node, bool success)> onFinish,
+                             bool progressive) {
     if (gltfNode) {
+        // Progressive models bind their textures to specific materials as the textures
+        // arrive, so only fully loaded models can share materials
+        if (!progressive) {
+            VROModelIOUtil::deduplicateMaterials(gltfNode);
+        }
+
         // The top-level glTF Node is a dummy; all of the data is stored in the children, so we
         // simply transfer those children over to the destination node
         for (std::shared_ptr<VRONode> child : gltfNode->getChildNodes()) {
@@ -1085,6 +1351,14 @@ void VROGLTFLoader::injectGLTF(std::shared_ptr<VRONode> gltfNode,
         rootNode->recomputeUmbrellaBoundingBox();
         rootNode->syncAppThreadProperties();
         rootNode->setIgnoreEventHandling(rootNode->getIgnoreEventHandling());
+
+        // Progressive models render immediately; their textures are bound as they arrive
+        if (progressive) {
+            if (onFinish) {
+                onFinish(rootNode, true);
+            }
+            return;
+        }
         rootNode->setHoldRendering(true);
 
         // Don't hold a strong reference to the Node: hydrateAsync stores its callback (and
@@ -1112,7 +1386,7 @@ void VROGLTFLoader::injectGLTF(std::shared_ptr<VRONode> gltfNode,
 
 bool VROGLTFLoader::processScene(const tinygltf::Model &gModel, std::shared_ptr<VRONode> rootNode, const tinygltf::Scene &gScene,
                                  std::shared_ptr<VRODriver> driver) {
-    std::shared_ptr<VRONode> sceneNode = std::make_shared<VRONode>();
+    std::shared_ptr<VRONode> sceneNode = makeUnrestricted<VRONode>();
     sceneNode->setName(gScene.name);
 
     std::vector<int> gNodeIndexes = gScene.nodes;
@@ -1153,7 +1427,7 @@ bool VROGLTFLoader::processNode(const tinygltf::Model &gModel, std::shared_ptr<V
     }
 
     // Finally set the parsed transforms on VRONode.
-    std::shared_ptr<VRONode> node = std::make_shared<VRONode>();
+    std::shared_ptr<VRONode> node = makeUnrestricted<VRONode>();
     node->setPosition(pos);
     node->setScale(scale);
     node->setRotation(rot);
@@ -1162,7 +1436,8 @@ bool VROGLTFLoader::processNode(const tinygltf::Model &gModel, std::shared_ptr<V
     // Process the Geometry for this node, if any.
     // Fail fast if we have failed to process the node's mesh.
     int meshIndex = gNode.mesh;
-    if (meshIndex >= 0 && !processMesh(gModel, node, gModel.meshes[meshIndex], driver)) {
+    if (meshIndex >= 0 && (!processMesh(gModel, node, meshIndex, driver) ||
+                           !processLODs(gModel, gNode, node, driver))) {
         return false;
     }
 
@@ -1172,8 +1447,9 @@ bool VROGLTFLoader::processNode(const tinygltf::Model &gModel, std::shared_ptr<V
         _skinMap[gNode.skin]->setSkinnerNode(node);
         geom->setSkinner(_skinMap[gNode.skin]);
         for (const std::shared_ptr<VROMaterial> &material : geom->getMaterials()) {
-            material->addShaderModifier(VROBoneUBO::createSkinningShaderModifier(false));
+            material->addShaderModifier(VROBoneUBO::createSkinningShaderModifier());
         }
+        VROGeometryUtilSplitNodeByBoneLimit(node, VROBoneUBO::getMaxBones(VROSkinningMode::Matrix));
     }
 
     // Set the animations on this node, if any.
@@ -1206,6 +1482,72 @@ bool VROGLTFLoader::processNode(const tinygltf::Model &gModel, std::shared_ptr<V
     return true;
 }
 
+static const std::string kLODExtension = "MSFT_lod";
+
+bool VROGLTFLoader::processLODs(const tinygltf::Model &gModel, const tinygltf::Node &gNode,
+                                std::shared_ptr<VRONode> &node, std::shared_ptr<VRODriver> driver) {
+    // Skinned and morphed geometry deforms its vertices, which its LODs would not follow
+    std::shared_ptr<VROGeometry> geometry = node->getGeometry();
+    if (!geometry || gNode.skin >= 0 || geometry->hasMorphers()) {
+        return true;
+    }
+    std::vector<VROGeometryLOD> lods;
+    
+    auto it = gNode.extensions.find(kLODExtension);
+    if (it != gNode.extensions.end() && it->second.Has("ids") && it->second.Get("ids").IsArray()) {
+        const tinygltf::Value &ids = it->second.Get("ids");
+        
+        /*
+         MSFT_screencoverage gives, for the node and each of its LODs, the fraction
+         of the screen's area below which the next LOD takes over. LODs without a
+         coverage halve the coverage of the last.
+         */
+        tinygltf::Value coverages;
+        if (gNode.extras.Has("MSFT_screencoverage") && gNode.extras.Get("MSFT_screencoverage").IsArray()) {
+            coverages = gNode.extras.Get("MSFT_screencoverage");
+        }
+        
+        float coverage = 1.0f;
+        for (int i = 0; i < ids.ArrayLen(); i++) {
+            const tinygltf::Value &id = ids.Get(i);
+            int gLODNodeIndex = id.IsInt() ? id.Get<int>() : -1;
+            if (gLODNodeIndex < 0 || gLODNodeIndex >= gModel.nodes.size() || gModel.nodes[gLODNodeIndex].mesh < 0) {
+                pwarn("GLTF node %s has an invalid LOD", gNode.name.c_str());
+                break;
+            }
+            
+            coverage *= 0.5f;
+            if (i < coverages.ArrayLen()) {
+                const tinygltf::Value &value = coverages.Get(i);
+                if (value.IsNumber() || value.IsInt()) {
+                    coverage = sqrt(value.IsInt() ? value.Get<int>() : value.Get<double>());
+                }
+            }
+            
+            // LODs are rendered with the node's materials, so they must have its elements
+            std::shared_ptr<VRONode> lodNode = makeUnrestricted<VRONode>();
+            if (!processMesh(gModel, lodNode, gModel.nodes[gLODNodeIndex].mesh, driver)) {
+                return false;
+            }
+            std::shared_ptr<VROGeometry> lodGeometry = lodNode->getGeometry();
+            if (lodGeometry->getGeometryElements().size() != geometry->getGeometryElements().size()) {
+                pwarn("GLTF node %s has a LOD with a different number of primitives, ignoring", gNode.name.c_str());
+                break;
+            }
+            lods.push_back({ lodGeometry, coverage });
+        }
+    }
+    else if (_optimizeGeometry) {
+        // glTF vertex buffers are shared between primitives, so the LODs share them too
+        for (VROMeshLOD &lod : VROMeshOptimizer::generateLODs(geometry->getGeometrySources(),
+                                                              geometry->getGeometryElements(), false)) {
+            lods.push_back({ std::make_shared<VROGeometry>(lod.sources, lod.elements), lod.screenCoverage });
+        }
+    }
+    geometry->setLODs(lods);
+    return true;
+}
+
 bool VROGLTFLoader::processSkinnerInverseBindData(const tinygltf::Model &gModel,
                                                   const tinygltf::Skin &skin,
                                                   std::vector<VROMatrix4f> &invBindTransformsOut) {
@@ -1228,13 +1570,13 @@ bool VROGLTFLoader::processSkinnerInverseBindData(const tinygltf::Model &gModel,
 
     // Determine offsets and data sizes representing the 'window of data' in the buffer
     size_t elementCount = gDataAcessor.count;
-    size_t dataOffset = gDataAcessor.byteOffset + gIndiceBufferView.byteOffset;
+    size_t dataOffset = gDataAcessor.byteOffset;
     size_t dataLength = elementCount * bufferViewStride;
 
     // Now process that buffer to produce the right output data.
-    const tinygltf::Buffer &gBuffer = gModel.buffers[gIndiceBufferView.buffer];
+    const unsigned char *bufferViewData = getBufferViewData(gModel, gDataAcessor.bufferView);
     std::vector<VROMatrix4f> invBindTransforms;
-    VROByteBuffer buffer((char *)gBuffer.data.data() + dataOffset, dataLength, false);
+    VROByteBuffer buffer((char *) bufferViewData + dataOffset, dataLength, false);
     for (int elementIndex = 0; elementIndex < elementCount; elementIndex++) {
 
         // Set the buffer position to begin at each element index - Ex: Each Mat4.
@@ -1259,8 +1601,9 @@ bool VROGLTFLoader::processSkinnerInverseBindData(const tinygltf::Model &gModel,
     return true;
 }
 
-bool VROGLTFLoader::processMesh(const tinygltf::Model &gModel, std::shared_ptr<VRONode> &rootNode, const tinygltf::Mesh &gMesh,
+bool VROGLTFLoader::processMesh(const tinygltf::Model &gModel, std::shared_ptr<VRONode> &rootNode, int gMeshIndex,
                                 std::shared_ptr<VRODriver> driver) {
+    const tinygltf::Mesh &gMesh = gModel.meshes[gMeshIndex];
     if (gMesh.primitives.size() <=0) {
         perr("GTLF requires mesh data to contain at least one primitive!");
         return false;
@@ -1272,18 +1615,34 @@ bool VROGLTFLoader::processMesh(const tinygltf::Model &gModel, std::shared_ptr<V
     std::vector<std::shared_ptr<VROMaterial>> materials;
     std::map<int, std::shared_ptr<VROMorpher>> morphers;
 
+    // Use the cached geometry of this mesh if it matches the mesh; otherwise the
+    // geometry is processed below, and recorded for the cache if none is recorded yet.
+    const VROCachedMesh *cachedMesh = nullptr;
+    bool recordMesh = false;
+    if (_geometryCache && gMeshIndex < _cachedMeshes.size()) {
+        if (_geometryCacheHit && _cachedMeshes[gMeshIndex].elements.size() == gMesh.primitives.size()) {
+            cachedMesh = &_cachedMeshes[gMeshIndex];
+        } else {
+            recordMesh = !_geometryCacheHit && _cachedMeshes[gMeshIndex].elements.empty();
+        }
+    }
+
     // A single mesh may contain more than one type of primitive type to be drawn. Cycle through them here.
     const std::vector<tinygltf::Primitive> &gPrimitives = gMesh.primitives;
     for (tinygltf::Primitive gPrimitive : gPrimitives) {
 
-        // Grab vertex indexing information needed for creating meshes.
-        bool successVertex = processVertexElement(gModel, gPrimitive, elements);
-        bool successAttributes = processVertexAttributes(gModel, gPrimitive.attributes, sources, elements.size() - 1, driver);
-        processTangent(elements, sources, elements.size() - 1);
-        
-        if (!successVertex || !successAttributes) {
-            pwarn("Failed to process mesh %s.", gMesh.name.c_str());
-            return false;
+        if (cachedMesh) {
+            VROGeometryCache::instantiateElement(*cachedMesh, (int) elements.size(), sources, elements);
+        } else {
+            // Grab vertex indexing information needed for creating meshes.
+            bool successVertex = processVertexElement(gModel, gPrimitive, elements);
+            bool successAttributes = processVertexAttributes(gModel, gPrimitive.attributes, sources, elements.size() - 1, driver);
+            processTangent(elements, sources, elements.size() - 1);
+
+            if (!successVertex || !successAttributes) {
+                pwarn("Failed to process mesh %s.", gMesh.name.c_str());
+                return false;
+            }
         }
 
         // Grab the material pertaining to this primitive in this mesh.
@@ -1305,9 +1664,25 @@ bool VROGLTFLoader::processMesh(const tinygltf::Model &gModel, std::shared_ptr<V
         }
     }
 
+    /*
+     Optimize the triangle order of newly processed geometry before it is recorded.
+     glTF vertices live in vertex buffers shared between primitives, so they are
+     never reordered here.
+     */
+    if (_optimizeGeometry && !cachedMesh) {
+        VROMeshOptimizer::optimize(sources, elements, false);
+    }
+
+    // Morph targets are not part of the recorded geometry: they are processed from the
+    // model on every load.
+    if (recordMesh) {
+        _cachedMeshes[gMeshIndex].sources = sources;
+        _cachedMeshes[gMeshIndex].elements = elements;
+    }
+
     // Apply a default material if none has been specified.
     if (materials.size() == 0) {
-        materials.push_back(std::make_shared<VROMaterial>());
+        materials.push_back(makeUnrestricted<VROMaterial>());
     }
 
     // Finally construct our geometry with the processed vertex and attribute data.
@@ -1357,51 +1732,20 @@ void VROGLTFLoader::processTangent(std::vector<std::shared_ptr<VROGeometryElemen
         return;
     }
 
-    std::vector<VROVector3f> posArray;
-    pos->processVertices([&posArray](int index, VROVector4f vertex) {
-        posArray.push_back(VROVector3f(vertex.x, vertex.y, vertex.z));
-    });
-
-    std::vector<VROVector3f> normArray;
-    normal->processVertices([&normArray](int index, VROVector4f vertex) {
-        normArray.push_back(VROVector3f(vertex.x, vertex.y, vertex.z));
-    });
-
-    std::vector<VROVector3f> texCoordArray;
-    texcoord->processVertices([&texCoordArray](int index, VROVector4f vertex) {
-        texCoordArray.push_back(VROVector3f(vertex.x, vertex.y, vertex.z));
-    });
-
-    std::vector<int> elementIndicesArray;
-    std::shared_ptr<VROGeometryElement> targetedElement = elements[geoElementIndex];
-    targetedElement->processIndices([&elementIndicesArray](int index, int indexRead) {
-        elementIndicesArray.push_back(indexRead);
-    });
-
-    // Generate the tangents for this model given the attributes for this element index.
-    std::vector<VROVector4f> generatedTangents;
-    regenerateTangent(posArray, normArray, texCoordArray, elementIndicesArray, generatedTangents);
-    if (generatedTangents.size() <= 0) {
-        pwarn("Unable to generate tangents for this model");
+    if (normal->getVertexCount() != pos->getVertexCount() || texcoord->getVertexCount() != pos->getVertexCount()) {
+        pwarn("Unable to generate missing tangents for this model - vertex count does not match.");
         return;
     }
 
-    // Finally store the data back into a Tangent geometry source.
-    int sizeOfTangent = 4;
+    // Store the tangents in a new Tangent geometry source. They are written
+    // directly into its data once the whole model is processed.
     int vertexSize = pos->getVertexCount();
-    float *dataOut = new float[vertexSize * sizeOfTangent];
-    for (int i = 0; i < vertexSize; i ++ ) {
-        dataOut[(i * sizeOfTangent)]     = generatedTangents[i].x;
-        dataOut[(i * sizeOfTangent) + 1] = generatedTangents[i].y;
-        dataOut[(i * sizeOfTangent) + 2] = generatedTangents[i].z;
-        dataOut[(i * sizeOfTangent) + 3] = generatedTangents[i].w;        
-    }
-
     int sizeOfSingleTangent = getTypeSize(GLTFType::Vec4) * getComponentTypeSize(GLTFTypeComponent::Float);
-    std::shared_ptr<VROData> indexData = std::make_shared<VROData>((void *) dataOut,
+    float *dataOut = new float[vertexSize * 4]();
+    std::shared_ptr<VROData> tangentData = std::make_shared<VROData>((void *) dataOut,
                                         vertexSize * sizeOfSingleTangent,
                                         VRODataOwnership::Move);
-    tangent = std::make_shared<VROGeometrySource>(indexData,
+    tangent = std::make_shared<VROGeometrySource>(tangentData,
                                         VROGeometrySourceSemantic::Tangent,
                                         vertexSize,
                                         true,
@@ -1411,108 +1755,8 @@ void VROGLTFLoader::processTangent(std::vector<std::shared_ptr<VROGeometryElemen
                                         sizeOfSingleTangent);
     tangent->setGeometryElementIndex((int) geoElementIndex);
     sources.push_back(tangent);
-    return;
-}
-
-void VROGLTFLoader::regenerateTangent(std::vector<VROVector3f> &posArray,
-                                      std::vector<VROVector3f> &normArray,
-                                      std::vector<VROVector3f> &texCoordArray,
-                                      std::vector<int> &elementIndicesArray,
-                                      std::vector<VROVector4f> &generatedTangents) {
-    int vertexSize = (int) posArray.size();
-    // Sanity check.
-    if (normArray.size() != vertexSize
-        || texCoordArray.size() != vertexSize) {
-        pwarn("Unable to missing generate tangents for this model - vertex count does not match.");
-        return;
-    }
-
-    VROVector3f *tan1 = new VROVector3f[vertexSize * 2];
-    VROVector3f *tan2 = tan1 + vertexSize;
-
-    // For each triangle, compute the tangent and bitangent
-    for (size_t i = 0; i < elementIndicesArray.size(); i += 3) {
-        int i1 = elementIndicesArray[i + 0];
-        int i2 = elementIndicesArray[i + 1];
-        int i3 = elementIndicesArray[i + 2];
-
-        VROVector3f &var1 = posArray[i1];
-        VROVector3f &var2 = posArray[i2];
-        VROVector3f &var3 = posArray[i3];
-
-        VROVector3f v1(var1.x, var1.y, var1.z);
-        VROVector3f v2(var2.x, var2.y, var2.z);
-        VROVector3f v3(var3.x, var3.y, var3.z);
-
-        VROVector3f &texcoord1 = texCoordArray[i1];
-        VROVector3f &texcoord2 = texCoordArray[i2];
-        VROVector3f &texcoord3 = texCoordArray[i3];
-
-        VROVector3f w1(texcoord1.x, texcoord1.y, 0);
-        VROVector3f w2(texcoord2.x, texcoord2.y, 0);
-        VROVector3f w3(texcoord3.x, texcoord3.y, 0);
-
-        float x1 = v2.x - v1.x;
-        float x2 = v3.x - v1.x;
-        float y1 = v2.y - v1.y;
-        float y2 = v3.y - v1.y;
-        float z1 = v2.z - v1.z;
-        float z2 = v3.z - v1.z;
-
-        float s1 = w2.x - w1.x;
-        float s2 = w3.x - w1.x;
-        float t1 = w2.y - w1.y;
-        float t2 = w3.y - w1.y;
 
-        float r = 1.0f / (s1 * t2 - s2 * t1);
-        VROVector3f sdir((t2 * x1 - t1 * x2) * r, (t2 * y1 - t1 * y2) * r, (t2 * z1 - t1 * z2) * r);
-        VROVector3f tdir((s1 * x2 - s2 * x1) * r, (s1 * y2 - s2 * y1) * r, (s1 * z2 - s2 * z1) * r);
-
-        // ADD the tangent to the existing value; this way we average across all triangles
-        // that share this vertex. Note we do not normalize, and that is intentional: we
-        // want larger triangles to have a bigger "impact" than smaller triangles
-        tan1[i1] += sdir;
-        tan1[i2] += sdir;
-        tan1[i3] += sdir;
-
-        tan2[i1] += tdir;
-        tan2[i2] += tdir;
-        tan2[i3] += tdir;
-    }
-
-    VROVector3f *tan3 = tan1 + vertexSize;
-    for (size_t i = 0; i < vertexSize; i++) {
-        VROVector3f n = { normArray[i].x, normArray[i].y, normArray[i].z };
-        VROVector3f t = tan1[i];
-
-        // Gram-Schmidt orthogonalize
-        VROVector3f tangent = (t - n * n.dot(t)).normalize();
-
-        // Calculate handedness
-        float handedness = (n.cross(t).dot(tan3[i]) < 0.0F) ? -1.0F : 1.0F;
-
-        // Ensure that tangent is valid before saving it.
-        float magnitude = tangent.magnitude();
-        if (!isnan(magnitude) && !isinf(magnitude)) {
-            generatedTangents.push_back({tangent.x, tangent.y, tangent.z, handedness});
-            continue;
-        }
-
-        // Else, generate a default tangent with perpendicular assumptions.
-        VROVector3f c1 = n.cross(VROVector3f(0,0,1));
-        VROVector3f c2 = n.cross(VROVector3f(0,1,0));
-        VROVector3f tangent2;
-        if (c1.magnitude() > c2.magnitude()) {
-            tangent2 = c1;
-        } else {
-            tangent2 = c2;
-        }
-
-        tangent = tangent.normalize();
-        generatedTangents.push_back({tangent2.x, tangent2.y, tangent2.z, -1.0});
-    }
-
-    delete[] tan1;
+    _tangentJobs.push_back({ pos, normal, texcoord, elements[geoElementIndex], tangentData, 0, sizeOfSingleTangent });
 }
 
 bool VROGLTFLoader::processVertexElement(const tinygltf::Model &gModel,
@@ -1541,6 +1785,10 @@ bool VROGLTFLoader::processVertexElement(const tinygltf::Model &gModel,
     if (!getComponentType(gIndicesAccessor, gTypeComponent) || !getComponent(gIndicesAccessor, gType)) {
         return false;
     }
+    if (gIndicesAccessor.bufferView < 0) {
+        perr("GLTF vertex indices without a bufferView (e.g. Draco compressed) are not supported");
+        return false;
+    }
 
     // Warn here if the indexed vertex data is NOT of the proper type expected by GLTF for vertex indexing.
     if (gType != GLTFType::Scalar
@@ -1563,14 +1811,20 @@ bool VROGLTFLoader::processVertexElement(const tinygltf::Model &gModel,
     // Determine offsets and data sizes representing the indexed vertices's 'window of data' in the buffer
     int primitiveCount = VROGeometryUtilGetPrimitiveCount((int) gIndicesAccessor.count, primitiveType);
     size_t elementCount = gIndicesAccessor.count;
-    size_t dataOffset = gIndicesAccessor.byteOffset + gIndiceBufferView.byteOffset;
+    size_t dataOffset = gIndicesAccessor.byteOffset;
     size_t dataLength = elementCount *  bufferViewStride;
 
-    // Finally, grab the raw indexed vertex data from the buffer to be created with VROGeometryElement
-    const tinygltf::Buffer &gBuffer = gModel.buffers[gIndiceBufferView.buffer];
-    std::shared_ptr<VROData> data = std::make_shared<VROData>((void *)gBuffer.data.data(),
-                                                              dataLength,
-                                                              dataOffset);
+    // Finally, grab the raw indexed vertex data from the buffer to be created with VROGeometryElement.
+    // Decoded indices that span their entire bufferView are used as is, and otherwise sliced.
+    std::shared_ptr<VROData> data;
+    auto decoded = _decodedBufferViews.find(gIndicesAccessor.bufferView);
+    if (decoded != _decodedBufferViews.end() && dataOffset == 0 && (size_t) decoded->second->getDataLength() == dataLength) {
+        data = decoded->second;
+    } else if (decoded != _decodedBufferViews.end()) {
+        data = std::make_shared<VROData>(decoded->second, (int) dataOffset, (int) dataLength);
+    } else {
+        data = getBufferSlice(gModel, gIndiceBufferView.buffer, gIndiceBufferView.byteOffset + dataOffset, dataLength);
+    }
     std::shared_ptr<VROGeometryElement> element
             = std::make_shared<VROGeometryElement>(data,
                                                    primitiveType,
@@ -1610,6 +1864,10 @@ bool VROGLTFLoader::processVertexAttributes(const tinygltf::Model &gModel,
         if (!getComponentType(gAttributeAccesor, gTypeComponent) || !getComponent(gAttributeAccesor, gType)) {
             return false;
         }
+        if (gAttributeAccesor.bufferView < 0) {
+            perr("GLTF attribute %s without a bufferView (e.g. Draco compressed) is not supported", attributeName.c_str());
+            return false;
+        }
         
         // Determine the offsets and data sizes representing the 'window of data' for this attribute in the buffer
         const tinygltf::BufferView gIndiceBufferView = gModel.bufferViews[gAttributeAccesor.bufferView];
@@ -1627,8 +1885,13 @@ bool VROGLTFLoader::processVertexAttributes(const tinygltf::Model &gModel,
             
             auto it = VROGLTFLoader::_dataCache.find(key);
             if (it == VROGLTFLoader::_dataCache.end()) {
-                const tinygltf::Buffer &gbuffer = gModel.buffers[gIndiceBufferView.buffer];
-                vbo = driver->newVertexBuffer(std::make_shared<VROData>((void *) gbuffer.data.data(), bufferViewTotalSize, bufferViewOffset));
+                // Decoded bufferViews already have their own data, which the VBO shares
+                auto decoded = _decodedBufferViews.find(gAttributeAccesor.bufferView);
+                if (decoded != _decodedBufferViews.end()) {
+                    vbo = driver->newVertexBuffer(decoded->second);
+                } else {
+                    vbo = driver->newVertexBuffer(getBufferSlice(gModel, gIndiceBufferView.buffer, bufferViewOffset, bufferViewTotalSize));
+                }
                 VROGLTFLoader::_dataCache[key] = vbo;
             } else {
                 vbo = it->second;
@@ -1636,8 +1899,8 @@ bool VROGLTFLoader::processVertexAttributes(const tinygltf::Model &gModel,
             source = buildGeometrySource(attributeType, gType, gTypeComponent, gAttributeAccesor, gIndiceBufferView, vbo);
             
         } else {
-            const tinygltf::Buffer &gBuffer = gModel.buffers[gIndiceBufferView.buffer];
-            source = buildBoneWeightSource(gType, gTypeComponent, gAttributeAccesor, gIndiceBufferView, gBuffer);
+            source = buildBoneWeightSource(gType, gTypeComponent, gAttributeAccesor, gIndiceBufferView,
+                                           getBufferViewData(gModel, gAttributeAccesor.bufferView));
         }
 
         // Because GLTF can have VROGeometryElements that corresponds to different sets of VROGeometrySources,
@@ -1774,9 +2037,8 @@ std::shared_ptr<VROGeometrySource> VROGLTFLoader::buildBoneWeightSource(GLTFType
                                                                         GLTFTypeComponent gTypeComponent,
                                                                         const tinygltf::Accessor &gAttributeAccesor,
                                                                         const tinygltf::BufferView &gIndiceBufferView,
-                                                                        const tinygltf::Buffer &gbuffer) {
+                                                                        const unsigned char *bufferViewData) {
     bool isFloat = gTypeComponent == GLTFTypeComponent::Float;
-    size_t bufferViewOffset = gIndiceBufferView.byteOffset;
     size_t bufferViewTotalSize = gIndiceBufferView.byteLength;
     
     // Calculate the byte stride size if none is provided from the BufferView.
@@ -1788,7 +2050,7 @@ std::shared_ptr<VROGeometrySource> VROGLTFLoader::buildBoneWeightSource(GLTFType
     
     // gLTF requires the manual normalization of weighted bone attributes. As such,
     // we process them here before constructing our VROGeometrySource.
-    VROByteBuffer buffer((char *) gbuffer.data.data() + bufferViewOffset, bufferViewTotalSize, false);
+    VROByteBuffer buffer((char *) bufferViewData, bufferViewTotalSize, false);
     
     // Parse the gLTF buffers for the weight of each bone and normalize them.
     // The normalized data is stored in dataOut.
@@ -1842,23 +2104,17 @@ std::shared_ptr<VROGeometrySource> VROGLTFLoader::buildBoneWeightSource(GLTFType
 }
 
 std::shared_ptr<VROMaterial> VROGLTFLoader::getMaterial(const tinygltf::Model &gModel, const tinygltf::Material &gMat) {
-    std::shared_ptr<VROMaterial> vroMat = std::make_shared<VROMaterial>();
+    std::shared_ptr<VROMaterial> vroMat = makeUnrestricted<VROMaterial>();
     tinygltf::ParameterMap gAdditionalMap = gMat.additionalValues;
 
     // Process PBR values from the given tinyGLTF material into our VROMaterial, if any.
     processPBR(gModel, vroMat, gMat);
 
     // Process Normal textures
-    std::shared_ptr<VROTexture> normalTexture = getTexture(gModel, gAdditionalMap, "normalTexture", false);
-    if (normalTexture != nullptr) {
-        vroMat->getNormal().setTexture(normalTexture);
-    }
+    processTexture(gModel, gAdditionalMap, "normalTexture", false, vroMat, { &vroMat->getNormal() });
 
     // Process Occlusion Textures
-    std::shared_ptr<VROTexture> occlusionTexture = getTexture(gModel, gAdditionalMap, "occlusionTexture", false);
-    if (occlusionTexture != nullptr) {
-        vroMat->getAmbientOcclusion().setTexture(occlusionTexture);
-    }
+    processTexture(gModel, gAdditionalMap, "occlusionTexture", false, vroMat, { &vroMat->getAmbientOcclusion() });
 
     // Process GLTF transparency modes
     std::string mode = "OPAQUE";
@@ -1911,21 +2167,15 @@ void VROGLTFLoader::processPBR(const tinygltf::Model &gModel, std::shared_ptr<VR
 
     // Process a metallic / roughness texture if any, where metalness values are sampled from the
     // B channel and roughness values are sampled from the G channel.
-    std::shared_ptr<VROTexture> metallicRoughnessTexture = getTexture(gModel, gPbrMap, "metallicRoughnessTexture", false);
-    if (metallicRoughnessTexture != nullptr) {
-        vroMat->getMetalness().setTexture(metallicRoughnessTexture);
-        vroMat->getRoughness().setTexture(metallicRoughnessTexture);
-    }
-    else {
+    // Deferred textures keep these colors as their placeholder.
+    if (!processTexture(gModel, gPbrMap, "metallicRoughnessTexture", false, vroMat,
+                        { &vroMat->getMetalness(), &vroMat->getRoughness() }) || _progressive) {
         vroMat->getMetalness().setColor({ (float) metallicFactor, 1.0, 1.0, 1.0 });
         vroMat->getRoughness().setColor({ (float) roughnessFactor, 1.0, 1.0, 1.0 });
     }
 
     // Grab the base color texture in sRGB space.
-    std::shared_ptr<VROTexture> baseColorTexture = getTexture(gModel, gPbrMap, "baseColorTexture", true);
-    if (baseColorTexture != nullptr) {
-        vroMat->getDiffuse().setTexture(baseColorTexture);
-    }
+    processTexture(gModel, gPbrMap, "baseColorTexture", true, vroMat, { &vroMat->getDiffuse() });
     vroMat->setLightingModel(VROLightingModel::PhysicallyBased);
 }
 
@@ -1946,6 +2196,26 @@ std::shared_ptr<VROTexture> VROGLTFLoader::getTexture(const tinygltf::Model &gMo
 
 std::shared_ptr<VROTexture> VROGLTFLoader::getTexture(const tinygltf::Model &gModel, const tinygltf::Texture &gTexture, bool srgb){
     std::shared_ptr<VROTexture> texture = nullptr;
+
+    // Prefer compressed KTX2 images, falling back to the source image if they can't be used
+    int ktx2Index = getKTX2Source(gTexture);
+    if (ktx2Index >= 0 && ktx2Index < gModel.images.size()) {
+        std::string key = VROStringUtil::toString(ktx2Index);
+        if (VROGLTFLoader::_textureCache.find(key) != VROGLTFLoader::_textureCache.end()) {
+            return VROGLTFLoader::_textureCache[key];
+        }
+
+        texture = loadKTX2Texture(gModel.images[ktx2Index], srgb);
+        if (texture) {
+            processSampler(gModel, gTexture, texture);
+            VROGLTFLoader::_textureCache[key] = texture;
+            return texture;
+        }
+        if (gTexture.source >= 0) {
+            pwarn("Using fallback image for KTX2 texture %s", gModel.images[ktx2Index].name.c_str());
+        }
+    }
+
     int imageIndex = gTexture.source;
     if (imageIndex < 0){
         perr("Attempted to grab an invalid GTLF texture source.");
@@ -1959,12 +2229,20 @@ std::shared_ptr<VROTexture> VROGLTFLoader::getTexture(const tinygltf::Model &gMo
     }
 
     // Grab the GLTF image data of for this texture.
-    tinygltf::Image gImg = gModel.images[imageIndex];
+    const tinygltf::Image &gImg = gModel.images[imageIndex];
     std::string imgName = gImg.name;
 
-    // Decode the GLTF image data / raw bytes into a VROImage data.
-    std::vector<unsigned char> data = gImg.rawByteVec;
-    std::shared_ptr<VROImage> image = VROPlatformLoadImageWithBufferedData(data, VROTextureInternalFormat::RGBA8);
+    // Decode the GLTF image data / raw bytes into a VROImage data, unless it was
+    // already decoded in parallel with the model's other images
+    std::shared_ptr<VROImage> image;
+    auto decoded = _decodedImages.find(imageIndex);
+    if (decoded != _decodedImages.end()) {
+        image = decoded->second;
+        _decodedImages.erase(decoded);
+    }
+    else {
+        image = VROPlatformLoadImageWithBufferedData(gImg.rawByteVec, VROTextureInternalFormat::RGBA8);
+    }
     if (image == nullptr){
         perr("Error when parsing texture for image %s.", imgName.c_str());
         return nullptr;
@@ -1972,6 +2250,51 @@ std::shared_ptr<VROTexture> VROGLTFLoader::getTexture(const tinygltf::Model &gMo
 
     // Use the VROImage data to create a VROTexture, with parsed GLTF Sampler properties.
     texture = std::make_shared<VROTexture>(srgb, VROMipmapMode::Runtime, image);
+    processSampler(gModel, gTexture, texture);
+    setStreamingSource(gImg, texture);
+
+    // Cache a copy of the created texture as other elements may also refer to it.
+    std::string key = VROStringUtil::toString(imageIndex);
+    VROGLTFLoader::_textureCache[key] = texture;
+    return texture;
+}
+
+void VROGLTFLoader::setStreamingSource(const tinygltf::Image &gImage, std::shared_ptr<VROTexture> &texture) {
+    // Retain the encoded image, which is far smaller than the decoded pixels, and
+    // decode it again whenever the texture's resolution changes
+    std::shared_ptr<std::vector<unsigned char>> bytes = std::make_shared<std::vector<unsigned char>>(gImage.rawByteVec);
+    texture->setStreamingSource([bytes] {
+        return VROPlatformLoadImageWithBufferedData(*bytes, VROTextureInternalFormat::RGBA8);
+    });
+}
+
+void VROGLTFLoader::decodeImages(const tinygltf::Model &gModel) {
+    // KTX2 textures only decode their fallback image if needed, so leave those
+    // to getTexture
+    std::vector<int> imageIndices;
+    for (const tinygltf::Texture &gTexture : gModel.textures) {
+        if (gTexture.source >= 0 && gTexture.source < gModel.images.size() && getKTX2Source(gTexture) < 0 &&
+            std::find(imageIndices.begin(), imageIndices.end(), gTexture.source) == imageIndices.end()) {
+            imageIndices.push_back(gTexture.source);
+        }
+    }
+
+    std::vector<const std::vector<unsigned char> *> encoded;
+    for (int imageIndex : imageIndices) {
+        encoded.push_back(&gModel.images[imageIndex].rawByteVec);
+    }
+    std::vector<std::shared_ptr<VROImage>> images = VROImageDecoder::decode(encoded, VROTextureInternalFormat::RGBA8);
+
+    // Images the native decoder can't handle are decoded by the platform in getTexture
+    for (size_t i = 0; i < imageIndices.size(); i++) {
+        if (images[i]) {
+            _decodedImages[imageIndices[i]] = images[i];
+        }
+    }
+}
+
+void VROGLTFLoader::processSampler(const tinygltf::Model &gModel, const tinygltf::Texture &gTexture,
+                                   std::shared_ptr<VROTexture> &texture) {
     int samplerIndex = gTexture.sampler;
     if (samplerIndex >=0) {
         tinygltf::Sampler sampler = gModel.samplers[samplerIndex];
@@ -1985,11 +2308,220 @@ std::shared_ptr<VROTexture> VROGLTFLoader::getTexture(const tinygltf::Model &gMo
         texture->setMagnificationFilter(VROFilterMode::Linear);
         texture->setMinificationFilter(VROFilterMode::Linear);
     }
+}
 
-    // Cache a copy of the created texture as other elements may also refer to it.
-    std::string key = VROStringUtil::toString(imageIndex);
-    VROGLTFLoader::_textureCache[key] = texture;
-    return texture;
+int VROGLTFLoader::getKTX2Source(const tinygltf::Texture &gTexture) {
+    auto it = gTexture.extensions.find("KHR_texture_basisu");
+    if (it == gTexture.extensions.end() || !it->second.Has("source") || !it->second.Get("source").IsInt()) {
+        return -1;
+    }
+    return it->second.Get("source").Get<int>();
+}
+
+std::shared_ptr<VROTexture> VROGLTFLoader::loadKTX2Texture(const tinygltf::Image &gImg, bool srgb) {
+    const std::vector<unsigned char> &data = gImg.rawByteVec;
+    if (!VROTextureUtil::isKTX2(data.data(), (uint32_t) data.size())) {
+        perr("Texture image %s is not a KTX2 file", gImg.name.c_str());
+        return nullptr;
+    }
+
+    VROTextureFormat format;
+    int width, height;
+    std::vector<uint32_t> mipSizes;
+    std::shared_ptr<VROData> texData = VROTextureUtil::readKTX2Header(data.data(), (uint32_t) data.size(),
+                                                                      &format, &width, &height, &mipSizes);
+    if (!texData) {
+        return nullptr;
+    }
+    if (format == VROTextureFormat::ASTC_4x4_LDR && !_astcSupported) {
+        pinfo("ASTC textures are not supported on this device, skipping KTX2 image %s", gImg.name.c_str());
+        return nullptr;
+    }
+
+    std::vector<std::shared_ptr<VROData>> dataVec = { texData };
+    VROMipmapMode mipmapMode = mipSizes.size() > 1 ? VROMipmapMode::Pregenerated : VROMipmapMode::None;
+    return std::make_shared<VROTexture>(VROTextureType::Texture2D, format,
+                                        VROTextureInternalFormat::RGBA8, srgb,
+                                        mipmapMode, dataVec, width, height, mipSizes);
+}
+
+#pragma mark - Progressive Loading
+
+bool VROGLTFLoader::processTexture(const tinygltf::Model &gModel, std::map<std::string, tinygltf::Parameter> gPropMap,
+                                   std::string targetedTextureName, bool srgb,
+                                   std::shared_ptr<VROMaterial> &material, std::vector<VROMaterialVisual *> visuals) {
+    // Compressed textures are not decoded, so they are not worth streaming
+    int index = gPropMap.find(targetedTextureName) != gPropMap.end() ? gPropMap[targetedTextureName].TextureIndex() : -1;
+    bool compressed = index >= 0 && getKTX2Source(gModel.textures[index]) >= 0;
+
+    if (!_progressive || compressed) {
+        std::shared_ptr<VROTexture> texture = getTexture(gModel, gPropMap, targetedTextureName, srgb);
+        if (texture == nullptr) {
+            return false;
+        }
+        for (VROMaterialVisual *visual : visuals) {
+            visual->setTexture(texture);
+        }
+        return true;
+    }
+
+    if (index < 0 || gModel.textures[index].source < 0) {
+        return false;
+    }
+
+    VROGLTFDeferredTexture &deferred = _deferredTextures[{ gModel.textures[index].source, srgb }];
+    deferred.textureIndex = index;
+    deferred.priority = 0;
+    for (VROMaterialVisual *visual : visuals) {
+        deferred.bindings.push_back({ material, visual });
+    }
+    return true;
+}
+
+void VROGLTFLoader::prioritizeTextures(std::shared_ptr<VRONode> rootNode) {
+    std::map<VROMaterial *, float> sizes;
+    measureMaterials(rootNode, 1.0, sizes);
+
+    for (auto &kv : _deferredTextures) {
+        for (auto &binding : kv.second.bindings) {
+            kv.second.priority = std::max(kv.second.priority, sizes[binding.first.get()]);
+        }
+    }
+}
+
+void VROGLTFLoader::measureMaterials(std::shared_ptr<VRONode> node, float scale, std::map<VROMaterial *, float> &sizes) {
+    VROVector3f nodeScale = node->getScale();
+    scale *= std::max(fabs(nodeScale.x), std::max(fabs(nodeScale.y), fabs(nodeScale.z)));
+
+    std::shared_ptr<VROGeometry> geometry = node->getGeometry();
+    if (geometry) {
+        float size = geometry->getBoundingBox().getExtents().magnitude() * scale;
+        for (const std::shared_ptr<VROMaterial> &material : geometry->getMaterials()) {
+            float &materialSize = sizes[material.get()];
+            materialSize = std::max(materialSize, size);
+        }
+    }
+    for (std::shared_ptr<VRONode> &child : node->getChildNodes()) {
+        measureMaterials(child, scale, sizes);
+    }
+}
+
+void VROGLTFLoader::streamTextures(const tinygltf::Model &gModel, std::shared_ptr<VRODriver> driver) {
+    std::vector<std::pair<std::pair<int, bool>, VROGLTFDeferredTexture *>> order;
+    for (auto &kv : _deferredTextures) {
+        order.push_back({ kv.first, &kv.second });
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [](const std::pair<std::pair<int, bool>, VROGLTFDeferredTexture *> &a,
+                        const std::pair<std::pair<int, bool>, VROGLTFDeferredTexture *> &b) {
+                         return a.second->priority > b.second->priority;
+                     });
+
+    // Decode a batch of the highest priority textures at a time in parallel, so
+    // textures still stream in priority order
+    std::vector<std::shared_ptr<VROImage>> batch;
+    size_t batchSize = (size_t) VROImageDecoder::getConcurrency();
+
+    for (size_t i = 0; i < order.size(); i++) {
+        auto &entry = order[i];
+        int imageIndex = entry.first.first;
+        bool srgb = entry.first.second;
+        const tinygltf::Texture &gTexture = gModel.textures[entry.second->textureIndex];
+
+        if (i % batchSize == 0) {
+            std::vector<const std::vector<unsigned char> *> encoded;
+            for (size_t j = i; j < std::min(i + batchSize, order.size()); j++) {
+                encoded.push_back(&gModel.images[order[j].first.first].rawByteVec);
+            }
+            batch = VROImageDecoder::decode(encoded, VROTextureInternalFormat::RGBA8);
+        }
+        std::shared_ptr<VROImage> image = batch[i % batchSize];
+        if (image == nullptr) {
+            image = VROPlatformLoadImageWithBufferedData(gModel.images[imageIndex].rawByteVec,
+                                                         VROTextureInternalFormat::RGBA8);
+        }
+        if (image == nullptr) {
+            perr("Error when parsing texture for image %s.", gModel.images[imageIndex].name.c_str());
+            continue;
+        }
+
+        std::shared_ptr<VROTexture> preview = createPreviewTexture(image, srgb);
+        if (preview) {
+            processSampler(gModel, gTexture, preview);
+        }
+        std::shared_ptr<VROTexture> texture = std::make_shared<VROTexture>(srgb, VROMipmapMode::Runtime, image);
+        processSampler(gModel, gTexture, texture);
+        setStreamingSource(gModel.images[imageIndex], texture);
+
+        /*
+         Bind the preview right away, then swap in the full texture once it has
+         finished its (incremental) upload.
+         */
+        std::vector<std::pair<std::shared_ptr<VROMaterial>, VROMaterialVisual *>> bindings = entry.second->bindings;
+        VROPlatformDispatchAsyncRenderer([bindings, preview, texture, driver] {
+            if (preview) {
+                preview->prewarm(driver);
+                for (auto &binding : bindings) {
+                    binding.second->swapTexture(preview);
+                }
+            }
+
+            // The callback keeps the texture alive until it is uploaded; the texture
+            // releases its callbacks once hydrated
+            std::shared_ptr<VRODriver> hydrationDriver = driver;
+            texture->hydrateAsync([bindings, texture] {
+                for (auto &binding : bindings) {
+                    binding.second->swapTexture(texture);
+                }
+            }, hydrationDriver);
+        });
+    }
+    _deferredTextures.clear();
+}
+
+std::shared_ptr<VROTexture> VROGLTFLoader::createPreviewTexture(std::shared_ptr<VROImage> image, bool srgb) {
+    int width = image->getWidth();
+    int height = image->getHeight();
+    if (image->getFormat() != VROTextureFormat::RGBA8 || std::max(width, height) <= kPreviewTextureSize) {
+        return nullptr;
+    }
+
+    // Box-filter the image down so its longest side is kPreviewTextureSize
+    int step = (std::max(width, height) + kPreviewTextureSize - 1) / kPreviewTextureSize;
+    int previewWidth = std::max(width / step, 1);
+    int previewHeight = std::max(height / step, 1);
+
+    size_t length;
+    image->lock();
+    const unsigned char *pixels = image->getData(&length);
+    if (pixels == nullptr || length < (size_t) width * height * 4) {
+        image->unlock();
+        return nullptr;
+    }
+
+    int previewLength = previewWidth * previewHeight * 4;
+    unsigned char *previewPixels = (unsigned char *) malloc(previewLength);
+    for (int y = 0; y < previewHeight; y++) {
+        for (int x = 0; x < previewWidth; x++) {
+            int sum[4] = { 0, 0, 0, 0 };
+            for (int sy = 0; sy < step; sy++) {
+                const unsigned char *row = pixels + ((size_t) (y * step + sy) * width + x * step) * 4;
+                for (int sx = 0; sx < step * 4; sx++) {
+                    sum[sx & 3] += row[sx];
+                }
+            }
+            for (int c = 0; c < 4; c++) {
+                previewPixels[(y * previewWidth + x) * 4 + c] = (unsigned char) (sum[c] / (step * step));
+            }
+        }
+    }
+    image->unlock();
+
+    std::vector<std::shared_ptr<VROData>> data = { std::make_shared<VROData>(previewPixels, previewLength,
+                                                                             VRODataOwnership::Move) };
+    return std::make_shared<VROTexture>(VROTextureType::Texture2D, VROTextureFormat::RGBA8,
+                                        VROTextureInternalFormat::RGBA8, srgb, VROMipmapMode::Runtime,
+                                        data, previewWidth, previewHeight, std::vector<uint32_t>());
 }
 
 VROMatrix4f VROGLTFLoader::getTransformOfNode(const tinygltf::Model &gModel, int nodeIndex) {
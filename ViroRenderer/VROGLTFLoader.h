@@ -37,11 +37,15 @@
 #include "VROMaterial.h"
 #include "VROModelIOUtil.h"
 #include "VROByteBuffer.h"
+#include "VROThreadRestricted.h"
+#include "VROGeometryCache.h"
+#include "VROTangentGenerator.h"
 
 class VROMorpher;
 class VRONode;
 class VROVertexBuffer;
 class VROTexture;
+class VROImage;
 class VROGeometry;
 class VROSkinner;
 class VROSkeleton;
@@ -49,6 +53,7 @@ class VROTaskQueue;
 class VROSkeletalAnimation;
 class VROKeyframeAnimation;
 class VROKeyframeAnimationFrame;
+class VROImage;
 
 namespace tinygltf {
     class Model;
@@ -64,6 +69,8 @@ namespace tinygltf {
     class AnimationSampler;
     class Buffer;
     class BufferView;
+    class Image;
+    class Node;
 }
 
 /*
@@ -101,49 +108,97 @@ enum class GLTFTypeComponent {
  */
 class VROGLTFLoader {
 public:
+    /*
+     Load the given .gltf or .glb file into rootNode. By default the model is revealed
+     once all of its textures are uploaded, after which onFinish is invoked.
+
+     If progressive is true, the model is instead attached as soon as its geometry is
+     built, and onFinish is invoked at that point. Materials render with their constant
+     factors until their textures arrive. Textures are then decoded and streamed in
+     largest-first order, each appearing first as a low-resolution preview while the
+     full resolution texture uploads.
+
+     If optimizeGeometry is true, the triangles of each primitive are reordered for
+     the GPU's vertex cache and to reduce overdraw (see VROMeshOptimizer), and
+     high-poly static meshes are given simplified levels of detail. Levels of detail
+     authored with the MSFT_lod extension are used regardless.
+     */
     static void loadGLTFFromResource(std::string gltfManifestFilePath,
                                      const std::map<std::string, std::string> overwriteResourceMap,
                                      VROResourceType resourceType,
                                      std::shared_ptr<VRONode> rootNode,
                                      bool isGLTFBinary,
                                      std::shared_ptr<VRODriver> driver,
-                                     std::function<void(std::shared_ptr<VRONode> node, bool success)> onFinish = nullptr);
+                                     std::function<void(std::shared_ptr<VRONode> node, bool success)> onFinish = nullptr,
+                                     bool progressive = false,
+                                     bool optimizeGeometry = true);
 
 private:
+    /*
+     Each load constructs its model with its own loader, which holds the data cached
+     while processing that model. This allows multiple models to load concurrently.
+     */
+    VROGLTFLoader(bool progressive, bool optimizeGeometry, std::shared_ptr<VROGeometryCache> geometryCache) :
+        _progressive(progressive), _astcSupported(false), _optimizeGeometry(optimizeGeometry),
+        _geometryCache(geometryCache), _geometryCacheKey(0), _geometryCacheHit(false) {}
+
+    /*
+     Construct the Viro 3D Model for the given parsed glTF model. Returns the node whose
+     children are the nodes of the model, or nullptr on failure. Does not touch the GPU
+     and may run on any thread.
+     */
+    std::shared_ptr<VRONode> buildModel(const tinygltf::Model &gModel, std::shared_ptr<VRODriver> driver);
+
+    /*
+     As above, for a model whose lifetime the loader may extend: bufferView data is
+     then sliced from the model's buffers instead of copied (see getBufferSlice), and
+     the model is released when the last geometry reading from it is destroyed.
+     */
+    std::shared_ptr<VRONode> buildModel(std::shared_ptr<const tinygltf::Model> gModel, std::shared_ptr<VRODriver> driver);
+
     // Functions for processing basic components required for constructing a 3D Model in Viro.
-    static bool processScene(const tinygltf::Model &gModel, std::shared_ptr<VRONode> rootNode, const tinygltf::Scene &gScene,
-                             std::shared_ptr<VRODriver> driver);
-    static bool processNode(const tinygltf::Model &gModel, std::shared_ptr<VRONode> &sceneNode, int gNodeIndex,
-                            std::shared_ptr<VRODriver> driver);
-    static bool processMesh(const tinygltf::Model &gModel, std::shared_ptr<VRONode> &node, const tinygltf::Mesh &gMesh,
-                            std::shared_ptr<VRODriver> driver);
+    bool processScene(const tinygltf::Model &gModel, std::shared_ptr<VRONode> rootNode, const tinygltf::Scene &gScene,
+                      std::shared_ptr<VRODriver> driver);
+    bool processNode(const tinygltf::Model &gModel, std::shared_ptr<VRONode> &sceneNode, int gNodeIndex,
+                     std::shared_ptr<VRODriver> driver);
+    bool processMesh(const tinygltf::Model &gModel, std::shared_ptr<VRONode> &node, int gMeshIndex,
+                     std::shared_ptr<VRODriver> driver);
+    
+    /*
+     Set the levels of detail of the given node's geometry: the meshes of the nodes
+     listed by the glTF node's MSFT_lod extension if it has one, and otherwise
+     simplifications generated from the geometry itself.
+     */
+    bool processLODs(const tinygltf::Model &gModel, const tinygltf::Node &gNode, std::shared_ptr<VRONode> &node,
+                     std::shared_ptr<VRODriver> driver);
     static bool processSkin(const tinygltf::Model &gModel, std::shared_ptr<VRONode> &node, int skinIndex);
-    static bool processVertexElement(const tinygltf::Model &gModel, const tinygltf::Primitive &gPrimitive,
-                                     std::vector<std::shared_ptr<VROGeometryElement>> &element);
-    static bool processVertexAttributes(const tinygltf::Model &gModel, std::map<std::string, int> &gAttributes,
-                                        std::vector<std::shared_ptr<VROGeometrySource>> &sources,
-                                        size_t geoElementIndex,
-                                        std::shared_ptr<VRODriver> driver);
-    static void processTangent(std::vector<std::shared_ptr<VROGeometryElement>> &elements,
-                               std::vector<std::shared_ptr<VROGeometrySource>> &sources, size_t geoElementIndex);
-    static void regenerateTangent(std::vector<VROVector3f> &posArray,
-                                  std::vector<VROVector3f> &normArray,
-                                  std::vector<VROVector3f> &texCoordArray,
-                                  std::vector<int> &elementIndicesArray,
-                                  std::vector<VROVector4f> &generatedTangents);
-    static bool processMorphTargets(const tinygltf::Model &gModel,
-                                    const tinygltf::Mesh &gMesh,
-                                    const tinygltf::Primitive &gPrimitive,
-                                    std::shared_ptr<VROMaterial> &material,
-                                    std::vector<std::shared_ptr<VROGeometrySource>> &sources,
-                                    std::vector<std::shared_ptr<VROGeometryElement>> &elements,
-                                    std::map<int, std::shared_ptr<VROMorpher>> &morphers,
-                                    std::shared_ptr<VRODriver> driver);
+    bool processVertexElement(const tinygltf::Model &gModel, const tinygltf::Primitive &gPrimitive,
+                              std::vector<std::shared_ptr<VROGeometryElement>> &element);
+    bool processVertexAttributes(const tinygltf::Model &gModel, std::map<std::string, int> &gAttributes,
+                                 std::vector<std::shared_ptr<VROGeometrySource>> &sources,
+                                 size_t geoElementIndex,
+                                 std::shared_ptr<VRODriver> driver);
+    
+    /*
+     If the primitive at the given element index has no tangents, add a tangent
+     source for it, and queue the generation of its tangents in _tangentJobs.
+     */
+    void processTangent(std::vector<std::shared_ptr<VROGeometryElement>> &elements,
+                        std::vector<std::shared_ptr<VROGeometrySource>> &sources, size_t geoElementIndex);
+    bool processMorphTargets(const tinygltf::Model &gModel,
+                             const tinygltf::Mesh &gMesh,
+                             const tinygltf::Primitive &gPrimitive,
+                             std::shared_ptr<VROMaterial> &material,
+                             std::vector<std::shared_ptr<VROGeometrySource>> &sources,
+                             std::vector<std::shared_ptr<VROGeometryElement>> &elements,
+                             std::map<int, std::shared_ptr<VROMorpher>> &morphers,
+                             std::shared_ptr<VRODriver> driver);
     static std::string getMorphTargetName(const tinygltf::Model &gModel,
                                           const tinygltf::Primitive &gPrimtive, int targetIndex);
 
     static void injectGLTF(std::shared_ptr<VRONode> gltfNode, std::shared_ptr<VRONode> rootNode,
-                           std::shared_ptr<VRODriver> driver, std::function<void(std::shared_ptr<VRONode> node, bool success)> onFinish);
+                           std::shared_ptr<VRODriver> driver, std::function<void(std::shared_ptr<VRONode> node, bool success)> onFinish,
+                           bool progressive);
     
     static std::shared_ptr<VROGeometrySource> buildGeometrySource(VROGeometrySourceSemantic attributeType,
                                                                   GLTFType gType,
@@ -155,14 +210,39 @@ private:
                                                                     GLTFTypeComponent gTypeComponent,
                                                                     const tinygltf::Accessor &gAttributeAccesor,
                                                                     const tinygltf::BufferView &gIndiceBufferView,
-                                                                    const tinygltf::Buffer &gbuffer);
+                                                                    const unsigned char *bufferViewData);
 
     // Processing of GTLF Materials and Textures into VROMaterials and VROTextures
-    static std::shared_ptr<VROMaterial> getMaterial(const tinygltf::Model &gModel, const tinygltf::Material &gMat);
-    static std::shared_ptr<VROTexture> getTexture(const  tinygltf::Model &gModel, std::map<std::string, tinygltf::Parameter> gPropMap,
-                                                  std::string targetedTextureName, bool srgb);
-    static std::shared_ptr<VROTexture> getTexture(const tinygltf::Model &gModel, const tinygltf::Texture &texture, bool srgb);
-    static void processPBR(const tinygltf::Model &gModel, std::shared_ptr<VROMaterial> &texture, const tinygltf::Material &gMat);
+    std::shared_ptr<VROMaterial> getMaterial(const tinygltf::Model &gModel, const tinygltf::Material &gMat);
+    bool processTexture(const tinygltf::Model &gModel, std::map<std::string, tinygltf::Parameter> gPropMap,
+                        std::string targetedTextureName, bool srgb,
+                        std::shared_ptr<VROMaterial> &material, std::vector<VROMaterialVisual *> visuals);
+    std::shared_ptr<VROTexture> getTexture(const  tinygltf::Model &gModel, std::map<std::string, tinygltf::Parameter> gPropMap,
+                                           std::string targetedTextureName, bool srgb);
+    std::shared_ptr<VROTexture> getTexture(const tinygltf::Model &gModel, const tinygltf::Texture &texture, bool srgb);
+    void processPBR(const tinygltf::Model &gModel, std::shared_ptr<VROMaterial> &texture, const tinygltf::Material &gMat);
+    static void processSampler(const tinygltf::Model &gModel, const tinygltf::Texture &gTexture,
+                               std::shared_ptr<VROTexture> &texture);
+
+    /*
+     Stream the given texture from the encoded bytes of its glTF image.
+     */
+    static void setStreamingSource(const tinygltf::Image &gImage, std::shared_ptr<VROTexture> &texture);
+
+    /*
+     Textures with the KHR_texture_basisu extension reference a KTX2 image, and optionally a
+     fallback image in their source. The KTX2 image is used when its format can be uploaded
+     to this device (ASTC requires device support); otherwise the fallback is used.
+     */
+    static int getKTX2Source(const tinygltf::Texture &gTexture);
+    std::shared_ptr<VROTexture> loadKTX2Texture(const tinygltf::Image &gImg, bool srgb);
+    bool _astcSupported;
+
+    // Progressive loading of textures
+    void prioritizeTextures(std::shared_ptr<VRONode> rootNode);
+    static void measureMaterials(std::shared_ptr<VRONode> node, float scale, std::map<VROMaterial *, float> &sizes);
+    void streamTextures(const tinygltf::Model &gModel, std::shared_ptr<VRODriver> driver);
+    static std::shared_ptr<VROTexture> createPreviewTexture(std::shared_ptr<VROImage> image, bool srgb);
 
     // Conversion of GLTF Semantics to VRO Semantics
     static bool getPrimitiveType(int mode, VROGeometryPrimitiveType &type);
@@ -173,60 +253,139 @@ private:
     static VROWrapMode getWrappingMode(int mode);
 
     // Processing of Animation Data
-    static bool processAnimations(const tinygltf::Model &gModel);
-    static bool processKeyFrameAnimations(const tinygltf::Model &gModel,
-                                         std::map<int, std::map<int, std::vector<int>>> &gltfAnimatedNodes);
-    static void flattenSkeletalKeyframeAnimations(
+    bool processAnimations(const tinygltf::Model &gModel);
+    bool processKeyFrameAnimations(const tinygltf::Model &gModel,
+                                  std::map<int, std::map<int, std::vector<int>>> &gltfAnimatedNodes);
+    void flattenSkeletalKeyframeAnimations(
             std::map<int, std::pair<int, std::vector<int>>> &skeletalAnimToNodeSkinPair);
-    static std::shared_ptr<VROKeyframeAnimation> convertChannelToKeyFrameAnimation(
+    std::shared_ptr<VROKeyframeAnimation> convertChannelToKeyFrameAnimation(
                                                   const tinygltf::Model &gModel,
                                                   const tinygltf::Animation &anim,
                                                   int targetedChannel);
-    static bool processRawChannelData(const tinygltf::Model &gModel,
-                                      std::string channelProperty,
-                                      int channelTarget,
-                                      const tinygltf::AnimationSampler &gChannelSampler,
-                                      std::vector<std::unique_ptr<VROKeyframeAnimationFrame>> &framesOut);
-    static bool processSkeletalAnimation(const tinygltf::Model &gModel,
-                                         std::map<int, std::pair<int, std::vector<int>>> &skeletalAnimToSkinToNodeMap);
-    static bool processSkeletalTransformsForFrame(const tinygltf::Model &gModel,
-                                                  int skin,
-                                                  int animation,
-                                                  int subAnimPropertyIndex,
-                                                  int keyFrameIndex,
-                                                  int currentJointIndex,
-                                                  std::map<int, VROMatrix4f> &transforms);
-    static bool processSkinner(const tinygltf::Model &gModel);
-    static bool processSkinnerInverseBindData(const tinygltf::Model &gModel,
-                                              const tinygltf::Skin &skin,
-                                              std::vector<VROMatrix4f> &invBindTransformsOut);
-    static void clearCachedData();
+    bool processRawChannelData(const tinygltf::Model &gModel,
+                               std::string channelProperty,
+                               int channelTarget,
+                               const tinygltf::AnimationSampler &gChannelSampler,
+                               std::vector<std::unique_ptr<VROKeyframeAnimationFrame>> &framesOut);
+    bool processSkeletalAnimation(const tinygltf::Model &gModel,
+                                  std::map<int, std::pair<int, std::vector<int>>> &skeletalAnimToSkinToNodeMap);
+    bool processSkeletalTransformsForFrame(const tinygltf::Model &gModel,
+                                           int skin,
+                                           int animation,
+                                           int subAnimPropertyIndex,
+                                           int keyFrameIndex,
+                                           int currentJointIndex,
+                                           std::map<int, VROMatrix4f> &transforms);
+    bool processSkinner(const tinygltf::Model &gModel);
+    bool processSkinnerInverseBindData(const tinygltf::Model &gModel,
+                                       const tinygltf::Skin &skin,
+                                       std::vector<VROMatrix4f> &invBindTransformsOut);
+
+    /*
+     BufferViews compressed with EXT_meshopt_compression are decoded before the model is
+     built, each into its own data. getBufferViewData returns the (decoded) contents of
+     a bufferView, which all processing reads in place of the raw buffer.
+     */
+    bool decodeCompressedBufferViews(const tinygltf::Model &gModel);
+    const unsigned char *getBufferViewData(const tinygltf::Model &gModel, int bufferViewIndex) const;
+    std::map<int, std::shared_ptr<VROData>> _decodedBufferViews;
+
+    /*
+     Return the given range of the given buffer. While building a shared model, the
+     range is a slice of the buffer that retains the model; otherwise (or if the
+     buffer also holds images, whose encoded bytes should not outlive the load) it
+     is a copy.
+     */
+    std::shared_ptr<VROData> getBufferSlice(const tinygltf::Model &gModel, int bufferIndex,
+                                            size_t byteOffset, size_t byteLength);
+    std::shared_ptr<const void> _modelOwner;
+    std::set<int> _imageBuffers;
+    std::map<int, std::shared_ptr<VROData>> _bufferData;
+
+    /*
+     Returns true if the model requires an extension without which it cannot be loaded,
+     and which the loader does not support (KHR_draco_mesh_compression).
+     */
+    static bool requiresUnsupportedExtension(const tinygltf::Model &gModel);
+
+    /*
+     The processed sources and elements of each mesh are persisted in the geometry cache,
+     keyed by a hash of the data they are built from (see hashMeshData). On a hit,
+     _cachedMeshes holds the geometry of each mesh, read back from the cache; on a miss,
+     it collects the geometry of each mesh as it is processed, to be stored once the
+     model is built.
+     */
+    uint64_t hashMeshData(const tinygltf::Model &gModel) const;
+    bool _optimizeGeometry;
+    std::shared_ptr<VROGeometryCache> _geometryCache;
+    uint64_t _geometryCacheKey;
+    bool _geometryCacheHit;
+    std::vector<VROCachedMesh> _cachedMeshes;
+
+    /*
+     Tangents missing from the model's primitives. These are generated together, in
+     parallel, once all meshes are processed and before the geometry is cached.
+     */
+    std::vector<VROTangentJob> _tangentJobs;
 
     /*
      As multiple mesh attributes may point to the same texture or data arrays when loading a
-     GTLF model, we cache them here during loadGLTFFromResource(), and clear them out after.
+     GTLF model, we cache them here for the duration of the load.
      */
-    static std::map<std::string, std::shared_ptr<VROVertexBuffer>> _dataCache;
-    static std::map<std::string, std::shared_ptr<VROTexture>> _textureCache;
+    std::map<std::string, std::shared_ptr<VROVertexBuffer>> _dataCache;
+    std::map<std::string, std::shared_ptr<VROTexture>> _textureCache;
+
+    /*
+     Images decoded in parallel ahead of building the model, by image index. Each
+     is consumed by the first getTexture call for its image.
+     */
+    void decodeImages(const tinygltf::Model &gModel);
+    std::map<int, std::shared_ptr<VROImage>> _decodedImages;
 
     /*
      Cached maps of skinner indexes to skeletal data, including both joints and affected node
-     indexes. Note that in gLTF, a node can only have one skeletal root joint. These caches
-     are cleared out after the parsing of a single gLTF model.
+     indexes. Note that in gLTF, a node can only have one skeletal root joint.
      */
-    static std::map<int, std::shared_ptr<VROSkeleton>> _skinIndexToSkeleton;
-    static std::map<int, std::map<int,int>> _skinIndexToJointNodeIndex;
-    static std::map<int, std::map<int,std::vector<int>>> _skinIndexToJointChildJoints;
-    static std::map<int, std::shared_ptr<VROSkinner>> _skinMap;
-    static std::map<int, int> _skinIndexToSkeletonRootJoint;
+    std::map<int, std::shared_ptr<VROSkeleton>> _skinIndexToSkeleton;
+    std::map<int, std::map<int,int>> _skinIndexToJointNodeIndex;
+    std::map<int, std::map<int,std::vector<int>>> _skinIndexToJointChildJoints;
+    std::map<int, std::shared_ptr<VROSkinner>> _skinMap;
+    std::map<int, int> _skinIndexToSkeletonRootJoint;
 
     /*
-     Cached maps of nodeIndexes to it's corresponding animations. These caches are cleared
-     out after the parsing of a single gLTF model. Note that _nodeKeyFrameAnims is of the form:
-     <nodeIndex , <animationIndex, VROKeyframeAnimation>>> _nodeKeyframeAnims.
+     Cached maps of nodeIndexes to it's corresponding animations. Note that _nodeKeyFrameAnims
+     is of the form: <nodeIndex , <animationIndex, VROKeyframeAnimation>>> _nodeKeyframeAnims.
      */
-    static std::map<int, std::map<int, std::vector<std::shared_ptr<VROKeyframeAnimation>>>> _nodeKeyFrameAnims;
-    static std::map<int, std::vector<std::shared_ptr<VROSkeletalAnimation>>> _skinSkeletalAnims;
+    std::map<int, std::map<int, std::vector<std::shared_ptr<VROKeyframeAnimation>>>> _nodeKeyFrameAnims;
+    std::map<int, std::vector<std::shared_ptr<VROSkeletalAnimation>>> _skinSkeletalAnims;
+
+    /*
+     In progressive mode, textures are not decoded while the model is built. Instead
+     each texture (keyed by its image index and color space) records the material
+     visuals that use it, and a priority that orders the streaming of textures.
+     */
+    struct VROGLTFDeferredTexture {
+        int textureIndex;
+        float priority;
+        std::vector<std::pair<std::shared_ptr<VROMaterial>, VROMaterialVisual *>> bindings;
+    };
+    bool _progressive;
+    std::map<std::pair<int, bool>, VROGLTFDeferredTexture> _deferredTextures;
+
+    /*
+     Nodes and materials are constructed off the rendering thread, so their thread
+     restriction is lifted until restoreThreadRestrictions() hands them to the renderer.
+     */
+    std::vector<std::shared_ptr<VROThreadRestricted>> _unrestrictedObjects;
+
+    template <typename T>
+    std::shared_ptr<T> makeUnrestricted() {
+        std::shared_ptr<T> object = std::make_shared<T>();
+        object->setThreadRestrictionEnabled(false);
+        _unrestrictedObjects.push_back(object);
+        return object;
+    }
+    void restoreThreadRestrictions();
 
     /*
      Returns the local transform of the node index retried from the gltf model.
@@ -0,0 +1,188 @@
+//
+//  VROGPUCullerOpenGL.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include "VROGPUCullerOpenGL.h"
+#include "VRODriverOpenGL.h"
+#include "VROShaderProgram.h"
+#include "VROGeometryBufferArena.h"
+#include "VROProfiler.h"
+#include "VROLog.h"
+
+/*
+ Each invocation transforms the bounds of one object into world space (as a
+ center and extents, so the box stays tight under rotation), and tests the box
+ against the frustum planes. The instance count of the object's command, the
+ second word of each VROMultiDrawCommand, is set to zero if the box is outside
+ any plane.
+ */
+static const char *kGPUCullShaderSource =
+    "#version 310 es\n"
+    "layout (local_size_x = 64) in;\n"
+    "struct VROCullObject {\n"
+    "    vec4 bounds_min;\n"
+    "    vec4 bounds_max;\n"
+    "    mat4 transform;\n"
+    "};\n"
+    "layout (std430, binding = 0) buffer Commands {\n"
+    "    uint commands[];\n"
+    "};\n"
+    "layout (std430, binding = 1) readonly buffer Objects {\n"
+    "    VROCullObject objects[];\n"
+    "};\n"
+    "uniform vec4 frustum_planes[5];\n"
+    "uniform uint num_commands;\n"
+    "void main() {\n"
+    "    uint i = gl_GlobalInvocationID.x;\n"
+    "    if (i >= num_commands) {\n"
+    "        return;\n"
+    "    }\n"
+    "    VROCullObject object = objects[i];\n"
+    "    vec3 center = (object.bounds_min.xyz + object.bounds_max.xyz) * 0.5;\n"
+    "    vec3 extents = (object.bounds_max.xyz - object.bounds_min.xyz) * 0.5;\n"
+    "    vec3 world_center = (object.transform * vec4(center, 1.0)).xyz;\n"
+    "    vec3 world_extents = abs(object.transform[0].xyz) * extents.x +\n"
+    "                         abs(object.transform[1].xyz) * extents.y +\n"
+    "                         abs(object.transform[2].xyz) * extents.z;\n"
+    "    bool visible = true;\n"
+    "    for (int p = 0; p < 5; p++) {\n"
+    "        vec4 plane = frustum_planes[p];\n"
+    "        if (dot(plane.xyz, world_center) + plane.w < -dot(abs(plane.xyz), world_extents)) {\n"
+    "            visible = false;\n"
+    "        }\n"
+    "    }\n"
+    "    commands[i * 5u + 1u] = visible ? 1u : 0u;\n"
+    "}\n";
+
+VROGPUCullerOpenGL::VROGPUCullerOpenGL(std::shared_ptr<VRODriverOpenGL> driver,
+                                       PFNGLDISPATCHCOMPUTEPROC dispatchCompute,
+                                       PFNGLMEMORYBARRIERPROC memoryBarrier) :
+    _driver(driver),
+    _dispatchCompute(dispatchCompute),
+    _memoryBarrier(memoryBarrier),
+    _frustumPlanesLocation(-1),
+    _numCommandsLocation(-1),
+    _objectBuffer(0) {
+    
+    static_assert(sizeof(VROMultiDrawCommand) == 5 * sizeof(GLuint), "Culling shader assumes 5-word commands");
+    static_assert(sizeof(VROGPUCullObject) == 24 * sizeof(float), "Culling shader assumes std430 cull objects");
+        
+    _program = compile();
+    if (_program != 0) {
+        _frustumPlanesLocation = glGetUniformLocation(_program, "frustum_planes");
+        _numCommandsLocation = glGetUniformLocation(_program, "num_commands");
+        GL( glGenBuffers(1, &_objectBuffer) );
+    }
+}
+
+VROGPUCullerOpenGL::~VROGPUCullerOpenGL() {
+    std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
+    if (driver && _program != 0) {
+        driver->deleteProgram(_program);
+        driver->deleteBuffer(_objectBuffer);
+    }
+}
+
+GLuint VROGPUCullerOpenGL::compile() {
+    GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
+    GL( glShaderSource(shader, 1, &kGPUCullShaderSource, nullptr) );
+    GL( glCompileShader(shader) );
+    
+    GLint status;
+    GL( glGetShaderiv(shader, GL_COMPILE_STATUS, &status) );
+    if (status == 0) {
+        char log[1024];
+        GL( glGetShaderInfoLog(shader, sizeof(log), nullptr, log) );
+        perr("GPU culling shader failed to compile, culling on the CPU only:\n%s", log);
+        GL( glDeleteShader(shader) );
+        return 0;
+    }
+    
+    GLuint program = glCreateProgram();
+    GL( glAttachShader(program, shader) );
+    GL( glLinkProgram(program) );
+    GL( glDeleteShader(shader) );
+    
+    GL( glGetProgramiv(program, GL_LINK_STATUS, &status) );
+    if (status == 0) {
+        perr("GPU culling program failed to link, culling on the CPU only");
+        GL( glDeleteProgram(program) );
+        return 0;
+    }
+    return program;
+}
+
+VROGPUCullObject VROGPUCullerOpenGL::buildObject(const VROBoundingBox &bounds, const VROMatrix4f &transform) {
+    VROGPUCullObject object;
+    object.boundsMin[0] = bounds.getMinX();
+    object.boundsMin[1] = bounds.getMinY();
+    object.boundsMin[2] = bounds.getMinZ();
+    object.boundsMin[3] = 0;
+    object.boundsMax[0] = bounds.getMaxX();
+    object.boundsMax[1] = bounds.getMaxY();
+    object.boundsMax[2] = bounds.getMaxZ();
+    object.boundsMax[3] = 0;
+    memcpy(object.transform, transform.getArray(), sizeof(object.transform));
+    return object;
+}
+
+void VROGPUCullerOpenGL::cull(GLuint commandBuffer, const VROGPUCullObject *objects, int numObjects,
+                              const VROMatrix4f &viewProjection) {
+    passert (isReady());
+    
+    // Extract the left, right, bottom, top, and near planes from the rows of the
+    // view-projection, with their normals facing into the frustum
+    const float *m = viewProjection.getArray();
+    float planes[5][4];
+    for (int p = 0; p < 5; p++) {
+        int row = p / 2;
+        float sign = (p % 2 == 0) ? 1 : -1;
+        for (int c = 0; c < 4; c++) {
+            planes[p][c] = m[c * 4 + 3] + sign * m[c * 4 + row];
+        }
+    }
+    
+    GL( glBindBuffer(GL_SHADER_STORAGE_BUFFER, _objectBuffer) );
+    GL( glBufferData(GL_SHADER_STORAGE_BUFFER, numObjects * sizeof(VROGPUCullObject), objects, GL_STREAM_DRAW) );
+    GL( glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, commandBuffer) );
+    GL( glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, _objectBuffer) );
+    
+    GL( glUseProgram(_program) );
+    GL( glUniform4fv(_frustumPlanesLocation, 5, &planes[0][0]) );
+    GL( glUniform1ui(_numCommandsLocation, (GLuint) numObjects) );
+    GL( _dispatchCompute((numObjects + kGPUCullWorkGroupSize - 1) / kGPUCullWorkGroupSize, 1, 1) );
+    GL( _memoryBarrier(GL_COMMAND_BARRIER_BIT) );
+    
+    GL( glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0) );
+    GL( glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, 0) );
+    GL( glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0) );
+    
+    // Restore the material's program for the draw
+    std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
+    if (driver && driver->getBoundShader()) {
+        GL( glUseProgram(driver->getBoundShader()->getProgram()) );
+    }
+    VRO_PROFILE_COUNT(GPUCullDispatches, 1);
+}
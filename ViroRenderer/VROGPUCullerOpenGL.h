@@ -0,0 +1,125 @@
+//
+//  VROGPUCullerOpenGL.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef VROGPUCullerOpenGL_h
+#define VROGPUCullerOpenGL_h
+
+#include <memory>
+#include <vector>
+#include "VROOpenGL.h"
+#include "VROMatrix4f.h"
+#include "VROBoundingBox.h"
+
+class VRODriverOpenGL;
+class VROGPUCullerOpenGL;
+
+/*
+ Number of invocations in each work group of the culling compute shader.
+ */
+static const int kGPUCullWorkGroupSize = 64;
+
+/*
+ The object drawn by one multi-draw command, in the std430 layout read by the
+ culling compute shader: its local bounds and its model transform.
+ */
+typedef struct {
+    float boundsMin[4];
+    float boundsMax[4];
+    float transform[16];
+} VROGPUCullObject;
+
+/*
+ A request to cull a multi-draw's commands before they are drawn. The objects
+ correspond one-to-one with the commands.
+ */
+struct VROGPUCullRequest {
+    VROGPUCullerOpenGL *culler;
+    const VROGPUCullObject *objects;
+    VROMatrix4f viewProjection;
+};
+
+/*
+ VROGPUCullerOpenGL frustum culls the commands of a multi-draw on the GPU, with
+ a compute shader (GLES 3.1) that reads each command's bounds from a shader
+ storage buffer and zeroes the instance count of every command outside the
+ frustum, writing directly into the indirect buffer the multi-draw reads.
+ 
+ The CPU culls nodes once per frame against the head's frustum; the GPU cull
+ refines this for each eye, against the bounds of each draw, without any
+ per-object work on the CPU beyond copying the bounds and transforms. Like the
+ CPU frustum, the cull has no far plane.
+ */
+class VROGPUCullerOpenGL {
+public:
+    
+    /*
+     Create a culler with the given GLES 3.1 entry points, which are loaded at
+     runtime. If the compute shader fails to compile, isReady() returns false.
+     */
+    VROGPUCullerOpenGL(std::shared_ptr<VRODriverOpenGL> driver,
+                       PFNGLDISPATCHCOMPUTEPROC dispatchCompute,
+                       PFNGLMEMORYBARRIERPROC memoryBarrier);
+    virtual ~VROGPUCullerOpenGL();
+    
+    bool isReady() const {
+        return _program != 0;
+    }
+    
+    /*
+     Build the cull object for a draw of geometry with the given local bounds
+     and model transform.
+     */
+    static VROGPUCullObject buildObject(const VROBoundingBox &bounds, const VROMatrix4f &transform);
+    
+    /*
+     Cull the given number of commands in the given indirect buffer, against
+     the frustum of the given view-projection matrix. The commands must already
+     be uploaded. A barrier is issued so that the following indirect draw reads
+     the culled commands. Restores the driver's bound shader afterward.
+     */
+    void cull(GLuint commandBuffer, const VROGPUCullObject *objects, int numObjects,
+              const VROMatrix4f &viewProjection);
+    
+private:
+    
+    std::weak_ptr<VRODriverOpenGL> _driver;
+    PFNGLDISPATCHCOMPUTEPROC _dispatchCompute;
+    PFNGLMEMORYBARRIERPROC _memoryBarrier;
+    
+    /*
+     The compute program and its uniform locations, and the buffer to which the
+     cull objects are written.
+     */
+    GLuint _program;
+    GLint _frustumPlanesLocation;
+    GLint _numCommandsLocation;
+    GLuint _objectBuffer;
+    
+    GLuint compile();
+    
+};
+
+#endif /* VROGPUCullerOpenGL_h */
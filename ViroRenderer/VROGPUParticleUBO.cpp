@@ -0,0 +1,410 @@
+//
+//  VROGPUParticleUBO.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROGPUParticleUBO.h"
+#include "VROParticle.h"
+#include "VROParticleModifier.h"
+#include "VROShaderProgram.h"
+#include "VROShaderModifier.h"
+#include "VRODriverOpenGL.h"
+#include "VROStringUtil.h"
+#include "VROLog.h"
+#include <algorithm>
+
+VROGPUParticleUBO::VROGPUParticleUBO(std::shared_ptr<VRODriver> driver) :
+    _driver(driver),
+    _emitterUBO(0),
+    _emitterDataDirty(true),
+    _cursor(0),
+    _numActiveParticles(0),
+    _numActiveUBOs(0),
+    _epochMs(-1),
+    _currentTimeMs(0),
+    _decelerationPeriodSec(-1),
+    _hasLocalBounds(false),
+    _hasWorldBounds(false) {
+    
+    GLint maxBlockSize = 0;
+    GL( glGetIntegerv(GL_MAX_UNIFORM_BLOCK_SIZE, &maxBlockSize) );
+    _particlesPerUBO = maxBlockSize >= kMaxGPUParticlesPerUBO * (int) sizeof(VROGPUParticleData) ?
+                       kMaxGPUParticlesPerUBO : kMinGPUParticlesPerUBO;
+        
+    memset(&_emitterData, 0x0, sizeof(VROGPUParticleEmitterData));
+    VROMatrix4f identity;
+    memcpy(_emitterData.emitter_transform, identity.getArray(), 16 * sizeof(float));
+    _lastKnownBoundingBox = VROBoundingBox(0, 0, 0, 0, 0, 0);
+}
+
+VROGPUParticleUBO::~VROGPUParticleUBO() {
+    std::shared_ptr<VRODriverOpenGL> driver = std::dynamic_pointer_cast<VRODriverOpenGL>(_driver.lock());
+    if (driver) {
+        for (GLuint buffer : _particleUBOs) {
+            driver->deleteBuffer(buffer);
+        }
+        if (_emitterUBO != 0) {
+            driver->deleteBuffer(_emitterUBO);
+        }
+    }
+}
+
+std::vector<std::shared_ptr<VROShaderModifier>> VROGPUParticleUBO::createInstanceShaderModifier() {
+    std::vector<std::shared_ptr<VROShaderModifier>> modifiers;
+    
+    // The particle block is declared here rather than in gpu_particles_vsh, since its
+    // size depends on the device's maximum uniform block size
+    std::vector<std::string> vertexModifierCode = {
+            "#include gpu_particles_vsh",
+            "layout (std140) uniform gpu_particles_data { VROGPUParticle gpu_particles[" + VROStringUtil::toString(_particlesPerUBO) + "]; };",
+            "out highp vec4 v_particle_color;",
+            "_transforms.model_matrix = gpu_particle_transform(gpu_particles[v_instance_id], _transforms.view_matrix, v_particle_color);",
+    };
+    
+    // Color is blended as with CPU particles (see VROParticleUBO)
+    std::vector<std::string> surfaceModifierCode = {
+            "in highp vec4 v_particle_color;",
+            "highp vec4 particleColor = v_particle_color;",
+            "highp vec4 dest =_surface.diffuse_color.xyzw;",
+            "highp vec4 src = particleColor;",
+            "highp float srcAlpha = 0.5;",
+            "if (particleColor.x != -1.0 && _surface.diffuse_color.a != 0.0) {"
+            "   highp vec4 final = (src * srcAlpha) + (dest * (1.0 - srcAlpha));",
+            "   _surface.diffuse_color.xyz = final.xyz;",
+            "}",
+            "_surface.alpha = _surface.alpha * particleColor.w;",
+    };
+    
+    modifiers.push_back(
+            std::make_shared<VROShaderModifier>(VROShaderEntryPoint::Geometry, vertexModifierCode));
+    modifiers.push_back(
+            std::make_shared<VROShaderModifier>(VROShaderEntryPoint::Surface, surfaceModifierCode));
+    return modifiers;
+}
+
+#pragma mark - Simulation
+
+void VROGPUParticleUBO::setCapacity(int maxParticles) {
+    int numUBOs = (maxParticles + _particlesPerUBO - 1) / _particlesPerUBO;
+    int capacity = numUBOs * _particlesPerUBO;
+    if (capacity == _particles.size()) {
+        return;
+    }
+    
+    // Buffers beyond the new capacity are released; new buffers are created when
+    // first bound
+    std::shared_ptr<VRODriverOpenGL> driver = std::dynamic_pointer_cast<VRODriverOpenGL>(_driver.lock());
+    while (_particleUBOs.size() > numUBOs) {
+        if (driver && _particleUBOs.back() != 0) {
+            driver->deleteBuffer(_particleUBOs.back());
+        }
+        _particleUBOs.pop_back();
+    }
+    _particleUBOs.resize(numUBOs, 0);
+    
+    _particles.resize(capacity);
+    _expirationTimesMs.resize(capacity);
+    _dirtyRanges.resize(numUBOs);
+    clear();
+}
+
+void VROGPUParticleUBO::clear() {
+    // Dead slots are marked with an expiration time of -1; the shader collapses
+    // them by giving them a spawn time in the future
+    memset(_particles.data(), 0x0, _particles.size() * sizeof(VROGPUParticleData));
+    for (int i = 0; i < _particles.size(); i++) {
+        _particles[i].position_spawn[3] = FLT_MAX;
+        _expirationTimesMs[i] = -1;
+    }
+    for (int i = 0; i < _dirtyRanges.size(); i++) {
+        _dirtyRanges[i] = { 0, _particlesPerUBO };
+    }
+    
+    _cursor = 0;
+    _numActiveParticles = 0;
+    _numActiveUBOs = 0;
+    _hasLocalBounds = false;
+    _hasWorldBounds = false;
+    _lastKnownBoundingBox = VROBoundingBox(0, 0, 0, 0, 0, 0);
+}
+
+bool VROGPUParticleUBO::spawn(const VROParticle &particle) {
+    int capacity = (int) _particles.size();
+    if (_epochMs < 0) {
+        _epochMs = particle.spawnTimeMs;
+    }
+    
+    // Particles have similar lifetimes, so the slot after the last spawned particle
+    // is almost always free
+    int slot = -1;
+    for (int i = 0; i < capacity; i++) {
+        int candidate = (_cursor + i) % capacity;
+        if (_expirationTimesMs[candidate] < particle.spawnTimeMs) {
+            slot = candidate;
+            break;
+        }
+    }
+    if (slot < 0) {
+        return false;
+    }
+    _cursor = (slot + 1) % capacity;
+    
+    VROVector3f position = particle.spawnedLocalTransform.extractTranslation();
+    VROVector3f velocity = particle.initialVelocity;
+    VROVector3f accel = particle.initialAccel;
+    VROVector3f scale = particle.initialScale;
+    
+    // Particles that are not fixed to the emitter don't follow it after they spawn,
+    // so their state is stored in world space
+    if (!particle.fixedToEmitter) {
+        const VROMatrix4f &world = particle.spawnedWorldTransform;
+        VROVector3f origin = world.extractTranslation();
+        position = world.multiply(position);
+        velocity = world.multiply(velocity) - origin;
+        accel = world.multiply(accel) - origin;
+        
+        VROVector3f worldScale = world.extractScale();
+        scale = VROVector3f(scale.x * worldScale.x, scale.y * worldScale.y, scale.z * worldScale.z);
+    }
+    
+    VROGPUParticleData &data = _particles[slot];
+    data.position_spawn[0] = position.x;
+    data.position_spawn[1] = position.y;
+    data.position_spawn[2] = position.z;
+    data.position_spawn[3] = (particle.spawnTimeMs - _epochMs) / 1000.0;
+    data.velocity_lifetime[0] = velocity.x;
+    data.velocity_lifetime[1] = velocity.y;
+    data.velocity_lifetime[2] = velocity.z;
+    data.velocity_lifetime[3] = particle.lifePeriodMs / 1000.0;
+    data.accel_alpha[0] = accel.x;
+    data.accel_alpha[1] = accel.y;
+    data.accel_alpha[2] = accel.z;
+    data.accel_alpha[3] = particle.initialAlpha.x;
+    data.color_fixed[0] = particle.initialColor.x;
+    data.color_fixed[1] = particle.initialColor.y;
+    data.color_fixed[2] = particle.initialColor.z;
+    data.color_fixed[3] = particle.fixedToEmitter ? 1.0 : 0.0;
+    data.scale[0] = scale.x;
+    data.scale[1] = scale.y;
+    data.scale[2] = scale.z;
+    data.rotation[0] = particle.initialRotation.x;
+    data.rotation[1] = particle.initialRotation.y;
+    data.rotation[2] = particle.initialRotation.z;
+    _expirationTimesMs[slot] = particle.spawnTimeMs + particle.lifePeriodMs;
+    
+    int block = slot / _particlesPerUBO;
+    int index = slot % _particlesPerUBO;
+    std::pair<int, int> &range = _dirtyRanges[block];
+    if (range.first >= range.second) {
+        range = { index, index + 1 };
+    }
+    else {
+        range = { std::min(range.first, index), std::max(range.second, index + 1) };
+    }
+    
+    _numActiveParticles++;
+    _numActiveUBOs = std::max(_numActiveUBOs, block + 1);
+    expandBounds(data, particle.fixedToEmitter);
+    return true;
+}
+
+void VROGPUParticleUBO::expandBounds(const VROGPUParticleData &data, bool fixedToEmitter) {
+    // Bound the particle's parabolic trajectory on each axis by its start and end
+    // points and, if reached during its life, its turning point. Modifier curves
+    // may deviate from this, so the bounds are padded by the particle's scale
+    float t = data.velocity_lifetime[3];
+    if (_decelerationPeriodSec >= 0) {
+        t = std::min(t, (float) _decelerationPeriodSec);
+    }
+    
+    float min[3], max[3];
+    for (int i = 0; i < 3; i++) {
+        float p = data.position_spawn[i];
+        float v = data.velocity_lifetime[i];
+        float a = data.accel_alpha[i];
+        float end = p + v * t + 0.5f * a * t * t;
+        
+        min[i] = std::min(p, end);
+        max[i] = std::max(p, end);
+        if (a != 0) {
+            float turn = -v / a;
+            if (turn > 0 && turn < t) {
+                float extreme = p + v * turn + 0.5f * a * turn * turn;
+                min[i] = std::min(min[i], extreme);
+                max[i] = std::max(max[i], extreme);
+            }
+        }
+    }
+    float pad = std::max(std::max(fabs(data.scale[0]), fabs(data.scale[1])), fabs(data.scale[2]));
+    VROBoundingBox box(min[0] - pad, max[0] + pad, min[1] - pad, max[1] + pad, min[2] - pad, max[2] + pad);
+    
+    if (fixedToEmitter) {
+        if (_hasLocalBounds) {
+            _localBounds.unionDestructive(box);
+        }
+        else {
+            _localBounds = box;
+            _hasLocalBounds = true;
+        }
+    }
+    else {
+        if (_hasWorldBounds) {
+            _worldBounds.unionDestructive(box);
+        }
+        else {
+            _worldBounds = box;
+            _hasWorldBounds = true;
+        }
+    }
+}
+
+void VROGPUParticleUBO::setModifier(VROGPUParticleProperty property, const VROParticleModifier &modifier) {
+    const std::vector<VROParticleModifier::VROModifierInterval> &intervals = modifier.getIntervals();
+    if (intervals.size() > kMaxGPUModifierIntervals) {
+        pwarn("Particle modifier has %d intervals, only the first %d are simulated on the GPU",
+              (int) intervals.size(), kMaxGPUModifierIntervals);
+    }
+    int count = std::min((int) intervals.size(), kMaxGPUModifierIntervals);
+    
+    int m = (int) property;
+    int header[4] = { (int) modifier.getReferenceFactor(), count, 0, 0 };
+    float values[kMaxGPUModifierIntervals * 8];
+    memset(values, 0x0, sizeof(values));
+    for (int i = 0; i < count; i++) {
+        const VROParticleModifier::VROModifierInterval &interval = intervals[i];
+        values[i * 8 + 0] = interval.targetedValue.x;
+        values[i * 8 + 1] = interval.targetedValue.y;
+        values[i * 8 + 2] = interval.targetedValue.z;
+        values[i * 8 + 4] = interval.startFactor;
+        values[i * 8 + 5] = interval.endFactor;
+    }
+    
+    float *dest = &_emitterData.modifier_intervals[m * kMaxGPUModifierIntervals * 8];
+    if (memcmp(&_emitterData.modifier_headers[m * 4], header, sizeof(header)) != 0 ||
+        memcmp(dest, values, sizeof(values)) != 0) {
+        memcpy(&_emitterData.modifier_headers[m * 4], header, sizeof(header));
+        memcpy(dest, values, sizeof(values));
+        _emitterDataDirty = true;
+    }
+}
+
+void VROGPUParticleUBO::update(double currentTimeMs, const VROMatrix4f &emitterTransform,
+                               double decelerationPeriodSec) {
+    _currentTimeMs = currentTimeMs;
+    _decelerationPeriodSec = decelerationPeriodSec;
+    
+    // Retire expired particles. Their slots are left as-is: the shader collapses
+    // particles past their lifetime
+    int numActive = 0;
+    int lastActive = -1;
+    for (int i = 0; i < _expirationTimesMs.size(); i++) {
+        if (_expirationTimesMs[i] >= currentTimeMs) {
+            numActive++;
+            lastActive = i;
+        }
+    }
+    _numActiveParticles = numActive;
+    _numActiveUBOs = (lastActive + _particlesPerUBO) / _particlesPerUBO;
+    if (numActive == 0) {
+        _hasLocalBounds = false;
+        _hasWorldBounds = false;
+    }
+    
+    memcpy(_emitterData.emitter_transform, emitterTransform.getArray(), 16 * sizeof(float));
+    _emitterData.emitter_params[0] = _epochMs < 0 ? 0 : (currentTimeMs - _epochMs) / 1000.0;
+    _emitterData.emitter_params[1] = decelerationPeriodSec;
+    _emitterDataDirty = true;
+    
+    VROBoundingBox box(0, 0, 0, 0, 0, 0);
+    if (_hasLocalBounds) {
+        box = _localBounds.transform(emitterTransform);
+    }
+    if (_hasWorldBounds) {
+        box = _hasLocalBounds ? box.unionWith(_worldBounds) : _worldBounds;
+    }
+    _lastKnownBoundingBox = box;
+}
+
+#pragma mark - Rendering
+
+int VROGPUParticleUBO::getNumberOfDrawCalls() {
+    return _numActiveParticles > 0 ? _numActiveUBOs : -1;
+}
+
+int VROGPUParticleUBO::bindDrawData(int currentDrawCallIndex) {
+    if (currentDrawCallIndex >= _numActiveUBOs) {
+        return 0;
+    }
+    
+    pglpush("GPUParticles");
+    if (_emitterUBO == 0) {
+        GL( glGenBuffers(1, &_emitterUBO) );
+        GL( glBindBuffer(GL_UNIFORM_BUFFER, _emitterUBO) );
+        GL( glBufferData(GL_UNIFORM_BUFFER, sizeof(VROGPUParticleEmitterData), &_emitterData, GL_DYNAMIC_DRAW) );
+        _emitterDataDirty = false;
+    }
+    GL( glBindBufferBase(GL_UNIFORM_BUFFER, VROShaderProgram::sGPUParticleEmitterUBOBindingPoint, _emitterUBO) );
+    if (_emitterDataDirty) {
+#if VRO_AVOID_BUFFER_SUB_DATA
+        GL( glBufferData(GL_UNIFORM_BUFFER, sizeof(VROGPUParticleEmitterData), &_emitterData, GL_DYNAMIC_DRAW) );
+#else
+        GL( glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(VROGPUParticleEmitterData), &_emitterData) );
+#endif
+        _emitterDataDirty = false;
+    }
+    
+    // Only the particles spawned since the block was last bound are uploaded
+    uploadBlock(currentDrawCallIndex);
+    pglpop();
+    
+    return _particlesPerUBO;
+}
+
+void VROGPUParticleUBO::uploadBlock(int block) {
+    const VROGPUParticleData *blockData = &_particles[block * _particlesPerUBO];
+    GLsizeiptr blockSize = _particlesPerUBO * sizeof(VROGPUParticleData);
+    
+    GLuint &buffer = _particleUBOs[block];
+    if (buffer == 0) {
+        GL( glGenBuffers(1, &buffer) );
+        GL( glBindBuffer(GL_UNIFORM_BUFFER, buffer) );
+        GL( glBufferData(GL_UNIFORM_BUFFER, blockSize, blockData, GL_DYNAMIC_DRAW) );
+        _dirtyRanges[block] = { 0, 0 };
+    }
+    GL( glBindBufferBase(GL_UNIFORM_BUFFER, VROShaderProgram::sGPUParticlesUBOBindingPoint, buffer) );
+    
+    std::pair<int, int> &range = _dirtyRanges[block];
+    if (range.first < range.second) {
+#if VRO_AVOID_BUFFER_SUB_DATA
+        GL( glBufferData(GL_UNIFORM_BUFFER, blockSize, blockData, GL_DYNAMIC_DRAW) );
+#else
+        GL( glBufferSubData(GL_UNIFORM_BUFFER, range.first * sizeof(VROGPUParticleData),
+                            (range.second - range.first) * sizeof(VROGPUParticleData), &blockData[range.first]) );
+#endif
+        range = { 0, 0 };
+    }
+}
+
+VROBoundingBox VROGPUParticleUBO::getInstancedBoundingBox() {
+    return _lastKnownBoundingBox;
+}
@@ -0,0 +1,210 @@
+//
+//  VROGPUParticleUBO.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROGPUParticleUBO_h
+#define VROGPUParticleUBO_h
+
+#include "VROInstancedUBO.h"
+#include "VROAtomic.h"
+
+/*
+ Number of particles per uniform block. Each particle uses 96 bytes, so the
+ minimum fits the 16KB block size guaranteed by GLES 3.0; on devices that
+ support 64KB blocks the maximum is used instead.
+ */
+static const int kMinGPUParticlesPerUBO = 170;
+static const int kMaxGPUParticlesPerUBO = 680;
+
+/*
+ The curves of each VROParticleModifier are evaluated in the shader, with at
+ most this many intervals per modifier.
+ */
+static const int kNumGPUParticleModifiers = 6;
+static const int kMaxGPUModifierIntervals = 4;
+
+/*
+ The particle properties animated by VROParticleModifiers, in the order their
+ curves appear in VROGPUParticleEmitterData.
+ */
+enum class VROGPUParticleProperty {
+    Alpha = 0,
+    Color = 1,
+    Scale = 2,
+    Rotation = 3,
+    Velocity = 4,
+    Acceleration = 5
+};
+
+/*
+ The spawn state of a single particle. Grouped in 4N slots, matching the
+ VROGPUParticle struct in gpu_particles_vsh.glsl.
+ */
+typedef struct {
+    float position_spawn[4];    // xyz: spawn position, w: spawn time in seconds
+    float velocity_lifetime[4]; // xyz: initial velocity, w: lifetime in seconds
+    float accel_alpha[4];       // xyz: initial acceleration, w: initial alpha
+    float color_fixed[4];       // xyz: initial color, w: 1 if fixed to the emitter
+    float scale[4];             // xyz: initial scale
+    float rotation[4];          // xyz: initial rotation in radians
+} VROGPUParticleData;
+
+/*
+ Per-emitter data shared by all particles. Grouped in 4N slots, matching the
+ gpu_particle_emitter_data block in gpu_particles_vsh.glsl.
+ */
+typedef struct {
+    float emitter_transform[16];
+    float emitter_params[4];    // x: current time in seconds, y: deceleration period in seconds
+    int modifier_headers[kNumGPUParticleModifiers * 4]; // x: reference factor, y: interval count
+    float modifier_intervals[kNumGPUParticleModifiers * kMaxGPUModifierIntervals * 8];
+} VROGPUParticleEmitterData;
+
+class VROParticle;
+class VROParticleModifier;
+
+/*
+ VROGPUParticleUBO simulates particles on the GPU. Each particle's spawn state is
+ written once, when it spawns, to a persistent set of uniform buffers; the
+ vertex shader then derives the particle's position, color, scale and rotation
+ from that state, the elapsed time, and the emitter's modifier curves. Because
+ the particle equations of motion are closed-form in time, no per-frame state
+ is written back, and the CPU cost per frame is independent of the number of
+ particles.
+ 
+ Particles are billboarded against the view plane, and particles that are not
+ fixed to the emitter are stored in world space, baking in the emitter
+ transform at the time they spawned.
+ */
+class VROGPUParticleUBO : public VROInstancedUBO {
+public:
+    
+    VROGPUParticleUBO(std::shared_ptr<VRODriver> driver);
+    virtual ~VROGPUParticleUBO();
+    
+    std::vector<std::shared_ptr<VROShaderModifier>> createInstanceShaderModifier();
+    int getNumberOfDrawCalls();
+    int bindDrawData(int currentDrawCallIndex);
+    VROBoundingBox getInstancedBoundingBox();
+    
+    /*
+     Set the maximum number of live particles. Changing the capacity kills all
+     particles.
+     */
+    void setCapacity(int maxParticles);
+    int getCapacity() const {
+        return (int) _particles.size();
+    }
+    
+    /*
+     Number of particles alive as of the last update.
+     */
+    int getNumActiveParticles() const {
+        return _numActiveParticles;
+    }
+    
+    /*
+     Write the spawn state of the given particle to a free slot. Returns false if
+     every slot holds a live particle.
+     */
+    bool spawn(const VROParticle &particle);
+    
+    /*
+     Kill all particles.
+     */
+    void clear();
+    
+    /*
+     Upload the curve of the given modifier, to be evaluated in the shader.
+     */
+    void setModifier(VROGPUParticleProperty property, const VROParticleModifier &modifier);
+    
+    /*
+     Advance the simulation to the given time, using the emitter's current
+     transform for particles that are fixed to it. The deceleration period is
+     the time in seconds after which particles stop moving; negative if none.
+     */
+    void update(double currentTimeMs, const VROMatrix4f &emitterTransform,
+                double decelerationPeriodSec);
+    
+private:
+    
+    std::weak_ptr<VRODriver> _driver;
+    
+    /*
+     The particles per uniform block, determined by GL_MAX_UNIFORM_BLOCK_SIZE.
+     */
+    int _particlesPerUBO;
+    
+    /*
+     One uniform buffer per block of particles, and the buffer holding the
+     emitter data. Buffers are created lazily when first bound.
+     */
+    std::vector<GLuint> _particleUBOs;
+    GLuint _emitterUBO;
+    
+    /*
+     CPU copy of each particle slot, the time at which each slot's particle dies,
+     and the range of slots within each block that have changed since the block
+     was last uploaded.
+     */
+    std::vector<VROGPUParticleData> _particles;
+    std::vector<double> _expirationTimesMs;
+    std::vector<std::pair<int, int>> _dirtyRanges;
+    
+    VROGPUParticleEmitterData _emitterData;
+    bool _emitterDataDirty;
+    
+    /*
+     The next slot to try when spawning, the number of live particles, and the
+     number of blocks up to the last one that holds a live particle.
+     */
+    int _cursor;
+    int _numActiveParticles;
+    int _numActiveUBOs;
+    
+    /*
+     Particle times are stored in seconds relative to this time, to preserve
+     precision in the shader.
+     */
+    double _epochMs;
+    double _currentTimeMs;
+    double _decelerationPeriodSec;
+    
+    /*
+     Conservative bounds of the trajectories of live particles, in emitter space
+     for particles fixed to the emitter and world space otherwise. Reset when no
+     particles remain.
+     */
+    VROBoundingBox _localBounds;
+    VROBoundingBox _worldBounds;
+    bool _hasLocalBounds, _hasWorldBounds;
+    VROAtomic<VROBoundingBox> _lastKnownBoundingBox;
+    
+    void expandBounds(const VROGPUParticleData &data, bool fixedToEmitter);
+    void uploadBlock(int block);
+    
+};
+
+#endif /* VROGPUParticleUBO_h */
@@ -0,0 +1,180 @@
+//
+//  VROGPUTimerOpenGL.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROGPUTimerOpenGL.h"
+#include "VROProfiler.h"
+#include "VROTime.h"
+#include "VROLog.h"
+
+VROGPUTimerOpenGL::VROGPUTimerOpenGL() :
+    _currentFrame(0),
+    _timerOpen(false),
+    _segmentOpen(false),
+    _frameOpen(false),
+    _frameTime(-1) {
+
+}
+
+VROGPUTimerOpenGL::~VROGPUTimerOpenGL() {
+    // Destroyed with the driver, while the GL context is still current
+    for (int i = 0; i < kGPUTimerFrameLatency; i++) {
+        for (VROGPUTimerQuery &query : _frames[i]) {
+            _freeQueries.push_back(query.query);
+        }
+    }
+    if (!_freeQueries.empty()) {
+        GL( glDeleteQueries((GLsizei) _freeQueries.size(), _freeQueries.data()) );
+    }
+}
+
+void VROGPUTimerOpenGL::begin(const char *name) {
+    if (_timerOpen && !_segmentOpen) {
+        return;
+    }
+    if (_segmentOpen) {
+        close();
+    }
+    open(name);
+}
+
+bool VROGPUTimerOpenGL::begin(std::function<void(uint64_t)> callback) {
+    if (_timerOpen && !_segmentOpen) {
+        return false;
+    }
+    if (_segmentOpen) {
+        close();
+    }
+    open(nullptr, callback);
+    return true;
+}
+
+void VROGPUTimerOpenGL::end() {
+    if (!_timerOpen || _segmentOpen) {
+        return;
+    }
+    close();
+    if (_frameOpen) {
+        open(nullptr);
+    }
+}
+
+void VROGPUTimerOpenGL::beginFrame() {
+    if (_frameOpen) {
+        return;
+    }
+    _frameOpen = true;
+    if (!_timerOpen) {
+        open(nullptr);
+    }
+}
+
+void VROGPUTimerOpenGL::endFrame() {
+    if (!_frameOpen) {
+        return;
+    }
+    if (_segmentOpen) {
+        close();
+    }
+    _frameOpen = false;
+}
+
+void VROGPUTimerOpenGL::open(const char *name, std::function<void(uint64_t)> callback) {
+    GLuint query;
+    if (_freeQueries.empty()) {
+        GL( glGenQueries(1, &query) );
+    }
+    else {
+        query = _freeQueries.back();
+        _freeQueries.pop_back();
+    }
+
+    GL( glBeginQuery(GL_TIME_ELAPSED_EXT, query) );
+    _frames[_currentFrame].push_back({ query, name, callback, VRONanoTime(), _frameOpen });
+    _timerOpen = true;
+    _segmentOpen = (name == nullptr && !callback);
+}
+
+void VROGPUTimerOpenGL::close() {
+    GL( glEndQuery(GL_TIME_ELAPSED_EXT) );
+    _timerOpen = false;
+    _segmentOpen = false;
+}
+
+void VROGPUTimerOpenGL::nextFrame() {
+    _frameOpen = false;
+    if (_timerOpen) {
+        close();
+    }
+    _currentFrame = (_currentFrame + 1) % kGPUTimerFrameLatency;
+    collect(_frames[_currentFrame]);
+}
+
+void VROGPUTimerOpenGL::collect(std::vector<VROGPUTimerQuery> &queries) {
+    if (queries.empty()) {
+        return;
+    }
+
+    bool disjoint = false;
+#if !VRO_PLATFORM_MACOS
+    GLint disjointOccurred = 0;
+    GL( glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjointOccurred) );
+    disjoint = disjointOccurred != 0;
+#endif
+
+    // The frame time is only valid if every query issued within the frame completed
+    bool frameTimed = !disjoint;
+    bool frameQueried = false;
+    uint64_t frameNs = 0;
+
+    for (VROGPUTimerQuery &query : queries) {
+        GLuint available = 0;
+        GL( glGetQueryObjectuiv(query.query, GL_QUERY_RESULT_AVAILABLE, &available) );
+
+        if (available && !disjoint) {
+            // 32-bit results cover passes of up to ~4 seconds, far beyond what we profile
+            GLuint elapsedNs = 0;
+            GL( glGetQueryObjectuiv(query.query, GL_QUERY_RESULT, &elapsedNs) );
+            if (query.name) {
+                VROProfiler::addGPUEvent(query.name, query.cpuStartNs, elapsedNs);
+            }
+            if (query.callback) {
+                query.callback(elapsedNs);
+            }
+            if (query.inFrame) {
+                frameNs += elapsedNs;
+            }
+        }
+        else if (query.inFrame) {
+            frameTimed = false;
+        }
+        frameQueried |= query.inFrame;
+        _freeQueries.push_back(query.query);
+    }
+    queries.clear();
+
+    if (frameQueried && frameTimed) {
+        _frameTime = frameNs / 1000000.0;
+    }
+}
@@ -0,0 +1,138 @@
+//
+//  VROGPUTimerOpenGL.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROGPUTimerOpenGL_h
+#define VROGPUTimerOpenGL_h
+
+#include "VROOpenGL.h"
+#include <vector>
+#include <functional>
+
+#ifndef GL_TIME_ELAPSED_EXT
+#define GL_TIME_ELAPSED_EXT 0x88BF
+#endif
+#ifndef GL_GPU_DISJOINT_EXT
+#define GL_GPU_DISJOINT_EXT 0x8FBB
+#endif
+
+/*
+ Number of frames a timer query is given to complete before its result is
+ read. Reading any sooner would stall the CPU on the GPU.
+ */
+static const int kGPUTimerFrameLatency = 3;
+
+/*
+ Measures the GPU time of profiled render passes with GL_TIME_ELAPSED queries
+ (EXT_disjoint_timer_query on GLES, core on desktop GL), and reports the
+ results to VROProfiler. Queries issued during a frame are collected
+ kGPUTimerFrameLatency frames later; a query that is still unavailable then is
+ dropped rather than waited on, as are all queries of a frame during which the
+ GPU reported a disjoint operation (e.g. a frequency change).
+
+ The timer can also measure the GPU time of entire frames. Since elapsed-time
+ queries can not nest, the frame is covered by a sequence of segment queries
+ that are closed whenever a named timer opens, and reopened when it closes; the
+ frame time is the sum of all queries issued while the frame was open.
+ */
+class VROGPUTimerOpenGL {
+public:
+
+    VROGPUTimerOpenGL();
+    virtual ~VROGPUTimerOpenGL();
+
+    /*
+     Open and close a timer. Only one timer may be open at a time.
+     */
+    void begin(const char *name);
+    void end();
+
+    /*
+     Open a timer whose result, in nanoseconds, is passed to the given callback
+     when collected instead of being reported to VROProfiler. Returns false if
+     another timer is already open, in which case end() must not be invoked.
+     */
+    bool begin(std::function<void(uint64_t)> callback);
+
+    /*
+     Open and close the timing of a frame, within which named timers may be
+     opened and closed as usual.
+     */
+    void beginFrame();
+    void endFrame();
+
+    /*
+     Get the GPU time of the most recently collected frame in milliseconds, or
+     a negative value if no frame has been timed successfully.
+     */
+    double getFrameTime() const {
+        return _frameTime;
+    }
+
+    /*
+     Advance to the next frame, collecting the results of the queries issued
+     kGPUTimerFrameLatency frames ago.
+     */
+    void nextFrame();
+
+private:
+
+    /*
+     Segment queries, which only contribute to the frame time, have no name.
+     */
+    struct VROGPUTimerQuery {
+        GLuint query;
+        const char *name;
+        std::function<void(uint64_t)> callback;
+        uint64_t cpuStartNs;
+        bool inFrame;
+    };
+
+    /*
+     Queries issued during each of the last kGPUTimerFrameLatency frames, and
+     the index of the current frame's set.
+     */
+    std::vector<VROGPUTimerQuery> _frames[kGPUTimerFrameLatency];
+    int _currentFrame;
+
+    /*
+     Query objects that have been collected and may be reused.
+     */
+    std::vector<GLuint> _freeQueries;
+    bool _timerOpen;
+    bool _segmentOpen;
+
+    /*
+     True while a frame is being timed, and the last collected frame time.
+     */
+    bool _frameOpen;
+    double _frameTime;
+
+    void open(const char *name, std::function<void(uint64_t)> callback = nullptr);
+    void close();
+    void collect(std::vector<VROGPUTimerQuery> &queries);
+
+};
+
+#endif /* VROGPUTimerOpenGL_h */
@@ -47,6 +47,7 @@ VROGaussianBlurRenderPass::VROGaussianBlurRenderPass() :
     _reinforcedIntensity(1),
     _normalizedKernel(true),
     _considerTransparentPixels(false),
+    _packedFloatSupported(false),
     _preBlurPass(nullptr),
     _gaussianBlur(nullptr),
     _blurTargetA(nullptr),
@@ -59,6 +60,20 @@ VROGaussianBlurRenderPass::~VROGaussianBlurRenderPass() {
 void VROGaussianBlurRenderPass::createRenderTargets(std::shared_ptr<VRODriver> &driver) {
     _blurTargetA = driver->newRenderTarget(VRORenderTargetType::ColorTextureHDR16, 1, 1, false, false);
     _blurTargetB = driver->newRenderTarget(VRORenderTargetType::ColorTextureHDR16, 1, 1, false, false);
+    _packedFloatSupported = driver->isPackedFloatRenderTargetSupported();
+    updateTargetFormats();
+}
+
+void VROGaussianBlurRenderPass::updateTargetFormats() {
+    // Alpha is only carried through the blur when compositing onto transparent pixels
+    VROAttachmentFormat format = (_packedFloatSupported && !_considerTransparentPixels) ?
+                                  VROAttachmentFormat::R11G11B10F : VROAttachmentFormat::Default;
+    if (_blurTargetA) {
+        _blurTargetA->setAttachmentFormat(0, format);
+    }
+    if (_blurTargetB) {
+        _blurTargetB->setAttachmentFormat(0, format);
+    }
 }
 
 void VROGaussianBlurRenderPass::resetRenderTargets() {
@@ -109,6 +124,7 @@ void VROGaussianBlurRenderPass::setClearColor(VROVector4f color) {
     }
 
     _considerTransparentPixels = color.w != 1.0;
+    updateTargetFormats();
     resetShaders();
 }
 
@@ -252,7 +268,7 @@ void VROGaussianBlurRenderPass::render(std::shared_ptr<VROScene> scene,
     // Apply any pre-blur passes with the given inputTexture onto Buffer B.
     _preBlurPass->begin(driver);
     driver->setBlendingMode(VROBlendMode::None);
-    driver->bindRenderTarget(bufferB, VRORenderTargetUnbindOp::Invalidate);
+    driver->bindRenderTarget(bufferB, VRORenderTargetActions::overwrite(), VRORenderTargetUnbindOp::Invalidate);
     _preBlurPass->blitOpt({ input }, driver);
     _preBlurPass->end(driver);
 
@@ -262,15 +278,15 @@ void VROGaussianBlurRenderPass::render(std::shared_ptr<VROScene> scene,
     driver->setBlendingMode(VROBlendMode::None);
     for (int i = 0; i < _numBlurIterations; i++) {
         if (i == 0) {
-            driver->bindRenderTarget(bufferA, VRORenderTargetUnbindOp::Invalidate);
+            driver->bindRenderTarget(bufferA, VRORenderTargetActions::overwrite(), VRORenderTargetUnbindOp::Invalidate);
             _gaussianBlur->blitOpt({ bufferB->getTexture(0) }, driver);
         }
         else if (i % 2 == 1) {
-            driver->bindRenderTarget(bufferB, VRORenderTargetUnbindOp::Invalidate);
+            driver->bindRenderTarget(bufferB, VRORenderTargetActions::overwrite(), VRORenderTargetUnbindOp::Invalidate);
             _gaussianBlur->blitOpt({ bufferA->getTexture(0) }, driver);
         }
         else {
-            driver->bindRenderTarget(bufferA, VRORenderTargetUnbindOp::Invalidate);
+            driver->bindRenderTarget(bufferA, VRORenderTargetActions::overwrite(), VRORenderTargetUnbindOp::Invalidate);
             _gaussianBlur->blitOpt({ bufferB->getTexture(0) }, driver);
         }
         _horizontal = !_horizontal;
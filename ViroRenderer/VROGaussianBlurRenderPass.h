@@ -157,6 +157,17 @@ private:
      */
     bool _considerTransparentPixels = true;
 
+    /*
+     True if the driver can render to R11G11B10F, in which case the blur targets
+     use that format when there are no transparent pixels to consider.
+     */
+    bool _packedFloatSupported;
+
+    /*
+     Set the attachment format of the blur targets given the current settings.
+     */
+    void updateTargetFormats();
+
     /*
      A premultiplied intensity ratio applied to the input texture and it's rgb values
      before bluring.
@@ -35,6 +35,22 @@
 #include "VROMaterial.h"
 #include "VRORenderMetadata.h"
 #include "VROMorpher.h"
+#include "VROTriangleBVH.h"
+#include "VROResidencyManager.h"
+#include "VROVertexBuffer.h"
+#include "VROImpostor.h"
+#include <mutex>
+
+// The nearest distance considered when estimating on-screen size, so geometry
+// at the camera doesn't request infinite resolution
+static const float kStreamingMinDistance = 0.1f;
+
+// The margin by which screen coverage must pass a LOD threshold before the
+// LOD changes
+static const float kLODHysteresis = 0.1f;
+
+// Guards the lazy computation of geometry bounding boxes (see getBoundingBox)
+static std::mutex sBoundingBoxMutex;
 
 VROGeometry::~VROGeometry() {
     delete (_substrate);
@@ -48,18 +64,59 @@ void VROGeometry::deleteGL() {
 }
 
 void VROGeometry::prewarm(std::shared_ptr<VRODriver> driver) {
+    if (_substrate && _dynamicUpdatePending) {
+        _dynamicUpdatePending = false;
+        if (!isRenderable() || !_substrate->updateGeometry(*this, _dynamicUpdateAppendOnly, driver)) {
+            delete (_substrate);
+            _substrate = nullptr;
+        }
+    }
     if (!_substrate && isRenderable()) {
         _substrate = driver->newGeometrySubstrate(*this);
+        if (!_residencyTracked) {
+            std::shared_ptr<VROResidencyManager> manager = driver->getResidencyManager();
+            if (manager) {
+                manager->addGeometry(std::static_pointer_cast<VROGeometry>(shared_from_this()));
+                _residencyTracked = true;
+            }
+        }
+        
+        // Upload the LODs with the geometry, so switching LODs never stalls
+        for (VROGeometryLOD &lod : _lods) {
+            lod.geometry->prewarm(driver);
+        }
+    }
+}
+
+bool VROGeometry::evictSubstrate() {
+    if (!_substrate) {
+        return false;
+    }
+    
+    // The sources are unchanged, so the version is not incremented
+    delete (_substrate);
+    _substrate = nullptr;
+    _dynamicUpdatePending = false;
+    return true;
+}
+
+void VROGeometry::setReleasesVertexDataOnHydrate(bool releases) {
+    getBoundingBox();
+    for (const std::shared_ptr<VROGeometrySource> &source : _geometrySources) {
+        if (source->getVertexBuffer()) {
+            source->getVertexBuffer()->setReleasesDataOnHydrate(releases);
+        }
     }
 }
 
 void VROGeometry::render(int elementIndex,
                          const std::shared_ptr<VROMaterial> &material,
-                         VROMatrix4f transform,
-                         VROMatrix4f normalMatrix,
+                         const VROMatrix4f &transform,
+                         const VROMatrix4f &normalMatrix,
                          float opacity,
                          const VRORenderContext &context,
                          std::shared_ptr<VRODriver> &driver) {
+    _lastRenderedFrame = context.getFrame();
     prewarm(driver);
     if (_substrate) {
         _substrate->render(*this, elementIndex, transform, normalMatrix,
@@ -67,7 +124,63 @@ void VROGeometry::render(int elementIndex,
     }
 }
 
-void VROGeometry::renderSilhouette(VROMatrix4f transform,
+void VROGeometry::renderInstanced(int elementIndex,
+                                  const std::shared_ptr<VROMaterial> &material,
+                                  const std::vector<VROMatrix4f> &transforms,
+                                  const std::vector<VROMatrix4f> &normalMatrices,
+                                  float opacity,
+                                  const VRORenderContext &context,
+                                  std::shared_ptr<VRODriver> &driver) {
+    _lastRenderedFrame = context.getFrame();
+    prewarm(driver);
+    if (_substrate) {
+        _substrate->renderInstanced(*this, elementIndex, transforms, normalMatrices,
+                                    opacity, material, context, driver);
+    }
+}
+
+bool VROGeometry::isAutomaticInstancingSupported() const {
+    return !_instancedUBO && (!_skinner || _skinner->getBakedAnimation()) && _elementsToMorphers.empty();
+}
+
+bool VROGeometry::isInstancingRequired() const {
+    return _skinner && _skinner->getBakedAnimation() && isAutomaticInstancingSupported();
+}
+
+bool VROGeometry::isMultiDrawCompatibleWith(int elementIndex, const VROGeometry &other, int otherElementIndex) const {
+    return _substrate && other._substrate && !_skinner && !other._skinner &&
+           isAutomaticInstancingSupported() && other.isAutomaticInstancingSupported() &&
+           _screenSpace == other._screenSpace &&
+           _cameraEnclosure == other._cameraEnclosure &&
+           _substrate->isMultiDrawCompatible(elementIndex, *other._substrate, otherElementIndex);
+}
+
+void VROGeometry::renderMultiDraw(const std::vector<VROGeometry *> &geometries,
+                                  const std::vector<int> &elementIndices,
+                                  const std::shared_ptr<VROMaterial> &material,
+                                  const std::vector<VROMatrix4f> &transforms,
+                                  const std::vector<VROMatrix4f> &normalMatrices,
+                                  float opacity,
+                                  const VRORenderContext &context,
+                                  std::shared_ptr<VRODriver> &driver) {
+    passert (!geometries.empty() && geometries.front() == this);
+    if (!_substrate) {
+        return;
+    }
+    
+    std::vector<VROGeometrySubstrate *> substrates;
+    std::vector<VROBoundingBox> bounds;
+    substrates.reserve(geometries.size());
+    bounds.reserve(geometries.size());
+    for (VROGeometry *geometry : geometries) {
+        substrates.push_back(geometry->_substrate);
+        bounds.push_back(geometry->getBoundingBox());
+    }
+    _substrate->renderMultiDraw(*this, substrates, bounds, elementIndices, transforms, normalMatrices,
+                                opacity, material, context, driver);
+}
+
+void VROGeometry::renderSilhouette(const VROMatrix4f &transform,
                                    std::shared_ptr<VROMaterial> &material,
                                    const VRORenderContext &context,
                                    std::shared_ptr<VRODriver> &driver) {
@@ -78,7 +191,7 @@ void VROGeometry::renderSilhouette(VROMatrix4f transform,
 }
 
 void VROGeometry::renderSilhouetteTextured(int element,
-                                           VROMatrix4f transform,
+                                           const VROMatrix4f &transform,
                                            std::shared_ptr<VROMaterial> &material,
                                            const VRORenderContext &context,
                                            std::shared_ptr<VRODriver> &driver) {
@@ -95,6 +208,37 @@ void VROGeometry::updateSortKeys(VRONode *node, uint32_t hierarchyId, uint32_t h
                                  const VRORenderContext &context,
                                  std::shared_ptr<VRODriver> &driver) {
     _sortKeys.clear();
+    _lastRenderedFrame = context.getFrame();
+    for (VROGeometryLOD &lod : _lods) {
+        lod.geometry->_lastRenderedFrame = _lastRenderedFrame;
+    }
+
+    // The approximate fraction of the viewport's height covered by this
+    // geometry, used to select its LOD, and its on-screen size in pixels, used
+    // to stream the resolution of its textures
+    float screenCoverage = node->getBoundingBox().getExtents().magnitude() * context.getProjectionMatrix()[5] * 0.5f /
+                           std::max(distanceFromCamera, kStreamingMinDistance);
+    float screenSize = screenCoverage * context.getCamera().getViewport().getHeight();
+    if (!_lods.empty() || _impostor) {
+        node->setLODLevel(selectLOD(screenCoverage, node->getLODLevel()));
+    }
+    
+    // Impostors are captured by the choreographer, the first time any node
+    // needs one, and are rendered in place of the geometry thereafter
+    if (_impostor) {
+        if (!_impostor->getGeometry()) {
+            if (screenCoverage < _impostor->getScreenCoverage() && _impostor->requestCapture()) {
+                metadata->addImpostorCapture(node);
+            }
+        }
+        else if (node->getLODLevel() > (int) _lods.size()) {
+            VROGeometry *impostor = _impostor->getGeometry().get();
+            impostor->updateSortKeys(node, hierarchyId, hierarchyDepth, lightsHash, lights, opacity,
+                                     distanceFromCamera, zFar, metadata, context, driver);
+            _sortKeys = impostor->_sortKeys;
+            return;
+        }
+    }
 
     size_t numElements = _geometryElements.size();
     for (size_t i = 0; i < numElements; i++) {
@@ -107,20 +251,31 @@ void VROGeometry::updateSortKeys(VRONode *node, uint32_t hierarchyId, uint32_t h
         key.lights = lightsHash;
         key.node = (uintptr_t) node;
         key.elementIndex = (int) i;
-        key.distanceFromCamera = zFar - distanceFromCamera;
         
         std::shared_ptr<VROMaterial> &material = _materials[materialIndex];
         material->updateSortKey(key, lights, context, driver);
+        material->updateTextureScreenSize(screenSize, context.getFrame());
 
         key.transparent = (node->getOpacity() < (1 - kEpsilon) ||
-                           material->getTransparency() < (1 - kEpsilon) ||
-                           material->hasDiffuseAlpha());
+                           material->getRenderedTransparency() < (1 - kEpsilon) ||
+                           material->hasDiffuseAlpha() ||
+                           (material->isCrossfading() && material->getOutgoing()->hasDiffuseAlpha()));
+        
+        // Transparent objects render back to front, opaque objects front to back.
+        // Order-independent transparent objects all take the nearest distance, so
+        // they render last, sorted by state alone
+        if (key.transparent && material->isOrderIndependent()) {
+            key.distanceFromCamera = zFar;
+        } else {
+            key.distanceFromCamera = key.transparent ? zFar - distanceFromCamera : distanceFromCamera;
+        }
         key.incoming = true;
         
         _sortKeys.push_back(key);
         
+        // Cross-fading materials blend their outgoing material in the same draw
         const std::shared_ptr<VROMaterial> &outgoing = material->getOutgoing();
-        if (outgoing) {
+        if (outgoing && !material->isCrossfading()) {
             outgoing->updateSortKey(key, lights, context, driver);
             key.incoming = false;
             
@@ -137,14 +292,25 @@ void VROGeometry::updateSortKeys(VRONode *node, uint32_t hierarchyId, uint32_t h
     }
     
     if (_substrate) {
+        // Process morph target data, if any. Morphers that only changed weights rewrite
+        // their sources in place, so only those buffers need to be re-uploaded; the
+        // substrate is recreated if any sources were added or removed.
         bool updatedMorphSources = false;
-        for (int i = 0; i < _elementsToMorphers.size(); i ++) {
-            if (_elementsToMorphers[i]->update(_geometrySources)){
+        std::vector<std::shared_ptr<VROGeometrySource>> updatedMorphData;
+        for (auto &kv : _elementsToMorphers) {
+            if (kv.second->update(_geometrySources, context.getJobSystem(), &updatedMorphData)) {
+                updatedMorphSources = true;
+            }
+        }
+
+        if (!updatedMorphSources && !updatedMorphData.empty()) {
+            if (_substrate->updateSourceData(updatedMorphData, driver)) {
+                ++_version;
+            } else {
                 updatedMorphSources = true;
             }
         }
 
-        // Process morph target data, if any.
         if (updatedMorphSources) {
             setSources(_geometrySources);
             prewarm(driver);
@@ -154,6 +320,46 @@ void VROGeometry::updateSortKeys(VRONode *node, uint32_t hierarchyId, uint32_t h
     }
 }
 
+void VROGeometry::setLODs(std::vector<VROGeometryLOD> lods) {
+    _lods = lods;
+    for (VROGeometryLOD &lod : _lods) {
+        lod.geometry->setMaterials(_materials);
+    }
+}
+
+VROGeometry *VROGeometry::getGeometryForLOD(int lod) {
+    if (lod <= 0) {
+        return this;
+    }
+    if (lod <= _lods.size()) {
+        return _lods[lod - 1].geometry.get();
+    }
+    if (_impostor && _impostor->getGeometry()) {
+        return _impostor->getGeometry().get();
+    }
+    return _lods.empty() ? this : _lods.back().geometry.get();
+}
+
+int VROGeometry::selectLOD(float screenCoverage, int currentLOD) const {
+    int numLevels = (int) _lods.size();
+    if (_impostor && _impostor->getGeometry()) {
+        numLevels++;
+    }
+    
+    int lod = std::max(0, std::min(currentLOD, numLevels));
+    while (lod < numLevels && screenCoverage < getLODScreenCoverage(lod) * (1 - kLODHysteresis)) {
+        lod++;
+    }
+    while (lod > 0 && screenCoverage > getLODScreenCoverage(lod - 1) * (1 + kLODHysteresis)) {
+        lod--;
+    }
+    return lod;
+}
+
+float VROGeometry::getLODScreenCoverage(int index) const {
+    return index < _lods.size() ? _lods[index].screenCoverage : _impostor->getScreenCoverage();
+}
+
 void VROGeometry::getSortKeys(std::vector<VROSortKey> *outKeys) {
     outKeys->insert(outKeys->end(), _sortKeys.begin(), _sortKeys.end());
 }
@@ -163,18 +369,29 @@ const VROBoundingBox &VROGeometry::getBoundingBox() {
         return _bounds;
     }
     
+    // Nodes in different subtrees may share this geometry, so the parallel transform
+    // pass can get here from several threads at once. The bounds are computed by
+    // one of them, and published only when complete.
+    std::lock_guard<std::mutex> lock(sBoundingBoxMutex);
+    if (_boundingBoxComputed) {
+        return _bounds;
+    }
+    
+    VROBoundingBox bounds = _bounds;
+    bool first = true;
     auto vertexSources = getGeometrySourcesForSemantic(VROGeometrySourceSemantic::Vertex);
     for (std::shared_ptr<VROGeometrySource> &source : vertexSources) {
         VROBoundingBox box = source->getBoundingBox();
         
-        if (!_boundingBoxComputed) {
-            _bounds = box;
-            _boundingBoxComputed = true;
+        if (first) {
+            bounds = box;
+            first = false;
         }
         else {
-            _bounds.unionDestructive(box);
+            bounds.unionDestructive(box);
         }
     }
+    _bounds = bounds;
     _boundingBoxComputed = true;
     return _bounds;
 }
@@ -183,6 +400,26 @@ VROVector3f VROGeometry::getCenter() {
     return getBoundingBox().getCenter();
 }
 
+std::shared_ptr<VROTriangleBVH> VROGeometry::getTriangleBVH() {
+    if (_triangleBVH) {
+        return _triangleBVH;
+    }
+    
+    std::vector<VROTriangle> triangles;
+    std::vector<std::shared_ptr<VROGeometrySource>> vertexSources = getGeometrySourcesForSemantic(VROGeometrySourceSemantic::Vertex);
+    if (!vertexSources.empty()) {
+        for (const std::shared_ptr<VROGeometryElement> &element : _geometryElements) {
+            triangles.reserve(triangles.size() + element->getPrimitiveCount());
+            element->visitTriangles([&triangles](int index, const VROTriangle &triangle) {
+                triangles.push_back(triangle);
+                return true;
+            }, *vertexSources.front());
+        }
+    }
+    _triangleBVH = std::make_shared<VROTriangleBVH>(std::move(triangles));
+    return _triangleBVH;
+}
+
 void VROGeometry::setGeometrySourceForSemantic(VROGeometrySourceSemantic semantic,
                                                std::shared_ptr<VROGeometrySource> source) {
     std::vector<std::shared_ptr<VROGeometrySource>> sources;
@@ -223,11 +460,24 @@ bool VROGeometry::isRenderable() const {
     return false;
 }
 
-void VROGeometry::updateSubstrate() {
-    delete (_substrate);
-    _substrate = nullptr;
+void VROGeometry::updateSubstrate(bool append) {
+    // Dynamic geometries try to keep their substrate, updating it when next rendered
+    if (_dynamic && _substrate) {
+        _dynamicUpdateAppendOnly = append && (!_dynamicUpdatePending || _dynamicUpdateAppendOnly);
+        _dynamicUpdatePending = true;
+    } else {
+        delete (_substrate);
+        _substrate = nullptr;
+    }
+    ++_version;
 }
 
 void VROGeometry::updateBoundingBox(){
     _boundingBoxComputed = false;
 }
+
+void VROGeometry::expandBoundingBox(const VROBoundingBox &box) {
+    if (_boundingBoxComputed) {
+        _bounds.unionDestructive(box);
+    }
+}
@@ -52,8 +52,21 @@ class VROGeometrySource;
 class VROGeometrySubstrate;
 class VROMatrix4f;
 class VROInstancedUBO;
+class VROTriangleBVH;
 class VRORenderMetadata;
+class VROImpostor;
 enum class VROGeometrySourceSemantic;
+class VROGeometry;
+
+/*
+ A simplified version of a geometry, rendered in its place when the geometry
+ covers less than screenCoverage of the viewport's height. A LOD has the same
+ elements as the geometry it simplifies, and is rendered with its materials.
+ */
+struct VROGeometryLOD {
+    std::shared_ptr<VROGeometry> geometry;
+    float screenCoverage;
+};
 
 /*
  Represents a three-dimensional shape, a collection of vertices, normals and texture coordinates
@@ -76,6 +89,10 @@ public:
         _screenSpace(false),
         _boundingBoxComputed(false),
         _substrate(nullptr),
+        _version(0),
+        _dynamic(false),
+        _dynamicUpdatePending(false),
+        _dynamicUpdateAppendOnly(false),
         _instancedUBO(nullptr) {
 
         _bounds = VROBoundingBox();
@@ -90,7 +107,11 @@ public:
         _cameraEnclosure(false),
         _screenSpace(false),
         _boundingBoxComputed(false),
-        _substrate(nullptr) {
+        _substrate(nullptr),
+        _version(0),
+        _dynamic(false),
+        _dynamicUpdatePending(false),
+        _dynamicUpdateAppendOnly(false) {
 
         _bounds = VROBoundingBox();
         ALLOCATION_TRACKER_ADD(Geometry, 1);
@@ -102,7 +123,12 @@ public:
      */
     VROGeometry(std::shared_ptr<VROGeometry> geometry) :
         _geometrySources(geometry->_geometrySources),
-        _geometryElements(geometry->_geometryElements) {
+        _geometryElements(geometry->_geometryElements),
+        _boundingBoxComputed(false),
+        _version(0),
+        _dynamic(false),
+        _dynamicUpdatePending(false),
+        _dynamicUpdateAppendOnly(false) {
         
          ALLOCATION_TRACKER_ADD(Geometry, 1);
     }
@@ -120,6 +146,30 @@ public:
      the geometry will be initialized when it is made visible.
      */
     void prewarm(std::shared_ptr<VRODriver> driver);
+    
+    /*
+     Release the substrate of this geometry, to be rebuilt from its sources the
+     next time it is rendered. Invoked by the VROResidencyManager under memory
+     pressure. Returns false if the geometry had no substrate.
+     */
+    bool evictSubstrate();
+
+    /*
+     Release the CPU copy of this geometry's vertex buffers once they are uploaded
+     (see VROVertexBuffer::setReleasesDataOnHydrate). The bounding box is computed
+     first. Per-triangle hit testing, physics mesh shapes, the geometry cache and
+     scene archives all read vertex data, so this is only for geometry that needs
+     none of them. Sources without vertex buffers are unaffected.
+     */
+    void setReleasesVertexDataOnHydrate(bool releases);
+    
+    /*
+     The last frame in which this geometry was rendered, or -1 if it has not been
+     rendered.
+     */
+    int getLastRenderedFrame() const {
+        return _lastRenderedFrame;
+    }
 
     /*
      Render the given element of the geometry with full texturing and
@@ -128,19 +178,71 @@ public:
      */
     void render(int elementIndex,
                 const std::shared_ptr<VROMaterial> &material,
-                VROMatrix4f transform,
-                VROMatrix4f normalMatrix,
+                const VROMatrix4f &transform,
+                const VROMatrix4f &normalMatrix,
                 float opacity,
                 const VRORenderContext &context,
                 std::shared_ptr<VRODriver> &driver);
     
+    /*
+     Render the given element of the geometry once for each of the given
+     transforms, in as few draw calls as possible. Assumes the material's
+     instanced shader and geometry-independent properties have already been
+     bound.
+     */
+    void renderInstanced(int elementIndex,
+                         const std::shared_ptr<VROMaterial> &material,
+                         const std::vector<VROMatrix4f> &transforms,
+                         const std::vector<VROMatrix4f> &normalMatrices,
+                         float opacity,
+                         const VRORenderContext &context,
+                         std::shared_ptr<VRODriver> &driver);
+    
+    /*
+     True if multiple nodes sharing this geometry can be rendered with a
+     single instanced draw. This excludes geometries that are already
+     instanced (e.g. particles), morphed, or skinned without a baked
+     animation.
+     */
+    bool isAutomaticInstancingSupported() const;
+    
+    /*
+     True if this geometry must be rendered through automatic instancing, even
+     when only one node renders it. Geometries skinned by a baked animation read
+     the animation frame of each node from its instance data.
+     */
+    bool isInstancingRequired() const;
+    
+    /*
+     True if the given element of this geometry can be rendered in the same
+     multi-draw as the given element of the other geometry. Both geometries must
+     have been rendered at least once, and their vertices must share a page of
+     the driver's buffer arena.
+     */
+    bool isMultiDrawCompatibleWith(int elementIndex, const VROGeometry &other, int otherElementIndex) const;
+    
+    /*
+     Render the given element of each of the given geometries, which must
+     begin with this geometry, with a single multi-draw. Assumes the material's
+     instanced shader and geometry-independent properties have already been
+     bound.
+     */
+    void renderMultiDraw(const std::vector<VROGeometry *> &geometries,
+                         const std::vector<int> &elementIndices,
+                         const std::shared_ptr<VROMaterial> &material,
+                         const std::vector<VROMatrix4f> &transforms,
+                         const std::vector<VROMatrix4f> &normalMatrices,
+                         float opacity,
+                         const VRORenderContext &context,
+                         std::shared_ptr<VRODriver> &driver);
+    
     /*
      Render the silhouette of the entire geometry (all elements). Renders
      using the given material, which is assumed to already be bound, ignoring
      texturing and lighting. Typically this is used for rendering to a stencil
      buffer or shadow map.
      */
-    void renderSilhouette(VROMatrix4f transform,
+    void renderSilhouette(const VROMatrix4f &transform,
                           std::shared_ptr<VROMaterial> &material,
                           const VRORenderContext &context,
                           std::shared_ptr<VRODriver> &driver);
@@ -151,7 +253,7 @@ public:
      bound, and binds its associated texture.
      */
     void renderSilhouetteTextured(int element,
-                                  VROMatrix4f transform,
+                                  const VROMatrix4f &transform,
                                   std::shared_ptr<VROMaterial> &material,
                                   const VRORenderContext &context,
                                   std::shared_ptr<VRODriver> &driver);
@@ -170,8 +272,11 @@ public:
     
     virtual void setMaterials(std::vector<std::shared_ptr<VROMaterial>> materials) {
         _materials = materials;
+        for (VROGeometryLOD &lod : _lods) {
+            lod.geometry->setMaterials(materials);
+        }
     }
-    const std::vector<std::shared_ptr<VROMaterial>> &getMaterials() {
+    const std::vector<std::shared_ptr<VROMaterial>> &getMaterials() const {
         return _materials;
     }
        
@@ -193,9 +298,23 @@ public:
      invoked.
      */
     void updateBoundingBox();
+    
+    /*
+     Grow the bounding box to include the given box, if it has already been
+     computed. Used by geometries that only ever add vertices, so that each
+     addition does not recompute the box from all sources.
+     */
+    void expandBoundingBox(const VROBoundingBox &box);
 
     VROVector3f getCenter();
     
+    /*
+     Get the BVH over this geometry's triangles (in model space), used to
+     accelerate hit testing. Built from the vertex source the first time it is
+     accessed, and rebuilt whenever the sources or elements change.
+     */
+    std::shared_ptr<VROTriangleBVH> getTriangleBVH();
+    
     bool isCameraEnclosure() const {
         return _cameraEnclosure;
     }
@@ -255,19 +374,106 @@ public:
     const std::shared_ptr<VROInstancedUBO> &getInstancedUBO() const{
         return _instancedUBO;
     }
+    
+    /*
+     Get the version of this geometry, which changes each time its sources or
+     elements change.
+     */
+    uint32_t getVersion() const {
+        return _version;
+    }
+    
+    /*
+     True if this geometry is deformed by morph targets.
+     */
+    bool hasMorphers() const {
+        return !_elementsToMorphers.empty();
+    }
 
     /*
-     Set the geometry sources and/or elements used by this geometry. Triggers a substrate update.
+     Set the levels of detail of this geometry, in order of decreasing screen
+     coverage. The LODs take on this geometry's materials.
+     */
+    void setLODs(std::vector<VROGeometryLOD> lods);
+    const std::vector<VROGeometryLOD> &getLODs() const {
+        return _lods;
+    }
+    
+    /*
+     Set the impostor that replaces this geometry, below all its LODs, when it
+     covers less than the impostor's screen coverage. The impostor is captured
+     the first time it's needed, and until then the geometry renders at its
+     lowest LOD.
+     */
+    void setImpostor(std::shared_ptr<VROImpostor> impostor) {
+        _impostor = impostor;
+    }
+    const std::shared_ptr<VROImpostor> &getImpostor() const {
+        return _impostor;
+    }
+    
+    /*
+     Get the geometry to render at the given level of detail, where level 0
+     is this geometry itself, and the level past the last LOD is the impostor.
+     */
+    VROGeometry *getGeometryForLOD(int lod);
+    
+    /*
+     Select the level of detail for a node that covers the given fraction of
+     the viewport's height and last rendered the given level. The level only
+     changes once the coverage is past a threshold by a margin, so that nodes
+     hovering at a threshold do not flicker between levels. The level past the
+     last LOD is selected only once the impostor has been captured.
+     */
+    int selectLOD(float screenCoverage, int currentLOD) const;
+
+
+    /*
+     Dynamic geometries are those whose sources and elements are replaced
+     frequently, e.g. every frame. They are uploaded to streaming buffers with
+     room to grow, and new sources and elements are written into those buffers
+     in place, keeping the vertex arrays, so long as their vertex layout is
+     unchanged and they fit. Otherwise the substrate is recreated, as it is for
+     all other geometries.
+     */
+    void setDynamic(bool dynamic) {
+        _dynamic = dynamic;
+    }
+    bool isDynamic() const {
+        return _dynamic;
+    }
+
+    /*
+     Set the geometry sources and/or elements used by this geometry. Triggers a substrate
+     update, which for dynamic geometries happens in place the next time the geometry
+     is rendered.
      */
     void setSources(std::vector<std::shared_ptr<VROGeometrySource>> sources) {
         _geometrySources = sources;
+        _triangleBVH.reset();
         updateSubstrate();
     }
     void setElements(std::vector<std::shared_ptr<VROGeometryElement>> elements) {
         _geometryElements = elements;
+        _triangleBVH.reset();
         updateSubstrate();
     }
     
+    /*
+     Set new sources and elements for this dynamic geometry that extend its
+     current ones: the data of each source and element starts with the bytes
+     of the data it replaces, and only adds to them. The substrate then uploads
+     only the added bytes, so the cost of the update does not grow with the
+     size of the geometry.
+     */
+    void appendSourcesAndElements(std::vector<std::shared_ptr<VROGeometrySource>> sources,
+                                  std::vector<std::shared_ptr<VROGeometryElement>> elements) {
+        _geometrySources = sources;
+        _geometryElements = elements;
+        _triangleBVH.reset();
+        updateSubstrate(true);
+    }
+    
 private:
     /*
      User-assigned name of this geometry.
@@ -313,15 +519,46 @@ private:
     VROBoundingBox _bounds;
 
     /*
-     True if the bounding box for this VROGeometry has been computed.
+     True if the bounding box for this VROGeometry has been computed. Set only
+     once _bounds is complete, since the parallel transform pass may request the
+     bounds of a geometry shared by several subtrees from several threads at once
+     (see getBoundingBox()).
+     */
+    VROAtomic<bool> _boundingBoxComputed;
+    
+    /*
+     Lazily built triangle BVH for hit testing; see getTriangleBVH().
      */
-    bool _boundingBoxComputed;
+    std::shared_ptr<VROTriangleBVH> _triangleBVH;
     
     /*
      Representation of this geometry in the underlying graphics library.
      */
     VROGeometrySubstrate *_substrate;
     
+    /*
+     Incremented each time the substrate is invalidated (see updateSubstrate), so that
+     caches of renderings of this geometry (e.g. cached shadow maps) can detect changes.
+     */
+    uint32_t _version;
+    
+    /*
+     True if this geometry is dynamic (see setDynamic). A pending update means that
+     the sources or elements changed since they were last written to the substrate;
+     it is append-only if every change since then only appended data (see
+     appendSourcesAndElements).
+     */
+    bool _dynamic;
+    bool _dynamicUpdatePending;
+    bool _dynamicUpdateAppendOnly;
+    
+    /*
+     Residency state: the geometry is registered with the VROResidencyManager
+     when its substrate is first created.
+     */
+    int _lastRenderedFrame = -1;
+    bool _residencyTracked = false;
+    
     /*
      The skinner ties this geometry to a skeleton, enabling skeletal animation.
      */
@@ -335,9 +572,16 @@ private:
     
     /*
      Invoke when the substrate needs to be refreshed (typically when underlying
-     geometry sources or elements change).
+     geometry sources or elements change). Append indicates the change only
+     appended data to the sources and elements.
+     */
+    void updateSubstrate(bool append = false);
+    
+    /*
+     The screen coverage below which the level after the given index is
+     selected: that LOD, or the impostor past the last LOD.
      */
-    void updateSubstrate();
+    float getLODScreenCoverage(int index) const;
 
     /*
      If set, this geometry is instanced rendered with the configurations set by this
@@ -350,6 +594,16 @@ private:
      have morphers; elements without a morpher will not be present in this map.
      */
     std::map<int, std::shared_ptr<VROMorpher>> _elementsToMorphers;
+    
+    /*
+     Simplified versions of this geometry, in order of decreasing screen coverage.
+     */
+    std::vector<VROGeometryLOD> _lods;
+    
+    /*
+     Billboard rendered in place of this geometry when it is far away.
+     */
+    std::shared_ptr<VROImpostor> _impostor;
 };
 
 #endif /* VROGeometry_h */
@@ -0,0 +1,418 @@
+//
+//  VROGeometryBufferArena.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROGeometryBufferArena.h"
+#include "VRODriverOpenGL.h"
+#include "VROAllocationTracker.h"
+#include "VROInstancedTransformUBO.h"
+#include "VROGeometryUtil.h"
+#include "VROGPUCullerOpenGL.h"
+#include "VROProfiler.h"
+#include "VROLog.h"
+#include <algorithm>
+#include <iterator>
+
+// Size of each page's vertex and index buffers, in bytes
+static const int kArenaPageVertexBytes = 1024 * 1024;
+static const int kArenaPageIndexBytes = 512 * 1024;
+
+// Maximum number of vertices in a page, so that rebased 16-bit indices fit
+static const int kArenaPageMaxVertices = 65536;
+
+// Divisor of the draw_id attribute, larger than the instance count of any draw
+static const int kDrawIDDivisor = 1 << 16;
+
+#pragma mark - Free List
+
+/*
+ First-fit free list over the units [0, capacity). Adjacent free ranges are
+ merged when freed.
+ */
+class VROArenaFreeList {
+public:
+    VROArenaFreeList(int capacity) {
+        _ranges[0] = capacity;
+    }
+    
+    bool allocate(int size, int alignment, int *outStart) {
+        for (auto it = _ranges.begin(); it != _ranges.end(); ++it) {
+            int rangeStart = it->first;
+            int rangeEnd = it->first + it->second;
+            int start = ((rangeStart + alignment - 1) / alignment) * alignment;
+            if (start + size > rangeEnd) {
+                continue;
+            }
+            
+            // Any alignment padding remains free
+            _ranges.erase(it);
+            if (start > rangeStart) {
+                _ranges[rangeStart] = start - rangeStart;
+            }
+            if (start + size < rangeEnd) {
+                _ranges[start + size] = rangeEnd - (start + size);
+            }
+            *outStart = start;
+            return true;
+        }
+        return false;
+    }
+    
+    void free(int start, int size) {
+        int end = start + size;
+        auto next = _ranges.lower_bound(start);
+        if (next != _ranges.end() && next->first == end) {
+            end += next->second;
+            next = _ranges.erase(next);
+        }
+        if (next != _ranges.begin()) {
+            auto prev = std::prev(next);
+            if (prev->first + prev->second == start) {
+                start = prev->first;
+                _ranges.erase(prev);
+            }
+        }
+        _ranges[start] = end - start;
+    }
+    
+    int getNumRanges() const {
+        return (int) _ranges.size();
+    }
+    
+private:
+    // Start of each free range, mapped to its size
+    std::map<int, int> _ranges;
+};
+
+#pragma mark - Page
+
+class VROGeometryArenaPage {
+public:
+    VROGeometryArenaPage(const VROVertexDescriptorOpenGL &layout, int vertexCapacity) :
+        layout(layout),
+        vertexBuffer(0),
+        indexBuffer(0),
+        vao(0),
+        vertexCapacity(vertexCapacity),
+        vertices(vertexCapacity),
+        indices(kArenaPageIndexBytes),
+        numAllocations(0) {}
+    
+    VROVertexDescriptorOpenGL layout;
+    GLuint vertexBuffer;
+    GLuint indexBuffer;
+    GLuint vao;
+    
+    // Vertices are allocated in units of vertices, indices in bytes
+    int vertexCapacity;
+    VROArenaFreeList vertices;
+    VROArenaFreeList indices;
+    int numAllocations;
+    
+    int getReservedBytes() const {
+        return vertexCapacity * layout.stride + kArenaPageIndexBytes;
+    }
+};
+
+template <typename T>
+static void rebaseIndices(const void *indices, int indexCount, int firstVertex, std::vector<uint8_t> &outIndices) {
+    outIndices.resize(indexCount * sizeof(T));
+    const T *source = (const T *) indices;
+    T *dest = (T *) outIndices.data();
+    for (int i = 0; i < indexCount; i++) {
+        dest[i] = (T) (source[i] + firstVertex);
+    }
+}
+
+#pragma mark - Arena
+
+VROGeometryBufferArena::VROGeometryBufferArena(std::shared_ptr<VRODriverOpenGL> driver,
+                                               PFNGLMULTIDRAWELEMENTSINDIRECTEXTPROC multiDrawElementsIndirect) :
+    _driver(driver),
+    _multiDrawElementsIndirect(multiDrawElementsIndirect),
+    _drawIDBuffer(0),
+    _indirectBuffer(0),
+    _reservedBytes(0),
+    _usedBytes(0) {
+    
+    if (_multiDrawElementsIndirect) {
+        std::vector<GLint> drawIDs(getMaxMultiDrawCommands());
+        for (int i = 0; i < drawIDs.size(); i++) {
+            drawIDs[i] = i;
+        }
+        GL( glGenBuffers(1, &_drawIDBuffer) );
+        GL( glBindBuffer(GL_ARRAY_BUFFER, _drawIDBuffer) );
+        GL( glBufferData(GL_ARRAY_BUFFER, drawIDs.size() * sizeof(GLint), drawIDs.data(), GL_STATIC_DRAW) );
+        GL( glBindBuffer(GL_ARRAY_BUFFER, 0) );
+        
+        GL( glGenBuffers(1, &_indirectBuffer) );
+    }
+}
+
+VROGeometryBufferArena::~VROGeometryBufferArena() {
+    std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
+    for (std::unique_ptr<VROGeometryArenaPage> &page : _pages) {
+        if (driver) {
+            driver->deleteBuffer(page->vertexBuffer);
+            driver->deleteBuffer(page->indexBuffer);
+            driver->deleteVertexArray(page->vao);
+        }
+        ALLOCATION_TRACKER_SUB(VBO, 1);
+    }
+    if (driver && _multiDrawElementsIndirect) {
+        driver->deleteBuffer(_drawIDBuffer);
+        driver->deleteBuffer(_indirectBuffer);
+    }
+}
+
+bool VROGeometryBufferArena::allocate(const VROVertexDescriptorOpenGL &layout, int vertexCount, int indexBytes,
+                                      VROGeometryArenaAllocation *outAllocation) {
+    std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
+    if (!driver || layout.stride == 0 || vertexCount <= 0 || indexBytes <= 0 ||
+        vertexCount * layout.stride > kMaxArenaGeometryVertexBytes || indexBytes > kMaxArenaGeometryIndexBytes) {
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(_mutex);
+    
+    int firstVertex = 0;
+    int indexOffset = 0;
+    VROGeometryArenaPage *page = nullptr;
+    for (std::unique_ptr<VROGeometryArenaPage> &candidate : _pages) {
+        if (!VROIsLayoutCompatible(candidate->layout, layout)) {
+            continue;
+        }
+        if (!candidate->vertices.allocate(vertexCount, 1, &firstVertex)) {
+            continue;
+        }
+        if (!candidate->indices.allocate(indexBytes, 4, &indexOffset)) {
+            candidate->vertices.free(firstVertex, vertexCount);
+            continue;
+        }
+        page = candidate.get();
+        break;
+    }
+    
+    if (!page) {
+        page = createPage(layout, driver);
+        if (!page) {
+            return false;
+        }
+        if (!page->vertices.allocate(vertexCount, 1, &firstVertex) ||
+            !page->indices.allocate(indexBytes, 4, &indexOffset)) {
+            deletePage(page);
+            return false;
+        }
+    }
+    
+    page->numAllocations++;
+    _usedBytes += vertexCount * layout.stride + indexBytes;
+    updateStats();
+    
+    outAllocation->page = page;
+    outAllocation->firstVertex = firstVertex;
+    outAllocation->vertexCount = vertexCount;
+    outAllocation->indexOffset = indexOffset;
+    outAllocation->indexBytes = indexBytes;
+    return true;
+}
+
+void VROGeometryBufferArena::free(const VROGeometryArenaAllocation &allocation) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    
+    VROGeometryArenaPage *page = allocation.page;
+    page->vertices.free(allocation.firstVertex, allocation.vertexCount);
+    page->indices.free(allocation.indexOffset, allocation.indexBytes);
+    page->numAllocations--;
+    _usedBytes -= allocation.vertexCount * page->layout.stride + allocation.indexBytes;
+    
+    // Keep the last page of each layout, so that geometries that are continually
+    // recreated (e.g. updating text) do not recreate the page along with them
+    if (page->numAllocations == 0) {
+        int numLayoutPages = 0;
+        for (std::unique_ptr<VROGeometryArenaPage> &other : _pages) {
+            if (VROIsLayoutCompatible(other->layout, page->layout)) {
+                numLayoutPages++;
+            }
+        }
+        if (numLayoutPages > 1) {
+            deletePage(page);
+        }
+    }
+    updateStats();
+}
+
+void VROGeometryBufferArena::uploadVertices(const VROGeometryArenaAllocation &allocation, const void *data) {
+    const VROGeometryArenaPage *page = allocation.page;
+    
+    GL( glBindBuffer(GL_ARRAY_BUFFER, page->vertexBuffer) );
+    GL( glBufferSubData(GL_ARRAY_BUFFER, allocation.firstVertex * page->layout.stride,
+                        allocation.vertexCount * page->layout.stride, data) );
+    GL( glBindBuffer(GL_ARRAY_BUFFER, 0) );
+}
+
+int VROGeometryBufferArena::uploadIndices(const VROGeometryArenaAllocation &allocation, int offset,
+                                          const void *indices, int indexCount, int bytesPerIndex) {
+    const VROGeometryArenaPage *page = allocation.page;
+    passert (offset + indexCount * bytesPerIndex <= allocation.indexBytes);
+    
+    std::vector<uint8_t> rebased;
+    if (bytesPerIndex == 2) {
+        rebaseIndices<uint16_t>(indices, indexCount, allocation.firstVertex, rebased);
+    } else {
+        rebaseIndices<uint32_t>(indices, indexCount, allocation.firstVertex, rebased);
+    }
+    
+    // Binding the element buffer would modify the bound vertex array
+    std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
+    if (driver) {
+        driver->unbindVertexArray();
+    }
+    GL( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page->indexBuffer) );
+    GL( glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, allocation.indexOffset + offset, rebased.size(), rebased.data()) );
+    GL( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0) );
+    
+    return allocation.indexOffset + offset;
+}
+
+GLuint VROGeometryBufferArena::getVertexArray(const VROGeometryArenaAllocation &allocation) const {
+    return allocation.page->vao;
+}
+
+GLuint VROGeometryBufferArena::getIndexBuffer(const VROGeometryArenaAllocation &allocation) const {
+    return allocation.page->indexBuffer;
+}
+
+int VROGeometryBufferArena::getMaxMultiDrawCommands() const {
+    // Per-draw data is read from the VROInstancedTransformUBO
+    return kMaxInstancesPerUBO;
+}
+
+void VROGeometryBufferArena::multiDraw(GLenum primitiveType, GLenum indexType,
+                                       const VROMultiDrawCommand *commands, int numCommands,
+                                       const VROGPUCullRequest *cull) {
+    passert (_multiDrawElementsIndirect != nullptr);
+    
+    // The buffer is orphaned with each upload, so that we do not wait on
+    // the previous multi-draw
+    GL( glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _indirectBuffer) );
+    GL( glBufferData(GL_DRAW_INDIRECT_BUFFER, numCommands * sizeof(VROMultiDrawCommand), commands, GL_STREAM_DRAW) );
+    if (cull) {
+        cull->culler->cull(_indirectBuffer, cull->objects, numCommands, cull->viewProjection);
+    }
+    GL( _multiDrawElementsIndirect(primitiveType, indexType, nullptr, numCommands, 0) );
+    GL( glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0) );
+    
+    VRO_PROFILE_COUNT(MultiDrawCalls, 1);
+    VRO_PROFILE_COUNT(MultiDrawCommands, numCommands);
+}
+
+VROGeometryArenaPage *VROGeometryBufferArena::createPage(const VROVertexDescriptorOpenGL &layout,
+                                                         std::shared_ptr<VRODriverOpenGL> &driver) {
+    int vertexCapacity = std::min(kArenaPageMaxVertices, kArenaPageVertexBytes / (int) layout.stride);
+    if (vertexCapacity <= 0) {
+        return nullptr;
+    }
+    
+    VROGeometryArenaPage *page = new VROGeometryArenaPage(layout, vertexCapacity);
+    page->layout.buffer = 0;
+    page->layout.ownsBuffer = false;
+    
+    // Unbind the current vertex array so that binding the element buffer does not modify it
+    driver->unbindVertexArray();
+    
+    GL( glGenBuffers(1, &page->vertexBuffer) );
+    GL( glBindBuffer(GL_ARRAY_BUFFER, page->vertexBuffer) );
+    GL( glBufferData(GL_ARRAY_BUFFER, vertexCapacity * layout.stride, nullptr, GL_STATIC_DRAW) );
+    
+    GL( glGenBuffers(1, &page->indexBuffer) );
+    GL( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page->indexBuffer) );
+    GL( glBufferData(GL_ELEMENT_ARRAY_BUFFER, kArenaPageIndexBytes, nullptr, GL_STATIC_DRAW) );
+    
+    GL( glGenVertexArrays(1, &page->vao) );
+    driver->bindVertexArray(page->vao);
+    for (int i = 0; i < layout.numAttributes; i++) {
+        const VROVertexAttributeOpenGL &attribute = layout.attributes[i];
+        if (!attribute.normalized && (attribute.type == GL_INT || attribute.type == GL_SHORT)) {
+            GL( glVertexAttribIPointer(attribute.index, attribute.size, attribute.type, layout.stride,
+                                       (GLvoid *) attribute.offset) );
+        }
+        else {
+            GL( glVertexAttribPointer(attribute.index, attribute.size, attribute.type, attribute.normalized,
+                                      layout.stride, (GLvoid *) attribute.offset) );
+        }
+        GL( glEnableVertexAttribArray(attribute.index) );
+    }
+    if (_multiDrawElementsIndirect) {
+        GL( glBindBuffer(GL_ARRAY_BUFFER, _drawIDBuffer) );
+        GL( glVertexAttribIPointer(kDrawIDAttributeIndex, 1, GL_INT, sizeof(GLint), (GLvoid *) 0) );
+        GL( glVertexAttribDivisor(kDrawIDAttributeIndex, kDrawIDDivisor) );
+        GL( glEnableVertexAttribArray(kDrawIDAttributeIndex) );
+    }
+    GL( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page->indexBuffer) );
+    driver->unbindVertexArray();
+    
+    GL( glBindBuffer(GL_ARRAY_BUFFER, 0) );
+    GL( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0) );
+    
+    ALLOCATION_TRACKER_ADD(VBO, 1);
+    _reservedBytes += page->getReservedBytes();
+    _pages.push_back(std::unique_ptr<VROGeometryArenaPage>(page));
+    
+    pinfo("Created geometry arena page %d for stride %d [%d vertices]", (int) _pages.size(),
+          (int) layout.stride, vertexCapacity);
+    return page;
+}
+
+void VROGeometryBufferArena::deletePage(VROGeometryArenaPage *page) {
+    std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
+    if (driver) {
+        driver->deleteBuffer(page->vertexBuffer);
+        driver->deleteBuffer(page->indexBuffer);
+        driver->deleteVertexArray(page->vao);
+    }
+    ALLOCATION_TRACKER_SUB(VBO, 1);
+    _reservedBytes -= page->getReservedBytes();
+    
+    _pages.erase(std::remove_if(_pages.begin(), _pages.end(),
+                                [page](const std::unique_ptr<VROGeometryArenaPage> &candidate) {
+                                    return candidate.get() == page;
+                                }), _pages.end());
+}
+
+void VROGeometryBufferArena::updateStats() {
+#if TRACK_MEMORY_ALLOCATIONS
+    // Each page has at least one free range until it is full; ranges beyond
+    // that are holes left by freed geometries
+    int fragments = 0;
+    for (std::unique_ptr<VROGeometryArenaPage> &page : _pages) {
+        fragments += std::max(0, page->vertices.getNumRanges() - 1);
+        fragments += std::max(0, page->indices.getNumRanges() - 1);
+    }
+    
+    ALLOCATION_TRACKER_SET(GeometryArenaReserved, _reservedBytes);
+    ALLOCATION_TRACKER_SET(GeometryArenaUsed, _usedBytes);
+    ALLOCATION_TRACKER_SET(GeometryArenaFragments, fragments);
+#endif
+}
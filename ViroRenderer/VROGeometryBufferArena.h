@@ -0,0 +1,207 @@
+//
+//  VROGeometryBufferArena.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROGeometryBufferArena_h
+#define VROGeometryBufferArena_h
+
+#include <map>
+#include <mutex>
+#include <vector>
+#include <memory>
+#include "VROOpenGL.h"
+#include "VROGeometrySubstrateOpenGL.h"
+
+class VRODriverOpenGL;
+class VROGeometryArenaPage;
+struct VROGPUCullRequest;
+
+/*
+ Geometries with more vertex data than this, in bytes, are given their own
+ buffers instead of sharing the arena's.
+ */
+static const int kMaxArenaGeometryVertexBytes = 64 * 1024;
+static const int kMaxArenaGeometryIndexBytes = 64 * 1024;
+
+/*
+ A range of vertices and a range of index bytes, allocated from a single page
+ of the arena.
+ */
+struct VROGeometryArenaAllocation {
+    VROGeometryArenaPage *page;
+    int firstVertex;
+    int vertexCount;
+    int indexOffset;
+    int indexBytes;
+};
+
+/*
+ One command of a multi-draw, in the layout read by glMultiDrawElementsIndirect.
+ */
+typedef struct {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+} VROMultiDrawCommand;
+
+/*
+ VROGeometryBufferArena sub-allocates the vertex and index data of small static
+ geometries (UI quads, text, polylines, small props) from large shared buffers,
+ so that thousands of these geometries do not each need their own buffers and
+ vertex array object.
+ 
+ The arena is made of pages. Each page holds a vertex buffer, an index buffer,
+ and a single VAO, and only holds vertices of one layout (stride and attribute
+ format), so that all geometries in a page draw with the same VAO; consecutive
+ draws of these geometries then skip the vertex array bind. Ranges within a page
+ are managed by free lists, so geometries may be freed in any order.
+ 
+ Each geometry draws its range by offsetting into the page's index buffer.
+ Indices are rebased by the geometry's first vertex when uploaded; pages hold
+ at most 65536 vertices so that rebased 16-bit indices remain in range.
+ 
+ When multi-draw indirect is supported, runs of geometries in the same page
+ can further be drawn with a single glMultiDrawElementsIndirectEXT. Each page
+ VAO then feeds the draw_id attribute from the base instance of each command,
+ sourcing it from a buffer of sequential IDs with a divisor larger than any
+ instance count, so that every instance of a command reads its base instance
+ (and so that non-multi-draws read zero).
+ 
+ Allocations must be made on the rendering thread. Allocations may be freed
+ from any thread.
+ */
+class VROGeometryBufferArena {
+    
+public:
+    
+    /*
+     Create a new arena. The given glMultiDrawElementsIndirectEXT is null if
+     multi-draw indirect is not supported.
+     */
+    VROGeometryBufferArena(std::shared_ptr<VRODriverOpenGL> driver,
+                           PFNGLMULTIDRAWELEMENTSINDIRECTEXTPROC multiDrawElementsIndirect);
+    virtual ~VROGeometryBufferArena();
+    
+    /*
+     Allocate room for the given number of vertices of the given layout, and the
+     given number of index bytes. Returns false if the request cannot fit in a
+     page, in which case the geometry should use its own buffers.
+     */
+    bool allocate(const VROVertexDescriptorOpenGL &layout, int vertexCount, int indexBytes,
+                  VROGeometryArenaAllocation *outAllocation);
+    
+    /*
+     Release the given allocation. Empty pages are deleted, unless they are the
+     last page of their layout.
+     */
+    void free(const VROGeometryArenaAllocation &allocation);
+    
+    /*
+     Upload the vertices of the given allocation. The data must contain
+     allocation.vertexCount vertices, in the layout the allocation was made with.
+     */
+    void uploadVertices(const VROGeometryArenaAllocation &allocation, const void *data);
+    
+    /*
+     Upload indices to the given byte offset within the allocation's index range,
+     rebasing them to the allocation's first vertex. Returns the byte offset of
+     the indices within the page's index buffer, to be passed to glDrawElements.
+     */
+    int uploadIndices(const VROGeometryArenaAllocation &allocation, int offset,
+                      const void *indices, int indexCount, int bytesPerIndex);
+    
+    /*
+     Get the VAO and index buffer of the page containing the given allocation.
+     */
+    GLuint getVertexArray(const VROGeometryArenaAllocation &allocation) const;
+    GLuint getIndexBuffer(const VROGeometryArenaAllocation &allocation) const;
+    
+    /*
+     True if the given allocations are in the same page, and can therefore be
+     drawn with the same multi-draw.
+     */
+    bool isSamePage(const VROGeometryArenaAllocation &a, const VROGeometryArenaAllocation &b) const {
+        return a.page == b.page;
+    }
+    
+    /*
+     Multi-draw support. Commands may select per-draw data through their base
+     instance, which must be less than getMaxMultiDrawCommands(). The VAO of the
+     commands' page must be bound.
+     */
+    bool isMultiDrawSupported() const {
+        return _multiDrawElementsIndirect != nullptr;
+    }
+    int getMaxMultiDrawCommands() const;
+    
+    /*
+     Submit the given commands in one multi-draw. If a cull request is given,
+     the commands are first culled on the GPU, in the indirect buffer.
+     */
+    void multiDraw(GLenum primitiveType, GLenum indexType, const VROMultiDrawCommand *commands, int numCommands,
+                   const VROGPUCullRequest *cull = nullptr);
+    
+private:
+    
+    std::weak_ptr<VRODriverOpenGL> _driver;
+    
+    /*
+     Multi-draw entry point, the buffer of sequential draw IDs read by the
+     draw_id attribute, and the buffer to which commands are written.
+     */
+    PFNGLMULTIDRAWELEMENTSINDIRECTEXTPROC _multiDrawElementsIndirect;
+    GLuint _drawIDBuffer;
+    GLuint _indirectBuffer;
+    
+    /*
+     All pages, across all layouts. Guarded by _mutex, since allocations are freed
+     from any thread.
+     */
+    std::vector<std::unique_ptr<VROGeometryArenaPage>> _pages;
+    std::mutex _mutex;
+    
+    /*
+     Bytes reserved by the arena's buffers, and bytes in use by allocations.
+     */
+    int _reservedBytes;
+    int _usedBytes;
+    
+    /*
+     Create a new page for the given layout. Returns nullptr if the layout's
+     stride is too large to hold any vertices.
+     */
+    VROGeometryArenaPage *createPage(const VROVertexDescriptorOpenGL &layout,
+                                     std::shared_ptr<VRODriverOpenGL> &driver);
+    void deletePage(VROGeometryArenaPage *page);
+    
+    /*
+     Report the arena's memory use and fragmentation to the VROAllocationTracker.
+     */
+    void updateStats();
+    
+};
+
+#endif /* VROGeometryBufferArena_h */
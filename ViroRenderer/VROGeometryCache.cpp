@@ -0,0 +1,427 @@
+//
+//  VROGeometryCache.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROGeometryCache.h"
+#include "VROGeometrySource.h"
+#include "VROGeometryElement.h"
+#include "VROGeometryUtil.h"
+#include "VROVertexBuffer.h"
+#include "VRODriver.h"
+#include "VROData.h"
+#include "VROPlatformUtil.h"
+#include "VROLog.h"
+#include <map>
+#include <algorithm>
+#include <string.h>
+
+static const uint32_t kGeometryCacheMagic = 0x56524f47; // 'VROG'
+static const uint32_t kGeometryCacheVersion = 1;
+
+// Buffer data is aligned so it can be read in place from the mapping
+static const size_t kGeometryCacheBufferAlignment = 16;
+
+struct VROGeometryCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t numBuffers;
+    uint32_t numMeshes;
+};
+
+struct VROGeometryCacheBuffer {
+    uint64_t offset;
+    uint32_t length;
+    uint32_t vertexBuffer;
+};
+
+struct VROGeometryCacheMesh {
+    uint32_t numSources;
+    uint32_t numElements;
+};
+
+struct VROGeometryCacheSource {
+    int32_t buffer;
+    int32_t semantic;
+    int32_t vertexCount;
+    int32_t floatComponents;
+    int32_t componentsPerVertex;
+    int32_t bytesPerComponent;
+    int32_t dataOffset;
+    int32_t dataStride;
+    int32_t elementIndex;
+    int32_t padding;
+};
+
+struct VROGeometryCacheElement {
+    int32_t buffer;
+    int32_t primitiveType;
+    int32_t primitiveCount;
+    int32_t bytesPerIndex;
+    int32_t isSigned;
+    int32_t tag;
+};
+
+VROGeometryCache::VROGeometryCache(std::string directory) :
+    _directory(directory) {
+
+}
+
+VROGeometryCache::~VROGeometryCache() {
+
+}
+
+std::string VROGeometryCache::getPath(uint64_t key) const {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.geo", (unsigned long long) key);
+    return _directory + "/" + name;
+}
+
+#pragma mark - Hashing
+
+uint64_t VROGeometryCache::hash(const void *data, size_t length) {
+    return VROPlatformHashCacheKey(data, length);
+}
+
+uint64_t VROGeometryCache::hash(const void *data, size_t length, uint64_t seed) {
+    return VROPlatformHashCacheKey(data, length, seed);
+}
+
+uint64_t VROGeometryCache::hashFile(std::string path, uint64_t seed) {
+    size_t length = 0;
+    const void *data = VROPlatformMapFile(path, &length);
+    if (!data) {
+        return 0;
+    }
+
+    uint64_t h = hash(data, length, seed);
+    VROPlatformUnmapFile(data, length);
+    return h;
+}
+
+#pragma mark - Instantiating
+
+void VROGeometryCache::instantiateElement(const VROCachedMesh &mesh, int elementIndex,
+                                          std::vector<std::shared_ptr<VROGeometrySource>> &outSources,
+                                          std::vector<std::shared_ptr<VROGeometryElement>> &outElements) {
+    int outElementIndex = (int) outElements.size();
+    outElements.push_back(std::make_shared<VROGeometryElement>(*mesh.elements[elementIndex]));
+
+    for (const std::shared_ptr<VROGeometrySource> &source : mesh.sources) {
+        if (source->getGeometryElementIndex() != elementIndex) {
+            continue;
+        }
+
+        std::shared_ptr<VROGeometrySource> instance;
+        if (source->getVertexBuffer()) {
+            instance = std::make_shared<VROGeometrySource>(source->getVertexBuffer(), source);
+        } else {
+            instance = std::make_shared<VROGeometrySource>(source->getData(), source);
+        }
+        instance->setGeometryElementIndex(outElementIndex);
+        outSources.push_back(instance);
+    }
+}
+
+void VROGeometryCache::instantiateMesh(const VROCachedMesh &mesh,
+                                       std::vector<std::shared_ptr<VROGeometrySource>> &outSources,
+                                       std::vector<std::shared_ptr<VROGeometryElement>> &outElements) {
+    for (const std::shared_ptr<VROGeometrySource> &source : mesh.sources) {
+        std::shared_ptr<VROGeometrySource> instance;
+        if (source->getVertexBuffer()) {
+            instance = std::make_shared<VROGeometrySource>(source->getVertexBuffer(), source);
+        } else {
+            instance = std::make_shared<VROGeometrySource>(source->getData(), source);
+        }
+        instance->setGeometryElementIndex(source->getGeometryElementIndex());
+        outSources.push_back(instance);
+    }
+    for (const std::shared_ptr<VROGeometryElement> &element : mesh.elements) {
+        outElements.push_back(std::make_shared<VROGeometryElement>(*element));
+    }
+}
+
+#pragma mark - Loading
+
+bool VROGeometryCache::loadMeshes(uint64_t key, std::shared_ptr<VRODriver> driver,
+                                  std::vector<VROCachedMesh> *outMeshes) {
+    if (_directory.empty() || key == 0) {
+        return false;
+    }
+
+    // The mapping is released when the last buffer that slices it is destroyed
+    std::string path = getPath(key);
+    std::shared_ptr<VROData> file = VROData::mapFile(path);
+    if (!file) {
+        return false;
+    }
+
+    std::vector<VROCachedMesh> meshes;
+    if (!parseMeshes(file, driver, &meshes)) {
+        pinfo("Discarding corrupt geometry cache file %s", path.c_str());
+        remove(path.c_str());
+        return false;
+    }
+
+    *outMeshes = std::move(meshes);
+    return true;
+}
+
+bool VROGeometryCache::parseMeshes(std::shared_ptr<VROData> file, std::shared_ptr<VRODriver> driver,
+                                   std::vector<VROCachedMesh> *outMeshes) const {
+    const uint8_t *bytes = (const uint8_t *) file->getData();
+    size_t length = (size_t) file->getDataLength();
+    size_t position = 0;
+
+    VROGeometryCacheHeader header;
+    if (length < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, bytes, sizeof(header));
+    position += sizeof(header);
+    if (header.magic != kGeometryCacheMagic || header.version != kGeometryCacheVersion) {
+        return false;
+    }
+
+    // The buffer table: each buffer becomes one VROData slicing the mapping,
+    // and vertex buffers additionally one VBO, shared by every source that uses it
+    if ((length - position) / sizeof(VROGeometryCacheBuffer) < header.numBuffers) {
+        return false;
+    }
+    std::vector<std::shared_ptr<VROData>> buffers;
+    std::vector<std::shared_ptr<VROVertexBuffer>> vertexBuffers;
+    for (uint32_t b = 0; b < header.numBuffers; b++) {
+        VROGeometryCacheBuffer buffer;
+        memcpy(&buffer, bytes + position, sizeof(buffer));
+        position += sizeof(buffer);
+        if (buffer.offset > length || buffer.length > length - buffer.offset) {
+            return false;
+        }
+
+        if (buffer.vertexBuffer && !driver) {
+            return false;
+        }
+
+        std::shared_ptr<VROData> data = std::make_shared<VROData>(file, (int) buffer.offset, (int) buffer.length);
+        buffers.push_back(data);
+        vertexBuffers.push_back(buffer.vertexBuffer ? driver->newVertexBuffer(data) : nullptr);
+    }
+
+    std::vector<VROCachedMesh> meshes(header.numMeshes);
+    for (VROCachedMesh &mesh : meshes) {
+        VROGeometryCacheMesh meshHeader;
+        if (length - position < sizeof(meshHeader)) {
+            return false;
+        }
+        memcpy(&meshHeader, bytes + position, sizeof(meshHeader));
+        position += sizeof(meshHeader);
+
+        for (uint32_t s = 0; s < meshHeader.numSources; s++) {
+            VROGeometryCacheSource record;
+            if (length - position < sizeof(record)) {
+                return false;
+            }
+            memcpy(&record, bytes + position, sizeof(record));
+            position += sizeof(record);
+
+            if (record.buffer < 0 || record.buffer >= (int) buffers.size() ||
+                record.semantic < 0 || record.semantic >= (int) VROGeometrySourceSemantic::Invalid ||
+                record.vertexCount < 0 || record.dataOffset < 0 || record.dataStride < 0 ||
+                record.elementIndex < -1 || record.elementIndex >= (int) meshHeader.numElements) {
+                return false;
+            }
+            int64_t end = (int64_t) record.dataOffset + (int64_t) record.dataStride * std::max(0, record.vertexCount - 1) +
+                          (int64_t) record.componentsPerVertex * record.bytesPerComponent;
+            if (record.vertexCount > 0 && end > buffers[record.buffer]->getDataLength()) {
+                return false;
+            }
+
+            VROGeometrySourceSemantic semantic = (VROGeometrySourceSemantic) record.semantic;
+            std::shared_ptr<VROGeometrySource> source;
+            if (vertexBuffers[record.buffer]) {
+                source = std::make_shared<VROGeometrySource>(vertexBuffers[record.buffer], semantic, record.vertexCount,
+                                                             record.floatComponents != 0, record.componentsPerVertex,
+                                                             record.bytesPerComponent, record.dataOffset, record.dataStride);
+            } else {
+                source = std::make_shared<VROGeometrySource>(buffers[record.buffer], semantic, record.vertexCount,
+                                                             record.floatComponents != 0, record.componentsPerVertex,
+                                                             record.bytesPerComponent, record.dataOffset, record.dataStride);
+            }
+            source->setGeometryElementIndex(record.elementIndex);
+            mesh.sources.push_back(source);
+        }
+
+        for (uint32_t e = 0; e < meshHeader.numElements; e++) {
+            VROGeometryCacheElement record;
+            if (length - position < sizeof(record)) {
+                return false;
+            }
+            memcpy(&record, bytes + position, sizeof(record));
+            position += sizeof(record);
+
+            if (record.buffer < 0 || record.buffer >= (int) buffers.size() ||
+                record.primitiveType < 0 || record.primitiveType > (int) VROGeometryPrimitiveType::Point ||
+                record.primitiveCount < 0 || record.bytesPerIndex <= 0) {
+                return false;
+            }
+            VROGeometryPrimitiveType primitiveType = (VROGeometryPrimitiveType) record.primitiveType;
+            int64_t indexLength = (int64_t) VROGeometryUtilGetIndicesCount(record.primitiveCount, primitiveType) * record.bytesPerIndex;
+            if (indexLength > buffers[record.buffer]->getDataLength()) {
+                return false;
+            }
+
+            mesh.elements.push_back(std::make_shared<VROGeometryElement>(buffers[record.buffer], primitiveType,
+                                                                         record.primitiveCount, record.bytesPerIndex,
+                                                                         record.isSigned != 0));
+            mesh.elementTags.push_back(record.tag);
+        }
+    }
+
+    *outMeshes = std::move(meshes);
+    return true;
+}
+
+#pragma mark - Storing
+
+void VROGeometryCache::storeMeshes(uint64_t key, const std::vector<VROCachedMesh> &meshes) {
+    if (_directory.empty() || key == 0) {
+        return;
+    }
+
+    // Assign each distinct block of data a buffer, in order of first use. Data
+    // used by a VBO is restored into a VBO.
+    std::vector<std::shared_ptr<VROData>> buffers;
+    std::vector<bool> vertexBuffers;
+    std::map<VROData *, int> bufferIndices;
+    auto getBufferIndex = [&buffers, &vertexBuffers, &bufferIndices](std::shared_ptr<VROData> data, bool vertexBuffer) {
+        auto it = bufferIndices.find(data.get());
+        if (it != bufferIndices.end()) {
+            return it->second;
+        }
+        int index = (int) buffers.size();
+        bufferIndices[data.get()] = index;
+        buffers.push_back(data);
+        vertexBuffers.push_back(vertexBuffer);
+        return index;
+    };
+
+    std::vector<VROGeometryCacheMesh> meshRecords;
+    std::vector<VROGeometryCacheSource> sourceRecords;
+    std::vector<VROGeometryCacheElement> elementRecords;
+    for (const VROCachedMesh &mesh : meshes) {
+        meshRecords.push_back({ (uint32_t) mesh.sources.size(), (uint32_t) mesh.elements.size() });
+
+        for (const std::shared_ptr<VROGeometrySource> &source : mesh.sources) {
+            std::shared_ptr<VROVertexBuffer> vbo = source->getVertexBuffer();
+            std::shared_ptr<VROData> data = vbo ? vbo->getData() : source->getData();
+            if (!data) {
+                pwarn("Geometry source without data cannot be cached");
+                return;
+            }
+
+            VROGeometryCacheSource record;
+            record.buffer = getBufferIndex(data, vbo != nullptr);
+            record.semantic = (int32_t) source->getSemantic();
+            record.vertexCount = source->getVertexCount();
+            record.floatComponents = source->isFloatComponents();
+            record.componentsPerVertex = source->getComponentsPerVertex();
+            record.bytesPerComponent = source->getBytesPerComponent();
+            record.dataOffset = source->getDataOffset();
+            record.dataStride = source->getDataStride();
+            record.elementIndex = source->getGeometryElementIndex();
+            record.padding = 0;
+            sourceRecords.push_back(record);
+        }
+
+        for (size_t e = 0; e < mesh.elements.size(); e++) {
+            const std::shared_ptr<VROGeometryElement> &element = mesh.elements[e];
+            if (!element->getData()) {
+                pwarn("Geometry element without data cannot be cached");
+                return;
+            }
+
+            VROGeometryCacheElement record;
+            record.buffer = getBufferIndex(element->getData(), false);
+            record.primitiveType = (int32_t) element->getPrimitiveType();
+            record.primitiveCount = element->getPrimitiveCount();
+            record.bytesPerIndex = element->getBytesPerIndex();
+            record.isSigned = element->isSigned();
+            record.tag = e < mesh.elementTags.size() ? mesh.elementTags[e] : 0;
+            elementRecords.push_back(record);
+        }
+    }
+
+    // Lay out the file: header, buffer table, mesh records (each followed by its
+    // sources and elements), then the buffer data
+    size_t tableLength = sizeof(VROGeometryCacheHeader) + buffers.size() * sizeof(VROGeometryCacheBuffer) +
+                         meshRecords.size() * sizeof(VROGeometryCacheMesh) +
+                         sourceRecords.size() * sizeof(VROGeometryCacheSource) +
+                         elementRecords.size() * sizeof(VROGeometryCacheElement);
+
+    std::vector<VROGeometryCacheBuffer> bufferRecords;
+    size_t fileLength = tableLength;
+    for (size_t b = 0; b < buffers.size(); b++) {
+        fileLength = (fileLength + kGeometryCacheBufferAlignment - 1) & ~(kGeometryCacheBufferAlignment - 1);
+        bufferRecords.push_back({ (uint64_t) fileLength, (uint32_t) buffers[b]->getDataLength(), (uint32_t) vertexBuffers[b] });
+        fileLength += buffers[b]->getDataLength();
+    }
+
+    std::shared_ptr<std::vector<uint8_t>> file = std::make_shared<std::vector<uint8_t>>(fileLength, 0);
+    uint8_t *out = file->data();
+
+    VROGeometryCacheHeader header = { kGeometryCacheMagic, kGeometryCacheVersion, key,
+                                      (uint32_t) buffers.size(), (uint32_t) meshRecords.size() };
+    memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    if (!bufferRecords.empty()) {
+        memcpy(out, bufferRecords.data(), bufferRecords.size() * sizeof(VROGeometryCacheBuffer));
+        out += bufferRecords.size() * sizeof(VROGeometryCacheBuffer);
+    }
+
+    size_t sourceIndex = 0;
+    size_t elementIndex = 0;
+    for (const VROGeometryCacheMesh &meshRecord : meshRecords) {
+        memcpy(out, &meshRecord, sizeof(meshRecord));
+        out += sizeof(meshRecord);
+        for (uint32_t s = 0; s < meshRecord.numSources; s++) {
+            memcpy(out, &sourceRecords[sourceIndex++], sizeof(VROGeometryCacheSource));
+            out += sizeof(VROGeometryCacheSource);
+        }
+        for (uint32_t e = 0; e < meshRecord.numElements; e++) {
+            memcpy(out, &elementRecords[elementIndex++], sizeof(VROGeometryCacheElement));
+            out += sizeof(VROGeometryCacheElement);
+        }
+    }
+
+    for (size_t b = 0; b < buffers.size(); b++) {
+        memcpy(file->data() + bufferRecords[b].offset, buffers[b]->getData(), bufferRecords[b].length);
+    }
+    writeFile(getPath(key), file);
+}
+
+void VROGeometryCache::writeFile(std::string path, std::shared_ptr<std::vector<uint8_t>> buffer) {
+    VROPlatformDispatchAsyncWorker([path, buffer] {
+        VROPlatformWriteCacheFile(path, buffer->data(), buffer->size());
+    }, VROTaskPriority::Low);
+}
@@ -0,0 +1,139 @@
+//
+//  VROGeometryCache.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROGeometryCache_h
+#define VROGeometryCache_h
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <stdint.h>
+
+class VRODriver;
+class VROData;
+class VROGeometrySource;
+class VROGeometryElement;
+
+/*
+ The processed geometry of one mesh, as stored in the VROGeometryCache: its
+ sources and elements exactly as they are handed to VROGeometry. Each element
+ may carry a tag whose meaning is defined by the loader (e.g. the index of
+ the material the element is drawn with).
+ */
+struct VROCachedMesh {
+    std::vector<std::shared_ptr<VROGeometrySource>> sources;
+    std::vector<std::shared_ptr<VROGeometryElement>> elements;
+    std::vector<int> elementTags;
+};
+
+/*
+ Persists the processed geometry of 3D models to disk, so that subsequent
+ loads of the same model can skip building vertex data (de-indexing,
+ interleaving, tangent generation, and so on). All meshes of a model are
+ stored in one file, keyed by a hash of the model's source data computed
+ by the loader (see hash()).
+
+ Vertex and index buffers are stored uncompressed and aligned, and
+ cache files are memory mapped when loaded: the loaded sources and elements
+ read directly from the mapping. Buffers shared by several sources, or by
+ several meshes, are stored once and remain shared when loaded. Files are
+ written on a background thread, and written in full or not at all.
+
+ Materials, skeletons, and animations are not cached; loaders continue to
+ build them from the source model.
+
+ Methods may be invoked from any thread.
+ */
+class VROGeometryCache {
+public:
+
+    /*
+     Hash the given bytes, continuing from the given seed. Loaders combine the
+     hashes of everything their processed geometry depends on into a key. This
+     is the shared cache key hash (see VROPlatformHashCacheKey).
+     */
+    static uint64_t hash(const void *data, size_t length, uint64_t seed);
+    static uint64_t hash(const void *data, size_t length);
+
+    /*
+     Hash the contents of the file at the given path. Returns 0 if the file
+     cannot be read.
+     */
+    static uint64_t hashFile(std::string path, uint64_t seed);
+
+    /*
+     Append to the given vectors new sources and elements that share the data
+     of the given cached mesh, so that one cached mesh can back any number of
+     geometries. The first variant appends only the given element and the
+     sources bound to it; the second appends the entire mesh.
+     */
+    static void instantiateElement(const VROCachedMesh &mesh, int elementIndex,
+                                   std::vector<std::shared_ptr<VROGeometrySource>> &outSources,
+                                   std::vector<std::shared_ptr<VROGeometryElement>> &outElements);
+    static void instantiateMesh(const VROCachedMesh &mesh,
+                                std::vector<std::shared_ptr<VROGeometrySource>> &outSources,
+                                std::vector<std::shared_ptr<VROGeometryElement>> &outElements);
+
+    VROGeometryCache(std::string directory);
+    virtual ~VROGeometryCache();
+
+    /*
+     Load the meshes stored under the given key. Sources that were stored from
+     vertex buffers are loaded into new vertex buffers created by the given
+     driver (which may be null if no such sources were stored). Returns false
+     if the key is not cached.
+     */
+    bool loadMeshes(uint64_t key, std::shared_ptr<VRODriver> driver,
+                    std::vector<VROCachedMesh> *outMeshes);
+
+    /*
+     Store the given meshes under the given key. The data of the meshes is
+     copied before returning, so the meshes may be used freely afterward.
+     */
+    void storeMeshes(uint64_t key, const std::vector<VROCachedMesh> &meshes);
+
+private:
+
+    /*
+     The directory in which meshes are stored. Created on each store.
+     */
+    std::string _directory;
+
+    std::string getPath(uint64_t key) const;
+
+    /*
+     Parse the mapped file into meshes. Returns false if the file is corrupt.
+     */
+    bool parseMeshes(std::shared_ptr<VROData> file, std::shared_ptr<VRODriver> driver,
+                     std::vector<VROCachedMesh> *outMeshes) const;
+
+    /*
+     Write the given buffer to the given path on a background thread.
+     */
+    void writeFile(std::string path, std::shared_ptr<std::vector<uint8_t>> buffer);
+
+};
+
+#endif /* VROGeometryCache_h */
@@ -25,78 +25,68 @@
 //  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "VROGeometryElement.h"
-#include "VROByteBuffer.h"
 #include "VROGeometrySource.h"
 #include "VROLog.h"
 #include "VROMath.h"
+#include "VROMeshOptimizer.h"
 
 void VROGeometryElement::processTriangles(std::function<void(int index, VROTriangle triangle)> function,
                                           std::shared_ptr<VROGeometrySource> geometrySource) const {
-    
-    std::vector<VROVector3f> vertices;
-    geometrySource->processVertices([&vertices](int index, VROVector4f vertex) {
-        vertices.push_back(VROVector3f(vertex.x, vertex.y, vertex.z));
-    });
-    
-    VROVector3f A, B, C;
-
-    if (_primitiveType == VROGeometryPrimitiveType::Triangle) {
-        processIndices([&vertices, &A, &B, &C, function](int index, int indexRead) {
-            if (index % 3 == 0) {
-                A = vertices[indexRead];
-            }
-            if (index % 3 == 1) {
-                B = vertices[indexRead];
-            }
-            if (index % 3 == 2) {
-                C = vertices[indexRead];
-                function(index / 3, {A, B, C});
-            }
-        });
-    }
-    else if (_primitiveType == VROGeometryPrimitiveType::TriangleStrip) {
-        processIndices([&vertices, &A, &B, &C, function](int index, int indexRead) {
-            if (index == 0) {
-                A = vertices[indexRead];
-            }
-            else if (index == 1) {
-                B = vertices[indexRead];
-            }
-            else {
-                C = vertices[indexRead];
-                function(index / 3, {A, B, C});
-                
-                A = B;
-                B = C;
-            }
-        });
-    }
+    visitTriangles([&function](int index, const VROTriangle &triangle) {
+        function(index, triangle);
+        return true;
+    }, *geometrySource);
 }
 
 void VROGeometryElement::processIndices(std::function<void (int, int)> function) const {
-    VROByteBuffer buffer(_data->getData(), _data->getDataLength(), false);
+    visitIndices([&function](int index, int indexRead) {
+        function(index, indexRead);
+        return true;
+    });
+}
+
+void VROGeometryElement::optimizeTriangleOrder(std::shared_ptr<VROGeometrySource> positions) {
+    if (_primitiveType != VROGeometryPrimitiveType::Triangle || _primitiveCount <= 0 || !_data ||
+        (_bytesPerIndex != 2 && _bytesPerIndex != 4)) {
+        return;
+    }
     
-    //TODO Support all primitive types!
-    if (_primitiveType != VROGeometryPrimitiveType::Triangle) {
+    std::vector<uint32_t> indices;
+    uint32_t maxIndex = 0;
+    indices.reserve(_primitiveCount * 3);
+    bool valid = visitIndices([&indices, &maxIndex](int index, int indexRead) {
+        if (indexRead < 0) {
+            return false;
+        }
+        indices.push_back((uint32_t) indexRead);
+        maxIndex = std::max(maxIndex, (uint32_t) indexRead);
+        return true;
+    });
+    if (!valid) {
         return;
     }
     
-    int indexCount = _primitiveCount * 3;
+    std::vector<int> hardBoundaries;
+    std::vector<uint32_t> optimized = VROMeshOptimizer::optimizeVertexCache(indices, maxIndex + 1, &hardBoundaries);
+    if (positions) {
+        std::vector<VROVector3f> vertices;
+        vertices.reserve(positions->getVertexCount());
+        positions->visitVertices([&vertices](int index, const VROVector4f &vertex) {
+            vertices.push_back(VROVector3f(vertex.x, vertex.y, vertex.z));
+            return true;
+        });
+        VROMeshOptimizer::optimizeOverdraw(optimized, hardBoundaries, vertices);
+    }
     
-    for (int i = 0; i < indexCount; i++) {
-        buffer.setPosition(i * _bytesPerIndex);
-        int idx;
-        if (_bytesPerIndex == 2) {
-            idx = _signed ? buffer.readShort() : buffer.readUnsignedShort();
-        }
-        else if (_bytesPerIndex == 4) {
-            idx = buffer.readInt();
+    // Indices keep their width, so signed 16-bit data is written back unchanged
+    int length = (int) optimized.size() * _bytesPerIndex;
+    void *data = malloc(length);
+    if (_bytesPerIndex == 2) {
+        for (size_t i = 0; i < optimized.size(); i++) {
+            ((uint16_t *) data)[i] = (uint16_t) optimized[i];
         }
-        else {
-            pabort("Invalid bytes per index %d", _bytesPerIndex);
-        }
-        
-        function(i, idx);
+    } else {
+        memcpy(data, optimized.data(), length);
     }
+    _data = std::make_shared<VROData>(data, length, VRODataOwnership::Move);
 }
-
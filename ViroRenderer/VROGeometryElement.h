@@ -28,11 +28,13 @@
 #define VROGeometryElement_h
 
 #include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <memory>
 #include <functional>
 #include "VROData.h"
+#include "VROLog.h"
 #include "VROTriangle.h"
 
 class VROGeometrySource;
@@ -69,7 +71,8 @@ public:
     VROGeometryElement() : _primitiveType(VROGeometryPrimitiveType::Triangle),
                            _primitiveCount(0),
                            _data(nullptr),
-                           _bytesPerIndex(sizeof(int))
+                           _bytesPerIndex(sizeof(int)),
+                           _signed(true)
     {}
 
     void setData(std::shared_ptr<VROData> data) {
@@ -99,6 +102,9 @@ public:
     int getBytesPerIndex() const {
         return _bytesPerIndex;
     }
+    bool isSigned() const {
+        return _signed;
+    }
     
     /*
      Read through the indices in this element, read the corresponding vertices
@@ -113,8 +119,77 @@ public:
      */
     void processIndices(std::function<void(int index, int indexRead)> function) const;
     
+    /*
+     Inlinable versions of processTriangles and processIndices, for hot loops.
+     The visitor is invoked as visitor(int index, const VROTriangle &triangle)
+     or visitor(int index, int indexRead) respectively, and returns false to
+     stop the traversal. The index buffer is read in place by index width, and
+     32-bit float positions are read in place by stride. Both return false if
+     the visitor stopped early. visitTriangles is defined in VROGeometrySource.h.
+     */
+    template <typename Visitor>
+    bool visitTriangles(Visitor &&visitor, const VROGeometrySource &geometrySource) const;
+    template <typename Visitor>
+    bool visitIndices(Visitor &&visitor) const {
+        //TODO Support all primitive types!
+        if (_primitiveType != VROGeometryPrimitiveType::Triangle) {
+            return true;
+        }
+        const char *indices = getIndexData();
+        int indexCount = _primitiveCount * 3;
+        for (int i = 0; i < indexCount; i++) {
+            if (!visitor(i, readIndex(indices, i))) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    /*
+     Reorder the triangles of this element for the GPU's post-transform vertex
+     cache, and then (if positions are provided) to reduce overdraw. This only
+     permutes triangles, which keep their winding, so the element draws the
+     same surface. Elements other than 16 or 32-bit triangle lists are left
+     unchanged. See VROMeshOptimizer.
+     */
+    void optimizeTriangleOrder(std::shared_ptr<VROGeometrySource> positions);
+    
 private:
     
+    /*
+     The start of the index data, validating the index width.
+     */
+    const char *getIndexData() const {
+        if (_bytesPerIndex != 2 && _bytesPerIndex != 4) {
+            pabort("Invalid bytes per index %d", _bytesPerIndex);
+        }
+        return (const char *) _data->getData();
+    }
+    
+    /*
+     Read the i'th index from the given index data. Indices may be unaligned
+     within their buffer, so they are copied out rather than dereferenced.
+     */
+    int readIndex(const char *indices, int i) const {
+        if (_bytesPerIndex == 2) {
+            if (_signed) {
+                int16_t index;
+                memcpy(&index, indices + i * 2, sizeof(index));
+                return index;
+            }
+            else {
+                uint16_t index;
+                memcpy(&index, indices + i * 2, sizeof(index));
+                return index;
+            }
+        }
+        else {
+            int32_t index;
+            memcpy(&index, indices + i * 4, sizeof(index));
+            return index;
+        }
+    }
+    
     /*
      The type of the primitives we should create from the associated geometry
      source using the indices in this element.
@@ -320,7 +320,7 @@ VROBoundingBox VROGeometrySource::getBoundingBox() const {
     float minZ =  FLT_MAX;
     float maxZ = -FLT_MAX;
     
-    processVertices([&minX, &maxX, &minY, &maxY, &minZ, &maxZ](int index, VROVector4f vertex) {
+    visitVertices([&minX, &maxX, &minY, &maxY, &minZ, &maxZ](int index, const VROVector4f &vertex) {
         if (vertex.x < minX) {
             minX = vertex.x;
         }
@@ -339,6 +339,7 @@ VROBoundingBox VROGeometrySource::getBoundingBox() const {
         if (vertex.z > maxZ) {
             maxZ = vertex.z;
         }
+        return true;
     });
     
     return VROBoundingBox(minX, maxX, minY, maxY, minZ, maxZ);
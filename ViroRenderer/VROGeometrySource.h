@@ -29,10 +29,13 @@
 
 #include <stdio.h>
 #include <memory>
+#include <vector>
+#include <algorithm>
 #include <functional>
 #include "VROData.h"
 #include "VROBoundingBox.h"
 #include "VROGeometryElement.h"
+#include "VROVector4f.h"
 
 enum class VROGeometrySourceSemantic {
     Vertex,
@@ -172,6 +175,44 @@ public:
      */
     void processVertices(std::function<void(int index, VROVector4f vertex)> function) const;
     
+    /*
+     Inlinable version of processVertices, for hot loops. The visitor is invoked
+     as visitor(int index, const VROVector4f &vertex) and returns false to stop
+     the traversal. 32-bit float sources are read in place by stride; other
+     formats are decoded through processVertices. Returns false if the visitor
+     stopped early.
+     */
+    template <typename Visitor>
+    bool visitVertices(Visitor &&visitor) const {
+        std::shared_ptr<VROData> data = getData();
+        if (isFloat32()) {
+            const char *vertex = (const char *) data->getData() + _dataOffset;
+            int components = std::min(_componentsPerVertex, 4);
+            for (int i = 0; i < _vertexCount; i++, vertex += _dataStride) {
+                float v[4] = { 0, 0, 0, 0 };
+                memcpy(v, vertex, components * sizeof(float));
+                if (!visitor(i, VROVector4f(v[0], v[1], v[2], v[3]))) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        
+        bool stopped = false;
+        processVertices([&visitor, &stopped](int index, VROVector4f vertex) {
+            stopped = stopped || !visitor(index, vertex);
+        });
+        return !stopped;
+    }
+    
+    /*
+     True if this source's components are 32-bit floats, which the visit
+     functions read in place.
+     */
+    bool isFloat32() const {
+        return _floatComponents && _bytesPerComponent == 4;
+    }
+    
     /*
      Read through all vertices in this data source and modify them.
      */
@@ -239,4 +280,47 @@ private:
     int _geoElementIndex = -1;
 };
 
+template <typename Visitor>
+bool VROGeometryElement::visitTriangles(Visitor &&visitor, const VROGeometrySource &geometrySource) const {
+    //TODO Support all primitive types!
+    if (_primitiveType != VROGeometryPrimitiveType::Triangle) {
+        return true;
+    }
+    const char *indices = getIndexData();
+    
+    // Read 32-bit float positions in place; decode anything else once up front
+    const char *positions = nullptr;
+    int stride = geometrySource.getDataStride();
+    std::vector<VROVector3f> decoded;
+    std::shared_ptr<VROData> data = geometrySource.getData();
+    if (geometrySource.isFloat32() && geometrySource.getComponentsPerVertex() >= 3) {
+        positions = (const char *) data->getData() + geometrySource.getDataOffset();
+    }
+    else {
+        decoded.reserve(geometrySource.getVertexCount());
+        geometrySource.visitVertices([&decoded](int index, const VROVector4f &vertex) {
+            decoded.push_back({ vertex.x, vertex.y, vertex.z });
+            return true;
+        });
+    }
+    auto position = [positions, stride, &decoded](int index) {
+        if (positions) {
+            float v[3];
+            memcpy(v, positions + index * stride, sizeof(v));
+            return VROVector3f(v[0], v[1], v[2]);
+        }
+        return decoded[index];
+    };
+    
+    for (int t = 0; t < _primitiveCount; t++) {
+        VROTriangle triangle(position(readIndex(indices, t * 3)),
+                             position(readIndex(indices, t * 3 + 1)),
+                             position(readIndex(indices, t * 3 + 2)));
+        if (!visitor(t, triangle)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 #endif /* VROGeometrySource_h */
@@ -30,6 +30,8 @@
 #include <stdio.h>
 #include <vector>
 #include <memory>
+#include "VROMatrix4f.h"
+#include "VROBoundingBox.h"
 
 class VROLight;
 class VRORenderContext;
@@ -39,6 +41,7 @@ class VROMaterial;
 class VROGeometry;
 class VROMaterial;
 class VROTexture;
+class VROGeometrySource;
 
 /*
  Represents the geometry in the underlying graphics hardware.
@@ -55,6 +58,31 @@ public:
      */
     virtual void update(const VROGeometry &geometry,
                         std::shared_ptr<VRODriver> &driver) = 0;
+
+    /*
+     Re-upload the data of the given sources, which must already be part of this
+     substrate, without otherwise changing the vertex layout. Used for sources
+     whose data is rewritten every frame (e.g. CPU morph targets). Returns false
+     if the data could not be updated in place, in which case the substrate
+     must be recreated.
+     */
+    virtual bool updateSourceData(const std::vector<std::shared_ptr<VROGeometrySource>> &sources,
+                                  std::shared_ptr<VRODriver> &driver) {
+        return false;
+    }
+    
+    /*
+     Re-upload all sources and elements of the given dynamic geometry (see
+     VROGeometry::setDynamic) in place. If appendOnly is true, the data only
+     grew since it was last uploaded, so only the added bytes need be written.
+     Returns false if this substrate was not created for a dynamic geometry,
+     or if the new sources and elements do not match its vertex layout or fit
+     its buffers, in which case the substrate must be recreated.
+     */
+    virtual bool updateGeometry(const VROGeometry &geometry, bool appendOnly,
+                                std::shared_ptr<VRODriver> &driver) {
+        return false;
+    }
     
     /*
      Render the given element of the geometry with full texturing and
@@ -63,13 +91,64 @@ public:
      */
     virtual void render(const VROGeometry &geometry,
                         int elementIndex,
-                        VROMatrix4f transform,
-                        VROMatrix4f normalMatrix,
+                        const VROMatrix4f &transform,
+                        const VROMatrix4f &normalMatrix,
                         float opacity,
                         const std::shared_ptr<VROMaterial> &material,
                         const VRORenderContext &context,
                         std::shared_ptr<VRODriver> &driver) = 0;
     
+    /*
+     Render the given element of the geometry once for each of the given
+     transforms. Assumes the material's instanced shader (see
+     VROMaterial::bindInstancedShader) and geometry-independent properties have
+     already been bound. The default implementation renders each instance
+     separately.
+     */
+    virtual void renderInstanced(const VROGeometry &geometry,
+                                 int elementIndex,
+                                 const std::vector<VROMatrix4f> &transforms,
+                                 const std::vector<VROMatrix4f> &normalMatrices,
+                                 float opacity,
+                                 const std::shared_ptr<VROMaterial> &material,
+                                 const VRORenderContext &context,
+                                 std::shared_ptr<VRODriver> &driver) {
+        for (size_t i = 0; i < transforms.size(); i++) {
+            render(geometry, elementIndex, transforms[i], normalMatrices[i], opacity, material, context, driver);
+        }
+    }
+    
+    /*
+     True if the given element of this substrate can be rendered in the same
+     multi-draw as the given element of the other substrate (see
+     renderMultiDraw).
+     */
+    virtual bool isMultiDrawCompatible(int elementIndex, const VROGeometrySubstrate &other,
+                                       int otherElementIndex) const {
+        return false;
+    }
+    
+    /*
+     Render the given element of each of the given substrates, each with its
+     own transform, in a single multi-draw. This substrate must be the first of
+     the substrates, and the given geometry its geometry; all substrates must be
+     multi-draw compatible with it. Assumes the material's instanced shader and
+     geometry-independent properties have already been bound.
+     
+     The local bounds of each substrate's geometry are given so that draws may
+     be culled on the GPU.
+     */
+    virtual void renderMultiDraw(const VROGeometry &geometry,
+                                 const std::vector<VROGeometrySubstrate *> &substrates,
+                                 const std::vector<VROBoundingBox> &bounds,
+                                 const std::vector<int> &elementIndices,
+                                 const std::vector<VROMatrix4f> &transforms,
+                                 const std::vector<VROMatrix4f> &normalMatrices,
+                                 float opacity,
+                                 const std::shared_ptr<VROMaterial> &material,
+                                 const VRORenderContext &context,
+                                 std::shared_ptr<VRODriver> &driver) {}
+    
     /*
      Render the silhouette of the entire geometry (all elements). Renders
      using the given material, which is assumed to already be bound, ignoring
@@ -77,7 +156,7 @@ public:
      buffer or shadow map.
      */
     virtual void renderSilhouette(const VROGeometry &geometry,
-                                  VROMatrix4f transform,
+                                  const VROMatrix4f &transform,
                                   std::shared_ptr<VROMaterial> &material,
                                   const VRORenderContext &context,
                                   std::shared_ptr<VRODriver> &driver) = 0;
@@ -89,7 +168,7 @@ public:
      */
     virtual void renderSilhouetteTextured(const VROGeometry &geometry,
                                           int element,
-                                          VROMatrix4f transform,
+                                          const VROMatrix4f &transform,
                                           std::shared_ptr<VROMaterial> &material,
                                           const VRORenderContext &context,
                                           std::shared_ptr<VRODriver> &driver) = 0;
@@ -149,7 +149,6 @@ void VROGeometrySubstrateMetal::readGeometrySources(id <MTLDevice> device,
 void VROGeometrySubstrateMetal::updatePipelineStates(const VROGeometry &geometry,
                                                      VRODriverMetal &driver) {
     
-    id <MTLDevice> device = driver.getDevice();
     const std::vector<std::shared_ptr<VROMaterial>> &materials = geometry.getMaterials();
     
     for (int i = 0; i < _elements.size(); i++) {
@@ -159,65 +158,24 @@ void VROGeometrySubstrateMetal::updatePipelineStates(const VROGeometry &geometry
         id <MTLRenderPipelineState> pipelineState = createRenderPipelineState(material, driver);
         _elementPipelineStates.push_back(pipelineState);
         
-        id <MTLDepthStencilState> depthStencilState = createDepthStencilState(material, device);
+        id <MTLDepthStencilState> depthStencilState = createDepthStencilState(material, driver);
         _elementDepthStates.push_back(depthStencilState);
     }
 }
 
 id <MTLRenderPipelineState> VROGeometrySubstrateMetal::createRenderPipelineState(const std::shared_ptr<VROMaterial> &material,
                                                                                  VRODriverMetal &driver) {
-    
-    id <MTLDevice> device = driver.getDevice();
     std::shared_ptr<VRORenderTarget> renderTarget = driver.getRenderTarget();
-    
     VROMaterialSubstrateMetal *substrate = static_cast<VROMaterialSubstrateMetal *>(material->getSubstrate(driver));
     
-    MTLRenderPipelineDescriptor *pipelineStateDescriptor = [[MTLRenderPipelineDescriptor alloc] init];
-    pipelineStateDescriptor.label = @"VROLayerPipeline";
-    pipelineStateDescriptor.sampleCount = renderTarget->getSampleCount();
-    pipelineStateDescriptor.vertexFunction = substrate->getVertexProgram();
-    pipelineStateDescriptor.fragmentFunction = substrate->getFragmentProgram();
-    pipelineStateDescriptor.vertexDescriptor = _vertexDescriptor;
-    pipelineStateDescriptor.colorAttachments[0].pixelFormat = renderTarget->getColorPixelFormat();
-    pipelineStateDescriptor.colorAttachments[0].blendingEnabled = YES;
-    pipelineStateDescriptor.colorAttachments[0].rgbBlendOperation = MTLBlendOperationAdd;
-    pipelineStateDescriptor.colorAttachments[0].alphaBlendOperation = MTLBlendOperationAdd;
-    pipelineStateDescriptor.colorAttachments[0].sourceRGBBlendFactor = MTLBlendFactorSourceAlpha;
-    pipelineStateDescriptor.colorAttachments[0].sourceAlphaBlendFactor = MTLBlendFactorSourceAlpha;
-    pipelineStateDescriptor.colorAttachments[0].destinationRGBBlendFactor = MTLBlendFactorOneMinusSourceAlpha;
-    pipelineStateDescriptor.colorAttachments[0].destinationAlphaBlendFactor = MTLBlendFactorOneMinusSourceAlpha;
-    pipelineStateDescriptor.depthAttachmentPixelFormat = renderTarget->getDepthStencilPixelFormat();
-    pipelineStateDescriptor.stencilAttachmentPixelFormat = renderTarget->getDepthStencilPixelFormat();
-    
-    NSError *error = NULL;
-    id <MTLRenderPipelineState> pipelineState = [device newRenderPipelineStateWithDescriptor:pipelineStateDescriptor
-                                                                                       error:&error];
-    if (!pipelineState) {
-        NSLog(@"Failed to created pipeline state, error %@", error);
-    }
-    return  pipelineState;
+    return driver.getRenderPipelineState(substrate->getVertexProgram(), substrate->getFragmentProgram(),
+                                         _vertexDescriptor, renderTarget->getColorPixelFormat(),
+                                         renderTarget->getDepthStencilPixelFormat(), renderTarget->getSampleCount());
 }
 
 id <MTLDepthStencilState> VROGeometrySubstrateMetal::createDepthStencilState(const std::shared_ptr<VROMaterial> &material,
-                                                                             id <MTLDevice> device) {
-    
-    MTLDepthStencilDescriptor *depthStateDesc = [[MTLDepthStencilDescriptor alloc] init];
-    depthStateDesc.depthWriteEnabled = material->getWritesToDepthBuffer();
-    
-    if (material->getReadsFromDepthBuffer()) {
-        /*
-         Using LessEqual ensures that outgoing material transitions work correctly,
-         in that we can render the same face twice (once outgoing, once incoming), and
-         the incoming will not fail the depth test despite having the same depth as
-         the outgoing.
-         */
-        depthStateDesc.depthCompareFunction = MTLCompareFunctionLessEqual;
-    }
-    else {
-        depthStateDesc.depthCompareFunction = MTLCompareFunctionAlways;
-    }
-    
-    return [device newDepthStencilStateWithDescriptor:depthStateDesc];
+                                                                             VRODriverMetal &driver) {
+    return driver.getDepthStencilState(material->getWritesToDepthBuffer(), material->getReadsFromDepthBuffer());
 }
 
 MTLVertexFormat VROGeometrySubstrateMetal::parseVertexFormat(std::shared_ptr<VROGeometrySource> &source) {
@@ -332,7 +290,7 @@ void VROGeometrySubstrateMetal::render(const VROGeometry &geometry,
      */
     if (material->isUpdated()) {
         _elementPipelineStates[elementIndex] = createRenderPipelineState(material, metal);
-        _elementDepthStates[elementIndex] = createDepthStencilState(material, metal.getDevice());
+        _elementDepthStates[elementIndex] = createDepthStencilState(material, metal);
     }
     
     VROMaterialSubstrateMetal *substrate = static_cast<VROMaterialSubstrateMetal *>(material->getSubstrate(driver));
@@ -132,16 +132,17 @@ private:
                               VRODriverMetal &driver);
     
     /*
-     Create a pipeline state from the given material, using the current _vertexDescriptor.
+     Get the pipeline state for the given material and the current _vertexDescriptor,
+     from the driver's cache.
      */
     id <MTLRenderPipelineState> createRenderPipelineState(const std::shared_ptr<VROMaterial> &material,
                                                           VRODriverMetal &driver);
     
     /*
-     Create a depth/stencil state from the given material.
+     Get the depth/stencil state for the given material, from the driver's cache.
      */
     id <MTLDepthStencilState> createDepthStencilState(const std::shared_ptr<VROMaterial> &material,
-                                                      id <MTLDevice> device);
+                                                      VRODriverMetal &driver);
     
     /*
      Parse an MTLVertexFormat from the given geometry source.
@@ -32,16 +32,168 @@
 #include "VROGeometryUtil.h"
 #include "VROLog.h"
 #include "VROBoneUBO.h"
+#include "VROSkinningCache.h"
+#include "VROSkinner.h"
 #include "VROInstancedUBO.h"
+#include "VROInstancedTransformUBO.h"
 #include "VROShaderProgram.h"
 #include "VROTextureReference.h"
 #include "VROVertexBufferOpenGL.h"
+#include "VROProfiler.h"
+#include "VROGeometryBufferArena.h"
+#include "VROGPUCullerOpenGL.h"
+#include "VROShaderModifier.h"
+#include "VROMaterial.h"
+#include "VROMath.h"
+#include "VROBakedSkeletalAnimation.h"
 #include <map>
 
+/*
+ Dynamic geometry buffers are split into this many segments, written round-robin,
+ so an update never writes to data the GPU may be reading for one of the frames
+ still in flight. Each segment is sized with headroom so that growing geometry
+ is not recreated on every update.
+ */
+static const int kDynamicBufferSegments = 3;
+static const float kDynamicBufferHeadroom = 1.5;
+static const GLsizeiptr kDynamicBufferAlignment = 256;
+
+/*
+ Encode the given value, in [-1, 1], as a signed normalized integer of the given
+ number of bits.
+ */
+static uint32_t VROPackSnorm(float value, int bits) {
+    int max = (1 << (bits - 1)) - 1;
+    int quantized = (int) roundf(VROMathClamp(value, -1, 1) * max);
+    return (uint32_t) quantized & ((1u << bits) - 1);
+}
+
+static uint32_t VROPackSnorm1010102(float x, float y, float z, float w) {
+    return VROPackSnorm(x, 10) | (VROPackSnorm(y, 10) << 10) | (VROPackSnorm(z, 10) << 20) | (VROPackSnorm(w, 2) << 30);
+}
+
+/*
+ Encode the given value as a half float, rounding to nearest. Only used for
+ values within [-2, 2], so overflow is not possible; values too small for a
+ normal half are flushed to zero.
+ */
+static uint16_t VROPackHalf(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(float));
+    
+    uint16_t sign = (bits >> 16) & 0x8000;
+    int exponent = (int) ((bits >> 23) & 0xFF) - 127 + 15;
+    if (exponent <= 0) {
+        return sign;
+    }
+    uint32_t mantissa = bits & 0x7FFFFF;
+    uint32_t half = ((uint32_t) exponent << 10) | (mantissa >> 13);
+    half += (mantissa >> 12) & 1;
+    return sign | (uint16_t) half;
+}
+
+static bool VROHasGeometryModifiers(const VROGeometry &geometry) {
+    for (const std::shared_ptr<VROMaterial> &material : geometry.getMaterials()) {
+        for (const std::shared_ptr<VROShaderModifier> &modifier : material->getShaderModifiers()) {
+            if (modifier->getEntryPoint() == VROShaderEntryPoint::Geometry) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/*
+ Write the given data to the given range of the buffer bound to target. The
+ range is never one the GPU may still be reading (see kDynamicBufferSegments),
+ so it is mapped without synchronizing.
+ */
+static void VROWriteBufferRange(GLenum target, GLintptr offset, const void *data, GLsizeiptr length) {
+    if (length <= 0) {
+        return;
+    }
+#if VRO_SUPPORTS_BUFFER_MAPPING
+    void *dest = glMapBufferRange(target, offset, length,
+                                  GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (dest != nullptr) {
+        memcpy(dest, data, length);
+        GL( glUnmapBuffer(target) );
+        return;
+    }
+#endif
+    GL( glBufferSubData(target, offset, length, data) );
+}
+
+static GLsizeiptr VROGetDynamicSegmentSize(int length) {
+    GLsizeiptr size = (GLsizeiptr) (std::max(length, 1) * kDynamicBufferHeadroom);
+    return ((size + kDynamicBufferAlignment - 1) / kDynamicBufferAlignment) * kDynamicBufferAlignment;
+}
+
+/*
+ Group the sources of the given dynamic geometry by data buffer, in order of
+ first use, so that the groups of successive updates can be matched. Returns
+ false if the geometry cannot be updated in place.
+ */
+static bool VROGroupDynamicSources(const VROGeometry &geometry,
+                                   std::vector<std::pair<std::shared_ptr<VROData>, std::vector<std::shared_ptr<VROGeometrySource>>>> *outGroups) {
+    if (geometry.getSkinner() || geometry.hasMorphers() || geometry.getGeometryElements().empty()) {
+        return false;
+    }
+    for (const std::shared_ptr<VROGeometrySource> &source : geometry.getGeometrySources()) {
+        std::shared_ptr<VROData> data = source->getData();
+        if (source->getVertexBuffer() || !data || source->getGeometryElementIndex() != -1) {
+            return false;
+        }
+        auto group = std::find_if(outGroups->begin(), outGroups->end(),
+                                  [&data](const std::pair<std::shared_ptr<VROData>, std::vector<std::shared_ptr<VROGeometrySource>>> &g) {
+                                      return g.first == data;
+                                  });
+        if (group == outGroups->end()) {
+            outGroups->push_back({ data, { source } });
+        } else {
+            group->second.push_back(source);
+        }
+    }
+    for (const std::shared_ptr<VROGeometryElement> &element : geometry.getGeometryElements()) {
+        if (!element->getData()) {
+            return false;
+        }
+    }
+    return !outGroups->empty();
+}
+
+/*
+ Point the attributes of the given descriptor at its buffer, with all offsets
+ moved by the given base offset. The VAO to configure must be bound.
+ */
+static void VROSetAttributePointers(const VROVertexDescriptorOpenGL &vd, uintptr_t baseOffset) {
+    GL( glBindBuffer(GL_ARRAY_BUFFER, vd.buffer) );
+    for (int i = 0; i < vd.numAttributes; i++) {
+        const VROVertexAttributeOpenGL &attribute = vd.attributes[i];
+        if (!attribute.normalized && (attribute.type == GL_INT || attribute.type == GL_SHORT)) {
+            GL( glVertexAttribIPointer(attribute.index, attribute.size, attribute.type, vd.stride,
+                                       (GLvoid *) (baseOffset + attribute.offset)) );
+        }
+        else {
+            GL( glVertexAttribPointer(attribute.index, attribute.size, attribute.type,
+                                      attribute.normalized, vd.stride, (GLvoid *) (baseOffset + attribute.offset)) );
+        }
+        GL( glEnableVertexAttribArray(attribute.index) );
+    }
+}
+
 VROGeometrySubstrateOpenGL::VROGeometrySubstrateOpenGL(const VROGeometry &geometry,
                                                        std::shared_ptr<VRODriverOpenGL> driver) :
-    _driver(driver) {
-    readGeometryElements(geometry.getGeometryElements());
+    _vertexBufferBytes(0),
+    _indexBufferBytes(0),
+    _quantizedPositions(false),
+    _dynamic(false),
+    _dynamicSegment(0),
+    _driver(driver),
+    _skinningCacheSupported(true) {
+    // Geometry leaves its vertex array bound after drawing; unbind it so that
+    // binding our element buffers does not modify it
+    driver->unbindVertexArray();
         
     std::vector<std::shared_ptr<VROGeometrySource>> sources = geometry.getGeometrySources();
     if (geometry.getSkinner()) {
@@ -53,7 +205,42 @@ VROGeometrySubstrateOpenGL::VROGeometrySubstrateOpenGL(const VROGeometry &geomet
             sources.push_back(geometry.getSkinner()->getBoneWeights());
         }
     }
-    readGeometrySources(sources);
+
+    // Dynamic geometries are streamed into buffers they can be rewritten in
+    if (geometry.isDynamic() && readDynamicGeometry(geometry)) {
+        return;
+    }
+
+    /*
+     Static geometries are re-encoded in a compact vertex format where possible.
+     Small static geometries then share the buffers of the arena.
+     */
+    std::shared_ptr<VROData> data;
+    VROVertexDescriptorOpenGL layout;
+    int vertexCount;
+    bool compact = compactGeometrySources(geometry, sources, &data, &layout, &vertexCount);
+    if ((compact || readInterleavedLayout(sources, &data, &layout, &vertexCount)) &&
+        allocateFromArena(geometry, layout, data, vertexCount, driver)) {
+        return;
+    }
+    readGeometryElements(geometry.getGeometryElements());
+    
+    if (compact) {
+        GL( glGenBuffers(1, &layout.buffer) );
+        GL( glBindBuffer(GL_ARRAY_BUFFER, layout.buffer) );
+        GL( glBufferData(GL_ARRAY_BUFFER, vertexCount * layout.stride, data->getData(), GL_STATIC_DRAW) );
+        ALLOCATION_TRACKER_ADD(VBO, 1);
+        _vertexBufferBytes += vertexCount * layout.stride;
+        ALLOCATION_TRACKER_ADD(VertexBufferMemory, vertexCount * layout.stride);
+        
+        layout.ownsBuffer = true;
+        _vertexDescriptors.push_back(layout);
+        createVAO();
+        return;
+    }
+    
+    // Morphed geometry rewrites its vertex data whenever morph weights change
+    readGeometrySources(sources, geometry.hasMorphers() ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
         
     createVAO();
 }
@@ -61,7 +248,10 @@ VROGeometrySubstrateOpenGL::VROGeometrySubstrateOpenGL(const VROGeometry &geomet
 VROGeometrySubstrateOpenGL::~VROGeometrySubstrateOpenGL() {
     // Ensure we are deleting GL objects with the current GL context
     std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
-    if (driver) {
+    if (driver && _arenaAllocation) {
+        // The arena owns the buffers and VAO
+        driver->getGeometryArena()->free(*_arenaAllocation);
+    } else if (driver) {
         for (VROGeometryElementOpenGL &element : _elements) {
             driver->deleteBuffer(element.buffer);
         }
@@ -74,6 +264,11 @@ VROGeometrySubstrateOpenGL::~VROGeometrySubstrateOpenGL() {
         for (GLuint vao : _vaos) {
             driver->deleteVertexArray(vao);
         }
+        for (GLuint vao : _skinnedVAOs) {
+            driver->deleteVertexArray(vao);
+        }
+        ALLOCATION_TRACKER_SUB(VertexBufferMemory, _vertexBufferBytes);
+        ALLOCATION_TRACKER_SUB(IndexBufferMemory, _indexBufferBytes);
     } else {
         // Make the allocation tracker subtract VBOs if the driver was
         // released, just to keep the counter accurate.
@@ -82,6 +277,8 @@ VROGeometrySubstrateOpenGL::~VROGeometrySubstrateOpenGL() {
                 ALLOCATION_TRACKER_SUB(VBO, 1);
             }
         }
+        ALLOCATION_TRACKER_SUB(VertexBufferMemory, _vertexBufferBytes);
+        ALLOCATION_TRACKER_SUB(IndexBufferMemory, _indexBufferBytes);
     }
 
     std::map<int, std::vector<VROVertexDescriptorOpenGL>>::iterator it;
@@ -104,6 +301,8 @@ void VROGeometrySubstrateOpenGL::readGeometryElements(const std::vector<std::sha
         GL( glGenBuffers(1, &elementOGL.buffer) );
         GL( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementOGL.buffer) );
         GL( glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * element->getBytesPerIndex(), element->getData()->getData(), GL_STATIC_DRAW) );
+        _indexBufferBytes += indexCount * element->getBytesPerIndex();
+        ALLOCATION_TRACKER_ADD(IndexBufferMemory, indexCount * element->getBytesPerIndex());
      
         elementOGL.primitiveType = parsePrimitiveType(element->getPrimitiveType());
         elementOGL.indexCount = indexCount;
@@ -113,7 +312,67 @@ void VROGeometrySubstrateOpenGL::readGeometryElements(const std::vector<std::sha
     }
 }
 
-void VROGeometrySubstrateOpenGL::readGeometrySources(const std::vector<std::shared_ptr<VROGeometrySource>> &sources) {
+bool VROGeometrySubstrateOpenGL::readDynamicGeometry(const VROGeometry &geometry) {
+    std::vector<std::pair<std::shared_ptr<VROData>, std::vector<std::shared_ptr<VROGeometrySource>>>> groups;
+    if (!VROGroupDynamicSources(geometry, &groups)) {
+        return false;
+    }
+    
+    /*
+     Each buffer starts with its data in the first segment. The segments are
+     sized with headroom, so that geometry that grows each frame (e.g. a
+     polyline being drawn) is only occasionally recreated.
+     */
+    for (auto &group : groups) {
+        GLsizeiptr segmentSize = VROGetDynamicSegmentSize(group.first->getDataLength());
+        
+        GLuint buffer;
+        GL( glGenBuffers(1, &buffer) );
+        GL( glBindBuffer(GL_ARRAY_BUFFER, buffer) );
+        GL( glBufferData(GL_ARRAY_BUFFER, segmentSize * kDynamicBufferSegments, nullptr, GL_DYNAMIC_DRAW) );
+        VROWriteBufferRange(GL_ARRAY_BUFFER, 0, group.first->getData(), group.first->getDataLength());
+        ALLOCATION_TRACKER_ADD(VBO, 1);
+        _vertexBufferBytes += segmentSize * kDynamicBufferSegments;
+        ALLOCATION_TRACKER_ADD(VertexBufferMemory, segmentSize * kDynamicBufferSegments);
+        
+        VROVertexDescriptorOpenGL vd = configureVertexDescriptor(buffer, group.second);
+        vd.ownsBuffer = true;
+        _vertexDescriptors.push_back(vd);
+        _dynamicVertexSegmentSizes.push_back(segmentSize);
+        _dynamicVertexLengths.push_back(group.first->getDataLength());
+    }
+    GL( glBindBuffer(GL_ARRAY_BUFFER, 0) );
+    
+    for (const std::shared_ptr<VROGeometryElement> &element : geometry.getGeometryElements()) {
+        int indexCount = VROGeometryUtilGetIndicesCount(element->getPrimitiveCount(), element->getPrimitiveType());
+        int length = indexCount * element->getBytesPerIndex();
+        GLsizeiptr segmentSize = VROGetDynamicSegmentSize(length);
+        
+        VROGeometryElementOpenGL elementOGL;
+        GL( glGenBuffers(1, &elementOGL.buffer) );
+        GL( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementOGL.buffer) );
+        GL( glBufferData(GL_ELEMENT_ARRAY_BUFFER, segmentSize * kDynamicBufferSegments, nullptr, GL_DYNAMIC_DRAW) );
+        VROWriteBufferRange(GL_ELEMENT_ARRAY_BUFFER, 0, element->getData()->getData(), length);
+        _indexBufferBytes += segmentSize * kDynamicBufferSegments;
+        ALLOCATION_TRACKER_ADD(IndexBufferMemory, segmentSize * kDynamicBufferSegments);
+        
+        elementOGL.primitiveType = parsePrimitiveType(element->getPrimitiveType());
+        elementOGL.indexCount = indexCount;
+        elementOGL.indexType = (element->getBytesPerIndex() == 2) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        elementOGL.indexBufferOffset = 0;
+        _elements.push_back(elementOGL);
+        _dynamicIndexSegmentSizes.push_back(segmentSize);
+        _dynamicIndexLengths.push_back(length);
+    }
+    GL( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0) );
+    
+    _dynamic = true;
+    createVAO();
+    return true;
+}
+
+void VROGeometrySubstrateOpenGL::readGeometrySources(const std::vector<std::shared_ptr<VROGeometrySource>> &sources,
+                                                     GLenum usage) {
     std::map<std::shared_ptr<VROData>, std::vector<std::shared_ptr<VROGeometrySource>>> dataMap;
     std::map<std::shared_ptr<VROVertexBuffer>, std::vector<std::shared_ptr<VROGeometrySource>>> vboMap;
 
@@ -158,9 +417,12 @@ void VROGeometrySubstrateOpenGL::readGeometrySources(const std::vector<std::shar
         GLuint buffer;
         GL( glGenBuffers(1, &buffer) );
         GL( glBindBuffer(GL_ARRAY_BUFFER, buffer) );
-        GL( glBufferData(GL_ARRAY_BUFFER, data->getDataLength(), data->getData(), GL_STATIC_DRAW) );
+        GL( glBufferData(GL_ARRAY_BUFFER, data->getDataLength(), data->getData(), usage) );
+        _dataBuffers[data] = buffer;
         
         ALLOCATION_TRACKER_ADD(VBO, 1);
+        _vertexBufferBytes += data->getDataLength();
+        ALLOCATION_TRACKER_ADD(VertexBufferMemory, data->getDataLength());
         
         VROVertexDescriptorOpenGL vd = configureVertexDescriptor(buffer, group);
         vd.ownsBuffer = true;
@@ -168,6 +430,281 @@ void VROGeometrySubstrateOpenGL::readGeometrySources(const std::vector<std::shar
     }
 }
 
+bool VROGeometrySubstrateOpenGL::readInterleavedLayout(const std::vector<std::shared_ptr<VROGeometrySource>> &sources,
+                                                       std::shared_ptr<VROData> *outData,
+                                                       VROVertexDescriptorOpenGL *outLayout,
+                                                       int *outVertexCount) {
+    if (sources.empty()) {
+        return false;
+    }
+    
+    /*
+     All sources must interleave their attributes in a single data buffer, so
+     that the geometry's vertices are one contiguous range. Sources assigned to
+     specific elements need their own VAOs.
+     */
+    std::shared_ptr<VROData> data = sources[0]->getData();
+    int stride = sources[0]->getDataStride();
+    int vertexCount = 0;
+    if (!data || stride <= 0) {
+        return false;
+    }
+    for (const std::shared_ptr<VROGeometrySource> &source : sources) {
+        if (source->getVertexBuffer() || source->getData() != data || source->getGeometryElementIndex() != -1 ||
+            source->getDataStride() != stride ||
+            source->getDataOffset() + source->getComponentsPerVertex() * source->getBytesPerComponent() > stride) {
+            return false;
+        }
+        vertexCount = std::max(vertexCount, source->getVertexCount());
+    }
+    if (vertexCount <= 0 || vertexCount * stride > data->getDataLength()) {
+        return false;
+    }
+    
+    *outData = data;
+    *outLayout = configureVertexDescriptor(0, sources);
+    *outVertexCount = vertexCount;
+    return true;
+}
+
+bool VROGeometrySubstrateOpenGL::allocateFromArena(const VROGeometry &geometry,
+                                                   const VROVertexDescriptorOpenGL &layout,
+                                                   const std::shared_ptr<VROData> &data,
+                                                   int vertexCount,
+                                                   std::shared_ptr<VRODriverOpenGL> &driver) {
+    /*
+     Skinned and morphed geometries update their vertices in their own buffers.
+     */
+    const std::vector<std::shared_ptr<VROGeometryElement>> &elements = geometry.getGeometryElements();
+    if (geometry.getSkinner() || geometry.hasMorphers() || elements.empty() ||
+        vertexCount * (int) layout.stride > kMaxArenaGeometryVertexBytes) {
+        return false;
+    }
+    
+    /*
+     Each element's indices are placed one after the other, 4-byte aligned, and
+     must only reference this geometry's vertices.
+     */
+    int indexBytes = 0;
+    for (const std::shared_ptr<VROGeometryElement> &element : elements) {
+        if (element->getData() == nullptr) {
+            return false;
+        }
+        int indexCount = VROGeometryUtilGetIndicesCount(element->getPrimitiveCount(), element->getPrimitiveType());
+        const void *indices = element->getData()->getData();
+        for (int i = 0; i < indexCount; i++) {
+            int index = (element->getBytesPerIndex() == 2) ? ((const uint16_t *) indices)[i] : ((const uint32_t *) indices)[i];
+            if (index >= vertexCount) {
+                return false;
+            }
+        }
+        indexBytes += ((indexCount * element->getBytesPerIndex() + 3) / 4) * 4;
+    }
+    if (indexBytes <= 0 || indexBytes > kMaxArenaGeometryIndexBytes) {
+        return false;
+    }
+    
+    VROGeometryArenaAllocation allocation;
+    VROGeometryBufferArena *arena = driver->getGeometryArena();
+    if (!arena->allocate(layout, vertexCount, indexBytes, &allocation)) {
+        return false;
+    }
+    arena->uploadVertices(allocation, data->getData());
+    
+    int offset = 0;
+    GLuint vao = arena->getVertexArray(allocation);
+    for (const std::shared_ptr<VROGeometryElement> &element : elements) {
+        int indexCount = VROGeometryUtilGetIndicesCount(element->getPrimitiveCount(), element->getPrimitiveType());
+        
+        VROGeometryElementOpenGL elementOGL;
+        elementOGL.buffer = arena->getIndexBuffer(allocation);
+        elementOGL.primitiveType = parsePrimitiveType(element->getPrimitiveType());
+        elementOGL.indexCount = indexCount;
+        elementOGL.indexType = (element->getBytesPerIndex() == 2) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        elementOGL.indexBufferOffset = arena->uploadIndices(allocation, offset, element->getData()->getData(),
+                                                            indexCount, element->getBytesPerIndex());
+        _elements.push_back(elementOGL);
+        _vaos.push_back(vao);
+        
+        offset += ((indexCount * element->getBytesPerIndex() + 3) / 4) * 4;
+    }
+    
+    _arenaAllocation = std::unique_ptr<VROGeometryArenaAllocation>(new VROGeometryArenaAllocation(allocation));
+    return true;
+}
+
+bool VROGeometrySubstrateOpenGL::compactGeometrySources(const VROGeometry &geometry,
+                                                        const std::vector<std::shared_ptr<VROGeometrySource>> &sources,
+                                                        std::shared_ptr<VROData> *outData,
+                                                        VROVertexDescriptorOpenGL *outLayout,
+                                                        int *outVertexCount) {
+    if (geometry.getSkinner() || geometry.hasMorphers() || sources.empty()) {
+        return false;
+    }
+    
+    /*
+     Only float sources of the attributes we know how to encode are compacted;
+     anything else keeps its original format.
+     */
+    std::shared_ptr<VROGeometrySource> position, normal, tangent, texcoord;
+    int vertexCount = sources[0]->getVertexCount();
+    for (const std::shared_ptr<VROGeometrySource> &source : sources) {
+        if (source->getVertexBuffer() || !source->getData() || source->getGeometryElementIndex() != -1 ||
+            !source->isFloatComponents() || source->getBytesPerComponent() != 4 ||
+            source->getVertexCount() != vertexCount) {
+            return false;
+        }
+        
+        int components = source->getComponentsPerVertex();
+        std::shared_ptr<VROGeometrySource> *slot;
+        switch (source->getSemantic()) {
+            case VROGeometrySourceSemantic::Vertex:
+                slot = (components == 3) ? &position : nullptr;
+                break;
+            case VROGeometrySourceSemantic::Normal:
+                slot = (components == 3) ? &normal : nullptr;
+                break;
+            case VROGeometrySourceSemantic::Tangent:
+                slot = (components == 3 || components == 4) ? &tangent : nullptr;
+                break;
+            case VROGeometrySourceSemantic::Texcoord:
+                slot = (components == 2) ? &texcoord : nullptr;
+                break;
+            default:
+                slot = nullptr;
+                break;
+        }
+        if (!slot || *slot) {
+            return false;
+        }
+        *slot = source;
+    }
+    if (!position || vertexCount <= 0) {
+        return false;
+    }
+    
+    /*
+     Tiled texcoords lose too much precision as half floats, and quantized
+     positions are only correct where the model transform is applied to them.
+     */
+    bool halfTexcoords = true;
+    if (texcoord) {
+        texcoord->processVertices([&halfTexcoords](int index, VROVector4f vertex) {
+            halfTexcoords &= (fabs(vertex.x) <= 2 && fabs(vertex.y) <= 2);
+        });
+    }
+    bool quantizePositions = !geometry.getInstancedUBO() && !VROHasGeometryModifiers(geometry);
+    
+    VROVertexDescriptorOpenGL vd;
+    vd.buffer = 0;
+    vd.stride = 0;
+    vd.numAttributes = 0;
+    vd.ownsBuffer = false;
+    
+    auto addAttribute = [&vd](VROGeometrySourceSemantic semantic, GLint size, GLenum type, GLboolean normalized,
+                              int bytes) {
+        VROVertexAttributeOpenGL &attribute = vd.attributes[vd.numAttributes++];
+        attribute.index = VROGeometryUtilParseAttributeIndex(semantic);
+        attribute.size = size;
+        attribute.type = type;
+        attribute.normalized = normalized;
+        attribute.offset = vd.stride;
+        vd.stride += bytes;
+        return attribute.offset;
+    };
+    
+    // Positions are padded to 8 bytes to keep the following attributes aligned
+    uintptr_t positionOffset = quantizePositions ? addAttribute(VROGeometrySourceSemantic::Vertex, 3, GL_SHORT, GL_TRUE, 8) :
+                                                   addAttribute(VROGeometrySourceSemantic::Vertex, 3, GL_FLOAT, GL_FALSE, 12);
+    uintptr_t normalOffset = 0, tangentOffset = 0, texcoordOffset = 0;
+    if (normal) {
+        normalOffset = addAttribute(VROGeometrySourceSemantic::Normal, 4, GL_INT_2_10_10_10_REV, GL_TRUE, 4);
+    }
+    if (tangent) {
+        tangentOffset = addAttribute(VROGeometrySourceSemantic::Tangent, 4, GL_INT_2_10_10_10_REV, GL_TRUE, 4);
+    }
+    if (texcoord) {
+        texcoordOffset = halfTexcoords ? addAttribute(VROGeometrySourceSemantic::Texcoord, 2, GL_HALF_FLOAT, GL_FALSE, 4) :
+                                         addAttribute(VROGeometrySourceSemantic::Texcoord, 2, GL_FLOAT, GL_FALSE, 8);
+    }
+    
+    int length = vertexCount * vd.stride;
+    uint8_t *vertices = (uint8_t *) calloc(length, 1);
+    int stride = vd.stride;
+    
+    if (quantizePositions) {
+        VROBoundingBox bounds = position->getBoundingBox();
+        VROVector3f center = bounds.getCenter();
+        VROVector3f extent((bounds.getMaxX() - bounds.getMinX()) / 2,
+                           (bounds.getMaxY() - bounds.getMinY()) / 2,
+                           (bounds.getMaxZ() - bounds.getMinZ()) / 2);
+        
+        // Flat axes quantize to zero, so any scale works for them
+        extent.x = (extent.x > 0) ? extent.x : 1;
+        extent.y = (extent.y > 0) ? extent.y : 1;
+        extent.z = (extent.z > 0) ? extent.z : 1;
+        
+        position->processVertices([vertices, stride, positionOffset, center, extent](int index, VROVector4f vertex) {
+            int16_t *out = (int16_t *) (vertices + index * stride + positionOffset);
+            out[0] = (int16_t) roundf(VROMathClamp((vertex.x - center.x) / extent.x, -1, 1) * 32767);
+            out[1] = (int16_t) roundf(VROMathClamp((vertex.y - center.y) / extent.y, -1, 1) * 32767);
+            out[2] = (int16_t) roundf(VROMathClamp((vertex.z - center.z) / extent.z, -1, 1) * 32767);
+        });
+        
+        _dequantization.toIdentity();
+        _dequantization.scale(extent.x, extent.y, extent.z);
+        _dequantization.translate(center);
+        _quantizedPositions = true;
+    } else {
+        position->processVertices([vertices, stride, positionOffset](int index, VROVector4f vertex) {
+            float *out = (float *) (vertices + index * stride + positionOffset);
+            out[0] = vertex.x;
+            out[1] = vertex.y;
+            out[2] = vertex.z;
+        });
+    }
+    if (normal) {
+        normal->processVertices([vertices, stride, normalOffset](int index, VROVector4f vertex) {
+            VROVector3f n = VROVector3f(vertex.x, vertex.y, vertex.z).normalize();
+            *((uint32_t *) (vertices + index * stride + normalOffset)) = VROPackSnorm1010102(n.x, n.y, n.z, 0);
+        });
+    }
+    if (tangent) {
+        // Three component tangents take the default W of 1 when read as floats
+        bool hasHandedness = tangent->getComponentsPerVertex() == 4;
+        tangent->processVertices([vertices, stride, tangentOffset, hasHandedness](int index, VROVector4f vertex) {
+            VROVector3f t = VROVector3f(vertex.x, vertex.y, vertex.z).normalize();
+            float w = (!hasHandedness || vertex.w >= 0) ? 1 : -1;
+            *((uint32_t *) (vertices + index * stride + tangentOffset)) = VROPackSnorm1010102(t.x, t.y, t.z, w);
+        });
+    }
+    if (texcoord) {
+        texcoord->processVertices([vertices, stride, texcoordOffset, halfTexcoords](int index, VROVector4f vertex) {
+            uint8_t *out = vertices + index * stride + texcoordOffset;
+            if (halfTexcoords) {
+                ((uint16_t *) out)[0] = VROPackHalf(vertex.x);
+                ((uint16_t *) out)[1] = VROPackHalf(vertex.y);
+            } else {
+                ((float *) out)[0] = vertex.x;
+                ((float *) out)[1] = vertex.y;
+            }
+        });
+    }
+    
+    *outData = std::make_shared<VROData>((void *) vertices, length, VRODataOwnership::Move);
+    *outLayout = vd;
+    *outVertexCount = vertexCount;
+    return true;
+}
+
+const VROMatrix4f &VROGeometrySubstrateOpenGL::getModelTransform(const VROMatrix4f &transform, VROMatrix4f *scratch) const {
+    if (!_quantizedPositions) {
+        return transform;
+    }
+    *scratch = transform.multiply(_dequantization);
+    return *scratch;
+}
+
 VROVertexDescriptorOpenGL VROGeometrySubstrateOpenGL::configureVertexDescriptor(GLuint buffer, std::vector<std::shared_ptr<VROGeometrySource>> group) {
     VROVertexDescriptorOpenGL vd;
     vd.stride = group[0]->getDataStride();
@@ -178,11 +715,18 @@ VROVertexDescriptorOpenGL VROGeometrySubstrateOpenGL::configureVertexDescriptor(
         std::shared_ptr<VROGeometrySource> source = group[i];
 
         int attrIdx = VROGeometryUtilParseAttributeIndex(source->getSemantic());
+        
+        // Edge creases are not read by any shader, and their index carries the
+        // draw ID of multi-draws
+        if (attrIdx == kDrawIDAttributeIndex) {
+            continue;
+        }
         std::pair<GLuint, int> format = parseVertexFormat(source);
         
         vd.attributes[vd.numAttributes].index = attrIdx;
         vd.attributes[vd.numAttributes].size = format.second;
         vd.attributes[vd.numAttributes].type = format.first;
+        vd.attributes[vd.numAttributes].normalized = GL_FALSE;
         vd.attributes[vd.numAttributes].offset = source->getDataOffset();
         vd.numAttributes++;
         passert (source->getDataStride() == vd.stride);
@@ -211,19 +755,7 @@ void VROGeometrySubstrateOpenGL::createVAO() {
         }
 
         for (VROVertexDescriptorOpenGL &vd : vertexDescriptors) {
-            GL( glBindBuffer(GL_ARRAY_BUFFER, vd.buffer) );
-    
-            for (int i = 0; i < vd.numAttributes; i++) {
-                if (vd.attributes[i].type == GL_INT || vd.attributes[i].type == GL_SHORT) {
-                    GL( glVertexAttribIPointer(vd.attributes[i].index, vd.attributes[i].size, vd.attributes[i].type, vd.stride,
-                                               (GLvoid *) vd.attributes[i].offset) );
-                }
-                else {
-                    GL( glVertexAttribPointer(vd.attributes[i].index, vd.attributes[i].size, vd.attributes[i].type, GL_FALSE, vd.stride,
-                                              (GLvoid *) vd.attributes[i].offset) );
-                }
-                GL( glEnableVertexAttribArray(vd.attributes[i].index) );
-            }
+            VROSetAttributePointers(vd, 0);
         }
         
         GL( glBindBuffer(GL_ARRAY_BUFFER, 0) );
@@ -274,60 +806,387 @@ GLuint VROGeometrySubstrateOpenGL::parsePrimitiveType(VROGeometryPrimitiveType p
     }
 }
 
+bool VROGeometrySubstrateOpenGL::createSkinningCache(const VROGeometry &geometry) {
+    /*
+     Skinning is only cached when all elements share the same vertex data, so that
+     a single pass over the vertices skins the entire geometry.
+     */
+    if (!_elementToDescriptorsMap.empty() || _elements.empty()) {
+        return false;
+    }
+    
+    std::vector<std::shared_ptr<VROGeometrySource>> positions = geometry.getGeometrySourcesForSemantic(VROGeometrySourceSemantic::Vertex);
+    if (positions.size() != 1) {
+        return false;
+    }
+    int vertexCount = positions[0]->getVertexCount();
+    int positionIndex = VROGeometryUtilParseAttributeIndex(VROGeometrySourceSemantic::Vertex);
+    int boneIndicesIndex = VROGeometryUtilParseAttributeIndex(VROGeometrySourceSemantic::BoneIndices);
+    int boneWeightsIndex = VROGeometryUtilParseAttributeIndex(VROGeometrySourceSemantic::BoneWeights);
+    
+    bool hasBoneIndices = false;
+    bool hasBoneWeights = false;
+    for (VROVertexDescriptorOpenGL &vd : _vertexDescriptors) {
+        for (int i = 0; i < vd.numAttributes; i++) {
+            hasBoneIndices |= (vd.attributes[i].index == boneIndicesIndex);
+            hasBoneWeights |= (vd.attributes[i].index == boneWeightsIndex);
+        }
+    }
+    if (vertexCount <= 0 || !hasBoneIndices || !hasBoneWeights) {
+        return false;
+    }
+    
+    std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
+    if (!driver) {
+        return false;
+    }
+    _skinningCache = std::unique_ptr<VROSkinningCache>(new VROSkinningCache(vertexCount, driver));
+    driver->unbindVertexArray();
+    
+    /*
+     The skinned VAOs are identical to the regular VAOs, except that positions are
+     read from the skinning cache.
+     */
+    GLuint vaos[_elements.size()];
+    GL( glGenVertexArrays((int) _elements.size(), vaos) );
+    
+    for (int e = 0; e < _elements.size(); e++) {
+        GL( glBindVertexArray(vaos[e]) );
+        
+        for (VROVertexDescriptorOpenGL &vd : _vertexDescriptors) {
+            GL( glBindBuffer(GL_ARRAY_BUFFER, vd.buffer) );
+            
+            for (int i = 0; i < vd.numAttributes; i++) {
+                if (vd.attributes[i].index == positionIndex) {
+                    continue;
+                }
+                if (vd.attributes[i].type == GL_INT || vd.attributes[i].type == GL_SHORT) {
+                    GL( glVertexAttribIPointer(vd.attributes[i].index, vd.attributes[i].size, vd.attributes[i].type, vd.stride,
+                                               (GLvoid *) vd.attributes[i].offset) );
+                }
+                else {
+                    GL( glVertexAttribPointer(vd.attributes[i].index, vd.attributes[i].size, vd.attributes[i].type, GL_FALSE, vd.stride,
+                                              (GLvoid *) vd.attributes[i].offset) );
+                }
+                GL( glEnableVertexAttribArray(vd.attributes[i].index) );
+            }
+        }
+        
+        GL( glBindBuffer(GL_ARRAY_BUFFER, _skinningCache->getBuffer()) );
+        GL( glVertexAttribPointer(positionIndex, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (GLvoid *) 0) );
+        GL( glEnableVertexAttribArray(positionIndex) );
+        
+        GL( glBindBuffer(GL_ARRAY_BUFFER, 0) );
+        GL( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _elements[e].buffer) );
+        GL( glBindVertexArray(0) );
+    }
+    
+    _skinnedVAOs.assign(vaos, vaos + _elements.size());
+    return true;
+}
+
+GLuint VROGeometrySubstrateOpenGL::getVAO(const VROGeometry &geometry, int elementIndex) const {
+    if (_skinningCache && geometry.getSkinner()->isSkinningCacheValid()) {
+        return _skinnedVAOs[elementIndex];
+    }
+    return _vaos[elementIndex];
+}
+
 void VROGeometrySubstrateOpenGL::update(const VROGeometry &geometry,
                                         std::shared_ptr<VRODriver> &driver) {
     if (_boneUBO) {
-        _boneUBO->update(geometry.getSkinner());
+        const std::shared_ptr<VROSkinner> &skinner = geometry.getSkinner();
+        _boneUBO->update(skinner);
+        
+        /*
+         Skin into the cache once here, at the start of the frame, so that all of
+         this frame's passes read the same skinned vertices. The cache skins with
+         matrices only; dual-quaternion skinners are skinned in each pass, and
+         skinners with baked animations in their instanced draws.
+         */
+        bool cacheValid = false;
+        if (skinner->isSkinningCached() && _skinningCacheSupported && !skinner->getBakedAnimation() &&
+            skinner->getActiveSkinningMode() == VROSkinningMode::Matrix) {
+            if (!_skinningCache) {
+                _skinningCacheSupported = createSkinningCache(geometry);
+            }
+            if (_skinningCache) {
+                cacheValid = _skinningCache->update(_vaos[0], *_boneUBO);
+            }
+        }
+        skinner->setSkinningCacheValid(cacheValid);
     }
 }
 
-void VROGeometrySubstrateOpenGL::render(const VROGeometry &geometry,
-                                        int elementIndex,
-                                        VROMatrix4f transform,
-                                        VROMatrix4f normalMatrix,
-                                        float opacity,
-                                        const std::shared_ptr<VROMaterial> &material,
-                                        const VRORenderContext &context,
-                                        std::shared_ptr<VRODriver> &driver) {
-    VROMatrix4f viewMatrix = context.getViewMatrix();
-    VROMatrix4f projectionMatrix = context.getProjectionMatrix();
+bool VROGeometrySubstrateOpenGL::updateSourceData(const std::vector<std::shared_ptr<VROGeometrySource>> &sources,
+                                                  std::shared_ptr<VRODriver> &driver) {
+    std::map<std::shared_ptr<VROData>, GLuint> buffers;
+    for (const std::shared_ptr<VROGeometrySource> &source : sources) {
+        auto it = _dataBuffers.find(source->getData());
+        if (source->getVertexBuffer() || it == _dataBuffers.end()) {
+            return false;
+        }
+        buffers[it->first] = it->second;
+    }
+
+    // Sources sharing a data buffer are uploaded together
+    for (auto &kv : buffers) {
+        GL( glBindBuffer(GL_ARRAY_BUFFER, kv.second) );
+        GL( glBufferSubData(GL_ARRAY_BUFFER, 0, kv.first->getDataLength(), kv.first->getData()) );
+    }
+    GL( glBindBuffer(GL_ARRAY_BUFFER, 0) );
+    return true;
+}
+
+bool VROGeometrySubstrateOpenGL::updateGeometry(const VROGeometry &geometry, bool appendOnly,
+                                                std::shared_ptr<VRODriver> &driver) {
+    std::vector<std::pair<std::shared_ptr<VROData>, std::vector<std::shared_ptr<VROGeometrySource>>>> groups;
+    const std::vector<std::shared_ptr<VROGeometryElement>> &elements = geometry.getGeometryElements();
+    std::shared_ptr<VRODriverOpenGL> driverGL = _driver.lock();
+    if (!_dynamic || !driverGL || !VROGroupDynamicSources(geometry, &groups) ||
+        groups.size() != _vertexDescriptors.size() || elements.size() != _elements.size()) {
+        return false;
+    }
+    
+    // The new data must have the same vertex layout and index formats, and fit in the segments
+    for (int i = 0; i < groups.size(); i++) {
+        if (groups[i].first->getDataLength() > _dynamicVertexSegmentSizes[i] ||
+            !VROIsLayoutCompatible(configureVertexDescriptor(_vertexDescriptors[i].buffer, groups[i].second),
+                                   _vertexDescriptors[i])) {
+            return false;
+        }
+    }
+    for (int i = 0; i < elements.size(); i++) {
+        const std::shared_ptr<VROGeometryElement> &element = elements[i];
+        int indexCount = VROGeometryUtilGetIndicesCount(element->getPrimitiveCount(), element->getPrimitiveType());
+        GLuint indexType = (element->getBytesPerIndex() == 2) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        if (parsePrimitiveType(element->getPrimitiveType()) != _elements[i].primitiveType ||
+            indexType != _elements[i].indexType ||
+            indexCount * element->getBytesPerIndex() > _dynamicIndexSegmentSizes[i]) {
+            return false;
+        }
+    }
+    
+    // Unbind the current VAO, so that binding element buffers does not modify it
+    driverGL->unbindVertexArray();
+    if (appendOnly && appendDynamicGeometry(groups, elements)) {
+        return true;
+    }
+    _dynamicSegment = (_dynamicSegment + 1) % kDynamicBufferSegments;
+    
+    for (int i = 0; i < groups.size(); i++) {
+        GL( glBindBuffer(GL_ARRAY_BUFFER, _vertexDescriptors[i].buffer) );
+        VROWriteBufferRange(GL_ARRAY_BUFFER, _dynamicSegment * _dynamicVertexSegmentSizes[i],
+                            groups[i].first->getData(), groups[i].first->getDataLength());
+        _dynamicVertexLengths[i] = groups[i].first->getDataLength();
+    }
+    for (int i = 0; i < elements.size(); i++) {
+        const std::shared_ptr<VROGeometryElement> &element = elements[i];
+        int indexCount = VROGeometryUtilGetIndicesCount(element->getPrimitiveCount(), element->getPrimitiveType());
+        
+        GL( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _elements[i].buffer) );
+        VROWriteBufferRange(GL_ELEMENT_ARRAY_BUFFER, _dynamicSegment * _dynamicIndexSegmentSizes[i],
+                            element->getData()->getData(), indexCount * element->getBytesPerIndex());
+        _elements[i].indexCount = indexCount;
+        _elements[i].indexBufferOffset = (int) (_dynamicSegment * _dynamicIndexSegmentSizes[i]);
+        _dynamicIndexLengths[i] = indexCount * element->getBytesPerIndex();
+    }
+    GL( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0) );
+    
+    // Point each VAO's attributes at the new segment of each vertex buffer
+    for (GLuint vao : _vaos) {
+        GL( glBindVertexArray(vao) );
+        for (int i = 0; i < _vertexDescriptors.size(); i++) {
+            VROSetAttributePointers(_vertexDescriptors[i], _dynamicSegment * _dynamicVertexSegmentSizes[i]);
+        }
+    }
+    GL( glBindVertexArray(0) );
+    GL( glBindBuffer(GL_ARRAY_BUFFER, 0) );
+    return true;
+}
+
+bool VROGeometrySubstrateOpenGL::appendDynamicGeometry(const std::vector<std::pair<std::shared_ptr<VROData>, std::vector<std::shared_ptr<VROGeometrySource>>>> &groups,
+                                                       const std::vector<std::shared_ptr<VROGeometryElement>> &elements) {
+    for (int i = 0; i < groups.size(); i++) {
+        if (groups[i].first->getDataLength() < _dynamicVertexLengths[i]) {
+            return false;
+        }
+    }
+    std::vector<GLsizeiptr> indexLengths;
+    for (int i = 0; i < elements.size(); i++) {
+        const std::shared_ptr<VROGeometryElement> &element = elements[i];
+        int indexCount = VROGeometryUtilGetIndicesCount(element->getPrimitiveCount(), element->getPrimitiveType());
+        indexLengths.push_back(indexCount * element->getBytesPerIndex());
+        if (indexLengths[i] < _dynamicIndexLengths[i]) {
+            return false;
+        }
+    }
+    
+    // Write only the tail of each buffer into the current segment; the VAOs are unchanged
+    for (int i = 0; i < groups.size(); i++) {
+        GL( glBindBuffer(GL_ARRAY_BUFFER, _vertexDescriptors[i].buffer) );
+        VROWriteBufferRange(GL_ARRAY_BUFFER, _dynamicSegment * _dynamicVertexSegmentSizes[i] + _dynamicVertexLengths[i],
+                            (const char *) groups[i].first->getData() + _dynamicVertexLengths[i],
+                            groups[i].first->getDataLength() - _dynamicVertexLengths[i]);
+        _dynamicVertexLengths[i] = groups[i].first->getDataLength();
+    }
+    GL( glBindBuffer(GL_ARRAY_BUFFER, 0) );
+    
+    for (int i = 0; i < elements.size(); i++) {
+        const std::shared_ptr<VROGeometryElement> &element = elements[i];
+        GL( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _elements[i].buffer) );
+        VROWriteBufferRange(GL_ELEMENT_ARRAY_BUFFER, _dynamicSegment * _dynamicIndexSegmentSizes[i] + _dynamicIndexLengths[i],
+                            (const char *) element->getData()->getData() + _dynamicIndexLengths[i],
+                            indexLengths[i] - _dynamicIndexLengths[i]);
+        _elements[i].indexCount = (int) (indexLengths[i] / element->getBytesPerIndex());
+        _dynamicIndexLengths[i] = indexLengths[i];
+    }
+    GL( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0) );
+    return true;
+}
+
+/*
+ Returns the view and projection matrices for the given geometry, without
+ copying them. Screen space geometries are specified in viewport (screen)
+ coordinates. Therefore they do not respond to the camera (identity view
+ matrix), and they use an orthographic projection.
+ */
+static void getViewProjection(const VROGeometry &geometry, const VRORenderContext &context,
+                              const VROMatrix4f **outView, const VROMatrix4f **outProjection) {
+    static const VROMatrix4f kIdentity;
+    
+    *outView = &context.getViewMatrix();
+    *outProjection = &context.getProjectionMatrix();
     
     if (geometry.isCameraEnclosure()) {
-        viewMatrix = context.getEnclosureViewMatrix();
+        *outView = &context.getEnclosureViewMatrix();
     }
     if (geometry.isScreenSpace()) {
-        /*
-         Screen space geometries are specified in viewport (screen) coordinates.
-         Therefore they do not respond to the camera (identity view matrix), and
-         they use an orthographic projection.
-         */
-        viewMatrix = VROMatrix4f();
-        projectionMatrix = context.getOrthographicMatrix();
+        *outView = &kIdentity;
+        *outProjection = &context.getOrthographicMatrix();
     }
+}
+
+/*
+ Select the shading rate for a draw from its content. Backgrounds (including the
+ AR camera feed) and translucent unlit geometry such as UI have little high
+ frequency shading detail, and distant geometry covers little of the screen, so
+ each can be shaded coarsely. A negative distance indicates it is unknown.
+ */
+static VROShadingRate getShadingRate(const VROGeometry &geometry, const VROMaterial &material,
+                                     float opacity, float distance, const VRORenderContext &context) {
+    VROShadingRateLevel level = context.getShadingRateLevel();
+    if (level == VROShadingRateLevel::None) {
+        return VROShadingRate::Rate1x1;
+    }
+    bool high = (level == VROShadingRateLevel::High);
     
-    std::string geoName = geometry.getName();
-    std::string materialName = material->getName();
-    
-    if (!materialName.empty()) {
-        pglpush("Geometry [%s], Material [%s]", geoName.c_str(), materialName.c_str());
+    bool background = geometry.isCameraEnclosure() || (geometry.isScreenSpace() && !material.getWritesToDepthBuffer());
+    if (background) {
+        return high ? VROShadingRate::Rate4x4 : VROShadingRate::Rate2x2;
     }
-    else {
-        pglpush("Geometry [%s]", geoName.c_str());
+    if (material.getLightingModel() == VROLightingModel::Constant &&
+        material.getRenderedTransparency() * opacity < 1) {
+        return VROShadingRate::Rate2x2;
+    }
+    if (high && distance > 40) {
+        return VROShadingRate::Rate4x4;
     }
+    if (distance > (high ? 10 : 20)) {
+        return VROShadingRate::Rate2x2;
+    }
+    return VROShadingRate::Rate1x1;
+}
+
+void VROGeometrySubstrateOpenGL::render(const VROGeometry &geometry,
+                                        int elementIndex,
+                                        const VROMatrix4f &transform,
+                                        const VROMatrix4f &normalMatrix,
+                                        float opacity,
+                                        const std::shared_ptr<VROMaterial> &material,
+                                        const VRORenderContext &context,
+                                        std::shared_ptr<VRODriver> &driver) {
+    const VROMatrix4f *viewMatrix;
+    const VROMatrix4f *projectionMatrix;
+    getViewProjection(geometry, context, &viewMatrix, &projectionMatrix);
+    
+    // The names are only evaluated when debug markers are compiled in
+    pglpush("Geometry [%s], Material [%s]", geometry.getName().c_str(), material->getName().c_str());
     
     if (_boneUBO) {
         _boneUBO->bind();
     }
 
-    VROGeometryElementOpenGL element = _elements[elementIndex];
+    passert (elementIndex < _vaos.size() && elementIndex >= 0);
+    const VROGeometryElementOpenGL &element = _elements[elementIndex];
     VROMaterialSubstrateOpenGL *substrate = static_cast<VROMaterialSubstrateOpenGL *>(material->getSubstrate(driver));
-    substrate->bindView(transform, viewMatrix, projectionMatrix, normalMatrix,
-                        context.getCamera().getPosition(), context.getEyeType());
+    VROMatrix4f dequantized;
+    substrate->bindView(getModelTransform(transform, &dequantized), *viewMatrix, *projectionMatrix, normalMatrix,
+                        context.getCamera().getPosition(), context.getEyeType(), driver);
+    if (context.isMultiviewEnabled()) {
+        bindMultiviewView(geometry, substrate, context);
+    }
+    
+    VRODriverOpenGL *driverGL = static_cast<VRODriverOpenGL *>(driver.get());
+    float distance = transform.extractTranslation().distance(context.getCamera().getPosition());
+    driverGL->setShadingRate(getShadingRate(geometry, *material, opacity, distance, context));
+    
+    // The vertex array is left bound, so that consecutive draws of this element
+    // (e.g. across passes) skip the rebind
+    driverGL->bindVertexArray(getVAO(geometry, elementIndex));
+    renderMaterial(geometry, material, substrate, element, opacity, geometry.getInstancedUBO(), context, driver);
     
+    pglpop();
+}
+
+void VROGeometrySubstrateOpenGL::renderInstanced(const VROGeometry &geometry,
+                                                 int elementIndex,
+                                                 const std::vector<VROMatrix4f> &transforms,
+                                                 const std::vector<VROMatrix4f> &normalMatrices,
+                                                 float opacity,
+                                                 const std::shared_ptr<VROMaterial> &material,
+                                                 const VRORenderContext &context,
+                                                 std::shared_ptr<VRODriver> &driver) {
+    const VROMatrix4f *viewMatrix;
+    const VROMatrix4f *projectionMatrix;
+    getViewProjection(geometry, context, &viewMatrix, &projectionMatrix);
+    
+    pglpush("Instanced Geometry [%s] x %d", geometry.getName().c_str(), (int) transforms.size());
+    
+    VRODriverOpenGL *driverGL = static_cast<VRODriverOpenGL *>(driver.get());
+    const std::shared_ptr<VROInstancedTransformUBO> &instancedUBO = driverGL->getInstancedTransformUBO();
+    if (_quantizedPositions) {
+        std::vector<VROMatrix4f> dequantized;
+        dequantized.reserve(transforms.size());
+        for (const VROMatrix4f &transform : transforms) {
+            dequantized.push_back(transform.multiply(_dequantization));
+        }
+        instancedUBO->update(dequantized, normalMatrices);
+    } else {
+        instancedUBO->update(transforms, normalMatrices);
+    }
+    
+    // The model and normal matrices are read per-instance from the UBO, so the
+    // uniforms are bound to identity
     passert (elementIndex < _vaos.size() && elementIndex >= 0);
-    GL (glBindVertexArray(_vaos[elementIndex]) );
-    renderMaterial(geometry, material, substrate, element, opacity, context, driver);
-    GL (glBindVertexArray(0) );
+    const VROGeometryElementOpenGL &element = _elements[elementIndex];
+    VROMaterialSubstrateOpenGL *substrate = static_cast<VROMaterialSubstrateOpenGL *>(material->getSubstrate(driver));
+    substrate->bindView(VROMatrix4f::identity(), *viewMatrix, *projectionMatrix, VROMatrix4f::identity(),
+                        context.getCamera().getPosition(), context.getEyeType(), driver);
+    if (context.isMultiviewEnabled()) {
+        bindMultiviewView(geometry, substrate, context);
+    }
+    
+    // Skinned geometries are instanced only when animated by a baked animation
+    const std::shared_ptr<VROSkinner> &skinner = geometry.getSkinner();
+    if (_boneUBO && skinner->getBakedAnimation()) {
+        _boneUBO->bindBakedAnimation(*skinner->getBakedAnimation());
+    }
+    
+    // Instances are spread across the scene, so only their content selects the rate
+    driverGL->setShadingRate(getShadingRate(geometry, *material, opacity, -1, context));
+    driverGL->bindVertexArray(getVAO(geometry, elementIndex));
+    renderMaterial(geometry, material, substrate, element, opacity, instancedUBO, context, driver);
     
     pglpop();
 }
@@ -335,12 +1194,46 @@ void VROGeometrySubstrateOpenGL::render(const VROGeometry &geometry,
 void VROGeometrySubstrateOpenGL::renderMaterial(const VROGeometry &geometry,
                                                 const std::shared_ptr<VROMaterial> &material,
                                                 VROMaterialSubstrateOpenGL *substrate,
-                                                VROGeometryElementOpenGL &element,
+                                                const VROGeometryElementOpenGL &element,
                                                 float opacity,
+                                                const std::shared_ptr<VROInstancedUBO> &instancedUBO,
                                                 const VRORenderContext &context,
                                                 std::shared_ptr<VRODriver> &driver) {
     substrate->bindGeometry(opacity, geometry);
+    bindTextures(material, substrate, context, driver);
+
+    if (instancedUBO != nullptr) {
+        int numberOfDraws = instancedUBO->getNumberOfDrawCalls();
+        for (int i = 0; i < numberOfDraws; i++) {
+            int instances = instancedUBO->bindDrawData(i);
+            GL( glDrawElementsInstanced(element.primitiveType, element.indexCount, element.indexType,
+                                        (GLvoid *) (uintptr_t) element.indexBufferOffset, instances) );
+            VRO_PROFILE_COUNT(InstancedDrawCalls, 1);
+            VRO_PROFILE_COUNT(Triangles, getTriangleCount(element) * instances);
+        }
+    }
+    else {
+        GL( glDrawElements(element.primitiveType, element.indexCount, element.indexType,
+                           (GLvoid *) (uintptr_t) element.indexBufferOffset) );
+        VRO_PROFILE_COUNT(DrawCalls, 1);
+        VRO_PROFILE_COUNT(Triangles, getTriangleCount(element));
+    }
+}
 
+int VROGeometrySubstrateOpenGL::getTriangleCount(const VROGeometryElementOpenGL &element) {
+    if (element.primitiveType == GL_TRIANGLES) {
+        return element.indexCount / 3;
+    }
+    else if (element.primitiveType == GL_TRIANGLE_STRIP) {
+        return std::max(element.indexCount - 2, 0);
+    }
+    return 0;
+}
+
+void VROGeometrySubstrateOpenGL::bindTextures(const std::shared_ptr<VROMaterial> &material,
+                                              VROMaterialSubstrateOpenGL *substrate,
+                                              const VRORenderContext &context,
+                                              std::shared_ptr<VRODriver> &driver) {
     int activeTexture = 0;
     const std::vector<VROTextureReference> &textureReferences = substrate->getTextures();
     for (int j = 0; j < textureReferences.size(); ++j) {
@@ -370,75 +1263,194 @@ void VROGeometrySubstrateOpenGL::renderMaterial(const VROGeometry &geometry,
             ++activeTexture;
         }
     }
+}
 
-    const std::shared_ptr<VROInstancedUBO> &instancedUBO = geometry.getInstancedUBO();
-    if (instancedUBO != nullptr) {
-        int numberOfDraws = instancedUBO->getNumberOfDrawCalls();
-        for (int i = 0; i < numberOfDraws; i++) {
-            int instances = instancedUBO->bindDrawData(i);
-            GL( glDrawElementsInstanced(element.primitiveType, element.indexCount, element.indexType, 0, instances) );
+bool VROGeometrySubstrateOpenGL::isMultiDrawCompatible(int elementIndex, const VROGeometrySubstrate &other,
+                                                       int otherElementIndex) const {
+    const VROGeometrySubstrateOpenGL &otherGL = static_cast<const VROGeometrySubstrateOpenGL &>(other);
+    if (!_arenaAllocation || !otherGL._arenaAllocation ||
+        _arenaAllocation->page != otherGL._arenaAllocation->page) {
+        return false;
+    }
+    
+    const VROGeometryElementOpenGL &element = _elements[elementIndex];
+    const VROGeometryElementOpenGL &otherElement = otherGL._elements[otherElementIndex];
+    if (element.primitiveType != otherElement.primitiveType || element.indexType != otherElement.indexType) {
+        return false;
+    }
+    
+    std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
+    return driver && driver->getGeometryArena()->isMultiDrawSupported();
+}
+
+void VROGeometrySubstrateOpenGL::renderMultiDraw(const VROGeometry &geometry,
+                                                 const std::vector<VROGeometrySubstrate *> &substrates,
+                                                 const std::vector<VROBoundingBox> &bounds,
+                                                 const std::vector<int> &elementIndices,
+                                                 const std::vector<VROMatrix4f> &transforms,
+                                                 const std::vector<VROMatrix4f> &normalMatrices,
+                                                 float opacity,
+                                                 const std::shared_ptr<VROMaterial> &material,
+                                                 const VRORenderContext &context,
+                                                 std::shared_ptr<VRODriver> &driver) {
+    passert (substrates.size() == elementIndices.size() && substrates.size() == transforms.size());
+    passert (!substrates.empty() && substrates.front() == this);
+    
+    const VROMatrix4f *viewMatrix;
+    const VROMatrix4f *projectionMatrix;
+    getViewProjection(geometry, context, &viewMatrix, &projectionMatrix);
+    
+    pglpush("Multi-draw [%s] x %d", geometry.getName().c_str(), (int) substrates.size());
+    
+    VRODriverOpenGL *driverGL = static_cast<VRODriverOpenGL *>(driver.get());
+    VROGeometryBufferArena *arena = driverGL->getGeometryArena();
+    const std::shared_ptr<VROInstancedTransformUBO> &instancedUBO = driverGL->getInstancedTransformUBO();
+    
+    // Each geometry in the page may have its own dequantization
+    std::vector<VROMatrix4f> modelTransforms;
+    modelTransforms.reserve(transforms.size());
+    for (int i = 0; i < substrates.size(); i++) {
+        VROMatrix4f dequantized;
+        const VROGeometrySubstrateOpenGL *other = static_cast<const VROGeometrySubstrateOpenGL *>(substrates[i]);
+        modelTransforms.push_back(other->getModelTransform(transforms[i], &dequantized));
+    }
+    instancedUBO->update(modelTransforms, normalMatrices);
+    
+    // As with instanced draws, the model and normal matrices are read from the
+    // UBO, indexed by the draw ID of each command
+    VROMaterialSubstrateOpenGL *substrate = static_cast<VROMaterialSubstrateOpenGL *>(material->getSubstrate(driver));
+    substrate->bindView(VROMatrix4f::identity(), *viewMatrix, *projectionMatrix, VROMatrix4f::identity(),
+                        context.getCamera().getPosition(), context.getEyeType(), driver);
+    if (context.isMultiviewEnabled()) {
+        bindMultiviewView(geometry, substrate, context);
+    }
+    substrate->bindGeometry(opacity, geometry);
+    bindTextures(material, substrate, context, driver);
+    
+    driverGL->setShadingRate(getShadingRate(geometry, *material, opacity, -1, context));
+    driverGL->bindVertexArray(arena->getVertexArray(*_arenaAllocation));
+    
+    const VROGeometryElementOpenGL &firstElement = _elements[elementIndices.front()];
+    int bytesPerIndex = (firstElement.indexType == GL_UNSIGNED_SHORT) ? 2 : 4;
+    
+    // Each command selects its transforms by base instance, within the current UBO draw
+    passert (kMaxInstancesPerUBO <= arena->getMaxMultiDrawCommands());
+    
+    // Cull the commands on the GPU against this eye's frustum. Multiview draws
+    // cover both eyes, and are left to the CPU's cull
+    VROGPUCullRequest cullRequest;
+    cullRequest.culler = context.isMultiviewEnabled() ? nullptr : driverGL->getGPUCuller();
+    std::vector<VROGPUCullObject> cullObjects;
+    if (cullRequest.culler) {
+        cullObjects.reserve(substrates.size());
+        for (int i = 0; i < substrates.size(); i++) {
+            cullObjects.push_back(VROGPUCullerOpenGL::buildObject(bounds[i], transforms[i]));
         }
+        cullRequest.viewProjection = projectionMatrix->multiply(*viewMatrix);
     }
-    else {
-        GL( glDrawElements(element.primitiveType, element.indexCount, element.indexType, 0) );
+    
+    std::vector<VROMultiDrawCommand> commands;
+    int numberOfDraws = instancedUBO->getNumberOfDrawCalls();
+    for (int d = 0; d < numberOfDraws; d++) {
+        int count = instancedUBO->bindDrawData(d);
+        
+        commands.clear();
+        for (int j = 0; j < count; j++) {
+            int index = d * kMaxInstancesPerUBO + j;
+            const VROGeometrySubstrateOpenGL *other = static_cast<const VROGeometrySubstrateOpenGL *>(substrates[index]);
+            const VROGeometryElementOpenGL &element = other->_elements[elementIndices[index]];
+            
+            VROMultiDrawCommand command;
+            command.count = element.indexCount;
+            command.instanceCount = 1;
+            command.firstIndex = element.indexBufferOffset / bytesPerIndex;
+            command.baseVertex = 0;
+            command.baseInstance = j;
+            commands.push_back(command);
+        }
+        if (cullRequest.culler) {
+            cullRequest.objects = &cullObjects[d * kMaxInstancesPerUBO];
+        }
+        arena->multiDraw(firstElement.primitiveType, firstElement.indexType, commands.data(), (int) commands.size(),
+                         cullRequest.culler ? &cullRequest : nullptr);
     }
+    
+    pglpop();
+}
+
+void VROGeometrySubstrateOpenGL::bindMultiviewView(const VROGeometry &geometry,
+                                                   VROMaterialSubstrateOpenGL *substrate,
+                                                   const VRORenderContext &context) {
+    VROMatrix4f viewMatrices[kMultiviewNumViews];
+    VROMatrix4f projectionMatrices[kMultiviewNumViews];
+    
+    for (int i = 0; i < kMultiviewNumViews; i++) {
+        viewMatrices[i] = context.getMultiviewViewMatrix(i);
+        projectionMatrices[i] = context.getMultiviewProjectionMatrix(i);
+        
+        if (geometry.isCameraEnclosure()) {
+            viewMatrices[i] = context.getEnclosureViewMatrix();
+        }
+        if (geometry.isScreenSpace()) {
+            viewMatrices[i] = VROMatrix4f();
+            projectionMatrices[i] = context.getOrthographicMatrix();
+        }
+    }
+    substrate->bindMultiviewView(viewMatrices, projectionMatrices);
 }
 
 void VROGeometrySubstrateOpenGL::renderSilhouette(const VROGeometry &geometry,
-                                                  VROMatrix4f transform,
+                                                  const VROMatrix4f &transform,
                                                   std::shared_ptr<VROMaterial> &material,
                                                   const VRORenderContext &context,
                                                   std::shared_ptr<VRODriver> &driver) {
     
-    VROMatrix4f viewMatrix = context.getViewMatrix();
-    VROMatrix4f projectionMatrix = context.getProjectionMatrix();
-    VROMatrix4f normalMatrix; // Silhouettes ignore lighting so normal matrix can be identity
-
-    if (geometry.isCameraEnclosure()) {
-        viewMatrix = context.getEnclosureViewMatrix();
-    }
-    if (geometry.isScreenSpace()) {
-        viewMatrix = VROMatrix4f();
-        projectionMatrix = context.getOrthographicMatrix();
-    }
+    const VROMatrix4f *viewMatrix;
+    const VROMatrix4f *projectionMatrix;
+    getViewProjection(geometry, context, &viewMatrix, &projectionMatrix);
+    
+    // Silhouettes ignore lighting so normal matrix can be identity
+    const VROMatrix4f &normalMatrix = VROMatrix4f::identity();
+    VRODriverOpenGL *driverGL = static_cast<VRODriverOpenGL *>(driver.get());
     
     pglpush("Silhouette [%s]", geometry.getName().c_str());
     for (int i = 0; i < geometry.getGeometryElements().size(); i++) {
-        VROGeometryElementOpenGL &element = _elements[i];
+        const VROGeometryElementOpenGL &element = _elements[i];
         if (_boneUBO) {
             _boneUBO->bind();
         }
         
         VROMaterialSubstrateOpenGL *substrate = static_cast<VROMaterialSubstrateOpenGL *>(material->getSubstrate(driver));
-        substrate->bindView(transform, viewMatrix, projectionMatrix, normalMatrix,
-                            context.getCamera().getPosition(), context.getEyeType());
+        VROMatrix4f dequantized;
+        substrate->bindView(getModelTransform(transform, &dequantized), *viewMatrix, *projectionMatrix, normalMatrix,
+                            context.getCamera().getPosition(), context.getEyeType(), driver);
+        if (context.isMultiviewEnabled()) {
+            bindMultiviewView(geometry, substrate, context);
+        }
         
-        GL( glBindVertexArray(_vaos[i]) );
+        driverGL->bindVertexArray(getVAO(geometry, i));
         substrate->bindGeometry(1.0, geometry);
-        GL( glDrawElements(element.primitiveType, element.indexCount, element.indexType, 0) );
-        GL( glBindVertexArray(0) );
+        GL( glDrawElements(element.primitiveType, element.indexCount, element.indexType,
+                           (GLvoid *) (uintptr_t) element.indexBufferOffset) );
+        VRO_PROFILE_COUNT(DrawCalls, 1);
+        VRO_PROFILE_COUNT(Triangles, getTriangleCount(element));
     }
     pglpop();
 }
 
 void VROGeometrySubstrateOpenGL::renderSilhouetteTextured(const VROGeometry &geometry,
                                                           int elementIndex,
-                                                          VROMatrix4f transform,
+                                                          const VROMatrix4f &transform,
                                                           std::shared_ptr<VROMaterial> &material,
                                                           const VRORenderContext &context,
                                                           std::shared_ptr<VRODriver> &driver) {
     
-    VROMatrix4f viewMatrix = context.getViewMatrix();
-    VROMatrix4f projectionMatrix = context.getProjectionMatrix();
-    VROMatrix4f normalMatrix; // Silhouettes ignore lighting so normal matrix can be identity
+    const VROMatrix4f *viewMatrix;
+    const VROMatrix4f *projectionMatrix;
+    getViewProjection(geometry, context, &viewMatrix, &projectionMatrix);
     
-    if (geometry.isCameraEnclosure()) {
-        viewMatrix = context.getEnclosureViewMatrix();
-    }
-    if (geometry.isScreenSpace()) {
-        viewMatrix = VROMatrix4f();
-        projectionMatrix = context.getOrthographicMatrix();
-    }
+    // Silhouettes ignore lighting so normal matrix can be identity
+    const VROMatrix4f &normalMatrix = VROMatrix4f::identity();
     
     pglpush("Silhouette [%s]", geometry.getName().c_str());
     
@@ -446,14 +1458,17 @@ void VROGeometrySubstrateOpenGL::renderSilhouetteTextured(const VROGeometry &geo
         _boneUBO->bind();
     }
 
-    VROGeometryElementOpenGL &element = _elements[elementIndex];
+    const VROGeometryElementOpenGL &element = _elements[elementIndex];
     VROMaterialSubstrateOpenGL *substrate = static_cast<VROMaterialSubstrateOpenGL *>(material->getSubstrate(driver));
-    substrate->bindView(transform, viewMatrix, projectionMatrix, normalMatrix,
-                        context.getCamera().getPosition(), context.getEyeType());
+    VROMatrix4f dequantized;
+    substrate->bindView(getModelTransform(transform, &dequantized), *viewMatrix, *projectionMatrix, normalMatrix,
+                        context.getCamera().getPosition(), context.getEyeType(), driver);
+    if (context.isMultiviewEnabled()) {
+        bindMultiviewView(geometry, substrate, context);
+    }
     
-    GL( glBindVertexArray(_vaos[elementIndex]) );
-    renderMaterial(geometry, material, substrate, element, 1.0, context, driver);
-    GL( glBindVertexArray(0) );
+    static_cast<VRODriverOpenGL *>(driver.get())->bindVertexArray(getVAO(geometry, elementIndex));
+    renderMaterial(geometry, material, substrate, element, 1.0, geometry.getInstancedUBO(), context, driver);
     
     pglpop();
 }
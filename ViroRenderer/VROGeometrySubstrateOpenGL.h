@@ -38,6 +38,10 @@ class VROGeometrySource;
 class VROGeometryElement;
 class VROMaterialSubstrateOpenGL;
 class VROBoneUBO;
+class VROSkinningCache;
+class VROInstancedUBO;
+class VROData;
+struct VROGeometryArenaAllocation;
 enum class VROGeometryPrimitiveType;
 
 struct VROGeometryElementOpenGL {
@@ -52,6 +56,7 @@ struct VROVertexAttributeOpenGL {
     GLuint index;
     GLint size;
     GLenum type;
+    GLboolean normalized;
     uintptr_t offset;
 };
 
@@ -63,6 +68,32 @@ struct VROVertexDescriptorOpenGL {
     bool ownsBuffer;
 };
 
+/*
+ Layouts are compatible if they have the same stride and the same attributes,
+ in any order.
+ */
+inline bool VROIsLayoutCompatible(const VROVertexDescriptorOpenGL &a, const VROVertexDescriptorOpenGL &b) {
+    if (a.stride != b.stride || a.numAttributes != b.numAttributes) {
+        return false;
+    }
+    for (int i = 0; i < a.numAttributes; i++) {
+        const VROVertexAttributeOpenGL &attribute = a.attributes[i];
+        bool found = false;
+        for (int j = 0; j < b.numAttributes; j++) {
+            const VROVertexAttributeOpenGL &other = b.attributes[j];
+            if (attribute.index == other.index) {
+                found = attribute.size == other.size && attribute.type == other.type &&
+                        attribute.normalized == other.normalized && attribute.offset == other.offset;
+                break;
+            }
+        }
+        if (!found) {
+            return false;
+        }
+    }
+    return true;
+}
+
 class VROGeometrySubstrateOpenGL : public VROGeometrySubstrate {
     
 public:
@@ -73,24 +104,50 @@ public:
     
     void update(const VROGeometry &geometry,
                 std::shared_ptr<VRODriver> &driver);
+    bool updateSourceData(const std::vector<std::shared_ptr<VROGeometrySource>> &sources,
+                          std::shared_ptr<VRODriver> &driver);
+    bool updateGeometry(const VROGeometry &geometry, bool appendOnly,
+                        std::shared_ptr<VRODriver> &driver);
     void render(const VROGeometry &geometry,
                 int elementIndex,
-                VROMatrix4f transform,
-                VROMatrix4f normalMatrix,
+                const VROMatrix4f &transform,
+                const VROMatrix4f &normalMatrix,
                 float opacity,
                 const std::shared_ptr<VROMaterial> &material,
                 const VRORenderContext &context,
                 std::shared_ptr<VRODriver> &driver);
     
+    void renderInstanced(const VROGeometry &geometry,
+                         int elementIndex,
+                         const std::vector<VROMatrix4f> &transforms,
+                         const std::vector<VROMatrix4f> &normalMatrices,
+                         float opacity,
+                         const std::shared_ptr<VROMaterial> &material,
+                         const VRORenderContext &context,
+                         std::shared_ptr<VRODriver> &driver);
+    
+    bool isMultiDrawCompatible(int elementIndex, const VROGeometrySubstrate &other,
+                               int otherElementIndex) const;
+    void renderMultiDraw(const VROGeometry &geometry,
+                         const std::vector<VROGeometrySubstrate *> &substrates,
+                         const std::vector<VROBoundingBox> &bounds,
+                         const std::vector<int> &elementIndices,
+                         const std::vector<VROMatrix4f> &transforms,
+                         const std::vector<VROMatrix4f> &normalMatrices,
+                         float opacity,
+                         const std::shared_ptr<VROMaterial> &material,
+                         const VRORenderContext &context,
+                         std::shared_ptr<VRODriver> &driver);
+    
     void renderSilhouette(const VROGeometry &geometry,
-                          VROMatrix4f transform,
+                          const VROMatrix4f &transform,
                           std::shared_ptr<VROMaterial> &material,
                           const VRORenderContext &context,
                           std::shared_ptr<VRODriver> &driver);
     
     void renderSilhouetteTextured(const VROGeometry &geometry,
                                   int element,
-                                  VROMatrix4f transform,
+                                  const VROMatrix4f &transform,
                                   std::shared_ptr<VROMaterial> &material,
                                   const VRORenderContext &context,
                                   std::shared_ptr<VRODriver> &driver);
@@ -102,6 +159,60 @@ private:
     std::map<int, std::vector<VROVertexDescriptorOpenGL>> _elementToDescriptorsMap;
     std::vector<VROVertexDescriptorOpenGL> _vertexDescriptors;
 
+    /*
+     The buffer into which each raw data buffer of this geometry's sources was
+     uploaded, so that its contents can be updated in place.
+     */
+    std::map<std::shared_ptr<VROData>, GLuint> _dataBuffers;
+    
+    /*
+     The range of the VROGeometryBufferArena holding this geometry's vertices and
+     indices, if it was allocated from the arena. In this case the arena owns
+     the buffers and VAO.
+     */
+    std::unique_ptr<VROGeometryArenaAllocation> _arenaAllocation;
+    
+    /*
+     Bytes of the vertex and index buffers this substrate allocated itself (i.e.
+     not those of the arena or of shared VROVertexBuffers), as reported to
+     VROAllocationTracker.
+     */
+    int64_t _vertexBufferBytes;
+    int64_t _indexBufferBytes;
+    
+    /*
+     True if this geometry's positions were quantized to normalized shorts over
+     its bounding box. The model transform of each draw is then multiplied by
+     _dequantization, which maps the quantized positions back to model space.
+     */
+    bool _quantizedPositions;
+    VROMatrix4f _dequantization;
+    
+    /*
+     True if this substrate was created for a dynamic geometry. Each vertex buffer
+     and element buffer of a dynamic geometry is split into kDynamicBufferSegments
+     segments of the given sizes (one size per vertex descriptor, and one per
+     element). Each update writes the next segment and points the VAOs at it, so
+     the CPU never writes over data the GPU may still be reading.
+     
+     Append-only updates instead write just the added bytes, past the lengths
+     last written to the current segment. Frames in flight only read within
+     those lengths, so the segment is kept.
+     */
+    bool _dynamic;
+    int _dynamicSegment;
+    std::vector<GLsizeiptr> _dynamicVertexSegmentSizes;
+    std::vector<GLsizeiptr> _dynamicIndexSegmentSizes;
+    std::vector<GLsizeiptr> _dynamicVertexLengths;
+    std::vector<GLsizeiptr> _dynamicIndexLengths;
+    
+    /*
+     Write the data the given dynamic sources and elements added since they were
+     last uploaded. Returns false if any of them shrank.
+     */
+    bool appendDynamicGeometry(const std::vector<std::pair<std::shared_ptr<VROData>, std::vector<std::shared_ptr<VROGeometrySource>>>> &groups,
+                               const std::vector<std::shared_ptr<VROGeometryElement>> &elements);
+
     /*
      Parse the given geometry elements and populate the _elements vector with the
      results.
@@ -110,14 +221,85 @@ private:
     
     /*
      Parse the given geometry sources and populate the _vars vector with the
-     results.
+     results. Raw data buffers are uploaded with the given usage hint.
      */
-    void readGeometrySources(const std::vector<std::shared_ptr<VROGeometrySource>> &sources);
+    void readGeometrySources(const std::vector<std::shared_ptr<VROGeometrySource>> &sources,
+                             GLenum usage);
     
     /*
      Create a Vertex Array Object for each element.
      */
     void createVAO();
+    
+    /*
+     Upload the sources and elements of the given dynamic geometry into
+     segmented streaming buffers. Returns false if the geometry's sources are
+     not all CPU data applying to every element, or if it is skinned or morphed,
+     in which case the geometry is uploaded as usual.
+     */
+    bool readDynamicGeometry(const VROGeometry &geometry);
+    
+    /*
+     Place the elements and sources of the given geometry in the driver's
+     VROGeometryBufferArena, sharing the arena's buffers and VAO. Returns false
+     if the geometry is not eligible (e.g. it is large, skinned, morphed, or
+     its vertex data is not interleaved in a single buffer), in which case it
+     is given its own buffers.
+     */
+    bool allocateFromArena(const VROGeometry &geometry,
+                           const VROVertexDescriptorOpenGL &layout,
+                           const std::shared_ptr<VROData> &data,
+                           int vertexCount,
+                           std::shared_ptr<VRODriverOpenGL> &driver);
+    
+    /*
+     If the given sources interleave all of their attributes in a single data
+     buffer, return that buffer, its layout, and its vertex count.
+     */
+    bool readInterleavedLayout(const std::vector<std::shared_ptr<VROGeometrySource>> &sources,
+                               std::shared_ptr<VROData> *outData,
+                               VROVertexDescriptorOpenGL *outLayout,
+                               int *outVertexCount);
+    
+    /*
+     Re-encode the given float sources into a compact interleaved vertex format:
+     normals and tangents become normalized 10_10_10_2 integers (the tangent's
+     handedness fits in the 2-bit W), texcoords within [-2, 2] become half
+     floats, and positions become normalized shorts over the bounding box,
+     recording their dequantization in _dequantization. The GPU decodes each of
+     these formats to floats when fetching attributes, so shaders are unchanged.
+     
+     Returns false if the geometry is not eligible (e.g. it is skinned or
+     morphed, or has attributes other than position, normal, tangent and
+     texcoord). Positions are left as floats for instanced geometry, and for
+     geometry whose materials have geometry shader modifiers, since these may
+     read model space positions before the model transform is applied.
+     */
+    bool compactGeometrySources(const VROGeometry &geometry,
+                                const std::vector<std::shared_ptr<VROGeometrySource>> &sources,
+                                std::shared_ptr<VROData> *outData,
+                                VROVertexDescriptorOpenGL *outLayout,
+                                int *outVertexCount);
+    
+    /*
+     Return the model transform to bind for the given node transform: the
+     transform itself, or if positions are quantized the transform applied
+     after dequantization, which is written to the given scratch matrix.
+     */
+    const VROMatrix4f &getModelTransform(const VROMatrix4f &transform, VROMatrix4f *scratch) const;
+    
+    /*
+     Create the skinning cache for the given geometry, along with a second set of
+     VAOs that read positions from the cache. Returns false if this geometry's
+     skinning cannot be cached.
+     */
+    bool createSkinningCache(const VROGeometry &geometry);
+    
+    /*
+     Get the VAO to use when rendering the given element: the skinned VAO if this
+     frame's skinned vertices are in the skinning cache, otherwise the regular VAO.
+     */
+    GLuint getVAO(const VROGeometry &geometry, int elementIndex) const;
 
     /*
      Parse the component type and number of components from the given geometry source.
@@ -150,13 +332,45 @@ private:
      */
     std::unique_ptr<VROBoneUBO> _boneUBO;
     
+    /*
+     If this geometry's skinning is cached, the buffer into which its vertices are
+     skinned each frame, and the per-element VAOs that read positions from that
+     buffer. _skinningCacheSupported is false if the layout of this geometry's
+     vertex data prevents caching.
+     */
+    std::unique_ptr<VROSkinningCache> _skinningCache;
+    std::vector<GLuint> _skinnedVAOs;
+    bool _skinningCacheSupported;
+    
+    /*
+     Bind the textures of the given material's active shader binding.
+     */
+    void bindTextures(const std::shared_ptr<VROMaterial> &material,
+                      VROMaterialSubstrateOpenGL *substrate,
+                      const VRORenderContext &context,
+                      std::shared_ptr<VRODriver> &driver);
+    
     void renderMaterial(const VROGeometry &geometry,
                         const std::shared_ptr<VROMaterial> &material,
                         VROMaterialSubstrateOpenGL *substrate,
-                        VROGeometryElementOpenGL &element,
+                        const VROGeometryElementOpenGL &element,
                         float opacity,
+                        const std::shared_ptr<VROInstancedUBO> &instancedUBO,
                         const VRORenderContext &renderContext,
                         std::shared_ptr<VRODriver> &driver);
+
+    /*
+     The number of triangles drawn by one instance of the given element.
+     */
+    static int getTriangleCount(const VROGeometryElementOpenGL &element);
+
+    /*
+     Bind each eye's view and projection to the given substrate during multiview
+     passes. Camera enclosures and screen space geometries use the same matrices
+     for both views.
+     */
+    void bindMultiviewView(const VROGeometry &geometry, VROMaterialSubstrateOpenGL *substrate,
+                           const VRORenderContext &context);
     
 };
 
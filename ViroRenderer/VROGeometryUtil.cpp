@@ -32,7 +32,9 @@
 #include "VROLog.h"
 #include "VRONode.h"
 #include "VROGeometry.h"
+#include "VROSkinner.h"
 #include <set>
+#include <map>
 
 std::vector<std::shared_ptr<VRONode>> VROGeometryUtilSplitNodeByGeometryElements(std::shared_ptr<VRONode> node) {
     std::vector<std::shared_ptr<VRONode>> nodes;
@@ -107,6 +109,192 @@ std::shared_ptr<VROData> VROGeometryUtilExtractAndCenter(std::shared_ptr<VROGeom
     return source->getData();
 }
 
+std::vector<std::shared_ptr<VROGeometry>> VROGeometryUtilSplitByBoneLimit(std::shared_ptr<VROGeometry> geometry, int maxBones) {
+    std::vector<std::shared_ptr<VROGeometry>> partitions;
+    
+    const std::shared_ptr<VROSkinner> &skinner = geometry->getSkinner();
+    if (!skinner || !skinner->getBoneIndices() || !skinner->getBoneWeights()) {
+        return partitions;
+    }
+    
+    /*
+     Read the (up to) four bones that influence each vertex. Bones with no weight are
+     ignored, as they need not be in the vertex's palette.
+     */
+    std::shared_ptr<VROGeometrySource> boneIndicesSource = skinner->getBoneIndices();
+    std::shared_ptr<VROGeometrySource> boneWeightsSource = skinner->getBoneWeights();
+    int vertexCount = boneIndicesSource->getVertexCount();
+    
+    std::vector<int> boneIndices(vertexCount * 4, 0);
+    boneIndicesSource->processVertices([&boneIndices, vertexCount](int index, VROVector4f vertex) {
+        if (index < vertexCount) {
+            boneIndices[index * 4 + 0] = (int) vertex.x;
+            boneIndices[index * 4 + 1] = (int) vertex.y;
+            boneIndices[index * 4 + 2] = (int) vertex.z;
+            boneIndices[index * 4 + 3] = (int) vertex.w;
+        }
+    });
+    std::vector<bool> influences(vertexCount * 4, false);
+    boneWeightsSource->processVertices([&influences, vertexCount](int index, VROVector4f weight) {
+        if (index < vertexCount) {
+            influences[index * 4 + 0] = weight.x > 0;
+            influences[index * 4 + 1] = weight.y > 0;
+            influences[index * 4 + 2] = weight.z > 0;
+            influences[index * 4 + 3] = weight.w > 0;
+        }
+    });
+    
+    /*
+     Nothing to do if every bone already fits in the UBO.
+     */
+    bool fits = true;
+    for (int i = 0; i < vertexCount * 4; i++) {
+        if (influences[i] && skinner->getPaletteBone(boneIndices[i]) >= maxBones) {
+            fits = false;
+            break;
+        }
+    }
+    if (fits) {
+        return partitions;
+    }
+    
+    /*
+     Greedily partition the triangles of each element, in order, such that each
+     partition references at most maxBones bones.
+     */
+    struct VROBonePartition {
+        int elementIndex;
+        std::vector<int> indices;
+        std::set<int> bones;
+    };
+    std::vector<VROBonePartition> boneParts;
+    
+    const std::vector<std::shared_ptr<VROGeometryElement>> &elements = geometry->getGeometryElements();
+    for (int e = 0; e < elements.size(); e++) {
+        const std::shared_ptr<VROGeometryElement> &element = elements[e];
+        if (element->getPrimitiveType() != VROGeometryPrimitiveType::Triangle) {
+            pwarn("Cannot split skinned geometry [%s] by bones: only triangle elements are supported",
+                  geometry->getName().c_str());
+            return {};
+        }
+        
+        std::vector<int> elementIndices;
+        elementIndices.reserve(element->getPrimitiveCount() * 3);
+        element->visitIndices([&elementIndices](int index, int indexRead) {
+            elementIndices.push_back(indexRead);
+            return true;
+        });
+        
+        VROBonePartition part;
+        part.elementIndex = e;
+        for (int t = 0; t + 2 < elementIndices.size(); t += 3) {
+            std::set<int> triangleBones;
+            for (int v = 0; v < 3; v++) {
+                int vertex = elementIndices[t + v];
+                for (int b = 0; b < 4; b++) {
+                    if (influences[vertex * 4 + b]) {
+                        triangleBones.insert(skinner->getPaletteBone(boneIndices[vertex * 4 + b]));
+                    }
+                }
+            }
+            
+            std::set<int> bones = part.bones;
+            bones.insert(triangleBones.begin(), triangleBones.end());
+            if (bones.size() > maxBones && !part.indices.empty()) {
+                boneParts.push_back(part);
+                part.indices.clear();
+                bones = triangleBones;
+            }
+            part.bones = bones;
+            part.indices.insert(part.indices.end(), elementIndices.begin() + t, elementIndices.begin() + t + 3);
+        }
+        if (!part.indices.empty()) {
+            boneParts.push_back(part);
+        }
+    }
+    
+    /*
+     Each partition becomes a geometry that shares the original vertex data, with its
+     own element and bone indices remapped into its own palette.
+     */
+    std::vector<std::shared_ptr<VROGeometrySource>> sources;
+    for (const std::shared_ptr<VROGeometrySource> &source : geometry->getGeometrySources()) {
+        if (source->getSemantic() != VROGeometrySourceSemantic::BoneIndices &&
+            source->getSemantic() != VROGeometrySourceSemantic::BoneWeights) {
+            sources.push_back(source);
+        }
+    }
+    const std::vector<std::shared_ptr<VROMaterial>> &materials = geometry->getMaterials();
+    
+    for (VROBonePartition &part : boneParts) {
+        std::vector<int> palette(part.bones.begin(), part.bones.end());
+        std::map<int, int> paletteIndex;
+        for (int i = 0; i < palette.size(); i++) {
+            paletteIndex[palette[i]] = i;
+        }
+        
+        std::vector<int> partBoneIndices(vertexCount * 4, 0);
+        for (int vertex : part.indices) {
+            for (int b = 0; b < 4; b++) {
+                if (influences[vertex * 4 + b]) {
+                    int bone = skinner->getPaletteBone(boneIndices[vertex * 4 + b]);
+                    partBoneIndices[vertex * 4 + b] = paletteIndex[bone];
+                }
+            }
+        }
+        
+        std::shared_ptr<VROData> boneIndicesData = std::make_shared<VROData>((void *) partBoneIndices.data(),
+                                                                             (int) (partBoneIndices.size() * sizeof(int)));
+        std::shared_ptr<VROGeometrySource> partBoneIndicesSource = std::make_shared<VROGeometrySource>(boneIndicesData,
+                                                                                                       VROGeometrySourceSemantic::BoneIndices,
+                                                                                                       vertexCount, false, 4, sizeof(int),
+                                                                                                       0, 4 * sizeof(int));
+        std::shared_ptr<VROData> indexData = std::make_shared<VROData>((void *) part.indices.data(),
+                                                                       (int) (part.indices.size() * sizeof(int)));
+        std::shared_ptr<VROGeometryElement> partElement = std::make_shared<VROGeometryElement>(indexData,
+                                                                                               VROGeometryPrimitiveType::Triangle,
+                                                                                               (int) part.indices.size() / 3,
+                                                                                               sizeof(int));
+        
+        std::shared_ptr<VROGeometry> partition = std::make_shared<VROGeometry>(sources, std::vector<std::shared_ptr<VROGeometryElement>>{ partElement });
+        partition->setName(geometry->getName());
+        if (!materials.empty()) {
+            partition->setMaterials({ materials[part.elementIndex % materials.size()] });
+        }
+        partition->setSkinner(std::make_shared<VROSkinner>(skinner, palette, partBoneIndicesSource, boneWeightsSource));
+        partitions.push_back(partition);
+    }
+    
+    return partitions;
+}
+
+void VROGeometryUtilSplitNodeByBoneLimit(std::shared_ptr<VRONode> node, int maxBones) {
+    std::shared_ptr<VROGeometry> geometry = node->getGeometry();
+    if (!geometry) {
+        return;
+    }
+    std::vector<std::shared_ptr<VROGeometry>> partitions = VROGeometryUtilSplitByBoneLimit(geometry, maxBones);
+    if (partitions.empty()) {
+        return;
+    }
+    
+    /*
+     The first partition replaces the node's geometry; the rest are placed in child
+     nodes with identity transforms, so that all partitions share the node's
+     transform and are driven by the same skeleton.
+     */
+    node->setGeometry(partitions[0]);
+    for (int i = 1; i < partitions.size(); i++) {
+        std::shared_ptr<VRONode> partitionNode = std::make_shared<VRONode>();
+        // Nodes built off the rendering thread pass their lifted restriction on to their partitions
+        partitionNode->setThreadRestrictionEnabled(node->isThreadRestrictionEnabled());
+        partitionNode->setName(node->getName());
+        partitionNode->setRenderingOrder(node->getRenderingOrder());
+        partitionNode->setGeometry(partitions[i]);
+        node->addChildNode(partitionNode);
+    }
+}
+
 int VROGeometryUtilGetIndicesCount(int primitiveCount, VROGeometryPrimitiveType primitiveType) {
     switch (primitiveType) {
         case VROGeometryPrimitiveType::Triangle:
@@ -36,6 +36,7 @@ class VROVector3f;
 class VROGeometryElement;
 class VROGeometrySource;
 class VRONode;
+class VROGeometry;
 enum class VROGeometrySourceSemantic;
 enum class VROGeometryPrimitiveType;
 
@@ -54,6 +55,22 @@ std::shared_ptr<VROData> VROGeometryUtilExtractAndCenter(std::shared_ptr<VROGeom
                                                          std::shared_ptr<VROGeometrySource> geometrySource,
                                                          VROVector3f *outCenter);
 
+/*
+ Split the given skinned geometry so that each partition's bones fit in the bone UBO:
+ the triangles of each element are partitioned such that each partition references at
+ most maxBones bones, and each partition receives its own VROSkinner, whose palette maps
+ its bone indices to the skeleton. The partitions share the original vertex data. Returns
+ an empty vector if the geometry's bones already fit.
+ */
+std::vector<std::shared_ptr<VROGeometry>> VROGeometryUtilSplitByBoneLimit(std::shared_ptr<VROGeometry> geometry, int maxBones);
+
+/*
+ Split the skinned geometry of the given node with VROGeometryUtilSplitByBoneLimit, if
+ required. The first partition replaces the node's geometry, and the others are added
+ in new child nodes.
+ */
+void VROGeometryUtilSplitNodeByBoneLimit(std::shared_ptr<VRONode> node, int maxBones);
+
 /*
  Get how many indices are required to render the given number of primitives of the
  given type, and vice-versa.
@@ -67,4 +84,11 @@ int VROGeometryUtilGetPrimitiveCount(int indicesCount, VROGeometryPrimitiveType
  */
 int VROGeometryUtilParseAttributeIndex(VROGeometrySourceSemantic semantic);
 
+/*
+ Attribute index of the draw ID read by multi-draw shaders (see
+ VROShaderProgram::enableDrawID). Shares the index of EdgeCrease, which no
+ shader reads.
+ */
+static const int kDrawIDAttributeIndex = 6;
+
 #endif /* VROGeometryUtil_h */
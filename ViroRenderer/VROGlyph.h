@@ -33,6 +33,7 @@
 #include "VROVector3f.h"
 #include "VROTriangle.h"
 #include "VROAllocationTracker.h"
+#include "VROShapeUtils.h"
 #include <ft2build.h>
 #include FT_FREETYPE_H
 
@@ -46,6 +47,28 @@ enum class VROGlyphRenderMode {
     None,
     Bitmap,
     Vector,
+    DistanceField,
+};
+
+/*
+ Distance field glyphs are rasterized once at this pixel size, and scaled to
+ the size of each typeface. The field extends kDistanceFieldSpread pixels (at
+ this size) beyond the glyph's edge, which bounds the widest outline that can
+ be drawn from it.
+ */
+static const int kDistanceFieldGlyphSize = 48;
+static const int kDistanceFieldSpread = 8;
+
+/*
+ The triangles of a vectorized glyph as renderable vertices, extruded to a given
+ depth. Vertices are ordered front, back, then side, so the glyph's indices for
+ each face form a contiguous range.
+ */
+class VROGlyphMesh {
+public:
+    std::vector<VROShapeVertexLayout> vertices;
+    int numFrontVertices;
+    int numBackVertices;
 };
 
 /*
@@ -105,6 +128,12 @@ public:
      atlas vector. The loaded bitmap data will be available by calling
      getBitmap(outlineWidth).
      
+     The loadDistanceFieldBitmap method renders the glyph at the face's current
+     size, converts it into a signed distance field, and writes the field to the
+     given atlas vector. The field is available by invoking getBitmap(0). Distance
+     field atlases store 0.5 at the glyph's edge, increasing inward, with
+     kDistanceFieldSpread pixels mapping to 0.5.
+     
      Finally, the loadVector method craetes the contours of the glyph in 3D,
      triangulates them, and stores the results, which are accessible via
      getTriangles(). This method is used for 3D text rendering.
@@ -120,6 +149,9 @@ public:
                                    uint32_t outlineWidth,
                                    std::vector<std::shared_ptr<VROGlyphAtlas>> *atlases,
                                    std::shared_ptr<VRODriver> driver) = 0;
+    virtual bool loadDistanceFieldBitmap(FT_Face face, uint32_t charCode, uint32_t variantSelector,
+                                         std::vector<std::shared_ptr<VROGlyphAtlas>> *atlases,
+                                         std::shared_ptr<VRODriver> driver) = 0;
     virtual bool loadVector(FT_Face face, uint32_t charCode, uint32_t variantSelector) = 0;
     
 #pragma mark - Bitmap Fonts
@@ -132,12 +164,28 @@ public:
         return _bitmaps.find(outlineWidth)->second;
     }
     
+    /*
+     Override the bitmap for the given outline width. Used by distance field
+     glyphs, which share one rasterization across sizes.
+     */
+    void setBitmap(int outlineWidth, const VROGlyphBitmap &bitmap) {
+        _bitmaps[outlineWidth] = bitmap;
+    }
+    
 #pragma mark - Vector Fonts
     
     const std::vector<VROGlyphTriangle> &getTriangles() const {
         return _triangles;
     }
     
+    /*
+     Get the triangles of this glyph as a mesh, scaled by the given factor and
+     extruded to the given depth. Meshes are cached by scale and extrusion, so
+     text that is rebuilt at the same depth only has to translate the vertices
+     of each glyph into place. Must be invoked from the rendering thread.
+     */
+    const VROGlyphMesh &getExtrudedMesh(float scale, float extrusion);
+    
 #pragma mark - All Fonts
     
     long getAdvance() const {
@@ -163,6 +211,11 @@ protected:
      */
     std::vector<VROGlyphTriangle> _triangles;
     
+    /*
+     The meshes built from _triangles, by scale and extrusion.
+     */
+    std::map<std::pair<float, float>, VROGlyphMesh> _extrudedMeshes;
+    
 };
 
 enum class VROGlyphTriangleType {
@@ -194,4 +247,34 @@ private:
     VROGlyphTriangleType _type;
 };
 
+inline const VROGlyphMesh &VROGlyph::getExtrudedMesh(float scale, float extrusion) {
+    std::pair<float, float> key = { scale, extrusion };
+    auto it = _extrudedMeshes.find(key);
+    if (it != _extrudedMeshes.end()) {
+        return it->second;
+    }
+    
+    VROGlyphMesh &mesh = _extrudedMeshes[key];
+    mesh.vertices.reserve(_triangles.size() * 3);
+    mesh.numFrontVertices = 0;
+    mesh.numBackVertices = 0;
+    
+    for (VROGlyphTriangleType type : { VROGlyphTriangleType::Front, VROGlyphTriangleType::Back, VROGlyphTriangleType::Side }) {
+        for (const VROGlyphTriangle &triangle : _triangles) {
+            if (triangle.getType() != type) {
+                continue;
+            }
+            for (const VROVector3f &point : { triangle.getA(), triangle.getB(), triangle.getC() }) {
+                mesh.vertices.push_back({ point.x * scale, point.y * scale, point.z * scale * extrusion, 0, 0, 0, 0, 1 });
+            }
+            if (type == VROGlyphTriangleType::Front) {
+                mesh.numFrontVertices += 3;
+            } else if (type == VROGlyphTriangleType::Back) {
+                mesh.numBackVertices += 3;
+            }
+        }
+    }
+    return mesh;
+}
+
 #endif /* VROGlyph_h */
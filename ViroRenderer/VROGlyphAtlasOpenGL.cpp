@@ -31,12 +31,20 @@
 #include "VROMath.h"
 #include "VRODriverOpenGL.h"
 #include "VRODefines.h"
+#include "VROAllocationTracker.h"
+#include <algorithm>
 
 static const int kGlyphAtlasTextureSize = 512;
 static const int kGlyphPadding = 8;
 
+// Two bytes per texel, for the CPU bitmap and for the (mipmapped) GPU texture
+static const int64_t kGlyphAtlasBitmapBytes = 2 * kGlyphAtlasTextureSize * kGlyphAtlasTextureSize;
+static const int64_t kGlyphAtlasTextureBytes = kGlyphAtlasBitmapBytes + kGlyphAtlasBitmapBytes / 3;
+
 VROGlyphAtlasOpenGL::VROGlyphAtlasOpenGL(bool isOutline) :
-    _textureId(0) {
+    _textureId(0),
+    _dirtyMinV(0),
+    _dirtyMaxV(0) {
     _outline = isOutline;
     _luminanceAlphaBitmap = (GLubyte *)malloc( sizeof(GLubyte) * 2 *
                                                kGlyphAtlasTextureSize * kGlyphAtlasTextureSize );
@@ -47,10 +55,15 @@ VROGlyphAtlasOpenGL::VROGlyphAtlasOpenGL(bool isOutline) :
             _luminanceAlphaBitmap[2 * (i + j * kGlyphAtlasTextureSize) + 1] = 0;
         }
     }
+    ALLOCATION_TRACKER_ADD(GlyphAtlasMemory, kGlyphAtlasBitmapBytes);
 }
 
 VROGlyphAtlasOpenGL::~VROGlyphAtlasOpenGL() {
     free (_luminanceAlphaBitmap);
+    ALLOCATION_TRACKER_SUB(GlyphAtlasMemory, kGlyphAtlasBitmapBytes);
+    if (_textureId) {
+        ALLOCATION_TRACKER_SUB(GlyphAtlasMemory, kGlyphAtlasTextureBytes);
+    }
 }
 
 int VROGlyphAtlasOpenGL::getSize() const {
@@ -124,6 +137,14 @@ void VROGlyphAtlasOpenGL::write(FT_Bitmap &bitmap, const VROAtlasLocation &locat
      of the text is determined entirely by the material's diffuse color. The
      alpha value of the texture is taken from the glyph's value.
      */
+    std::lock_guard<std::mutex> lock(_bitmapMutex);
+    if (_dirtyMinV >= _dirtyMaxV) {
+        _dirtyMinV = minV;
+        _dirtyMaxV = minV + texHeight;
+    } else {
+        _dirtyMinV = std::min(_dirtyMinV, minV);
+        _dirtyMaxV = std::max(_dirtyMaxV, minV + texHeight);
+    }
     for (int j = 0; j < texHeight; j++) {
         for (int i = 0; i < texWidth; i++) {
             _luminanceAlphaBitmap[2 * (minU + i + (j + minV) * kGlyphAtlasTextureSize) + 0] = 255;
@@ -136,9 +157,14 @@ void VROGlyphAtlasOpenGL::refreshTexture(std::shared_ptr<VRODriver> driver) {
     bool isNew = false;
     if (!_textureId) {
         GL( glGenTextures(1, &_textureId) );
+        ALLOCATION_TRACKER_ADD(GlyphAtlasMemory, kGlyphAtlasTextureBytes);
         isNew = true;
     }
     
+    std::lock_guard<std::mutex> lock(_bitmapMutex);
+    if (!isNew && _dirtyMinV >= _dirtyMaxV) {
+        return;
+    }
     GL( glBindTexture(GL_TEXTURE_2D, _textureId) );
     
     if (isNew) {
@@ -149,10 +175,13 @@ void VROGlyphAtlasOpenGL::refreshTexture(std::shared_ptr<VRODriver> driver) {
         GL( glTexImage2D(GL_TEXTURE_2D, 0, GL_RG8, kGlyphAtlasTextureSize, kGlyphAtlasTextureSize, 0,
                          GL_RG, GL_UNSIGNED_BYTE, _luminanceAlphaBitmap) );
     } else {
-        GL( glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, kGlyphAtlasTextureSize, kGlyphAtlasTextureSize,
-                            GL_RG, GL_UNSIGNED_BYTE, _luminanceAlphaBitmap) );
+        // Upload only the rows written since the last refresh; rows are contiguous in
+        // the bitmap, so they can be uploaded as a single full-width region
+        GL( glTexSubImage2D(GL_TEXTURE_2D, 0, 0, _dirtyMinV, kGlyphAtlasTextureSize, _dirtyMaxV - _dirtyMinV,
+                            GL_RG, GL_UNSIGNED_BYTE, _luminanceAlphaBitmap + 2 * _dirtyMinV * kGlyphAtlasTextureSize) );
     }
     GL( glGenerateMipmap(GL_TEXTURE_2D) );
+    _dirtyMinV = _dirtyMaxV = 0;
     
     if (isNew) {
         std::unique_ptr<VROTextureSubstrate> substrate = std::unique_ptr<VROTextureSubstrateOpenGL>(new VROTextureSubstrateOpenGL(GL_TEXTURE_2D, _textureId, std::dynamic_pointer_cast<VRODriverOpenGL>(driver), true));
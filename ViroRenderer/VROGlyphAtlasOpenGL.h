@@ -29,6 +29,7 @@
 
 #include "VROGlyphAtlas.h"
 #include "VROOpenGL.h"
+#include <mutex>
 
 class VRODriver;
 class VRODriverOpenGL;
@@ -50,6 +51,14 @@ private:
     GLuint _textureId;
     GLubyte *_luminanceAlphaBitmap;
     
+    /*
+     The rows of the bitmap written since the texture was last refreshed
+     (_dirtyMinV >= _dirtyMaxV when clean). Glyphs may be written on a
+     background thread, so the bitmap and dirty rows are guarded by the mutex.
+     */
+    int _dirtyMinV, _dirtyMaxV;
+    std::mutex _bitmapMutex;
+    
     void loadTexture(FT_Face face, FT_GlyphSlot &glyph,
                      std::shared_ptr<VRODriverOpenGL> driver);
     
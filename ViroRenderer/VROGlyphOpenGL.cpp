@@ -44,6 +44,62 @@
 
 static const int kBezierSteps = 4;
 static const float kExtrusion = 1;
+static const float kDistanceInfinity = 1e20;
+
+/*
+ One-dimensional squared Euclidean distance transform (Felzenszwalb and
+ Huttenlocher), applied in place to the length samples of the grid starting
+ at offset and spaced stride apart. The f, z, and v arrays are scratch space
+ of at least length, length + 1, and length elements.
+ */
+static void distanceTransform1D(float *grid, int offset, int stride, int length,
+                                float *f, float *z, int *v) {
+    f[0] = grid[offset];
+    v[0] = 0;
+    z[0] = -kDistanceInfinity;
+    z[1] =  kDistanceInfinity;
+    
+    // Find the lower envelope of the parabolas rooted at each sample
+    for (int q = 1, k = 0; q < length; q++) {
+        f[q] = grid[offset + q * stride];
+        float s;
+        do {
+            int r = v[k];
+            s = (f[q] - f[r] + q * q - r * r) / (float) (q - r) / 2.0f;
+        } while (s <= z[k] && --k > -1);
+        
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = kDistanceInfinity;
+    }
+    
+    // Sample the envelope
+    for (int q = 0, k = 0; q < length; q++) {
+        while (z[k + 1] < q) {
+            k++;
+        }
+        int r = v[k];
+        grid[offset + q * stride] = (q - r) * (q - r) + f[r];
+    }
+}
+
+/*
+ Two-dimensional squared distance transform, applied in place: on output each
+ cell holds the squared distance to the nearest seed (cells that were 0).
+ */
+static void distanceTransform2D(std::vector<float> &grid, int width, int height) {
+    int length = std::max(width, height);
+    std::vector<float> f(length), z(length + 1);
+    std::vector<int> v(length);
+    
+    for (int x = 0; x < width; x++) {
+        distanceTransform1D(grid.data(), x, width, height, f.data(), z.data(), v.data());
+    }
+    for (int y = 0; y < height; y++) {
+        distanceTransform1D(grid.data(), y * width, 1, width, f.data(), z.data(), v.data());
+    }
+}
 
 VROGlyphOpenGL::VROGlyphOpenGL() {
     
@@ -190,6 +246,101 @@ bool VROGlyphOpenGL::loadOutlineBitmap(FT_Library library, FT_Face face, uint32_
     return true;
 }
 
+bool VROGlyphOpenGL::loadDistanceFieldBitmap(FT_Face face, uint32_t charCode, uint32_t variantSelector,
+                                             std::vector<std::shared_ptr<VROGlyphAtlas>> *glyphAtlases,
+                                             std::shared_ptr<VRODriver> driver) {
+    if (!loadGlyph(face, charCode, variantSelector)) {
+        return false;
+    }
+    FT_GlyphSlot &glyph = face->glyph;
+    
+    if (glyphAtlases->empty()) {
+        glyphAtlases->push_back(std::make_shared<VROGlyphAtlasOpenGL>(false));
+    }
+    std::shared_ptr<VROGlyphAtlas> atlas = glyphAtlases->back();
+    
+    FT_Render_Glyph(glyph, FT_RENDER_MODE_NORMAL);
+    FT_Bitmap &coverage = glyph->bitmap;
+    
+    /*
+     Seed the distance grids from the glyph's coverage, padded by the spread. The
+     outer grid measures distance to the glyph and the inner grid distance to the
+     background; partially covered pixels are seeded with their sub-pixel offset
+     from the edge (as in Mapbox's TinySDF).
+     */
+    int spread = kDistanceFieldSpread;
+    int coverageWidth  = (int) coverage.width;
+    int coverageHeight = (int) coverage.rows;
+    int width  = coverageWidth  + spread * 2;
+    int height = coverageHeight + spread * 2;
+    
+    std::vector<float> outer(width * height, kDistanceInfinity);
+    std::vector<float> inner(width * height, 0);
+    for (int j = 0; j < coverageHeight; j++) {
+        for (int i = 0; i < coverageWidth; i++) {
+            float a = coverage.buffer[i + coverage.pitch * j] / 255.0f;
+            if (a == 0) {
+                continue;
+            }
+            int index = (j + spread) * width + (i + spread);
+            if (a == 1) {
+                outer[index] = 0;
+                inner[index] = kDistanceInfinity;
+            } else {
+                float d = 0.5f - a;
+                outer[index] = d > 0 ? d * d : 0;
+                inner[index] = d < 0 ? d * d : 0;
+            }
+        }
+    }
+    distanceTransform2D(outer, width, height);
+    distanceTransform2D(inner, width, height);
+    
+    std::vector<unsigned char> field(width * height);
+    for (int i = 0; i < width * height; i++) {
+        float distance = sqrtf(outer[i]) - sqrtf(inner[i]);
+        float value = VROMathClamp(0.5f - distance / (2.0f * spread), 0, 1);
+        field[i] = (unsigned char) roundf(value * 255);
+    }
+    
+    FT_Bitmap bitmap;
+    memset(&bitmap, 0, sizeof(FT_Bitmap));
+    bitmap.width = width;
+    bitmap.rows = height;
+    bitmap.pitch = width;
+    bitmap.buffer = field.data();
+    bitmap.num_grays = 256;
+    bitmap.pixel_mode = FT_PIXEL_MODE_GRAY;
+    
+    VROAtlasLocation location;
+    if (atlas->glyphWillFit(bitmap, &location)) {
+        atlas->write(bitmap, location, driver);
+    } else {
+        // Did not fit in the atlas, create a new atlas
+        glyphAtlases->push_back(std::make_shared<VROGlyphAtlasOpenGL>(false));
+        atlas = glyphAtlases->back();
+        
+        if (atlas->glyphWillFit(bitmap, &location)) {
+            atlas->write(bitmap, location, driver);
+        } else {
+            pinfo("Failed to render distance field glyph for char code %d", charCode);
+            return false;
+        }
+    }
+    
+    VROGlyphBitmap vBitmap;
+    vBitmap.atlas = atlas;
+    vBitmap.bearing = VROVector3f(glyph->bitmap_left - spread, glyph->bitmap_top + spread);
+    vBitmap.size = VROVector3f(width, height);
+    vBitmap.minU = ((float) location.minU) / (float) atlas->getSize();
+    vBitmap.maxU = ((float) location.maxU) / (float) atlas->getSize();
+    vBitmap.minV = ((float) location.minV) / (float) atlas->getSize();
+    vBitmap.maxV = ((float) location.maxV) / (float) atlas->getSize();
+    
+    _bitmaps[0] = vBitmap;
+    return true;
+}
+
 bool VROGlyphOpenGL::loadVector(FT_Face face, uint32_t charCode, uint32_t variantSelector) {
     if (!loadGlyph(face, charCode, variantSelector)) {
         return false;
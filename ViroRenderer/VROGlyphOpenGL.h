@@ -53,6 +53,9 @@ public:
                            uint32_t outlineWidth,
                            std::vector<std::shared_ptr<VROGlyphAtlas>> *atlases,
                            std::shared_ptr<VRODriver> driver);
+    bool loadDistanceFieldBitmap(FT_Face face, uint32_t charCode, uint32_t variantSelector,
+                                 std::vector<std::shared_ptr<VROGlyphAtlas>> *atlases,
+                                 std::shared_ptr<VRODriver> driver);
     bool loadVector(FT_Face face, uint32_t charCode, uint32_t variantSelector);
         
 private:
@@ -28,6 +28,8 @@
 #include "VROLog.h"
 #include "VROTexture.h"
 #include "VROData.h"
+#include "VROJobSystem.h"
+#include "VROPlatformUtil.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #include "glm/gtc/packing.hpp"
@@ -37,15 +39,204 @@
 #include <stdint.h>
 #include <iostream>
 #include <array>
+#include <vector>
+#include <cmath>
+#include <string.h>
 
 // Set to true to compress HDR textures into RGB9_E5 format; false to
 // store HDR textures in memory in fully expanded RGB16F.
 static bool kCompressHDR = true;
 
+// Scanlines are decoded in batches of this many
+static const int kHDRDecodeBatchScanlines = 32;
+
+// Hash of the source pixels. Identifies the HDR to caches of the data derived
+// from it (e.g. VROIBLCache)
+static uint64_t hashHDRData(const void *data, int width, int height, int componentsPerPixel) {
+    const uint32_t header[3] = { (uint32_t) width, (uint32_t) height, (uint32_t) componentsPerPixel };
+    uint64_t h = VROPlatformHashCacheKey(header, sizeof(header));
+    return VROPlatformHashCacheKey(data, (size_t) width * height * componentsPerPixel * sizeof(uint32_t), h);
+}
+
+/*
+ Read the next line of a Radiance header, returning false at the end of the data.
+ */
+static bool readHDRHeaderLine(const uint8_t *data, size_t length, size_t *offset, std::string *outLine) {
+    if (*offset >= length) {
+        return false;
+    }
+    const uint8_t *begin = data + *offset;
+    const uint8_t *newline = (const uint8_t *) memchr(begin, '\n', length - *offset);
+    if (!newline) {
+        return false;
+    }
+    outLine->assign((const char *) begin, newline - begin);
+    *offset = newline - data + 1;
+    return true;
+}
+
+/*
+ Find the end of the run-length encoded scanline at the given offset, without
+ decoding it. Returns false if the scanline is not in the (new-style) adaptive
+ run-length encoding of the given width, or runs past the data.
+ */
+static bool skipHDRScanline(const uint8_t *data, size_t length, int width, size_t *offset) {
+    size_t p = *offset;
+    if (p + 4 > length || data[p] != 2 || data[p + 1] != 2 || (data[p + 2] & 0x80) ||
+        ((data[p + 2] << 8) | data[p + 3]) != width) {
+        return false;
+    }
+    p += 4;
+    
+    for (int component = 0; component < 4; component++) {
+        int count = 0;
+        while (count < width) {
+            if (p >= length) {
+                return false;
+            }
+            int code = data[p++];
+            if (code > 128) {
+                count += code - 128;
+                p += 1;
+            }
+            else if (code > 0) {
+                count += code;
+                p += code;
+            }
+            else {
+                return false;
+            }
+        }
+        if (count != width || p > length) {
+            return false;
+        }
+    }
+    *offset = p;
+    return true;
+}
+
+/*
+ Decode the run-length encoded scanline at the given offset (validated by
+ skipHDRScanline) into RGBE pixels.
+ */
+static void decodeHDRScanline(const uint8_t *data, size_t offset, int width, uint8_t *outRGBE) {
+    const uint8_t *p = data + offset + 4;
+    for (int component = 0; component < 4; component++) {
+        int count = 0;
+        while (count < width) {
+            int code = *p++;
+            if (code > 128) {
+                int run = code - 128;
+                uint8_t value = *p++;
+                for (int i = 0; i < run; i++) {
+                    outRGBE[(count + i) * 4 + component] = value;
+                }
+                count += run;
+            }
+            else {
+                for (int i = 0; i < code; i++) {
+                    outRGBE[(count + i) * 4 + component] = p[i];
+                }
+                p += code;
+                count += code;
+            }
+        }
+    }
+}
+
+uint32_t *VROHDRLoader::decodeRadianceHDR(std::string hdrPath, int *outWidth, int *outHeight) {
+    std::shared_ptr<VROData> file = VROData::mapFile(hdrPath);
+    if (!file) {
+        return nullptr;
+    }
+    const uint8_t *data = (const uint8_t *) file->getData();
+    size_t length = file->getDataLength();
+    
+    /*
+     Parse the header, which ends with an empty line, followed by the resolution.
+     Only the standard orientation, with scanlines running top to bottom, and the
+     RGBE format are supported.
+     */
+    size_t offset = 0;
+    std::string line;
+    if (!readHDRHeaderLine(data, length, &offset, &line) ||
+        (line.compare(0, 10, "#?RADIANCE") != 0 && line.compare(0, 6, "#?RGBE") != 0)) {
+        return nullptr;
+    }
+    while (true) {
+        if (!readHDRHeaderLine(data, length, &offset, &line)) {
+            return nullptr;
+        }
+        if (line.empty()) {
+            break;
+        }
+        if (line.compare(0, 7, "FORMAT=") == 0 && line != "FORMAT=32-bit_rle_rgbe") {
+            return nullptr;
+        }
+    }
+    
+    int width = 0, height = 0;
+    if (!readHDRHeaderLine(data, length, &offset, &line) ||
+        sscanf(line.c_str(), "-Y %d +X %d", &height, &width) != 2 || width <= 0 || height <= 0) {
+        return nullptr;
+    }
+    
+    /*
+     Scanlines are run-length encoded, so locate them all before decoding them in
+     parallel. Images whose scanlines are flat or use the old run-length encoding
+     are left to stb_image.
+     */
+    std::vector<size_t> scanlines(height);
+    for (int y = 0; y < height; y++) {
+        scanlines[y] = offset;
+        if (!skipHDRScanline(data, length, width, &offset)) {
+            return nullptr;
+        }
+    }
+    
+    size_t numPixels = (size_t) width * height;
+    uint32_t *packedF9E5 = (uint32_t *) malloc(numPixels * sizeof(uint32_t));
+    int numBatches = (height + kHDRDecodeBatchScanlines - 1) / kHDRDecodeBatchScanlines;
+    
+    VROJobSystem::getShared()->parallelFor(0, numBatches, 1, [data, width, height, &scanlines, packedF9E5](int batch) {
+        std::vector<uint8_t> rgbe((size_t) width * 4);
+        int last = std::min(height, (batch + 1) * kHDRDecodeBatchScanlines);
+        for (int y = batch * kHDRDecodeBatchScanlines; y < last; y++) {
+            decodeHDRScanline(data, scanlines[y], width, rgbe.data());
+            
+            uint32_t *row = packedF9E5 + (size_t) y * width;
+            for (int x = 0; x < width; x++) {
+                const uint8_t *pixel = &rgbe[x * 4];
+                if (pixel[3] == 0) {
+                    row[x] = 0;
+                    continue;
+                }
+                float scale = ldexpf(1.0f, pixel[3] - (128 + 8));
+                const glm::vec3 v(pixel[0] * scale, pixel[1] * scale, pixel[2] * scale);
+                row[x] = glm::packF3x9_E1x5(v);
+            }
+        }
+    });
+    
+    *outWidth = width;
+    *outHeight = height;
+    return packedF9E5;
+}
+
 std::shared_ptr<VROTexture> VROHDRLoader::loadRadianceHDRTexture(std::string hdrPath) {
     int width, height, n;
 
     pinfo("Loading Radiance HDR file [%s]...", hdrPath.c_str());
+    
+    // Decode straight to RGB9_E5 where possible, never expanding the image to floats
+    if (kCompressHDR) {
+        uint32_t *packedF9E5 = decodeRadianceHDR(hdrPath, &width, &height);
+        if (packedF9E5) {
+            pinfo("Load successful [width: %d, height %d]", width, height);
+            return loadRGB9E5Texture(packedF9E5, width, height);
+        }
+    }
+    
     float *data = stbi_loadf(hdrPath.c_str(), &width, &height, &n, 0);
     if (data == nullptr) {
         pinfo("Error loading Radiance HDR file");
@@ -76,28 +267,42 @@ std::shared_ptr<VROTexture> VROHDRLoader::loadTexture(float *data, int width, in
             packedF9E5[i] = glm::packF3x9_E1x5(v);
         }
         free (data);
-        
-        std::vector<uint32_t> mipSizes;
-        std::shared_ptr<VROData> texData = std::make_shared<VROData>(packedF9E5, packedLength, VRODataOwnership::Move);
-        std::vector<std::shared_ptr<VROData>> dataVec = { texData };
-        
-        return std::make_shared<VROTexture>(VROTextureType::Texture2D,
-                                            VROTextureFormat::RGB9_E5,
-                                            VROTextureInternalFormat::RGB9_E5, true,
-                                            VROMipmapMode::None,
-                                            dataVec, width, height, mipSizes);
+        return loadRGB9E5Texture(packedF9E5, width, height);
     }
     else {
+        uint64_t contentHash = hashHDRData(data, width, height, componentsPerPixel);
         int length = numPixels * componentsPerPixel * sizeof(float);
         
         std::vector<uint32_t> mipSizes;
         std::shared_ptr<VROData> texData = std::make_shared<VROData>(data, length, VRODataOwnership::Move);
         std::vector<std::shared_ptr<VROData>> dataVec = { texData };
         
-        return std::make_shared<VROTexture>(VROTextureType::Texture2D,
-                                            VROTextureFormat::RGB16F,
-                                            VROTextureInternalFormat::RGB16F, true,
-                                            VROMipmapMode::None,
-                                            dataVec, width, height, mipSizes);
+        std::shared_ptr<VROTexture> texture = std::make_shared<VROTexture>(VROTextureType::Texture2D,
+                                                                           VROTextureFormat::RGB16F,
+                                                                           VROTextureInternalFormat::RGB16F, true,
+                                                                           VROMipmapMode::None,
+                                                                           dataVec, width, height, mipSizes);
+        texture->setContentHash(contentHash);
+        return texture;
     }
 }
+
+std::shared_ptr<VROTexture> VROHDRLoader::loadRGB9E5Texture(uint32_t *packedF9E5, int width, int height) {
+    // The packed pixels identify the HDR as well as the source floats, and the same packed
+    // pixels result whether the HDR was decoded natively or by stb_image
+    uint64_t contentHash = hashHDRData(packedF9E5, width, height, 1);
+    
+    // The texture frees its data once uploaded to the GPU
+    std::vector<uint32_t> mipSizes;
+    int packedLength = width * height * sizeof(uint32_t);
+    std::shared_ptr<VROData> texData = std::make_shared<VROData>(packedF9E5, packedLength, VRODataOwnership::Move);
+    std::vector<std::shared_ptr<VROData>> dataVec = { texData };
+    
+    std::shared_ptr<VROTexture> texture = std::make_shared<VROTexture>(VROTextureType::Texture2D,
+                                                                       VROTextureFormat::RGB9_E5,
+                                                                       VROTextureInternalFormat::RGB9_E5, true,
+                                                                       VROMipmapMode::None,
+                                                                       dataVec, width, height, mipSizes);
+    texture->setContentHash(contentHash);
+    return texture;
+}
@@ -30,12 +30,16 @@
 #include <stdio.h>
 #include <string>
 #include <memory>
+#include <stdint.h>
 
 class VROTexture;
 enum class VROTextureInternalFormat;
 
 /*
  Converts HDR images to RGB9_E5 format so that they can be read by OpenGL ES.
+ Radiance files are decoded natively, directly into RGB9_E5, with scanlines
+ decoded in parallel on a small pool of worker threads dedicated to HDR
+ decoding; files the native decoder does not support fall back to stb_image.
  */
 class VROHDRLoader {
 public:
@@ -50,6 +54,14 @@ private:
     
     static std::shared_ptr<VROTexture> loadTexture(float *data, int width, int height,
                                                    int componentsPerPixel);
+    static std::shared_ptr<VROTexture> loadRGB9E5Texture(uint32_t *packedF9E5, int width, int height);
+    
+    /*
+     Decode the run-length encoded Radiance HDR file at the given path into RGB9_E5
+     pixels, to be freed by the caller. Returns nullptr if the file can't be read, or
+     is in an orientation or encoding the native decoder does not support.
+     */
+    static uint32_t *decodeRadianceHDR(std::string hdrPath, int *outWidth, int *outHeight);
     
 };
 
@@ -0,0 +1,226 @@
+//
+//  VROIBLCache.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROIBLCache.h"
+#include "VROTexture.h"
+#include "VRORenderTarget.h"
+#include "VROData.h"
+#include "VROPlatformUtil.h"
+#include "VROLog.h"
+#include <algorithm>
+#include <string.h>
+
+static const uint32_t kIBLCacheMagic = 0x56524f49; // 'VROI'
+static const uint32_t kIBLCacheVersion = 1;
+
+// Maps larger than this are assumed to be corrupt
+static const uint32_t kMaxIBLMapSize = 4096;
+static const uint32_t kMaxIBLMapMipLevels = 13;
+
+struct VROIBLMapHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t numFaces;
+    uint32_t mipLevels;
+    uint32_t width;
+    uint32_t height;
+    uint32_t channels;
+    uint32_t padding;
+};
+
+VROIBLCache::VROIBLCache(std::string directory) :
+    _directory(directory) {
+
+}
+
+VROIBLCache::~VROIBLCache() {
+
+}
+
+std::string VROIBLCache::getEnvironmentPath(uint64_t key) const {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.ibl", (unsigned long long) key);
+    return _directory + "/" + name;
+}
+
+std::string VROIBLCache::getBRDFPath() const {
+    return _directory + "/brdf.ibl";
+}
+
+#pragma mark - Loading
+
+bool VROIBLCache::loadEnvironmentMaps(uint64_t key, std::shared_ptr<VROTexture> *outIrradianceMap,
+                                      std::shared_ptr<VROTexture> *outPrefilteredMap) {
+    if (_directory.empty() || key == 0) {
+        return false;
+    }
+
+    std::string path = getEnvironmentPath(key);
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+
+    std::shared_ptr<VROTexture> irradianceMap = loadMap(file);
+    std::shared_ptr<VROTexture> prefilteredMap = irradianceMap ? loadMap(file) : nullptr;
+    fclose(file);
+
+    if (!irradianceMap || !prefilteredMap) {
+        pinfo("Discarding corrupt IBL cache file %s", path.c_str());
+        remove(path.c_str());
+        return false;
+    }
+
+    *outIrradianceMap = irradianceMap;
+    *outPrefilteredMap = prefilteredMap;
+    return true;
+}
+
+std::shared_ptr<VROTexture> VROIBLCache::loadBRDFMap() {
+    if (_directory.empty()) {
+        return nullptr;
+    }
+
+    std::string path = getBRDFPath();
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return nullptr;
+    }
+
+    std::shared_ptr<VROTexture> brdfMap = loadMap(file);
+    fclose(file);
+
+    if (!brdfMap) {
+        pinfo("Discarding corrupt IBL cache file %s", path.c_str());
+        remove(path.c_str());
+    }
+    return brdfMap;
+}
+
+std::shared_ptr<VROTexture> VROIBLCache::loadMap(FILE *file) const {
+    VROIBLMapHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        header.magic != kIBLCacheMagic ||
+        header.version != kIBLCacheVersion ||
+        (header.numFaces != 1 && header.numFaces != 6) ||
+        (header.channels != 2 && header.channels != 4) ||
+        header.width == 0 || header.width > kMaxIBLMapSize ||
+        header.height == 0 || header.height > kMaxIBLMapSize ||
+        header.mipLevels == 0 || header.mipLevels > kMaxIBLMapMipLevels) {
+        return nullptr;
+    }
+
+    // Each face holds its miplevels consecutively, largest first
+    std::vector<uint32_t> mipSizes;
+    uint32_t faceLength = 0;
+    for (uint32_t mip = 0; mip < header.mipLevels; mip++) {
+        uint32_t width  = std::max(1u, header.width  >> mip);
+        uint32_t height = std::max(1u, header.height >> mip);
+        mipSizes.push_back(width * height * header.channels * sizeof(float));
+        faceLength += mipSizes.back();
+    }
+
+    std::vector<std::shared_ptr<VROData>> faces;
+    for (uint32_t f = 0; f < header.numFaces; f++) {
+        void *bytes = malloc(faceLength);
+        if (fread(bytes, 1, faceLength, file) != faceLength) {
+            free(bytes);
+            return nullptr;
+        }
+        faces.push_back(std::make_shared<VROData>(bytes, faceLength, VRODataOwnership::Move));
+    }
+
+    bool mipmapped = header.mipLevels > 1;
+    if (!mipmapped) {
+        mipSizes.clear();
+    }
+    return std::make_shared<VROTexture>(header.numFaces == 6 ? VROTextureType::TextureCube : VROTextureType::Texture2D,
+                                        header.channels == 4 ? VROTextureFormat::RGBA16F : VROTextureFormat::RG16F,
+                                        header.channels == 4 ? VROTextureInternalFormat::RGBA16F : VROTextureInternalFormat::RG16F,
+                                        false, mipmapped ? VROMipmapMode::Pregenerated : VROMipmapMode::None,
+                                        faces, header.width, header.height, mipSizes);
+}
+
+#pragma mark - Storing
+
+void VROIBLCache::storeEnvironmentMaps(uint64_t key, std::shared_ptr<VRORenderTarget> irradianceTarget,
+                                       std::shared_ptr<VRORenderTarget> prefilteredTarget, int prefilteredMipLevels) {
+    if (_directory.empty() || key == 0) {
+        return;
+    }
+
+    std::shared_ptr<std::vector<uint8_t>> buffer = std::make_shared<std::vector<uint8_t>>();
+    readMap(irradianceTarget, true, 1, 4, buffer.get());
+    readMap(prefilteredTarget, true, prefilteredMipLevels, 4, buffer.get());
+    writeFile(getEnvironmentPath(key), buffer);
+}
+
+void VROIBLCache::storeBRDFMap(std::shared_ptr<VRORenderTarget> brdfTarget) {
+    if (_directory.empty()) {
+        return;
+    }
+
+    std::shared_ptr<std::vector<uint8_t>> buffer = std::make_shared<std::vector<uint8_t>>();
+    readMap(brdfTarget, false, 1, 2, buffer.get());
+    writeFile(getBRDFPath(), buffer);
+}
+
+void VROIBLCache::readMap(std::shared_ptr<VRORenderTarget> target, bool cube, int mipLevels, int channels,
+                          std::vector<uint8_t> *outBuffer) const {
+    VROIBLMapHeader header;
+    header.magic = kIBLCacheMagic;
+    header.version = kIBLCacheVersion;
+    header.numFaces = cube ? 6 : 1;
+    header.mipLevels = mipLevels;
+    header.width = target->getWidth();
+    header.height = target->getHeight();
+    header.channels = channels;
+    header.padding = 0;
+
+    const uint8_t *headerBytes = (const uint8_t *) &header;
+    outBuffer->insert(outBuffer->end(), headerBytes, headerBytes + sizeof(header));
+
+    for (uint32_t f = 0; f < header.numFaces; f++) {
+        for (int mip = 0; mip < mipLevels; mip++) {
+            // Pixels are read back as RGBA; keep only the channels we store
+            std::shared_ptr<VROData> pixels = target->readPixels(0, f, mip);
+            const float *rgba = (const float *) pixels->getData();
+            int numPixels = pixels->getDataLength() / (4 * sizeof(float));
+
+            size_t offset = outBuffer->size();
+            outBuffer->resize(offset + numPixels * channels * sizeof(float));
+            float *out = (float *) (outBuffer->data() + offset);
+            for (int i = 0; i < numPixels; i++) {
+                memcpy(out + i * channels, rgba + i * 4, channels * sizeof(float));
+            }
+        }
+    }
+}
+
+void VROIBLCache::writeFile(std::string path, std::shared_ptr<std::vector<uint8_t>> buffer) {
+    VROPlatformDispatchAsyncWorker([path, buffer] {
+        VROPlatformWriteCacheFile(path, buffer->data(), buffer->size());
+    }, VROTaskPriority::Low);
+}
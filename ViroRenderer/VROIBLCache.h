@@ -0,0 +1,109 @@
+//
+//  VROIBLCache.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROIBLCache_h
+#define VROIBLCache_h
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <stdio.h>
+#include <stdint.h>
+
+class VROTexture;
+class VRORenderTarget;
+
+/*
+ Persists the results of image-based lighting preprocessing (see VROIBLPreprocess)
+ to disk, so that subsequent runs can skip the GPU convolutions. The irradiance
+ and prefiltered cubemaps of each lighting environment are stored in one file,
+ keyed by the content hash of the environment's source HDR (see
+ VROTexture::getContentHash). The BRDF lookup table does not depend on the
+ environment, so one copy is stored and shared by all environments.
+
+ Maps are stored as uncompressed floats. Files are written on a background
+ thread, and written in full or not at all.
+
+ All methods must be invoked on the rendering thread.
+ */
+class VROIBLCache {
+public:
+
+    VROIBLCache(std::string directory);
+    virtual ~VROIBLCache();
+
+    /*
+     Load the irradiance and prefiltered maps of the environment with the given
+     content hash. Returns false if the maps are not cached.
+     */
+    bool loadEnvironmentMaps(uint64_t key, std::shared_ptr<VROTexture> *outIrradianceMap,
+                             std::shared_ptr<VROTexture> *outPrefilteredMap);
+
+    /*
+     Read back the irradiance and prefiltered maps rendered to the given cube
+     targets, and store them under the given content hash.
+     */
+    void storeEnvironmentMaps(uint64_t key, std::shared_ptr<VRORenderTarget> irradianceTarget,
+                              std::shared_ptr<VRORenderTarget> prefilteredTarget, int prefilteredMipLevels);
+
+    /*
+     Load or store the BRDF lookup table. Load returns nullptr if the table is
+     not cached.
+     */
+    std::shared_ptr<VROTexture> loadBRDFMap();
+    void storeBRDFMap(std::shared_ptr<VRORenderTarget> brdfTarget);
+
+private:
+
+    /*
+     The directory in which maps are stored. Created on first store.
+     */
+    std::string _directory;
+
+    std::string getEnvironmentPath(uint64_t key) const;
+    std::string getBRDFPath() const;
+
+    /*
+     Read a cached map into a new texture. Returns nullptr on a miss or if the
+     file is corrupt.
+     */
+    std::shared_ptr<VROTexture> loadMap(FILE *file) const;
+
+    /*
+     Read back the given target (all faces and the given number of miplevels),
+     keeping the given number of channels of each pixel, and append the result
+     to the given buffer, preceded by its header.
+     */
+    void readMap(std::shared_ptr<VRORenderTarget> target, bool cube, int mipLevels, int channels,
+                 std::vector<uint8_t> *outBuffer) const;
+
+    /*
+     Write the given buffer to the given path on a background thread.
+     */
+    void writeFile(std::string path, std::shared_ptr<std::vector<uint8_t>> buffer);
+
+};
+
+#endif /* VROIBLCache_h */
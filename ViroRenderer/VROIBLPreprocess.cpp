@@ -33,13 +33,28 @@
 #include "VROIrradianceRenderPass.h"
 #include "VROPrefilterRenderPass.h"
 #include "VROBRDFRenderPass.h"
+#include "VROIBLCache.h"
+#include "VRODriver.h"
+#include "VROTexture.h"
+#include "VROFrameScheduler.h"
+#include "VROSphericalHarmonics.h"
+#include "VROData.h"
 
 // Set to true to display the generated irradiance map as the background, and to
 // deactivate specular IBL
 static bool kDebugIrradiance = false;
 
-VROIBLPreprocess::VROIBLPreprocess() {
+// Number of texels sampled along each edge of a cube face when projecting onto
+// spherical harmonics; irradiance is low frequency, so the faces are subsampled
+static const int kSphericalHarmonicsSamplesPerEdge = 64;
+
+VROIBLPreprocess::VROIBLPreprocess(bool sphericalHarmonicsIrradiance) {
     _phase = VROIBLPhase::Idle;
+    _slice = 0;
+    _mapsReady = false;
+    _sphericalHarmonicsIrradiance = sphericalHarmonicsIrradiance;
+    _persistEnvironmentMaps = false;
+    _persistBRDFMap = false;
     _equirectangularToCubePass = std::make_shared<VROEquirectangularToCubeRenderPass>();
     _irradiancePass = std::make_shared<VROIrradianceRenderPass>();
     _prefilterPass = std::make_shared<VROPrefilterRenderPass>();
@@ -52,94 +67,259 @@ VROIBLPreprocess::~VROIBLPreprocess() {
 
 void VROIBLPreprocess::execute(std::shared_ptr<VROScene> scene, VRORenderContext *context,
                                std::shared_ptr<VRODriver> driver) {
- 
-    if (_phase == VROIBLPhase::Idle) {
-        std::shared_ptr<VROPortal> portal = scene->getActivePortal();
-
-        // If idling, check if the lighting environment has changed
-        if (portal->getLightingEnvironment() != nullptr && portal->getLightingEnvironment() != _currentLightingEnvironment) {
-            pinfo("Lighting environment changed");
-
-            _currentLightingEnvironment = portal->getLightingEnvironment();
-            _phase = VROIBLPhase::CubeConvert;
-        }
+    std::shared_ptr<VROPortal> portal = scene->getActivePortal();
+    
+    // Check if the lighting environment has changed. If the maps for a previous
+    // environment are still being rendered, they are abandoned
+    if (portal->getLightingEnvironment() != nullptr && portal->getLightingEnvironment() != _currentLightingEnvironment) {
+        pinfo("Lighting environment changed");
         
-        // If an environment map has been removed
-        if (portal->getLightingEnvironment() == nullptr && _currentLightingEnvironment != nullptr) {
-            pinfo("Lighting environment removed");
-            context->setIrradianceMap(nullptr);
-            context->setBRDFMap(nullptr);
-            context->setPrefilteredMap(nullptr);
-            
-            _currentLightingEnvironment = nullptr;
+        _currentLightingEnvironment = portal->getLightingEnvironment();
+        _mapsReady = false;
+        
+        VROIBLPhase phase = loadCachedMaps(context, driver);
+        if (phase != VROIBLPhase::Idle) {
+            beginConvolution(phase, driver);
+        }
+        else {
+            _phase = VROIBLPhase::Idle;
         }
     }
     
-    else if (_phase == VROIBLPhase::CubeConvert) {
-        doCubeConversionPhase(scene, context, driver);
-        _phase = VROIBLPhase::IrradianceConvolution;
+    // If an environment map has been removed
+    if (portal->getLightingEnvironment() == nullptr && _currentLightingEnvironment != nullptr) {
+        pinfo("Lighting environment removed");
+        context->setIrradianceMap(nullptr);
+        context->setIrradianceSphericalHarmonics(nullptr);
+        context->setBRDFMap(nullptr);
+        context->setPrefilteredMap(nullptr);
+        
+        _currentLightingEnvironment = nullptr;
+        _phase = VROIBLPhase::Idle;
+        _mapsReady = false;
+    }
+    
+    // Without a lighting environment, fall back to the portal's ambient harmonics
+    if (_sphericalHarmonicsIrradiance && _currentLightingEnvironment == nullptr) {
+        context->setIrradianceSphericalHarmonics(portal->getAmbientSphericalHarmonics());
     }
     
-    else if (_phase == VROIBLPhase::IrradianceConvolution) {
-        doIrradianceConvolutionPhase(scene, context, driver);
+    // Swap in the new maps once they're all complete
+    if (_mapsReady && _sphericalHarmonicsIrradiance) {
+        context->setIrradianceSphericalHarmonics(_sphericalHarmonics);
+        context->setPrefilteredMap(_prefilterMap);
+        context->setBRDFMap(_brdfMap);
+        _mapsReady = false;
+    }
+    else if (_mapsReady) {
         context->setIrradianceMap(_irradianceMap);
-        _phase = VROIBLPhase::PrefilterConvolution;
-        
         if (kDebugIrradiance) {
-            std::shared_ptr<VROPortal> portal = scene->getActivePortal();
             portal->setBackgroundCube(_irradianceMap);
-            _phase = VROIBLPhase::Idle;
         }
+        else {
+            context->setPrefilteredMap(_prefilterMap);
+            context->setBRDFMap(_brdfMap);
+        }
+        _mapsReady = false;
     }
+}
 
-    else if (_phase == VROIBLPhase::PrefilterConvolution) {
-        doPrefilterConvolutionPhase(scene, context, driver);
-        context->setPrefilteredMap(_prefilterMap);
-        _phase = VROIBLPhase::BRDFConvolution;
+VROIBLPhase VROIBLPreprocess::loadCachedMaps(VRORenderContext *context, std::shared_ptr<VRODriver> driver) {
+    std::shared_ptr<VROIBLCache> cache = driver->getIBLCache();
+    uint64_t key = _currentLightingEnvironment->getContentHash();
+    _persistEnvironmentMaps = cache != nullptr && key != 0 && !kDebugIrradiance;
+    if (!_persistEnvironmentMaps) {
+        return VROIBLPhase::CubeConvert;
     }
-
-    else if (_phase == VROIBLPhase::BRDFConvolution) {
-        doBRDFComputationPhase(scene, context, driver);
-        context->setBRDFMap(_brdfMap);
-        _phase = VROIBLPhase::Idle;
+    
+    if (!_brdfMap) {
+        _brdfMap = cache->loadBRDFMap();
+        if (_brdfMap) {
+            _brdfMap->prewarm(driver);
+        }
     }
-}
-
-void VROIBLPreprocess::doCubeConversionPhase(std::shared_ptr<VROScene> scene, VRORenderContext *context,
-                                             std::shared_ptr<VRODriver> driver) {
-    pinfo("   Converting equirectangular texture to cubemap");
     
-    VRORenderPassInputOutput inputs;
-    inputs.textures[kEquirectangularToCubeHDRTextureInput] = _currentLightingEnvironment;
-    _equirectangularToCubePass->render(scene, nullptr, inputs, context, driver);
-    _cubeLightingEnvironment = inputs.outputTarget->getTexture(0);
+    // The cache holds irradiance maps rather than spherical harmonics, so in that
+    // mode the environment is always projected from its cubemap
+    if (_sphericalHarmonicsIrradiance) {
+        _persistEnvironmentMaps = false;
+        return VROIBLPhase::CubeConvert;
+    }
+    
+    std::shared_ptr<VROTexture> irradianceMap, prefilterMap;
+    if (!cache->loadEnvironmentMaps(key, &irradianceMap, &prefilterMap)) {
+        return VROIBLPhase::CubeConvert;
+    }
+    pinfo("   Loaded cached irradiance and prefiltered maps");
+    
+    irradianceMap->prewarm(driver);
+    prefilterMap->prewarm(driver);
+    _irradianceMap = irradianceMap;
+    _prefilterMap = prefilterMap;
+    _persistEnvironmentMaps = false;
+    
+    if (!_brdfMap) {
+        return VROIBLPhase::BRDFConvolution;
+    }
+    context->setIrradianceMap(_irradianceMap);
+    context->setPrefilteredMap(_prefilterMap);
+    context->setBRDFMap(_brdfMap);
+    return VROIBLPhase::Idle;
 }
 
-void VROIBLPreprocess::doIrradianceConvolutionPhase(std::shared_ptr<VROScene> scene, VRORenderContext *context,
-                                                    std::shared_ptr<VRODriver> driver) {
-    pinfo("   Convoluting texture to create irradiance map");
+void VROIBLPreprocess::beginConvolution(VROIBLPhase phase, std::shared_ptr<VRODriver> driver) {
+    // Render to new textures, so that the maps of the previous environment stay
+    // intact while they remain in use
+    if (phase == VROIBLPhase::CubeConvert) {
+        _irradiancePass->beginNewOutput();
+        _prefilterPass->beginNewOutput();
+    }
+    _phase = phase;
+    _slice = 0;
     
-    VRORenderPassInputOutput inputs;
-    inputs.textures[kIrradianceLightingEnvironmentInput] = _cubeLightingEnvironment;
-    _irradiancePass->render(scene, nullptr, inputs, context, driver);
-    _irradianceMap = inputs.outputTarget->getTexture(0);
+    std::shared_ptr<VROFrameScheduler> scheduler = driver->getFrameScheduler();
+    if (scheduler->isTaskQueued(kIBLConvolutionTaskKey)) {
+        return;
+    }
+    
+    std::weak_ptr<VROIBLPreprocess> preprocess_w = shared_from_this();
+    std::weak_ptr<VRODriver> driver_w = driver;
+    scheduler->scheduleResumableTask(kIBLConvolutionTaskKey, [preprocess_w, driver_w]() -> bool {
+        std::shared_ptr<VROIBLPreprocess> preprocess = preprocess_w.lock();
+        std::shared_ptr<VRODriver> driver = driver_w.lock();
+        if (!preprocess || !driver) {
+            return true;
+        }
+        return preprocess->renderSlice(driver);
+    }, VROFrameTaskPriority::Low);
 }
 
-void VROIBLPreprocess::doPrefilterConvolutionPhase(std::shared_ptr<VROScene> scene, VRORenderContext *context,
-                                                   std::shared_ptr<VRODriver> driver) {
-    pinfo("   Convoluting texture to create prefiltered map");
-
+bool VROIBLPreprocess::renderSlice(std::shared_ptr<VRODriver> driver) {
     VRORenderPassInputOutput inputs;
-    inputs.textures[kPrefilterLightingEnvironmentInput] = _cubeLightingEnvironment;
-    _prefilterPass->render(scene, nullptr, inputs, context, driver);
-    _prefilterMap = inputs.outputTarget->getTexture(0);
+    
+    if (_phase == VROIBLPhase::CubeConvert) {
+        if (_slice == 0) {
+            pinfo("   Converting equirectangular texture to cubemap");
+        }
+        inputs.textures[kEquirectangularToCubeHDRTextureInput] = _currentLightingEnvironment;
+        _equirectangularToCubePass->renderSlice(_slice++, inputs, driver);
+        
+        if (_slice == _equirectangularToCubePass->getNumSlices()) {
+            _cubeTarget = inputs.outputTarget;
+            _cubeLightingEnvironment = inputs.outputTarget->getTexture(0);
+            finishPhase(_sphericalHarmonicsIrradiance ? VROIBLPhase::SphericalHarmonicsProjection :
+                                                        VROIBLPhase::IrradianceConvolution);
+        }
+    }
+    
+    else if (_phase == VROIBLPhase::SphericalHarmonicsProjection) {
+        if (_slice == 0) {
+            pinfo("   Projecting cubemap onto spherical harmonics");
+            _sphericalHarmonics = std::make_shared<VROSphericalHarmonics>();
+        }
+        
+        // Each slice reads back and projects one face of the cubemap
+        int size = _cubeTarget->getWidth();
+        std::shared_ptr<VROData> pixels = _cubeTarget->readPixels(0, _slice, 0);
+        _sphericalHarmonics->accumulateCubeFace(_slice, (const float *) pixels->getData(), size,
+                                                std::max(1, size / kSphericalHarmonicsSamplesPerEdge));
+        _slice++;
+        
+        if (_slice == 6) {
+            _sphericalHarmonics->finishProjection();
+            _irradianceMap = nullptr;
+            _irradianceTarget = nullptr;
+            finishPhase(VROIBLPhase::PrefilterConvolution);
+        }
+    }
+    
+    else if (_phase == VROIBLPhase::IrradianceConvolution) {
+        if (_slice == 0) {
+            pinfo("   Convoluting texture to create irradiance map");
+        }
+        inputs.textures[kIrradianceLightingEnvironmentInput] = _cubeLightingEnvironment;
+        _irradiancePass->renderSlice(_slice++, inputs, driver);
+        
+        if (_slice == _irradiancePass->getNumSlices()) {
+            _irradianceTarget = inputs.outputTarget;
+            _irradianceMap = inputs.outputTarget->getTexture(0);
+            
+            if (kDebugIrradiance) {
+                finishPhase(VROIBLPhase::Idle);
+                _mapsReady = true;
+            }
+            else {
+                finishPhase(VROIBLPhase::PrefilterConvolution);
+            }
+        }
+    }
+    
+    else if (_phase == VROIBLPhase::PrefilterConvolution) {
+        if (_slice == 0) {
+            pinfo("   Convoluting texture to create prefiltered map");
+        }
+        inputs.textures[kPrefilterLightingEnvironmentInput] = _cubeLightingEnvironment;
+        _prefilterPass->renderSlice(_slice++, inputs, driver);
+        
+        if (_slice == _prefilterPass->getNumSlices()) {
+            _prefilterTarget = inputs.outputTarget;
+            _prefilterMap = inputs.outputTarget->getTexture(0);
+            finishPhase(VROIBLPhase::BRDFConvolution);
+        }
+    }
+    
+    else if (_phase == VROIBLPhase::BRDFConvolution) {
+        // The BRDF map doesn't depend on the environment, so it's only computed once
+        if (_brdfMap) {
+            finishPhase(VROIBLPhase::Persist);
+            _mapsReady = true;
+            return false;
+        }
+        
+        if (_slice == 0) {
+            pinfo("   Convoluting texture to create BRDF map");
+        }
+        _brdfPass->renderSlice(_slice++, inputs, driver);
+        
+        if (_slice == _brdfPass->getNumSlices()) {
+            _brdfTarget = inputs.outputTarget;
+            _brdfMap = inputs.outputTarget->getTexture(0);
+            _persistBRDFMap = driver->getIBLCache() != nullptr;
+            
+            finishPhase(VROIBLPhase::Persist);
+            _mapsReady = true;
+        }
+    }
+    
+    else if (_phase == VROIBLPhase::Persist) {
+        doPersistPhase(driver);
+        finishPhase(VROIBLPhase::Idle);
+    }
+    
+    driver->unbindShader();
+    return _phase == VROIBLPhase::Idle;
 }
 
-void VROIBLPreprocess::doBRDFComputationPhase(std::shared_ptr<VROScene> scene, VRORenderContext *context,
-                                              std::shared_ptr<VRODriver> driver) {
-    pinfo("   Convoluting texture to create BRDF map");
+void VROIBLPreprocess::finishPhase(VROIBLPhase next) {
+    _phase = next;
+    _slice = 0;
+}
 
-    VRORenderPassInputOutput inputs;
-    _brdfPass->render(scene, nullptr, inputs, context, driver);
-    _brdfMap = inputs.outputTarget->getTexture(0);
+void VROIBLPreprocess::doPersistPhase(std::shared_ptr<VRODriver> driver) {
+    std::shared_ptr<VROIBLCache> cache = driver->getIBLCache();
+    if (!cache) {
+        return;
+    }
+    
+    if (_persistEnvironmentMaps) {
+        pinfo("   Storing irradiance and prefiltered maps");
+        cache->storeEnvironmentMaps(_currentLightingEnvironment->getContentHash(), _irradianceTarget,
+                                    _prefilterTarget, kPrefilterMipLevels);
+        _persistEnvironmentMaps = false;
+    }
+    if (_persistBRDFMap) {
+        pinfo("   Storing BRDF map");
+        cache->storeBRDFMap(_brdfTarget);
+        _persistBRDFMap = false;
+    }
 }
@@ -28,24 +28,50 @@
 #define VROIBLPreprocess_h
 
 #include "VROPreprocess.h"
+#include <string>
 
 class VROTexture;
+class VRORenderTarget;
 class VROEquirectangularToCubeRenderPass;
 class VROIrradianceRenderPass;
 class VROPrefilterRenderPass;
 class VROBRDFRenderPass;
+class VROSphericalHarmonics;
 
 enum class VROIBLPhase {
     Idle,
     CubeConvert,
+    SphericalHarmonicsProjection,
     IrradianceConvolution,
     PrefilterConvolution,
-    BRDFConvolution
+    BRDFConvolution,
+    Persist
 };
 
-class VROIBLPreprocess : public VROPreprocess {
+/*
+ Key of the resumable frame task that renders the IBL maps.
+ */
+const std::string kIBLConvolutionTaskKey = "ibl_convolution";
+
+/*
+ Generates the irradiance, prefiltered, and BRDF maps used for image-based
+ lighting whenever the active portal's lighting environment changes.
+
+ On a cache miss the maps are rendered progressively by a resumable task on
+ the VROFrameScheduler, one slice (a cube face, a face of one miplevel, or a
+ band of the BRDF map) at a time, so that frame time is only spent when it is
+ available. The slices render to new textures, and the maps of the previous
+ environment remain in use until all of the new maps are complete.
+
+ With spherical harmonics irradiance, the irradiance convolution is replaced by
+ a projection of the environment cubemap onto spherical harmonics, read back
+ one face per slice, and diffuse lighting is evaluated from those coefficients.
+ When the active portal has no lighting environment, its ambient spherical
+ harmonics (e.g. from AR light estimation) are used instead.
+ */
+class VROIBLPreprocess : public VROPreprocess, public std::enable_shared_from_this<VROIBLPreprocess> {
 public:
-    VROIBLPreprocess();
+    VROIBLPreprocess(bool sphericalHarmonicsIrradiance = false);
     virtual ~VROIBLPreprocess();
     
     virtual void execute(std::shared_ptr<VROScene> scene, VRORenderContext *context,
@@ -53,7 +79,27 @@ public:
     
 private:
     
+    /*
+     The phase being rendered for the current lighting environment, and the next
+     slice of that phase to render.
+     */
     VROIBLPhase _phase;
+    int _slice;
+    
+    /*
+     True once the maps of the current lighting environment are complete and
+     have yet to be set on the render context.
+     */
+    bool _mapsReady;
+    
+    /*
+     True to compute diffuse irradiance as spherical harmonics rather than as an
+     irradiance map. The harmonics of the current environment are accumulated in
+     _sphericalHarmonics.
+     */
+    bool _sphericalHarmonicsIrradiance;
+    std::shared_ptr<VROSphericalHarmonics> _sphericalHarmonics;
+    
     std::shared_ptr<VROEquirectangularToCubeRenderPass> _equirectangularToCubePass;
     std::shared_ptr<VROIrradianceRenderPass> _irradiancePass;
     std::shared_ptr<VROPrefilterRenderPass> _prefilterPass;
@@ -61,18 +107,47 @@ private:
 
     std::shared_ptr<VROTexture> _currentLightingEnvironment;
     std::shared_ptr<VROTexture> _cubeLightingEnvironment;
+    std::shared_ptr<VRORenderTarget> _cubeTarget;
     std::shared_ptr<VROTexture> _irradianceMap;
     std::shared_ptr<VROTexture> _prefilterMap;
     std::shared_ptr<VROTexture> _brdfMap;
-
-    void doCubeConversionPhase(std::shared_ptr<VROScene> scene, VRORenderContext *context,
-                               std::shared_ptr<VRODriver> driver);
-    void doIrradianceConvolutionPhase(std::shared_ptr<VROScene> scene, VRORenderContext *context,
-                                      std::shared_ptr<VRODriver> driver);
-    void doPrefilterConvolutionPhase(std::shared_ptr<VROScene> scene, VRORenderContext *context,
-                                     std::shared_ptr<VRODriver> driver);
-    void doBRDFComputationPhase(std::shared_ptr<VROScene> scene, VRORenderContext *context,
-                                     std::shared_ptr<VRODriver> driver);
+    
+    /*
+     The targets the irradiance, prefilter, and BRDF maps were rendered to, and
+     whether their maps are yet to be stored in the driver's VROIBLCache. Maps are
+     read back and stored in the Persist phase, after they're rendered.
+     */
+    std::shared_ptr<VRORenderTarget> _irradianceTarget;
+    std::shared_ptr<VRORenderTarget> _prefilterTarget;
+    std::shared_ptr<VRORenderTarget> _brdfTarget;
+    bool _persistEnvironmentMaps;
+    bool _persistBRDFMap;
+    
+    /*
+     Load the maps for the current lighting environment from the driver's
+     VROIBLCache, and return the first phase whose map was not cached. The BRDF
+     map is shared by all environments, so once computed or loaded it's reused.
+     */
+    VROIBLPhase loadCachedMaps(VRORenderContext *context, std::shared_ptr<VRODriver> driver);
+    
+    /*
+     Start rendering the maps of the current lighting environment from the given
+     phase, scheduling the convolution task if it's not already queued.
+     */
+    void beginConvolution(VROIBLPhase phase, std::shared_ptr<VRODriver> driver);
+    
+    /*
+     Render the next slice of the current phase. Returns true when there is no
+     more work to do.
+     */
+    bool renderSlice(std::shared_ptr<VRODriver> driver);
+    
+    /*
+     Move to the given phase once the slices of the current phase are done.
+     */
+    void finishPhase(VROIBLPhase next);
+    
+    void doPersistPhase(std::shared_ptr<VRODriver> driver);
 };
 
 #endif /* VROIBLPreprocess_h */
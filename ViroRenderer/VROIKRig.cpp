@@ -27,8 +27,15 @@
 #include "VRONode.h"
 #include "VROBone.h"
 #include "VROSkeleton.h"
+#include "VROTime.h"
+#include <algorithm>
+#include <limits>
 static const float kFABRIKRetry = 50;
 static const float kReachableEffectorThresholdMeters = 0.005;
+
+// Iteration stops when an iteration reduces the effector error by less than
+// this amount, as happens when a target is out of reach
+static const float kFABRIKStallThresholdMeters = 0.0001;
 static const bool kSyncNodePosition = false;
 static const bool kLockIntermediaryBoneMode = true;
 
@@ -75,6 +82,7 @@ VROIKRig::VROIKRig(std::shared_ptr<VRONode> root,
 
     _initializeRig = true;
     _processedNewEffectorPositions = false;
+    _needsSync = false;
 }
 
 VROIKRig::VROIKRig(std::shared_ptr<VROSkeleton> skeleton,
@@ -121,6 +129,7 @@ VROIKRig::VROIKRig(std::shared_ptr<VROSkeleton> skeleton,
 
     _initializeRig = true;
     _processedNewEffectorPositions = false;
+    _needsSync = false;
 }
 
 VROIKRig::~VROIKRig() {
@@ -307,6 +316,11 @@ void VROIKRig::setPositionForEffector(std::string affectorId, VROVector3f pos) {
 }
 
 void VROIKRig::processRig() {
+    solveRig(0);
+    syncRig();
+}
+
+void VROIKRig::solveRig(uint64_t deadlineNs) {
     if (_initializeRig) {
         initializeRig();
         return;
@@ -324,8 +338,28 @@ void VROIKRig::processRig() {
         return;
     }
 
-    // Else, start our processing the IK calculations for this rig.
-    processInverseKinematics();
+    // Warm-start from the last solution, carried along with any root motion
+    // since it was computed.
+    VROVector3f rootMotion = _rootJoint->position - _solvedRootPosition;
+    if (rootMotion.magnitude() > 0) {
+        for (auto &joint : _allKnownIKJoints) {
+            if (joint != _rootJoint) {
+                joint->position = joint->position + rootMotion;
+            }
+        }
+    }
+    _solvedRootPosition = _rootJoint->position;
+
+    // Else, start our processing the IK calculations for this rig. If the deadline
+    // cut the solve short, it continues from here next frame.
+    _processedNewEffectorPositions = processInverseKinematics(deadlineNs);
+    _needsSync = true;
+}
+
+void VROIKRig::syncRig() {
+    if (!_needsSync) {
+        return;
+    }
 
     // Sync the results from the IK calculations.
     if (_skeleton != nullptr) {
@@ -337,8 +371,7 @@ void VROIKRig::processRig() {
             syncResultRotationOnly(_rootJoint);
         }
     }
-
-    _processedNewEffectorPositions = true;
+    _needsSync = false;
 }
 
 void VROIKRig::initializeRig() {
@@ -436,6 +469,7 @@ void VROIKRig::initializeRig() {
         }
     }
 
+    _solvedRootPosition = _rootJoint->position;
     _initializeRig = false;
 }
 
@@ -538,11 +572,12 @@ void VROIKRig::formChainDependencies(std::shared_ptr<VROIKChain> &currentChain)
     }
 }
 
-void VROIKRig::processInverseKinematics() {
+bool VROIKRig::processInverseKinematics(uint64_t deadlineNs) {
     VROVector3f preservedRootPosition = _rootJoint->position;
 
     // Main FABRIK algorithm
     int retry = 0;
+    float previousError = std::numeric_limits<float>::max();
     while(retry < kFABRIKRetry) {
         // Step 0: Refresh fabric tree
         for (auto &chain : _allKnownChains) {
@@ -588,28 +623,34 @@ void VROIKRig::processInverseKinematics() {
         }
 
         // Step 5: Now examine the end effectors and determine if they are close enough
-        // to the desired target distance.
-        if (hasEffectorsMetTarget()) {
-           break;
+        // to the desired target distance, or have stopped getting any closer.
+        float error = getEffectorError();
+        if (error <= kReachableEffectorThresholdMeters ||
+            previousError - error < kFABRIKStallThresholdMeters) {
+           return true;
         }
+        previousError = error;
 
-        // If not, repeat.
+        // If not, repeat, unless we're out of time.
+        if (deadlineNs > 0 && VRONanoTime() >= deadlineNs) {
+            return false;
+        }
         retry ++;
     }
+    return true;
 }
 
-bool VROIKRig::hasEffectorsMetTarget() {
+float VROIKRig::getEffectorError() {
+    float error = 0;
     for (auto desiredPos : _effectorDesiredPositionMap) {
         std::string key = desiredPos.first;
         std::shared_ptr<VROIKJoint> effectorJoint = _keyToEffectorMap[key];
         VROVector3f desiredPosition = desiredPos.second;
         VROVector3f currentPosition = effectorJoint->position;
 
-        if (desiredPosition.distanceAccurate(currentPosition) > kReachableEffectorThresholdMeters) {
-            return false;
-        }
+        error = std::max(error, desiredPosition.distanceAccurate(currentPosition));
     }
-    return true;
+    return error;
 }
 
 void VROIKRig::processChainTreeTowardsEffectors(std::shared_ptr<VROIKChain> &chain) {
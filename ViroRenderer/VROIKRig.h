@@ -118,6 +118,18 @@ public:
      */
     void processRig();
 
+    /*
+     The two phases of processRig, split so that independent rigs can be solved
+     in parallel. solveRig runs the FABRIK iterations; it reads node and bone
+     transforms but writes only to this rig, so it may be invoked off the rendering
+     thread. Iteration stops when the effectors converge or stall, or at the given
+     deadline (in VRONanoTime nanoseconds, 0 for none), in which case the solve
+     resumes from the partial solution next frame. syncRig writes the solution back
+     to the node or skeletal tree, and must be invoked on the rendering thread.
+     */
+    void solveRig(uint64_t deadlineNs);
+    void syncRig();
+
 private:
     /*
      The root IKJoint of this rig
@@ -150,6 +162,17 @@ private:
      */
     bool _processedNewEffectorPositions;
 
+    /*
+     True if solveRig has produced joint positions not yet synced by syncRig.
+     */
+    bool _needsSync;
+
+    /*
+     The root joint's position at the last solve. The previous solution is moved
+     with the root before solving again, so each solve is warm-started from it.
+     */
+    VROVector3f _solvedRootPosition;
+
     /*
      A vec of all root IK chains in this rig
      */
@@ -222,11 +245,11 @@ private:
     /*
      Main kinematic functions for performing a FABRIK pass.
      */
-    void processInverseKinematics();
+    bool processInverseKinematics(uint64_t deadlineNs);
     void processChainTreeTowardsRoot(std::shared_ptr<VROIKChain> &chain);
     void processChainTreeTowardsEffectors(std::shared_ptr<VROIKChain> &chain);
     void processFABRIKChainNode(std::shared_ptr<VROIKChain> &chain, bool reverse);
-    bool hasEffectorsMetTarget();
+    float getEffectorError();
 
     /*
      FUnctions for syncing the result of FABRIK calculations back into node / bone transforms.
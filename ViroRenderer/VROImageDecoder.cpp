@@ -0,0 +1,85 @@
+//
+//  VROImageDecoder.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROImageDecoder.h"
+#include "VROJobSystem.h"
+#include "VROLog.h"
+#include <algorithm>
+
+// glTF only permits PNG and JPEG images. Failure strings are global in
+// stb_image and would race between decode threads.
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_PNG
+#define STBI_ONLY_JPEG
+#define STBI_NO_STDIO
+#define STBI_NO_FAILURE_STRINGS
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define STBI_NEON
+#endif
+#include "stb_image.h"
+
+VRODecodedImage::VRODecodedImage(unsigned char *pixels, int width, int height, bool hasAlpha) :
+    _pixels(pixels),
+    _width(width),
+    _height(height) {
+    _format = hasAlpha ? VROTextureFormat::RGBA8 : VROTextureFormat::RGB8;
+    _internalFormat = VROTextureInternalFormat::RGBA8;
+}
+
+VRODecodedImage::~VRODecodedImage() {
+    stbi_image_free(_pixels);
+}
+
+std::shared_ptr<VROImage> VROImageDecoder::decode(const unsigned char *data, size_t length,
+                                                  VROTextureInternalFormat format) {
+    if (format != VROTextureInternalFormat::RGBA8 || data == nullptr || length == 0) {
+        return nullptr;
+    }
+
+    int width, height, components;
+    unsigned char *pixels = stbi_load_from_memory(data, (int) length, &width, &height, &components, 4);
+    if (pixels == nullptr) {
+        return nullptr;
+    }
+
+    // Grey-alpha and RGBA sources have alpha
+    bool hasAlpha = components == 2 || components == 4;
+    return std::make_shared<VRODecodedImage>(pixels, width, height, hasAlpha);
+}
+
+std::vector<std::shared_ptr<VROImage>> VROImageDecoder::decode(const std::vector<const std::vector<unsigned char> *> &encoded,
+                                                               VROTextureInternalFormat format) {
+    std::vector<std::shared_ptr<VROImage>> images(encoded.size());
+    VROJobSystem::getShared()->parallelFor(0, (int) encoded.size(), 1, [&encoded, &images, format] (int i) {
+        if (encoded[i] != nullptr) {
+            images[i] = decode(encoded[i]->data(), encoded[i]->size(), format);
+        }
+    });
+    return images;
+}
+
+int VROImageDecoder::getConcurrency() {
+    return VROJobSystem::getShared()->getConcurrency();
+}
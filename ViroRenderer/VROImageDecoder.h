@@ -0,0 +1,98 @@
+//
+//  VROImageDecoder.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROImageDecoder_h
+#define VROImageDecoder_h
+
+#include <memory>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+#include "VROImage.h"
+
+/*
+ Image whose pixels were decoded natively by VROImageDecoder. The decoded
+ buffer is handed to the texture substrate as-is, without further copies.
+ Pixels are always four bytes (RGBA8); opaque images report format RGB8, as
+ the platform images do.
+ */
+class VRODecodedImage : public VROImage {
+public:
+
+    VRODecodedImage(unsigned char *pixels, int width, int height, bool hasAlpha);
+    virtual ~VRODecodedImage();
+
+    int getWidth() const {
+        return _width;
+    }
+    int getHeight() const {
+        return _height;
+    }
+    unsigned char *getData(size_t *length) {
+        *length = (size_t) _width * _height * 4;
+        return _pixels;
+    }
+
+private:
+
+    unsigned char *_pixels;
+    int _width, _height;
+
+};
+
+/*
+ Decodes encoded PNG and JPEG images in native code, without a round trip
+ through the platform's image classes. Batches of images are decoded in
+ parallel on a small pool of worker threads dedicated to decoding, so long
+ decodes never delay the jobs of the rendering thread.
+ */
+class VROImageDecoder {
+public:
+
+    /*
+     Decode the given encoded image on the calling thread. Only RGBA8 internal
+     formats are decoded; returns nullptr for other formats or if the image
+     can't be decoded natively. May be invoked from any thread.
+     */
+    static std::shared_ptr<VROImage> decode(const unsigned char *data, size_t length,
+                                            VROTextureInternalFormat format);
+
+    /*
+     Decode each of the given encoded images in parallel and return them in the
+     same order. Images that can't be decoded natively are returned as nullptr.
+     Blocks until all images are decoded; the calling thread decodes images
+     while it waits. May be invoked from any thread.
+     */
+    static std::vector<std::shared_ptr<VROImage>> decode(const std::vector<const std::vector<unsigned char> *> &encoded,
+                                                         VROTextureInternalFormat format);
+
+    /*
+     The number of images decoded concurrently by a parallel decode.
+     */
+    static int getConcurrency();
+
+};
+
+#endif /* VROImageDecoder_h */
@@ -36,6 +36,7 @@
 #include "VROLog.h"
 #include "VROShaderModifier.h"
 #include "VROTextureSubstrateOpenGL.h"
+#include "VROProfiler.h"
 
 VROImagePostProcessOpenGL::VROImagePostProcessOpenGL(std::shared_ptr<VROShaderProgram> shader) :
     _shader(shader),
@@ -89,7 +90,7 @@ void VROImagePostProcessOpenGL::blit(std::vector<std::shared_ptr<VROTexture>> te
         uniform_binder.first->setForMaterial(uniform_binder.second, nullptr, nullptr);
     }
     
-    drawScreenSpaceVAR();
+    drawScreenSpaceVAR(driver);
     driver->unbindShader();
 }
 
@@ -117,7 +118,7 @@ void VROImagePostProcessOpenGL::blitOpt(std::vector<std::shared_ptr<VROTexture>>
     for (auto uniform_binder : _uniformBinders) {
         uniform_binder.first->setForMaterial(uniform_binder.second, nullptr, nullptr);
     }
-    drawScreenSpaceVAR();
+    drawScreenSpaceVAR(driver);
 }
 
 void VROImagePostProcessOpenGL::end(std::shared_ptr<VRODriver> &driver) {
@@ -136,14 +137,15 @@ bool VROImagePostProcessOpenGL::bind(std::vector<std::shared_ptr<VROTexture>> te
     return true;
 }
 
-void VROImagePostProcessOpenGL::drawScreenSpaceVAR() {
+void VROImagePostProcessOpenGL::drawScreenSpaceVAR(std::shared_ptr<VRODriver> &driver) {
+    std::shared_ptr<VRODriverOpenGL> driverGL = std::static_pointer_cast<VRODriverOpenGL>(driver);
     if (_quadVAO == 0) {
         GL( glGenBuffers(1, &_quadVBO));
         GL( glBindBuffer(GL_ARRAY_BUFFER, _quadVBO) );
         GL( glBufferData(GL_ARRAY_BUFFER, sizeof(_quadFSVAR), _quadFSVAR, GL_STATIC_DRAW) );
         
         GL( glGenVertexArrays(1, &_quadVAO) );
-        GL( glBindVertexArray(_quadVAO) );
+        driverGL->bindVertexArray(_quadVAO);
         
         int verticesIndex = VROGeometryUtilParseAttributeIndex(VROGeometrySourceSemantic::Vertex);
         GL( glEnableVertexAttribArray(verticesIndex) );
@@ -154,9 +156,9 @@ void VROImagePostProcessOpenGL::drawScreenSpaceVAR() {
         GL( glVertexAttribPointer(texcoordIndex, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *) (2 * sizeof(float))) );
     }
     
-    GL( glBindVertexArray(_quadVAO) );
+    driverGL->bindVertexArray(_quadVAO);
     GL( glDrawArrays(GL_TRIANGLE_STRIP, 0, 4) );
-    GL( glBindVertexArray(0) );
+    VRO_PROFILE_COUNT(DrawCalls, 1);
 }
 
 void VROImagePostProcessOpenGL::buildQuadFSVAR(bool flipped) {
@@ -88,7 +88,7 @@ private:
     /*
      Draw the vertex array.
      */
-    void drawScreenSpaceVAR();
+    void drawScreenSpaceVAR(std::shared_ptr<VRODriver> &driver);
     
 };
 
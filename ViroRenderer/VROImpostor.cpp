@@ -0,0 +1,223 @@
+//
+//  VROImpostor.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include "VROImpostor.h"
+#include "VROGeometry.h"
+#include "VROGeometryElement.h"
+#include "VROGeometrySource.h"
+#include "VROMaterial.h"
+#include "VRONode.h"
+#include "VRODriver.h"
+#include "VRORenderTarget.h"
+#include "VRORenderContext.h"
+#include "VROShaderModifier.h"
+#include "VROShapeUtils.h"
+#include "VROMath.h"
+#include "VROStringUtil.h"
+#include "VROLog.h"
+#include "VROOpenGL.h" // For pglpush and pop
+
+/*
+ The billboard is built around the geometry's center in the geometry's space,
+ and turned to face the camera in world space. Billboards are constant-lit, so
+ the normal of each vertex carries the billboard's center instead. The view
+ whose azimuth about the geometry's vertical axis is nearest to the camera's is
+ selected, and its cell of the atlas mapped onto the quad.
+ */
+static std::shared_ptr<VROShaderModifier> sImpostorVertexModifier;
+static std::shared_ptr<VROShaderModifier> sImpostorFragmentModifier;
+
+static std::shared_ptr<VROShaderModifier> getImpostorVertexModifier() {
+    if (!sImpostorVertexModifier) {
+        std::vector<std::string> modifierCode = {
+            "highp vec3 impostor_center = (_transforms.model_matrix * vec4(_geometry.normal, 1.0)).xyz;",
+            "highp vec2 impostor_corner = _geometry.texcoord * 2.0 - 1.0;",
+            "highp float impostor_radius = abs(_geometry.position.x - _geometry.normal.x);",
+            "highp vec3 impostor_up = _transforms.model_matrix[1].xyz;",
+            "highp float impostor_scale = length(impostor_up);",
+            "impostor_up /= impostor_scale;",
+            "highp vec3 impostor_dir = camera_position - impostor_center;",
+            "impostor_dir -= impostor_up * dot(impostor_dir, impostor_up);",
+            "if (dot(impostor_dir, impostor_dir) < 0.000001) {",
+            "    impostor_dir = _transforms.model_matrix[2].xyz;",
+            "}",
+            "impostor_dir = normalize(impostor_dir);",
+            "highp vec3 impostor_right = cross(impostor_up, impostor_dir);",
+            "highp float impostor_azimuth = atan(dot(impostor_dir, normalize(_transforms.model_matrix[0].xyz)),",
+            "                                    dot(impostor_dir, normalize(_transforms.model_matrix[2].xyz)));",
+            "highp float impostor_view = mod(floor(impostor_azimuth * " + VROStringUtil::toString(kImpostorNumViews) + ".0 / 6.2831853 + 0.5), " +
+                VROStringUtil::toString(kImpostorNumViews) + ".0);",
+            "highp vec3 impostor_position = impostor_center + (impostor_right * impostor_corner.x + impostor_up * impostor_corner.y) * impostor_radius * impostor_scale;",
+            "v_texcoord = vec2((impostor_view + _geometry.texcoord.x) / " + VROStringUtil::toString(kImpostorNumViews) + ".0, _geometry.texcoord.y);",
+            "v_surface_position = impostor_position;",
+            "_vertex.position = _transforms.projection_matrix * _transforms.view_matrix * vec4(impostor_position, 1.0);",
+        };
+        sImpostorVertexModifier = std::make_shared<VROShaderModifier>(VROShaderEntryPoint::Vertex, modifierCode);
+        sImpostorVertexModifier->setName("impostor");
+    }
+    return sImpostorVertexModifier;
+}
+
+static std::shared_ptr<VROShaderModifier> getImpostorFragmentModifier() {
+    if (!sImpostorFragmentModifier) {
+        std::vector<std::string> modifierCode = {
+            "if (_output_color.a < 0.1) discard;",
+        };
+        sImpostorFragmentModifier = std::make_shared<VROShaderModifier>(VROShaderEntryPoint::Fragment, modifierCode);
+        sImpostorFragmentModifier->setName("impostor_f");
+    }
+    return sImpostorFragmentModifier;
+}
+
+VROImpostor::VROImpostor(float screenCoverage) :
+    _screenCoverage(screenCoverage),
+    _captureRequested(false) {
+    
+}
+
+VROImpostor::~VROImpostor() {
+    
+}
+
+bool VROImpostor::requestCapture() {
+    if (_captureRequested) {
+        return false;
+    }
+    _captureRequested = true;
+    return true;
+}
+
+void VROImpostor::invalidate() {
+    _geometry.reset();
+    _captureRequested = false;
+}
+
+void VROImpostor::capture(VRONode &node, VRORenderContext *context, std::shared_ptr<VRODriver> &driver) {
+    std::shared_ptr<VROGeometry> geometry = node.getGeometry();
+    if (!geometry || geometry->getMaterials().empty()) {
+        return;
+    }
+    
+    // Each view is an orthographic projection of the geometry's bounding sphere,
+    // from a camera outside the sphere looking toward its center
+    const VROBoundingBox &bounds = geometry->getBoundingBox();
+    VROVector3f localCenter = bounds.getCenter();
+    float radius = bounds.getExtents().magnitude() * 0.5f;
+    if (radius < kEpsilon) {
+        return;
+    }
+    
+    VROMatrix4f worldTransform = node.getWorldTransform();
+    VROMatrix4f normalMatrix = worldTransform.invert().transpose();
+    VROVector3f center = worldTransform.multiply(localCenter);
+    VROVector3f up = worldTransform.multiply(localCenter + VROVector3f(0, 1, 0)) - center;
+    float worldRadius = radius * up.magnitude();
+    up = up.normalize();
+    
+    if (!_target) {
+        _target = driver->newRenderTarget(VRORenderTargetType::ColorTexture, 1, 1, false, true);
+        _target->setViewport({ 0, 0, kImpostorNumViews * kImpostorViewResolution, kImpostorViewResolution });
+        _target->hydrate();
+        _target->setClearColor({ 0, 0, 0, 0 });
+    }
+    
+    VROMatrix4f previousProjection = context->getProjectionMatrix();
+    VROMatrix4f previousView = context->getViewMatrix();
+    context->setProjectionMatrix(VROMathComputeOrthographicProjection(-worldRadius, worldRadius, -worldRadius, worldRadius,
+                                                                      worldRadius, worldRadius * 3));
+    
+    pglpush("Impostor");
+    driver->bindRenderTarget(_target, VRORenderTargetActions::clearAll(), VRORenderTargetUnbindOp::Invalidate);
+    
+    bool captured = true;
+    int numElements = (int) geometry->getGeometryElements().size();
+    for (int v = 0; v < kImpostorNumViews && captured; v++) {
+        float azimuth = v * 2 * M_PI / kImpostorNumViews;
+        VROVector3f direction = (worldTransform.multiply(localCenter + VROVector3f(sin(azimuth), 0, cos(azimuth))) - center).normalize();
+        context->setViewMatrix(VROMathComputeLookAtMatrix(center + direction * (worldRadius * 2), direction.scale(-1), up));
+        _target->setRenderRegion({ v * kImpostorViewResolution, 0, kImpostorViewResolution, kImpostorViewResolution });
+        
+        for (int i = 0; i < numElements; i++) {
+            std::shared_ptr<VROMaterial> &material = geometry->getMaterialForElement(i);
+            if (!material->bindShader(node.getComputedLightsHash(), node.getComputedLights(), *context, driver)) {
+                captured = false;
+                break;
+            }
+            material->bindProperties(driver);
+            geometry->render(i, material, worldTransform, normalMatrix, 1.0, *context, driver);
+        }
+    }
+    pglpop();
+    
+    context->setProjectionMatrix(previousProjection);
+    context->setViewMatrix(previousView);
+    
+    // Shaders still compiling: try again when next requested
+    if (!captured) {
+        _captureRequested = false;
+        return;
+    }
+    _geometry = buildBillboard(localCenter, radius);
+}
+
+std::shared_ptr<VROGeometry> VROImpostor::buildBillboard(VROVector3f center, float radius) {
+    const int numVertices = 4;
+    const int numIndices = 6;
+    
+    VROShapeVertexLayout var[numVertices];
+    float corners[numVertices][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+    for (int i = 0; i < numVertices; i++) {
+        var[i].x = center.x + corners[i][0] * radius;
+        var[i].y = center.y + corners[i][1] * radius;
+        var[i].z = center.z;
+        var[i].u = (corners[i][0] + 1) * 0.5f;
+        var[i].v = (corners[i][1] + 1) * 0.5f;
+        var[i].nx = center.x;
+        var[i].ny = center.y;
+        var[i].nz = center.z;
+    }
+    int indices[numIndices] = { 0, 1, 2, 0, 2, 3 };
+    VROShapeUtilComputeTangents(var, numVertices, indices, numIndices);
+    
+    std::shared_ptr<VROData> vertexData = std::make_shared<VROData>((void *) var, sizeof(VROShapeVertexLayout) * numVertices);
+    std::vector<std::shared_ptr<VROGeometrySource>> sources = VROShapeUtilBuildGeometrySources(vertexData, numVertices);
+    
+    std::shared_ptr<VROData> indexData = std::make_shared<VROData>((void *) indices, sizeof(int) * numIndices);
+    std::vector<std::shared_ptr<VROGeometryElement>> elements = {
+        std::make_shared<VROGeometryElement>(indexData, VROGeometryPrimitiveType::Triangle, 2, sizeof(int))
+    };
+    std::shared_ptr<VROGeometry> billboard = std::make_shared<VROGeometry>(sources, elements);
+    
+    std::shared_ptr<VROMaterial> material = std::make_shared<VROMaterial>();
+    material->setLightingModel(VROLightingModel::Constant);
+    material->setCullMode(VROCullMode::None);
+    material->getDiffuse().setTexture(_target->getTexture(0));
+    material->addShaderModifier(getImpostorVertexModifier());
+    material->addShaderModifier(getImpostorFragmentModifier());
+    billboard->setMaterials({ material });
+    billboard->setName("Impostor");
+    return billboard;
+}
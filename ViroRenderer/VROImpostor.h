@@ -0,0 +1,137 @@
+//
+//  VROImpostor.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef VROImpostor_h
+#define VROImpostor_h
+
+#include <memory>
+#include "VROVector3f.h"
+
+class VRONode;
+class VRODriver;
+class VROGeometry;
+class VRORenderTarget;
+class VRORenderContext;
+
+/*
+ Number of views around the vertical axis captured into an impostor's atlas,
+ and the resolution of each view in texels. Keep the number of views in sync
+ with the impostor shader modifier.
+ */
+static const int kImpostorNumViews = 8;
+static const int kImpostorViewResolution = 128;
+
+/*
+ Fraction of the viewport's height below which a geometry is rendered by its
+ impostor, by default.
+ */
+static const float kImpostorDefaultScreenCoverage = 0.05;
+
+/*
+ Impostors are captured as they're needed, at most this many per frame, to
+ spread the cost of capturing many at once.
+ */
+static const int kMaxImpostorCapturesPerFrame = 1;
+
+/*
+ An impostor replaces a complex geometry with a single textured billboard when
+ the geometry is far enough away that its detail is lost.
+ 
+ The geometry is captured from kImpostorNumViews directions around its vertical
+ axis into one atlas, the first time it drops below the impostor's screen
+ coverage (see VROGeometry::updateSortKeys). From then on it renders as a quad
+ that turns about the geometry's vertical axis to face the camera, textured
+ with the view nearest the camera's direction. Impostors of nodes sharing a
+ geometry share a single quad, and so are batched by automatic instancing.
+ 
+ Impostors are captured with the lighting of the node that first requested the
+ capture, and do not respond to later changes in lighting or materials; call
+ invalidate() to recapture.
+ */
+class VROImpostor {
+    
+public:
+    
+    VROImpostor(float screenCoverage = kImpostorDefaultScreenCoverage);
+    virtual ~VROImpostor();
+    
+    /*
+     The fraction of the viewport's height below which the geometry is rendered
+     by this impostor.
+     */
+    float getScreenCoverage() const {
+        return _screenCoverage;
+    }
+    
+    /*
+     The billboard rendered in place of the geometry, or nullptr if the
+     impostor has not yet been captured.
+     */
+    const std::shared_ptr<VROGeometry> &getGeometry() const {
+        return _geometry;
+    }
+    
+    /*
+     Request that the impostor be captured. Returns true if this is the first
+     request since the impostor was created or invalidated, in which case the
+     caller should schedule the capture.
+     */
+    bool requestCapture();
+    
+    /*
+     Capture the geometry of the given node into this impostor's atlas. The
+     capture renders with the node's lights, and overrides the view and
+     projection matrices of the context for its duration. If any material is not
+     yet ready to render, the capture is abandoned and may be requested again.
+     */
+    void capture(VRONode &node, VRORenderContext *context, std::shared_ptr<VRODriver> &driver);
+    
+    /*
+     Discard the captured impostor, so that it is captured again the next time
+     it is needed.
+     */
+    void invalidate();
+    
+private:
+    
+    float _screenCoverage;
+    bool _captureRequested;
+    
+    /*
+     The billboard and the render target holding its atlas.
+     */
+    std::shared_ptr<VROGeometry> _geometry;
+    std::shared_ptr<VRORenderTarget> _target;
+    
+    /*
+     Build the billboard for a geometry with the given center and radius, in the
+     geometry's coordinate space.
+     */
+    std::shared_ptr<VROGeometry> buildBillboard(VROVector3f center, float radius);
+    
+};
+
+#endif /* VROImpostor_h */
@@ -26,6 +26,7 @@
 #include "VROInputControllerBase.h"
 #include "VROTime.h"
 #include "VROPortal.h"
+#include "VRORenderInvalidation.h"
 
 static bool sSceneBackgroundAdd = true;
 
@@ -40,6 +41,10 @@ VROInputControllerBase::VROInputControllerBase(std::shared_ptr<VRODriver> driver
     _currentRotateNode = nullptr;
     _scene = nullptr;
     _currentControllerStatus = VROEventDelegate::ControllerStatus::Unknown;
+    _hitTestGeneration = 0;
+    _hitResultCoherent = false;
+    _hitTestInterval = kDefaultHitTestInterval;
+    _framesSinceFullHitTest = 0;
     
 #if VRO_PLATFORM_IOS
     if (kDebugSceneBackgroundDistance) {
@@ -81,6 +86,10 @@ void VROInputControllerBase::setProjection(VROMatrix4f projection) {
 }
 
 void VROInputControllerBase::onButtonEvent(int source, VROEventDelegate::ClickState clickState) {
+    if (_frameCapture) {
+        _frameCapture->recordButton(source, clickState);
+    }
+
     // Return if we have not focused on any node upon which to trigger events.
     if (_hitResult == nullptr) {
         return;
@@ -159,6 +168,10 @@ void VROInputControllerBase::onButtonEvent(int source, VROEventDelegate::ClickSt
 void VROInputControllerBase::onTouchpadEvent(int source, VROEventDelegate::TouchState touchState,
                                              float posX,
                                              float posY) {
+    if (_frameCapture) {
+        _frameCapture->recordTouchpad(source, touchState, posX, posY);
+    }
+
     // Avoid spamming similar TouchDownMove events.
     VROVector3f currentTouchedPosition = VROVector3f(posX, posY, 0);
     if (touchState == VROEventDelegate::TouchState::TouchDownMove &&
@@ -182,6 +195,10 @@ void VROInputControllerBase::onTouchpadEvent(int source, VROEventDelegate::Touch
 }
 
 void VROInputControllerBase::onMove(int source, VROVector3f position, VROQuaternion rotation, VROVector3f forward) {
+    if (_frameCapture) {
+        _frameCapture->recordMove(source, position, rotation, forward);
+    }
+
     _lastKnownRotation = rotation;
     _lastKnownPosition = position;
     _lastKnownForward = forward;
@@ -351,6 +368,10 @@ VROVector3f VROInputControllerBase::getDragPositionFixedToPlane() {
 }
 
 void VROInputControllerBase::onPinch(int source, float scaleFactor, VROEventDelegate::PinchState pinchState) {
+    if (_frameCapture) {
+        _frameCapture->recordPinch(source, scaleFactor, pinchState);
+    }
+
     if(pinchState == VROEventDelegate::PinchState::PinchStart) {
         if(_hitResult == nullptr) {
             return;
@@ -374,6 +395,10 @@ void VROInputControllerBase::onPinch(int source, float scaleFactor, VROEventDele
 }
 
 void VROInputControllerBase::onRotate(int source, float rotationRadians, VROEventDelegate::RotateState rotateState) {
+    if (_frameCapture) {
+        _frameCapture->recordRotate(source, rotationRadians, rotateState);
+    }
+
     if(rotateState == VROEventDelegate::RotateState::RotateStart) {
         if(_hitResult == nullptr) {
             return;
@@ -401,11 +426,73 @@ void VROInputControllerBase::updateHitNode(const VROCamera &camera, VROVector3f
         return;
     }
 
+    // If neither the ray nor anything in the scene has changed, neither has the hit
+    uint64_t generation = VRORenderInvalidation::getGeneration();
+    if (_hitResult && _hitResultCoherent && generation == _hitTestGeneration &&
+        origin.distance(_hitTestOrigin) < kHitTestCoherenceDistance &&
+        ray.normalize().angleWithNormedVector(_hitTestRay.normalize()) < kHitTestCoherenceAngle) {
+        return;
+    }
+    _hitTestOrigin = origin;
+    _hitTestRay = ray;
+    _hitTestGeneration = generation;
+    _hitResultCoherent = true;
+    
+    // Between full hit tests, keep the last hit node while the ray still hits it
+    ++_framesSinceFullHitTest;
+    if (_framesSinceFullHitTest < _hitTestInterval) {
+        std::shared_ptr<VROHitTestResult> result = hitTestLastHitNode(camera, origin, ray);
+        if (result) {
+            _hitResult = result;
+            return;
+        }
+    }
+    
     // Perform hit test re-calculate forward vectors as needed.
+    _framesSinceFullHitTest = 0;
     _hitResult = std::make_shared<VROHitTestResult>(hitTest(camera, origin, ray, true));
 }
 
+std::shared_ptr<VROHitTestResult> VROInputControllerBase::hitTestLastHitNode(const VROCamera &camera,
+                                                                             VROVector3f origin, VROVector3f ray) {
+    // A background hit says nothing about what the ray hits now
+    if (!_hitResult || _hitResult->isBackgroundHit()) {
+        return nullptr;
+    }
+    
+    // Make sure the node is still in the scene, and still selectable from the root
+    std::shared_ptr<VRONode> node = _hitResult->getNode();
+    std::shared_ptr<VRONode> rootNode = _scene->getRootNode();
+    std::shared_ptr<VRONode> ancestor = node;
+    while (ancestor && ancestor != rootNode) {
+        if (!ancestor->isSelectable()) {
+            return nullptr;
+        }
+        ancestor = ancestor->getParentNode();
+    }
+    if (!ancestor) {
+        return nullptr;
+    }
+    
+    std::vector<VROHitTestResult> results = node->hitTest(camera, origin, ray, true);
+    const VROHitTestResult *closest = nullptr;
+    for (const VROHitTestResult &candidate : results) {
+        if (!candidate.getNode()->getIgnoreEventHandling() &&
+            (!closest || candidate.getDistance() < closest->getDistance())) {
+            closest = &candidate;
+        }
+    }
+    if (!closest) {
+        return nullptr;
+    }
+    return std::make_shared<VROHitTestResult>(*closest);
+}
+
 void VROInputControllerBase::onControllerStatus(int source, VROEventDelegate::ControllerStatus status){
+    if (_frameCapture) {
+        _frameCapture->recordControllerStatus(source, status);
+    }
+
     if (_currentControllerStatus == status){
         return;
     }
@@ -426,6 +513,10 @@ void VROInputControllerBase::onControllerStatus(int source, VROEventDelegate::Co
 }
 
 void VROInputControllerBase::onSwipe(int source, VROEventDelegate::SwipeState swipeState) {
+    if (_frameCapture) {
+        _frameCapture->recordSwipe(source, swipeState);
+    }
+
     std::shared_ptr<VRONode> focusedNode;
     if (_hitResult) {
         focusedNode = getNodeToHandleEvent(VROEventDelegate::EventAction::OnSwipe, _hitResult->getNode());
@@ -440,6 +531,10 @@ void VROInputControllerBase::onSwipe(int source, VROEventDelegate::SwipeState sw
 }
 
 void VROInputControllerBase::onScroll(int source, float x, float y) {
+    if (_frameCapture) {
+        _frameCapture->recordScroll(source, x, y);
+    }
+
     std::shared_ptr<VRONode> focusedNode;
     if (_hitResult) {
         focusedNode = getNodeToHandleEvent(VROEventDelegate::EventAction::OnScroll, _hitResult->getNode());
@@ -31,6 +31,7 @@
 #include <string>
 #include <memory>
 #include <set>
+#include <algorithm>
 #include <float.h>
 #include "VROInputPresenter.h"
 #include "VROScene.h"
@@ -39,12 +40,26 @@
 #include "VROHitTestResult.h"
 #include "VRONode.h"
 #include "VROGeometry.h"
+#include "VROFrameCapture.h"
 
 static const float ON_DRAG_DISTANCE_THRESHOLD = 0.01;
 static const float ON_PINCH_SCALE_THRESHOLD = 0.02;
 static const float ON_ROTATE_THRESHOLD = 0.01; // in radians (~.5729 degrees)
 static float kSceneBackgroundDistance = 8;
 
+/*
+ Rays that moved less than these amounts since the last hit test, in a scene
+ that has not been invalidated since, reuse its result (see updateHitNode).
+ The angle is in radians.
+ */
+static const float kHitTestCoherenceDistance = 0.001;
+static const float kHitTestCoherenceAngle = 0.001;
+
+/*
+ Default number of frames between full scene hit tests; see setHitTestInterval.
+ */
+static const int kDefaultHitTestInterval = 3;
+
 /*
  Responsible for mapping generalized input data from a controller, to a unified
  set of VROEventDelegate.EventTypes. It then notifies corresponding VROEventDelegates
@@ -88,9 +103,31 @@ public:
 
     void attachScene(std::shared_ptr<VROScene> scene) {
         _scene = scene;
+        _hitResultCoherent = false;
     }
     void detachScene() {
         _scene = nullptr;
+        _hitResultCoherent = false;
+    }
+    
+    /*
+     Set the number of frames between full scene hit tests for gaze and hover.
+     On the frames in between, the previously hit node is tested first, and if
+     the ray still hits it that result is used without testing the rest of the
+     scene. As a result, a node that moves in front of the hit node may take up
+     to this many frames to be detected. Set to 1 to test the full scene every
+     frame.
+     */
+    void setHitTestInterval(int intervalFrames) {
+        _hitTestInterval = std::max(intervalFrames, 1);
+    }
+    
+    /*
+     Record the events delivered to this controller into the given frame
+     capture, or stop recording if null.
+     */
+    void setFrameCapture(std::shared_ptr<VROFrameCapture> capture) {
+        _frameCapture = capture;
     }
     
     /*
@@ -176,7 +213,9 @@ protected:
 
     /*
      Update the hit node, performing an intersection from the camera's position
-     toward the given direction.
+     toward the given direction. Hit tests are temporally coherent: the last
+     result is reused if neither the ray nor the scene has changed, and the
+     last hit node is tested before the full scene (see setHitTestInterval).
      */
     void updateHitNode(const VROCamera &camera, VROVector3f origin, VROVector3f ray);
 
@@ -280,6 +319,34 @@ private:
      */
     std::shared_ptr<VROInputPresenter> _controllerPresenter;
     
+    /*
+     Frame capture recording the events delivered to this controller, if any.
+     */
+    std::shared_ptr<VROFrameCapture> _frameCapture;
+    
+    /*
+     The ray and scene generation (see VRORenderInvalidation) of the last hit
+     test, and whether _hitResult is still valid for them.
+     */
+    VROVector3f _hitTestOrigin;
+    VROVector3f _hitTestRay;
+    uint64_t _hitTestGeneration;
+    bool _hitResultCoherent;
+    
+    /*
+     Frames between full scene hit tests in updateHitNode, and the number of
+     frames since the last one.
+     */
+    int _hitTestInterval;
+    int _framesSinceFullHitTest;
+    
+    /*
+     Hit test only the subtree of the last hit node, returning nullptr if the
+     ray no longer hits it (or it has left the scene).
+     */
+    std::shared_ptr<VROHitTestResult> hitTestLastHitNode(const VROCamera &camera, VROVector3f origin,
+                                                         VROVector3f ray);
+    
     /*
      Last known position that a TouchEvent occured on.
      */
@@ -0,0 +1,155 @@
+//
+//  VROInstancedTransformUBO.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include "VROInstancedTransformUBO.h"
+#include "VROShaderProgram.h"
+#include "VROShaderModifier.h"
+#include "VRODriverOpenGL.h"
+#include "VROLog.h"
+#include <algorithm>
+
+VROInstancedTransformUBO::VROInstancedTransformUBO(std::shared_ptr<VRODriver> driver) {
+    _driver = driver;
+    
+    GL( glGenBuffers(1, &_transformsUBO) );
+    GL( glBindBuffer(GL_UNIFORM_BUFFER, _transformsUBO) );
+    GL( glBufferData(GL_UNIFORM_BUFFER, sizeof(VROInstancedTransformsUBOData), nullptr, GL_DYNAMIC_DRAW) );
+}
+
+VROInstancedTransformUBO::~VROInstancedTransformUBO() {
+    std::shared_ptr<VRODriverOpenGL> driver = std::dynamic_pointer_cast<VRODriverOpenGL>(_driver.lock());
+    if (driver) {
+        driver->deleteBuffer(_transformsUBO);
+    }
+}
+
+std::vector<std::shared_ptr<VROShaderModifier>> VROInstancedTransformUBO::createInstanceShaderModifier() {
+    return getInstanceShaderModifiers();
+}
+
+std::vector<std::shared_ptr<VROShaderModifier>> VROInstancedTransformUBO::getInstanceShaderModifiers() {
+    static std::shared_ptr<VROShaderModifier> sInstanceModifier;
+    if (!sInstanceModifier) {
+        // The normal matrix uniform is bound to identity for instanced draws, so
+        // we transform the normal and tangent into world space here
+        std::vector<std::string> modifierCode = {
+            "#include instanced_transforms_vsh",
+            "_transforms.model_matrix = instanced_model_matrix[v_instance_id];",
+            "_geometry.normal = (instanced_normal_matrix[v_instance_id] * vec4(_geometry.normal, 0.0)).xyz;",
+            "_geometry.tangent.xyz = (instanced_normal_matrix[v_instance_id] * vec4(_geometry.tangent.xyz, 0.0)).xyz;",
+        };
+        sInstanceModifier = std::make_shared<VROShaderModifier>(VROShaderEntryPoint::Geometry, modifierCode);
+        sInstanceModifier->setName("instanced_transforms");
+    }
+    return { sInstanceModifier };
+}
+
+std::shared_ptr<VROShaderModifier> VROInstancedTransformUBO::getInstanceLayerShaderModifier() {
+    static std::shared_ptr<VROShaderModifier> sInstanceLayerModifier;
+    if (!sInstanceLayerModifier) {
+        std::vector<std::string> modifierCode = {
+            "v_diffuse_layer = instanced_normal_matrix[v_instance_id][3][3];",
+        };
+        sInstanceLayerModifier = std::make_shared<VROShaderModifier>(VROShaderEntryPoint::Geometry, modifierCode);
+        sInstanceLayerModifier->setName("instanced_diffuse_layer");
+    }
+    return sInstanceLayerModifier;
+}
+
+std::shared_ptr<VROShaderModifier> VROInstancedTransformUBO::getInstanceAtlasShaderModifier() {
+    static std::shared_ptr<VROShaderModifier> sInstanceAtlasModifier;
+    if (!sInstanceAtlasModifier) {
+        std::vector<std::string> modifierCode = {
+            "highp mat4 atlas_normal_matrix = instanced_normal_matrix[v_instance_id];",
+            "v_diffuse_rect = vec4(atlas_normal_matrix[0][3], atlas_normal_matrix[1][3], atlas_normal_matrix[2][3], atlas_normal_matrix[3][0]);",
+        };
+        sInstanceAtlasModifier = std::make_shared<VROShaderModifier>(VROShaderEntryPoint::Geometry, modifierCode);
+        sInstanceAtlasModifier->setName("instanced_diffuse_atlas");
+    }
+    return sInstanceAtlasModifier;
+}
+
+void VROInstancedTransformUBO::encodeDiffuseTexture(const VROTexture &texture, VROMatrix4f *normalMatrix) {
+    int layer = texture.getTextureArrayLayer();
+    if (layer >= 0) {
+        (*normalMatrix)[15] = (float) layer;
+    }
+    else if (texture.getTextureAtlasId() != 0) {
+        VROVector4f rect = texture.getTextureAtlasRect();
+        (*normalMatrix)[3]  = rect.x;
+        (*normalMatrix)[7]  = rect.y;
+        (*normalMatrix)[11] = rect.z;
+        (*normalMatrix)[12] = rect.w;
+    }
+}
+
+void VROInstancedTransformUBO::encodeBakedAnimationFrame(float frame, VROMatrix4f *normalMatrix) {
+    (*normalMatrix)[14] = frame;
+}
+
+int VROInstancedTransformUBO::getNumberOfDrawCalls() {
+    return (int) ((_transforms.size() + kMaxInstancesPerUBO - 1) / kMaxInstancesPerUBO);
+}
+
+int VROInstancedTransformUBO::bindDrawData(int currentDrawCallIndex) {
+    int start = currentDrawCallIndex * kMaxInstancesPerUBO;
+    int end = std::min((int) _transforms.size(), start + kMaxInstancesPerUBO);
+    if (start >= end) {
+        return 0;
+    }
+    
+    VROInstancedTransformsUBOData data;
+    for (int i = start; i < end; i++) {
+        memcpy(&data.model_matrix[(i - start) * 16], _transforms[i].getArray(), 16 * sizeof(float));
+        memcpy(&data.normal_matrix[(i - start) * 16], _normalMatrices[i].getArray(), 16 * sizeof(float));
+    }
+    
+    // Upload only the used portion of each array
+    int count = end - start;
+    pglpush("InstancedTransforms");
+    GL( glBindBufferBase(GL_UNIFORM_BUFFER, VROShaderProgram::sInstancedTransformsUBOBindingPoint, _transformsUBO) );
+#if VRO_AVOID_BUFFER_SUB_DATA
+    GL( glBufferData(GL_UNIFORM_BUFFER, sizeof(VROInstancedTransformsUBOData), &data, GL_DYNAMIC_DRAW) );
+#else
+    GL( glBufferSubData(GL_UNIFORM_BUFFER, 0, count * 16 * sizeof(float), data.model_matrix) );
+    GL( glBufferSubData(GL_UNIFORM_BUFFER, offsetof(VROInstancedTransformsUBOData, normal_matrix),
+                        count * 16 * sizeof(float), data.normal_matrix) );
+#endif
+    pglpop();
+    return count;
+}
+
+VROBoundingBox VROInstancedTransformUBO::getInstancedBoundingBox() {
+    // Not used: instanced nodes are culled individually before they are batched
+    return VROBoundingBox(0, 0, 0, 0, 0, 0);
+}
+
+void VROInstancedTransformUBO::update(const std::vector<VROMatrix4f> &transforms,
+                                      const std::vector<VROMatrix4f> &normalMatrices) {
+    passert (transforms.size() == normalMatrices.size());
+    _transforms = transforms;
+    _normalMatrices = normalMatrices;
+}
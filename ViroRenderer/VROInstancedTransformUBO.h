@@ -0,0 +1,119 @@
+//
+//  VROInstancedTransformUBO.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef VROInstancedTransformUBO_h
+#define VROInstancedTransformUBO_h
+
+#include "VROInstancedUBO.h"
+
+class VROTexture;
+
+/*
+ Number of instances that fit in a single draw. Each instance uses two mat4s
+ (128 bytes), keeping the block under the 16KB minimum guaranteed by GLES 3.0.
+ */
+static const int kMaxInstancesPerUBO = 120;
+
+/*
+ Uniform buffer object structure format through which per-instance transforms are
+ batched into the vertex shader. Should match the layout specified in
+ instanced_transforms_vsh.glsl.
+ */
+typedef struct {
+    float model_matrix[kMaxInstancesPerUBO * 16];
+    float normal_matrix[kMaxInstancesPerUBO * 16];
+} VROInstancedTransformsUBOData;
+
+/*
+ VROInstancedTransformUBO batches the world and normal transforms of a set of nodes
+ that share a geometry and material, so their geometry can be rendered with one
+ instanced draw per kMaxInstancesPerUBO nodes. Used by automatic instancing (see
+ VROPortal::renderContents). A single UBO is shared by all geometries, through
+ VRODriverOpenGL.
+ */
+class VROInstancedTransformUBO : public VROInstancedUBO {
+public:
+    
+    VROInstancedTransformUBO(std::shared_ptr<VRODriver> driver);
+    virtual ~VROInstancedTransformUBO();
+    
+    /*
+     The shader modifier that replaces the model matrix and normal transform with
+     those of the current instance. Shared by all materials, so that every
+     instanced shader uses the same modifier key.
+     */
+    std::vector<std::shared_ptr<VROShaderModifier>> createInstanceShaderModifier();
+    static std::vector<std::shared_ptr<VROShaderModifier>> getInstanceShaderModifiers();
+    
+    /*
+     Materials whose diffuse texture is packed into a texture array or onto an
+     atlas page can batch with materials using other layers of that array or
+     regions of that page. The layer or region of each instance is carried in
+     the elements of its normal matrix that don't affect normals (its last row
+     and column), and read by these modifiers, which follow the instance
+     modifiers in instanced shaders of such materials.
+     */
+    static std::shared_ptr<VROShaderModifier> getInstanceLayerShaderModifier();
+    static std::shared_ptr<VROShaderModifier> getInstanceAtlasShaderModifier();
+    
+    /*
+     Write the layer or atlas region of the given diffuse texture into the given
+     instance normal matrix. No effect if the texture is not packed.
+     */
+    static void encodeDiffuseTexture(const VROTexture &texture, VROMatrix4f *normalMatrix);
+    
+    /*
+     Write the frame position at which the instance samples its geometry's baked
+     animation into the given instance normal matrix (see
+     VROBoneUBO::createBakedSkinningShaderModifier).
+     */
+    static void encodeBakedAnimationFrame(float frame, VROMatrix4f *normalMatrix);
+    
+    int getNumberOfDrawCalls();
+    int bindDrawData(int currentDrawCallIndex);
+    VROBoundingBox getInstancedBoundingBox();
+    
+    /*
+     Set the transforms for the next instanced render. Both vectors must be the
+     same size.
+     */
+    void update(const std::vector<VROMatrix4f> &transforms,
+                const std::vector<VROMatrix4f> &normalMatrices);
+    
+private:
+    
+    GLuint _transformsUBO;
+    std::weak_ptr<VRODriver> _driver;
+    
+    /*
+     The transforms set by the last update.
+     */
+    std::vector<VROMatrix4f> _transforms;
+    std::vector<VROMatrix4f> _normalMatrices;
+    
+};
+
+#endif /* VROInstancedTransformUBO_h */
@@ -0,0 +1,91 @@
+//
+//  VROInstancingTest.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROInstancingTest.h"
+#include "VROTestUtil.h"
+
+static const int kInstancingGridSize = 32;
+static const int kInstancingGridLayers = 2;
+static const float kInstancingSpacing = 1.5;
+
+VROInstancingTest::VROInstancingTest() :
+    VRORendererTest(VRORendererTestType::Instancing) {
+        
+}
+
+VROInstancingTest::~VROInstancingTest() {
+    
+}
+
+void VROInstancingTest::build(std::shared_ptr<VRORenderer> renderer,
+                              std::shared_ptr<VROFrameSynchronizer> frameSynchronizer,
+                              std::shared_ptr<VRODriver> driver) {
+    _sceneController = std::make_shared<VROSceneController>();
+    std::shared_ptr<VROScene> scene = _sceneController->getScene();
+    
+    std::shared_ptr<VROPortal> rootNode = scene->getRootNode();
+    rootNode->setPosition({0, 0, 0});
+    
+    std::shared_ptr<VROLight> ambient = std::make_shared<VROLight>(VROLightType::Ambient);
+    ambient->setColor({ 0.4, 0.4, 0.4 });
+    rootNode->addLight(ambient);
+    
+    std::shared_ptr<VROLight> directional = std::make_shared<VROLight>(VROLightType::Directional);
+    directional->setColor({ 1.0, 1.0, 1.0 });
+    directional->setDirection({ 0.3, -1.0, -0.5 });
+    rootNode->addLight(directional);
+    
+    std::shared_ptr<VROBox> box = VROBox::createBox(1, 1, 1);
+    box->setName("Instanced Box");
+    
+    std::shared_ptr<VROMaterial> material = box->getMaterials()[0];
+    material->setLightingModel(VROLightingModel::Blinn);
+    material->getDiffuse().setTexture(VROTestUtil::loadDiffuseTexture("boba.png"));
+    
+    /*
+     Centered grid in front of the camera; each layer is offset in depth.
+     */
+    float offset = (kInstancingGridSize - 1) * kInstancingSpacing / 2.0;
+    for (int layer = 0; layer < kInstancingGridLayers; layer++) {
+        for (int x = 0; x < kInstancingGridSize; x++) {
+            for (int y = 0; y < kInstancingGridSize; y++) {
+                std::shared_ptr<VRONode> boxNode = std::make_shared<VRONode>();
+                boxNode->setGeometry(box);
+                boxNode->setPosition({ x * kInstancingSpacing - offset,
+                                       y * kInstancingSpacing - offset,
+                                       -20.0f - layer * kInstancingSpacing * 2 });
+                boxNode->setRotationEuler({ 0, (float) (x + y) * 0.1f, 0 });
+                rootNode->addChildNode(boxNode);
+            }
+        }
+    }
+    
+    std::shared_ptr<VRONodeCamera> camera = std::make_shared<VRONodeCamera>();
+    std::shared_ptr<VRONode> cameraNode = std::make_shared<VRONode>();
+    cameraNode->setCamera(camera);
+    rootNode->addChildNode(cameraNode);
+    
+    _pointOfView = cameraNode;
+}
@@ -0,0 +1,294 @@
+//
+//  VROIntersectionKernels.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROIntersectionKernels.h"
+#include "VROTriangle.h"
+#include <math.h>
+#include <string.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define VRO_INTERSECTION_NEON 1
+#elif defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64)
+#include <xmmintrin.h>
+#define VRO_INTERSECTION_SSE 1
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#define VRO_INTERSECTION_WASM_SIMD 1
+#endif
+
+/*
+ Ray direction components smaller than this are clamped before taking their
+ reciprocal. This keeps the slab distances finite (and never NaN, which an
+ infinite reciprocal times a zero offset would produce), so the box kernel
+ needs no special cases for axis-aligned rays.
+ */
+static const float kMinRayComponent = 1e-20f;
+
+#pragma mark - Four-wide Operations
+
+#if VRO_INTERSECTION_NEON
+
+typedef float32x4_t VROFloat4;
+typedef uint32x4_t VROMask4;
+
+static inline VROFloat4 VROLoad4(const float *p)                  { return vld1q_f32(p); }
+static inline VROFloat4 VROSplat4(float f)                        { return vdupq_n_f32(f); }
+static inline void VROStore4(float *p, VROFloat4 a)               { vst1q_f32(p, a); }
+static inline VROFloat4 VROAdd4(VROFloat4 a, VROFloat4 b)         { return vaddq_f32(a, b); }
+static inline VROFloat4 VROSub4(VROFloat4 a, VROFloat4 b)         { return vsubq_f32(a, b); }
+static inline VROFloat4 VROMul4(VROFloat4 a, VROFloat4 b)         { return vmulq_f32(a, b); }
+static inline VROFloat4 VROMin4(VROFloat4 a, VROFloat4 b)         { return vminq_f32(a, b); }
+static inline VROFloat4 VROMax4(VROFloat4 a, VROFloat4 b)         { return vmaxq_f32(a, b); }
+static inline VROMask4 VROGreaterEqual4(VROFloat4 a, VROFloat4 b) { return vcgeq_f32(a, b); }
+static inline VROMask4 VROLessEqual4(VROFloat4 a, VROFloat4 b)    { return vcleq_f32(a, b); }
+static inline VROMask4 VRONotEqual4(VROFloat4 a, VROFloat4 b)     { return vmvnq_u32(vceqq_f32(a, b)); }
+static inline VROMask4 VROAnd4(VROMask4 a, VROMask4 b)            { return vandq_u32(a, b); }
+static inline VROFloat4 VROSelect4(VROMask4 m, VROFloat4 a, VROFloat4 b) { return vbslq_f32(m, a, b); }
+static inline int VROMoveMask4(VROMask4 m) {
+    uint32_t lanes[4];
+    vst1q_u32(lanes, m);
+    return (lanes[0] & 1) | (lanes[1] & 2) | (lanes[2] & 4) | (lanes[3] & 8);
+}
+
+#elif VRO_INTERSECTION_SSE
+
+typedef __m128 VROFloat4;
+typedef __m128 VROMask4;
+
+static inline VROFloat4 VROLoad4(const float *p)                  { return _mm_loadu_ps(p); }
+static inline VROFloat4 VROSplat4(float f)                        { return _mm_set1_ps(f); }
+static inline void VROStore4(float *p, VROFloat4 a)               { _mm_storeu_ps(p, a); }
+static inline VROFloat4 VROAdd4(VROFloat4 a, VROFloat4 b)         { return _mm_add_ps(a, b); }
+static inline VROFloat4 VROSub4(VROFloat4 a, VROFloat4 b)         { return _mm_sub_ps(a, b); }
+static inline VROFloat4 VROMul4(VROFloat4 a, VROFloat4 b)         { return _mm_mul_ps(a, b); }
+static inline VROFloat4 VROMin4(VROFloat4 a, VROFloat4 b)         { return _mm_min_ps(a, b); }
+static inline VROFloat4 VROMax4(VROFloat4 a, VROFloat4 b)         { return _mm_max_ps(a, b); }
+static inline VROMask4 VROGreaterEqual4(VROFloat4 a, VROFloat4 b) { return _mm_cmpge_ps(a, b); }
+static inline VROMask4 VROLessEqual4(VROFloat4 a, VROFloat4 b)    { return _mm_cmple_ps(a, b); }
+static inline VROMask4 VRONotEqual4(VROFloat4 a, VROFloat4 b)     { return _mm_cmpneq_ps(a, b); }
+static inline VROMask4 VROAnd4(VROMask4 a, VROMask4 b)            { return _mm_and_ps(a, b); }
+static inline VROFloat4 VROSelect4(VROMask4 m, VROFloat4 a, VROFloat4 b) {
+    return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+}
+static inline int VROMoveMask4(VROMask4 m) { return _mm_movemask_ps(m); }
+
+#elif VRO_INTERSECTION_WASM_SIMD
+
+// WebAssembly SIMD128 (-msimd128). The pseudo-min/max match the SSE semantics
+// and lower to single instructions on x86 hosts
+typedef v128_t VROFloat4;
+typedef v128_t VROMask4;
+
+static inline VROFloat4 VROLoad4(const float *p)                  { return wasm_v128_load(p); }
+static inline VROFloat4 VROSplat4(float f)                        { return wasm_f32x4_splat(f); }
+static inline void VROStore4(float *p, VROFloat4 a)               { wasm_v128_store(p, a); }
+static inline VROFloat4 VROAdd4(VROFloat4 a, VROFloat4 b)         { return wasm_f32x4_add(a, b); }
+static inline VROFloat4 VROSub4(VROFloat4 a, VROFloat4 b)         { return wasm_f32x4_sub(a, b); }
+static inline VROFloat4 VROMul4(VROFloat4 a, VROFloat4 b)         { return wasm_f32x4_mul(a, b); }
+static inline VROFloat4 VROMin4(VROFloat4 a, VROFloat4 b)         { return wasm_f32x4_pmin(a, b); }
+static inline VROFloat4 VROMax4(VROFloat4 a, VROFloat4 b)         { return wasm_f32x4_pmax(a, b); }
+static inline VROMask4 VROGreaterEqual4(VROFloat4 a, VROFloat4 b) { return wasm_f32x4_ge(a, b); }
+static inline VROMask4 VROLessEqual4(VROFloat4 a, VROFloat4 b)    { return wasm_f32x4_le(a, b); }
+static inline VROMask4 VRONotEqual4(VROFloat4 a, VROFloat4 b)     { return wasm_f32x4_ne(a, b); }
+static inline VROMask4 VROAnd4(VROMask4 a, VROMask4 b)            { return wasm_v128_and(a, b); }
+static inline VROFloat4 VROSelect4(VROMask4 m, VROFloat4 a, VROFloat4 b) { return wasm_v128_bitselect(a, b, m); }
+static inline int VROMoveMask4(VROMask4 m) { return (int) wasm_i32x4_bitmask(m); }
+
+#else
+
+// Scalar fallback: plain loops over the lanes, which compilers are free to
+// auto-vectorize
+struct VROFloat4 { float v[4]; };
+struct VROMask4  { bool v[4]; };
+
+#define VRO_LANEWISE(type, expr) type r; for (int i = 0; i < 4; i++) { r.v[i] = (expr); } return r;
+
+static inline VROFloat4 VROLoad4(const float *p)                  { VRO_LANEWISE(VROFloat4, p[i]) }
+static inline VROFloat4 VROSplat4(float f)                        { VRO_LANEWISE(VROFloat4, f) }
+static inline void VROStore4(float *p, VROFloat4 a)               { memcpy(p, a.v, sizeof(a.v)); }
+static inline VROFloat4 VROAdd4(VROFloat4 a, VROFloat4 b)         { VRO_LANEWISE(VROFloat4, a.v[i] + b.v[i]) }
+static inline VROFloat4 VROSub4(VROFloat4 a, VROFloat4 b)         { VRO_LANEWISE(VROFloat4, a.v[i] - b.v[i]) }
+static inline VROFloat4 VROMul4(VROFloat4 a, VROFloat4 b)         { VRO_LANEWISE(VROFloat4, a.v[i] * b.v[i]) }
+static inline VROFloat4 VROMin4(VROFloat4 a, VROFloat4 b)         { VRO_LANEWISE(VROFloat4, a.v[i] < b.v[i] ? a.v[i] : b.v[i]) }
+static inline VROFloat4 VROMax4(VROFloat4 a, VROFloat4 b)         { VRO_LANEWISE(VROFloat4, a.v[i] > b.v[i] ? a.v[i] : b.v[i]) }
+static inline VROMask4 VROGreaterEqual4(VROFloat4 a, VROFloat4 b) { VRO_LANEWISE(VROMask4, a.v[i] >= b.v[i]) }
+static inline VROMask4 VROLessEqual4(VROFloat4 a, VROFloat4 b)    { VRO_LANEWISE(VROMask4, a.v[i] <= b.v[i]) }
+static inline VROMask4 VRONotEqual4(VROFloat4 a, VROFloat4 b)     { VRO_LANEWISE(VROMask4, a.v[i] != b.v[i]) }
+static inline VROMask4 VROAnd4(VROMask4 a, VROMask4 b)            { VRO_LANEWISE(VROMask4, a.v[i] && b.v[i]) }
+static inline VROFloat4 VROSelect4(VROMask4 m, VROFloat4 a, VROFloat4 b) { VRO_LANEWISE(VROFloat4, m.v[i] ? a.v[i] : b.v[i]) }
+static inline int VROMoveMask4(VROMask4 m) {
+    return (m.v[0] ? 1 : 0) | (m.v[1] ? 2 : 0) | (m.v[2] ? 4 : 0) | (m.v[3] ? 8 : 0);
+}
+
+#undef VRO_LANEWISE
+
+#endif
+
+#pragma mark - Packing
+
+static float VROClampedInverse(float c) {
+    if (fabsf(c) < kMinRayComponent) {
+        c = (c < 0) ? -kMinRayComponent : kMinRayComponent;
+    }
+    return 1.0f / c;
+}
+
+VROPacketRay::VROPacketRay(VROVector3f origin, VROVector3f direction) :
+    origin(origin),
+    direction(direction),
+    inverseDirection(VROClampedInverse(direction.x), VROClampedInverse(direction.y), VROClampedInverse(direction.z)) {
+    
+}
+
+void VROPackTriangles(const VROTriangle *triangles, int count, VROTrianglePacket *outPacket) {
+    memset(outPacket, 0, sizeof(VROTrianglePacket));
+    for (int i = 0; i < count && i < kIntersectionPacketWidth; i++) {
+        const VROTriangle &triangle = triangles[i];
+        VROVector3f a = triangle.getA();
+        VROVector3f e1 = triangle.getB() - a;
+        VROVector3f e2 = triangle.getC() - a;
+        
+        outPacket->ax[i] = a.x;
+        outPacket->ay[i] = a.y;
+        outPacket->az[i] = a.z;
+        outPacket->e1x[i] = e1.x;
+        outPacket->e1y[i] = e1.y;
+        outPacket->e1z[i] = e1.z;
+        outPacket->e2x[i] = e2.x;
+        outPacket->e2y[i] = e2.y;
+        outPacket->e2z[i] = e2.z;
+    }
+}
+
+void VROClearBoxPacket(VROBoxPacket *packet) {
+    memset(packet, 0, sizeof(VROBoxPacket));
+}
+
+void VROSetBoxPacketLane(VROBoxPacket *packet, int lane, const float min[3], const float max[3]) {
+    packet->minX[lane] = min[0];
+    packet->minY[lane] = min[1];
+    packet->minZ[lane] = min[2];
+    packet->maxX[lane] = max[0];
+    packet->maxY[lane] = max[1];
+    packet->maxZ[lane] = max[2];
+    packet->validLanes |= (1 << lane);
+}
+
+#pragma mark - Kernels
+
+int VROIntersectRayTrianglePacket(const VROPacketRay &ray, const VROTrianglePacket &packet,
+                                  float tMax, float *outT) {
+    /*
+     Moller-Trumbore, evaluated without division: the barycentric coordinates
+     and the distance are left scaled by the determinant, and their signs
+     normalized so the determinant is positive. Only the hit lanes are divided
+     out, afterward.
+     */
+    VROFloat4 dx = VROSplat4(ray.direction.x);
+    VROFloat4 dy = VROSplat4(ray.direction.y);
+    VROFloat4 dz = VROSplat4(ray.direction.z);
+    
+    VROFloat4 e1x = VROLoad4(packet.e1x), e1y = VROLoad4(packet.e1y), e1z = VROLoad4(packet.e1z);
+    VROFloat4 e2x = VROLoad4(packet.e2x), e2y = VROLoad4(packet.e2y), e2z = VROLoad4(packet.e2z);
+    
+    // p = d x e2, det = e1 . p
+    VROFloat4 px = VROSub4(VROMul4(dy, e2z), VROMul4(dz, e2y));
+    VROFloat4 py = VROSub4(VROMul4(dz, e2x), VROMul4(dx, e2z));
+    VROFloat4 pz = VROSub4(VROMul4(dx, e2y), VROMul4(dy, e2x));
+    VROFloat4 det = VROAdd4(VROAdd4(VROMul4(e1x, px), VROMul4(e1y, py)), VROMul4(e1z, pz));
+    
+    // s = origin - a, u = s . p
+    VROFloat4 sx = VROSub4(VROSplat4(ray.origin.x), VROLoad4(packet.ax));
+    VROFloat4 sy = VROSub4(VROSplat4(ray.origin.y), VROLoad4(packet.ay));
+    VROFloat4 sz = VROSub4(VROSplat4(ray.origin.z), VROLoad4(packet.az));
+    VROFloat4 u = VROAdd4(VROAdd4(VROMul4(sx, px), VROMul4(sy, py)), VROMul4(sz, pz));
+    
+    // q = s x e1, v = d . q, t = e2 . q
+    VROFloat4 qx = VROSub4(VROMul4(sy, e1z), VROMul4(sz, e1y));
+    VROFloat4 qy = VROSub4(VROMul4(sz, e1x), VROMul4(sx, e1z));
+    VROFloat4 qz = VROSub4(VROMul4(sx, e1y), VROMul4(sy, e1x));
+    VROFloat4 v = VROAdd4(VROAdd4(VROMul4(dx, qx), VROMul4(dy, qy)), VROMul4(dz, qz));
+    VROFloat4 t = VROAdd4(VROAdd4(VROMul4(e2x, qx), VROMul4(e2y, qy)), VROMul4(e2z, qz));
+    
+    VROFloat4 zero = VROSplat4(0);
+    VROFloat4 sign = VROSelect4(VROGreaterEqual4(det, zero), VROSplat4(1), VROSplat4(-1));
+    det = VROMul4(det, sign);
+    u = VROMul4(u, sign);
+    v = VROMul4(v, sign);
+    t = VROMul4(t, sign);
+    
+    VROMask4 hit = VROAnd4(VRONotEqual4(det, zero), VROGreaterEqual4(u, zero));
+    hit = VROAnd4(hit, VROGreaterEqual4(v, zero));
+    hit = VROAnd4(hit, VROLessEqual4(VROAdd4(u, v), det));
+    hit = VROAnd4(hit, VROGreaterEqual4(t, zero));
+    hit = VROAnd4(hit, VROLessEqual4(t, VROMul4(VROSplat4(tMax), det)));
+    
+    int mask = VROMoveMask4(hit);
+    if (mask == 0) {
+        return -1;
+    }
+    
+    float scaledT[4], scale[4];
+    VROStore4(scaledT, t);
+    VROStore4(scale, det);
+    
+    int closest = -1;
+    float closestT = tMax;
+    for (int i = 0; i < kIntersectionPacketWidth; i++) {
+        if (mask & (1 << i)) {
+            float laneT = scaledT[i] / scale[i];
+            if (closest < 0 || laneT < closestT) {
+                closest = i;
+                closestT = laneT;
+            }
+        }
+    }
+    *outT = closestT;
+    return closest;
+}
+
+int VROIntersectRayBoxPacket(const VROPacketRay &ray, const VROBoxPacket &packet,
+                             float tMax, float outTNear[4]) {
+    VROFloat4 ox = VROSplat4(ray.origin.x), oy = VROSplat4(ray.origin.y), oz = VROSplat4(ray.origin.z);
+    VROFloat4 ix = VROSplat4(ray.inverseDirection.x);
+    VROFloat4 iy = VROSplat4(ray.inverseDirection.y);
+    VROFloat4 iz = VROSplat4(ray.inverseDirection.z);
+    
+    VROFloat4 t0x = VROMul4(VROSub4(VROLoad4(packet.minX), ox), ix);
+    VROFloat4 t1x = VROMul4(VROSub4(VROLoad4(packet.maxX), ox), ix);
+    VROFloat4 t0y = VROMul4(VROSub4(VROLoad4(packet.minY), oy), iy);
+    VROFloat4 t1y = VROMul4(VROSub4(VROLoad4(packet.maxY), oy), iy);
+    VROFloat4 t0z = VROMul4(VROSub4(VROLoad4(packet.minZ), oz), iz);
+    VROFloat4 t1z = VROMul4(VROSub4(VROLoad4(packet.maxZ), oz), iz);
+    
+    VROFloat4 tNear = VROMax4(VROMax4(VROMin4(t0x, t1x), VROMin4(t0y, t1y)),
+                              VROMax4(VROMin4(t0z, t1z), VROSplat4(0)));
+    VROFloat4 tFar  = VROMin4(VROMin4(VROMax4(t0x, t1x), VROMax4(t0y, t1y)),
+                              VROMin4(VROMax4(t0z, t1z), VROSplat4(tMax)));
+    
+    VROStore4(outTNear, tNear);
+    return VROMoveMask4(VROLessEqual4(tNear, tFar)) & packet.validLanes;
+}
@@ -0,0 +1,110 @@
+//
+//  VROIntersectionKernels.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROIntersectionKernels_h
+#define VROIntersectionKernels_h
+
+#include <stdint.h>
+#include "VROVector3f.h"
+
+class VROTriangle;
+
+/*
+ Ray intersection kernels that test four triangles or four boxes at a time.
+ Primitives are stored in structure-of-arrays packets so that each lane of a
+ NEON or SSE register holds one primitive; where neither is available the
+ kernels fall back to scalar loops over the lanes.
+ 
+ Rays are given as an origin and a direction that need not be normalized.
+ Distances along the ray are parametric, in units of the ray direction, so
+ the hit point for distance t is origin + ray * t. Callers are expected to
+ transform a single ray into the primitives' coordinate system rather than
+ transforming the primitives (see VROTriangleBVH).
+ */
+static const int kIntersectionPacketWidth = 4;
+
+/*
+ Four triangles, stored as one vertex and the two edges leaving it. Unused
+ lanes hold degenerate triangles, which never intersect.
+ */
+struct alignas(16) VROTrianglePacket {
+    float ax[4], ay[4], az[4];
+    float e1x[4], e1y[4], e1z[4];
+    float e2x[4], e2y[4], e2z[4];
+};
+
+/*
+ Four axis-aligned boxes. Only the lanes set in validLanes are tested.
+ */
+struct alignas(16) VROBoxPacket {
+    float minX[4], minY[4], minZ[4];
+    float maxX[4], maxY[4], maxZ[4];
+    int validLanes;
+};
+
+/*
+ A ray prepared for packet tests: the reciprocal direction is precomputed for
+ the box slab tests, with near-zero components clamped so that the slab
+ distances stay finite.
+ */
+struct VROPacketRay {
+    VROVector3f origin;
+    VROVector3f direction;
+    VROVector3f inverseDirection;
+    
+    VROPacketRay(VROVector3f origin, VROVector3f direction);
+};
+
+/*
+ Pack up to four triangles into the given packet. Lanes beyond count are
+ filled with degenerate triangles.
+ */
+void VROPackTriangles(const VROTriangle *triangles, int count, VROTrianglePacket *outPacket);
+
+/*
+ Empty the given box packet, or set one of its lanes (marking it valid).
+ */
+void VROClearBoxPacket(VROBoxPacket *packet);
+void VROSetBoxPacketLane(VROBoxPacket *packet, int lane, const float min[3], const float max[3]);
+
+/*
+ Find the closest intersection of the ray with the triangles in the packet
+ at a distance in [0, tMax]. Triangles are two-sided. Returns the lane of the
+ closest hit and stores its distance in outT, or returns -1 if there is no
+ hit.
+ */
+int VROIntersectRayTrianglePacket(const VROPacketRay &ray, const VROTrianglePacket &packet,
+                                  float tMax, float *outT);
+
+/*
+ Test the ray against the boxes in the packet, accepting boxes that it
+ enters at a distance no greater than tMax. Returns a bit mask of the lanes
+ hit, and stores the entry distance of each lane in outTNear (undefined for
+ lanes not hit).
+ */
+int VROIntersectRayBoxPacket(const VROPacketRay &ray, const VROBoxPacket &packet,
+                             float tMax, float outTNear[4]);
+
+#endif /* VROIntersectionKernels_h */
@@ -66,6 +66,12 @@ void VROIrradianceRenderPass::render(std::shared_ptr<VROScene> scene,
                                      std::shared_ptr<VROScene> outgoingScene,
                                      VRORenderPassInputOutput &inputs,
                                      VRORenderContext *context, std::shared_ptr<VRODriver> &driver) {
+    for (int slice = 0; slice < getNumSlices(); slice++) {
+        renderSlice(slice, inputs, driver);
+    }
+}
+
+void VROIrradianceRenderPass::renderSlice(int slice, VRORenderPassInputOutput &inputs, std::shared_ptr<VRODriver> &driver) {
     if (!_shader) {
         init(driver);
     }
@@ -74,8 +80,12 @@ void VROIrradianceRenderPass::render(std::shared_ptr<VROScene> scene,
     // Bind the HDR texture to texture unit 0
     VRORenderUtil::bindTexture(0, inputs.textures[kIrradianceLightingEnvironmentInput], driver);
     
-    // Bind the destination render target
-    driver->bindRenderTarget(_irradianceRenderTarget, VRORenderTargetUnbindOp::Invalidate);
+    int face = slice;
+    
+    // Attach the face before binding the target, so that the bind only discards the
+    // face being rendered (the others may have been rendered by earlier slices)
+    _irradianceRenderTarget->setTextureCubeFace(face, 0, 0);
+    driver->bindRenderTarget(_irradianceRenderTarget, VRORenderTargetActions::overwrite(), VRORenderTargetUnbindOp::Invalidate);
     
     // Setup for rendering the cube
     VRORenderUtil::prepareForBlit(driver, true, false);
@@ -97,17 +107,25 @@ void VROIrradianceRenderPass::render(std::shared_ptr<VROScene> scene,
     };
     
     _shader->getUniform("projection_matrix")->setMat4(captureProjection);
+    _shader->getUniform("view_matrix")->setMat4(captureViews[face]);
+    
+    GL( glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT) );
+    VRORenderUtil::renderUnitCube(&_cubeVAO, &_cubeVBO, driver);
     
-    for (int i = 0; i < 6; ++i) {
-        _shader->getUniform("view_matrix")->setMat4(captureViews[i]);
-        _irradianceRenderTarget->setTextureCubeFace(i, 0, 0);
-        GL( glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT) );
-        VRORenderUtil::renderUnitCube(&_cubeVAO, &_cubeVBO);
-    }
     driver->unbindShader();
     pglpop();
     inputs.outputTarget = _irradianceRenderTarget;
 }
 
+int VROIrradianceRenderPass::getNumSlices() const {
+    return 6;
+}
+
+void VROIrradianceRenderPass::beginNewOutput() {
+    if (_irradianceRenderTarget) {
+        _irradianceRenderTarget->attachNewTextures();
+    }
+}
+
 
 
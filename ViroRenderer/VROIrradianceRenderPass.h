@@ -49,6 +49,20 @@ public:
                 std::shared_ptr<VROScene> outgoingScene,
                 VRORenderPassInputOutput &inputs,
                 VRORenderContext *context, std::shared_ptr<VRODriver> &driver);
+    
+    /*
+     Render a single slice (one face) of the cubemap. Slices may be rendered on
+     separate frames, so that the work can be time-sliced; render() renders all of
+     them at once.
+     */
+    void renderSlice(int slice, VRORenderPassInputOutput &inputs, std::shared_ptr<VRODriver> &driver);
+    int getNumSlices() const;
+    
+    /*
+     Render subsequent slices to a new cubemap texture, so that the texture of the
+     last render remains intact for those still using it.
+     */
+    void beginNewOutput();
         
 private:
    
@@ -0,0 +1,240 @@
+//
+//  VROJobSystem.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROJobSystem.h"
+#include "VROLog.h"
+#include <algorithm>
+
+// Upper bound on the number of worker threads, regardless of core count
+static const int kMaxJobWorkers = 7;
+
+#if VRO_THREADS
+// The job system and queue index of the current thread, if it is a worker
+static thread_local VROJobSystem *tWorkerJobSystem = nullptr;
+static thread_local int tWorkerIndex = -1;
+#endif
+
+struct VROJob {
+    std::function<void()> function;
+    VROJobCounter *counter;
+};
+
+class VROJobQueue {
+public:
+    std::mutex mutex;
+    std::deque<VROJob> jobs;
+};
+
+static int VROJobSystemDefaultWorkerCount() {
+#if !VRO_THREADS
+    return 0;
+#else
+    int hardwareThreads = (int) std::thread::hardware_concurrency();
+    return std::max(0, std::min(kMaxJobWorkers, hardwareThreads - 1));
+#endif
+}
+
+VROJobSystem::VROJobSystem() :
+    VROJobSystem(VROJobSystemDefaultWorkerCount()) {
+
+}
+
+VROJobSystem::VROJobSystem(int numWorkers) :
+    _nextQueue(0),
+    _numQueuedJobs(0),
+    _shutdown(false) {
+
+#if !VRO_THREADS
+    numWorkers = 0;
+#endif
+    for (int i = 0; i < numWorkers; i++) {
+        _queues.emplace_back(new VROJobQueue());
+    }
+#if VRO_THREADS
+    for (int i = 0; i < numWorkers; i++) {
+        _workers.emplace_back(&VROJobSystem::workerLoop, this, i);
+    }
+#endif
+    pinfo("Job system initialized with %d workers", numWorkers);
+}
+
+std::shared_ptr<VROJobSystem> VROJobSystem::getShared() {
+    static std::shared_ptr<VROJobSystem> sShared = std::make_shared<VROJobSystem>();
+    return sShared;
+}
+
+VROJobSystem::~VROJobSystem() {
+#if VRO_THREADS
+    {
+        std::lock_guard<std::mutex> lock(_idleMutex);
+        _shutdown = true;
+    }
+    _idleCondition.notify_all();
+    for (std::thread &worker : _workers) {
+        worker.join();
+    }
+#endif
+}
+
+void VROJobSystem::run(std::function<void()> job, VROJobCounter &counter) {
+    if (_queues.empty()) {
+        job();
+        return;
+    }
+    counter._pending++;
+
+    // Workers push onto their own queue (keeping nested jobs local), external
+    // threads distribute jobs round-robin across all queues
+    int index;
+#if VRO_THREADS
+    if (tWorkerJobSystem == this) {
+        index = tWorkerIndex;
+    }
+    else
+#endif
+    {
+        index = (int) (_nextQueue++ % _queues.size());
+    }
+
+    VROJobQueue *queue = _queues[index].get();
+    {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->jobs.push_back({ std::move(job), &counter });
+    }
+    {
+        std::lock_guard<std::mutex> lock(_idleMutex);
+        _numQueuedJobs++;
+    }
+    _idleCondition.notify_one();
+}
+
+void VROJobSystem::wait(VROJobCounter &counter) {
+#if VRO_THREADS
+    int index = (tWorkerJobSystem == this) ? tWorkerIndex : -1;
+    while (!counter.isComplete()) {
+        std::function<void()> job;
+        VROJobCounter *jobCounter;
+        if (findJob(index, &job, &jobCounter)) {
+            execute(job, jobCounter);
+        }
+        else {
+            // The remaining jobs are in flight on other threads
+            std::this_thread::yield();
+        }
+    }
+#endif
+}
+
+void VROJobSystem::parallelFor(int begin, int end, int batchSize, std::function<void(int)> fn) {
+    if (end <= begin) {
+        return;
+    }
+    batchSize = std::max(1, batchSize);
+    if (_queues.empty() || end - begin <= batchSize) {
+        for (int i = begin; i < end; i++) {
+            fn(i);
+        }
+        return;
+    }
+
+    VROJobCounter counter;
+    for (int batchStart = begin; batchStart < end; batchStart += batchSize) {
+        int batchEnd = std::min(end, batchStart + batchSize);
+        run([&fn, batchStart, batchEnd] {
+            for (int i = batchStart; i < batchEnd; i++) {
+                fn(i);
+            }
+        }, counter);
+    }
+    wait(counter);
+}
+
+bool VROJobSystem::findJob(int index, std::function<void()> *outJob, VROJobCounter **outCounter) {
+    int numQueues = (int) _queues.size();
+
+    // First check our own queue, LIFO so that nested jobs stay cache-warm
+    if (index >= 0) {
+        VROJobQueue *queue = _queues[index].get();
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        if (!queue->jobs.empty()) {
+            VROJob &job = queue->jobs.back();
+            *outJob = std::move(job.function);
+            *outCounter = job.counter;
+            queue->jobs.pop_back();
+            _numQueuedJobs--;
+            return true;
+        }
+    }
+
+    // Then steal the oldest job from the other queues
+    int start = std::max(index, 0);
+    for (int i = 0; i < numQueues; i++) {
+        int victim = (start + i) % numQueues;
+        if (victim == index) {
+            continue;
+        }
+
+        VROJobQueue *queue = _queues[victim].get();
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        if (!queue->jobs.empty()) {
+            VROJob &job = queue->jobs.front();
+            *outJob = std::move(job.function);
+            *outCounter = job.counter;
+            queue->jobs.pop_front();
+            _numQueuedJobs--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void VROJobSystem::execute(std::function<void()> &job, VROJobCounter *counter) {
+    job();
+    counter->_pending--;
+}
+
+void VROJobSystem::workerLoop(int index) {
+#if VRO_THREADS
+    tWorkerJobSystem = this;
+    tWorkerIndex = index;
+
+    while (true) {
+        std::function<void()> job;
+        VROJobCounter *counter;
+        if (findJob(index, &job, &counter)) {
+            execute(job, counter);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(_idleMutex);
+        _idleCondition.wait(lock, [this] {
+            return _shutdown || _numQueuedJobs > 0;
+        });
+        if (_shutdown) {
+            break;
+        }
+    }
+#endif
+}
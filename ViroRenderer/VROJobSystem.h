@@ -0,0 +1,167 @@
+//
+//  VROJobSystem.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROJobSystem_h
+#define VROJobSystem_h
+
+#include <stdio.h>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include "VROAtomic.h"
+#include "VRODefines.h"
+
+#if VRO_THREADS
+#include <thread>
+#endif
+
+class VROJobQueue;
+
+/*
+ Tracks the completion of a batch of jobs submitted to a VROJobSystem.
+ Every job added with a given VROJobCounter increments it, and every
+ job that finishes decrements it. VROJobSystem::wait() blocks until the
+ counter drops back to zero.
+ */
+class VROJobCounter {
+public:
+    VROJobCounter() : _pending(0) {}
+
+    bool isComplete() const {
+        return _pending == 0;
+    }
+
+private:
+    friend class VROJobSystem;
+    VROAtomic<int> _pending;
+};
+
+/*
+ Fixed-size pool of worker threads that executes short, CPU-bound jobs
+ (for example, the per-subtree passes of the scene update). Each worker owns
+ a queue: workers pop jobs from the back of their own queue, and steal from
+ the front of other workers' queues when theirs runs dry.
+
+ Jobs are joined with wait(), during which the waiting thread executes jobs
+ itself rather than sleeping, so jobs may safely submit and wait on nested
+ jobs. Jobs must not touch the GPU or perform blocking I/O.
+
+ On platforms without threads (WebAssembly built without pthreads), or when
+ constructed with zero workers, jobs run inline on the submitting thread.
+ */
+class VROJobSystem {
+
+public:
+
+    /*
+     Create a job system with the given number of worker threads. The
+     default uses one worker per hardware thread, minus one for the
+     rendering thread (which participates in wait()).
+     */
+    VROJobSystem();
+    VROJobSystem(int numWorkers);
+    virtual ~VROJobSystem();
+
+    /*
+     The process-wide job system for background work, such as decoding,
+     parsing, and processing assets as they load. Modules share it rather
+     than creating their own workers, so that concurrent loads do not
+     oversubscribe the CPU. The renderer's scene update uses its own job
+     system, so that frames never wait behind (or, while waiting, execute)
+     long-running load jobs.
+     */
+    static std::shared_ptr<VROJobSystem> getShared();
+
+    /*
+     Number of worker threads. If zero, all jobs run inline.
+     */
+    int getNumWorkers() const {
+        return (int) _queues.size();
+    }
+
+    /*
+     The number of threads that can concurrently execute jobs: the
+     workers plus the thread that waits on them.
+     */
+    int getConcurrency() const {
+        return getNumWorkers() + 1;
+    }
+
+    /*
+     Submit a job, associating it with the given counter.
+     */
+    void run(std::function<void()> job, VROJobCounter &counter);
+
+    /*
+     Block until all jobs associated with the given counter have completed.
+     The calling thread executes queued jobs while it waits.
+     */
+    void wait(VROJobCounter &counter);
+
+    /*
+     Convenience function that invokes fn(i) for each i in [begin, end),
+     splitting the range into batches of at most batchSize, and waits for
+     all invocations to complete.
+     */
+    void parallelFor(int begin, int end, int batchSize, std::function<void(int)> fn);
+
+private:
+
+    std::vector<std::unique_ptr<VROJobQueue>> _queues;
+
+#if VRO_THREADS
+    std::vector<std::thread> _workers;
+#endif
+
+    /*
+     Round-robin index used to distribute jobs submitted from threads
+     that are not workers of this job system.
+     */
+    VROAtomic<unsigned int> _nextQueue;
+
+    /*
+     Idle workers sleep on this condition variable; _numQueuedJobs is
+     the number of jobs waiting in all queues.
+     */
+    std::mutex _idleMutex;
+    std::condition_variable _idleCondition;
+    VROAtomic<int> _numQueuedJobs;
+    bool _shutdown;
+
+    void workerLoop(int index);
+
+    /*
+     Pop a job from the given worker's queue, or steal one from another
+     worker. Pass -1 to only steal. Returns false if there is no work.
+     */
+    bool findJob(int index, std::function<void()> *outJob, VROJobCounter **outCounter);
+    void execute(std::function<void()> &job, VROJobCounter *counter);
+
+};
+
+#endif /* VROJobSystem_h */
@@ -99,6 +99,7 @@ void VROKeyframeAnimation::execute(std::shared_ptr<VRONode> node, std::function<
     }
     
     VROTransaction::begin();
+    VROTransaction::setAnimationLODNode(node);
     VROTransaction::setAnimationDuration(_duration);
     VROTransaction::setAnimationTimeOffset(_timeOffset);
     VROTransaction::setAnimationSpeed(_speed);
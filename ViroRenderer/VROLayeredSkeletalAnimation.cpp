@@ -36,18 +36,44 @@
 #include "VROAnimationChain.h"
 #include "VROExecutableNodeAnimation.h"
 #include "VROSkeletalAnimationLayer.h"
+#include "VROMath.h"
+#include "VROQuaternion.h"
 #include <sstream>
 #include <map>
 
 static const float kBlendEpsilon = 0.02;
 
+/*
+ A layer's transform of a bone, and its normalized weight, to be blended.
+ */
+struct VROBoneBlendInput {
+    const VROMatrix4f *transform;
+    float weight;
+    VROQuaternion rotation;
+    VROVector3f translation;
+};
+
+/*
+ The blend in progress of a single bone. If the bone's transform so far is taken
+ from a single layer unchanged, unblendedInput is the index of that layer's input.
+ */
+struct VROBoneBlend {
+    int boneIndex;
+    int firstInput;
+    int numInputs;
+    VROQuaternion rotation;
+    VROVector3f translation;
+    float weight;
+    int unblendedInput;
+};
+
 void VROSkeletalAnimationLayerInternal::buildKeyframes() {
     // If the keyframes are already built, nothing to do here
     if (boneKeyTimes.size() > 0) {
         return;
     }
     for (const std::unique_ptr<VROSkeletalAnimationFrame> &frame : animation->getFrames()) {
-        passert (frame->boneIndices.size() == frame->boneTransforms.size());
+        passert (frame->boneIndices.size() == frame->localBoneTransforms.size());
         
         for (int f = 0; f < frame->boneIndices.size(); f++) {
             int boneIndex = frame->boneIndices[f];
@@ -172,33 +198,152 @@ std::shared_ptr<VROExecutableAnimation> VROLayeredSkeletalAnimation::copy() {
 
 void VROLayeredSkeletalAnimation::blendFrame(int f) {
     const std::vector<std::unique_ptr<VROSkeletalAnimationFrame>> &masterFrames = _layers[0]->animation->getFrames();
-    std::vector<std::pair<VROMatrix4f, float>> boneTransformsToBlend;
-
-    for (int b = 0; b < masterFrames[f]->boneIndices.size(); b++) {
-        int boneIndex = masterFrames[f]->boneIndices[b];
-        
-        // Collect all layers that have a non-zero weight on this bone
-        VROMatrix4f boneIdentityTransform = _skinner->getSkeleton()->getBone(boneIndex)->getLocalTransform();
+    const std::vector<int> &boneIndices = masterFrames[f]->boneIndices;
+    
+    /*
+     Collect, for each bone, the layers that have a non-zero weight on it. Bones
+     influenced by fewer than two layers need no blending.
+     */
+    std::vector<VROBoneBlendInput> inputs;
+    std::vector<VROBoneBlend> blends;
+    int maxInputs = 0;
+    
+    for (int b = 0; b < boneIndices.size(); b++) {
+        int boneIndex = boneIndices[b];
+        VROBoneBlend blend;
+        blend.boneIndex = boneIndex;
+        blend.firstInput = (int) inputs.size();
         
+        float totalWeight = 0;
         for (int i = 0; i < _layers.size(); i++) {
             std::shared_ptr<VROSkeletalAnimationLayerInternal> &layer = _layers[i];
             float weight = layer->getBoneWeight(boneIndex);
             if (weight > 0) {
                 auto boneLocalTransform = layer->boneLocalTransforms.find(boneIndex);
                 if (boneLocalTransform != layer->boneLocalTransforms.end() && f < boneLocalTransform->second.size()) {
-                    boneTransformsToBlend.push_back({ boneLocalTransform->second[f], weight });
+                    VROBoneBlendInput input;
+                    input.transform = &boneLocalTransform->second[f];
+                    input.weight = weight;
+                    inputs.push_back(input);
+                    totalWeight += weight;
                 }
             }
         }
+        blend.numInputs = (int) inputs.size() - blend.firstInput;
+        
+        if (blend.numInputs == 0) {
+            _boneTransforms[boneIndex][f] = _skinner->getSkeleton()->getBone(boneIndex)->getLocalTransform();
+            continue;
+        } else if (blend.numInputs == 1) {
+            _boneTransforms[boneIndex][f] = *inputs.back().transform;
+            inputs.pop_back();
+            continue;
+        }
+        
+        // Reweight the transforms so they add to one, and decompose them
+        for (int i = blend.firstInput; i < inputs.size(); i++) {
+            VROBoneBlendInput &input = inputs[i];
+            input.weight /= totalWeight;
+            
+            VROVector3f scale = input.transform->extractScale();
+            input.rotation = input.transform->extractRotation(scale);
+            input.translation = input.transform->extractTranslation();
+        }
+        
+        const VROBoneBlendInput &first = inputs[blend.firstInput];
+        blend.rotation = first.rotation;
+        blend.translation = first.translation;
+        blend.weight = first.weight;
+        blend.unblendedInput = blend.firstInput;
+        
+        blends.push_back(blend);
+        maxInputs = std::max(maxInputs, blend.numInputs);
+    }
+    
+    /*
+     Blend the layers into each bone in order, one layer per step. Each step blends
+     the next layer into every bone it influences, slerping the rotations of all of
+     those bones in a single batch.
+     */
+    std::vector<int> slerpBlends;
+    std::vector<VROQuaternion> slerpFrom, slerpTo;
+    std::vector<float> slerpTimes;
+    
+    for (int step = 1; step < maxInputs; step++) {
+        slerpBlends.clear();
+        slerpFrom.clear();
+        slerpTo.clear();
+        slerpTimes.clear();
+        
+        for (int k = 0; k < blends.size(); k++) {
+            VROBoneBlend &blend = blends[k];
+            if (step >= blend.numInputs) {
+                continue;
+            }
+            
+            // Skip tranforms that are below a given weight
+            const VROBoneBlendInput &next = inputs[blend.firstInput + step];
+            if (next.weight < kBlendEpsilon) {
+                continue;
+            }
+            
+            // Reweight from the cumulative weight across all quaternions into a normalized
+            // weight between just the last quaternion and the new one
+            float twoValueBlendWeight = next.weight / (blend.weight + next.weight);
+            
+            // Optimization to avoid blending when values are extremely low or high
+            if (twoValueBlendWeight > (1 - kBlendEpsilon)) {
+                blend.rotation = next.rotation;
+                blend.translation = next.translation;
+                blend.unblendedInput = blend.firstInput + step;
+            } else if (twoValueBlendWeight > kBlendEpsilon) {
+                // Rotations are averaged by slerping, translation by interpolation
+                slerpBlends.push_back(k);
+                slerpFrom.push_back(blend.rotation);
+                slerpTo.push_back(next.rotation);
+                slerpTimes.push_back(twoValueBlendWeight);
+                
+                blend.translation = blend.translation.interpolate(next.translation, twoValueBlendWeight);
+                blend.unblendedInput = -1;
+            } // else don't bother blending next into the bone, its weight is too low to matter
+            
+            // Add the original weight of the latest transform to our total blend weight
+            // (note this is distinct from the weight we just used to perform the blend --
+            // that weight is just between the two quaternions, this weight is the weight
+            // amongst *all* quaternions)
+            blend.weight += next.weight;
+        }
         
-        if (boneTransformsToBlend.size() == 0) {
-            _boneTransforms[boneIndex][f] = boneIdentityTransform;
-        } else if (boneTransformsToBlend.size() == 1) {
-            _boneTransforms[boneIndex][f] = boneTransformsToBlend[0].first;
+        VROQuaternion::slerp(slerpFrom.data(), slerpTo.data(), slerpTimes.data(), (int) slerpFrom.size(),
+                             slerpFrom.data());
+        for (int i = 0; i < slerpBlends.size(); i++) {
+            blends[slerpBlends[i]].rotation = slerpFrom[i];
+        }
+    }
+    
+    /*
+     Bones whose blend was decided by a single layer keep that layer's transform;
+     blended bones are recomposed from their rotation and translation.
+     */
+    for (const VROBoneBlend &blend : blends) {
+        if (blend.unblendedInput >= 0) {
+            _boneTransforms[blend.boneIndex][f] = *inputs[blend.unblendedInput].transform;
         } else {
-            _boneTransforms[boneIndex][f] = blendBoneTransforms(boneIndex, boneTransformsToBlend);
+            VROMatrix4f blendedTransform = blend.rotation.getMatrix();
+            blendedTransform.translate(blend.translation);
+            _boneTransforms[blend.boneIndex][f] = blendedTransform;
         }
-        boneTransformsToBlend.clear();
+    }
+}
+
+void VROLayeredSkeletalAnimation::prepareFrame(float t) {
+    if (_frameTimes.empty()) {
+        return;
+    }
+    int frame = VROMathInterpolateKeyFrameIndex(t, _frameTimes, &_prepareCursor);
+    if (!_cached[frame]) {
+        blendFrame(frame);
+        _cached[frame] = true;
     }
 }
 
@@ -218,6 +363,7 @@ void VROLayeredSkeletalAnimation::preload() {
                 _boneKeyTimes[boneIndex].push_back(_layers[0]->boneKeyTimes[boneIndex][f]);
                 _boneTransforms[boneIndex].push_back(VROMatrix4f::identity());
             }
+            _frameTimes.push_back(masterFrames[f]->time);
             _cached.push_back(false);
         }
     }
@@ -231,6 +377,7 @@ void VROLayeredSkeletalAnimation::execute(std::shared_ptr<VRONode> node, std::fu
      Finally, begin the animation for each bone, all of which we be in a single transaction.
      */
     VROTransaction::begin();
+    VROTransaction::setAnimationLODNode(node);
     VROTransaction::setAnimationDuration(_duration);
     VROTransaction::setAnimationSpeed(_speed);
     VROTransaction::setAnimationTimeOffset(_timeOffset);
@@ -258,6 +405,18 @@ void VROLayeredSkeletalAnimation::execute(std::shared_ptr<VRONode> node, std::fu
     }
     
     std::weak_ptr<VROLayeredSkeletalAnimation> weakSelf = shared_from_this();
+    
+    /*
+     Blend each frame before the bones request it. This runs in parallel with the
+     blending of the other layered animations running this frame.
+     */
+    _prepareCursor = 0;
+    VROTransaction::setPrepareCallback([weakSelf](float t) {
+        std::shared_ptr<VROLayeredSkeletalAnimation> skeletal = weakSelf.lock();
+        if (skeletal) {
+            skeletal->prepareFrame(t);
+        }
+    });
     VROTransaction::setFinishCallback([weakSelf, onFinished](bool terminate) {
         std::shared_ptr<VROLayeredSkeletalAnimation> skeletal = weakSelf.lock();
         if (skeletal) {
@@ -272,77 +431,6 @@ void VROLayeredSkeletalAnimation::execute(std::shared_ptr<VRONode> node, std::fu
     _transaction = transaction;
 }
 
-VROMatrix4f VROLayeredSkeletalAnimation::blendBoneTransforms(int bone, const std::vector<std::pair<VROMatrix4f, float>> &transformsAndWeights) {
-    passert (transformsAndWeights.size() >= 2);
-    
-    /*
-     Reweight the transforms so they add to one.
-     */
-    std::vector<std::pair<VROMatrix4f, float>> reweighted;
-    float totalWeight = 0;
-    for (int i = 0; i < transformsAndWeights.size(); i++) {
-        totalWeight += transformsAndWeights[i].second;
-    }
-    for (int i = 0; i < transformsAndWeights.size(); i++) {
-        reweighted.push_back({ transformsAndWeights[i].first, transformsAndWeights[i].second / totalWeight });
-    }
-    
-    /*
-     Compute the blended transform.
-     */
-    VROMatrix4f blendedTransform = reweighted[0].first;
-    float blendedWeight = reweighted[0].second;
-    
-    for (int i = 1; i < reweighted.size(); i++) {
-        VROMatrix4f nextTransform = reweighted[i].first;
-        float nextWeight = reweighted[i].second;
-        
-        // Skip tranforms that are below a given weight
-        if (nextWeight < kBlendEpsilon) {
-            continue;
-        }
-        
-        // Reweight from the cumulative weight across all quaternions into a normalized
-        // weight between just the last quaternion and the new one
-        float totalWeight = blendedWeight + nextWeight;
-        float twoValueBlendWeight = (nextWeight / totalWeight);
-        
-        // Optimization to avoid blending when values are extremely low or high
-        if (twoValueBlendWeight > (1 - kBlendEpsilon)) {
-            blendedTransform = nextTransform;
-        } else if (twoValueBlendWeight > kBlendEpsilon) {
-            blendedTransform = blendBoneTransform(blendedTransform, nextTransform, twoValueBlendWeight);
-        } // else don't bother blending nextTransform into blendedTransform, its weight is too low to matter
-        
-        // Add the original weight of the latest transform to our total blend weight
-        // (note this is distinct from the weight we just used to perform the blend --
-        // that weight is just between the two quaternions, this weight is the weight
-        // amongst *all* quaternions)
-        blendedWeight += nextWeight;
-    }
-    return blendedTransform;
-}
-
-VROMatrix4f VROLayeredSkeletalAnimation::blendBoneTransform(const VROMatrix4f &previous, const VROMatrix4f &next, float weight) {
-    // Merge the current animation with any previously stored animation for this bone
-    VROVector3f   previousScale = previous.extractScale();
-    VROQuaternion previousRotation = previous.extractRotation(previousScale);
-    VROVector3f   previousTranslation = previous.extractTranslation();
-    
-    VROVector3f   currentScale = next.extractScale();
-    VROQuaternion currentRotation = next.extractRotation(currentScale);
-    VROVector3f   currentTranslation = next.extractTranslation();
-    
-    // Rotations are averaged by slerping
-    VROQuaternion averageRotation = VROQuaternion::slerp(previousRotation, currentRotation, weight);
-    VROMatrix4f averageTransform = averageRotation.getMatrix();
-    
-    // Translation is averaged by interpolation
-    VROVector3f averageTranslation = previousTranslation.interpolate(currentTranslation, weight);
-    averageTransform.translate(averageTranslation);
-    return averageTransform;
-}
-
 void VROLayeredSkeletalAnimation::setSpeed(float speed) {
     _speed = speed;
     std::shared_ptr<VROTransaction> transaction = _transaction.lock();
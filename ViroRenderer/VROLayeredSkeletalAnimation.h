@@ -96,7 +96,7 @@ public:
             _skinner(skinner),
             _layers(layers),
             _duration(duration),
-            _cached(false) {}
+            _prepareCursor(0) {}
 
     virtual ~VROLayeredSkeletalAnimation() { }
     
@@ -172,6 +172,12 @@ private:
     std::map<int, std::vector<float>> _boneKeyTimes;
     std::map<int, std::vector<VROMatrix4f>> _boneTransforms;
     
+    /*
+     The key times of the frames, and the last frame found when preparing frames.
+     */
+    std::vector<float> _frameTimes;
+    int _prepareCursor;
+    
     /*
      If the animation is running, this is its associated transaction.
      */
@@ -181,8 +187,11 @@ private:
      Blending methods to create the unified animation.
      */
     void blendFrame(int f);
-    static VROMatrix4f blendBoneTransform(const VROMatrix4f &previous, const VROMatrix4f &next, float weight);
-    static VROMatrix4f blendBoneTransforms(int bone, const std::vector<std::pair<VROMatrix4f, float>> &transformsAndWeights);
+    
+    /*
+     Blend the frame that will be displayed at the given T, if not yet cached.
+     */
+    void prepareFrame(float t);
     
     /*
      Recursively flatten out chains of chains.
@@ -31,10 +31,13 @@
 #include "VROLightingUBO.h"
 #include "VRORenderer.h" // for kZNear and kZFar
 #include "VROPencil.h"
+#include "VROBoundingBox.h"
+#include <algorithm>
 
 VROLight::VROLight(VROLightType type) :
     _lightId(++sLightId),
     _type(type),
+    _cullingVersion(0),
     _color({ 1.0, 1.0, 1.0 }),
     _intensity(1000.0),
     _temperature(6500),
@@ -54,7 +57,9 @@ VROLight::VROLight(VROLightType type) :
     _shadowOrthographicSize(20),
     _shadowNearZ(0.1),
     _shadowFarZ(20),
+    _shadowCascadeCount(1),
     _shadowMapIndex(-1),
+    _shadowCasterBounds(0, 0, 1, 1),
     _influenceBitMask(1) {
     
 }
@@ -100,6 +105,7 @@ void VROLight::setPosition(VROVector3f position) {
 void VROLight::setTransformedPosition(VROVector3f position) {
     if (!_transformedPosition.isEqual(position)) {
         _updatedFragmentData = true;
+        ++_cullingVersion;
     }
     _transformedPosition = position;
 }
@@ -131,6 +137,7 @@ void VROLight::setAttenuationEndDistance(float attenuationEndDistance) {
     animate(std::make_shared<VROAnimationFloat>([](VROAnimatable *const animatable, float value) {
                                                     ((VROLight *)animatable)->_attenuationEndDistance = value;
                                                     ((VROLight *)animatable)->_updatedFragmentData = true;
+                                                    ((VROLight *)animatable)->_cullingVersion++;
                                                 }, _attenuationEndDistance, attenuationEndDistance));
 }
 
@@ -159,6 +166,10 @@ void VROLight::setCastsShadow(bool castsShadow) {
     if (!castsShadow) {
         _shadowMapIndex = -1;
     }
+    if (_castsShadow != castsShadow) {
+        // Shadow casting lights are not clustered, so this changes light culling
+        ++_cullingVersion;
+    }
     _castsShadow = castsShadow;
 }
 
@@ -169,6 +180,56 @@ void VROLight::setShadowOpacity(float shadowOpacity) {
     }, _shadowOpacity, shadowOpacity));
 }
 
+void VROLight::setShadowCascadeCount(int count) {
+    _shadowCascadeCount = std::max(1, std::min(count, kMaxShadowCascades));
+}
+
+void VROLight::setShadowCascades(const std::vector<VROShadowCascade> &cascades) {
+    bool changed = cascades.size() != _shadowCascades.size();
+    for (int i = 0; !changed && i < (int) cascades.size(); i++) {
+        changed = cascades[i].split != _shadowCascades[i].split || cascades[i].scale != _shadowCascades[i].scale ||
+                  cascades[i].offsetX != _shadowCascades[i].offsetX || cascades[i].offsetY != _shadowCascades[i].offsetY ||
+                  cascades[i].layer != _shadowCascades[i].layer;
+    }
+    if (changed) {
+        _shadowCascades = cascades;
+        _updatedFragmentData = true;
+    }
+}
+
+void VROLight::setShadowCasterBounds(VROVector4f bounds) {
+    if (bounds.x != _shadowCasterBounds.x || bounds.y != _shadowCasterBounds.y ||
+        bounds.z != _shadowCasterBounds.z || bounds.w != _shadowCasterBounds.w) {
+        _shadowCasterBounds = bounds;
+        _updatedFragmentData = true;
+    }
+}
+
+VROVector4f VROLight::computeShadowMapBounds(const VROBoundingBox &box) const {
+    VROMatrix4f viewProjection = _shadowProjectionMatrix * _shadowViewMatrix;
+    float minU = std::numeric_limits<float>::max(), minV = minU;
+    float maxU = -minU, maxV = -minU;
+    
+    for (int c = 0; c < 8; c++) {
+        VROVector4f corner((c & 1) ? box.getMaxX() : box.getMinX(),
+                           (c & 2) ? box.getMaxY() : box.getMinY(),
+                           (c & 4) ? box.getMaxZ() : box.getMinZ(), 1.0);
+        VROVector4f clip = viewProjection.multiply(corner);
+        
+        // Points behind a spot light don't project; be conservative
+        if (clip.w <= 0) {
+            return VROVector4f(0, 0, 1, 1);
+        }
+        float u = clip.x / clip.w * 0.5 + 0.5;
+        float v = clip.y / clip.w * 0.5 + 0.5;
+        minU = std::min(minU, u);
+        minV = std::min(minV, v);
+        maxU = std::max(maxU, u);
+        maxV = std::max(maxV, v);
+    }
+    return VROVector4f(std::max(minU, 0.0f), std::max(minV, 0.0f), std::min(maxU, 1.0f), std::min(maxV, 1.0f));
+}
+
 void VROLight::propagateFragmentUpdates() {
     if (!_updatedFragmentData) {
         return;
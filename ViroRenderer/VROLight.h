@@ -41,6 +41,7 @@ static std::atomic_int sLightId;
 class VROTexture;
 class VROPencil;
 class VROLightingUBO;
+class VROBoundingBox;
 
 enum class VROLightType {
     Ambient,
@@ -55,6 +56,26 @@ enum class VROShadowMode {
     Modulated
 };
 
+/*
+ The maximum number of cascades in a directional light's shadow map.
+ */
+static const int kMaxShadowCascades = 4;
+
+/*
+ One cascade of a light's shadow map. The cascade covers the surfaces within
+ split distance of the camera, and maps the light's base shadow map texcoords
+ into its own tile of the shadow atlas (see VROShadowAtlas) by the given scale
+ and offset; the tile is in the given layer of the shadow map texture array.
+ Lights without cascaded shadows have a single cascade, which maps the texcoords
+ into the light's tile.
+ */
+struct VROShadowCascade {
+    float split;
+    float scale;
+    float offsetX, offsetY;
+    int layer;
+};
+
 class VROLight : public VROAnimatable {
     
 public:
@@ -84,6 +105,15 @@ public:
     VROLightType getType() const {
         return _type;
     }
+
+    /*
+     Incremented whenever a property that affects which nodes this light
+     influences changes (transformed position, attenuation end distance, or
+     influence bit mask). Used to cache per-node light culling.
+     */
+    uint32_t getCullingVersion() const {
+        return _cullingVersion;
+    }
     
 #pragma mark - Light Properties
     
@@ -148,6 +178,9 @@ public:
     }
     
     void setInfluenceBitMask(int influenceBitMask) {
+        if (_influenceBitMask != influenceBitMask) {
+            ++_cullingVersion;
+        }
         _influenceBitMask = influenceBitMask;
     }
     int getInfluenceBitMask() const {
@@ -202,6 +235,19 @@ public:
         return _shadowFarZ;
     }
     
+    /*
+     Set the number of cascades used for this light's shadow map, from 1 (the
+     default) to kMaxShadowCascades. Only applies to directional lights. With more
+     than one cascade, the shadowed region follows the camera: its orthographic
+     size is the diameter of the region around the camera that receives shadows,
+     and it is split into cascades of increasing size, each rendered to its own
+     shadow map, so that nearby shadows receive the most resolution.
+     */
+    void setShadowCascadeCount(int count);
+    int getShadowCascadeCount() const {
+        return _shadowCascadeCount;
+    }
+    
 #pragma mark - Light Implementation
     
     /*
@@ -251,6 +297,35 @@ public:
         _shadowProjectionMatrix = shadowProjectionMatrix;
     }
     
+    /*
+     The cascades rendered for this light's shadow map this frame, each of which
+     occupies its own tile of the shadow atlas. Lights that are not cascaded have
+     one cascade.
+     */
+    const std::vector<VROShadowCascade> &getShadowCascades() const {
+        return _shadowCascades;
+    }
+    void setShadowCascades(const std::vector<VROShadowCascade> &cascades);
+    
+    /*
+     The region of this light's shadow map covered by shadow casters this frame,
+     as (minU, minV, maxU, maxV) in the texcoords of the shadow projection, within
+     [0, 1]. Fragments outside of it can't be in shadow, and skip the shadow map
+     lookup. The bounds are empty (min > max) when nothing casts a shadow.
+     */
+    VROVector4f getShadowCasterBounds() const {
+        return _shadowCasterBounds;
+    }
+    void setShadowCasterBounds(VROVector4f bounds);
+    
+    /*
+     Project the given world space box into the texcoords of this light's shadow
+     map, using the current shadow view and projection matrices, in the same form
+     as the shadow caster bounds. Returns the entire map if the box crosses the
+     light's plane.
+     */
+    VROVector4f computeShadowMapBounds(const VROBoundingBox &box) const;
+    
 #pragma mark - Debugging
     
     void drawLightFrustum(std::shared_ptr<VROPencil> pencil);
@@ -259,6 +334,7 @@ private:
     
     uint32_t _lightId;
     VROLightType _type;
+    uint32_t _cullingVersion;
     
     /*
      RGB color of the light.
@@ -379,11 +455,23 @@ private:
     float _shadowNearZ, _shadowFarZ;
     
     /*
-     The index into the shadow render target's texture array where we can find this
-     light's shadow map.
+     The number of cascades in the shadow map of a directional light, and the
+     cascades rendered this frame.
+     */
+    int _shadowCascadeCount;
+    std::vector<VROShadowCascade> _shadowCascades;
+    
+    /*
+     The layer of the shadow render target's texture array holding this light's
+     (first) shadow map tile, or -1 if the light has no shadow map this frame.
      */
     int _shadowMapIndex;
     
+    /*
+     The shadow caster bounds for this frame; see getShadowCasterBounds().
+     */
+    VROVector4f _shadowCasterBounds;
+    
     /*
      Bit mask that is ANDed with each node's lightReceivingBitMask and shadowCastingBitMask
      to determine what objects are illuminated by, and cast shadows from, this light.
@@ -0,0 +1,338 @@
+//
+//  VROLightBins.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include "VROLightBins.h"
+#include "VROLight.h"
+#include "VROLightClusterGrid.h"
+#include "VROBoundingBox.h"
+#include "VROFrustum.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Boxes or lights tested at a time
+static const int kLightBatchWidth = 4;
+
+// The grid never exceeds this many cells along each axis
+static const int kMaxLightBinsPerAxis = 8;
+
+typedef float VROLightFloat4 __attribute__((__vector_size__(16)));
+typedef int VROLightInt4 __attribute__((__vector_size__(16)));
+
+/*
+ Clamp each lane to zero from below, by masking out the non-positive lanes.
+ */
+static inline __attribute__((__always_inline__)) VROLightFloat4 positive4_simd(VROLightFloat4 v) {
+    return (VROLightFloat4) ((VROLightInt4) v & (VROLightInt4) (v > 0.0f));
+}
+
+/*
+ Test four boxes, given as six arrays of box planes in VROBoxPlane order,
+ against four spheres, given as arrays of x, y, z and squared radius. Returns
+ in the low four bits the boxes closer to their sphere's center than its
+ radius. At most one of the two distances past each axis' planes is positive,
+ so their sum is the distance to the box along that axis.
+ */
+static inline __attribute__((__always_inline__)) uint32_t influence4_simd(const float boxPlanes[6][kLightBatchWidth],
+                                                                          const float spheres[4][kLightBatchWidth]) {
+    const VROLightFloat4 *planes = (const VROLightFloat4 *) boxPlanes;
+    const VROLightFloat4 *sphere = (const VROLightFloat4 *) spheres;
+    
+    VROLightFloat4 distanceSquared = { 0, 0, 0, 0 };
+    for (int axis = 0; axis < 3; axis++) {
+        VROLightFloat4 d = positive4_simd(planes[axis * 2] - sphere[axis]) +
+                           positive4_simd(sphere[axis] - planes[axis * 2 + 1]);
+        distanceSquared += d * d;
+    }
+    VROLightInt4 influenced = (VROLightInt4) (distanceSquared < sphere[3]);
+    return (influenced[0] & 1) | (influenced[1] & 2) | (influenced[2] & 4) | (influenced[3] & 8);
+}
+
+bool VROLightBins::isAttenuated(const VROLight &light) {
+    // Ambient and Directional lights do not attenuate
+    return light.getType() != VROLightType::Ambient && light.getType() != VROLightType::Directional &&
+           !std::isinf(light.getAttenuationEndDistance());
+}
+
+VROLightBins::VROLightBins() :
+    _gridSize{ 0, 0, 0 } {
+    
+}
+
+VROLightBins::~VROLightBins() {
+    
+}
+
+void VROLightBins::build(const std::vector<std::shared_ptr<VROLight>> &lights, bool skipClusterable) {
+    _lights = lights;
+    _globalLights.clear();
+    _localLights.clear();
+    _localInfluenceMasks.clear();
+    _localPositions.clear();
+    _localRadiiSquared.clear();
+    _cellOffsets.clear();
+    _cellLights.clear();
+    
+    float inf = std::numeric_limits<float>::infinity();
+    _gridMin = VROVector3f(inf, inf, inf);
+    _gridMax = VROVector3f(-inf, -inf, -inf);
+    
+    for (int i = 0; i < (int) _lights.size(); i++) {
+        const std::shared_ptr<VROLight> &light = _lights[i];
+        
+        // Clusterable lights are evaluated per-fragment through the light cluster grid
+        if (skipClusterable && VROLightClusterGrid::isClusterable(light)) {
+            continue;
+        }
+        if (!isAttenuated(*light)) {
+            _globalLights.push_back(i);
+            continue;
+        }
+        
+        // No box is closer than a non-positive attenuation distance
+        float radius = light->getAttenuationEndDistance();
+        if (!(radius > 0)) {
+            continue;
+        }
+        VROVector3f position = light->getTransformedPosition();
+        _localLights.push_back(i);
+        _localInfluenceMasks.push_back(light->getInfluenceBitMask());
+        _localPositions.push_back(position);
+        _localRadiiSquared.push_back(radius * radius);
+        
+        _gridMin = VROVector3f(std::min(_gridMin.x, position.x - radius), std::min(_gridMin.y, position.y - radius),
+                               std::min(_gridMin.z, position.z - radius));
+        _gridMax = VROVector3f(std::max(_gridMax.x, position.x + radius), std::max(_gridMax.y, position.y + radius),
+                               std::max(_gridMax.z, position.z + radius));
+    }
+    
+    int numLocal = (int) _localLights.size();
+    _candidateMask.assign(VROFrustum::getBatchMaskSize(numLocal), 0);
+    _candidates.reserve(numLocal);
+    if (numLocal == 0) {
+        return;
+    }
+    
+    // Roughly one light per cell, were the lights spread evenly
+    int size = std::min(std::max((int) std::ceil(std::cbrt((float) numLocal)), 1), kMaxLightBinsPerAxis);
+    _gridSize[0] = _gridSize[1] = _gridSize[2] = size;
+    VROVector3f extent = _gridMax - _gridMin;
+    _cellScale = VROVector3f(size / extent.x, size / extent.y, size / extent.z);
+    
+    int numCells = size * size * size;
+    _cellOffsets.assign(numCells + 1, 0);
+    
+    // Count the lights in each cell, then fill each cell's span in light order
+    for (int pass = 0; pass < 2; pass++) {
+        std::vector<int> cursors;
+        if (pass == 1) {
+            for (int c = 0; c < numCells; c++) {
+                _cellOffsets[c + 1] += _cellOffsets[c];
+            }
+            _cellLights.resize(_cellOffsets[numCells]);
+            cursors.assign(_cellOffsets.begin(), _cellOffsets.end() - 1);
+        }
+        
+        for (int l = 0; l < numLocal; l++) {
+            float radius = sqrtf(_localRadiiSquared[l]);
+            VROVector3f radii(radius, radius, radius);
+            int min[3], max[3];
+            getCellRange(_localPositions[l] - radii, _localPositions[l] + radii, min, max);
+            
+            for (int z = min[2]; z <= max[2]; z++) {
+                for (int y = min[1]; y <= max[1]; y++) {
+                    for (int x = min[0]; x <= max[0]; x++) {
+                        int cell = (z * size + y) * size + x;
+                        if (pass == 0) {
+                            _cellOffsets[cell + 1]++;
+                        }
+                        else {
+                            _cellLights[cursors[cell]++] = l;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+void VROLightBins::getCellRange(const VROVector3f &min, const VROVector3f &max, int *outMin, int *outMax) const {
+    float mins[3] = { (min.x - _gridMin.x) * _cellScale.x, (min.y - _gridMin.y) * _cellScale.y,
+                      (min.z - _gridMin.z) * _cellScale.z };
+    float maxs[3] = { (max.x - _gridMin.x) * _cellScale.x, (max.y - _gridMin.y) * _cellScale.y,
+                      (max.z - _gridMin.z) * _cellScale.z };
+    
+    // Clamp before converting, so that unbounded boxes stay within the grid
+    for (int axis = 0; axis < 3; axis++) {
+        float last = (float) (_gridSize[axis] - 1);
+        outMin[axis] = (int) std::min(last, std::max(0.0f, std::floor(mins[axis])));
+        outMax[axis] = (int) std::min(last, std::max(0.0f, std::floor(maxs[axis])));
+    }
+}
+
+void VROLightBins::getLightsInfluencing(const VROBoundingBox &box, int lightReceivingBitMask,
+                                        std::vector<std::shared_ptr<VROLight>> *outLights) const {
+    const float *planes = box.getPlanes();
+    
+    /*
+     Gather the local lights binned in the cells the box overlaps. Lights span
+     several cells, so lights from more than one cell are merged through the
+     candidate mask, which also restores their order.
+     */
+    _candidates.clear();
+    if (!_localLights.empty() &&
+        planes[VROBoxPlaneMaxX] >= _gridMin.x && planes[VROBoxPlaneMinX] <= _gridMax.x &&
+        planes[VROBoxPlaneMaxY] >= _gridMin.y && planes[VROBoxPlaneMinY] <= _gridMax.y &&
+        planes[VROBoxPlaneMaxZ] >= _gridMin.z && planes[VROBoxPlaneMinZ] <= _gridMax.z) {
+        
+        int min[3], max[3];
+        getCellRange(VROVector3f(planes[VROBoxPlaneMinX], planes[VROBoxPlaneMinY], planes[VROBoxPlaneMinZ]),
+                     VROVector3f(planes[VROBoxPlaneMaxX], planes[VROBoxPlaneMaxY], planes[VROBoxPlaneMaxZ]),
+                     min, max);
+        int size = _gridSize[0];
+        
+        if (min[0] == max[0] && min[1] == max[1] && min[2] == max[2]) {
+            int cell = (min[2] * size + min[1]) * size + min[0];
+            for (int i = _cellOffsets[cell]; i < _cellOffsets[cell + 1]; i++) {
+                int l = _cellLights[i];
+                if ((_localInfluenceMasks[l] & lightReceivingBitMask) != 0) {
+                    _candidates.push_back(l);
+                }
+            }
+        }
+        else {
+            for (int z = min[2]; z <= max[2]; z++) {
+                for (int y = min[1]; y <= max[1]; y++) {
+                    for (int x = min[0]; x <= max[0]; x++) {
+                        int cell = (z * size + y) * size + x;
+                        for (int i = _cellOffsets[cell]; i < _cellOffsets[cell + 1]; i++) {
+                            _candidateMask[_cellLights[i] >> 5] |= 1u << (_cellLights[i] & 31);
+                        }
+                    }
+                }
+            }
+            for (int w = 0; w < (int) _candidateMask.size(); w++) {
+                uint32_t bits = _candidateMask[w];
+                while (bits != 0) {
+                    int l = (w << 5) + __builtin_ctz(bits);
+                    bits &= bits - 1;
+                    if ((_localInfluenceMasks[l] & lightReceivingBitMask) != 0) {
+                        _candidates.push_back(l);
+                    }
+                }
+                _candidateMask[w] = 0;
+            }
+        }
+    }
+    
+    // Test the candidates four at a time against the box, keeping those in range
+    int numPassed = 0;
+    int numCandidates = (int) _candidates.size();
+    if (numCandidates > 0) {
+        alignas(16) float boxPlanes[6][kLightBatchWidth];
+        for (int p = 0; p < 6; p++) {
+            for (int b = 0; b < kLightBatchWidth; b++) {
+                boxPlanes[p][b] = planes[p];
+            }
+        }
+        
+        alignas(16) float spheres[4][kLightBatchWidth];
+        for (int i = 0; i < numCandidates; i += kLightBatchWidth) {
+            int groupSize = std::min(kLightBatchWidth, numCandidates - i);
+            for (int b = 0; b < kLightBatchWidth; b++) {
+                int l = _candidates[i + std::min(b, groupSize - 1)];
+                spheres[0][b] = _localPositions[l].x;
+                spheres[1][b] = _localPositions[l].y;
+                spheres[2][b] = _localPositions[l].z;
+                spheres[3][b] = _localRadiiSquared[l];
+            }
+            
+            uint32_t influenced = influence4_simd(boxPlanes, spheres);
+            for (int b = 0; b < groupSize; b++) {
+                if ((influenced >> b) & 1) {
+                    _candidates[numPassed++] = _candidates[i + b];
+                }
+            }
+        }
+    }
+    
+    // Merge the lights in range with the global lights, in light order
+    int g = 0;
+    int c = 0;
+    int numGlobal = (int) _globalLights.size();
+    while (g < numGlobal || c < numPassed) {
+        int index;
+        if (c >= numPassed || (g < numGlobal && _globalLights[g] < _localLights[_candidates[c]])) {
+            index = _globalLights[g++];
+        }
+        else {
+            index = _localLights[_candidates[c++]];
+        }
+        
+        const std::shared_ptr<VROLight> &light = _lights[index];
+        if ((light->getInfluenceBitMask() & lightReceivingBitMask) != 0) {
+            outLights->push_back(light);
+        }
+    }
+}
+
+void VROLightBins::intersectBatch(const VROLight &light, const VROBoundingBox *boxes, int count,
+                                  uint32_t *outInfluenced) {
+    int numWords = VROFrustum::getBatchMaskSize(count);
+    bool attenuated = isAttenuated(light);
+    for (int w = 0; w < numWords; w++) {
+        outInfluenced[w] = attenuated ? 0 : ~0u;
+    }
+    if (!attenuated) {
+        return;
+    }
+    
+    float radius = std::max(light.getAttenuationEndDistance(), 0.0f);
+    VROVector3f position = light.getTransformedPosition();
+    alignas(16) float spheres[4][kLightBatchWidth];
+    for (int b = 0; b < kLightBatchWidth; b++) {
+        spheres[0][b] = position.x;
+        spheres[1][b] = position.y;
+        spheres[2][b] = position.z;
+        spheres[3][b] = radius * radius;
+    }
+    
+    // Transpose each group of four boxes as VROFrustum::intersectBatch does
+    alignas(16) float boxPlanes[6][kLightBatchWidth];
+    for (int i = 0; i < count; i += kLightBatchWidth) {
+        int groupSize = std::min(kLightBatchWidth, count - i);
+        for (int b = 0; b < kLightBatchWidth; b++) {
+            const float *planes = boxes[i + std::min(b, groupSize - 1)].getPlanes();
+            for (int p = 0; p < 6; p++) {
+                boxPlanes[p][b] = planes[p];
+            }
+        }
+        
+        // Groups are four-aligned, so they never span two mask words
+        uint32_t groupMask = (1 << groupSize) - 1;
+        outInfluenced[i >> 5] |= (influence4_simd(boxPlanes, spheres) & groupMask) << (i & 31);
+    }
+}
@@ -0,0 +1,123 @@
+//
+//  VROLightBins.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef VROLightBins_h
+#define VROLightBins_h
+
+#include <vector>
+#include <memory>
+#include <stdint.h>
+#include "VROVector3f.h"
+
+class VROLight;
+class VROBoundingBox;
+
+/*
+ The lights of a scene binned once per change into a coarse world-space grid,
+ so that each node tests only the lights near it instead of every light in the
+ scene. Ambient and directional lights influence everything and are not
+ binned. The lights that may influence a box are found from the cells it
+ overlaps, then tested four at a time against the box with SIMD vector
+ extensions, which map to NEON on ARM and SSE on x86.
+ 
+ The light positions must be transformed before building (see
+ VRONode::collectLights). Queries must be made on one thread.
+ */
+class VROLightBins {
+public:
+    
+    VROLightBins();
+    virtual ~VROLightBins();
+    
+    /*
+     Bin the given lights. If skipClusterable is true, lights evaluated through
+     the light cluster grid are omitted (see VROLightClusterGrid::isClusterable).
+     */
+    void build(const std::vector<std::shared_ptr<VROLight>> &lights, bool skipClusterable);
+    
+    /*
+     Append to outLights the lights that influence the given box and match the
+     given receiving bit mask, in the order they were given to build.
+     */
+    void getLightsInfluencing(const VROBoundingBox &box, int lightReceivingBitMask,
+                              std::vector<std::shared_ptr<VROLight>> *outLights) const;
+    
+    /*
+     Batched test of a contiguous array of boxes against the range of the given
+     light. Bit i of outInfluenced is set if box i is within the light's
+     attenuation distance, or always for lights that do not attenuate. The mask
+     must hold VROFrustum::getBatchMaskSize(count) words.
+     */
+    static void intersectBatch(const VROLight &light, const VROBoundingBox *boxes, int count,
+                               uint32_t *outInfluenced);
+    
+    /*
+     True if the given light's influence ends at its attenuation distance.
+     */
+    static bool isAttenuated(const VROLight &light);
+    
+private:
+    
+    std::vector<std::shared_ptr<VROLight>> _lights;
+    
+    /*
+     Indices into _lights of the lights that do not attenuate.
+     */
+    std::vector<int> _globalLights;
+    
+    /*
+     The attenuated lights, in order: their indices into _lights, influence
+     masks, and positions and squared attenuation distances.
+     */
+    std::vector<int> _localLights;
+    std::vector<int> _localInfluenceMasks;
+    std::vector<VROVector3f> _localPositions;
+    std::vector<float> _localRadiiSquared;
+    
+    /*
+     The grid spans the bounds of the attenuated lights' spheres of influence.
+     Each cell's local light indices, in ascending order, are stored
+     contiguously; cell c's span _cellLights[_cellOffsets[c]] to
+     _cellLights[_cellOffsets[c + 1]].
+     */
+    VROVector3f _gridMin, _gridMax;
+    VROVector3f _cellScale;
+    int _gridSize[3];
+    std::vector<int> _cellOffsets;
+    std::vector<int> _cellLights;
+    
+    /*
+     Scratch for queries: the local lights gathered from the overlapped cells,
+     and the candidates passing the influence mask.
+     */
+    mutable std::vector<uint32_t> _candidateMask;
+    mutable std::vector<int> _candidates;
+    
+    void getCellRange(const VROVector3f &min, const VROVector3f &max, int *outMin, int *outMax) const;
+    
+};
+
+#endif /* VROLightBins_h */
@@ -0,0 +1,204 @@
+//
+//  VROLightClusterGrid.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROLightClusterGrid.h"
+#include "VROLight.h"
+#include "VROVector4f.h"
+#include <cmath>
+#include <algorithm>
+
+static inline int clampIndex(int index, int max) {
+    return std::max(0, std::min(index, max));
+}
+
+bool VROLightClusterGrid::isClusterable(const std::shared_ptr<VROLight> &light) {
+    VROLightType type = light->getType();
+    if (type != VROLightType::Omni && type != VROLightType::Spot) {
+        return false;
+    }
+    return !light->getCastsShadow() && light->getInfluenceBitMask() == 1;
+}
+
+VROLightClusterGrid::VROLightClusterGrid() :
+    _depthSliceScale(0),
+    _depthSliceBias(0),
+    _version(0) {
+    _clusterHeaders.resize(kNumLightClusters, 0);
+    _counts.resize(kNumLightClusters, 0);
+}
+
+VROLightClusterGrid::~VROLightClusterGrid() {
+    
+}
+
+void VROLightClusterGrid::update(const std::vector<std::shared_ptr<VROLight>> &lights,
+                                 VROMatrix4f viewMatrix, VROMatrix4f projectionMatrix,
+                                 float zNear, float zFar) {
+    ++_version;
+    _lights.clear();
+    _ranges.clear();
+    _lightIndices.clear();
+    std::fill(_clusterHeaders.begin(), _clusterHeaders.end(), 0);
+    std::fill(_counts.begin(), _counts.end(), 0);
+    
+    _viewProjectionMatrix = projectionMatrix.multiply(viewMatrix);
+    
+    float logDepthRatio = log(zFar / zNear);
+    _depthSliceScale = kLightClustersZ / logDepthRatio;
+    _depthSliceBias = -kLightClustersZ * log(zNear) / logDepthRatio;
+    
+    /*
+     Find the cluster range covered by each clusterable light, and count the
+     lights in each cluster.
+     */
+    for (const std::shared_ptr<VROLight> &light : lights) {
+        if (_lights.size() >= kMaxClusteredLights) {
+            break;
+        }
+        if (!isClusterable(light)) {
+            continue;
+        }
+        
+        VROVector3f center = viewMatrix.multiply(light->getTransformedPosition());
+        VROLightClusterRange range;
+        if (!computeClusterRange(center, light->getAttenuationEndDistance(), projectionMatrix,
+                                 zNear, zFar, &range)) {
+            continue;
+        }
+        
+        for (int z = range.minZ; z <= range.maxZ; z++) {
+            for (int y = range.minY; y <= range.maxY; y++) {
+                for (int x = range.minX; x <= range.maxX; x++) {
+                    int cluster = (z * kLightClustersY + y) * kLightClustersX + x;
+                    _counts[cluster] = std::min(_counts[cluster] + 1, (uint32_t) kMaxLightsPerCluster);
+                }
+            }
+        }
+        _lights.push_back(light);
+        _ranges.push_back(range);
+    }
+    
+    if (_lights.empty()) {
+        return;
+    }
+    
+    /*
+     Prefix sum the counts into offsets. If the index list overflows, the
+     remaining clusters are truncated.
+     */
+    uint32_t offset = 0;
+    for (int cluster = 0; cluster < kNumLightClusters; cluster++) {
+        uint32_t count = std::min(_counts[cluster], kMaxClusterLightIndices - offset);
+        _clusterHeaders[cluster] = (offset << 8) | count;
+        _counts[cluster] = 0;
+        offset += count;
+    }
+    _lightIndices.resize(offset, 0);
+    
+    /*
+     Fill the light indices for each cluster. Lights are visited in order, so
+     each cluster's list is sorted by light index.
+     */
+    for (int i = 0; i < (int) _lights.size(); i++) {
+        const VROLightClusterRange &range = _ranges[i];
+        for (int z = range.minZ; z <= range.maxZ; z++) {
+            for (int y = range.minY; y <= range.maxY; y++) {
+                for (int x = range.minX; x <= range.maxX; x++) {
+                    int cluster = (z * kLightClustersY + y) * kLightClustersX + x;
+                    uint32_t header = _clusterHeaders[cluster];
+                    if (_counts[cluster] < (header & 0xFF)) {
+                        _lightIndices[(header >> 8) + _counts[cluster]] = (uint8_t) i;
+                        _counts[cluster]++;
+                    }
+                }
+            }
+        }
+    }
+}
+
+bool VROLightClusterGrid::computeClusterRange(VROVector3f center, float radius,
+                                              const VROMatrix4f &projectionMatrix,
+                                              float zNear, float zFar,
+                                              VROLightClusterRange *outRange) const {
+    // View space looks down the -Z axis
+    float depth = -center.z;
+    if (depth + radius < zNear || depth - radius > zFar) {
+        return false;
+    }
+    outRange->minZ = getDepthSlice(std::max(depth - radius, zNear));
+    outRange->maxZ = getDepthSlice(std::min(depth + radius, zFar));
+    
+    /*
+     If the sphere crosses the near plane, its screen-space projection is
+     unbounded, so assume it covers every tile.
+     */
+    if (depth - radius <= zNear) {
+        outRange->minX = 0;
+        outRange->maxX = kLightClustersX - 1;
+        outRange->minY = 0;
+        outRange->maxY = kLightClustersY - 1;
+        return true;
+    }
+    
+    /*
+     Otherwise, bound the projection of the sphere's view-space bounding box.
+     */
+    float minX =  1, minY =  1;
+    float maxX = -1, maxY = -1;
+    for (int i = 0; i < 8; i++) {
+        VROVector4f corner(center.x + ((i & 1) ? radius : -radius),
+                           center.y + ((i & 2) ? radius : -radius),
+                           center.z + ((i & 4) ? radius : -radius),
+                           1.0);
+        VROVector4f clip = projectionMatrix.multiply(corner);
+        float ndcX = clip.x / clip.w;
+        float ndcY = clip.y / clip.w;
+        
+        if (i == 0) {
+            minX = maxX = ndcX;
+            minY = maxY = ndcY;
+        }
+        else {
+            minX = std::min(minX, ndcX);
+            maxX = std::max(maxX, ndcX);
+            minY = std::min(minY, ndcY);
+            maxY = std::max(maxY, ndcY);
+        }
+    }
+    if (minX > 1 || maxX < -1 || minY > 1 || maxY < -1) {
+        return false;
+    }
+    
+    outRange->minX = clampIndex((int) floor((minX * 0.5 + 0.5) * kLightClustersX), kLightClustersX - 1);
+    outRange->maxX = clampIndex((int) floor((maxX * 0.5 + 0.5) * kLightClustersX), kLightClustersX - 1);
+    outRange->minY = clampIndex((int) floor((minY * 0.5 + 0.5) * kLightClustersY), kLightClustersY - 1);
+    outRange->maxY = clampIndex((int) floor((maxY * 0.5 + 0.5) * kLightClustersY), kLightClustersY - 1);
+    return true;
+}
+
+int VROLightClusterGrid::getDepthSlice(float depth) const {
+    int slice = (int) floor(log(depth) * _depthSliceScale + _depthSliceBias);
+    return clampIndex(slice, kLightClustersZ - 1);
+}
@@ -0,0 +1,176 @@
+//
+//  VROLightClusterGrid.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROLightClusterGrid_h
+#define VROLightClusterGrid_h
+
+#include <vector>
+#include <memory>
+#include <stdint.h>
+#include "VROMatrix4f.h"
+#include "VROVector3f.h"
+
+class VROLight;
+
+/*
+ Dimensions of the cluster grid. The view frustum is divided into a
+ kLightClustersX by kLightClustersY grid of screen-space tiles, and each tile
+ is divided into kLightClustersZ depth slices, spaced exponentially between
+ the near and far clipping planes. These values must be kept in sync with
+ the clustered lighting shader modifier in VROShaderFactory.
+ */
+static const int kLightClustersX = 16;
+static const int kLightClustersY = 8;
+static const int kLightClustersZ = 16;
+static const int kNumLightClusters = kLightClustersX * kLightClustersY * kLightClustersZ;
+
+/*
+ The maximum number of clustered lights per frame, and the maximum number of
+ light references across all clusters. These are limited by the minimum GLES
+ uniform block size (16KB), as the lights and references are stored in UBOs;
+ each reference is one byte.
+ */
+static const int kMaxClusteredLights = 128;
+static const int kMaxClusterLightIndices = 16384;
+static const int kMaxLightsPerCluster = 255;
+
+/*
+ Bins the local lights in the scene into view frustum clusters, for clustered
+ forward lighting. Each frame (and each eye), the grid is rebuilt from the
+ lights and the eye's view and projection matrices. Each
+ fragment then finds its cluster from its clip-space position, and only
+ evaluates the lights binned into that cluster. This lifts the kMaxLights
+ limit for any single object, and keeps per-node light culling off the CPU.
+ 
+ Only lights that satisfy isClusterable() are binned: omni and spot lights
+ that do not cast shadows. Ambient, directional, and shadow-casting lights
+ continue to use the per-node lighting UBO (the shadow map lookups are indexed
+ by per-node light index).
+ 
+ Note that clustered lights do not consult each node's light receiving bit
+ mask: only lights with the default influence bit mask are clustered, and
+ they influence every node they reach.
+ 
+ The grid is platform-independent; VROLightClusterUBO uploads it to the GPU.
+ */
+class VROLightClusterGrid {
+public:
+    
+    /*
+     Returns true if the given light should be rendered through the cluster
+     grid, instead of through the per-node lighting UBO.
+     */
+    static bool isClusterable(const std::shared_ptr<VROLight> &light);
+    
+    VROLightClusterGrid();
+    virtual ~VROLightClusterGrid();
+    
+    /*
+     Rebuild the grid for the given lights (non-clusterable lights are ignored)
+     and the given eye.
+     */
+    void update(const std::vector<std::shared_ptr<VROLight>> &lights,
+                VROMatrix4f viewMatrix, VROMatrix4f projectionMatrix,
+                float zNear, float zFar);
+    
+    /*
+     The clustered lights, in the order referenced by the light indices.
+     */
+    const std::vector<std::shared_ptr<VROLight>> &getLights() const {
+        return _lights;
+    }
+    int getNumLights() const {
+        return (int) _lights.size();
+    }
+    
+    /*
+     One entry per cluster: the offset of the cluster's first light index in getLightIndices(),
+     shifted left by 8 bits, OR'd with the number of lights in the cluster.
+     */
+    const std::vector<uint32_t> &getClusterHeaders() const {
+        return _clusterHeaders;
+    }
+    
+    /*
+     The light indices for all clusters, indexing into getLights().
+     */
+    const std::vector<uint8_t> &getLightIndices() const {
+        return _lightIndices;
+    }
+    
+    /*
+     The view-projection matrix and depth slice parameters used to build the
+     grid. The shader uses these to locate each fragment's cluster: the depth
+     slice of view depth d is floor(log(d) * scale + bias).
+     */
+    const VROMatrix4f &getViewProjectionMatrix() const {
+        return _viewProjectionMatrix;
+    }
+    float getDepthSliceScale() const {
+        return _depthSliceScale;
+    }
+    float getDepthSliceBias() const {
+        return _depthSliceBias;
+    }
+    
+    /*
+     Incremented each time the grid is rebuilt, so that GPU copies know when
+     to update.
+     */
+    uint32_t getVersion() const {
+        return _version;
+    }
+    
+private:
+    
+    std::vector<std::shared_ptr<VROLight>> _lights;
+    std::vector<uint32_t> _clusterHeaders;
+    std::vector<uint8_t> _lightIndices;
+    
+    VROMatrix4f _viewProjectionMatrix;
+    float _depthSliceScale, _depthSliceBias;
+    uint32_t _version;
+    
+    /*
+     Scratch storage reused across updates: the cluster range covered by each
+     light, and the running count of lights per cluster.
+     */
+    struct VROLightClusterRange {
+        int minX, maxX, minY, maxY, minZ, maxZ;
+    };
+    std::vector<VROLightClusterRange> _ranges;
+    std::vector<uint32_t> _counts;
+    
+    /*
+     Compute the range of clusters that a sphere (in view space) overlaps.
+     Returns false if it overlaps none.
+     */
+    bool computeClusterRange(VROVector3f center, float radius, const VROMatrix4f &projectionMatrix,
+                             float zNear, float zFar, VROLightClusterRange *outRange) const;
+    int getDepthSlice(float depth) const;
+    
+};
+
+#endif /* VROLightClusterGrid_h */
@@ -0,0 +1,130 @@
+//
+//  VROLightClusterUBO.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROLightClusterUBO.h"
+#include "VROShaderProgram.h"
+#include "VRODriverOpenGL.h"
+#include "VROLight.h"
+#include "VROMath.h"
+#include "VROLog.h"
+
+static const int kClusterHeadersSize = kNumLightClusters * sizeof(uint32_t);
+static const int kClusterIndicesSize = kMaxClusterLightIndices * sizeof(uint8_t);
+
+VROLightClusterUBO::VROLightClusterUBO(std::shared_ptr<VRODriverOpenGL> driver) :
+    _driver(driver),
+    _uploadedVersion(0) {
+    
+    GL( glGenBuffers(1, &_lightsUBO) );
+    GL( glBindBuffer(GL_UNIFORM_BUFFER, _lightsUBO) );
+    GL( glBufferData(GL_UNIFORM_BUFFER, sizeof(VROClusteredLightingData), nullptr, GL_DYNAMIC_DRAW) );
+    
+    GL( glGenBuffers(1, &_headersUBO) );
+    GL( glBindBuffer(GL_UNIFORM_BUFFER, _headersUBO) );
+    GL( glBufferData(GL_UNIFORM_BUFFER, kClusterHeadersSize, nullptr, GL_DYNAMIC_DRAW) );
+    
+    GL( glGenBuffers(1, &_indicesUBO) );
+    GL( glBindBuffer(GL_UNIFORM_BUFFER, _indicesUBO) );
+    GL( glBufferData(GL_UNIFORM_BUFFER, kClusterIndicesSize, nullptr, GL_DYNAMIC_DRAW) );
+}
+
+VROLightClusterUBO::~VROLightClusterUBO() {
+    std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
+    if (driver) {
+        driver->deleteBuffer(_lightsUBO);
+        driver->deleteBuffer(_headersUBO);
+        driver->deleteBuffer(_indicesUBO);
+    }
+}
+
+void VROLightClusterUBO::bind(const std::shared_ptr<VROLightClusterGrid> &grid) {
+    std::shared_ptr<VROLightClusterGrid> uploadedGrid = _uploadedGrid.lock();
+    if (uploadedGrid != grid || _uploadedVersion != grid->getVersion()) {
+        upload(*grid);
+        _uploadedGrid = grid;
+        _uploadedVersion = grid->getVersion();
+    }
+    
+    GL( glBindBufferBase(GL_UNIFORM_BUFFER, VROShaderProgram::sClusteredLightingUBOBindingPoint, _lightsUBO) );
+    GL( glBindBufferBase(GL_UNIFORM_BUFFER, VROShaderProgram::sClusterHeadersUBOBindingPoint, _headersUBO) );
+    GL( glBindBufferBase(GL_UNIFORM_BUFFER, VROShaderProgram::sClusterIndicesUBOBindingPoint, _indicesUBO) );
+}
+
+void VROLightClusterUBO::upload(const VROLightClusterGrid &grid) {
+    pglpush("Clustered Lights");
+    std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
+    
+    VROClusteredLightingData data;
+    memcpy(data.cluster_view_projection, grid.getViewProjectionMatrix().getArray(), 16 * sizeof(float));
+    data.cluster_depth_params[0] = grid.getDepthSliceScale();
+    data.cluster_depth_params[1] = grid.getDepthSliceBias();
+    data.cluster_depth_params[2] = 0;
+    data.cluster_depth_params[3] = 0;
+    data.cluster_dimensions[0] = kLightClustersX;
+    data.cluster_dimensions[1] = kLightClustersY;
+    data.cluster_dimensions[2] = kLightClustersZ;
+    data.cluster_dimensions[3] = grid.getNumLights();
+    
+    const std::vector<std::shared_ptr<VROLight>> &lights = grid.getLights();
+    for (int i = 0; i < (int) lights.size(); i++) {
+        const std::shared_ptr<VROLight> &light = lights[i];
+        VROVector3f lightColor = light->getColor();
+        if (driver && driver->isLinearRenderingEnabled()) {
+            lightColor = VROMathConvertSRGBToLinearColor(lightColor);
+        }
+        VROLightingUBO::encodeLight(light, lightColor * light->getColorFromTemperature(),
+                                    &data.clustered_lights[i]);
+    }
+    
+    int indicesSize = (int) grid.getLightIndices().size();
+    
+    GL( glBindBuffer(GL_UNIFORM_BUFFER, _lightsUBO) );
+#if VRO_AVOID_BUFFER_SUB_DATA
+    GL( glBufferData(GL_UNIFORM_BUFFER, sizeof(VROClusteredLightingData), &data, GL_DYNAMIC_DRAW) );
+#else
+    // Only the grid parameters and the used lights need to be uploaded
+    int lightsSize = (int) (offsetof(VROClusteredLightingData, clustered_lights) + lights.size() * sizeof(VROLightData));
+    GL( glBufferSubData(GL_UNIFORM_BUFFER, 0, lightsSize, &data) );
+#endif
+    
+    GL( glBindBuffer(GL_UNIFORM_BUFFER, _headersUBO) );
+#if VRO_AVOID_BUFFER_SUB_DATA
+    GL( glBufferData(GL_UNIFORM_BUFFER, kClusterHeadersSize, grid.getClusterHeaders().data(), GL_DYNAMIC_DRAW) );
+#else
+    GL( glBufferSubData(GL_UNIFORM_BUFFER, 0, kClusterHeadersSize, grid.getClusterHeaders().data()) );
+#endif
+    
+    if (indicesSize > 0) {
+        GL( glBindBuffer(GL_UNIFORM_BUFFER, _indicesUBO) );
+#if VRO_AVOID_BUFFER_SUB_DATA
+        std::vector<uint8_t> indices(kClusterIndicesSize, 0);
+        memcpy(indices.data(), grid.getLightIndices().data(), indicesSize);
+        GL( glBufferData(GL_UNIFORM_BUFFER, kClusterIndicesSize, indices.data(), GL_DYNAMIC_DRAW) );
+#else
+        GL( glBufferSubData(GL_UNIFORM_BUFFER, 0, indicesSize, grid.getLightIndices().data()) );
+#endif
+    }
+    pglpop();
+}
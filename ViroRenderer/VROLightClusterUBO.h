@@ -0,0 +1,90 @@
+//
+//  VROLightClusterUBO.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROLightClusterUBO_h
+#define VROLightClusterUBO_h
+
+#include "VROOpenGL.h"
+#include "VROLightingUBO.h"
+#include "VROLightClusterGrid.h"
+#include <memory>
+
+// Must match the clustered_lighting layout in VROShaderFactory
+typedef struct {
+    float cluster_view_projection[16];
+    float cluster_depth_params[4];
+    int   cluster_dimensions[4];
+    VROLightData clustered_lights[kMaxClusteredLights];
+} VROClusteredLightingData;
+
+class VRODriverOpenGL;
+
+/*
+ Uploads a VROLightClusterGrid to the GPU for clustered forward lighting. The
+ grid is split across three UBOs, each of which fits in the 16KB minimum block
+ size guaranteed by GLES 3.0:
+ 
+ 1. clustered_lighting: the grid's view-projection and depth slice parameters,
+    and the clustered lights themselves (in the same format as the per-node
+    lighting UBO).
+ 2. cluster_headers_data: one 32-bit header per cluster, packed four to a uvec4,
+    holding the offset and count of the cluster's light indices.
+ 3. cluster_indices_data: the 8-bit light indices of all clusters, packed
+    sixteen to a uvec4.
+ 
+ UBOs are used instead of SSBOs or buffer textures so that clustering runs on
+ any GLES 3.0 device. A single instance is shared by all materials, through
+ VRODriverOpenGL.
+ */
+class VROLightClusterUBO {
+public:
+    
+    VROLightClusterUBO(std::shared_ptr<VRODriverOpenGL> driver);
+    virtual ~VROLightClusterUBO();
+    
+    /*
+     Bind the given grid to the clustered lighting binding points, first
+     uploading it if it has changed since the last bind.
+     */
+    void bind(const std::shared_ptr<VROLightClusterGrid> &grid);
+    
+private:
+    
+    GLuint _lightsUBO;
+    GLuint _headersUBO;
+    GLuint _indicesUBO;
+    std::weak_ptr<VRODriverOpenGL> _driver;
+    
+    /*
+     The grid and grid version last uploaded.
+     */
+    std::weak_ptr<VROLightClusterGrid> _uploadedGrid;
+    uint32_t _uploadedVersion;
+    
+    void upload(const VROLightClusterGrid &grid);
+    
+};
+
+#endif /* VROLightClusterUBO_h */
@@ -77,6 +77,24 @@ void VROLightingUBO::bind() {
     }
 }
 
+void VROLightingUBO::encodeLight(const std::shared_ptr<VROLight> &light, VROVector3f color,
+                                 VROLightData *outData) {
+    outData->type = (int) light->getType();
+    outData->shadow_map_index = light->getShadowMapIndex();
+    outData->shadow_bias = light->getShadowBias();
+    outData->shadow_opacity = light->getShadowOpacity();
+    outData->shadow_cascade_count = (int) light->getShadowCascades().size();
+    light->getTransformedPosition().toArray(outData->position);
+    light->getTransformedDirection().toArray(outData->direction);
+    color.toArray(outData->color);
+    outData->intensity = light->getIntensity();
+    outData->attenuation_start_distance = light->getAttenuationStartDistance();
+    outData->attenuation_end_distance = light->getAttenuationEndDistance();
+    outData->attenuation_falloff_exp = light->getAttenuationFalloffExponent();
+    outData->spot_inner_angle = cos(degrees_to_radians(light->getSpotInnerAngle() * 0.5));
+    outData->spot_outer_angle = cos(degrees_to_radians(light->getSpotOuterAngle() * 0.5));
+}
+
 void VROLightingUBO::updateLightsFragment() {
     pglpush("Lights [Fragment]");
     std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
@@ -102,19 +120,23 @@ void VROLightingUBO::updateLightsFragment() {
         else {
             int index = data.num_lights;
             
-            data.lights[index].type = (int) light->getType();
-            data.lights[index].shadow_map_index = light->getShadowMapIndex();
-            data.lights[index].shadow_bias = light->getShadowBias();
-            data.lights[index].shadow_opacity = light->getShadowOpacity();
-            light->getTransformedPosition().toArray(data.lights[index].position);
-            light->getTransformedDirection().toArray(data.lights[index].direction);
-            color.toArray(data.lights[index].color);
-            data.lights[index].intensity = light->getIntensity();
-            data.lights[index].attenuation_start_distance = light->getAttenuationStartDistance();
-            data.lights[index].attenuation_end_distance = light->getAttenuationEndDistance();
-            data.lights[index].attenuation_falloff_exp = light->getAttenuationFalloffExponent();
-            data.lights[index].spot_inner_angle = cos(degrees_to_radians(light->getSpotInnerAngle() * 0.5));
-            data.lights[index].spot_outer_angle = cos(degrees_to_radians(light->getSpotOuterAngle() * 0.5));
+            encodeLight(light, color, &data.lights[index]);
+            
+            const std::vector<VROShadowCascade> &cascades = light->getShadowCascades();
+            for (int c = 0; c < kMaxShadowCascades; c++) {
+                bool valid = c < (int) cascades.size();
+                data.shadow_cascade_splits[index * 4 + c] = valid ? cascades[c].split : 0;
+                data.shadow_cascade_scales[index * 4 + c] = valid ? cascades[c].scale : 1;
+                data.shadow_cascade_offsets_x[index * 4 + c] = valid ? cascades[c].offsetX : 0;
+                data.shadow_cascade_offsets_y[index * 4 + c] = valid ? cascades[c].offsetY : 0;
+                data.shadow_cascade_layers[index * 4 + c] = valid ? cascades[c].layer : 0;
+            }
+            
+            VROVector4f casterBounds = light->getShadowCasterBounds();
+            data.shadow_caster_bounds[index * 4 + 0] = casterBounds.x;
+            data.shadow_caster_bounds[index * 4 + 1] = casterBounds.y;
+            data.shadow_caster_bounds[index * 4 + 2] = casterBounds.z;
+            data.shadow_caster_bounds[index * 4 + 3] = casterBounds.w;
             
             data.num_lights++;
             if (data.num_lights >= kMaxLights) {
@@ -28,6 +28,7 @@
 #define VROLightingUBO_h
 
 #include "VROOpenGL.h"
+#include "VROVector3f.h"
 #include <vector>
 #include <atomic>
 #include <memory>
@@ -60,7 +61,8 @@ typedef struct {
     int   shadow_map_index;
     float shadow_bias;
     float shadow_opacity;
-    float light_padding0, light_padding1, light_padding2;
+    int   shadow_cascade_count;
+    float light_padding1, light_padding2;
 } VROLightData;
 
 // Must match lighting_functions lighting_fragment layout
@@ -70,6 +72,17 @@ typedef struct {
     
     float ambient_light_color[4];
     VROLightData lights[kMaxLights];
+    
+    // The shadow cascades of each light (see VROShadowCascade), one vec4 per light,
+    // each holding up to kMaxShadowCascades values
+    float shadow_cascade_splits[4 * kMaxLights];
+    float shadow_cascade_scales[4 * kMaxLights];
+    float shadow_cascade_offsets_x[4 * kMaxLights];
+    float shadow_cascade_offsets_y[4 * kMaxLights];
+    float shadow_cascade_layers[4 * kMaxLights];
+    
+    // The shadow caster bounds of each light (see VROLight::getShadowCasterBounds)
+    float shadow_caster_bounds[4 * kMaxLights];
 } VROLightingFragmentData;
 
 // Must match standard_vsh lighting_vertex layout
@@ -142,6 +155,14 @@ class VROLightingUBO {
     
 public:
     
+    /*
+     Write the given non-ambient light into the given VROLightData, with the
+     given (final, color-space converted) color. Shared with the clustered
+     lighting UBO.
+     */
+    static void encodeLight(const std::shared_ptr<VROLight> &light, VROVector3f color,
+                            VROLightData *outData);
+    
     VROLightingUBO(int hash, const std::vector<std::shared_ptr<VROLight>> &lights,
                    std::shared_ptr<VRODriverOpenGL> driver);
     virtual ~VROLightingUBO();
@@ -0,0 +1,100 @@
+//
+//  VROMPSCQueue.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROMPSCQueue_h
+#define VROMPSCQueue_h
+
+#include "VROAtomic.h"
+#include <utility>
+
+/*
+ Unbounded lock-free multiple-producer, single-consumer queue (after Dmitry
+ Vyukov's intrusive MPSC node queue). Any thread may push(); only a single
+ consumer thread may pop(). Producers never wait on each other or on the
+ consumer: a push is one allocation and one atomic exchange.
+
+ A push that is still in progress when the consumer reaches it is not yet
+ visible, so pop() may return false while a concurrent push is completing;
+ the element is returned by a later pop().
+ */
+template <typename T>
+class VROMPSCQueue {
+public:
+
+    VROMPSCQueue() {
+        Node *stub = new Node();
+        _head = stub;
+        _tail = stub;
+    }
+
+    virtual ~VROMPSCQueue() {
+        T value;
+        while (pop(&value)) {}
+        delete (_tail);
+    }
+
+    void push(T value) {
+        Node *node = new Node();
+        node->value = std::move(value);
+
+        Node *previous = _head.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_release);
+    }
+
+    /*
+     Pop the oldest element into outValue. Consumer thread only.
+     */
+    bool pop(T *outValue) {
+        Node *tail = _tail;
+        Node *next = tail->next.load(std::memory_order_acquire);
+        if (next == nullptr) {
+            return false;
+        }
+
+        // The next node becomes the new stub, so its value is moved out
+        *outValue = std::move(next->value);
+        _tail = next;
+        delete (tail);
+        return true;
+    }
+
+private:
+
+    struct Node {
+        Node() : next(nullptr) {}
+        VROAtomic<Node *> next;
+        T value;
+    };
+
+    /*
+     Producers push onto the head; the consumer pops from the tail, which is
+     always a stub node whose value has already been consumed.
+     */
+    VROAtomic<Node *> _head;
+    Node *_tail;
+
+};
+
+#endif /* VROMPSCQueue_h */
@@ -33,6 +33,7 @@
 #include "VROSortKey.h"
 #include "VROThreadRestricted.h"
 #include "VROLog.h"
+#include "VRORenderInvalidation.h"
 #include <atomic>
 #include <algorithm>
 
@@ -50,15 +51,19 @@ VROMaterial::VROMaterial() : VROThreadRestricted(VROThreadName::Renderer),
     _blendMode(VROBlendMode::Alpha),
     _writesToDepthBuffer(true),
     _readsFromDepthBuffer(true),
+    _orderIndependent(false),
     _colorWriteMask(VROColorMaskAll),
     _bloomThreshold(-1),
     _postProcessMask(false),
+    _equirectangularDiffuse(false),
     _receivesShadows(true),
+    _shadowCatcher(false),
     _castsShadows(true),
     _chromaKeyFilteringEnabled(false),
     _chromaKeyFilteringColor({ 0, 1, 0 }),
     _needsToneMapping(true),
     _renderingOrder(0),
+    _crossfading(false),
     _substrate(nullptr) {
    
     _diffuse          = new VROMaterialVisual(*this, (int)VROTextureType::None |
@@ -98,15 +103,19 @@ VROMaterial::VROMaterial(std::shared_ptr<VROMaterial> material) : VROThreadRestr
  _blendMode(material->_blendMode),
  _writesToDepthBuffer(material->_writesToDepthBuffer),
  _readsFromDepthBuffer(material->_readsFromDepthBuffer),
+ _orderIndependent(material->_orderIndependent),
  _colorWriteMask(material->_colorWriteMask),
  _bloomThreshold(material->_bloomThreshold),
  _postProcessMask(material->_postProcessMask),
+ _equirectangularDiffuse(material->_equirectangularDiffuse),
  _receivesShadows(material->_receivesShadows),
+ _shadowCatcher(material->_shadowCatcher),
  _castsShadows(material->_castsShadows),
  _chromaKeyFilteringEnabled(material->_chromaKeyFilteringEnabled),
  _chromaKeyFilteringColor(material->_chromaKeyFilteringColor),
  _needsToneMapping(material->needsToneMapping()),
  _renderingOrder(material->_renderingOrder),
+ _crossfading(false),
  _substrate(nullptr) {
  
      _diffuse = new VROMaterialVisual(*this, *material->_diffuse);
@@ -164,10 +173,13 @@ void VROMaterial::copyFrom(std::shared_ptr<VROMaterial> material) {
     _blendMode = material->_blendMode;
     _writesToDepthBuffer = material->_writesToDepthBuffer;
     _readsFromDepthBuffer = material->_readsFromDepthBuffer;
+    _orderIndependent = material->_orderIndependent;
     _colorWriteMask = material->_colorWriteMask;
     _bloomThreshold = material->_bloomThreshold;
     _postProcessMask = material->_postProcessMask;
+    _equirectangularDiffuse = material->_equirectangularDiffuse;
     _receivesShadows = material->_receivesShadows;
+    _shadowCatcher = material->_shadowCatcher;
     _castsShadows = material->_castsShadows;
     _chromaKeyFilteringEnabled = material->_chromaKeyFilteringEnabled;
     _chromaKeyFilteringColor = material->_chromaKeyFilteringColor;
@@ -226,6 +238,17 @@ bool VROMaterial::isHydrated() {
     return true;
 }
 
+void VROMaterial::updateTextureScreenSize(float pixels, int frame) {
+    VROMaterialVisual *visuals[10] = { _diffuse, _roughness, _metalness, _specular, _normal, _reflective,
+                                       _emission, _multiply, _ambientOcclusion, _selfIllumination };
+    for (int i = 0; i < 10; i++) {
+        VROMaterialVisual *visual = visuals[i];
+        if (visual->getTextureType() != VROTextureType::None && visual->getTexture()) {
+            visual->getTexture()->updateScreenSize(pixels, frame);
+        }
+    }
+}
+
 void VROMaterial::setTransparency(float transparency) {
     animate(std::make_shared<VROAnimationFloat>([](VROAnimatable *const animatable, float v) {
         ((VROMaterial *)animatable)->_transparency = v;
@@ -314,9 +337,16 @@ bool VROMaterial::hasShaderModifier(std::shared_ptr<VROShaderModifier> modifier)
 
 void VROMaterial::removeOutgoingMaterial() {
     _outgoing.reset();
+
+    // The cross-fading shader reads from the outgoing material
+    if (_crossfading) {
+        _crossfading = false;
+        updateSubstrate();
+    }
 }
 
 void VROMaterial::updateSubstrateTextures() {
+    VRORenderInvalidation::invalidate();
     if (_substrate) {
         _substrate->updateTextures();
     }
@@ -324,6 +354,7 @@ void VROMaterial::updateSubstrateTextures() {
 
 void VROMaterial::updateSubstrate() {
     passert_thread(__func__);
+    VRORenderInvalidation::invalidate();
     if (_substrate != nullptr) {
         delete (_substrate);
     }
@@ -332,6 +363,7 @@ void VROMaterial::updateSubstrate() {
 
 VROMaterialSubstrate *const VROMaterial::getSubstrate(std::shared_ptr<VRODriver> &driver) {
     if (!_substrate) {
+        _crossfading = _outgoing && driver->isMaterialCrossfadeSupported() && isCrossfadableWith(*_outgoing);
         _substrate = driver->newMaterialSubstrate(*this);
     }
     return _substrate;
@@ -360,6 +392,13 @@ bool VROMaterial::bindShader(int lightsHash,
     return getSubstrate(driver)->bindShader(lightsHash, lights, context, driver);
 }
 
+bool VROMaterial::bindInstancedShader(int lightsHash,
+                                      const std::vector<std::shared_ptr<VROLight>> &lights,
+                                      const VRORenderContext &context,
+                                      std::shared_ptr<VRODriver> &driver) {
+    return getSubstrate(driver)->bindInstancedShader(lightsHash, lights, context, driver);
+}
+
 bool VROMaterial::hasDiffuseAlpha() const {
     if (_diffuse->getTextureType() == VROTextureType::None) {
         return _diffuse->getColor().w < (1.0 - kEpsilon);
@@ -370,6 +409,195 @@ bool VROMaterial::hasDiffuseAlpha() const {
     }
 }
 
+bool VROMaterial::isBatchableWith(const VROMaterial &material) const {
+    std::shared_ptr<VROTexture> diffuse = _diffuse->getTexture();
+    std::shared_ptr<VROTexture> otherDiffuse = material._diffuse->getTexture();
+    if (!diffuse || !otherDiffuse) {
+        return false;
+    }
+    uint32_t arrayId = diffuse->getTextureArrayId();
+    uint32_t atlasId = diffuse->getTextureAtlasId();
+    bool sameArray = arrayId != 0 && otherDiffuse->getTextureArrayId() == arrayId;
+    bool sameAtlas = atlasId != 0 && otherDiffuse->getTextureAtlasId() == atlasId;
+    if (!sameArray && !sameAtlas) {
+        return false;
+    }
+    if (_outgoing || material._outgoing || !_shaderModifiers.empty() || !material._shaderModifiers.empty()) {
+        return false;
+    }
+    
+    return _diffuse->getColor().isEqual(material._diffuse->getColor()) &&
+           _diffuse->getIntensity() == material._diffuse->getIntensity() &&
+           _roughness->isIdenticalTo(*material._roughness) &&
+           _metalness->isIdenticalTo(*material._metalness) &&
+           _specular->isIdenticalTo(*material._specular) &&
+           _normal->isIdenticalTo(*material._normal) &&
+           _reflective->isIdenticalTo(*material._reflective) &&
+           _emission->isIdenticalTo(*material._emission) &&
+           _multiply->isIdenticalTo(*material._multiply) &&
+           _ambientOcclusion->isIdenticalTo(*material._ambientOcclusion) &&
+           _selfIllumination->isIdenticalTo(*material._selfIllumination) &&
+           _shininess == material._shininess &&
+           _fresnelExponent == material._fresnelExponent &&
+           _transparency == material._transparency &&
+           _transparencyMode == material._transparencyMode &&
+           _lightingModel == material._lightingModel &&
+           _litPerPixel == material._litPerPixel &&
+           _cullMode == material._cullMode &&
+           _blendMode == material._blendMode &&
+           _writesToDepthBuffer == material._writesToDepthBuffer &&
+           _readsFromDepthBuffer == material._readsFromDepthBuffer &&
+           _orderIndependent == material._orderIndependent &&
+           _colorWriteMask == material._colorWriteMask &&
+           _bloomThreshold == material._bloomThreshold &&
+           _postProcessMask == material._postProcessMask &&
+           _equirectangularDiffuse == material._equirectangularDiffuse &&
+           _receivesShadows == material._receivesShadows &&
+           _shadowCatcher == material._shadowCatcher &&
+           _castsShadows == material._castsShadows &&
+           _chromaKeyFilteringEnabled == material._chromaKeyFilteringEnabled &&
+           _chromaKeyFilteringColor.isEqual(material._chromaKeyFilteringColor) &&
+           _needsToneMapping == material._needsToneMapping &&
+           _renderingOrder == material._renderingOrder;
+}
+
+bool VROMaterial::isCrossfadableWith(const VROMaterial &outgoing) const {
+    if (!_shaderModifiers.empty() || !outgoing._shaderModifiers.empty()) {
+        return false;
+    }
+
+    // Both diffuse textures must be absent or sampled by the same plain 2D sampler
+    std::shared_ptr<VROTexture> diffuse = _diffuse->getTexture();
+    std::shared_ptr<VROTexture> outgoingDiffuse = outgoing._diffuse->getTexture();
+    VROTextureType type = _diffuse->getTextureType();
+    if (type != outgoing._diffuse->getTextureType() || !_diffuse->hasSameTransformAs(*outgoing._diffuse)) {
+        return false;
+    }
+    if (type == VROTextureType::Texture2D) {
+        for (const std::shared_ptr<VROTexture> &texture : { diffuse, outgoingDiffuse }) {
+            if (texture->getInternalFormat() == VROTextureInternalFormat::YCBCR ||
+                texture->getInternalFormat() == VROTextureInternalFormat::RG8 ||
+                texture->getTextureArrayId() != 0 ||
+                texture->getTextureAtlasId() != 0 ||
+                texture->getStereoMode() != VROStereoMode::None) {
+                return false;
+            }
+        }
+    }
+    else if (type != VROTextureType::None) {
+        return false;
+    }
+
+    return _roughness->isIdenticalTo(*outgoing._roughness) &&
+           _metalness->isIdenticalTo(*outgoing._metalness) &&
+           _specular->isIdenticalTo(*outgoing._specular) &&
+           _normal->isIdenticalTo(*outgoing._normal) &&
+           _reflective->isIdenticalTo(*outgoing._reflective) &&
+           _emission->isIdenticalTo(*outgoing._emission) &&
+           _multiply->isIdenticalTo(*outgoing._multiply) &&
+           _ambientOcclusion->isIdenticalTo(*outgoing._ambientOcclusion) &&
+           _selfIllumination->isIdenticalTo(*outgoing._selfIllumination) &&
+           _shininess == outgoing._shininess &&
+           _fresnelExponent == outgoing._fresnelExponent &&
+           _transparencyMode == outgoing._transparencyMode &&
+           _lightingModel == outgoing._lightingModel &&
+           _litPerPixel == outgoing._litPerPixel &&
+           _cullMode == outgoing._cullMode &&
+           _blendMode == outgoing._blendMode &&
+           _writesToDepthBuffer == outgoing._writesToDepthBuffer &&
+           _readsFromDepthBuffer == outgoing._readsFromDepthBuffer &&
+           _orderIndependent == outgoing._orderIndependent &&
+           _colorWriteMask == outgoing._colorWriteMask &&
+           _bloomThreshold == outgoing._bloomThreshold &&
+           _postProcessMask == outgoing._postProcessMask &&
+           _equirectangularDiffuse == outgoing._equirectangularDiffuse &&
+           _receivesShadows == outgoing._receivesShadows &&
+           _shadowCatcher == outgoing._shadowCatcher &&
+           _castsShadows == outgoing._castsShadows &&
+           _chromaKeyFilteringEnabled == outgoing._chromaKeyFilteringEnabled &&
+           _chromaKeyFilteringColor.isEqual(outgoing._chromaKeyFilteringColor) &&
+           _needsToneMapping == outgoing._needsToneMapping &&
+           _renderingOrder == outgoing._renderingOrder;
+}
+
+bool VROMaterial::isIdenticalTo(const VROMaterial &material) const {
+    if (this == &material) {
+        return true;
+    }
+    if (_outgoing || material._outgoing || _name != material._name ||
+        _shaderModifiers != material._shaderModifiers) {
+        return false;
+    }
+    
+    return _diffuse->isIdenticalTo(*material._diffuse) &&
+           _roughness->isIdenticalTo(*material._roughness) &&
+           _metalness->isIdenticalTo(*material._metalness) &&
+           _specular->isIdenticalTo(*material._specular) &&
+           _normal->isIdenticalTo(*material._normal) &&
+           _reflective->isIdenticalTo(*material._reflective) &&
+           _emission->isIdenticalTo(*material._emission) &&
+           _multiply->isIdenticalTo(*material._multiply) &&
+           _ambientOcclusion->isIdenticalTo(*material._ambientOcclusion) &&
+           _selfIllumination->isIdenticalTo(*material._selfIllumination) &&
+           _shininess == material._shininess &&
+           _fresnelExponent == material._fresnelExponent &&
+           _transparency == material._transparency &&
+           _transparencyMode == material._transparencyMode &&
+           _lightingModel == material._lightingModel &&
+           _litPerPixel == material._litPerPixel &&
+           _cullMode == material._cullMode &&
+           _blendMode == material._blendMode &&
+           _writesToDepthBuffer == material._writesToDepthBuffer &&
+           _readsFromDepthBuffer == material._readsFromDepthBuffer &&
+           _orderIndependent == material._orderIndependent &&
+           _colorWriteMask == material._colorWriteMask &&
+           _bloomThreshold == material._bloomThreshold &&
+           _postProcessMask == material._postProcessMask &&
+           _equirectangularDiffuse == material._equirectangularDiffuse &&
+           _receivesShadows == material._receivesShadows &&
+           _shadowCatcher == material._shadowCatcher &&
+           _castsShadows == material._castsShadows &&
+           _chromaKeyFilteringEnabled == material._chromaKeyFilteringEnabled &&
+           _chromaKeyFilteringColor.isEqual(material._chromaKeyFilteringColor) &&
+           _needsToneMapping == material._needsToneMapping &&
+           _renderingOrder == material._renderingOrder;
+}
+
+size_t VROMaterial::hashProperties() const {
+    std::hash<float> hashFloat;
+    size_t h = std::hash<std::string>()(_name);
+    for (const VROMaterialVisual *visual : { _diffuse, _roughness, _metalness, _specular, _normal, _reflective,
+                                             _emission, _multiply, _ambientOcclusion, _selfIllumination }) {
+        h = 31 * h + visual->hash();
+    }
+    for (const std::shared_ptr<VROShaderModifier> &modifier : _shaderModifiers) {
+        h = 31 * h + std::hash<VROShaderModifier *>()(modifier.get());
+    }
+    h = 31 * h + hashFloat(_shininess);
+    h = 31 * h + hashFloat(_fresnelExponent);
+    h = 31 * h + hashFloat(_transparency);
+    h = 31 * h + hashFloat(_bloomThreshold);
+    h = 31 * h + (size_t) _transparencyMode;
+    h = 31 * h + (size_t) _lightingModel;
+    h = 31 * h + (size_t) _cullMode;
+    h = 31 * h + (size_t) _blendMode;
+    h = 31 * h + (size_t) _colorWriteMask;
+    h = 31 * h + (size_t) _renderingOrder;
+    h = 31 * h + ((_litPerPixel << 0) | (_writesToDepthBuffer << 1) | (_readsFromDepthBuffer << 2) |
+                  (_orderIndependent << 3) | (_postProcessMask << 4) | (_equirectangularDiffuse << 5) |
+                  (_receivesShadows << 6) | (_shadowCatcher << 7) | (_castsShadows << 8) |
+                  (_chromaKeyFilteringEnabled << 9) | (_needsToneMapping << 10));
+    return h;
+}
+
+float VROMaterial::getCrossfadeWeight() const {
+    if (!_crossfading) {
+        return 1.0;
+    }
+    float total = _transparency + _outgoing->_transparency;
+    return total > 0 ? _transparency / total : 1.0;
+}
+
 void VROMaterial::setChromaKeyFilteringEnabled(bool enabled) {
     _chromaKeyFilteringEnabled = enabled;
     updateSubstrate();
@@ -55,6 +55,7 @@ enum class VROBlendMode {
     Subtract,
     Screen,
     PremultiplyAlpha,
+    WeightedTransparency, // Internal: accumulation of weighted blended OIT
 };
 
 enum class VROTransparencyMode {
@@ -106,6 +107,12 @@ public:
      */
     int hydrateAsync(std::function<void()> callback,
                      std::shared_ptr<VRODriver> &driver);
+
+    /*
+     True if this material's substrate has been created and all of its
+     textures have been uploaded.
+     */
+    bool isHydrated();
     
     /*
      Delete any rendering resources. Invoked prior to destruction, on the
@@ -154,6 +161,16 @@ public:
                     const VRORenderContext &context,
                     std::shared_ptr<VRODriver> &driver);
     void bindProperties(std::shared_ptr<VRODriver> &driver);
+    
+    /*
+     Bind the instanced variant of this material's shader, used to render many
+     nodes sharing a geometry in one draw. Returns false if the shader could not
+     be bound, or if the platform does not support instancing.
+     */
+    bool bindInstancedShader(int lightsHash,
+                             const std::vector<std::shared_ptr<VROLight>> &lights,
+                             const VRORenderContext &context,
+                             std::shared_ptr<VRODriver> &driver);
 
     VROMaterialVisual &getDiffuse() const {
         return *_diffuse;
@@ -265,6 +282,21 @@ public:
         updateSubstrate();
     }
     
+    /*
+     Order independence. Transparent objects are normally sorted back to front. An
+     order-independent material is instead rendered after the sorted transparent
+     objects, grouped only by render state. This is only honored for materials whose
+     blending is commutative (VROBlendMode::Add) and that do not write depth, since
+     only then is the result the same in any order. Alpha-blended objects in front
+     of these materials will not occlude them.
+     */
+    void setOrderIndependent(bool orderIndependent) {
+        _orderIndependent = orderIndependent;
+    }
+    bool isOrderIndependent() const {
+        return _orderIndependent && _blendMode == VROBlendMode::Add && !_writesToDepthBuffer;
+    }
+
     /*
      Color writes.
      */
@@ -304,6 +336,20 @@ public:
         return _postProcessMask;
     }
 
+    /*
+     Equirectangular diffuse. If true, the diffuse texture is an equirectangular
+     (360) image around the viewer, sampled along the direction to each fragment's
+     surface position instead of at its texture coordinates. Used by backgrounds
+     that are drawn as full-screen quads (see VROBackgroundQuad).
+     */
+    void setEquirectangularDiffuse(bool equirectangular) {
+        _equirectangularDiffuse = equirectangular;
+        updateSubstrate();
+    }
+    bool isEquirectangularDiffuse() const {
+        return _equirectangularDiffuse;
+    }
+
     /*
      Shadows.
      */
@@ -314,6 +360,19 @@ public:
     bool getReceivesShadows() const {
         return _receivesShadows;
     }
+    
+    /*
+     Shadow catchers are invisible surfaces that only render the shadows cast onto
+     them, such as the virtual shadows on real-world planes in AR. Set by
+     VROARShadow.
+     */
+    void setShadowCatcher(bool shadowCatcher) {
+        _shadowCatcher = shadowCatcher;
+        updateSubstrate();
+    }
+    bool isShadowCatcher() const {
+        return _shadowCatcher;
+    }
 
     void setCastsShadows(bool castsShadows) {
         _castsShadows = castsShadows;
@@ -372,12 +431,39 @@ public:
     /*
      Make a snapshot of this material and cross-fade that snapshot out,
      bringing in the current material. Used to animate material changes.
-     No effect if there is no active animation transaction.
+     No effect if there is no active animation transaction. Compatible
+     materials are cross-faded in a single draw, see isCrossfading().
      */
     void fadeSnapshot();
-    std::shared_ptr<VROMaterial> getOutgoing() const {
+    const std::shared_ptr<VROMaterial> &getOutgoing() const {
         return _outgoing;
     }
+
+    /*
+     True if the outgoing material is blended into this material within a single
+     draw, instead of being rendered separately. This is decided each time the
+     substrate is created, and holds when the driver supports it and the two
+     materials differ only in their diffuse contents (see isCrossfadableWith).
+     The outgoing material is then not rendered at all.
+     */
+    bool isCrossfading() const {
+        return _crossfading;
+    }
+
+    /*
+     Get the transparency this material renders with. When cross-fading in a single
+     draw, this is the combined transparency of the incoming and outgoing materials,
+     which fadeSnapshot() splits between the two over the course of the fade.
+     */
+    float getRenderedTransparency() const {
+        return _crossfading ? _transparency + _outgoing->_transparency : _transparency;
+    }
+
+    /*
+     Get the weight of this material's diffuse contents against the outgoing
+     material's contents, from 0 (fully outgoing) to 1, when cross-fading.
+     */
+    float getCrossfadeWeight() const;
     
     /*
      Check if the material has been updated since the last substrate was
@@ -412,11 +498,49 @@ public:
                        const VRORenderContext &context,
                        std::shared_ptr<VRODriver> &driver);
 
+    /*
+     Record the on-screen size, in pixels, of geometry using this material during
+     the given frame, for its streamed textures (see VROTexture::setStreamingSource).
+     */
+    void updateTextureScreenSize(float pixels, int frame);
+
     /*
      Return true if this material has an alpha channel associated with its diffuse color or
      texture.
      */
     bool hasDiffuseAlpha() const;
+    
+    /*
+     Return true if this material can be rendered in the same batch as the given
+     material, sharing one shader and set of uniforms: the two must be identical
+     except for their diffuse textures, which must be layers of the same texture
+     array or regions of the same atlas page (see VROTexture::setArrayPackingEnabled
+     and setAtlasPackingEnabled). Each draw in the batch then selects its own
+     layer or region.
+     */
+    bool isBatchableWith(const VROMaterial &material) const;
+
+    /*
+     Return true if the given outgoing material can be cross-faded into this material
+     in a single draw. The two must be identical except for their transparency and
+     their diffuse color, intensity, and texture; the diffuse textures, if any, must
+     both be plain 2D textures sampled with the same transform.
+     */
+    bool isCrossfadableWith(const VROMaterial &outgoing) const;
+
+    /*
+     Return true if this material is identical to the given material in every
+     property, including its name, texture identities, and shader modifiers, so
+     that one can stand in for the other. Materials that are fading out an
+     outgoing material are never identical to another material.
+     */
+    bool isIdenticalTo(const VROMaterial &material) const;
+
+    /*
+     Hash of the properties compared by isIdenticalTo(): identical materials have
+     the same hash.
+     */
+    size_t hashProperties() const;
 
     /*
      Returns a VROBlendMode for the given string. If no matching blend modes were found,
@@ -522,6 +646,11 @@ private:
      */
     bool _writesToDepthBuffer, _readsFromDepthBuffer;
     
+    /*
+     True if this material opts out of the transparent sort. See setOrderIndependent().
+     */
+    bool _orderIndependent;
+    
     /*
      Color mask settings. Materials will only write to color channels that are true
      in this bitfield. If all of these are set to off, then the material will not
@@ -535,6 +664,12 @@ private:
      values of this material whenever this material is changed.
      */
     std::shared_ptr<VROMaterial> _outgoing;
+
+    /*
+     True if _outgoing is blended into this material by its shader, see
+     isCrossfading().
+     */
+    bool _crossfading;
     
     /*
      Modifiers to alter the shader code.
@@ -552,10 +687,21 @@ private:
      */
     bool _postProcessMask;
 
+    /*
+     True if the diffuse texture is sampled as an equirectangular image along the
+     direction to the surface position.
+     */
+    bool _equirectangularDiffuse;
+
     /*
      True if this material receives shadows. Defaults to true.
      */
     bool _receivesShadows;
+    
+    /*
+     True if this material only renders the shadows cast onto it.
+     */
+    bool _shadowCatcher;
 
     /*
      True if surfaces using this material cast shadows. Note: due to a technical limitation,
@@ -599,7 +745,6 @@ private:
     VROMaterialSubstrate *_substrate;
     
     void removeOutgoingMaterial();
-    bool isHydrated();
     
 };
 
@@ -33,7 +33,12 @@
 #include "VROMaterial.h"
 #include "VROEye.h"
 #include "VRODriver.h"
+#include "VRODriverOpenGL.h"
+#include "VROUniformRingBuffer.h"
 #include "VROTextureReference.h"
+#include "VRORenderContext.h"
+#include "VROStringUtil.h"
+#include "VROSphericalHarmonics.h"
 #include "VROMath.h"
 
 VROMaterialShaderBinding::VROMaterialShaderBinding(std::shared_ptr<VROShaderProgram> program,
@@ -56,7 +61,8 @@ VROMaterialShaderBinding::VROMaterialShaderBinding(std::shared_ptr<VROShaderProg
     _viewMatrixUniform(nullptr),
     _projectionMatrixUniform(nullptr),
     _cameraPositionUniform(nullptr),
-    _eyeTypeUniform(nullptr) {
+    _eyeTypeUniform(nullptr),
+    _shCoefficientsUniform(nullptr) {
     
     loadUniforms();
     loadTextures();
@@ -85,6 +91,17 @@ void VROMaterialShaderBinding::loadUniforms() {
     _viewMatrixUniform = program->getUniform("view_matrix");
     _cameraPositionUniform = program->getUniform("camera_position");
     _eyeTypeUniform = program->getUniform("eye_type");
+    if (lightingShaderCapabilities.sphericalHarmonicsIrradiance) {
+        _shCoefficientsUniform = program->getUniform("sh_coefficients");
+    }
+
+    if (program->isMultiview()) {
+        for (int i = 0; i < kMultiviewNumViews; i++) {
+            std::string index = "[" + VROStringUtil::toString(i) + "]";
+            _multiviewViewMatrixUniforms.push_back(program->getUniform("view_matrices" + index));
+            _multiviewProjectionMatrixUniforms.push_back(program->getUniform("projection_matrices" + index));
+        }
+    }
     
     for (const std::shared_ptr<VROShaderModifier> &modifier : program->getModifiers()) {
         std::vector<std::string> uniformNames = modifier->getUniforms();
@@ -109,6 +126,10 @@ void VROMaterialShaderBinding::loadTextures() {
         if (sampler == "diffuse_texture" || sampler == "diffuse_texture_y") {
             _textures.emplace_back(_material.getDiffuse().getTexture());
         }
+        else if (sampler == "crossfade_diffuse_texture") {
+            const std::shared_ptr<VROMaterial> &outgoing = _material.getOutgoing();
+            _textures.emplace_back(outgoing ? outgoing->getDiffuse().getTexture() : _material.getDiffuse().getTexture());
+        }
         else if (sampler == "specular_texture") {
             _textures.emplace_back(_material.getSpecular().getTexture());
         }
@@ -142,9 +163,23 @@ void VROMaterialShaderBinding::loadTextures() {
     }
 }
 
-void VROMaterialShaderBinding::bindViewUniforms(VROMatrix4f &modelMatrix, VROMatrix4f &viewMatrix,
-                                                VROMatrix4f &projectionMatrix, VROMatrix4f &normalMatrix,
-                                                VROVector3f &cameraPosition, VROEyeType &eyeType) {
+void VROMaterialShaderBinding::bindViewUniforms(const VROMatrix4f &modelMatrix, const VROMatrix4f &viewMatrix,
+                                                const VROMatrix4f &projectionMatrix, const VROMatrix4f &normalMatrix,
+                                                const VROVector3f &cameraPosition, VROEyeType eyeType,
+                                                std::shared_ptr<VRODriver> &driver) {
+    /*
+     Programs with the uniform ring enabled read the transforms from ranges of
+     the ring; their transform uniforms below have no location, and are skipped.
+     */
+    if (_program->hasDrawBlock() || _program->hasCameraBlock()) {
+        VROUniformRingBuffer *ring = static_cast<VRODriverOpenGL *>(driver.get())->getUniformRing();
+        if (ring && _program->hasDrawBlock()) {
+            ring->bindDrawData(modelMatrix, normalMatrix);
+        }
+        if (ring && _program->hasCameraBlock()) {
+            ring->bindCameraData(viewMatrix, projectionMatrix, cameraPosition);
+        }
+    }
     if (_normalMatrixUniform != nullptr) {
         _normalMatrixUniform->setMat4(normalMatrix);
     }
@@ -170,6 +205,14 @@ void VROMaterialShaderBinding::bindViewUniforms(VROMatrix4f &modelMatrix, VROMat
     }
 }
 
+void VROMaterialShaderBinding::bindMultiviewUniforms(const VROMatrix4f *viewMatrices,
+                                                     const VROMatrix4f *projectionMatrices) {
+    for (int i = 0; i < _multiviewViewMatrixUniforms.size(); i++) {
+        _multiviewViewMatrixUniforms[i]->setMat4(viewMatrices[i]);
+        _multiviewProjectionMatrixUniforms[i]->setMat4(projectionMatrices[i]);
+    }
+}
+
 void VROMaterialShaderBinding::bindMaterialUniforms(const VROMaterial &material,
                                                     std::shared_ptr<VRODriver> &driver) {
     if (_diffuseSurfaceColorUniform != nullptr) {
@@ -204,9 +247,26 @@ void VROMaterialShaderBinding::bindMaterialUniforms(const VROMaterial &material,
 
 void VROMaterialShaderBinding::bindGeometryUniforms(float opacity, const VROGeometry &geometry, const VROMaterial &material) {
     if (_alphaUniform != nullptr) {
-        _alphaUniform->setFloat(material.getTransparency() * opacity);
+        _alphaUniform->setFloat(material.getRenderedTransparency() * opacity);
     }
     for (auto binder_uniform : _modifierUniformBinders) {
         binder_uniform.first->setForMaterial(binder_uniform.second, &geometry, &material);
     }
 }
+
+void VROMaterialShaderBinding::bindLightingUniforms(const VRORenderContext &context) {
+    if (_shCoefficientsUniform == nullptr || !context.getIrradianceSphericalHarmonics()) {
+        return;
+    }
+    
+    VROVector3f coefficients[kSphericalHarmonicsCoefficients];
+    context.getIrradianceSphericalHarmonics()->getShaderCoefficients(coefficients);
+    
+    float values[kSphericalHarmonicsCoefficients * 3];
+    for (int i = 0; i < kSphericalHarmonicsCoefficients; i++) {
+        values[i * 3 + 0] = coefficients[i].x;
+        values[i * 3 + 1] = coefficients[i].y;
+        values[i * 3 + 2] = coefficients[i].z;
+    }
+    _shCoefficientsUniform->set(values);
+}
@@ -39,6 +39,7 @@ class VROTextureReference;
 class VROUniform;
 class VROUniformBinder;
 class VROShaderProgram;
+class VRORenderContext;
 enum class VROEyeType;
 
 /*
@@ -68,13 +69,26 @@ public:
      */
     VROLightingShaderCapabilities lightingShaderCapabilities;
     
-    void bindViewUniforms(VROMatrix4f &modelMatrix, VROMatrix4f &viewMatrix,
-                          VROMatrix4f &projectionMatrix, VROMatrix4f &normalMatrix,
-                          VROVector3f &cameraPosition, VROEyeType &eyeType);
+    void bindViewUniforms(const VROMatrix4f &modelMatrix, const VROMatrix4f &viewMatrix,
+                          const VROMatrix4f &projectionMatrix, const VROMatrix4f &normalMatrix,
+                          const VROVector3f &cameraPosition, VROEyeType eyeType,
+                          std::shared_ptr<VRODriver> &driver);
+
+    /*
+     Bind the per-view matrices of a multiview program, one view and projection per
+     view rendered. No-op if the program is not multiview.
+     */
+    void bindMultiviewUniforms(const VROMatrix4f *viewMatrices, const VROMatrix4f *projectionMatrices);
     void bindMaterialUniforms(const VROMaterial &material,
                               std::shared_ptr<VRODriver> &driver);
     void bindGeometryUniforms(float opacity, const VROGeometry &geometry, const VROMaterial &material);
     
+    /*
+     Bind the lighting environment state held by the render context that isn't
+     a texture: currently the spherical harmonics used for diffuse irradiance.
+     */
+    void bindLightingUniforms(const VRORenderContext &context);
+    
     std::shared_ptr<VROShaderProgram> &getProgram() {
         return _program;
     }
@@ -118,6 +132,13 @@ private:
     
     VROUniform *_cameraPositionUniform;
     VROUniform *_eyeTypeUniform;
+    VROUniform *_shCoefficientsUniform;
+
+    /*
+     Per-view matrix uniforms, populated only for multiview programs.
+     */
+    std::vector<VROUniform *> _multiviewViewMatrixUniforms;
+    std::vector<VROUniform *> _multiviewProjectionMatrixUniforms;
     std::vector<std::pair<VROUniformBinder *, VROUniform *>> _modifierUniformBinders;
     
     /*
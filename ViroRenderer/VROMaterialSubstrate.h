@@ -72,6 +72,26 @@ public:
                             const VRORenderContext &context,
                             std::shared_ptr<VRODriver> &driver) = 0;
     
+    /*
+     Bind the variant of this material's shader that renders a batch of instances
+     with per-instance transforms (see VROGeometry::renderInstanced). Returns false
+     if instancing is not supported, in which case nothing is bound.
+     */
+    virtual bool bindInstancedShader(int lightsHash,
+                                     const std::vector<std::shared_ptr<VROLight>> &lights,
+                                     const VRORenderContext &context,
+                                     std::shared_ptr<VRODriver> &driver) {
+        return false;
+    }
+    
+    /*
+     Begin building the shader this material uses with the given lights, without
+     binding it, so that it is ready by the time the material is first rendered.
+     */
+    virtual void prewarmShader(const std::vector<std::shared_ptr<VROLight>> &lights,
+                               const VRORenderContext &context,
+                               std::shared_ptr<VRODriver> &driver) {}
+    
     /*
      Bind the properties of this material to the active rendering context.
      These properties should be node and geometry independent. The shader
@@ -90,9 +110,10 @@ public:
      Bind the properties of the view and projection to the active rendering
      context.
      */
-    virtual void bindView(VROMatrix4f modelMatrix, VROMatrix4f viewMatrix,
-                          VROMatrix4f projectionMatrix, VROMatrix4f normalMatrix,
-                          VROVector3f cameraPosition, VROEyeType eyeType) = 0;
+    virtual void bindView(const VROMatrix4f &modelMatrix, const VROMatrix4f &viewMatrix,
+                          const VROMatrix4f &projectionMatrix, const VROMatrix4f &normalMatrix,
+                          const VROVector3f &cameraPosition, VROEyeType eyeType,
+                          std::shared_ptr<VRODriver> &driver) = 0;
     
 };
 
@@ -34,16 +34,20 @@
 #include "VROSortKey.h"
 #include "VROBoneUBO.h"
 #include "VROInstancedUBO.h"
+#include "VROInstancedTransformUBO.h"
+#include "VROShaderModifier.h"
 #include "VROShaderFactory.h"
 #include "VROMaterialShaderBinding.h"
 #include "VROTextureReference.h"
 #include <sstream>
+#include <algorithm>
 
 #pragma mark - Loading Materials
 
 VROMaterialSubstrateOpenGL::VROMaterialSubstrateOpenGL(VROMaterial &material, std::shared_ptr<VRODriverOpenGL> &driver) :
     _material(material),
-    _activeBinding(nullptr) {
+    _activeBinding(nullptr),
+    _activeBindingInstanced(false) {
 
     _materialShaderCapabilities = VROShaderCapabilities::deriveMaterialCapabilitiesKey(material);
     ALLOCATION_TRACKER_ADD(MaterialSubstrates, 1);
@@ -70,11 +74,28 @@ bool VROMaterialSubstrateOpenGL::bindShader(int lightsHash,
                                             const VRORenderContext &context,
                                             std::shared_ptr<VRODriver> &driver) {
     
-    _activeBinding = getShaderBindingForLights(lights, context, driver);
+    return bindShaderBinding(getShaderBindingForLights(lights, context, driver), false, lightsHash, lights, context, driver);
+}
+
+bool VROMaterialSubstrateOpenGL::bindInstancedShader(int lightsHash,
+                                                     const std::vector<std::shared_ptr<VROLight>> &lights,
+                                                     const VRORenderContext &context,
+                                                     std::shared_ptr<VRODriver> &driver) {
+    return bindShaderBinding(getInstancedShaderBindingForLights(lights, context, driver), true, lightsHash, lights, context, driver);
+}
+
+bool VROMaterialSubstrateOpenGL::bindShaderBinding(VROMaterialShaderBinding *binding, bool instanced, int lightsHash,
+                                                   const std::vector<std::shared_ptr<VROLight>> &lights,
+                                                   const VRORenderContext &context,
+                                                   std::shared_ptr<VRODriver> &driver) {
+    _activeBinding = binding;
+    _activeBindingInstanced = instanced;
     
+    // If the shader is still compiling, defer rendering until it's ready rather
+    // than stalling the frame
     std::shared_ptr<VROShaderProgram> &shader = _activeBinding->getProgram();
     if (!shader->isHydrated()) {
-        if (!shader->hydrate()) {
+        if (!shader->hydrateAsync()) {
             return false;
         }
     }
@@ -93,15 +114,27 @@ bool VROMaterialSubstrateOpenGL::bindShader(int lightsHash,
         }
     }
     _lightingUBO->bind();
+    
+    if (shader->hasClusteredLightingBlock() && context.getLightClusters()) {
+        glDriver.getLightClusterUBO()->bind(context.getLightClusters());
+    }
+    _activeBinding->bindLightingUniforms(context);
     return true;
 }
 
-void VROMaterialSubstrateOpenGL::bindView(VROMatrix4f modelMatrix, VROMatrix4f viewMatrix,
-                                          VROMatrix4f projectionMatrix, VROMatrix4f normalMatrix,
-                                          VROVector3f cameraPosition, VROEyeType eyeType) {
+void VROMaterialSubstrateOpenGL::bindView(const VROMatrix4f &modelMatrix, const VROMatrix4f &viewMatrix,
+                                          const VROMatrix4f &projectionMatrix, const VROMatrix4f &normalMatrix,
+                                          const VROVector3f &cameraPosition, VROEyeType eyeType,
+                                          std::shared_ptr<VRODriver> &driver) {
     passert(_activeBinding != nullptr);
     _activeBinding->bindViewUniforms(modelMatrix, viewMatrix, projectionMatrix, normalMatrix,
-                                     cameraPosition, eyeType);
+                                     cameraPosition, eyeType, driver);
+}
+
+void VROMaterialSubstrateOpenGL::bindMultiviewView(const VROMatrix4f *viewMatrices,
+                                                   const VROMatrix4f *projectionMatrices) {
+    passert(_activeBinding != nullptr);
+    _activeBinding->bindMultiviewUniforms(viewMatrices, projectionMatrices);
 }
 
 const std::vector<VROTextureReference> &VROMaterialSubstrateOpenGL::getTextures() const {
@@ -115,11 +148,16 @@ void VROMaterialSubstrateOpenGL::updateTextures() {
     for (auto &kv : _shaderBindings) {
         kv.second->loadTextures();
     }
+    for (auto &kv : _instancedShaderBindings) {
+        kv.second->loadTextures();
+    }
 }
 
 void VROMaterialSubstrateOpenGL::updateSortKey(VROSortKey &key, const std::vector<std::shared_ptr<VROLight>> &lights,
                                                const VRORenderContext &context,
                                                std::shared_ptr<VRODriver> driver) {
+    updateDiffuseTextureType();
+    
     VROMaterialShaderBinding *binding = getShaderBindingForLights(lights, context, driver);
     passert (binding != nullptr);
 
@@ -128,6 +166,13 @@ void VROMaterialSubstrateOpenGL::updateSortKey(VROSortKey &key, const std::vecto
     key.textures = hashTextures(binding->getTextures());
 }
 
+void VROMaterialSubstrateOpenGL::prewarmShader(const std::vector<std::shared_ptr<VROLight>> &lights,
+                                               const VRORenderContext &context,
+                                               std::shared_ptr<VRODriver> &driver) {
+    updateDiffuseTextureType();
+    getShaderBindingForLights(lights, context, driver);
+}
+
 VROMaterialShaderBinding *VROMaterialSubstrateOpenGL::getShaderBindingForLights(const std::vector<std::shared_ptr<VROLight>> &lights,
                                                                                 const VRORenderContext &context,
                                                                                 std::shared_ptr<VRODriver> driver) {
@@ -135,7 +180,7 @@ VROMaterialShaderBinding *VROMaterialSubstrateOpenGL::getShaderBindingForLights(
     VROLightingShaderCapabilities capabilities = VROShaderCapabilities::deriveLightingCapabilitiesKey(lights, context);
     
     // Optimized path: check the active binding
-    if (_activeBinding != nullptr && _activeBinding->lightingShaderCapabilities == capabilities) {
+    if (_activeBinding != nullptr && !_activeBindingInstanced && _activeBinding->lightingShaderCapabilities == capabilities) {
         return _activeBinding;
     }
     
@@ -148,20 +193,80 @@ VROMaterialShaderBinding *VROMaterialSubstrateOpenGL::getShaderBindingForLights(
     // Finally, check the shader factory, which will create a new shader if necessary
     std::shared_ptr<VROShaderProgram> shader = driverGL->getShaderFactory()->getShader(_materialShaderCapabilities, capabilities,
                                                                                        _material.getShaderModifiers(), driverGL);
-    if (!shader->isHydrated()) {
-        shader->hydrate();
+    if (!shader->isHydrated() && !shader->isHydrating()) {
+        shader->hydrateAsync();
     }
     VROMaterialShaderBinding *binding = new VROMaterialShaderBinding(shader, capabilities, _material);
     _shaderBindings[capabilities] = std::unique_ptr<VROMaterialShaderBinding>(binding);
     return binding;
 }
 
+VROMaterialShaderBinding *VROMaterialSubstrateOpenGL::getInstancedShaderBindingForLights(const std::vector<std::shared_ptr<VROLight>> &lights,
+                                                                                         const VRORenderContext &context,
+                                                                                         std::shared_ptr<VRODriver> driver) {
+    std::shared_ptr<VRODriverOpenGL> driverGL = std::dynamic_pointer_cast<VRODriverOpenGL>(driver);
+    VROLightingShaderCapabilities capabilities = VROShaderCapabilities::deriveLightingCapabilitiesKey(lights, context);
+    
+    auto it = _instancedShaderBindings.find(capabilities);
+    if (it != _instancedShaderBindings.end()) {
+        return it->second.get();
+    }
+    
+    // The instanced program is the material's program with the instancing modifier
+    // appended; the modifier is included in the capabilities key so the factory
+    // caches it separately
+    std::vector<std::shared_ptr<VROShaderModifier>> modifiers = _material.getShaderModifiers();
+    
+    // Skinned geometries are only instanced when skinned by a baked animation
+    std::replace(modifiers.begin(), modifiers.end(), VROBoneUBO::createSkinningShaderModifier(),
+                 VROBoneUBO::createBakedSkinningShaderModifier());
+    std::vector<std::shared_ptr<VROShaderModifier>> instanceModifiers = VROInstancedTransformUBO::getInstanceShaderModifiers();
+    modifiers.insert(modifiers.end(), instanceModifiers.begin(), instanceModifiers.end());
+    if (_materialShaderCapabilities.diffuseTexture == VRODiffuseTextureType::Array) {
+        modifiers.push_back(VROInstancedTransformUBO::getInstanceLayerShaderModifier());
+    }
+    else if (_materialShaderCapabilities.diffuseTexture == VRODiffuseTextureType::Atlas) {
+        modifiers.push_back(VROInstancedTransformUBO::getInstanceAtlasShaderModifier());
+    }
+    
+    VROMaterialShaderCapabilities materialCapabilities = _materialShaderCapabilities;
+    materialCapabilities.additionalModifierKeys = VROShaderModifier::getShaderModifierKey(modifiers);
+    
+    std::shared_ptr<VROShaderProgram> shader = driverGL->getShaderFactory()->getShader(materialCapabilities, capabilities,
+                                                                                       modifiers, driverGL);
+    if (!shader->isHydrated() && !shader->isHydrating()) {
+        shader->hydrateAsync();
+    }
+    VROMaterialShaderBinding *binding = new VROMaterialShaderBinding(shader, capabilities, _material);
+    _instancedShaderBindings[capabilities] = std::unique_ptr<VROMaterialShaderBinding>(binding);
+    return binding;
+}
+
 uint32_t VROMaterialSubstrateOpenGL::hashTextures(const std::vector<VROTextureReference> &textures) const {
     uint32_t h = 0;
     for (const VROTextureReference &texture : textures) {
         if (!texture.isGlobal()) {
-            h = 31 * h + texture.getLocalTexture()->getTextureId();
+            // Textures packed into the same array or atlas page bind the same GL texture
+            std::shared_ptr<VROTexture> local = texture.getLocalTexture();
+            uint32_t arrayId = local->getTextureArrayId();
+            uint32_t atlasId = local->getTextureAtlasId();
+            h = 31 * h + (arrayId != 0 ? arrayId : (atlasId != 0 ? atlasId : local->getTextureId()));
         }
     }
     return h;
 }
+
+void VROMaterialSubstrateOpenGL::updateDiffuseTextureType() {
+    std::shared_ptr<VROTexture> diffuse = _material.getDiffuse().getTexture();
+    bool layered = diffuse && diffuse->getTextureArrayId() != 0;
+    bool atlased = diffuse && diffuse->getTextureAtlasId() != 0;
+    if (layered == (_materialShaderCapabilities.diffuseTexture == VRODiffuseTextureType::Array) &&
+        atlased == (_materialShaderCapabilities.diffuseTexture == VRODiffuseTextureType::Atlas)) {
+        return;
+    }
+    
+    _materialShaderCapabilities = VROShaderCapabilities::deriveMaterialCapabilitiesKey(_material);
+    _activeBinding = nullptr;
+    _shaderBindings.clear();
+    _instancedShaderBindings.clear();
+}
@@ -71,6 +71,23 @@ public:
                     const VRORenderContext &context,
                     std::shared_ptr<VRODriver> &driver);
     
+    /*
+     Bind the instanced variant of this material's shader, which reads its model
+     and normal transforms from the VROInstancedTransformUBO.
+     */
+    bool bindInstancedShader(int lightsHash,
+                             const std::vector<std::shared_ptr<VROLight>> &lights,
+                             const VRORenderContext &context,
+                             std::shared_ptr<VRODriver> &driver);
+    
+    /*
+     Create the shader binding for the given lights, which begins compiling its
+     program.
+     */
+    void prewarmShader(const std::vector<std::shared_ptr<VROLight>> &lights,
+                       const VRORenderContext &context,
+                       std::shared_ptr<VRODriver> &driver);
+    
     /*
      Bind the properties of this material to the active rendering context.
      These properties should be node and geometry independent. The shader
@@ -89,9 +106,16 @@ public:
      Bind the properties of the view and projection to the active rendering
      context.
      */
-    void bindView(VROMatrix4f modelMatrix, VROMatrix4f viewMatrix,
-                  VROMatrix4f projectionMatrix, VROMatrix4f normalMatrix,
-                  VROVector3f cameraPosition, VROEyeType eyeType);
+    void bindView(const VROMatrix4f &modelMatrix, const VROMatrix4f &viewMatrix,
+                  const VROMatrix4f &projectionMatrix, const VROMatrix4f &normalMatrix,
+                  const VROVector3f &cameraPosition, VROEyeType eyeType,
+                  std::shared_ptr<VRODriver> &driver);
+
+    /*
+     Bind the per-view view and projection matrices, when the active binding uses
+     a multiview program.
+     */
+    void bindMultiviewView(const VROMatrix4f *viewMatrices, const VROMatrix4f *projectionMatrices);
     
     const std::vector<VROTextureReference> &getTextures() const;
     
@@ -110,6 +134,7 @@ private:
      to reduce lookups into the _programs map.
      */
     VROMaterialShaderBinding *_activeBinding;
+    bool _activeBindingInstanced;
     std::shared_ptr<VROLightingUBO> _lightingUBO;
     
     /*
@@ -128,6 +153,12 @@ private:
      */
     std::map<VROLightingShaderCapabilities, std::unique_ptr<VROMaterialShaderBinding>> _shaderBindings;
     
+    /*
+     The instanced variants of the above programs, created on demand when this
+     material is automatically instanced.
+     */
+    std::map<VROLightingShaderCapabilities, std::unique_ptr<VROMaterialShaderBinding>> _instancedShaderBindings;
+    
     /*
      Get the shader program that should be used for the given light configuration.
      Returned as a material-shader binding. If no such binding exists, it is created
@@ -136,9 +167,31 @@ private:
     VROMaterialShaderBinding *getShaderBindingForLights(const std::vector<std::shared_ptr<VROLight>> &lights,
                                                         const VRORenderContext &context,
                                                         std::shared_ptr<VRODriver> driver);
+    VROMaterialShaderBinding *getInstancedShaderBindingForLights(const std::vector<std::shared_ptr<VROLight>> &lights,
+                                                                 const VRORenderContext &context,
+                                                                 std::shared_ptr<VRODriver> driver);
+    
+    /*
+     Bind the given binding's program and the lighting UBO for the given lights, and
+     make it the active binding. If the program uses clustered lighting, the context's
+     light cluster grid is bound as well.
+     */
+    bool bindShaderBinding(VROMaterialShaderBinding *binding, bool instanced, int lightsHash,
+                           const std::vector<std::shared_ptr<VROLight>> &lights,
+                           const VRORenderContext &context,
+                           std::shared_ptr<VRODriver> &driver);
 
     uint32_t hashTextures(const std::vector<VROTextureReference> &textures) const;
     
+    /*
+     Packed diffuse textures (see VROTexture::setArrayPackingEnabled and
+     setAtlasPackingEnabled) only become array layers or atlas regions once
+     hydrated, which may be after this substrate is created.
+     When this happens the capabilities are re-derived, and the bindings compiled
+     for the old capabilities discarded.
+     */
+    void updateDiffuseTextureType();
+    
 };
 
 #endif /* VROMaterialSubstrateOpenGL_h */
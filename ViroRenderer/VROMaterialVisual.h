@@ -111,6 +111,40 @@ public:
         return _intensity;
     }
     
+    /*
+     Return true if this visual has the same color, texture, intensity, and
+     texture transform as the given visual.
+     */
+    bool isIdenticalTo(const VROMaterialVisual &visual) const {
+        return _contentsColor.isEqual(visual._contentsColor) &&
+               _contentsTexture == visual._contentsTexture &&
+               _intensity == visual._intensity &&
+               _contentsTransform == visual._contentsTransform;
+    }
+
+    /*
+     Return true if this visual samples its texture with the same texture
+     transform as the given visual.
+     */
+    bool hasSameTransformAs(const VROMaterialVisual &visual) const {
+        return _contentsTransform == visual._contentsTransform;
+    }
+
+    /*
+     Hash of the color, texture identity, and intensity of this visual. Visuals
+     that are identical (see isIdenticalTo) have the same hash.
+     */
+    size_t hash() const {
+        std::hash<float> hashFloat;
+        size_t h = std::hash<VROTexture *>()(_contentsTexture.get());
+        h = 31 * h + hashFloat(_contentsColor.x);
+        h = 31 * h + hashFloat(_contentsColor.y);
+        h = 31 * h + hashFloat(_contentsColor.z);
+        h = 31 * h + hashFloat(_contentsColor.w);
+        h = 31 * h + hashFloat(_intensity);
+        return h;
+    }
+    
 private:
     
     /*
@@ -286,10 +286,39 @@ float IDENTITY_MATRIX[] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f
 
 double IDENTITY_MATRIX_D[] = { 1.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 0.0, 1.0 };
 
+/*
+ Columns are loaded into 4-wide vectors without assuming 16-byte alignment, so the
+ float kernels below accept any float[16]. The compiler lowers the vector operations
+ to NEON, SSE, or WebAssembly SIMD128 depending on the target, and to scalar code
+ elsewhere. Loading every input before storing also makes the kernels safe when the
+ output aliases an input.
+ */
+typedef float float4 __attribute__((__vector_size__(16), __aligned__(4)));
+
+/*
+ Shuffles (used by transpose and invert) need __builtin_shufflevector; compilers
+ without it fall back to the scalar implementations.
+ */
+#if defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 12)
+#define VRO_MATH_SIMD_SHUFFLE 1
+#else
+#define VRO_MATH_SIMD_SHUFFLE 0
+#endif
+
+static inline float4 VROMathLoadColumn(const float *m, int column) {
+    float4 c;
+    memcpy(&c, m + column * 4, sizeof(float4));
+    return c;
+}
+
+static inline void VROMathStoreColumn(float *m, int column, float4 c) {
+    memcpy(m + column * 4, &c, sizeof(float4));
+}
+
 void VROMathMultVectorByMatrix(const float *matrix, const float *input, float *output) {
-    for (int i = 0; i < 4; i++) {
-        output[i] = input[0] * matrix[i] + input[1] * matrix[4 + i] + input[2] * matrix[8 + i] + input[3] * matrix[12 + i];
-    }
+    float4 r = VROMathLoadColumn(matrix, 0) * input[0] + VROMathLoadColumn(matrix, 1) * input[1] +
+               VROMathLoadColumn(matrix, 2) * input[2] + VROMathLoadColumn(matrix, 3) * input[3];
+    memcpy(output, &r, sizeof(float4));
 }
 
 void VROMathMultVectorByMatrix_d(const double *matrix, const double *input, double *output) {
@@ -305,22 +334,42 @@ void VROMathMultVectorByMatrix_fd(const float *matrix, const double *input, doub
 }
 
 void VROMathMultMatrices(const float *m1, const float *m0, float *d) {
-    d[0] = m0[0] * m1[0] + m0[4] * m1[1] + m0[8] * m1[2] + m0[12] * m1[3];
-    d[1] = m0[1] * m1[0] + m0[5] * m1[1] + m0[9] * m1[2] + m0[13] * m1[3];
-    d[2] = m0[2] * m1[0] + m0[6] * m1[1] + m0[10] * m1[2] + m0[14] * m1[3];
-    d[3] = m0[3] * m1[0] + m0[7] * m1[1] + m0[11] * m1[2] + m0[15] * m1[3];
-    d[4] = m0[0] * m1[4] + m0[4] * m1[5] + m0[8] * m1[6] + m0[12] * m1[7];
-    d[5] = m0[1] * m1[4] + m0[5] * m1[5] + m0[9] * m1[6] + m0[13] * m1[7];
-    d[6] = m0[2] * m1[4] + m0[6] * m1[5] + m0[10] * m1[6] + m0[14] * m1[7];
-    d[7] = m0[3] * m1[4] + m0[7] * m1[5] + m0[11] * m1[6] + m0[15] * m1[7];
-    d[8] = m0[0] * m1[8] + m0[4] * m1[9] + m0[8] * m1[10] + m0[12] * m1[11];
-    d[9] = m0[1] * m1[8] + m0[5] * m1[9] + m0[9] * m1[10] + m0[13] * m1[11];
-    d[10] = m0[2] * m1[8] + m0[6] * m1[9] + m0[10] * m1[10] + m0[14] * m1[11];
-    d[11] = m0[3] * m1[8] + m0[7] * m1[9] + m0[11] * m1[10] + m0[15] * m1[11];
-    d[12] = m0[0] * m1[12] + m0[4] * m1[13] + m0[8] * m1[14] + m0[12] * m1[15];
-    d[13] = m0[1] * m1[12] + m0[5] * m1[13] + m0[9] * m1[14] + m0[13] * m1[15];
-    d[14] = m0[2] * m1[12] + m0[6] * m1[13] + m0[10] * m1[14] + m0[14] * m1[15];
-    d[15] = m0[3] * m1[12] + m0[7] * m1[13] + m0[11] * m1[14] + m0[15] * m1[15];
+    float4 c0 = VROMathLoadColumn(m0, 0);
+    float4 c1 = VROMathLoadColumn(m0, 1);
+    float4 c2 = VROMathLoadColumn(m0, 2);
+    float4 c3 = VROMathLoadColumn(m0, 3);
+    
+    float4 r[4];
+    for (int j = 0; j < 4; j++) {
+        const float *b = m1 + j * 4;
+        r[j] = c0 * b[0] + c1 * b[1] + c2 * b[2] + c3 * b[3];
+    }
+    for (int j = 0; j < 4; j++) {
+        VROMathStoreColumn(d, j, r[j]);
+    }
+}
+
+void VROMathMultMatricesBatch(const float *m1, const float *m0, float *d, int count) {
+    for (int i = 0; i < count; i++) {
+        VROMathMultMatrices(m1 + i * 16, m0 + i * 16, d + i * 16);
+    }
+}
+
+void VROMathTransformPoints(const float *matrix, const float *points, float *output, int count) {
+    float4 c0 = VROMathLoadColumn(matrix, 0);
+    float4 c1 = VROMathLoadColumn(matrix, 1);
+    float4 c2 = VROMathLoadColumn(matrix, 2);
+    float4 c3 = VROMathLoadColumn(matrix, 3);
+    
+    for (int i = 0; i < count; i++) {
+        const float *p = points + i * 3;
+        float4 r = c0 * p[0] + c1 * p[1] + c2 * p[2] + c3;
+        
+        float *o = output + i * 3;
+        o[0] = r[0];
+        o[1] = r[1];
+        o[2] = r[2];
+    }
 }
 
 void VROMathMultMatrices_d(const double *m1, const double *m0, double *d) {
@@ -530,40 +579,44 @@ void VROMathMakeIdentity_d(double *m) {
 }
 
 void VROMathTransposeMatrix(const float *src, float *transpose) {
-    transpose[0] = src[0];
-    transpose[1] = src[4];
-    transpose[2] = src[8];
-    transpose[3] = src[12];
-    
-    transpose[4] = src[1];
-    transpose[5] = src[5];
-    transpose[6] = src[9];
-    transpose[7] = src[13];
-
-    transpose[8] = src[2];
-    transpose[9] = src[6];
-    transpose[10] = src[10];
-    transpose[11] = src[14];
-
-    transpose[12] = src[3];
-    transpose[13] = src[7];
-    transpose[14] = src[11];
-    transpose[15] = src[15];
+#if VRO_MATH_SIMD_SHUFFLE
+    float4 c0 = VROMathLoadColumn(src, 0);
+    float4 c1 = VROMathLoadColumn(src, 1);
+    float4 c2 = VROMathLoadColumn(src, 2);
+    float4 c3 = VROMathLoadColumn(src, 3);
+    
+    float4 t0 = __builtin_shufflevector(c0, c1, 0, 4, 1, 5);
+    float4 t1 = __builtin_shufflevector(c2, c3, 0, 4, 1, 5);
+    float4 t2 = __builtin_shufflevector(c0, c1, 2, 6, 3, 7);
+    float4 t3 = __builtin_shufflevector(c2, c3, 2, 6, 3, 7);
+    
+    VROMathStoreColumn(transpose, 0, __builtin_shufflevector(t0, t1, 0, 1, 4, 5));
+    VROMathStoreColumn(transpose, 1, __builtin_shufflevector(t0, t1, 2, 3, 6, 7));
+    VROMathStoreColumn(transpose, 2, __builtin_shufflevector(t2, t3, 0, 1, 4, 5));
+    VROMathStoreColumn(transpose, 3, __builtin_shufflevector(t2, t3, 2, 3, 6, 7));
+#else
+    float t[16];
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            t[i * 4 + j] = src[j * 4 + i];
+        }
+    }
+    memcpy(transpose, t, sizeof(float) * 16);
+#endif
 }
 
+#if VRO_MATH_SIMD_SHUFFLE
 static __attribute__((__always_inline__, __nodebug__)) void invert4x4_simd(const float *src, float *dst) {
-    typedef __attribute__((__ext_vector_type__(4))) float float4;
-    
     float4 row0, row1, row2, row3;
     float4 col0, col1, col2, col3;
     float4 det, tmp1;
     
     /* Load matrix: */
     
-    col0 = ((float4 *) src)[0];
-    col1 = ((float4 *) src)[1];
-    col2 = ((float4 *) src)[2];
-    col3 = ((float4 *) src)[3];
+    col0 = VROMathLoadColumn(src, 0);
+    col1 = VROMathLoadColumn(src, 1);
+    col2 = VROMathLoadColumn(src, 2);
+    col3 = VROMathLoadColumn(src, 3);
     
     /* Transpose: */
     
@@ -673,11 +726,12 @@ static __attribute__((__always_inline__, __nodebug__)) void invert4x4_simd(const
     
     /* Store inverted matrix: */
     
-    ((float4 *) dst)[0] = col0;
-    ((float4 *) dst)[1] = col1;
-    ((float4 *) dst)[2] = col2;
-    ((float4 *) dst)[3] = col3;
+    VROMathStoreColumn(dst, 0, col0);
+    VROMathStoreColumn(dst, 1, col1);
+    VROMathStoreColumn(dst, 2, col2);
+    VROMathStoreColumn(dst, 3, col3);
 }
+#endif
 
 void invert4x4(const float *src, float *inverse) {
     float temp[16];
@@ -743,10 +797,10 @@ void invert4x4(const float *src, float *inverse) {
 }
 
 bool VROMathInvertMatrix(const float *src, float *inverse) {
-#if TARGET_OS_SIMULATOR || VRO_PLATFORM_WASM || VRO_PLATFORM_MACOS
-    invert4x4(src, inverse);
-#else
+#if VRO_MATH_SIMD_SHUFFLE
     invert4x4_simd(src, inverse);
+#else
+    invert4x4(src, inverse);
 #endif
     return true;
 }
@@ -854,7 +908,29 @@ double VROMathInterpolate_d(double input, double inMin, double inMax, double out
     return outMin + position;
 }
 
-float VROMathInterpolateKeyFrameIndex(float input, const std::vector<float> &inputs) {
+/*
+ Return the index i of the first key time greater than input, given that input is
+ within [inputs.front(), inputs.back()). Resumes from the cursor if provided, which
+ is updated; seeking backward falls back to a binary search.
+ */
+static int VROMathFindKeyFrame(float input, const std::vector<float> &inputs, int *cursor) {
+    int i;
+    if (cursor && *cursor > 0 && *cursor < inputs.size() && inputs[*cursor - 1] <= input) {
+        i = *cursor;
+        while (input >= inputs[i]) {
+            i++;
+        }
+    } else {
+        i = (int) (std::upper_bound(inputs.begin(), inputs.end(), input) - inputs.begin());
+    }
+    
+    if (cursor) {
+        *cursor = i;
+    }
+    return i;
+}
+
+float VROMathInterpolateKeyFrameIndex(float input, const std::vector<float> &inputs, int *cursor) {
     if (input < inputs.front()) {
         return 0;
     }
@@ -862,16 +938,11 @@ float VROMathInterpolateKeyFrameIndex(float input, const std::vector<float> &inp
         return inputs.size() - 1;
     }
     
-    for (int i = 1; i < inputs.size(); i++) {
-        if (input < inputs[i]) {
-            return i - 1;
-        }
-    }
-    pabort();
-    return 0;
+    return VROMathFindKeyFrame(input, inputs, cursor) - 1;
 }
 
-float VROMathInterpolateKeyFrame(float input, const std::vector<float> &inputs, const std::vector<float> &outputs) {
+float VROMathInterpolateKeyFrame(float input, const std::vector<float> &inputs, const std::vector<float> &outputs,
+                                 int *cursor) {
     passert (inputs.size() == outputs.size());
     if (input < inputs.front()) {
         return outputs.front();
@@ -880,17 +951,12 @@ float VROMathInterpolateKeyFrame(float input, const std::vector<float> &inputs,
         return outputs.back();
     }
     
-    for (int i = 1; i < inputs.size(); i++) {
-        if (input < inputs[i]) {
-            return VROMathInterpolate(input, inputs[i - 1], inputs[i], outputs[i - 1], outputs[i]);
-        }
-    }
-    
-    pabort();
-    return 0;
+    int i = VROMathFindKeyFrame(input, inputs, cursor);
+    return VROMathInterpolate(input, inputs[i - 1], inputs[i], outputs[i - 1], outputs[i]);
 }
 
-VROVector3f VROMathInterpolateKeyFrameVector3f(float input, const std::vector<float> &inputs, const std::vector<VROVector3f> &outputs) {
+VROVector3f VROMathInterpolateKeyFrameVector3f(float input, const std::vector<float> &inputs, const std::vector<VROVector3f> &outputs,
+                                               int *cursor) {
     passert (inputs.size() == outputs.size());
     if (input < inputs.front()) {
         return outputs.front();
@@ -899,17 +965,12 @@ VROVector3f VROMathInterpolateKeyFrameVector3f(float input, const std::vector<fl
         return outputs.back();
     }
     
-    for (int i = 1; i < inputs.size(); i++) {
-        if (input < inputs[i]) {
-            return outputs[i - 1].interpolate(outputs[i], (input - inputs[i - 1]) / (inputs[i] - inputs[i - 1]));
-        }
-    }
-    
-    pabort();
-    return {};
+    int i = VROMathFindKeyFrame(input, inputs, cursor);
+    return outputs[i - 1].interpolate(outputs[i], (input - inputs[i - 1]) / (inputs[i] - inputs[i - 1]));
 }
 
-VROQuaternion VROMathInterpolateKeyFrameQuaternion(float input, const std::vector<float> &inputs, const std::vector<VROQuaternion> &outputs) {
+VROQuaternion VROMathInterpolateKeyFrameQuaternion(float input, const std::vector<float> &inputs, const std::vector<VROQuaternion> &outputs,
+                                                   int *cursor) {
     passert (inputs.size() == outputs.size());
     if (input < inputs.front()) {
         return outputs.front();
@@ -918,17 +979,12 @@ VROQuaternion VROMathInterpolateKeyFrameQuaternion(float input, const std::vecto
         return outputs.back();
     }
     
-    for (int i = 1; i < inputs.size(); i++) {
-        if (input < inputs[i]) {
-            return VROQuaternion::slerp(outputs[i - 1], outputs[i], (input - inputs[i - 1]) / (inputs[i] - inputs[i - 1]));
-        }
-    }
-    
-    pabort();
-    return {};
+    int i = VROMathFindKeyFrame(input, inputs, cursor);
+    return VROQuaternion::slerp(outputs[i - 1], outputs[i], (input - inputs[i - 1]) / (inputs[i] - inputs[i - 1]));
 }
 
-VROMatrix4f VROMathInterpolateKeyFrameMatrix4f(float input, const std::vector<float> &inputs, const std::vector<VROMatrix4f> &outputs) {
+VROMatrix4f VROMathInterpolateKeyFrameMatrix4f(float input, const std::vector<float> &inputs, const std::vector<VROMatrix4f> &outputs,
+                                               int *cursor) {
     passert (inputs.size() == outputs.size());
     if (input < inputs.front()) {
         return outputs.front();
@@ -937,18 +993,12 @@ VROMatrix4f VROMathInterpolateKeyFrameMatrix4f(float input, const std::vector<fl
         return outputs.back();
     }
     
-    for (int i = 1; i < inputs.size(); i++) {
-        if (input < inputs[i]) {
-            float interp[16];
-            for (int j = 0; j < 16; j++) {
-                interp[j] = VROMathInterpolate(input, inputs[i - 1], inputs[i], outputs[i - 1][j], outputs[i][j]);
-            }
-            return { interp };
-        }
+    int i = VROMathFindKeyFrame(input, inputs, cursor);
+    float interp[16];
+    for (int j = 0; j < 16; j++) {
+        interp[j] = VROMathInterpolate(input, inputs[i - 1], inputs[i], outputs[i - 1][j], outputs[i][j]);
     }
-    
-    pabort();
-    return {};
+    return { interp };
 }
 
 void VROMathInterpolatePoint(const float *bottom, const float *top, float amount, int size, float *result) {
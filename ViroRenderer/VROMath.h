@@ -87,6 +87,14 @@ void VROMathMultMatrices_dfd(const double *a, const float *b, double *r);
 void VROMathMultMatrices_fdd(const float *a, const double *b, double *r);
 void VROMathMultMatrices_ffd(const float *a, const float *b, double *r);
 
+/*
+ Batched variants. VROMathMultMatricesBatch multiplies count pairs of matrices
+ stored contiguously (16 floats each). VROMathTransformPoints transforms count
+ packed XYZ points (3 floats each) by the given matrix, with w = 1.
+ */
+void VROMathMultMatricesBatch(const float *a, const float *b, float *r, int count);
+void VROMathTransformPoints(const float *matrix, const float *points, float *output, int count);
+
 void VROMathMakeIdentity(float *m);
 void VROMathMakeIdentity_d(double *m);
 
@@ -107,11 +115,21 @@ void VROMathMultVX(const float *vx, const float *m0, float *d);
  */
 float  VROMathInterpolate(float input, float inMin, float inMax, float outMin, float outMax);
 double VROMathInterpolate_d(double input, double inMin, double inMax, double outMin, double outMax);
-float  VROMathInterpolateKeyFrame(float input, const std::vector<float> &inputs, const std::vector<float> &outputs);
-float  VROMathInterpolateKeyFrameIndex(float input, const std::vector<float> &inputs);
-VROVector3f   VROMathInterpolateKeyFrameVector3f(float input, const std::vector<float> &inputs, const std::vector<VROVector3f> &outputs);
-VROQuaternion VROMathInterpolateKeyFrameQuaternion(float input, const std::vector<float> &inputs, const std::vector<VROQuaternion> &outputs);
-VROMatrix4f   VROMathInterpolateKeyFrameMatrix4f(float input, const std::vector<float> &inputs, const std::vector<VROMatrix4f> &outputs);
+
+/*
+ Keyframe interpolation functions. If a cursor is provided, it holds the key found
+ by the last call and the search for the keys surrounding input resumes from there:
+ this makes sampling an animation that advances forward in time O(1) per call.
+ */
+float  VROMathInterpolateKeyFrame(float input, const std::vector<float> &inputs, const std::vector<float> &outputs,
+                                  int *cursor = nullptr);
+float  VROMathInterpolateKeyFrameIndex(float input, const std::vector<float> &inputs, int *cursor = nullptr);
+VROVector3f   VROMathInterpolateKeyFrameVector3f(float input, const std::vector<float> &inputs, const std::vector<VROVector3f> &outputs,
+                                                 int *cursor = nullptr);
+VROQuaternion VROMathInterpolateKeyFrameQuaternion(float input, const std::vector<float> &inputs, const std::vector<VROQuaternion> &outputs,
+                                                   int *cursor = nullptr);
+VROMatrix4f   VROMathInterpolateKeyFrameMatrix4f(float input, const std::vector<float> &inputs, const std::vector<VROMatrix4f> &outputs,
+                                                 int *cursor = nullptr);
 void   VROMathInterpolatePoint(const float *bottom, const float *top, float amount, int size, float *result);
 
 /*
@@ -208,23 +208,23 @@ void VROMatrix4f::scale(float x, float y, float z) {
 
 VROVector3f VROMatrix4f::multiply(const VROVector3f &vector) const {
     VROVector3f result;
-    result.x = vector.x * _mtx[0] + vector.y * _mtx[4] + vector.z * _mtx[8]  + _mtx[12];
-    result.y = vector.x * _mtx[1] + vector.y * _mtx[5] + vector.z * _mtx[9]  + _mtx[13];
-    result.z = vector.x * _mtx[2] + vector.y * _mtx[6] + vector.z * _mtx[10] + _mtx[14];
+    VROMathTransformPoints(_mtx, &vector.x, &result.x, 1);
     
     return result;
 }
 
 VROVector4f VROMatrix4f::multiply(const VROVector4f &vector) const {
     VROVector4f result;
-    result.x = vector.x * _mtx[0] + vector.y * _mtx[4] + vector.z * _mtx[8]  + vector.w * _mtx[12];
-    result.y = vector.x * _mtx[1] + vector.y * _mtx[5] + vector.z * _mtx[9]  + vector.w * _mtx[13];
-    result.z = vector.x * _mtx[2] + vector.y * _mtx[6] + vector.z * _mtx[10] + vector.w * _mtx[14];
-    result.w = vector.x * _mtx[3] + vector.y * _mtx[7] + vector.z * _mtx[11] + vector.w * _mtx[15];
+    VROMathMultVectorByMatrix(_mtx, &vector.x, &result.x);
 
     return result;
 }
 
+void VROMatrix4f::multiply(const VROVector3f *points, int count, VROVector3f *out) const {
+    static_assert(sizeof(VROVector3f) == sizeof(float) * 3, "VROVector3f must be packed XYZ");
+    VROMathTransformPoints(_mtx, &points[0].x, &out[0].x, count);
+}
+
 VROMatrix4f VROMatrix4f::multiply(const VROMatrix4f &matrix) const {
     float nmtx[16];
     VROMathMultMatrices(matrix._mtx, _mtx, nmtx);
@@ -232,6 +232,11 @@ VROMatrix4f VROMatrix4f::multiply(const VROMatrix4f &matrix) const {
     return VROMatrix4f(nmtx);
 }
 
+void VROMatrix4f::multiply(const VROMatrix4f *a, const VROMatrix4f *b, VROMatrix4f *out, int count) {
+    static_assert(sizeof(VROMatrix4f) == sizeof(float) * 16, "VROMatrix4f must be 16 packed floats");
+    VROMathMultMatricesBatch(b[0]._mtx, a[0]._mtx, out[0]._mtx, count);
+}
+
 void VROMatrix4f::setRotationCenter(const VROVector3f &center, const VROVector3f &translation) {
     _mtx[12] = -_mtx[0] * center.x - _mtx[4] * center.y - _mtx[8]  * center.z + (center.x - translation.x);
     _mtx[13] = -_mtx[1] * center.x - _mtx[5] * center.y - _mtx[9]  * center.z + (center.y - translation.y);
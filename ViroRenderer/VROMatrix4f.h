@@ -103,6 +103,14 @@ public:
     VROVector3f multiply(const VROVector3f &vector) const;
     VROVector4f multiply(const VROVector4f &vector) const;
     
+    /*
+     Batched multiplication. The first multiplies count pairs of matrices, such that
+     out[i] = a[i] * b[i]; the second transforms count points by this matrix. Both
+     use vector instructions, and out may alias the inputs.
+     */
+    static void multiply(const VROMatrix4f *a, const VROMatrix4f *b, VROMatrix4f *out, int count);
+    void multiply(const VROVector3f *points, int count, VROVector3f *out) const;
+    
     /*
      Decomposition into affine transforms. These methods only work on affine 
      matrices. To extract rotation, the scale factors are required.
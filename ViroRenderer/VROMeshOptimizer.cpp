@@ -0,0 +1,842 @@
+//
+//  VROMeshOptimizer.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROMeshOptimizer.h"
+#include "VROGeometrySource.h"
+#include "VROGeometryElement.h"
+#include "VROGeometryUtil.h"
+#include "VROGeometryCache.h"
+#include "VROJobSystem.h"
+#include "VROLog.h"
+#include "VROVector4f.h"
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+
+// The post-transform cache size Tipsify optimizes for. Mobile GPUs vary, and
+// Tipsify degrades gracefully on larger caches.
+static const int kVertexCacheSize = 16;
+
+// Meshes with fewer triangles than this are cheap enough to draw at any size,
+// and get no LODs. LOD generation also stops once a LOD falls below it.
+static const int kMinLODTriangles = 4096;
+static const int kMaxLODLevels = 4;
+
+// Each LOD targets this fraction of the triangles of the last, and is dropped
+// if simplification gets it no further than kMaxLODTriangleRatio
+static const float kLODTriangleReduction = 0.5f;
+static const float kMaxLODTriangleRatio = 0.75f;
+
+// The largest error, relative to the extent of the mesh, any LOD may reach
+static const float kMaxLODError = 0.05f;
+
+/*
+ LOD screen coverages are chosen so that a LOD's error covers no more than
+ kLODPixelError pixels on a viewport of kLODReferenceHeight pixels. Each
+ LOD's coverage is also at least 2x below the last, and LODs that would only
+ be used below kMinLODCoverage are not worth generating.
+ */
+static const float kLODPixelError = 1.0f;
+static const float kLODReferenceHeight = 1080.0f;
+static const float kMinLODCoverage = 0.02f;
+
+static std::vector<uint32_t> VROReadIndices(const std::shared_ptr<VROGeometryElement> &element) {
+    std::vector<uint32_t> indices;
+    indices.reserve(element->getPrimitiveCount() * 3);
+    element->visitIndices([&indices](int index, int indexRead) {
+        indices.push_back((uint32_t) indexRead);
+        return true;
+    });
+    return indices;
+}
+
+static std::shared_ptr<VROGeometryElement> VROBuildElement(const std::vector<uint32_t> &indices, int vertexCount) {
+    int bytesPerIndex = (vertexCount <= 0xFFFF) ? 2 : 4;
+    int length = (int) indices.size() * bytesPerIndex;
+    void *data = malloc(length);
+    if (bytesPerIndex == 2) {
+        uint16_t *out = (uint16_t *) data;
+        for (size_t i = 0; i < indices.size(); i++) {
+            out[i] = (uint16_t) indices[i];
+        }
+    } else {
+        memcpy(data, indices.data(), length);
+    }
+    return std::make_shared<VROGeometryElement>(std::make_shared<VROData>(data, length, VRODataOwnership::Move),
+                                                VROGeometryPrimitiveType::Triangle, (int) indices.size() / 3,
+                                                bytesPerIndex, false);
+}
+
+static std::shared_ptr<VROGeometrySource> VROFindPositions(const std::vector<std::shared_ptr<VROGeometrySource>> &sources,
+                                                           int elementIndex) {
+    for (const std::shared_ptr<VROGeometrySource> &source : sources) {
+        if (source->getSemantic() == VROGeometrySourceSemantic::Vertex &&
+            (source->getGeometryElementIndex() == -1 || source->getGeometryElementIndex() == elementIndex)) {
+            return source;
+        }
+    }
+    return nullptr;
+}
+
+static std::vector<VROVector3f> VROReadPositions(const std::shared_ptr<VROGeometrySource> &source) {
+    std::vector<VROVector3f> positions;
+    positions.reserve(source->getVertexCount());
+    source->processVertices([&positions](int index, VROVector4f vertex) {
+        positions.push_back(VROVector3f(vertex.x, vertex.y, vertex.z));
+    });
+    return positions;
+}
+
+#pragma mark - Optimization
+
+void VROMeshOptimizer::optimize(std::vector<std::shared_ptr<VROGeometrySource>> &sources,
+                                std::vector<std::shared_ptr<VROGeometryElement>> &elements,
+                                bool reorderVertices) {
+    if (elements.empty()) {
+        return;
+    }
+    
+    bool reorder = reorderVertices && canReorderVertices(sources, elements);
+    int vertexCount = reorder ? sources.front()->getVertexCount() : 0;
+    if (reorder) {
+        std::vector<std::vector<uint32_t>> indices;
+        for (const std::shared_ptr<VROGeometryElement> &element : elements) {
+            indices.push_back(VROReadIndices(element));
+        }
+        weldVertices(sources, indices);
+        for (int i = 0; i < elements.size(); i++) {
+            elements[i] = VROBuildElement(indices[i], vertexCount);
+        }
+    }
+    
+    // Triangle order is independent per element
+    VROJobSystem::getShared()->parallelFor(0, (int) elements.size(), 1, [&sources, &elements](int i) {
+        elements[i]->optimizeTriangleOrder(VROFindPositions(sources, i));
+    });
+    
+    if (reorder) {
+        std::vector<std::vector<uint32_t>> indices;
+        for (const std::shared_ptr<VROGeometryElement> &element : elements) {
+            indices.push_back(VROReadIndices(element));
+        }
+        reorderVertexFetch(sources, indices);
+        
+        int reorderedCount = sources.front()->getVertexCount();
+        for (int i = 0; i < elements.size(); i++) {
+            elements[i] = VROBuildElement(indices[i], reorderedCount);
+        }
+        pinfo("Welded mesh from %d to %d vertices", vertexCount, reorderedCount);
+    }
+}
+
+#pragma mark - Vertex Cache
+
+std::vector<uint32_t> VROMeshOptimizer::optimizeVertexCache(const std::vector<uint32_t> &indices, int vertexCount,
+                                                            std::vector<int> *outHardBoundaries) {
+    int triangleCount = (int) indices.size() / 3;
+    std::vector<uint32_t> output;
+    output.reserve(triangleCount * 3);
+    if (triangleCount == 0 || vertexCount <= 0) {
+        return output;
+    }
+    
+    /*
+     Build the triangles adjacent to each vertex, and the number of those
+     triangles not yet emitted (the vertex's live count).
+     */
+    std::vector<int> liveCount(vertexCount, 0);
+    for (int i = 0; i < triangleCount * 3; i++) {
+        liveCount[indices[i]]++;
+    }
+    std::vector<int> adjacencyOffsets(vertexCount + 1, 0);
+    for (int v = 0; v < vertexCount; v++) {
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveCount[v];
+    }
+    std::vector<int> adjacency(triangleCount * 3);
+    std::vector<int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (int i = 0; i < triangleCount * 3; i++) {
+        adjacency[fill[indices[i]]++] = i / 3;
+    }
+    
+    std::vector<int> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnd;
+    std::vector<uint32_t> candidates;
+    deadEnd.reserve(triangleCount * 3);
+    
+    int time = kVertexCacheSize + 1;
+    int cursor = 0;
+    int fanning = 0;
+    while (fanning < vertexCount && liveCount[fanning] == 0) {
+        fanning++;
+    }
+    outHardBoundaries->push_back(0);
+    
+    while (fanning >= 0 && fanning < vertexCount) {
+        // Emit all remaining triangles around the fanning vertex
+        candidates.clear();
+        for (int k = adjacencyOffsets[fanning]; k < adjacencyOffsets[fanning + 1]; k++) {
+            int t = adjacency[k];
+            if (emitted[t]) {
+                continue;
+            }
+            for (int c = 0; c < 3; c++) {
+                uint32_t v = indices[t * 3 + c];
+                output.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                liveCount[v]--;
+                if (time - cacheTime[v] > kVertexCacheSize) {
+                    cacheTime[v] = time++;
+                }
+            }
+            emitted[t] = true;
+        }
+        
+        /*
+         Fan next around the candidate that will still be in the cache when its
+         remaining triangles are emitted, preferring the oldest such vertex.
+         */
+        int next = -1;
+        int bestPriority = -1;
+        for (uint32_t v : candidates) {
+            if (liveCount[v] <= 0) {
+                continue;
+            }
+            int priority = 0;
+            if (time - cacheTime[v] + 2 * liveCount[v] <= kVertexCacheSize) {
+                priority = time - cacheTime[v];
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                next = v;
+            }
+        }
+        
+        /*
+         At a dead end, resume from the most recently used vertex that has
+         triangles left, or failing that the next such vertex in index order.
+         Resuming from a vertex no longer in the cache starts a new cluster.
+         */
+        if (next < 0) {
+            while (!deadEnd.empty() && next < 0) {
+                uint32_t v = deadEnd.back();
+                deadEnd.pop_back();
+                if (liveCount[v] > 0) {
+                    next = v;
+                }
+            }
+            if (next < 0) {
+                while (cursor < vertexCount && liveCount[cursor] == 0) {
+                    cursor++;
+                }
+                next = (cursor < vertexCount) ? cursor : -1;
+            }
+            if (next >= 0 && time - cacheTime[next] > kVertexCacheSize) {
+                outHardBoundaries->push_back((int) output.size() / 3);
+            }
+        }
+        fanning = next;
+    }
+    return output;
+}
+
+float VROMeshOptimizer::computeACMR(const std::vector<uint32_t> &indices, int vertexCount) {
+    if (indices.size() < 3 || vertexCount <= 0) {
+        return 0;
+    }
+    std::vector<int> cacheTime(vertexCount, -kVertexCacheSize - 1);
+    int time = 0;
+    int misses = 0;
+    for (uint32_t v : indices) {
+        if (time - cacheTime[v] > kVertexCacheSize) {
+            cacheTime[v] = time++;
+            misses++;
+        }
+    }
+    return misses / (float) (indices.size() / 3);
+}
+
+#pragma mark - Overdraw
+
+void VROMeshOptimizer::optimizeOverdraw(std::vector<uint32_t> &indices, const std::vector<int> &hardBoundaries,
+                                        const std::vector<VROVector3f> &positions, float threshold) {
+    int triangleCount = (int) indices.size() / 3;
+    for (uint32_t v : indices) {
+        if (v >= positions.size()) {
+            return;
+        }
+    }
+    
+    /*
+     Split each hard cluster wherever the cache misses per triangle of the
+     cluster so far fall within the threshold of the whole cluster's, since
+     the split then costs little cache efficiency.
+     */
+    std::vector<int> boundaries;
+    std::vector<int> cacheTime(positions.size(), -kVertexCacheSize - 1);
+    int time = 0;
+    
+    auto countMisses = [&indices, &cacheTime, &time](int t) {
+        int misses = 0;
+        for (int c = 0; c < 3; c++) {
+            uint32_t v = indices[t * 3 + c];
+            if (time - cacheTime[v] > kVertexCacheSize) {
+                cacheTime[v] = time++;
+                misses++;
+            }
+        }
+        return misses;
+    };
+    auto resetCache = [&time]() {
+        time += kVertexCacheSize + 1;
+    };
+    
+    for (int h = 0; h < hardBoundaries.size(); h++) {
+        int start = hardBoundaries[h];
+        int end = (h + 1 < hardBoundaries.size()) ? hardBoundaries[h + 1] : triangleCount;
+        if (start >= end) {
+            continue;
+        }
+        
+        resetCache();
+        int clusterMisses = 0;
+        for (int t = start; t < end; t++) {
+            clusterMisses += countMisses(t);
+        }
+        float clusterThreshold = threshold * clusterMisses / (float) (end - start);
+        
+        resetCache();
+        boundaries.push_back(start);
+        int runningMisses = 0;
+        int runningTriangles = 0;
+        for (int t = start; t < end; t++) {
+            runningMisses += countMisses(t);
+            runningTriangles++;
+            
+            if (t + 1 < end && runningMisses / (float) runningTriangles <= clusterThreshold) {
+                boundaries.push_back(t + 1);
+                resetCache();
+                runningMisses = 0;
+                runningTriangles = 0;
+            }
+        }
+    }
+    
+    /*
+     Sort the clusters by how far they face outward from the mesh's centroid:
+     outer surfaces are drawn first so that they occlude inner ones.
+     */
+    struct VROTriangleCluster {
+        int start, end;
+        float sortKey;
+    };
+    std::vector<VROTriangleCluster> clusters;
+    std::vector<VROVector3f> centroids;
+    std::vector<VROVector3f> normals;
+    
+    VROVector3f meshCentroid;
+    float meshArea = 0;
+    for (int b = 0; b < boundaries.size(); b++) {
+        int start = boundaries[b];
+        int end = (b + 1 < boundaries.size()) ? boundaries[b + 1] : triangleCount;
+        
+        VROVector3f centroid;
+        VROVector3f normal;
+        float area = 0;
+        for (int t = start; t < end; t++) {
+            const VROVector3f &A = positions[indices[t * 3]];
+            const VROVector3f &B = positions[indices[t * 3 + 1]];
+            const VROVector3f &C = positions[indices[t * 3 + 2]];
+            
+            VROVector3f cross = (B - A).cross(C - A);
+            float triangleArea = cross.magnitude();
+            centroid += (A + B + C) * (triangleArea / 3.0f);
+            normal += cross;
+            area += triangleArea;
+        }
+        meshCentroid += centroid;
+        meshArea += area;
+        
+        clusters.push_back({ start, end, 0 });
+        centroids.push_back(area > 0 ? centroid / area : positions[indices[start * 3]]);
+        normals.push_back(normal);
+    }
+    if (meshArea > 0) {
+        meshCentroid = meshCentroid / meshArea;
+    }
+    for (int c = 0; c < clusters.size(); c++) {
+        float magnitude = normals[c].magnitude();
+        clusters[c].sortKey = (magnitude > 0) ? (centroids[c] - meshCentroid).dot(normals[c]) / magnitude : 0;
+    }
+    std::stable_sort(clusters.begin(), clusters.end(), [](const VROTriangleCluster &a, const VROTriangleCluster &b) {
+        return a.sortKey > b.sortKey;
+    });
+    
+    std::vector<uint32_t> sorted;
+    sorted.reserve(indices.size());
+    for (const VROTriangleCluster &cluster : clusters) {
+        sorted.insert(sorted.end(), indices.begin() + cluster.start * 3, indices.begin() + cluster.end * 3);
+    }
+    indices = std::move(sorted);
+}
+
+#pragma mark - Vertex Fetch
+
+bool VROMeshOptimizer::canReorderVertices(const std::vector<std::shared_ptr<VROGeometrySource>> &sources,
+                                          const std::vector<std::shared_ptr<VROGeometryElement>> &elements) {
+    if (sources.empty()) {
+        return false;
+    }
+    int vertexCount = sources.front()->getVertexCount();
+    if (vertexCount <= 0) {
+        return false;
+    }
+    for (const std::shared_ptr<VROGeometrySource> &source : sources) {
+        std::shared_ptr<VROData> data = source->getData();
+        int attributeSize = source->getComponentsPerVertex() * source->getBytesPerComponent();
+        int stride = source->getDataStride();
+        if (source->getVertexBuffer() || !data || source->getGeometryElementIndex() != -1 ||
+            source->getVertexCount() != vertexCount || stride <= 0 ||
+            source->getDataOffset() + attributeSize > stride ||
+            (vertexCount - 1) * stride + source->getDataOffset() + attributeSize > data->getDataLength()) {
+            return false;
+        }
+    }
+    for (const std::shared_ptr<VROGeometryElement> &element : elements) {
+        if (element->getPrimitiveType() != VROGeometryPrimitiveType::Triangle || !element->getData() ||
+            (element->getBytesPerIndex() != 2 && element->getBytesPerIndex() != 4)) {
+            return false;
+        }
+        bool inRange = element->visitIndices([vertexCount](int index, int indexRead) {
+            return indexRead >= 0 && indexRead < vertexCount;
+        });
+        if (!inRange) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void VROMeshOptimizer::weldVertices(const std::vector<std::shared_ptr<VROGeometrySource>> &sources,
+                                    std::vector<std::vector<uint32_t>> &indices) {
+    int vertexCount = sources.front()->getVertexCount();
+    
+    // Vertices are compared by the bytes of their attributes, ignoring padding
+    auto attribute = [](const std::shared_ptr<VROGeometrySource> &source, int v) {
+        return (const uint8_t *) source->getData()->getData() + v * source->getDataStride() + source->getDataOffset();
+    };
+    auto equal = [&sources, &attribute](int a, int b) {
+        for (const std::shared_ptr<VROGeometrySource> &source : sources) {
+            int size = source->getComponentsPerVertex() * source->getBytesPerComponent();
+            if (memcmp(attribute(source, a), attribute(source, b), size) != 0) {
+                return false;
+            }
+        }
+        return true;
+    };
+    
+    /*
+     Hash collisions between distinct vertices simply leave the later vertex
+     unwelded.
+     */
+    std::vector<uint32_t> canonical(vertexCount);
+    std::unordered_map<uint64_t, uint32_t> firstByHash;
+    firstByHash.reserve(vertexCount);
+    for (int v = 0; v < vertexCount; v++) {
+        uint64_t h = 0;
+        for (const std::shared_ptr<VROGeometrySource> &source : sources) {
+            h = VROGeometryCache::hash(attribute(source, v), source->getComponentsPerVertex() * source->getBytesPerComponent(), h);
+        }
+        auto it = firstByHash.find(h);
+        if (it == firstByHash.end()) {
+            firstByHash[h] = v;
+            canonical[v] = v;
+        } else {
+            canonical[v] = equal(it->second, v) ? it->second : v;
+        }
+    }
+    
+    for (std::vector<uint32_t> &elementIndices : indices) {
+        for (uint32_t &index : elementIndices) {
+            index = canonical[index];
+        }
+    }
+}
+
+void VROMeshOptimizer::reorderVertexFetch(std::vector<std::shared_ptr<VROGeometrySource>> &sources,
+                                          std::vector<std::vector<uint32_t>> &indices) {
+    int vertexCount = sources.front()->getVertexCount();
+    
+    std::vector<int> remap(vertexCount, -1);
+    std::vector<int> order;
+    for (std::vector<uint32_t> &elementIndices : indices) {
+        for (uint32_t &index : elementIndices) {
+            if (remap[index] < 0) {
+                remap[index] = (int) order.size();
+                order.push_back(index);
+            }
+            index = remap[index];
+        }
+    }
+    int reorderedCount = (int) order.size();
+    
+    /*
+     Copy each data buffer row by row in the new order. Sources that shared a
+     buffer share the reordered buffer.
+     */
+    std::map<std::shared_ptr<VROData>, std::shared_ptr<VROData>> reorderedData;
+    std::vector<std::shared_ptr<VROGeometrySource>> reorderedSources;
+    for (const std::shared_ptr<VROGeometrySource> &source : sources) {
+        std::shared_ptr<VROData> data = source->getData();
+        int stride = source->getDataStride();
+        
+        std::shared_ptr<VROData> &reordered = reorderedData[data];
+        if (!reordered) {
+            int length = reorderedCount * stride;
+            uint8_t *out = (uint8_t *) calloc(length, 1);
+            const uint8_t *in = (const uint8_t *) data->getData();
+            for (int r = 0; r < reorderedCount; r++) {
+                int rowLength = std::min(stride, data->getDataLength() - order[r] * stride);
+                memcpy(out + r * stride, in + order[r] * stride, rowLength);
+            }
+            reordered = std::make_shared<VROData>((void *) out, length, VRODataOwnership::Move);
+        }
+        reorderedSources.push_back(std::make_shared<VROGeometrySource>(reordered, source->getSemantic(), reorderedCount,
+                                                                       source->isFloatComponents(),
+                                                                       source->getComponentsPerVertex(),
+                                                                       source->getBytesPerComponent(),
+                                                                       source->getDataOffset(),
+                                                                       stride));
+    }
+    sources = reorderedSources;
+}
+
+#pragma mark - Simplification
+
+/*
+ The symmetric 4x4 matrix of a quadric error metric, summing the squared
+ distances to a set of planes.
+ */
+struct VROQuadric {
+    double a2, b2, c2, d2, ab, ac, ad, bc, bd, cd;
+    
+    void addPlane(const VROVector3f &n, double d, double weight) {
+        a2 += weight * n.x * n.x; b2 += weight * n.y * n.y; c2 += weight * n.z * n.z; d2 += weight * d * d;
+        ab += weight * n.x * n.y; ac += weight * n.x * n.z; ad += weight * n.x * d;
+        bc += weight * n.y * n.z; bd += weight * n.y * d;  cd += weight * n.z * d;
+    }
+    void add(const VROQuadric &q) {
+        a2 += q.a2; b2 += q.b2; c2 += q.c2; d2 += q.d2;
+        ab += q.ab; ac += q.ac; ad += q.ad; bc += q.bc; bd += q.bd; cd += q.cd;
+    }
+    double evaluate(const VROVector3f &p) const {
+        double x = p.x, y = p.y, z = p.z;
+        double error = a2 * x * x + b2 * y * y + c2 * z * z + d2 +
+                       2 * (ab * x * y + ac * x * z + bc * y * z + ad * x + bd * y + cd * z);
+        return std::max(error, 0.0);
+    }
+};
+
+std::vector<uint32_t> VROMeshOptimizer::simplify(const std::vector<uint32_t> &indices, const std::vector<VROVector3f> &positions,
+                                                 size_t targetIndexCount, float maxError, float *outError) {
+    *outError = 0;
+    int vertexCount = (int) positions.size();
+    for (uint32_t v : indices) {
+        if (v >= vertexCount) {
+            return indices;
+        }
+    }
+    
+    VROVector3f min = positions.empty() ? VROVector3f() : positions.front();
+    VROVector3f max = min;
+    for (const VROVector3f &p : positions) {
+        min = VROVector3f(std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z));
+        max = VROVector3f(std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z));
+    }
+    float extent = (max - min).magnitude();
+    if (extent <= 0 || indices.size() <= targetIndexCount) {
+        return indices;
+    }
+    
+    // Each vertex's quadric measures its distance to the planes of its triangles, weighted by area
+    std::vector<VROQuadric> quadrics(vertexCount, VROQuadric());
+    for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+        const VROVector3f &A = positions[indices[t]];
+        VROVector3f normal = (positions[indices[t + 1]] - A).cross(positions[indices[t + 2]] - A);
+        float area = normal.magnitude();
+        if (area <= 0) {
+            continue;
+        }
+        normal = normal / area;
+        for (int c = 0; c < 3; c++) {
+            quadrics[indices[t + c]].addPlane(normal, -normal.dot(A), area);
+        }
+    }
+    
+    // Vertices on an edge not shared by exactly two triangles are on a border (or seam), and are locked
+    std::unordered_map<uint64_t, int> edgeUses;
+    edgeUses.reserve(indices.size());
+    for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+        for (int c = 0; c < 3; c++) {
+            uint64_t a = indices[t + c], b = indices[t + (c + 1) % 3];
+            edgeUses[(std::min(a, b) << 32) | std::max(a, b)]++;
+        }
+    }
+    std::vector<bool> locked(vertexCount, false);
+    for (auto &edge : edgeUses) {
+        if (edge.second != 2) {
+            locked[edge.first >> 32] = true;
+            locked[edge.first & 0xFFFFFFFF] = true;
+        }
+    }
+    
+    double errorLimit = (double) maxError * extent * maxError * extent;
+    double reachedError = 0;
+    
+    struct VROCollapse {
+        uint32_t from, to;
+        double cost;
+    };
+    std::vector<VROCollapse> collapses;
+    std::vector<int> adjacencyOffsets(vertexCount + 1);
+    std::vector<int> adjacency;
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<bool> touched(vertexCount);
+    
+    std::vector<uint32_t> result = indices;
+    while (result.size() > targetIndexCount) {
+        int triangleCount = (int) result.size() / 3;
+        
+        // The triangles adjacent to each vertex
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for (uint32_t v : result) {
+            adjacencyOffsets[v + 1]++;
+        }
+        for (int v = 0; v < vertexCount; v++) {
+            adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        }
+        adjacency.resize(result.size());
+        std::vector<int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (int i = 0; i < result.size(); i++) {
+            adjacency[fill[result[i]]++] = i / 3;
+        }
+        
+        // The cheapest collapse of each edge; each interior edge is seen once in ascending order
+        collapses.clear();
+        for (int i = 0; i < result.size(); i++) {
+            uint32_t a = result[i];
+            uint32_t b = result[(i % 3 == 2) ? i - 2 : i + 1];
+            if (a >= b || (locked[a] && locked[b])) {
+                continue;
+            }
+            double cost = quadrics[a].evaluate(positions[b]) + quadrics[b].evaluate(positions[b]);
+            double reverseCost = quadrics[a].evaluate(positions[a]) + quadrics[b].evaluate(positions[a]);
+            if (locked[b] || (!locked[a] && cost <= reverseCost)) {
+                collapses.push_back({ a, b, cost });
+            } else {
+                collapses.push_back({ b, a, reverseCost });
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const VROCollapse &x, const VROCollapse &y) {
+            return x.cost < y.cost;
+        });
+        
+        /*
+         Perform collapses cheapest first. Each collapse removes about two
+         triangles and freezes the neighborhood it changed for the rest of the
+         pass, so that the flip tests of later collapses stay valid.
+         */
+        for (int v = 0; v < vertexCount; v++) {
+            remap[v] = v;
+        }
+        std::fill(touched.begin(), touched.end(), false);
+        
+        size_t collapsesNeeded = (result.size() - targetIndexCount + 5) / 6;
+        size_t collapsed = 0;
+        for (const VROCollapse &collapse : collapses) {
+            if (collapse.cost > errorLimit || collapsed >= collapsesNeeded) {
+                break;
+            }
+            if (touched[collapse.from] || touched[collapse.to]) {
+                continue;
+            }
+            
+            // Reject collapses that flip or badly stretch a remaining triangle
+            bool valid = true;
+            for (int k = adjacencyOffsets[collapse.from]; k < adjacencyOffsets[collapse.from + 1] && valid; k++) {
+                const uint32_t *triangle = &result[adjacency[k] * 3];
+                if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) {
+                    continue;
+                }
+                VROVector3f before[3], after[3];
+                for (int c = 0; c < 3; c++) {
+                    before[c] = positions[triangle[c]];
+                    after[c] = positions[triangle[c] == collapse.from ? collapse.to : triangle[c]];
+                }
+                VROVector3f n0 = (before[1] - before[0]).cross(before[2] - before[0]);
+                VROVector3f n1 = (after[1] - after[0]).cross(after[2] - after[0]);
+                valid = n0.dot(n1) > 0.25f * n0.magnitude() * n1.magnitude();
+            }
+            if (!valid) {
+                continue;
+            }
+            
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to].add(quadrics[collapse.from]);
+            touched[collapse.to] = true;
+            for (int k = adjacencyOffsets[collapse.from]; k < adjacencyOffsets[collapse.from + 1]; k++) {
+                for (int c = 0; c < 3; c++) {
+                    touched[result[adjacency[k] * 3 + c]] = true;
+                }
+            }
+            reachedError = std::max(reachedError, collapse.cost);
+            collapsed++;
+        }
+        if (collapsed == 0) {
+            break;
+        }
+        
+        // Rewrite the triangles, dropping those that collapsed
+        size_t write = 0;
+        for (int t = 0; t < triangleCount; t++) {
+            uint32_t a = remap[result[t * 3]], b = remap[result[t * 3 + 1]], c = remap[result[t * 3 + 2]];
+            if (a != b && b != c && a != c) {
+                result[write++] = a;
+                result[write++] = b;
+                result[write++] = c;
+            }
+        }
+        result.resize(write);
+    }
+    
+    *outError = (float) (sqrt(reachedError) / extent);
+    return result;
+}
+
+#pragma mark - Levels of Detail
+
+std::vector<VROMeshLOD> VROMeshOptimizer::generateLODs(const std::vector<std::shared_ptr<VROGeometrySource>> &sources,
+                                                       const std::vector<std::shared_ptr<VROGeometryElement>> &elements,
+                                                       bool reorderVertices) {
+    std::vector<VROMeshLOD> lods;
+    
+    int triangleCount = 0;
+    for (const std::shared_ptr<VROGeometryElement> &element : elements) {
+        if (element->getPrimitiveType() != VROGeometryPrimitiveType::Triangle || !element->getData() ||
+            (element->getBytesPerIndex() != 2 && element->getBytesPerIndex() != 4)) {
+            return lods;
+        }
+        triangleCount += element->getPrimitiveCount();
+    }
+    if (triangleCount < kMinLODTriangles) {
+        return lods;
+    }
+    
+    // Read the positions each element indexes, once per source
+    std::map<std::shared_ptr<VROGeometrySource>, std::vector<VROVector3f>> positionsBySource;
+    std::vector<std::shared_ptr<VROGeometrySource>> elementPositions;
+    std::vector<std::vector<uint32_t>> indices;
+    for (int i = 0; i < elements.size(); i++) {
+        std::shared_ptr<VROGeometrySource> positions = VROFindPositions(sources, i);
+        if (!positions) {
+            return lods;
+        }
+        if (positionsBySource.find(positions) == positionsBySource.end()) {
+            positionsBySource[positions] = VROReadPositions(positions);
+        }
+        elementPositions.push_back(positions);
+        indices.push_back(VROReadIndices(elements[i]));
+    }
+    bool reorder = reorderVertices && canReorderVertices(sources, elements);
+    
+    // Errors accumulate, since each LOD is simplified from the last
+    float previousCoverage = 2.0f;
+    float previousError = 0;
+    for (int level = 1; level <= kMaxLODLevels; level++) {
+        // Each LOD simplifies the last; the elements simplify independently
+        std::vector<std::vector<uint32_t>> simplified(elements.size());
+        std::vector<float> errors(elements.size(), 0);
+        VROJobSystem::getShared()->parallelFor(0, (int) elements.size(), 1,
+                               [&indices, &simplified, &errors, &elementPositions, &positionsBySource](int i) {
+            size_t target = (size_t) (indices[i].size() / 3 * kLODTriangleReduction) * 3;
+            simplified[i] = simplify(indices[i], positionsBySource.at(elementPositions[i]), target,
+                                     kMaxLODError, &errors[i]);
+            if (simplified[i].empty()) {
+                simplified[i] = indices[i];
+            }
+        });
+        
+        int lodTriangleCount = 0;
+        float error = previousError;
+        for (int i = 0; i < elements.size(); i++) {
+            lodTriangleCount += (int) simplified[i].size() / 3;
+            error = std::max(error, previousError + errors[i]);
+        }
+        if (lodTriangleCount > triangleCount * kMaxLODTriangleRatio) {
+            break;
+        }
+        
+        float coverage = std::min(previousCoverage * 0.5f,
+                                  error > 0 ? kLODPixelError / (error * kLODReferenceHeight) : 1.0f);
+        if (coverage < kMinLODCoverage) {
+            break;
+        }
+        
+        VROMeshLOD lod;
+        lod.sources = sources;
+        lod.screenCoverage = coverage;
+        for (int i = 0; i < elements.size(); i++) {
+            std::shared_ptr<VROGeometryElement> element = VROBuildElement(simplified[i], elementPositions[i]->getVertexCount());
+            element->optimizeTriangleOrder(elementPositions[i]);
+            lod.elements.push_back(element);
+        }
+        
+        // Compact the vertices down to those the LOD still uses
+        if (reorder) {
+            std::vector<std::vector<uint32_t>> lodIndices;
+            for (const std::shared_ptr<VROGeometryElement> &element : lod.elements) {
+                lodIndices.push_back(VROReadIndices(element));
+            }
+            reorderVertexFetch(lod.sources, lodIndices);
+            int lodVertexCount = lod.sources.front()->getVertexCount();
+            for (int i = 0; i < elements.size(); i++) {
+                lod.elements[i] = VROBuildElement(lodIndices[i], lodVertexCount);
+            }
+        }
+        pinfo("Generated LOD %d with %d triangles (from %d), error %f, used below screen coverage %f",
+              level, lodTriangleCount, triangleCount, error, coverage);
+        lods.push_back(lod);
+        
+        indices = std::move(simplified);
+        triangleCount = lodTriangleCount;
+        previousCoverage = coverage;
+        previousError = error;
+        if (triangleCount < kMinLODTriangles) {
+            break;
+        }
+    }
+    return lods;
+}
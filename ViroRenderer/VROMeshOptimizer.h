@@ -0,0 +1,162 @@
+//
+//  VROMeshOptimizer.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROMeshOptimizer_h
+#define VROMeshOptimizer_h
+
+#include <memory>
+#include <vector>
+#include <stdint.h>
+#include "VROVector3f.h"
+
+class VROGeometrySource;
+class VROGeometryElement;
+
+/*
+ A simplified version of a mesh produced by VROMeshOptimizer::generateLODs,
+ suitable for rendering when the mesh covers less than screenCoverage of the
+ viewport's height.
+ */
+struct VROMeshLOD {
+    std::vector<std::shared_ptr<VROGeometrySource>> sources;
+    std::vector<std::shared_ptr<VROGeometryElement>> elements;
+    float screenCoverage;
+};
+
+/*
+ Load-time optimization of mesh data for the GPU, run by loaders before their
+ geometry is handed to VROGeometry (and before it is stored in the
+ VROGeometryCache, so cached meshes load optimized). The stages are:
+
+ 1. Vertex welding: byte-identical vertices are merged, so that de-indexed
+    meshes (e.g. from OBJ) share vertices between triangles.
+ 2. Vertex cache optimization: the triangles of each element are reordered
+    with Tipsify (Sander et al. 2007) to maximize post-transform cache hits.
+ 3. Overdraw optimization: the clusters of triangles produced by Tipsify are
+    sorted so that those facing outward from the mesh are drawn first,
+    occluding the rest (from the same paper).
+ 4. Vertex fetch optimization: vertices are renumbered in the order they are
+    first referenced, so that vertex fetches walk memory linearly, and
+    indices are narrowed to 16 bits where possible.
+
+ Stages 2 and 3 only reorder triangles, and are always safe. Stages 1 and 4
+ rewrite the vertex data, so they only run when the caller owns it outright
+ (see optimize()).
+
+ The optimizer also generates levels of detail for high-poly meshes, by
+ quadric error edge collapse (Garland and Heckbert 1997).
+ */
+class VROMeshOptimizer {
+public:
+
+    /*
+     Optimize the given mesh, replacing the sources and elements in the given
+     vectors with their optimized counterparts. The elements of the mesh are
+     optimized in parallel.
+
+     If reorderVertices is true, vertices are also welded and reordered. This
+     requires that all sources are CPU data applying to every element, and is
+     skipped otherwise. Callers must not set reorderVertices if any other
+     object indexes the mesh's vertices (e.g. morph targets).
+     */
+    static void optimize(std::vector<std::shared_ptr<VROGeometrySource>> &sources,
+                         std::vector<std::shared_ptr<VROGeometryElement>> &elements,
+                         bool reorderVertices);
+
+    /*
+     Reorder the given triangle list for a post-transform vertex cache, using
+     Tipsify. The start of each cluster of triangles that Tipsify had to
+     restart away from the cache (the triangle index, not the index offset)
+     is appended to outHardBoundaries, beginning with 0.
+     */
+    static std::vector<uint32_t> optimizeVertexCache(const std::vector<uint32_t> &indices, int vertexCount,
+                                                     std::vector<int> *outHardBoundaries);
+
+    /*
+     Reorder the clusters of the given vertex cache optimized triangle list to
+     reduce overdraw. Hard clusters are split where doing so costs at most
+     the given factor of their cache efficiency, and the clusters are then
+     sorted outward-facing first.
+     */
+    static void optimizeOverdraw(std::vector<uint32_t> &indices, const std::vector<int> &hardBoundaries,
+                                 const std::vector<VROVector3f> &positions, float threshold = 1.05);
+
+    /*
+     The average number of vertex cache misses per triangle of the given
+     triangle list, simulating a FIFO cache of the size Tipsify targets.
+     */
+    static float computeACMR(const std::vector<uint32_t> &indices, int vertexCount);
+    
+    /*
+     Generate a chain of successively simplified versions of the given
+     (optimized) mesh, each with half the triangles of the last, until
+     simplification stops paying off. Meshes with few triangles get no LODs.
+     The screen coverage of each LOD is derived from its simplification
+     error, so that the error stays around a pixel when the LOD is selected.
+
+     If reorderVertices is true (see optimize()), each LOD gets its own
+     compacted copy of the vertices it uses. Otherwise every LOD shares the
+     mesh's sources, and only its elements are new.
+     */
+    static std::vector<VROMeshLOD> generateLODs(const std::vector<std::shared_ptr<VROGeometrySource>> &sources,
+                                                const std::vector<std::shared_ptr<VROGeometryElement>> &elements,
+                                                bool reorderVertices);
+    
+    /*
+     Simplify the given triangle list by collapsing edges onto their
+     endpoints in order of quadric error, until no more than targetIndexCount
+     indices remain, or until the next collapse would move the surface by
+     more than maxError (relative to the extent of the mesh). Vertices on
+     borders, including the seams between vertices split for differing
+     attributes, never move. The simplified list indexes the same vertices;
+     the error it reached is returned in outError.
+     */
+    static std::vector<uint32_t> simplify(const std::vector<uint32_t> &indices, const std::vector<VROVector3f> &positions,
+                                          size_t targetIndexCount, float maxError, float *outError);
+
+private:
+
+    /*
+     True if the vertices of the given mesh can be rewritten.
+     */
+    static bool canReorderVertices(const std::vector<std::shared_ptr<VROGeometrySource>> &sources,
+                                   const std::vector<std::shared_ptr<VROGeometryElement>> &elements);
+
+    /*
+     Point each index at the first vertex identical to the one it references.
+     */
+    static void weldVertices(const std::vector<std::shared_ptr<VROGeometrySource>> &sources,
+                             std::vector<std::vector<uint32_t>> &indices);
+
+    /*
+     Renumber vertices in order of first use, dropping unreferenced vertices,
+     and replace the sources with sources over the reordered data.
+     */
+    static void reorderVertexFetch(std::vector<std::shared_ptr<VROGeometrySource>> &sources,
+                                   std::vector<std::vector<uint32_t>> &indices);
+
+};
+
+#endif /* VROMeshOptimizer_h */
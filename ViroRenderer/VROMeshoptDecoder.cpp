@@ -0,0 +1,536 @@
+//
+//  VROMeshoptDecoder.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROMeshoptDecoder.h"
+#include "VROLog.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+static const unsigned char kVertexHeader = 0xA0;
+static const unsigned char kIndexHeader = 0xE0;
+static const unsigned char kSequenceHeader = 0xD0;
+
+// Vertex data is decoded in blocks of up to 256 vertices, one byte channel at a
+// time, each channel split into groups of 16 bytes.
+static const size_t kVertexBlockSizeBytes = 8192;
+static const size_t kVertexBlockMaxSize = 256;
+static const size_t kByteGroupSize = 16;
+static const size_t kByteGroupDecodeLimit = 24;
+static const size_t kTailMaxSize = 32;
+
+static size_t getVertexBlockSize(size_t vertexSize) {
+    size_t result = kVertexBlockSizeBytes / vertexSize;
+    result &= ~(kByteGroupSize - 1);
+    return std::min(result, kVertexBlockMaxSize);
+}
+
+static unsigned char unzigzag8(unsigned char v) {
+    return (unsigned char) (-(v & 1) ^ (v >> 1));
+}
+
+static unsigned int decodeVByte(const unsigned char *&data) {
+    unsigned char lead = *data++;
+    if (lead < 128) {
+        return lead;
+    }
+
+    // Up to 4 more groups of 7 bits each
+    unsigned int result = lead & 127;
+    unsigned int shift = 7;
+    for (int i = 0; i < 4; i++) {
+        unsigned char group = *data++;
+        result |= (unsigned int) (group & 127) << shift;
+        shift += 7;
+        if (group < 128) {
+            break;
+        }
+    }
+    return result;
+}
+
+static unsigned int decodeIndex(const unsigned char *&data, unsigned int last) {
+    unsigned int v = decodeVByte(data);
+    unsigned int d = (v >> 1) ^ -(int)(v & 1);
+    return last + d;
+}
+
+/*
+ Decode a group of 16 bytes, each stored with 0, 2, 4, or 8 bits. Values that do
+ not fit in 2 or 4 bits are stored as the maximum value, followed by the full byte
+ after the packed bits.
+ */
+static const unsigned char *decodeBytesGroup(const unsigned char *data, unsigned char *buffer, int bitslog2) {
+    if (bitslog2 == 0) {
+        memset(buffer, 0, kByteGroupSize);
+        return data;
+    } else if (bitslog2 == 3) {
+        memcpy(buffer, data, kByteGroupSize);
+        return data + kByteGroupSize;
+    }
+
+    int bits = bitslog2 == 1 ? 2 : 4;
+    unsigned char sentinel = (unsigned char) ((1 << bits) - 1);
+    const unsigned char *escaped = data + bits * 2;
+
+    for (size_t i = 0; i < kByteGroupSize; i++) {
+        unsigned char byte = data[(i * bits) / 8];
+        unsigned char enc = (unsigned char) ((byte >> (8 - bits - (i * bits) % 8)) & sentinel);
+        if (enc == sentinel) {
+            buffer[i] = *escaped++;
+        } else {
+            buffer[i] = enc;
+        }
+    }
+    return escaped;
+}
+
+static const unsigned char *decodeBytes(const unsigned char *data, const unsigned char *dataEnd,
+                                        unsigned char *buffer, size_t bufferSize) {
+    // Header has 2 bits per group, encoding the bit width of each group
+    size_t headerSize = (bufferSize / kByteGroupSize + 3) / 4;
+    if ((size_t) (dataEnd - data) < headerSize) {
+        return nullptr;
+    }
+
+    const unsigned char *header = data;
+    data += headerSize;
+
+    for (size_t i = 0; i < bufferSize; i += kByteGroupSize) {
+        if ((size_t) (dataEnd - data) < kByteGroupDecodeLimit) {
+            return nullptr;
+        }
+        size_t headerOffset = i / kByteGroupSize;
+        int bitslog2 = (header[headerOffset / 4] >> ((headerOffset % 4) * 2)) & 3;
+        data = decodeBytesGroup(data, buffer + i, bitslog2);
+    }
+    return data;
+}
+
+/*
+ Decode a block of vertices. Each byte of the vertex is stored as a delta from the
+ same byte of the previous vertex, and the bytes are transposed so that each
+ channel compresses independently.
+ */
+static const unsigned char *decodeVertexBlock(const unsigned char *data, const unsigned char *dataEnd,
+                                              unsigned char *vertexData, size_t vertexCount, size_t vertexSize,
+                                              unsigned char lastVertex[256]) {
+    unsigned char buffer[kVertexBlockMaxSize];
+    unsigned char transposed[kVertexBlockSizeBytes];
+    size_t vertexCountAligned = (vertexCount + kByteGroupSize - 1) & ~(kByteGroupSize - 1);
+
+    for (size_t k = 0; k < vertexSize; k++) {
+        data = decodeBytes(data, dataEnd, buffer, vertexCountAligned);
+        if (!data) {
+            return nullptr;
+        }
+
+        size_t vertexOffset = k;
+        unsigned char p = lastVertex[k];
+        for (size_t i = 0; i < vertexCount; i++) {
+            unsigned char v = (unsigned char) (unzigzag8(buffer[i]) + p);
+            transposed[vertexOffset] = v;
+            p = v;
+            vertexOffset += vertexSize;
+        }
+    }
+
+    memcpy(vertexData, transposed, vertexCount * vertexSize);
+    memcpy(lastVertex, &transposed[vertexSize * (vertexCount - 1)], vertexSize);
+    return data;
+}
+
+#pragma mark - Decoding
+
+bool VROMeshoptDecoder::decode(VROMeshoptMode mode, VROMeshoptFilter filter,
+                               void *destination, size_t count, size_t stride,
+                               const unsigned char *source, size_t sourceLength) {
+    bool success = false;
+    if (mode == VROMeshoptMode::Attributes) {
+        if (stride == 0 || stride > 256 || stride % 4 != 0) {
+            perr("Invalid byte stride %d for meshopt compressed attributes", (int) stride);
+            return false;
+        }
+        success = decodeVertexBuffer((unsigned char *) destination, count, stride, source, sourceLength);
+    } else {
+        if (stride != 2 && stride != 4) {
+            perr("Invalid byte stride %d for meshopt compressed indices", (int) stride);
+            return false;
+        }
+        if (mode == VROMeshoptMode::Triangles) {
+            success = decodeIndexBuffer(destination, count, stride, source, sourceLength);
+        } else {
+            success = decodeIndexSequence(destination, count, stride, source, sourceLength);
+        }
+    }
+    if (!success) {
+        return false;
+    }
+
+    switch (filter) {
+        case VROMeshoptFilter::Octahedral:
+            if (stride != 4 && stride != 8) {
+                perr("Invalid byte stride %d for octahedral meshopt filter", (int) stride);
+                return false;
+            }
+            applyOctahedralFilter(destination, count, stride);
+            break;
+        case VROMeshoptFilter::Quaternion:
+            if (stride != 8) {
+                perr("Invalid byte stride %d for quaternion meshopt filter", (int) stride);
+                return false;
+            }
+            applyQuaternionFilter(destination, count);
+            break;
+        case VROMeshoptFilter::Exponential:
+            applyExponentialFilter(destination, count, stride);
+            break;
+        default:
+            break;
+    }
+    return true;
+}
+
+bool VROMeshoptDecoder::decodeVertexBuffer(unsigned char *destination, size_t vertexCount, size_t vertexSize,
+                                           const unsigned char *source, size_t sourceLength) {
+    if (sourceLength < 1 + vertexSize) {
+        return false;
+    }
+
+    const unsigned char *data = source;
+    const unsigned char *dataEnd = source + sourceLength;
+
+    unsigned char header = *data++;
+    if ((header & 0xF0) != kVertexHeader || (header & 0x0F) > 0) {
+        perr("Unsupported meshopt vertex encoding %d", (int) header);
+        return false;
+    }
+
+    // The tail holds the first vertex, which is the baseline for the deltas of the
+    // first block; it is padded to a minimum size so groups can be read unchecked
+    size_t tailSize = std::max(vertexSize, kTailMaxSize);
+    if ((size_t) (dataEnd - data) < tailSize) {
+        return false;
+    }
+
+    unsigned char lastVertex[256];
+    memcpy(lastVertex, dataEnd - vertexSize, vertexSize);
+
+    size_t blockSize = getVertexBlockSize(vertexSize);
+    size_t vertexOffset = 0;
+    while (vertexOffset < vertexCount) {
+        size_t count = std::min(blockSize, vertexCount - vertexOffset);
+        data = decodeVertexBlock(data, dataEnd, destination + vertexOffset * vertexSize,
+                                 count, vertexSize, lastVertex);
+        if (!data) {
+            return false;
+        }
+        vertexOffset += count;
+    }
+    return (size_t) (dataEnd - data) == tailSize;
+}
+
+static void writeTriangle(void *destination, size_t offset, size_t indexSize,
+                          unsigned int a, unsigned int b, unsigned int c) {
+    if (indexSize == 2) {
+        unsigned short *out = (unsigned short *) destination;
+        out[offset + 0] = (unsigned short) a;
+        out[offset + 1] = (unsigned short) b;
+        out[offset + 2] = (unsigned short) c;
+    } else {
+        unsigned int *out = (unsigned int *) destination;
+        out[offset + 0] = a;
+        out[offset + 1] = b;
+        out[offset + 2] = c;
+    }
+}
+
+static void pushEdgeFifo(unsigned int fifo[16][2], unsigned int a, unsigned int b, size_t &offset) {
+    fifo[offset][0] = a;
+    fifo[offset][1] = b;
+    offset = (offset + 1) & 15;
+}
+
+static void pushVertexFifo(unsigned int fifo[16], unsigned int v, size_t &offset, int cond = 1) {
+    fifo[offset] = v;
+    offset = (offset + cond) & 15;
+}
+
+bool VROMeshoptDecoder::decodeIndexBuffer(void *destination, size_t indexCount, size_t indexSize,
+                                          const unsigned char *source, size_t sourceLength) {
+    if (indexCount % 3 != 0) {
+        return false;
+    }
+
+    // The smallest valid encoding is the header, one byte per triangle, and the
+    // 16 byte auxiliary code table that ends the stream
+    if (sourceLength < 1 + indexCount / 3 + 16) {
+        return false;
+    }
+    if ((source[0] & 0xF0) != kIndexHeader) {
+        perr("Unsupported meshopt index encoding %d", (int) source[0]);
+        return false;
+    }
+    int version = source[0] & 0x0F;
+    if (version > 1) {
+        perr("Unsupported meshopt index encoding version %d", version);
+        return false;
+    }
+
+    // Triangles are coded against FIFOs of recently seen edges and vertices. The
+    // FIFOs must be updated exactly as the encoder updated them.
+    unsigned int edgeFifo[16][2];
+    unsigned int vertexFifo[16];
+    memset(edgeFifo, -1, sizeof(edgeFifo));
+    memset(vertexFifo, -1, sizeof(vertexFifo));
+    size_t edgeFifoOffset = 0;
+    size_t vertexFifoOffset = 0;
+
+    unsigned int next = 0;
+    unsigned int last = 0;
+    int fecmax = version >= 1 ? 13 : 15;
+
+    const unsigned char *code = source + 1;
+    const unsigned char *data = code + indexCount / 3;
+    const unsigned char *dataSafeEnd = source + sourceLength - 16;
+    const unsigned char *codeauxTable = dataSafeEnd;
+
+    for (size_t i = 0; i < indexCount; i += 3) {
+        // Each triangle reads at most 16 bytes of data, which the code table guarantees
+        if (data > dataSafeEnd) {
+            return false;
+        }
+
+        unsigned char codetri = *code++;
+        if (codetri < 0xF0) {
+            // The triangle reuses an edge from the FIFO, and its third vertex is
+            // either new, in the vertex FIFO, or a free index
+            int fe = codetri >> 4;
+            unsigned int a = edgeFifo[(edgeFifoOffset - 1 - fe) & 15][0];
+            unsigned int b = edgeFifo[(edgeFifoOffset - 1 - fe) & 15][1];
+            unsigned int c;
+
+            int fec = codetri & 15;
+            if (fec < fecmax) {
+                int fec0 = fec == 0;
+                c = fec0 ? next : vertexFifo[(vertexFifoOffset - 1 - fec) & 15];
+                next += fec0;
+                pushVertexFifo(vertexFifo, c, vertexFifoOffset, fec0);
+            } else {
+                // 13 and 14 encode the last free index -1 and +1, 15 an explicit delta
+                last = c = (fec != 15) ? last + (fec - (fec ^ 3)) : decodeIndex(data, last);
+                pushVertexFifo(vertexFifo, c, vertexFifoOffset);
+            }
+
+            writeTriangle(destination, i, indexSize, a, b, c);
+            pushEdgeFifo(edgeFifo, c, b, edgeFifoOffset);
+            pushEdgeFifo(edgeFifo, a, c, edgeFifoOffset);
+        } else {
+            // The triangle has no cached edge. Codes below 0xFE look up the vertex
+            // FIFO indices in the table, others store them in the data.
+            unsigned int a, b, c;
+            int feb, fec;
+            if (codetri < 0xFE) {
+                unsigned char codeaux = codeauxTable[codetri & 15];
+                feb = codeaux >> 4;
+                fec = codeaux & 15;
+
+                a = next++;
+                int feb0 = feb == 0;
+                b = feb0 ? next : vertexFifo[(vertexFifoOffset - feb) & 15];
+                next += feb0;
+                int fec0 = fec == 0;
+                c = fec0 ? next : vertexFifo[(vertexFifoOffset - fec) & 15];
+                next += fec0;
+
+                pushVertexFifo(vertexFifo, a, vertexFifoOffset);
+                pushVertexFifo(vertexFifo, b, vertexFifoOffset, feb0);
+                pushVertexFifo(vertexFifo, c, vertexFifoOffset, fec0);
+            } else {
+                unsigned char codeaux = *data++;
+                int fea = codetri == 0xFE ? 0 : 15;
+                feb = codeaux >> 4;
+                fec = codeaux & 15;
+
+                // A zero code stored in the data resets the next index
+                if (codeaux == 0) {
+                    next = 0;
+                }
+
+                a = (fea == 0) ? next++ : 0;
+                b = (feb == 0) ? next++ : vertexFifo[(vertexFifoOffset - feb) & 15];
+                c = (fec == 0) ? next++ : vertexFifo[(vertexFifoOffset - fec) & 15];
+
+                // Free indices are delta encoded against the last free index
+                if (fea == 15) {
+                    last = a = decodeIndex(data, last);
+                }
+                if (feb == 15) {
+                    last = b = decodeIndex(data, last);
+                }
+                if (fec == 15) {
+                    last = c = decodeIndex(data, last);
+                }
+
+                pushVertexFifo(vertexFifo, a, vertexFifoOffset);
+                pushVertexFifo(vertexFifo, b, vertexFifoOffset, (feb == 0) | (feb == 15));
+                pushVertexFifo(vertexFifo, c, vertexFifoOffset, (fec == 0) | (fec == 15));
+            }
+
+            writeTriangle(destination, i, indexSize, a, b, c);
+            pushEdgeFifo(edgeFifo, b, a, edgeFifoOffset);
+            pushEdgeFifo(edgeFifo, c, b, edgeFifoOffset);
+            pushEdgeFifo(edgeFifo, a, c, edgeFifoOffset);
+        }
+    }
+
+    // All data must be consumed, ending at the code table
+    return data == dataSafeEnd;
+}
+
+bool VROMeshoptDecoder::decodeIndexSequence(void *destination, size_t indexCount, size_t indexSize,
+                                            const unsigned char *source, size_t sourceLength) {
+    // The smallest valid encoding is the header, one byte per index, and a 4 byte tail
+    if (sourceLength < 1 + indexCount + 4) {
+        return false;
+    }
+    if ((source[0] & 0xF0) != kSequenceHeader) {
+        perr("Unsupported meshopt index sequence encoding %d", (int) source[0]);
+        return false;
+    }
+    int version = source[0] & 0x0F;
+    if (version > 1) {
+        perr("Unsupported meshopt index sequence version %d", version);
+        return false;
+    }
+
+    const unsigned char *data = source + 1;
+    const unsigned char *dataSafeEnd = source + sourceLength - 4;
+
+    // Each index is a delta against one of two baselines, selected by its low bit
+    unsigned int last[2] = { 0, 0 };
+    for (size_t i = 0; i < indexCount; i++) {
+        // Each index reads at most 5 bytes, which the tail guarantees
+        if (data >= dataSafeEnd) {
+            return false;
+        }
+
+        unsigned int v = decodeVByte(data);
+        unsigned int current = v & 1;
+        v >>= 1;
+
+        unsigned int d = (v >> 1) ^ -(int)(v & 1);
+        unsigned int index = last[current] + d;
+        last[current] = index;
+
+        if (indexSize == 2) {
+            ((unsigned short *) destination)[i] = (unsigned short) index;
+        } else {
+            ((unsigned int *) destination)[i] = index;
+        }
+    }
+    return data == dataSafeEnd;
+}
+
+#pragma mark - Filters
+
+template <typename T>
+static void decodeOctahedral(T *data, size_t count) {
+    const float max = float((1 << (sizeof(T) * 8 - 1)) - 1);
+
+    for (size_t i = 0; i < count; i++) {
+        // The z component holds the scale of x and y: reconstruct z from it
+        float x = float(data[i * 4 + 0]);
+        float y = float(data[i * 4 + 1]);
+        float z = float(data[i * 4 + 2]) - fabsf(x) - fabsf(y);
+
+        // Unfold the octahedron for vectors with negative z
+        float t = (z >= 0.f) ? 0.f : z;
+        x += (x >= 0.f) ? t : -t;
+        y += (y >= 0.f) ? t : -t;
+
+        float l = sqrtf(x * x + y * y + z * z);
+        float s = max / l;
+
+        data[i * 4 + 0] = T(int(x * s + (x >= 0.f ? 0.5f : -0.5f)));
+        data[i * 4 + 1] = T(int(y * s + (y >= 0.f ? 0.5f : -0.5f)));
+        data[i * 4 + 2] = T(int(z * s + (z >= 0.f ? 0.5f : -0.5f)));
+    }
+}
+
+void VROMeshoptDecoder::applyOctahedralFilter(void *data, size_t count, size_t stride) {
+    if (stride == 4) {
+        decodeOctahedral((signed char *) data, count);
+    } else {
+        decodeOctahedral((short *) data, count);
+    }
+}
+
+void VROMeshoptDecoder::applyQuaternionFilter(void *data, size_t count) {
+    const float scale = 1.f / sqrtf(2.f);
+    short *q = (short *) data;
+
+    for (size_t i = 0; i < count; i++) {
+        // The low 2 bits of the last component are the index of the omitted (largest)
+        // component, and the remaining bits hold the scale of the other three
+        int sf = q[i * 4 + 3] | 3;
+        float ss = scale / float(sf);
+
+        float x = float(q[i * 4 + 0]) * ss;
+        float y = float(q[i * 4 + 1]) * ss;
+        float z = float(q[i * 4 + 2]) * ss;
+
+        float ww = 1.f - x * x - y * y - z * z;
+        float w = sqrtf(ww >= 0.f ? ww : 0.f);
+
+        int xf = int(x * 32767.f + (x >= 0.f ? 0.5f : -0.5f));
+        int yf = int(y * 32767.f + (y >= 0.f ? 0.5f : -0.5f));
+        int zf = int(z * 32767.f + (z >= 0.f ? 0.5f : -0.5f));
+        int wf = int(w * 32767.f + 0.5f);
+
+        int qc = q[i * 4 + 3] & 3;
+        q[i * 4 + ((qc + 1) & 3)] = short(xf);
+        q[i * 4 + ((qc + 2) & 3)] = short(yf);
+        q[i * 4 + ((qc + 3) & 3)] = short(zf);
+        q[i * 4 + ((qc + 0) & 3)] = short(wf);
+    }
+}
+
+void VROMeshoptDecoder::applyExponentialFilter(void *data, size_t count, size_t stride) {
+    unsigned int *values = (unsigned int *) data;
+    size_t valueCount = count * (stride / 4);
+
+    for (size_t i = 0; i < valueCount; i++) {
+        // Each value is a 24 bit signed mantissa with an 8 bit signed exponent
+        unsigned int v = values[i];
+        int m = int(v << 8) >> 8;
+        int e = int(v) >> 24;
+
+        union { float f; unsigned int ui; } u;
+        u.ui = unsigned(e + 127) << 23;
+        u.f = u.f * float(m);
+        values[i] = u.ui;
+    }
+}
@@ -0,0 +1,84 @@
+//
+//  VROMeshoptDecoder.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROMeshoptDecoder_h
+#define VROMeshoptDecoder_h
+
+#include <stddef.h>
+
+/*
+ The compression modes of EXT_meshopt_compression. Attributes is used for vertex
+ data, Triangles for triangle list indices, and Indices for all other index data.
+ */
+enum class VROMeshoptMode {
+    Attributes,
+    Triangles,
+    Indices
+};
+
+/*
+ Filters applied to vertex data after it is decoded, which convert quantized
+ normals, rotations, and exponent-encoded floats back into their bufferView format.
+ */
+enum class VROMeshoptFilter {
+    None,
+    Octahedral,
+    Quaternion,
+    Exponential
+};
+
+/*
+ Decodes bufferViews compressed with the EXT_meshopt_compression glTF extension.
+ Decoding writes directly into the destination buffer and allocates nothing, so it
+ is safe to run on any thread.
+ */
+class VROMeshoptDecoder {
+public:
+
+    /*
+     Decode count elements of the given stride (in bytes) from the compressed source
+     into destination, which must hold count * stride bytes. Returns false if the
+     compressed data is malformed.
+     */
+    static bool decode(VROMeshoptMode mode, VROMeshoptFilter filter,
+                       void *destination, size_t count, size_t stride,
+                       const unsigned char *source, size_t sourceLength);
+
+private:
+
+    static bool decodeVertexBuffer(unsigned char *destination, size_t vertexCount, size_t vertexSize,
+                                   const unsigned char *source, size_t sourceLength);
+    static bool decodeIndexBuffer(void *destination, size_t indexCount, size_t indexSize,
+                                  const unsigned char *source, size_t sourceLength);
+    static bool decodeIndexSequence(void *destination, size_t indexCount, size_t indexSize,
+                                    const unsigned char *source, size_t sourceLength);
+
+    static void applyOctahedralFilter(void *data, size_t count, size_t stride);
+    static void applyQuaternionFilter(void *data, size_t count);
+    static void applyExponentialFilter(void *data, size_t count, size_t stride);
+
+};
+
+#endif /* VROMeshoptDecoder_h */
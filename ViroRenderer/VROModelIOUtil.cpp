@@ -34,9 +34,33 @@
 #include "VRONode.h"
 #include "VROGeometry.h"
 #include "VROMaterial.h"
+#include "VROAssetCache.h"
+#include "VROTextureCompressor.h"
 
 const std::string kAssetURLPrefix = "file:///android_asset";
 
+/*
+ HTTP assets are downloaded through a persistent cache shared by all loaders.
+ WebAssembly downloads go through the browser's Cache API instead (see
+ VROPlatformDownloadURLToFileAsync).
+ */
+#if !VRO_PLATFORM_WASM
+static std::shared_ptr<VROAssetCache> getAssetCache() {
+    static std::shared_ptr<VROAssetCache> sAssetCache = std::make_shared<VROAssetCache>(VROPlatformGetCacheDirectory() + "/viro_assets");
+    return sAssetCache;
+}
+
+static bool isCacheableURL(const std::string &url) {
+    return VROStringUtil::startsWith(url, "http://") || VROStringUtil::startsWith(url, "https://");
+}
+#endif
+
+// Callbacks waiting on textures that are being loaded, keyed by texture cache
+// and texture name, so that concurrent requests for the same texture share a
+// single load. Only accessed on the rendering thread.
+typedef std::pair<const void *, std::string> VROTextureLoadKey;
+static std::map<VROTextureLoadKey, std::vector<std::function<void(std::shared_ptr<VROTexture>)>>> sPendingTextureLoads;
+
 void VROModelIOUtil::loadTextureAsync(const std::string &name, const std::string &base, VROResourceType type, bool sRGB,
                                       std::shared_ptr<std::map<std::string, std::string>> resourceMap,
                                       std::shared_ptr<std::map<std::string, std::shared_ptr<VROTexture>>> textureCache,
@@ -49,6 +73,32 @@ void VROModelIOUtil::loadTextureAsync(const std::string &name, const std::string
         return;
     }
 
+    // If the texture is already being loaded, wait on that load
+    VROTextureLoadKey key = std::make_pair(textureCache.get(), name);
+    auto pending = sPendingTextureLoads.find(key);
+    if (pending != sPendingTextureLoads.end()) {
+        pending->second.push_back(onFinished);
+        return;
+    }
+    sPendingTextureLoads[key].push_back(onFinished);
+
+    // Invoked on the rendering thread when the load completes or fails
+    std::function<void(std::shared_ptr<VROTexture>)> onLoaded = [key, textureCache](std::shared_ptr<VROTexture> texture) {
+        if (texture != nullptr) {
+            textureCache->insert(std::make_pair(key.second, texture));
+        }
+        auto it = sPendingTextureLoads.find(key);
+        if (it == sPendingTextureLoads.end()) {
+            return;
+        }
+        std::vector<std::function<void(std::shared_ptr<VROTexture>)>> callbacks = std::move(it->second);
+        sPendingTextureLoads.erase(it);
+        
+        for (auto &callback : callbacks) {
+            callback(texture);
+        }
+    };
+
     std::string textureFile;
     if (resourceMap == nullptr) {
         textureFile = base + "/" + name;
@@ -57,27 +107,27 @@ void VROModelIOUtil::loadTextureAsync(const std::string &name, const std::string
     }
 
     retrieveResourceAsync(textureFile, type,
-          [name, sRGB, onFinished, textureCache](std::string path, bool isTemp) {
+          [name, sRGB, onLoaded, textureFile, type](std::string path, bool isTemp) {
               // Abort (return empty texture) if the file wasn't found
               if (path.length() == 0) {
-                  onFinished(nullptr);
+                  onLoaded(nullptr);
                   return;
               }
               
-              VROPlatformDispatchAsyncBackground([name, path, sRGB, isTemp, textureCache, onFinished]() {
+              VROPlatformDispatchAsyncBackground([name, path, sRGB, isTemp, onLoaded, textureFile, type]() {
                   std::shared_ptr<VROTexture> texture = loadLocalTexture(name, path, sRGB, isTemp);
+                  if (texture) {
+                      texture->setSourceResource(textureFile, type);
+                  }
 
-                  VROPlatformDispatchAsyncRenderer([name, texture, textureCache, onFinished]() {
-                      if (texture != nullptr) {
-                          textureCache->insert(std::make_pair(name, texture));
-                      }
-                      onFinished(texture);
+                  VROPlatformDispatchAsyncRenderer([texture, onLoaded]() {
+                      onLoaded(texture);
                   });
               });
               
           },
-          [onFinished]() {
-              onFinished(nullptr);
+          [onLoaded]() {
+              onLoaded(nullptr);
           }
     );
 }
@@ -102,7 +152,50 @@ std::shared_ptr<VROTexture> VROModelIOUtil::loadLocalTexture(std::string name, s
                                                dataVec, texWidth, texHeight, mipSizes);
         return texture;
     }
+    else if (VROStringUtil::endsWith(name, "ktx2")) {
+        int dataLength;
+        void *data = VROPlatformLoadFile(path, &dataLength);
+        if (!data) {
+            return nullptr;
+        }
+        
+        VROTextureFormat format;
+        int texWidth;
+        int texHeight;
+        std::vector<uint32_t> mipSizes;
+        std::shared_ptr<VROData> texData = VROTextureUtil::readKTX2Header((uint8_t *) data, (uint32_t) dataLength,
+                                                                          &format, &texWidth, &texHeight, &mipSizes);
+        free(data);
+        if (!texData) {
+            pinfo("Failed to load KTX2 texture [%s] at path [%s]", name.c_str(), path.c_str());
+            return nullptr;
+        }
+        
+        std::vector<std::shared_ptr<VROData>> dataVec = { texData };
+        texture = std::make_shared<VROTexture>(VROTextureType::Texture2D, format,
+                                               VROTextureInternalFormat::RGBA8, sRGB,
+                                               mipSizes.size() > 1 ? VROMipmapMode::Pregenerated : VROMipmapMode::None,
+                                               dataVec, texWidth, texHeight, mipSizes);
+        return texture;
+    }
     else {
+#if !VRO_PLATFORM_WASM
+        /*
+         Images downloaded through the asset cache are compressed for the GPU, if enabled,
+         and the compressed texture is stored with them so later loads skip decoding.
+         */
+        bool compressed = false;
+        std::string compressedPath;
+        if (VROTextureCompressor::isEnabled()) {
+            compressedPath = getAssetCache()->getDerivedPath(path, ".etc2.ktx", &compressed);
+        }
+        if (compressed) {
+            texture = loadCompressedTexture(compressedPath, sRGB);
+            if (texture) {
+                return texture;
+            }
+        }
+#endif
         std::shared_ptr<VROImage> image = VROPlatformLoadImageFromFile(path, VROTextureInternalFormat::RGBA8);
         if (isTemp) {
             VROPlatformDeleteFile(path);
@@ -112,13 +205,35 @@ std::shared_ptr<VROTexture> VROModelIOUtil::loadLocalTexture(std::string name, s
             pinfo("Failed to load texture [%s] at path [%s]", name.c_str(), path.c_str());
             return nullptr;
         }
-        else {
-            texture = std::make_shared<VROTexture>(sRGB, VROMipmapMode::Runtime, image);
-            return texture;
+#if !VRO_PLATFORM_WASM
+        VROCompressedTexture compressedTexture;
+        if (!compressedPath.empty() && VROTextureCompressor::compress(image, &compressedTexture)) {
+            std::shared_ptr<VROData> ktx = VROTextureUtil::writeKTX(compressedTexture.data, compressedTexture.width,
+                                                                    compressedTexture.height, compressedTexture.mipSizes);
+            getAssetCache()->storeDerived(compressedPath, ktx->getData(), ktx->getDataLength());
+            return VROTextureCompressor::createTexture(compressedTexture, sRGB);
         }
+#endif
+        texture = std::make_shared<VROTexture>(sRGB, VROMipmapMode::Runtime, image);
+        return texture;
     }
 }
 
+std::shared_ptr<VROTexture> VROModelIOUtil::loadCompressedTexture(std::string path, bool sRGB) {
+    int dataLength;
+    void *data = VROPlatformLoadFile(path, &dataLength);
+    if (!data) {
+        return nullptr;
+    }
+    
+    VROCompressedTexture texture;
+    VROTextureFormat format;
+    texture.data = VROTextureUtil::readKTXHeader((uint8_t *) data, (uint32_t) dataLength,
+                                                 &format, &texture.width, &texture.height, &texture.mipSizes);
+    free(data);
+    return VROTextureCompressor::createTexture(texture, sRGB);
+}
+
 void VROModelIOUtil::retrieveResourceAsync(std::string resource, VROResourceType type,
                                            std::function<void(std::string, bool)> onSuccess,
                                            std::function<void()> onFailure) {
@@ -136,6 +251,15 @@ void VROModelIOUtil::retrieveResourceAsync(std::string resource, VROResourceType
         if (!VROStringUtil::startsWith(resource, kAssetURLPrefix)) {
             resource = VROStringUtil::encodeURL(resource);
         }
+#if !VRO_PLATFORM_WASM
+        // Cached files are owned by the cache, so they are never temporary
+        if (isCacheableURL(resource)) {
+            getAssetCache()->fetchAsync(resource, [onSuccess](std::string path) {
+                onSuccess(path, false);
+            }, onFailure);
+            return;
+        }
+#endif
         VROPlatformDownloadURLToFileAsync(resource, onSuccess, onFailure);
     }
     else {
@@ -160,6 +284,11 @@ std::string VROModelIOUtil::retrieveResource(std::string resource, VROResourceTy
         if (!VROStringUtil::startsWith(resource, kAssetURLPrefix)) {
             resource = VROStringUtil::encodeURL(resource);
         }
+#if !VRO_PLATFORM_WASM
+        if (isCacheableURL(resource)) {
+            return getAssetCache()->fetch(resource, success);
+        }
+#endif
         path = VROPlatformDownloadURLToFile(resource, isTemp, success);
     }
     else {
@@ -190,6 +319,57 @@ std::shared_ptr<std::map<std::string, std::string>> VROModelIOUtil::createResour
     }
 };
 
+// Materials installed by deduplicateMaterials, keyed by their property hash. Expired
+// entries are pruned as they are encountered. Only accessed on the rendering thread.
+static std::map<size_t, std::vector<std::weak_ptr<VROMaterial>>> sSharedMaterials;
+
+void VROModelIOUtil::deduplicateMaterials(std::shared_ptr<VROGeometry> geometry) {
+    std::vector<std::shared_ptr<VROMaterial>> materials = geometry->getMaterials();
+    bool replaced = false;
+    
+    for (std::shared_ptr<VROMaterial> &material : materials) {
+        if (material->getOutgoing()) {
+            continue;
+        }
+        
+        std::vector<std::weak_ptr<VROMaterial>> &candidates = sSharedMaterials[material->hashProperties()];
+        std::shared_ptr<VROMaterial> shared;
+        for (auto it = candidates.begin(); it != candidates.end();) {
+            std::shared_ptr<VROMaterial> candidate = it->lock();
+            if (!candidate) {
+                it = candidates.erase(it);
+                continue;
+            }
+            if (candidate->isIdenticalTo(*material)) {
+                shared = candidate;
+                break;
+            }
+            ++it;
+        }
+        
+        if (!shared) {
+            candidates.push_back(material);
+        }
+        else if (shared != material) {
+            material = shared;
+            replaced = true;
+        }
+    }
+    if (replaced) {
+        geometry->setMaterials(materials);
+    }
+}
+
+void VROModelIOUtil::deduplicateMaterials(std::shared_ptr<VRONode> node) {
+    std::shared_ptr<VROGeometry> geometry = node->getGeometry();
+    if (geometry) {
+        deduplicateMaterials(geometry);
+    }
+    for (std::shared_ptr<VRONode> &child : node->getChildNodes()) {
+        deduplicateMaterials(child);
+    }
+}
+
 void VROModelIOUtil::hydrateNodes(std::shared_ptr<VRONode> node, std::shared_ptr<VRODriver> &driver) {
     std::shared_ptr<VROGeometry> geometry = node->getGeometry();
     if (geometry) {
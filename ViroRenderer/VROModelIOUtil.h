@@ -33,6 +33,7 @@
 
 class VROTexture;
 class VRONode;
+class VROGeometry;
 class VRODriver;
 
 /*
@@ -69,7 +70,8 @@ public:
     /*
      Retrieve the given resource, returning the path to it on the local filesystem.
      The isTemp flag is set to true if the flag is temporary and should be deleted
-     after use. The success flag is set to false on failure.
+     after use. The success flag is set to false on failure. HTTP resources are
+     retrieved through a persistent VROAssetCache, and are never temporary.
      */
     static std::string retrieveResource(std::string resource, VROResourceType type,
                                         bool *isTemp, bool *success);
@@ -102,6 +104,17 @@ public:
      */
     static void hydrateAsync(std::shared_ptr<VRONode> node, std::function<void()> callback,
                              std::shared_ptr<VRODriver> &driver);
+
+    /*
+     Replace every material in the geometries descending from the given node with a
+     single shared instance per set of identical materials (see VROMaterial::isIdenticalTo).
+     Materials are shared within the model and with the materials of previously loaded
+     models that are still alive, so that identical materials sort together and their
+     draws can be instanced or merged. Must be invoked on the rendering thread, once
+     the textures of the materials are assigned.
+     */
+    static void deduplicateMaterials(std::shared_ptr<VRONode> node);
+    static void deduplicateMaterials(std::shared_ptr<VROGeometry> geometry);
     
 private:
     
@@ -117,6 +130,11 @@ private:
     static std::shared_ptr<VROTexture> loadLocalTexture(std::string name, std::string path,
                                                         bool sRGB, bool isTemp);
     
+    /*
+     Load a texture compressed by VROTextureCompressor from the KTX file at the given path.
+     */
+    static std::shared_ptr<VROTexture> loadCompressedTexture(std::string path, bool sRGB);
+    
 };
 
 #endif /* VROModelIOUtil_h */
@@ -33,8 +33,27 @@
 #include "VROMaterial.h"
 #include "VROUniform.h"
 #include "VROAnimationFloat.h"
+#include "VROJobSystem.h"
+#include <algorithm>
+#include <cstring>
 
 const int kMaxSupportedAttirbutes = 7;
+
+// Vertices whose morph target components are all within this distance of zero are
+// not stored in the target
+static const float kMorphDeltaEpsilon = 1e-6;
+
+// Targets that displace more than this fraction of their vertices are stored densely,
+// since indexing would then cost more than it skips
+static const float kMaxSparseMorphFraction = 0.5;
+
+// Number of vertices blended by each job when blending in parallel; smaller
+// meshes are blended on the calling thread
+static const int kMorphVerticesPerJob = 4096;
+
+// Unaligned vector type, so that packed xyzw components can be blended with
+// vector instructions (NEON or SSE) on every platform
+typedef float float4 __attribute__((__vector_size__(16), __aligned__(4)));
 static std::vector<VROGeometrySourceSemantic> VRO_MORPH_TYPES = {VROGeometrySourceSemantic::Vertex,
                                                                  VROGeometrySourceSemantic::Normal,
                                                                  VROGeometrySourceSemantic::Tangent};
@@ -86,14 +105,18 @@ void VROMorpher::addTarget(std::vector<std::shared_ptr<VROGeometrySource>> morph
 }
 
 void VROMorpher::configureMorphTargets() {
+    // The blended outputs are recreated on the next update, as the targets
+    // or their semantics may have changed
+    _outputSources.clear();
+
     std::map<std::string, std::shared_ptr<VROMorphTarget>> newTargets;
     if (_computeLocation == VROMorpher::ComputeLocation::CPU) {
         // Ensure our base model morph data is in CPU form.
-        _baseTarget = convertMorphTargetToCPU(_baseTarget);
+        _baseTarget = convertMorphTargetToCPU(_baseTarget, false);
 
         // Ensure all our morph target data is in CPU form.
         for (auto const& target : _morphTargets) {
-            newTargets[target.first] = convertMorphTargetToCPU(target.second);
+            newTargets[target.first] = convertMorphTargetToCPU(target.second, true);
         }
 
         // Since all calculations are done on the CPU, no additional
@@ -106,11 +129,11 @@ void VROMorpher::configureMorphTargets() {
 
     if (_computeLocation == VROMorpher::ComputeLocation::Hybrid) {
         // Ensure our base model morph data is in CPU form.
-        _baseTarget = convertMorphTargetToCPU(_baseTarget);
+        _baseTarget = convertMorphTargetToCPU(_baseTarget, false);
 
         // Ensure all our morph target data is in CPU form.
         for (auto const& target : _morphTargets) {
-            newTargets[target.first] = convertMorphTargetToCPU(target.second);
+            newTargets[target.first] = convertMorphTargetToCPU(target.second, true);
         }
         _morphTargets = newTargets;
         _needsUpdate = true;
@@ -144,7 +167,7 @@ void VROMorpher::configureShadersGPU() {
     for (auto target : _morphTargets) {
         target.second->isActive = false;
         int attribs = target.second->isCPU ?
-                           (int) target.second->geometryVecs.size() : (int) target.second->geometrySources.size();
+                           (int) target.second->geometryData.size() : (int) target.second->geometrySources.size();
         gpuKeyWeightPairs.push_back(std::make_pair(target.first, target.second->startWeight));
         totalAttribs += attribs;
     }
@@ -170,7 +193,7 @@ void VROMorpher::configureShadersGPU() {
     for (int i = 0; i < gpuKeyWeightPairs.size(); i ++) {
         std::shared_ptr<VROMorphTarget> &target = _morphTargets[gpuKeyWeightPairs[i].first];
 
-        int attribs = target->isCPU ? (int) target->geometryVecs.size() : (int) target->geometrySources.size();
+        int attribs = target->isCPU ? (int) target->geometryData.size() : (int) target->geometrySources.size();
         if (includedAttribs + attribs <= kMaxSupportedAttirbutes) {
             includedAttribs += attribs;
             target->isActive = true;
@@ -270,7 +293,7 @@ void VROMorpher::configureShadersHybrid() {
     bool hasNormal = false;
     bool hasTangent = false;
     for (auto &target : _morphTargets) {
-        for (auto &semanticTarget : target.second->geometryVecs) {
+        for (auto &semanticTarget : target.second->geometryData) {
             if (semanticTarget.first == VROGeometrySourceSemantic::Vertex) {
                 hasVertex = true;
             } else if (semanticTarget.first == VROGeometrySourceSemantic::Normal) {
@@ -324,7 +347,9 @@ void VROMorpher::configureShadersHybrid() {
     _shaderMod = morphMod;
 }
 
-bool VROMorpher::update(std::vector<std::shared_ptr<VROGeometrySource>> &geometrySources) {
+bool VROMorpher::update(std::vector<std::shared_ptr<VROGeometrySource>> &geometrySources,
+                        std::shared_ptr<VROJobSystem> jobs,
+                        std::vector<std::shared_ptr<VROGeometrySource>> *outUpdatedSources) {
     if (!_needsUpdate || _morphTargets.size() <= 0) {
         return false;
     }
@@ -373,135 +398,181 @@ bool VROMorpher::update(std::vector<std::shared_ptr<VROGeometrySource>> &geometr
 
     /*
      Handle the CPU / Hybrid case, where we handle weight calculations on the CPU, after which
-     the calculated targets are then loaded in to the GPU vertex shaders.
+     the calculated targets are then loaded in to the GPU vertex shaders. If the sources
+     from our last update are still installed, only their data changes.
      */
-    geometrySources.erase(
-            std::remove_if(geometrySources.begin(), geometrySources.end(),
-                           [this](const std::shared_ptr<VROGeometrySource>& src) {
-                               return _geometryElementIndex == src->getGeometryElementIndex() &&
-                                       (src->getSemantic() == VROGeometrySourceSemantic::Vertex
-                                      || src->getSemantic() == VROGeometrySourceSemantic::Tangent
-                                      || src->getSemantic() == VROGeometrySourceSemantic::Normal
-                                      || src->getSemantic() == VROGeometrySourceSemantic::Morph_0
-                                      || src->getSemantic() == VROGeometrySourceSemantic::Morph_1
-                                      || src->getSemantic() == VROGeometrySourceSemantic::Morph_2);
-                           }),
-            geometrySources.end());
+    bool updateInPlace = !_outputSources.empty();
+    for (auto &kv : _outputSources) {
+        if (std::find(geometrySources.begin(), geometrySources.end(), kv.second) == geometrySources.end()) {
+            updateInPlace = false;
+            break;
+        }
+    }
+
+    if (!updateInPlace) {
+        _outputSources.clear();
+        geometrySources.erase(
+                std::remove_if(geometrySources.begin(), geometrySources.end(),
+                               [this](const std::shared_ptr<VROGeometrySource>& src) {
+                                   return _geometryElementIndex == src->getGeometryElementIndex() &&
+                                           (src->getSemantic() == VROGeometrySourceSemantic::Vertex
+                                          || src->getSemantic() == VROGeometrySourceSemantic::Tangent
+                                          || src->getSemantic() == VROGeometrySourceSemantic::Normal
+                                          || src->getSemantic() == VROGeometrySourceSemantic::Morph_0
+                                          || src->getSemantic() == VROGeometrySourceSemantic::Morph_1
+                                          || src->getSemantic() == VROGeometrySourceSemantic::Morph_2);
+                               }),
+                geometrySources.end());
+    }
 
     if (_computeLocation == VROMorpher::ComputeLocation::CPU) {
-        processMorphTargets(true, geometrySources);
+        processMorphTargets(true, jobs);
     } else if (_computeLocation == VROMorpher::ComputeLocation::Hybrid) {
-        processMorphTargets(true, geometrySources);
-        processMorphTargets(false, geometrySources);
+        processMorphTargets(true, jobs);
+        processMorphTargets(false, jobs);
+    }
+
+    for (auto &kv : _outputSources) {
+        if (updateInPlace) {
+            outUpdatedSources->push_back(kv.second);
+        } else {
+            geometrySources.push_back(kv.second);
+        }
     }
 
     _needsUpdate = false;
-    return true;
+    return !updateInPlace;
 }
 
-void VROMorpher::processMorphTargets(bool isBaseAttribute,
-                                     std::vector<std::shared_ptr<VROGeometrySource>> &sourcesOut) {
-    std::vector<VROVector4f> &originalMorPosVec = _baseTarget->geometryVecs[VROGeometrySourceSemantic::Vertex];
-    std::vector<VROVector4f> &originalMorNormVec = _baseTarget->geometryVecs[VROGeometrySourceSemantic::Normal];
-    std::vector<VROVector4f> &originalMorTangentVec = _baseTarget->geometryVecs[VROGeometrySourceSemantic::Tangent];
-
-    // Create the output float data array to be stored in VROGeometry Source.
-    float *sourcesPos = originalMorPosVec.size() > 0 ? new float[originalMorPosVec.size() * 3] : nullptr;
-    float *sourcesNorm = originalMorNormVec.size() > 0 ? new float[originalMorNormVec.size() * 3] : nullptr;
-    float *sourcesTangent = originalMorTangentVec.size() > 0 ? new float[originalMorTangentVec.size() * 4] : nullptr;
-    resetSrc3(sourcesPos, (int) originalMorPosVec.size());
-    resetSrc3(sourcesNorm, (int) originalMorNormVec.size());
-    resetSrc4(sourcesTangent, (int) originalMorTangentVec.size());
-
-    // Create net morph target sources starting with this geometry's original base data.
-    addWeightedMorphToSrc3(sourcesPos, originalMorPosVec, 1.0);
-    addWeightedMorphToSrc3(sourcesNorm, originalMorNormVec, 1.0);
-    addWeightedMorphToSrc4(sourcesTangent, originalMorTangentVec, 1.0);
-
-    // Go through each morph target, add them all up with it's given weight.
-    bool hasPos = false;
-    bool hasNorm = false;
-    bool hasTang = false;
-    for (auto &target : _morphTargets) {
-        float weight = isBaseAttribute ? target.second->startWeight : target.second->endWeight;
-        if (_computeLocation == ComputeLocation::CPU && weight == 0.0) {
+void VROMorpher::processMorphTargets(bool isBaseAttribute, std::shared_ptr<VROJobSystem> &jobs) {
+    for (VROGeometrySourceSemantic semantic : VRO_MORPH_TYPES) {
+        auto base = _baseTarget->geometryData.find(semantic);
+        if (base == _baseTarget->geometryData.end()) {
             continue;
         }
 
-        std::vector<VROVector4f> &targetMorPosVec = target.second->geometryVecs[VROGeometrySourceSemantic::Vertex];
-        std::vector<VROVector4f> &targetMorNormVec = target.second->geometryVecs[VROGeometrySourceSemantic::Normal];
-        std::vector<VROVector4f> &targetMorTangentVec = target.second->geometryVecs[VROGeometrySourceSemantic::Tangent];
-
-        if (targetMorPosVec.size() > 0) {
-            addWeightedMorphToSrc3(sourcesPos, targetMorPosVec, weight);
-            hasPos = true;
+        // Hybrid end weights are only bound for the semantics that have targets
+        if (!isBaseAttribute) {
+            bool hasTarget = false;
+            for (auto &target : _morphTargets) {
+                if (target.second->geometryData.find(semantic) != target.second->geometryData.end()) {
+                    hasTarget = true;
+                    break;
+                }
+            }
+            if (!hasTarget) {
+                continue;
+            }
         }
 
-        if (targetMorNormVec.size() > 0) {
-            addWeightedMorphToSrc3(sourcesNorm, targetMorNormVec, weight);
-            hasNorm = true;
+        VROGeometrySourceSemantic outSemantic = semantic;
+        if (!isBaseAttribute) {
+            if (semantic == VROGeometrySourceSemantic::Vertex) {
+                outSemantic = VROGeometrySourceSemantic::Morph_0;
+            } else if (semantic == VROGeometrySourceSemantic::Normal) {
+                outSemantic = VROGeometrySourceSemantic::Morph_1;
+            } else {
+                outSemantic = VROGeometrySourceSemantic::Morph_2;
+            }
         }
 
-        if (targetMorTangentVec.size() > 0) {
-            addWeightedMorphToSrc4(sourcesTangent, targetMorTangentVec, weight);
-            hasTang = true;
+        int vertexCount = base->second.vertexCount;
+        int componentsPerVertex = (semantic == VROGeometrySourceSemantic::Tangent) ? 4 : 3;
+        int dataLength = vertexCount * componentsPerVertex * sizeof(float);
+
+        std::shared_ptr<VROGeometrySource> &source = _outputSources[outSemantic];
+        if (!source || source->getData()->getDataLength() != dataLength) {
+            std::shared_ptr<VROData> data = std::make_shared<VROData>(malloc(dataLength), dataLength,
+                                                                      VRODataOwnership::Move);
+            source = std::make_shared<VROGeometrySource>(data, outSemantic, vertexCount,
+                                                         true, componentsPerVertex,
+                                                         sizeof(float),
+                                                         0,
+                                                         sizeof(float) * componentsPerVertex);
+            source->setGeometryElementIndex(_geometryElementIndex);
         }
 
+        blendSemantic(semantic, isBaseAttribute, jobs);
+
+        // Pack the blended xyzw components into the source
+        float *out = (float *) source->getData()->getData();
+        if (componentsPerVertex == 4) {
+            memcpy(out, _blendBuffer.data(), dataLength);
+        } else {
+            const float *blend = _blendBuffer.data();
+            for (int i = 0; i < vertexCount; i++) {
+                out[i * 3]     = blend[i * 4];
+                out[i * 3 + 1] = blend[i * 4 + 1];
+                out[i * 3 + 2] = blend[i * 4 + 2];
+            }
+        }
     }
+}
 
-    // Finally set the draw data sources in a VROGeometrySource and add it to sourcesOut.
-    if  ((isBaseAttribute && originalMorPosVec.size() > 0) || (!isBaseAttribute && hasPos))  {
-        VROGeometrySourceSemantic semantic = isBaseAttribute ? VROGeometrySourceSemantic::Vertex : VROGeometrySourceSemantic::Morph_0;
-        std::shared_ptr<VROData> posData = std::make_shared<VROData>((void *) sourcesPos, originalMorPosVec.size() * 3 * sizeof(float));
-        std::shared_ptr<VROGeometrySource> posOut = std::make_shared<VROGeometrySource>(posData,
-                                                                                        semantic,
-                                                                                        originalMorPosVec.size(),
-                                                                                        true, 3,
-                                                                                        sizeof(float),
-                                                                                        0,
-                                                                                        sizeof(float) * 3);
-        posOut->setGeometryElementIndex(_geometryElementIndex);
-        sourcesOut.push_back(posOut);
-    }
+void VROMorpher::blendSemantic(VROGeometrySourceSemantic semantic, bool isBaseAttribute,
+                               std::shared_ptr<VROJobSystem> &jobs) {
+    const VROMorphTargetData &base = _baseTarget->geometryData[semantic];
+    int vertexCount = base.vertexCount;
 
-    if  ((isBaseAttribute && originalMorNormVec.size() > 0) || (!isBaseAttribute && hasNorm))  {
-        VROGeometrySourceSemantic semantic = isBaseAttribute ? VROGeometrySourceSemantic::Normal : VROGeometrySourceSemantic::Morph_1;
-        std::shared_ptr<VROData> normData = std::make_shared<VROData>((void *) sourcesNorm, originalMorNormVec.size() * 3 * sizeof(float));
-        std::shared_ptr<VROGeometrySource> normOut = std::make_shared<VROGeometrySource>(normData,
-                                                                                         semantic,
-                                                                                         originalMorNormVec.size(),
-                                                                                         true, 3,
-                                                                                         sizeof(float),
-                                                                                         0,
-                                                                                         sizeof(float) * 3);
-        normOut->setGeometryElementIndex(_geometryElementIndex);
-        sourcesOut.push_back(normOut);
-    }
+    // Gather the targets that contribute to this semantic. Targets with zero
+    // weight have no effect, so animating a few blendshapes out of a large
+    // set only costs the blendshapes that are animating.
+    std::vector<std::pair<const VROMorphTargetData *, float>> targets;
+    for (auto &target : _morphTargets) {
+        float weight = isBaseAttribute ? target.second->startWeight : target.second->endWeight;
+        if (weight == 0.0) {
+            continue;
+        }
 
-    if  ((isBaseAttribute && originalMorTangentVec.size() > 0) || (!isBaseAttribute && hasTang)) {
-        VROGeometrySourceSemantic semantic = isBaseAttribute ? VROGeometrySourceSemantic::Tangent : VROGeometrySourceSemantic::Morph_2;
-        std::shared_ptr<VROData> tangentData = std::make_shared<VROData>((void *) sourcesTangent, originalMorTangentVec.size() * 4 * sizeof(float));
-        std::shared_ptr<VROGeometrySource> tangentOut = std::make_shared<VROGeometrySource>(tangentData,
-                                                                                            semantic,
-                                                                                            originalMorTangentVec.size(),
-                                                                                            true, 4,
-                                                                                            sizeof(float),
-                                                                                            0,
-                                                                                            sizeof(float) * 4);
-        tangentOut->setGeometryElementIndex(_geometryElementIndex);
-        sourcesOut.push_back(tangentOut);
+        auto data = target.second->geometryData.find(semantic);
+        if (data == target.second->geometryData.end()) {
+            continue;
+        }
+        if (data->second.vertexCount != vertexCount) {
+            pwarn("Morph target %s does not match the vertex count of its base geometry", target.first.c_str());
+            continue;
+        }
+        targets.push_back({ &data->second, weight });
     }
 
-    if (sourcesPos != nullptr) {
-        delete[] sourcesPos;
-    }
+    _blendBuffer.resize(vertexCount * 4);
+    float *blend = _blendBuffer.data();
 
-    if (sourcesNorm != nullptr) {
-        delete[] sourcesNorm;
-    }
+    // Blend one range of vertices: start with the base, then add each weighted
+    // target. Sparse targets only visit the vertices they displace.
+    std::function<void(int)> blendRange = [blend, &base, &targets, vertexCount] (int range) {
+        int begin = range * kMorphVerticesPerJob;
+        int end = std::min(begin + kMorphVerticesPerJob, vertexCount);
+        memcpy(blend + begin * 4, base.components.data() + begin * 4, (end - begin) * 4 * sizeof(float));
 
-    if (sourcesTangent != nullptr) {
-        delete[] sourcesTangent;
+        for (const std::pair<const VROMorphTargetData *, float> &target : targets) {
+            const VROMorphTargetData &data = *target.first;
+            float weight = target.second;
+            const float *components = data.components.data();
+
+            if (!data.sparse) {
+                for (int i = begin; i < end; i++) {
+                    *((float4 *) (blend + i * 4)) += *((const float4 *) (components + i * 4)) * weight;
+                }
+            } else {
+                auto first = std::lower_bound(data.indices.begin(), data.indices.end(), begin);
+                auto last = std::lower_bound(first, data.indices.end(), end);
+
+                for (auto it = first; it != last; ++it) {
+                    size_t k = it - data.indices.begin();
+                    *((float4 *) (blend + (*it) * 4)) += *((const float4 *) (components + k * 4)) * weight;
+                }
+            }
+        }
+    };
+
+    int numRanges = (vertexCount + kMorphVerticesPerJob - 1) / kMorphVerticesPerJob;
+    if (jobs && numRanges > 1) {
+        jobs->parallelFor(0, numRanges, 1, blendRange);
+    } else {
+        for (int i = 0; i < numRanges; i++) {
+            blendRange(i);
+        }
     }
 }
 
@@ -604,7 +675,8 @@ bool VROMorpher::setComputeLocation(VROMorpher::ComputeLocation mode) {
     return true;
 }
 
-std::shared_ptr<VROMorphTarget> VROMorpher::convertMorphTargetToCPU(std::shared_ptr<VROMorphTarget> targetIn) {
+std::shared_ptr<VROMorphTarget> VROMorpher::convertMorphTargetToCPU(std::shared_ptr<VROMorphTarget> targetIn,
+                                                                    bool sparse) {
     // Return if target is already of type CPU
     if (targetIn->isCPU) {
         return targetIn;
@@ -625,18 +697,45 @@ std::shared_ptr<VROMorphTarget> VROMorpher::convertMorphTargetToCPU(std::shared_
             continue;
         }
 
-        // Else, convert the VROGeometrySource into a vertex array
-        std::vector<VROVector4f> dataVec;
-        targetIn->geometrySources[type]->processVertices([&dataVec](int i, VROVector4f vertex) {
-            dataVec.push_back(vertex);
+        // Else, convert the VROGeometrySource into packed components, keeping only
+        // the vertices that move if the target is sparse
+        VROMorphTargetData data;
+        data.vertexCount = 0;
+        data.sparse = sparse;
+        targetIn->geometrySources[type]->processVertices([&data](int i, VROVector4f vertex) {
+            data.vertexCount++;
+            if (data.sparse &&
+                fabs(vertex.x) <= kMorphDeltaEpsilon && fabs(vertex.y) <= kMorphDeltaEpsilon &&
+                fabs(vertex.z) <= kMorphDeltaEpsilon && fabs(vertex.w) <= kMorphDeltaEpsilon) {
+                return;
+            }
+            if (data.sparse) {
+                data.indices.push_back(i);
+            }
+            data.components.insert(data.components.end(), { vertex.x, vertex.y, vertex.z, vertex.w });
         });
 
-        if (dataVec.size() > 0) {
-            targetOut->geometryVecs[type] = dataVec;
+        if (data.vertexCount <= 0) {
+            continue;
         }
+
+        // Targets that move most of the mesh are faster to blend densely
+        if (data.sparse && data.indices.size() > data.vertexCount * kMaxSparseMorphFraction) {
+            std::vector<float> dense(data.vertexCount * 4, 0);
+            for (size_t k = 0; k < data.indices.size(); k++) {
+                memcpy(&dense[data.indices[k] * 4], &data.components[k * 4], 4 * sizeof(float));
+            }
+            data.components = std::move(dense);
+            data.indices.clear();
+            data.sparse = false;
+        }
+        targetOut->geometryData[type] = std::move(data);
     }
 
     targetOut->geometrySources.clear();
+    targetOut->startWeight = targetIn->startWeight;
+    targetOut->endWeight = targetIn->endWeight;
+    targetOut->isActive = targetIn->isActive;
     targetOut->isCPU = true;
     return targetOut;
 }
@@ -647,7 +746,7 @@ std::shared_ptr<VROMorphTarget> VROMorpher::convertMorphTargetToGPU(std::shared_
         return targetIn;
     }
 
-    if (targetIn->geometryVecs.size() <=0) {
+    if (targetIn->geometryData.size() <=0) {
         return nullptr;
     }
 
@@ -655,17 +754,16 @@ std::shared_ptr<VROMorphTarget> VROMorpher::convertMorphTargetToGPU(std::shared_
     std::shared_ptr<VROMorphTarget> targetOut = std::make_shared<VROMorphTarget>();
     for (VROGeometrySourceSemantic type: VRO_MORPH_TYPES) {
         // Skip if there's no source for this type.
-        if (targetIn->geometryVecs.find(type) == targetIn->geometryVecs.end()) {
-
+        if (targetIn->geometryData.find(type) == targetIn->geometryData.end()) {
             continue;
         }
 
-        if (targetIn->geometryVecs[type].size() <=0) {
+        if (targetIn->geometryData[type].vertexCount <=0) {
             continue;
         }
 
-        std::shared_ptr<VROGeometrySource> source = convertVecToGeoSource(
-                targetIn->geometryVecs[type],
+        std::shared_ptr<VROGeometrySource> source = convertDataToGeoSource(
+                targetIn->geometryData[type],
                 type);
 
         if (source != nullptr) {
@@ -673,14 +771,17 @@ std::shared_ptr<VROMorphTarget> VROMorpher::convertMorphTargetToGPU(std::shared_
         }
     }
 
-    targetIn->geometryVecs.clear();
+    targetIn->geometryData.clear();
+    targetOut->startWeight = targetIn->startWeight;
+    targetOut->endWeight = targetIn->endWeight;
+    targetOut->isActive = targetIn->isActive;
     targetOut->isCPU = false;
     return targetOut;
 }
 
-std::shared_ptr<VROGeometrySource> VROMorpher::convertVecToGeoSource(
-        std::vector<VROVector4f> &dataVecIn, VROGeometrySourceSemantic semantic) {
-    if (dataVecIn.size() <=0) {
+std::shared_ptr<VROGeometrySource> VROMorpher::convertDataToGeoSource(
+        const VROMorphTargetData &dataIn, VROGeometrySourceSemantic semantic) {
+    if (dataIn.vertexCount <=0) {
         perr("Attempted to convert to GeometrySource with invalid data.");
         return nullptr;
     }
@@ -697,20 +798,18 @@ std::shared_ptr<VROGeometrySource> VROMorpher::convertVecToGeoSource(
         return nullptr;
     }
 
-    float *sourcesData = (dataVecIn.size() > 0) ? new float[dataVecIn.size() * componentsPerVertex] : nullptr;
-    int morphSize = (int) dataVecIn.size();
-    for (int i = 0; i < morphSize; i ++) {
-        sourcesData[ i * componentsPerVertex]           = dataVecIn[i].x;
-        sourcesData[(i * componentsPerVertex) + 1]      = dataVecIn[i].y;
-        sourcesData[(i * componentsPerVertex) + 2]      = dataVecIn[i].z;
-        if (componentsPerVertex > 3){
-            sourcesData[(i * componentsPerVertex) + 3]  = dataVecIn[i].w;
-        }
+    // GPU targets are dense: vertices missing from sparse data are not displaced
+    int dataLength = dataIn.vertexCount * componentsPerVertex * sizeof(float);
+    float *sourcesData = (float *) calloc(dataIn.vertexCount * componentsPerVertex, sizeof(float));
+    int storedCount = (int) (dataIn.components.size() / 4);
+    for (int k = 0; k < storedCount; k++) {
+        int i = dataIn.sparse ? dataIn.indices[k] : k;
+        memcpy(&sourcesData[i * componentsPerVertex], &dataIn.components[k * 4], componentsPerVertex * sizeof(float));
     }
-    std::shared_ptr<VROData> data = std::make_shared<VROData>((void *) sourcesData, dataVecIn.size() * componentsPerVertex * sizeof(float));
+    std::shared_ptr<VROData> data = std::make_shared<VROData>((void *) sourcesData, dataLength, VRODataOwnership::Move);
     std::shared_ptr<VROGeometrySource> geoSource = std::make_shared<VROGeometrySource>(data,
                                                                                        semantic,
-                                                                                       dataVecIn.size(),
+                                                                                       dataIn.vertexCount,
                                                                                        true, componentsPerVertex,
                                                                                        sizeof(float),
                                                                                        0,
@@ -768,45 +867,3 @@ void VROMorpher::addMorphModifier(int morphTargetIndex, std::string &code, bool
         code = code +  " + (uniform_" + VROStringUtil::toString(morphTargetIndex) + " * " + "morph_" + targetIndex + ")";
     }
 }
-
-
-
-inline void VROMorpher::addWeightedMorphToSrc3(float *srcDataOut,
-                                               std::vector<VROVector4f> &morphData,
-                                               float weight) {
-    int morphSize = (int) morphData.size();
-    for (int i = 0; i < morphSize; i ++) {
-        srcDataOut[i *  3]      += (morphData[i].x * (weight));
-        srcDataOut[(i * 3) + 1] += (morphData[i].y * (weight));
-        srcDataOut[(i * 3) + 2] += (morphData[i].z * (weight));
-    }
-}
-
-inline void VROMorpher::addWeightedMorphToSrc4(float *srcDataOut,
-                                               std::vector<VROVector4f> &morphData,
-                                               float weight) {
-    int morphSize = (int) morphData.size();
-    for (int i = 0; i < morphSize; i ++) {
-        srcDataOut[i *  4]       += (morphData[i].x * (weight));
-        srcDataOut[(i * 4) + 1] += (morphData[i].y * (weight));
-        srcDataOut[(i * 4) + 2] += (morphData[i].z * (weight));
-        srcDataOut[(i * 4) + 3] += (morphData[i].z * (weight));
-    }
-}
-
-inline void VROMorpher::resetSrc3(float *srcDataOut, int size) {
-    for (int i = 0; i < size; i ++) {
-        srcDataOut[i *  3]      = 0;
-        srcDataOut[(i * 3) + 1] = 0;
-        srcDataOut[(i * 3) + 2] = 0;
-    }
-}
-
-inline void VROMorpher::resetSrc4(float *srcDataOut, int size) {
-    for (int i = 0; i < size; i ++) {
-        srcDataOut[i *  4]      = 0;
-        srcDataOut[(i * 4) + 1] = 0;
-        srcDataOut[(i * 4) + 2] = 0;
-        srcDataOut[(i * 4) + 3] = 0;
-    }
-}
@@ -40,6 +40,25 @@
 class VROGeometrySource;
 class VROgeometry;
 class VROMaterial;
+class VROJobSystem;
+
+/*
+ The vertex data of one VROGeometrySourceSemantic of a VROMorphTarget, stored as
+ four packed floats (xyzw) per vertex. Morph targets are sparse: they store only
+ the vertices they displace, in ascending order of vertex index. Targets that
+ displace most of the mesh, and the base target, are dense.
+ */
+struct VROMorphTargetData {
+    // Number of vertices in the mesh this data applies to.
+    int vertexCount;
+
+    // True if only the vertices in indices are stored.
+    bool sparse;
+    std::vector<int> indices;
+
+    // Four floats for each stored vertex.
+    std::vector<float> components;
+};
 
 /*
  VROMorphTarget contains geometric source data and morph-specific properties, that when applied
@@ -62,8 +81,8 @@ struct VROMorphTarget {
     std::map<VROGeometrySourceSemantic, std::shared_ptr<VROGeometrySource>> geometrySources;
 
     // Map of each VROGeometrySourceSemantic (Norm/Pos/Tangent) to its corresponding
-    // vertex data as an array of VROVector4f objects.
-    std::map<VROGeometrySourceSemantic, std::vector<VROVector4f>> geometryVecs;
+    // vertex data, used in CPU form.
+    std::map<VROGeometrySourceSemantic, VROMorphTargetData> geometryData;
 };
 
 /*
@@ -133,10 +152,16 @@ public:
 
     /*
      Processes all VROMorphTargets associated with this VROMorpher based on the current
-     _computeLocation and updates the given vec of geometrySources with processed morph
-     target data to be prewarmed and rehydrated for a given geometry.
+     _computeLocation. Returns true if the given vec of geometrySources was changed, in
+     which case the geometry's substrate must be recreated. When only weights changed in
+     CPU or Hybrid mode, the blended data is instead written into the existing sources,
+     which are appended to outUpdatedSources so that their buffers can be re-uploaded.
+
+     Blending is split across the given job system, if any, for large meshes.
      */
-    bool update(std::vector<std::shared_ptr<VROGeometrySource>> &geometrySources);
+    bool update(std::vector<std::shared_ptr<VROGeometrySource>> &geometrySources,
+                std::shared_ptr<VROJobSystem> jobs,
+                std::vector<std::shared_ptr<VROGeometrySource>> *outUpdatedSources);
 
     /*
      Sets the weight of a VROMorphTarget in this VROMorpher, matching the given key.
@@ -184,14 +209,34 @@ private:
      */
     float _hybridAnimationDuration;
 
+    /*
+     The VROGeometrySources holding the blended result of CPU and Hybrid modes, keyed by
+     the semantic under which they are bound (the base semantics, or Morph_0, Morph_1
+     and Morph_2 for the Hybrid end weights). These persist across weight changes so
+     that their data can be updated in place.
+     */
+    std::map<VROGeometrySourceSemantic, std::shared_ptr<VROGeometrySource>> _outputSources;
+
+    /*
+     Scratch xyzw buffer into which each semantic is blended before being packed into
+     its output source.
+     */
+    std::vector<float> _blendBuffer;
+
     /*
      Performs blending calculations for all VROMorphTargets associated with this VROMorpher and
-     consolidates the results in VROGeometrySource sourcesOut. If isBaseAttribute is true,
-     base VROGeometrySource elements are created. Else VROGeometrySource::Morph elements are
-     created (for Hybrid modes).
+     writes the results into _outputSources, creating any that are missing. If isBaseAttribute
+     is true, the start weights are blended into the base semantics. Else the end weights
+     are blended into the VROGeometrySource::Morph semantics (for Hybrid modes).
+     */
+    void processMorphTargets(bool isBaseAttribute, std::shared_ptr<VROJobSystem> &jobs);
+
+    /*
+     Blends the given semantic of the base target and all targets with non-zero weight into
+     _blendBuffer, splitting the mesh into ranges of vertices across the job system.
      */
-    void processMorphTargets(bool isBaseAttribute,
-                             std::vector<std::shared_ptr<VROGeometrySource>> &sourcesOut);
+    void blendSemantic(VROGeometrySourceSemantic semantic, bool isBaseAttribute,
+                       std::shared_ptr<VROJobSystem> &jobs);
 
     /*
      Converts all VROMorphTarget data associated with this VROMorpher into the current
@@ -205,10 +250,11 @@ private:
      Coverts a given VROMorphTarget data into a CPU or GPU type, usually called when
      a new _computeLocation is set.
      */
-    std::shared_ptr<VROMorphTarget> convertMorphTargetToCPU(std::shared_ptr<VROMorphTarget> targetIn);
+    std::shared_ptr<VROMorphTarget> convertMorphTargetToCPU(std::shared_ptr<VROMorphTarget> targetIn,
+                                                            bool sparse);
     std::shared_ptr<VROMorphTarget> convertMorphTargetToGPU( std::shared_ptr<VROMorphTarget> targetIn);
-    std::shared_ptr<VROGeometrySource> convertVecToGeoSource(std::vector<VROVector4f> &dataVecIn,
-                                                             VROGeometrySourceSemantic semantic);
+    std::shared_ptr<VROGeometrySource> convertDataToGeoSource(const VROMorphTargetData &dataIn,
+                                                              VROGeometrySourceSemantic semantic);
 
     /*
      Shader semantics mapping OpenGL's Attribute indexes to VROMorph indexes.
@@ -221,21 +267,6 @@ private:
      shaders for GPU Morph Targets.
      */
     static void addMorphModifier(int morphTargetIndex, std::string &shaderCode, bool isVec4);
-
-    /*
-     Helper functions for adding weighted morph target data to an existing float srcDataOut array
-     representing the base geometric source. NOTE: These functions are heavily, heavily used
-     and are considered performance sensitive functions!
-     */
-    inline void addWeightedMorphToSrc3(float *srcDataOut, std::vector<VROVector4f> &morphData, float weight);
-    inline void addWeightedMorphToSrc4(float *srcDataOut, std::vector<VROVector4f> &morphData, float weight);
-
-    /*
-     Helper functions for resetting an existing float srcDataOut array to 0. NOTE: These functions
-     are heavily, heavily used and are considered performance sensitive functions!
-     */
-    inline void resetSrc3(float *srcDataOut, int size);
-    inline void resetSrc4(float *srcDataOut, int size);
 };
 
 #endif /* VROMorpher_h */
@@ -27,7 +27,11 @@
 #include "VRONode.h"
 #include "VROIKRig.h"
 #include "VROGeometry.h"
+#include "VROTriangleBVH.h"
+#include "VROVector4f.h"
 #include "VROLight.h"
+#include "VROLightClusterGrid.h"
+#include "VROLightBins.h"
 #include "VROAnimation.h"
 #include "VROTransaction.h"
 #include "VROAnimationVector3f.h"
@@ -55,8 +59,21 @@
 #include "VROSkeletalAnimationLayer.h"
 #include "VROTransformDelegate.h"
 #include "VROInstancedUBO.h"
+#include "VROInstancedTransformUBO.h"
+#include "VROTexture.h"
 #include "VROPlatformUtil.h"
 #include "VROMorpher.h"
+#include "VROJobSystem.h"
+#include "VRORenderInvalidation.h"
+#include "VROTransformHierarchy.h"
+#include "VROOcclusionCuller.h"
+#include "VROProfiler.h"
+#include "VROBakedSkeletalAnimation.h"
+#include "VROTime.h"
+#include "VROFrameArena.h"
+#include <deque>
+#include <mutex>
+#include <cstring>
 
 // Opacity below which a node is considered hidden
 static const float kHiddenOpacityThreshold = 0.02;
@@ -68,6 +85,18 @@ static const bool kEnableVisibilityFrustumTest = true;
 static const bool kDebugBoundingBoxComputation = false;
 static const std::string kDebugBoundingBoxNodeName = "Stage";
 
+// When parallelizing a render cycle pass, the number of independent subtrees
+// we try to create per thread of the job system
+static const int kParallelSubtreesPerThread = 4;
+
+// Number of particle emitters updated per job
+static const int kParticleEmittersPerJob = 2;
+
+// Animation LOD defaults: the fraction of the viewport height below which
+// animations are throttled, and the longest interval between updates in frames
+static const float kDefaultAnimationLODScreenSize = 0.2;
+static const int kDefaultAnimationLODMaxUpdateInterval = 8;
+
 // Set to true to debut the sort order
 bool kDebugSortOrder = false;
 int  kDebugSortOrderFrameFrequency = 60;
@@ -85,7 +114,15 @@ VRONode::VRONode() : VROThreadRestricted(VROThreadName::Renderer),
     _uniqueID(sUniqueIDGenerator++),
     _type(VRONodeType::Normal),
     _visible(false),
+    _occlusionCandidateFrame(-1),
+    _occlusionQueryPending(false),
+    _occluded(false),
+    _occlusionResultFrame(-1),
     _lastVisitedRenderingFrame(-1),
+    _transformsDirty(true),
+    _computedLightsHash(0),
+    _computedLightsCullingVersion(0),
+    _computedLightsReceivingBitMask(0),
     _scale({1.0, 1.0, 1.0}),
     _euler({0, 0, 0}),
     _renderingOrder(0),
@@ -98,7 +135,11 @@ VRONode::VRONode() : VROThreadRestricted(VROThreadName::Renderer),
     _hierarchicalRendering(false),
     _lightReceivingBitMask(1),
     _shadowCastingBitMask(1),
+    _viewBitMask(1),
     _ignoreEventHandling(false),
+    _animationLODEnabled(false),
+    _animationLODScreenSize(kDefaultAnimationLODScreenSize),
+    _animationLODMaxUpdateInterval(kDefaultAnimationLODMaxUpdateInterval),
     _dragType(VRODragType::FixedDistance),
     _dragPlanePoint({ 0, 0, 0 }),
     _dragPlaneNormal({ 0, 0 ,0 }),
@@ -120,7 +161,15 @@ VRONode::VRONode(const VRONode &node) : VROThreadRestricted(VROThreadName::Rende
     _uniqueID(sUniqueIDGenerator++),
     _type(node._type),
     _visible(false),
+    _occlusionCandidateFrame(-1),
+    _occlusionQueryPending(false),
+    _occluded(false),
+    _occlusionResultFrame(-1),
     _lastVisitedRenderingFrame(-1),
+    _transformsDirty(true),
+    _computedLightsHash(0),
+    _computedLightsCullingVersion(0),
+    _computedLightsReceivingBitMask(0),
     _geometry(node._geometry),
     _lights(node._lights),
     _sounds(node._sounds),
@@ -137,7 +186,11 @@ VRONode::VRONode(const VRONode &node) : VROThreadRestricted(VROThreadName::Rende
     _hierarchicalRendering(node._hierarchicalRendering),
     _lightReceivingBitMask(node._lightReceivingBitMask),
     _shadowCastingBitMask(node._shadowCastingBitMask),
+    _viewBitMask(node._viewBitMask),
     _ignoreEventHandling(node._ignoreEventHandling),
+    _animationLODEnabled(node._animationLODEnabled),
+    _animationLODScreenSize(node._animationLODScreenSize),
+    _animationLODMaxUpdateInterval(node._animationLODMaxUpdateInterval),
     _dragType(node._dragType),
     _dragPlanePoint(node._dragPlanePoint),
     _dragPlaneNormal(node._dragPlaneNormal),
@@ -186,7 +239,8 @@ VRONode::VRONode(const VRONode &node) : VROThreadRestricted(VROThreadName::Rende
     _lastWorldUmbrellaBoundingBox(node._lastWorldUmbrellaBoundingBox),
     _lastUmbrellaBoundsSet(node._lastUmbrellaBoundsSet),
 #endif
-    _holdRendering(node._holdRendering) {
+    _holdRendering(node._holdRendering),
+    _bakedAnimationTimeOffset(node._bakedAnimationTimeOffset) {
         
     ALLOCATION_TRACKER_ADD(Nodes, 1);
 }
@@ -205,14 +259,87 @@ void VRONode::deleteGL() {
 }
 
 std::shared_ptr<VRONode> VRONode::clone() {
-    std::shared_ptr<VRONode> node = std::make_shared<VRONode>(*this);
-    for (std::shared_ptr<VRONode> &subnode : _subnodes) {
-        node->addChildNode(subnode->clone());
+    return cloneSubtree(nullptr);
+}
+
+/*
+ Allocates the nodes of an instantiate() call, and their shared_ptr control
+ blocks, from a linear arena. Deallocation is a no-op: the arena is retained by
+ every allocation through its control block, and frees its memory when the last
+ node allocated from it is destroyed.
+ */
+template <typename T>
+class VRONodeArenaAllocator {
+public:
+    typedef T value_type;
+    
+    VRONodeArenaAllocator(std::shared_ptr<VROFrameArena> arena) : _arena(arena) {}
+    template <typename U>
+    VRONodeArenaAllocator(const VRONodeArenaAllocator<U> &other) : _arena(other.getArena()) {}
+    
+    T *allocate(size_t n) {
+        return (T *) _arena->allocate(n * sizeof(T), alignof(T));
+    }
+    void deallocate(T *p, size_t n) {}
+    
+    const std::shared_ptr<VROFrameArena> &getArena() const {
+        return _arena;
     }
     
+    template <typename U>
+    bool operator== (const VRONodeArenaAllocator<U> &other) const {
+        return _arena == other.getArena();
+    }
+    template <typename U>
+    bool operator!= (const VRONodeArenaAllocator<U> &other) const {
+        return _arena != other.getArena();
+    }
+    
+private:
+    std::shared_ptr<VROFrameArena> _arena;
+};
+
+// Bytes reserved in the instantiation arena per node, on top of the node itself,
+// for its shared_ptr control block; the arena grows if this is exceeded
+static const size_t kInstantiatedNodeOverheadBytes = 64;
+
+std::vector<std::shared_ptr<VRONode>> VRONode::instantiate(int count) {
+    passert_thread(__func__);
+    std::vector<std::shared_ptr<VRONode>> instances;
+    if (count <= 0) {
+        return instances;
+    }
+    
+    size_t capacity = (size_t) count * getSubtreeSize() * (sizeof(VRONode) + kInstantiatedNodeOverheadBytes);
+    std::shared_ptr<VROFrameArena> arena = std::make_shared<VROFrameArena>(capacity);
+    
+    instances.reserve(count);
+    for (int i = 0; i < count; i++) {
+        instances.push_back(cloneSubtree(arena));
+    }
+    return instances;
+}
+
+std::shared_ptr<VRONode> VRONode::cloneSubtree(const std::shared_ptr<VROFrameArena> &arena) const {
+    std::shared_ptr<VRONode> node = arena ? std::allocate_shared<VRONode>(VRONodeArenaAllocator<VRONode>(arena), *this) :
+                                            std::make_shared<VRONode>(*this);
+    node->_subnodes.reserve(_subnodes.size());
+    for (const std::shared_ptr<VRONode> &subnode : _subnodes) {
+        std::shared_ptr<VRONode> child = subnode->cloneSubtree(arena);
+        child->_supernode = node;
+        node->_subnodes.push_back(child);
+    }
     return node;
 }
 
+int VRONode::getSubtreeSize() const {
+    int size = 1;
+    for (const std::shared_ptr<VRONode> &subnode : _subnodes) {
+        size += subnode->getSubtreeSize();
+    }
+    return size;
+}
+
 #pragma mark - Rendering
 
 void VRONode::render(int elementIndex,
@@ -224,17 +351,122 @@ void VRONode::render(int elementIndex,
         return;
     }
     if (_geometry && _computedOpacity > kHiddenOpacityThreshold) {
-        _geometry->render(elementIndex, material,
-                          _worldTransform, _worldInverseTransposeTransform, _computedOpacity,
-                          context, driver);
+        getRenderedGeometry()->render(elementIndex, material,
+                                      _worldTransform, _worldInverseTransposeTransform, _computedOpacity,
+                                      context, driver);
     }
 }
 
+void VRONode::renderDepth(int elementIndex,
+                          std::shared_ptr<VROMaterial> &depthMaterial,
+                          const VRORenderContext &context,
+                          std::shared_ptr<VRODriver> &driver) {
+    if (_holdRendering) {
+        return;
+    }
+    if (_geometry && _computedOpacity > kHiddenOpacityThreshold) {
+        getRenderedGeometry()->renderSilhouetteTextured(elementIndex, _worldTransform, depthMaterial, context, driver);
+    }
+}
+
+bool VRONode::isInstanceableWith(const VRONode &node) const {
+    return _geometry && _geometry == node._geometry && _lodLevel == node._lodLevel &&
+           getRenderedGeometry()->isAutomaticInstancingSupported() &&
+           !_holdRendering && !node._holdRendering &&
+           _computedOpacity > kHiddenOpacityThreshold &&
+           _computedOpacity == node._computedOpacity &&
+           _computedLightsHash == node._computedLightsHash &&
+           _computedLights == node._computedLights;
+}
+
+void VRONode::renderInstanced(const std::vector<VRONode *> &nodes,
+                              int elementIndex,
+                              std::shared_ptr<VROMaterial> &material,
+                              const VRORenderContext &context,
+                              std::shared_ptr<VRODriver> &driver) {
+    if (nodes.empty()) {
+        return;
+    }
+    
+    std::vector<VROMatrix4f> transforms;
+    std::vector<VROMatrix4f> normalMatrices;
+    transforms.reserve(nodes.size());
+    normalMatrices.reserve(nodes.size());
+    
+    VRONode *first = nodes.front();
+    const std::shared_ptr<VROSkinner> &skinner = first->getRenderedGeometry()->getSkinner();
+    VROBakedSkeletalAnimation *baked = skinner ? skinner->getBakedAnimation().get() : nullptr;
+    double time = VROTimeCurrentSeconds();
+    
+    std::shared_ptr<VROTexture> diffuse = material->getDiffuse().getTexture();
+    for (VRONode *node : nodes) {
+        transforms.push_back(node->_worldTransform);
+        normalMatrices.push_back(node->_worldInverseTransposeTransform);
+        VROInstancedTransformUBO::encodeDiffuseTexture(*diffuse, &normalMatrices.back());
+        if (baked) {
+            VROInstancedTransformUBO::encodeBakedAnimationFrame(baked->getFramePosition(time + node->_bakedAnimationTimeOffset),
+                                                                &normalMatrices.back());
+        }
+    }
+    
+    first->getRenderedGeometry()->renderInstanced(elementIndex, material, transforms, normalMatrices,
+                                                  first->_computedOpacity, context, driver);
+}
+
+bool VRONode::isMultiDrawableWith(int elementIndex, const VRONode &node, int nodeElementIndex) const {
+    return _geometry && node._geometry &&
+           !_holdRendering && !node._holdRendering &&
+           _computedOpacity > kHiddenOpacityThreshold &&
+           _computedOpacity == node._computedOpacity &&
+           _computedLightsHash == node._computedLightsHash &&
+           _computedLights == node._computedLights &&
+           getRenderedGeometry()->isMultiDrawCompatibleWith(elementIndex, *node.getRenderedGeometry(), nodeElementIndex);
+}
+
+void VRONode::renderMultiDraw(const std::vector<VRONode *> &nodes,
+                              const std::vector<int> &elementIndices,
+                              const std::vector<VROTexture *> &diffuseTextures,
+                              std::shared_ptr<VROMaterial> &material,
+                              const VRORenderContext &context,
+                              std::shared_ptr<VRODriver> &driver) {
+    if (nodes.empty()) {
+        return;
+    }
+    passert (diffuseTextures.empty() || diffuseTextures.size() == nodes.size());
+    
+    std::vector<VROGeometry *> geometries;
+    std::vector<VROMatrix4f> transforms;
+    std::vector<VROMatrix4f> normalMatrices;
+    geometries.reserve(nodes.size());
+    transforms.reserve(nodes.size());
+    normalMatrices.reserve(nodes.size());
+    for (size_t i = 0; i < nodes.size(); i++) {
+        VRONode *node = nodes[i];
+        geometries.push_back(node->getRenderedGeometry());
+        transforms.push_back(node->_worldTransform);
+        normalMatrices.push_back(node->_worldInverseTransposeTransform);
+        if (!diffuseTextures.empty()) {
+            VROInstancedTransformUBO::encodeDiffuseTexture(*diffuseTextures[i], &normalMatrices.back());
+        }
+    }
+    
+    VRONode *first = nodes.front();
+    first->getRenderedGeometry()->renderMultiDraw(geometries, elementIndices, material, transforms, normalMatrices,
+                                                  first->_computedOpacity, context, driver);
+}
+
+VROGeometry *VRONode::getRenderedGeometry() const {
+    return _geometry ? _geometry->getGeometryForLOD(_lodLevel) : nullptr;
+}
+
 void VRONode::render(const VRORenderContext &context, std::shared_ptr<VRODriver> &driver) {
     if (_holdRendering) {
         return;
     }
     if (_geometry && _computedOpacity > kHiddenOpacityThreshold) {
+        std::shared_ptr<VROLightClusterGrid> clusters = context.getLightClusters();
+        bool hasClusteredLights = clusters && clusters->getNumLights() > 0;
+        
         for (int i = 0; i < _geometry->getGeometryElements().size(); i++) {
             std::shared_ptr<VROMaterial> &material = _geometry->getMaterialForElement(i);
             if (!material->bindShader(_computedLightsHash, _computedLights, context, driver)) {
@@ -244,12 +476,12 @@ void VRONode::render(const VRORenderContext &context, std::shared_ptr<VRODriver>
 
             // We render the material if at least one of the following is true:
             //
-            // 1. There are lights in the scene that haven't been culled (if there are no lights, then
+            // 1. There are lights in the scene that haven't been culled, or clustered lights (if there are no lights, then
             //    nothing will be visible! Or,
             // 2. The material is Constant. Constant materials do not need light to be visible. Or,
             // 3. The material is PBR, and we have an active lighting environment. Lighting environments
             //    provide ambient light for PBR materials
-            if (!_computedLights.empty() ||
+            if (!_computedLights.empty() || hasClusteredLights ||
                  material->getLightingModel() == VROLightingModel::Constant ||
                 (material->getLightingModel() == VROLightingModel::PhysicallyBased && context.getIrradianceMap() != nullptr)) {
 
@@ -295,6 +527,16 @@ void VRONode::renderSilhouettes(std::shared_ptr<VROMaterial> &material,
     }
 }
 
+void VRONode::renderSilhouette(std::shared_ptr<VROMaterial> &material,
+                               const VRORenderContext &context, std::shared_ptr<VRODriver> &driver) {
+    if (_holdRendering) {
+        return;
+    }
+    if (_geometry && _computedOpacity > kHiddenOpacityThreshold) {
+        _geometry->renderSilhouette(_worldTransform, material, context, driver);
+    }
+}
+
 void VRONode::recomputeUmbrellaBoundingBox() {
     VROMatrix4f parentTransform;
     VROMatrix4f parentRotation;
@@ -351,31 +593,43 @@ void VRONode::updateSortKeys(uint32_t depth,
         return;
     }
 
-    std::stack<float> &opacities = params.opacities;
-    std::vector<std::shared_ptr<VROLight>> &lights = params.lights;
-    std::stack<int> &hierarchyDepths = params.hierarchyDepths;
-    std::stack<float> &distancesFromCamera = params.distancesFromCamera;
+    std::stack<float, VROFrameVector<float>> &opacities = params.opacities;
+    std::stack<int, VROFrameVector<int>> &hierarchyDepths = params.hierarchyDepths;
+    std::stack<float, VROFrameVector<float>> &distancesFromCamera = params.distancesFromCamera;
 
     /*
-     Compute specific parameters for this node.
+     Compute specific parameters for this node. The inverse-transpose and the
+     culled light list are cached, and only revalidated when their inputs change.
      */
-    _worldInverseTransposeTransform = _worldTransform.invert().transpose();
+    bool revalidated = false;
+    if (memcmp(_worldTransform.getArray(), _inverseTransposeSourceTransform.getArray(), sizeof(float) * 16) != 0) {
+        _worldInverseTransposeTransform = _worldTransform.invert().transpose();
+        _inverseTransposeSourceTransform = _worldTransform;
+        revalidated = true;
+    }
     _computedOpacity = opacities.top() * _opacity * _opacityFromHiddenFlag;
     opacities.push(_computedOpacity);
     
-    _computedLights.clear();
-    for (std::shared_ptr<VROLight> &light : lights) {
-        if ((light->getInfluenceBitMask() & _lightReceivingBitMask) != 0) {
-
-            // Ambient and Directional lights do not attenuate so do not cull them here
-            if (light->getType() == VROLightType::Ambient ||
-                light->getType() == VROLightType::Directional ||
-                getBoundingBox().getDistanceToPoint(light->getTransformedPosition()) < light->getAttenuationEndDistance()) {
-                _computedLights.push_back(light);
-            }
+    if (_computedLightsCullingVersion != params.lightCullingVersion ||
+        _computedLightsReceivingBitMask != _lightReceivingBitMask ||
+        memcmp(_worldBoundingBox.getPlanes(), _computedLightsBoundingBox.getPlanes(), sizeof(float) * 6) != 0) {
+        
+        _computedLights.clear();
+        if (params.lightBins) {
+            params.lightBins->getLightsInfluencing(_worldBoundingBox, _lightReceivingBitMask, &_computedLights);
         }
+        _computedLightsHash = VROLight::hashLights(_computedLights);
+        
+        _computedLightsCullingVersion = params.lightCullingVersion;
+        _computedLightsReceivingBitMask = _lightReceivingBitMask;
+        _computedLightsBoundingBox = _worldBoundingBox;
+        revalidated = true;
+    }
+    
+    params.nodesVisited++;
+    if (revalidated) {
+        params.nodesRevalidated++;
     }
-    _computedLightsHash = VROLight::hashLights(_computedLights);
 
     /*
      This node uses hierarchical rendering if its flag is set, or if its parent
@@ -489,9 +743,50 @@ void VRONode::getSortKeysForVisibleNodes(std::vector<VROSortKey> *outKeys) {
     }
 }
 
+void VRONode::getSortKeysForVisibleNodes(std::vector<VROSortKey> *outKeys, const VROFrustum &frustum,
+                                         const VROVector3f &cameraPosition) {
+    if (!_visible) {
+        return;
+    }
+    
+    // Bounds enclosing the camera are always kept, as in computeNodeVisibility.
+    // Once a node is entirely inside the frustum, so are all of its children
+    if (!_worldUmbrellaBoundingBox.containsPoint(cameraPosition)) {
+        VROFrustumResult result = frustum.intersectWithFarPointsOpt(_worldUmbrellaBoundingBox);
+        if (result == VROFrustumResult::Outside) {
+            return;
+        }
+        else if (result == VROFrustumResult::Inside) {
+            getSortKeysForVisibleNodes(outKeys);
+            return;
+        }
+    }
+    
+    if (_geometry && getType() == VRONodeType::Normal) {
+        _geometry->getSortKeys(outKeys);
+    }
+    for (std::shared_ptr<VRONode> &childNode : _subnodes) {
+        if (childNode->getType() == VRONodeType::Normal) {
+            childNode->getSortKeysForVisibleNodes(outKeys, frustum, cameraPosition);
+        }
+    }
+}
+
 void VRONode::computeTransforms(VROMatrix4f parentTransform, VROMatrix4f parentRotation) {
     passert_thread(__func__);
-    
+    computeTransformsRecursive(parentTransform, parentRotation);
+}
+
+void VRONode::computeTransformsRecursive(VROMatrix4f parentTransform, VROMatrix4f parentRotation) {
+    computeNodeTransform(parentTransform, parentRotation);
+
+    // Recurse down the tree
+    for (std::shared_ptr<VRONode> &childNode : _subnodes) {
+        childNode->computeTransformsRecursive(_worldTransform, _worldRotation);
+    }
+}
+
+void VRONode::computeNodeTransform(VROMatrix4f parentTransform, VROMatrix4f parentRotation) {
     // Compute the transform for this node
     doComputeTransform(parentTransform);
 
@@ -503,13 +798,11 @@ void VRONode::computeTransforms(VROMatrix4f parentTransform, VROMatrix4f parentR
         sound->setTransformedPosition(_worldTransform.multiply(sound->getPosition()));
     }
     
-    // Compute the umbrella bounding box for this node
+    // Compute the umbrella bounding box for this node. Note this uses the
+    // bounds of our children from the last frame, since they have not yet
+    // been recomputed; this also means it is safe to process our children
+    // on other threads once this function returns
     computeUmbrellaBounds();
-
-    // Recurse down the tree
-    for (std::shared_ptr<VRONode> &childNode : _subnodes) {
-        childNode->computeTransforms(_worldTransform, _worldRotation);
-    }
 }
 
 void VRONode::doComputeTransform(VROMatrix4f parentTransform) {
@@ -581,6 +874,18 @@ void VRONode::doComputeTransform(VROMatrix4f parentTransform) {
 void VRONode::applyConstraints(const VRORenderContext &context, VROMatrix4f parentTransform,
                                bool parentUpdated) {
     
+    bool updated = applyNodeConstraints(context, parentTransform, parentUpdated);
+
+    /*
+     Move down the tree.
+     */
+    for (std::shared_ptr<VRONode> &childNode : _subnodes) {
+        childNode->applyConstraints(context, _worldTransform, updated);
+    }
+}
+
+bool VRONode::applyNodeConstraints(const VRORenderContext &context, VROMatrix4f parentTransform,
+                                   bool parentUpdated) {
     bool updated = false;
     
     /*
@@ -598,6 +903,19 @@ void VRONode::applyConstraints(const VRORenderContext &context, VROMatrix4f pare
     for (const std::shared_ptr<VROConstraint> &constraint : _constraints) {
         if (constraint->getConstraintType() == VROConstraintType::Bone) {
             _worldTransform = constraint->getTransform(context, _worldTransform);
+        } else if (isConstraintAppliedInShader(constraint)) {
+            // The vertex shader rotates the geometry about the node's origin, so bound it
+            // by the sphere swept out by the scaled geometry
+            VROVector3f translation = _worldTransform.extractTranslation();
+            VROVector3f scale = _worldTransform.extractScale();
+            float ex = std::max(fabs(_geometryBoundingBox.getMinX()), fabs(_geometryBoundingBox.getMaxX())) * scale.x;
+            float ey = std::max(fabs(_geometryBoundingBox.getMinY()), fabs(_geometryBoundingBox.getMaxY())) * scale.y;
+            float ez = std::max(fabs(_geometryBoundingBox.getMinZ()), fabs(_geometryBoundingBox.getMaxZ())) * scale.z;
+            float radius = sqrt(ex * ex + ey * ey + ez * ez);
+            
+            _worldBoundingBox = VROBoundingBox(translation.x - radius, translation.x + radius,
+                                               translation.y - radius, translation.y + radius,
+                                               translation.z - radius, translation.z + radius);
         } else {
             VROMatrix4f billboardRotation = constraint->getTransform(context, _worldTransform);
 
@@ -625,25 +943,151 @@ void VRONode::applyConstraints(const VRORenderContext &context, VROMatrix4f pare
         
         updated = true;
     }
+    return updated;
+}
 
-    /*
-     Move down the tree.
-     */
-    for (std::shared_ptr<VRONode> &childNode : _subnodes) {
-        childNode->applyConstraints(context, _worldTransform, updated);
+void VRONode::collectIKRigs(std::vector<std::shared_ptr<VROIKRig>> *outRigs) {
+    if (_IKRig != nullptr) {
+        outRigs->push_back(_IKRig);
+        return;
+    }
+
+    for (const std::shared_ptr<VRONode> &node : _subnodes) {
+        node->collectIKRigs(outRigs);
     }
 }
 
-void VRONode::computeIKRig() {
-    std::shared_ptr<VROIKRig> rig = getIKRig();
-    if (rig != nullptr) {
-        rig->processRig();
+#pragma mark - Parallel Render Cycle
+
+/*
+ A subtree processed by a parallel render cycle pass, along with the state
+ it inherits from its parent.
+ */
+struct VROSubtree {
+    VRONode *node;
+    VROMatrix4f parentTransform;
+    VROMatrix4f parentRotation;
+    bool parentUpdated;
+};
+
+/*
+ Walk down the graph breadth-first from the given root, running the expand
+ function serially on each node (which processes that node alone and outputs
+ the child subtrees still to be processed), until there are enough subtrees
+ to keep every thread of the job system busy. Then run the process function
+ (which processes an entire subtree) on the remaining subtrees in parallel,
+ and wait for them to complete.
+ */
+template <typename Expand, typename Process>
+static void VROProcessSubtreesParallel(VROSubtree root, std::shared_ptr<VROJobSystem> &jobs,
+                                       Expand expand, Process process) {
+    if (!jobs || jobs->getNumWorkers() == 0) {
+        process(root);
         return;
     }
+    
+    size_t targetSubtrees = jobs->getConcurrency() * kParallelSubtreesPerThread;
+    std::deque<VROSubtree> subtrees = { root };
+    std::vector<VROSubtree> children;
+    
+    while (!subtrees.empty() && subtrees.size() < targetSubtrees) {
+        VROSubtree subtree = subtrees.front();
+        subtrees.pop_front();
+        
+        children.clear();
+        expand(subtree, &children);
+        subtrees.insert(subtrees.end(), children.begin(), children.end());
+    }
+    
+    VROJobCounter counter;
+    for (const VROSubtree &subtree : subtrees) {
+        jobs->run([&process, subtree] {
+            process(subtree);
+        }, counter);
+    }
+    jobs->wait(counter);
+}
+
+void VRONode::computeTransformsParallel(std::shared_ptr<VROJobSystem> &jobs) {
+    passert_thread(__func__);
+    
+    VROSubtree root = { this, {}, {}, false };
+    VROProcessSubtreesParallel(root, jobs,
+        [] (const VROSubtree &subtree, std::vector<VROSubtree> *outChildren) {
+            VRONode *node = subtree.node;
+            node->computeNodeTransform(subtree.parentTransform, subtree.parentRotation);
+            for (std::shared_ptr<VRONode> &childNode : node->_subnodes) {
+                outChildren->push_back({ childNode.get(), node->_worldTransform, node->_worldRotation, false });
+            }
+        },
+        [] (const VROSubtree &subtree) {
+            subtree.node->computeTransformsRecursive(subtree.parentTransform, subtree.parentRotation);
+        });
+}
+
+void VRONode::applyConstraintsParallel(const VRORenderContext &context, std::shared_ptr<VROJobSystem> &jobs) {
+    passert_thread(__func__);
+    
+    VROSubtree root = { this, {}, {}, false };
+    VROProcessSubtreesParallel(root, jobs,
+        [&context] (const VROSubtree &subtree, std::vector<VROSubtree> *outChildren) {
+            VRONode *node = subtree.node;
+            bool updated = node->applyNodeConstraints(context, subtree.parentTransform, subtree.parentUpdated);
+            for (std::shared_ptr<VRONode> &childNode : node->_subnodes) {
+                outChildren->push_back({ childNode.get(), node->_worldTransform, {}, updated });
+            }
+        },
+        [&context] (const VROSubtree &subtree) {
+            subtree.node->applyConstraints(context, subtree.parentTransform, subtree.parentUpdated);
+        });
+}
 
-    for (auto node : _subnodes) {
-        node->computeIKRig();
+void VRONode::updateVisibilityParallel(const VRORenderContext &context, std::shared_ptr<VROJobSystem> &jobs) {
+    passert_thread(__func__);
+    
+    VROSubtree root = { this, {}, {}, false };
+    VROProcessSubtreesParallel(root, jobs,
+        [&context] (const VROSubtree &subtree, std::vector<VROSubtree> *outChildren) {
+            VRONode *node = subtree.node;
+            VROFrustumResult result = node->computeNodeCulling(context);
+            
+            // Only descend into subtrees that intersect the frustum; the others
+            // are wholesale included or excluded, as in updateVisibility()
+            if (result == VROFrustumResult::Inside || !kEnableVisibilityFrustumTest) {
+                node->setVisibilityRecursive(true);
+            }
+            else if (result == VROFrustumResult::Intersects) {
+                node->_visible = true;
+                for (std::shared_ptr<VRONode> &childNode : node->_subnodes) {
+                    outChildren->push_back({ childNode.get(), {}, {}, false });
+                }
+            }
+            else {
+                node->setVisibilityRecursive(false);
+            }
+        },
+        [&context] (const VROSubtree &subtree) {
+            subtree.node->updateVisibility(context);
+        });
+}
+
+void VRONode::updateParticlesParallel(const VRORenderContext &context, std::shared_ptr<VROJobSystem> &jobs) {
+    passert_thread(__func__);
+    
+    // Emitters are independent of one another, so we collect them and update
+    // them in batches
+    std::vector<VRONode *> emitterNodes;
+    collectParticleEmitterNodes(&emitterNodes);
+    
+    if (!jobs) {
+        for (VRONode *node : emitterNodes) {
+            node->updateNodeParticles(context);
+        }
+        return;
     }
+    jobs->parallelFor(0, (int) emitterNodes.size(), kParticleEmittersPerJob, [&context, &emitterNodes] (int i) {
+        emitterNodes[i]->updateNodeParticles(context);
+    });
 }
 
 void VRONode::setWorldTransform(VROVector3f finalPosition, VROQuaternion finalRotation, bool animated) {
@@ -664,6 +1108,7 @@ void VRONode::setWorldTransform(VROVector3f finalPosition, VROQuaternion finalRo
         _scale = currentTransform.extractScale();
         _position = currentTransform.extractTranslation();
         _rotation = currentTransform.extractRotation(_scale);
+        _transformsDirty = true;
     } else {
         // we want this "setWorldTransform" to animate to the new scale/position/rotation. This is
         // slightly problematic because the computeTransforms is recursive, but this is only used
@@ -681,19 +1126,7 @@ void VRONode::setWorldTransform(VROVector3f finalPosition, VROQuaternion finalRo
 #pragma mark - Visibility
 
 void VRONode::updateVisibility(const VRORenderContext &context) {
-    const VROFrustum &frustum = context.getCamera().getFrustum();
-    VROFrustumResult result = VROFrustumResult::Outside;
-    
-    // First check for an edge case: if the bounds of the object _enclose_ the
-    // camera. This is common for mdoels or effects that surround the user, and
-    // our usual frustum test fails to handle this correctly.
-    if (_worldUmbrellaBoundingBox.containsPoint(context.getCamera().getPosition())) {
-        result = VROFrustumResult::Intersects;
-    }
-    // Otherwise do the normal frustum test.
-    else {
-        result = frustum.intersectAllOpt(_worldUmbrellaBoundingBox, &_umbrellaBoxMetadata);
-    }
+    VROFrustumResult result = computeNodeCulling(context);
     
     // Process the results of the frustum test, iterating down the tree if there
     // was an intersection, or else wholesale including or excluding all child nodes
@@ -712,6 +1145,55 @@ void VRONode::updateVisibility(const VRORenderContext &context) {
     }
 }
 
+VROFrustumResult VRONode::computeNodeVisibility(const VRORenderContext &context) {
+    const VROFrustum &frustum = context.getCamera().getFrustum();
+    
+    // First check for an edge case: if the bounds of the object _enclose_ the
+    // camera. This is common for mdoels or effects that surround the user, and
+    // our usual frustum test fails to handle this correctly.
+    if (_worldUmbrellaBoundingBox.containsPoint(context.getCamera().getPosition())) {
+        return VROFrustumResult::Intersects;
+    }
+    // Otherwise do the normal frustum test.
+    else {
+        return frustum.intersectAllOpt(_worldUmbrellaBoundingBox, &_umbrellaBoxMetadata);
+    }
+}
+
+VROFrustumResult VRONode::computeNodeCulling(const VRORenderContext &context) {
+    VROFrustumResult result = applyOcclusionResult(computeNodeVisibility(context), context);
+    if (result != VROFrustumResult::Outside) {
+        return result;
+    }
+    
+    // Nodes culled by the camera remain visible to any secondary view that sees
+    // them. Their children are then tested individually
+    for (const VROFrustum &frustum : context.getSecondaryViewFrustums()) {
+        if (frustum.intersectWithFarPointsOpt(_worldUmbrellaBoundingBox) != VROFrustumResult::Outside) {
+            return VROFrustumResult::Intersects;
+        }
+    }
+    return result;
+}
+
+VROFrustumResult VRONode::applyOcclusionResult(VROFrustumResult result, const VRORenderContext &context) {
+    if (result == VROFrustumResult::Outside || !context.isOcclusionCullingEnabled()) {
+        return result;
+    }
+    
+    // The node is in the frustum, so it's a candidate for an occlusion query.
+    // If it was found occluded recently, cull it wholesale
+    int frame = context.getFrame();
+    _occlusionCandidateFrame = frame;
+    if (_occluded && frame - _occlusionResultFrame <= kOcclusionResultMaxAge) {
+        return VROFrustumResult::Outside;
+    }
+    
+    // Descend even into subtrees entirely inside the frustum, since their
+    // children may be occluded where this node is not
+    return VROFrustumResult::Intersects;
+}
+
 void VRONode::setVisibilityRecursive(bool visible) {
     _visible = visible;
     
@@ -854,6 +1336,8 @@ void VRONode::addChildNode(std::shared_ptr<VRONode> node) {
     
     _subnodes.push_back(node);
     node->_supernode = std::static_pointer_cast<VRONode>(shared_from_this());
+    node->_transformsDirty = true;
+    VROTransformHierarchy::notifyGraphStructureChanged();
     
     /*
      If this node is attached to a VROScene, cascade and assign that scene to
@@ -865,6 +1349,28 @@ void VRONode::addChildNode(std::shared_ptr<VRONode> node) {
     }
 }
 
+void VRONode::addChildNodes(const std::vector<std::shared_ptr<VRONode>> &nodes) {
+    passert_thread(__func__);
+    if (nodes.empty()) {
+        return;
+    }
+    
+    std::shared_ptr<VRONode> self = std::static_pointer_cast<VRONode>(shared_from_this());
+    std::shared_ptr<VROScene> scene = _scene.lock();
+    
+    _subnodes.reserve(_subnodes.size() + nodes.size());
+    for (const std::shared_ptr<VRONode> &node : nodes) {
+        passert (node);
+        _subnodes.push_back(node);
+        node->_supernode = self;
+        node->_transformsDirty = true;
+        if (scene) {
+            node->setScene(scene, true);
+        }
+    }
+    VROTransformHierarchy::notifyGraphStructureChanged();
+}
+
 void VRONode::removeFromParentNode() {
     passert_thread(__func__);
     
@@ -877,6 +1383,7 @@ void VRONode::removeFromParentNode() {
                                                 return node.get() == this;
                                             }), parentSubnodes.end());
         _supernode.reset();
+        VROTransformHierarchy::notifyGraphStructureChanged();
     }
     
     /*
@@ -889,6 +1396,15 @@ std::vector<std::shared_ptr<VRONode>> VRONode::getChildNodes() const {
     return _subnodes;
 }
 
+void VRONode::collectNodes(std::function<bool(const VRONode &)> filter, std::vector<VRONode *> *outNodes) {
+    if (filter(*this)) {
+        outNodes->push_back(this);
+    }
+    for (std::shared_ptr<VRONode> &child : _subnodes) {
+        child->collectNodes(filter, outNodes);
+    }
+}
+
 void VRONode::getSkinner(std::vector<std::shared_ptr<VROSkinner>> &skinnersOut, bool recurse) {
     if (_geometry != nullptr && _geometry->getSkinner() != nullptr) {
         skinnersOut.push_back(_geometry->getSkinner());
@@ -968,36 +1484,54 @@ void VRONode::getChildPortals(std::vector<std::shared_ptr<VROPortal>> *outPortal
 
 void VRONode::setRotation(VROQuaternion rotation) {
     passert_thread(__func__);
-    animate(std::make_shared<VROAnimationQuaternion>([](VROAnimatable *const animatable, VROQuaternion r) {
-                                                         ((VRONode *)animatable)->_rotation = r;
-                                                         ((VRONode *)animatable)->_euler = r.toEuler();
-                                                     }, _rotation, rotation));
+    animateQuaternion(&_rotation, rotation, [](VROAnimatable *const animatable) {
+        VRONode *node = ((VRONode *)animatable);
+        node->_euler = node->_rotation.toEuler();
+        node->_transformsDirty = true;
+    });
 }
 
 void VRONode::setRotationEuler(VROVector3f euler) {
     passert_thread(__func__);
-    animate(std::make_shared<VROAnimationVector3f>([](VROAnimatable *const animatable, VROVector3f r) {
-                                                        ((VRONode *)animatable)->_euler = VROMathNormalizeAngles2PI(r);
-                                                        ((VRONode *)animatable)->_rotation = { r.x, r.y, r.z };
-                                                     }, _euler, euler));
-    
-    VROQuaternion rotation = { euler.x, euler.y, euler.z };
+    animateFloats(&_euler.x, &euler.x, 3, [](VROAnimatable *const animatable) {
+        VRONode *node = ((VRONode *)animatable);
+        node->_euler = VROMathNormalizeAngles2PI(node->_euler);
+        node->_rotation = { node->_euler.x, node->_euler.y, node->_euler.z };
+        node->_transformsDirty = true;
+    });
+}
+
+/*
+ Apply functions shared by the batched transform setters below.
+ */
+void VRONode::applyPosition(VROAnimatable *const animatable) {
+    VRONode *node = ((VRONode *)animatable);
+    node->_transformsDirty = true;
+    node->notifyTransformUpdate(false);
+}
+
+void VRONode::applyScale(VROAnimatable *const animatable) {
+    ((VRONode *)animatable)->_transformsDirty = true;
+}
+
+void VRONode::applyRotationEulerComponent(VROAnimatable *const animatable) {
+    VRONode *node = ((VRONode *)animatable);
+    VROVector3f &euler = node->_euler;
+    euler.x = VROMathNormalizeAngle2PI(euler.x);
+    euler.y = VROMathNormalizeAngle2PI(euler.y);
+    euler.z = VROMathNormalizeAngle2PI(euler.z);
+    node->_rotation = { euler.x, euler.y, euler.z };
+    node->_transformsDirty = true;
 }
 
 void VRONode::setPosition(VROVector3f position) {
     passert_thread(__func__);
-    animate(std::make_shared<VROAnimationVector3f>([](VROAnimatable *const animatable, VROVector3f p) {
-                                                        VRONode *node = ((VRONode *)animatable);
-                                                        node->_position = p;
-                                                        node->notifyTransformUpdate(false);
-                                                   }, _position, position));
+    animateFloats(&_position.x, &position.x, 3, applyPosition);
 }
 
 void VRONode::setScale(VROVector3f scale) {
     passert_thread(__func__);
-    animate(std::make_shared<VROAnimationVector3f>([](VROAnimatable *const animatable, VROVector3f s) {
-                                                       ((VRONode *)animatable)->_scale = s;
-                                                   }, _scale, scale));
+    animateFloats(&_scale.x, &scale.x, 3, applyScale);
 }
 
 void VRONode::setTransformDelegate(std::shared_ptr<VROTransformDelegate> delegate) {
@@ -1016,96 +1550,66 @@ void VRONode::notifyTransformUpdate(bool forced) {
 
 void VRONode::setPositionX(float x) {
     passert_thread(__func__);
-    animate(std::make_shared<VROAnimationFloat>([](VROAnimatable *const animatable, float p) {
-        VRONode *node = ((VRONode *)animatable);
-        node->_position.x = p;
-        node->notifyTransformUpdate(false);
-    }, _position.x, x));
+    animateFloats(&_position.x, &x, 1, applyPosition);
 }
 
 void VRONode::setPositionY(float y) {
     passert_thread(__func__);
-    animate(std::make_shared<VROAnimationFloat>([](VROAnimatable *const animatable, float p) {
-        VRONode *node = ((VRONode *)animatable);
-        node->_position.y = p;
-        node->notifyTransformUpdate(false);
-    }, _position.y, y));
+    animateFloats(&_position.y, &y, 1, applyPosition);
 }
 
 void VRONode::setPositionZ(float z) {
     passert_thread(__func__);
-    animate(std::make_shared<VROAnimationFloat>([](VROAnimatable *const animatable, float p) {
-        VRONode *node = ((VRONode *)animatable);
-        node->_position.z = p;
-        node->notifyTransformUpdate(false);
-    }, _position.z, z));
+    animateFloats(&_position.z, &z, 1, applyPosition);
 }
 
 void VRONode::setScaleX(float x) {
     passert_thread(__func__);
-    animate(std::make_shared<VROAnimationFloat>([](VROAnimatable *const animatable, float s) {
-        ((VRONode *)animatable)->_scale.x = s;
-    }, _scale.x, x));
+    animateFloats(&_scale.x, &x, 1, applyScale);
 }
 
 void VRONode::setScaleY(float y) {
     passert_thread(__func__);
-    animate(std::make_shared<VROAnimationFloat>([](VROAnimatable *const animatable, float s) {
-        ((VRONode *)animatable)->_scale.y = s;
-    }, _scale.y, y));
+    animateFloats(&_scale.y, &y, 1, applyScale);
 }
 
 void VRONode::setScaleZ(float z) {
     passert_thread(__func__);
-    animate(std::make_shared<VROAnimationFloat>([](VROAnimatable *const animatable, float s) {
-        ((VRONode *)animatable)->_scale.z = s;
-    }, _scale.z, z));
+    animateFloats(&_scale.z, &z, 1, applyScale);
 }
 
 void VRONode::setRotationEulerX(float radians) {
     passert_thread(__func__);
-    animate(std::make_shared<VROAnimationFloat>([](VROAnimatable *const animatable, float r) {
-        VROVector3f &euler = ((VRONode *) animatable)->_euler;
-        euler.x = VROMathNormalizeAngle2PI(r);
-        ((VRONode *)animatable)->_rotation = { euler.x, euler.y, euler.z };
-    }, _euler.x, radians));
+    animateFloats(&_euler.x, &radians, 1, applyRotationEulerComponent);
 }
 
 void VRONode::setRotationEulerY(float radians) {
     passert_thread(__func__);
-    animate(std::make_shared<VROAnimationFloat>([](VROAnimatable *const animatable, float r) {
-        VROVector3f &euler = ((VRONode *) animatable)->_euler;
-        euler.y = VROMathNormalizeAngle2PI(r);
-        ((VRONode *)animatable)->_rotation = { euler.x, euler.y, euler.z };
-    }, _euler.y, radians));
+    animateFloats(&_euler.y, &radians, 1, applyRotationEulerComponent);
 }
 
 void VRONode::setRotationEulerZ(float radians) {
     passert_thread(__func__);
-    animate(std::make_shared<VROAnimationFloat>([](VROAnimatable *const animatable, float r) {
-        VROVector3f &euler = ((VRONode *) animatable)->_euler;
-        euler.z = VROMathNormalizeAngle2PI(r);
-        ((VRONode *)animatable)->_rotation = { euler.x, euler.y, euler.z };
-    }, _euler.z, radians));
+    animateFloats(&_euler.z, &radians, 1, applyRotationEulerComponent);
 }
 
 void VRONode::setRotationPivot(VROMatrix4f pivot) {
     passert_thread(__func__);
     _rotationPivot = pivot;
     _rotationPivotInverse = pivot.invert();
+    _transformsDirty = true;
 }
 
 void VRONode::setScalePivot(VROMatrix4f pivot) {
     passert_thread(__func__);
     _scalePivot = pivot;
     _scalePivotInverse = pivot.invert();
+    _transformsDirty = true;
 }
 
 void VRONode::setOpacity(float opacity) {
     passert_thread(__func__);
-    animate(std::make_shared<VROAnimationFloat>([](VROAnimatable *const animatable, float s) {
-        ((VRONode *)animatable)->_opacity = s;
-    }, _opacity, opacity));
+    animateFloats(&_opacity, &opacity, 1, [](VROAnimatable *const animatable) {});
 }
 
 void VRONode::setHidden(bool hidden) {
@@ -1113,9 +1617,7 @@ void VRONode::setHidden(bool hidden) {
     _hidden = hidden;
     
     float opacity = hidden ? 0.0 : 1.0;
-    animate(std::make_shared<VROAnimationFloat>([](VROAnimatable *const animatable, float s) {
-        ((VRONode *)animatable)->_opacityFromHiddenFlag = s;
-    }, _opacityFromHiddenFlag, opacity));
+    animateFloats(&_opacityFromHiddenFlag, &opacity, 1, [](VROAnimatable *const animatable) {});
 }
 
 void VRONode::setHighAccuracyEvents(bool enabled) {
@@ -1125,40 +1627,114 @@ void VRONode::setHighAccuracyEvents(bool enabled) {
 
 #pragma mark - Application Thread Setters
 
+/*
+ Property writes made by the atomic setters, recorded on the application thread
+ and applied on the rendering thread. Values hold a vector (3 floats), quaternion
+ (4 floats), or pivot matrix (16 floats).
+ */
+enum class VROAtomicProperty {
+    Position,
+    Rotation,
+    Scale,
+    RotationPivot,
+    ScalePivot
+};
+
+struct VROAtomicPropertyWrite {
+    std::weak_ptr<VRONode> node;
+    VROAtomicProperty property;
+    float values[16];
+};
+
+struct VROAtomicPropertyWriteBuffer {
+    std::mutex mutex;
+    std::vector<VROAtomicPropertyWrite> pending;
+
+    // Owned by the rendering thread; swapped with pending so both keep
+    // their capacity across frames
+    std::vector<VROAtomicPropertyWrite> applying;
+};
+
+static VROAtomicPropertyWriteBuffer &getAtomicPropertyWriteBuffer() {
+    static VROAtomicPropertyWriteBuffer sBuffer;
+    return sBuffer;
+}
+
+static void recordAtomicPropertyWrite(std::shared_ptr<VRONode> node, VROAtomicProperty property,
+                                      const float *values, int count) {
+    VROAtomicPropertyWriteBuffer &buffer = getAtomicPropertyWriteBuffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    buffer.pending.emplace_back();
+
+    VROAtomicPropertyWrite &write = buffer.pending.back();
+    write.node = std::move(node);
+    write.property = property;
+    memcpy(write.values, values, count * sizeof(float));
+    VRORenderInvalidation::invalidate();
+}
+
+void VRONode::applyAtomicPropertyWrites() {
+    VROAtomicPropertyWriteBuffer &buffer = getAtomicPropertyWriteBuffer();
+    {
+        std::lock_guard<std::mutex> lock(buffer.mutex);
+        if (buffer.pending.empty()) {
+            return;
+        }
+        buffer.applying.swap(buffer.pending);
+    }
+    VRO_PROFILE_SCOPE("applyAtomicPropertyWrites");
+
+    for (const VROAtomicPropertyWrite &write : buffer.applying) {
+        std::shared_ptr<VRONode> node = write.node.lock();
+        if (!node) {
+            continue;
+        }
+
+        const float *v = write.values;
+        switch (write.property) {
+            case VROAtomicProperty::Position:
+                node->setPosition({ v[0], v[1], v[2] });
+                break;
+            case VROAtomicProperty::Rotation:
+                node->setRotation(VROQuaternion(v[0], v[1], v[2], v[3]));
+                break;
+            case VROAtomicProperty::Scale:
+                node->setScale({ v[0], v[1], v[2] });
+                break;
+            case VROAtomicProperty::RotationPivot:
+                node->setRotationPivot(VROMatrix4f(v));
+                break;
+            case VROAtomicProperty::ScalePivot:
+                node->setScalePivot(VROMatrix4f(v));
+                break;
+        }
+    }
+    VRO_PROFILE_COUNT(AtomicPropertyWrites, (int) buffer.applying.size());
+    buffer.applying.clear();
+}
+
 void VRONode::setPositionAtomic(VROVector3f position) {
     _lastPosition = position;
 
-    std::weak_ptr<VRONode> node_w = std::dynamic_pointer_cast<VRONode>(shared_from_this());
-    VROPlatformDispatchAsyncRenderer([node_w, position] {
-        std::shared_ptr<VRONode> node = node_w.lock();
-        if (node) {
-            node->setPosition(position);
-        }
-    });
+    float values[3] = { position.x, position.y, position.z };
+    recordAtomicPropertyWrite(std::static_pointer_cast<VRONode>(shared_from_this()),
+                              VROAtomicProperty::Position, values, 3);
 }
 
 void VRONode::setRotationAtomic(VROQuaternion rotation) {
     _lastRotation = rotation;
 
-    std::weak_ptr<VRONode> node_w = std::dynamic_pointer_cast<VRONode>(shared_from_this());
-    VROPlatformDispatchAsyncRenderer([node_w, rotation] {
-        std::shared_ptr<VRONode> node = node_w.lock();
-        if (node) {
-            node->setRotation(rotation);
-        }
-    });
+    float values[4] = { rotation.X, rotation.Y, rotation.Z, rotation.W };
+    recordAtomicPropertyWrite(std::static_pointer_cast<VRONode>(shared_from_this()),
+                              VROAtomicProperty::Rotation, values, 4);
 }
 
 void VRONode::setScaleAtomic(VROVector3f scale) {
     _lastScale = scale;
 
-    std::weak_ptr<VRONode> node_w = std::dynamic_pointer_cast<VRONode>(shared_from_this());
-    VROPlatformDispatchAsyncRenderer([node_w, scale] {
-        std::shared_ptr<VRONode> node = node_w.lock();
-        if (node) {
-            node->setScale(scale);
-        }
-    });
+    float values[3] = { scale.x, scale.y, scale.z };
+    recordAtomicPropertyWrite(std::static_pointer_cast<VRONode>(shared_from_this()),
+                              VROAtomicProperty::Scale, values, 3);
 }
 
 void VRONode::setRotationPivotAtomic(VROMatrix4f pivot) {
@@ -1166,13 +1742,8 @@ void VRONode::setRotationPivotAtomic(VROMatrix4f pivot) {
     _lastRotationPivot = pivot;
     _lastRotationPivotInverse = pivot.invert();
 
-    std::weak_ptr<VRONode> node_w = std::dynamic_pointer_cast<VRONode>(shared_from_this());
-    VROPlatformDispatchAsyncRenderer([node_w, pivot] {
-        std::shared_ptr<VRONode> node = node_w.lock();
-        if (node) {
-            node->setRotationPivot(pivot);
-        }
-    });
+    recordAtomicPropertyWrite(std::static_pointer_cast<VRONode>(shared_from_this()),
+                              VROAtomicProperty::RotationPivot, pivot.getArray(), 16);
 }
 
 void VRONode::setScalePivotAtomic(VROMatrix4f pivot) {
@@ -1180,13 +1751,8 @@ void VRONode::setScalePivotAtomic(VROMatrix4f pivot) {
     _lastScalePivot = pivot;
     _lastScalePivotInverse = pivot.invert();
 
-    std::weak_ptr<VRONode> node_w = std::dynamic_pointer_cast<VRONode>(shared_from_this());
-    VROPlatformDispatchAsyncRenderer([node_w, pivot] {
-        std::shared_ptr<VRONode> node = node_w.lock();
-        if (node) {
-            node->setScalePivot(pivot);
-        }
-    });
+    recordAtomicPropertyWrite(std::static_pointer_cast<VRONode>(shared_from_this()),
+                              VROAtomicProperty::ScalePivot, pivot.getArray(), 16);
 }
 
 void VRONode::computeTransformsAtomic(VROMatrix4f parentTransform, VROMatrix4f parentRotation) {
@@ -1509,6 +2075,36 @@ void VRONode::removeAllAnimations() {
     _animations.clear();
 }
 
+int VRONode::getAnimationUpdateInterval(const VRORenderContext &context) const {
+    if (!_animationLODEnabled) {
+        return 1;
+    }
+    if (!_visible) {
+        return 0;
+    }
+
+    /*
+     Estimate the fraction of the viewport height covered by the bounding sphere
+     of the umbrella box. The [5] element of the projection is cot(fovy / 2).
+     */
+    const VROBoundingBox &bounds = _worldUmbrellaBoundingBox;
+    float radius = bounds.getExtents().magnitude() * 0.5f;
+    float distance = bounds.getCenter().distance(context.getCamera().getPosition());
+    if (distance <= radius) {
+        return 1;
+    }
+
+    float screenSize = radius * context.getProjectionMatrix()[5] / distance;
+    float fullRateScreenSize = _animationLODScreenSize * context.getAnimationLODBias();
+    if (screenSize >= fullRateScreenSize) {
+        return 1;
+    }
+    if (screenSize <= 0) {
+        return _animationLODMaxUpdateInterval;
+    }
+    return std::min(_animationLODMaxUpdateInterval, (int) ceil(fullRateScreenSize / screenSize));
+}
+
 void VRONode::onAnimationFinished() {
     notifyTransformUpdate(true);
 
@@ -1526,8 +2122,8 @@ std::set<std::shared_ptr<VROMorpher>> VRONode::getMorphers(bool recursive) {
         }
     }
 
-    if (recursive && getChildNodes().size() > 0) {
-        for (auto childNode : _subnodes) {
+    if (recursive) {
+        for (const std::shared_ptr<VRONode> &childNode : _subnodes) {
             std::set<std::shared_ptr<VROMorpher>> subResults = childNode->getMorphers(recursive);
             result.insert(subResults.begin(), subResults.end());
         }
@@ -1563,6 +2159,16 @@ void VRONode::hitTest(const VROCamera &camera, VROVector3f origin, VROVector3f r
         return;
     }
     
+    /*
+     The umbrella bounds enclose this node and its entire subtree, so the scene
+     graph acts as a bounding volume hierarchy: if the ray misses them, there's
+     nothing below to hit.
+     */
+    VROVector3f umbrellaIntPt;
+    if (!_worldUmbrellaBoundingBox.intersectsRay(ray, origin, &umbrellaIntPt)) {
+        return;
+    }
+    
     VROMatrix4f transform = _worldTransform;
     boundsOnly = boundsOnly && !getHighAccuracyEvents();
     
@@ -1599,49 +2205,89 @@ void VRONode::hitTest(const VROCamera &camera, VROVector3f origin, VROVector3f r
 bool VRONode::hitTestGeometry(VROVector3f origin, VROVector3f ray,
                               VROMatrix4f transform, VROVector3f *intPt) {
     passert_thread(__func__);
-    std::shared_ptr<VROGeometrySource> vertexSource = _geometry->getGeometrySourcesForSemantic(VROGeometrySourceSemantic::Vertex).front();
     
-    bool hit = false;
-    float currentDistance = FLT_MAX;
-    std::string tag = getTag();
-    for (std::shared_ptr<VROGeometryElement> element : _geometry->getGeometryElements()) {
-         element->processTriangles([&hit, ray, origin, transform, &intPt, &currentDistance, tag](int index, VROTriangle triangle) {
-             VROTriangle transformed = triangle.transformByMatrix(transform);
-             VROVector3f intPtGeom;
-             if (transformed.intersectsRay(ray, origin, &intPtGeom)) {
-                 float distance = intPtGeom.distance(origin);
-                 if (distance < currentDistance){
-                     currentDistance = distance;
-                     *intPt = intPtGeom;
-                     hit = true;
-                 }
-
-                 //TODO Offer a way to break out of here, as optimization
-             }
-         }, vertexSource);
-    }
+    /*
+     Rather than transform every triangle into world space, transform the ray
+     into model space and test it against the geometry's triangle BVH. Affine
+     transforms preserve the ordering of hits along the ray, so the closest hit
+     in model space is also the closest hit in world space.
+     */
+    std::shared_ptr<VROTriangleBVH> bvh = _geometry->getTriangleBVH();
+    VROMatrix4f inverseTransform = transform.invert();
+    VROVector3f localOrigin = inverseTransform.multiply(origin);
+    VROVector4f localRay = inverseTransform.multiply(VROVector4f(ray.x, ray.y, ray.z, 0));
     
-    return hit;
+    VROVector3f localIntPt;
+    if (!bvh->intersectsRay({ localRay.x, localRay.y, localRay.z }, localOrigin, &localIntPt)) {
+        return false;
+    }
+    *intPt = transform.multiply(localIntPt);
+    return true;
 }
 
 #pragma mark - Constraints
 
+void VRONode::setGeometry(std::shared_ptr<VROGeometry> geometry) {
+    passert_thread(__func__);
+    for (const std::shared_ptr<VROConstraint> &constraint : _constraints) {
+        setConstraintShaderModifier(_geometry, constraint, false);
+        setConstraintShaderModifier(geometry, constraint, true);
+    }
+    _geometry = geometry;
+    _transformsDirty = true;
+}
+
 void VRONode::addConstraint(std::shared_ptr<VROConstraint> constraint) {
     passert_thread(__func__);
     _constraints.push_back(constraint);
+    setConstraintShaderModifier(_geometry, constraint, true);
+    _transformsDirty = true;
 }
 
 void VRONode::removeConstraint(std::shared_ptr<VROConstraint> constraint) {
     passert_thread(__func__);
+    setConstraintShaderModifier(_geometry, constraint, false);
     _constraints.erase(std::remove_if(_constraints.begin(), _constraints.end(),
                                   [constraint](std::shared_ptr<VROConstraint> candidate) {
                                       return candidate == constraint;
                                   }), _constraints.end());
+    _transformsDirty = true;
 }
 
 void VRONode::removeAllConstraints() {
     passert_thread(__func__);
+    for (const std::shared_ptr<VROConstraint> &constraint : _constraints) {
+        setConstraintShaderModifier(_geometry, constraint, false);
+    }
     _constraints.clear();
+    _transformsDirty = true;
+}
+
+void VRONode::setConstraintShaderModifier(std::shared_ptr<VROGeometry> geometry,
+                                          std::shared_ptr<VROConstraint> constraint, bool installed) {
+    std::shared_ptr<VROShaderModifier> modifier = constraint->getShaderModifier();
+    if (!geometry || !modifier || geometry->getInstancedUBO() != nullptr) {
+        return;
+    }
+    for (const std::shared_ptr<VROMaterial> &material : geometry->getMaterials()) {
+        bool hasModifier = material->hasShaderModifier(modifier);
+        if (installed && !hasModifier) {
+            material->addShaderModifier(modifier);
+        } else if (!installed && hasModifier) {
+            material->removeShaderModifier(modifier);
+        }
+    }
+}
+
+bool VRONode::isConstraintAppliedInShader(const std::shared_ptr<VROConstraint> &constraint) const {
+    // Nodes with children are constrained on the CPU, since their children inherit
+    // the constraint. Fall back to the CPU as well if the materials were replaced after
+    // the modifier was installed.
+    if (!_subnodes.empty() || !_geometry || _geometry->getMaterials().empty()) {
+        return false;
+    }
+    std::shared_ptr<VROShaderModifier> modifier = constraint->getShaderModifier();
+    return modifier && _geometry->getMaterials().front()->hasShaderModifier(modifier);
 }
 
 #pragma mark - Physics
@@ -1675,6 +2321,15 @@ void VRONode::clearPhysicsBody() {
 #pragma mark - Particle Emitters
 
 void VRONode::updateParticles(const VRORenderContext &context) {
+    updateNodeParticles(context);
+    
+    // Recurse to children
+    for (std::shared_ptr<VRONode> &child : _subnodes) {
+        child->updateParticles(context);
+    }
+}
+
+void VRONode::updateNodeParticles(const VRORenderContext &context) {
     if (_particleEmitter) {
         // Check if the particle emitter's surface has changed
         if (_geometry != _particleEmitter->getParticleSurface()) {
@@ -1684,10 +2339,14 @@ void VRONode::updateParticles(const VRORenderContext &context) {
         // Update the emitter
         _particleEmitter->update(context, _worldTransform);
     }
-    
-    // Recurse to children
+}
+
+void VRONode::collectParticleEmitterNodes(std::vector<VRONode *> *outNodes) {
+    if (_particleEmitter) {
+        outNodes->push_back(this);
+    }
     for (std::shared_ptr<VRONode> &child : _subnodes) {
-        child->updateParticles(context);
+        child->collectParticleEmitterNodes(outNodes);
     }
 }
 
@@ -1695,6 +2354,7 @@ void VRONode::setParticleEmitter(std::shared_ptr<VROParticleEmitter> emitter) {
     passert_thread(__func__);
     _particleEmitter = emitter;
     _geometry = emitter->getParticleSurface();
+    _transformsDirty = true;
     setIgnoreEventHandling(true);
 }
 
@@ -1702,6 +2362,7 @@ void VRONode::removeParticleEmitter() {
     passert_thread(__func__);
     _particleEmitter.reset();
     _geometry.reset();
+    _transformsDirty = true;
     setIgnoreEventHandling(false);
 }
 
@@ -51,6 +51,7 @@
 #include "VROThreadRestricted.h"
 #include "VROPhysicsBody.h"
 
+class VROFrustum;
 class VROGeometry;
 class VROLight;
 class VROScene;
@@ -70,6 +71,8 @@ class VROParticleEmitter;
 class VROSkeletalAnimationLayer;
 class VROSkinner;
 class VROIKRig;
+class VROJobSystem;
+class VROFrameArena;
 
 extern bool kDebugSortOrder;
 extern int  kDebugSortOrderFrameFrequency;
@@ -104,6 +107,10 @@ enum class VRODragType {
 
 class VRONode : public VROAnimatable, public VROThreadRestricted {
     
+    friend class VROTransformHierarchy;
+    friend class VROOcclusionCuller;
+    friend class VROSceneSnapshot;
+    
 public:
     
     static void resetDebugSortIndex();
@@ -139,6 +146,18 @@ public:
      are shared by reference with the copied node.
      */
     std::shared_ptr<VRONode> clone();
+    
+    /*
+     Clone this node's subtree the given number of times, returning the root of
+     each copy. As with clone(), geometries, materials and lights are shared by
+     reference with the copies.
+     
+     The copies are allocated together from one arena, which is released once
+     every copy has been destroyed, and are not attached to the scene graph; add
+     them with addChildNodes() to attach them all at once. Use this in place of
+     repeated clone() calls when spawning many instances of a model.
+     */
+    std::vector<std::shared_ptr<VRONode>> instantiate(int count);
 
     /*
      Get a unique ID for this VRONode.
@@ -183,6 +202,18 @@ public:
     void applyConstraints(const VRORenderContext &context, VROMatrix4f parentTransform,
                           bool parentUpdated);
     
+    /*
+     Parallel versions of computeTransforms, applyConstraints, updateVisibility, and
+     updateParticles. These are invoked on the root node of a scene. The top of the
+     graph is processed serially until it fans out into enough independent subtrees
+     to occupy the given job system; each subtree is then processed as a job. Each
+     function returns once all of its jobs have completed.
+     */
+    void computeTransformsParallel(std::shared_ptr<VROJobSystem> &jobs);
+    void applyConstraintsParallel(const VRORenderContext &context, std::shared_ptr<VROJobSystem> &jobs);
+    void updateVisibilityParallel(const VRORenderContext &context, std::shared_ptr<VROJobSystem> &jobs);
+    void updateParticlesParallel(const VRORenderContext &context, std::shared_ptr<VROJobSystem> &jobs);
+    
     /*
      Update the position of each light in this node, and add to the outLights vector.
      Recurses down the tree.
@@ -210,6 +241,13 @@ public:
      */
     void getSortKeysForVisibleNodes(std::vector<VROSortKey> *outKeys);
     
+    /*
+     Get the sort keys for the visible nodes in this portal that are also in the
+     given frustum, as seen from the given camera position.
+     */
+    void getSortKeysForVisibleNodes(std::vector<VROSortKey> *outKeys, const VROFrustum &frustum,
+                                    const VROVector3f &cameraPosition);
+    
     /*
      Render the given element of this node's geometry, using its latest computed transforms.
      */
@@ -217,6 +255,58 @@ public:
                 std::shared_ptr<VROMaterial> &material,
                 const VRORenderContext &context,
                 std::shared_ptr<VRODriver> &driver);
+
+    /*
+     Render the given element of this node's geometry to the depth buffer with the
+     given (already bound) depth material, for the depth pre-pass.
+     */
+    void renderDepth(int elementIndex,
+                     std::shared_ptr<VROMaterial> &depthMaterial,
+                     const VRORenderContext &context,
+                     std::shared_ptr<VRODriver> &driver);
+    
+    /*
+     Returns true if the given node can be rendered in the same instanced draw as
+     this node: the two must share a geometry that supports automatic instancing,
+     and have the same computed opacity and lights.
+     */
+    bool isInstanceableWith(const VRONode &node) const;
+    
+    /*
+     Render the given element of the geometry shared by all of the given nodes in
+     one instanced draw, using each node's latest computed transforms. The nodes
+     must be mutually instanceable (see isInstanceableWith()), and the material's
+     instanced shader must already be bound.
+     */
+    static void renderInstanced(const std::vector<VRONode *> &nodes,
+                                int elementIndex,
+                                std::shared_ptr<VROMaterial> &material,
+                                const VRORenderContext &context,
+                                std::shared_ptr<VRODriver> &driver);
+    
+    /*
+     Returns true if the given element of the given node can be rendered in the
+     same multi-draw as the given element of this node: their geometries must be
+     multi-draw compatible (see VROGeometry::isMultiDrawCompatibleWith), and the
+     nodes must have the same computed opacity and lights.
+     */
+    bool isMultiDrawableWith(int elementIndex, const VRONode &node, int nodeElementIndex) const;
+    
+    /*
+     Render the given element of each of the given nodes' geometries in one
+     multi-draw, using each node's latest computed transforms. The nodes must be
+     mutually multi-drawable (see isMultiDrawableWith()), and the material's
+     instanced shader must already be bound. If the nodes' materials differ only
+     in their layer or region of a packed diffuse texture (see
+     VROMaterial::isBatchableWith), diffuseTextures holds the diffuse texture of
+     each node's material; otherwise it is empty.
+     */
+    static void renderMultiDraw(const std::vector<VRONode *> &nodes,
+                                const std::vector<int> &elementIndices,
+                                const std::vector<VROTexture *> &diffuseTextures,
+                                std::shared_ptr<VROMaterial> &material,
+                                const VRORenderContext &context,
+                                std::shared_ptr<VRODriver> &driver);
     
     /*
      Recursively render this node and all of its children, with full texture
@@ -240,6 +330,13 @@ public:
     void renderSilhouettes(std::shared_ptr<VROMaterial> &material, VROSilhouetteMode mode,
                            std::function<bool(const VRONode&)> filter,
                            const VRORenderContext &context, std::shared_ptr<VRODriver> &driver);
+
+    /*
+     Render the flat silhouette of this node alone, excluding its children, with
+     the given material. The material's shader must already be bound.
+     */
+    void renderSilhouette(std::shared_ptr<VROMaterial> &material,
+                          const VRORenderContext &context, std::shared_ptr<VRODriver> &driver);
     
     /*
      This function recomputes this node's transform before recomputing its umbrella bounding box
@@ -249,13 +346,39 @@ public:
     
 #pragma mark - Geometry
     
-    void setGeometry(std::shared_ptr<VROGeometry> geometry) {
-        passert_thread(__func__);
-        _geometry = geometry;
-    }
-    std::shared_ptr<VROGeometry> getGeometry() const {
+    void setGeometry(std::shared_ptr<VROGeometry> geometry);
+    const std::shared_ptr<VROGeometry> &getGeometry() const {
         return _geometry;
     }
+    
+    /*
+     The level of detail at which this node's geometry is rendered, selected
+     each frame from the geometry's on-screen size (see VROGeometry::selectLOD).
+     */
+    int getLODLevel() const {
+        return _lodLevel;
+    }
+    void setLODLevel(int lod) {
+        _lodLevel = lod;
+    }
+    
+    /*
+     Offset, in seconds, at which this node plays the baked animation of its
+     geometry's skinner, if any (see VROBakedSkeletalAnimation). Giving each node
+     of a crowd a different offset keeps them from moving in lockstep, while
+     they are still rendered in one instanced draw.
+     */
+    void setBakedAnimationTimeOffset(float seconds) {
+        _bakedAnimationTimeOffset = seconds;
+    }
+    float getBakedAnimationTimeOffset() const {
+        return _bakedAnimationTimeOffset;
+    }
+    
+    /*
+     The geometry rendered for this node at its current level of detail.
+     */
+    VROGeometry *getRenderedGeometry() const;
 
     void setIKRig(std::shared_ptr<VROIKRig> rig) {
         _IKRig = rig;
@@ -265,10 +388,11 @@ public:
     }
 
     /*
-     Called during a render pass to perform a full IK calculation on the rig
-     attached to this node.
+     Collect the IK rigs attached to this node and its descendants, to be
+     processed in a render pass. Subnodes of a node with a rig are not searched,
+     since they are driven by that rig.
      */
-    void computeIKRig();
+    void collectIKRigs(std::vector<std::shared_ptr<VROIKRig>> *outRigs);
 
 #pragma mark - Camera
     
@@ -394,13 +518,20 @@ public:
     // The atomic setters below will immediately update all of a node's related application
     // thread properties. For example, node->setPositionAtomic() will immediately update the
     // application thread's world transform, so that it can be used for other calculations on
-    // the application thread. These setters will *dispatch* to the rendering thread to set the
-    // corresponding rendering thread properties.
+    // the application thread. These setters record the write in a shared buffer, and the
+    // rendering thread applies all recorded writes in one pass at the start of the next frame.
     void setPositionAtomic(VROVector3f position);
     void setRotationAtomic(VROQuaternion rotation);
     void setScaleAtomic(VROVector3f scale);
     void setScalePivotAtomic(VROMatrix4f scalePivot);
     void setRotationPivotAtomic(VROMatrix4f rotationPivot);
+
+    /*
+     Apply, in the order they were made, the rendering thread side of all atomic
+     property writes made since the last invocation. Invoked by the renderer at the
+     start of each frame.
+     */
+    static void applyAtomicPropertyWrites();
     
     /*
      Must be invoked for this node and its children (all the way down the scene graph) whenever
@@ -426,7 +557,8 @@ public:
     /*
      Recursively sync the application thread properties with the latest values from the rendering
      thread. Called on the rendering thread after the transform computation occurs in the render
-     cycle. Dispatches to the application thread.
+     cycle. Dispatches to the application thread, once per node: scenes use VROSceneSnapshot
+     instead, which publishes the entire graph with a single dispatch.
      */
     void syncAppThreadProperties();
     
@@ -545,6 +677,18 @@ public:
     int getShadowCastingBitMask() const {
         return _shadowCastingBitMask;
     }
+    
+    void setViewBitMask(int bitMask, bool recursive = false) {
+        _viewBitMask = bitMask;
+        if (recursive) {
+            for (std::shared_ptr<VRONode> &child : _subnodes) {
+                child->setViewBitMask(bitMask, recursive);
+            }
+        }
+    }
+    int getViewBitMask() const {
+        return _viewBitMask;
+    }
 
 #pragma mark - Sounds
     
@@ -572,10 +716,31 @@ public:
     void addChildNode(std::shared_ptr<VRONode> node);
     void removeFromParentNode();
     
+    /*
+     Add each of the given nodes as a child of this node. Equivalent to calling
+     addChildNode() for each, but notifies the scene graph of the change once.
+     */
+    void addChildNodes(const std::vector<std::shared_ptr<VRONode>> &nodes);
+    
     /*
      Return a copy of the subnode list.
      */
     std::vector<std::shared_ptr<VRONode>> getChildNodes() const;
+
+    /*
+     Return the subnode list itself, without copying it (and without touching
+     the reference count of each child). Only for traversals that do not add or
+     remove nodes while iterating; otherwise use getChildNodes().
+     */
+    const std::vector<std::shared_ptr<VRONode>> &getSubnodes() const {
+        return _subnodes;
+    }
+
+    /*
+     Recursively collect into outNodes, in depth-first order, the nodes of this
+     subtree (including this node) that pass the given filter.
+     */
+    void collectNodes(std::function<bool(const VRONode &)> filter, std::vector<VRONode *> *outNodes);
     
     /*
      Remove all children from this node.
@@ -685,6 +850,34 @@ public:
      */
     void removeAllAnimations();
 
+    /*
+     Animation LOD throttles the animations executed on this node when it is
+     small on screen or not visible. When enabled, animations run at full rate
+     while the node's umbrella bounds span at least the given fraction of the
+     viewport height; below that the update interval grows in proportion, up to
+     the given maximum number of frames. Animations pause while the node is not
+     visible, and resume at their current time when it reappears. Disabled by
+     default.
+     */
+    void setAnimationLODEnabled(bool enabled) {
+        _animationLODEnabled = enabled;
+    }
+    bool isAnimationLODEnabled() const {
+        return _animationLODEnabled;
+    }
+    void setAnimationLODScreenSize(float fullRateScreenSize) {
+        _animationLODScreenSize = fullRateScreenSize;
+    }
+    void setAnimationLODMaxUpdateInterval(int frames) {
+        _animationLODMaxUpdateInterval = std::max(frames, 1);
+    }
+
+    /*
+     Return the number of frames between animation updates for this node given
+     the camera of the last frame, or 0 if its animations should pause.
+     */
+    int getAnimationUpdateInterval(const VRORenderContext &context) const;
+
     /*
      Triggered when the animation running this animatable node completes.
      */
@@ -724,7 +917,7 @@ public:
     void setIgnoreEventHandling(bool canHandle) {
         _ignoreEventHandling = canHandle;
 
-        for (std::shared_ptr<VRONode> childNode : getChildNodes()){
+        for (const std::shared_ptr<VRONode> &childNode : _subnodes) {
             childNode->setIgnoreEventHandling(canHandle);
         }
     }
@@ -843,11 +1036,28 @@ protected:
      True if this node was found visible during the last call to computeVisibility().
      */
     bool _visible;
+
+    /*
+     Occlusion culling state, written during visibility and by the
+     VROOcclusionCuller. _occlusionCandidateFrame is the last frame this node
+     survived frustum culling, and _occluded is the result of the last occlusion
+     query, collected on _occlusionResultFrame.
+     */
+    int _occlusionCandidateFrame;
+    bool _occlusionQueryPending;
+    bool _occluded;
+    int _occlusionResultFrame;
     
     /*
      Last frame that this node was visited during sorting. Used for graph traversal.
      */
     int _lastVisitedRenderingFrame;
+    
+    /*
+     True if the position, rotation, scale, pivots, or geometry of this node have
+     changed since its transforms were last computed by a VROTransformHierarchy.
+     */
+    bool _transformsDirty;
 
 private:
     
@@ -923,6 +1133,18 @@ private:
     uint32_t _computedLightsHash;
     std::weak_ptr<VROTransformDelegate> _transformDelegate;
 
+    /*
+     Inputs from which _worldInverseTransposeTransform and _computedLights were
+     last derived. These products are only recomputed in updateSortKeys when
+     their inputs change: the world transform for the former, and the scene's
+     light culling version, this node's bounds, and its light receiving
+     bit mask for the latter.
+     */
+    VROMatrix4f _inverseTransposeSourceTransform;
+    uint32_t _computedLightsCullingVersion;
+    VROBoundingBox _computedLightsBoundingBox;
+    int _computedLightsReceivingBitMask;
+
     /*
      Application-thread copies of the node's transform data. See the 'Application Thread
      Properties' pragma above for a more extensive description of why we need these fields.
@@ -996,6 +1218,13 @@ private:
      */
     bool _ignoreEventHandling;
 
+    /*
+     Animation LOD parameters; see setAnimationLODEnabled.
+     */
+    bool _animationLODEnabled;
+    float _animationLODScreenSize;
+    int _animationLODMaxUpdateInterval;
+
     /*
      Delegate through which events are notified from the VROEventManager.
      */
@@ -1069,6 +1298,14 @@ private:
      Notifies attached transform delegate, if any, that a position change had occurred.
      */
     void notifyTransformUpdate(bool forced);
+
+    /*
+     Invoked after batched animations write the position, scale, or a single
+     euler component of a node.
+     */
+    static void applyPosition(VROAnimatable *const animatable);
+    static void applyScale(VROAnimatable *const animatable);
+    static void applyRotationEulerComponent(VROAnimatable *const animatable);
     
     /*
      Recursively set the visibility of this node and all of its children to the 
@@ -1076,6 +1313,45 @@ private:
      */
     void setVisibilityRecursive(bool visible);
     
+    /*
+     Copy this node and its subtree, allocating the copies from the given arena,
+     or from the heap if the arena is null. The copies are linked to one another
+     directly, without notifying the scene graph, since they're not yet attached
+     to it.
+     */
+    std::shared_ptr<VRONode> cloneSubtree(const std::shared_ptr<VROFrameArena> &arena) const;
+    int getSubtreeSize() const;
+    
+    /*
+     Single-node steps of the recursive render cycle passes. These do not assert
+     the rendering thread, since they are also run from job system workers.
+     computeNodeTransform computes the transforms and umbrella bounds of this node
+     only; applyNodeConstraints applies this node's constraints and returns true if
+     its world transform was updated; computeNodeVisibility runs the frustum test
+     for this node's umbrella bounds. computeNodeCulling additionally applies the
+     node's recent occlusion result (via applyOcclusionResult) when occlusion
+     culling is enabled.
+     */
+    void computeNodeTransform(VROMatrix4f parentTransform, VROMatrix4f parentRotation);
+    void computeTransformsRecursive(VROMatrix4f parentTransform, VROMatrix4f parentRotation);
+    bool applyNodeConstraints(const VRORenderContext &context, VROMatrix4f parentTransform,
+                              bool parentUpdated);
+    
+    /*
+     Install or remove the shader modifier of the given constraint, if it has one, on
+     the materials of the given geometry. isConstraintAppliedInShader returns true if
+     the constraint is applied by that modifier for this node, in which case its
+     world transform is left unconstrained.
+     */
+    void setConstraintShaderModifier(std::shared_ptr<VROGeometry> geometry,
+                                     std::shared_ptr<VROConstraint> constraint, bool installed);
+    bool isConstraintAppliedInShader(const std::shared_ptr<VROConstraint> &constraint) const;
+    VROFrustumResult computeNodeVisibility(const VRORenderContext &context);
+    VROFrustumResult computeNodeCulling(const VRORenderContext &context);
+    VROFrustumResult applyOcclusionResult(VROFrustumResult result, const VRORenderContext &context);
+    void updateNodeParticles(const VRORenderContext &context);
+    void collectParticleEmitterNodes(std::vector<VRONode *> *outNodes);
+    
     /*
      Recursively expand the given bounding box by this node's _worldBoundingBox.
      */
@@ -1134,6 +1410,13 @@ private:
      */
     int _lightReceivingBitMask;
     int _shadowCastingBitMask;
+    
+    /*
+     Secondary views (VROSecondaryView) render this node only if the bitwise AND of
+     this mask and the view's mask is non-zero. The main view renders all nodes.
+     Defaults to 1.
+     */
+    int _viewBitMask;
 
     /*
      Physics rigid body that if defined, drives and sets the transformations of this node.
@@ -1151,6 +1434,17 @@ private:
      */
     bool _holdRendering;
     
+    /*
+     The level of detail of the geometry for the current frame, 0 being the geometry
+     itself.
+     */
+    int _lodLevel = 0;
+    
+    /*
+     The time offset at which this node plays its geometry's baked animation.
+     */
+    float _bakedAnimationTimeOffset = 0;
+    
     /*
      Task queus used for loading objects into this VRONode. We store these here in order
      to scope them to the lifetime of the node for which they are performing loading
@@ -38,16 +38,25 @@
 #include "tiny_obj_loader.h"
 #include "VROShapeUtils.h"
 #include "VROTaskQueue.h"
+#include "VROGeometryCache.h"
+#include "VROMeshOptimizer.h"
+#include "VROTangentGenerator.h"
+#include "VROOBJParser.h"
 #include "VROModelIOUtil.h"
 
+// Incremented whenever the processing of OBJ geometry changes, invalidating the
+// geometry previously stored in the geometry cache
+static const uint32_t kOBJGeometryCacheVersion = 2;
+
 void VROOBJLoader::loadOBJFromResource(std::string resource, VROResourceType type,
                                        std::shared_ptr<VRONode> node,
                                        std::shared_ptr<VRODriver> driver,
-                                       std::function<void(std::shared_ptr<VRONode>, bool)> onFinish) {
+                                       std::function<void(std::shared_ptr<VRONode>, bool)> onFinish,
+                                       bool optimizeGeometry) {
     VROModelIOUtil::retrieveResourceAsync(resource, type,
-          [resource, type, node, driver, onFinish](std::string path, bool isTemp) {
+          [resource, type, node, driver, onFinish, optimizeGeometry](std::string path, bool isTemp) {
               // onSuccess() (note: callbacks from retrieveResourceAsync occur on rendering thread)
-              readOBJFileAsync(resource, type, node, path, isTemp, false, {}, driver, onFinish);
+              readOBJFileAsync(resource, type, node, path, isTemp, false, {}, driver, onFinish, optimizeGeometry);
           },
           [node, onFinish]() {
               // onFailure()
@@ -59,11 +68,12 @@ void VROOBJLoader::loadOBJFromResources(std::string resource, VROResourceType ty
                                         std::shared_ptr<VRONode> node,
                                         std::map<std::string, std::string> resourceMap,
                                         std::shared_ptr<VRODriver> driver,
-                                        std::function<void(std::shared_ptr<VRONode>, bool)> onFinish) {
+                                        std::function<void(std::shared_ptr<VRONode>, bool)> onFinish,
+                                        bool optimizeGeometry) {
     VROModelIOUtil::retrieveResourceAsync(resource, type,
-          [resource, type, node, resourceMap, driver, onFinish](std::string path, bool isTemp) {
+          [resource, type, node, resourceMap, driver, onFinish, optimizeGeometry](std::string path, bool isTemp) {
               // onSuccess() (note: callbacks from retrieveResourceAsync occur on rendering thread)
-              readOBJFileAsync(resource, type, node, path, isTemp, true, resourceMap, driver, onFinish);
+              readOBJFileAsync(resource, type, node, path, isTemp, true, resourceMap, driver, onFinish, optimizeGeometry);
           },
           [node, onFinish]() {
               // onFailure()
@@ -75,14 +85,45 @@ void VROOBJLoader::readOBJFileAsync(std::string resource, VROResourceType type,
                                     std::string path, bool isTemp, bool loadingTexturesFromResourceMap,
                                     std::map<std::string, std::string> resourceMap,
                                     std::shared_ptr<VRODriver> driver,
-                                    std::function<void(std::shared_ptr<VRONode> node, bool success)> onFinish) {
-    VROPlatformDispatchAsyncBackground([resource, type, node, path, resourceMap, driver, onFinish, isTemp, loadingTexturesFromResourceMap] {
+                                    std::function<void(std::shared_ptr<VRONode> node, bool success)> onFinish,
+                                    bool optimizeGeometry) {
+    std::shared_ptr<VROGeometryCache> geometryCache = driver->getGeometryCache();
+    VROPlatformDispatchAsyncBackground([resource, type, node, path, resourceMap, driver, onFinish, isTemp, loadingTexturesFromResourceMap,
+                                        geometryCache, optimizeGeometry] {
         pinfo("Loading OBJ from file %s", path.c_str());
         std::string base = resource.substr(0, resource.find_last_of('/'));
 
-        std::shared_ptr<tinyobj::attrib_t> attrib = std::make_shared<tinyobj::attrib_t>();
-        std::shared_ptr<std::vector<tinyobj::shape_t>> shapes = std::make_shared<std::vector<tinyobj::shape_t>>();
-        std::shared_ptr<std::vector<tinyobj::material_t>> materials = std::make_shared<std::vector<tinyobj::material_t>>();
+        // The processed geometry of an OBJ depends only on the contents of the OBJ file,
+        // and whether it is optimized
+        uint64_t geometryCacheKey = 0;
+        if (geometryCache) {
+            uint64_t seed = VROGeometryCache::hash(&kOBJGeometryCacheVersion, sizeof(kOBJGeometryCacheVersion));
+            seed = VROGeometryCache::hash(&optimizeGeometry, sizeof(optimizeGeometry), seed);
+            geometryCacheKey = VROGeometryCache::hashFile(path, seed);
+        }
+
+        /*
+         If an earlier load stored the processed geometry of this OBJ, use it. The
+         OBJ is then only scanned for its material libraries.
+         */
+        std::shared_ptr<std::vector<VROCachedMesh>> cachedMeshes = std::make_shared<std::vector<VROCachedMesh>>();
+        bool cached = geometryCache && geometryCache->loadMeshes(geometryCacheKey, nullptr, cachedMeshes.get()) &&
+                      cachedMeshes->size() == 1;
+        
+        std::shared_ptr<VROOBJData> data = std::make_shared<VROOBJData>();
+        bool parsed = VROOBJParser::parse(path, !cached, data.get());
+        if (isTemp) {
+            VROPlatformDeleteFile(path);
+        }
+        if (!parsed) {
+            pinfo("Failed to load OBJ data");
+            VROPlatformDispatchAsyncRenderer([node, onFinish] {
+                if (onFinish) {
+                    onFinish(node, false);
+                }
+            });
+            return;
+        }
         
         /*
          If the ancillary resources (e.g. textures) required by the model are provided in a
@@ -99,82 +140,121 @@ void VROOBJLoader::readOBJFileAsync(std::string resource, VROResourceType type,
         std::shared_ptr<VROTaskQueue> objTaskQueue = std::make_shared<VROTaskQueue>(resource, VROTaskExecutionOrder::Serial);
         node->addTaskQueue(objTaskQueue);
         
-        std::string err;
+        // Queue the reading of the MTL libraries named by the OBJ on the task queue
+        tinyobj::MaterialFileReader materialReader;
+        if (loadingTexturesFromResourceMap) {
+            materialReader = tinyobj::MaterialFileReader(fileMap.get(), objTaskQueue);
+        } else {
+            materialReader = tinyobj::MaterialFileReader(base, type == VROResourceType::URL, objTaskQueue);
+        }
+        
+        std::shared_ptr<std::vector<tinyobj::material_t>> materials = std::make_shared<std::vector<tinyobj::material_t>>();
+        std::shared_ptr<std::map<std::string, int>> materialMap = std::make_shared<std::map<std::string, int>>();
+        std::shared_ptr<std::string> err = std::make_shared<std::string>();
+        for (const std::vector<std::string> &filenames : data->materialLibraries) {
+            tinyobj::LoadMTLFiles(materials, materialMap, err.get(), filenames, &materialReader);
+        }
+        
+        // Must use weak pointers for the node and task queues from here on, because the
+        // callbacks below are held by task queues, which are held by the node
         std::weak_ptr<VROTaskQueue> objTaskQueue_w = objTaskQueue;
         std::weak_ptr<VRONode> node_w = node;
         
-        tinyobj::LoadObj(attrib, shapes, materials, &err,
-                         path.c_str(),
-                         base.c_str(),
-                         type == VROResourceType::URL, // base is URL?
-                         loadingTexturesFromResourceMap ? fileMap.get() : nullptr,
-                         objTaskQueue,
-                         [err, node_w, attrib, shapes, materials, resource, type, loadingTexturesFromResourceMap,
-                          fileMap, objTaskQueue_w, driver, onFinish] (bool success) {
-                             if (!err.empty()) {
-                                 pinfo("OBJ loading warning [%s]", err.c_str());
-                             }
-
-                             // Must use a weak pointer for node here because this onFinished call
-                             // gets passed into tinyObj::LoadObj, which in turn passes it into a
-                             // taskQueue held by the node -- potential strong reference cycle
-                             std::shared_ptr<VRONode> node_s = node_w.lock();
-                             if (!node_s) {
-                                 return;
-                             }
-                             
-                             if (success) {
-                                 std::string base = resource.substr(0, resource.find_last_of('/'));
-
-                                 // This task queue is used for donwloading textures
-                                 std::shared_ptr<VROTaskQueue> taskQueue = std::make_shared<VROTaskQueue>(
-                                         "obj-normal", VROTaskExecutionOrder::Serial);
-                                 node_s->addTaskQueue(taskQueue);
-
-                                 std::shared_ptr<std::map<std::string, std::shared_ptr<VROTexture>>> textureCache = std::make_shared<std::map<std::string, std::shared_ptr<VROTexture>>>();
-                                 std::shared_ptr<VROGeometry> geo = processOBJ(*attrib, *shapes,
-                                                                               *materials, base,
-                                                                               loadingTexturesFromResourceMap
-                                                                               ? VROResourceType::LocalFile
-                                                                               : type,
-                                                                               loadingTexturesFromResourceMap
-                                                                               ? fileMap : nullptr,
-                                                                               textureCache,
-                                                                               taskQueue);
-
-                                 // Run all the async tasks. When they're complete, inject the finished FBX into the
-                                 // node
-                                 std::weak_ptr<VROTaskQueue> taskQueue_w = taskQueue;
-                                 taskQueue->processTasksAsync(
-                                         [geo, node_w, taskQueue_w, objTaskQueue_w, attrib, shapes, materials,
-                                          fileMap, textureCache, driver, onFinish] {
-                                             std::shared_ptr<VRONode> node_s2 = node_w.lock();
-                                             if (node_s2) {
-                                                 injectOBJ(geo, node_s2, driver, onFinish);
-
-                                                 std::shared_ptr<VROTaskQueue> taskQueue_s = taskQueue_w.lock();
-                                                 if (taskQueue_s) {
-                                                     node_s2->removeTaskQueue(taskQueue_s);
-                                                 }
-                                                 std::shared_ptr<VROTaskQueue> objTaskQueue_s = objTaskQueue_w.lock();
-                                                 if (objTaskQueue_s) {
-                                                     node_s2->removeTaskQueue(objTaskQueue_s);
-                                                 }
-                                             }
-                                         });
-                             } else {
-                                 pinfo("Failed to load OBJ data");
-
-                                 onFinish(node_s, false);
-                                 std::shared_ptr<VROTaskQueue> objTaskQueue_s = objTaskQueue_w.lock();
-                                 if (objTaskQueue_s) {
-                                     node_s->removeTaskQueue(objTaskQueue_s);
-                                 }
-                             }
-                         });
-        if (isTemp) {
-            VROPlatformDeleteFile(path);
-        }
+        // Wait for the MTL files to be read. We have to switch over to the rendering thread
+        // in order to wait on the task queue
+        VROPlatformDispatchAsyncRenderer([node_w, objTaskQueue_w, data, cachedMeshes, cached, materials, materialMap,
+                                          err, base, type, loadingTexturesFromResourceMap, fileMap, driver, onFinish,
+                                          geometryCache, geometryCacheKey, optimizeGeometry] {
+            std::shared_ptr<VROTaskQueue> objTaskQueue_s = objTaskQueue_w.lock();
+            if (!objTaskQueue_s) {
+                return;
+            }
+            objTaskQueue_s->processTasksAsync([node_w, objTaskQueue_w, data, cachedMeshes, cached, materials, materialMap,
+                                               err, base, type, loadingTexturesFromResourceMap, fileMap, driver, onFinish,
+                                               geometryCache, geometryCacheKey, optimizeGeometry] {
+                if (!err->empty()) {
+                    pinfo("OBJ loading warning [%s]", err->c_str());
+                }
+                
+                // The geometry only depends on the materials through their names, so it is
+                // built in the background, while the materials are built on the rendering thread
+                VROPlatformDispatchAsyncBackground([node_w, objTaskQueue_w, data, cachedMeshes, cached, materials,
+                                                    materialMap, base, type, loadingTexturesFromResourceMap, fileMap,
+                                                    driver, onFinish, geometryCache, geometryCacheKey, optimizeGeometry] {
+                    std::shared_ptr<std::vector<int>> elementMaterialIndices = std::make_shared<std::vector<int>>();
+                    std::shared_ptr<VROGeometry> geo;
+                    if (cached) {
+                        geo = processCachedOBJ(cachedMeshes->front(), elementMaterialIndices.get(), optimizeGeometry);
+                    } else {
+                        geo = processOBJ(*data, *materialMap, elementMaterialIndices.get(), geometryCache,
+                                         geometryCacheKey, optimizeGeometry);
+                    }
+                    
+                    VROPlatformDispatchAsyncRenderer([node_w, objTaskQueue_w, geo, elementMaterialIndices, materials,
+                                                      base, type, loadingTexturesFromResourceMap, fileMap, driver,
+                                                      onFinish] {
+                        std::shared_ptr<VRONode> node_s = node_w.lock();
+                        if (!node_s) {
+                            return;
+                        }
+                        
+                        // This task queue is used for donwloading textures
+                        std::shared_ptr<VROTaskQueue> taskQueue = std::make_shared<VROTaskQueue>(
+                                "obj-normal", VROTaskExecutionOrder::Concurrent);
+                        node_s->addTaskQueue(taskQueue);
+                        
+                        std::shared_ptr<std::map<std::string, std::shared_ptr<VROTexture>>> textureCache = std::make_shared<std::map<std::string, std::shared_ptr<VROTexture>>>();
+                        std::vector<std::shared_ptr<VROMaterial>> materialsIndexed = processOBJMaterials(*materials, base,
+                                                                                                         loadingTexturesFromResourceMap
+                                                                                                         ? VROResourceType::LocalFile
+                                                                                                         : type,
+                                                                                                         loadingTexturesFromResourceMap
+                                                                                                         ? fileMap : nullptr,
+                                                                                                         textureCache,
+                                                                                                         taskQueue);
+                        
+                        /*
+                         Create a default material. This material will be used for the elements
+                         created from faces that have no material specified, or whose material
+                         is missing from the MTL files.
+                         */
+                        std::shared_ptr<VROMaterial> defaultMaterial = std::make_shared<VROMaterial>();
+                        defaultMaterial->setName("OBJ Default");
+                        
+                        std::vector<std::shared_ptr<VROMaterial>> elementMaterials;
+                        for (int materialIndex : *elementMaterialIndices) {
+                            if (materialIndex >= 0 && materialIndex < materialsIndexed.size()) {
+                                elementMaterials.push_back(materialsIndexed[materialIndex]);
+                            }
+                            else {
+                                elementMaterials.push_back(defaultMaterial);
+                            }
+                        }
+                        geo->setMaterials(elementMaterials);
+                        
+                        // Run all the async tasks. When they're complete, inject the finished OBJ into the
+                        // node
+                        std::weak_ptr<VROTaskQueue> taskQueue_w = taskQueue;
+                        taskQueue->processTasksAsync(
+                                [geo, node_w, taskQueue_w, objTaskQueue_w, fileMap, textureCache, driver, onFinish] {
+                                    std::shared_ptr<VRONode> node_s2 = node_w.lock();
+                                    if (node_s2) {
+                                        injectOBJ(geo, node_s2, driver, onFinish);
+                                        
+                                        std::shared_ptr<VROTaskQueue> taskQueue_s = taskQueue_w.lock();
+                                        if (taskQueue_s) {
+                                            node_s2->removeTaskQueue(taskQueue_s);
+                                        }
+                                        std::shared_ptr<VROTaskQueue> objTaskQueue_s = objTaskQueue_w.lock();
+                                        if (objTaskQueue_s) {
+                                            node_s2->removeTaskQueue(objTaskQueue_s);
+                                        }
+                                    }
+                                });
+                    });
+                });
+            });
+        });
     });
 }
 
@@ -184,6 +264,7 @@ void VROOBJLoader::injectOBJ(std::shared_ptr<VROGeometry> geometry,
                              std::function<void(std::shared_ptr<VRONode> node, bool success)> onFinish) {
  
     if (geometry) {
+        VROModelIOUtil::deduplicateMaterials(geometry);
         node->setGeometry(geometry);
         
         // recompute the node's umbrellaBoundingBox and set the atomic rendering properties before
@@ -215,19 +296,13 @@ void VROOBJLoader::injectOBJ(std::shared_ptr<VROGeometry> geometry,
     }
 }
 
-std::shared_ptr<VROGeometry> VROOBJLoader::processOBJ(tinyobj::attrib_t &attrib,
-                                                      std::vector<tinyobj::shape_t> &shapes,
-                                                      std::vector<tinyobj::material_t> &materials,
-                                                      std::string base,
-                                                      VROResourceType type,
-                                                      std::shared_ptr<std::map<std::string, std::string>> resourceMap,
-                                                      std::shared_ptr<std::map<std::string, std::shared_ptr<VROTexture>>> textureCache,
-                                                      std::shared_ptr<VROTaskQueue> taskQueue) {
-    pinfo("OBJ # of vertices  = %d", (int)(attrib.vertices.size()) / 3);
-    pinfo("OBJ # of normals   = %d", (int)(attrib.normals.size()) / 3);
-    pinfo("OBJ # of texcoords = %d", (int)(attrib.texcoords.size()) / 2);
+std::vector<std::shared_ptr<VROMaterial>> VROOBJLoader::processOBJMaterials(std::vector<tinyobj::material_t> &materials,
+                                                                            std::string base,
+                                                                            VROResourceType type,
+                                                                            std::shared_ptr<std::map<std::string, std::string>> resourceMap,
+                                                                            std::shared_ptr<std::map<std::string, std::shared_ptr<VROTexture>>> textureCache,
+                                                                            std::shared_ptr<VROTaskQueue> taskQueue) {
     pinfo("OBJ # of materials = %d", (int)materials.size());
-    pinfo("OBJ # of shapes    = %d", (int)shapes.size());
     
     /*
      Load materials, if provided, creating a VROMaterial for each OBJ material.
@@ -371,148 +446,121 @@ std::shared_ptr<VROGeometry> VROOBJLoader::processOBJ(tinyobj::attrib_t &attrib,
 
         materialsIndexed.push_back(material);
     }
+    return materialsIndexed;
+}
+
+std::shared_ptr<VROGeometry> VROOBJLoader::processCachedOBJ(const VROCachedMesh &mesh,
+                                                            std::vector<int> *outElementMaterialIndices,
+                                                            bool optimizeGeometry) {
+    std::vector<std::shared_ptr<VROGeometrySource>> sources;
+    std::vector<std::shared_ptr<VROGeometryElement>> elements;
+    VROGeometryCache::instantiateMesh(mesh, sources, elements);
+    *outElementMaterialIndices = mesh.elementTags;
     
-    /*
-     Build a single interleaved vertex array. All geometry elements will point to this
-     array.
-     */
-    std::vector<float> &vertices = attrib.vertices;
-    std::vector<float> &texcoords = attrib.texcoords;
-    std::vector<float> &normals = attrib.normals;
+    std::shared_ptr<VROGeometry> geometry = std::make_shared<VROGeometry>(sources, elements);
+    if (optimizeGeometry) {
+        generateLODs(geometry);
+    }
+    return geometry;
+}
+
+std::shared_ptr<VROGeometry> VROOBJLoader::processOBJ(VROOBJData &data,
+                                                      const std::map<std::string, int> &materialMap,
+                                                      std::vector<int> *outElementMaterialIndices,
+                                                      std::shared_ptr<VROGeometryCache> geometryCache,
+                                                      uint64_t geometryCacheKey,
+                                                      bool optimizeGeometry) {
+    pinfo("OBJ # of vertices  = %d", data.numPositions);
+    pinfo("OBJ # of normals   = %d", data.numNormals);
+    pinfo("OBJ # of texcoords = %d", data.numTexcoords);
     
     /*
-     Create a default material. This material will be used for the elements created
-     from shapes that have no material specified. If there is no MTL file, then
-     this material will be set for all elements.
+     The parser emits a single interleaved vertex array of deduplicated vertices.
+     All geometry elements will point to this array.
      */
-    std::shared_ptr<VROMaterial> defaultMaterial = std::make_shared<VROMaterial>();
-    defaultMaterial->setName("OBJ Default");
-    
-    std::vector<std::shared_ptr<VROMaterial>> elementMaterials;
+    std::vector<std::shared_ptr<VROGeometrySource>> sources = VROShapeUtilBuildGeometrySources(data.vertices, data.numVertices);
     
     /*
-     Count the number of vertices in the OBJ.
+     Create one element for each material used by the faces of the OBJ.
      */
-    int numVertices = 0;
-    for (tinyobj::shape_t &shape : shapes) {
-        tinyobj::mesh_t &mesh = shape.mesh;
-        
-        for (int f = 0; f < mesh.num_face_vertices.size(); f++) {
-            numVertices += mesh.num_face_vertices[f];
-        }
-    }
-    
-    int stride = sizeof(VROShapeVertexLayout);
-    int varSizeBytes = numVertices * stride;
-    
-    // Will be moved to VROData so does not need to be explicitly freed!
-    VROShapeVertexLayout *var = (VROShapeVertexLayout *) malloc(varSizeBytes);
-    VROVector3f *tangents = VROShapeUtilStartTangents(var, numVertices);
-
     std::vector<std::shared_ptr<VROGeometryElement>> elements;
-
-    int currentVertex = 0;
-    int currentIndex = 0;
-    for (tinyobj::shape_t &shape : shapes) {
-        tinyobj::mesh_t &mesh = shape.mesh;
+    std::vector<int> allIndices;
+    for (int i = 0; i < data.indices.size(); i++) {
+        std::vector<int> &indices = data.indices[i];
         
-        /*
-         Write all the indices of this mesh into the VAR layout.
-         */
-        for (int i = 0; i < mesh.indices.size(); i++) {
-            tinyobj::index_t &index = mesh.indices[i];
-            
-            VROShapeVertexLayout &v = var[currentVertex];
-            
-            v.x = vertices[index.vertex_index * 3 + 0];
-            v.y = vertices[index.vertex_index * 3 + 1];
-            v.z = vertices[index.vertex_index * 3 + 2];
-            
-            if (index.texcoord_index >= 0) {
-                v.u = texcoords[index.texcoord_index * 2 + 0];
-                v.v = 1 - texcoords[index.texcoord_index * 2 + 1];
-            }
-            else {
-                v.u = 0;
-                v.v = 0;
-            }
-            
-            if (index.normal_index >= 0) {
-                v.nx = normals[index.normal_index * 3 + 0];
-                v.ny = normals[index.normal_index * 3 + 1];
-                v.nz = normals[index.normal_index * 3 + 2];
-            }
-            else {
-                v.nx = 0;
-                v.ny = 0;
-                v.nz = 0;
-            }
-            
-            ++currentVertex;
+        VROGeometryPrimitiveType primitive = VROGeometryPrimitiveType::Triangle;
+        int indexCount = (int) indices.size();
+        int bytesPerIndex = sizeof(int);
+        int primitiveCount = VROGeometryUtilGetPrimitiveCount(indexCount, primitive);
+        std::shared_ptr<VROData> indexData = std::make_shared<VROData>(indices.data(), indexCount * bytesPerIndex);
+        
+        std::shared_ptr<VROGeometryElement> element = std::make_shared<VROGeometryElement>(indexData,
+                                                                                           primitive,
+                                                                                           primitiveCount,
+                                                                                           bytesPerIndex);
+        elements.push_back(element);
+        if (data.indices.size() > 1) {
+            allIndices.insert(allIndices.end(), indices.begin(), indices.end());
         }
-
+        
         /*
-         Create one element for each material used by this shape.
-         Maps from material index to indices using said material.
+         Material index -1 corresponds to no MTL file, or no material (or an unknown
+         material) set for the faces. In this case the default material is used.
          */
-        std::map<int, std::vector<int>> indicesByMaterial;
-        
-        for (int f = 0; f < mesh.num_face_vertices.size(); f++) {
-            int numFaceVertices = mesh.num_face_vertices[f];
-            if (numFaceVertices != 3) {
-                pinfo("Non-triangular OBJ files not supported!");
-                return {};
-            }
-            
-            std::vector<int> &indices = indicesByMaterial[mesh.material_ids[f]];
-            for (int c = 0; c < numFaceVertices; c++) {
-                indices.push_back(currentIndex++);
+        auto it = materialMap.find(data.materialNames[i]);
+        outElementMaterialIndices->push_back(it != materialMap.end() ? it->second : -1);
+    }
+    
+    /*
+     Generate the tangents directly into the interleaved array. Vertices may be
+     shared by elements, so the tangents are generated over the triangles of all
+     elements at once.
+     */
+    if (!elements.empty()) {
+        VROTangentJob tangentJob;
+        for (std::shared_ptr<VROGeometrySource> &source : sources) {
+            if (source->getSemantic() == VROGeometrySourceSemantic::Vertex) {
+                tangentJob.positions = source;
+            } else if (source->getSemantic() == VROGeometrySourceSemantic::Normal) {
+                tangentJob.normals = source;
+            } else if (source->getSemantic() == VROGeometrySourceSemantic::Texcoord) {
+                tangentJob.texcoords = source;
+            } else if (source->getSemantic() == VROGeometrySourceSemantic::Tangent) {
+                tangentJob.tangentOffset = source->getDataOffset();
+                tangentJob.tangentStride = source->getDataStride();
             }
         }
-        
-        for (auto &kv : indicesByMaterial) {
-            std::vector<int> &indices = kv.second;
-            
-            VROGeometryPrimitiveType primitive = VROGeometryPrimitiveType::Triangle;
-            int indexCount = (int) indices.size();
-            int bytesPerIndex = sizeof(int);
-            int primitiveCount = VROGeometryUtilGetPrimitiveCount(indexCount, primitive);
-            std::shared_ptr<VROData> data = std::make_shared<VROData>(indices.data(), indexCount * bytesPerIndex);
-            
-            std::shared_ptr<VROGeometryElement> element = std::make_shared<VROGeometryElement>(data,
-                                                                                               primitive,
-                                                                                               primitiveCount,
-                                                                                               bytesPerIndex);
-            elements.push_back(element);
-            
-            /*
-             Material index -1 corresponds to no MTL file, or no material set for the
-             group of faces. In this case we set the default material.
-             */
-            int materialIndex = kv.first;
-            if (materialIndex >= 0) {
-                elementMaterials.push_back(materialsIndexed[kv.first]);
-            }
-            else {
-                elementMaterials.push_back(defaultMaterial);
-            }
-            
-            VROShapeUtilComputeTangentsForIndices(var, numVertices, indices.data(), indexCount, tangents);
+        if (elements.size() == 1) {
+            tangentJob.element = elements.front();
+        } else {
+            std::shared_ptr<VROData> indexData = std::make_shared<VROData>(allIndices.data(), (int) allIndices.size() * sizeof(int));
+            tangentJob.element = std::make_shared<VROGeometryElement>(indexData, VROGeometryPrimitiveType::Triangle,
+                                                                      (int) allIndices.size() / 3, sizeof(int));
         }
+        tangentJob.tangents = data.vertices;
+        VROTangentGenerator::generate({ tangentJob });
     }
-    VROShapeUtilEndTangents(var, numVertices, tangents);    
     
     /*
-     Now turn the interleaved array into three sources.
+     The parser already shares vertices between triangles; optimizing reorders
+     the triangles and vertices for the GPU's caches.
      */
-    passert (numVertices == currentVertex);
-    passert (numVertices == currentIndex);
-    
-    std::shared_ptr<VROData> data = std::make_shared<VROData>((void *) var, sizeof(VROShapeVertexLayout) * numVertices, VRODataOwnership::Move);
-    std::vector<std::shared_ptr<VROGeometrySource>> sources = VROShapeUtilBuildGeometrySources(data, numVertices);
+    if (optimizeGeometry && !elements.empty()) {
+        VROMeshOptimizer::optimize(sources, elements, true);
+    }
     
     std::shared_ptr<VROGeometry> geometry = std::make_shared<VROGeometry>(sources, elements);
-    geometry->setMaterials(elementMaterials);
+    if (optimizeGeometry) {
+        generateLODs(geometry);
+    }
+    
+    if (geometryCache) {
+        VROCachedMesh mesh;
+        mesh.sources = sources;
+        mesh.elements = elements;
+        mesh.elementTags = *outElementMaterialIndices;
+        geometryCache->storeMeshes(geometryCacheKey, { mesh });
+    }
     
     VROBoundingBox bounds = geometry->getBoundingBox();
     pinfo("OBJ bounding box    =  x(%f %f) y(%f %f) z(%f %f)",
@@ -522,3 +570,12 @@ std::shared_ptr<VROGeometry> VROOBJLoader::processOBJ(tinyobj::attrib_t &attrib,
     
     return geometry;
 }
+
+void VROOBJLoader::generateLODs(std::shared_ptr<VROGeometry> geometry) {
+    std::vector<VROGeometryLOD> lods;
+    for (VROMeshLOD &lod : VROMeshOptimizer::generateLODs(geometry->getGeometrySources(),
+                                                          geometry->getGeometryElements(), true)) {
+        lods.push_back({ std::make_shared<VROGeometry>(lod.sources, lod.elements), lod.screenCoverage });
+    }
+    geometry->setLODs(lods);
+}
@@ -39,8 +39,12 @@
 
 class VRONode;
 class VROTexture;
+class VROMaterial;
 class VROGeometry;
 class VROTaskQueue;
+class VROGeometryCache;
+struct VROCachedMesh;
+struct VROOBJData;
 enum class VROResourceType;
 
 class VROOBJLoader {
@@ -53,16 +57,23 @@ public:
      
      The OBJ is loaded in the background. Afterward, the geometry is injected
      into the node on the main (rendering) thread, and the given callback is invoked.
+     
+     If optimizeGeometry is true, the vertices of the OBJ are welded and its
+     triangles and vertices are reordered for the GPU (see VROMeshOptimizer).
+     The optimized geometry is what is stored in the geometry cache. High-poly
+     OBJs also get simplified levels of detail.
      */
     static void loadOBJFromResource(std::string resource, VROResourceType type,
                                     std::shared_ptr<VRONode> destination,
                                     std::shared_ptr<VRODriver> driver,
-                                    std::function<void(std::shared_ptr<VRONode> node, bool success)> onFinish = nullptr);
+                                    std::function<void(std::shared_ptr<VRONode> node, bool success)> onFinish = nullptr,
+                                    bool optimizeGeometry = true);
     static void loadOBJFromResources(std::string resource, VROResourceType type,
                                      std::shared_ptr<VRONode> destination,
                                      std::map<std::string, std::string> resourceMap,
                                      std::shared_ptr<VRODriver> driver,
-                                     std::function<void(std::shared_ptr<VRONode> node, bool success)> onFinish = nullptr);
+                                     std::function<void(std::shared_ptr<VRONode> node, bool success)> onFinish = nullptr,
+                                     bool optimizeGeometry = true);
 
 private:
     
@@ -74,16 +85,45 @@ private:
                                  std::string path, bool isTemp, bool loadingTexturesFromResourceMap,
                                  std::map<std::string, std::string> resourceMap,
                                  std::shared_ptr<VRODriver> driver,
-                                 std::function<void(std::shared_ptr<VRONode> node, bool success)> onFinish);
+                                 std::function<void(std::shared_ptr<VRONode> node, bool success)> onFinish,
+                                 bool optimizeGeometry);
 
-    static std::shared_ptr<VROGeometry> processOBJ(tinyobj::attrib_t &attrib,
-                                                   std::vector<tinyobj::shape_t> &shapes,
-                                                   std::vector<tinyobj::material_t> &materials,
-                                                   std::string base,
-                                                   VROResourceType type,
-                                                   std::shared_ptr<std::map<std::string, std::string>> resourceMap,
-                                                   std::shared_ptr<std::map<std::string, std::shared_ptr<VROTexture>>> textureCache,
-                                                   std::shared_ptr<VROTaskQueue> taskQueue);
+    /*
+     Build the geometry of the given parsed OBJ, with one element for each material
+     its faces use. The index of each element's material in the given material map
+     (or -1 if it has none) is written to outElementMaterialIndices. Invoked on a
+     background thread.
+     */
+    static std::shared_ptr<VROGeometry> processOBJ(VROOBJData &data,
+                                                   const std::map<std::string, int> &materialMap,
+                                                   std::vector<int> *outElementMaterialIndices,
+                                                   std::shared_ptr<VROGeometryCache> geometryCache,
+                                                   uint64_t geometryCacheKey,
+                                                   bool optimizeGeometry);
+    
+    /*
+     Build the geometry of an OBJ from the mesh an earlier load stored in the geometry
+     cache, whose elements are tagged with the indices of their materials.
+     */
+    static std::shared_ptr<VROGeometry> processCachedOBJ(const VROCachedMesh &mesh,
+                                                         std::vector<int> *outElementMaterialIndices,
+                                                         bool optimizeGeometry);
+    
+    /*
+     Create a VROMaterial for each OBJ material, adding the loading of their textures
+     to the given task queue. Invoked on the rendering thread.
+     */
+    static std::vector<std::shared_ptr<VROMaterial>> processOBJMaterials(std::vector<tinyobj::material_t> &materials,
+                                                                         std::string base,
+                                                                         VROResourceType type,
+                                                                         std::shared_ptr<std::map<std::string, std::string>> resourceMap,
+                                                                         std::shared_ptr<std::map<std::string, std::shared_ptr<VROTexture>>> textureCache,
+                                                                         std::shared_ptr<VROTaskQueue> taskQueue);
+    
+    /*
+     Give the geometry levels of detail, if it is detailed enough to need them.
+     */
+    static void generateLODs(std::shared_ptr<VROGeometry> geometry);
 };
 
 #endif /* VROOBJLoader_h */
@@ -0,0 +1,624 @@
+//
+//  VROOBJParser.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include "VROOBJParser.h"
+#include "VROJobSystem.h"
+#include "VROData.h"
+#include "VROShapeUtils.h"
+#include "VROLog.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <string.h>
+
+// Files are split into at most this many chunks per parsing thread, each of at
+// least kMinOBJChunkBytes, so that small files are parsed inline
+static const int kOBJChunksPerThread = 4;
+static const size_t kMinOBJChunkBytes = 256 * 1024;
+
+// Vertices are written to the interleaved array in batches of this many
+static const int kOBJVertexBatch = 16384;
+
+// Powers of ten that are exactly representable as doubles
+static const double kOBJPowersOfTen[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+enum class VROOBJStatement {
+    Position,
+    Texcoord,
+    Normal,
+    Face,
+    UseMaterial,
+    MaterialLibrary,
+    Other
+};
+
+/*
+ A sequence of triangles in a chunk that use the same material, stored as the
+ (position, texcoord, normal) index triple of each corner, with -1 for missing
+ attributes. The first run of a chunk continues the material in effect at the
+ end of the previous chunk.
+ */
+struct VROOBJRun {
+    bool inheritsMaterial;
+    std::string material;
+    std::vector<int> corners;
+};
+
+struct VROOBJChunk {
+    const char *begin;
+    const char *end;
+    
+    // The attributes and material libraries declared in the chunk (first pass)
+    int numPositions = 0;
+    int numTexcoords = 0;
+    int numNormals = 0;
+    std::vector<std::vector<std::string>> materialLibraries;
+    
+    // The index in the file of the chunk's first attribute of each kind
+    int firstPosition = 0;
+    int firstTexcoord = 0;
+    int firstNormal = 0;
+    
+    // The faces of the chunk (second pass)
+    std::vector<VROOBJRun> runs;
+};
+
+#pragma mark - Tokenizing
+
+static inline bool VROOBJIsSpace(char c) {
+    return c == ' ' || c == '\t';
+}
+
+static inline bool VROOBJIsDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static inline const char *VROOBJSkipSpace(const char *p, const char *end) {
+    while (p < end && VROOBJIsSpace(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+/*
+ Return the start of the line following the line at p, and write the end of
+ the line at p, excluding its line break, to outLineEnd.
+ */
+static inline const char *VROOBJNextLine(const char *p, const char *end, const char **outLineEnd) {
+    const char *lineEnd = (const char *) memchr(p, '\n', end - p);
+    const char *next = lineEnd ? lineEnd + 1 : end;
+    if (!lineEnd) {
+        lineEnd = end;
+    }
+    if (lineEnd > p && *(lineEnd - 1) == '\r') {
+        --lineEnd;
+    }
+    *outLineEnd = lineEnd;
+    return next;
+}
+
+static inline bool VROOBJHasKeyword(const char *p, const char *end, const char *keyword, int length) {
+    return end - p > length && memcmp(p, keyword, length) == 0 && VROOBJIsSpace(p[length]);
+}
+
+/*
+ Identify the statement beginning at p, and advance p past its keyword.
+ */
+static VROOBJStatement VROOBJReadStatement(const char *&p, const char *end) {
+    if (p >= end) {
+        return VROOBJStatement::Other;
+    }
+    if (p[0] == 'v') {
+        if (VROOBJHasKeyword(p, end, "v", 1)) {
+            p += 2;
+            return VROOBJStatement::Position;
+        }
+        if (VROOBJHasKeyword(p, end, "vt", 2)) {
+            p += 3;
+            return VROOBJStatement::Texcoord;
+        }
+        if (VROOBJHasKeyword(p, end, "vn", 2)) {
+            p += 3;
+            return VROOBJStatement::Normal;
+        }
+    }
+    else if (p[0] == 'f') {
+        if (VROOBJHasKeyword(p, end, "f", 1)) {
+            p += 2;
+            return VROOBJStatement::Face;
+        }
+    }
+    else if (VROOBJHasKeyword(p, end, "usemtl", 6)) {
+        p += 7;
+        return VROOBJStatement::UseMaterial;
+    }
+    else if (VROOBJHasKeyword(p, end, "mtllib", 6)) {
+        p += 7;
+        return VROOBJStatement::MaterialLibrary;
+    }
+    return VROOBJStatement::Other;
+}
+
+/*
+ Parse the next whitespace-delimited token, returning false at the end of the
+ line.
+ */
+static bool VROOBJParseToken(const char *&p, const char *end, std::string *outToken) {
+    p = VROOBJSkipSpace(p, end);
+    const char *begin = p;
+    while (p < end && !VROOBJIsSpace(*p)) {
+        ++p;
+    }
+    if (p == begin) {
+        return false;
+    }
+    outToken->assign(begin, p - begin);
+    return true;
+}
+
+/*
+ Parse a decimal floating point number, never reading past end. Returns zero
+ (without advancing past the token) if there is no number at p.
+ */
+static float VROOBJParseFloat(const char *&p, const char *end) {
+    p = VROOBJSkipSpace(p, end);
+    
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        ++p;
+    }
+    
+    // Significant digits beyond what an int64 can hold only shift the exponent
+    int64_t mantissa = 0;
+    int significantDigits = 0;
+    int exponent = 0;
+    while (p < end && VROOBJIsDigit(*p)) {
+        if (significantDigits < 18) {
+            mantissa = mantissa * 10 + (*p - '0');
+            significantDigits += (mantissa != 0);
+        }
+        else {
+            ++exponent;
+        }
+        ++p;
+    }
+    if (p < end && *p == '.') {
+        ++p;
+        while (p < end && VROOBJIsDigit(*p)) {
+            if (significantDigits < 18) {
+                mantissa = mantissa * 10 + (*p - '0');
+                significantDigits += (mantissa != 0);
+                --exponent;
+            }
+            ++p;
+        }
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        ++p;
+        bool negativeExponent = false;
+        if (p < end && (*p == '-' || *p == '+')) {
+            negativeExponent = (*p == '-');
+            ++p;
+        }
+        int explicitExponent = 0;
+        while (p < end && VROOBJIsDigit(*p)) {
+            explicitExponent = std::min(explicitExponent * 10 + (*p - '0'), 1000);
+            ++p;
+        }
+        exponent += negativeExponent ? -explicitExponent : explicitExponent;
+    }
+    
+    double value = (double) mantissa;
+    if (exponent < 0) {
+        value = exponent >= -22 ? value / kOBJPowersOfTen[-exponent] : value * pow(10.0, exponent);
+    }
+    else if (exponent > 0) {
+        value = exponent <= 22 ? value * kOBJPowersOfTen[exponent] : value * pow(10.0, exponent);
+    }
+    return (float) (negative ? -value : value);
+}
+
+static bool VROOBJParseInt(const char *&p, const char *end, int *outValue) {
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        ++p;
+    }
+    if (p >= end || !VROOBJIsDigit(*p)) {
+        return false;
+    }
+    int value = 0;
+    while (p < end && VROOBJIsDigit(*p)) {
+        value = value * 10 + (*p - '0');
+        ++p;
+    }
+    *outValue = negative ? -value : value;
+    return true;
+}
+
+/*
+ Convert a one-based (or, if negative, relative) OBJ index into a zero-based
+ index, given the number of attributes declared before it. Returns -1 if the
+ index is absent.
+ */
+static inline int VROOBJResolveIndex(int index, int count) {
+    if (index > 0) {
+        return index - 1;
+    }
+    else if (index < 0) {
+        return count + index;
+    }
+    else {
+        return -1;
+    }
+}
+
+/*
+ Parse a face corner of the form v, v/vt, v//vn, or v/vt/vn, writing its
+ resolved index triple to outCorner.
+ */
+static bool VROOBJParseCorner(const char *&p, const char *end, int numPositions, int numTexcoords, int numNormals,
+                              int *outCorner) {
+    int position = 0, texcoord = 0, normal = 0;
+    if (!VROOBJParseInt(p, end, &position)) {
+        return false;
+    }
+    if (p < end && *p == '/') {
+        ++p;
+        if (p < end && *p == '/') {
+            ++p;
+            VROOBJParseInt(p, end, &normal);
+        }
+        else {
+            VROOBJParseInt(p, end, &texcoord);
+            if (p < end && *p == '/') {
+                ++p;
+                VROOBJParseInt(p, end, &normal);
+            }
+        }
+    }
+    while (p < end && !VROOBJIsSpace(*p)) {
+        ++p;
+    }
+    
+    outCorner[0] = VROOBJResolveIndex(position, numPositions);
+    outCorner[1] = VROOBJResolveIndex(texcoord, numTexcoords);
+    outCorner[2] = VROOBJResolveIndex(normal, numNormals);
+    return true;
+}
+
+#pragma mark - Passes
+
+/*
+ First pass: count the attributes of the chunk and read its material libraries.
+ */
+static void VROOBJScanChunk(VROOBJChunk &chunk) {
+    const char *p = chunk.begin;
+    while (p < chunk.end) {
+        const char *lineEnd;
+        const char *next = VROOBJNextLine(p, chunk.end, &lineEnd);
+        p = VROOBJSkipSpace(p, lineEnd);
+        
+        switch (VROOBJReadStatement(p, lineEnd)) {
+            case VROOBJStatement::Position:
+                ++chunk.numPositions;
+                break;
+            case VROOBJStatement::Texcoord:
+                ++chunk.numTexcoords;
+                break;
+            case VROOBJStatement::Normal:
+                ++chunk.numNormals;
+                break;
+            case VROOBJStatement::MaterialLibrary: {
+                std::vector<std::string> filenames;
+                std::string filename;
+                while (VROOBJParseToken(p, lineEnd, &filename)) {
+                    filenames.push_back(filename);
+                }
+                chunk.materialLibraries.push_back(filenames);
+                break;
+            }
+            default:
+                break;
+        }
+        p = next;
+    }
+}
+
+/*
+ Second pass: parse the attributes of the chunk into place in the file's
+ attribute arrays, and triangulate its faces into runs.
+ */
+static void VROOBJParseChunk(VROOBJChunk &chunk, float *positions, float *texcoords, float *normals) {
+    int numPositions = chunk.firstPosition;
+    int numTexcoords = chunk.firstTexcoord;
+    int numNormals = chunk.firstNormal;
+    VROOBJRun *run = nullptr;
+    
+    const char *p = chunk.begin;
+    while (p < chunk.end) {
+        const char *lineEnd;
+        const char *next = VROOBJNextLine(p, chunk.end, &lineEnd);
+        p = VROOBJSkipSpace(p, lineEnd);
+        
+        switch (VROOBJReadStatement(p, lineEnd)) {
+            case VROOBJStatement::Position: {
+                float *position = positions + (size_t) numPositions * 3;
+                position[0] = VROOBJParseFloat(p, lineEnd);
+                position[1] = VROOBJParseFloat(p, lineEnd);
+                position[2] = VROOBJParseFloat(p, lineEnd);
+                ++numPositions;
+                break;
+            }
+            case VROOBJStatement::Texcoord: {
+                float *texcoord = texcoords + (size_t) numTexcoords * 2;
+                texcoord[0] = VROOBJParseFloat(p, lineEnd);
+                texcoord[1] = VROOBJParseFloat(p, lineEnd);
+                ++numTexcoords;
+                break;
+            }
+            case VROOBJStatement::Normal: {
+                float *normal = normals + (size_t) numNormals * 3;
+                normal[0] = VROOBJParseFloat(p, lineEnd);
+                normal[1] = VROOBJParseFloat(p, lineEnd);
+                normal[2] = VROOBJParseFloat(p, lineEnd);
+                ++numNormals;
+                break;
+            }
+            case VROOBJStatement::UseMaterial: {
+                std::string material;
+                VROOBJParseToken(p, lineEnd, &material);
+                chunk.runs.push_back({ false, material, {} });
+                run = &chunk.runs.back();
+                break;
+            }
+            case VROOBJStatement::Face: {
+                if (!run) {
+                    chunk.runs.push_back({ true, "", {} });
+                    run = &chunk.runs.back();
+                }
+                
+                // Triangulate the polygon as a fan around its first corner
+                int first[3], previous[3], corner[3];
+                int numCorners = 0;
+                while (true) {
+                    p = VROOBJSkipSpace(p, lineEnd);
+                    if (p >= lineEnd ||
+                        !VROOBJParseCorner(p, lineEnd, numPositions, numTexcoords, numNormals, corner)) {
+                        break;
+                    }
+                    if (numCorners == 0) {
+                        memcpy(first, corner, sizeof(corner));
+                    }
+                    else if (numCorners >= 2) {
+                        run->corners.insert(run->corners.end(), first, first + 3);
+                        run->corners.insert(run->corners.end(), previous, previous + 3);
+                        run->corners.insert(run->corners.end(), corner, corner + 3);
+                    }
+                    memcpy(previous, corner, sizeof(corner));
+                    ++numCorners;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+        p = next;
+    }
+}
+
+#pragma mark - Parsing
+
+bool VROOBJParser::parse(std::string path, bool parseGeometry, VROOBJData *outData) {
+    std::shared_ptr<VROData> file = VROData::mapFile(path);
+    if (!file) {
+        pinfo("Failed to open file %s for OBJ", path.c_str());
+        return false;
+    }
+    
+    std::shared_ptr<VROJobSystem> pool = VROJobSystem::getShared();
+    const char *fileBegin = (const char *) file->getData();
+    const char *fileEnd = fileBegin + file->getDataLength();
+    size_t length = file->getDataLength();
+    
+    /*
+     Split the file into chunks of whole lines.
+     */
+    int numChunks = (int) std::max((size_t) 1, std::min((size_t) (pool->getConcurrency() * kOBJChunksPerThread),
+                                                        length / kMinOBJChunkBytes));
+    std::vector<VROOBJChunk> chunks;
+    const char *begin = fileBegin;
+    for (int i = 0; i < numChunks && begin < fileEnd; i++) {
+        const char *end = std::max(begin, fileBegin + (length * (i + 1)) / numChunks);
+        const char *newline = (const char *) memchr(end, '\n', fileEnd - end);
+        end = newline ? newline + 1 : fileEnd;
+        
+        VROOBJChunk chunk;
+        chunk.begin = begin;
+        chunk.end = end;
+        chunks.push_back(chunk);
+        begin = end;
+    }
+    
+    pool->parallelFor(0, (int) chunks.size(), 1, [&chunks](int i) {
+        VROOBJScanChunk(chunks[i]);
+    });
+    
+    int numPositions = 0, numTexcoords = 0, numNormals = 0;
+    for (VROOBJChunk &chunk : chunks) {
+        chunk.firstPosition = numPositions;
+        chunk.firstTexcoord = numTexcoords;
+        chunk.firstNormal = numNormals;
+        numPositions += chunk.numPositions;
+        numTexcoords += chunk.numTexcoords;
+        numNormals += chunk.numNormals;
+        
+        outData->materialLibraries.insert(outData->materialLibraries.end(),
+                                          chunk.materialLibraries.begin(), chunk.materialLibraries.end());
+    }
+    outData->numPositions = numPositions;
+    outData->numTexcoords = numTexcoords;
+    outData->numNormals = numNormals;
+    
+    if (!parseGeometry) {
+        return true;
+    }
+    
+    std::vector<float> positions((size_t) numPositions * 3);
+    std::vector<float> texcoords((size_t) numTexcoords * 2);
+    std::vector<float> normals((size_t) numNormals * 3);
+    pool->parallelFor(0, (int) chunks.size(), 1, [&chunks, &positions, &texcoords, &normals](int i) {
+        VROOBJParseChunk(chunks[i], positions.data(), texcoords.data(), normals.data());
+    });
+    
+    /*
+     Deduplicate the corners of the triangles, in file order so that vertex
+     numbering follows the file. Each position heads a chain of the vertices
+     that use it, which is searched for a matching texcoord and normal.
+     */
+    std::vector<int> firstVertexOfPosition(numPositions, -1);
+    std::vector<int> nextVertexOfPosition;
+    std::vector<int> vertexCorners;
+    std::map<std::string, int> materialElements;
+    std::string material;
+    int numInvalidTriangles = 0;
+    
+    for (VROOBJChunk &chunk : chunks) {
+        for (VROOBJRun &run : chunk.runs) {
+            if (!run.inheritsMaterial) {
+                material = run.material;
+            }
+            if (run.corners.empty()) {
+                continue;
+            }
+            
+            auto it = materialElements.find(material);
+            if (it == materialElements.end()) {
+                it = materialElements.insert({ material, (int) outData->indices.size() }).first;
+                outData->materialNames.push_back(material);
+                outData->indices.emplace_back();
+            }
+            std::vector<int> &indices = outData->indices[it->second];
+            
+            for (size_t t = 0; t + 9 <= run.corners.size(); t += 9) {
+                int *triangle = &run.corners[t];
+                if (triangle[0] < 0 || triangle[0] >= numPositions ||
+                    triangle[3] < 0 || triangle[3] >= numPositions ||
+                    triangle[6] < 0 || triangle[6] >= numPositions) {
+                    ++numInvalidTriangles;
+                    continue;
+                }
+                
+                for (int c = 0; c < 3; c++) {
+                    int position = triangle[c * 3 + 0];
+                    int texcoord = triangle[c * 3 + 1];
+                    int normal = triangle[c * 3 + 2];
+                    if (texcoord < 0 || texcoord >= numTexcoords) {
+                        texcoord = -1;
+                    }
+                    if (normal < 0 || normal >= numNormals) {
+                        normal = -1;
+                    }
+                    
+                    int vertex = firstVertexOfPosition[position];
+                    while (vertex >= 0 && (vertexCorners[vertex * 3 + 1] != texcoord ||
+                                           vertexCorners[vertex * 3 + 2] != normal)) {
+                        vertex = nextVertexOfPosition[vertex];
+                    }
+                    if (vertex < 0) {
+                        vertex = (int) nextVertexOfPosition.size();
+                        vertexCorners.push_back(position);
+                        vertexCorners.push_back(texcoord);
+                        vertexCorners.push_back(normal);
+                        nextVertexOfPosition.push_back(firstVertexOfPosition[position]);
+                        firstVertexOfPosition[position] = vertex;
+                    }
+                    indices.push_back(vertex);
+                }
+            }
+            std::vector<int>().swap(run.corners);
+        }
+    }
+    if (numInvalidTriangles > 0) {
+        pwarn("Skipped %d OBJ triangles with invalid vertex indices", numInvalidTriangles);
+    }
+    
+    /*
+     Write the interleaved vertex array.
+     */
+    int numVertices = (int) nextVertexOfPosition.size();
+    
+    // Will be moved to VROData so does not need to be explicitly freed!
+    VROShapeVertexLayout *var = (VROShapeVertexLayout *) malloc(std::max(1, numVertices) * sizeof(VROShapeVertexLayout));
+    
+    int numBatches = (numVertices + kOBJVertexBatch - 1) / kOBJVertexBatch;
+    pool->parallelFor(0, numBatches, 1, [var, numVertices, &vertexCorners, &positions, &texcoords, &normals](int b) {
+        int last = std::min(numVertices, (b + 1) * kOBJVertexBatch);
+        for (int i = b * kOBJVertexBatch; i < last; i++) {
+            VROShapeVertexLayout &v = var[i];
+            int position = vertexCorners[i * 3 + 0];
+            int texcoord = vertexCorners[i * 3 + 1];
+            int normal = vertexCorners[i * 3 + 2];
+            
+            v.x = positions[position * 3 + 0];
+            v.y = positions[position * 3 + 1];
+            v.z = positions[position * 3 + 2];
+            
+            if (texcoord >= 0) {
+                v.u = texcoords[texcoord * 2 + 0];
+                v.v = 1 - texcoords[texcoord * 2 + 1];
+            }
+            else {
+                v.u = 0;
+                v.v = 0;
+            }
+            
+            if (normal >= 0) {
+                v.nx = normals[normal * 3 + 0];
+                v.ny = normals[normal * 3 + 1];
+                v.nz = normals[normal * 3 + 2];
+            }
+            else {
+                v.nx = 0;
+                v.ny = 0;
+                v.nz = 0;
+            }
+            
+            v.tx = 0;
+            v.ty = 0;
+            v.tz = 0;
+            v.tw = 0;
+        }
+    });
+    
+    outData->vertices = std::make_shared<VROData>((void *) var, sizeof(VROShapeVertexLayout) * numVertices, VRODataOwnership::Move);
+    outData->numVertices = numVertices;
+    return true;
+}
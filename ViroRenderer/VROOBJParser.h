@@ -0,0 +1,93 @@
+//
+//  VROOBJParser.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef VROOBJParser_h
+#define VROOBJParser_h
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class VROData;
+
+/*
+ The contents of an OBJ file, as produced by VROOBJParser. Vertices are
+ deduplicated by their (position, texcoord, normal) triple, so each distinct
+ corner is stored once and shared by the triangles that reference it.
+ */
+struct VROOBJData {
+    /*
+     The file names listed by each mtllib statement, in order. A statement may
+     list several candidate files.
+     */
+    std::vector<std::vector<std::string>> materialLibraries;
+    
+    /*
+     The vertices, as an array of VROShapeVertexLayout. Texture coordinates are
+     flipped vertically, and tangents are zeroed for the caller to generate.
+     */
+    std::shared_ptr<VROData> vertices;
+    int numVertices = 0;
+    
+    /*
+     The triangles of the file, as one index list for each material (usemtl
+     name) they use, merged across groups and objects, in order of first use.
+     Faces using no material have an empty name.
+     */
+    std::vector<std::string> materialNames;
+    std::vector<std::vector<int>> indices;
+    
+    /*
+     The number of attributes declared in the file.
+     */
+    int numPositions = 0;
+    int numTexcoords = 0;
+    int numNormals = 0;
+};
+
+/*
+ Parallel parser for OBJ files. The file is memory mapped and split into chunks
+ of whole lines, which are parsed in two passes: the first counts the
+ attributes in each chunk, so that the second can parse every chunk directly
+ into place in the attribute arrays, resolving relative face indices against
+ the chunk's offset in the file. Polygons are triangulated as fans.
+ 
+ Chunks are parsed on a small pool of worker threads dedicated to OBJ parsing,
+ along with the calling thread. May be invoked from any thread.
+ */
+class VROOBJParser {
+public:
+    
+    /*
+     Parse the OBJ file at the given path into the given data. If parseGeometry
+     is false, only the material libraries are read (e.g. when the geometry is
+     loaded from a cache). Returns false if the file could not be read.
+     */
+    static bool parse(std::string path, bool parseGeometry, VROOBJData *outData);
+    
+};
+
+#endif /* VROOBJParser_h */
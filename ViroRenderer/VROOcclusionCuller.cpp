@@ -0,0 +1,216 @@
+//
+//  VROOcclusionCuller.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROOcclusionCuller.h"
+#include "VRONode.h"
+#include "VROBox.h"
+#include "VROMaterial.h"
+#include "VRODriver.h"
+#include "VROBoundingBox.h"
+#include "VRORenderContext.h"
+#include "VROCamera.h"
+#include "VROMatrix4f.h"
+#include "VROProfiler.h"
+#include "VROLog.h"
+#include <cmath>
+
+// Minimum extent of a query box, so that flat geometry (e.g. a quad) still
+// rasterizes
+static const float kMinOcclusionBoxSpan = 0.001f;
+
+VROOcclusionCuller::VROOcclusionCuller() {
+    _box = VROBox::createBox(1, 1, 1);
+    
+    _boxMaterial = std::make_shared<VROMaterial>();
+    _boxMaterial->setLightingModel(VROLightingModel::Constant);
+    _boxMaterial->setWritesToDepthBuffer(false);
+    _boxMaterial->setReadsFromDepthBuffer(true);
+    _boxMaterial->setCullMode(VROCullMode::None);
+    _box->setMaterials({ _boxMaterial });
+}
+
+VROOcclusionCuller::~VROOcclusionCuller() {
+    
+}
+
+void VROOcclusionCuller::reset(VRODriver &driver) {
+    for (VROOcclusionQuery &query : _pendingQueries) {
+        driver.releaseOcclusionQuery(query.query);
+        
+        std::shared_ptr<VRONode> node = query.node.lock();
+        if (node) {
+            node->_occlusionQueryPending = false;
+            node->_occluded = false;
+        }
+    }
+    _pendingQueries.clear();
+}
+
+#pragma mark - Results
+
+void VROOcclusionCuller::collectResults(int frame, VRODriver &driver) {
+    VRO_PROFILE_SCOPE("collectOcclusionResults");
+    
+    int numOccluded = 0;
+    auto it = _pendingQueries.begin();
+    while (it != _pendingQueries.end()) {
+        std::shared_ptr<VRONode> node = it->node.lock();
+        if (!node) {
+            driver.releaseOcclusionQuery(it->query);
+            it = _pendingQueries.erase(it);
+            continue;
+        }
+        
+        bool visible = true;
+        if (driver.getOcclusionQueryResult(it->query, &visible)) {
+            node->_occluded = !visible;
+            node->_occlusionResultFrame = frame;
+        }
+        else if (frame - it->frame > kMaxOcclusionQueryWaitFrames) {
+            // Give up on the query and render the node, as if it were visible
+            driver.releaseOcclusionQuery(it->query);
+            node->_occluded = false;
+        }
+        else {
+            ++it;
+            continue;
+        }
+        
+        if (node->_occluded) {
+            ++numOccluded;
+        }
+        node->_occlusionQueryPending = false;
+        it = _pendingQueries.erase(it);
+    }
+    VRO_PROFILE_COUNT(OccludedNodes, numOccluded);
+}
+
+#pragma mark - Queries
+
+void VROOcclusionCuller::issueQueries(VRONode *root, const VRORenderContext &context,
+                                      std::shared_ptr<VRODriver> &driver) {
+    VRO_PROFILE_SCOPE("issueOcclusionQueries");
+    
+    int frame = context.getFrame();
+    _candidates.clear();
+    collectCandidates(root, frame);
+    if (_candidates.empty()) {
+        return;
+    }
+    
+    if (!_boxMaterial->bindShader(0, {}, context, driver)) {
+        return;
+    }
+    _boxMaterial->bindProperties(driver);
+    
+    // Candidates were collected in post-order, so walk them backwards to
+    // test parents first; when the budget runs out it is the smaller
+    // subtrees that wait for a later frame
+    int numQueries = 0;
+    for (auto it = _candidates.rbegin(); it != _candidates.rend() && numQueries < kMaxOcclusionQueriesPerFrame; ++it) {
+        VRONode *node = *it;
+        const VROBoundingBox &bounds = node->_worldUmbrellaBoundingBox;
+        if (!isTestable(bounds, context)) {
+            continue;
+        }
+        
+        std::shared_ptr<VRONode> sharedNode = std::dynamic_pointer_cast<VRONode>(node->shared_from_this());
+        if (!sharedNode) {
+            continue;
+        }
+        uint32_t query = driver->beginOcclusionQuery();
+        if (query == 0) {
+            break;
+        }
+        
+        VROMatrix4f transform;
+        transform.toIdentity();
+        transform.scale(std::max(bounds.getSpanX(), kMinOcclusionBoxSpan),
+                        std::max(bounds.getSpanY(), kMinOcclusionBoxSpan),
+                        std::max(bounds.getSpanZ(), kMinOcclusionBoxSpan));
+        transform.translate(bounds.getCenter());
+        _box->renderSilhouette(transform, _boxMaterial, context, driver);
+        
+        driver->endOcclusionQuery();
+        
+        node->_occlusionQueryPending = true;
+        _pendingQueries.push_back({ sharedNode, query, frame });
+        ++numQueries;
+    }
+    _candidates.clear();
+    VRO_PROFILE_COUNT(OcclusionQueries, numQueries);
+}
+
+bool VROOcclusionCuller::collectCandidates(VRONode *node, int frame) {
+    bool depthTested = true;
+    
+    const std::shared_ptr<VROGeometry> &geometry = node->getGeometry();
+    if (geometry) {
+        // Skinned geometry may be posed outside of its bounds, and camera
+        // enclosures and screen space geometry are not positioned by the bounds
+        if (geometry->getSkinner() || geometry->isCameraEnclosure() || geometry->isScreenSpace()) {
+            depthTested = false;
+        }
+        for (const std::shared_ptr<VROMaterial> &material : geometry->getMaterials()) {
+            if (!material->getReadsFromDepthBuffer()) {
+                depthTested = false;
+            }
+        }
+    }
+    for (std::shared_ptr<VRONode> &child : node->_subnodes) {
+        if (!collectCandidates(child.get(), frame)) {
+            depthTested = false;
+        }
+    }
+    
+    // Visible nodes are re-tested at an interval, while occluded nodes are
+    // re-tested every frame so that they reappear as soon as they're revealed
+    if (depthTested && node->_occlusionCandidateFrame == frame && !node->_occlusionQueryPending &&
+       (node->_occluded || (node->getUniqueID() + frame) % kOcclusionVisibleRequeryInterval == 0)) {
+        _candidates.push_back(node);
+    }
+    return depthTested;
+}
+
+bool VROOcclusionCuller::isTestable(const VROBoundingBox &box, const VRORenderContext &context) {
+    float spans[3] = { box.getSpanX(), box.getSpanY(), box.getSpanZ() };
+    for (float span : spans) {
+        if (!std::isfinite(span) || span < 0) {
+            return false;
+        }
+    }
+    if (spans[0] == 0 && spans[1] == 0 && spans[2] == 0) {
+        return false;
+    }
+    
+    // Inflate the box by the near clipping distance: if the camera is inside,
+    // the near plane may clip away every face of the box
+    const VROCamera &camera = context.getCamera();
+    VROVector3f position = camera.getPosition();
+    float ncp = camera.getNCP();
+    return !(position.x >= box.getMinX() - ncp && position.x <= box.getMaxX() + ncp &&
+             position.y >= box.getMinY() - ncp && position.y <= box.getMaxY() + ncp &&
+             position.z >= box.getMinZ() - ncp && position.z <= box.getMaxZ() + ncp);
+}
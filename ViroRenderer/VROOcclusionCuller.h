@@ -0,0 +1,142 @@
+//
+//  VROOcclusionCuller.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROOcclusionCuller_h
+#define VROOcclusionCuller_h
+
+#include <memory>
+#include <vector>
+#include <stdint.h>
+
+class VRONode;
+class VROBox;
+class VROMaterial;
+class VRODriver;
+class VROBoundingBox;
+class VRORenderContext;
+
+/*
+ Number of frames an occlusion result remains valid. Occluded subtrees whose
+ result is older than this are rendered again until a fresh result arrives.
+ */
+static const int kOcclusionResultMaxAge = 6;
+
+/*
+ Visible subtrees are re-tested once every this many frames (staggered by node
+ ID); occluded subtrees are re-tested every frame so they reappear promptly.
+ */
+static const int kOcclusionVisibleRequeryInterval = 4;
+
+/*
+ Maximum number of occlusion queries issued per frame.
+ */
+static const int kMaxOcclusionQueriesPerFrame = 256;
+
+/*
+ Number of frames a query is given to complete before it is abandoned, and its
+ node treated as visible.
+ */
+static const int kMaxOcclusionQueryWaitFrames = 8;
+
+/*
+ Culls subtrees hidden behind opaque geometry using hardware occlusion queries.
+ Each frame, after the depth pre-pass, the world bounding box of each candidate
+ subtree (a node that survived frustum culling) is rendered against the
+ pre-pass depth inside a query. Results are collected without blocking at the
+ start of later frames, typically one to three frames after being issued, and
+ subtrees found hidden are treated as outside the frustum by
+ VRONode::updateVisibility. Relying on temporal coherence this way avoids
+ stalling the CPU on the GPU, at the cost of an occluded object appearing a
+ frame or two late when it is revealed.
+ */
+class VROOcclusionCuller {
+public:
+    
+    VROOcclusionCuller();
+    virtual ~VROOcclusionCuller();
+    
+    /*
+     Poll the outstanding queries, writing the results that have arrived to
+     their nodes. Invoked before visibility is computed each frame.
+     */
+    void collectResults(int frame, VRODriver &driver);
+    
+    /*
+     Issue queries for the candidate subtrees of the given tree. The depth
+     buffer must hold the occluders (the depth pre-pass), and the color mask
+     should be disabled.
+     */
+    void issueQueries(VRONode *root, const VRORenderContext &context,
+                      std::shared_ptr<VRODriver> &driver);
+    
+    /*
+     Release all outstanding queries and clear the results written to their
+     nodes.
+     */
+    void reset(VRODriver &driver);
+    
+private:
+    
+    struct VROOcclusionQuery {
+        std::weak_ptr<VRONode> node;
+        uint32_t query;
+        int frame;
+    };
+    
+    /*
+     Queries issued but not yet collected, in the order they were issued.
+     */
+    std::vector<VROOcclusionQuery> _pendingQueries;
+    
+    /*
+     Unit box rendered, scaled to each subtree's bounds, for each query. The
+     material reads but does not write depth, and is not culled so that the
+     query counts the box's back faces when its front faces are clipped.
+     */
+    std::shared_ptr<VROBox> _box;
+    std::shared_ptr<VROMaterial> _boxMaterial;
+    
+    /*
+     Nodes to query this frame, parents before their descendants.
+     */
+    std::vector<VRONode *> _candidates;
+    
+    /*
+     Collect into _candidates the nodes in the given subtree that are due for a
+     query. Returns true if every geometry in the subtree is depth tested; only
+     such subtrees can be culled, since anything drawn over the depth buffer
+     would otherwise vanish.
+     */
+    bool collectCandidates(VRONode *node, int frame);
+    
+    /*
+     A box can be tested if it is non-empty, finite, and does not contain the
+     camera (in which case the near plane would clip it).
+     */
+    static bool isTestable(const VROBoundingBox &box, const VRORenderContext &context);
+    
+};
+
+#endif /* VROOcclusionCuller_h */
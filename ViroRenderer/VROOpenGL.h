@@ -30,6 +30,19 @@
 #include "VRODefines.h"
 #include "VROLog.h"
 
+/*
+ Debug group markers (pglpush/pglpop) are only emitted in debug builds. In
+ release builds the macros, along with the evaluation of their arguments,
+ compile out entirely.
+ */
+#ifndef VRO_GL_DEBUG_MARKERS
+#if defined(DEBUG) && DEBUG
+#define VRO_GL_DEBUG_MARKERS 1
+#else
+#define VRO_GL_DEBUG_MARKERS 0
+#endif
+#endif
+
 #if VRO_PLATFORM_ANDROID
 
 #include <cstring>
@@ -40,8 +53,50 @@
 #include <GLES3/gl3ext.h>
 #include <GLES3/gl3platform.h>
 
+// OVR_multiview is loaded at runtime, when the extension is present
+#if !defined( GL_OVR_multiview )
+typedef void (GL_APIENTRY* PFNGLFRAMEBUFFERTEXTUREMULTIVIEWOVRPROC) (GLenum target, GLenum attachment, GLuint texture, GLint level, GLint baseViewIndex, GLsizei numViews);
+#endif
+
+// EXT_multisampled_render_to_texture is likewise loaded at runtime
+#if !defined( GL_EXT_multisampled_render_to_texture )
+#define GL_MAX_SAMPLES_EXT 0x8D57
+typedef void (GL_APIENTRY* PFNGLRENDERBUFFERSTORAGEMULTISAMPLEEXTPROC) (GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height);
+typedef void (GL_APIENTRY* PFNGLFRAMEBUFFERTEXTURE2DMULTISAMPLEEXTPROC) (GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level, GLsizei samples);
+#endif
+
+// QCOM_texture_foveated is likewise loaded at runtime
+#if !defined( GL_QCOM_texture_foveated )
+typedef void (GL_APIENTRY* PFNGLTEXTUREFOVEATIONPARAMETERSQCOMPROC) (GLuint texture, GLuint layer, GLuint focalPoint, GLfloat focalX, GLfloat focalY, GLfloat gainX, GLfloat gainY, GLfloat foveaArea);
+#endif
+
+// EXT_fragment_shading_rate and QCOM_shading_rate are likewise loaded at runtime;
+// the two share their shading rate enums
+#if !defined( GL_EXT_fragment_shading_rate )
+#define GL_SHADING_RATE_1X1_PIXELS_EXT 0x96A6
+#define GL_SHADING_RATE_2X2_PIXELS_EXT 0x96A9
+#define GL_SHADING_RATE_4X4_PIXELS_EXT 0x96AE
+#define GL_SHADING_RATE_ATTACHMENT_EXT 0x96D1
+#define GL_FRAGMENT_SHADING_RATE_COMBINER_OP_KEEP_EXT 0x96D2
+#define GL_FRAGMENT_SHADING_RATE_COMBINER_OP_MAX_EXT 0x96D5
+#define GL_MIN_FRAGMENT_SHADING_RATE_ATTACHMENT_TEXEL_WIDTH_EXT 0x96D7
+#define GL_MAX_FRAGMENT_SHADING_RATE_ATTACHMENT_TEXEL_WIDTH_EXT 0x96D8
+#define GL_MIN_FRAGMENT_SHADING_RATE_ATTACHMENT_TEXEL_HEIGHT_EXT 0x96D9
+#define GL_MAX_FRAGMENT_SHADING_RATE_ATTACHMENT_TEXEL_HEIGHT_EXT 0x96DA
+typedef void (GL_APIENTRY* PFNGLSHADINGRATEEXTPROC) (GLenum rate);
+typedef void (GL_APIENTRY* PFNGLSHADINGRATECOMBINEROPSEXTPROC) (GLenum combinerOp0, GLenum combinerOp1);
+typedef void (GL_APIENTRY* PFNGLFRAMEBUFFERSHADINGRATEEXTPROC) (GLenum target, GLenum attachment, GLuint texture, GLint baseLayer, GLsizei numLayers, GLsizei texelWidth, GLsizei texelHeight);
+#endif
+#if !defined( GL_QCOM_shading_rate )
+typedef void (GL_APIENTRY* PFNGLSHADINGRATEQCOMPROC) (GLenum rate);
+#endif
+
 // Avoiding glBufferSubData seems to increase stability on Adreno devices
 #define VRO_AVOID_BUFFER_SUB_DATA 1
+#define VRO_SUPPORTS_PROGRAM_BINARY 1
+#define VRO_SUPPORTS_TEXTURE_STORAGE 1
+#define VRO_SUPPORTS_PIXEL_BUFFER_UPLOAD 1
+#define VRO_SUPPORTS_BUFFER_MAPPING 1
 
 #define pglpush(message,...) ((void)0)
 #define pglpop() ((void)0)
@@ -55,7 +110,12 @@
 #import <OpenGLES/ES3/gl.h>
 #import <OpenGLES/ES3/glext.h>
 #define VRO_AVOID_BUFFER_SUB_DATA 0
+#define VRO_SUPPORTS_PROGRAM_BINARY 1
+#define VRO_SUPPORTS_TEXTURE_STORAGE 1
+#define VRO_SUPPORTS_PIXEL_BUFFER_UPLOAD 1
+#define VRO_SUPPORTS_BUFFER_MAPPING 1
 
+#if VRO_GL_DEBUG_MARKERS
 #define pglpush(message,...) \
 do { \
 char str[1024]; \
@@ -67,6 +127,10 @@ glPushGroupMarkerEXT(0, str); \
 do { \
 glPopGroupMarkerEXT(); \
 } while (0)
+#else
+#define pglpush(message,...) ((void)0)
+#define pglpop() ((void)0)
+#endif
 
 #elif VRO_PLATFORM_MACOS
 
@@ -77,7 +141,14 @@ glPopGroupMarkerEXT(); \
 #define GL_COMPRESSED_RGBA_ASTC_4x4_KHR 0xdecafbad
 #define GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR 0xdecafbad
 #define GL_FRAMEBUFFER_INCOMPLETE_DIMENSIONS 0xdecafbad
+#define VRO_SUPPORTS_PROGRAM_BINARY 0
+
+// glTexStorage2D requires GL 4.2
+#define VRO_SUPPORTS_TEXTURE_STORAGE 0
+#define VRO_SUPPORTS_PIXEL_BUFFER_UPLOAD 1
+#define VRO_SUPPORTS_BUFFER_MAPPING 1
 
+#if VRO_GL_DEBUG_MARKERS
 #define pglpush(message,...) \
 do { \
 char str[1024]; \
@@ -89,6 +160,10 @@ glPushGroupMarkerEXT(0, str); \
 do { \
 glPopGroupMarkerEXT(); \
 } while (0)
+#else
+#define pglpush(message,...) ((void)0)
+#define pglpop() ((void)0)
+#endif
 
 #elif VRO_PLATFORM_WASM
 
@@ -96,19 +171,52 @@ glPopGroupMarkerEXT(); \
 #include <GLES2/gl2ext.h>
 #include <GLES3/gl3platform.h>
 #define VRO_AVOID_BUFFER_SUB_DATA 0
+#define VRO_SUPPORTS_PROGRAM_BINARY 0
+#define VRO_SUPPORTS_TEXTURE_STORAGE 1
 
-#define pglpush(message,...) \
-do { \
-char str[1024]; \
-sprintf(str, #message, ##__VA_ARGS__); \
-\
-} while (0)
+// WebGL cannot map buffers, so pixel buffers would only add a copy
+#define VRO_SUPPORTS_PIXEL_BUFFER_UPLOAD 0
+#define VRO_SUPPORTS_BUFFER_MAPPING 0
 
-#define pglpop() \
-do { \
-\
-} while (0)
+#define pglpush(message,...) ((void)0)
+#define pglpop() ((void)0)
+
+#endif
 
+// From KHR_parallel_shader_compile; supported drivers report it in GL_EXTENSIONS
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// From EXT_buffer_storage, which is loaded at runtime where supported
+#ifndef GL_EXT_buffer_storage
+#define GL_MAP_PERSISTENT_BIT_EXT 0x0040
+#define GL_MAP_COHERENT_BIT_EXT 0x0080
+typedef void (*PFNGLBUFFERSTORAGEEXTPROC) (GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+#endif
+
+// From EXT_multi_draw_indirect (over GLES 3.1), likewise loaded at runtime
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+#ifndef GL_EXT_multi_draw_indirect
+typedef void (*PFNGLMULTIDRAWELEMENTSINDIRECTEXTPROC) (GLenum mode, GLenum type, const void *indirect, GLsizei drawcount, GLsizei stride);
+#endif
+
+// Compute shaders and shader storage buffers are core in GLES 3.1; we build
+// against GLES 3.0, so the entry points are loaded at runtime where available
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_COMMAND_BARRIER_BIT
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#endif
+#if !defined( GL_ES_VERSION_3_1 ) && !defined( GL_VERSION_4_3 )
+typedef void (*PFNGLDISPATCHCOMPUTEPROC) (GLuint num_groups_x, GLuint num_groups_y, GLuint num_groups_z);
+typedef void (*PFNGLMEMORYBARRIERPROC) (GLbitfield barriers);
 #endif
 
 #ifdef CHECK_GL_ERRORS
@@ -0,0 +1,128 @@
+//
+//  VROParallelUpdateTest.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROParallelUpdateTest.h"
+#include "VROTestUtil.h"
+#include "VROLog.h"
+
+static const int kParallelUpdateSubtrees = 16;
+static const int kParallelUpdateNodesPerSubtree = 16;
+static const float kParallelUpdateSpacing = 1.5;
+static const float kParallelUpdateTolerance = 0.001;
+static const int kParallelUpdateReportInterval = 300;
+
+static bool VROBoundsEqual(const VROBoundingBox &a, const VROBoundingBox &b) {
+    return fabs(a.getMinX() - b.getMinX()) < kParallelUpdateTolerance &&
+           fabs(a.getMaxX() - b.getMaxX()) < kParallelUpdateTolerance &&
+           fabs(a.getMinY() - b.getMinY()) < kParallelUpdateTolerance &&
+           fabs(a.getMaxY() - b.getMaxY()) < kParallelUpdateTolerance &&
+           fabs(a.getMinZ() - b.getMinZ()) < kParallelUpdateTolerance &&
+           fabs(a.getMaxZ() - b.getMaxZ()) < kParallelUpdateTolerance;
+}
+
+VROParallelUpdateTest::VROParallelUpdateTest() :
+    VRORendererTest(VRORendererTestType::ParallelUpdate),
+    _frames(0),
+    _failures(0) {
+        
+}
+
+VROParallelUpdateTest::~VROParallelUpdateTest() {
+    
+}
+
+void VROParallelUpdateTest::build(std::shared_ptr<VRORenderer> renderer,
+                                  std::shared_ptr<VROFrameSynchronizer> frameSynchronizer,
+                                  std::shared_ptr<VRODriver> driver) {
+    _sceneController = std::make_shared<VROSceneController>();
+    std::shared_ptr<VROScene> scene = _sceneController->getScene();
+    
+    std::shared_ptr<VROPortal> rootNode = scene->getRootNode();
+    rootNode->setPosition({0, 0, 0});
+    
+    std::shared_ptr<VROLight> ambient = std::make_shared<VROLight>(VROLightType::Ambient);
+    ambient->setColor({ 1.0, 1.0, 1.0 });
+    rootNode->addLight(ambient);
+    
+    _box = VROBox::createBox(1, 1, 1);
+    _box->getMaterials()[0]->getDiffuse().setColor({ 0.2, 0.6, 1.0, 1.0 });
+    
+    /*
+     Each subtree is a row of nodes under its own parent, so the parallel
+     transform pass hands different rows to different threads.
+     */
+    float offset = (kParallelUpdateNodesPerSubtree - 1) * kParallelUpdateSpacing / 2.0;
+    for (int s = 0; s < kParallelUpdateSubtrees; s++) {
+        std::shared_ptr<VRONode> subtree = std::make_shared<VRONode>();
+        subtree->setPosition({ 0, s * kParallelUpdateSpacing - offset, -20 });
+        rootNode->addChildNode(subtree);
+        
+        for (int n = 0; n < kParallelUpdateNodesPerSubtree; n++) {
+            std::shared_ptr<VRONode> node = std::make_shared<VRONode>();
+            node->setPosition({ n * kParallelUpdateSpacing - offset, 0, 0 });
+            node->setRotationEuler({ 0, (float) (s + n) * 0.1f, 0 });
+            subtree->addChildNode(node);
+            _nodes.push_back(node);
+        }
+    }
+    
+    std::shared_ptr<VRONodeCamera> camera = std::make_shared<VRONodeCamera>();
+    std::shared_ptr<VRONode> cameraNode = std::make_shared<VRONode>();
+    cameraNode->setCamera(camera);
+    rootNode->addChildNode(cameraNode);
+    
+    _pointOfView = cameraNode;
+    frameSynchronizer->addFrameListener(shared_from_this());
+}
+
+void VROParallelUpdateTest::onFrameWillRender(const VRORenderContext &context) {
+    /*
+     A fresh geometry has not computed its bounds, so the first node to reach it
+     in this frame's transform pass (on whichever thread) computes them.
+     */
+    std::shared_ptr<VROGeometry> geometry = std::make_shared<VROGeometry>(_box->getGeometrySources(),
+                                                                          _box->getGeometryElements());
+    geometry->setMaterials(_box->getMaterials());
+    for (std::shared_ptr<VRONode> &node : _nodes) {
+        node->setGeometry(geometry);
+    }
+}
+
+void VROParallelUpdateTest::onFrameDidRender(const VRORenderContext &context) {
+    VROBoundingBox expected = _box->getBoundingBox();
+    for (std::shared_ptr<VRONode> &node : _nodes) {
+        VROBoundingBox world = expected.transform(node->getWorldTransform());
+        if (!VROBoundsEqual(node->getBoundingBox(), world)) {
+            pwarn("Parallel update bounds mismatch on frame %d: expected %s, found %s", _frames,
+                  world.toString().c_str(), node->getBoundingBox().toString().c_str());
+            _failures++;
+        }
+    }
+    
+    _frames++;
+    if (_frames % kParallelUpdateReportInterval == 0) {
+        pinfo("Parallel update test: %d frames, %d bounds mismatches", _frames, _failures);
+    }
+}
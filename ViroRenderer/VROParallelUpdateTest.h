@@ -0,0 +1,76 @@
+//
+//  VROParallelUpdateTest.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROParallelUpdateTest_h
+#define VROParallelUpdateTest_h
+
+#include "VRORendererTest.h"
+
+/*
+ Several subtrees whose nodes all share one geometry, for validating the parallel
+ scene update. Each frame the shared geometry is replaced by a fresh copy whose
+ bounds have not yet been computed, so that the parallel transform pass computes
+ them from several threads at once; once the frame is rendered, the bounds of each
+ node are checked against bounds computed serially. Requires the parallel scene
+ update (VRORendererConfiguration::enableParallelSceneUpdate) on a device with
+ more than one core.
+ */
+class VROParallelUpdateTest : public VROFrameListener, public VRORendererTest, public std::enable_shared_from_this<VROFrameListener> {
+public:
+    
+    VROParallelUpdateTest();
+    virtual ~VROParallelUpdateTest();
+    
+    void build(std::shared_ptr<VRORenderer> renderer,
+               std::shared_ptr<VROFrameSynchronizer> frameSynchronizer,
+               std::shared_ptr<VRODriver> driver);
+    std::shared_ptr<VRONode> getPointOfView() {
+        return _pointOfView;
+    }
+    std::shared_ptr<VROSceneController> getSceneController() {
+        return _sceneController;
+    }
+    
+    void onFrameWillRender(const VRORenderContext &context);
+    void onFrameDidRender(const VRORenderContext &context);
+    
+private:
+
+    std::shared_ptr<VRONode> _pointOfView;
+    std::shared_ptr<VROSceneController> _sceneController;
+    
+    /*
+     The box whose sources and elements each fresh geometry shares, and the
+     nodes (across all subtrees) that share that geometry.
+     */
+    std::shared_ptr<VROBox> _box;
+    std::vector<std::shared_ptr<VRONode>> _nodes;
+    
+    int _frames;
+    int _failures;
+    
+};
+
+#endif /* VROParallelUpdateTest_h */
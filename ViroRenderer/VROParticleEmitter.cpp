@@ -28,11 +28,43 @@
 #include "VROParticleEmitter.h"
 #include "VROSurface.h"
 #include "VRONode.h"
-#include "VROBillboardConstraint.h"
 #include "VROParticleUBO.h"
+#include "VROGPUParticleUBO.h"
 #include "VROMaterial.h"
 #include "VRODriverOpenGL.h"
 #include "VROPlatformUtil.h"
+#include "VROShaderModifier.h"
+#include "VROStringUtil.h"
+#include "VROLog.h"
+#include "VRORenderInvalidation.h"
+
+/*
+ Creates the modifiers that fade particles as they near the depth already in the render
+ target. The geometry modifier passes on the two projection terms needed to linearize
+ window-space depth; the fragment modifier reads the scene depth with framebuffer fetch
+ and fades the fragment by its linear distance in front of it. Blend modes scale the
+ source by its alpha, so fading the alpha fades additive particles as well.
+ */
+static std::vector<std::shared_ptr<VROShaderModifier>> VROCreateSoftParticleModifiers(float distance) {
+    std::vector<std::string> geometryCode = {
+        "out highp vec2 v_soft_depth_params;",
+        "v_soft_depth_params = vec2(_transforms.projection_matrix[2][2], _transforms.projection_matrix[3][2]);",
+    };
+    std::vector<std::string> fragmentCode = {
+        "in highp vec2 v_soft_depth_params;",
+        "highp float soft_scene_depth = v_soft_depth_params.y / (gl_LastFragDepthARM * 2.0 - 1.0 + v_soft_depth_params.x);",
+        "highp float soft_particle_depth = v_soft_depth_params.y / (gl_FragCoord.z * 2.0 - 1.0 + v_soft_depth_params.x);",
+        "_output_color.a *= clamp((soft_scene_depth - soft_particle_depth) / " + VROStringUtil::toString(distance, 4) + ", 0.0, 1.0);",
+    };
+    
+    std::shared_ptr<VROShaderModifier> geometryModifier = std::make_shared<VROShaderModifier>(VROShaderEntryPoint::Geometry, geometryCode);
+    std::shared_ptr<VROShaderModifier> fragmentModifier = std::make_shared<VROShaderModifier>(VROShaderEntryPoint::Fragment, fragmentCode);
+    fragmentModifier->addReplacement("#version 300 es",
+                                     "#version 300 es\n#extension GL_ARM_shader_framebuffer_fetch_depth_stencil : require");
+    geometryModifier->setName("soft_g");
+    fragmentModifier->setName("soft_f");
+    return { geometryModifier, fragmentModifier };
+}
 
 VROParticleEmitter::VROParticleEmitter(std::shared_ptr<VRODriver> driver,
                                        std::shared_ptr<VROSurface> particleGeometry) {
@@ -71,6 +103,9 @@ void VROParticleEmitter::initParticleUBO(std::shared_ptr<VROSurface> particleGeo
     for (std::shared_ptr<VROShaderModifier> modifier : shaderModifiers) {
         material->addShaderModifier(modifier);
     }
+    for (std::shared_ptr<VROShaderModifier> modifier : _softParticleModifiers) {
+        material->addShaderModifier(modifier);
+    }
 }
 
 void VROParticleEmitter::setDefaultValues() {
@@ -90,6 +125,7 @@ void VROParticleEmitter::setDefaultValues() {
   
     _duration = 2000;
     _maxParticles = 500;
+    _particleBudget = _maxParticles;
     _particlesEmittedPerMeter = std::pair<int, int>(0, 0);
     _particlesEmittedPerSecond = std::pair<int, int>(10, 10);
     _particleLifeTime = std::pair<int, int>(2000, 2000);
@@ -104,17 +140,76 @@ void VROParticleEmitter::setDefaultValues() {
     _currentVolume = defaultVol;
 }
 
+void VROParticleEmitter::setSimulation(VROParticleSimulation simulation, std::shared_ptr<VRODriver> driver) {
+    if (_simulation == simulation) {
+        return;
+    }
+    _simulation = simulation;
+    _particles.clear();
+    _zombieParticles.clear();
+    _pool.clear();
+
+    if (simulation == VROParticleSimulation::GPU) {
+        _gpuParticles = std::make_shared<VROGPUParticleUBO>(driver);
+        _gpuParticles->setCapacity(_maxParticles);
+        bindInstancedUBO(_gpuParticles);
+    } else {
+        _gpuParticles.reset();
+        bindInstancedUBO(std::make_shared<VROParticleUBO>(driver));
+    }
+}
+
+void VROParticleEmitter::bindInstancedUBO(std::shared_ptr<VROInstancedUBO> instancedUBO) {
+    _particleGeometry->setInstancedUBO(instancedUBO);
+    addShaderModifiers(_particleGeometry->getMaterials()[0], instancedUBO);
+}
+
+void VROParticleEmitter::addShaderModifiers(std::shared_ptr<VROMaterial> material,
+                                            std::shared_ptr<VROInstancedUBO> instancedUBO) {
+    material->removeAllShaderModifiers();
+    std::vector<std::shared_ptr<VROShaderModifier>> shaderModifiers = instancedUBO->createInstanceShaderModifier();
+    for (std::shared_ptr<VROShaderModifier> modifier : shaderModifiers) {
+        material->addShaderModifier(modifier);
+    }
+    for (std::shared_ptr<VROShaderModifier> modifier : _softParticleModifiers) {
+        material->addShaderModifier(modifier);
+    }
+}
+
+void VROParticleEmitter::setSoftParticleDistance(float distance, std::shared_ptr<VRODriver> driver) {
+    std::shared_ptr<VROMaterial> material = _particleGeometry->getMaterials()[0];
+    for (std::shared_ptr<VROShaderModifier> modifier : _softParticleModifiers) {
+        material->removeShaderModifier(modifier);
+    }
+    _softParticleModifiers.clear();
+    _softParticleDistance = distance;
+    
+    if (distance <= 0) {
+        return;
+    }
+    if (!driver->isFramebufferFetchDepthSupported()) {
+        pinfo("Soft particles require framebuffer depth fetch, rendering particles unfaded");
+        return;
+    }
+    _softParticleModifiers = VROCreateSoftParticleModifiers(distance);
+    for (std::shared_ptr<VROShaderModifier> modifier : _softParticleModifiers) {
+        material->addShaderModifier(modifier);
+    }
+}
+
+void VROParticleEmitter::setOrderIndependent(bool orderIndependent) {
+    std::shared_ptr<VROMaterial> mat = _particleGeometry->getMaterials()[0];
+    mat->setOrderIndependent(orderIndependent);
+    mat->setBlendMode(orderIndependent ? VROBlendMode::Add : VROBlendMode::Alpha);
+}
+
 void VROParticleEmitter::setParticleSurface(std::shared_ptr<VROSurface> particleSurface) {
     std::shared_ptr<VROInstancedUBO> instanceUBO = _particleGeometry->getInstancedUBO();
     particleSurface->setInstancedUBO(instanceUBO);
     
     std::shared_ptr<VROMaterial> material = particleSurface->getMaterials()[0];
-    material->removeAllShaderModifiers();
-    
-    std::vector<std::shared_ptr<VROShaderModifier>> shaderModifiers = instanceUBO->createInstanceShaderModifier();
-    for (std::shared_ptr<VROShaderModifier> modifier : shaderModifiers) {
-        material->addShaderModifier(modifier);
-    }
+    addShaderModifiers(material, instanceUBO);
+    material->setOrderIndependent(_particleGeometry->getMaterials()[0]->isOrderIndependent());
     material->setWritesToDepthBuffer(false);
     material->setReadsFromDepthBuffer(true);
     material->setBlendMode(particleSurface->getMaterials().front()->getBlendMode());
@@ -171,11 +266,14 @@ void VROParticleEmitter::setPause(bool pause) {
 
 void VROParticleEmitter::update(const VRORenderContext &context, const VROMatrix4f &computedTransform) {
     _lastComputedTransform = computedTransform;
+    _particleBudget = std::max(1, (int) (_maxParticles * context.getParticleBudgetScale()));
     double currentTime = VROTimeCurrentMillis();
 
     bool isCurrentlyDelayed = processDelay(currentTime);
   
       if (!_paused) {
+        // Emitting particles change the image every frame
+        VRORenderInvalidation::invalidate();
         if (!isCurrentlyDelayed) {
           updateEmitter(currentTime - _emitterTotalPausedTime, computedTransform);
         }
@@ -220,6 +318,10 @@ void VROParticleEmitter::resetEmissionCycle(bool resetParticles) {
     if (resetParticles) {
         _particles.clear();
         _zombieParticles.clear();
+        _pool.clear();
+        if (_gpuParticles) {
+            _gpuParticles->clear();
+        }
     }
 
     // Restart delay times
@@ -245,9 +347,13 @@ void VROParticleEmitter::updateParticles(double currentTime,
                                          const VRORenderContext &context,
                                          const VROMatrix4f &computedTransform,
                                          bool isCurrentlyDelayed) {
-    updateParticlePhysics(currentTime);
-    updateParticleAppearance(currentTime);
-    updateParticlesToBeKilled(currentTime);
+    if (_simulation == VROParticleSimulation::GPU) {
+        updateGPUParticles(currentTime, computedTransform, isCurrentlyDelayed);
+        return;
+    }
+
+    _pool.setCapacity(_maxParticles);
+    _pool.killExpired(currentTime);
 
     // Do not spawn if the emitter is in delay mode, or if !_run, or if we have finished
     // an emission cycle.
@@ -255,94 +361,48 @@ void VROParticleEmitter::updateParticles(double currentTime,
         updateParticleSpawn(currentTime, computedTransform.extractTranslation());
     }
 
-    updateZombieParticles(currentTime);
-
-    // Finally calculate and billboard the updated particle's world transform before rendering.
-    std::shared_ptr<VROBillboardConstraint> constraint
-            = std::make_shared<VROBillboardConstraint>(VROBillboardAxis::All);
-
-    float minX = FLT_MAX, maxX = -FLT_MAX, minY = FLT_MAX, maxY = -FLT_MAX, minZ = FLT_MAX, maxZ = -FLT_MAX;
-    for (int i = 0; i < _particles.size(); i++) {
-        if (_particles[i].fixedToEmitter) {
-            // If the particle is fixedToEmitter, position the particle in referenceFactor to the
-            // emitter's base transform.
-            _particles[i].currentWorldTransform = computedTransform.multiply(_particles[i].currentLocalTransform);
-        } else {
-            // Else, position the particle in referenceFactor to where it had first been spawned.
-            _particles[i].currentWorldTransform = _particles[i].spawnedWorldTransform.multiply(_particles[i].currentLocalTransform);
-        }
-
-        VROMatrix4f billboardRotation = constraint->getTransform(context, _particles[i].currentWorldTransform);
-        VROVector3f computedPos = _particles[i].currentWorldTransform.extractTranslation();
-        _particles[i].currentWorldTransform.translate(computedPos.scale(-1));
-        _particles[i].currentWorldTransform = billboardRotation.multiply(_particles[i].currentWorldTransform);
-        _particles[i].currentWorldTransform.translate(computedPos);
-
-        minX = std::min(minX, computedPos.x);
-        minY = std::min(minY, computedPos.y);
-        minZ = std::min(minZ, computedPos.z);
-        maxX = std::max(maxX, computedPos.x);
-        maxY = std::max(maxY, computedPos.y);
-        maxZ = std::max(maxZ, computedPos.z);
-    }
+    // Advance the particles and compute their instance data before rendering. The particles
+    // are billboarded in the vertex shader (see VROParticleUBO).
+    VROParticlePoolModifiers modifiers = { _alphaModifier.get(), _colorModifier.get(), _scaleModifier.get(),
+                                           _rotationModifier.get(), _velocityModifier.get(),
+                                           _accelerationModifier.get() };
+    VROBoundingBox box = _pool.update(currentTime, computedTransform, _impulseDeaccelerationExplosionPeriod,
+                                      modifiers);
 
-    VROBoundingBox box =  VROBoundingBox(minX, maxX, minY, maxY, minZ, maxZ);
-    if (_particles.size() == 0) {
-        box = VROBoundingBox(0, 0, 0, 0, 0, 0);
-    }
     std::shared_ptr<VROInstancedUBO> instancedUBO = _particleGeometry->getInstancedUBO();
-    std::static_pointer_cast<VROParticleUBO>(instancedUBO)->update(_particles, box);
+    std::static_pointer_cast<VROParticleUBO>(instancedUBO)->update(_pool.getInstances(), _pool.getColors(),
+                                                                   _pool.size(), box);
 }
 
-void VROParticleEmitter::updateParticlePhysics(double currentTime) {
-    for (int i = 0; i < _particles.size(); i++) {
-        // Apply Physics modifiers
-        _particles[i].timeSinceSpawnedInMs = currentTime - _particles[i].spawnTimeMs;
-        VROVector3f velocity
-                = _velocityModifier->applyModifier(_particles[i], _particles[i].initialVelocity);
-        VROVector3f accel
-                = _accelerationModifier->applyModifier(_particles[i],_particles[i].initialAccel);
-
-        // Apply Velocity equation. NOTE: We are assuming a constant rate of acceleration and velocity.
-        float tSec = _particles[i].timeSinceSpawnedInMs / 1000;
-        if (_impulseDeaccelerationExplosionPeriod >= 0 && tSec > _impulseDeaccelerationExplosionPeriod){
-            tSec = _impulseDeaccelerationExplosionPeriod;
-        }
-
-        VROVector3f displacement = velocity * tSec + accel * 0.5 * tSec * tSec;
-        VROMatrix4f transform = _particles[i].spawnedLocalTransform;
-        VROVector3f velocityFinal = velocity + accel * tSec;
-        transform.translate(displacement);
-        _particles[i].currentLocalTransform = transform;
-
-        // Update distance, velocity and time deltas to be used for interpolating future modifiers.
-        _particles[i].distanceTraveled = displacement.magnitude();
-        _particles[i].velocity = velocityFinal.magnitude();
-    }
-}
+void VROParticleEmitter::updateGPUParticles(double currentTime, const VROMatrix4f &computedTransform,
+                                            bool isCurrentlyDelayed) {
+    _gpuParticles->setCapacity(_maxParticles);
 
-void VROParticleEmitter::updateParticleAppearance(double currentTime) {
-    for (int i = 0; i < _particles.size(); i++) {
-        if (_particles[i].isZombie) {
-            continue;
+    // Only spawning runs per particle on the CPU; killed particles are retired by
+    // the UBO as their lifetimes expire
+    if (!isCurrentlyDelayed && _run && !finishedEmissionCycle()) {
+        int totalParticles = getSpawnParticlesPerSecond(currentTime);
+        totalParticles += getSpawnParticlesPerMeter(computedTransform.extractTranslation());
+        totalParticles += getSpawnParticleBursts();
+
+        if (totalParticles > 0 && _gpuParticles->getNumActiveParticles() + totalParticles <= _particleBudget) {
+            for (int i = 0; i < totalParticles; i++) {
+                VROParticle particle;
+                resetParticle(particle, currentTime);
+                _gpuParticles->spawn(particle);
+            }
         }
-        VROVector3f alpha = _alphaModifier->applyModifier(_particles[i], _particles[i].initialAlpha);
-        VROVector3f color = _colorModifier->applyModifier(_particles[i], _particles[i].initialColor);
-        _particles[i].colorCurrent = VROVector4f(color.x, color.y, color.z, alpha.x);
-
-        VROVector3f finalScale = _scaleModifier->applyModifier(_particles[i], _particles[i].initialScale);
-        VROVector3f rotFinal = _rotationModifier->applyModifier(_particles[i], _particles[i].initialRotation);
-
-        // Apply final transformation matrix and update particle.
-        VROMatrix4f finalMatrix;
-        finalMatrix.toIdentity();
-        finalMatrix.translate(_particles[i].currentLocalTransform.extractTranslation());
-        finalMatrix.scale(finalScale.x, finalScale.y, finalScale.z);
-        finalMatrix.rotateX(rotFinal.x);
-        finalMatrix.rotateY(rotFinal.y);
-        finalMatrix.rotateZ(rotFinal.z);
-        _particles[i].currentLocalTransform = finalMatrix;
     }
+
+    // Modifiers are uploaded after spawning, since explosions replace the acceleration
+    // modifier when particles spawn
+    _gpuParticles->setModifier(VROGPUParticleProperty::Alpha, *_alphaModifier);
+    _gpuParticles->setModifier(VROGPUParticleProperty::Color, *_colorModifier);
+    _gpuParticles->setModifier(VROGPUParticleProperty::Scale, *_scaleModifier);
+    _gpuParticles->setModifier(VROGPUParticleProperty::Rotation, *_rotationModifier);
+    _gpuParticles->setModifier(VROGPUParticleProperty::Velocity, *_velocityModifier);
+    _gpuParticles->setModifier(VROGPUParticleProperty::Acceleration, *_accelerationModifier);
+    _gpuParticles->update(currentTime, computedTransform, _impulseDeaccelerationExplosionPeriod);
 }
 
 void VROParticleEmitter::updateParticleSpawn(double currentTime, VROVector3f currentPosition) {
@@ -352,8 +412,8 @@ void VROParticleEmitter::updateParticleSpawn(double currentTime, VROVector3f cur
     totalParticles += getSpawnParticleBursts();
 
     // Determine if we've hit the max number of particles and return if so.
-    int activeParticles = (int) (_particles.size() - _zombieParticles.size());
-    if (totalParticles == 0 || activeParticles + totalParticles > _maxParticles) {
+    int activeParticles = _pool.size();
+    if (totalParticles == 0 || activeParticles + totalParticles > _particleBudget) {
         return;
     }
 
@@ -457,57 +517,11 @@ int VROParticleEmitter::getSpawnParticleBursts(){
 }
 
 void VROParticleEmitter::spawnParticle(int numberOfParticles, double currentTime) {
-    // Spawn by firstly re-cyling particles.
-    int newParticles = numberOfParticles;
-    for (std::vector<VROParticle>::iterator it=_zombieParticles.begin(); it!=_zombieParticles.end(); ) {
-        VROParticle reInstatedParticle = *it;
-        resetParticle(reInstatedParticle, currentTime);
-        newParticles--;
-        _particles.push_back(reInstatedParticle);
-        _zombieParticles.erase(it);
-
-        if (newParticles <=0) {
-            return;
-        }
-    }
-
-    // If there are not enough particles, create more, add it to the pool, else return.
-    if (newParticles <= 0) {
-        return;
-    }
-
-    for (int i = newParticles; i > 0; i--) {
+    for (int i = 0; i < numberOfParticles; i++) {
         VROParticle particle;
         resetParticle(particle, currentTime);
-        _particles.push_back(particle);
-    }
-}
-
-void VROParticleEmitter::updateParticlesToBeKilled(double currentTime) {
-    // _zombieParticles contains all particles that have died so that they can be reused.
-    // Here, we add active particles that have died to this zombie list. Also note that particles
-    // that become zombies will be de-allocated after a certain time.
-    for (std::vector<VROParticle>::iterator it=_particles.begin(); it!=_particles.end(); ) {
-        VROParticle particle = *it;
-        bool hasDied = particle.spawnTimeMs + particle.lifePeriodMs < currentTime;
-        if (hasDied) {
-            particle.isZombie = true;
-            particle.killedTimeMs = currentTime;
-            _zombieParticles.push_back(particle);
-            _particles.erase(it);
-        } else {
-            ++it;
-        }
-    }
-}
-
-void VROParticleEmitter::updateZombieParticles(double currentTime) {
-    for (std::vector<VROParticle>::iterator it=_zombieParticles.begin(); it!=_zombieParticles.end(); ) {
-        VROParticle zombieParticle = *it;
-        if (zombieParticle.killedTimeMs + zombieParticle.zombiePeriodMs < currentTime) {
-            _zombieParticles.erase(it);
-        } else {
-            ++it;
+        if (!_pool.add(particle)) {
+            return;
         }
     }
 }
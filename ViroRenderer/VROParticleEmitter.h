@@ -28,14 +28,30 @@
 
 #include "VRODriver.h"
 #include "VROParticleModifier.h"
+#include "VROParticlePool.h"
 
 // Assumed mass of a single particle, used for all physics calculations.
 static float kAssumedParticleMass = 1;
 
 class VROSurface;
 class VROParticleUBO;
+class VROGPUParticleUBO;
+class VROInstancedUBO;
 class VROParticle;
 class VROTexture;
+class VROShaderModifier;
+class VROMaterial;
+
+/*
+ Where particles are simulated. CPU simulation advances and uploads every particle
+ each frame. GPU simulation writes each particle's state once, when it spawns, and
+ evaluates its motion and modifiers in the vertex shader, which scales to far
+ larger particle counts (see VROGPUParticleUBO).
+ */
+enum class VROParticleSimulation {
+    CPU,
+    GPU
+};
 
 /*
  Volume describing the area around which particles spawn within / around.
@@ -140,6 +156,37 @@ public:
     void setBlendMode(VROBlendMode mode);
     void setBloomThreshold(float threshold);
 
+    /*
+     Soft particles fade out as they approach the geometry behind them, over the given
+     distance in meters, instead of clipping sharply where they intersect it. The scene
+     depth is read at each fragment through framebuffer fetch, so no depth copy and no
+     extra pass are needed; this requires VRODriver::isFramebufferFetchDepthSupported(),
+     and is ignored on drivers without it. A distance of zero or less disables soft
+     particles.
+     */
+    void setSoftParticleDistance(float distance, std::shared_ptr<VRODriver> driver);
+    float getSoftParticleDistance() const {
+        return _softParticleDistance;
+    }
+
+    /*
+     Render particles with additive blending, exempt from the back to front sort of
+     transparent objects (see VROMaterial::setOrderIndependent). Additive blending is
+     commutative, so the particles of any number of order-independent emitters blend
+     correctly in whatever order they are drawn. Disabling restores alpha blending.
+     */
+    void setOrderIndependent(bool orderIndependent);
+
+    /*
+     Set whether particles are simulated on the CPU or on the GPU. Changing the
+     simulation kills all particles and replaces the shader modifiers on the
+     particle surface's material.
+     */
+    void setSimulation(VROParticleSimulation simulation, std::shared_ptr<VRODriver> driver);
+    VROParticleSimulation getSimulation() const {
+        return _simulation;
+    }
+
     /*
      True if we are no longer emitting particles and have completed the emission cycle.
      */
@@ -239,18 +286,18 @@ protected:
     std::shared_ptr<VROSurface> _particleGeometry;
 
     /*
-     List of all particles in the scene for this emitter. This includes active particles (particles
-     that have just been spawned and are animating in the scene) and also zombie particles
-     (particles that are just killed and become a zombie temporarily before being de-allocated
-     and removed from this list to encourage the recycling of particle objects).
+     Particles of emitters that manage their particles directly (VROFixedParticleEmitter).
+     _particles holds active particles, and _zombieParticles holds particles that have died,
+     kept temporarily so that they can be recycled. Simulated emitters keep their particles
+     in _pool instead.
      */
     std::vector<VROParticle> _particles;
-    
+    std::vector<VROParticle> _zombieParticles;
+
     /*
-     Vector containing all particles that have died so that they can be reused. Particles
-     in a zombie start after a certain time will be de-allocated.
+     The live particles of this emitter when it is simulated on the CPU.
      */
-    std::vector<VROParticle> _zombieParticles;
+    VROParticlePool _pool;
 
     /*
      The maximum number of active particles (not including zombie ones) that this emitter
@@ -258,6 +305,27 @@ protected:
      */
     int _maxParticles;
 
+    /*
+     The number of particles that may be alive this frame: _maxParticles, reduced by
+     the particle budget of the render context.
+     */
+    int _particleBudget;
+
+    /*
+     Where particles are simulated, and the UBO that simulates them when on the GPU.
+     In GPU simulation, _particles and _zombieParticles are unused.
+     */
+    VROParticleSimulation _simulation = VROParticleSimulation::CPU;
+    std::shared_ptr<VROGPUParticleUBO> _gpuParticles;
+
+    /*
+     The fade distance of soft particles, and the modifiers that apply it to the
+     particle surface's material. The modifiers are empty when soft particles are
+     disabled or unsupported.
+     */
+    float _softParticleDistance = 0;
+    std::vector<std::shared_ptr<VROShaderModifier>> _softParticleModifiers;
+
 private:
 
 #pragma mark - Particle Emission Behaviors
@@ -436,15 +504,30 @@ private:
      */
     void updateParticles(double currentTime, const VRORenderContext &context,
                          const VROMatrix4f &computedTransform, bool isCurrentlyDelayed);
-    void updateParticlePhysics(double currentTime);
-    void updateParticleAppearance(double currentTime);
-    void updateParticlesToBeKilled(double currentTime);
     void updateParticleSpawn(double currentTime, VROVector3f currentPos);
-    void updateZombieParticles(double currentTime);
 
     /*
-     Called when we wish to spawn new particles, given the numberOfParticles. To do so,
-     we firstly attempt to recycle zombie particles and create new ones if we do ever run out.
+     Spawns particles into, and advances, the GPU simulation.
+     */
+    void updateGPUParticles(double currentTime, const VROMatrix4f &computedTransform,
+                            bool isCurrentlyDelayed);
+
+    /*
+     Set the given UBO on the particle surface, replacing its material's shader
+     modifiers with those of the UBO.
+     */
+    void bindInstancedUBO(std::shared_ptr<VROInstancedUBO> instancedUBO);
+
+    /*
+     Replace all shader modifiers on the given particle material with those of the
+     given UBO, followed by the soft particle modifiers.
+     */
+    void addShaderModifiers(std::shared_ptr<VROMaterial> material,
+                            std::shared_ptr<VROInstancedUBO> instancedUBO);
+
+    /*
+     Called when we wish to spawn new particles, given the numberOfParticles. New particles
+     are added to _pool, which has a fixed capacity of _maxParticles.
      */
     void spawnParticle(int numberOfParticles, double currentTime);
 
@@ -106,14 +106,43 @@ public:
      with referenceFactor to the preset _referenceFactor.
      */
     VROVector3f applyModifier(VROParticle &particle, VROVector3f initialValue) {
+        return applyModifier(particle.timeSinceSpawnedInMs, particle.distanceTraveled, particle.velocity,
+                             initialValue);
+    }
+
+    /*
+     Apply the behavior of this modifier to the given initialValue, for a particle with
+     the given age in milliseconds, distance travelled, and speed.
+     */
+    VROVector3f applyModifier(double timeSinceSpawnedInMs, double distanceTraveled, double velocity,
+                              VROVector3f initialValue) const {
         if (_modifierInterval.size() <= 0) {
             return initialValue;
         }
 
-        double deltaFactor = getReferenceFactorForParticle(particle);
+        double deltaFactor = getReferenceFactorValue(timeSinceSpawnedInMs, distanceTraveled, velocity);
         return getFinalValue(initialValue, deltaFactor);
     }
 
+    /*
+     True if this modifier changes values over a particle's life. If false,
+     applyModifier always returns the initial value.
+     */
+    bool hasIntervals() const {
+        return !_modifierInterval.empty();
+    }
+
+    /*
+     The reference factor and sorted intervals of this modifier, used to evaluate
+     the modifier in the shader when particles are simulated on the GPU.
+     */
+    VROModifierFactor getReferenceFactor() const {
+        return _referenceFactor;
+    }
+    const std::vector<VROModifierInterval> &getIntervals() const {
+        return _modifierInterval;
+    }
+
 private:
     void init(VROVector3f minRange, VROVector3f maxRange, VROModifierFactor factor) {
         _initialMinValue = minRange;
@@ -160,23 +189,23 @@ private:
     }
 
     /*
-     Returns the referenceFactor factor value from the provided particle. The type of referenceFactor factor
-     is determined by this VROParticleModifier _referenceFactor.
+     Returns the referenceFactor factor value from the provided particle state. The type of
+     referenceFactor factor is determined by this VROParticleModifier _referenceFactor.
      */
-    double getReferenceFactorForParticle(const VROParticle &particle) {
+    double getReferenceFactorValue(double timeSinceSpawnedInMs, double distanceTraveled, double velocity) const {
         if (_referenceFactor == VROModifierFactor::Distance) {
-            return particle.distanceTraveled;
+            return distanceTraveled;
         } else if (_referenceFactor == VROModifierFactor::Velocity) {
-            return particle.velocity;
+            return velocity;
         }
-        return particle.timeSinceSpawnedInMs;
+        return timeSinceSpawnedInMs;
     }
 
     /*
      With the given particle, and based on this emitter's referenceFactor factor, determine the amount of
      passed time, distance, or velocity that is required to interpolate the desired value.
      */
-    VROVector3f getFinalValue(VROVector3f initialValue, double currentFactor) {
+    VROVector3f getFinalValue(VROVector3f initialValue, double currentFactor) const {
         VROVector3f start;
         VROVector3f end;
         for (int i = 0; i < _modifierInterval.size(); i++) {
@@ -233,7 +262,7 @@ private:
         return initialValue;
     }
 
-    VROVector3f interpolatePoint(VROVector3f &startValue, VROVector3f &endValue, float ratio) {
+    VROVector3f interpolatePoint(const VROVector3f &startValue, const VROVector3f &endValue, float ratio) const {
         VROVector3f final;
         if (ratio >= 1) {
             final = endValue;
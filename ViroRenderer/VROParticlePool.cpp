@@ -0,0 +1,327 @@
+//
+//  VROParticlePool.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROParticlePool.h"
+#include "VROParticle.h"
+#include "VROParticleModifier.h"
+#include "VROParticleUBO.h"
+#include "VROMath.h"
+#include <algorithm>
+#include <string.h>
+#include <float.h>
+
+/*
+ Number of particles processed per iteration of the arithmetic passes. Arrays are
+ padded to a multiple of this width, so the final group may include stale lanes,
+ which are never read back.
+ */
+static const int kParticleBatchWidth = 4;
+
+/*
+ The passes below use the compiler's vector extensions, which map to NEON on ARM
+ and SSE on x86.
+ */
+typedef float float4 __attribute__((__vector_size__(16)));
+
+static inline float4 load4(const float *src) {
+    float4 v;
+    memcpy(&v, src, sizeof(float4));
+    return v;
+}
+
+static inline void store4(float *dest, float4 v) {
+    memcpy(dest, &v, sizeof(float4));
+}
+
+static inline int paddedSize(int size) {
+    return (size + kParticleBatchWidth - 1) / kParticleBatchWidth * kParticleBatchWidth;
+}
+
+/*
+ Evaluate the given modifier for the first count particles, writing the results
+ to out. Modifiers without intervals leave every particle at its initial value.
+ */
+static void applyModifier(const VROParticleModifier *modifier, int count,
+                          const float *ageMs, const float *distance, const float *speed,
+                          const VROParticleStream3 &initial, VROParticleStream3 *out) {
+    if (!modifier->hasIntervals()) {
+        memcpy(out->x.data(), initial.x.data(), count * sizeof(float));
+        memcpy(out->y.data(), initial.y.data(), count * sizeof(float));
+        memcpy(out->z.data(), initial.z.data(), count * sizeof(float));
+        return;
+    }
+    
+    for (int i = 0; i < count; i++) {
+        VROVector3f value = modifier->applyModifier(ageMs[i], distance[i], speed[i],
+                                                    VROVector3f(initial.x[i], initial.y[i], initial.z[i]));
+        out->x[i] = value.x;
+        out->y[i] = value.y;
+        out->z[i] = value.z;
+    }
+}
+
+VROParticlePool::VROParticlePool() :
+    _capacity(0),
+    _count(0) {
+    
+}
+
+VROParticlePool::~VROParticlePool() {
+    
+}
+
+void VROParticlePool::setCapacity(int capacity) {
+    if (capacity == _capacity) {
+        return;
+    }
+    _capacity = capacity;
+    _count = 0;
+    
+    int size = paddedSize(capacity);
+    _spawnTimeMs.resize(size);
+    _expirationTimeMs.resize(size);
+    _spawnPosition.resize(size);
+    _initialVelocity.resize(size);
+    _initialAccel.resize(size);
+    _initialColor.resize(size);
+    _initialScale.resize(size);
+    _initialRotation.resize(size);
+    _initialAlpha.resize(size);
+    _fixedToEmitter.resize(size);
+    _spawnedWorldTransform.resize(size);
+    _spawnedWorldScale.resize(size);
+    _distanceTraveled.resize(size);
+    _speed.resize(size);
+    
+    _ageMs.resize(size);
+    _motionTime.resize(size);
+    _velocity.resize(size);
+    _accel.resize(size);
+    _position.resize(size);
+    _worldPosition.resize(size);
+    _scale.resize(size);
+    _rotation.resize(size);
+    _color.resize(size);
+    _alpha.resize(size);
+    
+    _instances.resize(size * kMaxFloatsPerInstance);
+    _colors.resize(size * 4);
+}
+
+void VROParticlePool::clear() {
+    _count = 0;
+}
+
+bool VROParticlePool::add(const VROParticle &particle) {
+    if (_count >= _capacity) {
+        return false;
+    }
+    int i = _count++;
+    
+    VROVector3f position = particle.spawnedLocalTransform.extractTranslation();
+    _spawnTimeMs[i] = particle.spawnTimeMs;
+    _expirationTimeMs[i] = particle.spawnTimeMs + particle.lifePeriodMs;
+    _spawnPosition.x[i] = position.x;
+    _spawnPosition.y[i] = position.y;
+    _spawnPosition.z[i] = position.z;
+    _initialVelocity.x[i] = particle.initialVelocity.x;
+    _initialVelocity.y[i] = particle.initialVelocity.y;
+    _initialVelocity.z[i] = particle.initialVelocity.z;
+    _initialAccel.x[i] = particle.initialAccel.x;
+    _initialAccel.y[i] = particle.initialAccel.y;
+    _initialAccel.z[i] = particle.initialAccel.z;
+    _initialColor.x[i] = particle.initialColor.x;
+    _initialColor.y[i] = particle.initialColor.y;
+    _initialColor.z[i] = particle.initialColor.z;
+    _initialScale.x[i] = particle.initialScale.x;
+    _initialScale.y[i] = particle.initialScale.y;
+    _initialScale.z[i] = particle.initialScale.z;
+    _initialRotation.x[i] = particle.initialRotation.x;
+    _initialRotation.y[i] = particle.initialRotation.y;
+    _initialRotation.z[i] = particle.initialRotation.z;
+    _initialAlpha.x[i] = particle.initialAlpha.x;
+    _initialAlpha.y[i] = particle.initialAlpha.y;
+    _initialAlpha.z[i] = particle.initialAlpha.z;
+    _fixedToEmitter[i] = particle.fixedToEmitter ? 1 : 0;
+    _spawnedWorldTransform[i] = particle.spawnedWorldTransform;
+    
+    VROVector3f spawnedScale = particle.spawnedWorldTransform.extractScale();
+    _spawnedWorldScale.x[i] = spawnedScale.x;
+    _spawnedWorldScale.y[i] = spawnedScale.y;
+    _spawnedWorldScale.z[i] = spawnedScale.z;
+    _distanceTraveled[i] = 0;
+    _speed[i] = particle.initialVelocity.magnitude();
+    return true;
+}
+
+void VROParticlePool::move(int from, int to) {
+    _spawnTimeMs[to] = _spawnTimeMs[from];
+    _expirationTimeMs[to] = _expirationTimeMs[from];
+    
+    VROParticleStream3 *streams[] = { &_spawnPosition, &_initialVelocity, &_initialAccel, &_initialColor,
+                                      &_initialScale, &_initialRotation, &_initialAlpha, &_spawnedWorldScale };
+    for (VROParticleStream3 *stream : streams) {
+        stream->x[to] = stream->x[from];
+        stream->y[to] = stream->y[from];
+        stream->z[to] = stream->z[from];
+    }
+    _fixedToEmitter[to] = _fixedToEmitter[from];
+    _spawnedWorldTransform[to] = _spawnedWorldTransform[from];
+    _distanceTraveled[to] = _distanceTraveled[from];
+    _speed[to] = _speed[from];
+}
+
+void VROParticlePool::killExpired(double currentTimeMs) {
+    int i = 0;
+    while (i < _count) {
+        if (_expirationTimeMs[i] < currentTimeMs) {
+            move(_count - 1, i);
+            --_count;
+        } else {
+            ++i;
+        }
+    }
+}
+
+VROBoundingBox VROParticlePool::update(double currentTimeMs, const VROMatrix4f &emitterTransform,
+                                       double decelerationPeriodSec, const VROParticlePoolModifiers &modifiers) {
+    int count = _count;
+    if (count == 0) {
+        return VROBoundingBox(0, 0, 0, 0, 0, 0);
+    }
+    int batched = paddedSize(count);
+    
+    // Ages are computed in double precision, since spawn times are absolute
+    float maxMotionTime = decelerationPeriodSec >= 0 ? decelerationPeriodSec : FLT_MAX;
+    for (int i = 0; i < count; i++) {
+        float ageMs = currentTimeMs - _spawnTimeMs[i];
+        _ageMs[i] = ageMs;
+        _motionTime[i] = std::min(ageMs / 1000.0f, maxMotionTime);
+    }
+    
+    // Physics modifiers interpolate against the distance and speed of the last update
+    applyModifier(modifiers.velocity, count, _ageMs.data(), _distanceTraveled.data(), _speed.data(),
+                  _initialVelocity, &_velocity);
+    applyModifier(modifiers.acceleration, count, _ageMs.data(), _distanceTraveled.data(), _speed.data(),
+                  _initialAccel, &_accel);
+    
+    // Equations of motion, assuming constant velocity and acceleration. The distance and
+    // speed are stored squared, then square-rooted below
+    for (int i = 0; i < batched; i += kParticleBatchWidth) {
+        float4 t = load4(&_motionTime[i]);
+        float4 halfT2 = t * t * 0.5f;
+        
+        float4 vx = load4(&_velocity.x[i]), vy = load4(&_velocity.y[i]), vz = load4(&_velocity.z[i]);
+        float4 ax = load4(&_accel.x[i]), ay = load4(&_accel.y[i]), az = load4(&_accel.z[i]);
+        
+        float4 dx = vx * t + ax * halfT2;
+        float4 dy = vy * t + ay * halfT2;
+        float4 dz = vz * t + az * halfT2;
+        store4(&_position.x[i], load4(&_spawnPosition.x[i]) + dx);
+        store4(&_position.y[i], load4(&_spawnPosition.y[i]) + dy);
+        store4(&_position.z[i], load4(&_spawnPosition.z[i]) + dz);
+        
+        float4 fx = vx + ax * t, fy = vy + ay * t, fz = vz + az * t;
+        store4(&_distanceTraveled[i], dx * dx + dy * dy + dz * dz);
+        store4(&_speed[i], fx * fx + fy * fy + fz * fz);
+    }
+    for (int i = 0; i < count; i++) {
+        _distanceTraveled[i] = sqrtf(_distanceTraveled[i]);
+        _speed[i] = sqrtf(_speed[i]);
+    }
+    
+    // Appearance modifiers interpolate against the distance and speed just computed
+    applyModifier(modifiers.alpha, count, _ageMs.data(), _distanceTraveled.data(), _speed.data(),
+                  _initialAlpha, &_alpha);
+    applyModifier(modifiers.color, count, _ageMs.data(), _distanceTraveled.data(), _speed.data(),
+                  _initialColor, &_color);
+    applyModifier(modifiers.scale, count, _ageMs.data(), _distanceTraveled.data(), _speed.data(),
+                  _initialScale, &_scale);
+    applyModifier(modifiers.rotation, count, _ageMs.data(), _distanceTraveled.data(), _speed.data(),
+                  _initialRotation, &_rotation);
+    
+    // World positions, first assuming every particle is fixed to the emitter, then
+    // correcting the particles that are not
+    const float *e = emitterTransform.getArray();
+    for (int i = 0; i < batched; i += kParticleBatchWidth) {
+        float4 px = load4(&_position.x[i]), py = load4(&_position.y[i]), pz = load4(&_position.z[i]);
+        store4(&_worldPosition.x[i], px * e[0] + py * e[4] + pz * e[8]  + e[12]);
+        store4(&_worldPosition.y[i], px * e[1] + py * e[5] + pz * e[9]  + e[13]);
+        store4(&_worldPosition.z[i], px * e[2] + py * e[6] + pz * e[10] + e[14]);
+    }
+    for (int i = 0; i < count; i++) {
+        if (!_fixedToEmitter[i]) {
+            VROVector3f world = _spawnedWorldTransform[i].multiply(VROVector3f(_position.x[i], _position.y[i], _position.z[i]));
+            _worldPosition.x[i] = world.x;
+            _worldPosition.y[i] = world.y;
+            _worldPosition.z[i] = world.z;
+        }
+    }
+    
+    float minX = FLT_MAX, maxX = -FLT_MAX, minY = FLT_MAX, maxY = -FLT_MAX, minZ = FLT_MAX, maxZ = -FLT_MAX;
+    for (int i = 0; i < count; i++) {
+        minX = std::min(minX, _worldPosition.x[i]);
+        maxX = std::max(maxX, _worldPosition.x[i]);
+        minY = std::min(minY, _worldPosition.y[i]);
+        maxY = std::max(maxY, _worldPosition.y[i]);
+        minZ = std::min(minZ, _worldPosition.z[i]);
+        maxZ = std::max(maxZ, _worldPosition.z[i]);
+    }
+    
+    // Write each particle's instance data. Only the scale of the emitter (or spawned world)
+    // transform carries over to the particle, since the vertex shader replaces its
+    // orientation with the billboard rotation
+    VROVector3f emitterScale = emitterTransform.extractScale();
+    for (int i = 0; i < count; i++) {
+        float sx = emitterScale.x, sy = emitterScale.y, sz = emitterScale.z;
+        if (!_fixedToEmitter[i]) {
+            sx = _spawnedWorldScale.x[i];
+            sy = _spawnedWorldScale.y[i];
+            sz = _spawnedWorldScale.z[i];
+        }
+        
+        float *instance = &_instances[i * kMaxFloatsPerInstance];
+        instance[0]  = _worldPosition.x[i];
+        instance[1]  = _worldPosition.y[i];
+        instance[2]  = _worldPosition.z[i];
+        instance[3]  = 1;
+        instance[4]  = _scale.x[i] * sx;
+        instance[5]  = _scale.y[i] * sy;
+        instance[6]  = _scale.z[i] * sz;
+        instance[7]  = 0;
+        instance[8]  = _rotation.x[i];
+        instance[9]  = _rotation.y[i];
+        instance[10] = _rotation.z[i];
+        instance[11] = 0;
+        
+        float *color = &_colors[i * 4];
+        color[0] = _color.x[i];
+        color[1] = _color.y[i];
+        color[2] = _color.z[i];
+        color[3] = _alpha.x[i];
+    }
+    
+    return VROBoundingBox(minX, maxX, minY, maxY, minZ, maxZ);
+}
@@ -0,0 +1,189 @@
+//
+//  VROParticlePool.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROParticlePool_h
+#define VROParticlePool_h
+
+#include <vector>
+#include <stdint.h>
+#include "VROMatrix4f.h"
+#include "VROVector3f.h"
+#include "VROBoundingBox.h"
+
+struct VROParticle;
+class VROParticleModifier;
+
+/*
+ A three-component property stored as one contiguous array per component.
+ */
+struct VROParticleStream3 {
+    std::vector<float> x, y, z;
+    
+    void resize(int size) {
+        x.resize(size);
+        y.resize(size);
+        z.resize(size);
+    }
+};
+
+/*
+ The modifiers of a VROParticleEmitter, applied to every particle in a pool.
+ */
+struct VROParticlePoolModifiers {
+    const VROParticleModifier *alpha;
+    const VROParticleModifier *color;
+    const VROParticleModifier *scale;
+    const VROParticleModifier *rotation;
+    const VROParticleModifier *velocity;
+    const VROParticleModifier *acceleration;
+};
+
+/*
+ Fixed-capacity, structure-of-arrays store of the live particles of a CPU-simulated
+ VROParticleEmitter. Each property of the particles is a contiguous array, so each
+ step of the update streams through only the memory it needs, and the arithmetic
+ steps run four particles at a time.
+ 
+ Live particles are always packed at the front of the arrays: spawning appends a
+ particle, and killing a particle moves the last particle into its slot. The update
+ writes each particle's instance data (world position, scale and rotation) and color
+ contiguously, ready to be copied into a VROParticleUBO, whose vertex shader billboards
+ the particles.
+ */
+class VROParticlePool {
+public:
+    
+    VROParticlePool();
+    virtual ~VROParticlePool();
+    
+    /*
+     Set the maximum number of live particles. Changing the capacity kills all
+     particles.
+     */
+    void setCapacity(int capacity);
+    int getCapacity() const {
+        return _capacity;
+    }
+    
+    /*
+     Number of live particles.
+     */
+    int size() const {
+        return _count;
+    }
+    
+    /*
+     Add a particle initialized by VROParticleEmitter::resetParticle. Returns false
+     if the pool is full.
+     */
+    bool add(const VROParticle &particle);
+    
+    /*
+     Kill all particles.
+     */
+    void clear();
+    
+    /*
+     Kill the particles whose lifetimes ended before the given time.
+     */
+    void killExpired(double currentTimeMs);
+    
+    /*
+     Advance every particle to the given time: apply the modifiers and equations of
+     motion, and compute each particle's world position, scale, rotation and color.
+     Particles fixed to the emitter follow the emitter transform. The deceleration
+     period is the time in seconds after which particles stop moving; negative if
+     none. Returns the bounds of the particle positions.
+     */
+    VROBoundingBox update(double currentTimeMs, const VROMatrix4f &emitterTransform,
+                          double decelerationPeriodSec, const VROParticlePoolModifiers &modifiers);
+    
+    /*
+     The instance data (kMaxFloatsPerInstance floats, see VROParticleUBO) and
+     colors (4 floats) of each live particle, as of the last update.
+     */
+    const float *getInstances() const {
+        return _instances.data();
+    }
+    const float *getColors() const {
+        return _colors.data();
+    }
+    
+private:
+    
+    int _capacity;
+    int _count;
+    
+#pragma mark - Particle State
+    
+    /*
+     State set when each particle spawns. Positions, velocities and accelerations are
+     relative to the emitter, or to the particle's spawned world transform if the
+     particle is not fixed to the emitter.
+     */
+    std::vector<double> _spawnTimeMs;
+    std::vector<double> _expirationTimeMs;
+    VROParticleStream3 _spawnPosition;
+    VROParticleStream3 _initialVelocity;
+    VROParticleStream3 _initialAccel;
+    VROParticleStream3 _initialColor;
+    VROParticleStream3 _initialScale;
+    VROParticleStream3 _initialRotation;
+    VROParticleStream3 _initialAlpha;
+    std::vector<uint8_t> _fixedToEmitter;
+    std::vector<VROMatrix4f> _spawnedWorldTransform;
+    VROParticleStream3 _spawnedWorldScale;
+    
+    /*
+     Distance travelled and speed as of the last update. Physics modifiers that
+     interpolate against distance or velocity use the values from the last update.
+     */
+    std::vector<float> _distanceTraveled;
+    std::vector<float> _speed;
+    
+#pragma mark - Per-Update Scratch
+    
+    std::vector<float> _ageMs;
+    std::vector<float> _motionTime;
+    VROParticleStream3 _velocity;
+    VROParticleStream3 _accel;
+    VROParticleStream3 _position;
+    VROParticleStream3 _worldPosition;
+    VROParticleStream3 _scale;
+    VROParticleStream3 _rotation;
+    VROParticleStream3 _color;
+    VROParticleStream3 _alpha;
+    
+    std::vector<float> _instances;
+    std::vector<float> _colors;
+    
+    /*
+     Move the spawn state of the particle in slot from into slot to.
+     */
+    void move(int from, int to);
+    
+};
+
+#endif /* VROParticlePool_h */
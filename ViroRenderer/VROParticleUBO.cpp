@@ -24,6 +24,7 @@
 //  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include <vector>
+#include <algorithm>
 #include "VROParticle.h"
 #include "VROParticleUBO.h"
 #include "VROMath.h"
@@ -31,27 +32,38 @@
 #include "VROShaderModifier.h"
 #include "VRODriverOpenGL.h"
 #include "VROParticleEmitter.h"
+#include "VROStringUtil.h"
 
-VROParticleUBO::VROParticleUBO(std::shared_ptr<VRODriver> driver) {
+VROParticleUBO::VROParticleUBO(std::shared_ptr<VRODriver> driver) :
+    _uploadPending(false) {
     _driver = driver;
     _lastKnownBoundingBox = VROBoundingBox(0, 0, 0, 0, 0, 0);
 
-    // Initialize data to something sane
-    VROParticlesUBOVertexData vertexData;
-    memset(vertexData.particles_transform, 0x0, kMaxParticlesPerUBO * kMaxFloatsPerTransform * sizeof(float));
-    
-    VROParticlesUBOFragmentData fragmentData;
-    memset(fragmentData.frag_particles_color, 0x0, kMaxParticlesPerUBO * kMaxFloatsPerColor * sizeof(float));
+    GLint maxBlockSize = 0;
+    GLint alignment = 1;
+    GL( glGetIntegerv(GL_MAX_UNIFORM_BLOCK_SIZE, &maxBlockSize) );
+    GL( glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment) );
+    alignment = std::max(alignment, 1);
+
+    _particlesPerUBO = maxBlockSize >= kMaxParticlesPerUBO * kMaxFloatsPerInstance * (int) sizeof(float) ?
+                       kMaxParticlesPerUBO : kMinParticlesPerUBO;
+    GLsizeiptr vertexWindowSize = _particlesPerUBO * kMaxFloatsPerInstance * sizeof(float);
+    GLsizeiptr fragmentWindowSize = _particlesPerUBO * kMaxFloatsPerColor * sizeof(float);
+    _vertexWindowStride = ((vertexWindowSize + alignment - 1) / alignment) * alignment;
+    _fragmentWindowStride = ((fragmentWindowSize + alignment - 1) / alignment) * alignment;
+
+    // Initialize one window of each buffer to something sane
+    std::vector<char> zeroes(std::max(vertexWindowSize, fragmentWindowSize), 0);
 
     // Set up Vertex UBO
     GL( glGenBuffers(1, &_particleVertexUBO) );
     GL( glBindBuffer(GL_UNIFORM_BUFFER, _particleVertexUBO) );
-    GL( glBufferData(GL_UNIFORM_BUFFER, sizeof(VROParticlesUBOVertexData), &vertexData, GL_DYNAMIC_DRAW) );
+    GL( glBufferData(GL_UNIFORM_BUFFER, vertexWindowSize, zeroes.data(), GL_DYNAMIC_DRAW) );
 
     // Set up Fragment UBO
     GL( glGenBuffers(1, &_particleFragmentUBO) );
     GL( glBindBuffer(GL_UNIFORM_BUFFER, _particleFragmentUBO) );
-    GL( glBufferData(GL_UNIFORM_BUFFER, sizeof(VROParticlesUBOFragmentData), &fragmentData, GL_DYNAMIC_DRAW) );
+    GL( glBufferData(GL_UNIFORM_BUFFER, fragmentWindowSize, zeroes.data(), GL_DYNAMIC_DRAW) );
 }
 
 VROParticleUBO::~VROParticleUBO() {
@@ -64,16 +76,21 @@ VROParticleUBO::~VROParticleUBO() {
 
 std::vector<std::shared_ptr<VROShaderModifier>> VROParticleUBO::createInstanceShaderModifier() {
     std::vector<std::shared_ptr<VROShaderModifier>> modifiers;
+    // The particle blocks are declared here rather than in particles_vsh, since their
+    // size depends on the device's maximum uniform block size
+    std::string numInstanceVectors = VROStringUtil::toString(_particlesPerUBO * 3);
+    std::string numColors = VROStringUtil::toString(_particlesPerUBO);
     std::vector<std::string> vertexModifierCode =  {
+            "layout (std140) uniform particles_vertex_data { highp vec4 particles_vertex_instance[" + numInstanceVectors + "]; };",
             "#include particles_vsh",
-            "_transforms.model_matrix = particles_vertex_transform[v_instance_id];",
+            "_transforms.model_matrix = particle_transform(v_instance_id, _transforms.view_matrix);",
     };
 
     // Note: A surface modifier is used here due to a bug in adding shader modifier code:
     // This is because bloom effects are applied before this code is run, resulting in
     // undesired effects. To get around that, we apply a surface modifier instead.
     std::vector<std::string> surfaceModifierCode = {
-            "#include particles_fsh",
+            "layout (std140) uniform particles_fragment_data { mediump vec4 particles_fragment_color[" + numColors + "]; };",
             "highp vec4 particleColor = particles_fragment_color[v_instance_id];"
             "highp vec4 dest =_surface.diffuse_color.xyzw;",
             "highp vec4 src = particleColor;",
@@ -95,67 +112,105 @@ std::vector<std::shared_ptr<VROShaderModifier>> VROParticleUBO::createInstanceSh
 }
 
 int VROParticleUBO::getNumberOfDrawCalls() {
-    if (_lastKnownParticles.size() == 0) {
+    int totalParticles = (int) (_lastKnownColors.size() / kMaxFloatsPerColor);
+    if (totalParticles == 0) {
         return -1;
     }
-
-    float totalParticles = _lastKnownParticles.size();
-    float maxParticlesPerUBO = kMaxParticlesPerUBO;
-    float requiredNumberOfDraws = ceil(totalParticles / maxParticlesPerUBO);
-    return (int) requiredNumberOfDraws;
+    return (totalParticles + _particlesPerUBO - 1) / _particlesPerUBO;
 }
 
 int VROParticleUBO::bindDrawData(int currentDrawCallIndex) {
-    if (_lastKnownParticles.size() == 0) {
+    int totalParticles = (int) (_lastKnownColors.size() / kMaxFloatsPerColor);
+    if (totalParticles == 0) {
         return 0;
     }
 
     // Grab the window of particles that corresponds to this currentDrawCallIndex
-    int start = currentDrawCallIndex * kMaxParticlesPerUBO;
-    int end = (currentDrawCallIndex + 1) * kMaxParticlesPerUBO;
-    if (_lastKnownParticles.size() < end ) {
-        end = (int) _lastKnownParticles.size() - 1;
+    int start = currentDrawCallIndex * _particlesPerUBO;
+    int end = std::min(totalParticles, (currentDrawCallIndex + 1) * _particlesPerUBO);
+    if (start >= end) {
+        return 0;
     }
-
-    // Parse / serialize the data into the uniform buffer object
-    VROParticlesUBOVertexData vertexData;
-    VROParticlesUBOFragmentData fragmentData;
-    for (int i = start; i < end; i++) {
-        const float *transformArray = _lastKnownParticles[i].currentWorldTransform.getArray();
-        memcpy(&vertexData.particles_transform[(i - start) * kMaxFloatsPerTransform],
-               transformArray,
-               kMaxFloatsPerTransform * sizeof(float));
-
-        fragmentData.frag_particles_color[(i - start) * 4 + 0] = _lastKnownParticles[i].colorCurrent.x;
-        fragmentData.frag_particles_color[(i - start) * 4 + 1] = _lastKnownParticles[i].colorCurrent.y;
-        fragmentData.frag_particles_color[(i - start) * 4 + 2] = _lastKnownParticles[i].colorCurrent.z;
-        fragmentData.frag_particles_color[(i - start) * 4 + 3] = _lastKnownParticles[i].colorCurrent.w;
+    if (_uploadPending) {
+        upload();
     }
 
-    // Finally bind the UBO to its corresponding buffers.
+    // Finally bind the window to its corresponding blocks.
     pglpush("Particles");
-    GL( glBindBufferBase(GL_UNIFORM_BUFFER, VROShaderProgram::sParticleVertexUBOBindingPoint, _particleVertexUBO) );
-#if VRO_AVOID_BUFFER_SUB_DATA
-    GL( glBufferData(GL_UNIFORM_BUFFER, sizeof(VROParticlesUBOVertexData), &vertexData, GL_DYNAMIC_DRAW) );
-#else
-    GL( glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(VROParticlesUBOVertexData), &vertexData) );
-#endif
+    GL( glBindBufferRange(GL_UNIFORM_BUFFER, VROShaderProgram::sParticleVertexUBOBindingPoint, _particleVertexUBO,
+                          currentDrawCallIndex * _vertexWindowStride,
+                          _particlesPerUBO * kMaxFloatsPerInstance * sizeof(float)) );
+    GL( glBindBufferRange(GL_UNIFORM_BUFFER, VROShaderProgram::sParticleFragmentUBOBindingPoint, _particleFragmentUBO,
+                          currentDrawCallIndex * _fragmentWindowStride,
+                          _particlesPerUBO * kMaxFloatsPerColor * sizeof(float)) );
     pglpop();
+    return end - start;
+}
 
-    pglpush("ParticlesFragment");
-    GL( glBindBufferBase(GL_UNIFORM_BUFFER, VROShaderProgram::sParticleFragmentUBOBindingPoint, _particleFragmentUBO) );
-#if VRO_AVOID_BUFFER_SUB_DATA
-    GL( glBufferData(GL_UNIFORM_BUFFER, sizeof(VROParticlesUBOFragmentData), &fragmentData, GL_DYNAMIC_DRAW) );
-#else
-    GL( glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(VROParticlesUBOFragmentData), &fragmentData) );
-#endif
+void VROParticleUBO::upload() {
+    int totalParticles = (int) (_lastKnownColors.size() / kMaxFloatsPerColor);
+    int numWindows = (totalParticles + _particlesPerUBO - 1) / _particlesPerUBO;
+
+    // Each buffer is reallocated (orphaned) with every upload, so that we never write to a
+    // buffer a previous frame's draws may still be reading. The last window is padded out
+    // to a full window, since that is the size of the bound range.
+    GLsizeiptr vertexSize = numWindows * _vertexWindowStride;
+    GLsizeiptr fragmentSize = numWindows * _fragmentWindowStride;
+    _staging.assign(std::max(vertexSize, fragmentSize), 0);
+
+    pglpush("ParticlesUpload");
+    for (int w = 0; w < numWindows; w++) {
+        int start = w * _particlesPerUBO;
+        int count = std::min(totalParticles - start, _particlesPerUBO);
+        memcpy(&_staging[w * _vertexWindowStride], &_lastKnownInstances[start * kMaxFloatsPerInstance],
+               count * kMaxFloatsPerInstance * sizeof(float));
+    }
+    GL( glBindBuffer(GL_UNIFORM_BUFFER, _particleVertexUBO) );
+    GL( glBufferData(GL_UNIFORM_BUFFER, vertexSize, _staging.data(), GL_DYNAMIC_DRAW) );
+
+    std::fill(_staging.begin(), _staging.end(), 0);
+    for (int w = 0; w < numWindows; w++) {
+        int start = w * _particlesPerUBO;
+        int count = std::min(totalParticles - start, _particlesPerUBO);
+        memcpy(&_staging[w * _fragmentWindowStride], &_lastKnownColors[start * kMaxFloatsPerColor],
+               count * kMaxFloatsPerColor * sizeof(float));
+    }
+    GL( glBindBuffer(GL_UNIFORM_BUFFER, _particleFragmentUBO) );
+    GL( glBufferData(GL_UNIFORM_BUFFER, fragmentSize, _staging.data(), GL_DYNAMIC_DRAW) );
     pglpop();
-    return end - start;
+
+    _uploadPending = false;
 }
 
 void VROParticleUBO::update(std::vector<VROParticle> &particles, VROBoundingBox &particleBox) {
-    _lastKnownParticles = particles;
+    _lastKnownInstances.assign(particles.size() * kMaxFloatsPerInstance, 0);
+    _lastKnownColors.resize(particles.size() * kMaxFloatsPerColor);
+    for (int i = 0; i < particles.size(); i++) {
+        VROVector3f position = particles[i].currentWorldTransform.extractTranslation();
+        VROVector3f scale = particles[i].currentWorldTransform.extractScale();
+
+        float *instance = &_lastKnownInstances[i * kMaxFloatsPerInstance];
+        instance[0] = position.x;
+        instance[1] = position.y;
+        instance[2] = position.z;
+        instance[4] = scale.x;
+        instance[5] = scale.y;
+        instance[6] = scale.z;
+
+        _lastKnownColors[i * kMaxFloatsPerColor + 0] = particles[i].colorCurrent.x;
+        _lastKnownColors[i * kMaxFloatsPerColor + 1] = particles[i].colorCurrent.y;
+        _lastKnownColors[i * kMaxFloatsPerColor + 2] = particles[i].colorCurrent.z;
+        _lastKnownColors[i * kMaxFloatsPerColor + 3] = particles[i].colorCurrent.w;
+    }
     _lastKnownBoundingBox = particleBox;
+    _uploadPending = true;
+}
+
+void VROParticleUBO::update(const float *instances, const float *colors, int count, const VROBoundingBox &box) {
+    _lastKnownInstances.assign(instances, instances + count * kMaxFloatsPerInstance);
+    _lastKnownColors.assign(colors, colors + count * kMaxFloatsPerColor);
+    _lastKnownBoundingBox = box;
+    _uploadPending = true;
 }
 
 VROBoundingBox VROParticleUBO::getInstancedBoundingBox() {
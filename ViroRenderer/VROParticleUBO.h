@@ -29,27 +29,15 @@
 #include "VROInstancedUBO.h"
 #include "VROAtomic.h"
 
-static const int kMaxParticlesPerUBO = 180;
-static const int kMaxFloatsPerTransform = 16;
-static const int kMaxFloatsPerColor = 4;
-
-/*
- Uniform buffer object structure format through which particle transform data are batched
- into the Vertex shader. Data is grouped in 4N slots, matching layout specified
- in particle_vsh.glsl.
- */
-typedef struct {
-    float particles_transform[kMaxParticlesPerUBO * kMaxFloatsPerTransform];
-} VROParticlesUBOVertexData;
-
 /*
- Uniform buffer object structure format through which particle "appearance" data are
- batched into the Fragment shader. Data is grouped in 4N slots, matching layout specified
- in particle_fsh.glsl.
+ Number of particles drawn per instanced draw call. Each draw binds a window of
+ this many particles; devices with 64KB uniform blocks take the larger window
+ (GLES 3.0 only guarantees 16KB).
  */
-typedef struct {
-    float frag_particles_color[kMaxParticlesPerUBO * kMaxFloatsPerColor];
-} VROParticlesUBOFragmentData;
+static const int kMinParticlesPerUBO = 340;
+static const int kMaxParticlesPerUBO = 1360;
+static const int kMaxFloatsPerInstance = 12;
+static const int kMaxFloatsPerColor = 4;
 
 class VROParticle;
 
@@ -57,6 +45,16 @@ class VROParticle;
  VROParticleUBO handles the binding and batching of particle information into the vertex
  and fragment shaders for instance rendering. Note that any instance of a given VROParticleUBO
  will always bind data to the same uniform buffers (Binding Point and Buffer ID).
+
+ Per-particle instance data is batched into the particles_vertex_data block. Each particle
+ is three vec4s: its world position, its scale, and its rotation about X, Y and Z (radians),
+ each in xyz. The vertex shader billboards each particle toward the camera, so the model
+ matrix is never stored. Colors are batched into the particles_fragment_data block, one
+ vec4 per particle.
+
+ All particles are streamed into one vertex and one fragment buffer, once per update, with
+ each draw's window at an aligned offset. Each draw call, eye, and render pass then only
+ rebinds a range of those buffers.
  */
 class VROParticleUBO : public VROInstancedUBO {
 public:
@@ -73,18 +71,27 @@ public:
     int getNumberOfDrawCalls();
 
     /*
-     Binds all VROParticlesUBOVertexData and VROParticlesUBOFragmentData to its corresponding
-     vertex and fragment uniform buffers so that they can be referred to and processed
-     by shader modifiers crated with createInstanceShaderModifier().
+     Binds the window of particle instance data and colors for the given draw call to the
+     vertex and fragment uniform blocks, so that they can be referred to and processed
+     by shader modifiers crated with createInstanceShaderModifier(). The particles are
+     uploaded by the first bind after an update.
      */
     int bindDrawData(int currentDrawCallIndex);
 
     /*
      Update the data in this UBO with the latest list of instanced particle data
-     like transformation matrix / color.
+     like transformation matrix / color. Only the position and scale of each particle's
+     currentWorldTransform are used: particles are always billboarded by the shader.
      */
     void update(std::vector<VROParticle> &particles, VROBoundingBox &box);
 
+    /*
+     Update the data in this UBO with contiguous arrays of per-particle instance data
+     (kMaxFloatsPerInstance floats each, laid out as in particles_vertex_data) and
+     colors (4 floats each), as produced by VROParticlePool.
+     */
+    void update(const float *instances, const float *colors, int count, const VROBoundingBox &box);
+
     /*
      Returns a bounding box that encapsulates all _lastKnownParticles.
      */
@@ -99,17 +106,35 @@ private:
     GLuint _particleVertexUBO;
     GLuint _particleFragmentUBO;
 
+    /*
+     The number of particles per draw call, and the stride between the windows of
+     consecutive draw calls in each buffer (aligned to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT).
+     */
+    int _particlesPerUBO;
+    GLsizeiptr _vertexWindowStride;
+    GLsizeiptr _fragmentWindowStride;
+
+    /*
+     True when the particles have been updated since they were last uploaded. The staging
+     buffer holds the windows laid out at their strides for the upload.
+     */
+    bool _uploadPending;
+    std::vector<char> _staging;
+
+    void upload();
+
     /*
      The driver that created this UBO.
      */
     std::weak_ptr<VRODriver> _driver;
     
     /*
-     The particles and the bounding box after the last update. Note that the bounding
-     box is atomic becuase it may be accessed from the application thread (see VRONode's
-     application properties).
+     The particle instance data, colors, and bounding box after the last update. Note that
+     the bounding box is atomic becuase it may be accessed from the application thread
+     (see VRONode's application properties).
      */
-    std::vector<VROParticle> _lastKnownParticles;
+    std::vector<float> _lastKnownInstances;
+    std::vector<float> _lastKnownColors;
     VROAtomic<VROBoundingBox> _lastKnownBoundingBox;
 };
 
@@ -26,43 +26,81 @@
 #include "VROPencil.h"
 #include "VROPhysicsBody.h"
 #include "VRONode.h"
+#include "VROBoundingBox.h"
 #include "VROPolyline.h"
 #include "VROMaterial.h"
 
 VROPencil::~VROPencil() {
-    _paths.clear();
+
 }
 
 void VROPencil::draw(VROVector3f from, VROVector3f to) {
-    std::vector<VROVector3f> pathTot;
-    pathTot.push_back(from);
-    pathTot.push_back(to);
-    _paths.push_back(pathTot);
+    _endpoints.push_back(from);
+    _endpoints.push_back(to);
+    _linesUpdated = true;
+}
+
+void VROPencil::drawBox(const VROBoundingBox &box) {
+    VROVector3f corners[8];
+    for (int i = 0; i < 8; i++) {
+        corners[i] = { (i & 1) ? box.getMaxX() : box.getMinX(),
+                       (i & 2) ? box.getMaxY() : box.getMinY(),
+                       (i & 4) ? box.getMaxZ() : box.getMinZ() };
+    }
+    // Each edge joins two corners that differ in exactly one axis bit
+    for (int i = 0; i < 8; i++) {
+        for (int axis = 1; axis < 8; axis <<= 1) {
+            if (!(i & axis)) {
+                draw(corners[i], corners[i | axis]);
+            }
+        }
+    }
+}
+
+void VROPencil::drawPoint(VROVector3f point, float size) {
+    float half = size / 2.0f;
+    draw(point - VROVector3f(half, 0, 0), point + VROVector3f(half, 0, 0));
+    draw(point - VROVector3f(0, half, 0), point + VROVector3f(0, half, 0));
+    draw(point - VROVector3f(0, 0, half), point + VROVector3f(0, 0, half));
 }
 
 void VROPencil::clear() {
-    _paths.clear();
+    if (!_endpoints.empty()) {
+        _endpoints.clear();
+        _linesUpdated = true;
+    }
 }
 
 void VROPencil::render(const VRORenderContext &context, std::shared_ptr<VRODriver> &driver) {
-    if (_paths.size() == 0) {
+    if (_endpoints.empty()) {
         return;
     }
 
-    std::shared_ptr<VROMaterial> pencilMaterial = std::make_shared<VROMaterial>();
-    pencilMaterial->getDiffuse().setColor({1.0, 0, 0, 1.0});
-    pencilMaterial->setCullMode(VROCullMode::None);
-    pencilMaterial->setLightingModel(VROLightingModel::Constant);
-    pencilMaterial->setWritesToDepthBuffer(false);
-    pencilMaterial->setReadsFromDepthBuffer(false);
-    pencilMaterial->bindShader(0, {}, context, driver);
-    pencilMaterial->bindProperties(driver);
-
-    std::shared_ptr<VROPolyline> line = VROPolyline::createPolyline(_paths, _brushThickness);
-    line->setMaterials({ pencilMaterial });
+    if (!_material) {
+        _material = std::make_shared<VROMaterial>();
+        _material->getDiffuse().setColor({1.0, 0, 0, 1.0});
+        _material->setCullMode(VROCullMode::None);
+        _material->setLightingModel(VROLightingModel::Constant);
+        _material->setWritesToDepthBuffer(false);
+        _material->setReadsFromDepthBuffer(false);
+    }
+    
+    // The line is recreated only when the brush changes; otherwise its buffers are reused
+    if (!_line || _lineThickness != _brushThickness) {
+        std::vector<std::vector<VROVector3f>> paths;
+        _line = VROPolyline::createPolyline(paths, _brushThickness);
+        _line->setDynamic(true);
+        _line->setMaterials({ _material });
+        _lineThickness = _brushThickness;
+        _linesUpdated = true;
+    }
+    if (_linesUpdated) {
+        _line->setSegments(_endpoints);
+        _linesUpdated = false;
+    }
 
-    pencilMaterial->bindShader(0, {}, context, driver);
-    pencilMaterial->bindProperties(driver);
-    line->render(0, pencilMaterial, VROMatrix4f::identity(), VROMatrix4f::identity(),
-                 1.0, context, driver);
+    _material->bindShader(0, {}, context, driver);
+    _material->bindProperties(driver);
+    _line->render(0, _material, VROMatrix4f::identity(), VROMatrix4f::identity(),
+                  1.0, context, driver);
 }
@@ -36,16 +36,21 @@ class VRODriver;
 class VROVector3f;
 class VROVector4f;
 class VROMaterial;
+class VROPolyline;
+class VROBoundingBox;
 
 /*
- Stored in VRORenderContext, VROPencil is used to draw a list of VROPolylines
- in a separate render pass, after having rendered the scene, mainly for drawing
- debug information.
+ Stored in VRORenderContext, VROPencil is used to draw lines in a separate render
+ pass, after having rendered the scene, mainly for drawing debug information. All
+ lines are batched into a single dynamic polyline that persists across frames, so
+ each frame streams its lines into the same buffers and draws them with one call.
  */
 class VROPencil {
 public:
-    VROPencil() {
-        _brushThickness = 0.05f;
+    VROPencil() :
+        _brushThickness(0.05f),
+        _lineThickness(0),
+        _linesUpdated(false) {
     }
     virtual ~VROPencil();
 
@@ -53,6 +58,17 @@ public:
      Adds a line to be drawn starting and ending at the provided world coordinates.
      */
     void draw(VROVector3f from, VROVector3f to);
+    
+    /*
+     Adds the twelve edges of the given world space box.
+     */
+    void drawBox(const VROBoundingBox &box);
+    
+    /*
+     Adds a point, drawn as three axis-aligned lines of the given size crossing
+     at the given world coordinates.
+     */
+    void drawPoint(VROVector3f point, float size);
 
     /*
      Renders the geometry of all lines added with VROPencil.draw(), called in VRORenderer.renderEye(),
@@ -73,8 +89,22 @@ public:
     }
 
 private:
-    std::vector<std::vector<VROVector3f>> _paths;
+    
+    /*
+     The endpoints of the lines added this frame, in pairs.
+     */
+    std::vector<VROVector3f> _endpoints;
     float _brushThickness;
+    
+    /*
+     The polyline and material all lines are drawn with, the thickness the
+     polyline was created with, and true if lines were added or cleared since
+     they were last written to the polyline.
+     */
+    std::shared_ptr<VROPolyline> _line;
+    std::shared_ptr<VROMaterial> _material;
+    float _lineThickness;
+    bool _linesUpdated;
 };
 
 #endif
@@ -29,6 +29,7 @@
 #include <LinearMath/btTransform.h>
 #include "VRONode.h"
 #include "VROPhysicsMotionState.h"
+#include "VROPhysicsWorld.h"
 #include "VROStringUtil.h"
 #include <btBulletDynamicsCommon.h>
 
@@ -54,13 +55,17 @@ VROPhysicsBody::VROPhysicsBody(std::shared_ptr<VRONode> node, VROPhysicsBody::VR
     _type = type;
     _mass = mass;
     _inertia = VROVector3f(1,1,1);
+    _world = nullptr;
+    _worldIndex = -1;
+    _dirty = false;
 
-    ++sPhysicsBodyIdCounter;
-    _key = VROStringUtil::toString(sPhysicsBodyIdCounter);
+    _id = ++sPhysicsBodyIdCounter;
+    _key = VROStringUtil::toString((int) _id);
     createBulletBody();
 
     // Schedule this physics body for an update in the computePhysics pass.
     _needsBulletUpdate = true;
+    _needsBulletReinsert = true;
 }
 
 VROPhysicsBody::~VROPhysicsBody() {
@@ -157,6 +162,8 @@ void VROPhysicsBody::setType(VROPhysicsBodyType type, float mass) {
     _type = type;
     setMass(mass);
     _needsBulletUpdate = true;
+    _needsBulletReinsert = true;
+    markDirty();
 }
 
 void VROPhysicsBody::setKinematicDrag(bool isDragging){
@@ -185,6 +192,7 @@ void VROPhysicsBody::setUseGravity(bool useGravity) {
     if (useGravity){
         _rigidBody->activate(true);
     }
+    markDirty();
 }
 
 bool VROPhysicsBody::getUseGravity() {
@@ -199,10 +207,12 @@ void VROPhysicsBody::setPhysicsShape(std::shared_ptr<VROPhysicsShape> shape) {
 
     // Bullet needs to refresh it's underlying object when changing its physics shape.
     _needsBulletUpdate = true;
+    markDirty();
 }
 
 void VROPhysicsBody::refreshBody() {
     _needsBulletUpdate = true;
+    markDirty();
 }
 
 void VROPhysicsBody::setIsSimulated(bool enabled) {
@@ -211,6 +221,8 @@ void VROPhysicsBody::setIsSimulated(bool enabled) {
     }
     _enableSimulation = enabled;
     _needsBulletUpdate = true;
+    _needsBulletReinsert = true;
+    markDirty();
 }
 
 bool VROPhysicsBody::getIsSimulated() {
@@ -230,6 +242,26 @@ bool VROPhysicsBody::needsBulletUpdate() {
     return _needsBulletUpdate;
 }
 
+bool VROPhysicsBody::needsBulletReinsert() {
+    return _needsBulletReinsert;
+}
+
+void VROPhysicsBody::markDirty() {
+    if (_world != nullptr && !_dirty) {
+        _world->markBodyDirty(this);
+    }
+}
+
+void VROPhysicsBody::updateBulletGravity(const btVector3 &worldGravity) {
+    if (_useGravity) {
+        _rigidBody->setFlags(_rigidBody->getFlags() & ~BT_DISABLE_WORLD_GRAVITY);
+        _rigidBody->setGravity(worldGravity);
+    } else {
+        _rigidBody->setFlags(_rigidBody->getFlags() | BT_DISABLE_WORLD_GRAVITY);
+        _rigidBody->setGravity({0, 0, 0});
+    }
+}
+
 void VROPhysicsBody::updateBulletRigidBody() {
     if (!_needsBulletUpdate) {
         return;
@@ -245,6 +277,16 @@ void VROPhysicsBody::updateBulletRigidBody() {
     // If shape is not defined, we attempt to infer the shape from the node's geometry.
     if (_shape == nullptr && node->getGeometry()) {
         _shape = std::make_shared<VROPhysicsShape>(node, false);
+    } else if (_shape && _shape->getType() == VROPhysicsShape::VROShapeType::AutoConvex) {
+        // Convex decomposition completes asynchronously; regenerate the shape from the
+        // cached hulls once it does
+        std::weak_ptr<VROPhysicsBody> body_w = shared_from_this();
+        _shape = std::make_shared<VROPhysicsShape>(node, [body_w] {
+            std::shared_ptr<VROPhysicsBody> body = body_w.lock();
+            if (body) {
+                body->refreshBody();
+            }
+        });
     } else if (_shape && _shape->getIsGeneratedFromGeometry()) {
         _shape = std::make_shared<VROPhysicsShape>(node, _shape->getIsCompoundShape());
     } else if (_shape == nullptr) {
@@ -356,6 +398,7 @@ void VROPhysicsBody::updateBulletRigidBody() {
 
     // Set flag to false indicating that the modifications has applied to the bullet rigid body.
     _needsBulletUpdate = false;
+    _needsBulletReinsert = false;
 }
 
 void VROPhysicsBody::getWorldTransform(btTransform& centerOfMassWorldTrans) const {
@@ -406,10 +449,12 @@ void VROPhysicsBody::applyForce(VROVector3f power, VROVector3f position) {
     bulletForce.force = power;
     bulletForce.location = position;
     _forces.push_back(bulletForce);
+    markDirty();
 }
 
 void VROPhysicsBody::applyTorque(VROVector3f torque) {
     _torques.push_back(torque);
+    markDirty();
 }
 
 void VROPhysicsBody::clearForces() {
@@ -441,6 +486,11 @@ void VROPhysicsBody::setVelocity(VROVector3f velocity, bool isConstant) {
     } else {
         _instantVelocity = velocity;
     }
+    markDirty();
+}
+
+bool VROPhysicsBody::hasPersistentForces() {
+    return !_forces.empty() || !_torques.empty() || _constantVelocity.magnitude() > 0;
 }
 
 void VROPhysicsBody::applyPresetVelocity() {
@@ -38,6 +38,7 @@ class btMotionState;
 class btRigidBody;
 class btVector3;
 class VROPhysicsBodyDelegate;
+class VROPhysicsWorld;
 
 //Atomic counter used to grab a unique Id to represent a VROPhysicsBody.
 static std::atomic_int sPhysicsBodyIdCounter;
@@ -112,8 +113,12 @@ public:
 
     /*
      Unique key identifier that the VROPhysicsWorld uses to track this VROPhysicsBody.
+     The id is the same identifier in numeric form.
      */
     std::string getKey();
+    uint32_t getId() const {
+        return _id;
+    }
 
     /*
      Returns a non-unique tag identifier stored in VRONode for referring to this VROPhysicsbody.
@@ -197,6 +202,47 @@ public:
      */
     bool needsBulletUpdate();
 
+    /*
+     True if the last modification requires the Bullet body to be removed and re-added to
+     the physics world (e.g. its type or simulation changed). Other updates, such as a new
+     shape, are applied in place. Cleared by updateBulletRigidBody.
+     */
+    bool needsBulletReinsert();
+
+    /*
+     Apply this body's gravity setting: bodies that use gravity follow the given gravity
+     of their world, others have none.
+     */
+    void updateBulletGravity(const btVector3 &worldGravity);
+
+    /*
+     True if this body has forces or a constant velocity that must be re-applied on every
+     physics step.
+     */
+    bool hasPersistentForces();
+
+    /*
+     The physics world that contains this body, and the body's index there. Maintained by
+     VROPhysicsWorld, which only visits the bodies that were marked dirty since the last
+     step (see markDirty).
+     */
+    void setWorld(VROPhysicsWorld *world, int index) {
+        _world = world;
+        _worldIndex = index;
+    }
+    VROPhysicsWorld *getWorld() const {
+        return _world;
+    }
+    int getWorldIndex() const {
+        return _worldIndex;
+    }
+    bool isDirty() const {
+        return _dirty;
+    }
+    void setDirty(bool dirty) {
+        _dirty = dirty;
+    }
+
     /*
      Updates the forces applied on the underlying bullet physics body. This is called and re-applied
      in each simulated physics step, as required by bullet.
@@ -234,8 +280,22 @@ public:
         float penetrationDistance;
     };
 
+    /*
+     A contact between this body and another, as reported once per physics step to
+     VROPhysicsBodyDelegate. Only the shallowest contact point is reported for each
+     pair of bodies. The other body is only valid during the delegate callback.
+     */
+    struct VROContact {
+        VROPhysicsBody *otherBody;
+        uint32_t otherBodyId;
+        VROVector3f point;
+        VROVector3f normal;
+        float penetrationDistance;
+    };
+
 private:
     std::string _key;
+    uint32_t _id;
     std::weak_ptr<VRONode> _w_node;
     bool _needsBulletUpdate;
     btRigidBody* _rigidBody;
@@ -269,6 +329,19 @@ private:
     std::vector<BulletForce> _forces;
     std::vector<VROVector3f> _torques;
 
+    /*
+     The world containing this body, and this body's index within it.
+     */
+    VROPhysicsWorld *_world;
+    int _worldIndex;
+    bool _dirty;
+    bool _needsBulletReinsert;
+
+    /*
+     Schedule this body to be updated by its world on the next physics step.
+     */
+    void markDirty();
+
     /*
      Creates / destroys the underlying bullet object representing this VROPhysicsBody.
      */
@@ -27,6 +27,8 @@
 #define VROPhysicsBodyDelegate_h
 #include "VROPhysicsBody.h"
 #include "VROTime.h"
+#include <vector>
+#include <algorithm>
 
 /*
  VROPhysicsBodyDelegate contains all callbacks delegate events pertaining to
@@ -34,13 +36,23 @@
  */
 class VROPhysicsBodyDelegate {
     /*
-     LastKnownCollidedObjects is used to filter out similar collision results
-     so that delegates are only notify with collided-enter events.
+     The ids of the bodies in contact during the last sampling window, and those seen so
+     far in the current window. Used to filter out continuing contacts so that delegates
+     are only notified with collision-entered events.
      */
-    std::map<std::string, VROPhysicsBody::VROCollision> _lastKnownCollidedObjects;
-    std::map<std::string, VROPhysicsBody::VROCollision> _currentCollidedObjects;
+    std::vector<uint32_t> _lastKnownCollidedBodies;
+    std::vector<uint32_t> _currentCollidedBodies;
+
+    /*
+     Collisions entered during the current window, delivered when the window closes.
+     */
+    std::vector<std::pair<std::string, VROPhysicsBody::VROCollision>> _enteredCollisions;
     double _lastSampledTime = 0;
 
+    static bool containsBody(const std::vector<uint32_t> &bodies, uint32_t id) {
+        return std::find(bodies.begin(), bodies.end(), id) != bodies.end();
+    }
+
 public:
     VROPhysicsBodyDelegate(){}
     virtual ~VROPhysicsBodyDelegate() {}
@@ -48,15 +60,30 @@ public:
     virtual void onCollided(std::string bodyBKey, VROPhysicsBody::VROCollision collision) = 0;
 
     /*
-     Called by VROPhysicsWorld when an object has collided within the computeCollisions() pass.
-     Bullet however only provides continuous contact collision checks. Instead, we only want to
-     notify our delegates about collision-entered events with onCollided(). Thus, here we
-     iterate through all known latestCollidedObjects and compare it with the objects we have
-     last seen in _lastKnownCollidedObjects, and then only notify the delegates regarding
-     new collisions.
+     Called by VROPhysicsWorld once per step with every body in contact with the given
+     body, in the computeCollisions() pass. Bullet however only provides continuous contact
+     collision checks. Instead, we only want to notify our delegates about collision-entered
+     events with onCollided(). Thus, here we compare the bodies in contact against those
+     last seen in _lastKnownCollidedBodies, and only notify the delegates regarding new
+     collisions. Continuing contacts cost no allocations.
      */
-    void onEngineCollisionUpdate(std::string currentObject, const std::map<std::string, VROPhysicsBody::VROCollision> &latestCollidedObjects) {
-        _currentCollidedObjects.insert(latestCollidedObjects.begin(), latestCollidedObjects.end());
+    void onEngineCollisionUpdate(VROPhysicsBody *body, const VROPhysicsBody::VROContact *contacts, int numContacts) {
+        for (int i = 0; i < numContacts; i++) {
+            const VROPhysicsBody::VROContact &contact = contacts[i];
+            if (containsBody(_currentCollidedBodies, contact.otherBodyId)) {
+                continue;
+            }
+            _currentCollidedBodies.push_back(contact.otherBodyId);
+
+            if (!containsBody(_lastKnownCollidedBodies, contact.otherBodyId)) {
+                VROPhysicsBody::VROCollision collision;
+                collision.collidedPoint = contact.point;
+                collision.collidedNormal = contact.normal;
+                collision.penetrationDistance = contact.penetrationDistance;
+                collision.collidedBodyTag = contact.otherBody->getTag();
+                _enteredCollisions.push_back({ contact.otherBody->getKey(), collision });
+            }
+        }
 
         // Sample at a rate of every 10 frames
         double collidedTime = VROTimeCurrentMillis();
@@ -65,14 +92,17 @@ public:
         }
 
         _lastSampledTime = collidedTime;
-        for (auto &it: _currentCollidedObjects) {
-            if (_lastKnownCollidedObjects.find(it.first) == _lastKnownCollidedObjects.end()) {
-                onCollided(it.first, it.second);
-            }
+        _lastKnownCollidedBodies.swap(_currentCollidedBodies);
+        _currentCollidedBodies.clear();
+
+        if (_enteredCollisions.empty()) {
+            return;
+        }
+        std::vector<std::pair<std::string, VROPhysicsBody::VROCollision>> entered;
+        entered.swap(_enteredCollisions);
+        for (auto &it : entered) {
+            onCollided(it.first, it.second);
         }
-        
-        _lastKnownCollidedObjects = _currentCollidedObjects;
-        _currentCollidedObjects.clear();
     }
 };
 
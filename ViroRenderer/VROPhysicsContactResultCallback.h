@@ -23,8 +23,8 @@
 //  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
 //  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
-#ifndef VROPhysicsMotionState_h
-#define VROPhysicsMotionState_h
+#ifndef VROPhysicsContactResultCallback_h
+#define VROPhysicsContactResultCallback_h
 
 #include <btBulletDynamicsCommon.h>
 #include "VROPhysicsBody.h"
@@ -35,6 +35,7 @@
  */
 struct VROPhysicsContactResultCallback : public btCollisionWorld::ContactResultCallback {
     std::vector<VROPhysicsBody::VROCollision> _collisions;
+    std::vector<VROPhysicsBody *> _collidedBodies;
 
     VROPhysicsContactResultCallback() {}
     ~VROPhysicsContactResultCallback() {_collisions.clear();}
@@ -75,6 +76,7 @@ struct VROPhysicsContactResultCallback : public btCollisionWorld::ContactResultC
         collision.collidedPoint = collisionOnBodyB;
         collision.collidedNormal = collidedNormal;
         _collisions.push_back(collision);
+        _collidedBodies.push_back(vroPhysicsBodyB);
 
         // Return a 1.f hit fraction to prevent bullet from extending the hit distance.
         return 1.f;
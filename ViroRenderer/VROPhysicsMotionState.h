@@ -31,6 +31,12 @@
 /*
  VROPhysicsMotionState, when attached to a Bullet body, notifies or grabs
  transformation updates to/from a weakly referenced VROPhysicsBody.
+
+ Bullet reports the transform of each active body interpolated between its last
+ two fixed steps, so bodies move smoothly at any frame rate. While a step runs on
+ the physics thread, the motion state is deferred: Bullet reads the transform
+ captured before the step, and the transform it writes is held until the
+ rendering thread flushes it onto the node.
  */
 class VROPhysicsMotionState : public btMotionState {
 public:
@@ -38,11 +44,17 @@ public:
     VROPhysicsMotionState(std::shared_ptr<VROPhysicsBody> body, btTransform transformOffset) {
         _w_physicsBody = body;
         _physicsTransformOffset = transformOffset;
+        _deferred = false;
+        _hasPendingTransform = false;
     }
 
     virtual ~VROPhysicsMotionState(){}
 
     void getWorldTransform(btTransform& centerOfMassWorldTrans) const {
+        if (_deferred) {
+            centerOfMassWorldTrans = _capturedTransform;
+            return;
+        }
         std::shared_ptr<VROPhysicsBody> body = _w_physicsBody.lock();
         if (!body) {
             return;
@@ -52,6 +64,11 @@ public:
     }
 
     void setWorldTransform(const btTransform& centerOfMassWorldTrans) {
+        if (_deferred) {
+            _pendingTransform = centerOfMassWorldTrans;
+            _hasPendingTransform = true;
+            return;
+        }
         std::shared_ptr<VROPhysicsBody> body = _w_physicsBody.lock();
         if (!body) {
             return;
@@ -64,10 +81,38 @@ public:
         return _physicsTransformOffset;
     }
 
+    /*
+     Capture the body's current transform and defer all transform updates until
+     flushWorldTransform() is invoked. Both must be called on the rendering thread.
+     */
+    void captureWorldTransform() {
+        std::shared_ptr<VROPhysicsBody> body = _w_physicsBody.lock();
+        if (body) {
+            body->getWorldTransform(_capturedTransform);
+        }
+        _deferred = true;
+    }
+
+    void flushWorldTransform() {
+        _deferred = false;
+        if (_hasPendingTransform) {
+            _hasPendingTransform = false;
+            setWorldTransform(_pendingTransform);
+        }
+    }
+
 private:
     /*
      The offset from Viro's geometric transform to Bullet's physicsBody transform (center of mass).
      */
     btTransform _physicsTransformOffset;
+
+    /*
+     The transforms read and written by Bullet while deferred.
+     */
+    bool _deferred;
+    bool _hasPendingTransform;
+    btTransform _capturedTransform;
+    btTransform _pendingTransform;
 };
 #endif
@@ -28,12 +28,527 @@
 #include "VROSphere.h"
 #include "VROLog.h"
 #include "VRONode.h"
+#include "VROGeometry.h"
+#include "VROGeometrySource.h"
+#include "VROGeometryElement.h"
+#include "VROTriangle.h"
+#include "VROPlatformUtil.h"
 #include <btBulletDynamicsCommon.h>
+#include <LinearMath/btConvexHullComputer.h>
+#include <map>
+#include <mutex>
+#include <float.h>
+#include <limits.h>
 const std::string VROPhysicsShape::kSphereTag = "Sphere";
 const std::string VROPhysicsShape::kBoxTag = "Box";
 const std::string VROPhysicsShape::kAutoCompoundTag = "Compound";
+const std::string VROPhysicsShape::kAutoConvexTag = "Convex";
 const float kMinBoxSize = 0.001f;
 
+#pragma mark - Convex Decomposition
+
+/*
+ Convex decomposition voxelizes the geometry, then recursively splits the solid voxels
+ with axis-aligned planes, choosing at each step the part whose convex hull least
+ matches its volume, and the plane that minimizes the volume of the resulting hulls.
+ */
+static const uint32_t kConvexCacheMagic = 0x5652434f; // 'VRCO'
+static const uint32_t kConvexCacheVersion = 1;
+static const int kConvexVoxelResolution = 32;
+static const int kMaxConvexHulls = 16;
+static const int kConvexSplitCandidates = 5;
+static const int kMaxConvexHullVertices = 32;
+
+// Parts whose hull exceeds their voxel volume by less than this fraction of the
+// whole mesh's hull volume are considered convex
+static const float kConvexConcavityThreshold = 0.01f;
+
+struct VROConvexCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t numHulls;
+    float margin;
+};
+
+struct VROConvexDecomposition {
+    bool complete = false;
+
+    /*
+     Points of each hull in the geometry's space, and the collision margin around
+     them (half a voxel, as the points are voxel centers).
+     */
+    std::vector<std::vector<VROVector3f>> hulls;
+    float margin = 0;
+
+    /*
+     Callbacks waiting for the decomposition to complete.
+     */
+    std::vector<std::function<void()>> waiters;
+};
+
+struct VROConvexDecompositionCache {
+    std::mutex mutex;
+    std::map<uint64_t, std::shared_ptr<VROConvexDecomposition>> decompositions;
+};
+
+static VROConvexDecompositionCache &getConvexDecompositionCache() {
+    static VROConvexDecompositionCache sCache;
+    return sCache;
+}
+
+static std::string getConvexCacheDirectory() {
+    return VROPlatformGetCacheDirectory() + "/viro_physics";
+}
+
+static std::string getConvexCachePath(uint64_t key) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.hull", (unsigned long long) key);
+    return getConvexCacheDirectory() + "/" + name;
+}
+
+/*
+ Solid voxels of the geometry. Voxels are indexed x-major, so a sorted list of
+ indices visits each row of voxels along X contiguously.
+ */
+struct VROVoxelGrid {
+    int nx, ny, nz;
+    float size;
+    VROVector3f origin;
+};
+
+/*
+ Appends the points whose hull is the hull of the given voxels. Each row of voxels
+ along X is spanned by its first and last voxel, so only their corners are needed.
+ An inset of 0.5 produces the voxel centers instead of their corners.
+ */
+static void getVoxelHullPoints(const VROVoxelGrid &grid, const std::vector<int> &voxels, float inset,
+                               std::vector<float> &outPoints) {
+    outPoints.clear();
+    for (size_t i = 0; i < voxels.size();) {
+        int row = voxels[i] / grid.nx;
+        size_t j = i;
+        while (j + 1 < voxels.size() && voxels[j + 1] / grid.nx == row) {
+            j++;
+        }
+
+        float x[2] = { voxels[i] % grid.nx + inset, voxels[j] % grid.nx + 1 - inset };
+        float y[2] = { row % grid.ny + inset, row % grid.ny + 1 - inset };
+        float z[2] = { row / grid.ny + inset, row / grid.ny + 1 - inset };
+        for (int a = 0; a < 2; a++) {
+            for (int b = 0; b < 2; b++) {
+                for (int c = 0; c < 2; c++) {
+                    outPoints.push_back(grid.origin.x + x[a] * grid.size);
+                    outPoints.push_back(grid.origin.y + y[b] * grid.size);
+                    outPoints.push_back(grid.origin.z + z[c] * grid.size);
+                }
+            }
+        }
+        i = j + 1;
+    }
+}
+
+static float getHullVolume(const btConvexHullComputer &hull) {
+    if (hull.vertices.size() < 4) {
+        return 0;
+    }
+
+    // Sum the tetrahedra formed by a reference vertex and a fan over each face
+    btVector3 reference = hull.vertices[0];
+    float volume = 0;
+    for (int f = 0; f < hull.faces.size(); f++) {
+        const btConvexHullComputer::Edge *first = &hull.edges[hull.faces[f]];
+        btVector3 a = hull.vertices[first->getSourceVertex()] - reference;
+
+        const btConvexHullComputer::Edge *edge = first->getNextEdgeOfFace();
+        while (edge->getTargetVertex() != first->getSourceVertex()) {
+            btVector3 b = hull.vertices[edge->getSourceVertex()] - reference;
+            btVector3 c = hull.vertices[edge->getTargetVertex()] - reference;
+            volume += a.dot(b.cross(c));
+            edge = edge->getNextEdgeOfFace();
+        }
+    }
+    return fabs(volume) / 6.0f;
+}
+
+static float getVoxelHullVolume(const VROVoxelGrid &grid, const std::vector<int> &voxels,
+                                std::vector<float> &scratch) {
+    getVoxelHullPoints(grid, voxels, 0, scratch);
+    if (scratch.empty()) {
+        return 0;
+    }
+    btConvexHullComputer hull;
+    hull.compute(scratch.data(), 3 * sizeof(float), (int) scratch.size() / 3, 0, 0);
+    return getHullVolume(hull);
+}
+
+static bool voxelizeGeometry(const std::vector<VROVector3f> &triangles, VROVoxelGrid &grid,
+                             std::vector<int> &outSolid) {
+    if (triangles.size() < 3) {
+        return false;
+    }
+
+    VROVector3f min = triangles[0];
+    VROVector3f max = triangles[0];
+    for (const VROVector3f &v : triangles) {
+        min = VROVector3f(std::min(min.x, v.x), std::min(min.y, v.y), std::min(min.z, v.z));
+        max = VROVector3f(std::max(max.x, v.x), std::max(max.y, v.y), std::max(max.z, v.z));
+    }
+    float span = std::max(std::max(max.x - min.x, max.y - min.y), max.z - min.z);
+    if (span < kMinBoxSize) {
+        return false;
+    }
+
+    // Pad the grid by a voxel on each side, so the exterior is connected
+    grid.size = span / kConvexVoxelResolution;
+    grid.origin = min - VROVector3f(grid.size, grid.size, grid.size);
+    grid.nx = (int) ceil((max.x - min.x) / grid.size) + 3;
+    grid.ny = (int) ceil((max.y - min.y) / grid.size) + 3;
+    grid.nz = (int) ceil((max.z - min.z) / grid.size) + 3;
+
+    const uint8_t kEmpty = 0, kSurface = 1, kExterior = 2;
+    std::vector<uint8_t> voxels(grid.nx * grid.ny * grid.nz, kEmpty);
+
+    // Mark the voxels touched by each triangle, sampling it at half-voxel spacing
+    for (size_t t = 0; t + 2 < triangles.size(); t += 3) {
+        const VROVector3f &a = triangles[t];
+        VROVector3f ab = triangles[t + 1] - a;
+        VROVector3f ac = triangles[t + 2] - a;
+        float longest = std::max(std::max(ab.magnitude(), ac.magnitude()), (ac - ab).magnitude());
+        int n = std::max(1, (int) ceil(longest / (grid.size * 0.5f)));
+
+        for (int i = 0; i <= n; i++) {
+            for (int j = 0; j <= n - i; j++) {
+                VROVector3f p = a + ab * ((float) i / n) + ac * ((float) j / n) - grid.origin;
+                int x = std::min(std::max((int) (p.x / grid.size), 0), grid.nx - 1);
+                int y = std::min(std::max((int) (p.y / grid.size), 0), grid.ny - 1);
+                int z = std::min(std::max((int) (p.z / grid.size), 0), grid.nz - 1);
+                voxels[x + grid.nx * (y + grid.ny * z)] = kSurface;
+            }
+        }
+    }
+
+    // Flood fill the exterior from the padded corner; everything it does not
+    // reach is inside or on the surface of the mesh
+    std::vector<int> stack = { 0 };
+    voxels[0] = kExterior;
+    while (!stack.empty()) {
+        int index = stack.back();
+        stack.pop_back();
+
+        int x = index % grid.nx;
+        int y = (index / grid.nx) % grid.ny;
+        int z = index / (grid.nx * grid.ny);
+        int neighbors[6][3] = { { x - 1, y, z }, { x + 1, y, z }, { x, y - 1, z },
+                                { x, y + 1, z }, { x, y, z - 1 }, { x, y, z + 1 } };
+        for (int k = 0; k < 6; k++) {
+            int nx = neighbors[k][0], ny = neighbors[k][1], nz = neighbors[k][2];
+            if (nx < 0 || ny < 0 || nz < 0 || nx >= grid.nx || ny >= grid.ny || nz >= grid.nz) {
+                continue;
+            }
+            int neighbor = nx + grid.nx * (ny + grid.ny * nz);
+            if (voxels[neighbor] == kEmpty) {
+                voxels[neighbor] = kExterior;
+                stack.push_back(neighbor);
+            }
+        }
+    }
+
+    outSolid.clear();
+    for (int i = 0; i < (int) voxels.size(); i++) {
+        if (voxels[i] != kExterior) {
+            outSolid.push_back(i);
+        }
+    }
+    return !outSolid.empty();
+}
+
+/*
+ Reduces the given hull vertices to the most extreme vertex along each of the 26
+ directions to the faces, edges, and corners of a cube.
+ */
+static std::vector<VROVector3f> simplifyHull(const std::vector<VROVector3f> &vertices) {
+    if (vertices.size() <= kMaxConvexHullVertices) {
+        return vertices;
+    }
+
+    std::vector<int> extremes;
+    for (int dx = -1; dx <= 1; dx++) {
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dz = -1; dz <= 1; dz++) {
+                if (dx == 0 && dy == 0 && dz == 0) {
+                    continue;
+                }
+                VROVector3f direction(dx, dy, dz);
+                int best = 0;
+                for (int i = 1; i < (int) vertices.size(); i++) {
+                    if (vertices[i].dot(direction) > vertices[best].dot(direction)) {
+                        best = i;
+                    }
+                }
+                if (std::find(extremes.begin(), extremes.end(), best) == extremes.end()) {
+                    extremes.push_back(best);
+                }
+            }
+        }
+    }
+
+    std::vector<VROVector3f> simplified;
+    for (int i : extremes) {
+        simplified.push_back(vertices[i]);
+    }
+    return simplified;
+}
+
+static std::vector<std::vector<VROVector3f>> decomposeConvex(const std::vector<VROVector3f> &triangles,
+                                                             float *outMargin) {
+    std::vector<std::vector<VROVector3f>> hulls;
+
+    VROVoxelGrid grid;
+    std::vector<int> solid;
+    if (!voxelizeGeometry(triangles, grid, solid)) {
+        return hulls;
+    }
+    *outMargin = grid.size * 0.5f;
+
+    struct VROConvexPart {
+        std::vector<int> voxels;
+        float concavity;
+    };
+
+    std::vector<float> scratch;
+    float voxelVolume = grid.size * grid.size * grid.size;
+    float totalHullVolume = getVoxelHullVolume(grid, solid, scratch);
+    float threshold = totalHullVolume * kConvexConcavityThreshold;
+
+    std::vector<VROConvexPart> parts;
+    parts.push_back({ std::move(solid), totalHullVolume });
+    parts.back().concavity -= parts.back().voxels.size() * voxelVolume;
+
+    while ((int) parts.size() < kMaxConvexHulls) {
+        int worst = 0;
+        for (int i = 1; i < (int) parts.size(); i++) {
+            if (parts[i].concavity > parts[worst].concavity) {
+                worst = i;
+            }
+        }
+        if (parts[worst].concavity < threshold) {
+            break;
+        }
+
+        // Evaluate evenly spaced planes along each axis through the part's extent,
+        // and keep the split whose two hulls have the least total volume
+        const std::vector<int> &voxels = parts[worst].voxels;
+        std::vector<int> left, right, bestLeft, bestRight;
+        float bestLeftVolume = 0, bestRightVolume = 0;
+        float bestCost = FLT_MAX;
+
+        for (int axis = 0; axis < 3; axis++) {
+            auto coordinate = [&grid, axis](int index) {
+                if (axis == 0) {
+                    return index % grid.nx;
+                } else if (axis == 1) {
+                    return (index / grid.nx) % grid.ny;
+                }
+                return index / (grid.nx * grid.ny);
+            };
+
+            int lo = INT_MAX, hi = INT_MIN;
+            for (int index : voxels) {
+                lo = std::min(lo, coordinate(index));
+                hi = std::max(hi, coordinate(index));
+            }
+
+            int previousPlane = lo;
+            for (int k = 1; k <= kConvexSplitCandidates; k++) {
+                int plane = lo + ((hi - lo + 1) * k) / (kConvexSplitCandidates + 1);
+                if (plane <= previousPlane || plane > hi) {
+                    continue;
+                }
+                previousPlane = plane;
+
+                left.clear();
+                right.clear();
+                for (int index : voxels) {
+                    (coordinate(index) < plane ? left : right).push_back(index);
+                }
+                if (left.empty() || right.empty()) {
+                    continue;
+                }
+
+                float leftVolume = getVoxelHullVolume(grid, left, scratch);
+                float rightVolume = getVoxelHullVolume(grid, right, scratch);
+                if (leftVolume + rightVolume < bestCost) {
+                    bestCost = leftVolume + rightVolume;
+                    bestLeft.swap(left);
+                    bestRight.swap(right);
+                    bestLeftVolume = leftVolume;
+                    bestRightVolume = rightVolume;
+                }
+            }
+        }
+
+        if (bestLeft.empty()) {
+            // Too thin to split further
+            parts[worst].concavity = 0;
+            continue;
+        }
+
+        float leftConcavity = bestLeftVolume - bestLeft.size() * voxelVolume;
+        float rightConcavity = bestRightVolume - bestRight.size() * voxelVolume;
+        parts[worst] = { std::move(bestLeft), leftConcavity };
+        parts.push_back({ std::move(bestRight), rightConcavity });
+    }
+
+    // Build each final hull from the centers of its voxels; the collision margin
+    // restores the half voxel this removes
+    for (const VROConvexPart &part : parts) {
+        getVoxelHullPoints(grid, part.voxels, 0.5f, scratch);
+        btConvexHullComputer hull;
+        hull.compute(scratch.data(), 3 * sizeof(float), (int) scratch.size() / 3, 0, 0);
+
+        std::vector<VROVector3f> vertices;
+        for (int i = 0; i < hull.vertices.size(); i++) {
+            vertices.push_back({ (float) hull.vertices[i].x(), (float) hull.vertices[i].y(), (float) hull.vertices[i].z() });
+        }
+        if (!vertices.empty()) {
+            hulls.push_back(simplifyHull(vertices));
+        }
+    }
+    return hulls;
+}
+
+static bool readConvexDecomposition(uint64_t key, std::vector<std::vector<VROVector3f>> &outHulls,
+                                    float *outMargin) {
+    FILE *file = fopen(getConvexCachePath(key).c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+
+    VROConvexCacheHeader header;
+    bool success = fread(&header, sizeof(header), 1, file) == 1 &&
+                   header.magic == kConvexCacheMagic && header.version == kConvexCacheVersion &&
+                   header.key == key && header.numHulls <= kMaxConvexHulls;
+    for (uint32_t h = 0; success && h < header.numHulls; h++) {
+        uint32_t numPoints = 0;
+        success = fread(&numPoints, sizeof(numPoints), 1, file) == 1 && numPoints <= kMaxConvexHullVertices * 8;
+        if (success) {
+            std::vector<VROVector3f> points(numPoints);
+            for (uint32_t p = 0; success && p < numPoints; p++) {
+                float xyz[3];
+                success = fread(xyz, sizeof(float), 3, file) == 3;
+                points[p] = { xyz[0], xyz[1], xyz[2] };
+            }
+            outHulls.push_back(std::move(points));
+        }
+    }
+    fclose(file);
+
+    if (!success) {
+        outHulls.clear();
+        return false;
+    }
+    *outMargin = header.margin;
+    return true;
+}
+
+static void writeConvexDecomposition(uint64_t key, const std::vector<std::vector<VROVector3f>> &hulls,
+                                     float margin) {
+    VROPlatformWriteCacheFile(getConvexCachePath(key), [key, &hulls, margin](FILE *file) {
+        VROConvexCacheHeader header = { kConvexCacheMagic, kConvexCacheVersion, key, (uint32_t) hulls.size(), margin };
+        bool success = fwrite(&header, sizeof(header), 1, file) == 1;
+        for (const std::vector<VROVector3f> &hull : hulls) {
+            uint32_t numPoints = (uint32_t) hull.size();
+            success = success && fwrite(&numPoints, sizeof(numPoints), 1, file) == 1;
+            for (const VROVector3f &point : hull) {
+                float xyz[3] = { point.x, point.y, point.z };
+                success = success && fwrite(xyz, sizeof(float), 3, file) == 3;
+            }
+        }
+        return success;
+    });
+}
+
+/*
+ Returns the completed decomposition of the given geometry, or nullptr if it is not yet
+ available, in which case it is started (if needed) and onDecomposed is queued to run on
+ the rendering thread once it completes.
+ */
+static std::shared_ptr<VROConvexDecomposition> findConvexDecomposition(std::shared_ptr<VROGeometry> geometry,
+                                                                       std::function<void()> onDecomposed) {
+    std::shared_ptr<std::vector<VROVector3f>> triangles = std::make_shared<std::vector<VROVector3f>>();
+    std::vector<std::shared_ptr<VROGeometrySource>> vertexSources = geometry->getGeometrySourcesForSemantic(VROGeometrySourceSemantic::Vertex);
+    if (vertexSources.empty()) {
+        return nullptr;
+    }
+    for (const std::shared_ptr<VROGeometryElement> &element : geometry->getGeometryElements()) {
+        element->visitTriangles([&triangles](int index, const VROTriangle &triangle) {
+            triangles->push_back(triangle.getA());
+            triangles->push_back(triangle.getB());
+            triangles->push_back(triangle.getC());
+            return true;
+        }, *vertexSources.front());
+    }
+    if (triangles->empty()) {
+        return nullptr;
+    }
+
+    uint64_t key = VROPlatformHashCacheKey(&kConvexCacheVersion, sizeof(kConvexCacheVersion));
+    int params[] = { kConvexVoxelResolution, kMaxConvexHulls, kConvexSplitCandidates, kMaxConvexHullVertices };
+    key = VROPlatformHashCacheKey(params, sizeof(params), key);
+    key = VROPlatformHashCacheKey(&kConvexConcavityThreshold, sizeof(kConvexConcavityThreshold), key);
+    key = VROPlatformHashCacheKey(triangles->data(), triangles->size() * sizeof(VROVector3f), key);
+
+    VROConvexDecompositionCache &cache = getConvexDecompositionCache();
+    std::shared_ptr<VROConvexDecomposition> decomposition;
+    {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        auto it = cache.decompositions.find(key);
+        if (it != cache.decompositions.end()) {
+            if (it->second->complete) {
+                return it->second;
+            }
+            it->second->waiters.push_back(onDecomposed);
+            return nullptr;
+        }
+
+        decomposition = std::make_shared<VROConvexDecomposition>();
+        decomposition->waiters.push_back(onDecomposed);
+        cache.decompositions[key] = decomposition;
+    }
+
+    VROPlatformDispatchAsyncWorker([key, triangles, decomposition] {
+        std::vector<std::vector<VROVector3f>> hulls;
+        float margin = 0;
+        if (!readConvexDecomposition(key, hulls, &margin)) {
+            hulls = decomposeConvex(*triangles, &margin);
+            if (!hulls.empty()) {
+                writeConvexDecomposition(key, hulls, margin);
+            }
+        }
+
+        std::vector<std::function<void()>> waiters;
+        {
+            std::lock_guard<std::mutex> lock(getConvexDecompositionCache().mutex);
+            decomposition->hulls = std::move(hulls);
+            decomposition->margin = margin;
+            decomposition->complete = true;
+            waiters.swap(decomposition->waiters);
+        }
+
+        VROPlatformDispatchAsyncRenderer([waiters] {
+            for (const std::function<void()> &waiter : waiters) {
+                if (waiter) {
+                    waiter();
+                }
+            }
+        });
+    }, VROTaskPriority::Low);
+    return nullptr;
+}
+
+#pragma mark - VROPhysicsShape
+
 VROPhysicsShape::VROPhysicsShape(VROShapeType type, std::vector<float> params) {
     if (type != VROShapeType::Sphere || VROShapeType::Box){
         perror("Attempted to construct unsupported VROPhysicsShape type!");
@@ -45,10 +560,12 @@ VROPhysicsShape::VROPhysicsShape(VROShapeType type, std::vector<float> params) {
     }
 
     _type = type;
+    _isDecomposed = false;
     _bulletShape = generateBasicBulletShape(type, params);
 }
 
 VROPhysicsShape::VROPhysicsShape(std::shared_ptr<VRONode> node, bool hasCompoundShapes){
+    _isDecomposed = false;
     if (hasCompoundShapes) {
         btCompoundShape* compoundShape = new btCompoundShape();
         generateCompoundBulletShape(*compoundShape, node, node);
@@ -64,8 +581,63 @@ VROPhysicsShape::VROPhysicsShape(std::shared_ptr<VRONode> node, bool hasCompound
     }
 }
 
+VROPhysicsShape::VROPhysicsShape(std::shared_ptr<VRONode> node, std::function<void()> onDecomposed) {
+    _type = VROShapeType::AutoConvex;
+    _isDecomposed = false;
+    _bulletShape = nullptr;
+
+    VROVector3f scale = node->getWorldTransform().extractScale();
+    std::shared_ptr<VROConvexDecomposition> decomposition;
+    if (node->getGeometry()) {
+        decomposition = findConvexDecomposition(node->getGeometry(), onDecomposed);
+    }
+
+    if (decomposition && !decomposition->hulls.empty()) {
+        // As with compound shapes, scale is applied to each hull directly. Each hull
+        // is centered on its centroid so the compound's mass is distributed across
+        // the hulls.
+        btCompoundShape *compoundShape = new btCompoundShape();
+        float margin = decomposition->margin * std::min(std::min(scale.x, scale.y), scale.z);
+
+        for (const std::vector<VROVector3f> &hull : decomposition->hulls) {
+            VROVector3f centroid;
+            for (const VROVector3f &point : hull) {
+                centroid += point * scale;
+            }
+            centroid /= (float) hull.size();
+
+            btConvexHullShape *hullShape = new btConvexHullShape();
+            for (const VROVector3f &point : hull) {
+                VROVector3f p = point * scale - centroid;
+                hullShape->addPoint(btVector3(p.x, p.y, p.z), false);
+            }
+            hullShape->recalcLocalAabb();
+            hullShape->setMargin(std::max(margin, kMinBoxSize));
+
+            btTransform transform = btTransform::getIdentity();
+            transform.setOrigin(btVector3(centroid.x, centroid.y, centroid.z));
+            compoundShape->addChildShape(transform, hullShape);
+        }
+        _bulletShape = compoundShape;
+        _isDecomposed = true;
+    } else {
+        // Until the decomposition is available, fall back to the bounding box
+        _bulletShape = generateBasicBulletShape(node);
+        if (_bulletShape != nullptr) {
+            _bulletShape->setLocalScaling(btVector3(scale.x, scale.y, scale.z));
+        }
+    }
+}
+
 VROPhysicsShape::~VROPhysicsShape() {
     if (_bulletShape != nullptr){
+        // Compound shapes do not own their children
+        if (getIsCompoundShape()) {
+            btCompoundShape *compoundShape = (btCompoundShape *) _bulletShape;
+            for (int i = 0; i < compoundShape->getNumChildShapes(); i++) {
+                delete(compoundShape->getChildShape(i));
+            }
+        }
         delete(_bulletShape);
     }
 }
@@ -75,11 +647,11 @@ btCollisionShape* VROPhysicsShape::getBulletShape() {
 }
 
 bool VROPhysicsShape::getIsGeneratedFromGeometry() {
-    return _type == Auto || _type == AutoCompound;
+    return _type == Auto || _type == AutoCompound || _type == AutoConvex;
 }
 
 bool VROPhysicsShape::getIsCompoundShape() {
-    return _type == AutoCompound;
+    return _type == AutoCompound || (_type == AutoConvex && _isDecomposed);
 }
 
 btCollisionShape* VROPhysicsShape::generateBasicBulletShape(std::shared_ptr<VRONode> node) {
@@ -115,7 +687,8 @@ btCollisionShape* VROPhysicsShape::generateBasicBulletShape(VROPhysicsShape::VRO
     } else if (type == VROPhysicsShape::VROShapeType::Sphere) {
         return new btSphereShape(btScalar(params[0]));
     } else if (type != VROPhysicsShape::VROShapeType::Auto &&
-               type != VROPhysicsShape::VROShapeType::AutoCompound) {
+               type != VROPhysicsShape::VROShapeType::AutoCompound &&
+               type != VROPhysicsShape::VROShapeType::AutoConvex) {
         perror("Attempted to grab a bullet shape from a mis-configured VROPhysicsShape!");
     }
     return nullptr;
@@ -28,6 +28,7 @@
 
 #include "VROLog.h"
 #include <memory>
+#include <functional>
 #include <stack>
 #include <vector>
 #include <string>
@@ -52,11 +53,13 @@ public:
         Auto = 0,           // Automatically infer a shape from attached geometry.
         AutoCompound = 1,   // Automatically infer a compound shape from attached geometry.
         Sphere = 2,         // _params[0] represents the radius of the sphere
-        Box = 3             // _params[0],[1],[2] represents the X,Y,Z half span of the Box
+        Box = 3,            // _params[0],[1],[2] represents the X,Y,Z half span of the Box
+        AutoConvex = 4      // Automatically decompose attached geometry into convex hulls.
     };
     static const std::string kSphereTag;
     static const std::string kBoxTag;
     static const std::string kAutoCompoundTag;
+    static const std::string kAutoConvexTag;
 
     /*
      Returns true of the given string and mass represents a valid representation of
@@ -66,7 +69,8 @@ public:
     static bool isValidShape(std::string strType, std::vector<float> params, std::string &errorMsg) {
         if (!VROStringUtil::strcmpinsensitive(strType, kSphereTag)
             && !VROStringUtil::strcmpinsensitive(strType, kBoxTag)
-            && !VROStringUtil::strcmpinsensitive(strType,kAutoCompoundTag)) {
+            && !VROStringUtil::strcmpinsensitive(strType,kAutoCompoundTag)
+            && !VROStringUtil::strcmpinsensitive(strType, kAutoConvexTag)) {
             errorMsg = "Provided invalid shape of type: " + strType;
             return false;
         } else if (VROStringUtil::strcmpinsensitive(strType, kSphereTag) && params.size() != 1) {
@@ -84,12 +88,23 @@ public:
             return VROPhysicsShape::VROShapeType::Sphere;
         } else if (VROStringUtil::strcmpinsensitive(strType, kAutoCompoundTag)) {
             return VROPhysicsShape::VROShapeType::AutoCompound;
+        } else if (VROStringUtil::strcmpinsensitive(strType, kAutoConvexTag)) {
+            return VROPhysicsShape::VROShapeType::AutoConvex;
         }
         return VROPhysicsShape::VROShapeType::Box;
     }
 
     VROPhysicsShape(VROShapeType type, std::vector<float> params = std::vector<float>());
     VROPhysicsShape(std::shared_ptr<VRONode> node, bool hasCompoundShapes = false);
+
+    /*
+     Creates an AutoConvex shape that decomposes the geometry of the given node into a
+     compound of convex hulls. Decomposition runs on a worker thread, and its results are
+     cached in memory and on disk, keyed by the hash of the geometry. Until the hulls are
+     available this shape is the geometry's bounding box; onDecomposed is then invoked on
+     the rendering thread so the owner can regenerate the shape.
+     */
+    VROPhysicsShape(std::shared_ptr<VRONode> node, std::function<void()> onDecomposed);
     virtual ~VROPhysicsShape();
 
     /*
@@ -109,6 +124,10 @@ public:
      */
     bool getIsCompoundShape();
 
+    VROShapeType getType() const {
+        return _type;
+    }
+
 private:
     /*
      Parameters that describe the dimensions of a shape.
@@ -117,6 +136,12 @@ private:
     VROShapeType _type;
     btCollisionShape* _bulletShape;
 
+    /*
+     True if this is an AutoConvex shape whose convex hulls were available at
+     construction. Until then, the shape is a bounding box placeholder.
+     */
+    bool _isDecomposed;
+
     /*
      Creates an underlying bullet collision shape representing this VROPhysicsShape,
      given the target shape type and associated params.
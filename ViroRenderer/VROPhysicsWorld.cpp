@@ -24,37 +24,146 @@
 //  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include <map>
+#include <algorithm>
 #include "VROPhysicsWorld.h"
 #include "VROPhysicsBodyDelegate.h"
 #include <btBulletDynamicsCommon.h>
 #include "VROPhysicsContactResultCallback.h"
 #include "VROPhysicsDebugDraw.h"
+#include "VROProfiler.h"
+#include "VROPhysicsMotionState.h"
+#include "VROTime.h"
+#include "VROJobSystem.h"
+
+#if !VRO_PLATFORM_WASM
+#include <LinearMath/btThreads.h>
+#include <BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h>
+#include <BulletCollision/CollisionDispatch/btCollisionDispatcherMt.h>
+#endif
 
 static const float kPhysicsStepTime = 1 / 60.f;
-static const float kPhysicsMaxSteps = 10;
+static const int kPhysicsMaxSteps = 10;
+
+// Elapsed time beyond this (e.g. after the app was paused) is dropped rather than
+// simulated, so the world does not lurch forward all at once
+static const float kPhysicsMaxElapsedTime = kPhysicsStepTime * kPhysicsMaxSteps;
+
+// The sweep and prune broadphase quantizes bounds within this distance of the origin
+static const float kSweepAndPruneWorldExtent = 500;
+static const int kSweepAndPruneMaxBodies = 16384;
+
+#if !VRO_PLATFORM_WASM
+
+/*
+ Runs Bullet's parallel loops on the shared VROJobSystem. Bullet uses one task
+ scheduler for all worlds, so this is installed once, by the first multithreaded
+ world.
+ */
+class VROPhysicsTaskScheduler : public btITaskScheduler {
+public:
+    VROPhysicsTaskScheduler(std::shared_ptr<VROJobSystem> jobs) :
+        btITaskScheduler("Viro"),
+        _jobs(jobs) {}
+    virtual ~VROPhysicsTaskScheduler() {}
+
+    int getMaxNumThreads() const {
+        return _jobs->getConcurrency();
+    }
+    int getNumThreads() const {
+        return _jobs->getConcurrency();
+    }
+    void setNumThreads(int numThreads) {
+        // The number of workers is fixed by the job system
+    }
+
+    void parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody &body) {
+        grainSize = std::max(grainSize, 1);
+        int numBatches = (iEnd - iBegin + grainSize - 1) / grainSize;
+        if (numBatches <= 1) {
+            body.forLoop(iBegin, iEnd);
+            return;
+        }
+        _jobs->parallelFor(0, numBatches, 1, [iBegin, iEnd, grainSize, &body] (int batch) {
+            int begin = iBegin + batch * grainSize;
+            body.forLoop(begin, std::min(begin + grainSize, iEnd));
+        });
+    }
+
+private:
+    std::shared_ptr<VROJobSystem> _jobs;
+};
+
+static void VROInstallPhysicsTaskScheduler() {
+    static VROPhysicsTaskScheduler *sScheduler = [] {
+        VROPhysicsTaskScheduler *scheduler = new VROPhysicsTaskScheduler(VROJobSystem::getShared());
+        btSetTaskScheduler(scheduler);
+        return scheduler;
+    }();
+    (void) sScheduler;
+}
 
-VROPhysicsWorld::VROPhysicsWorld() {
-    // Set to a default DbvtBroadphase (Dynamic AABB tree) as recommended by bullet.
-    _broadphase = new btDbvtBroadphase();
+#endif
+
+VROPhysicsWorld::VROPhysicsWorld() :
+    VROPhysicsWorld(VROPhysicsBroadphase::DynamicTree, false) {
+}
+
+VROPhysicsWorld::VROPhysicsWorld(VROPhysicsBroadphase broadphase, bool multithreaded) {
+    if (broadphase == VROPhysicsBroadphase::SweepAndPrune) {
+        btVector3 extent(kSweepAndPruneWorldExtent, kSweepAndPruneWorldExtent, kSweepAndPruneWorldExtent);
+        _broadphase = new btAxisSweep3(-extent, extent, kSweepAndPruneMaxBodies);
+    } else {
+        // Set to a default DbvtBroadphase (Dynamic AABB tree) as recommended by bullet.
+        _broadphase = new btDbvtBroadphase();
+    }
 
     // Set up the collision configuration and dispatcher with bullet defaults.
     _collisionConfiguration = new btDefaultCollisionConfiguration();
 
-    _collisionDispatcher = new btCollisionDispatcher(_collisionConfiguration);
-    _constraintSolver = new btSequentialImpulseConstraintSolver();
-
-    // Finally, we create the physics world with the prepared configurations.
-    _dynamicsWorld = new btDiscreteDynamicsWorld(_collisionDispatcher, _broadphase, _constraintSolver, _collisionConfiguration);
+#if !VRO_PLATFORM_WASM
+    if (multithreaded) {
+        // The multithreaded world solves each simulation island with a solver from
+        // the pool, and runs narrowphase and integration in parallel
+        VROInstallPhysicsTaskScheduler();
+        _collisionDispatcher = new btCollisionDispatcherMt(_collisionConfiguration);
+        btConstraintSolverPoolMt *solverPool = new btConstraintSolverPoolMt(btGetTaskScheduler()->getNumThreads());
+        _constraintSolver = solverPool;
+        _dynamicsWorld = new btDiscreteDynamicsWorldMt(_collisionDispatcher, _broadphase, solverPool, _collisionConfiguration);
+    } else
+#endif
+    {
+        _collisionDispatcher = new btCollisionDispatcher(_collisionConfiguration);
+        _constraintSolver = new btSequentialImpulseConstraintSolver();
+
+        // Finally, we create the physics world with the prepared configurations.
+        _dynamicsWorld = new btDiscreteDynamicsWorld(_collisionDispatcher, _broadphase, _constraintSolver, _collisionConfiguration);
+    }
 
     // Default to Earth's gravity if none is set.
     _dynamicsWorld->setGravity({0,-9.81f,0});
 
     _debugDrawVisible = false;
     _debugDraw = nullptr;
+    _lastStepTime = -1;
+
+#if !VRO_PLATFORM_WASM
+    _asyncStepping = false;
+    _stepPending = false;
+    _stepThreadExit = false;
+    _stepElapsed = 0;
+#endif
 }
 
 VROPhysicsWorld::~VROPhysicsWorld() {
-    _activePhysicsBodies.clear();
+#if !VRO_PLATFORM_WASM
+    stopStepThread();
+#endif
+    for (std::shared_ptr<VROPhysicsBody> &body : _bodies) {
+        body->setWorld(nullptr, -1);
+        body->setDirty(false);
+    }
+    _bodies.clear();
+    _dirtyBodies.clear();
     delete _dynamicsWorld;
     delete _constraintSolver;
     delete _collisionDispatcher;
@@ -71,16 +180,37 @@ void VROPhysicsWorld::setDebugDrawVisible(bool isVisible) {
 }
 
 void VROPhysicsWorld::setGravity(VROVector3f gravity){
+    // Bullet applies the gravity to every body that does not disable world gravity
+    finishPhysics();
     _dynamicsWorld->setGravity({gravity.x, gravity.y, gravity.z});
 }
 
+void VROPhysicsWorld::setAsyncStepping(bool async) {
+#if !VRO_PLATFORM_WASM
+    if (async == _asyncStepping) {
+        return;
+    }
+    if (async) {
+        _stepThreadExit = false;
+        _stepThread = std::thread(&VROPhysicsWorld::runStepThread, this);
+    } else {
+        stopStepThread();
+    }
+    _asyncStepping = async;
+#endif
+}
+
 void VROPhysicsWorld::addPhysicsBody(std::shared_ptr<VROPhysicsBody> body) {
-    if (_activePhysicsBodies.find(body->getKey()) != _activePhysicsBodies.end()) {
+    finishPhysics();
+    if (body->getWorld() == this) {
         pwarn("Attempted to add the same physics body twice to the same physics world!");
         return;
     }
 
-    _activePhysicsBodies[body->getKey()] = body;
+    body->setWorld(this, (int) _bodies.size());
+    _bodies.push_back(body);
+    markBodyDirty(body.get());
+
     btRigidBody* bulletBody = body->getBulletRigidBody();
     if (bulletBody && body->getIsSimulated()){
         _dynamicsWorld->addRigidBody(bulletBody);
@@ -90,12 +220,26 @@ void VROPhysicsWorld::addPhysicsBody(std::shared_ptr<VROPhysicsBody> body) {
 }
 
 void VROPhysicsWorld::removePhysicsBody(std::shared_ptr<VROPhysicsBody> body) {
-    if (_activePhysicsBodies.find(body->getKey()) == _activePhysicsBodies.end()) {
+    finishPhysics();
+    if (body->getWorld() != this) {
         pwarn("Attempted to remove a VROPhysicsBody that does not exist in this physics world!");
         return;
     }
 
-    _activePhysicsBodies.erase(body->getKey());
+    // Move the last body into the removed body's slot
+    int index = body->getWorldIndex();
+    if (index != (int) _bodies.size() - 1) {
+        _bodies[index] = _bodies.back();
+        _bodies[index]->setWorld(this, index);
+    }
+    _bodies.pop_back();
+
+    if (body->isDirty()) {
+        _dirtyBodies.erase(std::remove(_dirtyBodies.begin(), _dirtyBodies.end(), body.get()), _dirtyBodies.end());
+        body->setDirty(false);
+    }
+    body->setWorld(nullptr, -1);
+
     btRigidBody* bulletBody = body->getBulletRigidBody();
     if (bulletBody && body->getIsSimulated()){
         _dynamicsWorld->removeRigidBody(bulletBody);
@@ -105,39 +249,33 @@ void VROPhysicsWorld::removePhysicsBody(std::shared_ptr<VROPhysicsBody> body) {
 }
 
 void VROPhysicsWorld::computePhysics(const VRORenderContext &context) {
-    // Update all VROPhysicsBodies as need be before the physics step.
-    std::map<std::string, std::shared_ptr<VROPhysicsBody>>::iterator it;
-    for (it = _activePhysicsBodies.begin(); it != _activePhysicsBodies.end(); ++it) {
-        std::shared_ptr<VROPhysicsBody> physicsBody = it->second;
-
-        // To update a bullet physics object, it must be removed and added back into the world.
-        if (physicsBody->needsBulletUpdate()) {
-            btRigidBody *oldBulletBody = physicsBody->getBulletRigidBody();
-            _dynamicsWorld->removeRigidBody(oldBulletBody);
-
-            physicsBody->updateBulletRigidBody();
+    VRO_PROFILE_SCOPE("computePhysics");
+    finishPhysics();
 
-            if (physicsBody->getIsSimulated()) {
-                btRigidBody *newBulletBody = physicsBody->getBulletRigidBody();
-                _dynamicsWorld->addRigidBody(newBulletBody);
-            }
-        }
+    updatePhysicsBodies();
 
-        // Update gravity states for physics bodies
-        if (!physicsBody->getUseGravity()) {
-            physicsBody->getBulletRigidBody()->setGravity({0,0,0});
-        } else {
-            physicsBody->getBulletRigidBody()->setGravity(_dynamicsWorld->getGravity());
-        }
-
-        physicsBody->updateBulletForces();
-        physicsBody->applyPresetVelocity();
+    double now = VROTimeCurrentSeconds();
+    float elapsed = kPhysicsStepTime;
+    if (_lastStepTime >= 0) {
+        elapsed = std::min((float) (now - _lastStepTime), kPhysicsMaxElapsedTime);
     }
+    _lastStepTime = now;
 
-    // Step through the physics simulation
-    _dynamicsWorld->stepSimulation(kPhysicsStepTime, kPhysicsMaxSteps);
+#if !VRO_PLATFORM_WASM
+    bool async = _asyncStepping;
+#else
+    bool async = false;
+#endif
 
-    // Cycle through collisions that has resulted from the step.
+    /*
+     Step through the physics simulation, then cycle through the collisions that
+     resulted from the step. When stepping asynchronously, these are the collisions
+     of the step completed last frame, reported before the next step rewrites the
+     contact manifolds.
+     */
+    if (!async) {
+        stepSimulation(elapsed);
+    }
     computeCollisions();
 
     // If debug draw is true, render a set of lines that represents the collision mesh of
@@ -150,18 +288,160 @@ void VROPhysicsWorld::computePhysics(const VRORenderContext &context) {
         }
         _dynamicsWorld->debugDrawWorld();
     }
+
+#if !VRO_PLATFORM_WASM
+    if (async) {
+        for (std::shared_ptr<VROPhysicsBody> &body : _bodies) {
+            btRigidBody *bulletBody = body->getBulletRigidBody();
+            VROPhysicsMotionState *state = bulletBody ? (VROPhysicsMotionState *) bulletBody->getMotionState() : nullptr;
+            if (state) {
+                state->captureWorldTransform();
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(_stepMutex);
+        _stepElapsed = elapsed;
+        _stepPending = true;
+        _stepCondition.notify_all();
+    }
+#endif
+}
+
+void VROPhysicsWorld::markBodyDirty(VROPhysicsBody *body) {
+    if (!body->isDirty()) {
+        body->setDirty(true);
+        _dirtyBodies.push_back(body);
+    }
 }
 
+void VROPhysicsWorld::updatePhysicsBodies() {
+    VRO_PROFILE_SCOPE("updatePhysicsBodies");
+    VRO_PROFILE_COUNT(PhysicsBodies, (int) _bodies.size());
+
+    /*
+     Only bodies that were modified since the last step, or that have forces to
+     re-apply every step, are visited. Bodies re-mark themselves dirty if they
+     are modified while we iterate, so we swap out the list first.
+     */
+    std::vector<VROPhysicsBody *> dirtyBodies;
+    dirtyBodies.swap(_dirtyBodies);
+    VRO_PROFILE_COUNT(PhysicsBodyUpdates, (int) dirtyBodies.size());
+
+    const btVector3 &gravity = _dynamicsWorld->getGravity();
+    for (VROPhysicsBody *physicsBody : dirtyBodies) {
+        physicsBody->setDirty(false);
+
+        if (physicsBody->needsBulletUpdate()) {
+            VRO_PROFILE_COUNT(PhysicsBodyRebuilds, 1);
+            btRigidBody *bulletBody = physicsBody->getBulletRigidBody();
+
+            if (physicsBody->needsBulletReinsert()) {
+                // Changing the type or simulation of a Bullet body requires removing it from
+                // the world and adding it back in
+                _dynamicsWorld->removeRigidBody(bulletBody);
+                physicsBody->updateBulletRigidBody();
+
+                if (physicsBody->getIsSimulated()) {
+                    _dynamicsWorld->addRigidBody(bulletBody);
+                }
+            } else {
+                // Other changes (e.g. a new shape) can be made in place, as long as the
+                // body's cached contact pairs and bounds are refreshed
+                physicsBody->updateBulletRigidBody();
+
+                btBroadphaseProxy *proxy = bulletBody->getBroadphaseHandle();
+                if (proxy) {
+                    _dynamicsWorld->getBroadphase()->getOverlappingPairCache()->cleanProxyFromPairs(proxy,
+                                                                                                   _dynamicsWorld->getDispatcher());
+                    _dynamicsWorld->updateSingleAabb(bulletBody);
+                }
+            }
+        }
+
+        physicsBody->updateBulletGravity(gravity);
+        physicsBody->updateBulletForces();
+        physicsBody->applyPresetVelocity();
+
+        // Bodies whose update failed are retried, and bodies with forces re-apply them
+        // on the next step
+        if (physicsBody->needsBulletUpdate() || physicsBody->hasPersistentForces()) {
+            markBodyDirty(physicsBody);
+        }
+    }
+}
+
+void VROPhysicsWorld::stepSimulation(float elapsed) {
+    /*
+     Bullet accumulates the elapsed time and runs as many fixed steps as fit,
+     carrying the remainder to the next frame. Motion states receive transforms
+     interpolated across that remainder.
+     */
+    _dynamicsWorld->stepSimulation(elapsed, kPhysicsMaxSteps, kPhysicsStepTime);
+}
+
+void VROPhysicsWorld::finishPhysics() {
+#if !VRO_PLATFORM_WASM
+    if (!_asyncStepping) {
+        return;
+    }
+    {
+        std::unique_lock<std::mutex> lock(_stepMutex);
+        _stepCondition.wait(lock, [this] { return !_stepPending; });
+    }
+
+    for (std::shared_ptr<VROPhysicsBody> &body : _bodies) {
+        btRigidBody *bulletBody = body->getBulletRigidBody();
+        VROPhysicsMotionState *state = bulletBody ? (VROPhysicsMotionState *) bulletBody->getMotionState() : nullptr;
+        if (state) {
+            state->flushWorldTransform();
+        }
+    }
+#endif
+}
+
+#if !VRO_PLATFORM_WASM
+void VROPhysicsWorld::runStepThread() {
+    std::unique_lock<std::mutex> lock(_stepMutex);
+    while (true) {
+        _stepCondition.wait(lock, [this] { return _stepPending || _stepThreadExit; });
+        if (_stepThreadExit) {
+            return;
+        }
+
+        float elapsed = _stepElapsed;
+        lock.unlock();
+        stepSimulation(elapsed);
+        lock.lock();
+
+        _stepPending = false;
+        _stepCondition.notify_all();
+    }
+}
+
+void VROPhysicsWorld::stopStepThread() {
+    if (!_stepThread.joinable()) {
+        return;
+    }
+    finishPhysics();
+    {
+        std::lock_guard<std::mutex> lock(_stepMutex);
+        _stepThreadExit = true;
+        _stepCondition.notify_all();
+    }
+    _stepThread.join();
+}
+#endif
+
 void VROPhysicsWorld::computeCollisions() {
     /*
-     We generate collision pairs in the form of [bodyKeyA][bodyKeyB], where the array row
-     [bodyKeyA] represents the body upon which to notify delegates about other bodies (array
-     column [bodyKeyB]) that had collided against it. Thus we have a map representing these
-     pairs of the form: map<physicsBodyKeyA, map<physicsBodyKeyB, VROCollision>>.
+     We write two contacts for each colliding pair of bodies into _contacts, one from the
+     perspective of each body, then sort the buffer by body so that each body's contacts
+     are contiguous. The buffer is reused from step to step, so reporting contacts does
+     not allocate once it has grown to the scene's working size.
      */
-    std::map<std::string, std::map<std::string, VROPhysicsBody::VROCollision>> collidedPairs;
+    _contacts.clear();
 
-    // Iterate through the dynamic world to generate collidedPairs from bullet's set of
+    // Iterate through the dynamic world to generate contacts from bullet's set of
     // collision pairs (manifolds) to be used for notifying our physics delegates.
     int numManifolds = _dynamicsWorld->getDispatcher()->getNumManifolds();
     for (int i = 0; i < numManifolds; i++) {
@@ -202,72 +482,96 @@ void VROPhysicsWorld::computeCollisions() {
             continue;
         }
 
-        // Grab collision properties from bullet
-        const btVector3& ptA = bulletPoint->getPositionWorldOnA();
-        const btVector3& ptB = bulletPoint->getPositionWorldOnB();
-        VROVector3f collisionOnBodyA = VROVector3f(ptA.x(), ptA.y(), ptA.z());
-        VROVector3f collisionOnBodyB = VROVector3f(ptB.x(), ptB.y(), ptB.z());
+        // Only bodies in this world (not e.g. temporary shape test objects) are reported
         VROPhysicsBody *vroPhysicsBodyA = ((VROPhysicsBody *) obA->getUserPointer());
         VROPhysicsBody *vroPhysicsBodyB = ((VROPhysicsBody *) obB->getUserPointer());
-        std::string bodyKeyA = vroPhysicsBodyA->getKey();
-        std::string bodyKeyB = vroPhysicsBodyB->getKey();
-        std::string bodyTagA = vroPhysicsBodyA->getTag();
-        std::string bodyTagB = vroPhysicsBodyB->getTag();
-
-        VROVector3f collidedNormalA = VROVector3f(bulletPoint->m_normalWorldOnB.x(),
-                                                  bulletPoint->m_normalWorldOnB.y(),
-                                                  bulletPoint->m_normalWorldOnB.z());
-
-        VROVector3f collidedNormalB = VROVector3f(bulletPoint->m_normalWorldOnB.x(),
-                                               bulletPoint->m_normalWorldOnB.y(),
-                                               bulletPoint->m_normalWorldOnB.z()) * -1;
-
-        /*
-         Update the properties of collision pairs in the form of [bodyKeyA][bodyKeyB], where
-         the array row [bodyKeyA] represents the body upon which to notify delegates about
-         other bodies (the array column [bodyKeyB]) that had collided against it (where
-         it had collided, and it's corresponding normals). Thus, to account for notifying
-         both collided bodies, we update both pairs as shown below. We also only save
-         the shallowest penetration point for a given pair.
-         */
-        if (collidedPairs[bodyKeyA][bodyKeyB].penetrationDistance > minPenetrationDistance) {
-            collidedPairs[bodyKeyA][bodyKeyB].collidedPoint = collisionOnBodyA;
-            collidedPairs[bodyKeyA][bodyKeyB].penetrationDistance = minPenetrationDistance;
-            collidedPairs[bodyKeyA][bodyKeyB].collidedBodyTag = bodyTagB;
-            collidedPairs[bodyKeyA][bodyKeyB].collidedNormal = collidedNormalA;
+        if (vroPhysicsBodyA->getWorld() != this || vroPhysicsBodyB->getWorld() != this) {
+            continue;
         }
 
-        if (collidedPairs[bodyKeyB][bodyKeyA].penetrationDistance > minPenetrationDistance) {
-            collidedPairs[bodyKeyB][bodyKeyA].collidedPoint = collisionOnBodyB;
-            collidedPairs[bodyKeyB][bodyKeyA].penetrationDistance = minPenetrationDistance;
-            collidedPairs[bodyKeyB][bodyKeyA].collidedBodyTag = bodyTagA;
-            collidedPairs[bodyKeyB][bodyKeyA].collidedNormal = collidedNormalB;
-        }
+        // Grab collision properties from bullet
+        const btVector3& ptA = bulletPoint->getPositionWorldOnA();
+        const btVector3& ptB = bulletPoint->getPositionWorldOnB();
+        VROVector3f normalOnB = VROVector3f(bulletPoint->m_normalWorldOnB.x(),
+                                            bulletPoint->m_normalWorldOnB.y(),
+                                            bulletPoint->m_normalWorldOnB.z());
+
+        _contacts.push_back({ vroPhysicsBodyA->getWorldIndex(),
+                              { vroPhysicsBodyB, vroPhysicsBodyB->getId(), VROVector3f(ptA.x(), ptA.y(), ptA.z()),
+                                normalOnB, minPenetrationDistance }});
+        _contacts.push_back({ vroPhysicsBodyB->getWorldIndex(),
+                              { vroPhysicsBodyA, vroPhysicsBodyA->getId(), VROVector3f(ptB.x(), ptB.y(), ptB.z()),
+                                normalOnB * -1, minPenetrationDistance }});
     }
 
     /*
-     Iterate through active vroPhysicsBodies and notify those with attached physics delegates about
-     the latest map of collided bodies and it's corresponding VROCollision.
+     Sort by body, then by the other body, then by penetration, so that each pair's
+     shallowest contact comes first. Only that contact is kept for each pair.
+     */
+    std::sort(_contacts.begin(), _contacts.end(), [](const VROPhysicsWorldContact &a, const VROPhysicsWorldContact &b) {
+        if (a.bodyIndex != b.bodyIndex) {
+            return a.bodyIndex < b.bodyIndex;
+        }
+        if (a.contact.otherBodyId != b.contact.otherBodyId) {
+            return a.contact.otherBodyId < b.contact.otherBodyId;
+        }
+        return a.contact.penetrationDistance > b.contact.penetrationDistance;
+    });
+
+    /*
+     Iterate through the active bodies and hand those with attached physics delegates the
+     pairs they are in contact with, in a single call per body.
      */
-    std::map<std::string, std::shared_ptr<VROPhysicsBody>>::iterator it_body;
-    for (it_body = _activePhysicsBodies.begin(); it_body != _activePhysicsBodies.end(); ++it_body) {
-        std::shared_ptr<VROPhysicsBody> physicsBodyA = it_body->second;
-        std::shared_ptr<VROPhysicsBodyDelegate> delegateA = physicsBodyA->getPhysicsDelegate();
+    size_t next = 0;
+    for (int i = 0; i < (int) _bodies.size(); i++) {
+        _bodyContacts.clear();
+        while (next < _contacts.size() && _contacts[next].bodyIndex == i) {
+            const VROPhysicsBody::VROContact &contact = _contacts[next].contact;
+            if (_bodyContacts.empty() || _bodyContacts.back().otherBodyId != contact.otherBodyId) {
+                _bodyContacts.push_back(contact);
+            }
+            ++next;
+        }
+
+        std::shared_ptr<VROPhysicsBodyDelegate> delegateA = _bodies[i]->getPhysicsDelegate();
         if (!delegateA){
             continue;
         }
-
-        std::string key = physicsBodyA->getKey();
-        delegateA->onEngineCollisionUpdate(key, collidedPairs[key]);
-        collidedPairs[key].clear();
+        delegateA->onEngineCollisionUpdate(_bodies[i].get(), _bodyContacts.data(), (int) _bodyContacts.size());
     }
+}
+
+int VROPhysicsWorld::castRays(const VROPhysicsRay *rays, int numRays, VROPhysicsRayHit *outHits) {
+    finishPhysics();
 
-    collidedPairs.clear();
+    int numHits = 0;
+    for (int i = 0; i < numRays; i++) {
+        btVector3 from = { rays[i].from.x, rays[i].from.y, rays[i].from.z };
+        btVector3 to = { rays[i].to.x, rays[i].to.y, rays[i].to.z };
+
+        btCollisionWorld::ClosestRayResultCallback result(from, to);
+        _dynamicsWorld->rayTest(from, to, result);
+
+        VROPhysicsRayHit &hit = outHits[i];
+        if (!result.hasHit() || result.m_collisionObject->getUserPointer() == nullptr) {
+            hit.body = nullptr;
+            hit.fraction = 1;
+            continue;
+        }
+
+        hit.body = (VROPhysicsBody *) result.m_collisionObject->getUserPointer();
+        hit.point = VROVector3f(result.m_hitPointWorld.x(), result.m_hitPointWorld.y(), result.m_hitPointWorld.z());
+        hit.normal = VROVector3f(result.m_hitNormalWorld.x(), result.m_hitNormalWorld.y(), result.m_hitNormalWorld.z());
+        hit.fraction = result.m_closestHitFraction;
+        ++numHits;
+    }
+    return numHits;
 }
 
 bool VROPhysicsWorld::findCollisionsWithRay(VROVector3f fromPos, VROVector3f toPos,
                                             bool returnClosest,
                                             std::string rayTag){
+    finishPhysics();
     btVector3 from = {fromPos.x, fromPos.y, fromPos.z};
     btVector3 to = {toPos.x, toPos.y, toPos.z};
 
@@ -353,6 +657,7 @@ bool VROPhysicsWorld::findCollisionsWithRay(VROVector3f fromPos, VROVector3f toP
 bool VROPhysicsWorld::findCollisionsWithShape(VROVector3f fromPos, VROVector3f toPos,
                                               std::shared_ptr<VROPhysicsShape> shape,
                                               std::string rayTag) {
+    finishPhysics();
     if (fromPos == toPos) {
         // We are performing a shapeCollision test at a point
         return collisionTestAtPoint(fromPos, shape, rayTag);
@@ -372,25 +677,27 @@ bool VROPhysicsWorld::collisionTestAtPoint(VROVector3f pos,
         return false;
     }
 
-    // Create a temporary collision object with the provided shape, and add it to the dynamic
-    // world to perform the collision test with.
-    btCollisionObject* col = new btCollisionObject();
-    col->setCollisionShape(bulletShape);
-    col->setCollisionFlags(btCollisionObject::CF_STATIC_OBJECT);
-    col->setWorldTransform(btTransform(btQuaternion::getIdentity(), position));
-    _dynamicsWorld->addCollisionObject(col);
+    // Create a temporary collision object with the provided shape to perform the
+    // collision test with.
+    btCollisionObject col;
+    col.setCollisionShape(bulletShape);
+    col.setCollisionFlags(btCollisionObject::CF_STATIC_OBJECT);
+    col.setWorldTransform(btTransform(btQuaternion::getIdentity(), position));
 
-    // Perform the collision contact test
+    // Perform the collision contact test. contactTest queries the world's broadphase
+    // with the object's bounds, so the object does not need to be added to the world.
     VROPhysicsContactResultCallback results;
-    _dynamicsWorld->contactTest(col, results);
+    _dynamicsWorld->contactTest(&col, results);
 
     // Notify the corresponding delegates of collided objects.
-    for (VROPhysicsBody::VROCollision collision : results._collisions) {
-        if (_activePhysicsBodies.count(collision.collidedBodyTag) == 0){
+    for (size_t i = 0; i < results._collisions.size(); i++) {
+        VROPhysicsBody::VROCollision collision = results._collisions[i];
+        VROPhysicsBody *collidedBody = results._collidedBodies[i];
+        if (collidedBody->getWorld() != this) {
             continue;
         }
         
-        std::shared_ptr<VROPhysicsBody> body = _activePhysicsBodies[collision.collidedBodyTag];
+        std::shared_ptr<VROPhysicsBody> body = _bodies[collidedBody->getWorldIndex()];
         std::shared_ptr<VROPhysicsBodyDelegate> delegate = body->getPhysicsDelegate();
         if (delegate == nullptr) {
             continue;
@@ -400,10 +707,6 @@ bool VROPhysicsWorld::collisionTestAtPoint(VROVector3f pos,
         delegate->onCollided(body->getKey(), collision);
     }
 
-    // After the collision tests are done, remove our temporary collision object.
-    _dynamicsWorld->removeCollisionObject(col);
-    delete(col);
-
     return results._collisions.size() > 0;
 }
 
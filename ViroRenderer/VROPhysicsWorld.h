@@ -27,17 +27,66 @@
 #define VROPhysicsWorld_h
 #include <memory>
 #include "VROPhysicsBody.h"
+#include "VRODefines.h"
+#include <vector>
+
+// The Bullet build bundled with WebAssembly predates the multithreaded solver,
+// so physics stays on the rendering thread there even when built with pthreads
+#if !VRO_PLATFORM_WASM
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#endif
 
 class btBulletDynamicsCommon;
 class btDiscreteDynamicsWorld;
 class btBroadphaseInterface;
 class btDefaultCollisionConfiguration;
 class btCollisionDispatcher;
-class btSequentialImpulseConstraintSolver;
+class btConstraintSolver;
 class VROPhysicsDebugDraw;
 class VRODriver;
 class VRORenderContext;
 
+/*
+ The broadphase used to find potentially colliding pairs of bodies.
+ */
+enum class VROPhysicsBroadphase {
+    /*
+     Dynamic AABB tree. Handles any number of bodies, anywhere, moving freely.
+     */
+    DynamicTree,
+
+    /*
+     Sweep and prune over quantized bounds. Cheapest when most bodies are static
+     or move little between steps, but bodies must stay within 500m of the origin.
+     */
+    SweepAndPrune,
+};
+
+/*
+ A ray for batched queries through VROPhysicsWorld::castRays.
+ */
+struct VROPhysicsRay {
+    VROVector3f from;
+    VROVector3f to;
+};
+
+/*
+ The closest hit of a VROPhysicsRay. If the ray hit nothing, body is null. The body
+ pointer is valid until the body is removed from the world.
+ */
+struct VROPhysicsRayHit {
+    VROPhysicsBody *body;
+    VROVector3f point;
+    VROVector3f normal;
+
+    /*
+     The distance of the hit along the ray, from 0 (at the ray's start) to 1 (its end).
+     */
+    float fraction;
+};
+
 /*
  VROPhysicsWorld is a simulated physics environment that contains and processes
  all acting forces and collisions on VROPhysicsBodies. It also contains both
@@ -47,6 +96,14 @@ class VRORenderContext;
 class VROPhysicsWorld{
 public:
     VROPhysicsWorld();
+
+    /*
+     Create a physics world with the given broadphase. If multithreaded is true, the
+     world solves simulation islands and integrates bodies in parallel on the physics
+     worker pool; this only takes effect when the Bullet library is built with
+     BT_THREADSAFE, and is ignored on platforms without threads.
+     */
+    VROPhysicsWorld(VROPhysicsBroadphase broadphase, bool multithreaded);
     virtual ~VROPhysicsWorld();
 
     /*
@@ -58,10 +115,36 @@ public:
     void removePhysicsBody(std::shared_ptr<VROPhysicsBody> body);
 
     /*
-     When called, performs a timeStep of simulation / calculations for this physics world.
+     When called, advances the simulation by the time elapsed since the last call. The
+     simulation itself always moves in fixed steps, so it runs at the same speed
+     regardless of frame rate; frames that fall between steps show interpolated
+     transforms.
+
+     When stepping asynchronously, this instead starts the step on the physics thread
+     and returns, and finishPhysics() must be invoked before the frame ends.
      */
     void computePhysics(const VRORenderContext &context);
 
+    /*
+     Wait for the step started by computePhysics, if it is running on the physics
+     thread, then write its results onto the nodes of each body. Does nothing when
+     stepping synchronously.
+     */
+    void finishPhysics();
+
+    /*
+     If true, each step runs on a dedicated physics thread, overlapping the rendering
+     of the frame. Node transforms then reflect the step that completed in the
+     previous frame. Ignored on platforms without threads.
+     */
+    void setAsyncStepping(bool async);
+
+    /*
+     Schedule the given body, which must be in this world, to be updated before the
+     next step. Invoked by VROPhysicsBody when it is modified.
+     */
+    void markBodyDirty(VROPhysicsBody *body);
+
     /*
      Iterate through the dynamic world, identify collided object pairs and notify their corresponding
      physicsBodyDelegates regarding the collision event.
@@ -81,6 +164,14 @@ public:
     bool findCollisionsWithRay(VROVector3f from, VROVector3f to, bool returnClosest,
                                std::string rayTag);
 
+    /*
+     Casts each of the given rays into the scene, writing the closest hit of ray i into
+     outHits[i]. Returns the number of rays that hit a body. Unlike findCollisionsWithRay,
+     no delegates are notified and nothing is allocated, so this is suited to casting
+     many rays each frame into caller-owned buffers.
+     */
+    int castRays(const VROPhysicsRay *rays, int numRays, VROPhysicsRayHit *outHits);
+
     /*
      Projects a shape into the scene from the given start to end location and returns
      true if it has collided with any VROPhysics shape. If a collision occurred,
@@ -104,8 +195,33 @@ private:
     
     /*
      Represents the physicsBodies that have been added to and processed by this physics world.
+     Each body stores its index in this vector, so bodies are added and removed in constant
+     time.
+     */
+    std::vector<std::shared_ptr<VROPhysicsBody>> _bodies;
+
+    /*
+     The bodies that must be updated before the next step: those modified since the last
+     step, and those with forces that are re-applied every step.
+     */
+    std::vector<VROPhysicsBody *> _dirtyBodies;
+
+    /*
+     Buffers for contacts found by computeCollisions, reused across steps. _contacts holds
+     every contact of the step, tagged with the index of the body it is reported to;
+     _bodyContacts holds the contacts of the body currently being reported.
      */
-    std::map<std::string, std::shared_ptr<VROPhysicsBody>> _activePhysicsBodies;
+    struct VROPhysicsWorldContact {
+        int bodyIndex;
+        VROPhysicsBody::VROContact contact;
+    };
+    std::vector<VROPhysicsWorldContact> _contacts;
+    std::vector<VROPhysicsBody::VROContact> _bodyContacts;
+
+    /*
+     Apply the modifications of each dirty body to its Bullet body.
+     */
+    void updatePhysicsBodies();
 
     /*
      Bullet's representation of the physics world.
@@ -132,7 +248,7 @@ private:
      Represents the constraints upon which the objects in this world will be resolved against.
      This takes into account things like gravity, collisions, and hinges.
      */
-    btSequentialImpulseConstraintSolver* _constraintSolver;
+    btConstraintSolver* _constraintSolver;
 
     /*
      Performs a collision shape test at the given location, returns true if it has collided
@@ -155,5 +271,33 @@ private:
      */
     VROPhysicsDebugDraw* _debugDraw;
     bool _debugDrawVisible;
+
+    /*
+     The time at which the simulation was last advanced, in seconds, or a negative
+     number if the simulation has not yet run.
+     */
+    double _lastStepTime;
+
+    /*
+     Advance the simulation by the given number of seconds.
+     */
+    void stepSimulation(float elapsed);
+
+#if !VRO_PLATFORM_WASM
+    /*
+     The physics thread, and the state shared with it. _stepPending is set when a
+     step is started and cleared by the physics thread once it completes.
+     */
+    std::thread _stepThread;
+    std::mutex _stepMutex;
+    std::condition_variable _stepCondition;
+    bool _asyncStepping;
+    bool _stepPending;
+    bool _stepThreadExit;
+    float _stepElapsed;
+
+    void runStepThread();
+    void stopStepThread();
+#endif
 };
 #endif
@@ -26,11 +26,17 @@
 
 #include "VROPlatformUtil.h"
 #include "VROLog.h"
+#include "VROImageDecoder.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <fstream>
 #include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "VROOpenGL.h"
+#include "VRORenderInvalidation.h"
 
 static VROPlatformType sPlatformType = VROPlatformType::Unknown;
 
@@ -84,10 +90,102 @@ void *VROPlatformLoadFile(std::string filename, int *outLength) {
     return ret;
 }
 
+const void *VROPlatformMapFile(std::string filename, size_t *outLength) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        pinfo("Failed to open file %s", filename.c_str());
+        return nullptr;
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return nullptr;
+    }
+    
+    // The mapping remains valid after the descriptor is closed
+    void *data = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        pinfo("Failed to map file %s", filename.c_str());
+        return nullptr;
+    }
+    
+    *outLength = (size_t) st.st_size;
+    return data;
+}
+
+void VROPlatformUnmapFile(const void *data, size_t length) {
+    if (data) {
+        munmap((void *) data, length);
+    }
+}
+
+uint64_t VROPlatformHashCacheKey(const void *data, size_t length, uint64_t seed) {
+    const uint64_t kFNVPrime = 1099511628211ULL;
+    
+    const uint8_t *bytes = (const uint8_t *) data;
+    uint64_t h = seed;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, bytes + i, sizeof(word));
+        h = (h ^ word) * kFNVPrime;
+    }
+    for (; i < length; i++) {
+        h = (h ^ bytes[i]) * kFNVPrime;
+    }
+    return h;
+}
+
+static void VROPlatformMakeDirectories(const std::string &directory) {
+    // Create each ancestor in turn; those that already exist fail harmlessly
+    for (size_t slash = directory.find('/', 1); slash != std::string::npos; slash = directory.find('/', slash + 1)) {
+        mkdir(directory.substr(0, slash).c_str(), 0700);
+    }
+    mkdir(directory.c_str(), 0700);
+}
+
+bool VROPlatformWriteCacheFile(std::string path, std::function<bool(FILE *file)> write) {
+    static VROAtomic<unsigned int> sNextTempFile(0);
+    
+    size_t lastSlash = path.find_last_of('/');
+    if (lastSlash != std::string::npos && lastSlash > 0) {
+        VROPlatformMakeDirectories(path.substr(0, lastSlash));
+    }
+    
+    // Each write has its own temporary file, so that concurrent writes of the same
+    // file never interleave; whichever is renamed last wins, whole
+    char suffix[48];
+    snprintf(suffix, sizeof(suffix), ".%d.%u.tmp", (int) getpid(), (unsigned int) sNextTempFile++);
+    std::string tempPath = path + suffix;
+    FILE *file = fopen(tempPath.c_str(), "wb");
+    if (!file) {
+        pwarn("Failed to open cache file %s for writing", tempPath.c_str());
+        return false;
+    }
+    
+    bool success = write(file);
+    success = (fclose(file) == 0) && success;
+    if (!success || rename(tempPath.c_str(), path.c_str()) != 0) {
+        pwarn("Failed to write cache file %s", path.c_str());
+        remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool VROPlatformWriteCacheFile(std::string path, const void *data, size_t length) {
+    return VROPlatformWriteCacheFile(path, [data, length](FILE *file) {
+        return length == 0 || fwrite(data, 1, length, file) == length;
+    });
+}
+
 #pragma mark - iOS and MacOS
 #if VRO_PLATFORM_IOS || VRO_PLATFORM_MACOS
 
 #import <Foundation/Foundation.h>
+#include "VROStringUtil.h"
 
 NSURLSessionDataTask *downloadDataWithURLSynchronous(NSURL *url,
                                                      void (^completionBlock)(NSData *data, NSError *error));
@@ -135,6 +233,52 @@ std::string VROPlatformDownloadURLToFile(std::string url, bool *temp, bool *succ
     }
 }
 
+int VROPlatformDownloadURLWithHeaders(std::string url, std::string path,
+                                      const std::map<std::string, std::string> &requestHeaders,
+                                      std::map<std::string, std::string> *outResponseHeaders) {
+    NSURL *URL = [NSURL URLWithString:[NSString stringWithUTF8String:url.c_str()]];
+    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:URL];
+    request.timeoutInterval = 30;
+    
+    // The caller validates its own cache, so the URL cache is bypassed
+    request.cachePolicy = NSURLRequestReloadIgnoringLocalCacheData;
+    for (auto &kv : requestHeaders) {
+        [request setValue:[NSString stringWithUTF8String:kv.second.c_str()]
+       forHTTPHeaderField:[NSString stringWithUTF8String:kv.first.c_str()]];
+    }
+    
+    __block int status = 0;
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    NSURLSession *session = [NSURLSession sessionWithConfiguration:[NSURLSessionConfiguration defaultSessionConfiguration]];
+    NSURLSessionDataTask *task = [session dataTaskWithRequest:request
+                                            completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+        if (!error && [response isKindOfClass:[NSHTTPURLResponse class]]) {
+            NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse *) response;
+            status = (int) httpResponse.statusCode;
+            [httpResponse.allHeaderFields enumerateKeysAndObjectsUsingBlock:^(id key, id value, BOOL *stop) {
+                std::string name = [[key description] UTF8String];
+                VROStringUtil::toLowerCase(name);
+                (*outResponseHeaders)[name] = [[value description] UTF8String];
+            }];
+            
+            if (status >= 200 && status < 300) {
+                FILE *file = fopen(path.c_str(), status == 206 ? "ab" : "wb");
+                if (!file || (data.length > 0 && fwrite(data.bytes, 1, data.length, file) != data.length)) {
+                    status = 0;
+                }
+                if (file) {
+                    fclose(file);
+                }
+            }
+        }
+        dispatch_semaphore_signal(semaphore);
+    }];
+    [task resume];
+    [session finishTasksAndInvalidate];
+    dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+    return status;
+}
+
 void VROPlatformDownloadURLToFileAsync(std::string url,
                                        std::function<void(std::string, bool)> onSuccess,
                                        std::function<void()> onFailure) {
@@ -188,6 +332,34 @@ std::string VROPlatformGetDeviceBrand() {
     return ""; // TODO: do this for iOS/MacOS if required
 }
 
+VROThermalState VROPlatformGetThermalState() {
+    switch ([[NSProcessInfo processInfo] thermalState]) {
+        case NSProcessInfoThermalStateNominal:
+            return VROThermalState::Nominal;
+        case NSProcessInfoThermalStateFair:
+            return VROThermalState::Fair;
+        case NSProcessInfoThermalStateSerious:
+            return VROThermalState::Serious;
+        case NSProcessInfoThermalStateCritical:
+            return VROThermalState::Critical;
+        default:
+            return VROThermalState::Unknown;
+    }
+}
+
+bool VROPlatformIsLowPowerModeEnabled() {
+#if VRO_PLATFORM_IOS
+    return [[NSProcessInfo processInfo] isLowPowerModeEnabled];
+#else
+    return false;
+#endif
+}
+
+std::string VROPlatformGetCacheDirectory() {
+    NSArray *paths = NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES);
+    return std::string([[paths firstObject] UTF8String]);
+}
+
 #pragma mark - iOS
 
 #if VRO_PLATFORM_IOS
@@ -199,6 +371,7 @@ void VROPlatformSetEAGLContext(EAGLContext *context) {
 }
 
 void VROPlatformDispatchAsyncRenderer(std::function<void()> fcn) {
+    VRORenderInvalidation::invalidate();
     dispatch_async(dispatch_get_main_queue(), ^{
         // Ensure the EAGLContext is set whenever we dispatch to the
         // rendering thread. Otherwise we may end up invoking GL
@@ -226,6 +399,25 @@ void VROPlatformDispatchAsyncBackground(std::function<void()> fcn) {
     });
 }
 
+std::shared_ptr<VROTaskToken> VROPlatformDispatchAsyncWorker(std::function<void()> fcn, VROTaskPriority priority) {
+    // GCD is already a native pool, so we only need to map the priority
+    long queuePriority = DISPATCH_QUEUE_PRIORITY_DEFAULT;
+    if (priority == VROTaskPriority::High) {
+        queuePriority = DISPATCH_QUEUE_PRIORITY_HIGH;
+    }
+    else if (priority == VROTaskPriority::Low) {
+        queuePriority = DISPATCH_QUEUE_PRIORITY_LOW;
+    }
+
+    std::shared_ptr<VROTaskToken> token = std::make_shared<VROTaskToken>();
+    dispatch_async(dispatch_get_global_queue(queuePriority, 0), ^{
+        if (!token->isCancelled()) {
+            fcn();
+        }
+    });
+    return token;
+}
+
 NSURLSessionDataTask *downloadDataWithURLSynchronous(NSURL *url,
                                                      void (^completionBlock)(NSData *data, NSError *error)) {
     
@@ -304,7 +496,13 @@ std::shared_ptr<VROImage> VROPlatformLoadImageFromFile(std::string filename,
     return std::make_shared<VROImageiOS>(image, format);
 }
 
-std::shared_ptr<VROImage> VROPlatformLoadImageWithBufferedData(std::vector<unsigned char> rawData, VROTextureInternalFormat format) {
+std::shared_ptr<VROImage> VROPlatformLoadImageWithBufferedData(const std::vector<unsigned char> &rawData,
+                                                               VROTextureInternalFormat format) {
+    std::shared_ptr<VROImage> decoded = VROImageDecoder::decode(rawData.data(), rawData.size(), format);
+    if (decoded) {
+        return decoded;
+    }
+
     NSData *data = [NSData dataWithBytes:rawData.data() length:rawData.size()];
     if (!data) {
         pwarn("Error when processing buffered image data.");
@@ -367,6 +565,7 @@ VRORenderingThreadContext *VROPlatformGetRenderingThreadContext() {
 void VROPlatformDispatchAsyncRenderer(std::function<void()> fcn) {
     VRORenderingThreadContext *context = VROPlatformGetRenderingThreadContext();
     passert (context != nullptr);
+    VRORenderInvalidation::invalidate();
     [context->view queueRendererTask:fcn];
 }
 
@@ -383,6 +582,19 @@ void VROPlatformDispatchAsyncBackground(std::function<void()> fcn) {
     });
 }
 
+std::shared_ptr<VROTaskToken> VROPlatformDispatchAsyncWorker(std::function<void()> fcn, VROTaskPriority priority) {
+    // Tasks have to run on the background queue, which carries the rendering
+    // context, so priority is not applied on MacOS
+    passert (_context != nullptr);
+    std::shared_ptr<VROTaskToken> token = std::make_shared<VROTaskToken>();
+    dispatch_async(_context->backgroundQueue, ^{
+        if (!token->isCancelled()) {
+            fcn();
+        }
+    });
+    return token;
+}
+
 NSURLSessionDataTask *downloadDataWithURLSynchronous(NSURL *url,
                                                      void (^completionBlock)(NSData *data, NSError *error)) {
     
@@ -435,9 +647,9 @@ std::shared_ptr<VROImage> VROPlatformLoadImageFromFile(std::string filename,
     return std::make_shared<VROImageMacOS>(image, format);
 }
 
-std::shared_ptr<VROImage> VROPlatformLoadImageWithBufferedData(std::vector<unsigned char> rawData,
+std::shared_ptr<VROImage> VROPlatformLoadImageWithBufferedData(const std::vector<unsigned char> &rawData,
                                                                VROTextureInternalFormat format) {
-    return nullptr;
+    return VROImageDecoder::decode(rawData.data(), rawData.size(), format);
 }
 
 #endif
@@ -448,10 +660,14 @@ std::shared_ptr<VROImage> VROPlatformLoadImageWithBufferedData(std::vector<unsig
 #include "VROImageAndroid.h"
 #include "VROStringUtil.h"
 #include "VROByteBuffer.h"
+#include "VROMPSCQueue.h"
+#include "VROTime.h"
 #include <mutex>
 #include <thread>
+#include <unordered_map>
 #include <android/bitmap.h>
 #include <algorithm>
+#include <dlfcn.h>
 
 // We can hold a static reference to the JVM and to global references, but not to individual
 // JNIEnv objects, as those are thread-local. Access the JNIEnv object via getJNIEnv().
@@ -468,21 +684,35 @@ static AAssetManager *sAssetMgr = nullptr;
 // mutex.
 static std::mutex sTaskMapMutex;
 static int sTaskIdGenerator;
-static std::map<int, std::function<void()>> sTaskMap;
+static std::unordered_map<int, std::function<void()>> sTaskMap;
 
 // These queues store the ids of tasks to run on their respective threads once VROPlatformUtil
 // has properly been setup. This is because running these tasks require the PlatformUtil java
 // object to be created and set on sPlatformUtil.
 static std::vector<int> sBackgroundQueue;
-static std::vector<int> sRendererQueue;
 static std::vector<int> sAsyncQueue;
 
+// Tasks for the rendering thread. These bypass the task map and Java entirely: any thread
+// pushes onto this lock-free inbox, and the renderer drains it at the start of each frame.
+static VROMPSCQueue<std::function<void()>> sRendererInbox;
+
 // Mutexes for the queues. Note that in normal operation we never need to lock the queues; they're
 // only used during startup while waiting for initialization to complete.
 static std::mutex sBackgroundQueueMutex;
-static std::mutex sRendererQueueMutex;
 static std::mutex sAsyncQueueMutex;
 
+// PlatformUtil.dispatchAsyncBackground, resolved once when the environment is set. Resolving
+// it per dispatch costs a FindClass round trip, and FindClass cannot find our classes at all
+// from threads attached in native code (e.g. the worker pool)
+static jmethodID sDispatchAsyncBackgroundMethod = nullptr;
+
+// Native pool for VROPlatformDispatchAsyncWorker tasks. Intentionally never destroyed, so that
+// static destruction at exit doesn't wait on in-flight tasks
+static VROTaskPool *VROPlatformGetTaskPool() {
+    static VROTaskPool *sTaskPool = new VROTaskPool();
+    return sTaskPool;
+}
+
 // Get the JNI Environment for the current thread. If the JavaVM is not yet attached to the
 // current thread, attach it
 void getJNIEnv(JNIEnv **jenv) {
@@ -499,6 +729,10 @@ void VROPlatformSetEnv(JNIEnv *env, jobject appContext, jobject assetManager, jo
     sPlatformUtil = env->NewGlobalRef(platformUtil);
     sAssetMgr = AAssetManager_fromJava(env, assetManager);
 
+    jclass cls = env->GetObjectClass(sPlatformUtil);
+    sDispatchAsyncBackgroundMethod = env->GetMethodID(cls, "dispatchAsyncBackground", "(I)V");
+    env->DeleteLocalRef(cls);
+
     // Now that we've properly setup VROPlatformUtil, flush the task queues.
     VROPlatformFlushTaskQueues();
 }
@@ -586,6 +820,125 @@ std::string VROPlatformDownloadURLToFile(std::string url, bool *temp, bool *succ
     return spath;
 }
 
+int VROPlatformDownloadURLWithHeaders(std::string url, std::string path,
+                                      const std::map<std::string, std::string> &requestHeaders,
+                                      std::map<std::string, std::string> *outResponseHeaders) {
+    JNIEnv *env = VROPlatformGetJNIEnv();
+    
+    // Any of the calls below may throw (e.g. an IOException for a dropped connection)
+    auto failed = [env] {
+        if (env->ExceptionCheck()) {
+            env->ExceptionClear();
+            return true;
+        }
+        return false;
+    };
+    
+    jclass urlCls = env->FindClass("java/net/URL");
+    jclass connectionCls = env->FindClass("java/net/HttpURLConnection");
+    jclass streamCls = env->FindClass("java/io/InputStream");
+    jmethodID jurlInit = env->GetMethodID(urlCls, "<init>", "(Ljava/lang/String;)V");
+    jmethodID jopenConnection = env->GetMethodID(urlCls, "openConnection", "()Ljava/net/URLConnection;");
+    jmethodID jsetTimeout = env->GetMethodID(connectionCls, "setConnectTimeout", "(I)V");
+    jmethodID jsetReadTimeout = env->GetMethodID(connectionCls, "setReadTimeout", "(I)V");
+    jmethodID jsetProperty = env->GetMethodID(connectionCls, "setRequestProperty", "(Ljava/lang/String;Ljava/lang/String;)V");
+    jmethodID jgetResponseCode = env->GetMethodID(connectionCls, "getResponseCode", "()I");
+    jmethodID jgetHeaderKey = env->GetMethodID(connectionCls, "getHeaderFieldKey", "(I)Ljava/lang/String;");
+    jmethodID jgetHeader = env->GetMethodID(connectionCls, "getHeaderField", "(I)Ljava/lang/String;");
+    jmethodID jgetInputStream = env->GetMethodID(connectionCls, "getInputStream", "()Ljava/io/InputStream;");
+    jmethodID jdisconnect = env->GetMethodID(connectionCls, "disconnect", "()V");
+    jmethodID jread = env->GetMethodID(streamCls, "read", "([B)I");
+    jmethodID jclose = env->GetMethodID(streamCls, "close", "()V");
+    
+    int status = 0;
+    VRO_STRING jurlString = VRO_NEW_STRING(url.c_str());
+    jobject jurl = env->NewObject(urlCls, jurlInit, jurlString);
+    jobject jconnection = failed() ? nullptr : env->CallObjectMethod(jurl, jopenConnection);
+    
+    if (!failed() && jconnection != nullptr) {
+        env->CallVoidMethod(jconnection, jsetTimeout, 30000);
+        env->CallVoidMethod(jconnection, jsetReadTimeout, 30000);
+        for (auto &kv : requestHeaders) {
+            VRO_STRING jname = VRO_NEW_STRING(kv.first.c_str());
+            VRO_STRING jvalue = VRO_NEW_STRING(kv.second.c_str());
+            env->CallVoidMethod(jconnection, jsetProperty, jname, jvalue);
+            env->DeleteLocalRef(jname);
+            env->DeleteLocalRef(jvalue);
+        }
+        
+        status = env->CallIntMethod(jconnection, jgetResponseCode);
+        if (failed()) {
+            status = 0;
+        }
+        
+        // Header 0 is the status line, which has no key
+        for (int i = 1; status > 0; i++) {
+            VRO_STRING jkey = (VRO_STRING) env->CallObjectMethod(jconnection, jgetHeaderKey, i);
+            if (failed() || jkey == nullptr) {
+                break;
+            }
+            VRO_STRING jvalue = (VRO_STRING) env->CallObjectMethod(jconnection, jgetHeader, i);
+            if (!failed() && jvalue != nullptr) {
+                std::string name = VRO_STRING_STL(jkey);
+                VROStringUtil::toLowerCase(name);
+                (*outResponseHeaders)[name] = VRO_STRING_STL(jvalue);
+                env->DeleteLocalRef(jvalue);
+            }
+            env->DeleteLocalRef(jkey);
+        }
+        
+        if (status >= 200 && status < 300) {
+            jobject jstream = env->CallObjectMethod(jconnection, jgetInputStream);
+            FILE *file = failed() ? nullptr : fopen(path.c_str(), status == 206 ? "ab" : "wb");
+            
+            if (file == nullptr) {
+                status = 0;
+            }
+            else {
+                const int kBufferSize = 64 * 1024;
+                jbyteArray jbuffer = env->NewByteArray(kBufferSize);
+                std::vector<jbyte> buffer(kBufferSize);
+                while (true) {
+                    jint read = env->CallIntMethod(jstream, jread, jbuffer);
+                    if (failed()) {
+                        status = 0;
+                        break;
+                    }
+                    if (read < 0) {
+                        break;
+                    }
+                    env->GetByteArrayRegion(jbuffer, 0, read, buffer.data());
+                    if (fwrite(buffer.data(), 1, read, file) != (size_t) read) {
+                        status = 0;
+                        break;
+                    }
+                }
+                fclose(file);
+                env->DeleteLocalRef(jbuffer);
+            }
+            if (jstream != nullptr) {
+                env->CallVoidMethod(jstream, jclose);
+                failed();
+                env->DeleteLocalRef(jstream);
+            }
+        }
+        env->CallVoidMethod(jconnection, jdisconnect);
+        failed();
+    }
+    
+    if (jconnection != nullptr) {
+        env->DeleteLocalRef(jconnection);
+    }
+    if (jurl != nullptr) {
+        env->DeleteLocalRef(jurl);
+    }
+    env->DeleteLocalRef(jurlString);
+    env->DeleteLocalRef(urlCls);
+    env->DeleteLocalRef(connectionCls);
+    env->DeleteLocalRef(streamCls);
+    return status;
+}
+
 void VROPlatformDownloadURLToFileAsync(std::string url,
                                        std::function<void(std::string, bool)> onSuccess,
                                        std::function<void()> onFailure) {
@@ -836,8 +1189,15 @@ jobject VROPlatformLoadBitmapFromFile(std::string path, VROTextureInternalFormat
 }
 
 
-std::shared_ptr<VROImage> VROPlatformLoadImageWithBufferedData(std::vector<unsigned char> rawData,
+std::shared_ptr<VROImage> VROPlatformLoadImageWithBufferedData(const std::vector<unsigned char> &rawData,
                                                                VROTextureInternalFormat format) {
+    // Decode natively when possible, avoiding the copies and serialization of
+    // decoding through a Java Bitmap
+    std::shared_ptr<VROImage> decoded = VROImageDecoder::decode(rawData.data(), rawData.size(), format);
+    if (decoded) {
+        return decoded;
+    }
+
     if (sPlatformUtil == NULL) {
         pinfo("Platform not initialized, will not load image from buffered data");
         return 0;
@@ -1021,17 +1381,7 @@ int VROPlatformGenerateTask(std::function<void()> fcn) {
     return taskId;
 }
 
-void VROPlatformRunTask(int taskId) {
-    std::function<void()> fcn;
-    {
-        std::lock_guard<std::mutex> lock(sTaskMapMutex);
-        auto it = sTaskMap.find(taskId);
-        if (it != sTaskMap.end()) {
-            fcn = it->second;
-            sTaskMap.erase(it);
-        }
-    }
-
+static void VROPlatformRunTaskFunction(const std::function<void()> &fcn) {
     try {
         if (fcn) {
             fcn();
@@ -1048,6 +1398,19 @@ void VROPlatformRunTask(int taskId) {
     }
 }
 
+void VROPlatformRunTask(int taskId) {
+    std::function<void()> fcn;
+    {
+        std::lock_guard<std::mutex> lock(sTaskMapMutex);
+        auto it = sTaskMap.find(taskId);
+        if (it != sTaskMap.end()) {
+            fcn = std::move(it->second);
+            sTaskMap.erase(it);
+        }
+    }
+    VROPlatformRunTaskFunction(fcn);
+}
+
 void VROPlatformDispatchAsyncBackground(std::function<void()> fcn) {
     int task = VROPlatformGenerateTask(fcn);
 
@@ -1059,23 +1422,35 @@ void VROPlatformDispatchAsyncBackground(std::function<void()> fcn) {
 
     JNIEnv *env;
     getJNIEnv(&env);
+    env->CallVoidMethod(sPlatformUtil, sDispatchAsyncBackgroundMethod, task);
+}
 
-    jclass cls = env->FindClass("com/viro/core/internal/PlatformUtil");
-    jmethodID jmethod = env->GetMethodID(cls, "dispatchAsyncBackground", "(I)V");
-    env->CallVoidMethod(sPlatformUtil, jmethod, task);
-
-    env->DeleteLocalRef(cls);
+std::shared_ptr<VROTaskToken> VROPlatformDispatchAsyncWorker(std::function<void()> fcn, VROTaskPriority priority) {
+    return VROPlatformGetTaskPool()->dispatch([fcn] {
+        VROPlatformRunTaskFunction(fcn);
+    }, priority);
 }
 
 void VROPlatformDispatchAsyncRenderer(std::function<void()> fcn) {
-    int task = VROPlatformGenerateTask(fcn);
-    if (!sPlatformUtil) {
-        std::lock_guard<std::mutex> guard(sRendererQueueMutex);
-        sRendererQueue.push_back(task);
-        return;
+    sRendererInbox.push(std::move(fcn));
+    VRORenderInvalidation::invalidate();
+}
+
+int VROPlatformProcessRendererTasks(double budgetMillis) {
+    uint64_t deadline = VRONanoTime() + (uint64_t) (budgetMillis * 1000000);
+    int processed = 0;
+
+    // Always run at least one task per frame so a budget overrun can't starve the inbox
+    std::function<void()> fcn;
+    while (sRendererInbox.pop(&fcn)) {
+        VROPlatformRunTaskFunction(fcn);
+        processed++;
+
+        if (VRONanoTime() >= deadline) {
+            break;
+        }
     }
-    VROPlatformCallHostFunction(sPlatformUtil,
-                                "dispatchRenderer", "(I)V", task);
+    return processed;
 }
 
 void VROPlatformDispatchAsyncApplication(std::function<void()> fcn){
@@ -1092,28 +1467,14 @@ void VROPlatformDispatchAsyncApplication(std::function<void()> fcn){
 void VROPlatformFlushTaskQueues() {
     {
         std::lock_guard<std::mutex> guard(sBackgroundQueueMutex);
+        JNIEnv *env;
+        getJNIEnv(&env);
         for (int task : sBackgroundQueue) {
-            JNIEnv *env;
-            getJNIEnv(&env);
-
-            jclass cls = env->FindClass("com/viro/core/internal/PlatformUtil");
-            jmethodID jmethod = env->GetMethodID(cls, "dispatchAsyncBackground", "(I)V");
-            env->CallVoidMethod(sPlatformUtil, jmethod, task);
-
-            env->DeleteLocalRef(cls);
+            env->CallVoidMethod(sPlatformUtil, sDispatchAsyncBackgroundMethod, task);
         }
         sBackgroundQueue.clear();
     }
 
-    {
-        std::lock_guard<std::mutex> guard(sRendererQueueMutex);
-        for (int task : sRendererQueue) {
-            VROPlatformCallHostFunction(sPlatformUtil,
-                                        "dispatchRenderer", "(I)V", task);
-        }
-        sRendererQueue.clear();
-    }
-
     {
         std::lock_guard<std::mutex> guard(sAsyncQueueMutex);
         for (int task : sAsyncQueue) {
@@ -1286,6 +1647,70 @@ std::string VROPlatformGetDeviceBrand() {
     return VRO_STRING_STL(jBrandString);
 }
 
+// The NDK thermal API is only available from API 30, so it is loaded at runtime
+typedef void *(*VRO_PFN_AThermal_acquireManager)();
+typedef int (*VRO_PFN_AThermal_getCurrentThermalStatus)(void *manager);
+
+VROThermalState VROPlatformGetThermalState() {
+    static void *sThermalManager = nullptr;
+    static VRO_PFN_AThermal_getCurrentThermalStatus sGetCurrentThermalStatus = nullptr;
+    static std::once_flag loaded;
+    std::call_once(loaded, [] {
+        void *library = dlopen("libandroid.so", RTLD_NOW);
+        if (library == nullptr) {
+            return;
+        }
+        VRO_PFN_AThermal_acquireManager acquireManager =
+                (VRO_PFN_AThermal_acquireManager) dlsym(library, "AThermal_acquireManager");
+        sGetCurrentThermalStatus = (VRO_PFN_AThermal_getCurrentThermalStatus) dlsym(library, "AThermal_getCurrentThermalStatus");
+        if (acquireManager && sGetCurrentThermalStatus) {
+            sThermalManager = acquireManager();
+        }
+    });
+    if (!sThermalManager) {
+        return VROThermalState::Unknown;
+    }
+
+    // ATHERMAL_STATUS_NONE through ATHERMAL_STATUS_SHUTDOWN; negative on error
+    int status = sGetCurrentThermalStatus(sThermalManager);
+    if (status < 0) {
+        return VROThermalState::Unknown;
+    } else if (status == 0) {
+        return VROThermalState::Nominal;
+    } else if (status <= 2) {
+        return VROThermalState::Fair;
+    } else if (status == 3) {
+        return VROThermalState::Serious;
+    } else {
+        return VROThermalState::Critical;
+    }
+}
+
+bool VROPlatformIsLowPowerModeEnabled() {
+    if (sJavaAppContext == nullptr) {
+        return false;
+    }
+    JNIEnv *env;
+    getJNIEnv(&env);
+
+    jclass contextCls = env->GetObjectClass(sJavaAppContext);
+    jmethodID jgetSystemService = env->GetMethodID(contextCls, "getSystemService", "(Ljava/lang/String;)Ljava/lang/Object;");
+    jstring jservice = env->NewStringUTF("power");
+    jobject powerManager = env->CallObjectMethod(sJavaAppContext, jgetSystemService, jservice);
+    env->DeleteLocalRef(jservice);
+    env->DeleteLocalRef(contextCls);
+    if (powerManager == nullptr) {
+        return false;
+    }
+
+    jclass powerCls = env->GetObjectClass(powerManager);
+    jmethodID jisPowerSaveMode = env->GetMethodID(powerCls, "isPowerSaveMode", "()Z");
+    bool powerSave = env->CallBooleanMethod(powerManager, jisPowerSaveMode);
+    env->DeleteLocalRef(powerCls);
+    env->DeleteLocalRef(powerManager);
+    return powerSave;
+}
+
 std::string VROPlatformGetCacheDirectory() {
     JNIEnv *env;
     getJNIEnv(&env);
@@ -1325,6 +1750,27 @@ void Java_com_viro_core_internal_PlatformUtil_runTask(JNIEnv *env, jclass clazz,
 #include "emscripten/bind.h"
 #include "emscripten/val.h"
 #include "VROImageWasm.h"
+#include <mutex>
+#include <map>
+#if VRO_THREADS
+#include "emscripten/threading.h"
+#endif
+
+#if VRO_THREADS
+#include "VROMPSCQueue.h"
+#include "VROTime.h"
+
+// Tasks for the rendering thread, which any thread pushes onto this inbox for the
+// renderer to drain at the start of each frame, as on Android
+static VROMPSCQueue<std::function<void()>> sRendererInbox;
+
+// Pool of pthread workers for background and worker tasks. Intentionally never
+// destroyed, so that static destruction at exit doesn't wait on in-flight tasks
+static VROTaskPool *VROPlatformGetTaskPool() {
+    static VROTaskPool *sTaskPool = new VROTaskPool();
+    return sTaskPool;
+}
+#endif
 
 std::string VROPlatformRandomString(size_t length) {
     auto randchar = []() -> char {
@@ -1345,31 +1791,150 @@ std::string VROPlatformLoadResourceAsString(std::string resource, std::string ty
     return VROPlatformLoadFileAsString(path);
 }
 
-class VROPlatformWGetContext {
-public:
+/*
+ Downloads use fetch() and stream the response body into the virtual filesystem
+ chunk by chunk, so a large asset is never held in memory twice. Responses are
+ stored in the Cache API (keyed by URL, with the ETag kept on the cached
+ response), so repeat visits are served from the cache without waiting on the
+ network; the cached entry is then revalidated in the background with
+ If-None-Match and replaced if the asset changed. Where the Cache API isn't
+ available (insecure origins) downloads go straight to the network. At most
+ kMaxConcurrentFetches downloads run at once; the rest wait in a FIFO queue.
+ */
+static const int kMaxConcurrentFetches = 6;
+static const char *kFetchCacheName = "viro-assets-v1";
+
+struct VROPlatformFetchContext {
+    std::string path;
     std::function<void(std::string, bool)> onSuccess;
     std::function<void()> onFailure;
 };
 
-void VROPlatformWGetDownloadCallback(unsigned int x, void *arg, const char *file) {
-    pinfo("Downloaded file [%s]", file);
-    
-    VROPlatformWGetContext *context = (VROPlatformWGetContext *) arg;
-    context->onSuccess(std::string(file), true);
-    delete (context);
-}
+static std::mutex sFetchMutex;
+static int sFetchNextId = 0;
+static std::map<int, VROPlatformFetchContext> sFetches;
 
-void VROPlatformWGetErrorCallback(unsigned int x, void *arg, int error) {
-    pinfo("Error executing wget [%d]", error);
+EM_JS(void, VROPlatformFetchStart, (const char *urlPtr, const char *pathPtr, int fetchId,
+                                    int maxConcurrent, const char *cacheNamePtr), {
+    var url = UTF8ToString(urlPtr);
+    var path = UTF8ToString(pathPtr);
+    var cacheName = UTF8ToString(cacheNamePtr);
 
-    VROPlatformWGetContext *context = (VROPlatformWGetContext *) arg;
-    context->onFailure();
-    delete (context);
+    var state = Module['viroFetchState'];
+    if (!state) {
+        state = Module['viroFetchState'] = { active: 0, queue: [] };
+    }
+
+    var streamToFile = function(response) {
+        var stream = FS.open(path, 'w');
+        var reader = response.body.getReader();
+        var pump = function() {
+            return reader.read().then(function(chunk) {
+                if (chunk.done) {
+                    FS.close(stream);
+                    return;
+                }
+                FS.write(stream, chunk.value, 0, chunk.value.length);
+                return pump();
+            });
+        };
+        return pump().catch(function(error) {
+            FS.close(stream);
+            throw error;
+        });
+    };
+
+    var store = function(cache, response) {
+        var cacheControl = response.headers.get('Cache-Control') || '';
+        if (cache && cacheControl.indexOf('no-store') < 0) {
+            cache.put(url, response.clone()).catch(function() {});
+        }
+        return response;
+    };
+
+    var revalidate = function(cache, cached) {
+        var etag = cached.headers.get('ETag');
+        if (!etag) {
+            return;
+        }
+        fetch(url, { headers: { 'If-None-Match': etag } }).then(function(response) {
+            if (response.status == 200) {
+                store(cache, response);
+            }
+        }).catch(function() {});
+    };
+
+    var run = function() {
+        state.active++;
+        var openCache = (typeof caches !== 'undefined') ? caches.open(cacheName).catch(function() { return null; })
+                                                        : Promise.resolve(null);
+        openCache.then(function(cache) {
+            var lookup = cache ? cache.match(url).catch(function() { return null; }) : Promise.resolve(null);
+            return lookup.then(function(cached) {
+                if (cached) {
+                    return streamToFile(cached).then(function() {
+                        revalidate(cache, cached);
+                        return true;
+                    });
+                }
+                return fetch(url).then(function(response) {
+                    if (!response.ok) {
+                        return false;
+                    }
+                    return streamToFile(store(cache, response)).then(function() { return true; });
+                });
+            });
+        }).catch(function() {
+            return false;
+        }).then(function(success) {
+            state.active--;
+            Module['_VROPlatformFetchComplete'](fetchId, success ? 1 : 0);
+            if (state.queue.length > 0) {
+                state.queue.shift()();
+            }
+        });
+    };
+
+    if (state.active < maxConcurrent) {
+        run();
+    } else {
+        state.queue.push(run);
+    }
+});
+
+extern "C" EMSCRIPTEN_KEEPALIVE void VROPlatformFetchComplete(int fetchId, int success) {
+    VROPlatformFetchContext context;
+    {
+        std::lock_guard<std::mutex> lock(sFetchMutex);
+        auto it = sFetches.find(fetchId);
+        if (it == sFetches.end()) {
+            return;
+        }
+        context = std::move(it->second);
+        sFetches.erase(it);
+    }
+
+    if (success) {
+        pinfo("Downloaded file [%s]", context.path.c_str());
+        std::string path = context.path;
+        std::function<void(std::string, bool)> onSuccess = context.onSuccess;
+        VROPlatformDispatchAsyncRenderer([onSuccess, path] {
+            onSuccess(path, true);
+        });
+    } else {
+        pinfo("Failed to download file [%s]", context.path.c_str());
+        VROPlatformDispatchAsyncRenderer(context.onFailure);
+    }
 }
 
-void VROPlatformWGetStatusCallback(unsigned int x, void *arg, int percentage) {
-    pinfo("    Downloaded %d%%", percentage);
+#if VRO_THREADS
+// fetch() and the virtual filesystem live on the main browser thread
+static void VROPlatformFetchStartOnMainThread(char *url, char *path, int fetchId) {
+    VROPlatformFetchStart(url, path, fetchId, kMaxConcurrentFetches, kFetchCacheName);
+    free(url);
+    free(path);
 }
+#endif
 
 std::string VROPlatformDownloadURLToFile(std::string url, bool *temp, bool *success) {
     // Synchronous download not supported on WASM
@@ -1379,15 +1944,23 @@ std::string VROPlatformDownloadURLToFile(std::string url, bool *temp, bool *succ
 void VROPlatformDownloadURLToFileAsync(std::string url,
                                        std::function<void(std::string, bool)> onSuccess,
                                        std::function<void()> onFailure) {
-    VROPlatformWGetContext *context = new VROPlatformWGetContext();
-    context->onSuccess = onSuccess;
-    context->onFailure = onFailure;
-    
     std::string prefix = "/" + VROPlatformLastPathComponent(url, "download");
     std::string tempFile = prefix + "_" + VROPlatformRandomString(8);
-    emscripten_async_wget2(url.c_str(), tempFile.c_str(), "GET", "", context,
-                           &VROPlatformWGetDownloadCallback, &VROPlatformWGetErrorCallback, &VROPlatformWGetStatusCallback);
+
+    int fetchId;
+    {
+        std::lock_guard<std::mutex> lock(sFetchMutex);
+        fetchId = ++sFetchNextId;
+        sFetches[fetchId] = { tempFile, onSuccess, onFailure };
+    }
+
     pinfo("Downloading URL [%s]", url.c_str());
+#if VRO_THREADS
+    emscripten_async_run_in_main_runtime_thread(EM_FUNC_SIG_VIII, (void *) &VROPlatformFetchStartOnMainThread,
+                                                strdup(url.c_str()), strdup(tempFile.c_str()), fetchId);
+#else
+    VROPlatformFetchStart(url.c_str(), tempFile.c_str(), fetchId, kMaxConcurrentFetches, kFetchCacheName);
+#endif
 }
 
 std::string VROPlatformCopyResourceToFile(std::string asset, bool *isTemp) {
@@ -1397,7 +1970,9 @@ std::string VROPlatformCopyResourceToFile(std::string asset, bool *isTemp) {
 }
 
 void VROPlatformDeleteFile(std::string filename) {
-    // Not supported on WASM
+    // Downloads are written to the in-memory filesystem, so temp files must be
+    // removed once processed to release their memory
+    unlink(filename.c_str());
 }
 
 std::shared_ptr<VROImage> VROPlatformLoadImageFromFile(std::string filename,
@@ -1405,18 +1980,70 @@ std::shared_ptr<VROImage> VROPlatformLoadImageFromFile(std::string filename,
     return std::make_shared<VROImageWasm>(filename, format);
 }
 
+std::shared_ptr<VROImage> VROPlatformLoadImageWithBufferedData(const std::vector<unsigned char> &rawData,
+                                                               VROTextureInternalFormat format) {
+    return VROImageDecoder::decode(rawData.data(), rawData.size(), format);
+}
+
 void VROPlatformDispatchAsyncRenderer(std::function<void()> fcn) {
-    // Multithreading not supported on WASM
+#if VRO_THREADS
+    sRendererInbox.push(std::move(fcn));
+    VRORenderInvalidation::invalidate();
+#else
+    // Without pthreads everything runs on the rendering thread
     fcn();
+#endif
+}
+
+#if VRO_THREADS
+int VROPlatformProcessRendererTasks(double budgetMillis) {
+    uint64_t deadline = VRONanoTime() + (uint64_t) (budgetMillis * 1000000);
+    int processed = 0;
+
+    // Always run at least one task per frame so a budget overrun can't starve the inbox
+    std::function<void()> fcn;
+    while (sRendererInbox.pop(&fcn)) {
+        fcn();
+        processed++;
+
+        if (VRONanoTime() >= deadline) {
+            break;
+        }
+    }
+    return processed;
+}
+#endif
+
+VROThermalState VROPlatformGetThermalState() {
+    return VROThermalState::Unknown;
+}
+
+bool VROPlatformIsLowPowerModeEnabled() {
+    return false;
 }
 
 void VROPlatformDispatchAsyncBackground(std::function<void()> fcn) {
-    // Multithreading not supported on WASM
+#if VRO_THREADS
+    VROPlatformGetTaskPool()->dispatch(fcn);
+#else
+    // Multithreading not supported on WASM without pthreads
     fcn();
+#endif
+}
+
+std::shared_ptr<VROTaskToken> VROPlatformDispatchAsyncWorker(std::function<void()> fcn, VROTaskPriority priority) {
+#if VRO_THREADS
+    return VROPlatformGetTaskPool()->dispatch(fcn, priority);
+#else
+    // Multithreading not supported on WASM without pthreads
+    fcn();
+    return std::make_shared<VROTaskToken>();
+#endif
 }
 
 void VROPlatformDispatchAsyncApplication(std::function<void()> fcn) {
-    // Multithreading not supported on WASM
+    // The application runs on the rendering thread, even with pthreads: the
+    // browser's main thread only proxies the canvas and input events
     fcn();
 }
 
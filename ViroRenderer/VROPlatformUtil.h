@@ -30,6 +30,8 @@
 #include "VRODefines.h"
 #include "VROTexture.h"
 #include "VROLog.h"
+#include "VROTaskPool.h"
+#include <stdio.h>
 #include <string>
 #include <memory>
 #include <functional>
@@ -101,6 +103,19 @@ std::string VROPlatformDownloadURLToFile(std::string url, bool *temp, bool *succ
 void VROPlatformDownloadURLToFileAsync(std::string url,
                                        std::function<void(std::string, bool)> onSuccess,
                                        std::function<void()> onFailure);
+
+#if VRO_PLATFORM_IOS || VRO_PLATFORM_MACOS || VRO_PLATFORM_ANDROID
+/*
+ Request the given URL in a blocking fashion with the given request headers, and
+ return the HTTP status code, or 0 if the request failed. Response headers are
+ returned with lower-case names, even if the body fails to download. The body of
+ a 2xx response is written to the given file, except that a 206 (partial content)
+ body is appended to it. Used by VROAssetCache, which performs its own caching.
+ */
+int VROPlatformDownloadURLWithHeaders(std::string url, std::string path,
+                                      const std::map<std::string, std::string> &requestHeaders,
+                                      std::map<std::string, std::string> *outResponseHeaders);
+#endif
 void VROPlatformDeleteFile(std::string filename);
 
 /*
@@ -109,6 +124,14 @@ void VROPlatformDeleteFile(std::string filename);
  */
 void *VROPlatformLoadFile(std::string filename, int *outLength);
 
+/*
+ Memory-map the file for reading, so that its contents are paged in as they are
+ read instead of loaded up front. Returns nullptr if the file could not be mapped.
+ The mapping must be released with VROPlatformUnmapFile.
+ */
+const void *VROPlatformMapFile(std::string filename, size_t *outLength);
+void VROPlatformUnmapFile(const void *data, size_t length);
+
 /*
  Find the path and index (within the font collection) for the font that most nearly
  matches the given typeface, style, and weight. If the index is -1, then no suitable
@@ -128,13 +151,56 @@ std::string VROPlatformGetDeviceModel();
  */
 std::string VROPlatformGetDeviceBrand();
 
+/*
+ Thermal state of the device, coarsened from the platform's own scale (ProcessInfo
+ thermalState on iOS, PowerManager thermal status on Android). Unknown where the
+ platform does not report it.
+ */
+enum class VROThermalState {
+    Unknown,
+    Nominal,
+    Fair,
+    Serious,
+    Critical
+};
+VROThermalState VROPlatformGetThermalState();
+
+/*
+ Returns true if the user has enabled the platform's battery saver (Low Power Mode
+ on iOS, Battery Saver on Android).
+ */
+bool VROPlatformIsLowPowerModeEnabled();
+
 std::string VROPlatformGetCacheDirectory();
 
+/*
+ Hash the given bytes into a key for the files cached under the cache directory,
+ continuing from the given seed so that everything a cached file depends on can
+ be combined into one key. The hash is FNV-1a over 64-bit words, which keeps
+ hashing large assets cheap relative to processing them.
+ */
+static const uint64_t kVROCacheKeySeed = 14695981039346656037ULL;
+uint64_t VROPlatformHashCacheKey(const void *data, size_t length, uint64_t seed = kVROCacheKeySeed);
+
+/*
+ Write a file under the cache directory, creating its parent directories if
+ needed. The given function writes the contents, returning false on failure. The
+ file is written to a temporary path unique to this write and moved into place,
+ so that readers never see a partially written file (even when several threads
+ write the same file at once), and nothing is left behind on failure. Returns
+ true if the file was written.
+ */
+bool VROPlatformWriteCacheFile(std::string path, std::function<bool(FILE *file)> write);
+bool VROPlatformWriteCacheFile(std::string path, const void *data, size_t length);
+
 #pragma mark - Image Loading
 
 // Returns empty shared_ptr on failure
 std::shared_ptr<VROImage> VROPlatformLoadImageFromFile(std::string filename, VROTextureInternalFormat format);
-std::shared_ptr<VROImage> VROPlatformLoadImageWithBufferedData(std::vector<unsigned char> rawData,
+
+// Decodes natively (see VROImageDecoder) where possible, falling back to the
+// platform's decoder. Safe to invoke from background threads.
+std::shared_ptr<VROImage> VROPlatformLoadImageWithBufferedData(const std::vector<unsigned char> &rawData,
                                                                VROTextureInternalFormat format);
 
 #if VRO_PLATFORM_ANDROID
@@ -169,6 +235,26 @@ void VROPlatformDispatchAsyncRenderer(std::function<void()> fcn);
  */
 void VROPlatformDispatchAsyncBackground(std::function<void()> fcn);
 
+/*
+ Run the given function on a native worker thread at the given priority. Use
+ this for tasks that never call into Java: on Android the task runs on a native
+ pool instead of bouncing through the Java background executor, but threads
+ attached from native code cannot resolve application classes, so anything
+ that touches the JVM must use VROPlatformDispatchAsyncBackground instead.
+ The returned token cancels the task if it has not yet started.
+ */
+std::shared_ptr<VROTaskToken> VROPlatformDispatchAsyncWorker(std::function<void()> fcn,
+                                                             VROTaskPriority priority = VROTaskPriority::Normal);
+
+#if VRO_PLATFORM_ANDROID || (VRO_PLATFORM_WASM && VRO_THREADS)
+/*
+ Run the tasks queued by VROPlatformDispatchAsyncRenderer, stopping once the
+ given time budget is spent; the remainder run next frame. Must be called on
+ the rendering thread. Returns the number of tasks run.
+ */
+int VROPlatformProcessRendererTasks(double budgetMillis);
+#endif
+
 /*
  Run the given function on the application UI thread, asynchronously.
  */
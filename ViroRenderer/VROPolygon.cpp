@@ -32,6 +32,8 @@
 #include "VROLog.h"
 #include "stdlib.h"
 #include "VROByteBuffer.h"
+#include "VROMath.h"
+#include "VROPlatformUtil.h"
 #include "poly2tri/poly2tri.h"
 
 std::shared_ptr<VROPolygon> VROPolygon::createPolygon(std::vector<VROVector3f> path,
@@ -51,14 +53,45 @@ std::shared_ptr<VROPolygon> VROPolygon::createPolygon(std::vector<VROVector3f> p
 
 VROPolygon::VROPolygon(std::vector<VROVector3f> path, std::vector<std::vector<VROVector3f>> holes,
                        float u0, float v0, float u1, float v1) :
-    _holes(holes),
     _u0(u0),
     _v0(v0),
     _u1(u1),
-    _v1(v1) {
+    _v1(v1),
+    _boundaryVersion(0),
+    _triangulationPending(false) {
 
     removeDuplicateVertices(path);
-    _path = path;
+    _boundaryHash = hashBoundary(path, holes);
+    setPathAndBounds(path, holes);
+    updateSurface();
+}
+
+VROPolygon::~VROPolygon() {
+}
+
+void VROPolygon::setPath(std::vector<VROVector3f> path, std::vector<std::vector<VROVector3f>> holes) {
+    removeDuplicateVertices(path);
+    if (path.size() < 2) {
+        pwarn("Ignoring polygon path with fewer than 2 vertices");
+        return;
+    }
+
+    // Boundaries that are updated continuously (e.g. AR planes) are often unchanged
+    uint64_t hash = hashBoundary(path, holes);
+    if (hash == _boundaryHash) {
+        return;
+    }
+    _boundaryHash = hash;
+    ++_boundaryVersion;
+
+    setPathAndBounds(path, holes);
+    setDynamic(true);
+    triangulateAsync();
+}
+
+void VROPolygon::setPathAndBounds(std::vector<VROVector3f> &path, std::vector<std::vector<VROVector3f>> &holes) {
+    _path = std::move(path);
+    _holes = std::move(holes);
 
     // Determine the min and max vertex coordinates for this polygon.
     _minX = FLT_MAX;
@@ -71,25 +104,91 @@ VROPolygon::VROPolygon(std::vector<VROVector3f> path, std::vector<std::vector<VR
         _minY = std::min(_minY, vec.y);
         _maxY = std::max(_maxY, vec.y);
     }
-
-    updateSurface();
 }
 
-VROPolygon::~VROPolygon() {
+uint64_t VROPolygon::hashBoundary(const std::vector<VROVector3f> &path,
+                                  const std::vector<std::vector<VROVector3f>> &holes) {
+    // FNV-1a over the sizes and the x and y coordinates (polygons are flat)
+    uint64_t hash = 14695981039346656037ULL;
+    auto mix = [&hash](uint32_t value) {
+        hash = (hash ^ value) * 1099511628211ULL;
+    };
+    auto mixPath = [&mix](const std::vector<VROVector3f> &p) {
+        mix((uint32_t) p.size());
+        for (const VROVector3f &v : p) {
+            uint32_t x, y;
+            memcpy(&x, &v.x, sizeof(float));
+            memcpy(&y, &v.y, sizeof(float));
+            mix(x);
+            mix(y);
+        }
+    };
+    mixPath(path);
+    mix((uint32_t) holes.size());
+    for (const std::vector<VROVector3f> &hole : holes) {
+        mixPath(hole);
+    }
+    return hash;
 }
 
 void VROPolygon::updateSurface() {
-    std::vector<std::shared_ptr<VROGeometrySource>> sources;
-    std::vector<std::shared_ptr<VROGeometryElement>> elements;
-
-    // Build the polygon here to get sources and elements
     // Note that poly2Tri requires at least 2 vertices to build a geometry.
     passert(_path.size() > 1);
-    buildGeometry(sources, elements);
+    VROPolygonTriangulation triangulation = triangulate(_path, _holes, _minX, _maxX, _minY, _maxY,
+                                                        _u0, _v0, _u1, _v1, nullptr);
+    setTriangulation(triangulation);
+}
 
-    // Then set the geometric elements and sources that we've just built.
+void VROPolygon::triangulateAsync() {
+    // Only one triangulation runs at a time; when it completes, the latest
+    // boundary is triangulated if it has changed since
+    if (_triangulationPending) {
+        return;
+    }
+    _triangulationPending = true;
+
+    std::weak_ptr<VROPolygon> polygon_w = std::dynamic_pointer_cast<VROPolygon>(shared_from_this());
+    std::vector<VROVector3f> path = _path;
+    std::vector<std::vector<VROVector3f>> holes = _holes;
+    std::shared_ptr<const std::vector<int>> previousIndices = _indices;
+    float minX = _minX, maxX = _maxX, minY = _minY, maxY = _maxY;
+    float u0 = _u0, v0 = _v0, u1 = _u1, v1 = _v1;
+    int version = _boundaryVersion;
+
+    VROPlatformDispatchAsyncWorker([polygon_w, path, holes, previousIndices, minX, maxX, minY, maxY,
+                                    u0, v0, u1, v1, version] {
+        VROPolygonTriangulation triangulation = triangulate(path, holes, minX, maxX, minY, maxY,
+                                                            u0, v0, u1, v1, previousIndices.get());
+        VROPlatformDispatchAsyncRenderer([polygon_w, triangulation, version] {
+            std::shared_ptr<VROPolygon> polygon = polygon_w.lock();
+            if (!polygon) {
+                return;
+            }
+            polygon->_triangulationPending = false;
+            
+            // Even a stale triangulation is newer than the one displayed
+            polygon->setTriangulation(triangulation);
+            if (version != polygon->_boundaryVersion) {
+                polygon->triangulateAsync();
+            }
+        });
+    });
+}
+
+void VROPolygon::setTriangulation(const VROPolygonTriangulation &triangulation) {
+    std::vector<std::shared_ptr<VROGeometrySource>> sources = VROShapeUtilBuildGeometrySources(triangulation.vertexData,
+                                                                                               triangulation.numVertices);
+    const std::vector<int> &indices = *triangulation.indices;
+    std::shared_ptr<VROData> indexData = std::make_shared<VROData>((void *) indices.data(), (int) (sizeof(int) * indices.size()));
+    std::shared_ptr<VROGeometryElement> element = std::make_shared<VROGeometryElement>(indexData,
+                                                                                       VROGeometryPrimitiveType::Triangle,
+                                                                                       VROGeometryUtilGetPrimitiveCount((int) indices.size(),
+                                                                                                                        VROGeometryPrimitiveType::Triangle),
+                                                                                       sizeof(int));
+    _indices = triangulation.indices;
+    
     setSources(sources);
-    setElements(elements);
+    setElements({ element });
     updateBoundingBox();
 }
 
@@ -113,101 +212,108 @@ void VROPolygon::removeDuplicateVertices(std::vector<VROVector3f> &path) {
     }
 }
 
-void VROPolygon::buildGeometry(std::vector<std::shared_ptr<VROGeometrySource>> &sources,
-                               std::vector<std::shared_ptr<VROGeometryElement>> &elements) {
+VROPolygonTriangulation VROPolygon::triangulate(const std::vector<VROVector3f> &path,
+                                                const std::vector<std::vector<VROVector3f>> &holes,
+                                                float minX, float maxX, float minY, float maxY,
+                                                float u0, float v0, float u1, float v1,
+                                                const std::vector<int> *previousIndices) {
+    /*
+     The vertices are the points of the path followed by those of each hole, and
+     each triangle indexes three of them.
+     */
+    std::vector<VROVector3f> vertices = path;
+    for (const std::vector<VROVector3f> &hole : holes) {
+        vertices.insert(vertices.end(), hole.begin(), hole.end());
+    }
 
-    const std::size_t pathSize = _path.size();
+    VROPolygonTriangulation triangulation;
+    triangulation.numVertices = (int) vertices.size();
     
+    VROByteBuffer buffer(vertices.size() * sizeof(VROShapeVertexLayout));
+    for (const VROVector3f &v : vertices) {
+        writePolygonCorner(v.x, v.y, minX, maxX, minY, maxY, u0, v0, u1, v1, buffer);
+    }
+    triangulation.vertexData = std::make_shared<VROData>((void *) buffer.getData(), (int) buffer.getPosition());
+
     /*
-     Convert to poly2tri data structures.
+     Edits that only move vertices keep the previous triangles if none of them
+     flip or collapse, in which case they still tile the new boundary.
      */
-    std::vector<p2t::Point *> p2tPath;
-    p2tPath.reserve(pathSize);
+    if (previousIndices && canReuseTriangles(vertices, *previousIndices)) {
+        triangulation.indices = std::make_shared<std::vector<int>>(*previousIndices);
+        return triangulation;
+    }
+    
+    /*
+     Convert to poly2tri data structures. The points are stored contiguously so
+     that the index of each triangle corner can be recovered.
+     */
+    std::vector<p2t::Point> points;
+    points.reserve(vertices.size());
+    for (const VROVector3f &v : vertices) {
+        points.emplace_back(v.x, v.y);
+    }
 
-    for (VROVector3f &v : _path) {
-        p2t::Point *p = new p2t::Point(v.x, v.y);
-        p2tPath.push_back(p);
+    std::vector<p2t::Point *> p2tPath;
+    p2tPath.reserve(path.size());
+    for (size_t i = 0; i < path.size(); i++) {
+        p2tPath.push_back(&points[i]);
     }
     p2t::CDT cdt(p2tPath);
 
-    std::vector<std::vector<p2t::Point *>> p2tHoles;
-    p2tHoles.reserve(_holes.size());
-    
-    for (std::vector<VROVector3f> &hole : _holes) {
+    size_t start = path.size();
+    for (const std::vector<VROVector3f> &hole : holes) {
         std::vector<p2t::Point *> p2tHole;
         p2tHole.reserve(hole.size());
-        
-        for (VROVector3f &v : hole) {
-            p2t::Point *p = new p2t::Point(v.x, v.y);
-            p2tHole.push_back(p);
+        for (size_t i = 0; i < hole.size(); i++) {
+            p2tHole.push_back(&points[start + i]);
         }
-        
         cdt.AddHole(p2tHole);
-        p2tHoles.push_back(std::move(p2tHole));
+        start += hole.size();
     }
 
     // Triangulate
     cdt.Triangulate();
     std::vector<p2t::Triangle *> triangles = cdt.GetTriangles();
 
-    // Start creating our buffer of vertex indices that references each corner within this polygon.
-    VROByteBuffer buffer;
+    std::shared_ptr<std::vector<int>> indices = std::make_shared<std::vector<int>>();
+    indices->reserve(triangles.size() * 3);
     for (p2t::Triangle *triangle : triangles) {
-        p2t::Point *a = triangle->GetPoint(0);
-        p2t::Point *b = triangle->GetPoint(1);
-        p2t::Point *c = triangle->GetPoint(2);
-        
-        buffer.grow(sizeof(VROShapeVertexLayout) * 3);
-        writePolygonCorner(a, buffer);
-        writePolygonCorner(b, buffer);
-        writePolygonCorner(c, buffer);
-    }
-    std::shared_ptr<VROData> vertexData = std::make_shared<VROData>((void *) buffer.getData(), buffer.getPosition());
-    
-    // Parse our constructed buffered vertex data into actual usable geometry sources
-    // with (normal, tang, vertex, uvs).
-    size_t numCorners = triangles.size() * 3;
-    std::vector<std::shared_ptr<VROGeometrySource>> genSources = VROShapeUtilBuildGeometrySources(vertexData, numCorners);
-    for (std::shared_ptr<VROGeometrySource> source : genSources) {
-        sources.push_back(source);
-    }
-    elements.push_back(buildElement(numCorners));
-    
-    // Cleanup poly2tri structures
-    for (auto p : p2tPath) {
-        delete (p);
-    }
-    p2tPath.clear();
-    
-    for (auto &hole : p2tHoles) {
-        for (auto p : hole) {
-            delete (p);
+        for (int i = 0; i < 3; i++) {
+            indices->push_back((int) (triangle->GetPoint(i) - points.data()));
         }
-        hole.clear();
     }
-    p2tHoles.clear();
+    triangulation.indices = indices;
+    return triangulation;
 }
 
-std::shared_ptr<VROGeometryElement> VROPolygon::buildElement(size_t numCorners) {
-    int indices[numCorners];
-    for (int i = 0; i < numCorners; i++) {
-        indices[i] = i;
+bool VROPolygon::canReuseTriangles(const std::vector<VROVector3f> &vertices, const std::vector<int> &indices) {
+    // Every triangle must keep the winding of the first, with non-zero area
+    float winding = 0;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        if (indices[i] >= vertices.size() || indices[i + 1] >= vertices.size() || indices[i + 2] >= vertices.size()) {
+            return false;
+        }
+        const VROVector3f &a = vertices[indices[i]];
+        const VROVector3f &b = vertices[indices[i + 1]];
+        const VROVector3f &c = vertices[indices[i + 2]];
+        float area = (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y);
+        if (winding == 0) {
+            winding = area > 0 ? 1 : -1;
+        }
+        if (area * winding <= kEpsilon) {
+            return false;
+        }
     }
-
-    std::shared_ptr<VROData> indexData = std::make_shared<VROData>((void *) indices, sizeof(int) * numCorners);
-    std::shared_ptr<VROGeometryElement> element= std::make_shared<VROGeometryElement>(indexData,
-                                                                                      VROGeometryPrimitiveType::Triangle,
-                                                                                      VROGeometryUtilGetPrimitiveCount((int) numCorners,
-                                                                                                                       VROGeometryPrimitiveType::Triangle),
-                                                                                      sizeof(int));
-    return element;
+    return winding != 0;
 }
 
-void VROPolygon::writePolygonCorner(p2t::Point *position, VROByteBuffer &buffer) {
-    float u = _u0 + (position->x - _minX) / (_maxX - _minX) * (_u1 - _u0);
-    float v = _v0 + (position->y - _maxY) / (_minY - _maxY) * (_v1 - _v0);
-    buffer.writeFloat(position->x);
-    buffer.writeFloat(position->y);
+void VROPolygon::writePolygonCorner(float x, float y, float minX, float maxX, float minY, float maxY,
+                                    float u0, float v0, float u1, float v1, VROByteBuffer &buffer) {
+    float u = u0 + (x - minX) / (maxX - minX) * (u1 - u0);
+    float v = v0 + (y - maxY) / (minY - maxY) * (v1 - v0);
+    buffer.writeFloat(x);
+    buffer.writeFloat(y);
     buffer.writeFloat(0);
     buffer.writeFloat(u);
     buffer.writeFloat(v);
@@ -30,10 +30,17 @@
 #include "VROShapeUtils.h"
 #include "VROByteBuffer.h"
 #include <memory>
+#include <vector>
 
-namespace p2t {
-    class Point;
-}
+/*
+ The triangulation of a polygon: its vertices, encoded as VROShapeVertexLayout,
+ and the indices of its triangles.
+ */
+struct VROPolygonTriangulation {
+    std::shared_ptr<VROData> vertexData;
+    int numVertices;
+    std::shared_ptr<const std::vector<int>> indices;
+};
 
 /*
  A geometric representation of a flat Polygon, constructed with N vertices that describes its shape.
@@ -47,6 +54,16 @@ public:
                                                      float u0 = 0, float v0 = 0, float u1 = 1, float v1 = 1);
     virtual ~VROPolygon();
 
+    /*
+     Replace the perimeter and holes of this polygon. Does nothing if they are unchanged
+     (compared by hash), so that shapes that are updated continuously (e.g. detected AR
+     planes) only pay for the updates that move their vertices. Otherwise the polygon is
+     re-triangulated on a worker thread, and the result is written into its existing
+     buffers (it is marked dynamic) on the rendering thread. Until then the previous
+     triangulation is displayed.
+     */
+    void setPath(std::vector<VROVector3f> path, std::vector<std::vector<VROVector3f>> holes);
+
 protected:
     
     VROPolygon(std::vector<VROVector3f> path, std::vector<std::vector<VROVector3f>> holes,
@@ -72,15 +89,45 @@ private:
      */
     float _u0, _v0, _u1, _v1;
 
+    /*
+     Hash of the latest boundary, and its version, incremented each time it changes.
+     */
+    uint64_t _boundaryHash;
+    int _boundaryVersion;
+    
+    /*
+     True while a triangulation is running on a worker thread. The triangles of the
+     current triangulation are kept so that edits which only move vertices can
+     reuse them.
+     */
+    bool _triangulationPending;
+    std::shared_ptr<const std::vector<int>> _indices;
+
     /*
      Rebuilds the sources and elements for this geometric shape with the latest set of
-     boundary vertices.
+     boundary vertices, synchronously.
      */
     void updateSurface();
-    void buildGeometry(std::vector<std::shared_ptr<VROGeometrySource>> &sources,
-                       std::vector<std::shared_ptr<VROGeometryElement>> &elements);
-    std::shared_ptr<VROGeometryElement> buildElement(size_t numCorners);
-    void writePolygonCorner(p2t::Point *position, VROByteBuffer &buffer);
+    
+    /*
+     Triangulate the latest boundary on a worker thread.
+     */
+    void triangulateAsync();
+    void setTriangulation(const VROPolygonTriangulation &triangulation);
+    
+    /*
+     Triangulate the given boundary. Safe to invoke from any thread. If the previous
+     triangles index the same number of vertices, and none of them flip or collapse
+     over the new vertices, they are reused instead of running poly2tri.
+     */
+    static VROPolygonTriangulation triangulate(const std::vector<VROVector3f> &path,
+                                               const std::vector<std::vector<VROVector3f>> &holes,
+                                               float minX, float maxX, float minY, float maxY,
+                                               float u0, float v0, float u1, float v1,
+                                               const std::vector<int> *previousIndices);
+    static bool canReuseTriangles(const std::vector<VROVector3f> &vertices, const std::vector<int> &indices);
+    static void writePolygonCorner(float x, float y, float minX, float maxX, float minY, float maxY,
+                                   float u0, float v0, float u1, float v1, VROByteBuffer &buffer);
 
     /*
      Poly2Tri only processes paths with non repeating points, otherwise it would crash
@@ -88,6 +135,13 @@ private:
      duplicated vertices for a given path.
      */
     void removeDuplicateVertices(std::vector<VROVector3f> &path);
+
+    /*
+     Set the path and holes of this polygon, and compute its bounds.
+     */
+    void setPathAndBounds(std::vector<VROVector3f> &path, std::vector<std::vector<VROVector3f>> &holes);
+    static uint64_t hashBoundary(const std::vector<VROVector3f> &path,
+                                 const std::vector<std::vector<VROVector3f>> &holes);
 };
 
 #endif /* VROPolygon_h */
@@ -40,6 +40,9 @@
 #include "VROAnimationFloat.h"
 
 static const int kNumJointSegments = 16;
+
+// Initial capacity, in bytes, of the vertex and index stores
+static const size_t kMinStoreCapacity = 4096;
 static std::shared_ptr<VROShaderModifier> sPolylineShaderGeometryModifier;
 static std::shared_ptr<VROShaderModifier> sPolylineShaderVertexModifier;
 
@@ -63,7 +66,10 @@ std::shared_ptr<VROPolyline> VROPolyline::createPolyline(std::vector<std::vector
     return polyline;
 }
 
-VROPolyline::VROPolyline() {
+VROPolyline::VROPolyline() :
+    _thicknessMode(VROPolylineThicknessMode::World),
+    _numCorners(0) {
+        
     std::shared_ptr<VROMaterial> material = std::make_shared<VROMaterial>();
     material->getDiffuse().setColor({ 1.0, 1.0, 1.0, 1.0 });
     material->setCullMode(VROCullMode::None);
@@ -73,7 +79,9 @@ VROPolyline::VROPolyline() {
 VROPolyline::VROPolyline(std::vector<std::vector<VROVector3f>> paths, float thickness, VROPolylineJoinStyle joinStyle) :
     _thickness(thickness),
     _paths(paths),
-    _joinStyle(joinStyle) {
+    _joinStyle(joinStyle),
+    _thicknessMode(VROPolylineThicknessMode::World),
+    _numCorners(0) {
         
     update();
 }
@@ -89,9 +97,23 @@ void VROPolyline::setPaths(std::vector<std::vector<VROVector3f>> &paths) {
 }
 
 void VROPolyline::update() {
+    VROByteBuffer buffer;
+    size_t numCorners = 0;
+    for (std::vector<VROVector3f> &path : _paths) {
+        if (!path.empty()) {
+            numCorners += encodeLine(path, _joinStyle, buffer);
+        }
+    }
+    
+    // Rebuilt geometry starts new stores, leaving the data of the old sources intact
+    _vertexStore.reset();
+    _indexStore.reset();
+    _numCorners = 0;
+    writeCorners(buffer, numCorners);
+    
     std::vector<std::shared_ptr<VROGeometrySource>> sources;
     std::vector<std::shared_ptr<VROGeometryElement>> elements;
-    buildGeometry(_paths, _joinStyle, sources, elements);
+    buildGeometry(sources, elements);
     
     setSources(sources);
     setElements(elements);
@@ -99,10 +121,10 @@ void VROPolyline::update() {
 }
 
 void VROPolyline::appendPoint(VROVector3f point) {
-    std::vector<std::shared_ptr<VROGeometrySource>> sources = getGeometrySources();
-    std::vector<std::shared_ptr<VROGeometryElement>> elements = getGeometryElements();
+    // Polylines that are drawn point by point are updated in place
+    setDynamic(true);
     
-    // Encode the new data into a VROByteBuffer
+    // Encode the new corners into a VROByteBuffer
     VROByteBuffer buffer;
     size_t numCorners = 0;
     if (isEmpty()) {
@@ -115,113 +137,121 @@ void VROPolyline::appendPoint(VROVector3f point) {
         numCorners += encodeCircularEndcap(point, segment.ray(), true, true, buffer);
     }
     
-    // If there are no sources, create new ones
-    if (sources.empty()) {
-        std::shared_ptr<VROData> vertexData = std::make_shared<VROData>((void *) buffer.getData(), buffer.getPosition());
-        sources = VROShapeUtilBuildGeometrySources(vertexData, numCorners);
-        elements = { buildElement(numCorners) };
-        
+    if (_paths.empty()) {
+        _paths.emplace_back();
+    }
+    _paths.back().push_back(point);
+    
+    // The new corners only extend the existing data, so the substrate need only
+    // upload them
+    bool append = _numCorners > 0;
+    writeCorners(buffer, numCorners);
+    
+    std::vector<std::shared_ptr<VROGeometrySource>> sources;
+    std::vector<std::shared_ptr<VROGeometryElement>> elements;
+    buildGeometry(sources, elements);
+    if (append) {
+        appendSourcesAndElements(sources, elements);
+        expandBoundingBox(VROBoundingBox(point.x, point.x, point.y, point.y, point.z, point.z));
+    }
+    else {
         setSources(sources);
         setElements(elements);
+        updateBoundingBox();
     }
-    // Otherwise add to the existing sources
-    else {
-        std::vector<std::shared_ptr<VROGeometrySource>> newSources;
-        std::vector<std::shared_ptr<VROGeometryElement>> newElements;
-        
-        std::shared_ptr<VROData> existingVertexData = sources[0]->getData();
-        size_t newDataSize = existingVertexData->getDataLength() + buffer.getPosition();
-        char *newData = (char *) malloc(newDataSize);
-        std::shared_ptr<VROData> newVertexData = std::make_shared<VROData>(newData, newDataSize);
-        
-        VROByteBuffer vertexDataBuffer(newVertexData->getData(), newVertexData->getDataLength(), false);
-        vertexDataBuffer.writeBytes(existingVertexData->getData(), existingVertexData->getDataLength());
-        vertexDataBuffer.writeBytes(buffer.getData(), buffer.getPosition());
-        
-        for (std::shared_ptr<VROGeometrySource> &source : sources) {
-            std::shared_ptr<VROGeometrySource> newSource = std::make_shared<VROGeometrySource>(newVertexData,
-                                                                                               source->getSemantic(),
-                                                                                               source->getVertexCount() + numCorners,
-                                                                                               source->isFloatComponents(),
-                                                                                               source->getComponentsPerVertex(),
-                                                                                               source->getBytesPerComponent(),
-                                                                                               source->getDataOffset(),
-                                                                                               source->getDataStride());
-            newSources.push_back(newSource);
-        }
-        
-        size_t numNewVertices = sources[0]->getVertexCount() + numCorners;
-        newElements = { buildElement(numNewVertices) };
-        
-        setSources(newSources);
-        setElements(newElements);
+}
+
+void VROPolyline::setSegments(const std::vector<VROVector3f> &endpoints) {
+    VROByteBuffer buffer;
+    size_t numCorners = 0;
+    _paths.clear();
+    for (size_t i = 0; i + 1 < endpoints.size(); i += 2) {
+        numCorners += encodeQuad(VROLineSegment(endpoints[i], endpoints[i + 1]), true, true, buffer);
+        _paths.push_back({ endpoints[i], endpoints[i + 1] });
     }
+    
+    _vertexStore.reset();
+    _indexStore.reset();
+    _numCorners = 0;
+    writeCorners(buffer, numCorners);
+    
+    std::vector<std::shared_ptr<VROGeometrySource>> sources;
+    std::vector<std::shared_ptr<VROGeometryElement>> elements;
+    buildGeometry(sources, elements);
+    
+    setSources(sources);
+    setElements(elements);
     updateBoundingBox();
 }
 
 bool VROPolyline::isEmpty() const {
-    const std::vector<std::shared_ptr<VROGeometrySource>> &sources = getGeometrySources();
-    if (sources.empty()) {
-        return true;
-    }
-    
-    std::shared_ptr<VROGeometrySource> position = sources[0];
-    return position->getVertexCount() == 0;
+    return _numCorners == 0;
 }
 
 VROVector3f VROPolyline::getLastPoint() const {
-    const std::vector<std::shared_ptr<VROGeometrySource>> &sources = getGeometrySources();
-    if (sources.empty()) {
-        return {};
-    }
-    
-    std::shared_ptr<VROGeometrySource> vertexSource = sources[0];
-    if (vertexSource->getVertexCount() == 0) {
+    if (_numCorners == 0) {
         return {};
     }
     
-    std::shared_ptr<VROData> data = vertexSource->getData();
-    int lastPosition = (vertexSource->getVertexCount() - 1) * vertexSource->getDataStride();
-    
-    VROByteBuffer buffer((char *)data->getData() + lastPosition, vertexSource->getDataStride());
+    size_t lastPosition = (_numCorners - 1) * sizeof(VROShapeVertexLayout);
+    VROByteBuffer buffer((char *) _vertexStore->getData() + lastPosition, sizeof(VROShapeVertexLayout));
     VROVector3f point(buffer.readFloat(), buffer.readFloat(), buffer.readFloat());
     return point;
 }
 
-void VROPolyline::buildGeometry(std::vector<std::vector<VROVector3f>> &paths,
-                                VROPolylineJoinStyle joinStyle,
-                                std::vector<std::shared_ptr<VROGeometrySource>> &sources,
-                                std::vector<std::shared_ptr<VROGeometryElement>> &elements) {
-
-    VROByteBuffer buffer;
-    size_t numVertices = 0;
-    for (std::vector<VROVector3f> &path : paths) {
-        if (!path.empty()) {
-            numVertices = numVertices + encodeLine(path, joinStyle, buffer);
-        }
+void VROPolyline::writeCorners(VROByteBuffer &buffer, size_t numCorners) {
+    size_t vertexLength = (_numCorners + numCorners) * sizeof(VROShapeVertexLayout);
+    size_t indexLength = (_numCorners + numCorners) * sizeof(int);
+    
+    // Grow the stores by doubling, so that appending is amortized constant time
+    if (!_vertexStore || (size_t) _vertexStore->getDataLength() < vertexLength) {
+        _vertexStore = growStore(_vertexStore, _numCorners * sizeof(VROShapeVertexLayout), vertexLength);
     }
-    std::shared_ptr<VROData> vertexData = std::make_shared<VROData>((void *) buffer.getData(), buffer.getPosition());
-
-    std::vector<std::shared_ptr<VROGeometrySource>> genSources = VROShapeUtilBuildGeometrySources(vertexData, numVertices);
-    for (std::shared_ptr<VROGeometrySource> source : genSources) {
-        sources.push_back(source);
+    if (!_indexStore || (size_t) _indexStore->getDataLength() < indexLength) {
+        _indexStore = growStore(_indexStore, _numCorners * sizeof(int), indexLength);
     }
+    
+    memcpy((char *) _vertexStore->getData() + _numCorners * sizeof(VROShapeVertexLayout),
+           buffer.getData(), numCorners * sizeof(VROShapeVertexLayout));
+    int *indices = (int *) _indexStore->getData();
+    for (size_t i = _numCorners; i < _numCorners + numCorners; i++) {
+        indices[i] = (int) i;
+    }
+    _numCorners += numCorners;
+}
 
-    elements.push_back(buildElement(numVertices));
+std::shared_ptr<VROData> VROPolyline::growStore(std::shared_ptr<VROData> store, size_t usedLength, size_t minLength) {
+    size_t capacity = store ? store->getDataLength() : kMinStoreCapacity;
+    while (capacity < minLength) {
+        capacity *= 2;
+    }
+    
+    void *data = malloc(capacity);
+    if (store && usedLength > 0) {
+        memcpy(data, store->getData(), usedLength);
+    }
+    return std::make_shared<VROData>(data, (int) capacity, VRODataOwnership::Move);
 }
 
-std::shared_ptr<VROGeometryElement> VROPolyline::buildElement(size_t numCorners) {
-    int indices[numCorners];
-    for (int i = 0; i < numCorners; i++) {
-        indices[i] = i;
+void VROPolyline::buildGeometry(std::vector<std::shared_ptr<VROGeometrySource>> &sources,
+                                std::vector<std::shared_ptr<VROGeometryElement>> &elements) const {
+    if (_numCorners == 0) {
+        return;
     }
     
-    std::shared_ptr<VROData> indexData = std::make_shared<VROData>((void *) indices, sizeof(int) * numCorners);
-    std::shared_ptr<VROGeometryElement> element = std::make_shared<VROGeometryElement>(indexData,
-                                                                                       VROGeometryPrimitiveType::TriangleStrip,
-                                                                                       VROGeometryUtilGetPrimitiveCount((int) numCorners, VROGeometryPrimitiveType::TriangleStrip),
-                                                                                       sizeof(int));
-    return element;
+    // The sources and element view the used prefix of each store, retaining the store
+    std::shared_ptr<VROData> vertexData = std::make_shared<VROData>((const void *) _vertexStore->getData(),
+                                                                    (int) (_numCorners * sizeof(VROShapeVertexLayout)),
+                                                                    std::shared_ptr<const void>(_vertexStore));
+    std::shared_ptr<VROData> indexData = std::make_shared<VROData>((const void *) _indexStore->getData(),
+                                                                   (int) (_numCorners * sizeof(int)),
+                                                                   std::shared_ptr<const void>(_indexStore));
+    
+    sources = VROShapeUtilBuildGeometrySources(vertexData, _numCorners);
+    elements.push_back(std::make_shared<VROGeometryElement>(indexData,
+                                                            VROGeometryPrimitiveType::TriangleStrip,
+                                                            VROGeometryUtilGetPrimitiveCount((int) _numCorners, VROGeometryPrimitiveType::TriangleStrip),
+                                                            sizeof(int)));
 }
 
 size_t VROPolyline::encodeLine(const std::vector<VROVector3f> &path,
@@ -372,6 +402,10 @@ void VROPolyline::setThickness(float thickness) {
     }, _thickness, thickness));
 }
 
+void VROPolyline::setThicknessMode(VROPolylineThicknessMode mode) {
+    _thicknessMode = mode;
+}
+
 void VROPolyline::setMaterials(std::vector<std::shared_ptr<VROMaterial>> materials) {
     createPolylineShaderModifiers();
 
@@ -410,6 +444,7 @@ void VROPolyline::createPolylineShaderModifiers() {
     if (!sPolylineShaderGeometryModifier) {
         std::vector<std::string> geometryCode = {
             "uniform float thickness;",
+            "uniform float screen_thickness;",
             "vec4 world_position = _transforms.model_matrix * vec4(_geometry.position, 1.0);",
             "vec3 camera_ray = normalize(world_position.xyz - camera_position);",
             "vec4 line_dir = normal_matrix * vec4(_geometry.normal, 0.0);",
@@ -417,9 +452,17 @@ void VROPolyline::createPolylineShaderModifiers() {
             
             "highp vec3 world_vertex_offset = vec3(0.0);",
             
+            // Screen space thickness is a fraction of the viewport height, so scale it by the
+            // height of the view frustum at this vertex's depth
+            "highp float line_thickness = thickness;",
+            "if (screen_thickness > 0.0) {",
+            "   highp float view_depth = -(_transforms.view_matrix * world_position).z;",
+            "   line_thickness = thickness * view_depth * 2.0 / _transforms.projection_matrix[1][1];",
+            "}",
+            
             // Ensure we are not dealing with a 0 length vector (creates NaN when normalizing)
             "if (length(stroke_offset_dir) > 0.0) {",
-            "   highp vec3 stroke_offset = normalize(stroke_offset_dir) * (thickness / 2.0);"
+            "   highp vec3 stroke_offset = normalize(stroke_offset_dir) * (line_thickness / 2.0);"
             "   highp float angle = _geometry.tangent.x;"
             "   if (angle > 0.0) {",
             "      highp vec3 axis = camera_ray;",
@@ -445,6 +488,12 @@ void VROPolyline::createPolylineShaderModifiers() {
             const VROPolyline *polyline = dynamic_cast<const VROPolyline *>(geometry);
             uniform->setFloat(polyline->getThickness());
         });
+        sPolylineShaderGeometryModifier->setUniformBinder("screen_thickness", VROShaderProperty::Float,
+                                                          [](VROUniform *uniform,
+                                                             const VROGeometry *geometry, const VROMaterial *material) {
+            const VROPolyline *polyline = dynamic_cast<const VROPolyline *>(geometry);
+            uniform->setFloat(polyline->getThicknessMode() == VROPolylineThicknessMode::Screen ? 1.0 : 0.0);
+        });
         sPolylineShaderGeometryModifier->setName("line_g");
         
         /*
@@ -33,6 +33,7 @@ class VROVector3f;
 class VROByteBuffer;
 class VROLineSegment;
 class VROShaderModifier;
+class VROData;
 
 /*
  The style used to join segments. Round uses more triangles but generally looks better
@@ -44,6 +45,16 @@ enum class VROPolylineJoinStyle {
     Bevel,
 };
 
+/*
+ The units of the thickness of a polyline. World thickness is in world units, so
+ the line narrows with distance. Screen thickness is a fraction of the viewport
+ height, so the line is equally wide on screen at any distance.
+ */
+enum class VROPolylineThicknessMode {
+    World,
+    Screen,
+};
+
 class VROPolyline : public VROGeometry {
     
 public:
@@ -63,6 +74,14 @@ public:
         return _thickness;
     }
     
+    /*
+     Set whether the thickness is measured in world or screen space.
+     */
+    void setThicknessMode(VROPolylineThicknessMode mode);
+    VROPolylineThicknessMode getThicknessMode() const {
+        return _thicknessMode;
+    }
+    
     /*
      Set the join style, which determines how segments in the polyline are connected
      together.
@@ -80,9 +99,18 @@ public:
     
     /*
      Append the given point the last path in this polyline. This is more efficient
-     than invoking setPaths.
+     than invoking setPaths: only the new point's corners are encoded and uploaded,
+     so the cost of each append does not grow with the length of the line.
      */
     void appendPoint(VROVector3f point);
+    
+    /*
+     Replace the paths of this polyline with the given independent segments, where
+     each consecutive pair of points is one segment. Segments are drawn without
+     joins or endcaps, so this is the cheapest way to draw many short lines (e.g.
+     debug lines) with a single draw call.
+     */
+    void setSegments(const std::vector<VROVector3f> &endpoints);
 
     virtual void setMaterials(std::vector<std::shared_ptr<VROMaterial>> materials);
 
@@ -91,6 +119,17 @@ private:
     float _thickness;
     std::vector<std::vector<VROVector3f>> _paths;
     VROPolylineJoinStyle _joinStyle;
+    VROPolylineThicknessMode _thicknessMode;
+    
+    /*
+     The encoded corners of all paths, and their triangle strip indices, in stores
+     that grow by doubling. Appended corners are written past the used prefix, and
+     the geometry's sources and element view only that prefix, so the data of
+     previous sources is never modified.
+     */
+    std::shared_ptr<VROData> _vertexStore;
+    std::shared_ptr<VROData> _indexStore;
+    size_t _numCorners;
     
     VROPolyline(std::vector<std::vector<VROVector3f>> paths, float thickness, VROPolylineJoinStyle joinStyle);
     
@@ -109,11 +148,17 @@ private:
      */
     VROVector3f getLastPoint() const;
     
-    static void buildGeometry(std::vector<std::vector<VROVector3f>> &paths,
-                              VROPolylineJoinStyle joinStyle,
-                              std::vector<std::shared_ptr<VROGeometrySource>> &sources,
-                              std::vector<std::shared_ptr<VROGeometryElement>> &elements);
-    static std::shared_ptr<VROGeometryElement> buildElement(size_t numCorners);
+    /*
+     Append the given encoded corners to the stores.
+     */
+    void writeCorners(VROByteBuffer &buffer, size_t numCorners);
+    static std::shared_ptr<VROData> growStore(std::shared_ptr<VROData> store, size_t usedLength, size_t minLength);
+    
+    /*
+     Build sources and an element over the corners in the stores.
+     */
+    void buildGeometry(std::vector<std::shared_ptr<VROGeometrySource>> &sources,
+                       std::vector<std::shared_ptr<VROGeometryElement>> &elements) const;
     static size_t encodeLine(const std::vector<VROVector3f> &path, VROPolylineJoinStyle joinStyle, VROByteBuffer &outBuffer);
     static size_t encodeQuad(VROLineSegment segment, bool beginDegenerate, bool endDegenerate, VROByteBuffer &buffer);
     static size_t encodeCircularEndcap(VROVector3f center, VROVector3f direction,
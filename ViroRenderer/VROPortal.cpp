@@ -27,20 +27,303 @@
 #include "VROPortal.h"
 #include "VROLog.h"
 #include "VROGeometry.h"
+#include "VROGeometryElement.h"
 #include "VROMaterial.h"
+#include "VROARShadow.h"
+#include "VROTexture.h"
 #include "VROSkybox.h"
-#include "VROSphere.h"
+#include "VROBackgroundQuad.h"
 #include "VROBoundingBox.h"
 #include "VROPortalFrame.h"
 #include "VROShaderModifier.h"
+#include "VROLightClusterGrid.h"
+#include "VRORenderStatistics.h"
+#include "VRORenderContext.h"
+#include "VROMath.h"
+#include "VRODriver.h"
+#include "VRORenderTarget.h"
+#include "VROImagePostProcess.h"
+#include "VROImageShaderProgram.h"
+#include "VROUniform.h"
+#include "VROShadowMapRenderPass.h"
+#include "VROOpenGL.h" // For pglpush and pop
+#include <float.h>
 
-// Parameters for sphere backgrounds
-static const float kSphereBackgroundRadius = 1;
-static const float kSphereBackgroundNumSegments = 60;
+// Minimum number of consecutive, instanceable elements before we render them
+// with one instanced draw. Each instanced material requires its own shader
+// variant, so small batches are not worth the extra program.
+static const int kMinAutomaticInstanceBatchSize = 4;
+
+/*
+ Returns true if the two sort keys can be rendered in one instanced draw: they
+ must render the same element with the same material and lights, and must not
+ be part of a hierarchy (hierarchies have their own depth-buffer handling).
+ */
+static bool VROCanInstanceSortKeys(const VROSortKey &a, const VROSortKey &b) {
+    return a.material == b.material &&
+           a.elementIndex == b.elementIndex &&
+           a.incoming == b.incoming &&
+           a.transparent == b.transparent &&
+           a.lights == b.lights &&
+           a.hierarchyId == kMaxHierarchyId &&
+           b.hierarchyId == kMaxHierarchyId &&
+           ((VRONode *) a.node)->isInstanceableWith(*((VRONode *) b.node));
+}
+
+// Minimum number of consecutive keys with the same material, rendering different
+// geometries from the same arena page, before we submit them in one multi-draw.
+// Like instancing, this uses the material's instanced shader variant.
+static const int kMinMultiDrawBatchSize = 4;
+
+// Portal frames within this distance of the camera are treated as covering the
+// whole screen, so that a frame the camera is about to pass through (even when
+// moving backward) is never culled
+static const float kPortalCullingCameraMargin = 1.0;
+
+// Margin added to the screen-space bounds of each portal, in normalized device
+// coordinates. The bounds are computed from the head camera, so the margin covers
+// the offset of each eye in stereo rendering
+static const float kPortalScreenBoundsMargin = 0.1;
+
+// Portals in VROPortalRenderMode::Automatic render to texture when they cover
+// less than this fraction of the screen
+static const float kPortalTextureMaxScreenArea = 0.25;
+
+// Contents textures are refreshed at least this often (in frames), so that
+// animated contents keep moving. They are refreshed every frame while the camera
+// moves more than kPortalTextureRefreshDistance (in meters), or the portal's
+// screen-space bounds move more than kPortalTextureRefreshBounds (in normalized
+// device coordinates), from their position at the last refresh
+static const int kPortalTextureRefreshInterval = 4;
+static const float kPortalTextureRefreshDistance = 0.02;
+static const float kPortalTextureRefreshBounds = 0.02;
+
+// Contents textures are only resized when the required size differs from their
+// current size by more than this fraction; the compositor scales the texture
+// to the portal's bounds
+static const float kPortalTextureResizeThreshold = 0.25;
+static const int kPortalTextureMinSize = 16;
+
+/*
+ Returns the matrix that scales and translates the given screen-space bounds (in
+ normalized device coordinates) to cover clip space. Multiplied with a projection,
+ this narrows the projection to the bounds.
+ */
+static VROMatrix4f VROGetCropMatrix(const VROVector4f &bounds) {
+    VROMatrix4f crop;
+    crop[0]  = 2.0f / (bounds.z - bounds.x);
+    crop[5]  = 2.0f / (bounds.w - bounds.y);
+    crop[12] = -(bounds.z + bounds.x) / (bounds.z - bounds.x);
+    crop[13] = -(bounds.w + bounds.y) / (bounds.w - bounds.y);
+    return crop;
+}
+
+/*
+ Returns true if the materials of the two sort keys can be bound once for both:
+ either they're the same material, or they differ only in their layer or region
+ of a packed diffuse texture (see VROMaterial::isBatchableWith). Materials that
+ can batch in this way share a shader and textures, so their keys are adjacent
+ once sorted.
+ */
+static bool VROCanBatchSortKeyMaterials(const VROSortKey &a, const VROSortKey &b) {
+    if (a.material == b.material) {
+        return true;
+    }
+    if (!a.incoming || !b.incoming || a.shader != b.shader || a.textures != b.textures) {
+        return false;
+    }
+    const VROMaterial &materialA = *((VRONode *) a.node)->getRenderedGeometry()->getMaterialForElement(a.elementIndex);
+    const VROMaterial &materialB = *((VRONode *) b.node)->getRenderedGeometry()->getMaterialForElement(b.elementIndex);
+    return materialA.isBatchableWith(materialB);
+}
+
+/*
+ Returns true if the two sort keys can be rendered in one multi-draw: they must
+ have the same (or batchable) material, without shader modifiers, whose uniforms
+ may be bound per geometry, and the same lights; they must not be part of a
+ hierarchy, and their geometries must share an arena page.
+ */
+/*
+ Returns true if any of the material's shader modifiers bind uniforms. Binders
+ may read each geometry, so their uniforms can't be shared across a multi-draw.
+ */
+static bool VROHasShaderModifierUniforms(const VROMaterial &material) {
+    for (const std::shared_ptr<VROShaderModifier> &modifier : material.getShaderModifiers()) {
+        if (!modifier->getUniforms().empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool VROCanMultiDrawSortKeys(const VROSortKey &a, const VROSortKey &b, const VROMaterial &material) {
+    return VROCanBatchSortKeyMaterials(a, b) &&
+           a.incoming == b.incoming &&
+           a.transparent == b.transparent &&
+           a.lights == b.lights &&
+           a.hierarchyId == kMaxHierarchyId &&
+           b.hierarchyId == kMaxHierarchyId &&
+           !VROHasShaderModifierUniforms(material) &&
+           ((VRONode *) a.node)->isMultiDrawableWith(a.elementIndex, *((VRONode *) b.node), b.elementIndex);
+}
+
+/*
+ Returns the material rendered by the given sort key: the outgoing material of
+ the element for keys that are not incoming.
+ */
+static const VROMaterial *VROGetSortKeyMaterial(const VROSortKey &key) {
+    VROGeometry *geometry = ((VRONode *) key.node)->getRenderedGeometry();
+    if (!geometry) {
+        return nullptr;
+    }
+    const std::shared_ptr<VROMaterial> &material = geometry->getMaterialForElement(key.elementIndex);
+    return key.incoming ? material.get() : material->getOutgoing().get();
+}
+
+/*
+ Returns true if the given key is rendered in the transparency accumulation pass
+ of a portal that accumulates transparency: this holds for all alpha blended
+ transparent keys, including those in hierarchies. Keys with other blend modes
+ are unaffected by order, or are not expressible as a weighted average.
+ */
+static bool VROIsAccumulatedTransparency(const VROSortKey &key, const VROMaterial &material) {
+    return key.transparent && material.getBlendMode() == VROBlendMode::Alpha;
+}
+
+/*
+ Returns true if the given key may be rendered before the background: it must be
+ opaque and write to the depth buffer, so that the background (which is depth
+ tested at the far plane) is not rendered over it.
+ */
+static bool VROPrecedesBackground(const VROSortKey &key) {
+    const VROMaterial *material = VROGetSortKeyMaterial(key);
+    return !key.transparent && material && material->getWritesToDepthBuffer();
+}
+
+/*
+ Bind the properties of the given material. When accumulating transparency the
+ material's blending is replaced with the accumulation blend, and depth writes
+ are disabled so that accumulated fragments never occlude one another.
+ */
+static void VROBindMaterialProperties(const std::shared_ptr<VROMaterial> &material, bool accumulating,
+                                      std::shared_ptr<VRODriver> &driver) {
+    material->bindProperties(driver);
+    if (accumulating) {
+        driver->setBlendingMode(VROBlendMode::WeightedTransparency);
+        driver->setDepthWritingEnabled(false);
+    }
+}
+
+/*
+ Automatic depth pre-pass thresholds. Fragment cost is estimated per opaque
+ element from its lighting model; the pre-pass is skipped when the opaque
+ triangle count is high enough that re-transforming it would likely cost
+ more than the shading it saves.
+ */
+static const int kDepthPrepassMinFragmentCost = 16;
+static const int kDepthPrepassMaxTriangles = 250000;
+
+static bool VROIsDepthPrepassEligible(const VROSortKey &key, const VROGeometry &geometry,
+                                      const VROMaterial &material) {
+    return !key.transparent &&
+           key.incoming &&
+           key.hierarchyId == kMaxHierarchyId &&
+           material.getOutgoing() == nullptr &&
+           material.getWritesToDepthBuffer() &&
+           material.getReadsFromDepthBuffer() &&
+           material.getShaderModifiers().empty() &&
+           geometry.getInstancedUBO() == nullptr;
+}
+
+/*
+ Depth-only materials used to write hierarchy parents to the depth buffer, one per
+ cull mode (indexed by VROCullMode). These share the constant depth-writing shader
+ of the depth pre-pass.
+ */
+static std::shared_ptr<VROMaterial> &VROGetHierarchyDepthMaterial(VROCullMode cullMode) {
+    static thread_local std::shared_ptr<VROMaterial> sHierarchyDepthMaterials[3];
+    
+    std::shared_ptr<VROMaterial> &material = sHierarchyDepthMaterials[(int) cullMode];
+    if (!material) {
+        material = std::make_shared<VROMaterial>();
+        material->setLightingModel(VROLightingModel::Constant);
+        material->setWritesToDepthBuffer(true);
+        material->setReadsFromDepthBuffer(true);
+        material->setCullMode(cullMode);
+        material->addShaderModifier(VROShadowMapRenderPass::getShadowDepthWritingModifier());
+    }
+    return material;
+}
+
+/*
+ Project the corners of the given box to normalized device coordinates, storing
+ their bounds (min x, min y, max x, max y). Returns the number of corners behind
+ the camera, which are excluded from the bounds.
+ */
+static int VROProjectBoundingBox(const VROBoundingBox &box, const VROMatrix4f &viewProjection,
+                                 VROVector4f *outBounds) {
+    float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+    int cornersBehind = 0;
+    for (int i = 0; i < 8; i++) {
+        VROVector4f corner((i & 1) ? box.getMaxX() : box.getMinX(),
+                           (i & 2) ? box.getMaxY() : box.getMinY(),
+                           (i & 4) ? box.getMaxZ() : box.getMinZ(), 1.0);
+        VROVector4f clip = viewProjection.multiply(corner);
+        if (clip.w <= kEpsilon) {
+            cornersBehind++;
+            continue;
+        }
+        minX = std::min(minX, clip.x / clip.w);
+        maxX = std::max(maxX, clip.x / clip.w);
+        minY = std::min(minY, clip.y / clip.w);
+        maxY = std::max(maxY, clip.y / clip.w);
+    }
+    *outBounds = VROVector4f(minX, minY, maxX, maxY);
+    return cornersBehind;
+}
+
+/*
+ The screen-space bounds of the given node, used to determine which geometry may
+ overlap a hierarchy. Nodes partly behind the camera are conservatively treated as
+ covering the screen.
+ */
+static VROVector4f VROGetNodeScreenBounds(const VRONode *node, const VROMatrix4f &viewProjection) {
+    VROVector4f bounds;
+    if (VROProjectBoundingBox(node->getBoundingBox(), viewProjection, &bounds) > 0) {
+        return VROVector4f(-FLT_MAX, -FLT_MAX, FLT_MAX, FLT_MAX);
+    }
+    return bounds;
+}
+
+static bool VROScreenBoundsOverlap(const VROVector4f &a, const VROVector4f &b) {
+    return a.x <= b.z && b.x <= a.z && a.y <= b.w && b.y <= a.w;
+}
+
+static int VROGetFragmentCost(VROLightingModel lightingModel) {
+    switch (lightingModel) {
+        case VROLightingModel::PhysicallyBased:
+            return 4;
+        case VROLightingModel::Blinn:
+        case VROLightingModel::Phong:
+            return 2;
+        case VROLightingModel::Lambert:
+            return 1;
+        default:
+            return 0;
+    }
+}
 
 VROPortal::VROPortal() :
     VRONode(),
-    _passable(false) {
+    _screenBounds(-1, -1, 1, 1),
+    _cullsContents(false),
+    _accumulatesTransparency(false),
+    _renderMode(VROPortalRenderMode::Inline),
+    _textureResolutionScale(0.5),
+    _compositeBounds(-1, -1, 1, 1),
+    _opaqueKeyCount(0),
+    _passable(false),
+    _backgroundHalfResolution(false) {
     _type = VRONodeType::Portal;
 }
 
@@ -52,20 +335,49 @@ void VROPortal::deleteGL() {
     if (_background) {
         _background->deleteGL();
     }
+    for (VROPortalContentsTexture &texture : _contentsTextures) {
+        texture.target.reset();
+        texture.lastRefreshFrame = -1;
+    }
+    _contentsCompositor.reset();
+    for (VROPortalBackgroundTexture &texture : _backgroundTextures) {
+        texture.target.reset();
+        texture.compositor.reset();
+        texture.lastRefreshFrame = -1;
+    }
     VRONode::deleteGL();
 }
 
 #pragma mark - Scene Preparation
 
-void VROPortal::traversePortals(int frame, int recursionLevel,
+void VROPortal::traversePortals(const VRORenderContext &context, int recursionLevel,
                                 std::shared_ptr<VROPortalFrame> activeFrame,
+                                VROVector4f screenBounds,
                                 tree<std::shared_ptr<VROPortal>> *outPortals) {
     passert (_type == VRONodeType::Portal);
+    int frame = context.getFrame();
     passert (_lastVisitedRenderingFrame < frame);
     
     _lastVisitedRenderingFrame = frame;
     _recursionLevel = recursionLevel;
     _activePortalFrame = activeFrame;
+    _screenBounds = screenBounds;
+    
+    // Only the root portal accumulates transparency: the accumulation targets are
+    // composited over the whole screen, while each child portal's contents must
+    // remain confined to (and blended within) its stencil region
+    _accumulatesTransparency = recursionLevel == 0 && context.isOrderIndependentTransparencyEnabled();
+    
+    // Narrow the camera frustum to the portal's bounds, by scaling and translating
+    // the bounds to cover clip space
+    _cullsContents = screenBounds.x > -1 || screenBounds.y > -1 || screenBounds.z < 1 || screenBounds.w < 1;
+    if (_cullsContents) {
+        const VROCamera &camera = context.getCamera();
+        VROMatrix4f projection = VROGetCropMatrix(screenBounds).multiply(camera.getProjection());
+        _contentFrustum.fitToModelView(camera.getLookAtMatrix().getArray(), projection.getArray(), 0, 0, 0);
+        _contentFrustum.removeFCP();
+        _contentCullingCamera = camera.getPosition();
+    }
     
     outPortals->value = std::dynamic_pointer_cast<VROPortal>(shared_from_this());
     
@@ -73,21 +385,25 @@ void VROPortal::traversePortals(int frame, int recursionLevel,
     std::vector<std::shared_ptr<VROPortal>> childPortals;
     getChildPortals(&childPortals);
     for (std::shared_ptr<VROPortal> &childPortal : childPortals) {
-        if (childPortal->_lastVisitedRenderingFrame < frame) {
+        VROVector4f childBounds;
+        if (childPortal->_lastVisitedRenderingFrame < frame &&
+            computeScreenBounds(childPortal->getPortalEntrance(), context, screenBounds, &childBounds)) {
             outPortals->children.push_back({});
             tree<std::shared_ptr<VROPortal>> *node = &outPortals->children.back();
             
             // When moving down the tree, we assign the child's own frame
             // as its frame to render.
-            childPortal->traversePortals(frame, recursionLevel + 1,
-                                         childPortal->getPortalEntrance(), node);
+            childPortal->traversePortals(context, recursionLevel + 1,
+                                         childPortal->getPortalEntrance(), childBounds, node);
         }
     }
     
     // Search up the scene graph
     const std::shared_ptr<VROPortal> parentPortal = getParentPortal();
     if (parentPortal) {
-         if (parentPortal->_lastVisitedRenderingFrame < frame) {
+         VROVector4f parentBounds;
+         if (parentPortal->_lastVisitedRenderingFrame < frame &&
+             computeScreenBounds(_portalEntrance, context, screenBounds, &parentBounds)) {
              outPortals->children.push_back({});
              tree<std::shared_ptr<VROPortal>> *node = &outPortals->children.back();
              
@@ -95,51 +411,311 @@ void VROPortal::traversePortals(int frame, int recursionLevel,
              // portal above's frame to render. That way, the parent will render
              // this portal's entrance, which will make it appear like an exit from
              // this portal into the parent.
-             parentPortal->traversePortals(frame, recursionLevel + 1, _portalEntrance, node);
+             parentPortal->traversePortals(context, recursionLevel + 1, _portalEntrance, parentBounds, node);
          }
     }
 }
 
-void VROPortal::sortNodesBySortKeys() {
+bool VROPortal::computeScreenBounds(const std::shared_ptr<VROPortalFrame> &frame, const VRORenderContext &context,
+                                    const VROVector4f &clipBounds, VROVector4f *outBounds) {
+    if (!frame) {
+        *outBounds = clipBounds;
+        return true;
+    }
+    
+    const VROCamera &camera = context.getCamera();
+    VROBoundingBox box = frame->getUmbrellaBoundingBox();
+    if (box.getDistanceToPoint(camera.getPosition()) < kPortalCullingCameraMargin) {
+        *outBounds = clipBounds;
+        return true;
+    }
+    
+    // Project the corners of the frame's bounds. If any corner is behind the
+    // camera, the projected bounds are unreliable, so the frame is conservatively
+    // treated as covering the screen unless every corner is behind the camera
+    VROMatrix4f viewProjection = camera.getProjection().multiply(camera.getLookAtMatrix());
+    VROVector4f projected;
+    int cornersBehind = VROProjectBoundingBox(box, viewProjection, &projected);
+    if (cornersBehind == 8) {
+        return false;
+    }
+    if (cornersBehind > 0) {
+        *outBounds = clipBounds;
+        return true;
+    }
+    
+    VROVector4f bounds(std::max(projected.x - kPortalScreenBoundsMargin, clipBounds.x),
+                       std::max(projected.y - kPortalScreenBoundsMargin, clipBounds.y),
+                       std::min(projected.z + kPortalScreenBoundsMargin, clipBounds.z),
+                       std::min(projected.w + kPortalScreenBoundsMargin, clipBounds.w));
+    if (bounds.x >= bounds.z || bounds.y >= bounds.w) {
+        return false;
+    }
+    *outBounds = bounds;
+    return true;
+}
+
+/*
+ Returns the number of leading opaque keys in the given sorted keys, after which
+ the background is rendered. A hierarchy's depth is only written once it's
+ complete, so a split within a hierarchy moves to its start.
+ */
+static size_t VROCountOpaqueKeys(const std::vector<VROSortKey> &keys) {
+    size_t opaqueKeyCount = 0;
+    while (opaqueKeyCount < keys.size() && VROPrecedesBackground(keys[opaqueKeyCount])) {
+        ++opaqueKeyCount;
+    }
+    while (opaqueKeyCount > 0 && opaqueKeyCount < keys.size() &&
+           keys[opaqueKeyCount].hierarchyId < kMaxHierarchyId &&
+           keys[opaqueKeyCount].hierarchyId == keys[opaqueKeyCount - 1].hierarchyId) {
+        --opaqueKeyCount;
+    }
+    return opaqueKeyCount;
+}
+
+void VROPortal::sortNodesBySortKeys(const VRORenderContext &context, std::shared_ptr<VROJobSystem> &jobs) {
     _keys.clear();
-    getSortKeysForVisibleNodes(&_keys);
+    if (_cullsContents) {
+        getSortKeysForVisibleNodes(&_keys, _contentFrustum, _contentCullingCamera);
+    }
+    else if (!context.getSecondaryViewFrustums().empty()) {
+        // Nodes seen only by secondary views are visible as well, so narrow the
+        // keys to the camera's frustum
+        const VROCamera &camera = context.getCamera();
+        getSortKeysForVisibleNodes(&_keys, camera.getFrustum(), camera.getPosition());
+    }
+    else {
+        getSortKeysForVisibleNodes(&_keys);
+    }
+    
+    // Accumulated transparency is independent of order, so these keys need no depth
+    // sort; dropping their distance groups them by state instead
+    if (_accumulatesTransparency) {
+        for (VROSortKey &key : _keys) {
+            if (!key.transparent) {
+                continue;
+            }
+            const VROMaterial *material = VROGetSortKeyMaterial(key);
+            if (material && VROIsAccumulatedTransparency(key, *material)) {
+                key.distanceFromCamera = 0;
+            }
+        }
+    }
+    _keySorter.sort(_keys, jobs);
+    _opaqueKeyCount = VROCountOpaqueKeys(_keys);
+}
+
+void VROPortal::renderView(const VRORenderContext &context, std::shared_ptr<VRODriver> &driver,
+                           int viewBitMask, bool renderBackground, bool renderTransparency,
+                           std::vector<VROSortKey> &keys, VROSortKeySorter &sorter) {
+    const VROCamera &camera = context.getCamera();
+    keys.clear();
+    getSortKeysForVisibleNodes(&keys, camera.getFrustum(), camera.getPosition());
+    
+    // The sort keys were computed from the main camera: their distances are redone
+    // from this view's camera. Hierarchies share the distance of their parent and
+    // order independent keys take the far plane, so each keeps its distance
+    float zFar = context.getZFar();
+    size_t count = 0;
+    for (size_t i = 0; i < keys.size(); i++) {
+        VROSortKey key = keys[i];
+        VRONode *node = (VRONode *) key.node;
+        if ((node->getViewBitMask() & viewBitMask) == 0 || (key.transparent && !renderTransparency)) {
+            continue;
+        }
+        const VROMaterial *material = VROGetSortKeyMaterial(key);
+        bool orderIndependent = key.transparent && material && material->isOrderIndependent();
+        if (key.hierarchyId == kMaxHierarchyId && !orderIndependent) {
+            float distance = node->getBoundingBox().getCenter().distance(camera.getPosition());
+            if (!isinf(distance)) {
+                key.distanceFromCamera = key.transparent ? zFar - distance : distance;
+            }
+        }
+        keys[count++] = key;
+    }
+    keys.resize(count);
+    sorter.sort(keys);
+    
+    // Render the view's keys in place of the main camera's. Views do not accumulate
+    // transparency, so their alpha blended keys are sorted and blended as usual
+    std::swap(_keys, keys);
+    size_t opaqueKeyCount = _opaqueKeyCount;
+    bool accumulatesTransparency = _accumulatesTransparency;
+    _opaqueKeyCount = VROCountOpaqueKeys(_keys);
+    _accumulatesTransparency = false;
+    
+    if (renderBackground) {
+        renderContents(context, driver, [this, &context, &driver] {
+            this->renderBackground(context, driver);
+        });
+    }
+    else {
+        renderContents(context, driver);
+    }
     
-    std::sort(_keys.begin(), _keys.end());
+    std::swap(_keys, keys);
+    _opaqueKeyCount = opaqueKeyCount;
+    _accumulatesTransparency = accumulatesTransparency;
 }
 
 #pragma mark - Rendering Contents
 
 void VROPortal::renderBackground(const VRORenderContext &context,
                                  std::shared_ptr<VRODriver> &driver) {
-    if (_background) {
-        const std::shared_ptr<VROMaterial> &material = _background->getMaterials()[0];
+    if (!_background) {
+        return;
+    }
+    
+    VROPortalBackgroundTexture &texture = _backgroundTextures[(int) context.getEyeType()];
+    if (_backgroundHalfResolution && texture.compositor && texture.lastRefreshFrame == context.getFrame()) {
+        const std::shared_ptr<VROMaterial> &material = texture.compositor->getMaterialForElement(0);
         if (material->bindShader(0, {}, context, driver)) {
             material->bindProperties(driver);
-            
-            VROMatrix4f transform;
-            transform = _backgroundTransform.multiply(transform);
-            _background->render(0, material, transform, {}, 1.0, context, driver);
+            texture.compositor->render(0, material, {}, {}, 1.0, context, driver);
+        }
+        return;
+    }
+    
+    // Backgrounds drawn in pieces (e.g. VROTiledVideoSphere) draw each element in
+    // order over the last
+    VROMatrix4f transform;
+    transform = _backgroundTransform.multiply(transform);
+    
+    for (int i = 0; i < _background->getGeometryElements().size(); i++) {
+        const std::shared_ptr<VROMaterial> &material = _background->getMaterialForElement(i);
+        if (material->bindShader(0, {}, context, driver)) {
+            material->bindProperties(driver);
+            _background->render(i, material, transform, {}, 1.0, context, driver);
         }
     }
 }
 
-void VROPortal::renderContents(const VRORenderContext &context, std::shared_ptr<VRODriver> &driver) {
+void VROPortal::updateBackgroundTexture(std::shared_ptr<VRORenderTarget> &target,
+                                        const VRORenderContext &context, std::shared_ptr<VRODriver> &driver) {
+    if (!_background || !_backgroundHalfResolution || context.isMultiviewEnabled()) {
+        return;
+    }
+    
+    VROPortalBackgroundTexture &texture = _backgroundTextures[(int) context.getEyeType()];
+    VRORenderTargetType type = context.isHDREnabled() ? VRORenderTargetType::ColorTextureHDR16 :
+                                                        VRORenderTargetType::ColorTexture;
+    if (!texture.target || texture.target->getType() != type) {
+        texture.target = driver->newRenderTarget(type, 1, 1, false, false);
+        texture.compositor.reset();
+    }
+    
+    int width  = std::max(1, target->getWidth()  / 2);
+    int height = std::max(1, target->getHeight() / 2);
+    if (texture.target->getWidth() != width || texture.target->getHeight() != height) {
+        texture.target->setViewport({ 0, 0, width, height });
+    }
+    if (!texture.target->hydrate()) {
+        pwarn("Failed to create half resolution background texture for portal [%s]", getName().c_str());
+        _backgroundHalfResolution = false;
+        texture.target.reset();
+        texture.compositor.reset();
+        return;
+    }
+    if (!texture.compositor) {
+        texture.compositor = VROBackgroundQuad::createScreen(texture.target->getTexture(0));
+    }
+    
+    pglpush("Background Texture");
+    
+    // The texture has no depth or stencil: nothing else is rendered into it. The
+    // stale texture is invalidated so that renderBackground renders the background
+    // itself
+    driver->bindRenderTarget(texture.target, VRORenderTargetActions::clearColorOnly(), VRORenderTargetUnbindOp::None);
+    texture.lastRefreshFrame = -1;
+    renderBackground(context, driver);
+    driver->unbindShader();
+    
+    driver->bindRenderTarget(target, VRORenderTargetActions(VROLoadAction::Load, VROLoadAction::Load, VROLoadAction::Load,
+                                                            VROStoreAction::Store, VROStoreAction::Discard, VROStoreAction::Discard),
+                             VRORenderTargetUnbindOp::Invalidate);
+    pglpop();
+    
+    texture.lastRefreshFrame = context.getFrame();
+}
+
+void VROPortal::renderContents(const VRORenderContext &context, std::shared_ptr<VRODriver> &driver,
+                               std::function<void()> opaqueCallback) {
     uint32_t boundMaterialId = UINT32_MAX;
     uint32_t boundHierarchyId = kMaxHierarchyId; // kMaxHierarchyId == Not a hierarchy
     VROSortKey *boundHierarchyParent = nullptr;
     std::vector<std::shared_ptr<VROLight>> boundLights;
     
+    // Keys in [i, instancingDisabledUntil) are known not to instance, and keys
+    // in [i, multiDrawDisabledUntil) are known not to multi-draw
+    size_t instancingDisabledUntil = 0;
+    size_t multiDrawDisabledUntil = 0;
+    std::vector<VRONode *> instances;
+    std::vector<int> elementIndices;
+    std::vector<VROTexture *> diffuseTextures;
+    
+    // Clustered lights are not part of each node's computed lights
+    std::shared_ptr<VROLightClusterGrid> clusters = context.getLightClusters();
+    bool hasClusteredLights = clusters && clusters->getNumLights() > 0;
+    
+    // Null unless render statistics are enabled
+    VRORenderStatistics *statistics = context.getRenderStatistics().get();
+    
+    // When this portal accumulates transparency, its alpha blended keys render only
+    // in the accumulation pass, and all other keys only in the regular pass
+    bool accumulating = context.isAccumulatingTransparency();
+    passert (!accumulating || _accumulatesTransparency);
+    
+    // Finished hierarchies whose parents have not yet been written to the depth
+    // buffer, and the union of their screen bounds. Their depth writes are deferred
+    // until geometry that may overlap them is rendered, so that the depth writes of
+    // adjacent hierarchies are batched together. Multiview renders both eyes at once,
+    // so its screen bounds are not known and depth is written immediately
+    std::vector<VROSortKey *> pendingHierarchyParents;
+    VROVector4f pendingHierarchyBounds;
+    VROMatrix4f viewProjection = context.getProjectionMatrix().multiply(context.getViewMatrix());
+    bool defersHierarchyDepth = !context.isMultiviewEnabled();
+    auto overlapsPendingHierarchies = [&](const VROSortKey &key) {
+        return !pendingHierarchyParents.empty() &&
+               (!defersHierarchyDepth ||
+                VROScreenBoundsOverlap(VROGetNodeScreenBounds((VRONode *) key.node, viewProjection), pendingHierarchyBounds));
+    };
+    
+    // Once the leading opaque keys are rendered, their pending hierarchies are
+    // written to the depth buffer before invoking the opaque callback, so that
+    // whatever it renders at the far plane is rejected behind them. Batches
+    // never straddle the split
+    bool splitsOpaqueKeys = opaqueCallback && _opaqueKeyCount < _keys.size();
+    auto finishOpaqueKeys = [&]() {
+        if (boundHierarchyId < kMaxHierarchyId) {
+            pendingHierarchyParents.push_back(boundHierarchyParent);
+            boundHierarchyId = kMaxHierarchyId;
+            boundHierarchyParent = nullptr;
+        }
+        if (!pendingHierarchyParents.empty()) {
+            writeHierarchyParentsToDepthBuffer(pendingHierarchyParents, context, driver);
+            pendingHierarchyParents.clear();
+        }
+        opaqueCallback();
+        boundMaterialId = UINT32_MAX;
+    };
+    
     if (kDebugSortOrder && context.getFrame() % kDebugSortOrderFrameFrequency == 0) {
         pinfo("Rendering");
     }
     
     // Note that since portals and portal frames are not returned in _keys,
     // they will not be rendered here
-    for (VROSortKey &key : _keys) {
+    for (size_t i = 0; i < _keys.size(); i++) {
+        if (splitsOpaqueKeys && i == _opaqueKeyCount) {
+            finishOpaqueKeys();
+        }
+        size_t batchLimit = (splitsOpaqueKeys && i < _opaqueKeyCount) ? _opaqueKeyCount : _keys.size();
+        
+        VROSortKey &key = _keys[i];
         VRONode *node = (VRONode *)key.node;
         int elementIndex = key.elementIndex;
         
-        const std::shared_ptr<VROGeometry> &geometry = node->getGeometry();
+        VROGeometry *geometry = node->getRenderedGeometry();
         if (!geometry) {
             continue;
         }
@@ -148,37 +724,62 @@ void VROPortal::renderContents(const VRORenderContext &context, std::shared_ptr<
         if (!key.incoming) {
             material = material->getOutgoing();
         }
+        if (_accumulatesTransparency && VROIsAccumulatedTransparency(key, *material) != accumulating) {
+            continue;
+        }
         
-        // Rebind if materials or lights changed. We always have to rebind material
-        // properties even if only the lights changed, because new lights imply
-        // a potential change of shader -- and we have to upload our material's uniforms
-        // to any new shader.
-        if (key.material != boundMaterialId || boundLights != node->getComputedLights()) {
-
-            // If we're rendering a hierarchical object -- meaning, an object that's part of a close-knit
-            // 2D unit like a flex-view -- then the entire hierarchy of these 2D objects will appear
-            // consecutively in the sort order. In order to ensure there is no Z-fighting between the
-            // objects in the hierarchy (as they share the same 2D plane), we do not render the any object
-            // in the hierarchy to the depth buffer. Then, when we're done rendering the entire hierarchy
-            // we go back and re-render the parent of the hierarchy to the depth buffer, so that the
-            // hierarchy as a whole plays well in the depth buffer with other 3D objects.
-
-            // When the active hierarchy changes (to a new hierarchy, or to none)
+        // Shadow catchers draw nothing unless a shadow caster projects onto them
+        if (material->isShadowCatcher() &&
+            !VROARShadow::isShadowed(node->getBoundingBox(), node->getComputedLights())) {
+            continue;
+        }
+        
+        // If we're rendering a hierarchical object -- meaning, an object that's part of a close-knit
+        // 2D unit like a flex-view -- then the entire hierarchy of these 2D objects will appear
+        // consecutively in the sort order. In order to ensure there is no Z-fighting between the
+        // objects in the hierarchy (as they share the same 2D plane), we do not render the any object
+        // in the hierarchy to the depth buffer. Then, when we're done rendering the entire hierarchy
+        // we go back and render the parent of the hierarchy to the depth buffer, so that the
+        // hierarchy as a whole plays well in the depth buffer with other 3D objects.
+        //
+        // Accumulated transparency never writes depth, so it needs no hierarchy handling.
+        if (!accumulating) {
+            // When the active hierarchy changes (to a new hierarchy, or to none), defer
+            // the depth write of the last hierarchy's parent. The material is rebound so
+            // that depth writing is set for the new key
             if (key.hierarchyId != boundHierarchyId) {
-                // Finish the last hierarchy by writing the parent to the depth buffer
                 if (boundHierarchyId < kMaxHierarchyId) {
                     passert (boundHierarchyParent != nullptr);
-                    writeHierarchyParentToDepthBuffer(*boundHierarchyParent, context, driver);
-                    boundHierarchyId = kMaxHierarchyId;
-                }
-
-                // Set the parent of the new hierarchy
-                if (key.hierarchyId < kMaxHierarchyId) {
-                    boundHierarchyParent = &key;
-                } else {
-                    boundHierarchyParent = nullptr;
+                    VROVector4f bounds = VROGetNodeScreenBounds((VRONode *) boundHierarchyParent->node, viewProjection);
+                    if (pendingHierarchyParents.empty()) {
+                        pendingHierarchyBounds = bounds;
+                    } else {
+                        pendingHierarchyBounds = VROVector4f(std::min(bounds.x, pendingHierarchyBounds.x),
+                                                             std::min(bounds.y, pendingHierarchyBounds.y),
+                                                             std::max(bounds.z, pendingHierarchyBounds.z),
+                                                             std::max(bounds.w, pendingHierarchyBounds.w));
+                    }
+                    pendingHierarchyParents.push_back(boundHierarchyParent);
                 }
+                boundHierarchyId = key.hierarchyId;
+                boundHierarchyParent = key.hierarchyId < kMaxHierarchyId ? &key : nullptr;
+                boundMaterialId = UINT32_MAX;
+            }
+            
+            // Geometry that may overlap the pending hierarchies must be depth tested
+            // against them
+            if (overlapsPendingHierarchies(key)) {
+                writeHierarchyParentsToDepthBuffer(pendingHierarchyParents, context, driver);
+                pendingHierarchyParents.clear();
+                boundMaterialId = UINT32_MAX;
             }
+        }
+        
+        // Rebind if materials or lights changed. We always have to rebind material
+        // properties even if only the lights changed, because new lights imply
+        // a potential change of shader -- and we have to upload our material's uniforms
+        // to any new shader.
+        if (key.material != boundMaterialId || boundLights != node->getComputedLights()) {
 
             // TODO Perhaps we can check if the shader changed, and if so bind
             //      properties? We could also meld these two methods into one, simplifying
@@ -187,12 +788,11 @@ void VROPortal::renderContents(const VRORenderContext &context, std::shared_ptr<
                 pinfo("Failed to bind shader: will not render associated geometry");
                 continue;
             }
-            material->bindProperties(driver);
+            VROBindMaterialProperties(material, accumulating, driver);
 
             // When rendering a hierarchy, ensure nothing is written to the depth buffer
-            if (key.hierarchyId < kMaxHierarchyId) {
+            if (!accumulating && key.hierarchyId < kMaxHierarchyId) {
                 driver->setDepthWritingEnabled(false);
-                boundHierarchyId = key.hierarchyId;
             }
 
             boundMaterialId = key.material;
@@ -201,49 +801,381 @@ void VROPortal::renderContents(const VRORenderContext &context, std::shared_ptr<
         
         // We render the material if at least one of the following is true:
         //
-        // 1. There are lights in the scene that haven't been culled (if there are no lights, then
+        // 1. There are lights in the scene that haven't been culled, or clustered lights (if there are no lights, then
         //    nothing will be visible! Or,
         // 2. The material is Constant. Constant materials do not need light to be visible. Or,
         // 3. The material is PBR, and we have an active lighting environment. Lighting environments
         //    provide ambient light for PBR materials
-        if (!boundLights.empty() ||
+        if (!boundLights.empty() || hasClusteredLights ||
             material->getLightingModel() == VROLightingModel::Constant ||
             (material->getLightingModel() == VROLightingModel::PhysicallyBased && context.getIrradianceMap() != nullptr)) {
 
             if (kDebugSortOrder && context.getFrame() % kDebugSortOrderFrameFrequency == 0) {
                 if (node->getGeometry() && elementIndex == 0) {
-                    pinfo("   Rendering node [%s], element %d [transparent %d, distance from far plane %f, hierarchy [%d-%d]",
+                    pinfo("   Rendering node [%s], element %d [transparent %d, sort distance %f, hierarchy [%d-%d]",
                           node->getName().c_str(), elementIndex, key.transparent, key.distanceFromCamera, key.hierarchyId, key.hierarchyDepth);
                 }
             }
 
+            // Automatic instancing: when consecutive keys render the same geometry element
+            // with the same material, render them all in one instanced draw. Sorting has
+            // already made these keys adjacent, and they remain in sort order within the
+            // instanced draw
+            size_t batchEnd = i + 1;
+            if (i >= instancingDisabledUntil) {
+                while (batchEnd < batchLimit && VROCanInstanceSortKeys(key, _keys[batchEnd]) &&
+                       !overlapsPendingHierarchies(_keys[batchEnd])) {
+                    ++batchEnd;
+                }
+            }
+            // Geometries animated by a baked animation can only be rendered instanced
+            size_t minBatchSize = kMinAutomaticInstanceBatchSize;
+            if (node->getGeometry() && node->getRenderedGeometry()->isInstancingRequired()) {
+                minBatchSize = 1;
+            }
+            if (i >= instancingDisabledUntil && batchEnd - i >= minBatchSize) {
+                if (material->bindInstancedShader(key.lights, boundLights, context, driver)) {
+                    VROBindMaterialProperties(material, accumulating, driver);
+                    
+                    instances.clear();
+                    for (size_t j = i; j < batchEnd; j++) {
+                        instances.push_back((VRONode *) _keys[j].node);
+                    }
+                    if (statistics) {
+                        statistics->beginDraw(material, driver);
+                        for (VRONode *instance : instances) {
+                            statistics->addDraw(instance, elementIndex);
+                        }
+                    }
+                    VRONode::renderInstanced(instances, elementIndex, material, context, driver);
+                    if (statistics) {
+                        statistics->endDraw(driver);
+                    }
+                    
+                    // The instanced shader is now bound, so force a rebind on the next key
+                    boundMaterialId = UINT32_MAX;
+                    i = batchEnd - 1;
+                    continue;
+                }
+                
+                // Instancing isn't available for this material; restore its regular
+                // shader and render the batch normally
+                instancingDisabledUntil = batchEnd;
+                if (!material->bindShader(key.lights, boundLights, context, driver)) {
+                    continue;
+                }
+                VROBindMaterialProperties(material, accumulating, driver);
+            }
+            else if (i >= multiDrawDisabledUntil) {
+                // Multi-draw: when consecutive keys render different geometries from the same
+                // arena page with the same material, the keys differ only in transform and in
+                // the range of the page they draw. Submit them in one multi-draw, whose
+                // commands execute in sort order
+                size_t multiDrawEnd = i + 1;
+                while (multiDrawEnd < batchLimit && VROCanMultiDrawSortKeys(key, _keys[multiDrawEnd], *material) &&
+                       !overlapsPendingHierarchies(_keys[multiDrawEnd])) {
+                    ++multiDrawEnd;
+                }
+                if (multiDrawEnd - i >= kMinMultiDrawBatchSize) {
+                    if (material->bindInstancedShader(key.lights, boundLights, context, driver)) {
+                        VROBindMaterialProperties(material, accumulating, driver);
+                        
+                        // Materials with packed diffuse textures select their layer or
+                        // atlas region per draw
+                        std::shared_ptr<VROTexture> diffuse = material->getDiffuse().getTexture();
+                        bool packed = diffuse->getTextureArrayId() != 0 || diffuse->getTextureAtlasId() != 0;
+                        
+                        instances.clear();
+                        elementIndices.clear();
+                        diffuseTextures.clear();
+                        for (size_t j = i; j < multiDrawEnd; j++) {
+                            instances.push_back((VRONode *) _keys[j].node);
+                            elementIndices.push_back(_keys[j].elementIndex);
+                            if (packed) {
+                                const std::shared_ptr<VROMaterial> &drawMaterial = _keys[j].incoming ?
+                                    instances.back()->getRenderedGeometry()->getMaterialForElement(_keys[j].elementIndex) : material;
+                                diffuseTextures.push_back(drawMaterial->getDiffuse().getTexture().get());
+                            }
+                        }
+                        if (statistics) {
+                            statistics->beginDraw(material, driver);
+                            for (size_t j = 0; j < instances.size(); j++) {
+                                statistics->addDraw(instances[j], elementIndices[j]);
+                            }
+                        }
+                        VRONode::renderMultiDraw(instances, elementIndices, diffuseTextures, material, context, driver);
+                        if (statistics) {
+                            statistics->endDraw(driver);
+                        }
+                        
+                        boundMaterialId = UINT32_MAX;
+                        i = multiDrawEnd - 1;
+                        continue;
+                    }
+                    
+                    multiDrawDisabledUntil = multiDrawEnd;
+                    if (!material->bindShader(key.lights, boundLights, context, driver)) {
+                        continue;
+                    }
+                    VROBindMaterialProperties(material, accumulating, driver);
+                }
+            }
+
+            if (statistics) {
+                statistics->beginDraw(material, driver);
+                statistics->addDraw(node, elementIndex);
+            }
             node->render(elementIndex, material, context, driver);
+            if (statistics) {
+                statistics->endDraw(driver);
+            }
         }
     }
+    
+    // Geometry rendered after these contents (portal frames, other portals, and
+    // accumulated transparency) is depth tested, so the remaining hierarchies,
+    // including the last, are always written
+    if (boundHierarchyId < kMaxHierarchyId) {
+        pendingHierarchyParents.push_back(boundHierarchyParent);
+    }
+    if (!pendingHierarchyParents.empty()) {
+        writeHierarchyParentsToDepthBuffer(pendingHierarchyParents, context, driver);
+    }
+    if (opaqueCallback && !splitsOpaqueKeys) {
+        opaqueCallback();
+    }
 }
 
-void VROPortal::writeHierarchyParentToDepthBuffer(VROSortKey &hierarchyParent,
-                                                  const VRORenderContext &context,
-                                                  std::shared_ptr<VRODriver> &driver) {
-    VRONode *hParentNode = (VRONode *)hierarchyParent.node;
-    if (!hParentNode->getGeometry()) {
-        return;
+void VROPortal::renderDepthPrepass(std::shared_ptr<VROMaterial> depthMaterials[],
+                                   const VRORenderContext &context, std::shared_ptr<VRODriver> &driver) {
+    VROMaterial *boundMaterial = nullptr;
+    
+    for (size_t i = 0; i < _keys.size(); i++) {
+        VROSortKey &key = _keys[i];
+        VRONode *node = (VRONode *)key.node;
+        
+        VROGeometry *geometry = node->getRenderedGeometry();
+        if (!geometry) {
+            continue;
+        }
+        const std::shared_ptr<VROMaterial> &material = geometry->getMaterialForElement(key.elementIndex);
+        if (!VROIsDepthPrepassEligible(key, *geometry, *material)) {
+            continue;
+        }
+        
+        std::shared_ptr<VROMaterial> &depthMaterial = depthMaterials[(int) material->getCullMode()];
+        if (depthMaterial.get() != boundMaterial) {
+            if (!depthMaterial->bindShader(0, {}, context, driver)) {
+                continue;
+            }
+            depthMaterial->bindProperties(driver);
+            boundMaterial = depthMaterial.get();
+        }
+        node->renderDepth(key.elementIndex, depthMaterial, context, driver);
     }
+}
 
-    std::shared_ptr<VROMaterial> hParentMaterial = hParentNode->getGeometry()->getMaterialForElement(hierarchyParent.elementIndex);
-    if (!hParentMaterial->bindShader(hierarchyParent.lights, hParentNode->getComputedLights(), context, driver)) {
-        pinfo("Failed to bind shader: will not render associated geometry");
-        return;
+bool VROPortal::isDepthPrepassBeneficial() const {
+    int fragmentCost = 0;
+    int triangles = 0;
+    
+    for (const VROSortKey &key : _keys) {
+        VRONode *node = (VRONode *)key.node;
+        VROGeometry *geometry = node->getRenderedGeometry();
+        if (!geometry) {
+            continue;
+        }
+        const std::shared_ptr<VROMaterial> &material = geometry->getMaterialForElement(key.elementIndex);
+        if (!VROIsDepthPrepassEligible(key, *geometry, *material)) {
+            continue;
+        }
+        
+        fragmentCost += VROGetFragmentCost(material->getLightingModel());
+        triangles += node->getRenderedGeometry()->getGeometryElements()[key.elementIndex]->getPrimitiveCount();
+        if (triangles > kDepthPrepassMaxTriangles) {
+            return false;
+        }
     }
-    hParentMaterial->bindProperties(driver);
+    return fragmentCost >= kDepthPrepassMinFragmentCost;
+}
 
-    driver->setDepthWritingEnabled(true);
-    driver->setDepthReadingEnabled(true);
+void VROPortal::writeHierarchyParentsToDepthBuffer(const std::vector<VROSortKey *> &hierarchyParents,
+                                                   const VRORenderContext &context,
+                                                   std::shared_ptr<VRODriver> &driver) {
+    VROMaterial *boundDepthMaterial = nullptr;
     driver->setRenderTargetColorWritingMask(VROColorMaskNone);
-    hParentNode->render(hierarchyParent.elementIndex, hParentMaterial, context, driver);
+    
+    for (VROSortKey *hierarchyParent : hierarchyParents) {
+        VRONode *hParentNode = (VRONode *)hierarchyParent->node;
+        VROGeometry *hParentGeometry = hParentNode->getRenderedGeometry();
+        if (!hParentGeometry) {
+            continue;
+        }
+        
+        // The depth-only material reproduces the parent's depth unless the parent's
+        // shader modifiers displace vertices or discard fragments, or its geometry
+        // is instanced; in those cases the parent's own shader is used
+        std::shared_ptr<VROMaterial> hParentMaterial = hParentGeometry->getMaterialForElement(hierarchyParent->elementIndex);
+        if (hParentMaterial->getShaderModifiers().empty() && hParentGeometry->getInstancedUBO() == nullptr) {
+            std::shared_ptr<VROMaterial> &depthMaterial = VROGetHierarchyDepthMaterial(hParentMaterial->getCullMode());
+            if (depthMaterial.get() != boundDepthMaterial) {
+                if (!depthMaterial->bindShader(0, {}, context, driver)) {
+                    continue;
+                }
+                depthMaterial->bindProperties(driver);
+                boundDepthMaterial = depthMaterial.get();
+            }
+            hParentNode->renderDepth(hierarchyParent->elementIndex, depthMaterial, context, driver);
+            continue;
+        }
+        
+        if (!hParentMaterial->bindShader(hierarchyParent->lights, hParentNode->getComputedLights(), context, driver)) {
+            pinfo("Failed to bind shader: will not render associated geometry");
+            continue;
+        }
+        hParentMaterial->bindProperties(driver);
+        boundDepthMaterial = nullptr;
+        
+        driver->setDepthWritingEnabled(true);
+        driver->setDepthReadingEnabled(true);
+        hParentNode->render(hierarchyParent->elementIndex, hParentMaterial, context, driver);
+    }
     driver->setRenderTargetColorWritingMask(VROColorMaskAll);
 }
 
+#pragma mark - Render to Texture
+
+bool VROPortal::isRenderingToTexture(const VRORenderContext &context) const {
+    if (_renderMode == VROPortalRenderMode::Inline || _recursionLevel < 1 ||
+        !_activePortalFrame || isRenderingExitFrame()) {
+        return false;
+    }
+    
+    // Multiview renders both eyes in one pass, and the light clusters are built
+    // for the full-screen projection, so neither can be narrowed to the portal
+    if (context.isMultiviewEnabled() || context.isClusteredLightingEnabled()) {
+        return false;
+    }
+    if (_renderMode == VROPortalRenderMode::Texture) {
+        return true;
+    }
+    
+    float screenArea = (_screenBounds.z - _screenBounds.x) * (_screenBounds.w - _screenBounds.y) / 4.0f;
+    return screenArea < kPortalTextureMaxScreenArea;
+}
+
+void VROPortal::updateContentsTexture(std::shared_ptr<VRORenderTarget> &target,
+                                      const VRORenderContext &context, std::shared_ptr<VRODriver> &driver) {
+    VROPortalContentsTexture &texture = _contentsTextures[(int) context.getEyeType()];
+    int frame = context.getFrame();
+    const VROVector3f &cameraPosition = context.getCamera().getPosition();
+    
+    int width  = std::max(kPortalTextureMinSize,
+                          (int) (target->getWidth()  * (_screenBounds.z - _screenBounds.x) * 0.5f * _textureResolutionScale));
+    int height = std::max(kPortalTextureMinSize,
+                          (int) (target->getHeight() * (_screenBounds.w - _screenBounds.y) * 0.5f * _textureResolutionScale));
+    VRORenderTargetType type = context.isHDREnabled() ? VRORenderTargetType::ColorTextureHDR16 :
+                                                        VRORenderTargetType::ColorTexture;
+    
+    // A texture not composited last frame may be arbitrarily stale
+    bool refresh = !texture.target || texture.target->getType() != type ||
+                   texture.lastUsedFrame != frame - 1 ||
+                   frame - texture.lastRefreshFrame >= kPortalTextureRefreshInterval ||
+                   cameraPosition.distance(texture.cameraPosition) > kPortalTextureRefreshDistance ||
+                   fabs(_screenBounds.x - texture.bounds.x) > kPortalTextureRefreshBounds ||
+                   fabs(_screenBounds.y - texture.bounds.y) > kPortalTextureRefreshBounds ||
+                   fabs(_screenBounds.z - texture.bounds.z) > kPortalTextureRefreshBounds ||
+                   fabs(_screenBounds.w - texture.bounds.w) > kPortalTextureRefreshBounds;
+    texture.lastUsedFrame = frame;
+    if (!refresh) {
+        return;
+    }
+    
+    if (!texture.target || texture.target->getType() != type) {
+        texture.target = driver->newRenderTarget(type, 1, 1, false, true);
+    }
+    int currentWidth = texture.target->getWidth();
+    int currentHeight = texture.target->getHeight();
+    if (fabs(width  - currentWidth)  > currentWidth  * kPortalTextureResizeThreshold ||
+        fabs(height - currentHeight) > currentHeight * kPortalTextureResizeThreshold) {
+        texture.target->setViewport({ 0, 0, width, height });
+    }
+    if (!texture.target->hydrate()) {
+        pwarn("Failed to create contents texture for portal [%s], rendering inline", getName().c_str());
+        _renderMode = VROPortalRenderMode::Inline;
+        texture.target.reset();
+        return;
+    }
+    
+    pglpush("Contents Texture");
+    
+    // The parent target's depth and stencil remain in use, so it is not invalidated.
+    // The texture is cleared to the parent's clear color, which is the color the
+    // contents would otherwise be rendered over
+    texture.target->setClearColor(target->getClearColor());
+    driver->bindRenderTarget(texture.target, VRORenderTargetActions::clearAll(), VRORenderTargetUnbindOp::None);
+    texture.target->disablePortalStencilWriting(VROFace::FrontAndBack);
+    
+    // Narrow the projection to the portal's bounds, so the texture covers only the
+    // portal's region of the screen
+    VRORenderContext textureContext = context;
+    textureContext.setProjectionMatrix(VROGetCropMatrix(_screenBounds).multiply(context.getProjectionMatrix()));
+    
+    renderContents(textureContext, driver, [this, &textureContext, &driver] {
+        renderBackground(textureContext, driver);
+    });
+    driver->unbindShader();
+    
+    driver->bindRenderTarget(target, VRORenderTargetActions(VROLoadAction::Load, VROLoadAction::Load, VROLoadAction::Load,
+                                                            VROStoreAction::Store, VROStoreAction::Discard, VROStoreAction::Discard),
+                             VRORenderTargetUnbindOp::Invalidate);
+    pglpop();
+    
+    texture.bounds = _screenBounds;
+    texture.cameraPosition = cameraPosition;
+    texture.lastRefreshFrame = frame;
+}
+
+void VROPortal::renderContentsTexture(const VRORenderContext &context, std::shared_ptr<VRODriver> &driver) {
+    VROPortalContentsTexture &texture = _contentsTextures[(int) context.getEyeType()];
+    if (!texture.target) {
+        return;
+    }
+    
+    // Maps each pixel into the bounds the texture was last rendered at. Between
+    // refreshes the contents therefore hold still on screen
+    if (!_contentsCompositor) {
+        std::vector<std::string> samplers = { "contents_texture" };
+        std::vector<std::string> code = {
+            "uniform sampler2D contents_texture;",
+            "uniform highp vec4 contents_bounds;",
+            "highp vec2 ndc = v_texcoord * 2.0 - 1.0;",
+            "highp vec2 contents_uv = (ndc - contents_bounds.xy) / (contents_bounds.zw - contents_bounds.xy);",
+            "if (contents_uv.x < 0.0 || contents_uv.x > 1.0 || contents_uv.y < 0.0 || contents_uv.y > 1.0) {",
+            "    discard;",
+            "}",
+            "frag_color = texture(contents_texture, contents_uv);",
+        };
+        
+        std::shared_ptr<VROShaderModifier> modifier = std::make_shared<VROShaderModifier>(VROShaderEntryPoint::Image, code);
+        std::weak_ptr<VROPortal> portal_w = std::dynamic_pointer_cast<VROPortal>(shared_from_this());
+        modifier->setUniformBinder("contents_bounds", VROShaderProperty::Vec4,
+                                   [portal_w] (VROUniform *uniform,
+                                               const VROGeometry *geometry, const VROMaterial *material) {
+                                       std::shared_ptr<VROPortal> portal = portal_w.lock();
+                                       if (portal) {
+                                           uniform->setVec4(portal->_compositeBounds);
+                                       }
+                                   });
+        std::vector<std::shared_ptr<VROShaderModifier>> modifiers = { modifier };
+        std::shared_ptr<VROShaderProgram> shader = std::make_shared<VROImageShaderProgram>(samplers, modifiers, driver);
+        _contentsCompositor = driver->newImagePostProcess(shader);
+    }
+    
+    _compositeBounds = texture.bounds;
+    _contentsCompositor->blit({ texture.target->getTexture(0) }, driver);
+}
+
 #pragma mark - Portal Entrance
 
 void VROPortal::setPortalEntrance(std::shared_ptr<VROPortalFrame> entrance) {
@@ -269,13 +1201,13 @@ void VROPortal::renderPortal(const VRORenderContext &context, std::shared_ptr<VR
     }
 }
 
-void VROPortal::deactivateCulling(std::shared_ptr<VRONode> node) {
+void VROPortal::deactivateCulling(const std::shared_ptr<VRONode> &node) {
     if (node->getGeometry()) {
         for (const std::shared_ptr<VROMaterial> &material : node->getGeometry()->getMaterials()) {
             material->setCullMode(VROCullMode::None);
         }
     }
-    for (std::shared_ptr<VRONode> &child : node->getChildNodes()) {
+    for (const std::shared_ptr<VRONode> &child : node->getSubnodes()) {
         deactivateCulling(child);
     }
 }
@@ -290,6 +1222,14 @@ std::shared_ptr<VROTexture> VROPortal::getLightingEnvironment() const {
     return _lightingEnvironment;
 }
 
+void VROPortal::setAmbientSphericalHarmonics(std::shared_ptr<VROSphericalHarmonics> sh) {
+    _ambientSphericalHarmonics = sh;
+}
+
+std::shared_ptr<VROSphericalHarmonics> VROPortal::getAmbientSphericalHarmonics() const {
+    return _ambientSphericalHarmonics;
+}
+
 #pragma mark - Backgrounds
 
 static thread_local std::shared_ptr<VROShaderModifier> sBackgroundShaderModifier;
@@ -304,12 +1244,16 @@ void VROPortal::installBackgroundShaderModifier() {
                                                                         modifierCode);
         sBackgroundShaderModifier->setName("background");
     }
-    _background->getMaterials().front()->addShaderModifier(sBackgroundShaderModifier);
+    for (const std::shared_ptr<VROMaterial> &material : _background->getMaterials()) {
+        if (!material->hasShaderModifier(sBackgroundShaderModifier)) {
+            material->addShaderModifier(sBackgroundShaderModifier);
+        }
+    }
 }
 
 void VROPortal::setBackgroundCube(std::shared_ptr<VROTexture> textureCube) {
     passert_thread(__func__);
-    _background = VROSkybox::createSkybox(textureCube);
+    _background = VROBackgroundQuad::createCube(textureCube);
     _background->setName("Background");
     
     installBackgroundShaderModifier();
@@ -325,19 +1269,9 @@ void VROPortal::setBackgroundCube(VROVector4f color) {
 
 void VROPortal::setBackgroundSphere(std::shared_ptr<VROTexture> textureSphere) {
     passert_thread(__func__);
-    _background = VROSphere::createSphere(kSphereBackgroundRadius,
-                                          kSphereBackgroundNumSegments,
-                                          kSphereBackgroundNumSegments,
-                                          false);
-    _background->setCameraEnclosure(true);
+    _background = VROBackgroundQuad::createEquirectangular(textureSphere);
     _background->setName("Background");
     
-    std::shared_ptr<VROMaterial> material = _background->getMaterials().front();
-    material->setLightingModel(VROLightingModel::Constant);
-    material->getDiffuse().setTexture(textureSphere);
-    material->setWritesToDepthBuffer(false);
-    material->setNeedsToneMapping(false);
-    
     installBackgroundShaderModifier();
 }
 
@@ -359,7 +1293,9 @@ void VROPortal::setBackgroundRotation(VROQuaternion rotation) {
 
 void VROPortal::removeBackground() {
     passert_thread(__func__);
-    _background->getMaterials().front()->removeShaderModifier(sBackgroundShaderModifier);
+    for (const std::shared_ptr<VROMaterial> &material : _background->getMaterials()) {
+        material->removeShaderModifier(sBackgroundShaderModifier);
+    }
     _background.reset();
 }
 
@@ -31,8 +31,35 @@
 #include "VROTree.h"
 #include "VROLineSegment.h"
 #include "VROPortalDelegate.h"
+#include "VROFrustum.h"
+#include "VROVector4f.h"
 
 class VROPortalFrame;
+class VRORenderTarget;
+class VROImagePostProcess;
+class VROSphericalHarmonics;
+
+/*
+ How the contents of a portal are rendered.
+ 
+ Inline:    The contents are rendered directly into the portal's stencil region
+            of the render target, every frame.
+ Texture:   The contents are rendered into an offscreen texture covering the
+            portal's screen-space bounds, at reduced resolution, then composited
+            onto the portal's stencil region. The texture is refreshed every frame
+            while the camera or portal moves quickly, and at a lower rate otherwise.
+ Automatic: Texture when the portal covers a small area of the screen, Inline
+            otherwise.
+ 
+ Texture mode applies only to portals seen through another portal (those at
+ recursion level 1 or deeper), and is not used with multiview or clustered
+ lighting. Portals nested within a portal rendered to texture are not rendered.
+ */
+enum class VROPortalRenderMode {
+    Inline,
+    Texture,
+    Automatic
+};
 
 /*
  Portals are nodes that partition subgraphs of the overall scene
@@ -55,10 +82,22 @@ public:
     void deleteGL();
     
     /*
-     Render this portal's background.
+     Render this portal's background. Backgrounds are pinned to the far plane, so
+     they are only shaded where no opaque contents were rendered before them. When
+     the background is rendered at half resolution, this composites the texture last
+     rendered by updateBackgroundTexture.
      */
     void renderBackground(const VRORenderContext &context, std::shared_ptr<VRODriver> &driver);
     
+    /*
+     Render this portal's background into its half resolution texture, if the
+     background is rendered at half resolution. Must be invoked before the
+     contents of the given target are rendered: it re-binds the target, resetting
+     its stencil state.
+     */
+    void updateBackgroundTexture(std::shared_ptr<VRORenderTarget> &target,
+                                 const VRORenderContext &context, std::shared_ptr<VRODriver> &driver);
+    
     /*
      Render this portal's geometry.
      */
@@ -74,9 +113,46 @@ public:
     
     /*
      Render the visible nodes in this portal's graph, in an order determined by the
-     latest computed sort keys.
+     latest computed sort keys. If this portal accumulates transparency, its alpha
+     blended keys are skipped, and are instead rendered (alone) when the context is
+     accumulating transparency.
+     
+     If provided, the opaque callback is invoked once the leading opaque keys are
+     rendered (and written to the depth buffer), before any transparent key. This
+     is where backgrounds are rendered, so that the depth test rejects the
+     background wherever opaque contents cover it.
+     */
+    void renderContents(const VRORenderContext &context, std::shared_ptr<VRODriver> &driver,
+                        std::function<void()> opaqueCallback = nullptr);
+    
+    /*
+     True if the alpha blended contents of this portal are rendered with weighted
+     blended order independent transparency this frame, instead of sorted back to
+     front. This holds for the root portal when order independent transparency is
+     enabled.
+     */
+    bool getAccumulatesTransparency() const {
+        return _accumulatesTransparency;
+    }
+
+    /*
+     Render the opaque contents of this portal to the depth buffer only, using the
+     given depth material for each cull mode (indexed by VROCullMode). Only keys
+     whose depth the depth material reproduces exactly are rendered: opaque keys
+     outside hierarchies, whose materials write depth and have no shader modifiers
+     (which may displace vertices or discard fragments), and whose geometry is not
+     instanced. The contents are then rendered as usual; as depth is tested with
+     LEQUAL, only the nearest surface at each pixel is shaded.
+     */
+    void renderDepthPrepass(std::shared_ptr<VROMaterial> depthMaterials[],
+                            const VRORenderContext &context, std::shared_ptr<VRODriver> &driver);
+
+    /*
+     Estimate whether a depth pre-pass pays off for the current sort keys: true when
+     the opaque contents have enough expensively shaded elements to outweigh the
+     cost of transforming their triangles a second time.
      */
-    void renderContents(const VRORenderContext &context, std::shared_ptr<VRODriver> &driver);
+    bool isDepthPrepassBeneficial() const;
     
     /*
      Iterate up and down the scene graph, starting at the active portal.
@@ -91,16 +167,37 @@ public:
      
      The activeFrame node is used to assign an entrance frame geometry to this
      portal. See the discussion under _activePortalFrame for more detail.
+     
+     Portals whose frames are off screen, or entirely outside the screen-space
+     bounds of the portal they're seen through, are not visited: since their
+     silhouettes would not pass the stencil test, nothing within them can be
+     seen. The screenBounds are those of this portal, in normalized device
+     coordinates (min x, min y, max x, max y).
      */
-    void traversePortals(int frame, int recursionLevel,
+    void traversePortals(const VRORenderContext &context, int recursionLevel,
                          std::shared_ptr<VROPortalFrame> activeFrame,
+                         VROVector4f screenBounds,
                          tree<std::shared_ptr<VROPortal>> *outPortals);
     
     /*
      Sort the visible nodes in this portal's sub-graph by their sort-keys, and fill
-     the internal _keys vector with the results.
+     the internal _keys vector with the results. If a job system is provided,
+     large sorts are split across its threads. Nodes outside the frustum narrowed
+     to this portal's screen-space bounds are excluded, as are nodes visible only
+     to the context's secondary views.
      */
-    void sortNodesBySortKeys();
+    void sortNodesBySortKeys(const VRORenderContext &context, std::shared_ptr<VROJobSystem> &jobs);
+    
+    /*
+     Render this portal's background and contents from the camera of the given
+     context, for a secondary view. The visible nodes are culled to the camera's
+     frustum and to the given view bit mask, then sorted into the given keys using
+     the given sorter, which each view retains across frames. Nested portals are
+     not rendered.
+     */
+    void renderView(const VRORenderContext &context, std::shared_ptr<VRODriver> &driver,
+                    int viewBitMask, bool renderBackground, bool renderTransparency,
+                    std::vector<VROSortKey> &keys, VROSortKeySorter &sorter);
     
     /*
      Represents how how many levels deep this portal is: for example, the active portal
@@ -169,6 +266,47 @@ public:
      */
     bool intersectsLineSegment(VROLineSegment segment) const;
     
+#pragma mark - Render to Texture
+    
+    /*
+     Set how the contents of this portal are rendered. See VROPortalRenderMode.
+     The resolution scale is the size of the offscreen texture relative to the
+     portal's screen-space bounds, when rendering to texture.
+     */
+    void setRenderMode(VROPortalRenderMode mode) {
+        _renderMode = mode;
+    }
+    VROPortalRenderMode getRenderMode() const {
+        return _renderMode;
+    }
+    void setTextureResolutionScale(float scale) {
+        _textureResolutionScale = scale;
+    }
+    float getTextureResolutionScale() const {
+        return _textureResolutionScale;
+    }
+    
+    /*
+     Return true if the contents of this portal should be rendered to texture
+     for the current frame and eye.
+     */
+    bool isRenderingToTexture(const VRORenderContext &context) const;
+    
+    /*
+     Render the background and contents of this portal into its offscreen texture
+     for the current eye, if the texture is due for a refresh. The given render
+     target is then re-bound, with its contents preserved.
+     */
+    void updateContentsTexture(std::shared_ptr<VRORenderTarget> &target,
+                               const VRORenderContext &context, std::shared_ptr<VRODriver> &driver);
+    
+    /*
+     Composite the offscreen texture of the current eye onto the bound render
+     target. The caller sets the stencil test that confines the texture to
+     this portal.
+     */
+    void renderContentsTexture(const VRORenderContext &context, std::shared_ptr<VRODriver> &driver);
+    
 #pragma mark - Environment Lighting
     
     /*
@@ -181,11 +319,21 @@ public:
      */
     std::shared_ptr<VROTexture> getLightingEnvironment() const;
     
+    /*
+     Set spherical harmonics describing the ambient light around this portal,
+     such as those estimated by an AR session. These light objects using the
+     physically based lighting model when the portal has no lighting environment,
+     and are only used when spherical harmonics irradiance is enabled in the
+     VRORendererConfiguration.
+     */
+    void setAmbientSphericalHarmonics(std::shared_ptr<VROSphericalHarmonics> sh);
+    std::shared_ptr<VROSphericalHarmonics> getAmbientSphericalHarmonics() const;
+    
 #pragma mark - Backgrounds
     
     /*
-     Note: the scene renders all backgrounds in its tree before rendering
-     any content.
+     Note: the scene renders all backgrounds in its tree after its opaque
+     content, and before its transparent content.
      */
     
     /*
@@ -202,9 +350,10 @@ public:
     
     /*
      Set the background to an arbitrary geometry. All this guarantees is that
-     the given object will be rendered first. No properties will be set on
-     this geometry, but typically background geometries are screen-space, and
-     do not read or write to the depth buffer.
+     the given object will be rendered behind the contents: it is pushed to the
+     far plane and rendered after the opaque contents. No other properties will
+     be set on this geometry, but typically background geometries are screen-space,
+     and do not write to the depth buffer.
      */
     void setBackground(std::shared_ptr<VROGeometry> geometry);
     
@@ -220,6 +369,19 @@ public:
     }
     void removeBackground();
     
+    /*
+     Render the background at half resolution, and composite it upscaled. This
+     quarters the cost of shading the background, at the expense of sharpness, so
+     it suits blurry or low frequency environments. Not supported with multiview
+     rendering, where the background is rendered at full resolution.
+     */
+    void setBackgroundHalfResolution(bool enabled) {
+        _backgroundHalfResolution = enabled;
+    }
+    bool isBackgroundHalfResolution() const {
+        return _backgroundHalfResolution;
+    }
+    
 private:
     
     /*
@@ -227,12 +389,66 @@ private:
      */
     int _recursionLevel;
     
+    /*
+     The screen-space bounds of this portal for the current frame, in normalized
+     device coordinates. When these are narrower than the screen, the contents
+     of the portal are culled against _contentFrustum, the camera frustum
+     narrowed to these bounds.
+     */
+    VROVector4f _screenBounds;
+    bool _cullsContents;
+    VROFrustum _contentFrustum;
+    VROVector3f _contentCullingCamera;
+    
+    /*
+     True if the alpha blended keys of this portal are accumulated instead of sorted
+     this frame (see getAccumulatesTransparency).
+     */
+    bool _accumulatesTransparency;
+    
+    /*
+     Compute the screen-space bounds of the given portal frame, clipped to the
+     given bounds. Returns false if the frame is not visible within them.
+     */
+    static bool computeScreenBounds(const std::shared_ptr<VROPortalFrame> &frame, const VRORenderContext &context,
+                                    const VROVector4f &clipBounds, VROVector4f *outBounds);
+    
+    /*
+     Render mode, and the offscreen texture of each eye when rendering to
+     texture. The bounds and camera position are those of the last refresh;
+     the texture is composited at those bounds until it is next refreshed.
+     */
+    VROPortalRenderMode _renderMode;
+    float _textureResolutionScale;
+    struct VROPortalContentsTexture {
+        std::shared_ptr<VRORenderTarget> target;
+        VROVector4f bounds;
+        VROVector3f cameraPosition;
+        int lastRefreshFrame = -1;
+        int lastUsedFrame = -1;
+    };
+    VROPortalContentsTexture _contentsTextures[3];
+    VROVector4f _compositeBounds;
+    std::shared_ptr<VROImagePostProcess> _contentsCompositor;
+    
     /*
      The nodes in this portal's scene-graph, ordered for rendering by their
      sort keys.
      */
     std::vector<VROSortKey> _keys;
     
+    /*
+     The number of leading opaque keys in _keys, after which the background is
+     rendered. This never splits a hierarchy, as a hierarchy's depth is written
+     only once the whole hierarchy is rendered.
+     */
+    size_t _opaqueKeyCount;
+    
+    /*
+     Sorts _keys, retaining the sort order across frames.
+     */
+    VROSortKeySorter _keySorter;
+    
     /*
      True if this portal can be entered; e.g, if it can be made into an
      active portal.
@@ -274,17 +490,36 @@ private:
     std::shared_ptr<VROPortalFrame> _activePortalFrame;
     
     /*
-     The background visual to display. All backgrounds in the scene are rendered before
-     node content.
+     The background visual to display. All backgrounds in the scene are rendered after
+     the opaque node content, so they are only shaded where uncovered.
      */
     std::shared_ptr<VROGeometry> _background;
     
+    /*
+     When rendering the background at half resolution, the texture of each eye it's
+     rendered into, and the far plane quad that composites it. The texture is only
+     composited in the frame it was rendered.
+     */
+    bool _backgroundHalfResolution;
+    struct VROPortalBackgroundTexture {
+        std::shared_ptr<VRORenderTarget> target;
+        std::shared_ptr<VROGeometry> compositor;
+        int lastRefreshFrame = -1;
+    };
+    VROPortalBackgroundTexture _backgroundTextures[3];
+    
     /*
      The lighting environment for this portal. Determines the effect of image-based
      lighting (IBL) for objects using the physically based lighting model.
      */
     std::shared_ptr<VROTexture> _lightingEnvironment;
     
+    /*
+     Ambient spherical harmonics used in place of the lighting environment when it's
+     not set.
+     */
+    std::shared_ptr<VROSphericalHarmonics> _ambientSphericalHarmonics;
+    
     /*
       Portal delegate that is invoked when a portal is entered and exited.
      */
@@ -304,15 +539,16 @@ private:
      Deactivates culling on every geometry in the given node, recursively down the
      tree. Needed to ensure culling is off on portal frames.
      */
-    void deactivateCulling(std::shared_ptr<VRONode> node);
+    void deactivateCulling(const std::shared_ptr<VRONode> &node);
 
     /*
-     Write the hierarchy parent represented by the given sort key to the depth buffer
-     (only).
+     Write the hierarchy parents represented by the given sort keys to the depth
+     buffer (only). Parents without shader modifiers are written in a batch with
+     depth-only materials.
      */
-    void writeHierarchyParentToDepthBuffer(VROSortKey &hierarchyParent,
-                                           const VRORenderContext &context,
-                                           std::shared_ptr<VRODriver> &driver);
+    void writeHierarchyParentsToDepthBuffer(const std::vector<VROSortKey *> &hierarchyParents,
+                                            const VRORenderContext &context,
+                                            std::shared_ptr<VRODriver> &driver);
     
 };
 
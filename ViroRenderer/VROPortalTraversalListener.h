@@ -44,6 +44,7 @@ public:
     
     void onFrameWillRender(const VRORenderContext &context);
     void onFrameDidRender(const VRORenderContext &context);
+    const char *getFrameListenerName() const { return "portalTraversal"; }
     
 private:
     
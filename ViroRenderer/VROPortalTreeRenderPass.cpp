@@ -37,13 +37,29 @@
 #include "VROPortalFrame.h"
 #include "VROOpenGL.h" // For pglpush and pop
 #include "VROShadowMapRenderPass.h" // For drawing light frustra
+#include "VROProfiler.h"
+#include "VROOcclusionCuller.h"
+#include "VROEye.h"
 
-VROPortalTreeRenderPass::VROPortalTreeRenderPass() {
+VROPortalTreeRenderPass::VROPortalTreeRenderPass() :
+    _measuringOverdraw(false) {
     _silhouetteMaterial = std::make_shared<VROMaterial>();
     _silhouetteMaterial->setWritesToDepthBuffer(false);
     _silhouetteMaterial->setReadsFromDepthBuffer(false);
     _silhouetteMaterial->setCullMode(VROCullMode::None);
     _silhouetteMaterial->addShaderModifier(VROPortalFrame::getAlphaDiscardModifier());
+
+    // The depth pre-pass shares the constant depth-writing shader used by shadow maps
+    VROCullMode cullModes[] = { VROCullMode::Back, VROCullMode::Front, VROCullMode::None };
+    for (VROCullMode cullMode : cullModes) {
+        std::shared_ptr<VROMaterial> material = std::make_shared<VROMaterial>();
+        material->setLightingModel(VROLightingModel::Constant);
+        material->setWritesToDepthBuffer(true);
+        material->setReadsFromDepthBuffer(true);
+        material->setCullMode(cullMode);
+        material->addShaderModifier(VROShadowMapRenderPass::getShadowDepthWritingModifier());
+        _depthPrepassMaterials[(int) cullMode] = material;
+    }
 }
 
 VROPortalTreeRenderPass::~VROPortalTreeRenderPass() {
@@ -58,37 +74,84 @@ void VROPortalTreeRenderPass::render(std::shared_ptr<VROScene> scene,
     std::shared_ptr<VRORenderTarget> target = inputs.outputTarget;
     passert (target);
     
-    driver->bindRenderTarget(target, VRORenderTargetUnbindOp::Invalidate);
+    driver->bindRenderTarget(target, VRORenderTargetActions::clearAll(), VRORenderTargetUnbindOp::Invalidate);
     driver->setRenderTargetColorWritingMask(VROColorMaskAll);
 
+    bool measureOverdraw = VROProfiler::isEnabled();
+    _measuringOverdraw = measureOverdraw;
+    if (measureOverdraw) {
+        driver->beginOverdrawQuery(target->getWidth() * target->getHeight());
+    }
+
     // Get the top portal for the outgoing tree if we have an outgoing scene; this
     // way we can render the background of the outgoing scene with the background
     // of the regular scene, preventing blending artifacts during transitions
-    std::vector<tree<std::shared_ptr<VROPortal>>> outgoingTreeNodes;
+    //
+    // The portal trees are rendered in place: they're rebuilt by the scenes each
+    // frame, so there's no need to copy them (and every portal reference) here
     std::shared_ptr<VROPortal> outgoingTopPortal;
     if (outgoingScene) {
-        outgoingTreeNodes.push_back(outgoingScene->getPortalTree());
-        if (!outgoingTreeNodes.empty()) {
-            outgoingTopPortal = outgoingTreeNodes.front().value;
-        }
+        outgoingTopPortal = outgoingScene->getPortalTree().value;
     }
 
     // Render the regular scene; if an outgoing scene is present this will render
     // its top-level background as well
-    std::vector<tree<std::shared_ptr<VROPortal>>> treeNodes;
-    treeNodes.push_back(scene->getPortalTree());
-    render(treeNodes, outgoingTopPortal, true, target, *context, driver);
+    const tree<std::shared_ptr<VROPortal>> &portalTree = scene->getPortalTree();
+    render(&portalTree, 1, outgoingTopPortal, true, target, *context, driver);
 
     // Render the outgoing scene (if available). The outgoing scene is rendered
     // without backgrounds here
     if (outgoingScene) {
-        render(outgoingTreeNodes, nullptr, false, target, *context, driver);
+        render(&outgoingScene->getPortalTree(), 1, nullptr, false, target, *context, driver);
+    }
+    
+    // Accumulate the order independent transparency of the root portals, now that
+    // all opaque depth is in place
+    if (context->isOrderIndependentTransparencyEnabled()) {
+        std::vector<std::shared_ptr<VROPortal>> rootPortals = { portalTree.value };
+        if (outgoingTopPortal) {
+            rootPortals.push_back(outgoingTopPortal);
+        }
+        renderTransparencyAccumulation(rootPortals, target, *context, driver);
+    }
+    if (measureOverdraw) {
+        driver->endOverdrawQuery();
     }
+    _measuringOverdraw = false;
 
     // Render the pencil
     context->getPencil()->render(*context, driver);
 }
 
+void VROPortalTreeRenderPass::renderTransparencyAccumulation(std::vector<std::shared_ptr<VROPortal>> &rootPortals,
+                                                             std::shared_ptr<VRORenderTarget> &target,
+                                                             const VRORenderContext &context,
+                                                             std::shared_ptr<VRODriver> &driver) {
+    if (!target->bindTransparencyAccumulation()) {
+        pwarn("Order independent transparency is not supported by the target: transparent objects will not render");
+        return;
+    }
+    pglpush("Transparency Accumulation");
+    
+    VRORenderContext accumulationContext = context;
+    accumulationContext.setAccumulatingTransparency(true);
+    
+    // The root portal covers every stencil region, so accumulated fragments are
+    // confined only by the depth of the opaque contents (including portal frames)
+    target->disablePortalStencilWriting(VROFace::FrontAndBack);
+    target->setPortalStencilPassFunction(VROFace::FrontAndBack, VROStencilFunc::LessOrEqual, 0);
+    for (std::shared_ptr<VROPortal> &portal : rootPortals) {
+        if (portal && portal->getAccumulatesTransparency()) {
+            portal->renderContents(accumulationContext, driver);
+        }
+    }
+    driver->unbindShader();
+    driver->setBlendingMode(VROBlendMode::Alpha);
+    
+    target->unbindTransparencyAccumulation();
+    pglpop();
+}
+
 // The key to this algorithm is we render depth-first. That is, we funnel down
 // the tree, rendering portal silhouettes to the stencil buffer; then we unwind
 // back up the tree, rendering the portal content. Only *then* do we move
@@ -97,8 +160,8 @@ void VROPortalTreeRenderPass::render(std::shared_ptr<VROScene> scene,
 // traces of the prior sibling should be gone. This ensures siblings don't bleed
 // into each other (e.g. that an over-size object from one portal doesn't appear
 // in any of its siblings).
-void VROPortalTreeRenderPass::render(std::vector<tree<std::shared_ptr<VROPortal>>> &treeNodes,
-                                     std::shared_ptr<VROPortal> outgoingTopPortal, bool renderBackgrounds,
+void VROPortalTreeRenderPass::render(const tree<std::shared_ptr<VROPortal>> *treeNodes, size_t numTreeNodes,
+                                     const std::shared_ptr<VROPortal> &outgoingTopPortal, bool renderBackgrounds,
                                      std::shared_ptr<VRORenderTarget> &target,
                                      const VRORenderContext &context,
                                      std::shared_ptr<VRODriver> &driver) {
@@ -108,9 +171,9 @@ void VROPortalTreeRenderPass::render(std::vector<tree<std::shared_ptr<VROPortal>
     // portal are written to the depth buffer *before* the portals behind them are
     // rendered. Otherwise blending would cause portals on the same recursion level
     // to appear through one another.
-    int i = 0;
-    for (tree<std::shared_ptr<VROPortal>> &treeNode : treeNodes) {
-        std::shared_ptr<VROPortal> &portal = treeNode.value;
+    for (int i = 0; i < numTreeNodes; i++) {
+        const tree<std::shared_ptr<VROPortal>> &treeNode = treeNodes[i];
+        const std::shared_ptr<VROPortal> &portal = treeNode.value;
         
         const std::shared_ptr<VROPortalFrame> &portalFrame = portal->getActivePortalFrame();
         bool isExit = portal->isRenderingExitFrame();
@@ -146,8 +209,12 @@ void VROPortalTreeRenderPass::render(std::vector<tree<std::shared_ptr<VROPortal>
         
         // Recurse down to children. This way we continue rendering portal
         // silhouettes (of children, not siblings) before moving on to rendering
-        // actual content.
-        render(treeNode.children, nullptr, true, target, context, driver);
+        // actual content. Portals rendered to texture render only their own
+        // contents, so their children are skipped.
+        bool renderToTexture = portal->isRenderingToTexture(context);
+        if (!renderToTexture) {
+            render(treeNode.children.data(), treeNode.children.size(), nullptr, true, target, context, driver);
+        }
         
         // Now we're unwinding from recursion, prepare for scene rendering.
         pglpush("Contents");
@@ -166,13 +233,77 @@ void VROPortalTreeRenderPass::render(std::vector<tree<std::shared_ptr<VROPortal>
         //    belonging to level 1.
         target->setPortalStencilPassFunction(VROFace::FrontAndBack, VROStencilFunc::LessOrEqual,
                                              portal->getRecursionLevel());
-        if (renderBackgrounds) {
+        
+        // Composite the portal's offscreen texture in place of its contents. Refreshing
+        // the texture re-binds the target, resetting its stencil state
+        if (renderToTexture) {
+            portal->updateContentsTexture(target, context, driver);
+            target->disablePortalStencilWriting(VROFace::FrontAndBack);
+            target->setPortalStencilPassFunction(VROFace::FrontAndBack, VROStencilFunc::LessOrEqual,
+                                                 portal->getRecursionLevel());
+            portal->renderContentsTexture(context, driver);
+        }
+        
+        // Backgrounds rendered at half resolution are rendered offscreen first, and
+        // composited in place of the background. This too re-binds the target
+        bool renderBackgroundsInline = renderBackgrounds && !renderToTexture;
+        if (renderBackgroundsInline) {
             if (outgoingTopPortal != nullptr && i == 0) {
-                outgoingTopPortal->renderBackground(context, driver);
+                outgoingTopPortal->updateBackgroundTexture(target, context, driver);
+            }
+            portal->updateBackgroundTexture(target, context, driver);
+            target->disablePortalStencilWriting(VROFace::FrontAndBack);
+            target->setPortalStencilPassFunction(VROFace::FrontAndBack, VROStencilFunc::LessOrEqual,
+                                                 portal->getRecursionLevel());
+        }
+
+        // Lay down the depth of the opaque contents first, so that the color pass only
+        // shades visible fragments
+        //
+        // Occlusion queries test against this depth, so the pre-pass is forced on
+        // when they're issued. They are restricted to monocular rendering of a
+        // scene without portals: the queries' results must come from a single
+        // view of a single stencil region to carry across frames
+        std::shared_ptr<VROOcclusionCuller> occlusionCuller = context.getOcclusionCuller();
+        bool testOcclusion = occlusionCuller && renderBackgrounds && outgoingTopPortal == nullptr &&
+                             portal->getRecursionLevel() == 0 && numTreeNodes == 1 &&
+                             treeNode.children.empty() && context.getEyeType() == VROEyeType::Monocular;
+        
+        VRODepthPrepassMode prepassMode = context.getDepthPrepassMode();
+        if (!renderToTexture &&
+           (testOcclusion || prepassMode == VRODepthPrepassMode::Enabled ||
+           (prepassMode == VRODepthPrepassMode::Automatic && portal->isDepthPrepassBeneficial()))) {
+            pglpush("Depth Pre-pass");
+            driver->setRenderTargetColorWritingMask(VROColorMaskNone);
+            portal->renderDepthPrepass(_depthPrepassMaterials, context, driver);
+            
+            // Occlusion query samples are not shaded, so they're excluded from the
+            // overdraw measurement
+            if (testOcclusion) {
+                if (_measuringOverdraw) {
+                    driver->endOverdrawQuery();
+                }
+                occlusionCuller->issueQueries(portal.get(), context, driver);
+                if (_measuringOverdraw) {
+                    driver->beginOverdrawQuery(0);
+                }
             }
-            portal->renderBackground(context, driver);
+            driver->setRenderTargetColorWritingMask(VROColorMaskAll);
+            pglpop();
+        }
+        
+        // Backgrounds are pinned to the far plane, and are rendered after the opaque
+        // contents so that the depth test rejects them wherever they're covered
+        if (!renderToTexture) {
+            portal->renderContents(context, driver, [&] {
+                if (renderBackgroundsInline) {
+                    if (outgoingTopPortal != nullptr && i == 0) {
+                        outgoingTopPortal->renderBackground(context, driver);
+                    }
+                    portal->renderBackground(context, driver);
+                }
+            });
         }
-        portal->renderContents(context, driver);
         driver->unbindShader();
         pglpop();
         
@@ -208,7 +339,6 @@ void VROPortalTreeRenderPass::render(std::vector<tree<std::shared_ptr<VROPortal>
             pglpop();
         }
         
-        ++i;
         pglpop();
     }
 }
@@ -51,17 +51,39 @@ private:
      Material used to render silhouettes of objects to the scene.
      */
     std::shared_ptr<VROMaterial> _silhouetteMaterial;
+
+    /*
+     Materials used to render opaque objects to the depth buffer during the
+     depth pre-pass, one per VROCullMode.
+     */
+    std::shared_ptr<VROMaterial> _depthPrepassMaterials[3];
+
+    /*
+     True while the overdraw query is open for the current render.
+     */
+    bool _measuringOverdraw;
     
     /*
      Helper function for rendering. Performs depth-first rendering of portals, rendering
      the portal silhouettes to the stencil buffer on the way down, and the portal geometry
-     and content on the way up.
+     and content on the way up. The given tree nodes are siblings, stored
+     contiguously.
      */
-    void render(std::vector<tree<std::shared_ptr<VROPortal>>> &treeNodes,
-                std::shared_ptr<VROPortal> outgoingTopPortal, bool renderBackgrounds,
+    void render(const tree<std::shared_ptr<VROPortal>> *treeNodes, size_t numTreeNodes,
+                const std::shared_ptr<VROPortal> &outgoingTopPortal, bool renderBackgrounds,
                 std::shared_ptr<VRORenderTarget> &target,
                 const VRORenderContext &context,
                 std::shared_ptr<VRODriver> &driver);
+    
+    /*
+     Render the alpha blended contents of the given root portals into the target's
+     transparency accumulation buffers, for order independent transparency. These
+     are composited over the target by VROToneMappingRenderPass.
+     */
+    void renderTransparencyAccumulation(std::vector<std::shared_ptr<VROPortal>> &rootPortals,
+                                        std::shared_ptr<VRORenderTarget> &target,
+                                        const VRORenderContext &context,
+                                        std::shared_ptr<VRODriver> &driver);
 };
 
 #endif /* VROPortalTreeRenderPass_h */
@@ -30,52 +30,95 @@
 
 static const float kConfidenceThreshold = 0.15;
 
-float getCreationTime(const VROPoseFrame &frame) {
+#pragma mark - Pose Joints
+
+VROPoseJoints VROPoseJoints::fromPoseFrame(const VROPoseFrame &frame) {
+    VROPoseJoints joints;
+    for (int i = 0; i < kNumBodyJoints; i++) {
+        if (frame[i].empty()) {
+            continue;
+        }
+        const VROInferredBodyJoint &joint = frame[i][0];
+        if (joints.mask == 0) {
+            joints.creationTimeMs = joint.getCreationTime();
+        }
+        joints.setJoint(i, joint.getCenter(), joint.getConfidence(), joint.getCreationTime());
+    }
+    return joints;
+}
+
+VROPoseFrame VROPoseJoints::toPoseFrame() const {
+    VROPoseFrame frame = newPoseFrame();
     for (int i = 0; i < kNumBodyJoints; i++) {
-        if (!frame[i].empty()) {
-            return frame[i][0].getCreationTime();
+        if (!hasJoint(i)) {
+            continue;
+        }
+        VROInferredBodyJoint joint((VROBodyJointType) i);
+        joint.setCenter(getCenter(i));
+        joint.setConfidence(getConfidence(i));
+        frame[i] = { joint };
+    }
+    return frame;
+}
+
+#pragma mark - Pose History
+
+void VROPoseHistory::removePosesBefore(double timeMs) {
+    while (_count > 0 && _poses[_start].creationTimeMs < timeMs) {
+        _start = (_start + 1) % kMaxPoseHistory;
+        --_count;
+    }
+}
+
+void VROPoseHistory::removeJointsBefore(double timeMs) {
+    for (int i = 0; i < _count; i++) {
+        VROPoseJoints &pose = _poses[(_start + i) % kMaxPoseHistory];
+        for (int j = 0; j < kNumBodyJoints; j++) {
+            if (pose.hasJoint(j) && pose.creationTimesMs[j] < timeMs) {
+                pose.removeJoint(j);
+            }
         }
     }
-    return 0;
+    while (_count > 0 && _poses[_start].mask == 0) {
+        _start = (_start + 1) % kMaxPoseHistory;
+        --_count;
+    }
 }
 
+#pragma mark - Pose Filter
+
 VROPoseFrame VROPoseFilter::filterJoints(const VROPoseFrame &frame) {
-    VROPoseFrame newFrame = spatialFilter(_frames, _combinedFrame, frame);
+    VROPoseJoints filtered;
+    filterJoints(VROPoseJoints::fromPoseFrame(frame), &filtered);
+    return filtered.toPoseFrame();
+}
+
+void VROPoseFilter::filterJoints(const VROPoseJoints &joints, VROPoseJoints *outJoints) {
+    spatialFilter(_frames, _combinedFrames, joints, &_spatialFrame);
     
     double windowEnd = VROTimeCurrentMillis();
     double windowStart = windowEnd - _trackingPeriodMs;
     
-    // Remove old samples from the combined frame
-    for (int i = 0; i < kNumBodyJoints; i++) {
-        auto &joints = _combinedFrame[i];
-        joints.erase(std::remove_if(joints.begin(), joints.end(),
-                                    [windowStart](VROInferredBodyJoint &j) {
-                                        return j.getCreationTime() < windowStart;
-                                    }),
-                     joints.end());
-    }
-    
-    // Remove old frames
-    _frames.erase(std::remove_if(_frames.begin(), _frames.end(),
-                                 [windowStart](VROPoseFrame &f) {
-                                     return getCreationTime(f) < windowStart;
-                                 }),
-                  _frames.end());
+    // Remove old samples from the combined frames, and old frames
+    _combinedFrames.removeJointsBefore(windowStart);
+    _frames.removePosesBefore(windowStart);
     
-    // Update the frames vector, which contains all joints over time, organized
-    // by frame
-    _frames.push_back(newFrame);
+    // Update the frames window, which contains the spatially filtered joints over
+    // time. Empty frames contribute nothing to the filters, and are not kept
+    if (_spatialFrame.mask != 0) {
+        _frames.push(_spatialFrame);
+    }
     
-    // Update the combined frame, which contains all joints over time, organized
-    // by joint type
+    // Update the combined frames, which contain all confident joints received over time
+    VROPoseJoints confident = joints;
     for (int i = 0; i < kNumBodyJoints; i++) {
-        auto &kv = frame[i];
-        if (!kv.empty()) {
-            if (kv[0].getConfidence() > kConfidenceThreshold) {
-                _combinedFrame[i].push_back(kv[0]);
-            }
+        if (confident.hasJoint(i) && confident.getConfidence(i) <= kConfidenceThreshold) {
+            confident.removeJoint(i);
         }
     }
+    if (confident.mask != 0) {
+        _combinedFrames.push(confident);
+    }
     
-    return temporalFilter(_frames, _combinedFrame, newFrame);
+    temporalFilter(_frames, _combinedFrames, _spatialFrame, outJoints);
 }
@@ -30,6 +30,112 @@
 #include <map>
 #include "VROBodyTracker.h"
 
+/*
+ Four-wide float vector, operated on with the compiler's vector extensions.
+ */
+typedef float VROPoseVector __attribute__((__vector_size__(16)));
+
+/*
+ Fixed-size representation of a pose, holding at most one sample per joint,
+ indexed by VROBodyJointType. Each position holds the center of the joint in
+ xyz and its confidence in w, so a filter can update a joint's position and
+ confidence with a single vector operation. Joints that were not found have
+ their bit cleared in the mask. Filtering poses in this form requires no
+ allocation.
+ */
+struct VROPoseJoints {
+    VROPoseVector positions[kNumBodyJoints];
+    double creationTimesMs[kNumBodyJoints];
+    uint32_t mask;
+    
+    // Creation time of the first joint in the pose, or 0 if the pose is empty
+    double creationTimeMs;
+    
+    VROPoseJoints() : mask(0), creationTimeMs(0) {
+        // Absent joints are weighted by zero when filtering, so their lanes must
+        // hold finite values
+        for (int i = 0; i < kNumBodyJoints; i++) {
+            positions[i] = (VROPoseVector) { 0, 0, 0, 0 };
+            creationTimesMs[i] = 0;
+        }
+    }
+    
+    bool hasJoint(int joint) const {
+        return (mask >> joint) & 1;
+    }
+    void setJoint(int joint, VROVector3f center, float confidence, double creationTimeMs) {
+        positions[joint] = (VROPoseVector) { center.x, center.y, center.z, confidence };
+        creationTimesMs[joint] = creationTimeMs;
+        mask |= (1 << joint);
+    }
+    void setJoint(int joint, VROPoseVector position, double creationTimeMs) {
+        positions[joint] = position;
+        creationTimesMs[joint] = creationTimeMs;
+        mask |= (1 << joint);
+    }
+    void removeJoint(int joint) {
+        mask &= ~(1 << joint);
+    }
+    VROVector3f getCenter(int joint) const {
+        return { positions[joint][0], positions[joint][1], positions[joint][2] };
+    }
+    float getConfidence(int joint) const {
+        return positions[joint][3];
+    }
+    
+    /*
+     Conversion to and from the per-joint vectors delivered to
+     VROBodyTrackerDelegate. Only the first sample of each joint is kept.
+     */
+    static VROPoseJoints fromPoseFrame(const VROPoseFrame &frame);
+    VROPoseFrame toPoseFrame() const;
+};
+
+static const int kMaxPoseHistory = 64;
+
+/*
+ Fixed-capacity window of poses, ordered from oldest to newest. When the
+ window is full, pushing a pose overwrites the oldest.
+ */
+class VROPoseHistory {
+public:
+    
+    VROPoseHistory() : _start(0), _count(0) {}
+    
+    int size() const {
+        return _count;
+    }
+    const VROPoseJoints &operator[](int index) const {
+        return _poses[(_start + index) % kMaxPoseHistory];
+    }
+    
+    void push(const VROPoseJoints &pose) {
+        if (_count == kMaxPoseHistory) {
+            _start = (_start + 1) % kMaxPoseHistory;
+            --_count;
+        }
+        _poses[(_start + _count) % kMaxPoseHistory] = pose;
+        ++_count;
+    }
+    
+    /*
+     Remove the poses created before the given time.
+     */
+    void removePosesBefore(double timeMs);
+    
+    /*
+     Remove the individual joints created before the given time, and then
+     the poses left without joints.
+     */
+    void removeJointsBefore(double timeMs);
+    
+private:
+    
+    VROPoseJoints _poses[kMaxPoseHistory];
+    int _start, _count;
+    
+};
+
 /*
  Superclass for enabling spatial and temporal filtering of body pose data as
  received from an ML model. All data that passes the spatial filter is included
@@ -49,9 +155,7 @@ public:
      */
     VROPoseFilter(float trackingPeriodMs, float confidenceThreshold) :
         _trackingPeriodMs(trackingPeriodMs),
-        _confidenceThreshold(confidenceThreshold) {
-            _combinedFrame = newPoseFrame();
-        }
+        _confidenceThreshold(confidenceThreshold) {}
     virtual ~VROPoseFilter() {}
     
     /*
@@ -59,44 +163,54 @@ public:
      */
     VROPoseFrame filterJoints(const VROPoseFrame &frame);
     
+    /*
+     Filter a new set of joints into outJoints, without allocating.
+     */
+    void filterJoints(const VROPoseJoints &joints, VROPoseJoints *outJoints);
+    
 protected:
     
     /*
-     Apply a spatial filter to the given new frame of joints. All previous frames
-     are provided in pastFrames and combinedFrames. Combined frames contains the
-     same data as pastFrames, but with the pose structures flattened out.
+     Apply a spatial filter to the given new pose. All previous poses are provided
+     in pastFrames and combinedFrames. Combined frames contains the raw joints
+     received, keeping only those above the confidence threshold; pastFrames
+     contains the joints that passed the spatial filter.
      
-     When spatial filtering, neither pastFrames nor combinedFrame contain the newFrame.
+     When spatial filtering, neither pastFrames nor combinedFrames contain the newFrame.
      
-     Return a new frame with all spatially incoherent results thrown out. The returned
-     joints will be added to the tracking window for use in temporal filtering. Note
-     that joints that are thrown out will *not* be accessed by the temporal filter.
+     Write to outFrame the new pose with all spatially incoherent results thrown out.
+     The written joints will be added to the tracking window for use in temporal
+     filtering. Note that joints that are thrown out will *not* be accessed by the
+     temporal filter.
      
      The default behavior is to not do any spatial filtering (the provided newFrame
-     is returned).
+     is written).
      */
-    virtual VROPoseFrame spatialFilter(const std::vector<VROPoseFrame> &pastFrames, const VROPoseFrame &combinedFrame,
-                                       const VROPoseFrame &newFrame) {
-        return newFrame;
+    virtual void spatialFilter(const VROPoseHistory &pastFrames, const VROPoseHistory &combinedFrames,
+                               const VROPoseJoints &newFrame, VROPoseJoints *outFrame) {
+        *outFrame = newFrame;
     }
     
     /*
-     Apply a temporal filter to the given new frame of joints. All previous frames,
-     *including the new frame*, are provided in frames and combinedFrames.
-     Combined frames contains the same data as frames, but with the pose structures
-     flattened out.
+     Apply a temporal filter to the given new pose. All previous poses,
+     *including the new pose*, are provided in frames and combinedFrames.
      
-     Return the filtered joints.
+     Write the filtered joints to outFrame.
      */
-    virtual VROPoseFrame temporalFilter(const std::vector<VROPoseFrame> &frames, const VROPoseFrame &combinedFrame,
-                                        const VROPoseFrame &newFrame) = 0;
+    virtual void temporalFilter(const VROPoseHistory &frames, const VROPoseHistory &combinedFrames,
+                                const VROPoseJoints &newFrame, VROPoseJoints *outFrame) = 0;
     
 private:
     
     float _trackingPeriodMs;
     float _confidenceThreshold;
-    std::vector<VROPoseFrame> _frames;
-    VROPoseFrame _combinedFrame;
+    VROPoseHistory _frames;
+    VROPoseHistory _combinedFrames;
+    
+    /*
+     The result of the spatial filter for the current frame.
+     */
+    VROPoseJoints _spatialFrame;
     
 };
 
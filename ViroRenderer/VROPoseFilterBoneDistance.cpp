@@ -37,10 +37,10 @@ static const float kAnomalyDegrees = 45;
 std::vector<std::pair<int, int>> kPoseFilterSkeleton = {{0, 1}, {1, 5}, {5, 6}, {6, 7}, {1, 2},
     {2, 3}, {3, 4}, {1, 14}, {14, 15}, {15, 11}, {11, 12}, {12, 13}, {15, 8}, {8, 9}, {9, 10}};
 
-VROPoseFrame VROPoseFilterBoneDistance::spatialFilter(const std::vector<VROPoseFrame> &pastFrames, const VROPoseFrame &combinedFrame,
-                                                      const VROPoseFrame &newFrame) {
+void VROPoseFilterBoneDistance::spatialFilter(const VROPoseHistory &pastFrames, const VROPoseHistory &combinedFrames,
+                                              const VROPoseJoints &newFrame, VROPoseJoints *outFrame) {
     
-    VROPoseFrame filteredFrame = newPoseFrame();
+    *outFrame = newFrame;
     for (int i = 0; i < kNumBodyJoints; i++) {
         VROBodyJointType type = (VROBodyJointType) i;
         
@@ -59,9 +59,10 @@ VROPoseFrame VROPoseFilterBoneDistance::spatialFilter(const std::vector<VROPoseF
                 float distanceHipAnkleY = fabs(hipPosition.y - anklePosition.y);
                 
                 if (distanceHipKneeX < distanceHipAnkleY * kKneeAnomalyThreshold) {
-                    filteredFrame[i] = newFrame[i];
+                    continue;
                 }
             }
+            outFrame->removeJoint(i);
         }
         else if (type == VROBodyJointType::RightKnee) {
             VROVector3f hipPosition   = getJointPosition(newFrame, VROBodyJointType::RightHip);
@@ -73,22 +74,17 @@ VROPoseFrame VROPoseFilterBoneDistance::spatialFilter(const std::vector<VROPoseF
                 float distanceHipAnkleY = fabs(hipPosition.y - anklePosition.y);
                 
                 if (distanceHipKneeX < distanceHipAnkleY * kKneeAnomalyThreshold) {
-                    filteredFrame[i] = newFrame[i];
+                    continue;
                 }
             }
-        }
-        else {
-            filteredFrame[i] = newFrame[i];
+            outFrame->removeJoint(i);
         }
     }
-
-    return filteredFrame;
 }
 
-VROPoseFrame VROPoseFilterBoneDistance::temporalFilter(const std::vector<VROPoseFrame> &frames, const VROPoseFrame &combinedFrame,
-                                                       const VROPoseFrame &newFrame) {
-    VROPoseFrame filteredFrame = newPoseFrame();
-    std::vector<bool> discarded(kNumBodyJoints, false);
+void VROPoseFilterBoneDistance::temporalFilter(const VROPoseHistory &frames, const VROPoseHistory &combinedFrames,
+                                               const VROPoseJoints &newFrame, VROPoseJoints *outFrame) {
+    bool discarded[kNumBodyJoints] = { false };
     
     for (std::pair<int, int> limb : kPoseFilterSkeleton) {
         VROBodyJointType jointA = (VROBodyJointType) limb.first;
@@ -129,21 +125,21 @@ VROPoseFrame VROPoseFilterBoneDistance::temporalFilter(const std::vector<VROPose
         }
     }
     
+    *outFrame = newFrame;
     for (int i = 0; i < kNumBodyJoints; i++) {
-        if (!discarded[i]) {
-            filteredFrame[i] = newFrame[i];
+        if (discarded[i]) {
+            outFrame->removeJoint(i);
         }
     }
-    return filteredFrame;
 }
 
-float VROPoseFilterBoneDistance::getAverageLimbLength(const std::vector<VROPoseFrame> &frames,
+float VROPoseFilterBoneDistance::getAverageLimbLength(const VROPoseHistory &frames,
                                                       VROBodyJointType jointA, VROBodyJointType jointB) {
     float sumDistance = 0;
     int numFramesWithBothJoints = 0;
     
-    for (const VROPoseFrame &frame : frames) {
-        float length = getLimbLength(frame, jointA, jointB);
+    for (int i = 0; i < frames.size(); i++) {
+        float length = getLimbLength(frames[i], jointA, jointB);
         if (length > 0) {
             sumDistance += length;
             numFramesWithBothJoints++;
@@ -156,43 +152,28 @@ float VROPoseFilterBoneDistance::getAverageLimbLength(const std::vector<VROPoseF
     }
 }
 
-float VROPoseFilterBoneDistance::getLimbLength(const VROPoseFrame &frame,
+float VROPoseFilterBoneDistance::getLimbLength(const VROPoseJoints &frame,
                                                VROBodyJointType jointA, VROBodyJointType jointB) {
-    auto &samplesA = frame[(int) jointA];
-    auto &samplesB = frame[(int) jointB];
-    
-    size_t numSamples = std::min(samplesA.size(), samplesB.size());
-    if (numSamples == 0) {
+    if (!frame.hasJoint((int) jointA) || !frame.hasJoint((int) jointB)) {
         return 0;
     }
-    
-    float sumDistance = 0;
-    for (size_t i = 0; i < numSamples; i++) {
-        sumDistance += samplesA[i].getCenter().distance(samplesB[i].getCenter());
-    }
-    return sumDistance / (float) numSamples;
+    return frame.getCenter((int) jointA).distance(frame.getCenter((int) jointB));
 }
 
-VROVector3f VROPoseFilterBoneDistance::getJointPosition(const VROPoseFrame &frame, VROBodyJointType joint) {
-    auto &samples = frame[(int) joint];
-    if (samples.empty()) {
+VROVector3f VROPoseFilterBoneDistance::getJointPosition(const VROPoseJoints &frame, VROBodyJointType joint) {
+    if (!frame.hasJoint((int) joint)) {
         return {};
     }
-    
-    VROVector3f sumPosition;
-    for (const VROInferredBodyJoint &sample : samples) {
-        sumPosition += sample.getCenter();
-    }
-    return sumPosition / (float) samples.size();
+    return frame.getCenter((int) joint);
 }
 
-VROVector3f VROPoseFilterBoneDistance::getAverageLimbDirection(const std::vector<VROPoseFrame> &frames,
+VROVector3f VROPoseFilterBoneDistance::getAverageLimbDirection(const VROPoseHistory &frames,
                                                                VROBodyJointType jointA, VROBodyJointType jointB) {
     VROVector3f sumDirections;
     int numFramesWithBothJoints = 0;
     
-    for (const VROPoseFrame &frame : frames) {
-        VROVector3f direction = getLimbDirection(frame, jointA, jointB);
+    for (int i = 0; i < frames.size(); i++) {
+        VROVector3f direction = getLimbDirection(frames[i], jointA, jointB);
         if (!direction.isZero()) {
             sumDirections += direction;
             numFramesWithBothJoints++;
@@ -205,15 +186,10 @@ VROVector3f VROPoseFilterBoneDistance::getAverageLimbDirection(const std::vector
     }
 }
 
-VROVector3f VROPoseFilterBoneDistance::getLimbDirection(const VROPoseFrame &frame, VROBodyJointType jointA, VROBodyJointType jointB) {
-    auto &samplesA = frame[(int) jointA];
-    if (samplesA.empty()) {
-        return {};
-    }
-    auto &samplesB = frame[(int) jointB];
-    if (samplesB.empty()) {
+VROVector3f VROPoseFilterBoneDistance::getLimbDirection(const VROPoseJoints &frame, VROBodyJointType jointA, VROBodyJointType jointB) {
+    if (!frame.hasJoint((int) jointA) || !frame.hasJoint((int) jointB)) {
         return {};
     }
-    return (samplesB.front().getCenter() - samplesA.front().getCenter()).normalize();
+    return (frame.getCenter((int) jointB) - frame.getCenter((int) jointA)).normalize();
 }
 
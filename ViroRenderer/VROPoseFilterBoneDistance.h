@@ -44,18 +44,18 @@ public:
         VROPoseFilter(trackingPeriodMs, confidenceThreshold) {}
     virtual ~VROPoseFilterBoneDistance() {}
     
-    VROPoseFrame spatialFilter(const std::vector<VROPoseFrame> &frames, const VROPoseFrame &combinedFrame,
-                               const VROPoseFrame &newFrame);
-    VROPoseFrame temporalFilter(const std::vector<VROPoseFrame> &frames, const VROPoseFrame &combinedFrame,
-                                const VROPoseFrame &newFrame);
+    void spatialFilter(const VROPoseHistory &pastFrames, const VROPoseHistory &combinedFrames,
+                       const VROPoseJoints &newFrame, VROPoseJoints *outFrame);
+    void temporalFilter(const VROPoseHistory &frames, const VROPoseHistory &combinedFrames,
+                        const VROPoseJoints &newFrame, VROPoseJoints *outFrame);
 
 private:
     
-    VROVector3f getJointPosition(const VROPoseFrame &frame, VROBodyJointType joint);
-    float getAverageLimbLength(const std::vector<VROPoseFrame> &frames, VROBodyJointType jointA, VROBodyJointType jointB);
-    float getLimbLength(const VROPoseFrame &frame, VROBodyJointType jointA, VROBodyJointType jointB);
-    VROVector3f getLimbDirection(const VROPoseFrame &frame, VROBodyJointType jointA, VROBodyJointType jointB);
-    VROVector3f getAverageLimbDirection(const std::vector<VROPoseFrame> &frames, VROBodyJointType jointA, VROBodyJointType jointB);
+    VROVector3f getJointPosition(const VROPoseJoints &frame, VROBodyJointType joint);
+    float getAverageLimbLength(const VROPoseHistory &frames, VROBodyJointType jointA, VROBodyJointType jointB);
+    float getLimbLength(const VROPoseJoints &frame, VROBodyJointType jointA, VROBodyJointType jointB);
+    VROVector3f getLimbDirection(const VROPoseJoints &frame, VROBodyJointType jointA, VROBodyJointType jointB);
+    VROVector3f getAverageLimbDirection(const VROPoseHistory &frames, VROBodyJointType jointA, VROBodyJointType jointB);
     
 };
 
@@ -49,15 +49,34 @@
 static const double kEuroBeta = 1.0;
 static const double kEuroFCMin = 1.7;
 
+static const double kEuroDCutoff = 1.0;
+static const double kEuroInitialFrequency = 60;
+static const double kFilterUndefinedTime = -1.0;
+
+// Only the xyz lanes hold position; confidence (in w) is not filtered
+static const VROPoseVector kPositionLanes = { 1, 1, 1, 0 };
+
+static inline float computeAlpha(double cutoff, double frequency) {
+    double te = 1.0 / frequency;
+    double tau = 1.0 / (2 * M_PI * cutoff);
+    return 1.0 / (1.0 + tau / te);
+}
+
 // -----------------------------------------------------------------
 
 VROPoseFilterEuro::VROPoseFilterEuro(float trackingPeriodMs, float confidenceThreshold) :
-    VROPoseFilter(trackingPeriodMs, confidenceThreshold) {
+    VROPoseFilter(trackingPeriodMs, confidenceThreshold),
+    _beta(kEuroBeta),
+    _fcMin(kEuroFCMin),
+    _dCutoff(kEuroDCutoff) {
     
-    double frequency = 60;
-    double dcutoff = 1.0;
     for (int i = 0; i < kNumBodyJoints; i++) {
-        _filters.push_back(std::make_shared<VROOneEuroFilter>(frequency, kEuroFCMin, kEuroBeta, dcutoff));
+        _lastRaw[i] = (VROPoseVector) { 0, 0, 0, 0 };
+        _lastFiltered[i] = (VROPoseVector) { 0, 0, 0, 0 };
+        _lastDerivative[i] = (VROPoseVector) { 0, 0, 0, 0 };
+        _frequencies[i] = kEuroInitialFrequency;
+        _lastTimestamps[i] = kFilterUndefinedTime;
+        _initialized[i] = false;
     }
 }
 
@@ -66,48 +85,76 @@ VROPoseFilterEuro::~VROPoseFilterEuro() {
 }
 
 void VROPoseFilterEuro::setBeta(float beta) {
-    for (int i = 0; i < kNumBodyJoints; i++) {
-        _filters[i]->setBeta(beta);
-    }
+    _beta = beta;
 }
 
 void VROPoseFilterEuro::setFCMin(float fcMin) {
-    for (int i = 0; i < kNumBodyJoints; i++) {
-        _filters[i]->setFCMin(fcMin);
-    }
+    _fcMin = fcMin;
 }
 
-VROPoseFrame VROPoseFilterEuro::temporalFilter(const std::vector<VROPoseFrame> &frames, const VROPoseFrame &combinedFrame,
-                                               const VROPoseFrame &newFrame) {
-    VROPoseFrame dampenedJoints = newPoseFrame();
+void VROPoseFilterEuro::temporalFilter(const VROPoseHistory &frames, const VROPoseHistory &combinedFrames,
+                                       const VROPoseJoints &newFrame, VROPoseJoints *outFrame) {
+    // Compute aggregate confidence of each joint over the window
+    float sumConfidences[kNumBodyJoints];
+    float counts[kNumBodyJoints];
     for (int i = 0; i < kNumBodyJoints; i++) {
-        VROBodyJointType type = (VROBodyJointType) i;
-        
-        // Compute filtered position
-        const std::vector<VROInferredBodyJoint> &samples = newFrame[i];
-        if (samples.empty()) {
+        sumConfidences[i] = 0;
+        counts[i] = 0;
+    }
+    for (int f = 0; f < combinedFrames.size(); f++) {
+        const VROPoseJoints &frame = combinedFrames[f];
+        for (int i = 0; i < kNumBodyJoints; i++) {
+            float present = (float) frame.hasJoint(i);
+            sumConfidences[i] += frame.positions[i][3] * present;
+            counts[i] += present;
+        }
+    }
+    
+    *outFrame = VROPoseJoints();
+    outFrame->creationTimeMs = newFrame.creationTimeMs;
+    
+    for (int i = 0; i < kNumBodyJoints; i++) {
+        if (!newFrame.hasJoint(i)) {
             continue;
         }
-        const VROInferredBodyJoint &sample = samples.front();
-        
-        VROVector3f filtered = _filters[i]->filter(sample.getCenter(), sample.getCreationTime() / 1000.0,
-                                                   false);
         
-        // Compute aggregate confidence
-        const std::vector<VROInferredBodyJoint> &confidenceSamples = combinedFrame[i];
-        if (confidenceSamples.empty()) {
-            continue;
+        // Update the sampling frequency based on timestamps
+        double timestamp = newFrame.creationTimesMs[i] / 1000.0;
+        if (_lastTimestamps[i] != kFilterUndefinedTime) {
+            _frequencies[i] = 1.0 / (timestamp - _lastTimestamps[i]);
         }
-        float sumConfidence = 0;
-        for (int i = 0; i < confidenceSamples.size(); i++) {
-            sumConfidence += confidenceSamples[i].getConfidence();
+        _lastTimestamps[i] = timestamp;
+        
+        // Compute filtered position
+        VROPoseVector value = newFrame.positions[i] * kPositionLanes;
+        VROPoseVector filtered = value;
+        
+        if (!isinf(_frequencies[i])) {
+            float frequency = _frequencies[i];
+            if (!_initialized[i]) {
+                _lastDerivative[i] = (VROPoseVector) { 0, 0, 0, 0 };
+                _lastFiltered[i] = value;
+                _initialized[i] = true;
+            } else {
+                // Estimate the current variation per second
+                VROPoseVector derivative = (value - _lastRaw[i]) * frequency;
+                _lastDerivative[i] += (derivative - _lastDerivative[i]) * computeAlpha(_dCutoff, frequency);
+                
+                // Update the cutoff frequency: this should increase as the variation increases
+                VROPoseVector d2 = _lastDerivative[i] * _lastDerivative[i];
+                double cutoff = _fcMin + _beta * sqrt(d2[0] + d2[1] + d2[2]);
+                
+                // Filter with the new alpha derived from the cutoff
+                _lastFiltered[i] += (value - _lastFiltered[i]) * computeAlpha(cutoff, frequency);
+            }
+            _lastRaw[i] = value;
+            filtered = _lastFiltered[i];
         }
         
-        VROInferredBodyJoint dampenedJoint(type);
-        dampenedJoint.setCenter(filtered);
-        dampenedJoint.setConfidence(sumConfidence / (float) confidenceSamples.size());
-        dampenedJoints[i] = { dampenedJoint };
+        if (counts[i] == 0) {
+            continue;
+        }
+        filtered[3] = sumConfidences[i] / counts[i];
+        outFrame->setJoint(i, filtered, newFrame.creationTimesMs[i]);
     }
-    
-    return dampenedJoints;
 }
@@ -36,8 +36,8 @@ public:
     VROPoseFilterEuro(float trackingPeriodMs, float confidenceThreshold);
     virtual ~VROPoseFilterEuro();
     
-    VROPoseFrame temporalFilter(const std::vector<VROPoseFrame> &frames, const VROPoseFrame &combinedFrame,
-                                const VROPoseFrame &newFrame);
+    void temporalFilter(const VROPoseHistory &frames, const VROPoseHistory &combinedFrames,
+                        const VROPoseJoints &newFrame, VROPoseJoints *outFrame);
     
     /*
      Set the parameters to use for *all* joints. See VROPoseFilterEuro.cpp top-notes
@@ -47,7 +47,25 @@ public:
     void setFCMin(float fcMin);
     
 private:
-    std::vector<std::shared_ptr<VROOneEuroFilter>> _filters;
+    
+    /*
+     1€ filter parameters, shared by all joints.
+     */
+    double _beta;
+    double _fcMin;
+    double _dCutoff;
+    
+    /*
+     Per-joint state of the 1€ filter (see VROOneEuroFilter), held in fixed
+     arrays so that every joint is filtered with vector operations over its
+     position and derivative.
+     */
+    VROPoseVector _lastRaw[kNumBodyJoints];
+    VROPoseVector _lastFiltered[kNumBodyJoints];
+    VROPoseVector _lastDerivative[kNumBodyJoints];
+    double _frequencies[kNumBodyJoints];
+    double _lastTimestamps[kNumBodyJoints];
+    bool _initialized[kNumBodyJoints];
     
 };
 
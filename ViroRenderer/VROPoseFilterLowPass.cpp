@@ -25,39 +25,55 @@
 //  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "VROPoseFilterLowPass.h"
+#include <algorithm>
 
-VROPoseFrame VROPoseFilterLowPass::temporalFilter(const std::vector<VROPoseFrame> &frames, const VROPoseFrame &combinedFrame,
-                                                  const VROPoseFrame &newFrame) {
-    VROPoseFrame dampenedJoints = newPoseFrame();
-    
+void VROPoseFilterLowPass::temporalFilter(const VROPoseHistory &frames, const VROPoseHistory &combinedFrames,
+                                          const VROPoseJoints &newFrame, VROPoseJoints *outFrame) {
+    float counts[kNumBodyJoints];
     for (int i = 0; i < kNumBodyJoints; i++) {
-        VROBodyJointType type = (VROBodyJointType) i;
-        
-        const std::vector<VROInferredBodyJoint> &samples = combinedFrame[i];
-        if (samples.empty()) {
-            continue;
+        counts[i] = 0;
+    }
+    for (int f = 0; f < combinedFrames.size(); f++) {
+        const VROPoseJoints &frame = combinedFrames[f];
+        for (int i = 0; i < kNumBodyJoints; i++) {
+            counts[i] += (float) frame.hasJoint(i);
         }
-        
-        float k = 2 / ((float) samples.size() + 1);
-        VROVector3f emaYesterday = samples[0].getCenter();
-        float sumConfidence = samples[0].getConfidence();
-        
-        // Exponentially weight towards the earliest data at the end of the array
-        // (Items at the front of the array are older).
-        for (int i = 1; i < samples.size(); i++) {
-            const VROInferredBodyJoint &sample = samples[i];
-            
-            VROVector3f emaToday = (sample.getCenter() * k) + (emaYesterday * (1 - k));
-            emaYesterday = emaToday;
+    }
+    
+    // Exponentially weight towards the latest data, at the end of the window
+    // (frames at the front are older). The first sample of each joint seeds its
+    // average with a weight of 1; absent joints have a weight of 0.
+    VROPoseVector emas[kNumBodyJoints];
+    float seen[kNumBodyJoints];
+    float sumConfidences[kNumBodyJoints];
+    float k[kNumBodyJoints];
+    for (int i = 0; i < kNumBodyJoints; i++) {
+        emas[i] = (VROPoseVector) { 0, 0, 0, 0 };
+        seen[i] = 0;
+        sumConfidences[i] = 0;
+        k[i] = 2 / (counts[i] + 1);
+    }
+    
+    for (int f = 0; f < combinedFrames.size(); f++) {
+        const VROPoseJoints &frame = combinedFrames[f];
+        for (int i = 0; i < kNumBodyJoints; i++) {
+            float present = (float) frame.hasJoint(i);
+            float weight = present * (seen[i] * k[i] + (1 - seen[i]));
             
-            sumConfidence += sample.getConfidence();
+            emas[i] += (frame.positions[i] - emas[i]) * weight;
+            sumConfidences[i] += frame.positions[i][3] * present;
+            seen[i] = std::max(seen[i], present);
         }
-        
-        VROInferredBodyJoint dampenedJoint(type);
-        dampenedJoint.setCenter(emaYesterday);
-        dampenedJoint.setConfidence(sumConfidence / (float) samples.size());
-        dampenedJoints[i] = { dampenedJoint };
     }
     
-    return dampenedJoints;
+    *outFrame = VROPoseJoints();
+    outFrame->creationTimeMs = newFrame.creationTimeMs;
+    for (int i = 0; i < kNumBodyJoints; i++) {
+        if (counts[i] == 0) {
+            continue;
+        }
+        VROPoseVector dampened = emas[i];
+        dampened[3] = sumConfidences[i] / counts[i];
+        outFrame->setJoint(i, dampened, newFrame.creationTimesMs[i]);
+    }
 }
@@ -26,33 +26,34 @@
 
 #include "VROPoseFilterMovingAverage.h"
 
-VROPoseFrame VROPoseFilterMovingAverage::temporalFilter(const std::vector<VROPoseFrame> &frames, const VROPoseFrame &combinedFrame,
-                                                        const VROPoseFrame &newFrame) {
-    VROPoseFrame dampenedJoints = newPoseFrame();
+void VROPoseFilterMovingAverage::temporalFilter(const VROPoseHistory &frames, const VROPoseHistory &combinedFrames,
+                                                const VROPoseJoints &newFrame, VROPoseJoints *outFrame) {
+    // Sum the position and confidence of every joint across the window. Absent
+    // joints are weighted by zero, so each frame is accumulated without branching
+    VROPoseVector sums[kNumBodyJoints];
+    float counts[kNumBodyJoints];
+    for (int i = 0; i < kNumBodyJoints; i++) {
+        sums[i] = (VROPoseVector) { 0, 0, 0, 0 };
+        counts[i] = 0;
+    }
+    
+    for (int f = 0; f < combinedFrames.size(); f++) {
+        const VROPoseJoints &frame = combinedFrames[f];
+        for (int i = 0; i < kNumBodyJoints; i++) {
+            float present = (float) frame.hasJoint(i);
+            sums[i] += frame.positions[i] * present;
+            counts[i] += present;
+        }
+    }
     
+    // Dividing the sums yields the average position in xyz and the average
+    // confidence in w
+    *outFrame = VROPoseJoints();
+    outFrame->creationTimeMs = newFrame.creationTimeMs;
     for (int i = 0; i < kNumBodyJoints; i++) {
-        VROBodyJointType type = (VROBodyJointType) i;
-        
-        const std::vector<VROInferredBodyJoint> &samples = combinedFrame[i];
-        if (samples.empty()) {
+        if (counts[i] == 0) {
             continue;
         }
-        
-        VROVector3f sumPosition;
-        float sumConfidence = 0;
-        for (const VROInferredBodyJoint &sample : samples) {
-            sumPosition += sample.getCenter();
-            sumConfidence += sample.getConfidence();
-        }
-        VROVector3f averagePosition = sumPosition / (float) samples.size();
-        float averageConfidence = sumConfidence / (float) samples.size();
-        
-        VROInferredBodyJoint dampenedJoint(type);
-        dampenedJoint.setCenter(averagePosition);
-        dampenedJoint.setConfidence(averageConfidence);
-        dampenedJoints[i] = { dampenedJoint };
+        outFrame->setJoint(i, sums[i] / counts[i], newFrame.creationTimesMs[i]);
     }
-    
-    return dampenedJoints;
 }
-
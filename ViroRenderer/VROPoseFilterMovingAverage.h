@@ -39,8 +39,8 @@ public:
         VROPoseFilter(trackingPeriodMs, confidenceThreshold) {}
     virtual ~VROPoseFilterMovingAverage() {}
     
-    virtual VROPoseFrame temporalFilter(const std::vector<VROPoseFrame> &frames, const VROPoseFrame &combinedFrame,
-                                        const VROPoseFrame &newFrame);
+    virtual void temporalFilter(const VROPoseHistory &frames, const VROPoseHistory &combinedFrames,
+                                const VROPoseJoints &newFrame, VROPoseJoints *outFrame);
 
 };
 
@@ -32,6 +32,8 @@
 #include "VROTime.h"
 #include "VROTexture.h"
 #include "VROGaussianBlurRenderPass.h"
+#include "VROToneMappingRenderPass.h"
+#include "VROProfiler.h"
 
 static thread_local std::shared_ptr<VROImagePostProcess> sGrayScale;
 static thread_local std::shared_ptr<VROImagePostProcess> sSepia;
@@ -52,6 +54,8 @@ VROPostProcessEffectFactory::VROPostProcessEffectFactory() {
     _enabledWindowMask = false;
     _swirlSpeedMultiplier = 2;
     _shouldPostProcessWindowMask = true;
+    _compiledEffectCount = 0;
+    _compiledPassesDirty = true;
 }
 
 VROPostProcessEffectFactory::~VROPostProcessEffectFactory() {
@@ -114,6 +118,7 @@ void VROPostProcessEffectFactory::enableEffect(VROPostProcessEffect effect, std:
         return;
     }
     _cachedPrograms.push_back(appliedEffect);
+    _compiledPassesDirty = true;
 }
 
 void VROPostProcessEffectFactory::disableEffect(VROPostProcessEffect effect){
@@ -123,17 +128,33 @@ void VROPostProcessEffectFactory::disableEffect(VROPostProcessEffect effect){
         std::pair<VROPostProcessEffect,
                 std::shared_ptr<VROImagePostProcess>> appliedEffect = *it;
         if (appliedEffect.first == effect) {
-            _cachedPrograms.erase(it);
+            it = _cachedPrograms.erase(it);
         } else {
             ++it;
         }
     }
+    _compiledPassesDirty = true;
 }
 
 void VROPostProcessEffectFactory::clearAllEffects(){
     _cachedPrograms.clear();
+    _compiledPassesDirty = true;
 };
 
+bool VROPostProcessEffectFactory::isPerPixelEffect(VROPostProcessEffect effect) {
+    switch (effect) {
+        case VROPostProcessEffect::GrayScale:
+        case VROPostProcessEffect::Sepia:
+        case VROPostProcessEffect::SinCity:
+        case VROPostProcessEffect::Inverted:
+        case VROPostProcessEffect::ThermalVision:
+        case VROPostProcessEffect::CrossHatch:
+            return true;
+        default:
+            return false;
+    }
+}
+
 void VROPostProcessEffectFactory::createPostProcessMask(std::shared_ptr<VRODriver> driver) {
     if (!sTextureMask) {
         std::vector<std::string> samplers = { "source_texture", "post_processed_texture", "mask_texture" };
@@ -279,15 +300,37 @@ std::shared_ptr<VRORenderTarget> VROPostProcessEffectFactory::handlePostProcessi
                                                                                    std::shared_ptr<VRORenderTarget> targetB,
                                                                                    std::shared_ptr<VROTexture> materialMask,
                                                                                    VRORenderContext *context,
-                                                                                   std::shared_ptr<VRODriver> driver) {
-    if (_cachedPrograms.size() == 0) {
+                                                                                   std::shared_ptr<VRODriver> driver,
+                                                                                   std::shared_ptr<VROToneMappingRenderPass> toneMapping) {
+    // Masks blend the post-processed result against the unprocessed source, so they need
+    // every effect rendered here. Otherwise, the trailing per-pixel effects are deferred to
+    // the tone-mapping shader.
+    int numDeferred = 0;
+    if (toneMapping) {
+        if (!_enabledWindowMask && materialMask == nullptr) {
+            numDeferred = getTrailingPerPixelEffectCount();
+        }
+
+        std::vector<VROPostProcessEffect> deferred;
+        for (int i = (int) _cachedPrograms.size() - numDeferred; i < _cachedPrograms.size(); i++) {
+            deferred.push_back(_cachedPrograms[i].first);
+        }
+        std::string key = getEffectSequenceKey(deferred);
+        if (toneMapping->getColorTransformKey() != key) {
+            toneMapping->setColorTransform(key, getColorTransformCode(deferred));
+        }
+    }
+
+    int numEffects = (int) _cachedPrograms.size() - numDeferred;
+    if (numEffects == 0) {
         return source;
     }
+    VRO_PROFILE_GPU_SCOPE("postProcessPass", driver);
 
     // If there are no masks, blit effects as usual and return the post process result.
     targetA->hydrate();
     targetB->hydrate();
-    std::shared_ptr<VRORenderTarget> outputTarget = renderEffects(source, targetA, targetB, driver);
+    std::shared_ptr<VRORenderTarget> outputTarget = renderEffects(source, targetA, targetB, numEffects, driver);
     if (!_enabledWindowMask && materialMask == nullptr) {
         return outputTarget;
     }
@@ -305,14 +348,14 @@ std::shared_ptr<VRORenderTarget> VROPostProcessEffectFactory::handlePostProcessi
 
         // If the post process mask is enabled, blend the source and post processed result
         std::shared_ptr<VRORenderTarget> finalOutput = outputTarget == targetA ? targetB : targetA;
-        driver->bindRenderTarget(finalOutput, VRORenderTargetUnbindOp::Invalidate);
+        driver->bindRenderTarget(finalOutput, VRORenderTargetActions::clearColorOnly(), VRORenderTargetUnbindOp::Invalidate);
         sTextureMask->blit({source->getTexture(0), outputTarget->getTexture(0), materialMask}, driver);
         return finalOutput;
     }
 
     // Else, apply a window mask.
     std::shared_ptr<VRORenderTarget> finalOutput = outputTarget == targetA ? targetB : targetA;
-    driver->bindRenderTarget(finalOutput, VRORenderTargetUnbindOp::Invalidate);
+    driver->bindRenderTarget(finalOutput, VRORenderTargetActions::clearColorOnly(), VRORenderTargetUnbindOp::Invalidate);
     sWindowMask->blit({source->getTexture(0), outputTarget->getTexture(0)}, driver);
     return finalOutput;
 }
@@ -320,7 +363,12 @@ std::shared_ptr<VRORenderTarget> VROPostProcessEffectFactory::handlePostProcessi
 std::shared_ptr<VRORenderTarget> VROPostProcessEffectFactory::renderEffects(std::shared_ptr<VRORenderTarget> input,
                                                                             std::shared_ptr<VRORenderTarget> targetA,
                                                                             std::shared_ptr<VRORenderTarget> targetB,
+                                                                            int numEffects,
                                                                             std::shared_ptr<VRODriver> driver) {
+    if (_compiledPassesDirty || _compiledEffectCount != numEffects) {
+        compilePasses(numEffects, driver);
+    }
+
     // Save the aspect ratio of the final output if needed.
     _outputAspectRatio.x = targetB->getWidth();
     _outputAspectRatio.y = targetB->getHeight();
@@ -328,21 +376,21 @@ std::shared_ptr<VRORenderTarget> VROPostProcessEffectFactory::renderEffects(std:
     // Compound post process effects by blitting ping-pong style between input and output targets.
     std::shared_ptr<VRORenderTarget> outputTarget = input;
     
-    for (int i = 0; i < _cachedPrograms.size(); i++) {
-        std::shared_ptr<VROImagePostProcess> &postProcess = _cachedPrograms[i].second;
+    for (int i = 0; i < _compiledPasses.size(); i++) {
+        std::shared_ptr<VROImagePostProcess> &postProcess = _compiledPasses[i];
         
         if (i == 0) {
-            driver->bindRenderTarget(targetA, VRORenderTargetUnbindOp::Invalidate);
+            driver->bindRenderTarget(targetA, VRORenderTargetActions::clearColorOnly(), VRORenderTargetUnbindOp::Invalidate);
             postProcess->blit({ input->getTexture(0) }, driver);
             outputTarget = targetA;
         }
         else if (i % 2 == 1) {
-            driver->bindRenderTarget(targetB, VRORenderTargetUnbindOp::Invalidate);
+            driver->bindRenderTarget(targetB, VRORenderTargetActions::clearColorOnly(), VRORenderTargetUnbindOp::Invalidate);
             postProcess->blit({ targetA->getTexture(0) }, driver);
             outputTarget = targetB;
         }
         else {
-            driver->bindRenderTarget(targetA, VRORenderTargetUnbindOp::Invalidate);
+            driver->bindRenderTarget(targetA, VRORenderTargetActions::clearColorOnly(), VRORenderTargetUnbindOp::Invalidate);
             postProcess->blit({ targetB->getTexture(0) },  driver);
             outputTarget = targetA;
         }
@@ -351,46 +399,124 @@ std::shared_ptr<VRORenderTarget> VROPostProcessEffectFactory::renderEffects(std:
     return outputTarget;
 }
 
-std::shared_ptr<VROImagePostProcess> VROPostProcessEffectFactory::createGreyScale(std::shared_ptr<VRODriver> driver) {
-    if (!sGrayScale) {
-        std::vector<std::string> samplers = { "source_texture" };
-        std::vector<std::string> code = {
-                "uniform sampler2D source_texture;",
-                "frag_color = texture(source_texture, v_texcoord);",
+void VROPostProcessEffectFactory::compilePasses(int numEffects, std::shared_ptr<VRODriver> driver) {
+    _compiledPasses.clear();
+
+    int i = 0;
+    while (i < numEffects) {
+        if (!isPerPixelEffect(_cachedPrograms[i].first)) {
+            _compiledPasses.push_back(_cachedPrograms[i].second);
+            i++;
+            continue;
+        }
+
+        // Gather the run of consecutive per-pixel effects starting here
+        std::vector<VROPostProcessEffect> run;
+        int start = i;
+        while (i < numEffects && isPerPixelEffect(_cachedPrograms[i].first)) {
+            run.push_back(_cachedPrograms[i].first);
+            i++;
+        }
+
+        if (run.size() == 1) {
+            _compiledPasses.push_back(_cachedPrograms[start].second);
+        }
+        else {
+            _compiledPasses.push_back(createFusedEffect(run, driver));
+        }
+    }
+
+    _compiledEffectCount = numEffects;
+    _compiledPassesDirty = false;
+}
+
+int VROPostProcessEffectFactory::getTrailingPerPixelEffectCount() const {
+    int count = 0;
+    for (int i = (int) _cachedPrograms.size() - 1; i >= 0; i--) {
+        if (!isPerPixelEffect(_cachedPrograms[i].first)) {
+            break;
+        }
+        count++;
+    }
+    return count;
+}
+
+std::string VROPostProcessEffectFactory::getEffectSequenceKey(const std::vector<VROPostProcessEffect> &effects) {
+    std::string key;
+    for (VROPostProcessEffect effect : effects) {
+        key += VROStringUtil::toString((int) effect) + ",";
+    }
+    return key;
+}
+
+std::vector<std::string> VROPostProcessEffectFactory::getColorTransformCode(const std::vector<VROPostProcessEffect> &effects) {
+    std::vector<std::string> code;
+    for (VROPostProcessEffect effect : effects) {
+        std::vector<std::string> transform = getColorTransform(effect);
+        code.push_back("{");
+        code.insert(code.end(), transform.begin(), transform.end());
+        code.push_back("}");
+    }
+    return code;
+}
+
+std::shared_ptr<VROImagePostProcess> VROPostProcessEffectFactory::createFusedEffect(const std::vector<VROPostProcessEffect> &effects,
+                                                                                    std::shared_ptr<VRODriver> driver) {
+    std::string key = getEffectSequenceKey(effects);
+    auto it = _fusedPrograms.find(key);
+    if (it != _fusedPrograms.end()) {
+        return it->second;
+    }
+
+    std::vector<std::string> samplers = { "source_texture" };
+    std::vector<std::string> code = {
+            "uniform sampler2D source_texture;",
+            "frag_color = texture(source_texture, v_texcoord);",
+    };
+    std::vector<std::string> transform = getColorTransformCode(effects);
+    code.insert(code.end(), transform.begin(), transform.end());
+
+    std::shared_ptr<VROShaderProgram> shader = VROImageShaderProgram::create(samplers, code, driver);
+    std::shared_ptr<VROImagePostProcess> fused = driver->newImagePostProcess(shader);
+    _fusedPrograms[key] = fused;
+    return fused;
+}
+
+std::shared_ptr<VROImagePostProcess> VROPostProcessEffectFactory::createPerPixelEffect(VROPostProcessEffect effect,
+                                                                                       std::shared_ptr<VRODriver> driver) {
+    std::vector<std::string> samplers = { "source_texture" };
+    std::vector<std::string> code = {
+            "uniform sampler2D source_texture;",
+            "frag_color = texture(source_texture, v_texcoord);",
+    };
+    std::vector<std::string> transform = getColorTransform(effect);
+    code.insert(code.end(), transform.begin(), transform.end());
+
+    std::shared_ptr<VROShaderProgram> shader = VROImageShaderProgram::create(samplers, code, driver);
+    return driver->newImagePostProcess(shader);
+}
+
+std::vector<std::string> VROPostProcessEffectFactory::getColorTransform(VROPostProcessEffect effect) {
+    if (effect == VROPostProcessEffect::GrayScale) {
+        return {
                 "highp float average = 0.2126 * frag_color.r + 0.7152 * frag_color.g + 0.0722 * frag_color.b;",
                 "frag_color = vec4(average, average, average, 1.0);",
         };
-        std::shared_ptr<VROShaderProgram> shader = VROImageShaderProgram::create(samplers, code, driver);
-        sGrayScale = driver->newImagePostProcess(shader);
     }
-    return sGrayScale;
-}
-
-std::shared_ptr<VROImagePostProcess> VROPostProcessEffectFactory::createSepia(std::shared_ptr<VRODriver> driver) {
-    if (!sSepia) {
-        std::vector<std::string> samplers = { "source_texture" };
-        std::vector<std::string> code = {
-                "uniform sampler2D source_texture;",
+    else if (effect == VROPostProcessEffect::Sepia) {
+        return {
                 "highp float adjust = 0.9;",
-                "highp vec4 color = texture(source_texture, v_texcoord);",
+                "highp vec4 color = frag_color;",
                 "highp vec4 outputColor;",
                 "outputColor.r = min(1.0,(color.r * (1.0 - (0.607 * adjust))) + (color.g * 0.769 * adjust) + (color.b * 0.189 * adjust));",
                 "outputColor.g = min(1.0,(color.r * 0.349 * adjust) + (color.g * (1.0 - (0.314 * adjust))) + (color.b * 0.168 * adjust));",
                 "outputColor.b = min(1.0,(color.r * 0.272 * adjust) + (color.g * 0.534 * adjust) + (color.b * (1.0 - (0.869 * adjust))));",
                 "frag_color = vec4(outputColor.rgb, 1.0);"
         };
-        std::shared_ptr<VROShaderProgram> shader = VROImageShaderProgram::create(samplers, code, driver);
-        sSepia = driver->newImagePostProcess(shader);
     }
-    return sSepia;
-}
-
-std::shared_ptr<VROImagePostProcess> VROPostProcessEffectFactory::createSinCity(std::shared_ptr<VRODriver> driver) {
-    if (!sSinCity) {
-        std::vector<std::string> samplers = { "source_texture" };
+    else if (effect == VROPostProcessEffect::SinCity) {
         std::vector<std::string> code = {
-                "uniform sampler2D source_texture;",
-                "highp vec4 color = texture(source_texture, v_texcoord);",
+                "highp vec4 color = frag_color;",
                 "highp float thresh = 0.1f;",
                 "highp vec4 lumcoeff = vec4(0.299,0.587,0.114,0.);",
                 "highp float luminance = dot(color,lumcoeff);",
@@ -403,9 +529,73 @@ std::shared_ptr<VROImagePostProcess> VROPostProcessEffectFactory::createSinCity(
 
         std::vector<std::string> darkerScene = getHBCSModification(0, .45, .55 , .45);
         code.insert(code.end(), darkerScene.begin(), darkerScene.end());
+        return code;
+    }
+    else if (effect == VROPostProcessEffect::Inverted) {
+        return {
+                "frag_color = vec4(1.0 - frag_color.rgb, 1.0);"
+        };
+    }
+    else if (effect == VROPostProcessEffect::ThermalVision) {
+        return {
+                "highp vec3 pixcol = frag_color.rgb;",
+                "highp vec3 colors[3];",
+                "colors[0] = vec3(0.,0.,1.);",
+                "colors[1] = vec3(1.,1.,0.);",
+                "colors[2] = vec3(1.,0.,0.);",
+                "highp float lum = (pixcol.r+pixcol.g+pixcol.b)/3.;",
+                "int ix = (lum < 0.5)? 0:1;",
+                "highp vec3 tc = mix(colors[ix],colors[ix+1],(lum-float(ix)*0.5)/0.5);",
+                "frag_color = vec4(tc, 1.0);",
+        };
+    }
+    else if (effect == VROPostProcessEffect::CrossHatch) {
+        return {
+                "highp float hatch_y_offset= 5.0;",
+                "highp float lum_threshold_1= 1.0;",
+                "highp float lum_threshold_2= 0.7;",
+                "highp float lum_threshold_3= 0.5;",
+                "highp float lum_threshold_4= 0.3;",
+                "highp float lum = length(frag_color.rgb);",
+                "highp vec3 tc = vec3(1.0, 1.0, 1.0);",
+                "if (lum < lum_threshold_1 && mod(gl_FragCoord.x + gl_FragCoord.y, 10.0) == 0.0) {",
+                "    tc = vec3(0.0, 0.0, 0.0);",
+                "}",
+                "if (lum < lum_threshold_2 && mod(gl_FragCoord.x - gl_FragCoord.y, 10.0) == 0.0) {",
+                "    tc = vec3(0.0, 0.0, 0.0);",
+                "}",
+                "if (lum < lum_threshold_3 && mod(gl_FragCoord.x + gl_FragCoord.y - hatch_y_offset, 10.0) == 0.0){",
+                "    tc = vec3(0.0, 0.0, 0.0);",
+                "}",
+                "if (lum < lum_threshold_4 && mod(gl_FragCoord.x - gl_FragCoord.y - hatch_y_offset, 10.0) == 0.0){",
+                "    tc = vec3(0.0, 0.0, 0.0);",
+                "}",
+                "frag_color = vec4(tc, 1.0);",
+        };
+    }
+    else {
+        pwarn("Effect is not a per-pixel color transform!");
+        return {};
+    }
+}
 
-        std::shared_ptr<VROShaderProgram> shader = VROImageShaderProgram::create(samplers, code, driver);
-        sSinCity = driver->newImagePostProcess(shader);
+std::shared_ptr<VROImagePostProcess> VROPostProcessEffectFactory::createGreyScale(std::shared_ptr<VRODriver> driver) {
+    if (!sGrayScale) {
+        sGrayScale = createPerPixelEffect(VROPostProcessEffect::GrayScale, driver);
+    }
+    return sGrayScale;
+}
+
+std::shared_ptr<VROImagePostProcess> VROPostProcessEffectFactory::createSepia(std::shared_ptr<VRODriver> driver) {
+    if (!sSepia) {
+        sSepia = createPerPixelEffect(VROPostProcessEffect::Sepia, driver);
+    }
+    return sSepia;
+}
+
+std::shared_ptr<VROImagePostProcess> VROPostProcessEffectFactory::createSinCity(std::shared_ptr<VRODriver> driver) {
+    if (!sSinCity) {
+        sSinCity = createPerPixelEffect(VROPostProcessEffect::SinCity, driver);
     }
     return sSinCity;
 }
@@ -570,35 +760,14 @@ std::shared_ptr<VROImagePostProcess> VROPostProcessEffectFactory::createToonify(
 
 std::shared_ptr<VROImagePostProcess> VROPostProcessEffectFactory::createInverted(std::shared_ptr<VRODriver> driver) {
     if (!sInverted) {
-        std::vector<std::string> samplers = { "source_texture" };
-        std::vector<std::string> code = {
-                "uniform sampler2D source_texture;",
-                "highp vec4 color = texture(source_texture, v_texcoord);",
-                "frag_color = vec4(1.0 - color.rgb, 1.0);"
-        };
-        std::shared_ptr<VROShaderProgram> shader = VROImageShaderProgram::create(samplers, code, driver);
-        sInverted = driver->newImagePostProcess(shader);
+        sInverted = createPerPixelEffect(VROPostProcessEffect::Inverted, driver);
     }
     return sInverted;
 }
 
 std::shared_ptr<VROImagePostProcess> VROPostProcessEffectFactory::createThermalVision(std::shared_ptr<VRODriver> driver) {
     if (!sThermalVision) {
-        std::vector<std::string> samplers = { "source_texture" };
-        std::vector<std::string> code = {
-                "uniform sampler2D source_texture;",
-                "highp vec3 pixcol = texture(source_texture, v_texcoord).rgb;",
-                "highp vec3 colors[3];",
-                "colors[0] = vec3(0.,0.,1.);",
-                "colors[1] = vec3(1.,1.,0.);",
-                "colors[2] = vec3(1.,0.,0.);",
-                "highp float lum = (pixcol.r+pixcol.g+pixcol.b)/3.;",
-                "int ix = (lum < 0.5)? 0:1;",
-                "highp vec3 tc = mix(colors[ix],colors[ix+1],(lum-float(ix)*0.5)/0.5);",
-                "frag_color = vec4(tc, 1.0);",
-        };
-        std::shared_ptr<VROShaderProgram> shader = VROImageShaderProgram::create(samplers, code, driver);
-        sThermalVision = driver->newImagePostProcess(shader);
+        sThermalVision = createPerPixelEffect(VROPostProcessEffect::ThermalVision, driver);
     }
     return sThermalVision;
 }
@@ -623,32 +792,7 @@ std::shared_ptr<VROImagePostProcess> VROPostProcessEffectFactory::createPixel(st
 
 std::shared_ptr<VROImagePostProcess> VROPostProcessEffectFactory::createCrossHatch(std::shared_ptr<VRODriver> driver) {
     if (!sCrossHatch) {
-        std::vector<std::string> samplers = { "source_texture" };
-        std::vector<std::string> code = {
-                "uniform sampler2D source_texture;",
-                "highp float hatch_y_offset= 5.0;",
-                "highp float lum_threshold_1= 1.0;",
-                "highp float lum_threshold_2= 0.7;",
-                "highp float lum_threshold_3= 0.5;",
-                "highp float lum_threshold_4= 0.3;",
-                "highp float lum = length(texture(source_texture, v_texcoord).rgb);",
-                "highp vec3 tc = vec3(1.0, 1.0, 1.0);",
-                "if (lum < lum_threshold_1 && mod(gl_FragCoord.x + gl_FragCoord.y, 10.0) == 0.0) {",
-                "    tc = vec3(0.0, 0.0, 0.0);",
-                "}",
-                "if (lum < lum_threshold_2 && mod(gl_FragCoord.x - gl_FragCoord.y, 10.0) == 0.0) {",
-                "    tc = vec3(0.0, 0.0, 0.0);",
-                "}",
-                "if (lum < lum_threshold_3 && mod(gl_FragCoord.x + gl_FragCoord.y - hatch_y_offset, 10.0) == 0.0){",
-                "    tc = vec3(0.0, 0.0, 0.0);",
-                "}",
-                "if (lum < lum_threshold_4 && mod(gl_FragCoord.x - gl_FragCoord.y - hatch_y_offset, 10.0) == 0.0){",
-                "    tc = vec3(0.0, 0.0, 0.0);",
-                "}",
-                "frag_color = vec4(tc, 1.0);",
-        };
-        std::shared_ptr<VROShaderProgram> shader = VROImageShaderProgram::create(samplers, code, driver);
-        sCrossHatch = driver->newImagePostProcess(shader);
+        sCrossHatch = createPerPixelEffect(VROPostProcessEffect::CrossHatch, driver);
     }
     return sCrossHatch;
 }
@@ -43,6 +43,7 @@ class VRODriver;
 class VRORenderTarget;
 class VROTexture;
 class VROGaussianBlurRenderPass;
+class VROToneMappingRenderPass;
 class VRORenderContext;
 
 enum class VROPostProcessEffect{
@@ -95,13 +96,34 @@ public:
      Return the render target that contains the final result. Note this will always
      be one of the passed-in render targets (source if no post-processing was required,
      or one of targetA or targetB if there were any post-processing steps).
+
+     Consecutive per-pixel effects are fused into a single pass. If a tone-mapping pass
+     is provided and no mask is in use, the trailing run of per-pixel effects is instead
+     folded into the tone-mapping shader, so it costs no pass of its own.
      */
     std::shared_ptr<VRORenderTarget> handlePostProcessing(std::shared_ptr<VRORenderTarget> source,
                                                           std::shared_ptr<VRORenderTarget> targetA,
                                                           std::shared_ptr<VRORenderTarget> targetB,
                                                           std::shared_ptr<VROTexture> mask,
                                                           VRORenderContext *context,
-                                                          std::shared_ptr<VRODriver> driver);
+                                                          std::shared_ptr<VRODriver> driver,
+                                                          std::shared_ptr<VROToneMappingRenderPass> toneMapping = nullptr);
+
+    /*
+     Returns true if any effect is enabled.
+     */
+    bool hasEffects() const {
+        return !_cachedPrograms.empty();
+    }
+
+    /*
+     Returns true if handlePostProcessing reads its source target after rendering the
+     effects; i.e., if the result is blended back against the source through a mask.
+     If not, the source may be passed in as one of the ping-pong targets.
+     */
+    bool isSourceReadAfterEffects(std::shared_ptr<VROTexture> mask) const {
+        return _enabledWindowMask || mask != nullptr;
+    }
 
     static VROPostProcessEffect getEffectForString(std::string strEffect){
         VROStringUtil::toLowerCase(strEffect);
@@ -148,10 +170,17 @@ public:
      */
     void setGaussianBlurPass(std::shared_ptr<VROGaussianBlurRenderPass> pass);
 
+    /*
+     Returns true if the given effect only transforms the color of each fragment, without
+     moving its texcoord or sampling its neighbors. These effects can be fused together.
+     */
+    static bool isPerPixelEffect(VROPostProcessEffect effect);
+
 private:
     std::shared_ptr<VRORenderTarget> renderEffects(std::shared_ptr<VRORenderTarget> input,
                                                    std::shared_ptr<VRORenderTarget> targetA,
                                                    std::shared_ptr<VRORenderTarget> targetB,
+                                                   int numEffects,
                                                    std::shared_ptr<VRODriver> driver);
 
     /*
@@ -159,6 +188,33 @@ private:
      */
     std::vector<std::pair<VROPostProcessEffect, std::shared_ptr<VROImagePostProcess>>> _cachedPrograms;
 
+    /*
+     The passes actually run for the first N effects in _cachedPrograms, after fusing runs
+     of per-pixel effects. Rebuilt lazily whenever the enabled effects (or the number of
+     effects deferred to tone-mapping) change. Fused programs are cached by the sequence
+     of effects they implement, so toggling between configurations does not recompile.
+     */
+    std::vector<std::shared_ptr<VROImagePostProcess>> _compiledPasses;
+    int _compiledEffectCount;
+    bool _compiledPassesDirty;
+    std::map<std::string, std::shared_ptr<VROImagePostProcess>> _fusedPrograms;
+
+    void compilePasses(int numEffects, std::shared_ptr<VRODriver> driver);
+    std::shared_ptr<VROImagePostProcess> createFusedEffect(const std::vector<VROPostProcessEffect> &effects,
+                                                           std::shared_ptr<VRODriver> driver);
+
+    /*
+     Returns the number of per-pixel effects at the end of the effect chain.
+     */
+    int getTrailingPerPixelEffectCount() const;
+
+    /*
+     Builds the GLSL body that applies the given per-pixel effects, in order, to frag_color.
+     Each effect is scoped in its own block so their local variables do not collide.
+     */
+    std::vector<std::string> getColorTransformCode(const std::vector<VROPostProcessEffect> &effects);
+    static std::string getEffectSequenceKey(const std::vector<VROPostProcessEffect> &effects);
+
     /*
      Below is a list of post-process specific functions that builds, caches and returns post process
      effects to run.
@@ -178,8 +234,15 @@ private:
     std::shared_ptr<VROImagePostProcess> createSwirlEffect(std::shared_ptr<VRODriver> driver);
     std::shared_ptr<VROImagePostProcess> createZoomEffect(std::shared_ptr<VRODriver> driver);
     std::shared_ptr<VROImagePostProcess> createEmptyEffect(std::shared_ptr<VRODriver> driver);
+    std::shared_ptr<VROImagePostProcess> createPerPixelEffect(VROPostProcessEffect effect, std::shared_ptr<VRODriver> driver);
     std::vector<std::string> getHBCSModification(float hue, float brightness, float contrast, float saturation);
 
+    /*
+     Returns the per-pixel color transform for the given effect. The code reads the fragment
+     color from frag_color and writes the result back to it.
+     */
+    std::vector<std::string> getColorTransform(VROPostProcessEffect effect);
+
     /*
      Properties for applying the post process effects within a window mask.
      */
@@ -35,6 +35,7 @@
 #include "VRORenderUtil.h"
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
+#include <algorithm>
 
 VROPrefilterRenderPass::VROPrefilterRenderPass() {
 }
@@ -60,9 +61,15 @@ void VROPrefilterRenderPass::init(std::shared_ptr<VRODriver> driver) {
 }
 
 void VROPrefilterRenderPass::render(std::shared_ptr<VROScene> scene,
-                                     std::shared_ptr<VROScene> outgoingScene,
-                                     VRORenderPassInputOutput &inputs,
-                                     VRORenderContext *context, std::shared_ptr<VRODriver> &driver) {
+                                    std::shared_ptr<VROScene> outgoingScene,
+                                    VRORenderPassInputOutput &inputs,
+                                    VRORenderContext *context, std::shared_ptr<VRODriver> &driver) {
+    for (int slice = 0; slice < getNumSlices(); slice++) {
+        renderSlice(slice, inputs, driver);
+    }
+}
+
+void VROPrefilterRenderPass::renderSlice(int slice, VRORenderPassInputOutput &inputs, std::shared_ptr<VRODriver> &driver) {
     if (!_shader) {
         init(driver);
     }
@@ -71,8 +78,15 @@ void VROPrefilterRenderPass::render(std::shared_ptr<VROScene> scene,
     // Bind the input lighting environment to texture unit 0
     VRORenderUtil::bindTexture(0, inputs.textures[kPrefilterLightingEnvironmentInput], driver);
 
-    // Bind the destination render target
-    driver->bindRenderTarget(_prefilterRenderTarget, VRORenderTargetUnbindOp::Invalidate);
+    int mip = slice / 6;
+    int face = slice % 6;
+    
+    // Attach the face and miplevel before binding the target, so that the bind only
+    // discards the image being rendered (the others may have been rendered by earlier
+    // slices)
+    _prefilterRenderTarget->setTextureCubeFace(face, mip, 0);
+    driver->bindRenderTarget(_prefilterRenderTarget, VRORenderTargetActions::overwrite(), VRORenderTargetUnbindOp::Invalidate);
+    _prefilterRenderTarget->setRenderRegion({ 0, 0, std::max(1, _prefilterRenderTarget->getWidth() >> mip), std::max(1, _prefilterRenderTarget->getHeight() >> mip) });
 
     // Setup for rendering the cube
     VRORenderUtil::prepareForBlit(driver, true, false);
@@ -94,25 +108,29 @@ void VROPrefilterRenderPass::render(std::shared_ptr<VROScene> scene,
         glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f))
     };
     _shader->getUniform("projection_matrix")->setMat4(captureProjection);
+    _shader->getUniform("view_matrix")->setMat4(captureViews[face]);
 
     // Configure the mip level as a correlation of pbr roughness.
-    unsigned int maxMipLevels = 5;
-    for (unsigned int mip = 0; mip < maxMipLevels; ++mip) {
-        float roughness = (float)mip / (float)(maxMipLevels - 1);
-        _shader->getUniform("material_roughness")->setFloat(roughness);
-
-        // Finally render each face of the convoluted prefilter cubemap.
-        for (int i = 0; i < 6; ++i) {
-            _shader->getUniform("view_matrix")->setMat4(captureViews[i]);
-            _prefilterRenderTarget->setTextureCubeFace(i, mip, 0);
-            GL( glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT) );
-            VRORenderUtil::renderUnitCube(&_cubeVAO, &_cubeVBO);
-        }
-    }
+    float roughness = (float)mip / (float)(kPrefilterMipLevels - 1);
+    _shader->getUniform("material_roughness")->setFloat(roughness);
+
+    GL( glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT) );
+    VRORenderUtil::renderUnitCube(&_cubeVAO, &_cubeVBO, driver);
+
     driver->unbindShader();
     pglpop();
     inputs.outputTarget = _prefilterRenderTarget;
 }
 
+int VROPrefilterRenderPass::getNumSlices() const {
+    return 6 * kPrefilterMipLevels;
+}
+
+void VROPrefilterRenderPass::beginNewOutput() {
+    if (_prefilterRenderTarget) {
+        _prefilterRenderTarget->attachNewTextures();
+    }
+}
+
 
 
@@ -35,6 +35,12 @@ class VROImagePostProcess;
 
 const std::string kPrefilterLightingEnvironmentInput = "Prefilter_Input";
 
+/*
+ The number of miplevels rendered to the prefiltered cubemap, from roughness 0
+ (the base level) to roughness 1.
+ */
+const int kPrefilterMipLevels = 5;
+
 /*
  Creates a prefiltered irradiance cubemap through convolution of an environment map.
  */
@@ -48,6 +54,20 @@ public:
                 std::shared_ptr<VROScene> outgoingScene,
                 VRORenderPassInputOutput &inputs,
                 VRORenderContext *context, std::shared_ptr<VRODriver> &driver);
+    
+    /*
+     Render a single slice (one face of one miplevel) of the cubemap. Slices may be
+     rendered on separate frames, so that the work can be time-sliced; render()
+     renders all of them at once.
+     */
+    void renderSlice(int slice, VRORenderPassInputOutput &inputs, std::shared_ptr<VRODriver> &driver);
+    int getNumSlices() const;
+    
+    /*
+     Render subsequent slices to a new cubemap texture, so that the texture of the
+     last render remains intact for those still using it.
+     */
+    void beginNewOutput();
 
 private:
     unsigned int _cubeVAO = 0;
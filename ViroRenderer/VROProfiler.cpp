@@ -0,0 +1,311 @@
+//
+//  VROProfiler.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROProfiler.h"
+#include "VRODriver.h"
+#include "VROTime.h"
+#include "VROLog.h"
+#include <mutex>
+#include <vector>
+
+static const size_t kMaxProfilerEvents = 100000;
+static const uint32_t kGPUThreadId = 0;
+
+static const char *kCounterNames[] = {
+    "Draw calls",
+    "Instanced draw calls",
+    "Multi-draw calls",
+    "Multi-draw commands",
+    "GPU cull dispatches",
+    "Shader binds",
+    "Texture binds",
+    "Render target binds",
+    "State changes",
+    "State changes avoided",
+    "Vertex array binds",
+    "Renderer tasks",
+    "Atomic property writes",
+    "Overdraw (%)",
+    "Occlusion queries",
+    "Occluded nodes",
+    "Shadow maps rendered",
+    "Shadow maps cached",
+    "Physics bodies",
+    "Physics body updates",
+    "Physics body rebuilds",
+    "Triangles",
+    "Shader compiles",
+    "Texture uploads",
+};
+
+enum class VROProfilerEventType {
+    Duration,
+    Counter,
+};
+
+struct VROProfilerEvent {
+    VROProfilerEventType type;
+    const char *name;
+    std::string dynamicName;
+    uint64_t startNs;
+    uint64_t durationNs;
+    uint32_t threadId;
+    int value;
+};
+
+std::atomic<bool> VROProfiler::sEnabled { false };
+std::atomic<int> VROProfiler::sCounters[(int) VROProfilerCounter::NUM_COUNTERS];
+
+static std::mutex sEventMutex;
+static std::vector<VROProfilerEvent> sEvents;
+static size_t sNextEvent = 0;
+
+static std::atomic<uint32_t> sNextThreadId { 1 };
+static uint32_t sRenderThreadId = 0;
+static int sFrame = 0;
+static uint64_t sFrameStartNs = 0;
+
+static uint32_t getThreadId() {
+    static thread_local uint32_t threadId = 0;
+    if (threadId == 0) {
+        threadId = sNextThreadId.fetch_add(1);
+    }
+    return threadId;
+}
+
+static void addEvent(VROProfilerEvent &&event) {
+    std::lock_guard<std::mutex> lock(sEventMutex);
+    if (sEvents.size() < kMaxProfilerEvents) {
+        sEvents.push_back(std::move(event));
+    }
+    else {
+        sEvents[sNextEvent] = std::move(event);
+    }
+    sNextEvent = (sNextEvent + 1) % kMaxProfilerEvents;
+}
+
+#pragma mark - Recording
+
+void VROProfiler::setEnabled(bool enabled) {
+    if (enabled && !isEnabled()) {
+        pinfo("Profiler enabled, recording up to %d events", (int) kMaxProfilerEvents);
+    }
+    sEnabled.store(enabled);
+}
+
+void VROProfiler::beginFrame(int frame) {
+    if (!isEnabled()) {
+        return;
+    }
+    sRenderThreadId = getThreadId();
+    sFrame = frame;
+    sFrameStartNs = VRONanoTime();
+
+    for (int i = 0; i < (int) VROProfilerCounter::NUM_COUNTERS; i++) {
+        sCounters[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void VROProfiler::endFrame() {
+    if (!isEnabled() || sFrameStartNs == 0) {
+        return;
+    }
+    uint64_t endNs = VRONanoTime();
+    addCPUEvent("Frame " + std::to_string(sFrame), sFrameStartNs, endNs);
+
+    for (int i = 0; i < (int) VROProfilerCounter::NUM_COUNTERS; i++) {
+        VROProfilerEvent event;
+        event.type = VROProfilerEventType::Counter;
+        event.name = kCounterNames[i];
+        event.startNs = sFrameStartNs;
+        event.durationNs = 0;
+        event.threadId = sRenderThreadId;
+        event.value = sCounters[i].load(std::memory_order_relaxed);
+        addEvent(std::move(event));
+    }
+    sFrameStartNs = 0;
+}
+
+void VROProfiler::addCPUEvent(const char *name, uint64_t startNs, uint64_t endNs) {
+    VROProfilerEvent event;
+    event.type = VROProfilerEventType::Duration;
+    event.name = name;
+    event.startNs = startNs;
+    event.durationNs = endNs - startNs;
+    event.threadId = getThreadId();
+    event.value = 0;
+    addEvent(std::move(event));
+}
+
+void VROProfiler::addCPUEvent(const std::string &name, uint64_t startNs, uint64_t endNs) {
+    VROProfilerEvent event;
+    event.type = VROProfilerEventType::Duration;
+    event.name = nullptr;
+    event.dynamicName = name;
+    event.startNs = startNs;
+    event.durationNs = endNs - startNs;
+    event.threadId = getThreadId();
+    event.value = 0;
+    addEvent(std::move(event));
+}
+
+void VROProfiler::addGPUEvent(const char *name, uint64_t startNs, uint64_t durationNs) {
+    VROProfilerEvent event;
+    event.type = VROProfilerEventType::Duration;
+    event.name = name;
+    event.startNs = startNs;
+    event.durationNs = durationNs;
+    event.threadId = kGPUThreadId;
+    event.value = 0;
+    addEvent(std::move(event));
+}
+
+void VROProfiler::clear() {
+    std::lock_guard<std::mutex> lock(sEventMutex);
+    sEvents.clear();
+    sNextEvent = 0;
+}
+
+#pragma mark - Export
+
+static void appendEscaped(std::string &json, const char *str) {
+    for (const char *c = str; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            json.push_back('\\');
+            json.push_back(*c);
+        }
+        else if ((unsigned char) *c >= 0x20) {
+            json.push_back(*c);
+        }
+    }
+}
+
+static void appendThreadName(std::string &json, uint32_t threadId, const char *name) {
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer),
+             "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+             threadId, name);
+    json.append(buffer);
+}
+
+std::string VROProfiler::exportChromeTrace() {
+    std::lock_guard<std::mutex> lock(sEventMutex);
+
+    std::string json;
+    json.reserve(sEvents.size() * 96 + 256);
+    json.append("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+    appendThreadName(json, kGPUThreadId, "GPU");
+    if (sRenderThreadId != 0) {
+        json.push_back(',');
+        appendThreadName(json, sRenderThreadId, "Renderer");
+    }
+
+    // Timestamps are written relative to the oldest event, in microseconds
+    uint64_t baseNs = UINT64_MAX;
+    for (const VROProfilerEvent &event : sEvents) {
+        baseNs = std::min(baseNs, event.startNs);
+    }
+
+    char buffer[256];
+    for (const VROProfilerEvent &event : sEvents) {
+        const char *name = event.name ? event.name : event.dynamicName.c_str();
+        double ts = (event.startNs - baseNs) / 1000.0;
+
+        json.append(",{\"name\":\"");
+        appendEscaped(json, name);
+        if (event.type == VROProfilerEventType::Counter) {
+            snprintf(buffer, sizeof(buffer), "\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"value\":%d}}",
+                     ts, event.threadId, event.value);
+        }
+        else {
+            snprintf(buffer, sizeof(buffer), "\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+                     event.threadId == kGPUThreadId ? "gpu" : "cpu", ts, event.durationNs / 1000.0, event.threadId);
+        }
+        json.append(buffer);
+    }
+    json.append("]}");
+    return json;
+}
+
+bool VROProfiler::writeChromeTrace(std::string path) {
+    std::string json = exportChromeTrace();
+
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file) {
+        pwarn("Failed to open profiler trace file [%s]", path.c_str());
+        return false;
+    }
+    size_t written = fwrite(json.data(), 1, json.size(), file);
+    fclose(file);
+
+    if (written != json.size()) {
+        pwarn("Failed to write profiler trace file [%s]", path.c_str());
+        return false;
+    }
+    pinfo("Wrote profiler trace to [%s] (%d bytes)", path.c_str(), (int) written);
+    return true;
+}
+
+#pragma mark - VROProfilerScope
+
+VROProfilerScope::VROProfilerScope(const char *name, VRODriver *driver) :
+    _name(name),
+    _driver(driver),
+    _active(VROProfiler::isEnabled()) {
+    if (!_active) {
+        return;
+    }
+    _startNs = VRONanoTime();
+    if (_driver) {
+        _driver->beginGPUTimer(name);
+    }
+}
+
+VROProfilerScope::VROProfilerScope(std::string name) :
+    _name(nullptr),
+    _driver(nullptr),
+    _active(VROProfiler::isEnabled()) {
+    if (!_active) {
+        return;
+    }
+    _dynamicName = std::move(name);
+    _startNs = VRONanoTime();
+}
+
+VROProfilerScope::~VROProfilerScope() {
+    if (!_active) {
+        return;
+    }
+    if (_driver) {
+        _driver->endGPUTimer();
+    }
+    if (_name) {
+        VROProfiler::addCPUEvent(_name, _startNs, VRONanoTime());
+    }
+    else {
+        VROProfiler::addCPUEvent(_dynamicName, _startNs, VRONanoTime());
+    }
+}
@@ -0,0 +1,174 @@
+//
+//  VROProfiler.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROProfiler_h
+#define VROProfiler_h
+
+#include <stdio.h>
+#include <string>
+#include <atomic>
+#include <memory>
+
+class VRODriver;
+
+/*
+ Per-frame counters recorded by the profiler. These are accumulated over
+ each frame and emitted as counter tracks when the frame ends.
+ */
+enum class VROProfilerCounter {
+    DrawCalls,
+    InstancedDrawCalls,
+    MultiDrawCalls,
+    MultiDrawCommands,
+    GPUCullDispatches,
+    ShaderBinds,
+    TextureBinds,
+    RenderTargetBinds,
+    StateChanges,
+    StateChangesAvoided,
+    VertexArrayBinds,
+    RendererTasks,
+    AtomicPropertyWrites,
+    Overdraw,
+    OcclusionQueries,
+    OccludedNodes,
+    ShadowMapsRendered,
+    ShadowMapsCached,
+    PhysicsBodies,
+    PhysicsBodyUpdates,
+    PhysicsBodyRebuilds,
+    Triangles,
+    ShaderCompiles,
+    TextureUploads,
+    NUM_COUNTERS
+};
+
+/*
+ Opens a CPU timing scope that closes at the end of the enclosing block. The
+ name must be a string literal or otherwise outlive the profiler. The GPU
+ variant additionally times the enclosed GL commands via the given driver.
+ */
+#define VRO_PROFILE_CONCAT_INNER(a, b) a##b
+#define VRO_PROFILE_CONCAT(a, b) VRO_PROFILE_CONCAT_INNER(a, b)
+#define VRO_PROFILE_SCOPE(name) VROProfilerScope VRO_PROFILE_CONCAT(__profilerScope, __LINE__)(name)
+#define VRO_PROFILE_GPU_SCOPE(name, driver) VROProfilerScope VRO_PROFILE_CONCAT(__profilerScope, __LINE__)(name, driver.get())
+#define VRO_PROFILE_COUNT(counter, amount) do { if (VROProfiler::isEnabled()) { VROProfiler::count(VROProfilerCounter::counter, amount); } } while (0)
+
+/*
+ Records the CPU time spent in each phase of the frame, the GPU time of each
+ render pass (where the driver supports timer queries), and per-frame draw
+ call and state-change counts. Events are kept in a bounded ring buffer (the
+ oldest are discarded once it fills) and can be exported in the Chrome trace
+ event format, which loads in chrome://tracing and Perfetto.
+
+ Profiling is disabled by default; when disabled every hook reduces to a
+ single relaxed atomic load.
+ */
+class VROProfiler {
+public:
+
+    static void setEnabled(bool enabled);
+    static bool isEnabled() {
+        return sEnabled.load(std::memory_order_relaxed);
+    }
+
+    /*
+     Mark the boundaries of a frame. Counters are reset at the start of each
+     frame and emitted when the frame ends.
+     */
+    static void beginFrame(int frame);
+    static void endFrame();
+
+    /*
+     Record a CPU event on the calling thread. Start and end times are in
+     nanoseconds, from VRONanoTime(). Constant names are stored by pointer;
+     dynamic names are copied.
+     */
+    static void addCPUEvent(const char *name, uint64_t startNs, uint64_t endNs);
+    static void addCPUEvent(const std::string &name, uint64_t startNs, uint64_t endNs);
+
+    /*
+     Record an event on the GPU track. Timer queries only measure elapsed
+     GPU time, so the start time is the CPU time at which the commands were
+     issued.
+     */
+    static void addGPUEvent(const char *name, uint64_t startNs, uint64_t durationNs);
+
+    /*
+     Increment the given counter for the current frame.
+     */
+    static void count(VROProfilerCounter counter, int amount) {
+        sCounters[(int) counter].fetch_add(amount, std::memory_order_relaxed);
+    }
+    
+    /*
+     The value of the given counter for the current frame, or for the last frame
+     once it has ended (counters are only reset when the next frame begins).
+     */
+    static int getCount(VROProfilerCounter counter) {
+        return sCounters[(int) counter].load(std::memory_order_relaxed);
+    }
+
+    /*
+     Export all recorded events as Chrome trace JSON, or write them to the
+     given file. Returns false if the file could not be written.
+     */
+    static std::string exportChromeTrace();
+    static bool writeChromeTrace(std::string path);
+
+    /*
+     Discard all recorded events.
+     */
+    static void clear();
+
+private:
+
+    static std::atomic<bool> sEnabled;
+    static std::atomic<int> sCounters[(int) VROProfilerCounter::NUM_COUNTERS];
+
+};
+
+/*
+ RAII helper that records a CPU event spanning its lifetime, and optionally
+ brackets it with a GPU timer on the given driver.
+ */
+class VROProfilerScope {
+public:
+
+    VROProfilerScope(const char *name, VRODriver *driver = nullptr);
+    VROProfilerScope(std::string name);
+    ~VROProfilerScope();
+
+private:
+
+    const char *_name;
+    std::string _dynamicName;
+    VRODriver *_driver;
+    uint64_t _startNs;
+    bool _active;
+
+};
+
+#endif /* VROProfiler_h */
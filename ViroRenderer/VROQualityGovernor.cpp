@@ -0,0 +1,222 @@
+//
+//  VROQualityGovernor.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include "VROQualityGovernor.h"
+#include "VROLog.h"
+#include <algorithm>
+
+// Interval at which the thermal and battery state are polled
+static const double kQualityGovernorPollInterval = 1000;
+
+// Frames are slow when the average interval exceeds the target by this factor, and
+// have headroom when the average work time is under this fraction of the target
+static const double kQualityGovernorSlowFactor = 1.2;
+static const double kQualityGovernorHeadroomFactor = 0.7;
+
+// Intervals (ms) frames must be slow before degrading, and on time before restoring;
+// the restore wait doubles, up to the maximum, when a restore relapses within the
+// relapse window
+static const double kQualityGovernorDegradeTime = 2000;
+static const double kQualityGovernorMinRestoreDelay = 10000;
+static const double kQualityGovernorMaxRestoreDelay = 80000;
+static const double kQualityGovernorRelapseWindow = 30000;
+
+// Time (ms) the device must be cooler before each step down of the thermal minimum
+static const double kQualityGovernorThermalCooldown = 30000;
+
+// Frame intervals longer than this are pauses (e.g. the app was backgrounded), not
+// slow frames
+static const double kQualityGovernorMaxFrameInterval = 1000;
+
+static const double kQualityGovernorAverageWeight = 0.05;
+
+VROQualityGovernor::VROQualityGovernor(double targetFrameTime) :
+    _targetFrameTime(targetFrameTime),
+    _thermalState(VROThermalState::Unknown),
+    _lowPowerMode(false) {
+    reset();
+}
+
+VROQualityGovernor::~VROQualityGovernor() {
+    
+}
+
+void VROQualityGovernor::reset() {
+    _level = 0;
+    _performanceLevel = 0;
+    _thermalLevel = 0;
+    _averageFrameTime = -1;
+    _averageWorkTime = -1;
+    _slowTime = 0;
+    _fastTime = 0;
+    _timeSinceChange = 0;
+    _restoreDelay = kQualityGovernorMinRestoreDelay;
+    _lastChangeWasRestore = false;
+    _timeSincePoll = kQualityGovernorPollInterval;
+    _coolTime = 0;
+}
+
+VROQualityLevelSettings VROQualityGovernor::getSettings(int level) {
+    VROQualityLevelSettings settings;
+    settings.renderScale = 1.0;
+    settings.particleBudgetScale = 1.0;
+    settings.animationLODBias = 1.0;
+    settings.bloom = true;
+    settings.shadows = true;
+    settings.pbr = true;
+    settings.hdr = true;
+    
+    if (level >= 1) {
+        settings.renderScale = 0.85;
+        settings.bloom = false;
+    }
+    if (level >= 2) {
+        settings.renderScale = 0.7;
+        settings.shadows = false;
+        settings.particleBudgetScale = 0.5;
+        settings.animationLODBias = 2.0;
+    }
+    if (level >= 3) {
+        settings.renderScale = 0.6;
+        settings.pbr = false;
+        settings.particleBudgetScale = 0.25;
+        settings.animationLODBias = 4.0;
+    }
+    if (level >= 4) {
+        settings.hdr = false;
+    }
+    return settings;
+}
+
+bool VROQualityGovernor::update(double frameInterval, double frameWorkTime) {
+    if (frameInterval <= 0 || frameInterval > kQualityGovernorMaxFrameInterval) {
+        return false;
+    }
+    pollPlatformState(frameInterval);
+    updatePerformanceLevel(frameInterval, frameWorkTime);
+    
+    int level = std::max(_performanceLevel, _thermalLevel);
+    if (level == _level) {
+        return false;
+    }
+    
+    pinfo("Quality governor level changed from %d to %d [thermal state %d, low power %d]",
+          _level, level, (int) _thermalState, _lowPowerMode);
+    _level = level;
+    if (_callback) {
+        _callback(_level, _thermalState);
+    }
+    return true;
+}
+
+void VROQualityGovernor::pollPlatformState(double elapsed) {
+    _timeSincePoll += elapsed;
+    if (_timeSincePoll < kQualityGovernorPollInterval) {
+        return;
+    }
+    double sinceLastPoll = _timeSincePoll;
+    _timeSincePoll = 0;
+    
+    _thermalState = VROPlatformGetThermalState();
+    _lowPowerMode = VROPlatformIsLowPowerModeEnabled();
+    
+    int minimum = 0;
+    switch (_thermalState) {
+        case VROThermalState::Fair:
+            minimum = 1;
+            break;
+        case VROThermalState::Serious:
+            minimum = 2;
+            break;
+        case VROThermalState::Critical:
+            minimum = kQualityGovernorMaxLevel;
+            break;
+        default:
+            break;
+    }
+    if (_lowPowerMode) {
+        minimum = std::max(minimum, 1);
+    }
+    
+    // Heat builds quickly but dissipates slowly: raise the minimum at once, and
+    // lower it a step at a time once the device has stayed cooler
+    if (minimum >= _thermalLevel) {
+        _thermalLevel = minimum;
+        _coolTime = 0;
+    }
+    else {
+        _coolTime += sinceLastPoll;
+        if (_coolTime >= kQualityGovernorThermalCooldown) {
+            --_thermalLevel;
+            _coolTime = 0;
+        }
+    }
+}
+
+void VROQualityGovernor::updatePerformanceLevel(double frameInterval, double frameWorkTime) {
+    if (_averageFrameTime < 0) {
+        _averageFrameTime = frameInterval;
+    }
+    else {
+        _averageFrameTime += (frameInterval - _averageFrameTime) * kQualityGovernorAverageWeight;
+    }
+    if (frameWorkTime > 0) {
+        if (_averageWorkTime < 0) {
+            _averageWorkTime = frameWorkTime;
+        }
+        else {
+            _averageWorkTime += (frameWorkTime - _averageWorkTime) * kQualityGovernorAverageWeight;
+        }
+    }
+    _timeSinceChange += frameInterval;
+    
+    bool slow = _averageFrameTime > _targetFrameTime * kQualityGovernorSlowFactor;
+    bool headroom = !slow && (_averageWorkTime < 0 || _averageWorkTime < _targetFrameTime * kQualityGovernorHeadroomFactor);
+    _slowTime = slow ? _slowTime + frameInterval : 0;
+    _fastTime = headroom ? _fastTime + frameInterval : 0;
+    
+    if (_slowTime >= kQualityGovernorDegradeTime && _performanceLevel < kQualityGovernorMaxLevel) {
+        if (_lastChangeWasRestore && _timeSinceChange < kQualityGovernorRelapseWindow) {
+            _restoreDelay = std::min(_restoreDelay * 2, kQualityGovernorMaxRestoreDelay);
+        }
+        ++_performanceLevel;
+        _lastChangeWasRestore = false;
+    }
+    else if (_fastTime >= _restoreDelay && _performanceLevel > 0) {
+        --_performanceLevel;
+        _lastChangeWasRestore = true;
+    }
+    else {
+        return;
+    }
+    
+    // Judge the new level on its own frames
+    _slowTime = 0;
+    _fastTime = 0;
+    _timeSinceChange = 0;
+    _averageFrameTime = -1;
+    _averageWorkTime = -1;
+}
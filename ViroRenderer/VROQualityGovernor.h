@@ -0,0 +1,165 @@
+//
+//  VROQualityGovernor.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef VROQualityGovernor_h
+#define VROQualityGovernor_h
+
+#include <functional>
+#include "VROPlatformUtil.h"
+
+/*
+ The number of quality levels below full quality.
+ */
+static const int kQualityGovernorMaxLevel = 4;
+
+/*
+ The reductions applied at a quality level. Features can only be disabled by the
+ governor: a feature the application did not enable stays disabled at every level.
+ */
+struct VROQualityLevelSettings {
+    // Upper bound on the render resolution scale (see VROChoreographer)
+    float renderScale;
+
+    // Fraction of each particle emitter's maximum particles that may be alive
+    float particleBudgetScale;
+
+    // Multiplier on the screen size below which node animations are throttled
+    // (see VRONode::setAnimationLODEnabled)
+    float animationLODBias;
+
+    bool bloom;
+    bool shadows;
+    bool pbr;
+    bool hdr;
+};
+
+/*
+ Chooses a quality level for long-running sessions on devices that throttle. Level 0
+ is the quality the application configured; each level above it reduces more
+ (render scale, then bloom, shadows, particle budget and animation LOD, then PBR,
+ and finally HDR).
+
+ The level is the greater of two inputs. The thermal state, polled from the
+ platform about once a second, sets a minimum level; battery saver sets a minimum of
+ one. Independently, the frame time trend raises the level by one after frames
+ have run slow for a sustained period, and lowers it by one after a longer period
+ of frames on time with work to spare. Since frame intervals are quantized to the
+ display refresh, headroom is judged from the work time where it is known. Degrading is quick and restoring is slow, and the
+ wait before restoring doubles each time a restored level has to be abandoned
+ again shortly after, so the governor settles instead of oscillating. The thermal
+ minimum likewise only falls after the device has been cooler for a while.
+ */
+class VROQualityGovernor {
+public:
+
+    VROQualityGovernor(double targetFrameTime);
+    virtual ~VROQualityGovernor();
+
+    /*
+     Update the governor with the interval of the last frame and the time spent
+     working on it (the greater of its CPU and GPU time, or negative if unknown),
+     in milliseconds. Returns true if the level changed, after invoking the
+     callback.
+     */
+    bool update(double frameInterval, double frameWorkTime);
+
+    /*
+     Return to full quality and clear the frame time history.
+     */
+    void reset();
+
+    int getLevel() const {
+        return _level;
+    }
+    VROThermalState getThermalState() const {
+        return _thermalState;
+    }
+    bool isLowPowerModeEnabled() const {
+        return _lowPowerMode;
+    }
+    void setTargetFrameTime(double targetFrameTime) {
+        _targetFrameTime = targetFrameTime;
+    }
+
+    /*
+     Set a callback invoked on the rendering thread whenever the level changes,
+     with the new level and the thermal state at the time.
+     */
+    void setLevelChangedCallback(std::function<void(int level, VROThermalState thermalState)> callback) {
+        _callback = callback;
+    }
+
+    /*
+     Get the reductions applied at the given level.
+     */
+    static VROQualityLevelSettings getSettings(int level);
+
+private:
+
+    double _targetFrameTime;
+    int _level;
+
+    /*
+     The level chosen from frame times, and the minimum level imposed by the thermal
+     and battery state.
+     */
+    int _performanceLevel;
+    int _thermalLevel;
+
+    /*
+     Moving averages of the frame interval and work time, and how long (ms) frames
+     have continuously been slow, or on time with headroom.
+     */
+    double _averageFrameTime;
+    double _averageWorkTime;
+    double _slowTime;
+    double _fastTime;
+
+    /*
+     Time (ms) since the performance level last changed, the wait required before
+     restoring, and whether the last change was a restore.
+     */
+    double _timeSinceChange;
+    double _restoreDelay;
+    bool _lastChangeWasRestore;
+
+    /*
+     Platform state, the time since it was last polled, and the time the device
+     has been cooler than the current thermal minimum.
+     */
+    VROThermalState _thermalState;
+    bool _lowPowerMode;
+    double _timeSincePoll;
+    double _coolTime;
+
+    std::function<void(int, VROThermalState)> _callback;
+
+    void pollPlatformState(double elapsed);
+    void updatePerformanceLevel(double frameInterval, double frameWorkTime);
+
+};
+
+#endif /* VROQualityGovernor_h */
@@ -26,6 +26,7 @@
 
 #include "VROQuaternion.h"
 #include "VROMath.h"
+#include <string.h>
 
 // Constructor which converts euler angles to a quaternion
 VROQuaternion::VROQuaternion(float x, float y, float z) {
@@ -350,6 +351,44 @@ VROQuaternion VROQuaternion::slerp(VROQuaternion q1, VROQuaternion q2, float tim
 }
 
 
+// Quaternions are loaded into vectors in X, Y, Z, W order
+typedef float float4 __attribute__((__vector_size__(16), __aligned__(4)));
+
+void VROQuaternion::slerp(const VROQuaternion *q1, const VROQuaternion *q2, const float *times,
+                          int count, VROQuaternion *out, float threshold) {
+    static_assert(sizeof(VROQuaternion) == sizeof(float4), "VROQuaternion must be packed XYZW");
+    
+    for (int i = 0; i < count; i++) {
+        float4 a, b;
+        memcpy(&a, &q1[i].X, sizeof(float4));
+        memcpy(&b, &q2[i].X, sizeof(float4));
+        
+        float4 d = a * b;
+        float angle = d[0] + d[1] + d[2] + d[3];
+        
+        // make sure we use the short rotation
+        if (angle < 0.0f) {
+            a = -a;
+            angle = -angle;
+        }
+        
+        float time = times[i];
+        float scale, invscale;
+        if (angle <= (1 - threshold)) {
+            const float theta = acosf(angle);
+            const float invsintheta = VROMathReciprocal(sinf(theta));
+            scale = sinf(theta * (1.0f - time)) * invsintheta;
+            invscale = sinf(theta * time) * invsintheta;
+        } else { // linear interpolation
+            scale = 1.0f - time;
+            invscale = time;
+        }
+        
+        float4 result = a * scale + b * invscale;
+        memcpy(&out[i].X, &result, sizeof(float4));
+    }
+}
+
 // calculates the dot product
 float VROQuaternion::dotProduct(const VROQuaternion &q2) const {
     return (X * q2.X) + (Y * q2.Y) + (Z * q2.Z) + (W * q2.W);
@@ -167,6 +167,13 @@ class VROQuaternion {
 		static VROQuaternion slerp(VROQuaternion q1, VROQuaternion q2,
                                     float time, float threshold=.05f);
 
+		//! Spherically interpolate count pairs of quaternions at once
+		/** Equivalent to out[i] = slerp(q1[i], q2[i], times[i], threshold)
+		for each i, but computed with vector instructions. out may alias q1
+		or q2. */
+		static void slerp(const VROQuaternion *q1, const VROQuaternion *q2, const float *times,
+                          int count, VROQuaternion *out, float threshold=.05f);
+
 		//! Create quaternion from rotation angle and rotation axis.
 		/** Axis must be unit length.
 		The quaternion representing the rotation is
@@ -51,9 +51,10 @@ public:
         }
 
         recorder->bindToEglSurface();
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
         glViewport(_viewport.getX(), _viewport.getY(), _viewport.getWidth(), _viewport.getHeight());
         glScissor(_viewport.getX(), _viewport.getY(), _viewport.getWidth(), _viewport.getHeight());
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+        glClear(getLoadClearMask(true));
     }
 
     void invalidate() {
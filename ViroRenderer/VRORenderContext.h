@@ -36,13 +36,25 @@
 #include "VROQuaternion.h"
 #include "VROCamera.h"
 #include "VROFrameScheduler.h"
+#include "VRORendererConfiguration.h"
 
 class VROFrameSynchronizer;
 class VROTexture;
+class VROSphericalHarmonics;
+class VROLightClusterGrid;
+class VROOcclusionCuller;
+class VRORenderStatistics;
+class VROJobSystem;
+class VROFrameArena;
 class VROPencil;
 class VROInputControllerBase;
 enum class VROEyeType;
 
+/*
+ Number of views rendered by a multiview pass: one per eye.
+ */
+static const int kMultiviewNumViews = 2;
+
 /*
  Holds data specific to the current frame. Includes things like transformation
  matrices. There is nothing driver or device specific contained here.
@@ -58,7 +70,16 @@ public:
         _frame(0),
         _frameSynchronizer(synchronizer),
         _hdrEnabled(true),
-        _pbrEnabled(true) {
+        _pbrEnabled(true),
+        _clusteredLightingEnabled(false),
+        _multiviewEnabled(false),
+        _orderIndependentTransparencyEnabled(false),
+        _accumulatingTransparency(false),
+        _temporalAAEnabled(false),
+        _shadingRateLevel(VROShadingRateLevel::None),
+        _depthPrepassMode(VRODepthPrepassMode::Disabled),
+        _particleBudgetScale(1.0),
+        _animationLODBias(1.0) {
         
     }
     
@@ -109,16 +130,16 @@ public:
         _previousCamera = camera;
     }
     
-    VROMatrix4f getProjectionMatrix() const {
+    const VROMatrix4f &getProjectionMatrix() const {
         return _projectionMatrix;
     }
-    VROMatrix4f getViewMatrix() const {
+    const VROMatrix4f &getViewMatrix() const {
         return _viewMatrix;
     }
-    VROMatrix4f getEnclosureViewMatrix() const {
+    const VROMatrix4f &getEnclosureViewMatrix() const {
         return _enclosureViewMatrix;
     }
-    VROMatrix4f getOrthographicMatrix() const {
+    const VROMatrix4f &getOrthographicMatrix() const {
         return _orthographicMatrix;
     }
     
@@ -136,6 +157,13 @@ public:
         _irradianceMap = irradianceMap;
     }
 
+    std::shared_ptr<VROSphericalHarmonics> getIrradianceSphericalHarmonics() const {
+        return _irradianceSH;
+    }
+    void setIrradianceSphericalHarmonics(std::shared_ptr<VROSphericalHarmonics> sh) {
+        _irradianceSH = sh;
+    }
+
     std::shared_ptr<VROTexture> getPrefilteredMap() const {
         return _prefilteredMap;
     }
@@ -149,6 +177,56 @@ public:
     void setBRDFMap(std::shared_ptr<VROTexture> map) {
         _brdfMap = map;
     }
+
+    std::shared_ptr<VROLightClusterGrid> getLightClusters() const {
+        return _lightClusters;
+    }
+    void setLightClusters(std::shared_ptr<VROLightClusterGrid> clusters) {
+        _lightClusters = clusters;
+    }
+
+    /*
+     The frustums of the secondary views rendered this frame. Nodes within any of
+     them are visible, so that their sort keys are computed by the main frame's
+     update; each view then culls them to its own frustum.
+     */
+    const std::vector<VROFrustum> &getSecondaryViewFrustums() const {
+        return _secondaryViewFrustums;
+    }
+    void setSecondaryViewFrustums(std::vector<VROFrustum> frustums) {
+        _secondaryViewFrustums = frustums;
+    }
+
+    std::shared_ptr<VROOcclusionCuller> getOcclusionCuller() const {
+        return _occlusionCuller;
+    }
+    void setOcclusionCuller(std::shared_ptr<VROOcclusionCuller> culler) {
+        _occlusionCuller = culler;
+    }
+    bool isOcclusionCullingEnabled() const {
+        return _occlusionCuller != nullptr;
+    }
+
+    std::shared_ptr<VRORenderStatistics> getRenderStatistics() const {
+        return _renderStatistics;
+    }
+    void setRenderStatistics(std::shared_ptr<VRORenderStatistics> statistics) {
+        _renderStatistics = statistics;
+    }
+
+    std::shared_ptr<VROJobSystem> getJobSystem() const {
+        return _jobSystem;
+    }
+    void setJobSystem(std::shared_ptr<VROJobSystem> jobs) {
+        _jobSystem = jobs;
+    }
+
+    const std::shared_ptr<VROFrameArena> &getFrameArena() const {
+        return _frameArena;
+    }
+    void setFrameArena(std::shared_ptr<VROFrameArena> arena) {
+        _frameArena = arena;
+    }
     
     const VROCamera &getCamera() const {
         return _camera;
@@ -196,6 +274,105 @@ public:
         return _pbrEnabled;
     }
 
+    void setClusteredLightingEnabled(bool enabled) {
+        _clusteredLightingEnabled = enabled;
+    }
+    bool isClusteredLightingEnabled() const {
+        return _clusteredLightingEnabled;
+    }
+
+    /*
+     Multiview rendering draws both eyes in a single pass, each view reading its own
+     view and projection matrix. While enabled, materials are bound to multiview
+     shaders and the standard view and projection matrices refer to the left eye.
+     */
+    void setMultiviewMatrices(VROMatrix4f leftView, VROMatrix4f rightView,
+                              VROMatrix4f leftProjection, VROMatrix4f rightProjection) {
+        _multiviewViewMatrices[0] = leftView;
+        _multiviewViewMatrices[1] = rightView;
+        _multiviewProjectionMatrices[0] = leftProjection;
+        _multiviewProjectionMatrices[1] = rightProjection;
+    }
+    void setMultiviewEnabled(bool enabled) {
+        _multiviewEnabled = enabled;
+    }
+    bool isMultiviewEnabled() const {
+        return _multiviewEnabled;
+    }
+    VROMatrix4f getMultiviewViewMatrix(int view) const {
+        return _multiviewViewMatrices[view];
+    }
+    VROMatrix4f getMultiviewProjectionMatrix(int view) const {
+        return _multiviewProjectionMatrices[view];
+    }
+
+    /*
+     When order independent transparency is enabled, alpha blended geometry in
+     the root portal is not sorted or blended in the main pass; it is instead
+     accumulated in a separate pass, during which accumulating transparency is
+     true, and composited by the tone mapping pass.
+     */
+    void setOrderIndependentTransparencyEnabled(bool enabled) {
+        _orderIndependentTransparencyEnabled = enabled;
+    }
+    bool isOrderIndependentTransparencyEnabled() const {
+        return _orderIndependentTransparencyEnabled;
+    }
+    void setAccumulatingTransparency(bool accumulating) {
+        _accumulatingTransparency = accumulating;
+    }
+    bool isAccumulatingTransparency() const {
+        return _accumulatingTransparency;
+    }
+
+    /*
+     When temporal anti-aliasing is enabled, the projection matrix is jittered
+     each frame and materials write the velocity of each fragment to the HDR
+     target (see VROTemporalAntialiasingRenderPass).
+     */
+    void setTemporalAAEnabled(bool enabled) {
+        _temporalAAEnabled = enabled;
+    }
+    bool isTemporalAAEnabled() const {
+        return _temporalAAEnabled;
+    }
+
+    /*
+     The level of variable rate shading applied to the draws of this frame, or None
+     if variable rate shading is disabled or unsupported.
+     */
+    void setShadingRateLevel(VROShadingRateLevel level) {
+        _shadingRateLevel = level;
+    }
+    VROShadingRateLevel getShadingRateLevel() const {
+        return _shadingRateLevel;
+    }
+
+    void setDepthPrepassMode(VRODepthPrepassMode mode) {
+        _depthPrepassMode = mode;
+    }
+    VRODepthPrepassMode getDepthPrepassMode() const {
+        return _depthPrepassMode;
+    }
+
+    /*
+     Quality reductions set by the VROQualityGovernor: the fraction of each particle
+     emitter's maximum particles that may be alive, and the multiplier on the screen
+     size below which node animations are throttled.
+     */
+    void setParticleBudgetScale(float scale) {
+        _particleBudgetScale = scale;
+    }
+    float getParticleBudgetScale() const {
+        return _particleBudgetScale;
+    }
+    void setAnimationLODBias(float bias) {
+        _animationLODBias = bias;
+    }
+    float getAnimationLODBias() const {
+        return _animationLODBias;
+    }
+
 private:
     
     int _frame;
@@ -203,6 +380,15 @@ private:
     double _fps;
     bool _hdrEnabled;
     bool _pbrEnabled;
+    bool _clusteredLightingEnabled;
+    bool _multiviewEnabled;
+    bool _orderIndependentTransparencyEnabled;
+    bool _accumulatingTransparency;
+    bool _temporalAAEnabled;
+    VROShadingRateLevel _shadingRateLevel;
+    VRODepthPrepassMode _depthPrepassMode;
+    float _particleBudgetScale;
+    float _animationLODBias;
     
     /*
      The standard view and projection matrices. The view matrix is specific for
@@ -210,6 +396,13 @@ private:
      */
     VROMatrix4f _projectionMatrix;
     VROMatrix4f _viewMatrix;
+
+    /*
+     The per-eye view and projection matrices used by multiview passes, indexed
+     by view (0 is the left eye, 1 the right).
+     */
+    VROMatrix4f _multiviewViewMatrices[kMultiviewNumViews];
+    VROMatrix4f _multiviewProjectionMatrices[kMultiviewNumViews];
     
     /*
      The view matrix for camera enclosure objects (e.g. skyboxes).
@@ -252,6 +445,12 @@ private:
      */
     std::shared_ptr<VROTexture> _irradianceMap;
 
+    /*
+     Spherical harmonics used for PBR diffuse lighting in place of the irradiance
+     map, when no irradiance map is set.
+     */
+    std::shared_ptr<VROSphericalHarmonics> _irradianceSH;
+
     /*
      Prefiltered irradiance map used for PBR image-based specular lighting.
      */
@@ -262,6 +461,41 @@ private:
      */
     std::shared_ptr<VROTexture> _brdfMap;
 
+    /*
+     Lights binned into view frustum clusters for the current eye, used when
+     clustered lighting is enabled.
+     */
+    std::shared_ptr<VROLightClusterGrid> _lightClusters;
+
+    /*
+     Issues and collects hardware occlusion queries for the scene when
+     occlusion culling is enabled; null otherwise.
+     */
+    std::shared_ptr<VROOcclusionCuller> _occlusionCuller;
+    
+    /*
+     The frustums of this frame's secondary views.
+     */
+    std::vector<VROFrustum> _secondaryViewFrustums;
+
+    /*
+     Accumulates per-node and per-material render costs when render statistics
+     are enabled; null otherwise.
+     */
+    std::shared_ptr<VRORenderStatistics> _renderStatistics;
+
+    /*
+     Worker pool for parallelizing per-frame CPU work, or null if parallel scene
+     updates are disabled.
+     */
+    std::shared_ptr<VROJobSystem> _jobSystem;
+
+    /*
+     Linear allocator for scratch data that lives for the current frame. Reset
+     by the renderer at the end of each frame; render thread only.
+     */
+    std::shared_ptr<VROFrameArena> _frameArena;
+
     /*
      VROPencil is used for drawing a list of VROPolylines in a separate render pass,
      after having rendered the scene, mainly for representing debug information.
@@ -0,0 +1,341 @@
+//
+//  VRORenderGraph.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VRORenderGraph.h"
+#include "VRORenderTarget.h"
+#include "VRORenderTargetPool.h"
+#include "VRORenderContext.h"
+#include "VROLog.h"
+#include <algorithm>
+
+VRORenderGraph::VRORenderGraph(std::shared_ptr<VRORenderTargetPool> pool) :
+    _pool(pool),
+    _compiled(false),
+    _transientWidth(0),
+    _transientHeight(0),
+    _frame(nullptr) {
+}
+
+VRORenderGraph::~VRORenderGraph() {
+    for (VRORenderGraphResource &resource : _resources) {
+        releaseResource(resource);
+    }
+}
+
+#pragma mark - Declaration
+
+int VRORenderGraph::addResource(std::string name, VRORenderGraphResourceType type,
+                                VRORenderTargetType targetType, int numAttachments) {
+    passert_msg (_resourceIndices.find(name) == _resourceIndices.end(),
+                 "Render graph resource %s declared twice", name.c_str());
+    
+    VRORenderGraphResource resource;
+    resource.name = name;
+    resource.type = type;
+    resource.targetType = targetType;
+    resource.numAttachments = numAttachments;
+    resource.acquired = false;
+    resource.isOutput = false;
+    resource.lastUse = -1;
+    
+    _resourceIndices[name] = (int) _resources.size();
+    _resources.push_back(resource);
+    _compiled = false;
+    return (int) _resources.size() - 1;
+}
+
+void VRORenderGraph::importTarget(std::string name) {
+    addResource(name, VRORenderGraphResourceType::Imported, VRORenderTargetType::ColorTexture, 0);
+}
+
+void VRORenderGraph::declareTarget(std::string name, VRORenderTargetType type, int numAttachments) {
+    addResource(name, VRORenderGraphResourceType::Transient, type, numAttachments);
+}
+
+void VRORenderGraph::declareAlias(std::string name, std::vector<std::string> candidates) {
+    int index = addResource(name, VRORenderGraphResourceType::Alias, VRORenderTargetType::ColorTexture, 0);
+    for (std::string &candidate : candidates) {
+        int candidateIndex = getResourceIndex(candidate);
+        passert_msg (candidateIndex >= 0, "Render graph alias %s has undeclared candidate %s",
+                     name.c_str(), candidate.c_str());
+        _resources[index].candidates.push_back(candidateIndex);
+    }
+}
+
+void VRORenderGraph::addPass(std::string name, std::vector<std::string> reads, std::vector<std::string> writes,
+                             VRORenderGraphExecute execute, bool hasSideEffects) {
+    VRORenderGraphPass pass;
+    pass.name = name;
+    pass.execute = execute;
+    pass.hasSideEffects = hasSideEffects;
+    pass.valid = true;
+    
+    for (std::string &read : reads) {
+        int index = getResourceIndex(read);
+        if (index < 0) {
+            pwarn("Render graph pass %s reads undeclared resource %s", name.c_str(), read.c_str());
+            pass.valid = false;
+            continue;
+        }
+        pass.reads.push_back(index);
+    }
+    for (std::string &write : writes) {
+        int index = getResourceIndex(write);
+        if (index < 0) {
+            pwarn("Render graph pass %s writes undeclared resource %s", name.c_str(), write.c_str());
+            pass.valid = false;
+            continue;
+        }
+        pass.writes.push_back(index);
+    }
+    _passes.push_back(pass);
+    _compiled = false;
+}
+
+void VRORenderGraph::markOutput(std::string name) {
+    int index = getResourceIndex(name);
+    passert_msg (index >= 0, "Render graph output %s is undeclared", name.c_str());
+    _resources[index].isOutput = true;
+    _compiled = false;
+}
+
+bool VRORenderGraph::compile() {
+    int numResources = (int) _resources.size();
+    int numPasses = (int) _passes.size();
+    
+    /*
+     Validate in declaration order: a pass may only read resources that are imported
+     or produced by an earlier valid pass.
+     */
+    std::vector<bool> produced(numResources, false);
+    for (int r = 0; r < numResources; r++) {
+        produced[r] = _resources[r].type == VRORenderGraphResourceType::Imported;
+    }
+    for (VRORenderGraphPass &pass : _passes) {
+        if (!pass.valid) {
+            continue;
+        }
+        for (int read : pass.reads) {
+            if (!produced[read]) {
+                pwarn("Render graph pass %s reads %s before it is written: culling pass",
+                      pass.name.c_str(), _resources[read].name.c_str());
+                pass.valid = false;
+                break;
+            }
+        }
+        if (pass.valid) {
+            for (int write : pass.writes) {
+                produced[write] = true;
+            }
+        }
+    }
+    
+    /*
+     Cull in reverse: a pass survives if it has side effects, or writes a resource
+     that is an output of the graph or is read by a surviving pass.
+     */
+    std::vector<bool> needed(numResources, false);
+    for (int r = 0; r < numResources; r++) {
+        needed[r] = _resources[r].isOutput;
+    }
+    std::vector<bool> alive(numPasses, false);
+    for (int p = numPasses - 1; p >= 0; p--) {
+        VRORenderGraphPass &pass = _passes[p];
+        if (!pass.valid) {
+            continue;
+        }
+        bool contributes = pass.hasSideEffects;
+        for (int write : pass.writes) {
+            contributes |= needed[write];
+        }
+        if (!contributes) {
+            continue;
+        }
+        
+        alive[p] = true;
+        std::vector<int> reads;
+        for (int read : pass.reads) {
+            expand(read, &reads);
+        }
+        for (int read : reads) {
+            needed[read] = true;
+        }
+    }
+    
+    /*
+     Compute the last use of each resource over the surviving passes. Transients
+     are released after their last use, which is what lets later transients alias
+     their memory.
+     */
+    _compiledPasses.clear();
+    for (VRORenderGraphResource &resource : _resources) {
+        resource.lastUse = -1;
+    }
+    for (int p = 0; p < numPasses; p++) {
+        if (!alive[p]) {
+            continue;
+        }
+        int index = (int) _compiledPasses.size();
+        _compiledPasses.push_back(p);
+        
+        std::vector<int> used;
+        for (int read : _passes[p].reads) {
+            expand(read, &used);
+        }
+        for (int write : _passes[p].writes) {
+            expand(write, &used);
+        }
+        for (int r : used) {
+            _resources[r].lastUse = index;
+        }
+    }
+    
+    _releases.clear();
+    _releases.resize(_compiledPasses.size());
+    for (int r = 0; r < numResources; r++) {
+        const VRORenderGraphResource &resource = _resources[r];
+        if (resource.type == VRORenderGraphResourceType::Transient && resource.lastUse >= 0) {
+            _releases[resource.lastUse].push_back(r);
+        }
+    }
+    
+    _compiled = true;
+    return !_compiledPasses.empty();
+}
+
+void VRORenderGraph::clear() {
+    for (VRORenderGraphResource &resource : _resources) {
+        releaseResource(resource);
+    }
+    _resources.clear();
+    _resourceIndices.clear();
+    _passes.clear();
+    _compiledPasses.clear();
+    _releases.clear();
+    _compiled = false;
+}
+
+std::vector<std::string> VRORenderGraph::getCompiledPassNames() const {
+    std::vector<std::string> names;
+    for (int p : _compiledPasses) {
+        names.push_back(_passes[p].name);
+    }
+    return names;
+}
+
+void VRORenderGraph::expand(int resource, std::vector<int> *outResources) const {
+    outResources->push_back(resource);
+    for (int candidate : _resources[resource].candidates) {
+        outResources->push_back(candidate);
+    }
+}
+
+int VRORenderGraph::getResourceIndex(const std::string &name) const {
+    auto it = _resourceIndices.find(name);
+    if (it == _resourceIndices.end()) {
+        return -1;
+    }
+    return it->second;
+}
+
+#pragma mark - Execution
+
+void VRORenderGraph::setImportedTarget(std::string name, std::shared_ptr<VRORenderTarget> target) {
+    int index = getResourceIndex(name);
+    passert (index >= 0 && _resources[index].type == VRORenderGraphResourceType::Imported);
+    _resources[index].target = target;
+}
+
+void VRORenderGraph::setTransientSize(int width, int height) {
+    _transientWidth = width;
+    _transientHeight = height;
+}
+
+void VRORenderGraph::execute(VRORenderGraphFrame &frame) {
+    if (!_compiled) {
+        compile();
+    }
+    
+    _frame = &frame;
+    for (int i = 0; i < (int) _compiledPasses.size(); i++) {
+        VRORenderGraphPass &pass = _passes[_compiledPasses[i]];
+        pass.execute(*this, frame);
+        
+        for (int r : _releases[i]) {
+            releaseResource(_resources[r]);
+        }
+    }
+    _frame = nullptr;
+    
+    // Aliases and imports are rebound each frame
+    for (VRORenderGraphResource &resource : _resources) {
+        if (resource.type != VRORenderGraphResourceType::Transient) {
+            resource.target.reset();
+        }
+    }
+}
+
+std::shared_ptr<VRORenderTarget> VRORenderGraph::getTarget(const std::string &name, bool hydrate) {
+    int index = getResourceIndex(name);
+    if (index < 0) {
+        pwarn("Render graph resource %s is undeclared", name.c_str());
+        return nullptr;
+    }
+    
+    VRORenderGraphResource &resource = _resources[index];
+    if (resource.type == VRORenderGraphResourceType::Transient && !resource.target) {
+        passert_msg (_frame != nullptr, "Render graph transient %s retrieved outside execution", name.c_str());
+        resource.target = _pool->acquire(resource.targetType, resource.numAttachments,
+                                         _transientWidth, _transientHeight,
+                                         _frame->context->getFrame(), _frame->driver);
+        resource.acquired = true;
+    }
+    if (hydrate && resource.type == VRORenderGraphResourceType::Transient && !resource.target->hydrate()) {
+        pwarn("Render graph transient %s creation failed", name.c_str());
+    }
+    return resource.target;
+}
+
+std::shared_ptr<VROTexture> VRORenderGraph::getTexture(const std::string &name, int attachment) {
+    std::shared_ptr<VRORenderTarget> target = getTarget(name);
+    if (!target) {
+        return nullptr;
+    }
+    return target->getTexture(attachment);
+}
+
+void VRORenderGraph::setAliasTarget(const std::string &name, std::shared_ptr<VRORenderTarget> target) {
+    int index = getResourceIndex(name);
+    passert (index >= 0 && _resources[index].type == VRORenderGraphResourceType::Alias);
+    _resources[index].target = target;
+}
+
+void VRORenderGraph::releaseResource(VRORenderGraphResource &resource) {
+    if (resource.acquired) {
+        _pool->release(resource.target);
+        resource.acquired = false;
+    }
+    resource.target.reset();
+}
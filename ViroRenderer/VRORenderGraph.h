@@ -0,0 +1,243 @@
+//
+//  VRORenderGraph.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VRORenderGraph_h
+#define VRORenderGraph_h
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <map>
+#include <functional>
+
+class VROScene;
+class VRODriver;
+class VROTexture;
+class VRORenderContext;
+class VRORenderTarget;
+class VRORenderTargetPool;
+class VRORenderMetadata;
+class VRORenderGraph;
+enum class VRORenderTargetType;
+
+/*
+ The per-frame state handed to each pass of a render graph as it executes.
+ */
+class VRORenderGraphFrame {
+public:
+    std::shared_ptr<VROScene> scene;
+    std::shared_ptr<VROScene> outgoingScene;
+    std::shared_ptr<VRORenderMetadata> metadata;
+    VRORenderContext *context;
+    std::shared_ptr<VRODriver> driver;
+};
+
+/*
+ The function that renders a render graph pass. Passes retrieve the render
+ targets of the resources they declared from the graph.
+ */
+typedef std::function<void(VRORenderGraph &graph, VRORenderGraphFrame &frame)> VRORenderGraphExecute;
+
+/*
+ The kinds of resource (render target) in a render graph.
+
+ Imported:  A target owned outside the graph (e.g. the display, or the HDR target),
+            bound each frame with setImportedTarget.
+ Transient: A full-screen target allocated by the graph from its VRORenderTargetPool
+            when first retrieved, and released after the last pass that uses it, so
+            that transients with disjoint lifetimes alias the same memory.
+ Alias:     A name for a target chosen by its producing pass at execution time (via
+            setAliasTarget); e.g. whichever ping-pong target holds the final result
+            of post-processing. Readers of an alias extend the lifetimes of each of
+            the candidate resources it may refer to.
+ */
+enum class VRORenderGraphResourceType {
+    Imported,
+    Transient,
+    Alias,
+};
+
+/*
+ A declarative render graph. Passes declare the resources they read and write, and
+ the graph, when compiled:
+
+ 1. Validates the order of the passes: each resource a pass reads must be imported,
+    or written by an earlier pass. Passes that fail validation are culled.
+ 2. Culls passes that neither have side effects nor contribute (transitively) to an
+    output resource.
+ 3. Computes the lifetime of each transient resource over the surviving passes, so
+    that executing the graph allocates each transient from the pool just in time and
+    releases it as soon as its last reader completes.
+
+ Passes execute in declaration order. In OpenGL the driver orders the writes to a
+ target before later reads of it, so the graph inserts no explicit barriers; each
+ pass binds its targets with the load and store actions it needs (see
+ VRORenderTargetActions).
+
+ The graph is intended to be rebuilt only when the rendering configuration changes,
+ and executed every frame.
+ */
+class VRORenderGraph {
+public:
+    
+    VRORenderGraph(std::shared_ptr<VRORenderTargetPool> pool);
+    virtual ~VRORenderGraph();
+    
+#pragma mark - Declaration
+    
+    /*
+     Declare a resource owned outside the graph. Its target is bound each frame
+     with setImportedTarget.
+     */
+    void importTarget(std::string name);
+    
+    /*
+     Declare a transient resource, allocated by the graph with the given type and
+     number of attachments, at the transient size (see setTransientSize).
+     */
+    void declareTarget(std::string name, VRORenderTargetType type, int numAttachments);
+    
+    /*
+     Declare an alias, set by its producing pass at execution time to the target of
+     one of the given candidate resources, or to a target owned by the pass itself
+     (in which case there are no candidates).
+     */
+    void declareAlias(std::string name, std::vector<std::string> candidates);
+    
+    /*
+     Add a pass that reads and writes the given resources. Passes with side effects
+     (e.g. notifying a delegate) are never culled.
+     */
+    void addPass(std::string name, std::vector<std::string> reads, std::vector<std::string> writes,
+                 VRORenderGraphExecute execute, bool hasSideEffects = false);
+    
+    /*
+     Mark the given resource as an output of the graph. Passes that do not contribute
+     to an output are culled.
+     */
+    void markOutput(std::string name);
+    
+    /*
+     Validate, cull, and compute the resource lifetimes of the graph. Returns false
+     if no pass survived. Must be invoked after the last declaration, and before
+     executing the graph.
+     */
+    bool compile();
+    
+    /*
+     Remove all passes and resources.
+     */
+    void clear();
+    
+    /*
+     Get the names of the passes that survived compilation, in execution order.
+     */
+    std::vector<std::string> getCompiledPassNames() const;
+    
+#pragma mark - Execution
+    
+    /*
+     Bind the target for an imported resource, and set the size of the transient
+     resources. Invoked before each execution.
+     */
+    void setImportedTarget(std::string name, std::shared_ptr<VRORenderTarget> target);
+    void setTransientSize(int width, int height);
+    
+    /*
+     Execute the compiled passes.
+     */
+    void execute(VRORenderGraphFrame &frame);
+    
+    /*
+     Get the target of the given resource. Invoked by passes during execution. A
+     transient target is allocated on first retrieval, and hydrated if requested;
+     passes that may not end up rendering to a transient (e.g. post-process ping-pong
+     targets) can defer hydration to whoever renders to it.
+     */
+    std::shared_ptr<VRORenderTarget> getTarget(const std::string &name, bool hydrate = true);
+    std::shared_ptr<VROTexture> getTexture(const std::string &name, int attachment = 0);
+    
+    /*
+     Set the target for an alias. Invoked by the alias' producing pass.
+     */
+    void setAliasTarget(const std::string &name, std::shared_ptr<VRORenderTarget> target);
+    
+private:
+    
+    struct VRORenderGraphResource {
+        std::string name;
+        VRORenderGraphResourceType type;
+        VRORenderTargetType targetType;
+        int numAttachments;
+        std::vector<int> candidates;
+        
+        // The target this frame, and whether it was acquired from the pool
+        std::shared_ptr<VRORenderTarget> target;
+        bool acquired;
+        
+        // Whether the resource is an output of the graph, and the index of the
+        // compiled pass after which it is released (-1 if no pass uses it)
+        bool isOutput;
+        int lastUse;
+    };
+    
+    struct VRORenderGraphPass {
+        std::string name;
+        std::vector<int> reads;
+        std::vector<int> writes;
+        VRORenderGraphExecute execute;
+        bool hasSideEffects;
+        bool valid;
+    };
+    
+    std::shared_ptr<VRORenderTargetPool> _pool;
+    std::vector<VRORenderGraphResource> _resources;
+    std::map<std::string, int> _resourceIndices;
+    std::vector<VRORenderGraphPass> _passes;
+    
+    /*
+     The indices of the passes that survived compilation, and for each, the
+     transient resources to release once it completes.
+     */
+    std::vector<int> _compiledPasses;
+    std::vector<std::vector<int>> _releases;
+    bool _compiled;
+    
+    int _transientWidth, _transientHeight;
+    VRORenderGraphFrame *_frame;
+    
+    int addResource(std::string name, VRORenderGraphResourceType type, VRORenderTargetType targetType,
+                    int numAttachments);
+    int getResourceIndex(const std::string &name) const;
+    void releaseResource(VRORenderGraphResource &resource);
+    
+    /*
+     Append the given resource to the list, expanding aliases into their candidates.
+     */
+    void expand(int resource, std::vector<int> *outResources) const;
+    
+};
+
+#endif /* VRORenderGraph_h */
@@ -0,0 +1,65 @@
+//
+//  VRORenderInvalidation.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef VRORenderInvalidation_h
+#define VRORenderInvalidation_h
+
+#include <atomic>
+#include <stdint.h>
+
+/*
+ Process-wide signal that something affecting the rendered image has changed.
+ Scene mutations (animatable properties, materials, graph structure, atomic
+ property writes) and renderer task dispatches invalidate; the renderer uses
+ the generation to decide whether a frame can be skipped when render-on-demand
+ is enabled. Invalidating is a single relaxed atomic increment, so it is safe
+ and cheap from any thread.
+ */
+class VRORenderInvalidation {
+public:
+
+    static void invalidate() {
+        getCounter().fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /*
+     Monotonically increasing; a change in value since the last frame means the
+     scene may have changed.
+     */
+    static uint64_t getGeneration() {
+        return getCounter().load(std::memory_order_relaxed);
+    }
+
+private:
+
+    static std::atomic<uint64_t> &getCounter() {
+        static std::atomic<uint64_t> sGeneration(0);
+        return sGeneration;
+    }
+
+};
+
+#endif /* VRORenderInvalidation_h */
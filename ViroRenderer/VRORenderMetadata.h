@@ -27,6 +27,10 @@
 #ifndef VRORenderMetadata_h
 #define VRORenderMetadata_h
 
+#include <vector>
+
+class VRONode;
+
 /*
  The VRORenderMetadata collects scene-wide information about the
  forthcoming render during the updateSortKeys() phase of the render loop.
@@ -55,6 +59,13 @@ public:
         return _postProcessMaskPass;
     }
     
+    void addImpostorCapture(VRONode *node) {
+        _impostorCaptures.push_back(node);
+    }
+    const std::vector<VRONode *> &getImpostorCaptures() const {
+        return _impostorCaptures;
+    }
+    
 private:
     
     /*
@@ -69,5 +80,11 @@ private:
      */
     bool _postProcessMaskPass;
     
+    /*
+     Nodes whose geometry's impostor must be captured before it can be
+     rendered (see VROImpostor).
+     */
+    std::vector<VRONode *> _impostorCaptures;
+    
 };
 #endif /* VRORenderMetadata_h */
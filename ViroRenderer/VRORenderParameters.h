@@ -29,31 +29,73 @@
 
 #include <vector>
 #include <stack>
+#include <memory>
 #include "VROMatrix4f.h"
+#include "VROFrameArena.h"
 
-class VROLight;
+class VROLightBins;
+
+/*
+ Number of levels of the scene graph the per-frame stacks reserve upfront.
+ */
+static const int kRenderParametersReservedDepth = 32;
 
 /*
  Contains the per-frame render parameters for the current
- render pass.
+ render pass. The stacks are allocated from the given frame
+ arena, if any.
  */
 class VRORenderParameters {
     
 public:
     
-    std::stack<float> opacities;
-    std::vector<std::shared_ptr<VROLight>> lights;
-    std::stack<int> hierarchyDepths;
-    std::stack<float> distancesFromCamera;
+    std::stack<float, VROFrameVector<float>> opacities;
+    std::stack<int, VROFrameVector<int>> hierarchyDepths;
+    std::stack<float, VROFrameVector<float>> distancesFromCamera;
     int hierarchyId;
     float furthestDistanceFromCamera;
+
+    /*
+     The binned lights of the scene, against which each node culls its lights.
+     Not owned; the bins must outlive the traversal. Null if there are no lights.
+     */
+    const VROLightBins *lightBins;
+
+    /*
+     Changes whenever the lights, or any light property that affects culling,
+     change. Nodes skip light culling when this and their bounds are unchanged.
+     */
+    uint32_t lightCullingVersion;
+
+    /*
+     Statistics: the number of nodes visited, and the number of those whose
+     cached inverse-transpose transform or light list had to be recomputed.
+     */
+    int nodesVisited;
+    int nodesRevalidated;
     
-    VRORenderParameters() {
+    VRORenderParameters(VROFrameArena *arena = nullptr) :
+        opacities(reserved<float>(arena)),
+        hierarchyDepths(reserved<int>(arena)),
+        distancesFromCamera(reserved<float>(arena)) {
         opacities.push(1.0);
         hierarchyDepths.push(-1);
         hierarchyId = 0;
         furthestDistanceFromCamera = 0;
         distancesFromCamera.push(0);
+        lightBins = nullptr;
+        lightCullingVersion = 0;
+        nodesVisited = 0;
+        nodesRevalidated = 0;
+    }
+
+private:
+
+    template <typename T>
+    static VROFrameVector<T> reserved(VROFrameArena *arena) {
+        VROFrameVector<T> vector((VROFrameAllocator<T>(arena)));
+        vector.reserve(kRenderParametersReservedDepth);
+        return vector;
     }
     
 };
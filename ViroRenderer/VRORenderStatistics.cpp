@@ -0,0 +1,309 @@
+//
+//  VRORenderStatistics.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include "VRORenderStatistics.h"
+#include "VRONode.h"
+#include "VROMaterial.h"
+#include "VROGeometry.h"
+#include "VROGeometryElement.h"
+#include "VROShaderProgram.h"
+#include "VRODriver.h"
+#include <algorithm>
+#include <sstream>
+
+// Frames after which a GPU sample that never completed is discarded
+static const int kMaxGPUSampleLatency = 8;
+
+static void writeEscaped(std::stringstream &ss, const std::string &str) {
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            ss << '\\' << c;
+        }
+        else if ((unsigned char) c >= 0x20) {
+            ss << c;
+        }
+    }
+}
+
+VRORenderStatistics::VRORenderStatistics(int gpuSampleInterval) :
+    _gpuSampleInterval(std::max(gpuSampleInterval, 1)),
+    _frames(0),
+    _sampledFrames(0),
+    _frame(0),
+    _gpuSampleFrame(false),
+    _frameSampled(false),
+    _drawMaterial(nullptr),
+    _drawMaterialId(0),
+    _drawSampling(false),
+    _drawSerial(0) {
+    
+}
+
+VRORenderStatistics::~VRORenderStatistics() {
+    
+}
+
+void VRORenderStatistics::setGPUSampleInterval(int gpuSampleInterval) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _gpuSampleInterval = std::max(gpuSampleInterval, 1);
+}
+
+void VRORenderStatistics::beginFrame(int frame) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _frame = frame;
+    _frames++;
+    _gpuSampleFrame = (frame % _gpuSampleInterval) == 0;
+    _frameSampled = false;
+    
+    for (auto it = _pendingBatches.begin(); it != _pendingBatches.end();) {
+        if (frame - it->second.frame > kMaxGPUSampleLatency) {
+            it = _pendingBatches.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+void VRORenderStatistics::beginDraw(const std::shared_ptr<VROMaterial> &material, std::shared_ptr<VRODriver> &driver) {
+    _drawNodes.clear();
+    _drawMaterialId = material->getMaterialId();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _drawMaterial = &getTotals(_materials, _drawMaterialId, material->getName());
+    }
+    
+    _drawSampling = false;
+    if (_gpuSampleFrame) {
+        int serial = ++_drawSerial;
+        std::weak_ptr<VRORenderStatistics> statistics_w = shared_from_this();
+        _drawSampling = driver->beginGPUSample([statistics_w, serial](uint64_t elapsedNs) {
+            std::shared_ptr<VRORenderStatistics> statistics = statistics_w.lock();
+            if (statistics) {
+                statistics->onGPUSample(serial, elapsedNs);
+            }
+        });
+    }
+}
+
+void VRORenderStatistics::addDraw(VRONode *node, int elementIndex) {
+    _drawNodes.push_back({ node, elementIndex });
+}
+
+void VRORenderStatistics::endDraw(std::shared_ptr<VRODriver> &driver) {
+    if (_drawSampling) {
+        driver->endGPUTimer();
+    }
+    const std::shared_ptr<VROShaderProgram> &shader = driver->getBoundShader();
+    
+    // The material totals are cleared if statistics were reset during the draw
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_drawNodes.empty() || !_drawMaterial) {
+        return;
+    }
+    double share = 1.0 / _drawNodes.size();
+    
+    VRORenderStatisticsBatch batch;
+    batch.materialId = _drawMaterialId;
+    batch.frame = _frame;
+    
+    _drawMaterial->drawCalls += 1;
+    setShader(*_drawMaterial, shader);
+    for (std::pair<VRONode *, int> &draw : _drawNodes) {
+        VRONode *node = draw.first;
+        int triangles = 0;
+        
+        const std::shared_ptr<VROGeometry> &geometry = node->getGeometry();
+        if (geometry && draw.second < geometry->getGeometryElements().size()) {
+            const std::shared_ptr<VROGeometryElement> &element = geometry->getGeometryElements()[draw.second];
+            if (element->getPrimitiveType() == VROGeometryPrimitiveType::Triangle ||
+                element->getPrimitiveType() == VROGeometryPrimitiveType::TriangleStrip) {
+                triangles = element->getPrimitiveCount();
+            }
+        }
+        
+        VRORenderStatisticsTotals &totals = getTotals(_nodes, node->getUniqueID(), node->getName());
+        totals.drawCalls += share;
+        totals.triangles += triangles;
+        setShader(totals, shader);
+        
+        _drawMaterial->triangles += triangles;
+        if (_drawSampling) {
+            batch.nodeIds.push_back(node->getUniqueID());
+        }
+    }
+    
+    if (_drawSampling) {
+        _pendingBatches[_drawSerial] = batch;
+        if (!_frameSampled) {
+            _frameSampled = true;
+            _sampledFrames++;
+        }
+    }
+    _drawMaterial = nullptr;
+}
+
+VRORenderStatistics::VRORenderStatisticsTotals &VRORenderStatistics::getTotals(std::map<int, VRORenderStatisticsTotals> &totals,
+                                                                                int id, const std::string &name) {
+    auto it = totals.find(id);
+    if (it == totals.end()) {
+        VRORenderStatisticsTotals entry;
+        entry.name = name;
+        entry.shaderProgram = nullptr;
+        entry.drawCalls = 0;
+        entry.triangles = 0;
+        entry.gpuTimeNs = 0;
+        entry.gpuSamples = 0;
+        it = totals.emplace(id, entry).first;
+    }
+    return it->second;
+}
+
+void VRORenderStatistics::setShader(VRORenderStatisticsTotals &totals, const std::shared_ptr<VROShaderProgram> &shader) {
+    if (shader && shader.get() != totals.shaderProgram) {
+        totals.shaderProgram = shader.get();
+        totals.shader = shader->getName();
+    }
+}
+
+void VRORenderStatistics::onGPUSample(int serial, uint64_t elapsedNs) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _pendingBatches.find(serial);
+    if (it == _pendingBatches.end()) {
+        return;
+    }
+    
+    VRORenderStatisticsBatch &batch = it->second;
+    if (!batch.nodeIds.empty()) {
+        double share = elapsedNs / (double) batch.nodeIds.size();
+        for (int nodeId : batch.nodeIds) {
+            auto node = _nodes.find(nodeId);
+            if (node != _nodes.end()) {
+                node->second.gpuTimeNs += share;
+                node->second.gpuSamples++;
+            }
+        }
+    }
+    auto material = _materials.find(batch.materialId);
+    if (material != _materials.end()) {
+        material->second.gpuTimeNs += elapsedNs;
+        material->second.gpuSamples++;
+    }
+    _pendingBatches.erase(it);
+}
+
+std::vector<VRORenderStatisticsEntry> VRORenderStatistics::getTopNodes(int n, VRORenderStatisticsSort sort) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return getTop(_nodes, n, sort);
+}
+
+std::vector<VRORenderStatisticsEntry> VRORenderStatistics::getTopMaterials(int n, VRORenderStatisticsSort sort) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return getTop(_materials, n, sort);
+}
+
+std::vector<VRORenderStatisticsEntry> VRORenderStatistics::getTop(const std::map<int, VRORenderStatisticsTotals> &totals,
+                                                                  int n, VRORenderStatisticsSort sort) {
+    std::vector<VRORenderStatisticsEntry> entries;
+    entries.reserve(totals.size());
+    
+    double frames = std::max(_frames, 1);
+    for (const auto &kv : totals) {
+        const VRORenderStatisticsTotals &total = kv.second;
+        
+        VRORenderStatisticsEntry entry;
+        entry.id = kv.first;
+        entry.name = total.name;
+        entry.shader = total.shader;
+        entry.drawCalls = total.drawCalls / frames;
+        entry.triangles = total.triangles / frames;
+        entry.gpuTime = (total.gpuSamples > 0 && _sampledFrames > 0) ? total.gpuTimeNs / _sampledFrames / 1e6 : -1;
+        entries.push_back(entry);
+    }
+    
+    auto cost = [sort](const VRORenderStatisticsEntry &entry) {
+        switch (sort) {
+            case VRORenderStatisticsSort::DrawCalls:
+                return entry.drawCalls;
+            case VRORenderStatisticsSort::Triangles:
+                return entry.triangles;
+            default:
+                return entry.gpuTime;
+        }
+    };
+    
+    size_t count = std::min((size_t) std::max(n, 0), entries.size());
+    std::partial_sort(entries.begin(), entries.begin() + count, entries.end(),
+                      [&cost](const VRORenderStatisticsEntry &a, const VRORenderStatisticsEntry &b) {
+                          return cost(a) > cost(b);
+                      });
+    entries.resize(count);
+    return entries;
+}
+
+std::string VRORenderStatistics::toJSON(int n, VRORenderStatisticsSort sort) {
+    std::vector<VRORenderStatisticsEntry> nodes = getTopNodes(n, sort);
+    std::vector<VRORenderStatisticsEntry> materials = getTopMaterials(n, sort);
+    
+    auto writeEntries = [](std::stringstream &ss, const std::vector<VRORenderStatisticsEntry> &entries) {
+        ss << "[";
+        for (size_t i = 0; i < entries.size(); i++) {
+            const VRORenderStatisticsEntry &entry = entries[i];
+            if (i > 0) {
+                ss << ",";
+            }
+            ss << "{\"id\":" << entry.id << ",\"name\":\"";
+            writeEscaped(ss, entry.name);
+            ss << "\",\"shader\":\"";
+            writeEscaped(ss, entry.shader);
+            ss << "\",\"drawCalls\":" << entry.drawCalls << ",\"triangles\":" << entry.triangles
+               << ",\"gpuTime\":" << entry.gpuTime << "}";
+        }
+        ss << "]";
+    };
+    
+    std::stringstream ss;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        ss << "{\"frames\":" << _frames << ",\"sampledFrames\":" << _sampledFrames << ",\"nodes\":";
+    }
+    writeEntries(ss, nodes);
+    ss << ",\"materials\":";
+    writeEntries(ss, materials);
+    ss << "}";
+    return ss.str();
+}
+
+void VRORenderStatistics::reset() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _nodes.clear();
+    _materials.clear();
+    _pendingBatches.clear();
+    _frames = 0;
+    _sampledFrames = 0;
+    _frameSampled = false;
+    _drawMaterial = nullptr;
+}
@@ -0,0 +1,185 @@
+//
+//  VRORenderStatistics.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VRORenderStatistics_h
+#define VRORenderStatistics_h
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <map>
+#include <stdint.h>
+
+class VRONode;
+class VROMaterial;
+class VRODriver;
+class VROShaderProgram;
+
+/*
+ The quantity by which render statistics are ranked.
+ */
+enum class VRORenderStatisticsSort {
+    DrawCalls,
+    Triangles,
+    GPUTime,
+};
+
+/*
+ The render cost of a node or material, averaged per frame across every eye
+ and pass rendered since statistics were last reset. Draw calls shared by an
+ instanced or multi-draw batch are divided evenly between the nodes of the
+ batch, as is the batch's GPU time.
+ */
+struct VRORenderStatisticsEntry {
+    int id;
+    std::string name;
+    
+    /*
+     The shader variant most recently used to render this node or material.
+     */
+    std::string shader;
+    
+    double drawCalls;
+    double triangles;
+    
+    /*
+     Approximate GPU time in ms, from timer queries issued on sampled frames.
+     Negative if no sample has completed.
+     */
+    double gpuTime;
+};
+
+/*
+ Accumulates per-node and per-material render statistics during
+ VROPortal::renderContents, so that the nodes and materials that consume the
+ most of the frame budget can be found. GPU time is sampled with timer queries
+ once every gpuSampleInterval frames, since a query per draw is too costly to
+ issue every frame; samples are skipped while the profiler is timing the
+ enclosing render pass, as GPU timers can not nest.
+ 
+ Statistics are recorded on the rendering thread and may be queried from any
+ thread.
+ */
+class VRORenderStatistics : public std::enable_shared_from_this<VRORenderStatistics> {
+public:
+    
+    VRORenderStatistics(int gpuSampleInterval);
+    virtual ~VRORenderStatistics();
+    
+    /*
+     Set the number of frames between GPU time samples.
+     */
+    void setGPUSampleInterval(int gpuSampleInterval);
+    
+    /*
+     Invoked at the start of each frame.
+     */
+    void beginFrame(int frame);
+    
+    /*
+     Bracket a draw. Between the two calls, add each node drawn by the draw:
+     one for regular draws, or each node of an instanced or multi-draw batch.
+     The material and the currently bound shader are attributed the draw.
+     */
+    void beginDraw(const std::shared_ptr<VROMaterial> &material, std::shared_ptr<VRODriver> &driver);
+    void addDraw(VRONode *node, int elementIndex);
+    void endDraw(std::shared_ptr<VRODriver> &driver);
+    
+    /*
+     Get the n most expensive nodes or materials, ranked by the given quantity.
+     */
+    std::vector<VRORenderStatisticsEntry> getTopNodes(int n, VRORenderStatisticsSort sort);
+    std::vector<VRORenderStatisticsEntry> getTopMaterials(int n, VRORenderStatisticsSort sort);
+    
+    /*
+     Get the n most expensive nodes and materials as JSON.
+     */
+    std::string toJSON(int n, VRORenderStatisticsSort sort);
+    
+    /*
+     Clear all accumulated statistics.
+     */
+    void reset();
+    
+private:
+    
+    /*
+     Totals accumulated for a node or material.
+     */
+    struct VRORenderStatisticsTotals {
+        std::string name;
+        std::string shader;
+        const VROShaderProgram *shaderProgram;
+        double drawCalls;
+        double triangles;
+        double gpuTimeNs;
+        int gpuSamples;
+    };
+    
+    /*
+     The nodes and material of a batch whose GPU time is pending.
+     */
+    struct VRORenderStatisticsBatch {
+        std::vector<int> nodeIds;
+        int materialId;
+        int frame;
+    };
+    
+    std::mutex _mutex;
+    int _gpuSampleInterval;
+    int _frames;
+    int _sampledFrames;
+    int _frame;
+    bool _gpuSampleFrame;
+    bool _frameSampled;
+    
+    std::map<int, VRORenderStatisticsTotals> _nodes;
+    std::map<int, VRORenderStatisticsTotals> _materials;
+    
+    /*
+     The draw being recorded.
+     */
+    VRORenderStatisticsTotals *_drawMaterial;
+    int _drawMaterialId;
+    std::vector<std::pair<VRONode *, int>> _drawNodes;
+    bool _drawSampling;
+    int _drawSerial;
+    
+    /*
+     Batches awaiting their GPU timer results, by serial.
+     */
+    std::map<int, VRORenderStatisticsBatch> _pendingBatches;
+    
+    VRORenderStatisticsTotals &getTotals(std::map<int, VRORenderStatisticsTotals> &totals, int id,
+                                         const std::string &name);
+    void setShader(VRORenderStatisticsTotals &totals, const std::shared_ptr<VROShaderProgram> &shader);
+    void onGPUSample(int serial, uint64_t elapsedNs);
+    std::vector<VRORenderStatisticsEntry> getTop(const std::map<int, VRORenderStatisticsTotals> &totals,
+                                                 int n, VRORenderStatisticsSort sort);
+    
+};
+
+#endif /* VRORenderStatistics_h */
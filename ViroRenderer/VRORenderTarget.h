@@ -28,12 +28,16 @@
 #define VRORenderTarget_h
 
 #include <memory>
+#include <vector>
+#include <algorithm>
+#include "VROVector3f.h"
 #include "VROVector4f.h"
 #include "VROViewport.h"
 #include "VROLog.h"
 
 class VROTexture;
 class VRODriver;
+class VROData;
 enum class VROFace;
 
 /*
@@ -55,6 +59,7 @@ enum class VRORenderTargetType {
     ColorTextureSRGB,   // Uses a color texture and converts to sRGB space on write
     ColorTextureHDR16,  // Uses a Float16 color texture and a depth renderbuffer
     ColorTextureHDR32,  // Uses a Float32 color texture and a depth renderbuffer
+    ColorTextureHDR16Multiview, // Uses Float16 color texture arrays and a depth/stencil texture array, one layer per view
     DepthTexture,       // Uses a depth texture and no color buffer
     DepthTextureArray,  // Uses a depth texture array no color buffer
     CubeTexture,        // Uses a color texture and a depth renderbuffer
@@ -62,6 +67,36 @@ enum class VRORenderTargetType {
     CubeTextureHDR32,   // Uses a Float32 color texture and a depth renderbuffer
 };
 
+/*
+ Storage formats for individual color attachments, overriding the format implied by
+ the render target type. These reduce bandwidth for attachments that do not need the
+ full precision of their target.
+
+ Default:    The format implied by the render target type.
+ R11G11B10F: Packed float RGB with no alpha channel; alpha is sampled as 1.0. Half the
+             size of RGBA16F. Requires VRODriver::isPackedFloatRenderTargetSupported.
+ R8:         A single 8-bit channel, for masks that only store their red channel.
+ RG16F:      Two half float channels, for screen-space vectors such as velocities.
+             Cleared to zero (rather than the clear color) when color is cleared.
+ */
+enum class VROAttachmentFormat {
+    Default,
+    R11G11B10F,
+    R8,
+    RG16F,
+};
+
+/*
+ The rate at which fragments are shaded: each fragment shader invocation covers a
+ block of the given number of pixels along each axis. Coarser rates reduce fill cost
+ for content that does not need per-pixel detail. See VRODriver::setShadingRate.
+ */
+enum class VROShadingRate {
+    Rate1x1,
+    Rate2x2,
+    Rate4x4,
+};
+
 /*
  Possible stencil functions. Stenciling is owned by the render target.
  */
@@ -76,6 +111,82 @@ enum class VROStencilFunc {
     Always
 };
 
+/*
+ What to do with the prior contents of an attachment when its render target is bound.
+
+ Clear:    Clear the attachment (to the clear color for color attachments).
+ DontCare: The prior contents are not needed, because the pass overwrites every pixel
+           (with blending disabled), clears the attachment itself, or does not use it.
+           Tiled GPUs skip both the clear and the load of the attachment into tile memory.
+ Load:     Preserve the prior contents.
+ */
+enum class VROLoadAction {
+    Clear,
+    DontCare,
+    Load,
+};
+
+/*
+ What to do with the contents of an attachment once the pass is complete; applied when
+ the render target is unbound with VRORenderTargetUnbindOp::Invalidate.
+
+ Store:   Keep the contents, because they are sampled or blitted by a later pass.
+ Discard: The contents are no longer needed. Tiled GPUs skip writing them back from tile
+          memory.
+ */
+enum class VROStoreAction {
+    Store,
+    Discard,
+};
+
+/*
+ The load and store actions for each kind of attachment of a render target, declared by
+ each render pass when it binds its target (see VRODriver::bindRenderTarget). These map
+ to glClear and glInvalidateFramebuffer in OpenGL, and to MTLLoadAction and MTLStoreAction
+ in Metal.
+ */
+class VRORenderTargetActions {
+public:
+    
+    /*
+     Clear all attachments on bind, keep the color attachments, and discard depth and
+     stencil. This is the default behavior of every render target.
+     */
+    static VRORenderTargetActions clearAll() {
+        return VRORenderTargetActions(VROLoadAction::Clear, VROLoadAction::Clear, VROLoadAction::Clear,
+                                      VROStoreAction::Store, VROStoreAction::Discard, VROStoreAction::Discard);
+    }
+    
+    /*
+     For passes that write every pixel of the color attachments without blending (or that
+     clear the attachments themselves), and do not use depth or stencil.
+     */
+    static VRORenderTargetActions overwrite() {
+        return VRORenderTargetActions(VROLoadAction::DontCare, VROLoadAction::DontCare, VROLoadAction::DontCare,
+                                      VROStoreAction::Store, VROStoreAction::Discard, VROStoreAction::Discard);
+    }
+    
+    /*
+     For passes that blend over a cleared color attachment, and do not use depth or
+     stencil (e.g. post-processing passes).
+     */
+    static VRORenderTargetActions clearColorOnly() {
+        return VRORenderTargetActions(VROLoadAction::Clear, VROLoadAction::DontCare, VROLoadAction::DontCare,
+                                      VROStoreAction::Store, VROStoreAction::Discard, VROStoreAction::Discard);
+    }
+    
+    VRORenderTargetActions() :
+        VRORenderTargetActions(VROLoadAction::Clear, VROLoadAction::Clear, VROLoadAction::Clear,
+                               VROStoreAction::Store, VROStoreAction::Discard, VROStoreAction::Discard) {}
+    VRORenderTargetActions(VROLoadAction colorLoad, VROLoadAction depthLoad, VROLoadAction stencilLoad,
+                           VROStoreAction colorStore, VROStoreAction depthStore, VROStoreAction stencilStore) :
+        colorLoad(colorLoad), depthLoad(depthLoad), stencilLoad(stencilLoad),
+        colorStore(colorStore), depthStore(depthStore), stencilStore(stencilStore) {}
+    
+    VROLoadAction colorLoad, depthLoad, stencilLoad;
+    VROStoreAction colorStore, depthStore, stencilStore;
+};
+
 /*
  Represents a render target, with any number of color, stencil, or depth attachments.
  In OpenGL, this is represented by an FBO.
@@ -90,7 +201,9 @@ public:
      */
     VRORenderTarget(VRORenderTargetType type, int numAttachments) :
         _type(type),
-        _numAttachments(numAttachments) {
+        _numAttachments(numAttachments),
+        _attachmentFormats(numAttachments, VROAttachmentFormat::Default),
+        _sampleCount(1) {
             
         if (numAttachments > 1 &&
             (type == VRORenderTargetType::DepthTexture || type == VRORenderTargetType::DepthTextureArray)) {
@@ -130,15 +243,74 @@ public:
      */
     VRORenderTargetType getType() const { return _type; }
     
+    /*
+     Get the number of color attachments in this render target.
+     */
+    int getNumAttachments() const { return _numAttachments; }
+    
+    /*
+     Set the storage format of the given color attachment. Returns true if the format
+     changed, in which case the existing framebuffers are deleted and this target must
+     be re-hydrated.
+     */
+    bool setAttachmentFormat(int attachment, VROAttachmentFormat format) {
+        passert (attachment >= 0 && attachment < _numAttachments);
+        if (_attachmentFormats[attachment] == format) {
+            return false;
+        }
+        _attachmentFormats[attachment] = format;
+        deleteFramebuffers();
+        return true;
+    }
+    VROAttachmentFormat getAttachmentFormat(int attachment) const {
+        return _attachmentFormats[attachment];
+    }
+    
+    /*
+     Set the number of samples per pixel with which to render into this target's
+     color textures (1 for no multisampling). Samples are resolved into the textures
+     on-tile, without an explicit resolve pass. Implementations that do not support
+     this for the target render it without multisampling. Returns true if the sample
+     count changed, in which case the existing framebuffers are deleted and this
+     target must be re-hydrated.
+     */
+    bool setSampleCount(int samples) {
+        samples = std::max(1, samples);
+        if (_sampleCount == samples) {
+            return false;
+        }
+        _sampleCount = samples;
+        deleteFramebuffers();
+        return true;
+    }
+    int getSampleCount() const {
+        return _sampleCount;
+    }
+    
     /*
      Set the clear color to use for this render target.
      */
     void setClearColor(VROVector4f color) {
         _clearColor = color;
     }
+    VROVector4f getClearColor() const {
+        return _clearColor;
+    }
     
     /*
-     Bind this render-target. This will bind the target only for drawing.
+     Set the load and store actions used the next time this target is bound and
+     unbound. These are typically set through VRODriver::bindRenderTarget.
+     */
+    void setActions(VRORenderTargetActions actions) {
+        _actions = actions;
+    }
+    const VRORenderTargetActions &getActions() const {
+        return _actions;
+    }
+    
+    /*
+     Bind this render-target. This will bind the target only for drawing, and
+     performs the load actions of each attachment.
      */
     virtual void bind() = 0;
 
@@ -147,6 +319,13 @@ public:
      */
     virtual void bindRead() = 0;
     
+    /*
+     Restrict rendering and clears to the given region of this render target,
+     which must be bound. The region reverts to the full viewport the next time
+     the target is bound.
+     */
+    virtual void setRenderRegion(VROViewport region) = 0;
+    
     /*
      Invalidate the buffers in this render-target.
      
@@ -177,6 +356,71 @@ public:
      */
     virtual void blitStencil(std::shared_ptr<VRORenderTarget> destination, bool flipY,
                                   std::shared_ptr<VRODriver> driver) = 0;
+
+    /*
+     For multiview targets, blit the given image (view) of each color attachment
+     over to the same attachment of the given destination buffer.
+
+     The destination render target must already have been bound.
+     */
+    virtual void blitImage(int image, std::shared_ptr<VRORenderTarget> destination,
+                           std::shared_ptr<VRODriver> driver) = 0;
+
+    /*
+     Resolve the (possibly multisampled) color of this target into the color
+     attachment of the given destination, which must be the same size. Unlike
+     blitColor, this is supported by the display. Returns false if the driver
+     rejects the resolve, in which case the destination's contents are undefined.
+
+     The destination render target must already have been bound.
+     */
+    virtual bool resolveColor(std::shared_ptr<VRORenderTarget> destination,
+                              std::shared_ptr<VRODriver> driver) { return false; }
+
+    /*
+     Render the color attachments of this target at reduced pixel density away
+     from the given focal points, one per image, in normalized device coordinates.
+     Density falls off with the given gain outside of the fovea area; a gain of
+     zero renders at full density. Returns false if this target or the driver
+     does not support foveation.
+     */
+    virtual bool setFoveation(float gain, float foveaArea,
+                              const std::vector<VROVector3f> &focalPoints) = 0;
+    
+    /*
+     Shade the fragments of this target that lie beyond the given radius of the focal
+     point, in normalized device coordinates, at the given (coarser) rate, via a shading
+     rate attachment. The attachment is combined with the rate of each draw, taking the
+     coarser of the two. A radius of zero or less shades the whole target at the rate
+     of each draw. Returns false if this target or the driver does not support shading
+     rate attachments.
+     */
+    virtual bool setPeripheralShadingRate(float radius, VROShadingRate rate, VROVector3f focalPoint) {
+        return false;
+    }
+
+    /*
+     Bind the weighted blended transparency accumulation buffers of this target,
+     and clear them. These share this target's depth and stencil, so transparent
+     geometry rendered into them is depth tested against the opaque geometry.
+     Attachment 0 accumulates weighted color (RGB) and revealage (A); attachment 1
+     accumulates the weights. Returns false if this target does not support
+     transparency accumulation, in which case nothing is bound.
+     */
+    virtual bool bindTransparencyAccumulation() = 0;
+
+    /*
+     Rebind this target's own attachments after transparency accumulation,
+     preserving their contents.
+     */
+    virtual void unbindTransparencyAccumulation() = 0;
+
+    /*
+     Get the given transparency accumulation texture (0 for color and revealage,
+     1 for weights). Returns null if transparency has not been accumulated since
+     the framebuffers were last created.
+     */
+    virtual std::shared_ptr<VROTexture> getTransparencyTexture(int index) const = 0;
     
     /*
      Delete all existing framebuffers.
@@ -251,6 +495,15 @@ public:
      */
     virtual const std::shared_ptr<VROTexture> getTexture(int attachment) const = 0;
     
+    /*
+     Read back the given attachment as RGBA pixels: 32-bit floats for floating
+     point targets, and bytes otherwise. For cube targets, the face and miplevel
+     to read are given; other targets only read miplevel 0. This stalls until the
+     GPU finishes rendering to the attachment, so it should only be used for
+     one-time captures (e.g. persisting precomputed textures to disk).
+     */
+    virtual std::shared_ptr<VROData> readPixels(int attachment, int face, int mipLevel) = 0;
+    
 #pragma mark - Rendering Operations
     
     /*
@@ -307,15 +560,30 @@ protected:
     
     /*
      The number of attachments in this render target. Each attachment is
-     off the same type.
+     off the same type, unless overridden by setAttachmentFormat.
      */
     int _numAttachments;
     
+    /*
+     The storage format of each color attachment.
+     */
+    std::vector<VROAttachmentFormat> _attachmentFormats;
+    
+    /*
+     The requested number of samples per pixel (see setSampleCount).
+     */
+    int _sampleCount;
+    
     /*
      The clear color of this render target.
      */
     VROVector4f _clearColor;
     
+    /*
+     The load and store actions for the attachments of this render target.
+     */
+    VRORenderTargetActions _actions;
+    
 };
 
 #endif /* VRORenderTarget_h */
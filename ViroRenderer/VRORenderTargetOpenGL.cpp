@@ -32,6 +32,7 @@
 #include "VROMaterial.h"
 #include "VROViewport.h"
 #include "VRODefines.h"
+#include "VROData.h"
 
 #ifdef VRO_PLATFORM_ANDROID
 #define GL_COMPARE_REF_TO_TEXTURE                        0x884E
@@ -40,6 +41,20 @@
 #define GL_TEXTURE_COMPARE_FUNC                          0x884D
 #endif
 
+#ifndef GL_TEXTURE_FOVEATED_FEATURE_BITS_QCOM
+#define GL_FOVEATION_ENABLE_BIT_QCOM                     0x00000001
+#define GL_FOVEATION_SCALED_BIN_METHOD_BIT_QCOM          0x00000002
+#define GL_TEXTURE_FOVEATED_FEATURE_BITS_QCOM            0x8BFB
+#define GL_TEXTURE_FOVEATED_MIN_PIXEL_DENSITY_QCOM       0x8BFC
+#endif
+
+// Lower bound on the pixel density of foveated regions, so that the periphery
+// never degrades beyond this fraction of full resolution
+static const float kFoveationMinPixelDensity = 0.125;
+
+// Upper bound on the number of attachments discarded in a single glInvalidateSubFramebuffer
+static const int kMaxInvalidatedAttachments = 8;
+
 VRORenderTargetOpenGL::VRORenderTargetOpenGL(VRORenderTargetType type, int numAttachments, int numImages,
                                              bool enableMipmaps, bool needsDepthStencil,
                                              std::shared_ptr<VRODriverOpenGL> driver) :
@@ -47,12 +62,24 @@ VRORenderTargetOpenGL::VRORenderTargetOpenGL(VRORenderTargetType type, int numAt
     _framebuffer(0),
     _depthStencilbuffer(0),
     _colorbuffer(0),
+    _imageFramebuffer(0),
+    _transparencyFramebuffer(0),
+    _foveated(false),
+    _shadingRateTexture(0),
+    _shadingRateWidth(0),
+    _shadingRateHeight(0),
+    _shadingRateRadius(0),
+    _shadingRate(VROShadingRate::Rate1x1),
+    _shadingRateAttached(false),
     _numImages(numImages),
+    _attachedImageIndex(0),
     _mipmapsEnabled(enableMipmaps),
     _needsDepthStencil(needsDepthStencil),
     _driver(driver),
     _stencilRef(0xFF),
-    _stencilFunc(VROStencilFunc::Always) {
+    _stencilFunc(VROStencilFunc::Always),
+    _activeSampleCount(1),
+    _memoryBytes(0) {
     _clearColor.set(0.0, 0.0, 0.0, 1.0);
         
     // Adreno330 or older does not support offscreen render targets
@@ -62,6 +89,11 @@ VRORenderTargetOpenGL::VRORenderTargetOpenGL(VRORenderTargetType type, int numAt
     for (int i = 0; i < numAttachments; i++) {
         _textures.push_back({});
     }
+    
+    // Depth textures are sampled by later passes (e.g. shadow maps), so keep their depth
+    if (type == VRORenderTargetType::DepthTexture || type == VRORenderTargetType::DepthTextureArray) {
+        _actions.depthStore = VROStoreAction::Store;
+    }
     ALLOCATION_TRACKER_ADD(RenderTargets, 1);
 }
 
@@ -77,6 +109,10 @@ void VRORenderTargetOpenGL::bind() {
     }
     
     GL( glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _framebuffer) );
+    if (_shadingRateTexture != 0 && !_shadingRateAttached && _framebuffer != 0) {
+        std::static_pointer_cast<VRODriverOpenGL>(driver)->framebufferShadingRate(_shadingRateTexture);
+        _shadingRateAttached = true;
+    }
 
     /*
      Bind the viewport and scissor when the render target changes. The scissor
@@ -95,45 +131,90 @@ void VRORenderTargetOpenGL::bind() {
     GL (glStencilMask(0xFF) );
     
     /*
-     Prevent logical buffer load by immediately clearing.
+     Prevent logical buffer load by immediately clearing the attachments marked
+     Clear, and invalidating those marked DontCare.
      */
-    GL( glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT) );
+    GLbitfield clearMask = getLoadClearMask(false);
+    if (clearMask != 0) {
+        GL( glClear(clearMask) );
+    }
+    if (clearMask & GL_COLOR_BUFFER_BIT) {
+        clearVectorAttachments();
+    }
+    invalidateAttachments(GL_DRAW_FRAMEBUFFER, _actions.colorLoad == VROLoadAction::DontCare,
+                          _actions.depthLoad == VROLoadAction::DontCare,
+                          _actions.stencilLoad == VROLoadAction::DontCare);
     GL( glStencilFuncSeparate(GL_FRONT_AND_BACK, GL_ALWAYS, 0xFF, 0xFF) );
 }
 
+GLbitfield VRORenderTargetOpenGL::getLoadClearMask(bool clearDontCare) const {
+    GLbitfield mask = 0;
+    if (_actions.colorLoad == VROLoadAction::Clear ||
+       (_actions.colorLoad == VROLoadAction::DontCare && clearDontCare)) {
+        mask |= GL_COLOR_BUFFER_BIT;
+    }
+    if (_actions.depthLoad == VROLoadAction::Clear ||
+       (_actions.depthLoad == VROLoadAction::DontCare && clearDontCare)) {
+        mask |= GL_DEPTH_BUFFER_BIT;
+    }
+    if (_actions.stencilLoad == VROLoadAction::Clear ||
+       (_actions.stencilLoad == VROLoadAction::DontCare && clearDontCare)) {
+        mask |= GL_STENCIL_BUFFER_BIT;
+    }
+    return mask;
+}
+
+void VRORenderTargetOpenGL::invalidateAttachments(GLenum target, bool color, bool depth, bool stencil) {
+#if !VRO_PLATFORM_MACOS
+    GLenum attachments[kMaxInvalidatedAttachments];
+    int numAttachments = 0;
+    
+    if (color && _type != VRORenderTargetType::DepthTexture && _type != VRORenderTargetType::DepthTextureArray) {
+        int numColor = std::min(std::max(_numAttachments, 1), kMaxInvalidatedAttachments - 2);
+        for (int i = 0; i < numColor; i++) {
+            attachments[numAttachments++] = GL_COLOR_ATTACHMENT0 + i;
+        }
+    }
+    if (_type == VRORenderTargetType::DepthTexture || _type == VRORenderTargetType::DepthTextureArray) {
+        if (depth) {
+            attachments[numAttachments++] = GL_DEPTH_ATTACHMENT;
+        }
+    }
+    else if (_depthStencilTexture) {
+        // Combined depth-stencil attachments can only be discarded together
+        if (depth && stencil) {
+            attachments[numAttachments++] = GL_DEPTH_STENCIL_ATTACHMENT;
+        }
+    }
+    else if (_depthStencilbuffer) {
+        if (depth) {
+            attachments[numAttachments++] = GL_DEPTH_ATTACHMENT;
+        }
+        if (stencil) {
+            attachments[numAttachments++] = GL_STENCIL_ATTACHMENT;
+        }
+    }
+    
+    if (numAttachments > 0) {
+        GL( glInvalidateSubFramebuffer(target, numAttachments, attachments,
+                                       _viewport.getX(), _viewport.getY(), _viewport.getWidth(), _viewport.getHeight()) );
+    }
+#endif
+}
+
 void VRORenderTargetOpenGL::bindRead() {
     GL( glBindFramebuffer(GL_READ_FRAMEBUFFER, _framebuffer) );
 }
 
 void VRORenderTargetOpenGL::invalidate() {
-    switch (_type) {
-        case VRORenderTargetType::ColorTexture:
-        case VRORenderTargetType::ColorTextureRG16:
-        case VRORenderTargetType::ColorTextureSRGB:
-        case VRORenderTargetType::ColorTextureHDR16:
-        case VRORenderTargetType::ColorTextureHDR32:
-        case VRORenderTargetType::CubeTexture:
-        case VRORenderTargetType::CubeTextureHDR16:
-        case VRORenderTargetType::CubeTextureHDR32:
-            if (_depthStencilbuffer) {
-                GLenum attachments[2];
-                attachments[0] = GL_DEPTH_ATTACHMENT;
-                attachments[1] = GL_STENCIL_ATTACHMENT;
-#if !VRO_PLATFORM_MACOS
-                glInvalidateFramebuffer(GL_FRAMEBUFFER, 2, attachments);
-#endif
-            }
-            break;
-            
-        case VRORenderTargetType::DepthTexture:
-        case VRORenderTargetType::DepthTextureArray:
-            // Nothing to discard
-            break;
-            
-        default:
-            // Nothing to discard
-            break;
-    }
+    /*
+     Discard each attachment whose store action is Discard, so tiled GPUs do not
+     write it back from tile memory. This must be invoked while this target is still
+     bound.
+     */
+    invalidateAttachments(GL_DRAW_FRAMEBUFFER, _actions.colorStore == VROStoreAction::Discard,
+                          _actions.depthStore == VROStoreAction::Discard,
+                          _actions.stencilStore == VROStoreAction::Discard);
 }
 
 void VRORenderTargetOpenGL::blitColor(std::shared_ptr<VRORenderTarget> destination, bool flipY,
@@ -168,6 +249,296 @@ void VRORenderTargetOpenGL::blitAttachment(GLenum attachment, GLbitfield mask, G
     }
 }
 
+bool VRORenderTargetOpenGL::resolveColor(std::shared_ptr<VRORenderTarget> destination,
+                                         std::shared_ptr<VRODriver> driver) {
+    VRORenderTargetOpenGL *t = (VRORenderTargetOpenGL *) destination.get();
+    if (_viewport.getWidth() != t->_viewport.getWidth() || _viewport.getHeight() != t->_viewport.getHeight()) {
+        return false;
+    }
+    
+    // The default framebuffer of the display is read through its back buffer
+    GLenum readBuffer = (_type == VRORenderTargetType::Display && _framebuffer == 0) ? GL_BACK : GL_COLOR_ATTACHMENT0;
+    GLenum drawBuffer = GL_COLOR_ATTACHMENT0;
+    GL( glBindFramebuffer(GL_READ_FRAMEBUFFER, _framebuffer) );
+    GL( glReadBuffer(readBuffer) );
+    GL( glDrawBuffers(1, &drawBuffer) );
+    
+    /*
+     Resolving a multisampled buffer requires matching rectangles and formats; the
+     error is read directly (instead of through GL()) so it can be reported.
+     */
+    while (glGetError() != GL_NO_ERROR) {}
+    glBlitFramebuffer(   _viewport.getX(),    _viewport.getY(),    _viewport.getX() +    _viewport.getWidth(),    _viewport.getY() +    _viewport.getHeight(),
+                      t->_viewport.getX(), t->_viewport.getY(), t->_viewport.getX() + t->_viewport.getWidth(), t->_viewport.getY() + t->_viewport.getHeight(),
+                      GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    return glGetError() == GL_NO_ERROR;
+}
+
+void VRORenderTargetOpenGL::blitImage(int image, std::shared_ptr<VRORenderTarget> destination,
+                                      std::shared_ptr<VRODriver> driver) {
+    passert (_type == VRORenderTargetType::ColorTextureHDR16Multiview);
+    passert (image < _numImages);
+    passert (_viewport.getWidth() == destination->getWidth());
+    passert (_viewport.getHeight() == destination->getHeight());
+    
+    VRORenderTargetOpenGL *t = (VRORenderTargetOpenGL *) destination.get();
+    int numAttachments = std::min(_numAttachments, t->_numAttachments);
+    
+    if (_imageFramebuffer == 0) {
+        GL( glGenFramebuffers(1, &_imageFramebuffer) );
+    }
+    GL( glBindFramebuffer(GL_READ_FRAMEBUFFER, _imageFramebuffer) );
+    GL( glReadBuffer(GL_COLOR_ATTACHMENT0) );
+    
+    /*
+     Each attachment is blitted separately, reading its layer through the image
+     framebuffer and drawing only to the matching destination attachment.
+     */
+    GLenum drawBuffers[numAttachments];
+    for (int i = 0; i < numAttachments; i++) {
+        GL( glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, getTextureName(i), 0, image) );
+        for (int j = 0; j <= i; j++) {
+            drawBuffers[j] = (j == i) ? GL_COLOR_ATTACHMENT0 + i : GL_NONE;
+        }
+        GL( glDrawBuffers(i + 1, drawBuffers) );
+        GL( glBlitFramebuffer(   _viewport.getX(),    _viewport.getY(),    _viewport.getX() +    _viewport.getWidth(),    _viewport.getY() +    _viewport.getHeight(),
+                              t->_viewport.getX(), t->_viewport.getY(), t->_viewport.getX() + t->_viewport.getWidth(), t->_viewport.getY() + t->_viewport.getHeight(),
+                              GL_COLOR_BUFFER_BIT, GL_NEAREST) );
+    }
+    
+    // Restore the destination's draw buffers
+    GLenum attachments[t->_numAttachments];
+    for (int i = 0; i < t->_numAttachments; i++) {
+        attachments[i] = GL_COLOR_ATTACHMENT0 + i;
+    }
+    GL( glDrawBuffers(t->_numAttachments, attachments) );
+}
+
+bool VRORenderTargetOpenGL::setFoveation(float gain, float foveaArea,
+                                         const std::vector<VROVector3f> &focalPoints) {
+    std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
+    if (!driver || !driver->isFoveationSupported() || focalPoints.empty()) {
+        return false;
+    }
+    
+    GLenum target;
+    int numLayers = 1;
+    if (_type == VRORenderTargetType::ColorTextureHDR16 ||
+        _type == VRORenderTargetType::ColorTextureHDR32) {
+        target = GL_TEXTURE_2D;
+    }
+    else if (_type == VRORenderTargetType::ColorTextureHDR16Multiview) {
+        target = GL_TEXTURE_2D_ARRAY;
+        numLayers = _numImages;
+    }
+    else {
+        return false;
+    }
+    
+    if (!_foveated) {
+        // Nothing to do until foveation is first requested
+        if (gain <= 0) {
+            return true;
+        }
+        for (int i = 0; i < _textures.size(); i++) {
+            if (!_textures[i]) {
+                continue;
+            }
+            GL( glBindTexture(target, getTextureName(i)) );
+            GL( glTexParameteri(target, GL_TEXTURE_FOVEATED_FEATURE_BITS_QCOM,
+                                GL_FOVEATION_ENABLE_BIT_QCOM | GL_FOVEATION_SCALED_BIN_METHOD_BIT_QCOM) );
+            GL( glTexParameterf(target, GL_TEXTURE_FOVEATED_MIN_PIXEL_DENSITY_QCOM, kFoveationMinPixelDensity) );
+        }
+        GL( glBindTexture(target, 0) );
+        _foveated = true;
+    }
+    
+    for (int i = 0; i < _textures.size(); i++) {
+        if (!_textures[i]) {
+            continue;
+        }
+        for (int layer = 0; layer < numLayers; layer++) {
+            const VROVector3f &focalPoint = focalPoints[std::min(layer, (int) focalPoints.size() - 1)];
+            driver->textureFoveationParameters(getTextureName(i), layer, focalPoint.x, focalPoint.y,
+                                               gain, gain, foveaArea);
+        }
+    }
+    return true;
+}
+
+bool VRORenderTargetOpenGL::setPeripheralShadingRate(float radius, VROShadingRate rate, VROVector3f focalPoint) {
+#if VRO_PLATFORM_ANDROID
+    std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
+    if (!driver || !driver->isShadingRateAttachmentSupported() || _framebuffer == 0) {
+        return false;
+    }
+    if (_type != VRORenderTargetType::ColorTextureHDR16 &&
+        _type != VRORenderTargetType::ColorTextureHDR32) {
+        return false;
+    }
+    
+    // Nothing to do until a periphery is first requested
+    if (_shadingRateTexture == 0 && radius <= 0) {
+        return true;
+    }
+    
+    int texelWidth = driver->getShadingRateTexelWidth();
+    int texelHeight = driver->getShadingRateTexelHeight();
+    int width  = (_viewport.getWidth()  + texelWidth  - 1) / texelWidth;
+    int height = (_viewport.getHeight() + texelHeight - 1) / texelHeight;
+    if (width <= 0 || height <= 0) {
+        return false;
+    }
+    
+    bool resized = width != _shadingRateWidth || height != _shadingRateHeight;
+    if (!resized && _shadingRateTexture != 0 && radius == _shadingRateRadius && rate == _shadingRate &&
+        focalPoint.isEqual(_shadingRateFocalPoint)) {
+        return true;
+    }
+    if (_shadingRateTexture == 0 || resized) {
+        if (_shadingRateTexture != 0) {
+            driver->deleteTexture(_shadingRateTexture);
+        }
+        GL( glGenTextures(1, &_shadingRateTexture) );
+        GL( glBindTexture(GL_TEXTURE_2D, _shadingRateTexture) );
+        GL( glTexStorage2D(GL_TEXTURE_2D, 1, GL_R8UI, width, height) );
+        _shadingRateWidth = width;
+        _shadingRateHeight = height;
+        _shadingRateAttached = false;
+    }
+    else {
+        GL( glBindTexture(GL_TEXTURE_2D, _shadingRateTexture) );
+    }
+    _shadingRateRadius = radius;
+    _shadingRate = rate;
+    _shadingRateFocalPoint = focalPoint;
+    
+    // Each texel encodes the log2 of its rate's width in bits 2-3 and of its height
+    // in bits 0-1
+    uint8_t peripheral = 0;
+    if (rate == VROShadingRate::Rate2x2) {
+        peripheral = (1 << 2) | 1;
+    }
+    else if (rate == VROShadingRate::Rate4x4) {
+        peripheral = (2 << 2) | 2;
+    }
+    
+    float aspect = (float) _viewport.getWidth() / (float) std::max(1, _viewport.getHeight());
+    std::vector<uint8_t> texels(width * height);
+    for (int y = 0; y < height; y++) {
+        float ndcY = ((y + 0.5f) * texelHeight / _viewport.getHeight()) * 2.0f - 1.0f;
+        for (int x = 0; x < width; x++) {
+            float ndcX = ((x + 0.5f) * texelWidth / _viewport.getWidth()) * 2.0f - 1.0f;
+            float dx = (ndcX - focalPoint.x) * aspect;
+            float dy = ndcY - focalPoint.y;
+            texels[y * width + x] = (radius > 0 && dx * dx + dy * dy > radius * radius) ? peripheral : 0;
+        }
+    }
+    GL( glPixelStorei(GL_UNPACK_ALIGNMENT, 1) );
+    GL( glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RED_INTEGER, GL_UNSIGNED_BYTE, texels.data()) );
+    GL( glPixelStorei(GL_UNPACK_ALIGNMENT, 4) );
+    GL( glBindTexture(GL_TEXTURE_2D, 0) );
+    return true;
+#else
+    // Shading rate attachments are only loaded on Android
+    return false;
+#endif
+}
+
+bool VRORenderTargetOpenGL::bindTransparencyAccumulation() {
+    if (_transparencyFramebuffer == 0 && !createTransparencyFramebuffer()) {
+        return false;
+    }
+    std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
+    if (!driver) {
+        return false;
+    }
+    
+    GL( glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _transparencyFramebuffer) );
+    GL( glViewport(_viewport.getX(), _viewport.getY(), _viewport.getWidth(), _viewport.getHeight()) );
+    GL( glScissor(_viewport.getX(), _viewport.getY(), _viewport.getWidth(), _viewport.getHeight()) );
+    
+    /*
+     Weighted color and weights start at zero, and revealage starts at one (nothing
+     covers the opaque surface).
+     */
+    driver->setRenderTargetColorWritingMask(VROColorMaskAll);
+    const GLfloat accumulationClear[4] = { 0.0, 0.0, 0.0, 1.0 };
+    const GLfloat weightClear[4] = { 0.0, 0.0, 0.0, 0.0 };
+    GL( glClearBufferfv(GL_COLOR, 0, accumulationClear) );
+    GL( glClearBufferfv(GL_COLOR, 1, weightClear) );
+    return true;
+}
+
+void VRORenderTargetOpenGL::unbindTransparencyAccumulation() {
+    GL( glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _framebuffer) );
+    GL( glViewport(_viewport.getX(), _viewport.getY(), _viewport.getWidth(), _viewport.getHeight()) );
+    GL( glScissor(_viewport.getX(), _viewport.getY(), _viewport.getWidth(), _viewport.getHeight()) );
+}
+
+std::shared_ptr<VROTexture> VRORenderTargetOpenGL::getTransparencyTexture(int index) const {
+    passert (index >= 0 && index < 2);
+    return _transparencyTextures[index];
+}
+
+bool VRORenderTargetOpenGL::createTransparencyFramebuffer() {
+    std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
+    if (!driver) {
+        return false;
+    }
+    if (_type != VRORenderTargetType::ColorTextureHDR16 &&
+        _type != VRORenderTargetType::ColorTextureHDR32) {
+        pinfo("Transparency accumulation is only supported by HDR texture targets");
+        return false;
+    }
+    if (_framebuffer == 0 || _depthStencilbuffer == 0) {
+        pinfo("Transparency accumulation requires a hydrated target with depth and stencil");
+        return false;
+    }
+    
+    GL( glGenFramebuffers(1, &_transparencyFramebuffer) );
+    GL( glBindFramebuffer(GL_FRAMEBUFFER, _transparencyFramebuffer) );
+    
+    GLuint texNames[2];
+    GL( glGenTextures(2, texNames) );
+    for (int i = 0; i < 2; i++) {
+        GL( glBindTexture(GL_TEXTURE_2D, texNames[i]) );
+        GL( glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR) );
+        GL( glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR) );
+        GL( glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE) );
+        GL( glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE) );
+        GL( glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, _viewport.getWidth(), _viewport.getHeight(), 0,
+                         GL_RGBA, GL_FLOAT, nullptr) );
+        GL( glBindTexture(GL_TEXTURE_2D, 0) );
+        // Multisampled to match the shared depth/stencil renderbuffer
+        framebufferTexture2D(GL_COLOR_ATTACHMENT0 + i, texNames[i]);
+        
+        std::unique_ptr<VROTextureSubstrate> substrate = std::unique_ptr<VROTextureSubstrateOpenGL>(new VROTextureSubstrateOpenGL(GL_TEXTURE_2D, texNames[i], driver));
+        _transparencyTextures[i] = std::make_shared<VROTexture>(VROTextureType::Texture2D, VROTextureInternalFormat::RGBA8,
+                                                                std::move(substrate));
+    }
+    GL( glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _depthStencilbuffer) );
+    GL( glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_RENDERBUFFER, _depthStencilbuffer) );
+    
+    GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    GL( glDrawBuffers(2, drawBuffers) );
+    
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        pinfo("Failed to make complete transparency framebuffer %x", glCheckFramebufferStatus(GL_FRAMEBUFFER));
+        driver->deleteFramebuffer(_transparencyFramebuffer);
+        _transparencyFramebuffer = 0;
+        _transparencyTextures[0].reset();
+        _transparencyTextures[1].reset();
+        GL( glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer) );
+        return false;
+    }
+    
+    int64_t bytes = (int64_t) _viewport.getWidth() * _viewport.getHeight() * 8 * 2;
+    _memoryBytes += bytes;
+    ALLOCATION_TRACKER_ADD(RenderTargetMemory, bytes);
+    return true;
+}
+
 bool VRORenderTargetOpenGL::setViewport(VROViewport viewport) {
     float previousWidth = _viewport.getWidth();
     float previousHeight = _viewport.getHeight();
@@ -211,6 +582,48 @@ const std::shared_ptr<VROTexture> VRORenderTargetOpenGL::getTexture(int attachme
     return _textures[attachment];
 }
 
+std::shared_ptr<VROData> VRORenderTargetOpenGL::readPixels(int attachment, int face, int mipLevel) {
+    GLenum attachmentType = getTextureAttachmentType(attachment);
+    passert (attachmentType != 0 && attachmentType != GL_DEPTH_ATTACHMENT);
+    
+    // Attaching the face rebinds the framebuffer (and viewport) behind the driver's
+    // back, so restore the previous bindings when we're done
+    GLint previousFramebuffer = 0;
+    GLint previousViewport[4];
+    GL( glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer) );
+    GL( glGetIntegerv(GL_VIEWPORT, previousViewport) );
+    
+    bool cube = _type == VRORenderTargetType::CubeTexture ||
+                _type == VRORenderTargetType::CubeTextureHDR16 ||
+                _type == VRORenderTargetType::CubeTextureHDR32;
+    if (cube) {
+        setTextureCubeFace(face, mipLevel, attachment);
+    }
+    else {
+        passert (mipLevel == 0);
+    }
+    
+    bool floatingPoint = _type == VRORenderTargetType::ColorTextureRG16 ||
+                         _type == VRORenderTargetType::ColorTextureHDR16 ||
+                         _type == VRORenderTargetType::ColorTextureHDR32 ||
+                         _type == VRORenderTargetType::CubeTextureHDR16 ||
+                         _type == VRORenderTargetType::CubeTextureHDR32;
+    
+    int width  = std::max(1, _viewport.getWidth()  >> mipLevel);
+    int height = std::max(1, _viewport.getHeight() >> mipLevel);
+    int length = width * height * 4 * (floatingPoint ? sizeof(float) : sizeof(uint8_t));
+    void *pixels = malloc(length);
+    
+    GL( glBindFramebuffer(GL_READ_FRAMEBUFFER, _framebuffer) );
+    GL( glReadBuffer(attachmentType) );
+    GL( glReadPixels(0, 0, width, height, GL_RGBA, floatingPoint ? GL_FLOAT : GL_UNSIGNED_BYTE, pixels) );
+    
+    GL( glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer) );
+    GL( glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]) );
+    
+    return std::make_shared<VROData>(pixels, length, VRODataOwnership::Move);
+}
+
 void VRORenderTargetOpenGL::clearTextures() {
     for (int i = 0; i < _textures.size(); i++) {
         GLenum attachment = getTextureAttachmentType(i);
@@ -222,6 +635,7 @@ void VRORenderTargetOpenGL::clearTextures() {
     for (std::shared_ptr<VROTexture> &texture : _textures) {
         texture.reset();
     }
+    _foveated = false;
 }
 
 void VRORenderTargetOpenGL::attachTexture(std::shared_ptr<VROTexture> texture, int attachmentIndex) {
@@ -236,7 +650,7 @@ void VRORenderTargetOpenGL::attachTexture(std::shared_ptr<VROTexture> texture, i
         _type == VRORenderTargetType::ColorTextureHDR16 ||
         _type == VRORenderTargetType::ColorTextureHDR32 ||
         _type == VRORenderTargetType::DepthTexture) {
-        GL( glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, name, 0) );
+        framebufferTexture2D(attachment, name);
     }
     else if (_type == VRORenderTargetType::CubeTexture ||
              _type == VRORenderTargetType::CubeTextureHDR16 ||
@@ -245,6 +659,7 @@ void VRORenderTargetOpenGL::attachTexture(std::shared_ptr<VROTexture> texture, i
     }
     else if (_type == VRORenderTargetType::DepthTextureArray) {
         GL( glFramebufferTextureLayer(GL_FRAMEBUFFER, attachment, name, 0, 0) );
+        _attachedImageIndex = 0;
     }
     else {
         pabort();
@@ -256,9 +671,13 @@ void VRORenderTargetOpenGL::setTextureImageIndex(int index, int attachmentIndex)
     GLenum attachment = getTextureAttachmentType(attachmentIndex);
     passert (attachment != 0);
     passert (_type == VRORenderTargetType::DepthTextureArray);
+    if (index == _attachedImageIndex) {
+        return;
+    }
     
     GL( glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer) );
     GL( glFramebufferTextureLayer(GL_FRAMEBUFFER, attachment, name, 0, index) );
+    _attachedImageIndex = index;
 }
 
 void VRORenderTargetOpenGL::setTextureCubeFace(int face, int mipLevel, int attachmentIndex) {
@@ -301,6 +720,7 @@ bool VRORenderTargetOpenGL::attachNewTextures() {
         pinfo("Failed to attach new render target textures: viewport was not set (width or height was 0)");
         return false;
     }
+    _foveated = false;
     
     if (_type == VRORenderTargetType::ColorTexture ||
         _type == VRORenderTargetType::ColorTextureRG16 ||
@@ -330,6 +750,16 @@ bool VRORenderTargetOpenGL::attachNewTextures() {
             texType = GL_FLOAT;
         }
         
+        /*
+         Multisampled rendering resolves on-tile into the textures, so it requires
+         multisampled render to texture support. Targets with mipmaps render into
+         specific miplevels, and are never multisampled.
+         */
+        _activeSampleCount = 1;
+        if (_sampleCount > 1 && !_mipmapsEnabled) {
+            _activeSampleCount = std::min(_sampleCount, driver->getMaxMultisampledRenderToTextureSamples(_numAttachments));
+        }
+        
         GL (glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer) );
         GLuint texNames[_numAttachments];
         GL (glGenTextures(_numAttachments, texNames) );
@@ -342,13 +772,18 @@ bool VRORenderTargetOpenGL::attachNewTextures() {
             GL (glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, _mipmapsEnabled ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR) );
             GL (glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE) );
             GL (glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE) );
-            GL (glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, _viewport.getWidth(), _viewport.getHeight(), 0, format, texType, nullptr) );
+            GLint attachmentInternalFormat = internalFormat;
+            GLint attachmentFormat = format;
+            GLenum attachmentTexType = texType;
+            getAttachmentStorage(i, &attachmentInternalFormat, &attachmentFormat, &attachmentTexType);
+            GL (glTexImage2D(GL_TEXTURE_2D, 0, attachmentInternalFormat, _viewport.getWidth(), _viewport.getHeight(), 0,
+                             attachmentFormat, attachmentTexType, nullptr) );
             if (_mipmapsEnabled) {
                 // Allocates memory for the mipmaps
                 GL (glGenerateMipmap(GL_TEXTURE_2D) );
             }
             GL (glBindTexture(GL_TEXTURE_2D, 0) );
-            GL (glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texNames[i], 0) );
+            framebufferTexture2D(attachment, texNames[i]);
             
             std::unique_ptr<VROTextureSubstrate> substrate = std::unique_ptr<VROTextureSubstrateOpenGL>(new VROTextureSubstrateOpenGL(target, texNames[i], driver));
             _textures[i] = std::make_shared<VROTexture>(VROTextureType::Texture2D, VROTextureInternalFormat::RGBA8,
@@ -363,7 +798,13 @@ bool VRORenderTargetOpenGL::attachNewTextures() {
             _depthStencilRenderbufferStorage = GL_DEPTH24_STENCIL8;
             GL (glGenRenderbuffers(1, &_depthStencilbuffer) );
             GL (glBindRenderbuffer(GL_RENDERBUFFER, _depthStencilbuffer) );
-            GL (glRenderbufferStorage(GL_RENDERBUFFER, _depthStencilRenderbufferStorage, _viewport.getWidth(), _viewport.getHeight()) );
+            if (_activeSampleCount > 1) {
+                driver->renderbufferStorageMultisample(_depthStencilRenderbufferStorage, _viewport.getWidth(), _viewport.getHeight(),
+                                                       _activeSampleCount);
+            }
+            else {
+                GL (glRenderbufferStorage(GL_RENDERBUFFER, _depthStencilRenderbufferStorage, _viewport.getWidth(), _viewport.getHeight()) );
+            }
             
             GL (glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _depthStencilbuffer) );
             GL (glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_RENDERBUFFER, _depthStencilbuffer) );
@@ -482,6 +923,9 @@ bool VRORenderTargetOpenGL::attachNewTextures() {
             return false;
         }
     }
+    else if (_type == VRORenderTargetType::ColorTextureHDR16Multiview) {
+        return attachNewMultiviewTextures(driver);
+    }
     else if (_type == VRORenderTargetType::DepthTexture) {
         GLenum target = GL_TEXTURE_2D;
         GL (glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer) );
@@ -534,6 +978,7 @@ bool VRORenderTargetOpenGL::attachNewTextures() {
                          _numImages, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, 0) );
         GL (glBindTexture(GL_TEXTURE_2D_ARRAY, 0) );
         GL (glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texName, 0, 0) );
+        _attachedImageIndex = 0;
         
         if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
             pinfo("Failed to make complete resolve depth framebuffer object [error %x]", glCheckFramebufferStatus(GL_FRAMEBUFFER));
@@ -552,6 +997,66 @@ bool VRORenderTargetOpenGL::attachNewTextures() {
     return true;
 }
 
+bool VRORenderTargetOpenGL::attachNewMultiviewTextures(std::shared_ptr<VRODriverOpenGL> driver) {
+    if (!driver->isMultiviewSupported()) {
+        pinfo("Failed to attach multiview render target textures: multiview not supported");
+        return false;
+    }
+    
+    GLenum target = GL_TEXTURE_2D_ARRAY;
+    GL (glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer) );
+    GLuint texNames[_numAttachments];
+    GL (glGenTextures(_numAttachments, texNames) );
+    
+    for (int i = 0; i < _numAttachments; i++) {
+        GL (glBindTexture(target, texNames[i]) );
+        GL (glTexParameterf(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR) );
+        GL (glTexParameterf(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR) );
+        GL (glTexParameterf(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE) );
+        GL (glTexParameterf(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE) );
+        GLint internalFormat = GL_RGBA16F;
+        GLint format = GL_RGBA;
+        GLenum texType = GL_FLOAT;
+        getAttachmentStorage(i, &internalFormat, &format, &texType);
+        GL (glTexImage3D(target, 0, internalFormat, _viewport.getWidth(), _viewport.getHeight(), _numImages,
+                         0, format, texType, nullptr) );
+        GL (glBindTexture(target, 0) );
+        driver->framebufferTextureMultiview(getTextureAttachmentType(i), texNames[i], _numImages);
+        
+        std::unique_ptr<VROTextureSubstrate> substrate = std::unique_ptr<VROTextureSubstrateOpenGL>(new VROTextureSubstrateOpenGL(target, texNames[i], driver));
+        _textures[i] = std::make_shared<VROTexture>(VROTextureType::Texture2D, VROTextureInternalFormat::RGBA8,
+                                                    std::move(substrate));
+    }
+    
+    if (_needsDepthStencil && !_depthStencilTexture) {
+        GLuint depthName;
+        GL (glGenTextures(1, &depthName) );
+        GL (glBindTexture(target, depthName) );
+        GL (glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_NEAREST) );
+        GL (glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_NEAREST) );
+        GL (glTexImage3D(target, 0, GL_DEPTH24_STENCIL8, _viewport.getWidth(), _viewport.getHeight(), _numImages,
+                         0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, nullptr) );
+        GL (glBindTexture(target, 0) );
+        driver->framebufferTextureMultiview(GL_DEPTH_STENCIL_ATTACHMENT, depthName, _numImages);
+        
+        std::unique_ptr<VROTextureSubstrate> substrate = std::unique_ptr<VROTextureSubstrateOpenGL>(new VROTextureSubstrateOpenGL(target, depthName, driver));
+        _depthStencilTexture = std::make_shared<VROTexture>(VROTextureType::Texture2D, VROTextureInternalFormat::RGBA8,
+                                                            std::move(substrate));
+    }
+    
+    GLuint attachments[_numAttachments];
+    for (int i = 0; i < _numAttachments; i++) {
+        attachments[i] = GL_COLOR_ATTACHMENT0 + i;
+    }
+    GL (glDrawBuffers(_numAttachments, attachments) );
+    
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        pinfo("Failed to make complete multiview framebuffer object [error %x]", glCheckFramebufferStatus(GL_FRAMEBUFFER));
+        return false;
+    }
+    return true;
+}
+
 GLint VRORenderTargetOpenGL::getTextureName(int attachment) const {
     std::shared_ptr<VRODriver> driver = _driver.lock();
     if (!driver) {
@@ -576,6 +1081,7 @@ GLenum VRORenderTargetOpenGL::getTextureAttachmentType(int attachment) const {
         case VRORenderTargetType::ColorTextureSRGB:
         case VRORenderTargetType::ColorTextureHDR16:
         case VRORenderTargetType::ColorTextureHDR32:
+        case VRORenderTargetType::ColorTextureHDR16Multiview:
         case VRORenderTargetType::CubeTexture:
         case VRORenderTargetType::CubeTextureHDR16:
         case VRORenderTargetType::CubeTextureHDR32:
@@ -588,35 +1094,135 @@ GLenum VRORenderTargetOpenGL::getTextureAttachmentType(int attachment) const {
     }
 }
 
+void VRORenderTargetOpenGL::getAttachmentStorage(int attachment, GLint *internalFormat, GLint *format,
+                                                 GLenum *texType) const {
+    switch (_attachmentFormats[attachment]) {
+        case VROAttachmentFormat::R11G11B10F:
+            *internalFormat = GL_R11F_G11F_B10F;
+            *format = GL_RGB;
+            *texType = GL_FLOAT;
+            break;
+        case VROAttachmentFormat::R8:
+            *internalFormat = GL_R8;
+            *format = GL_RED;
+            *texType = GL_UNSIGNED_BYTE;
+            break;
+        case VROAttachmentFormat::RG16F:
+            *internalFormat = GL_RG16F;
+            *format = GL_RG;
+            *texType = GL_HALF_FLOAT;
+            break;
+        default:
+            break;
+    }
+}
+
+void VRORenderTargetOpenGL::framebufferTexture2D(GLenum attachment, GLuint texture) {
+    std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
+    if (_activeSampleCount > 1 && driver) {
+        driver->framebufferTexture2DMultisample(attachment, GL_TEXTURE_2D, texture, _activeSampleCount);
+    }
+    else {
+        GL( glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, 0) );
+    }
+}
+
 #pragma mark - Lifecycle
 
 bool VRORenderTargetOpenGL::restoreFramebuffers() {
+    bool success;
     switch (_type) {
         case VRORenderTargetType::Renderbuffer:
             createColorDepthRenderbuffers();
-            return true;
+            success = true;
+            break;
         case VRORenderTargetType::ColorTexture:
         case VRORenderTargetType::ColorTextureRG16:
         case VRORenderTargetType::ColorTextureSRGB:
         case VRORenderTargetType::ColorTextureHDR16:
         case VRORenderTargetType::ColorTextureHDR32:
+        case VRORenderTargetType::ColorTextureHDR16Multiview:
         case VRORenderTargetType::CubeTexture:
         case VRORenderTargetType::CubeTextureHDR16:
         case VRORenderTargetType::CubeTextureHDR32:
-            return createColorTextureTarget();
+            success = createColorTextureTarget();
+            break;
             
         case VRORenderTargetType::DepthTexture:
         case VRORenderTargetType::DepthTextureArray:
-            return createDepthTextureTarget();
+            success = createDepthTextureTarget();
+            break;
             
         default:
             pinfo("Invalid render target type, cannot restore framebuffers");
             return false;
     }
-    return true;
+    
+    if (success && _memoryBytes == 0) {
+        _memoryBytes = estimateMemory();
+        ALLOCATION_TRACKER_ADD(RenderTargetMemory, _memoryBytes);
+    }
+    return success;
+}
+
+int64_t VRORenderTargetOpenGL::estimateMemory() const {
+    int64_t pixels = (int64_t) _viewport.getWidth() * _viewport.getHeight();
+    
+    int colorBytesPerPixel = 4;
+    int layers = 1;
+    switch (_type) {
+        case VRORenderTargetType::ColorTextureHDR16:
+        case VRORenderTargetType::CubeTextureHDR16:
+            colorBytesPerPixel = 8;
+            break;
+        case VRORenderTargetType::ColorTextureHDR16Multiview:
+            colorBytesPerPixel = 8;
+            layers = _numImages;
+            break;
+        case VRORenderTargetType::ColorTextureHDR32:
+        case VRORenderTargetType::CubeTextureHDR32:
+            colorBytesPerPixel = 16;
+            break;
+        case VRORenderTargetType::DepthTexture:
+            return pixels * 4;
+        case VRORenderTargetType::DepthTextureArray:
+            return pixels * 4 * _numImages;
+        default:
+            break;
+    }
+    if (_type == VRORenderTargetType::CubeTexture || _type == VRORenderTargetType::CubeTextureHDR16 ||
+        _type == VRORenderTargetType::CubeTextureHDR32) {
+        layers = 6;
+    }
+    
+    int64_t bytes = 0;
+    for (int i = 0; i < _numAttachments; i++) {
+        int attachmentBytesPerPixel = colorBytesPerPixel;
+        if (_attachmentFormats[i] == VROAttachmentFormat::R11G11B10F) {
+            attachmentBytesPerPixel = 4;
+        }
+        else if (_attachmentFormats[i] == VROAttachmentFormat::R8) {
+            attachmentBytesPerPixel = 1;
+        }
+        else if (_attachmentFormats[i] == VROAttachmentFormat::RG16F) {
+            attachmentBytesPerPixel = 4;
+        }
+        bytes += pixels * attachmentBytesPerPixel * layers;
+    }
+    if (_mipmapsEnabled) {
+        bytes += bytes / 3;
+    }
+    if (_needsDepthStencil) {
+        bytes += pixels * 4 * (_type == VRORenderTargetType::ColorTextureHDR16Multiview ? _numImages : 1);
+    }
+    return bytes;
 }
 
 void VRORenderTargetOpenGL::deleteFramebuffers() {
+    // A released driver implies the GL context and its attachments were released
+    ALLOCATION_TRACKER_SUB(RenderTargetMemory, _memoryBytes);
+    _memoryBytes = 0;
+    
     std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
     if (!driver) {
         return;
@@ -634,6 +1240,22 @@ void VRORenderTargetOpenGL::deleteFramebuffers() {
         driver->deleteRenderbuffer(_depthStencilbuffer);
         _depthStencilbuffer = 0;
     }
+    if (_imageFramebuffer) {
+        driver->deleteFramebuffer(_imageFramebuffer);
+        _imageFramebuffer = 0;
+    }
+    if (_transparencyFramebuffer) {
+        driver->deleteFramebuffer(_transparencyFramebuffer);
+        _transparencyFramebuffer = 0;
+    }
+    _transparencyTextures[0].reset();
+    _transparencyTextures[1].reset();
+    _depthStencilTexture.reset();
+    if (_shadingRateTexture) {
+        driver->deleteTexture(_shadingRateTexture);
+        _shadingRateTexture = 0;
+    }
+    _shadingRateAttached = false;
     
     for (std::shared_ptr<VROTexture> &texture : _textures) {
         texture.reset();
@@ -796,12 +1418,27 @@ void VRORenderTargetOpenGL::clearColor() {
         driver->setRenderTargetColorWritingMask(VROColorMaskAll);
         GL (glClearColor(_clearColor.x, _clearColor.y, _clearColor.z, _clearColor.w) );
         GL (glClear(GL_COLOR_BUFFER_BIT) );
+        clearVectorAttachments();
     }
     else {
         pabort();
     }
 }
 
+void VRORenderTargetOpenGL::clearVectorAttachments() {
+    static const GLfloat zero[4] = { 0, 0, 0, 0 };
+    for (int i = 0; i < _numAttachments; i++) {
+        if (_attachmentFormats[i] == VROAttachmentFormat::RG16F) {
+            GL (glClearBufferfv(GL_COLOR, i, zero) );
+        }
+    }
+}
+
+void VRORenderTargetOpenGL::setRenderRegion(VROViewport region) {
+    GL( glViewport(region.getX(), region.getY(), region.getWidth(), region.getHeight()) );
+    GL( glScissor(region.getX(), region.getY(), region.getWidth(), region.getHeight()) );
+}
+
 void VRORenderTargetOpenGL::clearDepthAndColor() {
     std::shared_ptr<VRODriver> driver = _driver.lock();
     if (driver) {
@@ -809,6 +1446,7 @@ void VRORenderTargetOpenGL::clearDepthAndColor() {
         driver->setRenderTargetColorWritingMask(VROColorMaskAll);
         GL (glClearColor(_clearColor.x, _clearColor.y, _clearColor.z, _clearColor.w) );
         GL (glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT) );
+        clearVectorAttachments();
     }
     else {
         pabort();
@@ -55,6 +55,16 @@ public:
                            std::shared_ptr<VRODriver> driver);
     virtual void blitStencil(std::shared_ptr<VRORenderTarget> destination, bool flipY,
                              std::shared_ptr<VRODriver> driver);
+    virtual void blitImage(int image, std::shared_ptr<VRORenderTarget> destination,
+                           std::shared_ptr<VRODriver> driver);
+    virtual bool resolveColor(std::shared_ptr<VRORenderTarget> destination,
+                              std::shared_ptr<VRODriver> driver);
+    virtual bool setFoveation(float gain, float foveaArea,
+                              const std::vector<VROVector3f> &focalPoints);
+    virtual bool setPeripheralShadingRate(float radius, VROShadingRate rate, VROVector3f focalPoint);
+    virtual bool bindTransparencyAccumulation();
+    virtual void unbindTransparencyAccumulation();
+    virtual std::shared_ptr<VROTexture> getTransparencyTexture(int index) const;
     
     virtual bool setViewport(VROViewport viewport);
     virtual bool hydrate();
@@ -71,6 +81,7 @@ public:
     virtual void setTextureCubeFace(int face, int mipLevel, int attachmentIndex);
     virtual void setMipLevel(int mipLevel, int attachmentIndex);
     virtual const std::shared_ptr<VROTexture> getTexture(int attachment) const;
+    virtual std::shared_ptr<VROData> readPixels(int attachment, int face, int mipLevel);
     virtual void deleteFramebuffers();
     virtual bool restoreFramebuffers();
     
@@ -80,6 +91,7 @@ public:
     void clearDepth();
     void clearColor();
     void clearDepthAndColor();
+    virtual void setRenderRegion(VROViewport region);
     void enablePortalStencilWriting(VROFace face);
     void enablePortalStencilRemoval(VROFace face);
     void disablePortalStencilWriting(VROFace face);
@@ -98,6 +110,25 @@ protected:
      */
     VROViewport _viewport;
     
+    /*
+     Get the glClear mask corresponding to the load actions of this target. If
+     clearDontCare is true, DontCare attachments are cleared as well; this is used by
+     display targets, for which clearing is the only way to avoid a logical buffer load.
+     */
+    GLbitfield getLoadClearMask(bool clearDontCare) const;
+    
+    /*
+     Invalidate (glInvalidateSubFramebuffer) the given attachments of this target over
+     its viewport.
+     */
+    void invalidateAttachments(GLenum target, bool color, bool depth, bool stencil);
+    
+    /*
+     Clear the RG16F attachments of this target to zero; these hold vectors, to
+     which the clear color does not apply.
+     */
+    void clearVectorAttachments();
+    
 private:
     
 #pragma mark - Private
@@ -108,12 +139,51 @@ private:
      */
     GLuint _colorbuffer;
     std::vector<std::shared_ptr<VROTexture>> _textures;
+
+    /*
+     Multiview targets render depth and stencil to a texture array, since
+     renderbuffers have no layers. The image framebuffer is used to read a single
+     layer when blitting an image; it is created on first use.
+     */
+    std::shared_ptr<VROTexture> _depthStencilTexture;
+    GLuint _imageFramebuffer;
+
+    /*
+     Framebuffer and textures used to accumulate weighted blended transparency.
+     These are created on first use and share _depthStencilbuffer.
+     */
+    GLuint _transparencyFramebuffer;
+    std::shared_ptr<VROTexture> _transparencyTextures[2];
+
+    /*
+     True once foveation has been enabled on the current color textures. This
+     can not be undone, so foveation is thereafter disabled with a zero gain.
+     */
+    bool _foveated;
+    
+    /*
+     The R8UI shading rate attachment (or 0 if none has been requested), its size in
+     texels, and the parameters from which its contents were last computed. The
+     texture is attached to the framebuffer on the next bind after it is created.
+     */
+    GLuint _shadingRateTexture;
+    int _shadingRateWidth, _shadingRateHeight;
+    float _shadingRateRadius;
+    VROShadingRate _shadingRate;
+    VROVector3f _shadingRateFocalPoint;
+    bool _shadingRateAttached;
     
     /*
      If this is an array type, indicates the number of images in the texture.
      */
     int _numImages;
     
+    /*
+     If this is an array type, the image (layer) currently attached to the framebuffer,
+     so that re-attaching the same layer is a no-op.
+     */
+    int _attachedImageIndex;
+    
     /*
      If true, the color textures will have mipmap storage allocated so we can write to
      specific miplevels. To set the active miplevel use either setMipLevel or
@@ -140,6 +210,31 @@ private:
      */
     GLenum _depthStencilRenderbufferStorage;
     
+    /*
+     The number of samples per pixel the current attachments are rendered with. This
+     is the requested sample count, limited by the driver's support for multisampled
+     render to texture; 1 if multisampling is unavailable.
+     */
+    int _activeSampleCount;
+    
+    /*
+     Estimated GPU memory of the current attachments, as reported to
+     VROAllocationTracker. Zero when the framebuffers are deleted.
+     */
+    int64_t _memoryBytes;
+    
+    /*
+     Estimate the GPU memory of this render target's attachments at the current
+     viewport size.
+     */
+    int64_t estimateMemory() const;
+    
+    /*
+     Create the transparency accumulation framebuffer. Returns false on failure
+     or if this target's type does not support it.
+     */
+    bool createTransparencyFramebuffer();
+    
     /*
      Get the underlying OpenGL target and texture name for the currently attached
      texture.
@@ -151,6 +246,18 @@ private:
      */
     GLenum getTextureAttachmentType(int attachment) const;
     
+    /*
+     Override the given texture storage (internal format, format, and type) with the
+     format set for the given attachment, if any (see setAttachmentFormat).
+     */
+    void getAttachmentStorage(int attachment, GLint *internalFormat, GLint *format, GLenum *texType) const;
+    
+    /*
+     Attach the given 2D texture to the bound framebuffer, multisampled with the
+     active sample count.
+     */
+    void framebufferTexture2D(GLenum attachment, GLuint texture);
+    
     /*
      The driver that created this render target.
      */
@@ -166,6 +273,12 @@ private:
      */
     bool createColorTextureTarget();
     
+    /*
+     Create the color and depth/stencil texture arrays of a multiview target,
+     attached so that each draw renders every layer.
+     */
+    bool attachNewMultiviewTextures(std::shared_ptr<VRODriverOpenGL> driver);
+    
     /*
      Create a depth render-to-texture target with a color render buffer.
      */
@@ -0,0 +1,106 @@
+//
+//  VRORenderTargetPool.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VRORenderTargetPool.h"
+#include "VRORenderTarget.h"
+#include "VRODriver.h"
+#include "VROViewport.h"
+#include "VROLog.h"
+
+VRORenderTargetPool::VRORenderTargetPool() :
+    _clearColor({ 0, 0, 0, 1 }) {
+}
+
+VRORenderTargetPool::~VRORenderTargetPool() {
+}
+
+std::shared_ptr<VRORenderTarget> VRORenderTargetPool::acquire(VRORenderTargetType type, int numAttachments,
+                                                              int width, int height, int frame,
+                                                              std::shared_ptr<VRODriver> driver) {
+    // Prefer a free target of the exact size, so it need not be re-allocated
+    VRORenderTargetPoolEntry *resizable = nullptr;
+    for (VRORenderTargetPoolEntry &entry : _entries) {
+        if (entry.inUse || entry.target->getType() != type || entry.numAttachments != numAttachments) {
+            continue;
+        }
+        if (entry.target->getWidth() == width && entry.target->getHeight() == height) {
+            entry.inUse = true;
+            entry.lastFrameUsed = frame;
+            return entry.target;
+        }
+        if (!resizable) {
+            resizable = &entry;
+        }
+    }
+    
+    // Otherwise resize a free target of the same format (e.g. after the viewport or
+    // resolution scale changed), leaving it to be re-hydrated at its new size
+    if (resizable) {
+        resizable->target->setViewport({ 0, 0, width, height });
+        resizable->inUse = true;
+        resizable->lastFrameUsed = frame;
+        return resizable->target;
+    }
+    
+    std::shared_ptr<VRORenderTarget> target = driver->newRenderTarget(type, numAttachments, 1, false, false);
+    target->setViewport({ 0, 0, width, height });
+    target->setClearColor(_clearColor);
+    _entries.push_back({ target, numAttachments, true, frame });
+    
+    pinfo("Render target pool allocated target %d [%d x %d]", (int) _entries.size(), width, height);
+    return target;
+}
+
+void VRORenderTargetPool::release(std::shared_ptr<VRORenderTarget> target) {
+    for (VRORenderTargetPoolEntry &entry : _entries) {
+        if (entry.target == target) {
+            entry.inUse = false;
+            return;
+        }
+    }
+    pwarn("Attempted to release render target not owned by pool");
+}
+
+void VRORenderTargetPool::purge(int frame) {
+    for (auto it = _entries.begin(); it != _entries.end(); ) {
+        if (!it->inUse && frame - it->lastFrameUsed > kRenderTargetPoolMaxIdleFrames) {
+            it = _entries.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+void VRORenderTargetPool::clear() {
+    _entries.clear();
+}
+
+void VRORenderTargetPool::setClearColor(VROVector4f color) {
+    _clearColor = color;
+    for (VRORenderTargetPoolEntry &entry : _entries) {
+        entry.target->setClearColor(color);
+    }
+}
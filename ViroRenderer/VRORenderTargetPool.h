@@ -0,0 +1,110 @@
+//
+//  VRORenderTargetPool.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VRORenderTargetPool_h
+#define VRORenderTargetPool_h
+
+#include <memory>
+#include <vector>
+#include "VROVector4f.h"
+
+class VRODriver;
+class VRORenderTarget;
+enum class VRORenderTargetType;
+
+/*
+ The number of frames a pooled render target may go unused before its
+ graphics resources are released.
+ */
+static const int kRenderTargetPoolMaxIdleFrames = 90;
+
+/*
+ Pool of transient render targets. Rather than holding a dedicated target for
+ each intermediate result of the frame, the VRORenderGraph acquires targets
+ from this pool when a pass first writes a result, and releases them after
+ the last pass that reads it. A released target is immediately available to
+ subsequent passes in the same frame, so results whose lifetimes never overlap
+ share (alias) the same memory.
+
+ Targets are returned un-hydrated if they are new, so that they consume no
+ memory until a pass actually renders to them. Targets that go unused for
+ kRenderTargetPoolMaxIdleFrames are deleted, which frees the memory held for
+ features (bloom, post-processing) that have been turned off.
+ */
+class VRORenderTargetPool {
+public:
+    
+    VRORenderTargetPool();
+    virtual ~VRORenderTargetPool();
+    
+    /*
+     Acquire a color render target of the given type, number of attachments,
+     and size. The target is reserved for the caller until it's released. If
+     no free target matches the size, a free target of the same format is
+     resized before a new target is created.
+     */
+    std::shared_ptr<VRORenderTarget> acquire(VRORenderTargetType type, int numAttachments,
+                                             int width, int height, int frame,
+                                             std::shared_ptr<VRODriver> driver);
+    
+    /*
+     Return the given target to the pool. Its contents are undefined once it is
+     acquired again.
+     */
+    void release(std::shared_ptr<VRORenderTarget> target);
+    
+    /*
+     Delete the targets that have gone unused for kRenderTargetPoolMaxIdleFrames.
+     */
+    void purge(int frame);
+    
+    /*
+     Delete all targets. Invoked when the render configuration changes.
+     */
+    void clear();
+    
+    /*
+     Set the clear color used by all pooled targets.
+     */
+    void setClearColor(VROVector4f color);
+    
+    int getNumTargets() const {
+        return (int) _entries.size();
+    }
+    
+private:
+    
+    struct VRORenderTargetPoolEntry {
+        std::shared_ptr<VRORenderTarget> target;
+        int numAttachments;
+        bool inUse;
+        int lastFrameUsed;
+    };
+    std::vector<VRORenderTargetPoolEntry> _entries;
+    VROVector4f _clearColor;
+    
+};
+
+#endif /* VRORenderTargetPool_h */
@@ -29,6 +29,7 @@
 #include "VROTexture.h"
 #include "VROTextureSubstrateOpenGL.h"
 #include "VRODriver.h"
+#include "VRODriverOpenGL.h"
 #include "VROMaterial.h"
 
 void VRORenderUtil::prepareForBlit(std::shared_ptr<VRODriver> &driver, bool enableDepth,
@@ -41,7 +42,8 @@ void VRORenderUtil::prepareForBlit(std::shared_ptr<VRODriver> &driver, bool enab
     driver->setBlendingMode(VROBlendMode::Alpha);
 }
 
-void VRORenderUtil::renderUnitCube(unsigned int *vao, unsigned int *vbo) {
+void VRORenderUtil::renderUnitCube(unsigned int *vao, unsigned int *vbo, std::shared_ptr<VRODriver> &driver) {
+    std::shared_ptr<VRODriverOpenGL> driverGL = std::static_pointer_cast<VRODriverOpenGL>(driver);
     if (*vao == 0) {
         float vertices[] = {
             // back face
@@ -91,7 +93,7 @@ void VRORenderUtil::renderUnitCube(unsigned int *vao, unsigned int *vbo) {
         GL( glGenBuffers(1, vbo) );
         GL( glBindBuffer(GL_ARRAY_BUFFER, *vbo) );
         GL( glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW) );
-        GL( glBindVertexArray(*vao) );
+        driverGL->bindVertexArray(*vao);
         GL( glEnableVertexAttribArray(0) );
         GL( glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0) );
         GL( glEnableVertexAttribArray(1) );
@@ -99,15 +101,17 @@ void VRORenderUtil::renderUnitCube(unsigned int *vao, unsigned int *vbo) {
         GL( glEnableVertexAttribArray(2) );
         GL( glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float))) );
         GL( glBindBuffer(GL_ARRAY_BUFFER, 0) );
-        GL( glBindVertexArray(0) );
     }
     
-    GL( glBindVertexArray(*vao) );
+    driverGL->bindVertexArray(*vao);
     GL( glDrawArrays(GL_TRIANGLES, 0, 36) );
-    GL( glBindVertexArray(0) );
+
+    // Callers delete these vertex arrays directly, so do not leave them bound
+    driverGL->unbindVertexArray();
 }
 
-void VRORenderUtil::renderQuad(unsigned int *vao, unsigned int *vbo) {
+void VRORenderUtil::renderQuad(unsigned int *vao, unsigned int *vbo, std::shared_ptr<VRODriver> &driver) {
+    std::shared_ptr<VRODriverOpenGL> driverGL = std::static_pointer_cast<VRODriverOpenGL>(driver);
     if (*vao == 0) {
         float quadVertices[] = {
             // positions        // texture Coords
@@ -120,7 +124,7 @@ void VRORenderUtil::renderQuad(unsigned int *vao, unsigned int *vbo) {
         // setup quad VAO
         GL( glGenVertexArrays(1, vao) );
         GL( glGenBuffers(1, vbo) );
-        GL( glBindVertexArray(*vao) );
+        driverGL->bindVertexArray(*vao);
         GL( glBindBuffer(GL_ARRAY_BUFFER, *vbo) );
         GL( glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW) );
         GL( glEnableVertexAttribArray(0) );
@@ -129,9 +133,9 @@ void VRORenderUtil::renderQuad(unsigned int *vao, unsigned int *vbo) {
         GL( glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float))) );
     }
 
-    GL( glBindVertexArray(*vao) );
+    driverGL->bindVertexArray(*vao);
     GL( glDrawArrays(GL_TRIANGLE_STRIP, 0, 4) );
-    GL( glBindVertexArray(0) );
+    driverGL->unbindVertexArray();
 }
 
 bool VRORenderUtil::bindTexture(int unit, const std::shared_ptr<VROTexture> &texture,
@@ -42,19 +42,53 @@
 #include "VRORenderContext.h"
 #include "VROCamera.h"
 #include "VROFrameTimer.h"
+#include "VROProfiler.h"
 #include "VROFrameScheduler.h"
 #include "VROChoreographer.h"
+#include "VROOcclusionCuller.h"
 #include "VROPencil.h"
 #include "VROPortalTreeRenderPass.h"
 #include "VRORenderMetadata.h"
 #include "VROToneMappingRenderPass.h"
 #include "VRODebugHUD.h"
+#include "VROJobSystem.h"
+#include "VROPlatformUtil.h"
+#include "VRORenderInvalidation.h"
+#include "VROQualityGovernor.h"
+#include "VROFrameArena.h"
+#include "VROGeometry.h"
+#include "VROMaterial.h"
+#include "VROMaterialSubstrate.h"
+#include "VROPortal.h"
+#include "VROTexture.h"
+#include "VROFrameCapture.h"
+#include "VROSecondaryView.h"
 #include "VROOpenGL.h" // For pglpush and pop
+#include <algorithm>
 
 // Target frames-per-second. Eventually this will be platform dependent,
 // but for now all of our platforms target 60.
 static const double kFPSTarget = 60;
 
+// Time per frame allotted to tasks dispatched to the rendering thread (Android only; other
+// platforms dispatch renderer tasks through the OS run loop). Tasks beyond the budget roll
+// over to the next frame.
+static const double kRendererTaskBudgetMillis = 4.0;
+
+// Adaptive refresh rate: the preferred rate when nothing on screen changes, and the
+// lowest the display may drop to then; the fraction of the display's maximum rate the
+// display may drop to while animating; how long input holds the maximum rate; and how
+// long the content must be calmer before the rate falls
+static const float kAdaptiveFrameRateIdle = 30;
+static const float kAdaptiveFrameRateIdleMinimum = 10;
+static const float kAdaptiveFrameRateAnimatingFloor = 2.0 / 3.0;
+static const double kAdaptiveFrameRateInteractionSeconds = 1.0;
+static const double kAdaptiveFrameRateHoldSeconds = 0.5;
+
+// Scenes given to prepareSceneController are presented after this many seconds,
+// even if some of their resources are still loading
+static const double kScenePreparationTimeoutSeconds = 5.0;
+
 #pragma mark - Initialization
 
 VRORenderer::VRORenderer(VRORendererConfiguration config, std::shared_ptr<VROInputControllerBase> inputController) :
@@ -66,7 +100,27 @@ VRORenderer::VRORenderer(VRORendererConfiguration config, std::shared_ptr<VROInp
     _fpsTickIndex(0),
     _fpsTickSum(0) {
     _hasIncomingSceneTransition = false;
+    _preparationStartTime = 0;
+    _preparedGeneration = 0;
+    _renderStatistics = std::make_shared<VRORenderStatistics>(30);
+    _renderStatisticsEnabled = false;
+    _frameTelemetry = std::make_shared<VROFrameTelemetry>();
+    _frameTelemetryEnabled = false;
+    _frameTelemetryRefreshRate = kFPSTarget;
+    _frameTelemetryGPUTimer = false;
+    _frameTrace = VROFrameTelemetryTrace();
     _mpfTarget = 1000.0 / kFPSTarget;
+    _qualityGovernor = std::make_shared<VROQualityGovernor>(_mpfTarget);
+    _qualityGovernorEnabled = config.enableQualityGovernor;
+    _qualityBaselineCaptured = false;
+    _lateLatchingEnabled = config.enableLateLatching;
+    _latchAvailable = false;
+    _adaptiveFrameRateEnabled = config.enableAdaptiveFrameRate;
+    _adaptiveFrameRate = 0;
+    _adaptiveFrameRateCalmSince = 0;
+    _lastInteractionTime = 0;
+    _creationTime = VROTimeCurrentMillis();
+    _startupMetrics = { -1, -1 };
         
 #if VRO_PLATFORM_IOS || VRO_PLATFORM_ANDROID
     _debugHUD = std::unique_ptr<VRODebugHUD>(new VRODebugHUD());
@@ -75,6 +129,16 @@ VRORenderer::VRORenderer(VRORendererConfiguration config, std::shared_ptr<VROInp
     _context = std::make_shared<VRORenderContext>(_frameSynchronizer);
     _context->setPencil(std::make_shared<VROPencil>());
     memset(_fpsTickArray, 0x0, sizeof(_fpsTickArray));
+    
+    if (config.enableParallelSceneUpdate) {
+        _jobSystem = std::make_shared<VROJobSystem>();
+        if (_jobSystem->getNumWorkers() == 0) {
+            _jobSystem.reset();
+        }
+    }
+    _context->setJobSystem(_jobSystem);
+    _frameArena = std::make_shared<VROFrameArena>();
+    _context->setFrameArena(_frameArena);
 }
 
 VRORenderer::~VRORenderer() {
@@ -95,9 +159,6 @@ void VRORenderer::initRenderer(std::shared_ptr<VRODriver> driver) {
     if (delegate) {
         delegate->setupRendererWithDriver(driver);
     }
-#if VRO_PLATFORM_IOS || VRO_PLATFORM_ANDROID
-    _debugHUD->initRenderer(driver);
-#endif
 }
 
 void VRORenderer::setDelegate(std::shared_ptr<VRORenderDelegateInternal> delegate) {
@@ -110,6 +171,54 @@ void VRORenderer::setDebugHUDEnabled(bool enabled) {
 #endif
 }
 
+void VRORenderer::setProfilingEnabled(bool enabled) {
+    VROProfiler::setEnabled(enabled);
+}
+
+bool VRORenderer::exportProfilerTrace(std::string path) {
+    return VROProfiler::writeChromeTrace(path);
+}
+
+void VRORenderer::setRenderStatisticsEnabled(bool enabled, int gpuSampleInterval) {
+    _renderStatistics->setGPUSampleInterval(gpuSampleInterval);
+    _renderStatisticsEnabled = enabled;
+}
+
+void VRORenderer::resetRenderStatistics() {
+    _renderStatistics->reset();
+}
+
+std::vector<VRORenderStatisticsEntry> VRORenderer::getTopRenderedNodes(int n, VRORenderStatisticsSort sort) {
+    return _renderStatistics->getTopNodes(n, sort);
+}
+
+std::vector<VRORenderStatisticsEntry> VRORenderer::getTopRenderedMaterials(int n, VRORenderStatisticsSort sort) {
+    return _renderStatistics->getTopMaterials(n, sort);
+}
+
+std::string VRORenderer::getRenderStatisticsJSON(int n, VRORenderStatisticsSort sort) {
+    return _renderStatistics->toJSON(n, sort);
+}
+
+void VRORenderer::setFrameTelemetryEnabled(bool enabled, float refreshRate, double jankThreshold) {
+    _frameTelemetry->setJankThreshold(jankThreshold);
+    _frameTelemetryRefreshRate = refreshRate > 0 ? refreshRate : kFPSTarget;
+    _frameTelemetryEnabled = enabled;
+}
+
+void VRORenderer::resetFrameTelemetry() {
+    _frameTelemetry->reset();
+}
+
+std::string VRORenderer::getFrameTelemetryJSON(bool reset) {
+    return _frameTelemetry->toJSON(reset);
+}
+
+void VRORenderer::captureFrames(std::string directory, int frameCount) {
+    _frameCapture = std::make_shared<VROFrameCapture>(directory, frameCount);
+    _inputController->setFrameCapture(_frameCapture);
+}
+
 bool VRORenderer::setHDREnabled(bool enableHDR) {
     if (_choreographer) {
         return _choreographer->setHDREnabled(enableHDR);
@@ -140,16 +249,177 @@ bool VRORenderer::setShadowsEnabled(bool enableShadows) {
     }
 }
 
-bool VRORenderer::setBloomEnabled(bool enableBloom) {
+bool VRORenderer::setBloomEnabled(bool enableBloom, VROBloomMethod method) {
     if (_choreographer) {
-        return _choreographer->setBloomEnabled(enableBloom);
+        return _choreographer->setBloomEnabled(enableBloom, method);
     } else {
         pinfo("Modified initial renderer config for bloom");
         _initialRendererConfig.enableBloom = enableBloom;
+        _initialRendererConfig.bloomMethod = method;
         return true;
     }
 }
 
+bool VRORenderer::setClusteredLightingEnabled(bool enableClusteredLighting) {
+    if (_choreographer) {
+        return _choreographer->setClusteredLightingEnabled(enableClusteredLighting);
+    } else {
+        pinfo("Modified initial renderer config for clustered lighting");
+        _initialRendererConfig.enableClusteredLighting = enableClusteredLighting;
+        return true;
+    }
+}
+
+void VRORenderer::setDepthPrepassMode(VRODepthPrepassMode mode) {
+    if (_choreographer) {
+        _choreographer->setDepthPrepassMode(mode);
+    } else {
+        pinfo("Modified initial renderer config for depth pre-pass");
+        _initialRendererConfig.depthPrepassMode = mode;
+    }
+}
+
+bool VRORenderer::setOcclusionCullingEnabled(bool enableOcclusionCulling) {
+    if (_choreographer) {
+        return _choreographer->setOcclusionCullingEnabled(enableOcclusionCulling);
+    } else {
+        pinfo("Modified initial renderer config for occlusion culling");
+        _initialRendererConfig.enableOcclusionCulling = enableOcclusionCulling;
+        return true;
+    }
+}
+
+bool VRORenderer::setOrderIndependentTransparencyEnabled(bool enableOrderIndependentTransparency) {
+    if (_choreographer) {
+        return _choreographer->setOrderIndependentTransparencyEnabled(enableOrderIndependentTransparency);
+    } else {
+        pinfo("Modified initial renderer config for order independent transparency");
+        _initialRendererConfig.enableOrderIndependentTransparency = enableOrderIndependentTransparency;
+        return true;
+    }
+}
+
+bool VRORenderer::setMultiviewEnabled(bool enableMultiview) {
+    if (_choreographer) {
+        return _choreographer->setMultiviewEnabled(enableMultiview);
+    } else {
+        pinfo("Modified initial renderer config for multiview");
+        _initialRendererConfig.enableMultiview = enableMultiview;
+        return true;
+    }
+}
+
+void VRORenderer::setDynamicResolutionEnabled(bool enableDynamicResolution) {
+    if (_choreographer) {
+        _choreographer->setDynamicResolutionEnabled(enableDynamicResolution);
+    } else {
+        pinfo("Modified initial renderer config for dynamic resolution");
+        _initialRendererConfig.enableDynamicResolution = enableDynamicResolution;
+    }
+}
+
+bool VRORenderer::setTemporalAntialiasingEnabled(bool enableTemporalAntialiasing) {
+    if (_choreographer) {
+        return _choreographer->setTemporalAntialiasingEnabled(enableTemporalAntialiasing);
+    } else {
+        pinfo("Modified initial renderer config for temporal anti-aliasing");
+        _initialRendererConfig.enableTemporalAntialiasing = enableTemporalAntialiasing;
+        return true;
+    }
+}
+
+void VRORenderer::setRenderOnDemandEnabled(bool enableRenderOnDemand) {
+    if (_choreographer) {
+        _choreographer->setRenderOnDemandEnabled(enableRenderOnDemand);
+    } else {
+        pinfo("Modified initial renderer config for render on demand");
+        _initialRendererConfig.enableRenderOnDemand = enableRenderOnDemand;
+    }
+}
+
+void VRORenderer::setQualityGovernorEnabled(bool enableQualityGovernor) {
+    if (_qualityGovernorEnabled == enableQualityGovernor) {
+        return;
+    }
+    _qualityGovernorEnabled = enableQualityGovernor;
+    if (!enableQualityGovernor) {
+        _qualityGovernor->reset();
+        if (_choreographer) {
+            applyQualityLevel();
+        }
+    }
+}
+
+void VRORenderer::applyQualityLevel() {
+    VROQualityLevelSettings settings = VROQualityGovernor::getSettings(_qualityGovernor->getLevel());
+    if (!_qualityBaselineCaptured) {
+        if (_qualityGovernor->getLevel() == 0) {
+            return;
+        }
+        _qualityBaselineHDR = _choreographer->isHDREnabled();
+        _qualityBaselinePBR = _choreographer->isPBREnabled();
+        _qualityBaselineShadows = _choreographer->isShadowsEnabled();
+        _qualityBaselineBloom = _choreographer->isBloomEnabled();
+        _qualityBaselineBloomMethod = _choreographer->getBloomMethod();
+        _qualityBaselineCaptured = true;
+    }
+
+    _choreographer->setResolutionScaleLimit(settings.renderScale);
+    _choreographer->setHDREnabled(_qualityBaselineHDR && settings.hdr);
+    _choreographer->setPBREnabled(_qualityBaselinePBR && settings.pbr);
+    _choreographer->setShadowsEnabled(_qualityBaselineShadows && settings.shadows);
+    _choreographer->setBloomEnabled(_qualityBaselineBloom && settings.bloom, _qualityBaselineBloomMethod);
+    _context->setParticleBudgetScale(settings.particleBudgetScale);
+    _context->setAnimationLODBias(settings.animationLODBias);
+
+    // Back at full quality: later configuration changes are the application's own
+    if (_qualityGovernor->getLevel() == 0) {
+        _qualityBaselineCaptured = false;
+    }
+}
+
+bool VRORenderer::setFoveationLevel(VROFoveationLevel level) {
+    if (_choreographer) {
+        return _choreographer->setFoveationLevel(level);
+    } else {
+        pinfo("Modified initial renderer config for foveation");
+        _initialRendererConfig.foveationLevel = level;
+        return true;
+    }
+}
+
+VROFoveationLevel VRORenderer::getFoveationLevel() const {
+    if (_choreographer) {
+        return _choreographer->getFoveationLevel();
+    } else {
+        return _initialRendererConfig.foveationLevel;
+    }
+}
+
+bool VRORenderer::setShadingRateLevel(VROShadingRateLevel level) {
+    if (_choreographer) {
+        return _choreographer->setShadingRateLevel(level);
+    } else {
+        pinfo("Modified initial renderer config for variable rate shading");
+        _initialRendererConfig.shadingRateLevel = level;
+        return true;
+    }
+}
+
+VROShadingRateLevel VRORenderer::getShadingRateLevel() const {
+    if (_choreographer) {
+        return _choreographer->getShadingRateLevel();
+    } else {
+        return _initialRendererConfig.shadingRateLevel;
+    }
+}
+
+void VRORenderer::setFoveationFocalPoints(VROVector3f leftEye, VROVector3f rightEye) {
+    if (_choreographer) {
+        _choreographer->setFoveationFocalPoints(leftEye, rightEye);
+    }
+}
+
 const std::shared_ptr<VROChoreographer> VRORenderer::getChoreographer() const {
     return _choreographer;
 }
@@ -297,6 +567,16 @@ VROVector3f VRORenderer::unprojectPoint(VROVector3f point) {
 
 #pragma mark - Camera and Visibility
 
+void VRORenderer::addSecondaryView(std::shared_ptr<VROSecondaryView> view) {
+    if (std::find(_secondaryViews.begin(), _secondaryViews.end(), view) == _secondaryViews.end()) {
+        _secondaryViews.push_back(view);
+    }
+}
+
+void VRORenderer::removeSecondaryView(std::shared_ptr<VROSecondaryView> view) {
+    _secondaryViews.erase(std::remove(_secondaryViews.begin(), _secondaryViews.end(), view), _secondaryViews.end());
+}
+
 void VRORenderer::setPointOfView(std::shared_ptr<VRONode> node) {
     _pointOfView = node;
 }
@@ -314,7 +594,25 @@ void VRORenderer::setClearColor(VROVector4f color, std::shared_ptr<VRODriver> dr
 
 VROCamera VRORenderer::updateCamera(const VROViewport &viewport, const VROFieldOfView &fov,
                                     const VROMatrix4f &headRotation, const VROMatrix4f &projection) {
-    
+    VROCamera camera = computeCamera(viewport, fov, headRotation, projection, true);
+
+    _lastComputedCameraPosition = camera.getPosition();
+    _lastComputedCameraRotation = camera.getRotation().toEuler();
+    _lastComputedCameraForward = camera.getForward();
+
+    if (_cameraDelegate) {
+        _cameraDelegate->onCameraTransformationUpdate(
+                camera.getPosition(),
+                camera.getRotation().toEuler(),
+                camera.getForward());
+    }
+
+    return camera;
+}
+
+VROCamera VRORenderer::computeCamera(const VROViewport &viewport, const VROFieldOfView &fov,
+                                     const VROMatrix4f &headRotation, const VROMatrix4f &projection,
+                                     bool updateScene) {
     VROCamera camera;
     camera.setHeadRotation(headRotation);
     camera.setViewport(viewport);
@@ -342,7 +640,7 @@ VROCamera VRORenderer::updateCamera(const VROViewport &viewport, const VROFieldO
             if (nodeCamera->getRotationType() == VROCameraRotationType::Standard) {
                 camera.setPosition(_pointOfView->getWorldPosition() + nodeCamera->getPosition());
                 std::shared_ptr<VRONode> node = nodeCamera->getRefNodeToCopyRotation();
-                if (node != nullptr) {
+                if (node != nullptr && updateScene) {
                     node->setRotation(VROQuaternion(headRotation));
                 }
             }
@@ -369,19 +667,24 @@ VROCamera VRORenderer::updateCamera(const VROViewport &viewport, const VROFieldO
 
     camera.computeLookAtMatrix();
     camera.computeFrustum();
+    return camera;
+}
 
-    _lastComputedCameraPosition = camera.getPosition();
-    _lastComputedCameraRotation = camera.getRotation().toEuler();
-    _lastComputedCameraForward = camera.getForward();
-
-    if (_cameraDelegate) {
-        _cameraDelegate->onCameraTransformationUpdate(
-                camera.getPosition(),
-                camera.getRotation().toEuler(),
-                camera.getForward());
+bool VRORenderer::latchHeadRotation(VROMatrix4f headRotation) {
+    if (!_lateLatchingEnabled || !_latchAvailable) {
+        return false;
     }
+    VRO_PROFILE_SCOPE("latchHeadRotation");
 
-    return camera;
+    // Only the active camera changes: the previous camera, used for motion vectors
+    // and temporal effects, remains the one rendered last frame
+    VROCamera camera = computeCamera(_preparedViewport, _preparedFOV, headRotation, _preparedProjection, false);
+    _context->setCamera(camera);
+    _context->setEnclosureViewMatrix(VROMathComputeLookAtMatrix({ 0, 0, 0 }, camera.getForward(), camera.getUp()));
+
+    // Latch at most once per frame, so every eye renders with the same pose
+    _latchAvailable = false;
+    return true;
 }
 
 #pragma mark - Rendering
@@ -389,7 +692,17 @@ VROCamera VRORenderer::updateCamera(const VROViewport &viewport, const VROFieldO
 void VRORenderer::prepareFrame(int frame, VROViewport viewport, VROFieldOfView fov,
                                VROMatrix4f headRotation, VROMatrix4f projection, std::shared_ptr<VRODriver> driver) {
 
+    VROProfiler::beginFrame(frame);
+    VRO_PROFILE_SCOPE("prepareFrame");
+    uint64_t prepareStartNs = VRONanoTime();
+
+    // Anything invalidated from here on, including by this frame's own update, is
+    // rendered by the next frame
+    _preparedGeneration = VRORenderInvalidation::getGeneration();
+    _preparedViewport = viewport;
+
     pglpush("Viro Start Frame %d", frame);
+    double frameInterval = 0;
     if (!_rendererInitialized) {
         initRenderer(driver);
       
@@ -402,13 +715,69 @@ void VRORenderer::prepareFrame(int frame, VROViewport viewport, VROFieldOfView f
         _nanosecondsLastFrame = nanosecondsThisFrame;
         
         updateFPS(tick);
+        frameInterval = tick / (double) 1e6;
+
+        if (_qualityGovernorEnabled) {
+            double workTime = std::max(_frameEndTime - _frameStartTime, driver->getGPUFrameTime());
+            if (_qualityGovernor->update(frameInterval, workTime)) {
+                applyQualityLevel();
+            }
+        }
+    }
+#if VRO_PLATFORM_IOS || VRO_PLATFORM_ANDROID
+    // The HUD's geometry and glyphs are only built once it is first enabled
+    if (_debugHUD->isEnabled() && !_debugHUD->isInitialized()) {
+        _debugHUD->initRenderer(driver);
     }
+#endif
     
     _frameStartTime = VROTimeCurrentMillis();
-    VROTransaction::update();
+    _frameTrace.frame = frame;
+    _frameTrace.interval = frameInterval;
+    _frameTrace.render = 0;
+
+    // GPU frame times are only measured for telemetry once enabled
+    bool frameTelemetryEnabled = _frameTelemetryEnabled;
+    if (frameTelemetryEnabled != _frameTelemetryGPUTimer) {
+        driver->setGPUFrameTimerEnabled(frameTelemetryEnabled);
+        _frameTelemetryGPUTimer = frameTelemetryEnabled;
+    }
+#if VRO_PLATFORM_ANDROID || (VRO_PLATFORM_WASM && VRO_THREADS)
+    {
+        VRO_PROFILE_SCOPE("processRendererTasks");
+        int numTasks = VROPlatformProcessRendererTasks(kRendererTaskBudgetMillis);
+        VRO_PROFILE_COUNT(RendererTasks, numTasks);
+    }
+#endif
+    VRONode::applyAtomicPropertyWrites();
+    VROTransaction::update(*_context);
 
     _context->setHDREnabled(_choreographer->isHDREnabled());
     _context->setPBREnabled(_choreographer->isPBREnabled());
+    _context->setClusteredLightingEnabled(_choreographer->isClusteredLightingEnabled());
+    _context->setOrderIndependentTransparencyEnabled(_choreographer->isOrderIndependentTransparencyEnabled());
+    _context->setDepthPrepassMode(_choreographer->getDepthPrepassMode());
+
+    // Choose this frame's render scale before the eyes set their viewports
+    _choreographer->updateResolutionScale(frameInterval, driver);
+
+    // Occlusion results are only gathered for a single scene; during transitions
+    // the outgoing scene's depth would corrupt the queries
+    std::shared_ptr<VROOcclusionCuller> occlusionCuller;
+    if (!_outgoingSceneController) {
+        occlusionCuller = _choreographer->getOcclusionCuller();
+    }
+    if (occlusionCuller) {
+        occlusionCuller->collectResults(frame, *driver);
+    }
+    _context->setOcclusionCuller(occlusionCuller);
+    if (_renderStatisticsEnabled) {
+        _renderStatistics->beginFrame(frame);
+        _context->setRenderStatistics(_renderStatistics);
+    }
+    else {
+        _context->setRenderStatistics(nullptr);
+    }
     _context->setFrame(frame);
     _context->setFPS(getFPS());
     _context->getPencil()->clear();
@@ -422,16 +791,42 @@ void VRORenderer::prepareFrame(int frame, VROViewport viewport, VROFieldOfView f
     if (_sceneController) {
         if (_outgoingSceneController) {
             std::shared_ptr<VROScene> outgoingScene = _outgoingSceneController->getScene();
-            outgoingScene->computeTransforms();
+            outgoingScene->computeTransforms(_jobSystem);
             
         }
         std::shared_ptr<VROScene> scene = _sceneController->getScene();
-        scene->computeTransforms();
+        scene->computeTransforms(_jobSystem);
     }
 
     VROCamera camera = updateCamera(viewport, fov, headRotation, projection);
     _context->setPreviousCamera(_context->getCamera());
     _context->setCamera(camera);
+    
+    // Secondary views due this frame widen the visibility pass to their frustums,
+    // so that the nodes they see are updated along with the main view's
+    std::vector<VROFrustum> secondaryViewFrustums;
+    _dueSecondaryViews.clear();
+    if (_sceneController) {
+        for (std::shared_ptr<VROSecondaryView> &view : _secondaryViews) {
+            if (view->isDue(frame) && view->updateCamera(kZNear, getFarClippingPlane())) {
+                _dueSecondaryViews.push_back(view);
+                secondaryViewFrustums.push_back(view->getCamera().getFrustum());
+            }
+        }
+    }
+    _context->setSecondaryViewFrustums(secondaryViewFrustums);
+    _preparedFOV = fov;
+    _preparedProjection = projection;
+    _latchAvailable = true;
+
+    if (_frameCapture) {
+        _frameCapture->recordFrame(camera, _sceneController ? _sceneController->getScene()->getRootNode() : nullptr,
+                                   driver);
+        if (_frameCapture->isFinished()) {
+            _inputController->setFrameCapture(nullptr);
+            _frameCapture.reset();
+        }
+    }
 
     /*
      Enclosure matrix is used for rendering objects that follow the camera, such
@@ -449,38 +844,67 @@ void VRORenderer::prepareFrame(int frame, VROViewport viewport, VROFieldOfView f
     _context->setOrthographicMatrix(viewport.getOrthographicProjection(0, kZFar));
     _context->setShadowMap(nullptr);
     
-    _renderMetadata = std::make_shared<VRORenderMetadata>();
+    // Reuse the last frame's metadata when nothing else holds it
+    if (_renderMetadata && _renderMetadata.unique()) {
+        *_renderMetadata = VRORenderMetadata();
+    }
+    else {
+        _renderMetadata = std::make_shared<VRORenderMetadata>();
+    }
 
+    /*
+     The passes below run in sequence, since each depends on the node transforms
+     written by the last. When the job system is available, the constraint,
+     particle, and visibility passes are each split across independent subtrees
+     of the scene graph; every pass joins before the next begins, so the sort
+     keys are always computed (serially) from a complete scene update. Only the
+     radix passes of the final sort use the job system.
+     */
     const VRORenderContext &context = *_context.get();
     if (_sceneController) {
         if (_outgoingSceneController) {
             std::shared_ptr<VROScene> outgoingScene = _outgoingSceneController->getScene();
-            outgoingScene->computeIKRig(context);
+            outgoingScene->computeIKRig(context, _jobSystem);
             outgoingScene->computePhysics(context);
-            outgoingScene->applyConstraints(context);
-            outgoingScene->updateParticles(context);
-            outgoingScene->updateVisibility(context);
-            outgoingScene->updateSortKeys(_renderMetadata, context, driver);
+            outgoingScene->applyConstraints(context, _jobSystem);
+            outgoingScene->updateParticles(context, _jobSystem);
+            outgoingScene->updateVisibility(context, _jobSystem);
+            outgoingScene->updateSortKeys(_renderMetadata, context, driver, _jobSystem);
             outgoingScene->syncAtomicRenderProperties();
         }
 
         std::shared_ptr<VROScene> scene = _sceneController->getScene();
-        scene->computeIKRig(context);
+        scene->computeIKRig(context, _jobSystem);
         scene->computePhysics(context);
-        scene->applyConstraints(context);
-        scene->updateParticles(context);
-        scene->updateVisibility(context);
-        scene->updateSortKeys(_renderMetadata, context, driver);
+        scene->applyConstraints(context, _jobSystem);
+        scene->updateParticles(context, _jobSystem);
+        scene->updateSpatialIndex();
+        scene->updateVisibility(context, _jobSystem);
+        scene->updateSortKeys(_renderMetadata, context, driver, _jobSystem);
         scene->syncAtomicRenderProperties();
         updateSceneEffects(driver, scene);
 
+        VRO_PROFILE_SCOPE("processInput");
+        
+        // Events the controller derives from the camera are not captured, since
+        // replaying the camera reproduces them
+        _inputController->setFrameCapture(nullptr);
         _inputController->onProcess(camera);
+        _inputController->setFrameCapture(_frameCapture);
         _inputController->setView(camera.getLookAtMatrix());
         _inputController->setProjection(projection);
     }
 
     driver->willRenderFrame(context);
+    
+    // Secondary views only redo culling and sorting, against the update above
+    for (std::shared_ptr<VROSecondaryView> &view : _dueSecondaryViews) {
+        view->render(_sceneController->getScene(), context, driver);
+    }
+    _dueSecondaryViews.clear();
+    _frameTrace.prepare = (VRONanoTime() - prepareStartNs) / (double) 1e6;
 #if VRO_PLATFORM_IOS || VRO_PLATFORM_ANDROID
+    _debugHUD->addPhaseTime(VRODebugHUDPhase::Prepare, VRONanoTime() - prepareStartNs);
     _debugHUD->prepare(context);
 #endif
     pglpop();
@@ -488,7 +912,10 @@ void VRORenderer::prepareFrame(int frame, VROViewport viewport, VROFieldOfView f
 
 void VRORenderer::renderEye(VROEyeType eye, VROMatrix4f eyeView, VROMatrix4f eyeProjection,
                             VROViewport viewport, std::shared_ptr<VRODriver> driver) {
+    VRO_PROFILE_SCOPE("renderEye");
     pglpush("Viro Render Eye [%s]", VROEye::toString(eye).c_str());
+    uint64_t renderStartNs = VRONanoTime();
+    _latchAvailable = false;
     _choreographer->setViewport(viewport, driver);
     
     std::shared_ptr<VRORenderDelegateInternal> delegate = _delegate.lock();
@@ -520,12 +947,62 @@ void VRORenderer::renderEye(VROEyeType eye, VROMatrix4f eyeView, VROMatrix4f eye
     
     // This unbinds the last shader to even out our pglpush and pops
     driver->unbindShader();
+    _frameTrace.render += (VRONanoTime() - renderStartNs) / (double) 1e6;
+#if VRO_PLATFORM_IOS || VRO_PLATFORM_ANDROID
+    _debugHUD->addPhaseTime(VRODebugHUDPhase::Render, VRONanoTime() - renderStartNs);
+#endif
+    pglpop();
+}
+
+bool VRORenderer::renderMultiview(VROMatrix4f leftEyeView, VROMatrix4f rightEyeView,
+                                  VROMatrix4f leftEyeProjection, VROMatrix4f rightEyeProjection,
+                                  VROViewport viewport, std::shared_ptr<VRODriver> driver) {
+    if (!_sceneController || !_choreographer->isMultiviewEnabled()) {
+        return false;
+    }
+    
+    VRO_PROFILE_SCOPE("renderMultiview");
+    pglpush("Viro Render Multiview");
+    uint64_t renderStartNs = VRONanoTime();
+    _latchAvailable = false;
+    _choreographer->setViewport(viewport, driver);
+
+    // The standard matrices are those of the left eye, for which the preprocesses run
+    _context->setViewMatrix(leftEyeView);
+    _context->setProjectionMatrix(leftEyeProjection);
+    _context->setMultiviewMatrices(leftEyeView, rightEyeView, leftEyeProjection, rightEyeProjection);
+    _context->setEyeType(VROEyeType::Left);
+    _context->setZNear(kZNear);
+    _context->setZFar(getFarClippingPlane());
+    _context->setInputController(_inputController);
+
+    driver->willRenderEye(*_context.get());
+    bool rendered;
+    if (_outgoingSceneController && _outgoingSceneController->hasActiveTransitionAnimation()) {
+        rendered = _choreographer->renderMultiview(_sceneController->getScene(), _outgoingSceneController->getScene(),
+                                                   _renderMetadata, _context.get(), driver);
+    }
+    else {
+        rendered = _choreographer->renderMultiview(_sceneController->getScene(), nullptr,
+                                                   _renderMetadata, _context.get(), driver);
+    }
+    driver->didRenderEye(*_context.get());
+    
+    // This unbinds the last shader to even out our pglpush and pops
+    driver->unbindShader();
+    _frameTrace.render += (VRONanoTime() - renderStartNs) / (double) 1e6;
+#if VRO_PLATFORM_IOS || VRO_PLATFORM_ANDROID
+    _debugHUD->addPhaseTime(VRODebugHUDPhase::Render, VRONanoTime() - renderStartNs);
+#endif
     pglpop();
+    return rendered;
 }
 
 void VRORenderer::renderHUD(VROEyeType eye, VROMatrix4f eyeFromHeadMatrix, VROMatrix4f eyeProjection,
                             std::shared_ptr<VRODriver> driver) {
+    VRO_PROFILE_GPU_SCOPE("renderHUD", driver);
     pglpush("Viro Render HUD [%s]", VROEye::toString(eye).c_str());
+    uint64_t renderStartNs = VRONanoTime();
 
     /*
      When rendering the HUD we want the rendered elements to 'follow' the headset;
@@ -558,11 +1035,25 @@ void VRORenderer::renderHUD(VROEyeType eye, VROMatrix4f eyeFromHeadMatrix, VROMa
 
     // This unbinds the last shader to even out our pglpush and pops
     driver->unbindShader();
+    _frameTrace.render += (VRONanoTime() - renderStartNs) / (double) 1e6;
+#if VRO_PLATFORM_IOS || VRO_PLATFORM_ANDROID
+    _debugHUD->addPhaseTime(VRODebugHUDPhase::Render, VRONanoTime() - renderStartNs);
+#endif
     pglpop();
 }
 
 void VRORenderer::endFrame(std::shared_ptr<VRODriver> driver) {
     pglpush("Viro End Frame");
+    uint64_t endStartNs = VRONanoTime();
+
+    // Physics steps may overlap rendering; they must complete before tasks that can
+    // touch the physics world run below
+    if (_outgoingSceneController) {
+        _outgoingSceneController->getScene()->finishPhysics();
+    }
+    if (_sceneController) {
+        _sceneController->getScene()->finishPhysics();
+    }
 
     if (_outgoingSceneController && !_outgoingSceneController->hasActiveTransitionAnimation()) {
         _outgoingSceneController->onSceneDidDisappear(_context.get(), driver);
@@ -579,16 +1070,217 @@ void VRORenderer::endFrame(std::shared_ptr<VRODriver> driver) {
     double timeForProcessing = _mpfTarget - (_frameEndTime - _frameStartTime);
     
     VROFrameTimer timer(VROFrameType::Normal, timeForProcessing, _frameEndTime);
-    driver->getFrameScheduler()->processTasks(timer);
+    {
+        VRO_PROFILE_SCOPE("processTasks");
+        driver->getFrameScheduler()->processTasks(timer);
+    }
     
+    prewarmSceneShaders(timer, driver);
+    prepareIncomingScene(timer, driver);
     driver->didRenderFrame(timer, *_context.get());
+    updateStartupMetrics(driver);
+    _frameArena->reset();
+    _frameTrace.end = (VRONanoTime() - endStartNs) / (double) 1e6;
+    if (_frameTelemetryEnabled) {
+        recordFrameTelemetry(driver);
+    }
+#if VRO_PLATFORM_IOS || VRO_PLATFORM_ANDROID
+    _debugHUD->addPhaseTime(VRODebugHUDPhase::End, VRONanoTime() - endStartNs);
+    _debugHUD->endFrame(driver);
+#endif
     pglpop();
+    VROProfiler::endFrame();
+}
+
+void VRORenderer::recordFrameTelemetry(std::shared_ptr<VRODriver> driver) {
+    _frameTrace.gpu = driver->getGPUFrameTime();
+    _frameTrace.scene.clear();
+    if (_sceneController) {
+        _frameTrace.scene = _sceneController->getScene()->getRootNode()->getName();
+    }
+
+    // Frames shown at a lower adaptive rate are not late
+    float rate = _frameTelemetryRefreshRate;
+    if (_adaptiveFrameRateEnabled && _adaptiveFrameRate > 0) {
+        rate = std::min(rate, _adaptiveFrameRate);
+    }
+    _frameTelemetry->recordFrame(_frameTrace, 1000.0 / rate);
+}
+
+#pragma mark - Startup
+
+void VRORenderer::prewarmSceneShaders(const VROFrameTimer &timer, std::shared_ptr<VRODriver> driver) {
+    if (!_sceneController) {
+        return;
+    }
+
+    std::shared_ptr<VROScene> scene = _sceneController->getScene();
+    if (scene != _prewarmedScene.lock()) {
+        _prewarmedScene = scene;
+        _prewarmNodes.clear();
+        _prewarmLights = scene->getLights();
+
+        std::vector<std::shared_ptr<VRONode>> stack = { scene->getRootNode() };
+        while (!stack.empty()) {
+            std::shared_ptr<VRONode> node = stack.back();
+            stack.pop_back();
+
+            if (node->getGeometry()) {
+                _prewarmNodes.push_back(node);
+            }
+            std::vector<std::shared_ptr<VRONode>> children = node->getChildNodes();
+            stack.insert(stack.end(), children.begin(), children.end());
+        }
+    }
+
+    while (!_prewarmNodes.empty() && timer.isTimeRemainingInFrame()) {
+        std::shared_ptr<VRONode> node = _prewarmNodes.back().lock();
+        _prewarmNodes.pop_back();
+
+        std::shared_ptr<VROGeometry> geometry = node ? node->getGeometry() : nullptr;
+        if (!geometry) {
+            continue;
+        }
+
+        // Nodes that have not yet been rendered have no computed lights; assume they
+        // are lit by the whole scene
+        const std::vector<std::shared_ptr<VROLight>> &lights = node->getComputedLights().empty() ?
+                                                               _prewarmLights : node->getComputedLights();
+        for (const std::shared_ptr<VROMaterial> &material : geometry->getMaterials()) {
+            material->getSubstrate(driver)->prewarmShader(lights, *_context.get(), driver);
+        }
+    }
+    if (_prewarmNodes.empty()) {
+        _prewarmLights.clear();
+    }
+}
+
+void VRORenderer::updateStartupMetrics(std::shared_ptr<VRODriver> driver) {
+    if (_startupMetrics.timeToInteractive >= 0) {
+        return;
+    }
+
+    double now = VROTimeCurrentMillis();
+    if (_startupMetrics.timeToFirstFrame < 0) {
+        _startupMetrics.timeToFirstFrame = now - _creationTime;
+        pinfo("Time to first frame: %.1f ms", _startupMetrics.timeToFirstFrame);
+    }
+
+    // Interactive once a scene is rendering with nothing left to build
+    if (!_sceneController || _outgoingSceneController || !_prewarmNodes.empty() ||
+        driver->hasPendingShaderCompiles() || driver->getFrameScheduler()->getQueuedTaskCount() > 0) {
+        return;
+    }
+    _startupMetrics.timeToInteractive = now - _creationTime;
+    pinfo("Time to interactive: %.1f ms", _startupMetrics.timeToInteractive);
+}
+
+bool VRORenderer::presentIdleFrame(VROViewport viewport, std::shared_ptr<VRODriver> driver) {
+    if (!_rendererInitialized || !_choreographer || !_choreographer->isRenderOnDemandEnabled()) {
+        return false;
+    }
+    if (VRORenderInvalidation::getGeneration() != _preparedGeneration) {
+        return false;
+    }
+    if (viewport.getX() != _preparedViewport.getX() || viewport.getY() != _preparedViewport.getY() ||
+        viewport.getWidth() != _preparedViewport.getWidth() || viewport.getHeight() != _preparedViewport.getHeight()) {
+        return false;
+    }
+    if (hasContinuousUpdates(driver) ||
+        ((VROFrameSynchronizerInternal *)_frameSynchronizer.get())->hasAnimatingListeners()) {
+        return false;
+    }
+    return _choreographer->presentLastFrame(driver);
+}
+
+bool VRORenderer::hasContinuousUpdates(std::shared_ptr<VRODriver> driver) const {
+    if (_outgoingSceneController || _hasIncomingSceneTransition || _preparingSceneController ||
+        VROTransaction::hasRunningAnimations()) {
+        return true;
+    }
+    if (driver->getFrameScheduler()->getQueuedTaskCount() > 0) {
+        return true;
+    }
+    if (_sceneController && _sceneController->getScene()->hasPhysicsWorld()) {
+        return true;
+    }
+#if VRO_PLATFORM_IOS || VRO_PLATFORM_ANDROID
+    // The HUD displays live frame data
+    if (_debugHUD->isEnabled()) {
+        return true;
+    }
+#endif
+    return false;
+}
+
+void VRORenderer::requestRender() {
+    VRORenderInvalidation::invalidate();
+}
+
+void VRORenderer::notifyUserInteraction() {
+    _lastInteractionTime = VROTimeCurrentSeconds();
+    requestRender();
+}
+
+#pragma mark - Adaptive Refresh Rate
+
+VROFrameRateRange VRORenderer::getPreferredFrameRateRange(float minimumRate, float maximumRate,
+                                                         std::shared_ptr<VRODriver> driver) {
+    minimumRate = std::min(minimumRate, maximumRate);
+    if (!_adaptiveFrameRateEnabled || !_rendererInitialized) {
+        return { minimumRate, maximumRate, maximumRate };
+    }
+    double now = VROTimeCurrentSeconds();
+
+    /*
+     Interaction, animation, and any change since the frame was prepared (the same
+     tracking render-on-demand uses) call for the maximum rate. Otherwise only
+     fixed-rate content, or nothing at all, is changing.
+     */
+    float rate = kAdaptiveFrameRateIdle;
+    float contentRate = ((VROFrameSynchronizerInternal *)_frameSynchronizer.get())->getAnimatingContentFrameRate();
+    if (now - _lastInteractionTime.load() < kAdaptiveFrameRateInteractionSeconds ||
+        VRORenderInvalidation::getGeneration() != _preparedGeneration ||
+        contentRate < 0 || hasContinuousUpdates(driver)) {
+        rate = maximumRate;
+    }
+    else if (contentRate > 0) {
+        rate = contentRate;
+    }
+    rate = VROMathClamp(rate, minimumRate, maximumRate);
+
+    // Rise immediately, but fall only after the content has been calmer for the hold
+    if (rate >= _adaptiveFrameRate) {
+        _adaptiveFrameRate = rate;
+        _adaptiveFrameRateCalmSince = now;
+    }
+    else if (now - _adaptiveFrameRateCalmSince >= kAdaptiveFrameRateHoldSeconds) {
+        _adaptiveFrameRate = rate;
+        _adaptiveFrameRateCalmSince = now;
+    }
+
+    /*
+     While animating the display may drop somewhat below its maximum; fixed-rate
+     content must be shown at its own rate; and a static scene may go as low as
+     the display likes.
+     */
+    float preferred = _adaptiveFrameRate;
+    float minimum = preferred;
+    if (preferred >= maximumRate) {
+        minimum = maximumRate * kAdaptiveFrameRateAnimatingFloor;
+    }
+    else if (preferred <= kAdaptiveFrameRateIdle && contentRate == 0) {
+        minimum = kAdaptiveFrameRateIdleMinimum;
+    }
+    minimum = VROMathClamp(minimum, minimumRate, preferred);
+    return { minimum, preferred, preferred };
 }
 
 #pragma mark - Scene Loading
 
 void VRORenderer::setSceneController(std::shared_ptr<VROSceneController> sceneController,
                                      std::shared_ptr<VRODriver> driver) {
+    VROAllocationTracker::beginScene();
     std::shared_ptr<VROSceneController> outgoingSceneController = _sceneController;
     // Detach the inputcontroller before performing scene transitions
     if (_outgoingSceneController) {
@@ -615,6 +1307,7 @@ void VRORenderer::setSceneController(std::shared_ptr<VROSceneController> sceneCo
                                      VROTimingFunctionType timingFunctionType,
                                      std::shared_ptr<VRODriver> driver) {
     passert (sceneController != nullptr);
+    VROAllocationTracker::beginScene();
 
     _outgoingSceneController = _sceneController;
     _sceneController = sceneController;
@@ -637,7 +1330,122 @@ void VRORenderer::setSceneController(std::shared_ptr<VROSceneController> sceneCo
     }
 }
 
+void VRORenderer::prepareSceneController(std::shared_ptr<VROSceneController> sceneController,
+                                         std::function<void()> onPrepared) {
+    passert (sceneController != nullptr);
+    _preparingSceneController = sceneController;
+    _preparedCallback = onPrepared;
+    _preparationStartTime = VROTimeCurrentSeconds();
+    _preparingNodes.clear();
+    _preparingMaterials.clear();
+    _preparingTextures.clear();
+    _preparingLights.clear();
+
+    std::shared_ptr<VROPortal> root = sceneController->getScene()->getRootNode();
+    root->collectLights(&_preparingLights);
+
+    std::vector<std::shared_ptr<VRONode>> stack = { root };
+    while (!stack.empty()) {
+        std::shared_ptr<VRONode> node = stack.back();
+        stack.pop_back();
+
+        if (node->getGeometry() || std::dynamic_pointer_cast<VROPortal>(node)) {
+            _preparingNodes.push_back(node);
+        }
+        std::vector<std::shared_ptr<VRONode>> children = node->getChildNodes();
+        stack.insert(stack.end(), children.begin(), children.end());
+    }
+    requestRender();
+}
+
+void VRORenderer::setSceneControllerWhenPrepared(std::shared_ptr<VROSceneController> sceneController, float seconds,
+                                                 VROTimingFunctionType timingFunctionType,
+                                                 std::shared_ptr<VRODriver> driver) {
+    std::weak_ptr<VRODriver> driver_w = driver;
+    prepareSceneController(sceneController, [this, sceneController, seconds, timingFunctionType, driver_w] {
+        std::shared_ptr<VRODriver> driver = driver_w.lock();
+        if (driver) {
+            setSceneController(sceneController, seconds, timingFunctionType, driver);
+        }
+    });
+}
+
+void VRORenderer::prepareIncomingScene(const VROFrameTimer &timer, std::shared_ptr<VRODriver> driver) {
+    if (!_preparingSceneController) {
+        return;
+    }
+
+    std::function<void(std::shared_ptr<VROGeometry>)> prepareGeometry = [this, &driver] (std::shared_ptr<VROGeometry> geometry) {
+        geometry->prewarm(driver);
+        for (const std::shared_ptr<VROMaterial> &material : geometry->getMaterials()) {
+            material->prewarm(driver);
+            material->hydrateAsync([] {}, driver);
+            material->getSubstrate(driver)->prewarmShader(_preparingLights, *_context.get(), driver);
+            _preparingMaterials.push_back(material);
+        }
+    };
+
+    // Upload at least one node each frame, so that preparation always progresses
+    bool uploaded = false;
+    while (!_preparingNodes.empty() && (!uploaded || timer.isTimeRemainingInFrame())) {
+        std::shared_ptr<VRONode> node = _preparingNodes.back().lock();
+        _preparingNodes.pop_back();
+        if (!node) {
+            continue;
+        }
+        uploaded = true;
+
+        if (node->getGeometry()) {
+            prepareGeometry(node->getGeometry());
+        }
+        std::shared_ptr<VROPortal> portal = std::dynamic_pointer_cast<VROPortal>(node);
+        if (portal) {
+            if (portal->getBackground()) {
+                prepareGeometry(portal->getBackground());
+            }
+            std::shared_ptr<VROTexture> lightingEnvironment = portal->getLightingEnvironment();
+            if (lightingEnvironment) {
+                lightingEnvironment->hydrateAsync([] {}, driver);
+                _preparingTextures.push_back(lightingEnvironment);
+            }
+        }
+    }
+    if (!_preparingNodes.empty()) {
+        return;
+    }
+
+    _preparingMaterials.erase(std::remove_if(_preparingMaterials.begin(), _preparingMaterials.end(),
+                                             [] (const std::weak_ptr<VROMaterial> &material_w) {
+                                                 std::shared_ptr<VROMaterial> material = material_w.lock();
+                                                 return !material || material->isHydrated();
+                                             }), _preparingMaterials.end());
+    _preparingTextures.erase(std::remove_if(_preparingTextures.begin(), _preparingTextures.end(),
+                                            [] (const std::weak_ptr<VROTexture> &texture_w) {
+                                                std::shared_ptr<VROTexture> texture = texture_w.lock();
+                                                return !texture || texture->isHydrated();
+                                            }), _preparingTextures.end());
+
+    bool resident = _preparingMaterials.empty() && _preparingTextures.empty() && !driver->hasPendingShaderCompiles();
+    if (!resident) {
+        if (VROTimeCurrentSeconds() - _preparationStartTime < kScenePreparationTimeoutSeconds) {
+            return;
+        }
+        pwarn("Scene preparation timed out, presenting scene before all of its resources are resident");
+    }
+
+    std::function<void()> callback = _preparedCallback;
+    _preparingSceneController.reset();
+    _preparedCallback = nullptr;
+    _preparingMaterials.clear();
+    _preparingTextures.clear();
+    _preparingLights.clear();
+    if (callback) {
+        callback();
+    }
+}
+
 void VRORenderer::updateSceneEffects(std::shared_ptr<VRODriver> driver, std::shared_ptr<VROScene> scene) {
+    VRO_PROFILE_SCOPE("updateSceneEffects");
     if (scene->isPostProcessingEffectsUpdated()) {
         std::vector<std::string> effects = scene->getPostProcessingEffects();
         std::shared_ptr<VROPostProcessEffectFactory> postProcess = _choreographer->getPostProcessEffectFactory();
@@ -29,6 +29,7 @@
 
 #include <memory>
 #include <vector>
+#include <functional>
 #include "VROAtomic.h"
 #include "VROSceneController.h"
 #include "VROVector3f.h"
@@ -40,6 +41,8 @@
 #include "VROInputControllerBase.h"
 #include "VROPostProcessEffectFactory.h"
 #include "VRORendererConfiguration.h"
+#include "VRORenderStatistics.h"
+#include "VROFrameTelemetry.h"
 
 class VROEye;
 class VRONode;
@@ -51,8 +54,18 @@ class VRORenderContext;
 class VROFrameListener;
 class VRORenderDelegateInternal;
 class VROFrameScheduler;
+class VROJobSystem;
+class VROFrameArena;
 class VROChoreographer;
 class VRORenderMetadata;
+class VROQualityGovernor;
+class VROMaterial;
+class VROTexture;
+class VROLight;
+class VROScene;
+class VROFrameTimer;
+class VROFrameCapture;
+class VROSecondaryView;
 enum class VROCameraRotationType;
 enum class VROEyeType;
 enum class VROTimingFunctionType;
@@ -71,6 +84,41 @@ static const float kZFarMultiplier = 1.15;
 // Number of samples to collect when computing FPS
 static const int kFPSMaxSamples = 100;
 
+/*
+ A range of display refresh rates in frames per second, for displays that vary
+ their refresh rate (see VRORenderer::getPreferredFrameRateRange).
+ */
+struct VROFrameRateRange {
+    float minimum;
+    float maximum;
+    float preferred;
+
+    bool operator== (const VROFrameRateRange &other) const {
+        return minimum == other.minimum && maximum == other.maximum && preferred == other.preferred;
+    }
+    bool operator!= (const VROFrameRateRange &other) const {
+        return !(*this == other);
+    }
+};
+
+/*
+ Startup timings, in milliseconds since the renderer was created. Either is
+ negative until it has been reached.
+ */
+struct VROStartupMetrics {
+    /*
+     The time at which the first frame finished rendering.
+     */
+    double timeToFirstFrame;
+
+    /*
+     The time at which the first frame of a scene rendered with all of its
+     shaders and uploads complete, after which frames no longer stall or
+     omit content while resources are built.
+     */
+    double timeToInteractive;
+};
+
 // The FOV we use for the larger dimension of the viewport, when in
 // mono-rendering mode. This is similar to Hor+ scaling, in that one
 // dimension is fixed, and other is dependent on the viewport. Note
@@ -100,6 +148,50 @@ public:
      */
     void setDebugHUDEnabled(bool enabled);
 
+    /*
+     Enable or disable the frame profiler, and export everything it has
+     recorded as Chrome trace JSON (viewable in chrome://tracing or Perfetto)
+     to the given path. Export returns false if the file could not be written.
+     */
+    void setProfilingEnabled(bool enabled);
+    bool exportProfilerTrace(std::string path);
+
+    /*
+     Enable or disable per-node and per-material render statistics, which
+     accumulate the draw calls, triangles, shader variant, and sampled GPU time
+     (measured once every gpuSampleInterval frames) of everything rendered.
+     The top queries return the n most expensive nodes or materials since the
+     statistics were last reset.
+     */
+    void setRenderStatisticsEnabled(bool enabled, int gpuSampleInterval = 30);
+    void resetRenderStatistics();
+    std::vector<VRORenderStatisticsEntry> getTopRenderedNodes(int n, VRORenderStatisticsSort sort);
+    std::vector<VRORenderStatisticsEntry> getTopRenderedMaterials(int n, VRORenderStatisticsSort sort);
+    std::string getRenderStatisticsJSON(int n, VRORenderStatisticsSort sort);
+
+    /*
+     Enable or disable frame telemetry: histograms of frame interval, CPU and
+     GPU time, the vsyncs missed on a display of the given refresh rate, and the
+     phase traces of the frames around any frame longer than jankThreshold ms
+     (by default 1.5 frames). While adaptive frame rate is enabled, frames are
+     expected at the adaptive rate. The telemetry is polled as JSON, optionally
+     resetting it with the same call (see VROFrameTelemetry).
+     */
+    void setFrameTelemetryEnabled(bool enabled, float refreshRate = 60, double jankThreshold = 0);
+    void resetFrameTelemetry();
+    std::string getFrameTelemetryJSON(bool reset = false);
+
+    /*
+     Capture the input of the next frameCount frames (a snapshot of the scene,
+     the camera and clock of each frame, and the input events in between) to
+     the given directory, for deterministic replay by VROFrameReplay. Replaces
+     any capture in progress. Must be invoked on the rendering thread.
+     */
+    void captureFrames(std::string directory, int frameCount);
+    bool isCapturingFrames() const {
+        return _frameCapture != nullptr;
+    }
+
     /*
      Set renderer configuration properties. These are forwarded to the
      choreographer once it's created.
@@ -107,7 +199,47 @@ public:
     bool setHDREnabled(bool enableHDR);
     bool setPBREnabled(bool enablePBR);
     bool setShadowsEnabled(bool enableShadows);
-    bool setBloomEnabled(bool enableBloom);
+    bool setBloomEnabled(bool enableBloom, VROBloomMethod method = VROBloomMethod::DualFilter);
+    bool setClusteredLightingEnabled(bool enableClusteredLighting);
+    void setDepthPrepassMode(VRODepthPrepassMode mode);
+    bool setOcclusionCullingEnabled(bool enableOcclusionCulling);
+    bool setOrderIndependentTransparencyEnabled(bool enableOrderIndependentTransparency);
+    bool setMultiviewEnabled(bool enableMultiview);
+    bool setFoveationLevel(VROFoveationLevel level);
+    VROFoveationLevel getFoveationLevel() const;
+    bool setShadingRateLevel(VROShadingRateLevel level);
+    VROShadingRateLevel getShadingRateLevel() const;
+    void setDynamicResolutionEnabled(bool enableDynamicResolution);
+    bool setTemporalAntialiasingEnabled(bool enableTemporalAntialiasing);
+    void setRenderOnDemandEnabled(bool enableRenderOnDemand);
+
+    /*
+     Enable late latching of the head rotation (see latchHeadRotation).
+     */
+    void setLateLatchingEnabled(bool enableLateLatching) {
+        _lateLatchingEnabled = enableLateLatching;
+    }
+    bool isLateLatchingEnabled() const {
+        return _lateLatchingEnabled;
+    }
+
+    /*
+     Enable the quality governor, which reduces the render scale and features above
+     as the device heats up or frames run slow (see VROQualityGovernor). Disabling
+     it restores full quality. Set a callback on the governor to be notified of
+     level changes.
+     */
+    void setQualityGovernorEnabled(bool enableQualityGovernor);
+    std::shared_ptr<VROQualityGovernor> getQualityGovernor() const {
+        return _qualityGovernor;
+    }
+
+    /*
+     Set the gaze point of each eye, in normalized device coordinates, about which
+     foveated rendering retains full resolution. Invoke each frame before rendering
+     on platforms with eye tracking; otherwise foveation is fixed at the center.
+     */
+    void setFoveationFocalPoints(VROVector3f leftEye, VROVector3f rightEye);
 
     /*
      Get the VROChoreographer, which can be used to customize the rendering
@@ -115,6 +247,15 @@ public:
      */
     const std::shared_ptr<VROChoreographer> getChoreographer() const;
 
+#pragma mark - Secondary Views
+
+    /*
+     Add or remove a secondary view, which renders the scene from its own camera
+     into a texture at the start of each frame it is due (see VROSecondaryView).
+     */
+    void addSecondaryView(std::shared_ptr<VROSecondaryView> view);
+    void removeSecondaryView(std::shared_ptr<VROSecondaryView> view);
+
 #pragma mark - Viewport and FOV
 
     /*
@@ -192,6 +333,25 @@ public:
                             VROTimingFunctionType timingFunctionType,
                             std::shared_ptr<VRODriver> driver);
 
+    /*
+     Prepare the given scene controller's scene before it is presented: upload its
+     geometry and textures, build its shaders, and load its lighting environment,
+     a bounded amount each frame. The callback is invoked on the rendering thread,
+     at the end of a frame, once the scene is resident (or after a timeout, if some
+     of its resources never finish). Replaces any preparation already in progress.
+     Must be invoked on the rendering thread.
+     */
+    void prepareSceneController(std::shared_ptr<VROSceneController> sceneController,
+                                std::function<void()> onPrepared);
+
+    /*
+     Prepare the given scene controller, and start the animated transition to it
+     once it is resident, so that the transition does not stall on uploads.
+     */
+    void setSceneControllerWhenPrepared(std::shared_ptr<VROSceneController> sceneController, float seconds,
+                                        VROTimingFunctionType timingFunctionType,
+                                        std::shared_ptr<VRODriver> driver);
+
     /*
      Applies scene specific post processing configuration effects to the renderer if we
      haven't yet done so already (since the scene had appeared), or if it had changed.
@@ -224,6 +384,62 @@ public:
     void renderEye(VROEyeType eye, VROMatrix4f eyeView, VROMatrix4f eyeProjection,
                    VROViewport viewport, std::shared_ptr<VRODriver> driver);
 
+    /*
+     Render the scene for both eyes with a single set of draw calls, when multiview
+     is available. Invoke after prepareFrame and before the renderEye calls for the
+     frame, which then only perform their eye's post-processing. The viewport is
+     that of a single eye. Returns false if nothing was rendered, in which case
+     renderEye renders each eye in full.
+     */
+    bool renderMultiview(VROMatrix4f leftEyeView, VROMatrix4f rightEyeView,
+                         VROMatrix4f leftEyeProjection, VROMatrix4f rightEyeProjection,
+                         VROViewport viewport, std::shared_ptr<VRODriver> driver);
+
+    /*
+     Late latching: when enabled, invoke after prepareFrame and before renderMultiview
+     or the first renderEye, with the freshest head rotation the platform can provide.
+     The camera is recomputed from it, so the scene update, sort, and culling use the
+     older pose given to prepareFrame while what is rendered uses the newest. Eye views
+     must then be derived from getLookAtMatrix() again. Returns false, leaving the
+     camera unchanged, if late latching is disabled or no frame has been prepared.
+     */
+    bool latchHeadRotation(VROMatrix4f headRotation);
+
+    /*
+     Adaptive refresh rate: when enabled, invoke after each endFrame to get the range
+     of refresh rates suited to what is on screen, for displays that vary their
+     refresh rate. The range is the display's maximum while the user interacts or
+     anything animates; the content's own rate when only fixed-rate content such as
+     video is changing; and low when nothing changes, as tracked for
+     render-on-demand. The range rises immediately, but only falls once the content
+     has been calmer for a short hold, so brief pauses don't bounce the display.
+     The range is bounded by the given rates; minimumRate should be the rate of any
+     content the renderer does not track, such as an AR camera feed.
+     */
+    VROFrameRateRange getPreferredFrameRateRange(float minimumRate, float maximumRate,
+                                                 std::shared_ptr<VRODriver> driver);
+    void setAdaptiveFrameRateEnabled(bool enableAdaptiveFrameRate) {
+        _adaptiveFrameRateEnabled = enableAdaptiveFrameRate;
+    }
+    bool isAdaptiveFrameRateEnabled() const {
+        return _adaptiveFrameRateEnabled;
+    }
+
+    /*
+     Return the time to first frame and time to interactive of this renderer,
+     which are also logged when reached.
+     */
+    VROStartupMetrics getStartupMetrics() const {
+        return _startupMetrics;
+    }
+
+    /*
+     Notify the renderer of user input, which holds the display at its maximum
+     refresh rate while the user interacts, and renders the next frame in
+     render-on-demand mode. May be invoked from any thread.
+     */
+    void notifyUserInteraction();
+
     /*
      Render the HUD for the eye. The HUD follows the view, but is not 2D in that HUD elements
      can appear at different depths. The eyeFromHeadMatrix and eyeProjection are required for
@@ -237,6 +453,23 @@ public:
      */
     void endFrame(std::shared_ptr<VRODriver> driver);
 
+    /*
+     Render-on-demand: when enabled, invoke at the start of each display refresh. If
+     nothing that affects the image has changed since the last frame was prepared (no
+     scene mutations or renderer tasks, running animations, animating frame listeners
+     such as playing videos, scene transitions, queued frame tasks, physics, or viewport
+     changes), the last frame is re-presented and true is returned; the caller must then
+     skip prepareFrame through endFrame. Returns false if the frame must be rendered.
+     */
+    bool presentIdleFrame(VROViewport viewport, std::shared_ptr<VRODriver> driver);
+
+    /*
+     Force the next frame to render in render-on-demand mode. Scene changes made through
+     the node, material, and animation APIs are tracked automatically; this is for
+     changes the renderer cannot observe. May be invoked from any thread.
+     */
+    void requestRender();
+
 #pragma mark - Integration
     
     std::shared_ptr<VROFrameSynchronizer> getFrameSynchronizer() {
@@ -331,6 +564,51 @@ private:
      */
     std::unique_ptr<VRODebugHUD> _debugHUD;
     
+    /*
+     Per-node and per-material render statistics, installed in the render
+     context each frame while enabled.
+     */
+    std::shared_ptr<VRORenderStatistics> _renderStatistics;
+    std::atomic<bool> _renderStatisticsEnabled;
+
+    /*
+     Frame telemetry, and the trace of the frame in progress, which is timed
+     whether or not telemetry is enabled.
+     */
+    std::shared_ptr<VROFrameTelemetry> _frameTelemetry;
+    std::atomic<bool> _frameTelemetryEnabled;
+    std::atomic<float> _frameTelemetryRefreshRate;
+    bool _frameTelemetryGPUTimer;
+    VROFrameTelemetryTrace _frameTrace;
+    void recordFrameTelemetry(std::shared_ptr<VRODriver> driver);
+
+    /*
+     The frame capture in progress, if any.
+     */
+    std::shared_ptr<VROFrameCapture> _frameCapture;
+
+    /*
+     The VRORenderInvalidation generation and the viewport at the start of the last
+     prepared frame, against which presentIdleFrame detects changes.
+     */
+    uint64_t _preparedGeneration;
+    VROViewport _preparedViewport;
+
+    /*
+     The quality governor, and the features the application had enabled when it
+     first reduced quality, which are restored when it returns to level 0.
+     */
+    std::shared_ptr<VROQualityGovernor> _qualityGovernor;
+    bool _qualityGovernorEnabled;
+    bool _qualityBaselineCaptured;
+    bool _qualityBaselineHDR, _qualityBaselinePBR, _qualityBaselineShadows, _qualityBaselineBloom;
+    VROBloomMethod _qualityBaselineBloomMethod;
+
+    /*
+     Apply the settings of the governor's current level.
+     */
+    void applyQualityLevel();
+    
     /*
      The initial configuration to use for the renderer. These settings can be
      changed directly in the VROChoreographer after the renderer is initialized.
@@ -355,10 +633,86 @@ private:
      view from which we display the scene.
      */
     std::shared_ptr<VRONode> _pointOfView;
+    
+    /*
+     The secondary views of the renderer, and those due to render this frame.
+     */
+    std::vector<std::shared_ptr<VROSecondaryView>> _secondaryViews;
+    std::vector<std::shared_ptr<VROSecondaryView>> _dueSecondaryViews;
 
     VROCamera updateCamera(const VROViewport &viewport, const VROFieldOfView &fov,
                            const VROMatrix4f &headRotation, const VROMatrix4f &projection);
 
+    /*
+     Compute the camera for the given head rotation from the point of view. When
+     updateScene is false, nodes that copy the head rotation are left untouched
+     (used when late latching, after the scene has been updated for the frame).
+     */
+    VROCamera computeCamera(const VROViewport &viewport, const VROFieldOfView &fov,
+                            const VROMatrix4f &headRotation, const VROMatrix4f &projection,
+                            bool updateScene);
+
+    /*
+     Late latching state: the viewport, FOV, and projection given to the last
+     prepareFrame, from which the camera is recomputed when the head rotation
+     is latched.
+     */
+    bool _lateLatchingEnabled;
+    bool _latchAvailable;
+    VROFieldOfView _preparedFOV;
+    VROMatrix4f _preparedProjection;
+
+#pragma mark - [Private] Adaptive Refresh Rate
+
+    /*
+     The preferred refresh rate last returned by getPreferredFrameRateRange, and the
+     time since which a lower rate has sufficed.
+     */
+    bool _adaptiveFrameRateEnabled;
+    float _adaptiveFrameRate;
+    double _adaptiveFrameRateCalmSince;
+
+    /*
+     True if something other than the tracked scene state, such as an animation,
+     transition, physics, or a queued task, updates the scene continuously.
+     */
+    bool hasContinuousUpdates(std::shared_ptr<VRODriver> driver) const;
+
+    /*
+     The time of the last user interaction, in seconds.
+     */
+    std::atomic<double> _lastInteractionTime;
+
+#pragma mark - [Private] Startup
+
+    /*
+     The time at which this renderer was created, and the startup timings
+     measured from it.
+     */
+    double _creationTime;
+    VROStartupMetrics _startupMetrics;
+
+    /*
+     The scene whose shaders were last prewarmed, and its nodes whose material
+     shaders have yet to be built, along with the lights of the scene.
+     */
+    std::weak_ptr<VROScene> _prewarmedScene;
+    std::vector<std::weak_ptr<VRONode>> _prewarmNodes;
+    std::vector<std::shared_ptr<VROLight>> _prewarmLights;
+
+    /*
+     Begin building the shaders of every material in the active scene the
+     first time it is rendered, including nodes that are hidden or off screen,
+     so they are ready by the time they are first drawn. Shaders are built
+     with whatever time the frame has left.
+     */
+    void prewarmSceneShaders(const VROFrameTimer &timer, std::shared_ptr<VRODriver> driver);
+
+    /*
+     Record the startup timings reached by the frame that just ended.
+     */
+    void updateStartupMetrics(std::shared_ptr<VRODriver> driver);
+
     /*
      TODO: Revisit unifying Camera APIs in VIRO-2235.
      */
@@ -411,6 +765,18 @@ private:
      frame time allows.
      */
     std::shared_ptr<VROFrameScheduler> _frameScheduler;
+    
+    /*
+     Worker pool used to parallelize the scene update in prepareFrame. Null
+     if parallel scene update is disabled.
+     */
+    std::shared_ptr<VROJobSystem> _jobSystem;
+
+    /*
+     Linear allocator for the scratch data of each frame, reset at the end of
+     the frame.
+     */
+    std::shared_ptr<VROFrameArena> _frameArena;
 
 #pragma mark - [Private] Scene and Scene Transitions
     
@@ -418,6 +784,26 @@ private:
     std::shared_ptr<VROSceneController> _outgoingSceneController;
     bool _hasIncomingSceneTransition;
 
+    /*
+     The scene controller being prepared by prepareSceneController, the callback
+     to invoke once it is resident, and the time preparation began. The nodes
+     have yet to be uploaded; the materials and lighting environments are
+     uploaded but may still be waiting on their textures.
+     */
+    std::shared_ptr<VROSceneController> _preparingSceneController;
+    std::function<void()> _preparedCallback;
+    double _preparationStartTime;
+    std::vector<std::weak_ptr<VRONode>> _preparingNodes;
+    std::vector<std::weak_ptr<VROMaterial>> _preparingMaterials;
+    std::vector<std::weak_ptr<VROTexture>> _preparingTextures;
+    std::vector<std::shared_ptr<VROLight>> _preparingLights;
+
+    /*
+     Continue preparing the scene controller given to prepareSceneController,
+     with the time left in the frame.
+     */
+    void prepareIncomingScene(const VROFrameTimer &timer, std::shared_ptr<VRODriver> driver);
+
 #pragma mark - [Private] Frame Listeners
     
     /*
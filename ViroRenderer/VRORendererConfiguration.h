@@ -29,6 +29,54 @@
 
 #include <stdio.h>
 
+/*
+ Controls the depth pre-pass, which renders opaque geometry to the depth buffer
+ with a cheap shader before the color pass, so that expensive fragment shaders
+ run at most once per pixel. Automatic enables it each frame based on the
+ estimated fragment cost and triangle count of the opaque contents.
+ */
+enum class VRODepthPrepassMode {
+    Disabled,
+    Enabled,
+    Automatic
+};
+
+/*
+ Controls foveated rendering in VR, which renders the periphery of each eye at a
+ lower pixel density than the region around the focal point (the lens center, or
+ the gaze point when eye tracking is available). Higher levels reduce fill cost
+ further at the expense of peripheral sharpness.
+ */
+enum class VROFoveationLevel {
+    None = 0,
+    Low = 1,
+    Medium = 2,
+    High = 3
+};
+
+/*
+ Controls variable rate shading, which shades content that does not need per-pixel
+ detail at coarser rates: backgrounds (including the AR camera feed), translucent
+ unlit geometry such as UI, distant geometry, and in VR the periphery of each eye.
+ Higher levels shade that content more coarsely, and over more of the screen.
+ */
+enum class VROShadingRateLevel {
+    None = 0,
+    Low = 1,
+    High = 2
+};
+
+/*
+ Controls how bloom is blurred. Gaussian runs a separable Gaussian blur over a
+ half resolution target. DualFilter progressively downsamples the bloom input
+ to 1/32 resolution and upsamples it back, which is much cheaper in bandwidth
+ and produces a wider glow.
+ */
+enum class VROBloomMethod {
+    Gaussian,
+    DualFilter
+};
+
 class VRORendererConfiguration {
 public:
     bool enableShadows = true;
@@ -36,6 +84,75 @@ public:
     bool enableHDR = true;
     bool enablePBR = true;
     bool enableMultisampling = false;
+
+    // The blur used to spread bloom, when bloom is enabled
+    VROBloomMethod bloomMethod = VROBloomMethod::DualFilter;
+    
+    // Render unshadowed omni and spot lights through a view frustum cluster
+    // grid, instead of culling them per node (lifting the per-object light limit)
+    bool enableClusteredLighting = false;
+
+    // Run the scene update passes (transforms, constraints, particles,
+    // and visibility) across a pool of worker threads
+    bool enableParallelSceneUpdate = true;
+
+    // Render opaque geometry to the depth buffer before the color pass
+    VRODepthPrepassMode depthPrepassMode = VRODepthPrepassMode::Disabled;
+
+    // Skip rendering subtrees whose bounds were hidden behind the depth pre-pass
+    // in recent frames, as determined by hardware occlusion queries
+    bool enableOcclusionCulling = false;
+
+    // Render alpha blended geometry in the root portal with weighted blended
+    // order independent transparency instead of sorting it (requires HDR)
+    bool enableOrderIndependentTransparency = false;
+
+    // Render the base pass for both eyes in a single pass in VR, where
+    // OVR_multiview2 is supported
+    bool enableMultiview = true;
+
+    // Render the periphery of each eye at reduced density in VR, via
+    // QCOM_texture_foveated (or the VR runtime's foveation) where supported
+    VROFoveationLevel foveationLevel = VROFoveationLevel::None;
+
+    // Shade content that does not need per-pixel detail at coarser rates, via
+    // EXT_fragment_shading_rate or QCOM_shading_rate where supported
+    VROShadingRateLevel shadingRateLevel = VROShadingRateLevel::None;
+
+    // Scale the HDR render resolution between the given bounds (relative to the
+    // display) to hold the target frame rate; the tone-mapping pass upscales the
+    // result to the display
+    bool enableDynamicResolution = false;
+    float dynamicResolutionMinScale = 0.5;
+    float dynamicResolutionMaxScale = 1.0;
+    float dynamicResolutionTargetFPS = 60;
+
+    // Jitter the projection each frame and accumulate the results into full resolution
+    // history, anti-aliasing the scene and upsampling it from a reduced resolution
+    // (see VROTemporalAntialiasingRenderPass)
+    bool enableTemporalAntialiasing = false;
+
+    // Skip rendering frames in which nothing in the scene has changed, re-presenting
+    // the last frame instead (see VRORenderer::presentIdleFrame)
+    bool enableRenderOnDemand = false;
+
+    // Progressively reduce quality as the device heats up or frames run slow, and
+    // restore it as they recover (see VROQualityGovernor)
+    bool enableQualityGovernor = false;
+
+    // Recompute the camera from a freshly sampled head pose just before the eyes are
+    // rendered, after the scene has been updated and culled (see
+    // VRORenderer::latchHeadRotation)
+    bool enableLateLatching = false;
+
+    // Vary the display's refresh rate on adaptive refresh rate displays (e.g.
+    // ProMotion) with what is on screen (see VRORenderer::getPreferredFrameRateRange)
+    bool enableAdaptiveFrameRate = false;
+
+    // Evaluate PBR diffuse irradiance from spherical harmonics instead of an
+    // irradiance map, skipping the irradiance convolution and its texture fetch;
+    // also enables ambient spherical harmonics from AR light estimation
+    bool enableSphericalHarmonicsIrradiance = false;
 };
 
 #endif /* VRORendererConfiguration_h */
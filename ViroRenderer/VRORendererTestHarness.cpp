@@ -58,6 +58,9 @@
 #include "VROObjectRecognitionTest.h"
 #include "VROBodyRecognitionTest.h"
 #include "VROBodyMesherTest.h"
+#include "VROBenchmarkTest.h"
+#include "VROInstancingTest.h"
+#include "VROParallelUpdateTest.h"
 
 VRORendererTestHarness::VRORendererTestHarness(std::shared_ptr<VRORenderer> renderer,
                                                std::shared_ptr<VROFrameSynchronizer> frameSynchronizer,
@@ -160,6 +163,12 @@ std::shared_ptr<VRORendererTest> VRORendererTestHarness::createTest(VRORendererT
             return std::make_shared<VROBodyRecognitionTest>();
         case VRORendererTestType::BodyMesher:
             return std::make_shared<VROBodyMesherTest>();
+        case VRORendererTestType::Benchmark:
+            return std::make_shared<VROBenchmarkTest>();
+        case VRORendererTestType::Instancing:
+            return std::make_shared<VROInstancingTest>();
+        case VRORendererTestType::ParallelUpdate:
+            return std::make_shared<VROParallelUpdateTest>();
         default:
             pabort();
             return nullptr;
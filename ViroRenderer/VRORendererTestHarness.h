@@ -67,6 +67,9 @@ enum class VRORendererTestType {
     ObjectRecognition,
     BodyRecognition,
     BodyMesher,
+    Benchmark,
+    Instancing,
+    ParallelUpdate,
     NumTests,
 };
 
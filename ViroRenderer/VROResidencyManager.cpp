@@ -0,0 +1,115 @@
+//
+//  VROResidencyManager.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROResidencyManager.h"
+#include "VROTexture.h"
+#include "VROGeometry.h"
+#include "VROLog.h"
+#include <algorithm>
+
+// The number of frames a resource must go unrendered before it is evicted at
+// each pressure level. Critical pressure evicts everything not rendered in
+// the last frame.
+static const int kLowPressureIdleFrames = 600;
+static const int kModeratePressureIdleFrames = 120;
+static const int kCriticalPressureIdleFrames = 0;
+
+/*
+ Remove the expired resources from the given list, and return the rest that
+ have been idle for longer than idleFrames, least recently used first.
+ */
+template <typename T>
+static std::vector<std::shared_ptr<T>> collectIdle(std::vector<std::weak_ptr<T>> &resources,
+                                                    int frame, int idleFrames) {
+    std::vector<std::shared_ptr<T>> idle;
+    for (auto it = resources.begin(); it != resources.end();) {
+        std::shared_ptr<T> resource = it->lock();
+        if (!resource) {
+            it = resources.erase(it);
+            continue;
+        }
+        ++it;
+
+        if (frame - resource->getLastRenderedFrame() > idleFrames) {
+            idle.push_back(resource);
+        }
+    }
+    std::stable_sort(idle.begin(), idle.end(), [](const std::shared_ptr<T> &a, const std::shared_ptr<T> &b) {
+        return a->getLastRenderedFrame() < b->getLastRenderedFrame();
+    });
+    return idle;
+}
+
+VROResidencyManager::VROResidencyManager() :
+    _evictedTextureBytes(0),
+    _evictedTextureCount(0),
+    _evictedGeometryCount(0) {
+
+}
+
+VROResidencyManager::~VROResidencyManager() {
+
+}
+
+void VROResidencyManager::addTexture(std::shared_ptr<VROTexture> texture) {
+    _textures.push_back(texture);
+}
+
+void VROResidencyManager::addGeometry(std::shared_ptr<VROGeometry> geometry) {
+    _geometries.push_back(geometry);
+}
+
+void VROResidencyManager::evict(VROMemoryPressure pressure, int frame) {
+    int idleFrames = kLowPressureIdleFrames;
+    if (pressure == VROMemoryPressure::Moderate) {
+        idleFrames = kModeratePressureIdleFrames;
+    }
+    else if (pressure == VROMemoryPressure::Critical) {
+        idleFrames = kCriticalPressureIdleFrames;
+    }
+
+    int64_t textureBytes = 0;
+    int textureCount = 0;
+    for (std::shared_ptr<VROTexture> &texture : collectIdle(_textures, frame, idleFrames)) {
+        int64_t bytes = texture->evict();
+        if (bytes >= 0) {
+            textureBytes += bytes;
+            textureCount++;
+        }
+    }
+
+    int geometryCount = 0;
+    for (std::shared_ptr<VROGeometry> &geometry : collectIdle(_geometries, frame, idleFrames)) {
+        if (geometry->evictSubstrate()) {
+            geometryCount++;
+        }
+    }
+
+    _evictedTextureBytes += textureBytes;
+    _evictedTextureCount += textureCount;
+    _evictedGeometryCount += geometryCount;
+    pinfo("Memory pressure %d: evicted %d textures (%lld KB) and %d geometries", (int) pressure,
+          textureCount, (long long) (textureBytes / 1024), geometryCount);
+}
@@ -0,0 +1,103 @@
+//
+//  VROResidencyManager.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROResidencyManager_h
+#define VROResidencyManager_h
+
+#include <memory>
+#include <vector>
+#include <stdint.h>
+
+class VROTexture;
+class VROGeometry;
+
+/*
+ Severity of a memory warning from the platform. Android's onTrimMemory levels
+ and iOS memory warnings are mapped onto these (see VRODriver::onMemoryPressure).
+ */
+enum class VROMemoryPressure {
+    Low,
+    Moderate,
+    Critical
+};
+
+/*
+ Tracks the GPU resources that can be rebuilt on demand, and evicts the least
+ recently used of them when the platform signals memory pressure. Geometry
+ substrates are always rebuilt from their retained sources. Textures are
+ tracked only if they can reload their image (see VROTexture::setReloadSource
+ and VROTexture::setStreamingSource). An evicted resource is re-hydrated the
+ next time it is rendered: geometry immediately, and textures in the
+ background, which render blank until they are uploaded.
+
+ Each pressure level evicts resources that have not been rendered for a
+ number of frames, oldest first; critical pressure evicts everything not
+ rendered in the last frame.
+
+ All methods must be invoked on the rendering thread.
+ */
+class VROResidencyManager {
+public:
+
+    VROResidencyManager();
+    virtual ~VROResidencyManager();
+
+    /*
+     Begin tracking the given resource. Invoked when the resource is first
+     uploaded. The manager does not retain its resources.
+     */
+    void addTexture(std::shared_ptr<VROTexture> texture);
+    void addGeometry(std::shared_ptr<VROGeometry> geometry);
+
+    /*
+     Evict the resources the given pressure calls for, as of the given frame.
+     */
+    void evict(VROMemoryPressure pressure, int frame);
+
+    /*
+     Totals across all evictions, for diagnostics. Texture bytes are the
+     estimated GPU memory released; geometry is counted by substrate.
+     */
+    int64_t getEvictedTextureBytes() const {
+        return _evictedTextureBytes;
+    }
+    int getEvictedTextureCount() const {
+        return _evictedTextureCount;
+    }
+    int getEvictedGeometryCount() const {
+        return _evictedGeometryCount;
+    }
+
+private:
+
+    std::vector<std::weak_ptr<VROTexture>> _textures;
+    std::vector<std::weak_ptr<VROGeometry>> _geometries;
+    int64_t _evictedTextureBytes;
+    int _evictedTextureCount;
+    int _evictedGeometryCount;
+
+};
+
+#endif /* VROResidencyManager_h */
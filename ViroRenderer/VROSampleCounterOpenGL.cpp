@@ -0,0 +1,107 @@
+//
+//  VROSampleCounterOpenGL.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROSampleCounterOpenGL.h"
+#include "VROProfiler.h"
+#include "VROLog.h"
+
+VROSampleCounterOpenGL::VROSampleCounterOpenGL() :
+    _currentFrame(0),
+    _queryOpen(false) {
+
+}
+
+VROSampleCounterOpenGL::~VROSampleCounterOpenGL() {
+    for (int i = 0; i < kSampleCounterFrameLatency; i++) {
+        for (VROSampleQuery &query : _frames[i]) {
+            _freeQueries.push_back(query.query);
+        }
+    }
+    if (!_freeQueries.empty()) {
+        GL( glDeleteQueries((GLsizei) _freeQueries.size(), _freeQueries.data()) );
+    }
+}
+
+void VROSampleCounterOpenGL::begin(int numPixels) {
+    if (_queryOpen || numPixels < 0) {
+        return;
+    }
+
+    GLuint query;
+    if (_freeQueries.empty()) {
+        GL( glGenQueries(1, &query) );
+    }
+    else {
+        query = _freeQueries.back();
+        _freeQueries.pop_back();
+    }
+
+    GL( glBeginQuery(GL_SAMPLES_PASSED, query) );
+    _frames[_currentFrame].push_back({ query, numPixels });
+    _queryOpen = true;
+}
+
+void VROSampleCounterOpenGL::end() {
+    if (!_queryOpen) {
+        return;
+    }
+    GL( glEndQuery(GL_SAMPLES_PASSED) );
+    _queryOpen = false;
+}
+
+void VROSampleCounterOpenGL::nextFrame() {
+    if (_queryOpen) {
+        end();
+    }
+    _currentFrame = (_currentFrame + 1) % kSampleCounterFrameLatency;
+    collect(_frames[_currentFrame]);
+}
+
+void VROSampleCounterOpenGL::collect(std::vector<VROSampleQuery> &queries) {
+    if (queries.empty()) {
+        return;
+    }
+
+    // Aggregate over the frame's queries (e.g. one per eye)
+    uint64_t samples = 0;
+    uint64_t pixels = 0;
+    for (VROSampleQuery &query : queries) {
+        GLuint available = 0;
+        GL( glGetQueryObjectuiv(query.query, GL_QUERY_RESULT_AVAILABLE, &available) );
+
+        if (available) {
+            GLuint numSamples = 0;
+            GL( glGetQueryObjectuiv(query.query, GL_QUERY_RESULT, &numSamples) );
+            samples += numSamples;
+            pixels += query.numPixels;
+        }
+        _freeQueries.push_back(query.query);
+    }
+    queries.clear();
+
+    if (pixels > 0) {
+        VRO_PROFILE_COUNT(Overdraw, (int) (samples * 100 / pixels));
+    }
+}
@@ -0,0 +1,86 @@
+//
+//  VROSampleCounterOpenGL.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROSampleCounterOpenGL_h
+#define VROSampleCounterOpenGL_h
+
+#include "VROOpenGL.h"
+#include <vector>
+
+#ifndef GL_SAMPLES_PASSED
+#define GL_SAMPLES_PASSED 0x8914
+#endif
+
+/*
+ Number of frames a sample query is given to complete before its result is
+ read.
+ */
+static const int kSampleCounterFrameLatency = 3;
+
+/*
+ Measures overdraw with GL_SAMPLES_PASSED occlusion queries (desktop GL or
+ ARB_occlusion_query; GLES only offers boolean occlusion queries). Each query
+ counts the samples that pass the depth test over a span of draws covering
+ the given number of pixels; the ratio, as a percentage, is reported to the
+ profiler's Overdraw counter kSampleCounterFrameLatency frames later. A value
+ of 100% means each pixel was shaded once.
+ */
+class VROSampleCounterOpenGL {
+public:
+
+    VROSampleCounterOpenGL();
+    virtual ~VROSampleCounterOpenGL();
+
+    /*
+     Open and close a query. Only one query may be open at a time. A query
+     opened with zero pixels continues the measurement of the previous query
+     in the frame, after it was closed to make way for other occlusion queries.
+     */
+    void begin(int numPixels);
+    void end();
+
+    /*
+     Advance to the next frame, collecting the results of the queries issued
+     kSampleCounterFrameLatency frames ago.
+     */
+    void nextFrame();
+
+private:
+
+    struct VROSampleQuery {
+        GLuint query;
+        int numPixels;
+    };
+
+    std::vector<VROSampleQuery> _frames[kSampleCounterFrameLatency];
+    int _currentFrame;
+    std::vector<GLuint> _freeQueries;
+    bool _queryOpen;
+
+    void collect(std::vector<VROSampleQuery> &queries);
+
+};
+
+#endif /* VROSampleCounterOpenGL_h */
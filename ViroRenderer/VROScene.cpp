@@ -32,11 +32,27 @@
 #include "VROInputControllerBase.h"
 #include "VROHitTestResult.h"
 #include "VROLog.h"
+#include "VROProfiler.h"
 #include "VROAudioPlayer.h"
 #include "VROPencil.h"
 #include "VROToneMappingRenderPass.h"
+#include "VROTransformHierarchy.h"
+#include "VROSceneSnapshot.h"
+#include "VROSpatialIndex.h"
+#include "VROLight.h"
+#include "VROIKRig.h"
+#include "VROJobSystem.h"
+#include "VROTime.h"
 #include <stack>
 #include <algorithm>
+#include <unordered_set>
+
+// Time allotted each frame to solving the scene's IK rigs
+static const uint64_t kIKSolveBudgetNs = 2000000;
+
+// Light culling versions are unique across scenes, so nodes moved between
+// scenes never match a stale version
+static uint32_t sLightCullingVersion = 0;
 
 VROScene::VROScene() : VROThreadRestricted(VROThreadName::Renderer),
     _postProcessingEffectsUpdated(false),
@@ -44,10 +60,12 @@ VROScene::VROScene() : VROThreadRestricted(VROThreadName::Renderer),
     _toneMappingMethod(VROToneMappingMethod::HableLuminanceOnly),
     _toneMappingExposure(kToneMappingDefaultExposure),
     _toneMappingWhitePoint(kToneMappingDefaultWhitePoint),
-    _toneMappingUpdated(false) {
+    _toneMappingUpdated(false),
+    _spatialIndexVersion(0) {
         
     _rootNode = std::make_shared<VROPortal>();
     _rootNode->setName("Root");
+    _snapshot = std::make_shared<VROSceneSnapshot>();
     _activePortal = _rootNode;
     _activePortal->setPassable(true);
     
@@ -60,33 +78,92 @@ VROScene::~VROScene() {
 
 #pragma mark - Render Cycle
 
-void VROScene::computeTransforms() {
-    _rootNode->computeTransforms({}, {});
+void VROScene::computeTransforms(std::shared_ptr<VROJobSystem> &jobs) {
+    VRO_PROFILE_SCOPE("computeTransforms");
+    if (_transformHierarchy) {
+        _transformHierarchy->update(_rootNode);
+    } else if (jobs) {
+        _rootNode->computeTransformsParallel(jobs);
+    } else {
+        _rootNode->computeTransforms({}, {});
+    }
 }
 
-void VROScene::updateVisibility(const VRORenderContext &context) {
-    _rootNode->updateVisibility(context);
+void VROScene::setTransformHierarchyEnabled(bool enabled) {
+    passert_thread(__func__);
+    if (enabled && !_transformHierarchy) {
+        _transformHierarchy = std::make_shared<VROTransformHierarchy>();
+    } else if (!enabled) {
+        _transformHierarchy.reset();
+    }
 }
 
-void VROScene::applyConstraints(const VRORenderContext &context) {
-    _rootNode->applyConstraints(context, {}, false);
+void VROScene::updateVisibility(const VRORenderContext &context, std::shared_ptr<VROJobSystem> &jobs) {
+    VRO_PROFILE_SCOPE("updateVisibility");
+    // The batched test covers only the camera's frustum
+    if (_transformHierarchy && context.getSecondaryViewFrustums().empty() &&
+        _transformHierarchy->updateVisibility(_rootNode, context)) {
+        return;
+    }
+    if (jobs) {
+        _rootNode->updateVisibilityParallel(context, jobs);
+    } else {
+        _rootNode->updateVisibility(context);
+    }
 }
 
-void VROScene::computeIKRig(const VRORenderContext &context) {
-    _rootNode->computeIKRig();
+void VROScene::applyConstraints(const VRORenderContext &context, std::shared_ptr<VROJobSystem> &jobs) {
+    VRO_PROFILE_SCOPE("applyConstraints");
+    if (jobs) {
+        _rootNode->applyConstraintsParallel(context, jobs);
+    } else {
+        _rootNode->applyConstraints(context, {}, false);
+    }
+}
+
+void VROScene::computeIKRig(const VRORenderContext &context, std::shared_ptr<VROJobSystem> &jobs) {
+    VRO_PROFILE_SCOPE("computeIKRig");
+    std::vector<std::shared_ptr<VROIKRig>> rigs;
+    _rootNode->collectIKRigs(&rigs);
+    if (rigs.empty()) {
+        return;
+    }
+
+    // Solving only touches each rig's own joints, so rigs are solved in
+    // parallel; the results are then synced to the nodes and skeletons here
+    uint64_t deadlineNs = VRONanoTime() + kIKSolveBudgetNs;
+    if (jobs && rigs.size() > 1) {
+        jobs->parallelFor(0, (int) rigs.size(), 1, [&rigs, deadlineNs](int i) {
+            rigs[i]->solveRig(deadlineNs);
+        });
+    } else {
+        for (std::shared_ptr<VROIKRig> &rig : rigs) {
+            rig->solveRig(deadlineNs);
+        }
+    }
+    for (std::shared_ptr<VROIKRig> &rig : rigs) {
+        rig->syncRig();
+    }
 }
 
 void VROScene::syncAtomicRenderProperties() {
-    _rootNode->syncAppThreadProperties();
+    _snapshot->publish(_rootNode);
 }
 
-void VROScene::updateParticles(const VRORenderContext &context) {
-    _rootNode->updateParticles(context);
+void VROScene::updateParticles(const VRORenderContext &context, std::shared_ptr<VROJobSystem> &jobs) {
+    VRO_PROFILE_SCOPE("updateParticles");
+    if (jobs) {
+        _rootNode->updateParticlesParallel(context, jobs);
+    } else {
+        _rootNode->updateParticles(context);
+    }
 }
 
 void VROScene::updateSortKeys(std::shared_ptr<VRORenderMetadata> &metadata,
-                              const VRORenderContext &context, std::shared_ptr<VRODriver> &driver) {
+                              const VRORenderContext &context, std::shared_ptr<VRODriver> &driver,
+                              std::shared_ptr<VROJobSystem> &jobs) {
     passert_thread(__func__);
+    VRO_PROFILE_SCOPE("updateSortKeys");
     
     if (kDebugSortOrder && context.getFrame() % kDebugSortOrderFrameFrequency == 0) {
         pinfo("Updating sort keys");
@@ -96,13 +173,38 @@ void VROScene::updateSortKeys(std::shared_ptr<VRORenderMetadata> &metadata,
     _lights.clear();
     _rootNode->collectLights(&_lights);
 
-    VRORenderParameters renderParams;
-    renderParams.lights = _lights;
+    // Assign a new culling version if any light was added, removed, or changed
+    VROFrameArena *arena = context.getFrameArena().get();
+    VROFrameVector<std::pair<uint32_t, uint32_t>> lightCullingSignature((VROFrameAllocator<std::pair<uint32_t, uint32_t>>(arena)));
+    lightCullingSignature.reserve(_lights.size() + 1);
+    for (const std::shared_ptr<VROLight> &light : _lights) {
+        lightCullingSignature.push_back({ light->getLightId(), light->getCullingVersion() });
+    }
+    // Toggling clustered lighting changes which lights are culled per node
+    lightCullingSignature.push_back({ UINT32_MAX, context.isClusteredLightingEnabled() ? 1 : 0 });
+    if (_lightCullingVersion == 0 || lightCullingSignature.size() != _lightCullingSignature.size() ||
+        !std::equal(lightCullingSignature.begin(), lightCullingSignature.end(), _lightCullingSignature.begin())) {
+        _lightCullingSignature.assign(lightCullingSignature.begin(), lightCullingSignature.end());
+        _lightCullingVersion = ++sLightCullingVersion;
+    }
+
+    if (_lightBinsVersion != _lightCullingVersion) {
+        VRO_PROFILE_SCOPE("binLights");
+        _lightBins.build(_lights, context.isClusteredLightingEnabled());
+        _lightBinsVersion = _lightCullingVersion;
+    }
+
+    VRORenderParameters renderParams(arena);
+    renderParams.lightBins = &_lightBins;
+    renderParams.lightCullingVersion = _lightCullingVersion;
     _rootNode->updateSortKeys(0, renderParams, metadata, context, driver);
     
+    _sortKeyNodesVisited = renderParams.nodesVisited;
+    _sortKeyNodesRevalidated = renderParams.nodesRevalidated;
+    
     createPortalTree(context);
-    _portals.walkTree([] (std::shared_ptr<VROPortal> portal) {
-        portal->sortNodesBySortKeys();
+    _portals.walkTree([&jobs, &context] (std::shared_ptr<VROPortal> portal) {
+        portal->sortNodesBySortKeys(context, jobs);
     });
     
     _distanceOfFurthestObjectFromCamera = renderParams.furthestDistanceFromCamera;
@@ -122,7 +224,7 @@ void VROScene::setActivePortal(const std::shared_ptr<VROPortal> portal) {
 void VROScene::createPortalTree(const VRORenderContext &context) {
     _portals.children.clear();
     _portals.value.reset();
-    _activePortal->traversePortals(context.getFrame(), 0, nullptr, &_portals);
+    _activePortal->traversePortals(context, 0, nullptr, { -1, -1, 1, 1 }, &_portals);
     
     // Sort each recursion level by distance from camera, so that we render
     // sibling portals (portals on same recursion level) front to back
@@ -151,7 +253,7 @@ bool VROScene::hasNode_helper(const std::shared_ptr<VRONode> &candidate, const s
         return true;
     }
     else {
-        for (std::shared_ptr<VRONode> &child : candidate->getChildNodes()) {
+        for (const std::shared_ptr<VRONode> &child : candidate->getSubnodes()) {
             if (hasNode_helper(child, node)) {
                 return true;
             }
@@ -160,7 +262,7 @@ bool VROScene::hasNode_helper(const std::shared_ptr<VRONode> &candidate, const s
     }
 }
 
-const tree<std::shared_ptr<VROPortal>> VROScene::getPortalTree() const {
+const tree<std::shared_ptr<VROPortal>> &VROScene::getPortalTree() const {
     return _portals;
 }
 
@@ -171,7 +273,7 @@ std::vector<std::shared_ptr<VROGeometry>> VROScene::getBackgrounds() const {
     return backgrounds;
 }
 
-void VROScene::getBackgrounds(std::shared_ptr<VRONode> node, std::vector<std::shared_ptr<VROGeometry>> &backgrounds) const {
+void VROScene::getBackgrounds(const std::shared_ptr<VRONode> &node, std::vector<std::shared_ptr<VROGeometry>> &backgrounds) const {
     if (node->getType() == VRONodeType::Portal) {
         std::shared_ptr<VROPortal> portal = std::dynamic_pointer_cast<VROPortal>(node);
         if (portal->getBackground() != nullptr) {
@@ -179,11 +281,118 @@ void VROScene::getBackgrounds(std::shared_ptr<VRONode> node, std::vector<std::sh
         }
     }
     
-    for (std::shared_ptr<VRONode> &child : node->getChildNodes()) {
+    for (const std::shared_ptr<VRONode> &child : node->getSubnodes()) {
         getBackgrounds(child, backgrounds);
     }
 }
 
+#pragma mark - Spatial Queries
+
+static void VROCollectSpatialIndexNodes(const VRONode *node, std::vector<VRONode *> &nodes) {
+    for (const std::shared_ptr<VRONode> &child : node->getSubnodes()) {
+        nodes.push_back(child.get());
+        VROCollectSpatialIndexNodes(child.get(), nodes);
+    }
+}
+
+void VROScene::updateSpatialIndex() {
+    if (!_spatialIndex) {
+        return;
+    }
+    VRO_PROFILE_SCOPE("updateSpatialIndex");
+    
+    if (VROTransformHierarchy::getGraphStructureVersion() != _spatialIndexVersion) {
+        syncSpatialIndex();
+    }
+    else if (_transformHierarchy) {
+        // The hierarchy was flattened at the current version, so the nodes it
+        // updated are exactly the nodes whose bounds may have moved
+        std::shared_ptr<VROSpatialIndex> &index = _spatialIndex;
+        _transformHierarchy->forEachUpdatedNode([&index](VRONode *node) {
+            if (index->contains(node)) {
+                index->update(node, node->getBoundingBox());
+            }
+        });
+    }
+    else {
+        // No structure change, so every indexed node is still alive. Nodes
+        // that remain within their fat bounds cost one containment test
+        std::vector<VRONode *> nodes;
+        nodes.reserve(_spatialIndex->getNumNodes());
+        _spatialIndex->forEachNode([&nodes](VRONode *node) {
+            nodes.push_back(node);
+        });
+        for (VRONode *node : nodes) {
+            _spatialIndex->update(node, node->getBoundingBox());
+        }
+    }
+}
+
+void VROScene::syncSpatialIndex() {
+    // Some indexed nodes may no longer be in the scene (or may no longer
+    // exist), so re-collect the live nodes and drop indexed nodes that are
+    // not among them without dereferencing them
+    std::vector<VRONode *> nodes;
+    VROCollectSpatialIndexNodes(_rootNode.get(), nodes);
+    
+    std::unordered_set<VRONode *> live(nodes.begin(), nodes.end());
+    std::vector<VRONode *> removed;
+    _spatialIndex->forEachNode([&live, &removed](VRONode *node) {
+        if (live.find(node) == live.end()) {
+            removed.push_back(node);
+        }
+    });
+    for (VRONode *node : removed) {
+        _spatialIndex->remove(node);
+    }
+    for (VRONode *node : nodes) {
+        _spatialIndex->update(node, node->getBoundingBox());
+    }
+    _spatialIndexVersion = VROTransformHierarchy::getGraphStructureVersion();
+}
+
+const std::shared_ptr<VROSpatialIndex> &VROScene::getSpatialIndex() {
+    if (!_spatialIndex) {
+        _spatialIndex = std::make_shared<VROSpatialIndex>();
+        syncSpatialIndex();
+    } else {
+        updateSpatialIndex();
+    }
+    return _spatialIndex;
+}
+
+static std::vector<std::shared_ptr<VRONode>> VROSharedSpatialIndexNodes(const std::vector<VRONode *> &nodes) {
+    std::vector<std::shared_ptr<VRONode>> shared;
+    shared.reserve(nodes.size());
+    for (VRONode *node : nodes) {
+        shared.push_back(std::static_pointer_cast<VRONode>(node->shared_from_this()));
+    }
+    return shared;
+}
+
+std::vector<std::shared_ptr<VRONode>> VROScene::findNodesInRadius(VROVector3f center, float radius) {
+    passert_thread(__func__);
+    std::vector<VRONode *> nodes;
+    getSpatialIndex()->queryRadius(center, radius, &nodes);
+    return VROSharedSpatialIndexNodes(nodes);
+}
+
+std::vector<std::shared_ptr<VRONode>> VROScene::findNodesInBox(const VROBoundingBox &box) {
+    passert_thread(__func__);
+    std::vector<VRONode *> nodes;
+    getSpatialIndex()->queryBox(box, &nodes);
+    return VROSharedSpatialIndexNodes(nodes);
+}
+
+std::shared_ptr<VRONode> VROScene::findNearestNode(VROVector3f point, float maxDistance) {
+    passert_thread(__func__);
+    VRONode *node = getSpatialIndex()->queryNearest(point, maxDistance);
+    if (!node) {
+        return nullptr;
+    }
+    return std::static_pointer_cast<VRONode>(node->shared_from_this());
+}
+
 #pragma mark - Input Controllers
 
 void VROScene::detachInputController(std::shared_ptr<VROInputControllerBase> controller) {
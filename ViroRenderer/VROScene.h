@@ -37,6 +37,7 @@
 #include "VROThreadRestricted.h"
 #include "VROPhysicsWorld.h"
 #include "VROTree.h"
+#include "VROLightBins.h"
 
 class VRONode;
 class VROPortal;
@@ -50,6 +51,11 @@ class VROVector4f;
 class VROAudioPlayer;
 class VRORenderMetadata;
 class VROInputControllerBase;
+class VROJobSystem;
+class VROTransformHierarchy;
+class VROSceneSnapshot;
+class VROSpatialIndex;
+class VROBoundingBox;
 enum class VROToneMappingMethod;
 
 class VROScene : public std::enable_shared_from_this<VROScene>, public VROThreadRestricted {
@@ -63,42 +69,65 @@ public:
     
     /*
      Compute the transforms, recursively, for all nodes in this scene.
+
+     This and the other render cycle passes below accept an optional job
+     system; if provided, independent subtrees of the scene graph are
+     processed in parallel. Each pass returns only when complete.
+     */
+    void computeTransforms(std::shared_ptr<VROJobSystem> &jobs);
+    
+    /*
+     Enable or disable the flattened transform hierarchy. When enabled,
+     computeTransforms only recomputes the transforms of nodes that have
+     changed (and their descendants), instead of walking the entire graph.
+     Intended for scenes with large amounts of static content. Disabled by
+     default.
      */
-    void computeTransforms();
+    void setTransformHierarchyEnabled(bool enabled);
+    bool isTransformHierarchyEnabled() const {
+        return _transformHierarchy != nullptr;
+    }
 
     /*
-     Update the visibility status of all nodes in the scene graph.
+     Update the visibility status of all nodes in the scene graph. When the
+     transform hierarchy is enabled, its flattened graph is culled in a single
+     batch.
      */
-    void updateVisibility(const VRORenderContext &context);
+    void updateVisibility(const VRORenderContext &context, std::shared_ptr<VROJobSystem> &jobs);
     
     /*
      Update the particle emitters in the scene graph.
      */
-    virtual void updateParticles(const VRORenderContext &context);
+    virtual void updateParticles(const VRORenderContext &context, std::shared_ptr<VROJobSystem> &jobs);
     
     /*
      Apply transformation constraints (e.g. billboarding) to all nodes in
      the scene.
      */
-    void applyConstraints(const VRORenderContext &context);
+    void applyConstraints(const VRORenderContext &context, std::shared_ptr<VROJobSystem> &jobs);
 
     /*
      Applies a rig constraint computation pass to all applicable sub nodes.
+     Independent rigs are solved in parallel when a job system is provided,
+     and all rigs share a per-frame time budget; rigs that exhaust it resume
+     solving next frame.
      */
-    void computeIKRig(const VRORenderContext &context);
+    void computeIKRig(const VRORenderContext &context, std::shared_ptr<VROJobSystem> &jobs);
 
     /*
-     Notifies the root node that the render properties have settled and
-     that it should sync them now with their corresponding atomics.
+     Notifies the scene that the render properties have settled, and
+     publishes them to the application thread's atomics.
      */
     void syncAtomicRenderProperties();
     
     /*
-     Update the sort keys for all nodes in this scene.
+     Update the sort keys for all nodes in this scene, and sort each portal's
+     keys into rendering order.
      */
     void updateSortKeys(std::shared_ptr<VRORenderMetadata> &metadata,
                         const VRORenderContext &context,
-                        std::shared_ptr<VRODriver> &driver);
+                        std::shared_ptr<VRODriver> &driver,
+                        std::shared_ptr<VROJobSystem> &jobs);
     
 #pragma mark - Scene Introspection
     
@@ -122,6 +151,42 @@ public:
     const std::vector<std::shared_ptr<VROLight>> &getLights() const {
         return _lights;
     }
+
+    /*
+     Statistics from the last call to updateSortKeys: the number of visible
+     nodes visited, and the number whose cached per-node products (world
+     inverse-transpose and light list) were revalidated.
+     */
+    int getNumSortKeyNodesVisited() const {
+        return _sortKeyNodesVisited;
+    }
+    int getNumSortKeyNodesRevalidated() const {
+        return _sortKeyNodesRevalidated;
+    }
+    
+#pragma mark - Spatial Queries
+    
+    /*
+     Find the nodes whose world bounding boxes lie within the given distance
+     of a point or intersect a box, or the node whose bounding box is nearest
+     to a point (within maxDistance). Only each node's own bounds are
+     considered, not the bounds of its subtree, and visibility is ignored.
+
+     Queries are answered by a spatial index over the scene, which is built on
+     the first query and maintained each frame thereafter by
+     updateSpatialIndex(). Must be invoked on the rendering thread.
+     */
+    std::vector<std::shared_ptr<VRONode>> findNodesInRadius(VROVector3f center, float radius);
+    std::vector<std::shared_ptr<VRONode>> findNodesInBox(const VROBoundingBox &box);
+    std::shared_ptr<VRONode> findNearestNode(VROVector3f point, float maxDistance);
+    
+    /*
+     Bring the spatial index up to date with the bounds computed this frame,
+     if the index has been created. Invoked by the renderer after transforms
+     and constraints are applied. When the transform hierarchy is enabled,
+     only the nodes it updated are revisited.
+     */
+    void updateSpatialIndex();
     
 #pragma mark - Physics
     
@@ -140,6 +205,15 @@ public:
         return _physicsWorld;
     }
 
+    /*
+     Replace the physics world of this scene, e.g. with one configured for a
+     multithreaded solver or a different broadphase. Must be set before bodies are
+     added.
+     */
+    void setPhysicsWorld(std::shared_ptr<VROPhysicsWorld> physicsWorld) {
+        _physicsWorld = physicsWorld;
+    }
+
     /*
      Computes the physics simulation for the current frame, if a VROPhysicsWorld
      exists.
@@ -149,6 +223,16 @@ public:
             _physicsWorld->computePhysics(context);
         }
     }
+
+    /*
+     Completes the physics step started by computePhysics, if it is running on the
+     physics thread.
+     */
+    void finishPhysics() {
+        if (_physicsWorld != nullptr) {
+            _physicsWorld->finishPhysics();
+        }
+    }
     
 #pragma mark - Input
 
@@ -169,9 +253,10 @@ public:
     void setActivePortal(std::shared_ptr<VROPortal> node);
     
     /*
-     Get the portal tree. Reconstructed each frame.
+     Get the portal tree. Reconstructed each frame, so the returned reference
+     should not be held past the current frame.
      */
-    const tree<std::shared_ptr<VROPortal>> getPortalTree() const;
+    const tree<std::shared_ptr<VROPortal>> &getPortalTree() const;
     
     /*
      Get the active portal, which is the portal the user is currently "inside".
@@ -243,7 +328,7 @@ protected:
     /*
      Retrieve all background textures in the scene.
      */
-    void getBackgrounds(std::shared_ptr<VRONode> node, std::vector<std::shared_ptr<VROGeometry>> &backgrounds) const;
+    void getBackgrounds(const std::shared_ptr<VRONode> &node, std::vector<std::shared_ptr<VROGeometry>> &backgrounds) const;
     
 private:
     
@@ -261,6 +346,26 @@ private:
      All the lights in the scene, as collected during the last render cycle.
      */
     std::vector<std::shared_ptr<VROLight>> _lights;
+
+    /*
+     The ID and culling version of each light as of the last frame, and the
+     version assigned to that set. The version changes whenever the set does,
+     which invalidates the light lists cached by each node.
+     */
+    std::vector<std::pair<uint32_t, uint32_t>> _lightCullingSignature;
+    uint32_t _lightCullingVersion = 0;
+
+    /*
+     The lights binned for culling, rebuilt when the culling version changes.
+     */
+    VROLightBins _lightBins;
+    uint32_t _lightBinsVersion = 0;
+
+    /*
+     Sort key statistics from the last frame.
+     */
+    int _sortKeyNodesVisited = 0;
+    int _sortKeyNodesRevalidated = 0;
     
     /*
      The distance from the camera of the furthest away object, since the last
@@ -279,6 +384,31 @@ private:
      */
     std::vector<std::shared_ptr<VROParticleEmitter>> _activeParticles;
     
+    /*
+     Flattened hierarchy used to compute transforms, if enabled.
+     */
+    std::shared_ptr<VROTransformHierarchy> _transformHierarchy;
+    
+    /*
+     Index over the bounds of the scene's nodes, created on the first spatial
+     query, and the graph structure version it was last synchronized with.
+     */
+    std::shared_ptr<VROSpatialIndex> _spatialIndex;
+    uint32_t _spatialIndexVersion;
+    
+    /*
+     Return the spatial index, creating it or bringing it up to date first.
+     Synchronizing walks the scene graph, reconciling the index with its
+     current nodes.
+     */
+    const std::shared_ptr<VROSpatialIndex> &getSpatialIndex();
+    void syncSpatialIndex();
+
+    /*
+     Publishes the render properties of each node to the application thread.
+     */
+    std::shared_ptr<VROSceneSnapshot> _snapshot;
+    
     /*
      The active portal; the scene is rendered as though the camera is in this
      portal. Defaults to the root node.
@@ -0,0 +1,657 @@
+//
+//  VROSceneArchive.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include "VROSceneArchive.h"
+#include "VRONode.h"
+#include "VROGeometry.h"
+#include "VROGeometrySource.h"
+#include "VROGeometryElement.h"
+#include "VROGeometryCache.h"
+#include "VROMaterial.h"
+#include "VROMaterialVisual.h"
+#include "VROTexture.h"
+#include "VROVertexBuffer.h"
+#include "VRODriver.h"
+#include "VROData.h"
+#include "VROModelIOUtil.h"
+#include "VROPlatformUtil.h"
+#include "VROLog.h"
+#include <map>
+#include <set>
+#include <vector>
+#include <string.h>
+
+static const uint32_t kSceneArchiveMagic = 0x56524f41; // 'VROA'
+static const uint32_t kSceneArchiveVersion = 1;
+
+// Number of material visuals stored per material; see getArchivedVisual(). Reflective
+// visuals hold cube maps, which aren't loaded from resources, so they are not stored.
+static const int kNumArchivedVisuals = 9;
+
+static const uint32_t kSceneArchiveNodeHidden = 1;
+static const uint32_t kSceneArchiveNodeIgnoresEvents = 1 << 1;
+
+static const uint32_t kSceneArchiveMaterialWritesDepth = 1;
+static const uint32_t kSceneArchiveMaterialReadsDepth = 1 << 1;
+static const uint32_t kSceneArchiveMaterialReceivesShadows = 1 << 2;
+static const uint32_t kSceneArchiveMaterialCastsShadows = 1 << 3;
+
+/*
+ The file is laid out as the header followed by each table in the order of the
+ header's counts, then the string table. Strings are referenced by their offset
+ into the string table, and are null terminated. Nodes are stored in depth-first
+ order, so each node's parent precedes it; the first node is the root. Geometry i
+ is mesh i of the geometry cache entry under meshKey.
+ */
+struct VROSceneArchiveHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t meshKey;
+    uint32_t numNodes;
+    uint32_t numGeometries;
+    uint32_t numMaterialSlots;
+    uint32_t numMaterials;
+    uint32_t numTextures;
+    uint32_t stringsLength;
+};
+
+struct VROSceneArchiveNode {
+    int32_t parent;
+    int32_t geometry;
+    uint32_t name;
+    uint32_t tag;
+    float position[3];
+    float rotation[4];
+    float scale[3];
+    float opacity;
+    int32_t renderingOrder;
+    int32_t lightReceivingBitMask;
+    int32_t shadowCastingBitMask;
+    uint32_t flags;
+};
+
+struct VROSceneArchiveGeometry {
+    uint32_t name;
+    uint32_t firstMaterialSlot;
+    uint32_t numMaterials;
+    uint32_t padding;
+};
+
+struct VROSceneArchiveVisual {
+    float color[4];
+    float intensity;
+    int32_t texture;
+};
+
+struct VROSceneArchiveMaterial {
+    uint32_t name;
+    int32_t lightingModel;
+    int32_t blendMode;
+    int32_t cullMode;
+    int32_t transparencyMode;
+    float shininess;
+    float fresnelExponent;
+    float transparency;
+    float bloomThreshold;
+    int32_t renderingOrder;
+    uint32_t flags;
+    VROSceneArchiveVisual visuals[kNumArchivedVisuals];
+};
+
+struct VROSceneArchiveTexture {
+    uint32_t resource;
+    int32_t resourceType;
+    int32_t sRGB;
+};
+
+/*
+ A texture to load once a restored graph is handed to the renderer, and the
+ material visuals (by index, see getArchivedVisual()) to set it on.
+ */
+struct VROSceneArchivePendingTexture {
+    std::string resource;
+    VROResourceType type;
+    bool sRGB;
+    std::vector<std::pair<std::shared_ptr<VROMaterial>, int>> bindings;
+};
+
+/*
+ The result of parsing an archive on a background thread.
+ */
+struct VROSceneArchiveContents {
+    std::shared_ptr<VRONode> root;
+    std::vector<std::shared_ptr<VROThreadRestricted>> unrestrictedObjects;
+    std::vector<VROSceneArchivePendingTexture> textures;
+};
+
+static VROMaterialVisual &getArchivedVisual(const VROMaterial &material, int index) {
+    switch (index) {
+        case 0:  return material.getDiffuse();
+        case 1:  return material.getSpecular();
+        case 2:  return material.getNormal();
+        case 3:  return material.getRoughness();
+        case 4:  return material.getMetalness();
+        case 5:  return material.getAmbientOcclusion();
+        case 6:  return material.getEmission();
+        case 7:  return material.getMultiply();
+        default: return material.getSelfIllumination();
+    }
+}
+
+static std::shared_ptr<VROData> getSourceData(const std::shared_ptr<VROGeometrySource> &source) {
+    std::shared_ptr<VROVertexBuffer> vbo = source->getVertexBuffer();
+    return vbo ? vbo->getData() : source->getData();
+}
+
+/*
+ Geometry can be archived if all of its data can be read back on the CPU.
+ */
+static bool isArchivable(const VROGeometry &geometry) {
+    if (geometry.getGeometryElements().empty()) {
+        return false;
+    }
+    for (const std::shared_ptr<VROGeometrySource> &source : geometry.getGeometrySources()) {
+        if (!getSourceData(source)) {
+            return false;
+        }
+    }
+    for (const std::shared_ptr<VROGeometryElement> &element : geometry.getGeometryElements()) {
+        if (!element->getData()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename T>
+static void appendRecords(std::vector<uint8_t> &out, const std::vector<T> &records) {
+    if (!records.empty()) {
+        const uint8_t *bytes = (const uint8_t *) records.data();
+        out.insert(out.end(), bytes, bytes + records.size() * sizeof(T));
+    }
+}
+
+template <typename T>
+static bool readRecords(const uint8_t *bytes, size_t length, size_t *position, uint32_t count,
+                        std::vector<T> *outRecords) {
+    if ((length - *position) / sizeof(T) < count) {
+        return false;
+    }
+    outRecords->resize(count);
+    if (count > 0) {
+        memcpy(outRecords->data(), bytes + *position, count * sizeof(T));
+    }
+    *position += count * sizeof(T);
+    return true;
+}
+
+#pragma mark - Saving
+
+bool VROSceneArchive::save(std::shared_ptr<VRONode> root, std::string path, std::shared_ptr<VRODriver> driver,
+                           std::shared_ptr<VROGeometryCache> geometryCache) {
+    if (!geometryCache && driver) {
+        geometryCache = driver->getGeometryCache();
+    }
+    if (!geometryCache || !root) {
+        pwarn("Scene archives require a geometry cache");
+        return false;
+    }
+
+    std::string strings;
+    std::map<std::string, uint32_t> stringOffsets;
+    auto addString = [&strings, &stringOffsets](const std::string &string) {
+        auto it = stringOffsets.find(string);
+        if (it != stringOffsets.end()) {
+            return it->second;
+        }
+        uint32_t offset = (uint32_t) strings.size();
+        strings.append(string);
+        strings.push_back('\0');
+        stringOffsets[string] = offset;
+        return offset;
+    };
+    addString("");
+
+    std::vector<VROSceneArchiveNode> nodeRecords;
+    std::vector<VROSceneArchiveGeometry> geometryRecords;
+    std::vector<int32_t> materialSlots;
+    std::vector<VROSceneArchiveMaterial> materialRecords;
+    std::vector<VROSceneArchiveTexture> textureRecords;
+    std::vector<VROCachedMesh> meshes;
+
+    std::map<VROTexture *, int> textureIndices;
+    auto addTexture = [&textureRecords, &textureIndices, &addString](const std::shared_ptr<VROTexture> &texture) {
+        if (!texture) {
+            return -1;
+        }
+        if (texture->getSourceResource().empty()) {
+            pwarn("Texture %s was not loaded from a resource and will not be archived", texture->getName().c_str());
+            return -1;
+        }
+        auto it = textureIndices.find(texture.get());
+        if (it != textureIndices.end()) {
+            return it->second;
+        }
+        int index = (int) textureRecords.size();
+        textureIndices[texture.get()] = index;
+        textureRecords.push_back({ addString(texture->getSourceResource()),
+                                   (int32_t) texture->getSourceResourceType(), texture->isSRGB() });
+        return index;
+    };
+
+    std::map<VROMaterial *, int> materialIndices;
+    auto addMaterial = [&materialRecords, &materialIndices, &addString, &addTexture](const std::shared_ptr<VROMaterial> &material) {
+        auto it = materialIndices.find(material.get());
+        if (it != materialIndices.end()) {
+            return it->second;
+        }
+
+        VROSceneArchiveMaterial record;
+        memset(&record, 0, sizeof(record));
+        record.name = addString(material->getName());
+        record.lightingModel = (int32_t) material->getLightingModel();
+        record.blendMode = (int32_t) material->getBlendMode();
+        record.cullMode = (int32_t) material->getCullMode();
+        record.transparencyMode = (int32_t) material->getTransparencyMode();
+        record.shininess = material->getShininess();
+        record.fresnelExponent = material->getFresnelExponent();
+        record.transparency = material->getTransparency();
+        record.bloomThreshold = material->getBloomThreshold();
+        record.renderingOrder = material->getRenderingOrder();
+        record.flags = (material->getWritesToDepthBuffer() ? kSceneArchiveMaterialWritesDepth : 0) |
+                       (material->getReadsFromDepthBuffer() ? kSceneArchiveMaterialReadsDepth : 0) |
+                       (material->getReceivesShadows() ? kSceneArchiveMaterialReceivesShadows : 0) |
+                       (material->getCastsShadows() ? kSceneArchiveMaterialCastsShadows : 0);
+        for (int v = 0; v < kNumArchivedVisuals; v++) {
+            const VROMaterialVisual &visual = getArchivedVisual(*material, v);
+            VROVector4f color = visual.getColor();
+            record.visuals[v] = { { color.x, color.y, color.z, color.w }, visual.getIntensity(),
+                                  addTexture(visual.getTexture()) };
+        }
+
+        int index = (int) materialRecords.size();
+        materialIndices[material.get()] = index;
+        materialRecords.push_back(record);
+        return index;
+    };
+
+    // Geometry shared by several nodes is stored once. The mesh key hashes all
+    // mesh data, so an archive never pairs with meshes of an older save.
+    uint64_t meshHash = kVROCacheKeySeed;
+    std::set<VROData *> hashedData;
+    auto hashData = [&meshHash, &hashedData](const std::shared_ptr<VROData> &data) {
+        if (hashedData.insert(data.get()).second) {
+            meshHash = VROPlatformHashCacheKey(data->getData(), data->getDataLength(), meshHash);
+        }
+    };
+
+    std::map<VROGeometry *, int> geometryIndices;
+    auto addGeometry = [&](const std::shared_ptr<VROGeometry> &geometry) {
+        if (!geometry) {
+            return -1;
+        }
+        auto it = geometryIndices.find(geometry.get());
+        if (it != geometryIndices.end()) {
+            return it->second;
+        }
+        if (!isArchivable(*geometry)) {
+            pwarn("Geometry %s has no readable data and will not be archived", geometry->getName().c_str());
+            geometryIndices[geometry.get()] = -1;
+            return -1;
+        }
+
+        VROCachedMesh mesh;
+        mesh.sources = geometry->getGeometrySources();
+        mesh.elements = geometry->getGeometryElements();
+        for (const std::shared_ptr<VROGeometrySource> &source : mesh.sources) {
+            hashData(getSourceData(source));
+        }
+        for (const std::shared_ptr<VROGeometryElement> &element : mesh.elements) {
+            hashData(element->getData());
+        }
+        meshes.push_back(mesh);
+
+        VROSceneArchiveGeometry record;
+        record.name = addString(geometry->getName());
+        record.firstMaterialSlot = (uint32_t) materialSlots.size();
+        record.numMaterials = (uint32_t) geometry->getMaterials().size();
+        record.padding = 0;
+        for (const std::shared_ptr<VROMaterial> &material : geometry->getMaterials()) {
+            materialSlots.push_back(addMaterial(material));
+        }
+
+        int index = (int) geometryRecords.size();
+        geometryIndices[geometry.get()] = index;
+        geometryRecords.push_back(record);
+        return index;
+    };
+
+    // Depth-first, with each node's children visited in order
+    std::vector<std::pair<std::shared_ptr<VRONode>, int>> stack = { { root, -1 } };
+    while (!stack.empty()) {
+        std::shared_ptr<VRONode> node = stack.back().first;
+        int parent = stack.back().second;
+        stack.pop_back();
+
+        VROSceneArchiveNode record;
+        VROVector3f position = node->getPosition();
+        VROQuaternion rotation = node->getRotation();
+        VROVector3f scale = node->getScale();
+        record.parent = parent;
+        record.geometry = addGeometry(node->getGeometry());
+        record.name = addString(node->getName());
+        record.tag = addString(node->getTag());
+        record.position[0] = position.x; record.position[1] = position.y; record.position[2] = position.z;
+        record.rotation[0] = rotation.X; record.rotation[1] = rotation.Y; record.rotation[2] = rotation.Z; record.rotation[3] = rotation.W;
+        record.scale[0] = scale.x; record.scale[1] = scale.y; record.scale[2] = scale.z;
+        record.opacity = node->getOpacity();
+        record.renderingOrder = node->getRenderingOrder();
+        record.lightReceivingBitMask = node->getLightReceivingBitMask();
+        record.shadowCastingBitMask = node->getShadowCastingBitMask();
+        record.flags = (node->isHidden() ? kSceneArchiveNodeHidden : 0) |
+                       (node->getIgnoreEventHandling() ? kSceneArchiveNodeIgnoresEvents : 0);
+
+        int index = (int) nodeRecords.size();
+        nodeRecords.push_back(record);
+
+        const std::vector<std::shared_ptr<VRONode>> &children = node->getSubnodes();
+        for (auto it = children.rbegin(); it != children.rend(); ++it) {
+            stack.push_back({ *it, index });
+        }
+    }
+
+    std::vector<uint8_t> tables;
+    appendRecords(tables, nodeRecords);
+    appendRecords(tables, geometryRecords);
+    appendRecords(tables, materialSlots);
+    appendRecords(tables, materialRecords);
+    appendRecords(tables, textureRecords);
+    tables.insert(tables.end(), strings.begin(), strings.end());
+
+    uint64_t meshKey = VROPlatformHashCacheKey(tables.data(), tables.size(), meshHash);
+    if (meshKey == 0) {
+        meshKey = 1;
+    }
+
+    VROSceneArchiveHeader header = { kSceneArchiveMagic, kSceneArchiveVersion, meshKey,
+                                     (uint32_t) nodeRecords.size(), (uint32_t) geometryRecords.size(),
+                                     (uint32_t) materialSlots.size(), (uint32_t) materialRecords.size(),
+                                     (uint32_t) textureRecords.size(), (uint32_t) strings.size() };
+    std::shared_ptr<std::vector<uint8_t>> file = std::make_shared<std::vector<uint8_t>>(sizeof(header) + tables.size());
+    memcpy(file->data(), &header, sizeof(header));
+    memcpy(file->data() + sizeof(header), tables.data(), tables.size());
+
+    if (!meshes.empty()) {
+        geometryCache->storeMeshes(meshKey, meshes);
+    }
+
+    VROPlatformDispatchAsyncWorker([path, file] {
+        VROPlatformWriteCacheFile(path, file->data(), file->size());
+    }, VROTaskPriority::Low);
+    return true;
+}
+
+#pragma mark - Loading
+
+static bool parseArchive(const uint8_t *bytes, size_t length, std::shared_ptr<VRODriver> driver,
+                         std::shared_ptr<VROGeometryCache> geometryCache, VROSceneArchiveContents *outContents) {
+    VROSceneArchiveHeader header;
+    if (length < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, bytes, sizeof(header));
+    size_t position = sizeof(header);
+    if (header.magic != kSceneArchiveMagic || header.version != kSceneArchiveVersion || header.numNodes == 0) {
+        return false;
+    }
+
+    std::vector<VROSceneArchiveNode> nodeRecords;
+    std::vector<VROSceneArchiveGeometry> geometryRecords;
+    std::vector<int32_t> materialSlots;
+    std::vector<VROSceneArchiveMaterial> materialRecords;
+    std::vector<VROSceneArchiveTexture> textureRecords;
+    if (!readRecords(bytes, length, &position, header.numNodes, &nodeRecords) ||
+        !readRecords(bytes, length, &position, header.numGeometries, &geometryRecords) ||
+        !readRecords(bytes, length, &position, header.numMaterialSlots, &materialSlots) ||
+        !readRecords(bytes, length, &position, header.numMaterials, &materialRecords) ||
+        !readRecords(bytes, length, &position, header.numTextures, &textureRecords)) {
+        return false;
+    }
+
+    // Every string is null terminated, so any offset within the table is valid
+    if (header.stringsLength == 0 || length - position < header.stringsLength ||
+        bytes[position + header.stringsLength - 1] != '\0') {
+        return false;
+    }
+    const char *strings = (const char *) bytes + position;
+    uint32_t stringsLength = header.stringsLength;
+    auto getString = [strings, stringsLength](uint32_t offset, std::string *outString) {
+        if (offset >= stringsLength) {
+            return false;
+        }
+        *outString = std::string(strings + offset);
+        return true;
+    };
+
+    std::vector<VROCachedMesh> meshes;
+    if (header.numGeometries > 0 &&
+        (!geometryCache->loadMeshes(header.meshKey, driver, &meshes) || meshes.size() != header.numGeometries)) {
+        pinfo("Scene archive meshes are missing from the geometry cache");
+        return false;
+    }
+
+    VROSceneArchiveContents contents;
+
+    std::vector<VROSceneArchivePendingTexture> textures(textureRecords.size());
+    for (size_t t = 0; t < textureRecords.size(); t++) {
+        const VROSceneArchiveTexture &record = textureRecords[t];
+        if (!getString(record.resource, &textures[t].resource) ||
+            record.resourceType < (int) VROResourceType::LocalFile || record.resourceType > (int) VROResourceType::BundledResource) {
+            return false;
+        }
+        textures[t].type = (VROResourceType) record.resourceType;
+        textures[t].sRGB = record.sRGB != 0;
+    }
+
+    std::vector<std::shared_ptr<VROMaterial>> materials;
+    materials.reserve(materialRecords.size());
+    for (const VROSceneArchiveMaterial &record : materialRecords) {
+        std::string name;
+        if (!getString(record.name, &name) ||
+            record.lightingModel < 0 || record.lightingModel > (int) VROLightingModel::PhysicallyBased ||
+            record.blendMode < 0 || record.blendMode > (int) VROBlendMode::PremultiplyAlpha ||
+            record.cullMode < 0 || record.cullMode > (int) VROCullMode::None ||
+            record.transparencyMode < 0 || record.transparencyMode > (int) VROTransparencyMode::RGBZero) {
+            return false;
+        }
+
+        std::shared_ptr<VROMaterial> material = std::make_shared<VROMaterial>();
+        material->setThreadRestrictionEnabled(false);
+        contents.unrestrictedObjects.push_back(material);
+
+        material->setName(name);
+        material->setLightingModel((VROLightingModel) record.lightingModel);
+        material->setBlendMode((VROBlendMode) record.blendMode);
+        material->setCullMode((VROCullMode) record.cullMode);
+        material->setTransparencyMode((VROTransparencyMode) record.transparencyMode);
+        material->setShininess(record.shininess);
+        material->setFresnelExponent(record.fresnelExponent);
+        material->setTransparency(record.transparency);
+        material->setBloomThreshold(record.bloomThreshold);
+        material->setRenderingOrder(record.renderingOrder);
+        material->setWritesToDepthBuffer((record.flags & kSceneArchiveMaterialWritesDepth) != 0);
+        material->setReadsFromDepthBuffer((record.flags & kSceneArchiveMaterialReadsDepth) != 0);
+        material->setReceivesShadows((record.flags & kSceneArchiveMaterialReceivesShadows) != 0);
+        material->setCastsShadows((record.flags & kSceneArchiveMaterialCastsShadows) != 0);
+
+        for (int v = 0; v < kNumArchivedVisuals; v++) {
+            const VROSceneArchiveVisual &visualRecord = record.visuals[v];
+            if (visualRecord.texture < -1 || visualRecord.texture >= (int) textures.size()) {
+                return false;
+            }
+
+            VROMaterialVisual &visual = getArchivedVisual(*material, v);
+            visual.setColor({ visualRecord.color[0], visualRecord.color[1], visualRecord.color[2], visualRecord.color[3] });
+            visual.setIntensity(visualRecord.intensity);
+            if (visualRecord.texture >= 0) {
+                textures[visualRecord.texture].bindings.push_back({ material, v });
+            }
+        }
+        materials.push_back(material);
+    }
+
+    std::vector<std::shared_ptr<VROGeometry>> geometries;
+    geometries.reserve(geometryRecords.size());
+    for (size_t g = 0; g < geometryRecords.size(); g++) {
+        const VROSceneArchiveGeometry &record = geometryRecords[g];
+        std::string name;
+        if (!getString(record.name, &name) || record.firstMaterialSlot > materialSlots.size() ||
+            record.numMaterials > materialSlots.size() - record.firstMaterialSlot) {
+            return false;
+        }
+
+        std::vector<std::shared_ptr<VROMaterial>> geometryMaterials;
+        for (uint32_t m = 0; m < record.numMaterials; m++) {
+            int32_t slot = materialSlots[record.firstMaterialSlot + m];
+            if (slot < 0 || slot >= (int) materials.size()) {
+                return false;
+            }
+            geometryMaterials.push_back(materials[slot]);
+        }
+
+        std::shared_ptr<VROGeometry> geometry = std::make_shared<VROGeometry>(meshes[g].sources, meshes[g].elements);
+        geometry->setName(name);
+        geometry->setMaterials(geometryMaterials);
+        geometries.push_back(geometry);
+    }
+
+    // Nodes are built in one pass: each parent precedes its children, so every
+    // node can be attached as soon as it is created
+    std::vector<std::shared_ptr<VRONode>> nodes;
+    nodes.reserve(nodeRecords.size());
+    for (size_t n = 0; n < nodeRecords.size(); n++) {
+        const VROSceneArchiveNode &record = nodeRecords[n];
+        std::string name, tag;
+        if ((n == 0) != (record.parent < 0) || record.parent >= (int) n ||
+            record.geometry < -1 || record.geometry >= (int) geometries.size() ||
+            !getString(record.name, &name) || !getString(record.tag, &tag)) {
+            return false;
+        }
+
+        std::shared_ptr<VRONode> node = std::make_shared<VRONode>();
+        node->setThreadRestrictionEnabled(false);
+        contents.unrestrictedObjects.push_back(node);
+
+        node->setName(name);
+        node->setTag(tag);
+        node->setPosition({ record.position[0], record.position[1], record.position[2] });
+        node->setRotation({ record.rotation[0], record.rotation[1], record.rotation[2], record.rotation[3] });
+        node->setScale({ record.scale[0], record.scale[1], record.scale[2] });
+        node->setOpacity(record.opacity);
+        node->setHidden((record.flags & kSceneArchiveNodeHidden) != 0);
+        node->setRenderingOrder(record.renderingOrder);
+        node->setLightReceivingBitMask(record.lightReceivingBitMask);
+        node->setShadowCastingBitMask(record.shadowCastingBitMask);
+        node->setIgnoreEventHandling((record.flags & kSceneArchiveNodeIgnoresEvents) != 0);
+        if (record.geometry >= 0) {
+            node->setGeometry(geometries[record.geometry]);
+        }
+
+        if (record.parent >= 0) {
+            nodes[record.parent]->addChildNode(node);
+        }
+        nodes.push_back(node);
+    }
+
+    contents.root = nodes.front();
+    for (VROSceneArchivePendingTexture &texture : textures) {
+        if (!texture.bindings.empty()) {
+            contents.textures.push_back(std::move(texture));
+        }
+    }
+    *outContents = std::move(contents);
+    return true;
+}
+
+void VROSceneArchive::loadAsync(std::string path, std::shared_ptr<VRODriver> driver,
+                                std::function<void(std::shared_ptr<VRONode>)> onFinished,
+                                std::shared_ptr<VROGeometryCache> geometryCache) {
+    if (!geometryCache && driver) {
+        geometryCache = driver->getGeometryCache();
+    }
+    if (!geometryCache) {
+        onFinished(nullptr);
+        return;
+    }
+
+    VROPlatformDispatchAsyncBackground([path, driver, geometryCache, onFinished] {
+        std::shared_ptr<VROSceneArchiveContents> contents = std::make_shared<VROSceneArchiveContents>();
+
+        size_t length = 0;
+        const void *data = VROPlatformMapFile(path, &length);
+        bool success = false;
+        if (data) {
+            success = parseArchive((const uint8_t *) data, length, driver, geometryCache, contents.get());
+            VROPlatformUnmapFile(data, length);
+            if (!success) {
+                pinfo("Discarding corrupt or stale scene archive %s", path.c_str());
+                remove(path.c_str());
+            }
+        }
+
+        VROPlatformDispatchAsyncRenderer([contents, success, onFinished] {
+            if (!success) {
+                onFinished(nullptr);
+                return;
+            }
+            for (std::shared_ptr<VROThreadRestricted> &object : contents->unrestrictedObjects) {
+                object->setThreadRestrictionEnabled(true);
+            }
+            contents->unrestrictedObjects.clear();
+            onFinished(contents->root);
+
+            // Textures shared by several materials are loaded once
+            std::shared_ptr<std::map<std::string, std::shared_ptr<VROTexture>>> textureCache =
+                std::make_shared<std::map<std::string, std::shared_ptr<VROTexture>>>();
+            for (VROSceneArchivePendingTexture &texture : contents->textures) {
+                size_t slash = texture.resource.find_last_of('/');
+                std::string base = (slash == std::string::npos) ? "." : texture.resource.substr(0, slash);
+                std::string name = (slash == std::string::npos) ? texture.resource : texture.resource.substr(slash + 1);
+
+                std::vector<std::pair<std::shared_ptr<VROMaterial>, int>> bindings = texture.bindings;
+                VROModelIOUtil::loadTextureAsync(name, base, texture.type, texture.sRGB, nullptr, textureCache,
+                                                 [bindings](std::shared_ptr<VROTexture> loaded) {
+                    if (!loaded) {
+                        return;
+                    }
+                    for (const std::pair<std::shared_ptr<VROMaterial>, int> &binding : bindings) {
+                        getArchivedVisual(*binding.first, binding.second).setTexture(loaded);
+                    }
+                });
+            }
+        });
+    });
+}
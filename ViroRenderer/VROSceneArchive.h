@@ -0,0 +1,91 @@
+//
+//  VROSceneArchive.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef VROSceneArchive_h
+#define VROSceneArchive_h
+
+#include <string>
+#include <memory>
+#include <functional>
+
+class VRONode;
+class VRODriver;
+class VROGeometryCache;
+
+/*
+ Saves a fully built scene graph to a binary archive, and restores it in one
+ pass, so that complex scenes can be brought back on launch without replaying
+ their construction (node creation, material setup, model loading).
+
+ The archive stores the node hierarchy in depth-first order as flat records
+ (name, tag, transform, opacity, visibility, rendering order, and light and
+ shadow masks), the geometries and materials the nodes use, and string tables.
+ It is memory mapped when loaded and parsed in place. Mesh data is not stored
+ in the archive itself: it is written to the driver's VROGeometryCache, under
+ a key recorded in the archive, so vertex and index buffers are themselves
+ memory mapped and uploaded without processing. Textures are stored as
+ references to the resources they were loaded from (see
+ VROTexture::getSourceResource), which for remote assets are served by the
+ persistent VROAssetCache.
+
+ Only plain nodes, geometry, and materials are archived. Lights, animations,
+ skinners, physics bodies, portals, and other node subclasses are not; nodes of
+ subclasses are restored as plain nodes, and geometry whose data can't be
+ read back (e.g. video) is dropped. Textures that were not loaded from a
+ resource are dropped as well.
+ */
+class VROSceneArchive {
+public:
+
+    /*
+     Write the graph rooted at the given node to the archive at the given path.
+     The data is copied before returning and written on a background thread.
+     Returns false if the driver has no geometry cache. Must be invoked on the
+     rendering thread.
+
+     The mesh data is written to the given geometry cache if one is provided,
+     or to the driver's otherwise; an archive must be loaded with the cache
+     it was saved with.
+     */
+    static bool save(std::shared_ptr<VRONode> root, std::string path, std::shared_ptr<VRODriver> driver,
+                     std::shared_ptr<VROGeometryCache> geometryCache = nullptr);
+
+    /*
+     Restore the graph stored in the archive at the given path. The archive is
+     parsed and the nodes built on a background thread; the callback is then
+     invoked on the rendering thread with the root of the restored graph, or
+     with nullptr if the archive is missing, corrupt, or out of date with the
+     geometry cache. Textures are loaded afterward, and appear on their
+     materials as they become available. Must be invoked on the rendering
+     thread.
+     */
+    static void loadAsync(std::string path, std::shared_ptr<VRODriver> driver,
+                          std::function<void(std::shared_ptr<VRONode>)> onFinished,
+                          std::shared_ptr<VROGeometryCache> geometryCache = nullptr);
+
+};
+
+#endif /* VROSceneArchive_h */
@@ -0,0 +1,317 @@
+//
+//  VROSceneBenchmark.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROSceneBenchmark.h"
+#include "VRORendererTest.h"
+#include "VRORenderer.h"
+#include "VRODriver.h"
+#include "VROProfiler.h"
+#include "VROQuaternion.h"
+#include "VROViewport.h"
+#include "VROFieldOfView.h"
+#include "VROEye.h"
+#include "VROTime.h"
+#include "VRODefines.h"
+#include "VROLog.h"
+#include <algorithm>
+#include <sstream>
+#include <thread>
+#include <cstdio>
+
+#if VRO_PLATFORM_IOS || VRO_PLATFORM_MACOS
+#include <mach/mach.h>
+#elif VRO_PLATFORM_ANDROID
+#include <unistd.h>
+#endif
+
+static const double kBenchmarkFrameInterval = 1.0 / 60.0;
+static const int kDefaultWarmupFrames = 120;
+static const int kDefaultMeasuredFrames = 600;
+
+// Real time given to background loads between warm-up frames
+static const int kWarmupSleepMs = 8;
+
+static uint64_t getResidentBytes() {
+#if VRO_PLATFORM_IOS || VRO_PLATFORM_MACOS
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t) &info, &count) != KERN_SUCCESS) {
+        return 0;
+    }
+    return info.resident_size;
+#elif VRO_PLATFORM_ANDROID
+    FILE *file = fopen("/proc/self/statm", "r");
+    if (!file) {
+        return 0;
+    }
+    long pages = 0;
+    long residentPages = 0;
+    int read = fscanf(file, "%ld %ld", &pages, &residentPages);
+    fclose(file);
+    return read == 2 ? (uint64_t) residentPages * sysconf(_SC_PAGESIZE) : 0;
+#else
+    return 0;
+#endif
+}
+
+template <typename T>
+static double mean(const std::vector<T> &values) {
+    if (values.empty()) {
+        return 0;
+    }
+    double sum = 0;
+    for (T value : values) {
+        sum += value;
+    }
+    return sum / values.size();
+}
+
+static double percentile(std::vector<double> values, double p) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, (size_t) (p * values.size()))];
+}
+
+std::vector<VROSceneBenchmarkScene> VROSceneBenchmark::getStandardScenes() {
+    return {
+        { "many_instances",       VRORendererTestType::Instancing, { { -8, 0, 5 }, { 8, 0, 5 } }, { 0, 0, -20 } },
+        { "lights_skinned_crowd", VRORendererTestType::Perf,       { { -6, 1, 4 }, { 10, 1, 4 } }, { 2, -3, -5 } },
+        { "particle_storm",       VRORendererTestType::Particle,   { { -0.5, 0, 1 }, { 0.5, 0, 1 } }, { 0, -0.5, -1 } },
+        { "text_wall",            VRORendererTestType::Text,       { { -1, 0, 0 }, { 1, 0, 0 } }, { 0, 0, -6 } },
+        { "portal_nesting",       VRORendererTestType::Portal,     { { 0, 0, 0 }, { 0, 0, -1.5 } }, { 0, 0, -5 } },
+    };
+}
+
+VROSceneBenchmark::VROSceneBenchmark(std::shared_ptr<VRORenderer> renderer, std::shared_ptr<VRODriver> driver,
+                                     int width, int height) :
+    _renderer(renderer),
+    _driver(driver),
+    _width(width),
+    _height(height),
+    _warmupFrames(kDefaultWarmupFrames),
+    _measuredFrames(kDefaultMeasuredFrames),
+    _sceneIndex(-1),
+    _sceneFrame(0),
+    _frame(0),
+    _wasProfiling(false) {
+    
+}
+
+VROSceneBenchmark::~VROSceneBenchmark() {
+    
+}
+
+bool VROSceneBenchmark::renderFrame() {
+    if (_sceneIndex < 0) {
+        _wasProfiling = VROProfiler::isEnabled();
+        VROProfiler::setEnabled(true);
+        _driver->setGPUFrameTimerEnabled(true);
+        VROTimeSetFixedClock(true, 0);
+        
+        _sceneIndex = 0;
+        if (!isFinished()) {
+            loadScene(_scenes[_sceneIndex]);
+        }
+    }
+    if (isFinished()) {
+        return false;
+    }
+    
+    const VROSceneBenchmarkScene &scene = _scenes[_sceneIndex];
+    bool measuring = _sceneFrame >= _warmupFrames;
+    if (measuring) {
+        VROTimeAdvanceFixedClock(kBenchmarkFrameInterval);
+        updateCamera(scene, (float) (_sceneFrame - _warmupFrames) / (float) std::max(_measuredFrames - 1, 1));
+    }
+    
+    VROViewport viewport(0, 0, _width, _height);
+    VROFieldOfView fov = _renderer->computeUserFieldOfView(viewport.getWidth(), viewport.getHeight());
+    VROMatrix4f projection = fov.toPerspectiveProjection(kZNear, _renderer->getFarClippingPlane());
+    
+    uint64_t startNs = VRONanoTime();
+    _renderer->prepareFrame(_frame, viewport, fov, VROMatrix4f::identity(), projection, _driver);
+    uint64_t preparedNs = VRONanoTime();
+    _renderer->renderEye(VROEyeType::Monocular, _renderer->getLookAtMatrix(), projection, viewport, _driver);
+    _renderer->renderHUD(VROEyeType::Monocular, VROMatrix4f::identity(), projection, _driver);
+    uint64_t renderedNs = VRONanoTime();
+    _renderer->endFrame(_driver);
+    uint64_t endNs = VRONanoTime();
+    
+    ++_frame;
+    ++_sceneFrame;
+    
+    if (measuring) {
+        _prepareMs.push_back((preparedNs - startNs) / 1000000.0);
+        _renderMs.push_back((renderedNs - preparedNs) / 1000000.0);
+        _endMs.push_back((endNs - renderedNs) / 1000000.0);
+        _frameMs.push_back((endNs - startNs) / 1000000.0);
+        
+        double gpuMs = _driver->getGPUFrameTime();
+        if (gpuMs >= 0) {
+            _gpuMs.push_back(gpuMs);
+        }
+        _drawCalls.push_back(VROProfiler::getCount(VROProfilerCounter::DrawCalls));
+        _instancedDrawCalls.push_back(VROProfiler::getCount(VROProfilerCounter::InstancedDrawCalls));
+        _shaderBinds.push_back(VROProfiler::getCount(VROProfilerCounter::ShaderBinds));
+        _textureBinds.push_back(VROProfiler::getCount(VROProfilerCounter::TextureBinds));
+        _stateChanges.push_back(VROProfiler::getCount(VROProfilerCounter::StateChanges));
+    }
+#if !VRO_PLATFORM_WASM
+    else {
+        std::this_thread::sleep_for(std::chrono::milliseconds(kWarmupSleepMs));
+    }
+#endif
+    
+    if (_sceneFrame >= _warmupFrames + _measuredFrames) {
+        finishScene(scene);
+        
+        ++_sceneIndex;
+        if (!isFinished()) {
+            loadScene(_scenes[_sceneIndex]);
+        }
+        else {
+            VROTimeSetFixedClock(false);
+            _driver->setGPUFrameTimerEnabled(false);
+            VROProfiler::setEnabled(_wasProfiling);
+        }
+    }
+    return true;
+}
+
+void VROSceneBenchmark::loadScene(const VROSceneBenchmarkScene &scene) {
+    pinfo("Benchmarking scene [%s]", scene.name.c_str());
+    
+    _harness = std::make_shared<VRORendererTestHarness>(_renderer, _renderer->getFrameSynchronizer(), _driver);
+    _test = _harness->loadTest(scene.test);
+    _renderer->setSceneController(_test->getSceneController(), _driver);
+    
+    // The benchmark camera replaces the scene's own point of view
+    std::shared_ptr<VRONodeCamera> camera = std::make_shared<VRONodeCamera>();
+    _camera = std::make_shared<VRONode>();
+    _camera->setCamera(camera);
+    _test->getSceneController()->getScene()->getRootNode()->addChildNode(_camera);
+    _renderer->setPointOfView(_camera);
+    updateCamera(scene, 0);
+    
+    _sceneFrame = 0;
+    _prepareMs.clear();
+    _renderMs.clear();
+    _endMs.clear();
+    _frameMs.clear();
+    _gpuMs.clear();
+    _drawCalls.clear();
+    _instancedDrawCalls.clear();
+    _shaderBinds.clear();
+    _textureBinds.clear();
+    _stateChanges.clear();
+}
+
+void VROSceneBenchmark::finishScene(const VROSceneBenchmarkScene &scene) {
+    VROSceneBenchmarkResult result;
+    result.name = scene.name;
+    result.frames = (int) _frameMs.size();
+    result.prepareMs = mean(_prepareMs);
+    result.renderMs = mean(_renderMs);
+    result.endMs = mean(_endMs);
+    result.frameMedianMs = percentile(_frameMs, 0.5);
+    result.frame95Ms = percentile(_frameMs, 0.95);
+    result.gpuMs = _gpuMs.empty() ? -1 : mean(_gpuMs);
+    result.drawCalls = mean(_drawCalls);
+    result.instancedDrawCalls = mean(_instancedDrawCalls);
+    result.shaderBinds = mean(_shaderBinds);
+    result.textureBinds = mean(_textureBinds);
+    result.stateChanges = mean(_stateChanges);
+    result.residentBytes = getResidentBytes();
+    _results.push_back(result);
+    
+    pinfo("Scene [%s]: CPU %.2f ms (p95 %.2f), GPU %.2f ms, %.0f draw calls",
+          result.name.c_str(), result.frameMedianMs, result.frame95Ms, result.gpuMs, result.drawCalls);
+    
+    _camera.reset();
+    _test.reset();
+    _harness.reset();
+}
+
+void VROSceneBenchmark::updateCamera(const VROSceneBenchmarkScene &scene, float t) {
+    if (scene.cameraPath.empty()) {
+        return;
+    }
+    
+    VROVector3f position = scene.cameraPath.front();
+    if (scene.cameraPath.size() > 1) {
+        float segment = std::min(std::max(t, 0.0f), 1.0f) * (scene.cameraPath.size() - 1);
+        int index = std::min((int) segment, (int) scene.cameraPath.size() - 2);
+        position = scene.cameraPath[index].interpolate(scene.cameraPath[index + 1], segment - index);
+    }
+    
+    _camera->setPosition(position);
+    VROVector3f forward = (scene.cameraTarget - position).normalize();
+    _camera->setRotation(VROQuaternion::rotationFromTo({ 0, 0, -1 }, forward));
+}
+
+std::string VROSceneBenchmark::toJSON() const {
+    std::stringstream ss;
+    ss << "{\n";
+    ss << "  \"width\": " << _width << ",\n";
+    ss << "  \"height\": " << _height << ",\n";
+    ss << "  \"warmup_frames\": " << _warmupFrames << ",\n";
+    ss << "  \"time\": " << VROTimeGetCalendarTime() << ",\n";
+    ss << "  \"scenes\": [";
+    for (size_t i = 0; i < _results.size(); i++) {
+        const VROSceneBenchmarkResult &result = _results[i];
+        ss << (i == 0 ? "\n" : ",\n");
+        ss << "    { \"name\": \"" << result.name << "\""
+           << ", \"frames\": " << result.frames
+           << ", \"prepare_ms\": " << result.prepareMs
+           << ", \"render_ms\": " << result.renderMs
+           << ", \"end_ms\": " << result.endMs
+           << ", \"frame_median_ms\": " << result.frameMedianMs
+           << ", \"frame_p95_ms\": " << result.frame95Ms
+           << ", \"gpu_ms\": " << result.gpuMs
+           << ", \"draw_calls\": " << result.drawCalls
+           << ", \"instanced_draw_calls\": " << result.instancedDrawCalls
+           << ", \"shader_binds\": " << result.shaderBinds
+           << ", \"texture_binds\": " << result.textureBinds
+           << ", \"state_changes\": " << result.stateChanges
+           << ", \"resident_bytes\": " << result.residentBytes << " }";
+    }
+    ss << "\n  ]\n}\n";
+    return ss.str();
+}
+
+bool VROSceneBenchmark::writeJSON(std::string path) const {
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file) {
+        pwarn("Failed to open scene benchmark results file %s", path.c_str());
+        return false;
+    }
+    
+    std::string json = toJSON();
+    bool success = fwrite(json.data(), 1, json.size(), file) == json.size();
+    fclose(file);
+    return success;
+}
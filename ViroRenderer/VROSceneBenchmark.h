@@ -0,0 +1,167 @@
+//
+//  VROSceneBenchmark.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROSceneBenchmark_h
+#define VROSceneBenchmark_h
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "VRORendererTestHarness.h"
+#include "VROVector3f.h"
+
+class VRONode;
+class VRODriver;
+class VRORenderer;
+class VRORendererTest;
+
+/*
+ A scene to benchmark: one of the renderer test scenes, viewed from a camera that
+ moves through the given positions (evenly over the measured frames) while looking
+ at the target.
+ */
+struct VROSceneBenchmarkScene {
+    std::string name;
+    VRORendererTestType test;
+    std::vector<VROVector3f> cameraPath;
+    VROVector3f cameraTarget;
+};
+
+/*
+ Measurements of one benchmarked scene. Times are in milliseconds and counts are
+ per frame, averaged over the measured frames unless noted.
+ */
+struct VROSceneBenchmarkResult {
+    std::string name;
+    int frames;
+    
+    // CPU time of prepareFrame, of renderEye and renderHUD, and of endFrame
+    double prepareMs;
+    double renderMs;
+    double endMs;
+    
+    // CPU time of the whole frame: median and 95th percentile
+    double frameMedianMs;
+    double frame95Ms;
+    
+    // GPU frame time, averaged over the frames for which the driver had
+    // a timing; negative if the driver has no GPU timer
+    double gpuMs;
+    
+    double drawCalls;
+    double instancedDrawCalls;
+    double shaderBinds;
+    double textureBinds;
+    double stateChanges;
+    
+    // Resident memory of the process at the end of the scene, in bytes
+    uint64_t residentBytes;
+};
+
+/*
+ Renders benchmark scenes for a fixed number of frames each, against a
+ deterministic clock, and reports per-phase CPU time, GPU time, draw calls, and
+ memory. The harness renders into whatever surface is current on the calling
+ thread, typically an offscreen (pbuffer or offscreen canvas) surface created by
+ the platform runner. The clock is frozen at zero while each scene warms up (so
+ that assets finish loading without advancing animations), and then advances
+ exactly one frame interval per measured frame.
+ 
+ The platform drives the harness by calling renderFrame() once per frame on the
+ rendering thread until it returns false.
+ */
+class VROSceneBenchmark {
+public:
+    
+    /*
+     The standard benchmark scenes: many instances, many lights with a skinned
+     crowd, particles, text, and nested portals.
+     */
+    static std::vector<VROSceneBenchmarkScene> getStandardScenes();
+    
+    VROSceneBenchmark(std::shared_ptr<VRORenderer> renderer, std::shared_ptr<VRODriver> driver,
+                      int width, int height);
+    virtual ~VROSceneBenchmark();
+    
+    void addScene(VROSceneBenchmarkScene scene) {
+        _scenes.push_back(scene);
+    }
+    void setFrameCounts(int warmupFrames, int measuredFrames) {
+        _warmupFrames = warmupFrames;
+        _measuredFrames = measuredFrames;
+    }
+    
+    /*
+     Render the next frame of the benchmark. Returns false once every scene has
+     been measured, at which point the results are complete.
+     */
+    bool renderFrame();
+    
+    bool isFinished() const {
+        return _sceneIndex >= (int) _scenes.size();
+    }
+    const std::vector<VROSceneBenchmarkResult> &getResults() const {
+        return _results;
+    }
+    
+    std::string toJSON() const;
+    bool writeJSON(std::string path) const;
+    
+private:
+    
+    std::shared_ptr<VRORenderer> _renderer;
+    std::shared_ptr<VRODriver> _driver;
+    int _width, _height;
+    
+    std::vector<VROSceneBenchmarkScene> _scenes;
+    std::vector<VROSceneBenchmarkResult> _results;
+    int _warmupFrames;
+    int _measuredFrames;
+    
+    /*
+     State of the scene being benchmarked. _sceneFrame counts the frames rendered
+     in the current scene, including warm-up.
+     */
+    int _sceneIndex;
+    int _sceneFrame;
+    int _frame;
+    bool _wasProfiling;
+    std::shared_ptr<VRORendererTestHarness> _harness;
+    std::shared_ptr<VRORendererTest> _test;
+    std::shared_ptr<VRONode> _camera;
+    
+    /*
+     Per-frame samples of the current scene.
+     */
+    std::vector<double> _prepareMs, _renderMs, _endMs, _frameMs, _gpuMs;
+    std::vector<int> _drawCalls, _instancedDrawCalls, _shaderBinds, _textureBinds, _stateChanges;
+    
+    void loadScene(const VROSceneBenchmarkScene &scene);
+    void finishScene(const VROSceneBenchmarkScene &scene);
+    void updateCamera(const VROSceneBenchmarkScene &scene, float t);
+    
+};
+
+#endif /* VROSceneBenchmark_h */
@@ -0,0 +1,125 @@
+//
+//  VROSceneSnapshot.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROSceneSnapshot.h"
+#include "VRONode.h"
+#include "VROPlatformUtil.h"
+#include "VROProfiler.h"
+
+static const int kSnapshotFresh = 0x4;
+static const int kSnapshotIndexMask = 0x3;
+
+VROSceneSnapshot::VROSceneSnapshot() :
+    _writeIndex(0),
+    _readIndex(1),
+    _publishedIndex(2),
+    _applyPending(false) {
+}
+
+VROSceneSnapshot::~VROSceneSnapshot() {
+
+}
+
+void VROSceneSnapshot::publish(std::shared_ptr<VRONode> root) {
+    VRO_PROFILE_SCOPE("publishSnapshot");
+
+    VROSnapshotBuffer &buffer = _buffers[_writeIndex];
+    buffer.count = 0;
+    capture(root, buffer);
+
+    // Swap the buffer we wrote with the last published buffer, which the
+    // application thread has either read or skipped
+    _writeIndex = _publishedIndex.exchange(_writeIndex | kSnapshotFresh) & kSnapshotIndexMask;
+
+    if (!_applyPending.exchange(true)) {
+        std::weak_ptr<VROSceneSnapshot> snapshot_w = shared_from_this();
+        VROPlatformDispatchAsyncApplication([snapshot_w] {
+            std::shared_ptr<VROSceneSnapshot> snapshot = snapshot_w.lock();
+            if (snapshot) {
+                snapshot->apply();
+            }
+        });
+    }
+}
+
+void VROSceneSnapshot::capture(const std::shared_ptr<VRONode> &node, VROSnapshotBuffer &buffer) {
+    // Entries are assigned in place so that steady state frames do not allocate
+    size_t index = buffer.count++;
+    if (index == buffer.properties.size()) {
+        buffer.nodes.emplace_back();
+        buffer.properties.emplace_back();
+    }
+    buffer.nodes[index] = node;
+
+    VRONodeSnapshot &snapshot = buffer.properties[index];
+    snapshot.localTransform = node->_localTransform;
+    snapshot.worldTransform = node->_worldTransform;
+    snapshot.worldRotation = node->_worldRotation;
+    snapshot.worldPosition = node->_worldPosition;
+    snapshot.position = node->_position;
+    snapshot.scale = node->_scale;
+    snapshot.rotation = node->_rotation;
+    snapshot.worldBoundingBox = node->_worldBoundingBox;
+    snapshot.worldUmbrellaBoundingBox = node->_worldUmbrellaBoundingBox;
+    snapshot.localBoundingBox = node->_localBoundingBox;
+    snapshot.localUmbrellaBoundingBox = node->_localUmbrellaBoundingBox;
+    snapshot.geometryBoundingBox = node->_geometryBoundingBox;
+
+    for (const std::shared_ptr<VRONode> &childNode : node->_subnodes) {
+        capture(childNode, buffer);
+    }
+}
+
+void VROSceneSnapshot::apply() {
+    // Clear the pending flag first, so a snapshot published while we apply
+    // this one schedules another task
+    _applyPending = false;
+    if ((_publishedIndex.load() & kSnapshotFresh) == 0) {
+        return;
+    }
+    _readIndex = _publishedIndex.exchange(_readIndex) & kSnapshotIndexMask;
+
+    VROSnapshotBuffer &buffer = _buffers[_readIndex];
+    for (size_t i = 0; i < buffer.count; i++) {
+        std::shared_ptr<VRONode> node = buffer.nodes[i].lock();
+        if (!node) {
+            continue;
+        }
+
+        const VRONodeSnapshot &snapshot = buffer.properties[i];
+        node->_lastLocalTransform = snapshot.localTransform;
+        node->_lastWorldTransform = snapshot.worldTransform;
+        node->_lastWorldPosition = snapshot.worldPosition;
+        node->_lastWorldRotation = snapshot.worldRotation;
+        node->_lastPosition = snapshot.position;
+        node->_lastRotation = snapshot.rotation;
+        node->_lastScale = snapshot.scale;
+        node->_lastWorldBoundingBox = snapshot.worldBoundingBox;
+        node->_lastWorldUmbrellaBoundingBox = snapshot.worldUmbrellaBoundingBox;
+        node->_lastLocalBoundingBox = snapshot.localBoundingBox;
+        node->_lastLocalUmbrellaBoundingBox = snapshot.localUmbrellaBoundingBox;
+        node->_lastGeometryBoundingBox = snapshot.geometryBoundingBox;
+    }
+}
@@ -0,0 +1,114 @@
+//
+//  VROSceneSnapshot.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROSceneSnapshot_h
+#define VROSceneSnapshot_h
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include "VROMatrix4f.h"
+#include "VROVector3f.h"
+#include "VROQuaternion.h"
+#include "VROBoundingBox.h"
+
+class VRONode;
+
+/*
+ The render properties of a single node, as computed by the rendering thread.
+ */
+struct VRONodeSnapshot {
+    VROMatrix4f localTransform;
+    VROMatrix4f worldTransform;
+    VROMatrix4f worldRotation;
+    VROVector3f worldPosition;
+    VROVector3f position;
+    VROVector3f scale;
+    VROQuaternion rotation;
+    VROBoundingBox worldBoundingBox;
+    VROBoundingBox worldUmbrellaBoundingBox;
+    VROBoundingBox localBoundingBox;
+    VROBoundingBox localUmbrellaBoundingBox;
+    VROBoundingBox geometryBoundingBox;
+};
+
+/*
+ Transfers the render properties of every node in a scene graph from the rendering
+ thread to the application thread, where they back the VRONode getLast* accessors.
+
+ Each frame the rendering thread captures the properties of all nodes into contiguous
+ arrays, in depth-first order, and publishes them with an atomic swap into a triple
+ buffer. At most one task is dispatched to the application thread per frame; it takes
+ the most recently published buffer and copies it into the nodes. Neither thread ever
+ waits on the other, and frames the application thread falls behind on are skipped.
+ */
+class VROSceneSnapshot : public std::enable_shared_from_this<VROSceneSnapshot> {
+public:
+
+    VROSceneSnapshot();
+    virtual ~VROSceneSnapshot();
+
+    /*
+     Capture the render properties of the graph rooted at the given node and
+     publish them to the application thread. Must be invoked on the rendering
+     thread.
+     */
+    void publish(std::shared_ptr<VRONode> root);
+
+private:
+
+    struct VROSnapshotBuffer {
+        std::vector<std::weak_ptr<VRONode>> nodes;
+        std::vector<VRONodeSnapshot> properties;
+        size_t count = 0;
+    };
+
+    /*
+     The buffer being written by the rendering thread, and the buffer being read by
+     the application thread, are each owned by their thread. The remaining buffer is
+     the last one published; its index is swapped in and out atomically, with
+     kSnapshotFresh set if it has not yet been read.
+     */
+    VROSnapshotBuffer _buffers[3];
+    int _writeIndex;
+    int _readIndex;
+    std::atomic<int> _publishedIndex;
+
+    /*
+     True while a task to apply the snapshot is queued on the application thread.
+     */
+    std::atomic<bool> _applyPending;
+
+    void capture(const std::shared_ptr<VRONode> &node, VROSnapshotBuffer &buffer);
+
+    /*
+     Copy the most recently published snapshot into the nodes. Invoked on the
+     application thread.
+     */
+    void apply();
+
+};
+
+#endif /* VROSceneSnapshot_h */
@@ -0,0 +1,158 @@
+//
+//  VROSecondaryView.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include "VROSecondaryView.h"
+#include "VRONode.h"
+#include "VRONodeCamera.h"
+#include "VROScene.h"
+#include "VROPortal.h"
+#include "VRODriver.h"
+#include "VRORenderer.h"
+#include "VRORenderTarget.h"
+#include "VRORenderContext.h"
+#include "VROEye.h"
+#include "VROLightClusterGrid.h"
+#include "VROMath.h"
+#include "VROLog.h"
+#include "VROProfiler.h"
+#include "VROOpenGL.h" // For pglpush and pop
+
+/*
+ The vertical field of view, in degrees, used when the node camera does not
+ specify one.
+ */
+static const float kDefaultSecondaryViewFOV = 60;
+
+VROSecondaryView::VROSecondaryView(std::shared_ptr<VRONode> cameraNode, int width, int height) :
+    _cameraNode(cameraNode),
+    _width(width),
+    _height(height),
+    _updateInterval(1),
+    _viewBitMask(1),
+    _backgroundEnabled(true),
+    _transparencyEnabled(true),
+    _clearColor(0, 0, 0, 1),
+    _zNear(kZNear),
+    _zFar(kZFar),
+    _lastRenderedFrame(-1) {
+    
+}
+
+VROSecondaryView::~VROSecondaryView() {
+    
+}
+
+std::shared_ptr<VROTexture> VROSecondaryView::getTexture() const {
+    return _target ? _target->getTexture(0) : nullptr;
+}
+
+bool VROSecondaryView::updateCamera(float zNear, float zFar) {
+    if (!_cameraNode || !_cameraNode->getCamera() || _width <= 0 || _height <= 0) {
+        return false;
+    }
+    const std::shared_ptr<VRONodeCamera> &nodeCamera = _cameraNode->getCamera();
+    
+    // The node camera's FOV is along the major axis, as for the main view
+    float fov = nodeCamera->getFieldOfView() > 0 ? nodeCamera->getFieldOfView() : kDefaultSecondaryViewFOV;
+    VROFieldOfView fieldOfView = VRORenderer::computeFOVFromMajorAxis(fov, _width, _height);
+    _projection = fieldOfView.toPerspectiveProjection(zNear, zFar);
+    _zNear = zNear;
+    _zFar = zFar;
+    
+    _camera = VROCamera();
+    _camera.setViewport({ 0, 0, _width, _height });
+    _camera.setFOV(fieldOfView);
+    _camera.setProjection(_projection);
+    _camera.setPosition(_cameraNode->getWorldPosition() + nodeCamera->getPosition());
+    _camera.setBaseRotation(_cameraNode->getWorldRotation().multiply(nodeCamera->getBaseRotation().getMatrix()));
+    _camera.computeLookAtMatrix();
+    _camera.computeFrustum();
+    return true;
+}
+
+void VROSecondaryView::render(std::shared_ptr<VROScene> scene, const VRORenderContext &context,
+                              std::shared_ptr<VRODriver> &driver) {
+    VRO_PROFILE_GPU_SCOPE("secondaryView", driver);
+    pglpush("Secondary View [%d x %d]", _width, _height);
+    
+    if (!_target) {
+        _target = driver->newRenderTarget(VRORenderTargetType::ColorTexture, 1, 1, false, true);
+    }
+    if (_target->getWidth() != _width || _target->getHeight() != _height) {
+        _target->setViewport({ 0, 0, _width, _height });
+    }
+    if (!_target->hydrate()) {
+        pwarn("Failed to create secondary view target, will not render view");
+        _target.reset();
+        pglpop();
+        return;
+    }
+    
+    // The view shares the main view's lighting environment, but none of the
+    // features of its render pipeline
+    VRORenderContext viewContext = context;
+    viewContext.setCamera(_camera);
+    viewContext.setPreviousCamera(_camera);
+    viewContext.setViewMatrix(_camera.getLookAtMatrix());
+    viewContext.setProjectionMatrix(_projection);
+    viewContext.setEnclosureViewMatrix(VROMathComputeLookAtMatrix({ 0, 0, 0 }, _camera.getForward(), _camera.getUp()));
+    viewContext.setOrthographicMatrix(_camera.getViewport().getOrthographicProjection(0, kZFar));
+    viewContext.setZNear(_zNear);
+    viewContext.setZFar(_zFar);
+    viewContext.setEyeType(VROEyeType::Monocular);
+    viewContext.setMultiviewEnabled(false);
+    viewContext.setHDREnabled(false);
+    viewContext.setOrderIndependentTransparencyEnabled(false);
+    viewContext.setAccumulatingTransparency(false);
+    viewContext.setTemporalAAEnabled(false);
+    viewContext.setShadingRateLevel(VROShadingRateLevel::None);
+    viewContext.setShadowMap(nullptr);
+    viewContext.setOcclusionCuller(nullptr);
+    viewContext.setRenderStatistics(nullptr);
+    viewContext.setSecondaryViewFrustums({});
+    
+    // Nodes exclude clusterable lights from their computed lights, so the clusters
+    // are rebuilt in this view's space
+    if (context.isClusteredLightingEnabled()) {
+        if (!_lightClusters) {
+            _lightClusters = std::make_shared<VROLightClusterGrid>();
+        }
+        _lightClusters->update(scene->getLights(), viewContext.getViewMatrix(), _projection, _zNear, _zFar);
+        viewContext.setLightClusters(_lightClusters);
+    }
+    else {
+        viewContext.setLightClusters(nullptr);
+    }
+    
+    _target->setClearColor(_clearColor);
+    driver->bindRenderTarget(_target, VRORenderTargetActions::clearAll(), VRORenderTargetUnbindOp::Invalidate);
+    scene->getRootNode()->renderView(viewContext, driver, _viewBitMask, _backgroundEnabled, _transparencyEnabled,
+                                     _keys, _sorter);
+    driver->unbindShader();
+    
+    _lastRenderedFrame = context.getFrame();
+    pglpop();
+}
@@ -0,0 +1,194 @@
+//
+//  VROSecondaryView.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef VROSecondaryView_h
+#define VROSecondaryView_h
+
+#include <vector>
+#include <memory>
+#include "VROCamera.h"
+#include "VROVector4f.h"
+#include "VROSortKey.h"
+
+class VRONode;
+class VROScene;
+class VRODriver;
+class VROTexture;
+class VRORenderTarget;
+class VRORenderContext;
+class VROLightClusterGrid;
+
+/*
+ A secondary view renders the scene from the VRONodeCamera of a node into its own
+ texture, for minimaps, mirrors, picture-in-picture and the like. Views are added
+ to the VRORenderer, and are rendered at the start of each frame they are due,
+ after the frame's transform, animation and physics update, which they share with
+ the main view. Each view only redoes the culling and sorting of the scene for its
+ own camera.
+ 
+ Views render the active scene's root portal (nested portals are not rendered)
+ with a reduced feature set: to a low dynamic range target, with no shadows,
+ bloom, or post-processing.
+ */
+class VROSecondaryView {
+    
+public:
+    
+    VROSecondaryView(std::shared_ptr<VRONode> cameraNode, int width, int height);
+    virtual ~VROSecondaryView();
+    
+    /*
+     The node from whose VRONodeCamera this view renders. Orbit cameras are rendered
+     from their position, looking along their base rotation.
+     */
+    void setCameraNode(std::shared_ptr<VRONode> cameraNode) {
+        _cameraNode = cameraNode;
+    }
+    std::shared_ptr<VRONode> getCameraNode() const {
+        return _cameraNode;
+    }
+    
+    /*
+     The resolution of the texture this view renders into.
+     */
+    void setSize(int width, int height) {
+        _width = width;
+        _height = height;
+    }
+    int getWidth() const {
+        return _width;
+    }
+    int getHeight() const {
+        return _height;
+    }
+    
+    /*
+     Render this view every given number of frames. Between renders, the texture
+     retains the last rendered image. Defaults to 1 (every frame).
+     */
+    void setUpdateInterval(int frames) {
+        _updateInterval = std::max(1, frames);
+    }
+    int getUpdateInterval() const {
+        return _updateInterval;
+    }
+    
+    /*
+     Only nodes whose view bit mask (VRONode::setViewBitMask) has a bit in common
+     with this mask are rendered into this view. Defaults to 1.
+     */
+    void setViewBitMask(int bitMask) {
+        _viewBitMask = bitMask;
+    }
+    int getViewBitMask() const {
+        return _viewBitMask;
+    }
+    
+    /*
+     Features of the view. The background (skybox or AR camera feed) and transparent
+     geometry can each be omitted, for views such as minimaps that need neither.
+     Both are rendered by default.
+     */
+    void setBackgroundEnabled(bool enabled) {
+        _backgroundEnabled = enabled;
+    }
+    void setTransparencyEnabled(bool enabled) {
+        _transparencyEnabled = enabled;
+    }
+    void setClearColor(VROVector4f color) {
+        _clearColor = color;
+    }
+    
+    /*
+     The texture this view renders into. Null until the view is first rendered.
+     */
+    std::shared_ptr<VROTexture> getTexture() const;
+    
+    /*
+     Returns true if this view is due to render in the given frame.
+     */
+    bool isDue(int frame) const {
+        return _lastRenderedFrame < 0 || frame - _lastRenderedFrame >= _updateInterval;
+    }
+    
+    /*
+     Compute this view's camera from its camera node, whose world transform must be
+     up to date. Returns false if the node no longer has a camera.
+     */
+    bool updateCamera(float zNear, float zFar);
+    const VROCamera &getCamera() const {
+        return _camera;
+    }
+    
+    /*
+     Render the scene from this view's camera into its texture. The given context
+     is that of the main view, whose sort keys have been computed for this frame.
+     */
+    void render(std::shared_ptr<VROScene> scene, const VRORenderContext &context,
+                std::shared_ptr<VRODriver> &driver);
+    
+private:
+    
+    std::shared_ptr<VRONode> _cameraNode;
+    int _width, _height;
+    int _updateInterval;
+    int _viewBitMask;
+    bool _backgroundEnabled;
+    bool _transparencyEnabled;
+    VROVector4f _clearColor;
+    
+    /*
+     The camera and projection of the view, computed when it's due.
+     */
+    VROCamera _camera;
+    VROMatrix4f _projection;
+    float _zNear, _zFar;
+    
+    /*
+     The frame this view was last rendered in, or -1 if never.
+     */
+    int _lastRenderedFrame;
+    
+    /*
+     The target the view renders into.
+     */
+    std::shared_ptr<VRORenderTarget> _target;
+    
+    /*
+     The view's sorted keys, and the sorter that retains their order across
+     renders.
+     */
+    std::vector<VROSortKey> _keys;
+    VROSortKeySorter _sorter;
+    
+    /*
+     The clustered lights of the view, which are built in its own view space.
+     */
+    std::shared_ptr<VROLightClusterGrid> _lightClusters;
+    
+};
+
+#endif /* VROSecondaryView_h */
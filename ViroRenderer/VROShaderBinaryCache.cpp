@@ -0,0 +1,178 @@
+//
+//  VROShaderBinaryCache.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROShaderBinaryCache.h"
+#include "VROLog.h"
+#include "VROPlatformUtil.h"
+#include <vector>
+#include <stdio.h>
+
+static const uint32_t kShaderBinaryMagic = 0x56524f42; // 'VROB'
+static const uint32_t kShaderBinaryVersion = 1;
+
+// Programs larger than this are assumed to be corrupt
+static const uint32_t kMaxShaderBinaryLength = 16 * 1024 * 1024;
+
+struct VROShaderBinaryHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t driverHash;
+    uint32_t format;
+    uint32_t length;
+};
+
+VROShaderBinaryCache::VROShaderBinaryCache(std::string directory) :
+    _directory(directory),
+    _driverHash(0),
+    _supported(false),
+    _initialized(false) {
+
+}
+
+VROShaderBinaryCache::~VROShaderBinaryCache() {
+
+}
+
+void VROShaderBinaryCache::initialize() {
+    if (_initialized) {
+        return;
+    }
+    _initialized = true;
+
+#if VRO_SUPPORTS_PROGRAM_BINARY
+    GLint numFormats = 0;
+    GL( glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats) );
+    _supported = numFormats > 0 && !_directory.empty();
+    if (!_supported) {
+        pinfo("Shader binary cache disabled: driver reports no program binary formats");
+        return;
+    }
+
+    const char *vendor   = (const char *) GL( glGetString(GL_VENDOR) );
+    const char *renderer = (const char *) GL( glGetString(GL_RENDERER) );
+    const char *version  = (const char *) GL( glGetString(GL_VERSION) );
+
+    uint64_t driverHash = kVROCacheKeySeed;
+    driverHash = hash(vendor   ? vendor   : "", driverHash);
+    driverHash = hash(renderer ? renderer : "", driverHash);
+    driverHash = hash(version  ? version  : "", driverHash);
+    _driverHash = driverHash;
+#endif
+}
+
+uint64_t VROShaderBinaryCache::hash(const std::string &string, uint64_t seed) {
+    return VROPlatformHashCacheKey(string.data(), string.size(), seed);
+}
+
+std::string VROShaderBinaryCache::getPath(const std::string &vertexSource, const std::string &fragmentSource) const {
+    uint64_t key = hash(fragmentSource, hash(vertexSource, kVROCacheKeySeed));
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long) key);
+    return _directory + "/" + name;
+}
+
+bool VROShaderBinaryCache::load(const std::string &vertexSource, const std::string &fragmentSource, GLuint program) {
+#if VRO_SUPPORTS_PROGRAM_BINARY
+    initialize();
+    if (!_supported) {
+        return false;
+    }
+
+    std::string path = getPath(vertexSource, fragmentSource);
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+
+    VROShaderBinaryHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        header.magic != kShaderBinaryMagic ||
+        header.version != kShaderBinaryVersion ||
+        header.driverHash != _driverHash ||
+        header.length == 0 || header.length > kMaxShaderBinaryLength) {
+
+        fclose(file);
+        return false;
+    }
+
+    std::vector<uint8_t> binary(header.length);
+    size_t read = fread(binary.data(), 1, header.length, file);
+    fclose(file);
+
+    if (read != header.length) {
+        return false;
+    }
+
+    GL( glProgramBinary(program, header.format, binary.data(), header.length) );
+
+    // Drivers may reject binaries at will (e.g. after an OS update), in which case
+    // the program remains unlinked and we fall back to compiling
+    GLint status = 0;
+    GL( glGetProgramiv(program, GL_LINK_STATUS, &status) );
+    if (status == 0) {
+        pinfo("Rejected cached shader binary %s", path.c_str());
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void VROShaderBinaryCache::store(const std::string &vertexSource, const std::string &fragmentSource, GLuint program) {
+#if VRO_SUPPORTS_PROGRAM_BINARY
+    initialize();
+    if (!_supported) {
+        return;
+    }
+
+    GLint length = 0;
+    GL( glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length) );
+    if (length <= 0 || length > (GLint) kMaxShaderBinaryLength) {
+        return;
+    }
+
+    std::vector<uint8_t> binary(length);
+    GLenum format = 0;
+    GLsizei written = 0;
+    GL( glGetProgramBinary(program, length, &written, &format, binary.data()) );
+    if (written <= 0) {
+        return;
+    }
+
+    VROShaderBinaryHeader header;
+    header.magic = kShaderBinaryMagic;
+    header.version = kShaderBinaryVersion;
+    header.driverHash = _driverHash;
+    header.format = format;
+    header.length = (uint32_t) written;
+
+    VROPlatformWriteCacheFile(getPath(vertexSource, fragmentSource), [&header, &binary, written](FILE *file) {
+        return fwrite(&header, sizeof(header), 1, file) == 1 &&
+               fwrite(binary.data(), 1, written, file) == (size_t) written;
+    });
+#endif
+}
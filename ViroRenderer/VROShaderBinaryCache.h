@@ -0,0 +1,89 @@
+//
+//  VROShaderBinaryCache.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROShaderBinaryCache_h
+#define VROShaderBinaryCache_h
+
+#include <string>
+#include <stdint.h>
+#include "VROOpenGL.h"
+
+/*
+ Persists linked shader programs to disk via glGetProgramBinary, so that
+ subsequent launches can skip compiling and linking GLSL. Each program is
+ stored in its own file, keyed by a hash of its final vertex and fragment
+ source. Each file also records a hash of the GL vendor, renderer, and
+ version strings: binaries produced by a different driver are treated as
+ cache misses and overwritten.
+
+ All methods must be invoked on the rendering thread.
+ */
+class VROShaderBinaryCache {
+public:
+
+    VROShaderBinaryCache(std::string directory);
+    virtual ~VROShaderBinaryCache();
+
+    /*
+     Attempt to load the cached binary for the given sources into the given
+     program. Returns true if the program was successfully loaded and linked.
+     On failure the program is left untouched and may be compiled normally.
+     */
+    bool load(const std::string &vertexSource, const std::string &fragmentSource, GLuint program);
+
+    /*
+     Store the binary of the given (successfully linked) program, keyed by
+     the sources it was compiled from.
+     */
+    void store(const std::string &vertexSource, const std::string &fragmentSource, GLuint program);
+
+private:
+
+    /*
+     The directory in which binaries are stored. Created on first store.
+     */
+    std::string _directory;
+
+    /*
+     Hash identifying the GL driver, computed lazily since it requires an
+     active GL context. Binaries are only valid for the driver that produced
+     them.
+     */
+    uint64_t _driverHash;
+
+    /*
+     False if this driver reports no program binary formats, in which case
+     the cache is disabled.
+     */
+    bool _supported;
+    bool _initialized;
+
+    void initialize();
+    std::string getPath(const std::string &vertexSource, const std::string &fragmentSource) const;
+    static uint64_t hash(const std::string &string, uint64_t seed);
+
+};
+
+#endif /* VROShaderBinaryCache_h */
@@ -31,6 +31,13 @@
 #include "VROLight.h"
 #include "VROShaderModifier.h"
 #include "VRORenderContext.h"
+#include <sstream>
+
+/*
+ Version of the serialized capability format. Bumped whenever fields are added
+ to the capabilities, so that stale manifests are ignored rather than misread.
+ */
+static const int kShaderCapabilitiesFormatVersion = 4;
 
 #pragma mark - Shader Capability Extraction and Construction
 
@@ -46,7 +53,10 @@ VROMaterialShaderCapabilities VROShaderCapabilities::deriveMaterialCapabilitiesK
     cap.diffuseTextureStereoMode = VROStereoMode::None;
     cap.bloom = false;
     cap.postProcessMask = false;
+    cap.equirectangularDiffuse = false;
     cap.receivesShadows = true;
+    cap.shadowCatcher = false;
+    cap.crossfade = material.isCrossfading();
     
     cap.additionalModifierKeys = VROShaderModifier::getShaderModifierKey(material.getShaderModifiers());
     
@@ -69,6 +79,10 @@ VROMaterialShaderCapabilities VROShaderCapabilities::deriveMaterialCapabilitiesK
             cap.diffuseTexture = VRODiffuseTextureType::YCbCr;
         } else if (diffuse.getTexture()->getInternalFormat() == VROTextureInternalFormat::RG8) {
             cap.diffuseTexture = VRODiffuseTextureType::Text;
+        } else if (diffuse.getTexture()->getTextureArrayId() != 0) {
+            cap.diffuseTexture = VRODiffuseTextureType::Array;
+        } else if (diffuse.getTexture()->getTextureAtlasId() != 0) {
+            cap.diffuseTexture = VRODiffuseTextureType::Atlas;
         } else {
             cap.diffuseTexture = VRODiffuseTextureType::Normal;
         }
@@ -143,6 +157,7 @@ VROMaterialShaderCapabilities VROShaderCapabilities::deriveMaterialCapabilitiesK
     
     // Shadows
     cap.receivesShadows = material.getReceivesShadows();
+    cap.shadowCatcher = material.isShadowCatcher();
     
     // Bloom
     cap.bloom = material.isBloomSupported();
@@ -150,6 +165,10 @@ VROMaterialShaderCapabilities VROShaderCapabilities::deriveMaterialCapabilitiesK
     // Post Process Mask
     cap.postProcessMask = material.getPostProcessMask();
 
+    // Equirectangular diffuse, which only applies to 2D diffuse textures
+    cap.equirectangularDiffuse = material.isEquirectangularDiffuse() &&
+                                 cap.diffuseTexture != VRODiffuseTextureType::Cube;
+
     // Chroma key filtering
     if (material.isChromaKeyFilteringEnabled()) {
         cap.chromaKeyFiltering = true;
@@ -173,6 +192,11 @@ VROLightingShaderCapabilities VROShaderCapabilities::deriveLightingCapabilitiesK
     cap.pbr = context.isPBREnabled();
     cap.diffuseIrradiance = false;
     cap.specularIrradiance = false;
+    cap.sphericalHarmonicsIrradiance = false;
+    cap.clusteredLighting = context.isClusteredLightingEnabled();
+    cap.multiview = context.isMultiviewEnabled();
+    cap.weightedTransparency = context.isAccumulatingTransparency();
+    cap.temporalAA = context.isTemporalAAEnabled();
     
     if (context.getShadowMap() != nullptr) {
         for (const std::shared_ptr<VROLight> &light : lights) {
@@ -185,9 +209,95 @@ VROLightingShaderCapabilities VROShaderCapabilities::deriveLightingCapabilitiesK
     if (context.getIrradianceMap() != nullptr) {
         cap.diffuseIrradiance = true;
     }
+    else if (context.getIrradianceSphericalHarmonics() != nullptr) {
+        cap.sphericalHarmonicsIrradiance = true;
+    }
     if (context.getBRDFMap() != nullptr && context.getPrefilteredMap() != nullptr) {
         cap.specularIrradiance = true;
     }
 
     return cap;
 }
+
+#pragma mark - Serialization
+
+std::string VROShaderCapabilities::serialize() const {
+    const VROMaterialShaderCapabilities &m = materialCapabilities;
+    const VROLightingShaderCapabilities &l = lightingCapabilities;
+    // Cross-fading shaders only exist for the duration of a material transition,
+    // so they are not worth prewarming
+    if (!m.additionalModifierKeys.empty() || m.crossfade) {
+        return "";
+    }
+    
+    std::stringstream ss;
+    ss << "v" << kShaderCapabilitiesFormatVersion << " "
+       << (int) m.lightingModel << " " << (int) m.diffuseTexture << " " << (int) m.diffuseTextureStereoMode << " "
+       << m.diffuseEGLModifier << " " << m.specularTexture << " " << m.normalTexture << " " << m.reflectiveTexture << " "
+       << m.roughnessMap << " " << m.metalnessMap << " " << m.aoMap << " " << m.bloom << " " << m.postProcessMask << " "
+       << m.equirectangularDiffuse << " " << m.receivesShadows << " " << m.shadowCatcher << " " << m.chromaKeyFiltering << " "
+       << m.chromaKeyRed << " " << m.chromaKeyGreen << " " << m.chromaKeyBlue << " "
+       << l.shadows << " " << l.hdr << " " << l.pbr << " " << l.diffuseIrradiance << " " << l.specularIrradiance << " "
+       << l.sphericalHarmonicsIrradiance << " " << l.clusteredLighting << " " << l.multiview << " " << l.weightedTransparency << " "
+       << l.temporalAA;
+    return ss.str();
+}
+
+bool VROShaderCapabilities::deserialize(const std::string &line, VROShaderCapabilities *outCapabilities) {
+    std::stringstream ss(line);
+    std::string version;
+    ss >> version;
+    if (version != "v" + std::to_string(kShaderCapabilitiesFormatVersion)) {
+        return false;
+    }
+    
+    // The values in the order written by serialize
+    int lightingModel, diffuseTexture, stereoMode;
+    int m[16], l[10];
+    ss >> lightingModel >> diffuseTexture >> stereoMode;
+    for (int i = 0; i < 16; i++) {
+        ss >> m[i];
+    }
+    for (int i = 0; i < 10; i++) {
+        ss >> l[i];
+    }
+    if (ss.fail()) {
+        return false;
+    }
+    
+    VROMaterialShaderCapabilities &material = outCapabilities->materialCapabilities;
+    material.lightingModel = (VROLightingModel) lightingModel;
+    material.diffuseTexture = (VRODiffuseTextureType) diffuseTexture;
+    material.diffuseTextureStereoMode = (VROStereoMode) stereoMode;
+    material.diffuseEGLModifier = m[0];
+    material.specularTexture = m[1];
+    material.normalTexture = m[2];
+    material.reflectiveTexture = m[3];
+    material.roughnessMap = m[4];
+    material.metalnessMap = m[5];
+    material.aoMap = m[6];
+    material.bloom = m[7];
+    material.postProcessMask = m[8];
+    material.equirectangularDiffuse = m[9];
+    material.receivesShadows = m[10];
+    material.shadowCatcher = m[11];
+    material.chromaKeyFiltering = m[12];
+    material.chromaKeyRed = m[13];
+    material.chromaKeyGreen = m[14];
+    material.chromaKeyBlue = m[15];
+    material.crossfade = false;
+    material.additionalModifierKeys.clear();
+    
+    VROLightingShaderCapabilities &lighting = outCapabilities->lightingCapabilities;
+    lighting.shadows = l[0];
+    lighting.hdr = l[1];
+    lighting.pbr = l[2];
+    lighting.diffuseIrradiance = l[3];
+    lighting.specularIrradiance = l[4];
+    lighting.sphericalHarmonicsIrradiance = l[5];
+    lighting.clusteredLighting = l[6];
+    lighting.multiview = l[7];
+    lighting.weightedTransparency = l[8];
+    lighting.temporalAA = l[9];
+    return true;
+}
@@ -44,6 +44,8 @@ enum class VRODiffuseTextureType {
     Normal,
     Cube,
     Text,
+    Array,
+    Atlas,
 };
 
 /*
@@ -64,24 +66,27 @@ struct VROMaterialShaderCapabilities {
     bool roughnessMap, metalnessMap, aoMap;
     bool bloom;
     bool postProcessMask;
+    bool equirectangularDiffuse;
     bool receivesShadows;
+    bool shadowCatcher;
     bool chromaKeyFiltering;
     int chromaKeyRed, chromaKeyGreen, chromaKeyBlue;
+    bool crossfade;
     std::string additionalModifierKeys;
     
     bool operator< (const VROMaterialShaderCapabilities& r) const {
         return std::tie(lightingModel, diffuseTexture, diffuseTextureStereoMode,
                         diffuseEGLModifier, specularTexture, normalTexture, reflectiveTexture,
                         roughnessMap, metalnessMap, aoMap, bloom, postProcessMask,
-                        receivesShadows,
+                        equirectangularDiffuse, receivesShadows, shadowCatcher,
                         chromaKeyFiltering, chromaKeyRed, chromaKeyGreen, chromaKeyBlue,
-                        additionalModifierKeys) <
+                        crossfade, additionalModifierKeys) <
                 std::tie(r.lightingModel, r.diffuseTexture, r.diffuseTextureStereoMode,
                          r.diffuseEGLModifier, r.specularTexture, r.normalTexture, r.reflectiveTexture,
                          r.roughnessMap, r.metalnessMap, r.aoMap, r.bloom, r.postProcessMask,
-                         r.receivesShadows,
+                         r.equirectangularDiffuse, r.receivesShadows, r.shadowCatcher,
                          r.chromaKeyFiltering, r.chromaKeyRed, r.chromaKeyGreen, r.chromaKeyBlue,
-                         r.additionalModifierKeys);
+                         r.crossfade, r.additionalModifierKeys);
     }
 };
 
@@ -96,24 +101,41 @@ struct VROLightingShaderCapabilities {
     bool pbr;
     bool diffuseIrradiance;
     bool specularIrradiance;
+    bool sphericalHarmonicsIrradiance;
+    bool clusteredLighting;
+    bool multiview;
+    bool weightedTransparency;
+    bool temporalAA;
     
     bool operator< (const VROLightingShaderCapabilities &r) const {
-        return std::tie(  shadows,   hdr,   pbr,   diffuseIrradiance,   specularIrradiance)
-             < std::tie(r.shadows, r.hdr, r.pbr, r.diffuseIrradiance, r.specularIrradiance);
+        return std::tie(  shadows,   hdr,   pbr,   diffuseIrradiance,   specularIrradiance,   sphericalHarmonicsIrradiance,
+                          clusteredLighting,   multiview,   weightedTransparency,   temporalAA)
+             < std::tie(r.shadows, r.hdr, r.pbr, r.diffuseIrradiance, r.specularIrradiance, r.sphericalHarmonicsIrradiance,
+                        r.clusteredLighting, r.multiview, r.weightedTransparency, r.temporalAA);
     }
     bool operator== (const VROLightingShaderCapabilities& r) const {
         return shadows == r.shadows &&
                hdr == r.hdr &&
                pbr == r.pbr &&
                diffuseIrradiance == r.diffuseIrradiance &&
-               specularIrradiance == r.specularIrradiance;
+               specularIrradiance == r.specularIrradiance &&
+               sphericalHarmonicsIrradiance == r.sphericalHarmonicsIrradiance &&
+               clusteredLighting == r.clusteredLighting &&
+               multiview == r.multiview &&
+               weightedTransparency == r.weightedTransparency &&
+               temporalAA == r.temporalAA;
     }
     bool operator!= (const VROLightingShaderCapabilities& r) const {
         return shadows != r.shadows ||
                hdr != r.hdr ||
                pbr != r.pbr ||
                diffuseIrradiance != r.diffuseIrradiance ||
-               specularIrradiance != r.specularIrradiance;
+               specularIrradiance != r.specularIrradiance ||
+               sphericalHarmonicsIrradiance != r.sphericalHarmonicsIrradiance ||
+               clusteredLighting != r.clusteredLighting ||
+               multiview != r.multiview ||
+               weightedTransparency != r.weightedTransparency ||
+               temporalAA != r.temporalAA;
     }
 };
 
@@ -150,6 +172,19 @@ public:
      */
     static VROMaterialShaderCapabilities deriveMaterialCapabilitiesKey(const VROMaterial &material);
     
+    /*
+     Encode these capabilities as a single line of text, for shader manifests (see
+     VROShaderFactory::getShaderManifest). Capabilities with custom shader modifiers
+     cannot be rebuilt from their keys, so they encode to an empty string.
+     */
+    std::string serialize() const;
+    
+    /*
+     Decode capabilities encoded by serialize. Returns false if the line is malformed
+     or was written by an incompatible version.
+     */
+    static bool deserialize(const std::string &line, VROShaderCapabilities *outCapabilities);
+    
 };
 
 #endif /* VROShaderCapabilities_hpp */
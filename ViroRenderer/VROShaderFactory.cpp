@@ -37,10 +37,18 @@
 #include "VROStringUtil.h"
 #include "VROShadowMapRenderPass.h"
 #include "VROShaderCapabilities.h"
+#include "VRORenderContext.h"
 #include "VRODriverOpenGL.h"
+#include "VROARShadow.h"
+#include "VROTemporalAntialiasingRenderPass.h"
+#include "VROMath.h"
 #include <tuple>
 
 static thread_local std::shared_ptr<VROShaderModifier> sDiffuseTextureModifier;
+static thread_local std::shared_ptr<VROShaderModifier> sDiffuseTextureArrayGeometryModifier;
+static thread_local std::shared_ptr<VROShaderModifier> sDiffuseTextureArrayModifier;
+static thread_local std::shared_ptr<VROShaderModifier> sDiffuseTextureAtlasGeometryModifier;
+static thread_local std::shared_ptr<VROShaderModifier> sDiffuseTextureAtlasModifier;
 static thread_local std::shared_ptr<VROShaderModifier> sSpecularTextureModifier;
 static thread_local std::shared_ptr<VROShaderModifier> sNormalMapTextureModifier;
 static thread_local std::shared_ptr<VROShaderModifier> sReflectiveTextureModifier;
@@ -56,16 +64,24 @@ static thread_local std::shared_ptr<VROShaderModifier> sPBRDirectLightingModifie
 static thread_local std::shared_ptr<VROShaderModifier> sPBRConstantAmbientFragmentModifier;
 static thread_local std::shared_ptr<VROShaderModifier> sPBRDiffuseIrradianceFragmentModifier;
 static thread_local std::shared_ptr<VROShaderModifier> sPBRDiffuseAndSpecularIrradianceFragmentModifier;
+static thread_local std::shared_ptr<VROShaderModifier> sPBRSphericalHarmonicsIrradianceFragmentModifier;
+static thread_local std::shared_ptr<VROShaderModifier> sPBRSphericalHarmonicsAndSpecularIrradianceFragmentModifier;
+static thread_local std::shared_ptr<VROShaderModifier> sShadowCatcherIrradianceModifier;
+static thread_local std::shared_ptr<VROShaderModifier> sShadowCatcherSphericalHarmonicsModifier;
 static thread_local std::shared_ptr<VROShaderModifier> sRGTextureModifier;
 static thread_local std::shared_ptr<VROShaderModifier> sYCbCrTextureModifier;
 static thread_local std::shared_ptr<VROShaderModifier> sShadowMapGeometryModifier;
 static thread_local std::shared_ptr<VROShaderModifier> sShadowMapLightModifier;
+static thread_local std::shared_ptr<VROShaderModifier> sClusteredLightingModifier;
 static thread_local std::shared_ptr<VROShaderModifier> sBloomModifier;
 static thread_local std::shared_ptr<VROShaderModifier> sPostProcesMaskModifier;
 static thread_local std::shared_ptr<VROShaderModifier> sToneMappingMaskModifier;
+static thread_local std::shared_ptr<VROShaderModifier> sWeightedTransparencyModifier;
+static thread_local std::shared_ptr<VROShaderModifier> sEquirectangularTextureModifier;
 
 static thread_local std::map<std::tuple<int, int, int>, std::shared_ptr<VROShaderModifier>> sChromaKeyModifiers;
 static thread_local std::map<VROStereoMode, std::shared_ptr<VROShaderModifier>> sStereoscopicTextureModifiers;
+static thread_local std::map<std::tuple<bool, bool>, std::shared_ptr<VROShaderModifier>> sCrossfadeModifiers;
 
 // Debugging
 static thread_local std::shared_ptr<VROShaderModifier> sShadowMapFragmentModifier;
@@ -94,6 +110,10 @@ std::shared_ptr<VROShaderProgram> VROShaderFactory::getShader(VROMaterialShaderC
     if (it == _cachedPrograms.end()) {
         std::shared_ptr<VROShaderProgram> program = buildShader(capabilities, modifiers, driver);
         _cachedPrograms[capabilities] = program;
+        if (capabilities.materialCapabilities.additionalModifierKeys.empty()) {
+            std::lock_guard<std::mutex> lock(_builtCapabilitiesMutex);
+            _builtCapabilities.insert(capabilities);
+        }
         
         return program;
     }
@@ -102,6 +122,78 @@ std::shared_ptr<VROShaderProgram> VROShaderFactory::getShader(VROMaterialShaderC
     }
 }
 
+void VROShaderFactory::prewarmShaders(const std::vector<VROShaderCapabilities> &capabilities) {
+    for (const VROShaderCapabilities &capability : capabilities) {
+        // Shader modifiers aren't derivable from their keys, so we can't build these here
+        if (!capability.materialCapabilities.additionalModifierKeys.empty()) {
+            pwarn("Skipping prewarm of shader with custom modifiers [%s]",
+                  capability.materialCapabilities.additionalModifierKeys.c_str());
+            continue;
+        }
+        _pendingPrewarm.push_back(capability);
+    }
+}
+
+std::string VROShaderFactory::getShaderManifest() const {
+    std::lock_guard<std::mutex> lock(_builtCapabilitiesMutex);
+    std::string manifest;
+    for (const VROShaderCapabilities &capabilities : _builtCapabilities) {
+        manifest += capabilities.serialize() + "\n";
+    }
+    return manifest;
+}
+
+void VROShaderFactory::prewarmShaders(const std::string &manifest) {
+    std::vector<VROShaderCapabilities> capabilities;
+    size_t start = 0;
+    while (start < manifest.size()) {
+        size_t end = manifest.find('\n', start);
+        if (end == std::string::npos) {
+            end = manifest.size();
+        }
+        
+        VROShaderCapabilities entry;
+        if (end > start && VROShaderCapabilities::deserialize(manifest.substr(start, end - start), &entry)) {
+            capabilities.push_back(entry);
+        }
+        start = end + 1;
+    }
+    pinfo("Prewarming %d shaders from manifest", (int) capabilities.size());
+    prewarmShaders(capabilities);
+}
+
+bool VROShaderFactory::hydratePrewarmShaders(const VROFrameTimer &timer, std::shared_ptr<VRODriverOpenGL> &driver) {
+    while (!_pendingPrewarm.empty()) {
+        if (!timer.isTimeRemainingInFrame()) {
+            return false;
+        }
+
+        VROShaderCapabilities capabilities = _pendingPrewarm.back();
+        _pendingPrewarm.pop_back();
+
+        std::shared_ptr<VROShaderProgram> program = getShader(capabilities.materialCapabilities,
+                                                              capabilities.lightingCapabilities,
+                                                              {}, driver);
+        if (!program->isHydrated() && !program->isHydrating()) {
+            program->hydrateAsync();
+        }
+        _prewarmedPrograms.push_back(program);
+    }
+    return true;
+}
+
+bool VROShaderFactory::hasPendingShaders() const {
+    if (!_pendingPrewarm.empty()) {
+        return true;
+    }
+    for (auto &kv : _cachedPrograms) {
+        if (kv.second->isHydrating()) {
+            return true;
+        }
+    }
+    return false;
+}
+
 bool VROShaderFactory::purgeUnusedShaders(const VROFrameTimer &timer, bool force) {
     std::map<VROShaderCapabilities, std::shared_ptr<VROShaderProgram>>::iterator it = _cachedPrograms.begin();
     while (it != _cachedPrograms.end()) {
@@ -156,6 +248,12 @@ std::shared_ptr<VROShaderProgram> VROShaderFactory::buildShader(VROShaderCapabil
     std::vector<std::string> samplers;
     std::vector<std::shared_ptr<VROShaderModifier>> modifiers;
     
+    // Equirectangular sampling derives the texture coordinates that stereo mode
+    // and the diffuse texture build on, so it must come first
+    if (materialCapabilities.equirectangularDiffuse) {
+        modifiers.push_back(createEquirectangularTextureModifier());
+    }
+
     // Stereo mode must be placed prior to diffuse texture (because it modifies
     // the texture coordinates used when sampling the diffuse texture)
     if (materialCapabilities.diffuseTextureStereoMode != VROStereoMode::None) {
@@ -167,6 +265,16 @@ std::shared_ptr<VROShaderProgram> VROShaderFactory::buildShader(VROShaderCapabil
         samplers.push_back("diffuse_texture");
         modifiers.push_back(createDiffuseTextureModifier());
     }
+    else if (materialCapabilities.diffuseTexture == VRODiffuseTextureType::Array) {
+        samplers.push_back("diffuse_texture");
+        modifiers.push_back(createDiffuseTextureArrayGeometryModifier());
+        modifiers.push_back(createDiffuseTextureArrayModifier());
+    }
+    else if (materialCapabilities.diffuseTexture == VRODiffuseTextureType::Atlas) {
+        samplers.push_back("diffuse_texture");
+        modifiers.push_back(createDiffuseTextureAtlasGeometryModifier());
+        modifiers.push_back(createDiffuseTextureAtlasModifier());
+    }
     else if (materialCapabilities.diffuseTexture == VRODiffuseTextureType::Text) {
         samplers.push_back("diffuse_texture");
         modifiers.push_back(createTextTextureModifier());
@@ -184,6 +292,16 @@ std::shared_ptr<VROShaderProgram> VROShaderFactory::buildShader(VROShaderCapabil
         // Do nothing
     }
     
+    // Cross-fade from the outgoing material's diffuse contents, which replaces
+    // drawing the outgoing material separately
+    if (materialCapabilities.crossfade) {
+        bool diffuseTexture = (materialCapabilities.diffuseTexture == VRODiffuseTextureType::Normal);
+        if (diffuseTexture) {
+            samplers.push_back("crossfade_diffuse_texture");
+        }
+        modifiers.push_back(createCrossfadeModifier(diffuseTexture, driver->isLinearRenderingEnabled()));
+    }
+    
     if (materialCapabilities.diffuseEGLModifier) {
         modifiers.push_back(createEGLImageModifier(driver->isLinearRenderingEnabled()));
     }
@@ -200,9 +318,22 @@ std::shared_ptr<VROShaderProgram> VROShaderFactory::buildShader(VROShaderCapabil
         modifiers.push_back(createNormalMapTextureModifier());
     }
     
+    // Shadow catchers render only the shadows cast onto them, so they skip the
+    // lighting model entirely and only accumulate the ambient term, which
+    // VROARShadow uses to soften the shadow
+    if (materialCapabilities.shadowCatcher) {
+        if (lightingCapabilities.diffuseIrradiance) {
+            samplers.push_back("irradiance_map");
+            modifiers.push_back(createShadowCatcherIrradianceModifier());
+        }
+        else if (lightingCapabilities.sphericalHarmonicsIrradiance) {
+            modifiers.push_back(createShadowCatcherSphericalHarmonicsModifier());
+        }
+    }
+    
     // PBR lighting model
-    if (lightingModel == VROLightingModel::PhysicallyBased &&
-        lightingCapabilities.pbr) {
+    else if (lightingModel == VROLightingModel::PhysicallyBased &&
+             lightingCapabilities.pbr) {
         if (materialCapabilities.roughnessMap) {
             samplers.push_back("roughness_map");
             modifiers.push_back(createRoughnessTextureModifier());
@@ -228,6 +359,14 @@ std::shared_ptr<VROShaderProgram> VROShaderFactory::buildShader(VROShaderCapabil
             samplers.push_back("brdf_map");
             modifiers.push_back(createPBRDiffuseAndSpecularIrradianceFragmentModifier());
         }
+        else if (lightingCapabilities.sphericalHarmonicsIrradiance && !lightingCapabilities.specularIrradiance) {
+            modifiers.push_back(createPBRSphericalHarmonicsIrradianceFragmentModifier());
+        }
+        else if (lightingCapabilities.sphericalHarmonicsIrradiance && lightingCapabilities.specularIrradiance) {
+            samplers.push_back("prefiltered_map");
+            samplers.push_back("brdf_map");
+            modifiers.push_back(createPBRSphericalHarmonicsAndSpecularIrradianceFragmentModifier());
+        }
         else {
             modifiers.push_back(createPBRConstantAmbientFragmentModifier());
         }
@@ -270,17 +409,40 @@ std::shared_ptr<VROShaderProgram> VROShaderFactory::buildShader(VROShaderCapabil
         }
         samplers.push_back("shadow_map");
     }
+    
+    // Clustered lighting: in addition to the per-node lights, loop over the
+    // lights in the fragment's cluster
+    if (lightingCapabilities.clusteredLighting && lightingModel != VROLightingModel::Constant &&
+        !materialCapabilities.shadowCatcher) {
+        modifiers.push_back(createClusteredLightingModifier());
+    }
 
-    // Bloom
-    if (lightingCapabilities.hdr && materialCapabilities.bloom && driver->isBloomSupported()) {
+    // Bloom. Accumulated transparency writes only its own targets, so it does not
+    // contribute to bloom or the post process mask.
+    bool weightedTransparency = lightingCapabilities.weightedTransparency;
+    if (lightingCapabilities.hdr && materialCapabilities.bloom && driver->isBloomSupported() &&
+        !weightedTransparency) {
         modifiers.push_back(createBloomModifier());
     }
 
     // Post Process Mask. Also apply the same isBloomSupported optimizations.
-    if (materialCapabilities.postProcessMask) {
+    if (materialCapabilities.postProcessMask && !weightedTransparency) {
         modifiers.push_back(createPostProcessMaskModifier());
     }
     
+    // Velocity, for temporal anti-aliasing; written to its own HDR attachment
+    if (lightingCapabilities.temporalAA && lightingCapabilities.hdr && !weightedTransparency) {
+        modifiers.push_back(VROTemporalAntialiasingRenderPass::getVelocityModifier());
+    }
+    
+    // Shadow catcher modifiers, which must follow the shadow modifiers since they
+    // read the visibility each light computes
+    if (materialCapabilities.shadowCatcher) {
+        modifiers.push_back(VROARShadow::createSurfaceModifier());
+        modifiers.push_back(VROARShadow::createLightingModifier());
+        modifiers.push_back(VROARShadow::createFragmentModifier());
+    }
+    
     // Custom material modifiers. These are added to the back of the modifiers list
     // so that they can build off the standard modifiers.
     modifiers.insert(modifiers.end(), modifiers_in.begin(), modifiers_in.end());
@@ -294,13 +456,27 @@ std::shared_ptr<VROShaderProgram> VROShaderFactory::buildShader(VROShaderCapabil
 
     // The tone mapping mask generator must be the absolute *last* shader modifier
     // applied; otherwise it will be based on outdated alpha data (causing, for example
-    // transparent shadow planes to be partially visible)
-    if (lightingCapabilities.hdr) {
+    // transparent shadow planes to be partially visible). The same holds for the
+    // weighted transparency modifier, which replaces it when accumulating transparency.
+    if (weightedTransparency) {
+        modifiers.push_back(createWeightedTransparencyModifier());
+    }
+    else if (lightingCapabilities.hdr) {
         modifiers.push_back(createToneMappingMaskModifier());
     }
     
-    return std::make_shared<VROShaderProgram>(vertexShader, fragmentShader, samplers, modifiers, attributes,
-                                              driver);
+    std::shared_ptr<VROShaderProgram> program = std::make_shared<VROShaderProgram>(vertexShader, fragmentShader, samplers,
+                                                                                   modifiers, attributes, driver);
+    if (lightingCapabilities.multiview) {
+        program->enableMultiview(kMultiviewNumViews);
+    }
+    else if (driver->getUniformRing()) {
+        program->enableUniformRing();
+    }
+    if (driver->isMultiDrawIndirectSupported()) {
+        program->enableDrawID();
+    }
+    return program;
 }
 
 #pragma mark - Texture Modifiers
@@ -321,6 +497,94 @@ std::shared_ptr<VROShaderModifier> VROShaderFactory::createDiffuseTextureModifie
     return sDiffuseTextureModifier;
 }
 
+std::shared_ptr<VROShaderModifier> VROShaderFactory::createDiffuseTextureArrayGeometryModifier() {
+    /*
+     Modifier that passes the layer of the diffuse texture array to sample to the
+     fragment shader. Instanced draws override the layer per instance (see
+     VROInstancedTransformUBO::getInstanceLayerShaderModifier).
+     */
+    if (!sDiffuseTextureArrayGeometryModifier) {
+        std::vector<std::string> modifierCode =  {
+            "uniform highp float material_diffuse_layer;",
+            "out highp float v_diffuse_layer;",
+            "v_diffuse_layer = material_diffuse_layer;"
+        };
+        sDiffuseTextureArrayGeometryModifier = std::make_shared<VROShaderModifier>(VROShaderEntryPoint::Geometry,
+                                                                                   modifierCode);
+        sDiffuseTextureArrayGeometryModifier->setUniformBinder("material_diffuse_layer", VROShaderProperty::Float,
+                                                               [](VROUniform *uniform,
+                                                                  const VROGeometry *geometry, const VROMaterial *material) {
+            std::shared_ptr<VROTexture> texture = material->getDiffuse().getTexture();
+            uniform->setFloat(texture ? std::max(texture->getTextureArrayLayer(), 0) : 0);
+        });
+        sDiffuseTextureArrayGeometryModifier->setName("diffuse_array_layer");
+    }
+    return sDiffuseTextureArrayGeometryModifier;
+}
+
+std::shared_ptr<VROShaderModifier> VROShaderFactory::createDiffuseTextureArrayModifier() {
+    /*
+     Modifier that multiplies the material's surface color by its layer of a
+     diffuse texture array.
+     */
+    if (!sDiffuseTextureArrayModifier) {
+        std::vector<std::string> modifierCode =  {
+            "uniform highp sampler2DArray diffuse_texture;",
+            "in highp float v_diffuse_layer;",
+            "_surface.diffuse_color *= texture(diffuse_texture, vec3(_surface.diffuse_texcoord, v_diffuse_layer));"
+        };
+        sDiffuseTextureArrayModifier = std::make_shared<VROShaderModifier>(VROShaderEntryPoint::Surface,
+                                                                           modifierCode);
+        sDiffuseTextureArrayModifier->setName("diffuse_array");
+    }
+    return sDiffuseTextureArrayModifier;
+}
+
+std::shared_ptr<VROShaderModifier> VROShaderFactory::createDiffuseTextureAtlasGeometryModifier() {
+    /*
+     Modifier that passes the region of the atlas page holding the diffuse texture
+     to the fragment shader. Instanced draws override the region per instance (see
+     VROInstancedTransformUBO::getInstanceAtlasShaderModifier).
+     */
+    if (!sDiffuseTextureAtlasGeometryModifier) {
+        std::vector<std::string> modifierCode =  {
+            "uniform highp vec4 material_diffuse_rect;",
+            "out highp vec4 v_diffuse_rect;",
+            "v_diffuse_rect = material_diffuse_rect;"
+        };
+        sDiffuseTextureAtlasGeometryModifier = std::make_shared<VROShaderModifier>(VROShaderEntryPoint::Geometry,
+                                                                                   modifierCode);
+        sDiffuseTextureAtlasGeometryModifier->setUniformBinder("material_diffuse_rect", VROShaderProperty::Vec4,
+                                                               [](VROUniform *uniform,
+                                                                  const VROGeometry *geometry, const VROMaterial *material) {
+            std::shared_ptr<VROTexture> texture = material->getDiffuse().getTexture();
+            uniform->setVec4(texture ? texture->getTextureAtlasRect() : VROVector4f(0, 0, 1, 1));
+        });
+        sDiffuseTextureAtlasGeometryModifier->setName("diffuse_atlas_rect");
+    }
+    return sDiffuseTextureAtlasGeometryModifier;
+}
+
+std::shared_ptr<VROShaderModifier> VROShaderFactory::createDiffuseTextureAtlasModifier() {
+    /*
+     Modifier that multiplies the material's surface color by its region of an
+     atlas page. Texture coordinates are clamped to the region, emulating the
+     clamped wrap mode of atlased textures.
+     */
+    if (!sDiffuseTextureAtlasModifier) {
+        std::vector<std::string> modifierCode =  {
+            "uniform sampler2D diffuse_texture;",
+            "in highp vec4 v_diffuse_rect;",
+            "highp vec2 atlas_texcoord = v_diffuse_rect.xy + clamp(_surface.diffuse_texcoord, 0.0, 1.0) * v_diffuse_rect.zw;",
+            "_surface.diffuse_color *= texture(diffuse_texture, atlas_texcoord);"
+        };
+        sDiffuseTextureAtlasModifier = std::make_shared<VROShaderModifier>(VROShaderEntryPoint::Surface,
+                                                                           modifierCode);
+        sDiffuseTextureAtlasModifier->setName("diffuse_atlas");
+    }
+    return sDiffuseTextureAtlasModifier;
+}
+
 std::shared_ptr<VROShaderModifier> VROShaderFactory::createSpecularTextureModifier() {
     /*
      Modifier that multiplies the material's specular color by a specular texture.
@@ -484,16 +748,47 @@ std::shared_ptr<VROShaderModifier> VROShaderFactory::createShadowMapLightModifie
                 // perspective divide. The w coordinate is the depth value of the current fragment; it also
                 // needs the perspective divide and must be adjusted by bias to prevent z-fighting (acne).
                 // Finally, the z coordinate is the index into the texture array that we are checking.
-                "highp vec4 comparison = vec4(shadow_coords[i].xy / shadow_coords[i].w, lights[i].shadow_map_index, (shadow_coords[i].z - lights[i].shadow_bias) / shadow_coords[i].w);",
+                // Shadow coordinates only exist for per-node lights, which may cast shadows; clustered
+                // lights (see createClusteredLightingModifier) never do, and have no shadow map index.
+                //
+                // Each shadow map occupies a tile of the shadow atlas (see VROShadowAtlas). Cascaded
+                // shadow maps select the smallest cascade containing the fragment (by distance from the
+                // camera); the base texcoords are then mapped into the tile of the selected cascade. All
+                // cascades share the light's depth range, so the depth comparison is unchanged. The
+                // boundary test is made on the base texcoords, so that fragments outside the light's
+                // shadow map never sample neighboring tiles. It tests against the caster bounds, the
+                // part of the map covered by shadow casters (see VROLight::getShadowCasterBounds),
+                // which lie within [0, 1]: fragments outside them are lit, and skip the lookup.
+                "highp vec4 comparison = vec4(-1.0);",
+                "if (_light.shadow_map_index >= 0) {",
+                "    highp vec4 shadow_coord = shadow_coords[i];",
+                "    highp vec2 shadow_texcoord = shadow_coord.xy / shadow_coord.w;",
+                "    highp vec4 caster_bounds = shadow_caster_bounds[i];",
+                "    if (all(greaterThanEqual(shadow_texcoord, caster_bounds.xy)) && all(lessThanEqual(shadow_texcoord, caster_bounds.zw))) {",
+                "        int cascade = 0;",
+                "        if (_light.shadow_cascade_count > 1) {",
+                "            highp float shadow_distance = distance(camera_position, _surface.position);",
+                "            cascade = _light.shadow_cascade_count - 1;",
+                "            for (int c = _light.shadow_cascade_count - 2; c >= 0; c--) {",
+                "                if (shadow_distance < shadow_cascade_splits[i][c]) {",
+                "                    cascade = c;",
+                "                }",
+                "            }",
+                "        }",
+                "        shadow_texcoord = shadow_texcoord * shadow_cascade_scales[i][cascade] +",
+                "                          vec2(shadow_cascade_offsets_x[i][cascade], shadow_cascade_offsets_y[i][cascade]);",
+                "        comparison = vec4(shadow_texcoord, shadow_cascade_layers[i][cascade], (shadow_coord.z - _light.shadow_bias) / shadow_coord.w);",
+                "    }",
+                "}",
 
                 // Boundary condition to keep the area outside the texture map white.
-                "if (lights[i].shadow_map_index < 0 || comparison.x < 0.0 || comparison.y < 0.0 || comparison.x > 1.0 || comparison.y > 1.0) {",
+                "if (comparison.x < 0.0) {",
                 "    _lightingContribution.visibility = 1.0;",
 
                 // Perform the shadow test: the texture() command compares the occluder depth (the depth in
                 // the map) to the current fragment depth with PCF. We modify this by our shadow opacity param.
                 "} else {",
-                "    lowp float shadow_intensity = lights[i].shadow_opacity * (1.0 - texture(shadow_map, comparison));",
+                "    lowp float shadow_intensity = _light.shadow_opacity * (1.0 - texture(shadow_map, comparison));",
                 "    _lightingContribution.visibility = 1.0 - shadow_intensity;",
                 "}",
             };
@@ -506,6 +801,30 @@ std::shared_ptr<VROShaderModifier> VROShaderFactory::createShadowMapLightModifie
     return sShadowMapLightModifier;
 }
 
+std::shared_ptr<VROShaderModifier> VROShaderFactory::createClusteredLightingModifier() {
+    /*
+     Modifier that finds the fragment's light cluster, and extends the light loop
+     to iterate over the cluster's lights after the per-node lights. The cluster
+     grid is built by VROLightClusterGrid and bound by VROLightClusterUBO.
+     */
+    if (!sClusteredLightingModifier) {
+        std::vector<std::string> modifierCode = {
+            "#include clustered_lighting_fsh",
+            "highp uint _cluster_header = cluster_header(_surface.position);",
+            "int _cluster_offset = int(_cluster_header >> 8u);",
+            "int _cluster_light_count = int(_cluster_header & 0xFFu);",
+        };
+        sClusteredLightingModifier = std::make_shared<VROShaderModifier>(VROShaderEntryPoint::Surface,
+                                                                         modifierCode);
+        sClusteredLightingModifier->addReplacement("for (int i = 0; i < num_lights; i++) {",
+                                                   "for (int i = 0; i < num_lights + _cluster_light_count; i++) {");
+        sClusteredLightingModifier->addReplacement("VROLightUniforms _light = lights[i];",
+                                                   "VROLightUniforms _light; if (i < num_lights) { _light = lights[i]; } else { _light = clustered_light(_cluster_offset + i - num_lights); }");
+        sClusteredLightingModifier->setName("clustered");
+    }
+    return sClusteredLightingModifier;
+}
+
 std::shared_ptr<VROShaderModifier> VROShaderFactory::createShadowMapFragmentModifier() {
     /*
      Modifier that can change the _output_color. For shadow map debugging. Left
@@ -763,6 +1082,99 @@ std::shared_ptr<VROShaderModifier> VROShaderFactory::createPBRDiffuseAndSpecular
     return sPBRDiffuseAndSpecularIrradianceFragmentModifier;
 }
 
+/*
+ Evaluates the diffuse irradiance at N from the spherical harmonics uploaded by
+ VROMaterialShaderBinding. The coefficients are premultiplied by the basis and
+ cosine lobe constants (see VROSphericalHarmonics), and N is used unflipped, as
+ with the irradiance map.
+ */
+static std::vector<std::string> getSphericalHarmonicsIrradianceCode() {
+    return {
+        "uniform highp vec3 sh_coefficients[9];",
+        "highp vec3 irradiance = max(vec3(0.0), sh_coefficients[0]",
+        "    + sh_coefficients[1] * N.y + sh_coefficients[2] * N.z + sh_coefficients[3] * N.x",
+        "    + sh_coefficients[4] * (N.x * N.y) + sh_coefficients[5] * (N.y * N.z)",
+        "    + sh_coefficients[6] * (3.0 * N.z * N.z - 1.0) + sh_coefficients[7] * (N.x * N.z)",
+        "    + sh_coefficients[8] * (N.x * N.x - N.y * N.y));",
+    };
+}
+
+std::shared_ptr<VROShaderModifier> VROShaderFactory::createPBRSphericalHarmonicsIrradianceFragmentModifier() {
+    if (!sPBRSphericalHarmonicsIrradianceFragmentModifier) {
+        std::vector<std::string> modifierCode = getSphericalHarmonicsIrradianceCode();
+        modifierCode.insert(modifierCode.end(), {
+                "highp vec3 ambient_kS = fresnel_schlick_roughness(max(dot(N, V), 0.0), F0, _surface.roughness);",
+                "highp vec3 ambient_kD = 1.0 - ambient_kS;",
+                "ambient_kD *= 1.0 - _surface.metalness;",
+            
+                // Same combination as the irradiance map modifier above
+                "_ambient = (_ambient * albedo + ambient_kD * irradiance * albedo) * _surface.ao;",
+                "_output_color = vec4(_ambient + _diffuse, _output_color.a);",
+        });
+        sPBRSphericalHarmonicsIrradianceFragmentModifier = std::make_shared<VROShaderModifier>(VROShaderEntryPoint::Fragment,
+                                                                                               modifierCode);
+        sPBRSphericalHarmonicsIrradianceFragmentModifier->setName("pbr_sh");
+    }
+    return sPBRSphericalHarmonicsIrradianceFragmentModifier;
+}
+
+std::shared_ptr<VROShaderModifier> VROShaderFactory::createShadowCatcherIrradianceModifier() {
+    if (!sShadowCatcherIrradianceModifier) {
+        std::vector<std::string> modifierCode = {
+                "uniform samplerCube irradiance_map;",
+                "_ambient += texture(irradiance_map, _surface.normal).rgb;",
+        };
+        sShadowCatcherIrradianceModifier = std::make_shared<VROShaderModifier>(VROShaderEntryPoint::Fragment,
+                                                                               modifierCode);
+        sShadowCatcherIrradianceModifier->setName("catcher_ibl");
+    }
+    return sShadowCatcherIrradianceModifier;
+}
+
+std::shared_ptr<VROShaderModifier> VROShaderFactory::createShadowCatcherSphericalHarmonicsModifier() {
+    if (!sShadowCatcherSphericalHarmonicsModifier) {
+        // The SH code reads N, which is only declared by the PBR modifiers
+        std::vector<std::string> modifierCode = getSphericalHarmonicsIrradianceCode();
+        modifierCode.insert(modifierCode.begin() + 1, "highp vec3 N = _surface.normal;");
+        modifierCode.push_back("_ambient += irradiance;");
+        
+        sShadowCatcherSphericalHarmonicsModifier = std::make_shared<VROShaderModifier>(VROShaderEntryPoint::Fragment,
+                                                                                       modifierCode);
+        sShadowCatcherSphericalHarmonicsModifier->setName("catcher_sh");
+    }
+    return sShadowCatcherSphericalHarmonicsModifier;
+}
+
+std::shared_ptr<VROShaderModifier> VROShaderFactory::createPBRSphericalHarmonicsAndSpecularIrradianceFragmentModifier() {
+    if (!sPBRSphericalHarmonicsAndSpecularIrradianceFragmentModifier) {
+        std::vector<std::string> modifierCode = getSphericalHarmonicsIrradianceCode();
+        modifierCode.insert(modifierCode.end(), {
+                "const highp float MAX_REFLECTION_LOD = 4.0;",
+                "uniform samplerCube prefiltered_map;",
+                "uniform sampler2D brdf_map;",
+            
+                "highp vec3 ambient_kS = fresnel_schlick_roughness(max(dot(N, V), 0.0), F0, _surface.roughness);",
+                "highp vec3 ambient_kD = 1.0 - ambient_kS;",
+                "ambient_kD *= 1.0 - _surface.metalness;",
+            
+                // Specular is sampled from the prefiltered map exactly as in the irradiance map modifier
+                "highp vec3 n_cube = vec3(N.x, N.y, -N.z);",
+                "highp vec3 v_cube = vec3(vec3(V.x, V.y, -V.z));",
+                "highp vec3 R = reflect(-v_cube, n_cube); ",
+                "highp vec3 prefilteredColor = textureLod(prefiltered_map, R, _surface.roughness * MAX_REFLECTION_LOD).rgb;",
+                "highp vec2 brdf = texture(brdf_map, vec2(max(dot(N, V), 0.0), _surface.roughness)).xy;",
+                "highp vec3 ambient_specular = prefilteredColor * (ambient_kS * brdf.x + brdf.y);",
+            
+                "_ambient = (_ambient * albedo + ambient_kD * irradiance * albedo + ambient_specular) * _surface.ao;",
+                "_output_color = vec4(_ambient + _diffuse, _output_color.a);",
+        });
+        sPBRSphericalHarmonicsAndSpecularIrradianceFragmentModifier = std::make_shared<VROShaderModifier>(VROShaderEntryPoint::Fragment,
+                                                                                                          modifierCode);
+        sPBRSphericalHarmonicsAndSpecularIrradianceFragmentModifier->setName("pbr_sh_ibl");
+    }
+    return sPBRSphericalHarmonicsAndSpecularIrradianceFragmentModifier;
+}
+
 #pragma mark - Other Modifiers
 
 std::shared_ptr<VROShaderModifier> VROShaderFactory::createStereoTextureModifier(VROStereoMode currentStereoMode) {
@@ -803,6 +1215,24 @@ std::shared_ptr<VROShaderModifier> VROShaderFactory::createStereoTextureModifier
     return modifier;
 }
 
+std::shared_ptr<VROShaderModifier> VROShaderFactory::createEquirectangularTextureModifier() {
+    /*
+     Modifier that derives the diffuse texture coordinates from the direction to the
+     surface position, using the same equirectangular mapping as VROSphere.
+     */
+    if (!sEquirectangularTextureModifier) {
+        std::vector<std::string> surfaceModifierCode = {
+            "highp vec3 equirect_ray = normalize(_surface.position);",
+            "_surface.diffuse_texcoord = vec2(fract(1.0 - atan(equirect_ray.z, -equirect_ray.x) / 6.28318530718),",
+            "                                 acos(clamp(equirect_ray.y, -1.0, 1.0)) / 3.14159265359);",
+        };
+        sEquirectangularTextureModifier = std::make_shared<VROShaderModifier>(VROShaderEntryPoint::Surface,
+                                                                              surfaceModifierCode);
+        sEquirectangularTextureModifier->setName("equirect");
+    }
+    return sEquirectangularTextureModifier;
+}
+
 std::shared_ptr<VROShaderModifier> VROShaderFactory::createTextTextureModifier() {
     /*
      Modifier that samples an RG texture, and applies the 'R' to the R, G, and B
@@ -927,6 +1357,66 @@ std::shared_ptr<VROShaderModifier> VROShaderFactory::createChromaKeyModifier(int
     return modifier;
 }
 
+std::shared_ptr<VROShaderModifier> VROShaderFactory::createCrossfadeModifier(bool diffuseTexture, bool linearizeColor) {
+    /*
+     Modifier that blends the diffuse contents of a material's outgoing material into
+     its own, so that a material transition renders in one draw. The remaining
+     surface properties of the two materials are identical (see
+     VROMaterial::isCrossfadableWith).
+     */
+    std::tuple<bool, bool> key = std::tuple<bool, bool>(diffuseTexture, linearizeColor);
+    auto it = sCrossfadeModifiers.find(key);
+    if (it != sCrossfadeModifiers.end()) {
+        return it->second;
+    }
+    
+    std::vector<std::string> modifierCode = {
+        "uniform lowp float crossfade_weight;",
+        "uniform lowp vec4 crossfade_diffuse_surface_color;",
+        "uniform lowp float crossfade_diffuse_intensity;",
+    };
+    if (diffuseTexture) {
+        modifierCode.push_back("uniform sampler2D crossfade_diffuse_texture;");
+        modifierCode.push_back("lowp vec4 crossfade_diffuse_color = crossfade_diffuse_surface_color * texture(crossfade_diffuse_texture, _surface.diffuse_texcoord);");
+    }
+    else {
+        modifierCode.push_back("lowp vec4 crossfade_diffuse_color = crossfade_diffuse_surface_color;");
+    }
+    modifierCode.push_back("_surface.diffuse_color = mix(crossfade_diffuse_color, _surface.diffuse_color, crossfade_weight);");
+    modifierCode.push_back("_surface.diffuse_intensity = mix(crossfade_diffuse_intensity, _surface.diffuse_intensity, crossfade_weight);");
+    
+    std::shared_ptr<VROShaderModifier> modifier = std::make_shared<VROShaderModifier>(VROShaderEntryPoint::Surface,
+                                                                                      modifierCode);
+    modifier->setUniformBinder("crossfade_weight", VROShaderProperty::Float,
+                               [](VROUniform *uniform,
+                                  const VROGeometry *geometry,
+                                  const VROMaterial *material) {
+        uniform->setFloat(material->getCrossfadeWeight());
+    });
+    modifier->setUniformBinder("crossfade_diffuse_surface_color", VROShaderProperty::Vec4,
+                               [linearizeColor](VROUniform *uniform,
+                                                const VROGeometry *geometry,
+                                                const VROMaterial *material) {
+        const std::shared_ptr<VROMaterial> &outgoing = material->getOutgoing();
+        VROVector4f color = outgoing ? outgoing->getDiffuse().getColor() : material->getDiffuse().getColor();
+        if (linearizeColor) {
+            color = VROMathConvertSRGBToLinearColor(color);
+        }
+        uniform->setVec4(color);
+    });
+    modifier->setUniformBinder("crossfade_diffuse_intensity", VROShaderProperty::Float,
+                               [](VROUniform *uniform,
+                                  const VROGeometry *geometry,
+                                  const VROMaterial *material) {
+        const std::shared_ptr<VROMaterial> &outgoing = material->getOutgoing();
+        uniform->setFloat(outgoing ? outgoing->getDiffuse().getIntensity() : material->getDiffuse().getIntensity());
+    });
+    modifier->setName("crossfade");
+
+    sCrossfadeModifiers[key] = modifier;
+    return modifier;
+}
+
 std::shared_ptr<VROShaderModifier> VROShaderFactory::createPostProcessMaskModifier() {
     if (!sPostProcesMaskModifier) {
         std::vector<std::string> modifierCode =  {
@@ -1061,6 +1551,37 @@ std::shared_ptr<VROShaderModifier> VROShaderFactory::createToneMappingMaskModifi
     return sToneMappingMaskModifier;
 }
 
+std::shared_ptr<VROShaderModifier> VROShaderFactory::createWeightedTransparencyModifier() {
+    /*
+     Modifier that writes a fragment into the weighted blended order independent
+     transparency targets (McGuire and Bavoil, 2013). Each fragment is weighted by its
+     alpha and by its depth, so that nearer surfaces dominate, which lets the sum of the
+     weighted colors approximate back to front blending in any order. The color output
+     accumulates the weighted color and the revealage (the product of 1 - alpha), via
+     VROBlendMode::WeightedTransparency. The weight output accumulates the weights, and
+     the weighted tone mapping mask, which VROToneMappingRenderPass uses to resolve
+     the average transparent color over the opaque image.
+     */
+    if (!sWeightedTransparencyModifier) {
+        std::vector<std::string> modifierCode =  {
+            "layout (location = 1) out highp vec4 _transparency_weight;",
+            "uniform lowp float tone_mapped;",
+            "highp float oit_depth = 1.0 - gl_FragCoord.z;",
+            "highp float oit_weight = clamp(_output_color.a * max(1e-2, 3e3 * oit_depth * oit_depth * oit_depth), 1e-2, 3e3);",
+            "_transparency_weight = vec4(oit_weight, oit_weight * tone_mapped, 0.0, 0.0);",
+            "_output_color = vec4(_output_color.rgb * oit_weight, _output_color.a);"
+        };
+        sWeightedTransparencyModifier = std::make_shared<VROShaderModifier>(VROShaderEntryPoint::Fragment, modifierCode);
+        sWeightedTransparencyModifier->setUniformBinder("tone_mapped", VROShaderProperty::Float,
+                                                        [](VROUniform *uniform,
+                                                           const VROGeometry *geometry, const VROMaterial *material) {
+            uniform->setFloat(material->needsToneMapping() ? 1.0 : 0.0);
+        });
+        sWeightedTransparencyModifier->setName("oit");
+    }
+    return sWeightedTransparencyModifier;
+}
+
 std::vector<std::string> VROShaderFactory::createColorLinearizationCode() {
     std::vector<std::string> code = {
         /*
@@ -28,9 +28,12 @@
 #define VROShaderFactory_h
 
 #include <map>
+#include <set>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <memory>
+#include "VROShaderCapabilities.h"
 
 class VROShaderProgram;
 class VROFrameTimer;
@@ -41,10 +44,6 @@ class VRODriverOpenGL;
 class VROVector3f;
 enum class VROStereoMode;
 
-struct VROMaterialShaderCapabilities;
-struct VROLightingShaderCapabilities;
-struct VROShaderCapabilities;
-
 /*
  The VROShaderFactory creates and caches VROShaderPrograms.
  */
@@ -62,6 +61,14 @@ public:
      */
     bool purgeUnusedShaders(const VROFrameTimer &timer, bool force);
     
+    /*
+     Release the prewarmed programs that have not yet been used, so that they
+     can be purged. Invoked under memory pressure.
+     */
+    void releasePrewarmedShaders() {
+        _prewarmedPrograms.clear();
+    }
+    
     /*
      Retrieve a shader that has the given material and lighting capabilities.
      If the shader is not cached, it will be created. The modifiers are required
@@ -71,9 +78,64 @@ public:
                                                 VROLightingShaderCapabilities lightingCapabilities,
                                                 const std::vector<std::shared_ptr<VROShaderModifier>> &modifiers,
                                                 std::shared_ptr<VRODriverOpenGL> &driver);
+
+    /*
+     Queue shaders with the given capabilities to be built ahead of time, so
+     that the first frame rendering a material that requires them does not
+     stall on compilation. Shaders are built incrementally, with whatever time
+     remains at the end of each frame. Capabilities that depend on custom
+     shader modifiers cannot be prewarmed, and are skipped.
+     */
+    void prewarmShaders(const std::vector<VROShaderCapabilities> &capabilities);
+
+    /*
+     Build and hydrate queued prewarm shaders until running out of frame time.
+     Returns true if no prewarm shaders remain queued.
+     */
+    bool hydratePrewarmShaders(const VROFrameTimer &timer, std::shared_ptr<VRODriverOpenGL> &driver);
+    
+    /*
+     Get a manifest of the capabilities of every shader this factory has built
+     (excluding those with custom modifiers), one per line. Apps record it on a
+     representative run, ship it with their assets, and pass it to
+     prewarmShaders(manifest) at launch, so that shader assembly and compilation
+     (or, with the binary cache, loading) happen ahead of first use. May be
+     invoked from any thread.
+     */
+    std::string getShaderManifest() const;
+    
+    /*
+     Queue the shaders listed in the given manifest to be prewarmed. Lines that
+     are malformed or from an incompatible version are skipped.
+     */
+    void prewarmShaders(const std::string &manifest);
+
+    /*
+     True if any prewarm shaders remain queued, or any cached shader is still
+     compiling.
+     */
+    bool hasPendingShaders() const;
     
 private:
     
+    /*
+     Capabilities queued via prewarmShaders that have not yet been built.
+     */
+    std::vector<VROShaderCapabilities> _pendingPrewarm;
+    
+    /*
+     The capabilities of every shader built by this factory, for getShaderManifest.
+     Guarded by the mutex, since the manifest may be read off the rendering thread.
+     */
+    std::set<VROShaderCapabilities> _builtCapabilities;
+    mutable std::mutex _builtCapabilitiesMutex;
+
+    /*
+     Prewarmed programs are retained here so they survive purgeUnusedShaders
+     before their first use.
+     */
+    std::vector<std::shared_ptr<VROShaderProgram>> _prewarmedPrograms;
+    
     /*
      Shader programs cached by their capabilities.
      */
@@ -87,6 +149,10 @@ private:
                                                   std::shared_ptr<VRODriverOpenGL> &driver);
     
     std::shared_ptr<VROShaderModifier> createDiffuseTextureModifier();
+    std::shared_ptr<VROShaderModifier> createDiffuseTextureArrayGeometryModifier();
+    std::shared_ptr<VROShaderModifier> createDiffuseTextureArrayModifier();
+    std::shared_ptr<VROShaderModifier> createDiffuseTextureAtlasGeometryModifier();
+    std::shared_ptr<VROShaderModifier> createDiffuseTextureAtlasModifier();
     std::shared_ptr<VROShaderModifier> createSpecularTextureModifier();
     std::shared_ptr<VROShaderModifier> createNormalMapTextureModifier();
     std::shared_ptr<VROShaderModifier> createReflectiveTextureModifier();
@@ -101,21 +167,30 @@ private:
     std::shared_ptr<VROShaderModifier> createShadowMapGeometryModifier();
     std::shared_ptr<VROShaderModifier> createShadowMapLightModifier();
     std::shared_ptr<VROShaderModifier> createShadowMapFragmentModifier();
+    
+    std::shared_ptr<VROShaderModifier> createClusteredLightingModifier();
 
     std::shared_ptr<VROShaderModifier> createPBRSurfaceModifier();
     std::shared_ptr<VROShaderModifier> createPBRDirectLightingModifier();
     std::shared_ptr<VROShaderModifier> createPBRConstantAmbientFragmentModifier();
     std::shared_ptr<VROShaderModifier> createPBRDiffuseIrradianceFragmentModifier();
     std::shared_ptr<VROShaderModifier> createPBRDiffuseAndSpecularIrradianceFragmentModifier();
+    std::shared_ptr<VROShaderModifier> createPBRSphericalHarmonicsIrradianceFragmentModifier();
+    std::shared_ptr<VROShaderModifier> createPBRSphericalHarmonicsAndSpecularIrradianceFragmentModifier();
+    std::shared_ptr<VROShaderModifier> createShadowCatcherIrradianceModifier();
+    std::shared_ptr<VROShaderModifier> createShadowCatcherSphericalHarmonicsModifier();
 
     std::shared_ptr<VROShaderModifier> createTextTextureModifier();
     std::shared_ptr<VROShaderModifier> createYCbCrTextureModifier(bool linearizeColor);
     std::shared_ptr<VROShaderModifier> createEGLImageModifier(bool linearizeColor);
     std::shared_ptr<VROShaderModifier> createChromaKeyModifier(int r, int g, int b);
+    std::shared_ptr<VROShaderModifier> createCrossfadeModifier(bool diffuseTexture, bool linearizeColor);
     std::shared_ptr<VROShaderModifier> createStereoTextureModifier(VROStereoMode currentStereoMode);
+    std::shared_ptr<VROShaderModifier> createEquirectangularTextureModifier();
     std::shared_ptr<VROShaderModifier> createBloomModifier();
     std::shared_ptr<VROShaderModifier> createPostProcessMaskModifier();
     std::shared_ptr<VROShaderModifier> createToneMappingMaskModifier();
+    std::shared_ptr<VROShaderModifier> createWeightedTransparencyModifier();
     std::vector<std::string> createColorLinearizationCode();
     
 };
@@ -34,9 +34,12 @@
 #include "VROPlatformUtil.h"
 #include "VROGeometryUtil.h"
 #include "VROAllocationTracker.h"
+#include "VROShaderBinaryCache.h"
 #include "VROBoneUBO.h"
 #include "VROStringUtil.h"
 #include "VRODriverOpenGL.h"
+#include "VROProfiler.h"
+#include "VROSphericalHarmonics.h"
 #include <atomic>
 
 #define kDebugShaders 0
@@ -68,12 +71,25 @@ VROShaderProgram::VROShaderProgram(std::string vertexShader, std::string fragmen
     _bonesBlockIndex(GL_INVALID_INDEX),
     _particlesVertexBlockIndex(GL_INVALID_INDEX),
     _particlesFragmentBlockIndex(GL_INVALID_INDEX),
+    _instancedTransformsBlockIndex(GL_INVALID_INDEX),
+    _clusteredLightingBlockIndex(GL_INVALID_INDEX),
+    _clusterHeadersBlockIndex(GL_INVALID_INDEX),
+    _clusterIndicesBlockIndex(GL_INVALID_INDEX),
+    _gpuParticlesBlockIndex(GL_INVALID_INDEX),
+    _gpuParticleEmitterBlockIndex(GL_INVALID_INDEX),
+    _cameraBlockIndex(GL_INVALID_INDEX),
+    _drawBlockIndex(GL_INVALID_INDEX),
     _attributes(attributes),
     _uniformsNeedRebind(true),
     _shaderName(fragmentShader),
     _program(0),
     _failedToLink(false),
+    _linkPending(false),
+    _pendingVertexShader(0),
+    _pendingFragmentShader(0),
     _samplers(samplers),
+    _numViews(1),
+    _drawID(false),
     _driver(driver) {
     
     if (VROStringUtil::endsWith(fragmentShader, "_fsh")) {
@@ -145,6 +161,7 @@ VROShaderProgram::~VROShaderProgram() {
     for (VROUniform *uniform : _uniforms) {
         delete (uniform);
     }
+    deletePendingShaders();
 
     // Ensure we are deleting GL objects with the current GL context
     std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
@@ -164,6 +181,10 @@ VROShaderProgram::~VROShaderProgram() {
 #pragma mark Compiling and Linking
 
 bool VROShaderProgram::hydrate() {
+    // If an asynchronous link is in flight, block until it completes
+    if (_linkPending) {
+        return completeLink();
+    }
     passert (_program == 0);
 
 #if kDebugShaders
@@ -179,7 +200,7 @@ bool VROShaderProgram::hydrate() {
     // later. Note we only retry because of driver bugs: specifically, the Adreno 530 fails
     // to link with multiple render targets something around 50% of the time. Retrying fixes
     // the issue.
-    if (!compileAndLink()) {
+    if (!compileAndLink(false)) {
         _failedToLink = true;
         return false;
     } else {
@@ -188,11 +209,51 @@ bool VROShaderProgram::hydrate() {
     return true;
 }
 
+bool VROShaderProgram::hydrateAsync() {
+    std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
+    if (!driver || !driver->isParallelShaderCompileSupported()) {
+        return hydrate();
+    }
+
+    // Poll the in-flight link; querying GL_COMPLETION_STATUS_KHR never blocks
+    if (_linkPending) {
+        GLint complete = GL_FALSE;
+        GL( glGetProgramiv(_program, GL_COMPLETION_STATUS_KHR, &complete) );
+        if (complete == GL_FALSE) {
+            return false;
+        }
+        return completeLink();
+    }
+    passert (_program == 0);
+
+#if kDebugShaders
+    if (!_shaderName.empty()) {
+        pinfo("Compiling shader [%s] asynchronously", _shaderName.c_str());
+    }
+    else {
+        pinfo("Compiling anonymous shader asynchronously");
+    }
+#endif
+
+    if (!compileAndLink(true)) {
+        _failedToLink = true;
+        return false;
+    } else {
+        _failedToLink = false;
+    }
+    return isHydrated();
+}
+
 bool VROShaderProgram::isHydrated() const {
-    return _program != 0 && !_failedToLink;
+    return _program != 0 && !_failedToLink && !_linkPending;
+}
+
+bool VROShaderProgram::isHydrating() const {
+    return _linkPending;
 }
 
 void VROShaderProgram::evict() {
+    deletePendingShaders();
     if (_program != 0) {
         std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
         if (driver) {
@@ -207,33 +268,41 @@ void VROShaderProgram::evict() {
     _program = 0;
 }
 
-bool VROShaderProgram::compileShader(GLuint *shader, GLenum type, const char *source) {
-    GLint status;
+bool VROShaderProgram::compileShader(GLuint *shader, GLenum type, const char *source, bool checkStatus) {
     int len = (int) strlen(source);
 
     *shader = GL( glCreateShader(type) );
     GL( glShaderSource(*shader, 1, &source, &len) );
     GL( glCompileShader(*shader) );
 
-    GL( glGetShaderiv(*shader, GL_COMPILE_STATUS, &status) );
+    // Querying the compile status blocks until compilation completes, so
+    // asynchronous compiles defer the check until the program is linked
+    if (!checkStatus) {
+        return true;
+    }
+    if (!checkCompileStatus(*shader)) {
+        GL( glDeleteShader(*shader) );
+        return false;
+    }
+    return true;
+}
+
+bool VROShaderProgram::checkCompileStatus(GLuint shader) {
+    GLint status;
+    GL( glGetShaderiv(shader, GL_COMPILE_STATUS, &status) );
     if (status == 0) {
         GLint logLength;
-        GL( glGetShaderInfoLog(*shader, shaderMaxLogLength, &logLength, shaderLog) );
+        GL( glGetShaderInfoLog(shader, shaderMaxLogLength, &logLength, shaderLog) );
         if (logLength > 1) { // when there are no logs we have just a '\n', don't print that out
             perr("Shader compile log:\n%s", shaderLog);
         }
-
-        GL( glDeleteShader(*shader) );
         return false;
     }
-
     return true;
 }
 
-bool VROShaderProgram::linkProgram(GLuint prog) {
+bool VROShaderProgram::checkLinkStatus(GLuint prog) {
     GLint status;
-    GL( glLinkProgram(prog) );
-
     GL( glGetProgramiv(prog, GL_LINK_STATUS, &status) );
     if (status == 0) {
         GLint logLength;
@@ -266,7 +335,7 @@ bool VROShaderProgram::validateProgram(GLuint prog) {
     return true;
 }
 
-bool VROShaderProgram::compileAndLink() {
+bool VROShaderProgram::compileAndLink(bool async) {
     GLuint vertShader, fragShader;
     _program = GL( glCreateProgram() );
 
@@ -290,13 +359,32 @@ bool VROShaderProgram::compileAndLink() {
     }
 #endif
 
-    /*
-     Compile and attach the shaders to the program.
-     */
     passert (!_vertexSource.empty());
     passert (!_fragmentSource.empty());
 
-    if (!compileShader(&vertShader, GL_VERTEX_SHADER, _vertexSource.c_str())) {
+#if VRO_SUPPORTS_PROGRAM_BINARY
+    /*
+     If this program was linked during a previous session, load its binary
+     directly and skip compilation altogether.
+     */
+    std::shared_ptr<VROShaderBinaryCache> binaryCache;
+    std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
+    if (driver) {
+        binaryCache = driver->getShaderBinaryCache();
+    }
+    if (binaryCache && binaryCache->load(_vertexSource, _fragmentSource, _program)) {
+#if kDebugShaders
+        pinfo("Loaded shader %s from binary cache", _shaderName.c_str());
+#endif
+        return true;
+    }
+#endif
+
+    /*
+     Compile and attach the shaders to the program.
+     */
+    VRO_PROFILE_COUNT(ShaderCompiles, 1);
+    if (!compileShader(&vertShader, GL_VERTEX_SHADER, _vertexSource.c_str(), !async)) {
         pwarn("Failed to compile vertex shader \"%s\" with code:\n",
                _shaderName.c_str());
         VROStringUtil::printCode(_vertexSource);
@@ -304,7 +392,7 @@ bool VROShaderProgram::compileAndLink() {
         return false;
     }
 
-    if (!compileShader(&fragShader, GL_FRAGMENT_SHADER, _fragmentSource.c_str())) {
+    if (!compileShader(&fragShader, GL_FRAGMENT_SHADER, _fragmentSource.c_str(), !async)) {
         pwarn("Failed to compile fragment shader \"%s\" with code:\n",
                _shaderName.c_str());
         VROStringUtil::printCode(_fragmentSource);
@@ -320,10 +408,72 @@ bool VROShaderProgram::compileAndLink() {
      */
     bindAttributes();
 
+#if VRO_SUPPORTS_PROGRAM_BINARY
+    if (binaryCache) {
+        GL( glProgramParameteri(_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE) );
+    }
+#endif
+
+    /*
+     Declare the outputs captured by transform feedback, which must be
+     set before linking.
+     */
+    if (!_transformFeedbackVaryings.empty()) {
+        std::vector<const char *> varyings;
+        for (const std::string &varying : _transformFeedbackVaryings) {
+            varyings.push_back(varying.c_str());
+        }
+        GL( glTransformFeedbackVaryings(_program, (GLsizei) varyings.size(), varyings.data(), GL_INTERLEAVED_ATTRIBS) );
+    }
+
     /*
-     Link the program.
+     Link the program. When linking asynchronously, the driver compiles and
+     links on its own threads; we finish up once it reports completion.
      */
-    if (!linkProgram(_program)) {
+    GL( glLinkProgram(_program) );
+    if (async) {
+        _pendingVertexShader = vertShader;
+        _pendingFragmentShader = fragShader;
+        _linkPending = true;
+        return true;
+    }
+    return finishLink(vertShader, fragShader, false);
+}
+
+bool VROShaderProgram::completeLink() {
+    GLuint vertShader = _pendingVertexShader;
+    GLuint fragShader = _pendingFragmentShader;
+    _pendingVertexShader = 0;
+    _pendingFragmentShader = 0;
+    _linkPending = false;
+
+    if (!finishLink(vertShader, fragShader, true)) {
+        _failedToLink = true;
+        return false;
+    } else {
+        _failedToLink = false;
+    }
+    return true;
+}
+
+bool VROShaderProgram::finishLink(GLuint vertShader, GLuint fragShader, bool async) {
+    if (!checkLinkStatus(_program)) {
+        // Asynchronous compiles skipped the compile status check, so perform it now
+        if (async) {
+            if (!checkCompileStatus(vertShader)) {
+                pwarn("Failed to compile vertex shader \"%s\" with code:\n",
+                      _shaderName.c_str());
+                VROStringUtil::printCode(_vertexSource);
+                pabort("Failed to compile vertex shader %s", _shaderName.c_str());
+            }
+            if (!checkCompileStatus(fragShader)) {
+                pwarn("Failed to compile fragment shader \"%s\" with code:\n",
+                      _shaderName.c_str());
+                VROStringUtil::printCode(_fragmentSource);
+                pabort("Failed to compile fragment shader %s", _shaderName.c_str());
+            }
+        }
+
         pinfo("Failed to link program %d, name %s", _program, _shaderName.c_str());
         if (vertShader) {
             GL( glDeleteShader(vertShader) );
@@ -351,6 +501,14 @@ bool VROShaderProgram::compileAndLink() {
         GL( glDeleteShader(fragShader) );
     }
 
+#if VRO_SUPPORTS_PROGRAM_BINARY
+    std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
+    std::shared_ptr<VROShaderBinaryCache> binaryCache = driver ? driver->getShaderBinaryCache() : nullptr;
+    if (binaryCache) {
+        binaryCache->store(_vertexSource, _fragmentSource, _program);
+    }
+#endif
+
 #if kDebugShaders
     pinfo("Finished compiling shader %s", _shaderName.c_str());
 #endif
@@ -358,6 +516,20 @@ bool VROShaderProgram::compileAndLink() {
     return true;
 }
 
+void VROShaderProgram::deletePendingShaders() {
+    if (!_linkPending) {
+        return;
+    }
+    std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
+    if (driver) {
+        GL( glDeleteShader(_pendingVertexShader) );
+        GL( glDeleteShader(_pendingFragmentShader) );
+    }
+    _pendingVertexShader = 0;
+    _pendingFragmentShader = 0;
+    _linkPending = false;
+}
+
 bool VROShaderProgram::bind() {
     if (_failedToLink) {
         return false;
@@ -438,6 +610,9 @@ void VROShaderProgram::addModifierUniforms() {
 
 void VROShaderProgram::bindAttributes() {
     GL( glBindAttribLocation(_program, (int)VROGeometrySourceSemantic::Vertex, "position") );
+    if (_drawID) {
+        GL( glBindAttribLocation(_program, kDrawIDAttributeIndex, "draw_id") );
+    }
     
     if ((_attributes & (int)VROShaderMask::Tex) != 0) {
         GL( glBindAttribLocation(_program, VROGeometryUtilParseAttributeIndex(VROGeometrySourceSemantic::Texcoord), "texcoord") );
@@ -494,10 +669,19 @@ void VROShaderProgram::bindUniformBlocks() {
         GL( glUniformBlockBinding(_program, _lightingVertexBlockIndex, sLightingVertexUBOBindingPoint) );
     }
     
-    _bonesBlockIndex = GL( glGetUniformBlockIndex(_program, kDualQuaternionEnabled ? "bones_dq" : "bones") );
+    // The matrix and dual-quaternion bone blocks are two views of the same bone UBO,
+    // so both are linked to the bones binding point
+    _bonesBlockIndex = GL( glGetUniformBlockIndex(_program, "bones") );
     if (_bonesBlockIndex != GL_INVALID_INDEX) {
         GL( glUniformBlockBinding(_program, _bonesBlockIndex, sBonesUBOBindingPoint) );
     }
+    GLuint bonesDualQuaternionBlockIndex = GL( glGetUniformBlockIndex(_program, "bones_dq") );
+    if (bonesDualQuaternionBlockIndex != GL_INVALID_INDEX) {
+        GL( glUniformBlockBinding(_program, bonesDualQuaternionBlockIndex, sBonesUBOBindingPoint) );
+        if (_bonesBlockIndex == GL_INVALID_INDEX) {
+            _bonesBlockIndex = bonesDualQuaternionBlockIndex;
+        }
+    }
     
     _particlesVertexBlockIndex = GL( glGetUniformBlockIndex(_program, "particles_vertex_data") );
     if (_particlesVertexBlockIndex != GL_INVALID_INDEX) {
@@ -507,6 +691,38 @@ void VROShaderProgram::bindUniformBlocks() {
     if (_particlesFragmentBlockIndex != GL_INVALID_INDEX) {
         GL( glUniformBlockBinding(_program, _particlesFragmentBlockIndex, sParticleFragmentUBOBindingPoint) );
     }
+    _instancedTransformsBlockIndex = GL( glGetUniformBlockIndex(_program, "instanced_transforms_data") );
+    if (_instancedTransformsBlockIndex != GL_INVALID_INDEX) {
+        GL( glUniformBlockBinding(_program, _instancedTransformsBlockIndex, sInstancedTransformsUBOBindingPoint) );
+    }
+    _clusteredLightingBlockIndex = GL( glGetUniformBlockIndex(_program, "clustered_lighting") );
+    if (_clusteredLightingBlockIndex != GL_INVALID_INDEX) {
+        GL( glUniformBlockBinding(_program, _clusteredLightingBlockIndex, sClusteredLightingUBOBindingPoint) );
+    }
+    _clusterHeadersBlockIndex = GL( glGetUniformBlockIndex(_program, "cluster_headers_data") );
+    if (_clusterHeadersBlockIndex != GL_INVALID_INDEX) {
+        GL( glUniformBlockBinding(_program, _clusterHeadersBlockIndex, sClusterHeadersUBOBindingPoint) );
+    }
+    _clusterIndicesBlockIndex = GL( glGetUniformBlockIndex(_program, "cluster_indices_data") );
+    if (_clusterIndicesBlockIndex != GL_INVALID_INDEX) {
+        GL( glUniformBlockBinding(_program, _clusterIndicesBlockIndex, sClusterIndicesUBOBindingPoint) );
+    }
+    _gpuParticlesBlockIndex = GL( glGetUniformBlockIndex(_program, "gpu_particles_data") );
+    if (_gpuParticlesBlockIndex != GL_INVALID_INDEX) {
+        GL( glUniformBlockBinding(_program, _gpuParticlesBlockIndex, sGPUParticlesUBOBindingPoint) );
+    }
+    _gpuParticleEmitterBlockIndex = GL( glGetUniformBlockIndex(_program, "gpu_particle_emitter_data") );
+    if (_gpuParticleEmitterBlockIndex != GL_INVALID_INDEX) {
+        GL( glUniformBlockBinding(_program, _gpuParticleEmitterBlockIndex, sGPUParticleEmitterUBOBindingPoint) );
+    }
+    _cameraBlockIndex = GL( glGetUniformBlockIndex(_program, "camera_data") );
+    if (_cameraBlockIndex != GL_INVALID_INDEX) {
+        GL( glUniformBlockBinding(_program, _cameraBlockIndex, sCameraUBOBindingPoint) );
+    }
+    _drawBlockIndex = GL( glGetUniformBlockIndex(_program, "draw_data") );
+    if (_drawBlockIndex != GL_INVALID_INDEX) {
+        GL( glUniformBlockBinding(_program, _drawBlockIndex, sDrawUBOBindingPoint) );
+    }
 }
 
 void VROShaderProgram::addStandardUniforms() {
@@ -527,6 +743,97 @@ void VROShaderProgram::addStandardUniforms() {
     addUniform(VROShaderProperty::Float, 1, "material_metalness");
     addUniform(VROShaderProperty::Float, 1, "material_metalness_intensity");
     addUniform(VROShaderProperty::Float, 1, "material_ao");
+    
+    addUniform(VROShaderProperty::Vec3, kSphericalHarmonicsCoefficients, "sh_coefficients");
+}
+
+#pragma mark - Multiview
+
+void VROShaderProgram::enableMultiview(int numViews) {
+    passert (!isHydrated());
+    _numViews = numViews;
+
+    std::string version = "#version 300 es";
+    std::string views = VROStringUtil::toString(numViews);
+    inject(version, version + "\n#extension GL_OVR_multiview2 : require\nlayout(num_views = " + views + ") in;",
+           _vertexSource);
+
+    /*
+     The standard matrix uniforms are aliased to the current view's entry, so that
+     the base shaders and modifiers read them unchanged.
+     */
+    VROStringUtil::replaceAll(_vertexSource, "uniform mat4 view_matrix;",
+                              "uniform mat4 view_matrices[" + views + "];\n"
+                              "#define view_matrix view_matrices[gl_ViewID_OVR]");
+    VROStringUtil::replaceAll(_vertexSource, "uniform mat4 projection_matrix;",
+                              "uniform mat4 projection_matrices[" + views + "];\n"
+                              "#define projection_matrix projection_matrices[gl_ViewID_OVR]");
+
+    /*
+     Stereo texture modifiers select their half of the texture with eye_type in the
+     fragment shader; pass the view index through from the vertex shader instead.
+     */
+    std::string eyeTypeUniform = "uniform highp float eye_type;";
+    if (_fragmentSource.find(eyeTypeUniform) != std::string::npos) {
+        VROStringUtil::replaceAll(_fragmentSource, eyeTypeUniform,
+                                  "flat in highp float v_eye_type;\n#define eye_type v_eye_type");
+        inject("void main() {", "flat out highp float v_eye_type;\n\n"
+                                "void main() {\n"
+                                "    v_eye_type = float(gl_ViewID_OVR);", _vertexSource);
+    }
+
+    for (int i = 0; i < numViews; i++) {
+        std::string index = "[" + VROStringUtil::toString(i) + "]";
+        addUniform(VROShaderProperty::Mat4, 1, "view_matrices" + index);
+        addUniform(VROShaderProperty::Mat4, 1, "projection_matrices" + index);
+    }
+}
+
+#pragma mark - Uniform Ring
+
+void VROShaderProgram::enableUniformRing() {
+    passert (!isHydrated());
+    passert (!isMultiview());
+    
+    /*
+     Both stages declare the full camera block, so its member precisions must
+     match. The layouts should match VROCameraUBOData and VRODrawUBOData in
+     VROUniformRingBuffer.h.
+     */
+    std::string cameraBlock = "layout (std140) uniform camera_data {\n"
+                              "    highp mat4 view_matrix;\n"
+                              "    highp mat4 projection_matrix;\n"
+                              "    highp vec3 camera_position;\n"
+                              "};";
+    std::string drawBlock = "layout (std140) uniform draw_data {\n"
+                            "    highp mat4 model_matrix;\n"
+                            "    highp mat4 normal_matrix;\n"
+                            "};";
+    
+    if (_vertexSource.find("uniform mat4 model_matrix;") != std::string::npos &&
+        _vertexSource.find("uniform mat4 normal_matrix;") != std::string::npos) {
+        VROStringUtil::replaceAll(_vertexSource, "uniform mat4 normal_matrix;", "");
+        VROStringUtil::replaceAll(_vertexSource, "uniform mat4 model_matrix;", drawBlock);
+    }
+    if (_vertexSource.find("uniform mat4 view_matrix;") != std::string::npos &&
+        _vertexSource.find("uniform mat4 projection_matrix;") != std::string::npos) {
+        VROStringUtil::replaceAll(_vertexSource, "uniform highp vec3 camera_position;", "");
+        VROStringUtil::replaceAll(_vertexSource, "uniform mat4 projection_matrix;", "");
+        VROStringUtil::replaceAll(_vertexSource, "uniform mat4 view_matrix;", cameraBlock);
+        VROStringUtil::replaceAll(_fragmentSource, "uniform highp vec3 camera_position;", cameraBlock);
+    }
+}
+
+void VROShaderProgram::enableDrawID() {
+    passert (!isHydrated());
+    if (_vertexSource.find("v_instance_id = gl_InstanceID;") == std::string::npos) {
+        return;
+    }
+    VROStringUtil::replaceAll(_vertexSource, "flat out int v_instance_id;",
+                              "flat out int v_instance_id;\nin highp int draw_id;");
+    VROStringUtil::replaceAll(_vertexSource, "v_instance_id = gl_InstanceID;",
+                              "v_instance_id = gl_InstanceID + draw_id;");
+    _drawID = true;
 }
 
 #pragma mark - Source Inflation and Shader Modifiers
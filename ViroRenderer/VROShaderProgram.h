@@ -81,6 +81,14 @@ public:
     static const int sBonesUBOBindingPoint = 2;
     static const int sParticleVertexUBOBindingPoint = 3;
     static const int sParticleFragmentUBOBindingPoint = 4;
+    static const int sInstancedTransformsUBOBindingPoint = 5;
+    static const int sClusteredLightingUBOBindingPoint = 6;
+    static const int sClusterHeadersUBOBindingPoint = 7;
+    static const int sClusterIndicesUBOBindingPoint = 8;
+    static const int sGPUParticlesUBOBindingPoint = 9;
+    static const int sGPUParticleEmitterUBOBindingPoint = 10;
+    static const int sCameraUBOBindingPoint = 11;
+    static const int sDrawUBOBindingPoint = 12;
 
     /*
      Create a new shader program with the given source. This constructor assumes that the
@@ -121,6 +129,16 @@ public:
     void evict();
     bool isHydrated() const;
 
+    /*
+     Non-blocking hydration. When the driver supports KHR_parallel_shader_compile,
+     the first call starts compiling and linking on the driver's threads, and
+     subsequent calls poll for completion; returns true once the program is ready.
+     Without the extension this is equivalent to hydrate(). isHydrating() returns
+     true while a link is in flight.
+     */
+    bool hydrateAsync();
+    bool isHydrating() const;
+
     /*
      Bind this shader program, or unbind any program. Returns false if the program was
      already bound.
@@ -188,6 +206,61 @@ public:
         return _particlesFragmentBlockIndex;
     }
 
+    bool hasInstancedTransformsBlock() const {
+        return _instancedTransformsBlockIndex != GL_INVALID_INDEX;
+    }
+    
+    bool hasClusteredLightingBlock() const {
+        return _clusteredLightingBlockIndex != GL_INVALID_INDEX;
+    }
+    
+    bool hasCameraBlock() const {
+        return _cameraBlockIndex != GL_INVALID_INDEX;
+    }
+    bool hasDrawBlock() const {
+        return _drawBlockIndex != GL_INVALID_INDEX;
+    }
+
+    /*
+     Move the standard transform uniforms into uniform blocks that are bound to
+     ranges of the driver's VROUniformRingBuffer: the model and normal matrices
+     into draw_data, and the view and projection matrices and camera position into
+     camera_data. Shaders and modifiers read the same names as before. Must be
+     invoked before hydration, and not combined with multiview.
+     */
+    void enableUniformRing();
+
+    /*
+     Offset the instance ID of this program (v_instance_id) by the draw_id
+     attribute, so that each command of a multi-draw reads its own
+     per-instance data. Arena VAOs feed draw_id from the base instance of each
+     command; draws that do not set it read zero, so regular draws and instanced
+     draws are unaffected. Must be invoked before hydration.
+     */
+    void enableDrawID();
+
+    /*
+     Convert this program to render numViews views in a single pass, using
+     OVR_multiview2. The view and projection matrices become the per-view uniform
+     arrays view_matrices and projection_matrices, indexed by gl_ViewID_OVR, and
+     eye_type is derived from the view being rendered. Must be invoked before
+     hydration.
+     */
+    void enableMultiview(int numViews);
+    bool isMultiview() const {
+        return _numViews > 1;
+    }
+
+    /*
+     Capture the given vertex shader outputs into the buffer bound to
+     GL_TRANSFORM_FEEDBACK_BUFFER, interleaved in the order given. Must be
+     invoked before hydration.
+     */
+    void setTransformFeedbackVaryings(const std::vector<std::string> &varyings) {
+        passert (!isHydrated());
+        _transformFeedbackVaryings = varyings;
+    }
+
     const std::vector<std::shared_ptr<VROShaderModifier>> &getModifiers() const {
         return _modifiers;
     }
@@ -233,6 +306,33 @@ private:
     GLuint _particlesVertexBlockIndex;
     GLuint _particlesFragmentBlockIndex;
 
+    /*
+     The uniform block for per-instance transforms, used by automatic instancing.
+     */
+    GLuint _instancedTransformsBlockIndex;
+    
+    /*
+     The uniform blocks for clustered forward lighting: the clustered lights,
+     the per-cluster headers, and the per-cluster light indices.
+     */
+    GLuint _clusteredLightingBlockIndex;
+    GLuint _clusterHeadersBlockIndex;
+    GLuint _clusterIndicesBlockIndex;
+    
+    /*
+     The uniform blocks for GPU-simulated particles: the spawn state of each
+     particle, and the emitter's transform and modifier curves.
+     */
+    GLuint _gpuParticlesBlockIndex;
+    GLuint _gpuParticleEmitterBlockIndex;
+    
+    /*
+     The uniform blocks for per-view and per-draw transforms, present when the
+     uniform ring is enabled.
+     */
+    GLuint _cameraBlockIndex;
+    GLuint _drawBlockIndex;
+
     /*
      The attributes supported by this shader, as defined by the VROShaderMask enum.
      */
@@ -265,6 +365,14 @@ private:
      */
     bool _failedToLink;
 
+    /*
+     True while an asynchronous link is in flight. The shaders are retained
+     until the link completes, so their compile logs can be read on failure.
+     */
+    bool _linkPending;
+    GLuint _pendingVertexShader;
+    GLuint _pendingFragmentShader;
+
     /*
      List of the names of all samplers used by this shader.
      */
@@ -275,6 +383,22 @@ private:
      */
     std::vector<std::shared_ptr<VROShaderModifier>> _modifiers;
 
+    /*
+     The number of views rendered by each draw call; greater than one for
+     multiview programs.
+     */
+    int _numViews;
+
+    /*
+     True if this program reads the draw_id attribute.
+     */
+    bool _drawID;
+
+    /*
+     The vertex outputs captured by transform feedback, if any.
+     */
+    std::vector<std::string> _transformFeedbackVaryings;
+
     /*
      Weak reference to the driver that created this program. The driver's lifecycle
      is tied to the parent EGL context, so we only delete GL objects if the driver
@@ -290,15 +414,20 @@ private:
     void addModifierUniforms();
 
     /*
-     Compile and link the shader. Returns true on success.
+     Compile and link the shader. Returns true on success. If async is true, the
+     link is left in flight and completed by completeLink().
      */
-    bool compileAndLink();
+    bool compileAndLink(bool async);
+    bool completeLink();
+    bool finishLink(GLuint vertShader, GLuint fragShader, bool async);
+    void deletePendingShaders();
 
     /*
      Compile, link, and validate the shader at the given path. Type indicates fragment or vertex.
      */
-    bool compileShader(GLuint *shader, GLenum type, const char *source);
-    bool linkProgram(GLuint prog);
+    bool compileShader(GLuint *shader, GLenum type, const char *source, bool checkStatus);
+    bool checkCompileStatus(GLuint shader);
+    bool checkLinkStatus(GLuint prog);
     bool validateProgram(GLuint prog);
 
     /*
@@ -0,0 +1,97 @@
+//
+//  VROShadowAtlas.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROShadowAtlas.h"
+#include "VROLog.h"
+#include <algorithm>
+
+// The smallest tile we allocate, as a fraction of the layer size
+static const int kMinShadowAtlasTileDivisor = 8;
+
+VROShadowAtlas::VROShadowAtlas() :
+    _layerSize(0),
+    _maxLayers(0) {
+    
+}
+
+VROShadowAtlas::~VROShadowAtlas() {
+    
+}
+
+void VROShadowAtlas::reset(int layerSize, int maxLayers) {
+    _layerSize = layerSize;
+    _maxLayers = maxLayers;
+    _freeTiles.clear();
+}
+
+bool VROShadowAtlas::allocate(int size, VROShadowAtlasTile *outTile) {
+    passert (_layerSize > 0);
+    
+    int tileSize = _layerSize;
+    int minTileSize = std::max(1, _layerSize / kMinShadowAtlasTileDivisor);
+    while (tileSize / 2 >= std::max(size, minTileSize)) {
+        tileSize /= 2;
+    }
+    
+    // Find the smallest free tile that fits, preferring lower layers
+    int bestLayer = -1;
+    int bestIndex = -1;
+    for (int layer = 0; layer < (int) _freeTiles.size(); layer++) {
+        const std::vector<VROShadowAtlasTile> &tiles = _freeTiles[layer];
+        for (int i = 0; i < (int) tiles.size(); i++) {
+            if (tiles[i].size >= tileSize && (bestLayer < 0 || tiles[i].size < _freeTiles[bestLayer][bestIndex].size)) {
+                bestLayer = layer;
+                bestIndex = i;
+            }
+        }
+    }
+    
+    // No room in the existing layers: open a new one
+    if (bestLayer < 0) {
+        if ((int) _freeTiles.size() >= _maxLayers) {
+            return false;
+        }
+        bestLayer = (int) _freeTiles.size();
+        bestIndex = 0;
+        _freeTiles.push_back({ { bestLayer, 0, 0, _layerSize } });
+    }
+    
+    std::vector<VROShadowAtlasTile> &tiles = _freeTiles[bestLayer];
+    VROShadowAtlasTile tile = tiles[bestIndex];
+    tiles.erase(tiles.begin() + bestIndex);
+    
+    // Split the tile into quadrants until it's the requested size, leaving the
+    // other three quadrants free at each level
+    while (tile.size > tileSize) {
+        int half = tile.size / 2;
+        tiles.push_back({ tile.layer, tile.x + half, tile.y,        half });
+        tiles.push_back({ tile.layer, tile.x,        tile.y + half, half });
+        tiles.push_back({ tile.layer, tile.x + half, tile.y + half, half });
+        tile.size = half;
+    }
+    
+    *outTile = tile;
+    return true;
+}
@@ -0,0 +1,105 @@
+//
+//  VROShadowAtlas.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROShadowAtlas_h
+#define VROShadowAtlas_h
+
+#include <vector>
+#include "VROViewport.h"
+
+/*
+ A square region of one layer of the shadow map texture array, to which a
+ single shadow map (or a single cascade of a cascaded shadow map) is rendered.
+ */
+struct VROShadowAtlasTile {
+    int layer;
+    int x, y;
+    int size;
+    
+    VROViewport getViewport() const {
+        return VROViewport(x, y, size, size);
+    }
+    bool operator==(const VROShadowAtlasTile &other) const {
+        return layer == other.layer && x == other.x && y == other.y && size == other.size;
+    }
+    bool operator!=(const VROShadowAtlasTile &other) const {
+        return !(*this == other);
+    }
+};
+
+/*
+ Packs shadow maps of varying sizes into the layers of the shadow map texture
+ array. Each layer is subdivided as a quadtree: a request is rounded down to
+ a power-of-two fraction of the layer size, and is given the smallest free tile
+ that fits it, splitting larger tiles into quadrants as needed. Shadow maps
+ requested at a fraction of the largest shadow map size therefore share a
+ layer, instead of each occupying (and being rendered and sampled at the size
+ of) a full layer.
+ 
+ Allocation is deterministic: the same sequence of requests always receives
+ the same tiles, so that cached shadow maps remain valid across frames.
+ */
+class VROShadowAtlas {
+public:
+    
+    VROShadowAtlas();
+    virtual ~VROShadowAtlas();
+    
+    /*
+     Free all tiles, and set the size of each layer and the maximum number of
+     layers that may be allocated.
+     */
+    void reset(int layerSize, int maxLayers);
+    
+    /*
+     Allocate a tile of the given size, which is clamped to the layer size and
+     rounded down to a power-of-two fraction of it. Returns false if no layer
+     has room for the tile.
+     */
+    bool allocate(int size, VROShadowAtlasTile *outTile);
+    
+    /*
+     Get the number of layers holding at least one tile.
+     */
+    int getNumLayers() const {
+        return (int) _freeTiles.size();
+    }
+    int getLayerSize() const {
+        return _layerSize;
+    }
+    
+private:
+    
+    int _layerSize;
+    int _maxLayers;
+    
+    /*
+     The free tiles of each layer in use.
+     */
+    std::vector<std::vector<VROShadowAtlasTile>> _freeTiles;
+    
+};
+
+#endif /* VROShadowAtlas_h */
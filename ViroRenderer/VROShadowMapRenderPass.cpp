@@ -39,6 +39,25 @@
 #include "VROPencil.h"
 #include "VROBoneUBO.h"
 #include "VROFieldOfView.h"
+#include "VROFrustum.h"
+#include "VROProfiler.h"
+#include "VROGeometry.h"
+#include "VROLightBins.h"
+#include "VROOpenGL.h" // For pglpush and pop
+
+// Fraction of each cascade split distance taken from the logarithmic (rather
+// than uniform) split scheme
+static const float kShadowCascadeSplitLambda = 0.75;
+
+// FNV-1a hash, used to compute the signatures of cached shadow maps
+static const uint64_t kShadowSignatureHashBasis = 14695981039346656037ULL;
+static uint64_t hashShadowSignature(uint64_t h, const void *data, size_t length) {
+    const uint8_t *bytes = (const uint8_t *) data;
+    for (size_t i = 0; i < length; i++) {
+        h = (h ^ bytes[i]) * 1099511628211ULL;
+    }
+    return h;
+}
 
 // Shader modifier used for writing to depth buffer
 static thread_local std::shared_ptr<VROShaderModifier> sShadowDepthWritingModifier;
@@ -68,13 +87,21 @@ VROShadowMapRenderPass::VROShadowMapRenderPass(const std::shared_ptr<VROLight> l
     _silhouetteSkeletalMaterial->setReadsFromDepthBuffer(true);
     _silhouetteSkeletalMaterial->setCullMode(VROCullMode::None);
     _silhouetteSkeletalMaterial->addShaderModifier(getShadowDepthWritingModifier());
-    _silhouetteSkeletalMaterial->addShaderModifier(VROBoneUBO::createSkinningShaderModifier(true));
+    _silhouetteSkeletalMaterial->addShaderModifier(VROBoneUBO::createSkinningShaderModifier());
 }
 
 VROShadowMapRenderPass::~VROShadowMapRenderPass() {
     
 }
 
+int VROShadowMapRenderPass::getNumShadowMapTiles(const std::shared_ptr<VROLight> &light) {
+    // Cascades require the texture array
+    if (light->getType() == VROLightType::Directional && !kDebugShadowMaps) {
+        return light->getShadowCascadeCount();
+    }
+    return 1;
+}
+
 void VROShadowMapRenderPass::render(std::shared_ptr<VROScene> scene,
                                     std::shared_ptr<VROScene> outgoingScene,
                                     VRORenderPassInputOutput &inputs,
@@ -83,49 +110,235 @@ void VROShadowMapRenderPass::render(std::shared_ptr<VROScene> scene,
     VROMatrix4f previousProjection = context->getProjectionMatrix();
     VROMatrix4f previousView = context->getViewMatrix();
     
-    VROMatrix4f shadowProjection = computeLightProjectionMatrix();
+    int numTiles = (int) _tiles.size();
+    passert (numTiles == getNumShadowMapTiles(_light));
+    
     VROMatrix4f shadowView = computeLightViewMatrix();
+    VROMatrix4f shadowProjection;
+    std::vector<VROMatrix4f> tileProjections;
+    std::vector<VROShadowCascade> cascades;
+    if (numTiles > 1) {
+        computeCascades(shadowView, numTiles, _tiles.front().size, context, &shadowProjection,
+                        &tileProjections, &cascades);
+    }
+    else {
+        shadowProjection = computeLightProjectionMatrix();
+        tileProjections.push_back(shadowProjection);
+        
+        VROShadowCascade cascade;
+        cascade.split = 0;
+        cascade.scale = 1;
+        cascade.offsetX = 0;
+        cascade.offsetY = 0;
+        cascades.push_back(cascade);
+    }
+    
+    // Map each cascade's texcoords into its tile of the atlas
+    float layerSize = (float) target->getWidth();
+    for (int t = 0; t < numTiles; t++) {
+        const VROShadowAtlasTile &tile = _tiles[t];
+        float tileScale = tile.size / layerSize;
+        cascades[t].scale *= tileScale;
+        cascades[t].offsetX = cascades[t].offsetX * tileScale + tile.x / layerSize;
+        cascades[t].offsetY = cascades[t].offsetY * tileScale + tile.y / layerSize;
+        cascades[t].layer = tile.layer;
+    }
+    
+    // Gather the shadow casters of the entire scene (including the contents of
+    // all portals)
+    _casters.clear();
+    _casterBounds.clear();
+    collectShadowCasters(scene->getRootNode().get());
+    
+    int numCasters = (int) _casters.size();
+    _casterMask.resize(VROFrustum::getBatchMaskSize(numCasters));
+    _tileSignatures.resize(numTiles, 0);
+    
+    for (int t = 0; t < numTiles; t++) {
+        // Cull the casters against the tile's frustum in one batch. Skinned geometry
+        // is not culled, since it may be posed outside its bounds
+        VROFrustum lightFrustum;
+        lightFrustum.fitToModelView(shadowView.getArray(), tileProjections[t].getArray(), 0, 0, 0);
+        lightFrustum.intersectBatch(_casterBounds.data(), numCasters, _casterMask.data(), nullptr);
+        
+        // Skip the tile if neither the light nor any caster within it changed since
+        // it was last rendered
+        uint64_t signature = computeTileSignature(_tiles[t], shadowView, tileProjections[t], target);
+        if (signature != 0 && signature == _tileSignatures[t]) {
+            VRO_PROFILE_COUNT(ShadowMapsCached, 1);
+            continue;
+        }
+        _tileSignatures[t] = signature;
+        VRO_PROFILE_COUNT(ShadowMapsRendered, 1);
+        
+        context->setProjectionMatrix(tileProjections[t]);
+        context->setViewMatrix(shadowView);
+        renderTile(_tiles[t], target, context, driver);
+    }
+    
+    // Store generated shadow map properties in the VROLight
+    if (_light->getShadowViewMatrix() != shadowView) {
+        _light->setShadowViewMatrix(shadowView);
+    }
+    if (_light->getShadowProjectionMatrix() != shadowProjection) {
+        _light->setShadowProjectionMatrix(shadowProjection);
+    }
+    _light->setShadowCascades(cascades);
+    _light->setShadowCasterBounds(computeCasterBounds(_tiles.front().size));
+    _casters.clear();
+
+    if (kDrawShadowFrusta) {
+        drawShadowFrusta(scene, context, driver);
+    }
     
-    context->setProjectionMatrix(shadowProjection);
-    context->setViewMatrix(shadowView);
+    // Restore state
+    context->setProjectionMatrix(previousProjection);
+    context->setViewMatrix(previousView);
+}
+
+void VROShadowMapRenderPass::renderTile(const VROShadowAtlasTile &tile, std::shared_ptr<VRORenderTarget> target,
+                                        VRORenderContext *context, std::shared_ptr<VRODriver> &driver) {
+    // Attach the layer before binding, so that the bind only discards the layer
+    // being rendered (the other layers may hold cached shadow maps)
+    if (!kDebugShadowMaps) {
+        target->setTextureImageIndex(tile.layer, 0);
+    }
     
     driver->setDepthWritingEnabled(true);
     driver->setRenderTargetColorWritingMask(VROColorMaskNone);
-    driver->bindRenderTarget(target, VRORenderTargetUnbindOp::Invalidate);
+    
+    // The depth is cleared below (the target stays bound across tiles, so bind alone
+    // won't clear it), and stored for sampling in the lighting pass. Tiles that share
+    // their layer must load it, since the other tiles may hold cached shadow maps
+    VROLoadAction depthLoad = (tile.size == target->getWidth()) ? VROLoadAction::DontCare : VROLoadAction::Load;
+    VRORenderTargetActions actions(VROLoadAction::DontCare, depthLoad, VROLoadAction::DontCare,
+                                   VROStoreAction::Discard, VROStoreAction::Store, VROStoreAction::Discard);
+    driver->bindRenderTarget(target, actions, VRORenderTargetUnbindOp::Invalidate);
+    
+    // Restrict rendering and the clear to the tile
+    target->setRenderRegion(tile.getViewport());
     target->clearDepth();
     
-    std::vector<tree<std::shared_ptr<VROPortal>>> treeNodes;
-    treeNodes.push_back(scene->getPortalTree());
+    int numCasters = (int) _casters.size();
     
     // Render static objects
+    pglpush("Shadow Casters");
     _silhouetteStaticMaterial->bindShader(0, {}, *context, driver);
     _silhouetteStaticMaterial->bindProperties(driver);
-    render(treeNodes, target, _silhouetteStaticMaterial, [this](const VRONode &node)->bool {
-        if ((_light->getInfluenceBitMask() & node.getShadowCastingBitMask()) == 0) {
-            return false;
-        }
-        // Don't use this material for skeletal animation models; use the next one
-        if (node.getGeometry() == nullptr || node.getGeometry()->getSkinner().get() != nullptr) {
-            return false;
-        }
-        // If any material doesn't cast a shadow, don't cast for the whole node (technical limitation)
-        for (const std::shared_ptr<VROMaterial> &material : node.getGeometry()->getMaterials()) {
-            if (!material->getCastsShadows()) {
-                return false;
-            }
+    for (int i = 0; i < numCasters; i++) {
+        if (_casters[i]->getGeometry()->getSkinner() || !VROFrustum::isBatchMaskSet(_casterMask.data(), i)) {
+            continue;
         }
-        return true;
-    }, *context, driver);
+        _casters[i]->renderSilhouette(_silhouetteStaticMaterial, *context, driver);
+    }
     
     // Render skeletal animation objects
     _silhouetteSkeletalMaterial->bindShader(0, {}, *context, driver);
     _silhouetteSkeletalMaterial->bindProperties(driver);
-    render(treeNodes, target, _silhouetteSkeletalMaterial, [this](const VRONode &node)->bool {
-        if ((_light->getInfluenceBitMask() & node.getShadowCastingBitMask()) == 0) {
-            return false;
+    for (int i = 0; i < numCasters; i++) {
+        if (!_casters[i]->getGeometry()->getSkinner()) {
+            continue;
+        }
+        _casters[i]->renderSilhouette(_silhouetteSkeletalMaterial, *context, driver);
+    }
+    pglpop();
+    
+    driver->setRenderTargetColorWritingMask(VROColorMaskAll);
+}
+
+uint64_t VROShadowMapRenderPass::computeTileSignature(const VROShadowAtlasTile &tile, const VROMatrix4f &view,
+                                                      const VROMatrix4f &projection, std::shared_ptr<VRORenderTarget> target) const {
+    // With debug shadow maps every light shares one texture, so nothing can be cached
+    if (kDebugShadowMaps) {
+        return 0;
+    }
+    
+    uint64_t h = kShadowSignatureHashBasis;
+    h = hashShadowSignature(h, &tile, sizeof(tile));
+    int width = target->getWidth();
+    h = hashShadowSignature(h, &width, sizeof(width));
+    h = hashShadowSignature(h, view.getArray(), 16 * sizeof(float));
+    h = hashShadowSignature(h, projection.getArray(), 16 * sizeof(float));
+    
+    for (int i = 0; i < (int) _casters.size(); i++) {
+        const VRONode *caster = _casters[i];
+        const std::shared_ptr<VROGeometry> &geometry = caster->getGeometry();
+        
+        // Animated geometry may deform without changing its version, so tiles that
+        // contain it are always re-rendered
+        if (geometry->getSkinner() || geometry->hasMorphers() || geometry->getInstancedUBO()) {
+            return 0;
+        }
+        if (!VROFrustum::isBatchMaskSet(_casterMask.data(), i)) {
+            continue;
         }
-        // We should be using the previous material for non-skeletal models
-        if (node.getGeometry() == nullptr || node.getGeometry()->getSkinner().get() == nullptr) {
+        
+        const VROGeometry *geometryPtr = geometry.get();
+        uint32_t version = geometry->getVersion();
+        VROMatrix4f transform = caster->getWorldTransform();
+        h = hashShadowSignature(h, &caster, sizeof(caster));
+        h = hashShadowSignature(h, &geometryPtr, sizeof(geometryPtr));
+        h = hashShadowSignature(h, &version, sizeof(version));
+        h = hashShadowSignature(h, transform.getArray(), 16 * sizeof(float));
+    }
+    return h == 0 ? 1 : h;
+}
+
+void VROShadowMapRenderPass::computeCascades(const VROMatrix4f &shadowView, int numCascades, int shadowMapSize,
+                                             VRORenderContext *context, VROMatrix4f *outBaseProjection,
+                                             std::vector<VROMatrix4f> *outProjections,
+                                             std::vector<VROShadowCascade> *outCascades) const {
+    float near = _light->getShadowNearZ();
+    float far  = _light->getShadowFarZ();
+    
+    /*
+     Each cascade is an orthographic box around the camera, centered on the camera
+     and not its view frustum so that the cascades (and their cached shadow maps) do
+     not change as the camera rotates. The boxes are snapped to their texel grid so that
+     shadows do not shimmer as the camera moves. The split distances blend uniform and
+     logarithmic splits, which allots more resolution to nearby surfaces.
+     */
+    VROVector3f camera = shadowView.multiply(context->getCamera().getPosition());
+    float radius = _light->getShadowOrthographicSize() / 2.0;
+    float cameraNear = std::max(context->getZNear(), 0.01f);
+    
+    std::vector<float> splits;
+    std::vector<VROVector3f> centers;
+    for (int c = 0; c < numCascades; c++) {
+        float t = (float) (c + 1) / (float) numCascades;
+        float uniformSplit = cameraNear + (radius - cameraNear) * t;
+        float logSplit = cameraNear * pow(radius / cameraNear, t);
+        float split = (c == numCascades - 1) ? radius : (uniformSplit + (logSplit - uniformSplit) * kShadowCascadeSplitLambda);
+        
+        float texel = (2 * split) / (float) shadowMapSize;
+        VROVector3f center(floor(camera.x / texel) * texel, floor(camera.y / texel) * texel, 0);
+        
+        splits.push_back(split);
+        centers.push_back(center);
+        outProjections->push_back(VROMathComputeOrthographicProjection(center.x - split, center.x + split,
+                                                                       center.y - split, center.y + split, near, far));
+    }
+    
+    /*
+     The base projection (used to compute the shadow texcoords in the vertex shader) is
+     that of the largest cascade. Since all cascades share the light's depth range, each
+     cascade's texcoords are an affine transform of the base texcoords.
+     */
+    *outBaseProjection = outProjections->back();
+    VROVector3f baseCenter = centers.back();
+    for (int c = 0; c < numCascades; c++) {
+        VROShadowCascade cascade;
+        cascade.split = splits[c];
+        cascade.scale = radius / splits[c];
+        cascade.offsetX = 0.5 * (1.0 - cascade.scale) + 0.5 * (baseCenter.x - centers[c].x) / splits[c];
+        cascade.offsetY = 0.5 * (1.0 - cascade.scale) + 0.5 * (baseCenter.y - centers[c].y) / splits[c];
+        outCascades->push_back(cascade);
+    }
+}
+
+void VROShadowMapRenderPass::collectShadowCasters(VRONode *root) {
+    root->collectNodes([this](const VRONode &node)->bool {
+        if (node.getGeometry() == nullptr || (_light->getInfluenceBitMask() & node.getShadowCastingBitMask()) == 0) {
             return false;
         }
         // If any material doesn't cast a shadow, don't cast for the whole node (technical limitation)
@@ -135,40 +348,56 @@ void VROShadowMapRenderPass::render(std::shared_ptr<VROScene> scene,
             }
         }
         return true;
-    }, *context, driver);
+    }, &_casters);
     
-    // Store generated shadow map properties in the VROLight
-    _light->setShadowViewMatrix(shadowView);
-    _light->setShadowProjectionMatrix(shadowProjection);
-
-    if (kDrawShadowFrusta) {
-        drawShadowFrusta(scene, context, driver);
+    for (VRONode *caster : _casters) {
+        _casterBounds.push_back(caster->getBoundingBox());
+    }
+    if (!VROLightBins::isAttenuated(*_light)) {
+        return;
     }
     
-    // Restore state
-    driver->setRenderTargetColorWritingMask(VROColorMaskAll);
-    context->setProjectionMatrix(previousProjection);
-    context->setViewMatrix(previousView);
+    // Casters beyond the light's range only shadow surfaces the light doesn't reach.
+    // Skinned geometry is kept, since it may be posed outside its bounds
+    int numCasters = (int) _casters.size();
+    _casterMask.resize(VROFrustum::getBatchMaskSize(numCasters));
+    VROLightBins::intersectBatch(*_light, _casterBounds.data(), numCasters, _casterMask.data());
+    
+    int numInfluenced = 0;
+    for (int i = 0; i < numCasters; i++) {
+        if (VROFrustum::isBatchMaskSet(_casterMask.data(), i) || _casters[i]->getGeometry()->getSkinner()) {
+            _casters[numInfluenced] = _casters[i];
+            _casterBounds[numInfluenced] = _casterBounds[i];
+            numInfluenced++;
+        }
+    }
+    _casters.resize(numInfluenced);
+    _casterBounds.resize(numInfluenced);
 }
 
-void VROShadowMapRenderPass::render(std::vector<tree<std::shared_ptr<VROPortal>>> &treeNodes,
-                                    std::shared_ptr<VRORenderTarget> &target,
-                                    std::shared_ptr<VROMaterial> material,
-                                    std::function<bool(const VRONode&)> filter,
-                                    const VRORenderContext &context,
-                                    std::shared_ptr<VRODriver> &driver) {
-    
-    int i = 0;
-    for (tree<std::shared_ptr<VROPortal>> &treeNode : treeNodes) {
-        std::shared_ptr<VROPortal> &portal = treeNode.value;
-        pglpush("Shadow Recursion Level %d, Portal %d [%s]", portal->getRecursionLevel(), i, portal->getName().c_str());
-        
-        portal->renderSilhouettes(material, VROSilhouetteMode::Flat, filter, context, driver);
-        render(treeNode.children, target, material, filter, context, driver);
-        
-        ++i;
-        pglpop();
+VROVector4f VROShadowMapRenderPass::computeCasterBounds(int shadowMapSize) const {
+    float minU = 1, minV = 1, maxU = 0, maxV = 0;
+    for (int i = 0; i < (int) _casters.size(); i++) {
+        // Skinned geometry may be posed outside its bounds, so it may cast anywhere
+        if (_casters[i]->getGeometry()->getSkinner()) {
+            return VROVector4f(0, 0, 1, 1);
+        }
+        VROVector4f bounds = _light->computeShadowMapBounds(_casterBounds[i]);
+        minU = std::min(minU, bounds.x);
+        minV = std::min(minV, bounds.y);
+        maxU = std::max(maxU, bounds.z);
+        maxV = std::max(maxV, bounds.w);
+    }
+    if (minU > maxU || minV > maxV) {
+        return VROVector4f(1, 1, 0, 0);
     }
+    
+    // PCF samples neighboring texels, so pad the bounds to keep the soft edges
+    // of the shadows. Cascades only have finer texels than the base map, so a pad
+    // in base texcoords covers them too
+    float pad = 2.0 / shadowMapSize;
+    return VROVector4f(std::max(minU - pad, 0.0f), std::max(minV - pad, 0.0f),
+                       std::min(maxU + pad, 1.0f), std::min(maxV + pad, 1.0f));
 }
 
 VROMatrix4f VROShadowMapRenderPass::computeLightProjectionMatrix() const {
@@ -29,7 +29,8 @@
 
 #include "VRORenderPass.h"
 #include "VROMatrix4f.h"
-#include "VROTree.h"
+#include "VROBoundingBox.h"
+#include "VROShadowAtlas.h"
 #include <functional>
 #include <memory>
 
@@ -40,6 +41,7 @@ class VROMaterial;
 class VRORenderTarget;
 class VRORenderContext;
 class VROShaderModifier;
+struct VROShadowCascade;
 enum class VROSilhouetteFilter;
 
 /*
@@ -55,11 +57,12 @@ const bool kDebugShadowMaps = false;
 const bool kDrawShadowFrusta = false;
 
 /*
- The maximum number of shadow maps allowed. Note that while kMaxLights
- determines the number of lights that can be used *at one time*, this
- determines the maximum number of shadow maps that can be created per
- frame. That is, if we have 48 lights, only kMaxShadowMaps of them will be
- able to cast a shadow in a given frame.
+ The maximum number of layers in the shadow map texture array. Each layer holds
+ one shadow map of the largest requested size, or several smaller shadow maps
+ (see VROShadowAtlas). Note that while kMaxLights determines the number of
+ lights that can be used *at one time*, this bounds the number of shadow maps
+ that can be created per frame. That is, if we have 48 lights, only those that
+ fit in kMaxShadowMaps layers will be able to cast a shadow in a given frame.
  */
 const int kMaxShadowMaps = 32;
 
@@ -73,10 +76,36 @@ public:
                 std::shared_ptr<VROScene> outgoingScene,
                 VRORenderPassInputOutput &inputs,
                 VRORenderContext *context, std::shared_ptr<VRODriver> &driver);
+
+    /*
+     Fragment modifier that reduces a material to writing depth only. Also used
+     by the depth pre-pass of the base render pass.
+     */
+    static std::shared_ptr<VROShaderModifier> getShadowDepthWritingModifier();
     
-private:
+    /*
+     Get the number of shadow map tiles used by the given light: one per cascade
+     for directional lights, and one otherwise.
+     */
+    static int getNumShadowMapTiles(const std::shared_ptr<VROLight> &light);
     
-    static std::shared_ptr<VROShaderModifier> getShadowDepthWritingModifier();
+    /*
+     Set the tiles of the shadow atlas this pass renders to, one per cascade. Must
+     be set before each render.
+     */
+    void setTiles(const std::vector<VROShadowAtlasTile> &tiles) {
+        _tiles = tiles;
+    }
+    
+    /*
+     Discard the signatures of the cached shadow maps, so that every tile is
+     re-rendered on the next render. Invoked when the shadow target is replaced.
+     */
+    void invalidateCache() {
+        _tileSignatures.clear();
+    }
+    
+private:
     
     /*
      Material used to render silhouettes of objects to the scene.
@@ -90,19 +119,67 @@ private:
     const std::shared_ptr<VROLight> _light;
     
     /*
-     Helper function for rendering. Performs depth-first rendering of portals, rendering
-     the portal silhouettes to the stencil buffer on the way down, and the portal geometry
-     and content on the way up.
+     The shadow casters found in the scene this frame, their world bounding
+     boxes (contiguous, for batched culling), and the bitmask of casters within
+     the light's frustum.
+     */
+    std::vector<VRONode *> _casters;
+    std::vector<VROBoundingBox> _casterBounds;
+    std::vector<uint32_t> _casterMask;
+    
+    /*
+     The tiles of the shadow atlas holding this light's shadow map, one per cascade.
      */
-    void render(std::vector<tree<std::shared_ptr<VROPortal>>> &treeNodes,
-                std::shared_ptr<VRORenderTarget> &target,
-                std::shared_ptr<VROMaterial> material,
-                std::function<bool(const VRONode &)> filter,
-                const VRORenderContext &context,
-                std::shared_ptr<VRODriver> &driver);
+    std::vector<VROShadowAtlasTile> _tiles;
+    
+    /*
+     The signature of the light projection and casters last rendered to each tile
+     of this light's shadow map. Tiles are only re-rendered when their signature
+     changes, so static shadows cost nothing after their first frame. A signature of
+     0 means the tile can not be cached (e.g. it contains animated geometry).
+     */
+    std::vector<uint64_t> _tileSignatures;
+    
+    /*
+     Collect the nodes in the given subtree that cast shadows from this light
+     into _casters, and their bounds into _casterBounds. Casters beyond the
+     range of an attenuated light are left out.
+     */
+    void collectShadowCasters(VRONode *root);
     
     VROMatrix4f computeLightProjectionMatrix() const;
     VROMatrix4f computeLightViewMatrix() const;
+    
+    /*
+     Compute the region of the light's shadow map covered by the casters in
+     _casters, padded by the shadow filter's footprint (see
+     VROLight::getShadowCasterBounds). Uses the light's current shadow matrices.
+     */
+    VROVector4f computeCasterBounds(int shadowMapSize) const;
+    
+    /*
+     Compute the projection of each cascade of a directional light, the base
+     projection from which the shaders derive each cascade's texcoords, and the
+     cascades themselves.
+     */
+    void computeCascades(const VROMatrix4f &shadowView, int numCascades, int shadowMapSize,
+                         VRORenderContext *context, VROMatrix4f *outBaseProjection,
+                         std::vector<VROMatrix4f> *outProjections,
+                         std::vector<VROShadowCascade> *outCascades) const;
+    
+    /*
+     Compute the signature of the given tile from the light's matrices and the
+     casters within the tile (those set in _casterMask).
+     */
+    uint64_t computeTileSignature(const VROShadowAtlasTile &tile, const VROMatrix4f &view,
+                                  const VROMatrix4f &projection, std::shared_ptr<VRORenderTarget> target) const;
+    
+    /*
+     Render the casters within the given tile (those set in _casterMask) to that
+     tile of the target, using the projection set on the context.
+     */
+    void renderTile(const VROShadowAtlasTile &tile, std::shared_ptr<VRORenderTarget> target,
+                    VRORenderContext *context, std::shared_ptr<VRODriver> &driver);
 
     /*
      Debug function to draw the shadow frusta.
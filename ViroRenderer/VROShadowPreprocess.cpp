@@ -32,16 +32,12 @@
 #include "VRORenderContext.h"
 #include "VROScene.h"
 #include "VROOpenGL.h" // For pglpush and pop
+#include <algorithm>
 
 VROShadowPreprocess::VROShadowPreprocess(std::shared_ptr<VRODriver> driver) :
-     _maxSupportedShadowMapSize(2048) {
-         
-    if (kDebugShadowMaps) {
-        _shadowTarget = driver->newRenderTarget(VRORenderTargetType::DepthTexture, 1, kMaxShadowMaps, false, true);
-    }
-    else {
-        _shadowTarget = driver->newRenderTarget(VRORenderTargetType::DepthTextureArray, 1, kMaxShadowMaps, false, true);
-    }
+     _maxSupportedShadowMapSize(2048),
+     _shadowTargetLayers(0) {
+    
 }
 
 void VROShadowPreprocess::execute(std::shared_ptr<VROScene> scene, VRORenderContext *context,
@@ -49,12 +45,17 @@ void VROShadowPreprocess::execute(std::shared_ptr<VROScene> scene, VRORenderCont
     
     const std::vector<std::shared_ptr<VROLight>> &lights = scene->getLights();
     
-    // Get the max requested shadow map size; use that for our render target
+    // Gather the shadow casting lights, and their max requested shadow map size;
+    // use the latter for the size of each layer of our render target
+    std::vector<std::shared_ptr<VROLight>> shadowLights;
     int maxSize = 0;
     for (const std::shared_ptr<VROLight> &light : lights) {
         if (!light->getCastsShadow()) {
             continue;
         }
+        passert (light->getType() != VROLightType::Ambient && light->getType() != VROLightType::Omni);
+        
+        shadowLights.push_back(light);
         maxSize = std::max(maxSize, light->getShadowMapSize());
     }
     
@@ -63,14 +64,32 @@ void VROShadowPreprocess::execute(std::shared_ptr<VROScene> scene, VRORenderCont
         return;
     }
     
+    // Pack (and render) the largest shadow maps first, so that the smaller maps fill
+    // the remaining quadrants of each layer. The sort is stable so that the packing,
+    // and therefore the cached shadow maps, don't change from frame to frame.
+    std::vector<int> order(shadowLights.size());
+    for (int i = 0; i < (int) order.size(); i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&shadowLights](int a, int b) {
+        return shadowLights[a]->getShadowMapSize() > shadowLights[b]->getShadowMapSize();
+    });
+    
     // Use the smallest of our max supported shadow map size and our max requested size
     int shadowMapSize = std::min(maxSize, _maxSupportedShadowMapSize);
     int minRequiredShadowMapSize = 128;
     
-    // Set the shadow target's viewport. If we fail to create a shadow render target of
-    // requested size, cut the size in half. If we continue to fail, then shadows map not
-    // be supported by this device; in this case, return without rendering them.
+    // Pack the shadow maps into the atlas and size the shadow target to fit. If we fail
+    // to create a shadow render target of requested size, cut the size in half. If we
+    // continue to fail, then shadows map not be supported by this device; in this case,
+    // return without rendering them.
+    std::vector<std::vector<VROShadowAtlasTile>> tiles;
     while (shadowMapSize >= minRequiredShadowMapSize) {
+        int numLayers = packShadowMaps(shadowLights, order, shadowMapSize, &tiles);
+        if (numLayers > _shadowTargetLayers) {
+            createShadowTarget(numLayers, driver);
+        }
+        
         _shadowTarget->setViewport({ 0, 0, shadowMapSize, shadowMapSize });
         if (_shadowTarget->hydrate()) {
             break;
@@ -85,12 +104,13 @@ void VROShadowPreprocess::execute(std::shared_ptr<VROScene> scene, VRORenderCont
     }
     
     std::map<std::shared_ptr<VROLight>, std::shared_ptr<VROShadowMapRenderPass>> activeShadowPasses;
-    int i = 0;
-    for (const std::shared_ptr<VROLight> &light : lights) {
-        if (!light->getCastsShadow()) {
+    bool rendered = false;
+    for (int index : order) {
+        const std::shared_ptr<VROLight> &light = shadowLights[index];
+        if (tiles[index].empty()) {
+            light->setShadowMapIndex(-1);
             continue;
         }
-        passert (light->getType() != VROLightType::Ambient && light->getType() != VROLightType::Omni);
         
         std::shared_ptr<VROShadowMapRenderPass> shadowPass;
         
@@ -106,10 +126,8 @@ void VROShadowPreprocess::execute(std::shared_ptr<VROScene> scene, VRORenderCont
         activeShadowPasses[light] = shadowPass;
         
         pglpush("Shadow Pass");
-        if (!kDebugShadowMaps) {
-            _shadowTarget->setTextureImageIndex(i, 0);
-        }
-        light->setShadowMapIndex(i);
+        light->setShadowMapIndex(tiles[index].front().layer);
+        shadowPass->setTiles(tiles[index]);
         
         VRORenderPassInputOutput inputs;
         inputs.outputTarget = _shadowTarget;
@@ -118,12 +136,12 @@ void VROShadowPreprocess::execute(std::shared_ptr<VROScene> scene, VRORenderCont
         driver->unbindShader();
         pglpop();
         
-        ++i;
+        rendered = true;
     }
     
     // If any shadow was rendered, set the shadow map in the context; otherwise
     // make it null
-    if (i > 0) {
+    if (rendered) {
         context->setShadowMap(_shadowTarget->getTexture(0));
     }
     else {
@@ -134,3 +152,52 @@ void VROShadowPreprocess::execute(std::shared_ptr<VROScene> scene, VRORenderCont
     // are removed
     _shadowPasses = activeShadowPasses;
 }
+
+int VROShadowPreprocess::packShadowMaps(const std::vector<std::shared_ptr<VROLight>> &lights,
+                                        const std::vector<int> &order, int layerSize,
+                                        std::vector<std::vector<VROShadowAtlasTile>> *outTiles) {
+    // Debug shadow maps use a single 2D texture, which holds one full-size shadow map
+    int maxLayers = kDebugShadowMaps ? 1 : kMaxShadowMaps;
+    _atlas.reset(layerSize, maxLayers);
+    
+    outTiles->clear();
+    outTiles->resize(lights.size());
+    for (int index : order) {
+        const std::shared_ptr<VROLight> &light = lights[index];
+        int tileSize = kDebugShadowMaps ? layerSize : light->getShadowMapSize();
+        
+        // Each light occupies one tile per cascade; lights that don't entirely fit
+        // receive no shadow this frame
+        std::vector<VROShadowAtlasTile> &lightTiles = (*outTiles)[index];
+        for (int c = 0; c < VROShadowMapRenderPass::getNumShadowMapTiles(light); c++) {
+            VROShadowAtlasTile tile;
+            if (!_atlas.allocate(tileSize, &tile)) {
+                lightTiles.clear();
+                break;
+            }
+            lightTiles.push_back(tile);
+        }
+    }
+    return _atlas.getNumLayers();
+}
+
+void VROShadowPreprocess::createShadowTarget(int numLayers, std::shared_ptr<VRODriver> driver) {
+    if (kDebugShadowMaps) {
+        _shadowTarget = driver->newRenderTarget(VRORenderTargetType::DepthTexture, 1, 1, false, true);
+        _shadowTargetLayers = 1;
+    }
+    else {
+        // Grow by powers of two so that adding lights rarely reallocates the array
+        int layers = 1;
+        while (layers < numLayers) {
+            layers *= 2;
+        }
+        _shadowTargetLayers = std::min(layers, kMaxShadowMaps);
+        _shadowTarget = driver->newRenderTarget(VRORenderTargetType::DepthTextureArray, 1, _shadowTargetLayers, false, true);
+    }
+    
+    // The shadow maps cached by each pass were in the old target
+    for (auto &kv : _shadowPasses) {
+        kv.second->invalidateCache();
+    }
+}
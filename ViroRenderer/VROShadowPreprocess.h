@@ -28,6 +28,7 @@
 #define VROShadowPreprocess_h
 
 #include "VROPreprocess.h"
+#include "VROShadowAtlas.h"
 #include <vector>
 #include <map>
 #include <functional>
@@ -57,15 +58,34 @@ private:
     
     /*
      The render target for the shadow passes. This target uses a depth texture array
-     to capture shadow maps for all lights.
+     to capture shadow maps for all lights, packed into its layers by the atlas. The
+     array is grown as needed, up to kMaxShadowMaps layers.
      */
     std::shared_ptr<VRORenderTarget> _shadowTarget;
+    int _shadowTargetLayers;
+    VROShadowAtlas _atlas;
     
     /*
      The shadow passes for creating the depth maps for each light.
      */
     std::map<std::shared_ptr<VROLight>, std::shared_ptr<VROShadowMapRenderPass>> _shadowPasses;
     
+    /*
+     Pack the shadow maps of the given lights, in the given order, into the atlas
+     with layers of the given size. Each light's tiles (one per cascade, or none if
+     the light did not fit) are stored in outTiles, which is indexed like lights.
+     Returns the number of layers used.
+     */
+    int packShadowMaps(const std::vector<std::shared_ptr<VROLight>> &lights,
+                       const std::vector<int> &order, int layerSize,
+                       std::vector<std::vector<VROShadowAtlasTile>> *outTiles);
+    
+    /*
+     Replace the shadow target with one that can hold at least the given number
+     of layers.
+     */
+    void createShadowTarget(int numLayers, std::shared_ptr<VRODriver> driver);
+    
 };
 
 #endif /* VROShadowPreprocess_h */
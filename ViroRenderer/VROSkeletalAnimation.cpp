@@ -27,7 +27,8 @@
 #include "VROSkeletalAnimation.h"
 #include "VROTransaction.h"
 #include "VROLog.h"
-#include "VROAnimationMatrix4f.h"
+#include "VROAnimationClip.h"
+#include "VROAnimationClipTrack.h"
 #include "VROSkeleton.h"
 #include "VROShaderModifier.h"
 #include "VROBone.h"
@@ -35,19 +36,34 @@
 #include <sstream>
 #include <map>
 
+VROSkeletalAnimation::VROSkeletalAnimation(std::shared_ptr<VROSkinner> skinner,
+                                           std::vector<std::unique_ptr<VROSkeletalAnimationFrame>> &frames,
+                                           float duration,
+                                           std::shared_ptr<VROAnimationClip> clip) {
+    _skinner = skinner;
+    _frames = std::move(frames);
+    _duration = duration;
+    _clip = clip ? clip : VROAnimationClip::createSkeletalClip(_frames);
+
+    // The clip now holds the bone transforms
+    for (std::unique_ptr<VROSkeletalAnimationFrame> &frame : _frames) {
+        std::vector<VROMatrix4f>().swap(frame->boneTransforms);
+    }
+}
+
 std::shared_ptr<VROExecutableAnimation> VROSkeletalAnimation::copy() {
     std::vector<std::unique_ptr<VROSkeletalAnimationFrame>> frames;
     for (std::unique_ptr<VROSkeletalAnimationFrame> &origFrame : _frames) {
         std::unique_ptr<VROSkeletalAnimationFrame> frame = std::unique_ptr<VROSkeletalAnimationFrame>(new VROSkeletalAnimationFrame());
         frame->time = origFrame->time;
         frame->boneIndices = origFrame->boneIndices;
-        frame->boneTransforms = origFrame->boneTransforms;
+        frame->localBoneTransforms = origFrame->localBoneTransforms;
         frame->boneTransformsLegacy = origFrame->boneTransformsLegacy;
 
         frames.push_back(std::move(frame));
     }
 
-    std::shared_ptr<VROSkeletalAnimation> animation = std::make_shared<VROSkeletalAnimation>(_skinner, frames, _duration);
+    std::shared_ptr<VROSkeletalAnimation> animation = std::make_shared<VROSkeletalAnimation>(_skinner, frames, _duration, _clip);
     animation->setName(_name);
     animation->setTimeOffset(_timeOffset);
     animation->setSpeed(_speed);
@@ -57,44 +73,26 @@ std::shared_ptr<VROExecutableAnimation> VROSkeletalAnimation::copy() {
 void VROSkeletalAnimation::execute(std::shared_ptr<VRONode> node, std::function<void()> onFinished) {
     std::weak_ptr<VROSkeletalAnimation> shared_w = shared_from_this();
     
-    /*
-     Build the key frame animation data.
-     */
-    std::map<int, std::vector<float>> boneKeyTimes;
-    std::map<int, std::vector<VROMatrix4f>> boneKeyValues;
-
-    for (std::unique_ptr<VROSkeletalAnimationFrame> &frame : _frames) {
-        passert (frame->boneIndices.size() == frame->boneTransforms.size());
-        
-        for (int i = 0; i < frame->boneIndices.size(); i++) {
-            int boneIndex = frame->boneIndices[i];
-            VROMatrix4f &transform = frame->boneTransforms[i];
-            
-            boneKeyValues[boneIndex].push_back(transform);
-            boneKeyTimes[boneIndex].push_back(frame->time);
-        }
-    }
-    
     VROTransaction::begin();
+    VROTransaction::setAnimationLODNode(node);
     VROTransaction::setAnimationDuration(_duration);
     VROTransaction::setAnimationTimeOffset(_timeOffset);
     VROTransaction::setAnimationSpeed(_speed);
     VROTransaction::setTimingFunction(VROTimingFunctionType::Linear);
     
-    for (auto kv : boneKeyTimes) {
-        int boneIndex = kv.first;
-        std::shared_ptr<VROBone> bone = _skinner->getSkeleton()->getBone(boneIndex);
-        
-        std::vector<float> &keyTimes = kv.second;
-        std::vector<VROMatrix4f> &keyValues = boneKeyValues[boneIndex];
-        std::shared_ptr<VROAnimation> animation = std::make_shared<VROAnimationMatrix4f>([shared_w, boneIndex](VROAnimatable *const animatable, VROMatrix4f m) {
+    /*
+     Animate each bone by sampling its track of the clip.
+     */
+    for (int track = 0; track < _clip->getNumTracks(); track++) {
+        std::shared_ptr<VROBone> bone = _skinner->getSkeleton()->getBone(_clip->getTrackTarget(track));
+        std::shared_ptr<VROAnimation> animation = std::make_shared<VROAnimationClipTrack>([shared_w](VROAnimatable *const animatable, VROMatrix4f m) {
             std::shared_ptr<VROSkeletalAnimation> shared = shared_w.lock();
             if (!shared) {
                 return;
             }
             VROBone *bone = ((VROBone *)animatable);
             bone->setTransform(m, bone->getTransformType());
-        }, keyTimes, keyValues);
+        }, _clip, track);
         
         bone->animate(animation);
     }
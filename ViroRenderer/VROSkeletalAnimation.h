@@ -34,6 +34,7 @@
 
 class VROShaderModifier;
 class VROSkinner;
+class VROAnimationClip;
 
 /*
  Single frame of a skeletal animation. Identifies the bones
@@ -54,6 +55,10 @@ struct VROSkeletalAnimationFrame {
      
      The indices must correspond to the skeleton's bones
      array.
+     
+     The boneTransforms are compressed into the VROAnimationClip
+     of the VROSkeletalAnimation constructed from these frames,
+     and released from the frames themselves.
      */
     std::vector<int> boneIndices;
     std::vector<VROMatrix4f> boneTransforms;
@@ -77,13 +82,15 @@ class VROSkeletalAnimation : public VROExecutableAnimation, public std::enable_s
     
 public:
         
+    /*
+     Create a skeletal animation from the given frames, compressing their bone
+     transforms into a clip. If a clip is provided, it is used instead (e.g.
+     to share the clip between copies of an animation).
+     */
     VROSkeletalAnimation(std::shared_ptr<VROSkinner> skinner,
                          std::vector<std::unique_ptr<VROSkeletalAnimationFrame>> &frames,
-                         float duration)  {
-        _skinner = skinner;
-        _frames = std::move(frames);
-        _duration = duration;
-    }
+                         float duration,
+                         std::shared_ptr<VROAnimationClip> clip = nullptr);
 
     virtual ~VROSkeletalAnimation() { }
     
@@ -100,6 +107,14 @@ public:
     const std::vector<std::unique_ptr<VROSkeletalAnimationFrame>> &getFrames() const {
         return _frames;
     }
+
+    /*
+     The compressed bone transforms of this animation, with one track per
+     animated bone.
+     */
+    const std::shared_ptr<VROAnimationClip> &getClip() const {
+        return _clip;
+    }
     
 #pragma mark - Executable Animation API
     
@@ -149,6 +164,11 @@ private:
      The animation frames, in order of time.
      */
     std::vector<std::unique_ptr<VROSkeletalAnimationFrame>> _frames;
+
+    /*
+     The compressed bone transforms, shared by all copies of this animation.
+     */
+    std::shared_ptr<VROAnimationClip> _clip;
     
     /*
      The duration of this animation in seconds.
@@ -38,7 +38,11 @@ VROSkinner::VROSkinner(std::shared_ptr<VROSkeleton> skeleton,
                        std::shared_ptr<VROGeometrySource> boneWeights) :
     _skeleton(skeleton),
     _boneIndices(boneIndices),
-    _boneWeights(boneWeights) {
+    _boneWeights(boneWeights),
+    _skinningMode(VROSkinningMode::Matrix),
+    _activeSkinningMode(VROSkinningMode::Matrix),
+    _skinningCached(false),
+    _skinningCacheValid(false) {
 
     /*
      The geometryBindTransform moves the model into alignment with the skeleton.
@@ -54,6 +58,28 @@ VROSkinner::VROSkinner(std::shared_ptr<VROSkeleton> skeleton,
     }
 }
 
+VROSkinner::VROSkinner(const std::shared_ptr<VROSkinner> &skinner,
+                       std::vector<int> bonePalette,
+                       std::shared_ptr<VROGeometrySource> boneIndices,
+                       std::shared_ptr<VROGeometrySource> boneWeights) :
+    _skeleton(skinner->_skeleton),
+    _bindTransforms(skinner->_bindTransforms),
+    _inverseBindTransforms(skinner->_inverseBindTransforms),
+    _boneIndices(boneIndices),
+    _boneWeights(boneWeights),
+    _bonePalette(bonePalette),
+    _skinningMode(skinner->_skinningMode),
+    _activeSkinningMode(skinner->_activeSkinningMode),
+    _skinnerNodeWeak(skinner->_skinnerNodeWeak),
+    _skinningCached(skinner->_skinningCached),
+    _skinningCacheValid(false) {
+
+}
+
+int VROSkinner::getNumPaletteBones() const {
+    return _bonePalette.empty() ? _skeleton->getNumBones() : (int) _bonePalette.size();
+}
+
 VROMatrix4f VROSkinner::getModelTransform(int boneIndex) {
     const std::shared_ptr<VROBone> &bone = _skeleton->getBone(boneIndex);
 
@@ -36,6 +36,21 @@ class VRONode;
 class VROGeometry;
 class VROSkeleton;
 class VROBone;
+class VROBakedSkeletalAnimation;
+
+/*
+ The method by which a geometry is deformed by its skeleton. Matrix skinning
+ blends each bone's full transform matrix, and supports bones that scale.
+ Dual-quaternion skinning blends each bone's rotation and translation as a dual
+ quaternion, which preserves volume around twisting joints and takes half the
+ space per bone, so skeletons can have twice as many bones. Dual quaternions
+ cannot represent scale, so skinners whose bones scale are skinned with
+ matrices regardless of this setting.
+ */
+enum class VROSkinningMode {
+    Matrix,
+    DualQuaternion
+};
 /*
  VROSkinner is the base class for skeletal animation; it associates an animation
  skeleton with the geometry that will be deformed.
@@ -114,6 +129,18 @@ public:
                std::vector<VROMatrix4f> boneSpaceTransforms,
                std::shared_ptr<VROGeometrySource> boneIndices,
                std::shared_ptr<VROGeometrySource> boneWeights);
+    
+    /*
+     Create a skinner that drives one partition of the geometry driven by the given
+     skinner, with the same skeleton and bind transforms. The partition's bone indices
+     index into the given palette, which maps each to a bone in the skeleton. Used
+     when geometries are split to fit their bones within the bone UBO (see
+     VROGeometryUtilSplitByBoneLimit).
+     */
+    VROSkinner(const std::shared_ptr<VROSkinner> &skinner,
+               std::vector<int> bonePalette,
+               std::shared_ptr<VROGeometrySource> boneIndices,
+               std::shared_ptr<VROGeometrySource> boneWeights);
     virtual ~VROSkinner() {}
     
     /*
@@ -126,6 +153,17 @@ public:
         return _skeleton;
     }
     
+    /*
+     The bones this skinner writes to the bone UBO, in shader order. If this skinner
+     has a palette, the bone indices of its geometry index into the palette, and
+     getPaletteBone() returns the skeleton bone for each; otherwise they index the
+     skeleton directly.
+     */
+    int getNumPaletteBones() const;
+    int getPaletteBone(int index) const {
+        return _bonePalette.empty() ? index : _bonePalette[index];
+    }
+    
     const std::shared_ptr<VROGeometrySource> getBoneIndices() const {
         return _boneIndices;
     }
@@ -154,6 +192,68 @@ public:
         return _skinnerNodeWeak.lock();
     }
     
+    /*
+     Set the method used to skin the geometry. Defaults to Matrix. See
+     VROSkinningMode.
+     */
+    void setSkinningMode(VROSkinningMode mode) {
+        _skinningMode = mode;
+    }
+    VROSkinningMode getSkinningMode() const {
+        return _skinningMode;
+    }
+    
+    /*
+     The method by which the bone transforms currently in the bone UBO were written:
+     this is the skinning mode, except when dual quaternions were requested but the
+     skeleton is currently scaled. Set by VROBoneUBO each frame.
+     */
+    void setActiveSkinningMode(VROSkinningMode mode) {
+        _activeSkinningMode = mode;
+    }
+    VROSkinningMode getActiveSkinningMode() const {
+        return _activeSkinningMode;
+    }
+    
+    /*
+     When enabled, the geometry is skinned once per frame into a GPU buffer
+     (see VROSkinningCache), and every pass that draws it (each eye, each shadow
+     map, silhouettes) reads the skinned vertices from that buffer instead of
+     re-skinning them in its own vertex shader. Off by default.
+     */
+    void setSkinningCached(bool cached) {
+        _skinningCached = cached;
+    }
+    bool isSkinningCached() const {
+        return _skinningCached;
+    }
+    
+    /*
+     True if the skinned vertices for the current frame have been written to the
+     skinning cache, meaning the geometry's shaders must not skin them again. Set
+     by the geometry's substrate when it updates the cache.
+     */
+    void setSkinningCacheValid(bool valid) {
+        _skinningCacheValid = valid;
+    }
+    bool isSkinningCacheValid() const {
+        return _skinningCacheValid;
+    }
+    
+    /*
+     Animate the geometry with a baked animation instead of the skeleton (see
+     VROBakedSkeletalAnimation). The bake must have been made for this skinner.
+     Geometries with a baked animation are always rendered through automatic
+     instancing, and each node rendering them plays the animation at its own
+     time offset. Set to nullptr to return to the skeleton.
+     */
+    void setBakedAnimation(std::shared_ptr<VROBakedSkeletalAnimation> animation) {
+        _bakedAnimation = animation;
+    }
+    const std::shared_ptr<VROBakedSkeletalAnimation> &getBakedAnimation() const {
+        return _bakedAnimation;
+    }
+    
 private:
     
     /*
@@ -196,11 +296,35 @@ private:
      via _boneIndices) has in influencing the vertex.
      */
     std::shared_ptr<VROGeometrySource> _boneWeights;
+    
+    /*
+     Maps the bone indices of this skinner's geometry to the skeleton's bones. Empty
+     if the bone indices refer to the skeleton's bones directly.
+     */
+    std::vector<int> _bonePalette;
+    
+    /*
+     The requested skinning mode, and the mode last used to write the bone UBO.
+     */
+    VROSkinningMode _skinningMode;
+    VROSkinningMode _activeSkinningMode;
 
     /*
      Weak pointer to the node containing this VROSKinner.
      */
     std::weak_ptr<VRONode> _skinnerNodeWeak;
+    
+    /*
+     True if skinning is computed once per frame into a cache; and true if that
+     cache currently holds this frame's skinned vertices.
+     */
+    bool _skinningCached;
+    bool _skinningCacheValid;
+    
+    /*
+     The baked animation that drives the geometry in place of the skeleton, if any.
+     */
+    std::shared_ptr<VROBakedSkeletalAnimation> _bakedAnimation;
 };
 
 #endif /* VROSkinner_h */
@@ -0,0 +1,99 @@
+//
+//  VROSkinningCache.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROSkinningCache.h"
+#include "VROBoneUBO.h"
+#include "VROShaderProgram.h"
+#include "VROShaderModifier.h"
+#include "VRODriverOpenGL.h"
+#include "VROLog.h"
+#include "VROAllocationTracker.h"
+
+std::shared_ptr<VROShaderProgram> VROSkinningCache::createSkinningProgram(std::shared_ptr<VRODriverOpenGL> driver) {
+    std::vector<std::string> samplers;
+    std::vector<std::shared_ptr<VROShaderModifier>> modifiers;
+    std::shared_ptr<VROShaderProgram> program = std::make_shared<VROShaderProgram>("skinning_cache_vsh", "skinning_cache_fsh",
+                                                                                   samplers, modifiers,
+                                                                                   (int) VROShaderMask::BoneIndex | (int) VROShaderMask::BoneWeight,
+                                                                                   driver);
+    program->setTransformFeedbackVaryings({ "skinned_position" });
+    return program;
+}
+
+VROSkinningCache::VROSkinningCache(int vertexCount, std::shared_ptr<VRODriverOpenGL> driver) :
+    _vertexCount(vertexCount),
+    _driver(driver) {
+    
+    GL( glGenBuffers(1, &_buffer) );
+    GL( glBindBuffer(GL_ARRAY_BUFFER, _buffer) );
+    GL( glBufferData(GL_ARRAY_BUFFER, vertexCount * 3 * sizeof(float), nullptr, GL_DYNAMIC_COPY) );
+    GL( glBindBuffer(GL_ARRAY_BUFFER, 0) );
+    ALLOCATION_TRACKER_ADD(VBO, 1);
+}
+
+VROSkinningCache::~VROSkinningCache() {
+    std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
+    if (driver) {
+        driver->deleteBuffer(_buffer);
+    }
+    ALLOCATION_TRACKER_SUB(VBO, 1);
+}
+
+bool VROSkinningCache::update(GLuint sourceVAO, VROBoneUBO &boneUBO) {
+    std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
+    if (!driver) {
+        return false;
+    }
+    
+    std::shared_ptr<VROShaderProgram> program = driver->getSkinningCacheProgram();
+    // Compile without stalling the frame; until the program is ready the geometry
+    // is skinned in its own shaders
+    if (!program->isHydrated() && !program->hydrateAsync()) {
+        return false;
+    }
+    if (!program->isHydrated()) {
+        return false;
+    }
+    
+    pglpush("Skinning Cache");
+    boneUBO.bind();
+    driver->bindShader(program);
+    
+    /*
+     Each vertex is drawn as a point, and its skinned position captured into the
+     cache. Nothing is rasterized.
+     */
+    GL( glEnable(GL_RASTERIZER_DISCARD) );
+    driver->bindVertexArray(sourceVAO);
+    GL( glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, _buffer) );
+    GL( glBeginTransformFeedback(GL_POINTS) );
+    GL( glDrawArrays(GL_POINTS, 0, _vertexCount) );
+    GL( glEndTransformFeedback() );
+    GL( glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0) );
+    GL( glDisable(GL_RASTERIZER_DISCARD) );
+    
+    pglpop();
+    return true;
+}
@@ -0,0 +1,100 @@
+//
+//  VROSkinningCache.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROSkinningCache_h
+#define VROSkinningCache_h
+
+#include "VROOpenGL.h"
+#include <memory>
+
+class VROBoneUBO;
+class VROShaderProgram;
+class VRODriverOpenGL;
+
+/*
+ Holds the skinned vertex positions of a geometry for the current frame.
+ 
+ Normally skinned geometries deform their vertices in the vertex shader of
+ every pass that draws them: each eye, each shadow map, each silhouette. When
+ skinning is cached (see VROSkinner::setSkinningCached), the geometry is
+ instead skinned once per frame, from its bind-pose positions and the bone
+ UBO into this buffer, using transform feedback. The geometry's passes then
+ read their positions from this buffer and skip skinning altogether.
+ 
+ Only matrix skinning is cached, which deforms positions alone; normals are
+ read unchanged from the geometry. Skinners in dual-quaternion mode are skinned
+ in each pass.
+ */
+class VROSkinningCache {
+    
+public:
+    
+    /*
+     Create the program that skins each vertex and captures the result. One
+     program is shared by all caches of a driver (see
+     VRODriverOpenGL::getSkinningCacheProgram).
+     */
+    static std::shared_ptr<VROShaderProgram> createSkinningProgram(std::shared_ptr<VRODriverOpenGL> driver);
+    
+    VROSkinningCache(int vertexCount, std::shared_ptr<VRODriverOpenGL> driver);
+    virtual ~VROSkinningCache();
+    
+    /*
+     Skin the vertices of the given VAO, which must contain position, bone index
+     and bone weight attributes, with the bone matrices in the given UBO. Returns
+     false if the cache could not be written this frame (e.g. the skinning program
+     has not finished compiling), in which case the geometry should be skinned in
+     its own shaders.
+     */
+    bool update(GLuint sourceVAO, VROBoneUBO &boneUBO);
+    
+    /*
+     The buffer containing the tightly packed skinned positions, three floats
+     per vertex.
+     */
+    GLuint getBuffer() const {
+        return _buffer;
+    }
+    
+private:
+    
+    /*
+     The buffer that receives the skinned positions.
+     */
+    GLuint _buffer;
+    
+    /*
+     The number of vertices skinned into the buffer.
+     */
+    int _vertexCount;
+    
+    /*
+     The driver that created this cache.
+     */
+    std::weak_ptr<VRODriverOpenGL> _driver;
+    
+};
+
+#endif /* VROSkinningCache_h */
@@ -0,0 +1,250 @@
+//
+//  VROSortKey.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include "VROSortKey.h"
+#include "VROJobSystem.h"
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+static const int kRadixBits = 8;
+static const int kRadixBuckets = 1 << kRadixBits;
+static const int kRadixPasses = 128 / kRadixBits;
+
+/*
+ Minimum number of keys before radix passes are split across threads;
+ below this the cost of dispatching jobs outweighs the gain.
+ */
+static const size_t kParallelSortThreshold = 16384;
+
+/*
+ The coherent (insertion sort) path gives up in favor of the radix sort
+ once it has shifted this many keys per key sorted.
+ */
+static const size_t kInsertionSortMaxMovesPerKey = 2;
+
+static inline uint64_t VROFoldSortKeyField(uint32_t value) {
+    return (value ^ (value >> 12) ^ (value >> 24)) & 0xFFF;
+}
+
+static inline bool VROPackedSortKeyLess(const VROPackedSortKey &a, const VROPackedSortKey &b) {
+    return a.high < b.high || (a.high == b.high && a.low < b.low);
+}
+
+static inline uint32_t VROPackedSortKeyDigit(const VROPackedSortKey &key, int pass) {
+    uint64_t word = pass < kRadixPasses / 2 ? key.low : key.high;
+    return (uint32_t) (word >> ((pass % (kRadixPasses / 2)) * kRadixBits)) & (kRadixBuckets - 1);
+}
+
+#pragma mark - VROSortKey
+
+void VROSortKey::pack(uint64_t *outHigh, uint64_t *outLow) const {
+    int32_t order = std::max(-32768, std::min(32767, renderingOrder));
+    
+    // Negative distances (and NaN) are clamped to zero, so the sign bit is
+    // always clear and the remaining 31 bits sort like the float. Opaque
+    // distances are quantized into depth buckets
+    float distance = distanceFromCamera >= 0 ? distanceFromCamera : 0;
+    uint32_t distanceBits;
+    if (transparent) {
+        memcpy(&distanceBits, &distance, sizeof(float));
+    }
+    else {
+        distanceBits = (uint32_t) std::min(log2f(1 + distance) * kOpaqueDepthBucketsPerOctave, (float) 0x7FFFFFFF);
+    }
+    
+    uint64_t high = 0;
+    high |= (uint64_t) (order + 32768) << 48;
+    high |= (uint64_t) std::min(hierarchyId, (uint32_t) 0xFF) << 40;
+    high |= (uint64_t) std::min(hierarchyDepth, (uint32_t) 0xFF) << 32;
+    high |= (uint64_t) (transparent ? 1 : 0) << 31;
+    high |= (uint64_t) (distanceBits & 0x7FFFFFFF);
+    
+    uint64_t low = 0;
+    low |= (uint64_t) (incoming ? 1 : 0) << 63;
+    low |= (uint64_t) std::min(materialRenderingOrder, (uint32_t) 0x7FFF) << 48;
+    low |= VROFoldSortKeyField(shader)   << 36;
+    low |= VROFoldSortKeyField(textures) << 24;
+    low |= VROFoldSortKeyField(lights)   << 12;
+    low |= VROFoldSortKeyField(material);
+    
+    *outHigh = high;
+    *outLow = low;
+}
+
+#pragma mark - VROSortKeySorter
+
+void VROSortKeySorter::sort(std::vector<VROSortKey> &keys, std::shared_ptr<VROJobSystem> jobs) {
+    size_t numKeys = keys.size();
+    _packed.resize(numKeys);
+    
+    // Coherent path: start from the last sorted order, which is usually
+    // correct or nearly so
+    bool sorted = false;
+    if (numKeys > 1 && matchesLastInput(keys)) {
+        for (size_t i = 0; i < numKeys; i++) {
+            uint32_t index = _lastOrder[i];
+            keys[index].pack(&_packed[i].high, &_packed[i].low);
+            _packed[i].index = index;
+        }
+        sorted = insertionSort(numKeys * kInsertionSortMaxMovesPerKey);
+    }
+    
+    if (!sorted) {
+        for (size_t i = 0; i < numKeys; i++) {
+            keys[i].pack(&_packed[i].high, &_packed[i].low);
+            _packed[i].index = (uint32_t) i;
+        }
+        radixSort(jobs);
+    }
+    
+    // Record this input for the next sort, and output the keys in sorted order
+    _lastIdentities.resize(numKeys);
+    _lastOrder.resize(numKeys);
+    _sorted.resize(numKeys);
+    for (size_t i = 0; i < numKeys; i++) {
+        const VROSortKey &key = keys[i];
+        _lastIdentities[i] = { key.node, (key.elementIndex << 1) | (key.incoming ? 1 : 0) };
+        
+        uint32_t index = _packed[i].index;
+        _lastOrder[i] = index;
+        _sorted[i] = keys[index];
+    }
+    keys.swap(_sorted);
+}
+
+bool VROSortKeySorter::matchesLastInput(const std::vector<VROSortKey> &keys) const {
+    if (keys.size() != _lastIdentities.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < keys.size(); i++) {
+        const VROSortKey &key = keys[i];
+        const std::pair<uintptr_t, uint32_t> &identity = _lastIdentities[i];
+        if (key.node != identity.first ||
+            ((key.elementIndex << 1) | (key.incoming ? 1 : 0)) != identity.second) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool VROSortKeySorter::insertionSort(size_t maxMoves) {
+    size_t numKeys = _packed.size();
+    size_t moves = 0;
+    
+    for (size_t i = 1; i < numKeys; i++) {
+        if (!VROPackedSortKeyLess(_packed[i], _packed[i - 1])) {
+            continue;
+        }
+        VROPackedSortKey key = _packed[i];
+        size_t j = i;
+        while (j > 0 && VROPackedSortKeyLess(key, _packed[j - 1])) {
+            _packed[j] = _packed[j - 1];
+            --j;
+            
+            // Too far out of order. The caller repacks the keys, so there's
+            // no need to restore _packed here
+            if (++moves > maxMoves) {
+                return false;
+            }
+        }
+        _packed[j] = key;
+    }
+    return true;
+}
+
+void VROSortKeySorter::radixSort(std::shared_ptr<VROJobSystem> &jobs) {
+    size_t numKeys = _packed.size();
+    _scratch.resize(numKeys);
+    if (numKeys < 2) {
+        return;
+    }
+    
+    int numChunks = 1;
+    if (jobs && numKeys >= kParallelSortThreshold) {
+        numChunks = jobs->getConcurrency();
+    }
+    size_t chunkSize = (numKeys + numChunks - 1) / numChunks;
+    std::vector<uint32_t> histograms(numChunks * kRadixBuckets);
+    
+    VROPackedSortKey *src = _packed.data();
+    VROPackedSortKey *dst = _scratch.data();
+    
+    auto forEachChunk = [&](std::function<void(int)> fn) {
+        if (numChunks > 1) {
+            jobs->parallelFor(0, numChunks, 1, fn);
+        } else {
+            fn(0);
+        }
+    };
+    
+    for (int pass = 0; pass < kRadixPasses; pass++) {
+        std::fill(histograms.begin(), histograms.end(), 0);
+        forEachChunk([&](int chunk) {
+            uint32_t *histogram = &histograms[chunk * kRadixBuckets];
+            size_t end = std::min(numKeys, (chunk + 1) * chunkSize);
+            for (size_t i = chunk * chunkSize; i < end; i++) {
+                histogram[VROPackedSortKeyDigit(src[i], pass)]++;
+            }
+        });
+        
+        // Most passes are no-ops, since the packed fields rarely use their
+        // full width: skip the pass if every key has the same digit
+        uint32_t firstDigit = VROPackedSortKeyDigit(src[0], pass);
+        size_t firstDigitCount = 0;
+        for (int chunk = 0; chunk < numChunks; chunk++) {
+            firstDigitCount += histograms[chunk * kRadixBuckets + firstDigit];
+        }
+        if (firstDigitCount == numKeys) {
+            continue;
+        }
+        
+        // Convert the histograms into scatter offsets. Chunks are laid out in
+        // order within each bucket, which keeps the sort stable
+        uint32_t offset = 0;
+        for (int bucket = 0; bucket < kRadixBuckets; bucket++) {
+            for (int chunk = 0; chunk < numChunks; chunk++) {
+                uint32_t &count = histograms[chunk * kRadixBuckets + bucket];
+                uint32_t chunkOffset = offset;
+                offset += count;
+                count = chunkOffset;
+            }
+        }
+        
+        forEachChunk([&](int chunk) {
+            uint32_t *offsets = &histograms[chunk * kRadixBuckets];
+            size_t end = std::min(numKeys, (chunk + 1) * chunkSize);
+            for (size_t i = chunk * chunkSize; i < end; i++) {
+                dst[offsets[VROPackedSortKeyDigit(src[i], pass)]++] = src[i];
+            }
+        });
+        std::swap(src, dst);
+    }
+    
+    if (src != _packed.data()) {
+        _packed.swap(_scratch);
+    }
+}
@@ -28,14 +28,24 @@
 #define VROSortKey_hpp
 
 #include <stdio.h>
-#include <tuple>
+#include <stdint.h>
+#include <vector>
+#include <memory>
+
+class VROJobSystem;
 
 static const int kMaxHierarchyId = 100;
 
+/*
+ Resolution of the depth ordering of opaque objects: the number of depth
+ buckets per doubling of the distance from the camera.
+ */
+static const float kOpaqueDepthBucketsPerOctave = 4;
+
 /*
  Sort keys are used to quickly sort geometry elements into optimal batch rendering order,
- to limit state changes on the GPU. They consist of a large byte[] that can be sorted
- quickly via memcmp.
+ to limit state changes on the GPU. For sorting, each key is packed into a 128-bit
+ integer (see pack()), which can be radix sorted in linear time by VROSortKeySorter.
  */
 class VROSortKey {
     
@@ -44,30 +54,62 @@ public:
         
     }
 
+    /*
+     Pack the sort-relevant fields of this key into two 64-bit words, such that
+     comparing (high, low) lexicographically as unsigned integers yields the
+     rendering order. The fields are packed in order of decreasing importance:
+
+     high: renderingOrder (16) | hierarchyId (8) | hierarchyDepth (8) | transparent (1) | distanceFromCamera (31)
+     low:  incoming (1) | materialRenderingOrder (15) | shader (12) | textures (12) | lights (12) | material (12)
+
+     We generally sort by rendering order, opacity (opaque objects first), and
+     distance to camera, then by batch switching concerns (shader, textures, light,
+     material). Rendering orders and hierarchy values are clamped to their field
+     widths. The batch switching fields are folded into 12 bits; a collision there
+     only costs a state change, never correctness.
+
+     Transparent objects are sorted back to front by their exact distance, as the
+     bits of a non-negative float order the same way as the float itself. Opaque
+     objects are sorted front to back, so that early depth testing rejects the
+     fragments of the objects behind them. Their distance is quantized into
+     logarithmic depth buckets (kOpaqueDepthBucketsPerOctave per doubling of
+     distance), so that within each bucket they are still grouped by state.
+
+     For hierarchies, note that the distance from camera for all objects in a hierarchy
+     is set to the distance from camera of the parent. This way distance from camera becomes
+     irrelevant within a hierarchy, so that within each hierarchy we can sort by hierarchy
+     depth only. We also sort by hierarchy ID because we want the entirely of a hierarchy to
+     appear continuously in the sort order; this is essential for the deferred depth-write
+     rendering to work (see VROPortal::renderContents).
+
+     Note that because hierarchies appear before transparency in the sort order (they must,
+     otherwise the hierarchies would not be continuous in the sort order), this means
+     hierarchies will not *always* work with transparency. We make hierarchies render first,
+     so that they will appear behind other transparent objects. But *transparent* hierarchies
+     will not display opaque objects behind them. This is a known limitation with this system.
+     Before attempting to fix, look through the git history of this file (it has been tried
+     before).
+     */
+    void pack(uint64_t *outHigh, uint64_t *outLow) const;
+
+    /*
+     Compares the packed keys, with the node and element index as tie-breakers.
+     */
     bool operator< (const VROSortKey& r) const {
-        /*
-         The std::tie operation perform the sort for us, in order of increasing importance.
-         We generally sort by rendering order, opacity (opaque objects first), and
-         distance to camera, then by batch switching concerns (shader, textures, light,
-         material), and finally by tie-breakers (node,  element index).
-         
-         For hierarchies, note that the distance from camera for all objects in a hierarchy
-         is set to the distance from camera of the parent. This way distance from camera becomes
-         irrelevant within a hierarchy, so that within each hierarchy we can sort by hierarchy
-         depth only. We also sort by hierarchy ID because we want the entirely of a hierarchy to
-         appear continuously in the sort order; this is essential for the deferred depth-write
-         rendering to work (see VROPortal::renderContents).
-
-         Note that because hierarchies appear before transparency in the sort order (they must,
-         otherwise the hierarchies would not be continuous in the sort order), this means
-         hierarchies will not *always* work with transparency. We make hierarchies render first,
-         so that they will appear behind other transparent objects. But *transparent* hierarchies
-         will not display opaque objects behind them. This is a known limitation with this system.
-         Before attempting to fix, look through the git history of this file (it has been tried
-         before).
-         */
-        return std::tie(renderingOrder, hierarchyId, hierarchyDepth, transparent, distanceFromCamera, incoming, materialRenderingOrder, shader, textures, lights, material, node, elementIndex) <
-               std::tie(r.renderingOrder, r.hierarchyId, r.hierarchyDepth, r.transparent, r.distanceFromCamera, r.incoming, r.materialRenderingOrder, r.shader, r.textures, r.lights, r.material, r.node, r.elementIndex);
+        uint64_t high, low, rHigh, rLow;
+        pack(&high, &low);
+        r.pack(&rHigh, &rLow);
+        
+        if (high != rHigh) {
+            return high < rHigh;
+        }
+        if (low != rLow) {
+            return low < rLow;
+        }
+        if (node != r.node) {
+            return node < r.node;
+        }
+        return elementIndex < r.elementIndex;
     }
             
     /*
@@ -105,11 +147,11 @@ public:
     bool transparent;
     
     /*
-     Distance from camera for objects is next (back to front).
-     This value is set to (zFar - distance from the camera).
-     
-     When sorted, this results in back to front rendering of
-     objects, ensuring correct rendering of transparent objects.
+     Distance from camera for objects is next. For transparent
+     objects this value is set to (zFar - distance from the camera),
+     which results in back to front rendering, ensuring they blend
+     correctly. For opaque objects it is the distance itself, which
+     results in front to back rendering, minimizing overdraw.
      */
     float distanceFromCamera;
 
@@ -146,6 +188,61 @@ public:
     
 };
 
+/*
+ A VROSortKey in packed form, along with the index of the key it was packed
+ from.
+ */
+struct VROPackedSortKey {
+    uint64_t high;
+    uint64_t low;
+    uint32_t index;
+};
+
+/*
+ Sorts VROSortKeys by their packed form using a stable LSD radix sort. The
+ sorter retains the order from the previous sort: when the same elements are
+ sorted again (as is typical from one frame to the next), they are first
+ moved into their previous order and then fixed up with an insertion sort,
+ which is nearly linear when the order has barely changed. If too many keys
+ move, the sorter falls back to the radix sort.
+ */
+class VROSortKeySorter {
+    
+public:
+    
+    VROSortKeySorter() {}
+    virtual ~VROSortKeySorter() {}
+    
+    /*
+     Sort the given keys in place. Ties are broken by the previous order if
+     available, and otherwise by the input order. If a job system is provided,
+     radix passes over large key sets are split across its threads.
+     */
+    void sort(std::vector<VROSortKey> &keys, std::shared_ptr<VROJobSystem> jobs = nullptr);
+    
+private:
+    
+    /*
+     Packed keys and scratch space for the radix sort.
+     */
+    std::vector<VROPackedSortKey> _packed;
+    std::vector<VROPackedSortKey> _scratch;
+    std::vector<VROSortKey> _sorted;
+    
+    /*
+     The identity (node and element index, with the incoming flag in the low bit)
+     of each key in the last input, and the last sorted order as indices into
+     that input.
+     */
+    std::vector<std::pair<uintptr_t, uint32_t>> _lastIdentities;
+    std::vector<uint32_t> _lastOrder;
+    
+    bool matchesLastInput(const std::vector<VROSortKey> &keys) const;
+    bool insertionSort(size_t maxMoves);
+    void radixSort(std::shared_ptr<VROJobSystem> &jobs);
+    
+};
+
 // Uncomment to see a compiler error indicating the size of each VROSortKey
 // template<int s> struct SortKeySize;
 // SortKeySize<sizeof(VROSortKey)> sortKeySize;
@@ -50,7 +50,8 @@ class VROSound {
     
 public:
 
-    VROSound() : _volume(1), _muted(false), _loop(false) {};
+    VROSound() : _volume(1), _muted(false), _loop(false),
+        _rolloffModel(VROSoundRolloffModel::None), _rolloffMinDistance(0), _rolloffMaxDistance(0) {};
     virtual ~VROSound() {}
     
     virtual void play() = 0;
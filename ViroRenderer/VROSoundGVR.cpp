@@ -27,23 +27,48 @@
 
 #include "VROSoundGVR.h"
 #include "VROSoundDataGVR.h"
+#include "VROSoundVoiceManager.h"
 #include "VROLog.h"
 #include "vr/gvr/capi/include/gvr_audio.h"
+#include <mutex>
+#include <sys/stat.h>
+
+/*
+ Sound files up to this size are decoded once into GVR's sample cache and
+ shared by every sound playing the same file. Larger files are not preloaded,
+ so GVR streams them from disk during playback.
+ */
+static const long kMaxPreloadedSoundfileBytes = 1024 * 1024;
+
+/*
+ Number of sounds sharing each preloaded file, per GVR audio context. The file
+ is unloaded from the cache when the last of them is destroyed.
+ */
+static std::mutex sPreloadedSoundfilesMutex;
+static std::map<std::pair<gvr::AudioApi *, std::string>, int> sPreloadedSoundfiles;
 
 std::shared_ptr<VROSoundGVR> VROSoundGVR::create(std::string resource, VROResourceType resourceType,
                                                  std::shared_ptr<gvr::AudioApi> gvrAudio,
-                                                 VROSoundType type) {
+                                                 VROSoundType type,
+                                                 std::shared_ptr<VROSoundVoiceManager> voiceManager) {
     std::shared_ptr<VROSoundGVR> sound = std::make_shared<VROSoundGVR>(resource, resourceType, gvrAudio,
                                                                        type);
     sound->setup();
+    if (voiceManager && type == VROSoundType::Spatial) {
+        voiceManager->addSound(sound);
+    }
     return sound;
 }
 
 std::shared_ptr<VROSoundGVR> VROSoundGVR::create(std::shared_ptr<VROSoundData> data,
                                                  std::shared_ptr<gvr::AudioApi> gvrAudio,
-                                                 VROSoundType type) {
+                                                 VROSoundType type,
+                                                 std::shared_ptr<VROSoundVoiceManager> voiceManager) {
     std::shared_ptr<VROSoundGVR> sound = std::make_shared<VROSoundGVR>(data, gvrAudio, type);
     sound->setup();
+    if (voiceManager && type == VROSoundType::Spatial) {
+        voiceManager->addSound(sound);
+    }
     return sound;
 }
 
@@ -74,16 +99,56 @@ VROSoundGVR::~VROSoundGVR() {
     if (gvrAudio && gvrAudio->IsSoundPlaying(_audioId)) {
         gvrAudio->PauseSound(_audioId);
     }
-    if (gvrAudio && _data) {
-        gvrAudio->UnloadSoundfile(_data->getLocalFilePath());
+    if (gvrAudio && !_preloadedPath.empty()) {
+        std::lock_guard<std::mutex> lock(sPreloadedSoundfilesMutex);
+        auto key = std::make_pair(gvrAudio.get(), _preloadedPath);
+        auto it = sPreloadedSoundfiles.find(key);
+        if (it != sPreloadedSoundfiles.end() && --it->second == 0) {
+            gvrAudio->UnloadSoundfile(_preloadedPath);
+            sPreloadedSoundfiles.erase(it);
+        }
     }
 }
 
 void VROSoundGVR::setup() {
     _data->setDelegate(shared_from_this());
-    if (_ready) {
-        _gvrAudio.lock()->PreloadSoundfile(_data->getLocalFilePath());
+}
+
+std::string VROSoundGVR::getGVRPath() const {
+    // For some reason GVR behaves differently between iOS and Android where on iOS it does not
+    // like the path starting with "file://" whereas their Android API does want it, so remove the
+    // "file://" prefix only on iOS
+#if VRO_PLATFORM_ANDROID
+    return _data->getLocalFilePath();
+#else
+    return _data->getLocalFilePath().substr(7);
+#endif
+}
+
+void VROSoundGVR::preloadSoundfile() {
+    std::shared_ptr<gvr::AudioApi> gvrAudio = _gvrAudio.lock();
+    if (!gvrAudio || !_preloadedPath.empty()) {
+        return;
+    }
+
+    std::string path = getGVRPath();
+    std::string filePath = path.compare(0, 7, "file://") == 0 ? path.substr(7) : path;
+    struct stat fileStat;
+    if (stat(filePath.c_str(), &fileStat) != 0 || fileStat.st_size > kMaxPreloadedSoundfileBytes) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(sPreloadedSoundfilesMutex);
+    auto key = std::make_pair(gvrAudio.get(), path);
+    auto it = sPreloadedSoundfiles.find(key);
+    if (it != sPreloadedSoundfiles.end()) {
+        ++it->second;
+    } else if (gvrAudio->PreloadSoundfile(path)) {
+        sPreloadedSoundfiles[key] = 1;
+    } else {
+        return;
     }
+    _preloadedPath = path;
 }
 
 void VROSoundGVR::play() {
@@ -107,15 +172,7 @@ void VROSoundGVR::play() {
 
     // create the sound if it hasn't been created yet.
     if (_audioId == -1) {
-
-        // For some reason GVR behaves differently between iOS and Android where on iOS it does not
-        // like the path starting with "file://" whereas their Android API does want it, so remove the
-        // "file://" prefix only on iOS
-#if VRO_PLATFORM_ANDROID
-        std::string path = _data->getLocalFilePath();
-#else
-        std::string path = _data->getLocalFilePath().substr(7);
-#endif
+        std::string path = getGVRPath();
         switch (_type) {
             case VROSoundType::Normal:
                 _audioId = gvrAudio->CreateStereoSound(path);
@@ -130,11 +187,13 @@ void VROSoundGVR::play() {
 
         setProperties();
         gvrAudio->PlaySound(_audioId, _loop);
+        _virtual = false;
     }
-    else {
+    else if (!_virtual) {
         gvrAudio->ResumeSound(_audioId);
     }
 
+    // A virtual voice stays paused until the voice manager realizes it
     _paused = false;
 }
 
@@ -256,6 +315,7 @@ void VROSoundGVR::setDelegate(std::shared_ptr<VROSoundDelegateInternal> delegate
 
 void VROSoundGVR::dataIsReady() {
     _ready = true;
+    preloadSoundfile();
     if (_delegate) {
         _delegate->soundIsReady();
     }
@@ -288,3 +348,55 @@ void VROSoundGVR::setProperties() {
                                          {_rotation.X, _rotation.Y, _rotation.Z, _rotation.W});
     }
 }
+
+#pragma mark - Voice Management
+
+bool VROSoundGVR::isPlaying() const {
+    if (_audioId == -1 || _paused) {
+        return false;
+    }
+    if (_virtual) {
+        return true;
+    }
+    std::shared_ptr<gvr::AudioApi> gvrAudio = _gvrAudio.lock();
+    return gvrAudio && gvrAudio->IsSoundPlaying(_audioId);
+}
+
+float VROSoundGVR::getAudibility(VROVector3f listenerPosition) const {
+    if (_muted) {
+        return 0;
+    }
+
+    // Approximates GVR's distance rolloff models
+    float distance = _transformedPosition.distance(listenerPosition);
+    float attenuation = 1;
+    if (_rolloffModel != VROSoundRolloffModel::None && distance > _rolloffMinDistance) {
+        if (distance >= _rolloffMaxDistance) {
+            attenuation = 0;
+        } else if (_rolloffModel == VROSoundRolloffModel::Linear) {
+            attenuation = 1 - (distance - _rolloffMinDistance) / (_rolloffMaxDistance - _rolloffMinDistance);
+        } else {
+            attenuation = _rolloffMinDistance / distance;
+        }
+    }
+    return _volume * attenuation;
+}
+
+void VROSoundGVR::setVirtual(bool virtualized) {
+    if (virtualized == _virtual) {
+        return;
+    }
+    _virtual = virtualized;
+
+    std::shared_ptr<gvr::AudioApi> gvrAudio = _gvrAudio.lock();
+    if (!gvrAudio || _audioId == -1 || _paused) {
+        return;
+    }
+    if (virtualized) {
+        gvrAudio->PauseSound(_audioId);
+    } else {
+        // Properties may have changed while the voice was virtual
+        setProperties();
+        gvrAudio->ResumeSound(_audioId);
+    }
+}
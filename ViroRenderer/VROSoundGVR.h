@@ -39,20 +39,25 @@ namespace gvr {
     class AudioApi;
 }
 
+class VROSoundVoiceManager;
+
 class VROSoundGVR : public VROSound, public VROSoundDataDelegate, public std::enable_shared_from_this<VROSoundGVR> {
     
 public:
 
     /*
      Note: we should use the static factory create methods rather than the constructors, because
-     they automatically call the init function (vs having to call it manually ourselves)
+     they automatically call the init function (vs having to call it manually ourselves).
+     Spatial sounds are registered with the given voice manager, if any.
      */
     static std::shared_ptr<VROSoundGVR> create(std::string resource, VROResourceType resourceType,
                                                std::shared_ptr<gvr::AudioApi> gvrAudio,
-                                               VROSoundType type);
+                                               VROSoundType type,
+                                               std::shared_ptr<VROSoundVoiceManager> voiceManager = nullptr);
     static std::shared_ptr<VROSoundGVR> create(std::shared_ptr<VROSoundData> data,
                                                std::shared_ptr<gvr::AudioApi> gvrAudio,
-                                               VROSoundType type);
+                                               VROSoundType type,
+                                               std::shared_ptr<VROSoundVoiceManager> voiceManager = nullptr);
 
     VROSoundGVR(std::string resource, VROResourceType resourceType, std::shared_ptr<gvr::AudioApi> gvrAudio,
                 VROSoundType type);
@@ -78,6 +83,29 @@ public:
     virtual void setTransformedPosition(VROVector3f transformedPosition);
     virtual void setDistanceRolloffModel(VROSoundRolloffModel model, float minDistance, float maxDistance);
 
+    #pragma mark Voice Management
+
+    /*
+     True if the sound has been started and not paused (or finished), whether
+     or not its voice is currently virtualized.
+     */
+    bool isPlaying() const;
+
+    /*
+     Estimated loudness of this sound at the given listener position, from its
+     volume and distance rolloff model.
+     */
+    float getAudibility(VROVector3f listenerPosition) const;
+
+    /*
+     Virtualize or realize this sound's voice. A virtual voice is paused in the
+     spatializer but remains logically playing, and resumes when realized.
+     */
+    void setVirtual(bool virtualized);
+    bool isVirtual() const {
+        return _virtual;
+    }
+
     #pragma mark VROSoundDataDelegate Implementation
 
     void dataIsReady();
@@ -90,17 +118,26 @@ private:
      */
     void setup();
     void setProperties();
+    std::string getGVRPath() const;
+    void preloadSoundfile();
 
     /*
      Private fields
      */
     bool _ready = false;
     bool _paused = false;
+    bool _virtual = false;
     std::shared_ptr<VROSoundData> _data;
     std::weak_ptr<gvr::AudioApi> _gvrAudio;
     
     int32_t _audioId = -1; // (type is gvr::AudioSourceId)
     int _gvrRolloffType; // type is gvr_audio_distance_rolloff_type
+
+    /*
+     The path of the sound file this sound preloaded into GVR's shared sample
+     cache, if any.
+     */
+    std::string _preloadedPath;
 };
 
 #endif /* VROSoundGVR_h */
@@ -0,0 +1,82 @@
+//
+//  VROSoundVoiceManager.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROSoundVoiceManager.h"
+#include "VROSoundGVR.h"
+#include <algorithm>
+
+// Sounds quieter than this at the listener are virtualized regardless of
+// the voice budget
+static const float kInaudibleThreshold = 0.001f;
+
+VROSoundVoiceManager::VROSoundVoiceManager() :
+    _maxVoices(kDefaultMaxSpatialVoices),
+    _numRealVoices(0),
+    _numVirtualVoices(0) {
+    
+}
+
+VROSoundVoiceManager::~VROSoundVoiceManager() {
+    
+}
+
+void VROSoundVoiceManager::addSound(std::shared_ptr<VROSoundGVR> sound) {
+    _sounds.push_back(sound);
+}
+
+void VROSoundVoiceManager::updateVoices(VROVector3f listenerPosition) {
+    _candidates.clear();
+    for (auto it = _sounds.begin(); it != _sounds.end();) {
+        std::shared_ptr<VROSoundGVR> sound = it->lock();
+        if (!sound) {
+            it = _sounds.erase(it);
+            continue;
+        }
+        if (sound->isPlaying()) {
+            _candidates.push_back({ sound, sound->getAudibility(listenerPosition) });
+        }
+        ++it;
+    }
+    
+    std::sort(_candidates.begin(), _candidates.end(),
+              [](const VROVoiceCandidate &a, const VROVoiceCandidate &b) {
+                  return a.audibility > b.audibility;
+              });
+    
+    _numRealVoices = 0;
+    _numVirtualVoices = 0;
+    for (VROVoiceCandidate &candidate : _candidates) {
+        bool real = _numRealVoices < _maxVoices && candidate.audibility > kInaudibleThreshold;
+        candidate.sound->setVirtual(!real);
+        if (real) {
+            ++_numRealVoices;
+        } else {
+            ++_numVirtualVoices;
+        }
+    }
+    
+    // Release the sounds so that the manager doesn't extend their lifetimes
+    _candidates.clear();
+}
@@ -0,0 +1,98 @@
+//
+//  VROSoundVoiceManager.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROSoundVoiceManager_h
+#define VROSoundVoiceManager_h
+
+#include <memory>
+#include <vector>
+#include "VROVector3f.h"
+
+class VROSoundGVR;
+
+static const int kDefaultMaxSpatialVoices = 16;
+
+/*
+ Limits the number of spatial sounds rendered by the spatializer at once.
+ Each frame, the playing spatial sounds are ranked by their audibility at the
+ listener (volume attenuated by distance rolloff). The most audible are kept
+ as real voices, and the rest, along with any sound too quiet to hear, are
+ virtualized: paused in the spatializer while remaining logically playing, so
+ they resume when they become audible again.
+ */
+class VROSoundVoiceManager {
+public:
+    
+    VROSoundVoiceManager();
+    virtual ~VROSoundVoiceManager();
+    
+    /*
+     Set the maximum number of real spatial voices.
+     */
+    void setMaxVoices(int maxVoices) {
+        _maxVoices = maxVoices;
+    }
+    int getMaxVoices() const {
+        return _maxVoices;
+    }
+    
+    /*
+     Register a spatial sound to be managed. Sounds are held weakly, and are
+     dropped once destroyed.
+     */
+    void addSound(std::shared_ptr<VROSoundGVR> sound);
+    
+    /*
+     Rank the playing sounds for the given listener position, realizing and
+     virtualizing voices as needed. Invoked once per frame.
+     */
+    void updateVoices(VROVector3f listenerPosition);
+    
+    /*
+     Statistics from the last update.
+     */
+    int getNumRealVoices() const {
+        return _numRealVoices;
+    }
+    int getNumVirtualVoices() const {
+        return _numVirtualVoices;
+    }
+    
+private:
+    
+    struct VROVoiceCandidate {
+        std::shared_ptr<VROSoundGVR> sound;
+        float audibility;
+    };
+    
+    int _maxVoices;
+    int _numRealVoices;
+    int _numVirtualVoices;
+    std::vector<std::weak_ptr<VROSoundGVR>> _sounds;
+    std::vector<VROVoiceCandidate> _candidates;
+    
+};
+
+#endif /* VROSoundVoiceManager_h */
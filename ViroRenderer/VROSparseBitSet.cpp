@@ -164,3 +164,54 @@ uint32_t VROSparseBitSet::nextSetBit(uint32_t fromIndex) const {
     }
     return kNotFound;
 }
+
+bool VROSparseBitSet::getPage(uint32_t page, uint32_t *outBits) const {
+    static_assert(kPageValues == 1 << kLogValuesPerPage, "Page size mismatch");
+    static_assert(kPageElements == 1 << (kLogValuesPerPage - kLogBitsPerEl), "Page size mismatch");
+    if (page >= (mMaxVal + kPageMask) >> kLogValuesPerPage) {
+        return false;
+    }
+    uint16_t index = mIndices[page];
+    if (index == mZeroPageIndex) {
+        return false;
+    }
+    memcpy(outBits, &mBitmaps[index], kPageElements * sizeof(element));
+    return true;
+}
+
+std::vector<uint32_t> VROSparseBitSet::getRanges() const {
+    std::vector<uint32_t> ranges;
+    bool inRange = false;
+    uint32_t maxPage = (mMaxVal + kPageMask) >> kLogValuesPerPage;
+    for (uint32_t page = 0; page < maxPage; page++) {
+        uint16_t index = mIndices[page];
+        if (index == mZeroPageIndex) {
+            if (inRange) {
+                ranges.push_back(page << kLogValuesPerPage);
+                inRange = false;
+            }
+            continue;
+        }
+        const element *bitmap = &mBitmaps[index];
+        for (uint32_t j = 0; j < kPageElements; j++) {
+            element e = bitmap[j];
+            uint32_t base = (page << kLogValuesPerPage) + (j << kLogBitsPerEl);
+
+            // Whole elements continue or end the current range at once
+            if (e == (inRange ? kElAllOnes : 0)) {
+                continue;
+            }
+            for (uint32_t b = 0; b <= kElMask; b++) {
+                bool set = (e & (kElFirst >> b)) != 0;
+                if (set != inRange) {
+                    ranges.push_back(base + b);
+                    inRange = set;
+                }
+            }
+        }
+    }
+    if (inRange) {
+        ranges.push_back(mMaxVal);
+    }
+    return ranges;
+}
@@ -48,6 +48,7 @@
 #include <stdint.h>
 #include <sys/types.h>
 #include <memory>
+#include <vector>
 
 // ---------------------------------------------------------------------------
 
@@ -90,6 +91,20 @@ public:
 
     static const uint32_t kNotFound = ~0u;
 
+    // Values are stored in pages of kPageValues, each kPageElements 32-bit
+    // elements in which value 0 of the element is the most significant bit.
+    static const int kPageValues = 256;
+    static const int kPageElements = 8;
+
+    // Copy the page holding values page * kPageValues onward into outBits,
+    // which must hold kPageElements elements, so that whole pages can be
+    // combined 32 values at a time. Returns false, leaving outBits untouched,
+    // if the page holds no values.
+    bool getPage(uint32_t page, uint32_t *outBits) const;
+
+    // The set as ranges, laid out as for the constructor.
+    std::vector<uint32_t> getRanges() const;
+
 private:
     void initFromRanges(const uint32_t* ranges, size_t nRanges);
 
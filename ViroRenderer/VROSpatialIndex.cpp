@@ -0,0 +1,440 @@
+//
+//  VROSpatialIndex.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROSpatialIndex.h"
+#include "VROLog.h"
+#include <algorithm>
+#include <limits>
+
+// Margin by which leaf bounds are expanded, in world units
+static const float kSpatialIndexMargin = 0.1f;
+
+#pragma mark - Box Utilities
+
+// VROBoundingBox::containsBox and intersectsBox only test X and Y, so the
+// index uses its own three-dimensional tests
+
+static VROBoundingBox VROBoxUnion(const VROBoundingBox &a, const VROBoundingBox &b) {
+    return VROBoundingBox(std::min(a.getMinX(), b.getMinX()), std::max(a.getMaxX(), b.getMaxX()),
+                          std::min(a.getMinY(), b.getMinY()), std::max(a.getMaxY(), b.getMaxY()),
+                          std::min(a.getMinZ(), b.getMinZ()), std::max(a.getMaxZ(), b.getMaxZ()));
+}
+
+static float VROBoxSurfaceArea(const VROBoundingBox &box) {
+    float x = box.getSpanX();
+    float y = box.getSpanY();
+    float z = box.getSpanZ();
+    return 2 * (x * y + y * z + z * x);
+}
+
+static bool VROBoxContains(const VROBoundingBox &outer, const VROBoundingBox &inner) {
+    return outer.getMinX() <= inner.getMinX() && outer.getMaxX() >= inner.getMaxX() &&
+           outer.getMinY() <= inner.getMinY() && outer.getMaxY() >= inner.getMaxY() &&
+           outer.getMinZ() <= inner.getMinZ() && outer.getMaxZ() >= inner.getMaxZ();
+}
+
+static bool VROBoxOverlaps(const VROBoundingBox &a, const VROBoundingBox &b) {
+    return a.getMinX() <= b.getMaxX() && a.getMaxX() >= b.getMinX() &&
+           a.getMinY() <= b.getMaxY() && a.getMaxY() >= b.getMinY() &&
+           a.getMinZ() <= b.getMaxZ() && a.getMaxZ() >= b.getMinZ();
+}
+
+static VROBoundingBox VROBoxFatten(const VROBoundingBox &box) {
+    return VROBoundingBox(box.getMinX() - kSpatialIndexMargin, box.getMaxX() + kSpatialIndexMargin,
+                          box.getMinY() - kSpatialIndexMargin, box.getMaxY() + kSpatialIndexMargin,
+                          box.getMinZ() - kSpatialIndexMargin, box.getMaxZ() + kSpatialIndexMargin);
+}
+
+#pragma mark - Initialization
+
+VROSpatialIndex::VROSpatialIndex() :
+    _freeList(-1),
+    _root(-1) {
+    
+}
+
+VROSpatialIndex::~VROSpatialIndex() {
+    
+}
+
+void VROSpatialIndex::clear() {
+    _entries.clear();
+    _leaves.clear();
+    _freeList = -1;
+    _root = -1;
+}
+
+#pragma mark - Node Management
+
+void VROSpatialIndex::insert(VRONode *node, const VROBoundingBox &bounds) {
+    passert (!contains(node));
+    
+    int leaf = allocateEntry();
+    VROSpatialIndexEntry &entry = _entries[leaf];
+    entry.bounds = VROBoxFatten(bounds);
+    entry.nodeBounds = bounds;
+    entry.node = node;
+    entry.height = 0;
+    
+    _leaves[node] = leaf;
+    insertLeaf(leaf);
+}
+
+bool VROSpatialIndex::update(VRONode *node, const VROBoundingBox &bounds) {
+    auto it = _leaves.find(node);
+    if (it == _leaves.end()) {
+        insert(node, bounds);
+        return true;
+    }
+    
+    int leaf = it->second;
+    _entries[leaf].nodeBounds = bounds;
+    if (VROBoxContains(_entries[leaf].bounds, bounds)) {
+        return false;
+    }
+    
+    removeLeaf(leaf);
+    _entries[leaf].bounds = VROBoxFatten(bounds);
+    insertLeaf(leaf);
+    return true;
+}
+
+void VROSpatialIndex::remove(VRONode *node) {
+    auto it = _leaves.find(node);
+    if (it == _leaves.end()) {
+        return;
+    }
+    
+    int leaf = it->second;
+    _leaves.erase(it);
+    removeLeaf(leaf);
+    freeEntry(leaf);
+}
+
+int VROSpatialIndex::allocateEntry() {
+    int entry;
+    if (_freeList >= 0) {
+        entry = _freeList;
+        _freeList = _entries[entry].parent;
+    } else {
+        entry = (int) _entries.size();
+        _entries.emplace_back();
+    }
+    
+    VROSpatialIndexEntry &e = _entries[entry];
+    e.node = nullptr;
+    e.parent = -1;
+    e.child1 = -1;
+    e.child2 = -1;
+    e.height = 0;
+    return entry;
+}
+
+void VROSpatialIndex::freeEntry(int entry) {
+    _entries[entry].node = nullptr;
+    _entries[entry].height = -1;
+    _entries[entry].parent = _freeList;
+    _freeList = entry;
+}
+
+#pragma mark - Tree Maintenance
+
+void VROSpatialIndex::insertLeaf(int leaf) {
+    if (_root < 0) {
+        _root = leaf;
+        _entries[leaf].parent = -1;
+        return;
+    }
+    
+    // Descend to the sibling that minimizes the total surface area added to
+    // the tree (the surface area heuristic)
+    VROBoundingBox leafBounds = _entries[leaf].bounds;
+    int index = _root;
+    while (!_entries[index].isLeaf()) {
+        const VROSpatialIndexEntry &e = _entries[index];
+        int child1 = e.child1;
+        int child2 = e.child2;
+        
+        float area = VROBoxSurfaceArea(e.bounds);
+        float combinedArea = VROBoxSurfaceArea(VROBoxUnion(e.bounds, leafBounds));
+        
+        // Cost of making a new parent for this entry and the leaf, and the
+        // minimum cost of pushing the leaf further down
+        float cost = 2 * combinedArea;
+        float inheritanceCost = 2 * (combinedArea - area);
+        
+        auto childCost = [this, &leafBounds, inheritanceCost](int child) {
+            const VROSpatialIndexEntry &c = _entries[child];
+            float unionArea = VROBoxSurfaceArea(VROBoxUnion(c.bounds, leafBounds));
+            if (c.isLeaf()) {
+                return unionArea + inheritanceCost;
+            } else {
+                return unionArea - VROBoxSurfaceArea(c.bounds) + inheritanceCost;
+            }
+        };
+        float cost1 = childCost(child1);
+        float cost2 = childCost(child2);
+        
+        if (cost < cost1 && cost < cost2) {
+            break;
+        }
+        index = cost1 < cost2 ? child1 : child2;
+    }
+    int sibling = index;
+    
+    // Create a new parent for the sibling and the leaf
+    int oldParent = _entries[sibling].parent;
+    int newParent = allocateEntry();
+    
+    VROSpatialIndexEntry &p = _entries[newParent];
+    p.parent = oldParent;
+    p.bounds = VROBoxUnion(leafBounds, _entries[sibling].bounds);
+    p.height = _entries[sibling].height + 1;
+    p.child1 = sibling;
+    p.child2 = leaf;
+    
+    if (oldParent >= 0) {
+        if (_entries[oldParent].child1 == sibling) {
+            _entries[oldParent].child1 = newParent;
+        } else {
+            _entries[oldParent].child2 = newParent;
+        }
+    } else {
+        _root = newParent;
+    }
+    _entries[sibling].parent = newParent;
+    _entries[leaf].parent = newParent;
+    
+    // Walk back up, refitting and rebalancing
+    index = _entries[leaf].parent;
+    while (index >= 0) {
+        index = balance(index);
+        
+        VROSpatialIndexEntry &e = _entries[index];
+        const VROSpatialIndexEntry &c1 = _entries[e.child1];
+        const VROSpatialIndexEntry &c2 = _entries[e.child2];
+        e.height = 1 + std::max(c1.height, c2.height);
+        e.bounds = VROBoxUnion(c1.bounds, c2.bounds);
+        
+        index = e.parent;
+    }
+}
+
+void VROSpatialIndex::removeLeaf(int leaf) {
+    if (leaf == _root) {
+        _root = -1;
+        return;
+    }
+    
+    int parent = _entries[leaf].parent;
+    int grandParent = _entries[parent].parent;
+    int sibling = _entries[parent].child1 == leaf ? _entries[parent].child2 : _entries[parent].child1;
+    
+    if (grandParent < 0) {
+        _root = sibling;
+        _entries[sibling].parent = -1;
+        freeEntry(parent);
+        return;
+    }
+    
+    // Replace the parent with the sibling, then refit the path to the root
+    if (_entries[grandParent].child1 == parent) {
+        _entries[grandParent].child1 = sibling;
+    } else {
+        _entries[grandParent].child2 = sibling;
+    }
+    _entries[sibling].parent = grandParent;
+    freeEntry(parent);
+    
+    int index = grandParent;
+    while (index >= 0) {
+        index = balance(index);
+        
+        VROSpatialIndexEntry &e = _entries[index];
+        const VROSpatialIndexEntry &c1 = _entries[e.child1];
+        const VROSpatialIndexEntry &c2 = _entries[e.child2];
+        e.bounds = VROBoxUnion(c1.bounds, c2.bounds);
+        e.height = 1 + std::max(c1.height, c2.height);
+        
+        index = e.parent;
+    }
+}
+
+/*
+ If the subtrees of the given entry differ in height by more than one,
+ rotate the taller child up into its place. Returns the index of the entry
+ now at the root of the subtree.
+ */
+int VROSpatialIndex::balance(int a) {
+    VROSpatialIndexEntry *A = &_entries[a];
+    if (A->isLeaf() || A->height < 2) {
+        return a;
+    }
+    
+    int b = A->child1;
+    int c = A->child2;
+    int imbalance = _entries[c].height - _entries[b].height;
+    if (imbalance >= -1 && imbalance <= 1) {
+        return a;
+    }
+    
+    // Rotate the taller child (up) above A (down). The taller child's
+    // taller grandchild stays with it, and the shorter is passed to A
+    int up   = imbalance > 0 ? c : b;
+    int down = imbalance > 0 ? b : c;
+    
+    VROSpatialIndexEntry *U = &_entries[up];
+    int f = U->child1;
+    int g = U->child2;
+    
+    U->child1 = a;
+    U->parent = A->parent;
+    A->parent = up;
+    
+    if (U->parent >= 0) {
+        if (_entries[U->parent].child1 == a) {
+            _entries[U->parent].child1 = up;
+        } else {
+            _entries[U->parent].child2 = up;
+        }
+    } else {
+        _root = up;
+    }
+    
+    int keep = _entries[f].height > _entries[g].height ? f : g;
+    int give = keep == f ? g : f;
+    
+    U->child2 = keep;
+    A->child1 = down;
+    A->child2 = give;
+    _entries[give].parent = a;
+    
+    const VROSpatialIndexEntry &D = _entries[down];
+    const VROSpatialIndexEntry &G = _entries[give];
+    A->bounds = VROBoxUnion(D.bounds, G.bounds);
+    A->height = 1 + std::max(D.height, G.height);
+    
+    const VROSpatialIndexEntry &K = _entries[keep];
+    U->bounds = VROBoxUnion(A->bounds, K.bounds);
+    U->height = 1 + std::max(A->height, K.height);
+    
+    return up;
+}
+
+#pragma mark - Queries
+
+void VROSpatialIndex::queryBox(const VROBoundingBox &box, std::vector<VRONode *> *outNodes) const {
+    if (_root < 0) {
+        return;
+    }
+    _stack.clear();
+    _stack.push_back(_root);
+    
+    while (!_stack.empty()) {
+        int index = _stack.back();
+        _stack.pop_back();
+        
+        const VROSpatialIndexEntry &e = _entries[index];
+        if (!VROBoxOverlaps(e.bounds, box)) {
+            continue;
+        }
+        if (e.isLeaf()) {
+            // Leaf bounds are fattened, so test the node's actual bounds
+            if (VROBoxOverlaps(e.nodeBounds, box)) {
+                outNodes->push_back(e.node);
+            }
+        } else {
+            _stack.push_back(e.child1);
+            _stack.push_back(e.child2);
+        }
+    }
+}
+
+void VROSpatialIndex::queryRadius(VROVector3f center, float radius, std::vector<VRONode *> *outNodes) const {
+    if (_root < 0) {
+        return;
+    }
+    _stack.clear();
+    _stack.push_back(_root);
+    
+    while (!_stack.empty()) {
+        int index = _stack.back();
+        _stack.pop_back();
+        
+        const VROSpatialIndexEntry &e = _entries[index];
+        if (e.bounds.getDistanceToPoint(center) > radius) {
+            continue;
+        }
+        if (e.isLeaf()) {
+            if (e.nodeBounds.getDistanceToPoint(center) <= radius) {
+                outNodes->push_back(e.node);
+            }
+        } else {
+            _stack.push_back(e.child1);
+            _stack.push_back(e.child2);
+        }
+    }
+}
+
+VRONode *VROSpatialIndex::queryNearest(VROVector3f point, float maxDistance) const {
+    if (_root < 0) {
+        return nullptr;
+    }
+    
+    // Branch and bound: subtrees whose bounds are further than the closest
+    // node found so far are skipped, and the nearer child is visited first
+    VRONode *nearest = nullptr;
+    float nearestDistance = maxDistance;
+    
+    _stack.clear();
+    _stack.push_back(_root);
+    while (!_stack.empty()) {
+        int index = _stack.back();
+        _stack.pop_back();
+        
+        const VROSpatialIndexEntry &e = _entries[index];
+        if (e.bounds.getDistanceToPoint(point) > nearestDistance) {
+            continue;
+        }
+        if (e.isLeaf()) {
+            float distance = e.nodeBounds.getDistanceToPoint(point);
+            if (distance <= nearestDistance) {
+                nearest = e.node;
+                nearestDistance = distance;
+            }
+        } else {
+            float d1 = _entries[e.child1].bounds.getDistanceToPoint(point);
+            float d2 = _entries[e.child2].bounds.getDistanceToPoint(point);
+            if (d1 < d2) {
+                _stack.push_back(e.child2);
+                _stack.push_back(e.child1);
+            } else {
+                _stack.push_back(e.child1);
+                _stack.push_back(e.child2);
+            }
+        }
+    }
+    return nearest;
+}
@@ -0,0 +1,144 @@
+//
+//  VROSpatialIndex.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROSpatialIndex_h
+#define VROSpatialIndex_h
+
+#include <stdio.h>
+#include <vector>
+#include <unordered_map>
+#include "VROBoundingBox.h"
+#include "VROVector3f.h"
+
+class VRONode;
+
+/*
+ Dynamic AABB tree over the world bounding boxes of a set of nodes, used to
+ answer box, radius, and nearest-node queries without walking the scene graph.
+
+ Each leaf stores a "fat" box: the node's bounds expanded by a margin. When a
+ node moves, its leaf is only reinserted if its new bounds escape the fat box,
+ so small motions cost a single containment test. The tree is kept balanced
+ with AVL-style rotations on insertion and removal.
+
+ The index stores raw node pointers but never dereferences them, so nodes
+ may be destroyed while still indexed as long as the owner does not use the
+ returned pointers. Not thread-safe.
+ */
+class VROSpatialIndex {
+public:
+    
+    VROSpatialIndex();
+    virtual ~VROSpatialIndex();
+    
+    /*
+     Add the given node with the given world bounds, update its bounds, or
+     remove it. Update returns true if the node's leaf had to be reinserted.
+     */
+    void insert(VRONode *node, const VROBoundingBox &bounds);
+    bool update(VRONode *node, const VROBoundingBox &bounds);
+    void remove(VRONode *node);
+    void clear();
+    
+    bool contains(VRONode *node) const {
+        return _leaves.find(node) != _leaves.end();
+    }
+    int getNumNodes() const {
+        return (int) _leaves.size();
+    }
+    
+    /*
+     Invoke the given function on every indexed node.
+     */
+    template<typename F>
+    void forEachNode(F &&function) const {
+        for (auto &kv : _leaves) {
+            function(kv.first);
+        }
+    }
+    
+    /*
+     Collect the nodes whose bounds intersect the given box, or lie within
+     the given distance of the given point. Results are appended to the
+     output vector in no particular order.
+     */
+    void queryBox(const VROBoundingBox &box, std::vector<VRONode *> *outNodes) const;
+    void queryRadius(VROVector3f center, float radius, std::vector<VRONode *> *outNodes) const;
+    
+    /*
+     Return the node whose bounds are closest to the given point, ignoring
+     nodes further than maxDistance. Returns nullptr if there is no such node.
+     */
+    VRONode *queryNearest(VROVector3f point, float maxDistance) const;
+    
+private:
+    
+    struct VROSpatialIndexEntry {
+        // Fat bounds for leaves, union of the children for internal entries
+        VROBoundingBox bounds;
+        
+        // Leaves only: the node and its actual bounds
+        VROBoundingBox nodeBounds;
+        VRONode *node;
+        
+        // Parent index, or the next free entry when this entry is unused
+        int parent;
+        int child1;
+        int child2;
+        
+        // 0 for leaves, -1 for free entries
+        int height;
+        
+        bool isLeaf() const {
+            return child1 == -1;
+        }
+    };
+    
+    /*
+     Entry pool, with unused entries threaded into a free list.
+     */
+    std::vector<VROSpatialIndexEntry> _entries;
+    int _freeList;
+    int _root;
+    
+    /*
+     Map from each indexed node to its leaf entry.
+     */
+    std::unordered_map<VRONode *, int> _leaves;
+    
+    /*
+     Scratch stack for queries.
+     */
+    mutable std::vector<int> _stack;
+    
+    int allocateEntry();
+    void freeEntry(int entry);
+    void insertLeaf(int leaf);
+    void removeLeaf(int leaf);
+    int balance(int entry);
+    
+};
+
+#endif /* VROSpatialIndex_h */
@@ -0,0 +1,112 @@
+//
+//  VROSphericalHarmonics.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include "VROSphericalHarmonics.h"
+#include "VROMath.h"
+
+// Constants of the real basis functions Y_lm
+static const float kSHBasis[kSphericalHarmonicsCoefficients] = {
+    0.282095, 0.488603, 0.488603, 0.488603, 1.092548, 1.092548, 0.315392, 1.092548, 0.546274
+};
+
+// Clamped cosine convolution constants per band, divided by pi (Ramamoorthi and Hanrahan,
+// "An Efficient Representation for Irradiance Environment Maps")
+static const float kSHCosineLobe[kSphericalHarmonicsCoefficients] = {
+    1.0, 2.0 / 3.0, 2.0 / 3.0, 2.0 / 3.0, 0.25, 0.25, 0.25, 0.25, 0.25
+};
+
+VROSphericalHarmonics::VROSphericalHarmonics() :
+    _weight(0) {
+    
+}
+
+VROSphericalHarmonics::VROSphericalHarmonics(const float *radiance) :
+    _weight(0) {
+    for (int i = 0; i < kSphericalHarmonicsCoefficients; i++) {
+        _radiance[i] = { radiance[i * 3], radiance[i * 3 + 1], radiance[i * 3 + 2] };
+    }
+}
+
+VROSphericalHarmonics::~VROSphericalHarmonics() {
+    
+}
+
+void VROSphericalHarmonics::accumulateCubeFace(int face, const float *rgba, int size, int step) {
+    for (int y = 0; y < size; y += step) {
+        for (int x = 0; x < size; x += step) {
+            // Texel center in [-1, 1], mapped to a direction following the OpenGL
+            // cubemap face layout
+            float u = 2.0f * (x + 0.5f) / size - 1.0f;
+            float v = 2.0f * (y + 0.5f) / size - 1.0f;
+            
+            VROVector3f dir;
+            switch (face) {
+                case 0: dir = {  1, -v, -u }; break;
+                case 1: dir = { -1, -v,  u }; break;
+                case 2: dir = {  u,  1,  v }; break;
+                case 3: dir = {  u, -1, -v }; break;
+                case 4: dir = {  u, -v,  1 }; break;
+                default: dir = { -u, -v, -1 }; break;
+            }
+            
+            // Solid angle subtended by the texel is proportional to 1 / r^3
+            float r2 = 1.0f + u * u + v * v;
+            float weight = 1.0f / (r2 * sqrtf(r2));
+            dir = dir.normalize();
+            
+            const float *texel = rgba + (y * size + x) * 4;
+            VROVector3f color = VROVector3f(texel[0], texel[1], texel[2]) * weight;
+            
+            _radiance[0] += color * kSHBasis[0];
+            _radiance[1] += color * (kSHBasis[1] * dir.y);
+            _radiance[2] += color * (kSHBasis[2] * dir.z);
+            _radiance[3] += color * (kSHBasis[3] * dir.x);
+            _radiance[4] += color * (kSHBasis[4] * dir.x * dir.y);
+            _radiance[5] += color * (kSHBasis[5] * dir.y * dir.z);
+            _radiance[6] += color * (kSHBasis[6] * (3.0f * dir.z * dir.z - 1.0f));
+            _radiance[7] += color * (kSHBasis[7] * dir.x * dir.z);
+            _radiance[8] += color * (kSHBasis[8] * (dir.x * dir.x - dir.y * dir.y));
+            _weight += weight;
+        }
+    }
+}
+
+void VROSphericalHarmonics::finishProjection() {
+    if (_weight <= 0) {
+        return;
+    }
+    float normalization = 4.0f * M_PI / _weight;
+    for (int i = 0; i < kSphericalHarmonicsCoefficients; i++) {
+        _radiance[i] *= normalization;
+    }
+    _weight = 0;
+}
+
+void VROSphericalHarmonics::getShaderCoefficients(VROVector3f *outCoefficients) const {
+    for (int i = 0; i < kSphericalHarmonicsCoefficients; i++) {
+        outCoefficients[i] = _radiance[i] * (kSHCosineLobe[i] * kSHBasis[i]);
+    }
+}
@@ -0,0 +1,98 @@
+//
+//  VROSphericalHarmonics.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef VROSphericalHarmonics_h
+#define VROSphericalHarmonics_h
+
+#include "VROVector3f.h"
+
+/*
+ Number of coefficients in a third order (bands 0 through 2) projection.
+ */
+static const int kSphericalHarmonicsCoefficients = 9;
+
+/*
+ Third order spherical harmonics projection of the radiance of a lighting
+ environment. Diffuse irradiance is smooth enough to be reconstructed from these
+ nine RGB coefficients, which lets the PBR shader evaluate it from uniforms
+ instead of sampling a convolved irradiance cubemap.
+
+ Coefficients are stored in the order (l, m) = (0, 0), (1, -1), (1, 0), (1, 1),
+ (2, -2), (2, -1), (2, 0), (2, 1), (2, 2), using the real basis without the
+ Condon-Shortley phase.
+ */
+class VROSphericalHarmonics {
+public:
+    
+    /*
+     Create an empty projection, to be filled with accumulateCubeFace().
+     */
+    VROSphericalHarmonics();
+    
+    /*
+     Create from nine RGB radiance coefficients (27 floats, channel-interleaved),
+     in the order described above.
+     */
+    VROSphericalHarmonics(const float *radiance);
+    virtual ~VROSphericalHarmonics();
+    
+    /*
+     Project the given face of an RGBA float cubemap, in OpenGL face order
+     (+X, -X, +Y, -Y, +Z, -Z), onto the basis. Only every step'th texel in each
+     direction is read. Call finishProjection() after all faces are accumulated.
+     */
+    void accumulateCubeFace(int face, const float *rgba, int size, int step);
+    
+    /*
+     Normalize the accumulated projection by the solid angle it covered.
+     */
+    void finishProjection();
+    
+    const VROVector3f &getRadiance(int index) const {
+        return _radiance[index];
+    }
+    
+    /*
+     Get the coefficients uploaded to the shader. These are the radiance
+     coefficients convolved with the clamped cosine lobe, divided by pi, and
+     premultiplied by the constant of each basis function, so that the shader
+     only evaluates the polynomial in N. The result matches the irradiance / pi
+     stored in the maps rendered by VROIrradianceRenderPass.
+     */
+    void getShaderCoefficients(VROVector3f *outCoefficients) const;
+    
+private:
+    
+    VROVector3f _radiance[kSphericalHarmonicsCoefficients];
+    
+    /*
+     Total solid angle weight of the texels accumulated so far.
+     */
+    float _weight;
+    
+};
+
+#endif /* VROSphericalHarmonics_h */
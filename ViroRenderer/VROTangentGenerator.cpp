@@ -0,0 +1,294 @@
+//
+//  VROTangentGenerator.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include "VROTangentGenerator.h"
+#include "VROGeometrySource.h"
+#include "VROGeometryElement.h"
+#include "VROJobSystem.h"
+#include "VROData.h"
+#include "VROVector3f.h"
+#include "VROVector4f.h"
+#include "VROLog.h"
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+
+// Unindexed jobs are split across threads in batches of this many triangles
+static const int kTangentBatchTriangles = 8192;
+
+// Tangent plane projections shorter than this are considered degenerate
+static const float kMinTangentMagnitude = 1e-12;
+
+/*
+ Reads the components of a geometry source as floats: in place for 32-bit float
+ sources, otherwise from a decoded copy.
+ */
+class VROTangentStream {
+public:
+    
+    VROTangentStream(const VROGeometrySource &source) :
+        _data(source.getData()),
+        _components(std::min(source.getComponentsPerVertex(), 3)) {
+        if (source.isFloat32()) {
+            _base = (const char *) _data->getData() + source.getDataOffset();
+            _stride = source.getDataStride();
+        }
+        else {
+            _decoded.reserve(source.getVertexCount() * 3);
+            source.visitVertices([this](int index, const VROVector4f &vertex) {
+                _decoded.push_back(vertex.x);
+                _decoded.push_back(vertex.y);
+                _decoded.push_back(vertex.z);
+                return true;
+            });
+            _base = (const char *) _decoded.data();
+            _stride = 3 * sizeof(float);
+        }
+    }
+    
+    VROVector3f get(int index) const {
+        float v[3] = { 0, 0, 0 };
+        memcpy(v, _base + (size_t) index * _stride, _components * sizeof(float));
+        return VROVector3f(v[0], v[1], v[2]);
+    }
+    
+private:
+    
+    std::shared_ptr<VROData> _data;
+    int _components;
+    std::vector<float> _decoded;
+    const char *_base;
+    int _stride;
+    
+};
+
+/*
+ Compute the unnormalized tangent and bitangent of the given triangle: the
+ derivatives of its positions with respect to its texture coordinates. Returns
+ false if the texture coordinates of the triangle are degenerate.
+ */
+static bool VROGetTriangleTangentFrame(const VROVector3f p[3], const VROVector3f uv[3],
+                                       VROVector3f *outTangent, VROVector3f *outBitangent) {
+    VROVector3f d1 = p[1] - p[0];
+    VROVector3f d2 = p[2] - p[0];
+    float s1 = uv[1].x - uv[0].x;
+    float s2 = uv[2].x - uv[0].x;
+    float t1 = uv[1].y - uv[0].y;
+    float t2 = uv[2].y - uv[0].y;
+    
+    float area = s1 * t2 - s2 * t1;
+    if (area == 0 || !std::isfinite(1.0f / area)) {
+        return false;
+    }
+    float r = 1.0f / area;
+    *outTangent = (d1 * t2 - d2 * t1) * r;
+    *outBitangent = (d2 * s1 - d1 * s2) * r;
+    return true;
+}
+
+/*
+ Project the given vector onto the plane with the given normal, and normalize it.
+ Returns the zero vector if the projection is degenerate.
+ */
+static VROVector3f VROProjectToTangentPlane(const VROVector3f &v, const VROVector3f &normal) {
+    VROVector3f projected = v - normal * normal.dot(v);
+    float magnitude = projected.magnitude();
+    if (!(magnitude > kMinTangentMagnitude) || !std::isfinite(magnitude)) {
+        return VROVector3f();
+    }
+    return projected / magnitude;
+}
+
+/*
+ Add the given triangle frame to the accumulated frame of the triangle's vertex
+ at the given corner, projected onto the tangent plane of that vertex and
+ weighted by the angle of the triangle at that corner.
+ */
+static void VROAccumulateCorner(const VROVector3f p[3], int corner, const VROVector3f &normal,
+                                const VROVector3f &tangent, const VROVector3f &bitangent,
+                                VROVector3f *tangentSum, VROVector3f *bitangentSum) {
+    VROVector3f e1 = VROProjectToTangentPlane(p[(corner + 1) % 3] - p[corner], normal);
+    VROVector3f e2 = VROProjectToTangentPlane(p[(corner + 2) % 3] - p[corner], normal);
+    if (e1.isZero() || e2.isZero()) {
+        return;
+    }
+    float angle = e1.angleWithNormedVector(e2);
+    *tangentSum += VROProjectToTangentPlane(tangent, normal) * angle;
+    *bitangentSum += VROProjectToTangentPlane(bitangent, normal) * angle;
+}
+
+/*
+ Orthonormalize the accumulated frame of a vertex against its normal, and write
+ it to the given tangent. Vertices without a valid frame receive an arbitrary
+ tangent perpendicular to their normal.
+ */
+static void VROWriteTangent(const VROVector3f &normal, const VROVector3f &tangentSum,
+                            const VROVector3f &bitangentSum, char *outTangent) {
+    VROVector3f tangent = VROProjectToTangentPlane(tangentSum, normal);
+    float handedness = 1.0;
+    if (!tangent.isZero()) {
+        handedness = (normal.cross(tangent).dot(bitangentSum) < 0.0f) ? -1.0f : 1.0f;
+    }
+    else {
+        VROVector3f c1 = normal.cross(VROVector3f(0, 0, 1));
+        VROVector3f c2 = normal.cross(VROVector3f(0, 1, 0));
+        tangent = VROProjectToTangentPlane(c1.magnitude() > c2.magnitude() ? c1 : c2, normal);
+        if (tangent.isZero()) {
+            tangent = VROVector3f(1, 0, 0);
+        }
+    }
+    
+    float v[4] = { tangent.x, tangent.y, tangent.z, handedness };
+    memcpy(outTangent, v, sizeof(v));
+}
+
+bool VROTangentGenerator::generate(const std::vector<VROTangentJob> &jobs) {
+    // Each task generates an indexed job, or a range of the triangles of an
+    // unindexed job
+    struct VROTangentTask {
+        int job;
+        int firstTriangle;
+        int lastTriangle;
+    };
+    
+    bool valid = true;
+    std::vector<VROTangentTask> tasks;
+    for (int j = 0; j < jobs.size(); j++) {
+        const VROTangentJob &job = jobs[j];
+        if (!isValid(job)) {
+            valid = false;
+            continue;
+        }
+        if (job.element) {
+            tasks.push_back({ j, 0, 0 });
+            continue;
+        }
+        int numTriangles = job.positions->getVertexCount() / 3;
+        for (int first = 0; first < numTriangles; first += kTangentBatchTriangles) {
+            tasks.push_back({ j, first, std::min(first + kTangentBatchTriangles, numTriangles) });
+        }
+    }
+    
+    VROJobSystem::getShared()->parallelFor(0, (int) tasks.size(), 1, [&jobs, &tasks] (int i) {
+        const VROTangentTask &task = tasks[i];
+        if (jobs[task.job].element) {
+            generateIndexed(jobs[task.job]);
+        }
+        else {
+            generateUnindexed(jobs[task.job], task.firstTriangle, task.lastTriangle);
+        }
+    });
+    return valid;
+}
+
+bool VROTangentGenerator::isValid(const VROTangentJob &job) {
+    if (!job.positions || !job.normals || !job.texcoords || !job.tangents ||
+        !job.positions->getData() || !job.normals->getData() || !job.texcoords->getData()) {
+        return false;
+    }
+    int numVertices = job.positions->getVertexCount();
+    if (job.normals->getVertexCount() != numVertices || job.texcoords->getVertexCount() != numVertices) {
+        pwarn("Unable to generate tangents: vertex counts of sources do not match");
+        return false;
+    }
+    if (numVertices > 0 &&
+        job.tangentOffset + (size_t) (numVertices - 1) * job.tangentStride + 4 * sizeof(float) > job.tangents->getDataLength()) {
+        pwarn("Unable to generate tangents: tangent data is too small");
+        return false;
+    }
+    return true;
+}
+
+void VROTangentGenerator::generateUnindexed(const VROTangentJob &job, int firstTriangle, int lastTriangle) {
+    VROTangentStream positions(*job.positions);
+    VROTangentStream normals(*job.normals);
+    VROTangentStream texcoords(*job.texcoords);
+    char *tangents = (char *) job.tangents->getData() + job.tangentOffset;
+    
+    for (int t = firstTriangle; t < lastTriangle; t++) {
+        VROVector3f p[3], uv[3];
+        for (int c = 0; c < 3; c++) {
+            p[c] = positions.get(t * 3 + c);
+            uv[c] = texcoords.get(t * 3 + c);
+        }
+        VROVector3f tangent, bitangent;
+        bool hasFrame = VROGetTriangleTangentFrame(p, uv, &tangent, &bitangent);
+        
+        for (int c = 0; c < 3; c++) {
+            int vertex = t * 3 + c;
+            VROVector3f normal = normals.get(vertex);
+            VROVector3f tangentSum, bitangentSum;
+            if (hasFrame) {
+                tangentSum = tangent;
+                bitangentSum = bitangent;
+            }
+            VROWriteTangent(normal, tangentSum, bitangentSum, tangents + (size_t) vertex * job.tangentStride);
+        }
+    }
+}
+
+void VROTangentGenerator::generateIndexed(const VROTangentJob &job) {
+    VROTangentStream positions(*job.positions);
+    VROTangentStream normals(*job.normals);
+    VROTangentStream texcoords(*job.texcoords);
+    char *tangents = (char *) job.tangents->getData() + job.tangentOffset;
+    
+    int numVertices = job.positions->getVertexCount();
+    std::vector<VROVector3f> sums(numVertices * 2);
+    VROVector3f *tangentSums = sums.data();
+    VROVector3f *bitangentSums = sums.data() + numVertices;
+    
+    int triangle[3];
+    job.element->visitIndices([&](int index, int indexRead) {
+        triangle[index % 3] = indexRead;
+        if (index % 3 != 2) {
+            return true;
+        }
+        
+        VROVector3f p[3], uv[3];
+        for (int c = 0; c < 3; c++) {
+            if (triangle[c] < 0 || triangle[c] >= numVertices) {
+                return true;
+            }
+            p[c] = positions.get(triangle[c]);
+            uv[c] = texcoords.get(triangle[c]);
+        }
+        VROVector3f tangent, bitangent;
+        if (!VROGetTriangleTangentFrame(p, uv, &tangent, &bitangent)) {
+            return true;
+        }
+        for (int c = 0; c < 3; c++) {
+            int vertex = triangle[c];
+            VROAccumulateCorner(p, c, normals.get(vertex), tangent, bitangent,
+                                &tangentSums[vertex], &bitangentSums[vertex]);
+        }
+        return true;
+    });
+    
+    for (int i = 0; i < numVertices; i++) {
+        VROWriteTangent(normals.get(i), tangentSums[i], bitangentSums[i], tangents + (size_t) i * job.tangentStride);
+    }
+}
@@ -0,0 +1,97 @@
+//
+//  VROTangentGenerator.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef VROTangentGenerator_h
+#define VROTangentGenerator_h
+
+#include <memory>
+#include <vector>
+
+class VROData;
+class VROGeometrySource;
+class VROGeometryElement;
+
+/*
+ The inputs and output of generating the tangents of one triangle mesh. The
+ tangents (xyz, with the sign of the bitangent in w) are written as four floats
+ per vertex at the given byte offset and stride of the tangent data, so they may
+ be written directly into interleaved vertex data. If the element is null, the
+ vertices are drawn as unindexed triangles, in order.
+ */
+struct VROTangentJob {
+    std::shared_ptr<VROGeometrySource> positions;
+    std::shared_ptr<VROGeometrySource> normals;
+    std::shared_ptr<VROGeometrySource> texcoords;
+    std::shared_ptr<VROGeometryElement> element;
+    
+    std::shared_ptr<VROData> tangents;
+    int tangentOffset;
+    int tangentStride;
+};
+
+/*
+ Generates per-vertex tangents for normal mapping, following the conventions of
+ MikkTSpace: the tangent and bitangent of each triangle are projected onto the
+ tangent plane of each of its vertices, and accumulated weighted by the angle
+ of the triangle at that vertex, so results do not depend on how a surface is
+ triangulated. Vertices are never split, as vertex data may be shared between
+ primitives; vertices whose triangles have degenerate texture coordinates
+ receive a tangent perpendicular to their normal.
+ 
+ Positions, normals, and texture coordinates are read in place from 32-bit float
+ sources. Jobs run in parallel on a small pool of worker threads dedicated to
+ tangent generation. May be invoked from any thread.
+ */
+class VROTangentGenerator {
+public:
+    
+    /*
+     Generate the tangents of each of the given jobs in parallel, blocking until all
+     complete; the calling thread generates tangents while it waits. Unindexed jobs
+     are additionally split across threads by triangle. Returns false if any job's
+     sources do not have the same vertex count, in which case that job's tangents
+     are not written.
+     */
+    static bool generate(const std::vector<VROTangentJob> &jobs);
+    
+private:
+    
+    /*
+     Generate the tangents of the given range of triangles of an unindexed job. Each
+     vertex belongs to one triangle, so ranges may be generated concurrently.
+     */
+    static void generateUnindexed(const VROTangentJob &job, int firstTriangle, int lastTriangle);
+    
+    /*
+     Generate the tangents of an indexed job.
+     */
+    static void generateIndexed(const VROTangentJob &job);
+    
+    static bool isValid(const VROTangentJob &job);
+    
+};
+
+#endif /* VROTangentGenerator_h */
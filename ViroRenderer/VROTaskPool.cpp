@@ -0,0 +1,176 @@
+//
+//  VROTaskPool.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROTaskPool.h"
+#include "VROLog.h"
+#include <algorithm>
+
+// Bounds on the number of workers. Tasks may block on I/O, so we keep at
+// least two workers even on single-core devices
+static const int kMinTaskWorkers = 2;
+static const int kMaxTaskWorkers = 8;
+
+#if VRO_THREADS
+// The pool and queue index of the current thread, if it is a worker
+static thread_local VROTaskPool *tWorkerTaskPool = nullptr;
+static thread_local int tWorkerIndex = -1;
+#endif
+
+struct VROTask {
+    std::function<void()> function;
+    std::shared_ptr<VROTaskToken> token;
+};
+
+class VROTaskPoolQueue {
+public:
+    std::mutex mutex;
+    std::deque<VROTask> tasks[kNumTaskPriorities];
+};
+
+static int VROTaskPoolDefaultWorkerCount() {
+#if !VRO_THREADS
+    return 0;
+#else
+    int hardwareThreads = (int) std::thread::hardware_concurrency();
+    return std::max(kMinTaskWorkers, std::min(kMaxTaskWorkers, hardwareThreads));
+#endif
+}
+
+VROTaskPool::VROTaskPool() :
+    VROTaskPool(VROTaskPoolDefaultWorkerCount()) {
+
+}
+
+VROTaskPool::VROTaskPool(int numWorkers) :
+    _nextQueue(0),
+    _numQueuedTasks(0),
+    _shutdown(false) {
+
+#if !VRO_THREADS
+    numWorkers = 0;
+#endif
+    for (int i = 0; i < numWorkers; i++) {
+        _queues.emplace_back(new VROTaskPoolQueue());
+    }
+#if VRO_THREADS
+    for (int i = 0; i < numWorkers; i++) {
+        _workers.emplace_back(&VROTaskPool::workerLoop, this, i);
+    }
+#endif
+    pinfo("Task pool initialized with %d workers", numWorkers);
+}
+
+VROTaskPool::~VROTaskPool() {
+#if VRO_THREADS
+    {
+        std::lock_guard<std::mutex> lock(_idleMutex);
+        _shutdown = true;
+    }
+    _idleCondition.notify_all();
+    for (std::thread &worker : _workers) {
+        worker.join();
+    }
+#endif
+}
+
+std::shared_ptr<VROTaskToken> VROTaskPool::dispatch(std::function<void()> task, VROTaskPriority priority) {
+    std::shared_ptr<VROTaskToken> token = std::make_shared<VROTaskToken>();
+    if (_queues.empty()) {
+        task();
+        return token;
+    }
+
+    int index;
+#if VRO_THREADS
+    if (tWorkerTaskPool == this) {
+        index = tWorkerIndex;
+    }
+    else
+#endif
+    {
+        index = (int) (_nextQueue++ % _queues.size());
+    }
+
+    VROTaskPoolQueue *queue = _queues[index].get();
+    {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->tasks[(int) priority].push_back({ std::move(task), token });
+    }
+    {
+        std::lock_guard<std::mutex> lock(_idleMutex);
+        _numQueuedTasks++;
+    }
+    _idleCondition.notify_one();
+    return token;
+}
+
+bool VROTaskPool::findTask(int index, std::function<void()> *outTask, std::shared_ptr<VROTaskToken> *outToken) {
+    int numQueues = (int) _queues.size();
+
+    for (int priority = 0; priority < kNumTaskPriorities; priority++) {
+        // Check our own queue first, then steal from the others
+        for (int i = 0; i < numQueues; i++) {
+            VROTaskPoolQueue *queue = _queues[(index + i) % numQueues].get();
+            std::lock_guard<std::mutex> lock(queue->mutex);
+
+            std::deque<VROTask> &tasks = queue->tasks[priority];
+            if (!tasks.empty()) {
+                VROTask &task = tasks.front();
+                *outTask = std::move(task.function);
+                *outToken = std::move(task.token);
+                tasks.pop_front();
+                _numQueuedTasks--;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void VROTaskPool::workerLoop(int index) {
+#if VRO_THREADS
+    tWorkerTaskPool = this;
+    tWorkerIndex = index;
+
+    while (true) {
+        std::function<void()> task;
+        std::shared_ptr<VROTaskToken> token;
+        if (findTask(index, &task, &token)) {
+            if (!token->isCancelled()) {
+                task();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(_idleMutex);
+        _idleCondition.wait(lock, [this] {
+            return _shutdown || _numQueuedTasks > 0;
+        });
+        if (_shutdown) {
+            break;
+        }
+    }
+#endif
+}
@@ -0,0 +1,143 @@
+//
+//  VROTaskPool.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROTaskPool_h
+#define VROTaskPool_h
+
+#include <stdio.h>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include "VROAtomic.h"
+#include "VRODefines.h"
+
+#if VRO_THREADS
+#include <thread>
+#endif
+
+class VROTaskPoolQueue;
+
+/*
+ Priority of a task submitted to a VROTaskPool. Higher priority tasks are
+ always dequeued before lower priority tasks, across all workers.
+ */
+enum class VROTaskPriority {
+    High = 0,
+    Normal = 1,
+    Low = 2
+};
+static const int kNumTaskPriorities = 3;
+
+/*
+ Handle to a submitted task, used to cancel it. A task cancelled before it
+ starts is never run; a running task may poll isCancelled() to abort early.
+ */
+class VROTaskToken {
+public:
+    VROTaskToken() : _cancelled(false) {}
+
+    void cancel() {
+        _cancelled = true;
+    }
+    bool isCancelled() const {
+        return _cancelled;
+    }
+
+private:
+    VROAtomic<bool> _cancelled;
+};
+
+/*
+ Pool of native worker threads for fire-and-forget background tasks, such as
+ decoding textures or parsing model files. Unlike VROJobSystem, which runs
+ short CPU-bound jobs that are joined within a frame, tasks here are never
+ waited on and may block on I/O, so the pool keeps at least two workers
+ regardless of core count.
+
+ Each worker owns one queue per priority. Tasks submitted from a worker go
+ to that worker's queue, and tasks from other threads are distributed
+ round-robin. Idle workers steal from the other queues, taking the highest
+ priority task available anywhere before any lower priority task. Within a
+ priority, tasks run in submission order.
+
+ On platforms without threads (WebAssembly built without pthreads), tasks run
+ inline.
+ */
+class VROTaskPool {
+
+public:
+
+    VROTaskPool();
+    VROTaskPool(int numWorkers);
+    virtual ~VROTaskPool();
+
+    int getNumWorkers() const {
+        return (int) _queues.size();
+    }
+
+    /*
+     Submit a task at the given priority. The returned token can be used to
+     cancel the task.
+     */
+    std::shared_ptr<VROTaskToken> dispatch(std::function<void()> task,
+                                           VROTaskPriority priority = VROTaskPriority::Normal);
+
+private:
+
+    std::vector<std::unique_ptr<VROTaskPoolQueue>> _queues;
+
+#if VRO_THREADS
+    std::vector<std::thread> _workers;
+#endif
+
+    /*
+     Round-robin index used to distribute tasks submitted from threads
+     that are not workers of this pool.
+     */
+    VROAtomic<unsigned int> _nextQueue;
+
+    /*
+     Idle workers sleep on this condition variable; _numQueuedTasks is the
+     number of tasks waiting in all queues.
+     */
+    std::mutex _idleMutex;
+    std::condition_variable _idleCondition;
+    VROAtomic<int> _numQueuedTasks;
+    bool _shutdown;
+
+    void workerLoop(int index);
+
+    /*
+     Pop the highest priority task available, preferring the given worker's
+     own queue at each priority. Returns false if there is no work.
+     */
+    bool findTask(int index, std::function<void()> *outTask, std::shared_ptr<VROTaskToken> *outToken);
+
+};
+
+#endif /* VROTaskPool_h */
@@ -29,6 +29,9 @@
 #include "VROPlatformUtil.h"
 #include "VRODefines.h"
 #include "VROAllocationTracker.h"
+#include "VROProfiler.h"
+#include "VROTime.h"
+#include "VROStringUtil.h"
 #include <mutex>
 #include <algorithm>
 
@@ -55,10 +58,25 @@ void VROTaskQueue::printTaskQueues() {
 #endif
 }
 
+void VROTaskQueue::printOutstandingTasks() const {
+    for (const Task &task : _tasks) {
+        if (task.state == TaskState::Running) {
+            pinfo("      [%s] running", task.name.c_str());
+        }
+        else if (task.state == TaskState::Waiting) {
+            pinfo("      [%s] waiting on %d dependencies", task.name.c_str(), task.numOpenDependencies);
+        }
+    }
+}
+
 VROTaskQueue::VROTaskQueue(std::string name, VROTaskExecutionOrder executionOrder) :
     _started(false),
+    _executionOrder(executionOrder),
     _name(name),
-    _executionOrder(executionOrder) {
+    _numOpenTasks(0),
+    _numRunningTasks(0),
+    _startingTasks(false),
+    _restartRequested(false) {
         
     ALLOCATION_TRACKER_ADD(TaskQueues, 1);
 }
@@ -82,9 +100,30 @@ VROTaskQueue::~VROTaskQueue() {
 #endif
 }
 
-void VROTaskQueue::addTask(std::function<void()> task) {
+int VROTaskQueue::addTask(std::function<void()> task) {
     passert (!_started);
-    _tasks.push_back(task);
+    
+    int taskId = (int) _tasks.size();
+    _tasks.push_back({ "task " + VROStringUtil::toString(taskId), VROTaskThread::Renderer, true, task, {}, 0,
+                       TaskState::Waiting, 0, 0 });
+    return taskId;
+}
+
+int VROTaskQueue::addTask(std::string name, VROTaskThread thread, std::function<void()> work,
+                          std::vector<int> dependencies) {
+    passert (!_started);
+
+    int taskId = (int) _tasks.size();
+    _tasks.push_back({ name, thread, false, work, {}, 0, TaskState::Waiting, 0, 0 });
+
+    // Dependencies can only refer to tasks that were already added, which
+    // guarantees the graph is acyclic
+    for (int dependency : dependencies) {
+        passert (dependency >= 0 && dependency < taskId);
+        _tasks[dependency].dependents.push_back(taskId);
+        _tasks[taskId].numOpenDependencies++;
+    }
+    return taskId;
 }
 
 void VROTaskQueue::processTasksAsync(std::function<void()> onFinished) {
@@ -103,36 +142,171 @@ void VROTaskQueue::processTasksAsync(std::function<void()> onFinished) {
     // If there are no tasks, immediately call the onFinished handler
     if (_numOpenTasks == 0) {
         onFinished();
+        return;
     }
-    else if (_executionOrder == VROTaskExecutionOrder::Serial) {
-        // Perform one task at a time
-        std::function<void()> &task = _tasks.back();
-        task();
+
+    uint64_t now = VRONanoTime();
+    for (Task &task : _tasks) {
+        if (task.numOpenDependencies == 0) {
+            task.readyTimeNs = now;
+        }
+    }
+    startReadyTasks();
+}
+
+void VROTaskQueue::startReadyTasks() {
+    if (_startingTasks) {
+        _restartRequested = true;
+        return;
+    }
+    
+    _startingTasks = true;
+    do {
+        _restartRequested = false;
+        
+        if (_executionOrder == VROTaskExecutionOrder::Serial) {
+            // Perform one task at a time, most recently added first
+            if (_numRunningTasks > 0) {
+                break;
+            }
+            for (int i = (int) _tasks.size() - 1; i >= 0; i--) {
+                if (_tasks[i].state == TaskState::Waiting && _tasks[i].numOpenDependencies == 0) {
+                    startTask(i);
+                    break;
+                }
+            }
+        }
+        else {
+            // Fire off every task whose dependencies are satisfied
+            for (int i = 0; i < (int) _tasks.size(); i++) {
+                if (_tasks[i].state == TaskState::Waiting && _tasks[i].numOpenDependencies == 0) {
+                    startTask(i);
+                }
+            }
+        }
+    } while (_restartRequested && _numOpenTasks > 0);
+    _startingTasks = false;
+}
+
+void VROTaskQueue::startTask(int taskId) {
+    Task &task = _tasks[taskId];
+    task.state = TaskState::Running;
+    task.startTimeNs = VRONanoTime();
+    _numRunningTasks++;
+    
+    // Copy the work function, as it may complete (and the queue may finish
+    // and release its tasks) before it returns
+    std::function<void()> work = task.work;
+    if (task.async) {
+        _runningAsyncTasks.push_back(taskId);
+        work();
+        return;
+    }
+    
+    std::weak_ptr<VROTaskQueue> queue_w = shared_from_this();
+    std::string eventName = _name + ": " + task.name;
+    
+    if (task.thread == VROTaskThread::Renderer) {
+        VROPlatformDispatchAsyncRenderer([queue_w, taskId, work, eventName] {
+            uint64_t startTimeNs = VRONanoTime();
+            work();
+            uint64_t endTimeNs = VRONanoTime();
+            
+            if (VROProfiler::isEnabled()) {
+                VROProfiler::addCPUEvent(eventName, startTimeNs, endTimeNs);
+            }
+            std::shared_ptr<VROTaskQueue> queue = queue_w.lock();
+            if (queue) {
+                queue->completeTask(taskId, startTimeNs, endTimeNs);
+            }
+        });
     }
     else {
-        // Fire off all tasks at once
-        for (auto it = _tasks.begin(); it != _tasks.end(); ++it) {
-            std::function<void()> task = *it;
-            task();
+        std::function<void()> backgroundTask = [queue_w, taskId, work, eventName] {
+            uint64_t startTimeNs = VRONanoTime();
+            work();
+            uint64_t endTimeNs = VRONanoTime();
+            
+            if (VROProfiler::isEnabled()) {
+                VROProfiler::addCPUEvent(eventName, startTimeNs, endTimeNs);
+            }
+            VROPlatformDispatchAsyncRenderer([queue_w, taskId, startTimeNs, endTimeNs] {
+                std::shared_ptr<VROTaskQueue> queue = queue_w.lock();
+                if (queue) {
+                    queue->completeTask(taskId, startTimeNs, endTimeNs);
+                }
+            });
+        };
+        
+        if (task.thread == VROTaskThread::Worker) {
+            VROPlatformDispatchAsyncWorker(backgroundTask);
+        }
+        else {
+            VROPlatformDispatchAsyncBackground(backgroundTask);
         }
     }
 }
 
 void VROTaskQueue::onTaskComplete() {
+    if (_runningAsyncTasks.empty()) {
+        pwarn("Task queue [%s] received completion with no running asynchronous tasks", _name.c_str());
+        return;
+    }
+    onTaskComplete(_runningAsyncTasks.front());
+}
+
+void VROTaskQueue::onTaskComplete(int taskId) {
+    auto it = std::find(_runningAsyncTasks.begin(), _runningAsyncTasks.end(), taskId);
+    if (it == _runningAsyncTasks.end()) {
+        pwarn("Task queue [%s] received completion for task %d, which is not running", _name.c_str(), taskId);
+        return;
+    }
+    _runningAsyncTasks.erase(it);
+    completeTask(taskId, _tasks[taskId].startTimeNs, VRONanoTime());
+}
+
+void VROTaskQueue::completeTask(int taskId, uint64_t startTimeNs, uint64_t endTimeNs) {
+    Task &task = _tasks[taskId];
+    passert (task.state == TaskState::Running);
+    
+    task.state = TaskState::Complete;
+    _timings.push_back({ task.name, task.thread, task.readyTimeNs, startTimeNs, endTimeNs });
+    _numRunningTasks--;
     _numOpenTasks--;
+    
+    for (int dependent : task.dependents) {
+        Task &dependentTask = _tasks[dependent];
+        dependentTask.numOpenDependencies--;
+        if (dependentTask.numOpenDependencies == 0) {
+            dependentTask.readyTimeNs = endTimeNs;
+        }
+    }
+    
     if (_numOpenTasks == 0) {
-        _onFinished();
+#if kDebugTaskQueues
+        uint64_t queueStartNs = _timings.front().readyTimeNs;
+        pinfo("Task queue [%s] completed %d tasks in %f ms", _name.c_str(), (int) _timings.size(),
+              (endTimeNs - queueStartNs) / 1000000.0);
+        for (const VROTaskTiming &timing : _timings) {
+            pinfo("   [%s] waited %f ms, ran %f ms", timing.name.c_str(),
+                  (timing.startTimeNs - timing.readyTimeNs) / 1000000.0,
+                  (timing.endTimeNs - timing.startTimeNs) / 1000000.0);
+        }
+#endif
+        
+        // Release the work functions after we're done: this is important because tasks
+        // will often hold a reference back to their parent task queue, so that they can
+        // invoke onTaskComplete(). Because of this we have to explicitly clear the tasks
+        // out to ensure any strong ref cycles are removed.
+        for (Task &t : _tasks) {
+            t.work = nullptr;
+        }
         
-        // Clear the tasks after we're done: this is important because tasks will often
-        // hold a reference back to their parent task queue, so that they can invoke
-        // onTaskComplete(). Because of this we have to explicitly clear the tasks out
-        // to ensure any strong ref cycles are removed.
-        _tasks.clear();
-    }
-    else if (_executionOrder == VROTaskExecutionOrder::Serial) {
-        // Fire off the next task
-        _tasks.pop_back();
-        std::function<void()> &task = _tasks.back();
-        task();
+        std::function<void()> onFinished = _onFinished;
+        _onFinished = nullptr;
+        onFinished();
+    }
+    else {
+        startReadyTasks();
     }
 }
@@ -29,9 +29,12 @@
 
 #include <stdio.h>
 #include <queue>
+#include <deque>
+#include <vector>
 #include <string>
 #include <memory>
 #include <functional>
+#include <stdint.h>
 
 #define kDebugTaskQueues 0
 
@@ -43,11 +46,40 @@ enum class VROTaskExecutionOrder {
     Concurrent
 };
 
+/*
+ The thread on which a synchronous task's work is run. Worker tasks run on the
+ native worker pool and must not touch the JVM; Background tasks run on the
+ platform background queue, which may.
+ */
+enum class VROTaskThread {
+    Renderer,
+    Background,
+    Worker
+};
+
+/*
+ Timing of a task that has completed, in nanoseconds from VRONanoTime().
+ Tasks queued in a Concurrent queue begin waiting when processTasksAsync is
+ invoked or when their last dependency completes.
+ */
+struct VROTaskTiming {
+    std::string name;
+    VROTaskThread thread;
+    uint64_t readyTimeNs;
+    uint64_t startTimeNs;
+    uint64_t endTimeNs;
+};
+
 /*
  Task queue accumulates async tasks on the rendering thread, then signals
  the rendering thread upon the completion of all tasks. This is useful when
  we have to wait on a batch of background tasks to complete (e.g., downloading
  textures) before performing some action.
+
+ Tasks may depend on other tasks in the queue, forming a DAG: a task is not
+ started until all of its dependencies have completed. Concurrent queues start
+ every task whose dependencies are satisfied at once; Serial queues run one
+ task at a time, favoring the most recently added ready task.
  */
 class VROTaskQueue : public std::enable_shared_from_this<VROTaskQueue> {
 public:
@@ -58,11 +90,22 @@ public:
     /*
      Add a task to the queue. The task should be some function that executes
      asynchronously then, when done, invokes onTaskComplete() on this queue.
-     Tasks cannot be added after processTasksAsync has been invoked.
+     Tasks cannot be added after processTasksAsync has been invoked. Returns
+     the ID of the task, which can be used as a dependency of other tasks.
      
      Must be invoked on the rendering thread.
      */
-    void addTask(std::function<void()> task);
+    int addTask(std::function<void()> task);
+
+    /*
+     Add a synchronous task, which is complete as soon as its work function
+     returns; it should not invoke onTaskComplete(). The work is run on the
+     given thread once every task in dependencies has completed.
+
+     Must be invoked on the rendering thread.
+     */
+    int addTask(std::string name, VROTaskThread thread, std::function<void()> work,
+                std::vector<int> dependencies = {});
     
     /*
      Begin processing all the tasks. Invokes the onFinished callback function on
@@ -73,11 +116,21 @@ public:
     void processTasksAsync(std::function<void()> onFinished);
     
     /*
-     Tasks should invoke this method when they are complete.
+     Asynchronous tasks should invoke this method when they are complete. The
+     variant without an ID completes the earliest started task that remains
+     open; tasks in Concurrent queues that have dependents should pass their ID.
      
      Must be invoked on the rendering thread.
      */
     void onTaskComplete();
+    void onTaskComplete(int taskId);
+
+    /*
+     Get the timing of each task that has completed, in completion order.
+     */
+    const std::vector<VROTaskTiming> &getTaskTimings() const {
+        return _timings;
+    }
 
     /*
      Debug method to print the names of task queues that have started but
@@ -86,13 +139,53 @@ public:
     static void printTaskQueues();
     
 private:
+
+    enum class TaskState {
+        Waiting,
+        Running,
+        Complete
+    };
+
+    struct Task {
+        std::string name;
+        VROTaskThread thread;
+        bool async;
+        std::function<void()> work;
+        std::vector<int> dependents;
+        int numOpenDependencies;
+        TaskState state;
+        uint64_t readyTimeNs;
+        uint64_t startTimeNs;
+    };
     
     bool _started;
     VROTaskExecutionOrder _executionOrder;
     std::string _name;
-    std::vector<std::function<void()>> _tasks;
+    std::vector<Task> _tasks;
     int _numOpenTasks;
+    int _numRunningTasks;
     std::function<void()> _onFinished;
+
+    /*
+     IDs of the asynchronous tasks that are running, in the order they were
+     started.
+     */
+    std::deque<int> _runningAsyncTasks;
+
+    /*
+     Starting a task can complete it immediately (e.g. an asynchronous task
+     that finds its result cached), which re-enters startReadyTasks. These
+     flags collapse such nested calls into the outermost one.
+     */
+    bool _startingTasks;
+    bool _restartRequested;
+
+    std::vector<VROTaskTiming> _timings;
+
+    void startReadyTasks();
+    void startTask(int taskId);
+    void completeTask(int taskId, uint64_t startTimeNs, uint64_t endTimeNs);
+    void printOutstandingTasks() const;
     
 };
 
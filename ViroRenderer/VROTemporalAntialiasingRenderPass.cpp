@@ -0,0 +1,270 @@
+//
+//  VROTemporalAntialiasingRenderPass.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include "VROTemporalAntialiasingRenderPass.h"
+#include "VRODriver.h"
+#include "VROImagePostProcess.h"
+#include "VROImageShaderProgram.h"
+#include "VRORenderContext.h"
+#include "VROOpenGL.h"
+#include "VRORenderTarget.h"
+#include "VROShaderModifier.h"
+#include "VROMaterial.h"
+#include "VROGeometry.h"
+#include "VROStringUtil.h"
+#include "VROViewport.h"
+#include "VROEye.h"
+#include "VROLog.h"
+
+static thread_local std::shared_ptr<VROShaderModifier> sVelocityModifier;
+
+/*
+ The reprojection uniforms of the frame being rendered. Each maps the NDC of a
+ fragment this frame to its clip space position in the previous frame.
+ */
+static thread_local VROMatrix4f sReprojection;
+static thread_local VROMatrix4f sEnclosureReprojection;
+
+/*
+ The jitter of the frame being rendered in NDC (xy), and the inverse size of
+ the HDR target (zw).
+ */
+static thread_local VROVector4f sJitter;
+
+static float VROHalton(int index, int base) {
+    float result = 0;
+    float fraction = 1.0f / base;
+    while (index > 0) {
+        result += fraction * (index % base);
+        index /= base;
+        fraction /= base;
+    }
+    return result;
+}
+
+VROTemporalAntialiasingRenderPass::VROTemporalAntialiasingRenderPass() :
+    _jitterX(0),
+    _jitterY(0),
+    _historyWeight(0) {
+    for (int i = 0; i < 3; i++) {
+        _historyValid[i] = false;
+        _lastFrame[i] = -1;
+    }
+}
+
+VROTemporalAntialiasingRenderPass::~VROTemporalAntialiasingRenderPass() {
+}
+
+void VROTemporalAntialiasingRenderPass::createRenderTargets(std::shared_ptr<VRODriver> &driver) {
+    for (int i = 0; i < 3; i++) {
+        _history[i] = driver->newRenderTarget(VRORenderTargetType::ColorTextureHDR16, 1, 1, false, false);
+    }
+    _scratch = driver->newRenderTarget(VRORenderTargetType::ColorTextureHDR16, 1, 1, false, false);
+    invalidateHistory();
+}
+
+void VROTemporalAntialiasingRenderPass::resetRenderTargets() {
+    for (int i = 0; i < 3; i++) {
+        _history[i].reset();
+    }
+    _scratch.reset();
+    invalidateHistory();
+}
+
+void VROTemporalAntialiasingRenderPass::setViewport(VROViewport rtViewport) {
+    // The history is kept when only the (scaled) resolution of the scene changes
+    VROViewport viewport(0, 0, rtViewport.getWidth(), rtViewport.getHeight());
+    bool changed = false;
+    for (int i = 0; i < 3; i++) {
+        if (_history[i]) {
+            changed |= _history[i]->setViewport(viewport);
+        }
+    }
+    if (_scratch) {
+        changed |= _scratch->setViewport(viewport);
+    }
+    if (changed) {
+        invalidateHistory();
+    }
+}
+
+void VROTemporalAntialiasingRenderPass::invalidateHistory() {
+    for (int i = 0; i < 3; i++) {
+        _historyValid[i] = false;
+    }
+}
+
+void VROTemporalAntialiasingRenderPass::beginFrame(VRORenderContext *context, int width, int height) {
+    int eye = (int) context->getEyeType();
+    int frame = context->getFrame();
+    if (_lastFrame[eye] != frame - 1) {
+        _historyValid[eye] = false;
+    }
+    _lastFrame[eye] = frame;
+    
+    // Offset the projection by up to half a pixel in each direction; the offset is
+    // applied in NDC, after the perspective divide, so it is constant across depth
+    int sample = (frame % kTemporalAAJitterSamples) + 1;
+    float jitterX = (VROHalton(sample, 2) - 0.5f) * 2.0f / std::max(width, 1);
+    float jitterY = (VROHalton(sample, 3) - 0.5f) * 2.0f / std::max(height, 1);
+    
+    VROMatrix4f jitter = VROMatrix4f::identity();
+    jitter[12] = jitterX;
+    jitter[13] = jitterY;
+    
+    const VROMatrix4f projection = context->getProjectionMatrix();
+    VROMatrix4f jitteredProjection = jitter.multiply(projection);
+    
+    VROMatrix4f viewProjection = projection.multiply(context->getViewMatrix());
+    VROMatrix4f enclosureViewProjection = projection.multiply(context->getEnclosureViewMatrix());
+    if (!_historyValid[eye]) {
+        _previousViewProjection[eye] = viewProjection;
+        _previousEnclosureViewProjection[eye] = enclosureViewProjection;
+    }
+    
+    sReprojection = _previousViewProjection[eye].multiply(jitteredProjection.multiply(context->getViewMatrix()).invert());
+    sEnclosureReprojection = _previousEnclosureViewProjection[eye].multiply(
+        jitteredProjection.multiply(context->getEnclosureViewMatrix()).invert());
+    sJitter = VROVector4f(jitterX, jitterY, 1.0f / std::max(width, 1), 1.0f / std::max(height, 1));
+    
+    _previousViewProjection[eye] = viewProjection;
+    _previousEnclosureViewProjection[eye] = enclosureViewProjection;
+    
+    _jitterX = jitterX * 0.5f;
+    _jitterY = jitterY * 0.5f;
+    _historyWeight = _historyValid[eye] ? kTemporalAAHistoryWeight : 0.0f;
+    context->setProjectionMatrix(jitteredProjection);
+}
+
+std::shared_ptr<VROShaderModifier> VROTemporalAntialiasingRenderPass::getVelocityModifier() {
+    /*
+     Reconstructs the NDC of each fragment from its window coordinates and depth,
+     reprojects it into the previous frame, and writes the difference (with the
+     jitter removed) in UV units.
+     */
+    if (!sVelocityModifier) {
+        std::vector<std::string> modifierCode = {
+            "layout (location = " + VROStringUtil::toString(kTemporalAAVelocityAttachment) + ") out highp vec4 _velocity;",
+            "uniform highp mat4 taa_reprojection;",
+            "uniform highp vec4 taa_jitter;",
+            "highp vec4 taa_ndc = vec4(gl_FragCoord.xy * taa_jitter.zw * 2.0 - 1.0, gl_FragCoord.z * 2.0 - 1.0, 1.0);",
+            "highp vec4 taa_previous = taa_reprojection * taa_ndc;",
+            "_velocity = vec4((taa_ndc.xy - taa_jitter.xy - taa_previous.xy / taa_previous.w) * 0.5, 0.0, 1.0);",
+        };
+        sVelocityModifier = std::make_shared<VROShaderModifier>(VROShaderEntryPoint::Fragment, modifierCode);
+        sVelocityModifier->setUniformBinder("taa_reprojection", VROShaderProperty::Mat4,
+                                            [](VROUniform *uniform,
+                                               const VROGeometry *geometry, const VROMaterial *material) {
+            if (geometry != nullptr && geometry->isCameraEnclosure()) {
+                uniform->setMat4(sEnclosureReprojection);
+            }
+            else {
+                uniform->setMat4(sReprojection);
+            }
+        });
+        sVelocityModifier->setUniformBinder("taa_jitter", VROShaderProperty::Vec4,
+                                            [](VROUniform *uniform,
+                                               const VROGeometry *geometry, const VROMaterial *material) {
+            uniform->setVec4(sJitter);
+        });
+        sVelocityModifier->setName("taaVelocity");
+    }
+    return sVelocityModifier;
+}
+
+void VROTemporalAntialiasingRenderPass::initPostProcess(std::shared_ptr<VRODriver> driver) {
+    /*
+     The current frame is sampled with the jitter removed. The history is read
+     along the velocity and clamped to the range of the 3x3 neighborhood of the
+     current frame, which rejects history that is no longer visible.
+     */
+    std::vector<std::string> samplers = { "current_texture", "velocity_texture", "history_texture" };
+    std::vector<std::string> code = {
+        "uniform sampler2D current_texture;",
+        "uniform sampler2D velocity_texture;",
+        "uniform sampler2D history_texture;",
+        "uniform highp vec4 taa_resolve;",
+        "highp vec2 current_uv = v_texcoord + taa_resolve.xy;",
+        "highp vec2 texel = 1.0 / vec2(textureSize(current_texture, 0));",
+        "highp vec4 current = texture(current_texture, current_uv);",
+        "frag_color = current;",
+        "highp vec2 history_uv = v_texcoord - texture(velocity_texture, current_uv).xy;",
+        "if (taa_resolve.z > 0.0 && all(greaterThanEqual(history_uv, vec2(0.0))) && all(lessThanEqual(history_uv, vec2(1.0)))) {",
+        "    highp vec3 neighborhood_min = current.rgb;",
+        "    highp vec3 neighborhood_max = current.rgb;",
+        "    for (int x = -1; x <= 1; x++) {",
+        "        for (int y = -1; y <= 1; y++) {",
+        "            highp vec3 neighbor = texture(current_texture, current_uv + vec2(float(x), float(y)) * texel).rgb;",
+        "            neighborhood_min = min(neighborhood_min, neighbor);",
+        "            neighborhood_max = max(neighborhood_max, neighbor);",
+        "        }",
+        "    }",
+        "    highp vec4 history = texture(history_texture, history_uv);",
+        "    history.rgb = clamp(history.rgb, neighborhood_min, neighborhood_max);",
+        "    frag_color = mix(current, history, taa_resolve.z);",
+        "}",
+    };
+    
+    std::shared_ptr<VROShaderModifier> modifier = std::make_shared<VROShaderModifier>(VROShaderEntryPoint::Image, code);
+    modifier->setUniformBinder("taa_resolve", VROShaderProperty::Vec4,
+                               [this] (VROUniform *uniform,
+                                       const VROGeometry *geometry, const VROMaterial *material) {
+        uniform->setVec4({ _jitterX, _jitterY, _historyWeight, 0 });
+    });
+    
+    std::vector<std::shared_ptr<VROShaderModifier>> modifiers = { modifier };
+    std::shared_ptr<VROImageShaderProgram> shader = std::make_shared<VROImageShaderProgram>(samplers, modifiers, driver);
+    _resolve = driver->newImagePostProcess(shader);
+}
+
+void VROTemporalAntialiasingRenderPass::render(std::shared_ptr<VROScene> scene,
+                                               std::shared_ptr<VROScene> outgoingScene,
+                                               VRORenderPassInputOutput &inputs,
+                                               VRORenderContext *context, std::shared_ptr<VRODriver> &driver) {
+    passert (_scratch);
+    if (!_resolve) {
+        initPostProcess(driver);
+    }
+    
+    int eye = (int) context->getEyeType();
+    std::shared_ptr<VRORenderTarget> &history = _history[eye];
+    if (!history->hydrate() || !_scratch->hydrate()) {
+        pinfo("Failed to hydrate temporal anti-aliasing history");
+    }
+    
+    pglpush("Temporal AA");
+    driver->setBlendingMode(VROBlendMode::None);
+    driver->bindRenderTarget(_scratch, VRORenderTargetActions::overwrite(), VRORenderTargetUnbindOp::Invalidate);
+    _resolve->blit({ inputs.textures[kTemporalAAInput], inputs.textures[kTemporalAAVelocityInput],
+                     history->getTexture(0) }, driver);
+    driver->setBlendingMode(VROBlendMode::Alpha);
+    pglpop();
+    
+    // The resolved frame becomes the history of this eye
+    std::swap(history, _scratch);
+    _historyValid[eye] = true;
+    inputs.outputTarget = history;
+}
@@ -0,0 +1,155 @@
+//
+//  VROTemporalAntialiasingRenderPass.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef VROTemporalAntialiasingRenderPass_h
+#define VROTemporalAntialiasingRenderPass_h
+
+#include "VRORenderPass.h"
+#include "VROMatrix4f.h"
+
+class VRODriver;
+class VROImagePostProcess;
+class VROShaderModifier;
+class VROViewport;
+
+/*
+ Keys for the temporal anti-aliasing render pass: the (jittered) scene color and
+ the velocity attachment of the HDR target.
+ */
+const std::string kTemporalAAInput = "TAA_Input";
+const std::string kTemporalAAVelocityInput = "TAA_Velocity";
+
+/*
+ The HDR target attachment to which the velocity of each fragment is written
+ while temporal anti-aliasing is enabled.
+ */
+static const int kTemporalAAVelocityAttachment = 4;
+
+/*
+ The number of sub-pixel jitter offsets cycled through, from the (2, 3) Halton
+ sequence.
+ */
+static const int kTemporalAAJitterSamples = 8;
+
+/*
+ The weight of the reprojected history in each resolved frame.
+ */
+static const float kTemporalAAHistoryWeight = 0.9;
+
+/*
+ Temporal anti-aliasing and upsampling. Each frame the projection is jittered by
+ a sub-pixel offset, and the scene writes the screen-space motion of each
+ fragment to the velocity attachment. This pass then reprojects the resolved
+ result of the previous frame along that motion, clamps it to the neighborhood
+ of the current frame to reject stale history, and blends the two.
+
+ The history is held at the resolution of the display, so when the HDR target
+ is rendered at a lower resolution (see VROChoreographer's dynamic resolution)
+ the jittered frames accumulate into a full resolution image.
+
+ The result resides in the history of the eye being rendered, and is output
+ through inputs.outputTarget.
+ */
+class VROTemporalAntialiasingRenderPass : public VRORenderPass {
+public:
+    
+    VROTemporalAntialiasingRenderPass();
+    virtual ~VROTemporalAntialiasingRenderPass();
+    
+    /*
+     Jitter the projection of the given context for the coming frame, and update
+     the reprojection uniforms read by the velocity modifier. The width and
+     height are those of the (scaled) HDR target. Must be invoked before the
+     scene is rendered; the caller restores the projection after.
+     */
+    void beginFrame(VRORenderContext *context, int width, int height);
+    
+    void render(std::shared_ptr<VROScene> scene,
+                std::shared_ptr<VROScene> outgoingScene,
+                VRORenderPassInputOutput &inputs,
+                VRORenderContext *context, std::shared_ptr<VRODriver> &driver);
+    
+    /*
+     Functions for handling the history render targets. The viewport is that of
+     the display.
+     */
+    void createRenderTargets(std::shared_ptr<VRODriver> &driver);
+    void resetRenderTargets();
+    void setViewport(VROViewport viewport);
+    
+    /*
+     Discard the history of each eye, so that the next frame is resolved from
+     the current frame alone. Used on camera cuts and target changes.
+     */
+    void invalidateHistory();
+    
+    /*
+     The fragment modifier that writes the velocity of each fragment to
+     kTemporalAAVelocityAttachment. Velocities are derived from the depth of
+     the fragment and the motion of the camera.
+     */
+    static std::shared_ptr<VROShaderModifier> getVelocityModifier();
+    
+private:
+    
+    /*
+     The resolved history of each eye (indexed by VROEyeType), and the target
+     the next resolve is written to. After each resolve the scratch target and
+     the history of the eye are swapped.
+     */
+    std::shared_ptr<VRORenderTarget> _history[3];
+    std::shared_ptr<VRORenderTarget> _scratch;
+    
+    /*
+     True if the history of each eye holds the previous frame, and the frame it
+     was last rendered.
+     */
+    bool _historyValid[3];
+    int _lastFrame[3];
+    
+    /*
+     The unjittered view projection of the previous frame of each eye, for
+     standard and camera enclosure geometry.
+     */
+    VROMatrix4f _previousViewProjection[3];
+    VROMatrix4f _previousEnclosureViewProjection[3];
+    
+    /*
+     The jitter of the current frame, in UV units.
+     */
+    float _jitterX, _jitterY;
+    
+    /*
+     The weight of the history in the current resolve.
+     */
+    float _historyWeight;
+    
+    std::shared_ptr<VROImagePostProcess> _resolve;
+    void initPostProcess(std::shared_ptr<VRODriver> driver);
+    
+};
+
+#endif /* VROTemporalAntialiasingRenderPass_h */
@@ -34,13 +34,21 @@
 #include "VROLog.h"
 #include <cstddef>
 #include <limits>
+#include <algorithm>
+#include <tuple>
 #include "VROTextFormatter.h"
 #include "VROStringUtil.h"
 #include "VROGlyphAtlas.h"
+#include "VROShaderModifier.h"
 #include <ft2build.h>
 #include FT_FREETYPE_H
 
 static const int kVerticesPerGlyph = 6;
+static const int kDynamicTextBuilds = 3;
+static const int kMaxSynchronousGlyphLoads = 32;
+static const int kMaxSynchronousVectorGlyphLoads = 4;
+static std::shared_ptr<VROShaderModifier> sDistanceFieldModifier;
+static std::shared_ptr<VROShaderModifier> sDistanceFieldOutlineModifier;
 
 std::shared_ptr<VROText> VROText::createText(std::wstring text,
                                              std::string typefaceNames,
@@ -186,7 +194,11 @@ VROText::VROText(std::wstring text,
     _outerStroke(stroke),
     _outerStrokeWidth(strokeWidth),
     _outerStrokeColor(strokeColor),
-    _driver(driver) {
+    _distanceField(false),
+    _distanceFieldOutlineEdge(0.5),
+    _driver(driver),
+    _numBuilds(0),
+    _pendingGlyphLoads(0) {
 
 }
 
@@ -204,20 +216,43 @@ void VROText::update() {
     std::vector<std::shared_ptr<VROGeometryElement>> elements;
     std::vector<std::shared_ptr<VROMaterial>> materials;
 
-    _typefaceCollection = driver->newTypefaceCollection(_typefaceNames, _size, _fontStyle, _fontWeight);
+    // The typeface collection is only reloaded when the typefaces change (see setTypefaces)
+    if (!_typefaceCollection) {
+        _typefaceCollection = driver->newTypefaceCollection(_typefaceNames, _size, _fontStyle, _fontWeight);
+    }
+
+    if (_pendingGlyphLoads > 0 || preloadGlyphsAsync()) {
+        return;
+    }
 
     float realizedWidth = 0, realizedHeight = 0;
     if (_extrusion > 0.0001) {
         buildVectorizedText(_text, _typefaceCollection, _color, _extrusion, _width, _height, _horizontalAlignment, _verticalAlignment,
                             _lineBreakMode, _clipMode, _maxLines, getMaterials(), sources, elements, materials,
                             &realizedWidth, &realizedHeight, driver);
+        _glyphMaterials.clear();
+        _outlineMaterials.clear();
     }
     else {
+        if (_distanceField && _outerStroke != VROTextOuterStroke::None) {
+            // The stroke width, converted into distance field texels, moves the edge
+            // threshold out from the glyph's 0.5 contour
+            float strokeTexels = _outerStrokeWidth * (float) kDistanceFieldGlyphSize / (float) _size;
+            _distanceFieldOutlineEdge = std::max(0.5f - strokeTexels / (2.0f * kDistanceFieldSpread), 0.01f);
+        }
         buildBitmapText(_text, _typefaceCollection, _color, _outerStroke, _outerStrokeWidth, _outerStrokeColor,
-                        _width, _height, _horizontalAlignment, _verticalAlignment,
-                        _lineBreakMode, _clipMode, _maxLines, sources, elements, materials,
-                        &realizedWidth, &realizedHeight, driver);
+                        _distanceField, _width, _height, _horizontalAlignment, _verticalAlignment,
+                        _lineBreakMode, _clipMode, _maxLines, _glyphMaterials, _outlineMaterials,
+                        sources, elements, materials, &realizedWidth, &realizedHeight, driver);
+        
+        // Flat text that keeps being rebuilt (e.g. a live-updating label) becomes dynamic,
+        // so that its new vertices and indices are written into its existing buffers.
+        // Other text stays static, where it can be multi-drawn with other labels
+        if (_numBuilds >= kDynamicTextBuilds) {
+            setDynamic(true);
+        }
     }
+    ++_numBuilds;
 
     _realizedWidth = realizedWidth;
     _realizedHeight = realizedHeight;
@@ -228,71 +263,192 @@ void VROText::update() {
     updateBoundingBox();
 }
 
+bool VROText::preloadGlyphsAsync() {
+    // Vector glyphs are triangulated when loaded, so far fewer are loaded synchronously
+    bool vectorized = _extrusion > 0.0001;
+    VROGlyphRenderMode renderMode = _distanceField ? VROGlyphRenderMode::DistanceField : VROGlyphRenderMode::Bitmap;
+    uint32_t outlineWidth = (_outerStroke != VROTextOuterStroke::None && !_distanceField) ? _outerStrokeWidth : 0;
+    int maxSynchronousLoads = kMaxSynchronousGlyphLoads;
+    if (vectorized) {
+        renderMode = VROGlyphRenderMode::Vector;
+        outlineWidth = 0;
+        maxSynchronousLoads = kMaxSynchronousVectorGlyphLoads;
+    }
+    
+    // Gather the glyphs missing from each typeface's atlases
+    std::map<std::shared_ptr<VROTypeface>, std::vector<uint32_t>> missingGlyphs;
+    int numMissing = 0;
+    
+    std::vector<VROFontRun> fontRuns = _typefaceCollection->computeRuns(_text);
+    for (VROFontRun &fontRun : fontRuns) {
+        std::vector<uint32_t> &codePoints = missingGlyphs[fontRun.typeface];
+        for (int i = fontRun.start; i < fontRun.end; i++) {
+            uint32_t codePoint = _text.at(i);
+            if (!fontRun.typeface->isGlyphLoaded(codePoint, 0, outlineWidth, renderMode) &&
+                std::find(codePoints.begin(), codePoints.end(), codePoint) == codePoints.end()) {
+                codePoints.push_back(codePoint);
+                ++numMissing;
+            }
+        }
+    }
+    if (numMissing <= maxSynchronousLoads) {
+        return false;
+    }
+    
+    std::weak_ptr<VROText> text_w = std::static_pointer_cast<VROText>(shared_from_this());
+    for (auto &kv : missingGlyphs) {
+        if (kv.second.empty()) {
+            continue;
+        }
+        ++_pendingGlyphLoads;
+        VROTypeface::preloadGlyphsAsync(kv.first, kv.second, outlineWidth, renderMode, [text_w] {
+            std::shared_ptr<VROText> text = text_w.lock();
+            if (text && --text->_pendingGlyphLoads == 0) {
+                text->update();
+            }
+        });
+    }
+    return true;
+}
+
 void VROText::setText(std::wstring text) {
+    if (_numBuilds > 0 && text == _text) {
+        return;
+    }
     _text = text;
     update();
 }
 
 void VROText::setTypefaces(std::string typefaceNames, int size, VROFontStyle style, VROFontWeight weight) {
+    if (typefaceNames == _typefaceNames && size == _size && style == _fontStyle && weight == _fontWeight &&
+        _typefaceCollection) {
+        return;
+    }
     _typefaceNames = typefaceNames;
     _size = size;
     _fontStyle = style;
     _fontWeight = weight;
+    _typefaceCollection.reset();
     update();
 }
 
 void VROText::setColor(VROVector4f color) {
     _color = color;
-    update();
+    if (!swapMaterials(_glyphMaterials, color, false)) {
+        update();
+    }
 }
 
 void VROText::setExtrusion(float extrusion) {
+    if (_numBuilds > 0 && extrusion == _extrusion) {
+        return;
+    }
     _extrusion = extrusion;
     update();
 }
 
 void VROText::setOuterStroke(VROTextOuterStroke stroke, int outerStrokeWidth, VROVector4f outerStrokeColor) {
+    // Changing only the color of the stroke does not change the geometry
+    if (stroke == _outerStroke && outerStrokeWidth == _outerStrokeWidth && stroke != VROTextOuterStroke::None) {
+        _outerStrokeColor = outerStrokeColor;
+        if (swapMaterials(_outlineMaterials, outerStrokeColor, true)) {
+            return;
+        }
+    }
     _outerStroke = stroke;
     _outerStrokeWidth = outerStrokeWidth;
     _outerStrokeColor = outerStrokeColor;
     update();
 }
 
+void VROText::setDistanceField(bool distanceField) {
+    if (distanceField == _distanceField) {
+        return;
+    }
+    _distanceField = distanceField;
+    update();
+}
+
 void VROText::setWidth(float width) {
+    if (_numBuilds > 0 && width == _width) {
+        return;
+    }
     _width = width;
     update();
 }
 
 void VROText::setHeight(float height) {
+    if (_numBuilds > 0 && height == _height) {
+        return;
+    }
     _height = height;
     update();
 }
 
 void VROText::setHorizontalAlignment(VROTextHorizontalAlignment horizontalAlignment) {
+    if (_numBuilds > 0 && horizontalAlignment == _horizontalAlignment) {
+        return;
+    }
     _horizontalAlignment = horizontalAlignment;
     update();
 }
 
 void VROText::setVerticalAlignment(VROTextVerticalAlignment verticalAlignment) {
+    if (_numBuilds > 0 && verticalAlignment == _verticalAlignment) {
+        return;
+    }
     _verticalAlignment = verticalAlignment;
     update();
 }
 
 void VROText::setLineBreakMode(VROLineBreakMode lineBreakMode) {
+    if (_numBuilds > 0 && lineBreakMode == _lineBreakMode) {
+        return;
+    }
     _lineBreakMode = lineBreakMode;
     update();
 }
 
 void VROText::setClipMode(VROTextClipMode clipMode) {
+    if (_numBuilds > 0 && clipMode == _clipMode) {
+        return;
+    }
     _clipMode = clipMode;
     update();
 }
 
 void VROText::setMaxLines(int maxLines) {
+    if (_numBuilds > 0 && maxLines == _maxLines) {
+        return;
+    }
     _maxLines = maxLines;
     update();
 }
 
+bool VROText::swapMaterials(std::map<std::shared_ptr<VROGlyphAtlas>, std::shared_ptr<VROMaterial>> &textMaterials,
+                            VROVector4f color, bool outline) {
+    // Only valid while the given materials are the ones installed on this text
+    std::vector<std::shared_ptr<VROMaterial>> materials = getMaterials();
+    if (textMaterials.empty() || materials.empty()) {
+        return false;
+    }
+    for (auto &kv : textMaterials) {
+        if (std::find(materials.begin(), materials.end(), kv.second) == materials.end()) {
+            return false;
+        }
+    }
+    
+    // The geometry is unchanged; each element moves to the shared material of the new color
+    for (auto &kv : textMaterials) {
+        std::shared_ptr<VROMaterial> material = getTextMaterial(kv.first, color, outline, _distanceField);
+        material->getDiffuse().swapTexture(kv.first->getTexture());
+        std::replace(materials.begin(), materials.end(), kv.second, material);
+        kv.second = material;
+    }
+    setMaterials(materials);
+    return true;
+}
+
 void VROText::setMaterials(std::vector<std::shared_ptr<VROMaterial>> materials) {
     VROGeometry::setMaterials(materials);
     if (materials.size() > 0) {
@@ -300,16 +456,112 @@ void VROText::setMaterials(std::vector<std::shared_ptr<VROMaterial>> materials)
     }
 }
 
+/*
+ Distance field glyphs store 0.5 at the glyph contour, falling off linearly to
+ 0 and 1 across kDistanceFieldSpread texels to either side. The fill modifier
+ thresholds at the contour; the outline modifier thresholds at the edge set by
+ the stroke width. Both antialias over one screen pixel using the derivative of
+ the field, so the result stays sharp at any size.
+ */
+static std::shared_ptr<VROShaderModifier> getDistanceFieldModifier() {
+    if (!sDistanceFieldModifier) {
+        std::vector<std::string> modifierCode = {
+            "highp float sdf_w = max(fwidth(rg_color.g) * 0.5, 0.0001);",
+            "_surface.diffuse_color.a = material_diffuse_surface_color.a * smoothstep(0.5 - sdf_w, 0.5 + sdf_w, rg_color.g);",
+        };
+        sDistanceFieldModifier = std::make_shared<VROShaderModifier>(VROShaderEntryPoint::Surface, modifierCode);
+        sDistanceFieldModifier->setName("sdf");
+    }
+    return sDistanceFieldModifier;
+}
+
+static std::shared_ptr<VROShaderModifier> getDistanceFieldOutlineModifier() {
+    if (!sDistanceFieldOutlineModifier) {
+        std::vector<std::string> modifierCode = {
+            "uniform highp float sdf_edge;",
+            "highp float sdf_w = max(fwidth(rg_color.g) * 0.5, 0.0001);",
+            "_surface.diffuse_color.a = material_diffuse_surface_color.a * smoothstep(sdf_edge - sdf_w, sdf_edge + sdf_w, rg_color.g);",
+        };
+        sDistanceFieldOutlineModifier = std::make_shared<VROShaderModifier>(VROShaderEntryPoint::Surface, modifierCode);
+        sDistanceFieldOutlineModifier->setUniformBinder("sdf_edge", VROShaderProperty::Float,
+                                                        [](VROUniform *uniform,
+                                                           const VROGeometry *geometry, const VROMaterial *material) {
+            const VROText *text = dynamic_cast<const VROText *>(geometry);
+            uniform->setFloat(text ? text->getDistanceFieldOutlineEdge() : 0.5);
+        });
+        sDistanceFieldOutlineModifier->setName("sdf_o");
+    }
+    return sDistanceFieldOutlineModifier;
+}
+
+/*
+ Glyph and outline materials are shared by all text drawing from the same atlas
+ with the same color and style. Labels across the scene then have identical
+ materials, so their sort keys group together and VROPortal can submit runs of
+ them as a single multi-draw. Entries are weak, so each material is released
+ with the last text using it; while a material is alive, the text holding it
+ also holds its atlas.
+ */
+typedef std::tuple<VROGlyphAtlas *, bool, bool, float, float, float, float> VROTextMaterialKey;
+static std::map<VROTextMaterialKey, std::weak_ptr<VROMaterial>> sTextMaterials;
+
+std::shared_ptr<VROMaterial> VROText::getTextMaterial(const std::shared_ptr<VROGlyphAtlas> &atlas, VROVector4f color,
+                                                      bool outline, bool distanceField) {
+    VROTextMaterialKey key(atlas.get(), outline, distanceField, color.x, color.y, color.z, color.w);
+    auto it = sTextMaterials.find(key);
+    if (it != sTextMaterials.end()) {
+        std::shared_ptr<VROMaterial> material = it->second.lock();
+        if (material) {
+            return material;
+        }
+    }
+    
+    // Drop the entries of released materials before adding a new one
+    for (auto entry = sTextMaterials.begin(); entry != sTextMaterials.end();) {
+        if (entry->second.expired()) {
+            entry = sTextMaterials.erase(entry);
+        } else {
+            ++entry;
+        }
+    }
+    
+    std::shared_ptr<VROMaterial> material = std::make_shared<VROMaterial>();
+    material->setNeedsToneMapping(false);
+    material->getDiffuse().setColor(color);
+    if (outline) {
+        material->setRenderingOrder(0);
+        if (distanceField) {
+            material->addShaderModifier(getDistanceFieldOutlineModifier());
+        }
+        
+        // Outline strokes do not write to the depth buffer to prevent Z-fighting
+        // with the front stroke; this should be ok because the front stroke glyphs
+        // will write into the depth buffer immediately after
+        material->setWritesToDepthBuffer(false);
+    } else {
+        material->setRenderingOrder(1);
+        if (distanceField) {
+            material->addShaderModifier(getDistanceFieldModifier());
+        }
+    }
+    
+    sTextMaterials[key] = material;
+    return material;
+}
+
 void VROText::buildBitmapText(std::wstring &text,
                               std::shared_ptr<VROTypefaceCollection> &typefaces,
                               VROVector4f color,
                               VROTextOuterStroke outerStroke, int outerStrokeWidth, VROVector4f outerStrokeColor,
+                              bool distanceField,
                               float width, float height,
                               VROTextHorizontalAlignment horizontalAlignment,
                               VROTextVerticalAlignment verticalAlignment,
                               VROLineBreakMode lineBreakMode,
                               VROTextClipMode clipMode,
                               int maxLines,
+                              std::map<std::shared_ptr<VROGlyphAtlas>, std::shared_ptr<VROMaterial>> &glyphMaterials,
+                              std::map<std::shared_ptr<VROGlyphAtlas>, std::shared_ptr<VROMaterial>> &outlineMaterials,
                               std::vector<std::shared_ptr<VROGeometrySource>> &sources,
                               std::vector<std::shared_ptr<VROGeometryElement>> &elements,
                               std::vector<std::shared_ptr<VROMaterial>> &materials,
@@ -318,11 +570,16 @@ void VROText::buildBitmapText(std::wstring &text,
     if (text.size() == 0) {
         *outRealizedWidth = 0;
         *outRealizedHeight = 0;
+        glyphMaterials.clear();
+        outlineMaterials.clear();
         return;
     }
     
     /*
-     Configure the stroke (for outline or drop shadow).
+     Configure the stroke (for outline or drop shadow). Distance field glyphs draw
+     their stroke from the same bitmap as the glyph itself, thresholded further out
+     in the shader, so the outline is centered on the glyph and the drop shadow is
+     shifted by the stroke width.
      */
     int outlineWidth;
     int outlineOffset;
@@ -330,22 +587,48 @@ void VROText::buildBitmapText(std::wstring &text,
 
     if (outerStroke == VROTextOuterStroke::Outline) {
         outlineWidth = outerStrokeWidth;
-        outlineOffset = -outerStrokeWidth;
+        outlineOffset = distanceField ? 0 : -outerStrokeWidth;
     } else if (outerStroke == VROTextOuterStroke::DropShadow) {
         outlineWidth = outerStrokeWidth;
-        outlineOffset = 0;
+        outlineOffset = distanceField ? outerStrokeWidth : 0;
     } else {
         outlineWidth = 0;
         outlineOffset = 0;
     }
+    
+    VROGlyphRenderMode renderMode = distanceField ? VROGlyphRenderMode::DistanceField : VROGlyphRenderMode::Bitmap;
+    int glyphOutlineWidth = distanceField ? 0 : outlineWidth;
+    int outlineBitmapIndex = distanceField ? 0 : outlineWidth;
 
     /*
      Create a glyph, material, and vector of indices for each character
      in the text string. Characters that share the same atlas will use the
-     same material.
+     same material. Outline materials are kept in their own map, since
+     distance field glyphs share one atlas between glyph and outline.
      */
     std::map<uint32_t, std::shared_ptr<VROGlyph>> glyphMap;
     std::map<std::shared_ptr<VROGlyphAtlas>, std::pair<std::shared_ptr<VROMaterial>, std::vector<int>>> materialMap;
+    std::map<std::shared_ptr<VROGlyphAtlas>, std::pair<std::shared_ptr<VROMaterial>, std::vector<int>>> outlineMaterialMap;
+    
+    glyphMaterials.clear();
+    outlineMaterials.clear();
+    
+    auto addGlyphMaterial = [&](const std::shared_ptr<VROGlyphAtlas> &atlas) {
+        if (materialMap.find(atlas) == materialMap.end()) {
+            std::shared_ptr<VROMaterial> material = getTextMaterial(atlas, color, false, distanceField);
+            std::vector<int> indices;
+            materialMap[atlas] = { material, indices };
+            glyphMaterials[atlas] = material;
+        }
+    };
+    auto addOutlineMaterial = [&](const std::shared_ptr<VROGlyphAtlas> &atlas) {
+        if (outlineMaterialMap.find(atlas) == outlineMaterialMap.end()) {
+            std::shared_ptr<VROMaterial> material = getTextMaterial(atlas, outlineColor, true, distanceField);
+            std::vector<int> indices;
+            outlineMaterialMap[atlas] = { material, indices };
+            outlineMaterials[atlas] = material;
+        }
+    };
     
     // Split the text into runs, eached mapped to a typeface
     std::vector<VROFontRun> fontRuns = typefaces->computeRuns(text);
@@ -356,32 +639,11 @@ void VROText::buildBitmapText(std::wstring &text,
         std::wstring space = L" ";
         uint32_t spaceCode = *space.begin();
         
-        std::shared_ptr<VROGlyph> whitespaceGlyph = firstTypeface->getGlyph(spaceCode, 0, outlineWidth, VROGlyphRenderMode::Bitmap);
-        std::shared_ptr<VROGlyphAtlas> whitespaceAtlas = whitespaceGlyph->getBitmap(0).atlas;
-        
-        std::shared_ptr<VROMaterial> whitespaceMaterial = std::make_shared<VROMaterial>();
-        whitespaceMaterial->setNeedsToneMapping(false);
-        whitespaceMaterial->getDiffuse().setColor(color);
-        whitespaceMaterial->getDiffuse().setTexture(whitespaceAtlas->getTexture());
-        whitespaceMaterial->setRenderingOrder(1);
-        
-        std::vector<int> indices;
-        materialMap[whitespaceAtlas] = { whitespaceMaterial, indices };
-        
+        std::shared_ptr<VROGlyph> whitespaceGlyph = firstTypeface->getGlyph(spaceCode, 0, glyphOutlineWidth, renderMode);
+        addGlyphMaterial(whitespaceGlyph->getBitmap(0).atlas);
         if (outlineWidth > 0) {
-            std::shared_ptr<VROGlyphAtlas> whitespaceAtlasOutline = whitespaceGlyph->getBitmap(outlineWidth).atlas;
-
-            std::shared_ptr<VROMaterial> whitespaceMaterialOutline = std::make_shared<VROMaterial>();
-            whitespaceMaterialOutline->setNeedsToneMapping(false);
-            whitespaceMaterialOutline->setWritesToDepthBuffer(false);
-            whitespaceMaterialOutline->getDiffuse().setColor(outlineColor);
-            whitespaceMaterialOutline->getDiffuse().setTexture(whitespaceGlyph->getBitmap(outlineWidth).atlas->getTexture());
-            whitespaceMaterialOutline->setRenderingOrder(0);
-
-            std::vector<int> indices;
-            materialMap[whitespaceAtlasOutline] = { whitespaceMaterialOutline, indices };
+            addOutlineMaterial(whitespaceGlyph->getBitmap(outlineBitmapIndex).atlas);
         }
-        
         glyphMap[spaceCode] = whitespaceGlyph;
     }
     
@@ -398,37 +660,10 @@ void VROText::buildBitmapText(std::wstring &text,
         for (int i = fontRun.start; i < fontRun.end; i++) {
             uint32_t codePoint = text.at(i);
             if (glyphMap.find(codePoint) == glyphMap.end()) {
-                std::shared_ptr<VROGlyph> glyph = typeface->getGlyph(codePoint, 0, outlineWidth, VROGlyphRenderMode::Bitmap);
-                
-                const std::shared_ptr<VROGlyphAtlas> atlas = glyph->getBitmap(0).atlas;
-                auto materialAndIndices = materialMap.find(atlas);
-                if (materialAndIndices == materialMap.end()) {
-                    std::shared_ptr<VROMaterial> material = std::make_shared<VROMaterial>();
-                    material->setNeedsToneMapping(false);
-                    material->getDiffuse().setColor(color);
-                    material->setRenderingOrder(1);
-
-                    std::vector<int> indices;
-                    materialMap[atlas] = { material, indices };
-                }
-                
+                std::shared_ptr<VROGlyph> glyph = typeface->getGlyph(codePoint, 0, glyphOutlineWidth, renderMode);
+                addGlyphMaterial(glyph->getBitmap(0).atlas);
                 if (outlineWidth > 0) {
-                    const std::shared_ptr<VROGlyphAtlas> atlasOutline = glyph->getBitmap(outlineWidth).atlas;
-                    auto materialAndIndices = materialMap.find(atlasOutline);
-                    if (materialAndIndices == materialMap.end()) {
-                        std::shared_ptr<VROMaterial> material = std::make_shared<VROMaterial>();
-                        material->setNeedsToneMapping(false);
-                        material->getDiffuse().setColor(outlineColor);
-                        material->setRenderingOrder(0);
-                        
-                        // Outline strokes do not write to the depth buffer to prevent Z-fighting
-                        // with the front stroke; this should be ok because the front stroke glyphs
-                        // will write into the depth buffer immediately after
-                        material->setWritesToDepthBuffer(false);
-                        
-                        std::vector<int> indices;
-                        materialMap[atlasOutline] = { material, indices };
-                    }
+                    addOutlineMaterial(glyph->getBitmap(outlineBitmapIndex).atlas);
                 }
                 glyphMap[codePoint] = glyph;
             }
@@ -447,23 +682,23 @@ void VROText::buildBitmapText(std::wstring &text,
         std::shared_ptr<VROGlyph> glyph = kv.second;
         const std::shared_ptr<VROGlyphAtlas> &atlas = glyph->getBitmap(0).atlas;
         std::shared_ptr<VROMaterial> material = materialMap[atlas].first;
-        material->getDiffuse().setTexture(atlas->getTexture());
+        material->getDiffuse().swapTexture(atlas->getTexture());
         
         if (outlineWidth > 0) {
-            const std::shared_ptr<VROGlyphAtlas> &atlasOutline = glyph->getBitmap(outlineWidth).atlas;
-            std::shared_ptr<VROMaterial> materialOutline = materialMap[atlasOutline].first;
-            materialOutline->getDiffuse().setTexture(atlasOutline->getTexture());
+            const std::shared_ptr<VROGlyphAtlas> &atlasOutline = glyph->getBitmap(outlineBitmapIndex).atlas;
+            std::shared_ptr<VROMaterial> materialOutline = outlineMaterialMap[atlasOutline].first;
+            materialOutline->getDiffuse().swapTexture(atlasOutline->getTexture());
         }
     }
     
     std::vector<VROShapeVertexLayout> var;
 
     VROTextFormatter::formatAndBuild(text, width, height, maxLines, maxLineHeight, horizontalAlignment, verticalAlignment, lineBreakMode, clipMode, glyphMap, outRealizedWidth, outRealizedHeight,
-                                     [&var, &materialMap, outlineWidth, outlineOffset] (std::shared_ptr<VROGlyph> &glyph, float x, float y) {
+                                     [&var, &materialMap, &outlineMaterialMap, outlineWidth, outlineOffset, outlineBitmapIndex] (std::shared_ptr<VROGlyph> &glyph, float x, float y) {
                                          if (outlineWidth > 0) {
-                                             const VROGlyphBitmap &bitmap = glyph->getBitmap(outlineWidth);
+                                             const VROGlyphBitmap &bitmap = glyph->getBitmap(outlineBitmapIndex);
                                              buildBitmapChar(bitmap, x, y, outlineOffset, outlineOffset,
-                                                             var, materialMap[bitmap.atlas].second);
+                                                             var, outlineMaterialMap[bitmap.atlas].second);
                                          }
                                          const VROGlyphBitmap &bitmap = glyph->getBitmap(0);
                                          buildBitmapChar(bitmap, x, y, 0, 0, var, materialMap[bitmap.atlas].second);
@@ -477,7 +712,7 @@ void VROText::buildBitmapText(std::wstring &text,
         return;
     }
 
-    buildBitmapGeometry(var, materialMap, sources, elements, materials);
+    buildBitmapGeometry(var, materialMap, outlineMaterialMap, sources, elements, materials);
 }
 
 void VROText::buildBitmapChar(const VROGlyphBitmap &bitmap,
@@ -513,6 +748,7 @@ void VROText::buildBitmapChar(const VROGlyphBitmap &bitmap,
 
 void VROText::buildBitmapGeometry(std::vector<VROShapeVertexLayout> &var,
                                   std::map<std::shared_ptr<VROGlyphAtlas>, std::pair<std::shared_ptr<VROMaterial>, std::vector<int>>> &materialMap,
+                                  std::map<std::shared_ptr<VROGlyphAtlas>, std::pair<std::shared_ptr<VROMaterial>, std::vector<int>>> &outlineMaterialMap,
                                   std::vector<std::shared_ptr<VROGeometrySource>> &sources,
                                   std::vector<std::shared_ptr<VROGeometryElement>> &elements,
                                   std::vector<std::shared_ptr<VROMaterial>> &materials) {
@@ -529,16 +765,10 @@ void VROText::buildBitmapGeometry(std::vector<VROShapeVertexLayout> &var,
     // the color property)
     std::vector<std::pair<std::shared_ptr<VROMaterial>, std::vector<int>>> orderedElements;
     for (auto &kv : materialMap) {
-        const std::shared_ptr<VROGlyphAtlas> &atlas = kv.first;
-        if (!atlas->isOutline()) {
-            orderedElements.push_back(kv.second);
-        }
+        orderedElements.push_back(kv.second);
     }
-    for (auto &kv : materialMap) {
-        const std::shared_ptr<VROGlyphAtlas> &atlas = kv.first;
-        if (atlas->isOutline()) {
-            orderedElements.push_back(kv.second);
-        }
+    for (auto &kv : outlineMaterialMap) {
+        orderedElements.push_back(kv.second);
     }
     
     // Then create the element for each
@@ -672,34 +902,25 @@ void VROText::buildVectorizedChar(std::shared_ptr<VROGlyph> &glyph,
                                   std::vector<int> &backIndices,
                                   std::vector<int> &sideIndices) {
     
-    const std::vector<VROGlyphTriangle> &triangles = glyph->getTriangles();
-    for (const VROGlyphTriangle &triangle : triangles) {
-        var.push_back({ x + triangle.getA().x * kTextPointToWorldScale,
-            y + triangle.getA().y * kTextPointToWorldScale,
-            triangle.getA().z * kTextPointToWorldScale * extrusion, 0, 0, 0, 0, 1});
-        var.push_back({ x + triangle.getB().x * kTextPointToWorldScale,
-            y + triangle.getB().y * kTextPointToWorldScale,
-            triangle.getB().z * kTextPointToWorldScale * extrusion, 0, 0, 0, 0, 1});
-        var.push_back({ x + triangle.getC().x * kTextPointToWorldScale,
-            y + triangle.getC().y * kTextPointToWorldScale,
-            triangle.getC().z * kTextPointToWorldScale * extrusion, 0, 0, 0, 0, 1});
-        
-        for (int i = 0; i < 3; i++) {
-            int index = (int) (frontIndices.size() + backIndices.size() + sideIndices.size());
-            switch (triangle.getType()) {
-                case VROGlyphTriangleType::Front:
-                    frontIndices.push_back(index);
-                    break;
-                case VROGlyphTriangleType::Back:
-                    backIndices.push_back(index);
-                    break;
-                case VROGlyphTriangleType::Side:
-                    sideIndices.push_back(index);
-                    break;
-                default:
-                    pabort();
-            }
-        }
+    const VROGlyphMesh &mesh = glyph->getExtrudedMesh(kTextPointToWorldScale, extrusion);
+    int base = (int) var.size();
+    for (const VROShapeVertexLayout &vertex : mesh.vertices) {
+        var.push_back(vertex);
+        var.back().x += x;
+        var.back().y += y;
+    }
+    
+    int numVertices = (int) mesh.vertices.size();
+    int backStart = mesh.numFrontVertices;
+    int sideStart = backStart + mesh.numBackVertices;
+    for (int i = 0; i < backStart; i++) {
+        frontIndices.push_back(base + i);
+    }
+    for (int i = backStart; i < sideStart; i++) {
+        backIndices.push_back(base + i);
+    }
+    for (int i = sideStart; i < numVertices; i++) {
+        sideIndices.push_back(base + i);
     }
 }
 
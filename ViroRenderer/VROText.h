@@ -189,6 +189,26 @@ public:
     void setMaxLines(int maxLines);
     void setExtrusion(float extrusion);
     void setOuterStroke(VROTextOuterStroke stroke, int strokeWidth, VROVector4f strokeColor);
+
+    /*
+     Render flat text from signed distance field glyphs instead of per-size bitmaps.
+     Distance field glyphs share one atlas per typeface across all sizes and stroke
+     widths, and stay sharp when magnified. Stroke widths are limited to the distance
+     field's spread (kDistanceFieldSpread at kDistanceFieldGlyphSize). Has no effect
+     on extruded text.
+     */
+    void setDistanceField(bool distanceField);
+    bool isDistanceField() const {
+        return _distanceField;
+    }
+    
+    /*
+     The distance field value at which the outer stroke ends, derived from the stroke
+     width and font size. Bound to the outline shader when rendering distance fields.
+     */
+    float getDistanceFieldOutlineEdge() const {
+        return _distanceFieldOutlineEdge;
+    }
     void setMaterials(std::vector<std::shared_ptr<VROMaterial>> materials);
 
 private:
@@ -210,7 +230,30 @@ private:
     VROTextOuterStroke _outerStroke;
     int _outerStrokeWidth;
     VROVector4f _outerStrokeColor;
+    bool _distanceField;
+    float _distanceFieldOutlineEdge;
     std::weak_ptr<VRODriver> _driver;
+    
+    /*
+     The materials of the last bitmap build, by atlas, swapped when only the color
+     changes. The number of builds determines when flat text becomes dynamic.
+     */
+    std::map<std::shared_ptr<VROGlyphAtlas>, std::shared_ptr<VROMaterial>> _glyphMaterials;
+    std::map<std::shared_ptr<VROGlyphAtlas>, std::shared_ptr<VROMaterial>> _outlineMaterials;
+    int _numBuilds;
+    
+    /*
+     The number of typefaces still rasterizing glyphs for this text in the
+     background. While non-zero, the text keeps its previous geometry.
+     */
+    int _pendingGlyphLoads;
+    
+    /*
+     If more glyphs of the text are missing than we are willing to rasterize (or
+     for extruded text, triangulate) on the rendering thread, start loading them in the background
+     and return true. The text is updated again once they have loaded.
+     */
+    bool preloadGlyphsAsync();
 
     std::atomic<float> _realizedWidth, _realizedHeight;
     
@@ -219,31 +262,54 @@ private:
             float width, float height) :
         VROGeometry(sources, elements),
         _width(width),
-        _height(height)
+        _height(height),
+        _distanceField(false),
+        _distanceFieldOutlineEdge(0.5),
+        _numBuilds(0),
+        _pendingGlyphLoads(0)
     {}
     
     static void buildBitmapText(std::wstring &text,
                                 std::shared_ptr<VROTypefaceCollection> &typefaces,
                                 VROVector4f color,
                                 VROTextOuterStroke outerStroke, int outerStrokeWidth, VROVector4f outerStrokeColor,
+                                bool distanceField,
                                 float width, float height,
                                 VROTextHorizontalAlignment horizontalAlignment,
                                 VROTextVerticalAlignment verticalAlignment,
                                 VROLineBreakMode lineBreakMode,
                                 VROTextClipMode clipMode,
                                 int maxLines,
+                                std::map<std::shared_ptr<VROGlyphAtlas>, std::shared_ptr<VROMaterial>> &glyphMaterials,
+                                std::map<std::shared_ptr<VROGlyphAtlas>, std::shared_ptr<VROMaterial>> &outlineMaterials,
                                 std::vector<std::shared_ptr<VROGeometrySource>> &sources,
                                 std::vector<std::shared_ptr<VROGeometryElement>> &elements,
                                 std::vector<std::shared_ptr<VROMaterial>> &materials,
                                 float *outRealizedWidth, float *outRealizedHeight,
                                 std::shared_ptr<VRODriver> driver);
     
+    /*
+     Get the material shared by all text drawing the given atlas in the given color,
+     as glyphs or outlines.
+     */
+    static std::shared_ptr<VROMaterial> getTextMaterial(const std::shared_ptr<VROGlyphAtlas> &atlas, VROVector4f color,
+                                                        bool outline, bool distanceField);
+    
+    /*
+     Move the given glyph or outline materials to those of the given color without
+     rebuilding the text. Returns false if the materials are not installed on this
+     text, in which case the text must be rebuilt.
+     */
+    bool swapMaterials(std::map<std::shared_ptr<VROGlyphAtlas>, std::shared_ptr<VROMaterial>> &textMaterials,
+                       VROVector4f color, bool outline);
+    
     /*
      Build a standard Viro geometry from the given vertex array and material/indices
-     pairs.
+     pairs. The front materials come first, followed by the outline materials.
      */
     static void buildBitmapGeometry(std::vector<VROShapeVertexLayout> &var,
                                     std::map<std::shared_ptr<VROGlyphAtlas>, std::pair<std::shared_ptr<VROMaterial>, std::vector<int>>> &materialMap,
+                                    std::map<std::shared_ptr<VROGlyphAtlas>, std::pair<std::shared_ptr<VROMaterial>, std::vector<int>>> &outlineMaterialMap,
                                     std::vector<std::shared_ptr<VROGeometrySource>> &sources,
                                     std::vector<std::shared_ptr<VROGeometryElement>> &elements,
                                     std::vector<std::shared_ptr<VROMaterial>> &materials);
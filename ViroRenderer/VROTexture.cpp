@@ -35,10 +35,77 @@
 #include "VROMaterialVisual.h"
 #include "VROFrameScheduler.h"
 #include "VROStringUtil.h"
+#include "VROTextureStreamer.h"
+#include "VROResidencyManager.h"
+#include "VROPlatformUtil.h"
 #include <atomic>
 
 static std::atomic_int sTextureId;
 
+// Uncompressed 2D textures at least this large are uploaded incrementally,
+// roughly kIncrementalHydrationSliceBytes per frame
+static const int kIncrementalHydrationMinBytes = 1024 * 1024;
+static const int kIncrementalHydrationSliceBytes = 256 * 1024;
+
+// Streamed textures are never reduced below this size (longest side, in pixels)
+static const int kMinStreamedTextureSize = 64;
+
+/*
+ Box-filter the given image down by the given number of mip levels. Returns
+ nullptr if the image does not have four bytes per pixel (opaque images report
+ RGB8, but most platforms still provide RGBA8 pixels).
+ */
+static std::shared_ptr<VROData> buildStreamingLevel(std::shared_ptr<VROImage> image, int level,
+                                                    int *outWidth, int *outHeight) {
+    int width = image->getWidth();
+    int height = image->getHeight();
+    if (image->getFormat() != VROTextureFormat::RGBA8 && image->getFormat() != VROTextureFormat::RGB8) {
+        return nullptr;
+    }
+
+    image->lock();
+    size_t length;
+    const unsigned char *pixels = image->getData(&length);
+    if (pixels == nullptr || length < (size_t) width * height * 4) {
+        image->unlock();
+        return nullptr;
+    }
+
+    int step = 1 << level;
+    int levelWidth = std::max(width >> level, 1);
+    int levelHeight = std::max(height >> level, 1);
+    int levelLength = levelWidth * levelHeight * 4;
+    unsigned char *levelPixels = (unsigned char *) malloc(levelLength);
+
+    if (level == 0) {
+        memcpy(levelPixels, pixels, levelLength);
+    }
+    else {
+        for (int y = 0; y < levelHeight; y++) {
+            int rows = std::min(step, height - y * step);
+            for (int x = 0; x < levelWidth; x++) {
+                int columns = std::min(step, width - x * step);
+                int sum[4] = { 0, 0, 0, 0 };
+                for (int sy = 0; sy < rows; sy++) {
+                    const unsigned char *row = pixels + ((size_t) (y * step + sy) * width + x * step) * 4;
+                    for (int sx = 0; sx < columns * 4; sx++) {
+                        sum[sx & 3] += row[sx];
+                    }
+                }
+                int samples = std::max(rows * columns, 1);
+                for (int c = 0; c < 4; c++) {
+                    levelPixels[(y * levelWidth + x) * 4 + c] = (unsigned char) (sum[c] / samples);
+                }
+            }
+        }
+    }
+    image->unlock();
+
+    *outWidth = levelWidth;
+    *outHeight = levelHeight;
+    return std::make_shared<VROData>(levelPixels, levelLength, VRODataOwnership::Move);
+}
+
 VROTexture::VROTexture(VROTextureType type, VROTextureInternalFormat internalFormat, VROStereoMode stereoMode) :
     _textureId(sTextureId++),
     _type(type),
@@ -53,7 +120,9 @@ VROTexture::VROTexture(VROTextureType type, VROTextureInternalFormat internalFor
     _wrapT(VROWrapMode::Clamp),
     _minificationFilter(VROFilterMode::Linear),
     _magnificationFilter(VROFilterMode::Linear),
-    _mipFilter(VROFilterMode::Linear) {
+    _mipFilter(VROFilterMode::Linear),
+    _pendingRowsUploaded(0),
+    _contentHash(0) {
     
     setNumSubstrates(getNumSubstratesForFormat(internalFormat));
     ALLOCATION_TRACKER_ADD(Textures, 1);
@@ -74,7 +143,9 @@ VROTexture::VROTexture(VROTextureType type, VROTextureInternalFormat internalFor
     _wrapT(VROWrapMode::Clamp),
     _minificationFilter(VROFilterMode::Linear),
     _magnificationFilter(VROFilterMode::Linear),
-    _mipFilter(VROFilterMode::Linear) {
+    _mipFilter(VROFilterMode::Linear),
+    _pendingRowsUploaded(0),
+    _contentHash(0) {
     
     _substrates.push_back(std::move(substrate));
     ALLOCATION_TRACKER_ADD(Textures, 1);
@@ -98,7 +169,9 @@ VROTexture::VROTexture(bool sRGB,
     _wrapT(VROWrapMode::Clamp),
     _minificationFilter(VROFilterMode::Linear),
     _magnificationFilter(VROFilterMode::Linear),
-    _mipFilter(VROFilterMode::Linear) {
+    _mipFilter(VROFilterMode::Linear),
+    _pendingRowsUploaded(0),
+    _contentHash(0) {
     
     setNumSubstrates(getNumSubstratesForFormat(_internalFormat));
     ALLOCATION_TRACKER_ADD(Textures, 1);
@@ -121,7 +194,9 @@ VROTexture::VROTexture(bool sRGB,
     _wrapT(VROWrapMode::Clamp),
     _minificationFilter(VROFilterMode::Linear),
     _magnificationFilter(VROFilterMode::Linear),
-    _mipFilter(VROFilterMode::Linear) {
+    _mipFilter(VROFilterMode::Linear),
+    _pendingRowsUploaded(0),
+    _contentHash(0) {
     
     setNumSubstrates(getNumSubstratesForFormat(_internalFormat));
     ALLOCATION_TRACKER_ADD(Textures, 1);
@@ -150,7 +225,9 @@ VROTexture::VROTexture(VROTextureType type,
     _wrapT(VROWrapMode::Clamp),
     _minificationFilter(VROFilterMode::Linear),
     _magnificationFilter(VROFilterMode::Linear),
-    _mipFilter(VROFilterMode::Linear) {
+    _mipFilter(VROFilterMode::Linear),
+    _pendingRowsUploaded(0),
+    _contentHash(0) {
     
     setNumSubstrates(getNumSubstratesForFormat(internalFormat));
     ALLOCATION_TRACKER_ADD(Textures, 1);
@@ -167,38 +244,44 @@ int VROTexture::getNumSubstrates() const {
 void VROTexture::hydrateAsync(std::function<void()> callback,
                               std::shared_ptr<VRODriver> &driver) {
     if (isHydrated()) {
+        if (callback) {
+            callback();
+        }
         return;
     }
     
     _hydrationCallbacks.push_back(callback);
     
-    const std::shared_ptr<VROFrameScheduler> &scheduler = driver->getFrameScheduler();
-    std::string key = getHydrationTaskKey();
-    if (!scheduler->isTaskQueued(key)) {
-        std::function<void()> hydrationTask = createHydrationTask(driver);
-        scheduler->scheduleTask(key, hydrationTask);
-    }
+    scheduleHydrationTask(driver);
 }
 
 std::string VROTexture::getHydrationTaskKey() const {
     return "th_" + VROStringUtil::toString(_textureId);
 }
 
-std::function<void()> VROTexture::createHydrationTask(std::shared_ptr<VRODriver> &driver) {
+void VROTexture::scheduleHydrationTask(std::shared_ptr<VRODriver> &driver) {
+    const std::shared_ptr<VROFrameScheduler> &scheduler = driver->getFrameScheduler();
+    std::string key = getHydrationTaskKey();
+    if (scheduler->isTaskQueued(key)) {
+        return;
+    }
+
     // Only hold weak pointers: we don't want queued hydration
     // to prolong the lifetime of these objects
     std::weak_ptr<VRODriver> driver_w = driver;
     std::weak_ptr<VROTexture> texture_w = shared_from_this();
     
-    std::function<void()> hydrationTask = [driver_w, texture_w]() {
+    // Large uncompressed textures are uploaded a band of rows at a time, so
+    // the scheduler can spread them across frames
+    scheduler->scheduleResumableTask(key, [driver_w, texture_w]() {
         std::shared_ptr<VROTexture> texture_s = texture_w.lock();
         std::shared_ptr<VRODriver> driver_s = driver_w.lock();
         
         if (texture_s && driver_s) {
-            texture_s->hydrate(driver_s);
+            return texture_s->hydrateSlice(driver_s);
         }
-    };
-    return hydrationTask;
+        return true;
+    });
 }
 
 bool VROTexture::isHydrated() const {
@@ -211,15 +294,16 @@ VROTextureSubstrate *VROTexture::getSubstrate(int index, std::shared_ptr<VRODriv
         // Hydration only works for single-substrate textures. Multi-substrate
         // textures need to inject the substrates manually via setSubstrate().
         passert (index == 0);
-        if (immediate) {
+        
+        // Evicted textures have no image until it's reloaded from their source
+        if (_images.empty() && _data.empty() && !_pendingSubstrate && isReloadable()) {
+            reload(driver, immediate);
+        }
+        else if (immediate) {
             hydrate(driver);
         }
         else {
-            std::string key = getHydrationTaskKey();
-            if (!driver->getFrameScheduler()->isTaskQueued(key)) {
-                std::function<void()> hydrationTask = createHydrationTask(driver);
-                driver->getFrameScheduler()->scheduleTask(key, hydrationTask);
-            }
+            scheduleHydrationTask(driver);
         }
     }
     
@@ -242,6 +326,21 @@ void VROTexture::prewarm(std::shared_ptr<VRODriver> driver) {
 
 void VROTexture::hydrate(std::shared_ptr<VRODriver> &driver) {
     passert (_images.empty() || _data.empty());
+
+    // Complete any incremental upload in progress
+    if (_pendingSubstrate) {
+        while (!hydrateSlice(driver)) {}
+        return;
+    }
+
+    // Streamed textures start at their lowest resolution
+    if (_streamingSource && !_images.empty()) {
+        if (hydrateStreamed(driver)) {
+            onHydrated(driver);
+            return;
+        }
+        _streamingSource = nullptr;
+    }
     
     if (!_images.empty()) {
         std::vector<std::shared_ptr<VROData>> data;
@@ -258,18 +357,94 @@ void VROTexture::hydrate(std::shared_ptr<VRODriver> &driver) {
             image->unlock();
         }
         
-        std::vector<uint32_t> mipSizes;
-        _substrates[0] = std::unique_ptr<VROTextureSubstrate>(driver->newTextureSubstrate(_type, _format, _internalFormat, _sRGB, _mipmapMode,
-                                                                                          data, _width, _height, _mipSizes, _wrapS, _wrapT,
-                                                                                          _minificationFilter, _magnificationFilter, _mipFilter));
+        _substrates[0] = std::unique_ptr<VROTextureSubstrate>(newSubstrate(data, driver));
         _images.clear();
     }
     else if (!_data.empty()) {
-        _substrates[0] = std::unique_ptr<VROTextureSubstrate>(driver->newTextureSubstrate(_type, _format, _internalFormat, _sRGB, _mipmapMode,
-                                                                                          _data, _width, _height, _mipSizes, _wrapS, _wrapT,
-                                                                                          _minificationFilter, _magnificationFilter, _mipFilter));
+        _substrates[0] = std::unique_ptr<VROTextureSubstrate>(newSubstrate(_data, driver));
         _data.clear();
     }
+    onHydrated(driver);
+}
+
+VROTextureSubstrate *VROTexture::newSubstrate(std::vector<std::shared_ptr<VROData>> &data,
+                                              std::shared_ptr<VRODriver> &driver) {
+    if (isAtlasPackable()) {
+        VROTextureSubstrate *substrate = driver->newTextureAtlasRegionSubstrate(_format, _internalFormat, _sRGB,
+                                                                                data.front(), _width, _height,
+                                                                                _minificationFilter, _magnificationFilter);
+        if (substrate) {
+            return substrate;
+        }
+    }
+    if (isArrayPackable()) {
+        VROTextureSubstrate *substrate = driver->newTextureArrayLayerSubstrate(_format, _internalFormat, _sRGB, _mipmapMode,
+                                                                               data.front(), _width, _height, _wrapS, _wrapT,
+                                                                               _minificationFilter, _magnificationFilter, _mipFilter);
+        if (substrate) {
+            return substrate;
+        }
+    }
+    return driver->newTextureSubstrate(_type, _format, _internalFormat, _sRGB, _mipmapMode,
+                                       data, _width, _height, _mipSizes, _wrapS, _wrapT,
+                                       _minificationFilter, _magnificationFilter, _mipFilter);
+}
+
+bool VROTexture::isArrayPackable() const {
+    if (!_arrayPackingEnabled || _streamingSource) {
+        return false;
+    }
+    return _type == VROTextureType::Texture2D && _substrates.size() == 1 && _images.size() + _data.size() == 1 &&
+          (_format == VROTextureFormat::RGBA8 || _format == VROTextureFormat::RGB8 || _format == VROTextureFormat::RGB565) &&
+          (_mipmapMode == VROMipmapMode::None || _mipmapMode == VROMipmapMode::Runtime);
+}
+
+bool VROTexture::isAtlasPackable() const {
+    if (!_atlasPackingEnabled || _streamingSource) {
+        return false;
+    }
+    return _type == VROTextureType::Texture2D && _substrates.size() == 1 && _images.size() + _data.size() == 1 &&
+          (_format == VROTextureFormat::RGBA8 || _format == VROTextureFormat::RGB8) &&
+           _wrapS == VROWrapMode::Clamp && _wrapT == VROWrapMode::Clamp &&
+           _width <= kTextureAtlasMaxImageSize && _height <= kTextureAtlasMaxImageSize;
+}
+
+uint32_t VROTexture::getTextureAtlasId() const {
+    if (_substrates.empty() || !_substrates[0]) {
+        return 0;
+    }
+    return _substrates[0]->getAtlasId();
+}
+
+VROVector4f VROTexture::getTextureAtlasRect() const {
+    if (_substrates.empty() || !_substrates[0]) {
+        return { 0, 0, 1, 1 };
+    }
+    return _substrates[0]->getAtlasRect();
+}
+
+uint32_t VROTexture::getTextureArrayId() const {
+    if (_substrates.empty() || !_substrates[0]) {
+        return 0;
+    }
+    return _substrates[0]->getArrayId();
+}
+
+int VROTexture::getTextureArrayLayer() const {
+    if (_substrates.empty() || !_substrates[0]) {
+        return -1;
+    }
+    return _substrates[0]->getArrayLayer();
+}
+
+void VROTexture::onHydrated(std::shared_ptr<VRODriver> &driver) {
+    if (!_residencyTracked && isReloadable()) {
+        std::shared_ptr<VROResidencyManager> manager = driver->getResidencyManager();
+        if (manager) {
+            manager->addTexture(shared_from_this());
+            _residencyTracked = true;
+        }
+    }
     
     for (auto &callback : _hydrationCallbacks) {
         callback();
@@ -277,6 +452,268 @@ void VROTexture::hydrate(std::shared_ptr<VRODriver> &driver) {
     _hydrationCallbacks.clear();
 }
 
+bool VROTexture::isIncrementalHydrationSupported() const {
+    // Packed textures are uploaded, and their layer's mipmaps built, in one step
+    if (_streamingSource || isArrayPackable() || isAtlasPackable()) {
+        return false;
+    }
+    if (_type != VROTextureType::Texture2D || _substrates.size() != 1 || _images.size() + _data.size() != 1) {
+        return false;
+    }
+    if (_format != VROTextureFormat::RGBA8 && _format != VROTextureFormat::RGB8 && _format != VROTextureFormat::RGB565) {
+        return false;
+    }
+    int bytesPerPixel = _format == VROTextureFormat::RGB565 ? 2 : 4;
+    return _width * _height * bytesPerPixel >= kIncrementalHydrationMinBytes;
+}
+
+bool VROTexture::hydrateSlice(std::shared_ptr<VRODriver> &driver) {
+    if (isHydrated()) {
+        return true;
+    }
+
+    // The first slice allocates the substrate's storage without data
+    if (!_pendingSubstrate) {
+        if (!isIncrementalHydrationSupported()) {
+            hydrate(driver);
+            return true;
+        }
+
+        if (!_images.empty()) {
+            std::shared_ptr<VROImage> &image = _images.front();
+            image->lock();
+            {
+                size_t length;
+                void *bytes = image->getData(&length);
+                _pendingData = std::make_shared<VROData>(bytes, (int) length, VRODataOwnership::Wrap);
+            }
+            image->unlock();
+        }
+        else {
+            _pendingData = _data.front();
+        }
+
+        int bytesPerPixel = _format == VROTextureFormat::RGB565 ? 2 : 4;
+        if (_pendingData->getDataLength() < _width * _height * bytesPerPixel) {
+            pwarn("Texture data smaller than its dimensions, skipping incremental upload");
+            _pendingData.reset();
+            hydrate(driver);
+            return true;
+        }
+
+        std::vector<std::shared_ptr<VROData>> storage = { std::make_shared<VROData>(nullptr, 0, VRODataOwnership::Wrap) };
+        _pendingSubstrate = std::unique_ptr<VROTextureSubstrate>(driver->newTextureSubstrate(_type, _format, _internalFormat, _sRGB, _mipmapMode,
+                                                                                             storage, _width, _height, _mipSizes, _wrapS, _wrapT,
+                                                                                             _minificationFilter, _magnificationFilter, _mipFilter));
+        _pendingRowsUploaded = 0;
+        return false;
+    }
+
+    int bytesPerRow = _width * (_format == VROTextureFormat::RGB565 ? 2 : 4);
+    int numRows = std::min(_height - _pendingRowsUploaded, std::max(1, kIncrementalHydrationSliceBytes / bytesPerRow));
+    const char *rows = (const char *) _pendingData->getData() + (size_t) _pendingRowsUploaded * bytesPerRow;
+
+    if (!_pendingSubstrate->uploadRows(_pendingRowsUploaded, numRows, rows)) {
+        // The driver doesn't support incremental upload; fall back to a full upload
+        _pendingSubstrate.reset();
+        _pendingData.reset();
+        hydrate(driver);
+        return true;
+    }
+
+    _pendingRowsUploaded += numRows;
+    if (_pendingRowsUploaded < _height) {
+        return false;
+    }
+
+    _pendingSubstrate->finishUpload();
+    _substrates[0] = std::move(_pendingSubstrate);
+    _pendingData.reset();
+    _images.clear();
+    _data.clear();
+
+    onHydrated(driver);
+    return true;
+}
+
+#pragma mark - Streaming
+
+void VROTexture::setStreamingSource(std::function<std::shared_ptr<VROImage>()> source) {
+    _streamingSource = source;
+}
+
+void VROTexture::updateScreenSize(float pixels, int frame) {
+    _lastRenderedFrame = frame;
+    if (!_streamingSource) {
+        return;
+    }
+    if (frame != _screenSizeFrame) {
+        _screenSize = pixels;
+        _screenSizeFrame = frame;
+    }
+    else {
+        _screenSize = std::max(_screenSize, pixels);
+    }
+}
+
+int VROTexture::getStreamingLevelCount() const {
+    int size = std::max(_width, _height);
+    int count = 1;
+    while ((size >> count) >= kMinStreamedTextureSize) {
+        count++;
+    }
+    return count;
+}
+
+uint32_t VROTexture::getStreamingBytes(int level) const {
+    if (level < 0) {
+        return 0;
+    }
+    uint64_t bytes = (uint64_t) std::max(_width >> level, 1) * std::max(_height >> level, 1) * 4;
+    if (_mipmapMode != VROMipmapMode::None) {
+        bytes = bytes * 4 / 3;
+    }
+    return (uint32_t) bytes;
+}
+
+bool VROTexture::hydrateStreamed(std::shared_ptr<VRODriver> &driver) {
+    std::shared_ptr<VROTextureStreamer> streamer = driver->getTextureStreamer();
+    if (!streamer || _type != VROTextureType::Texture2D || _images.size() != 1) {
+        return false;
+    }
+
+    int level = getStreamingLevelCount() - 1;
+    int width, height;
+    std::shared_ptr<VROData> data = buildStreamingLevel(_images.front(), level, &width, &height);
+    if (!data) {
+        return false;
+    }
+
+    // The source provides the image from here on
+    installStreamingLevel(level, data, width, height, driver);
+    _images.clear();
+    streamer->addTexture(shared_from_this());
+    return true;
+}
+
+void VROTexture::requestStreamingLevel(int level, std::shared_ptr<VRODriver> driver) {
+    if (!_streamingSource || _streamingPendingLevel >= 0 || level == _streamingLevel) {
+        return;
+    }
+    _streamingPendingLevel = level;
+
+    std::function<std::shared_ptr<VROImage>()> source = _streamingSource;
+    std::weak_ptr<VROTexture> texture_w = shared_from_this();
+    std::weak_ptr<VRODriver> driver_w = driver;
+    std::string key = getHydrationTaskKey() + "_" + VROStringUtil::toString(level);
+
+    VROPlatformDispatchAsyncBackground([source, level, texture_w, driver_w, key] {
+        int width = 0, height = 0;
+        std::shared_ptr<VROImage> image = source();
+        std::shared_ptr<VROData> data = image ? buildStreamingLevel(image, level, &width, &height) : nullptr;
+
+        VROPlatformDispatchAsyncRenderer([level, texture_w, driver_w, key, data, width, height] {
+            std::shared_ptr<VROTexture> texture = texture_w.lock();
+            std::shared_ptr<VRODriver> driver = driver_w.lock();
+            if (!texture || !driver || !data) {
+                if (texture) {
+                    pwarn("Failed to load level %d of streamed texture %s", level, texture->getName().c_str());
+                    texture->_streamingPendingLevel = -1;
+                }
+                return;
+            }
+
+            // Upload within the frame's time budget
+            driver->getFrameScheduler()->scheduleTask(key, [level, texture_w, driver_w, data, width, height] {
+                std::shared_ptr<VROTexture> texture_s = texture_w.lock();
+                std::shared_ptr<VRODriver> driver_s = driver_w.lock();
+                if (texture_s && driver_s) {
+                    texture_s->installStreamingLevel(level, data, width, height, driver_s);
+                    texture_s->_streamingPendingLevel = -1;
+                }
+            });
+        });
+    });
+}
+
+void VROTexture::installStreamingLevel(int level, std::shared_ptr<VROData> data, int width, int height,
+                                       std::shared_ptr<VRODriver> &driver) {
+    VROMipmapMode mipmapMode = _mipmapMode == VROMipmapMode::Pregenerated ? VROMipmapMode::Runtime : _mipmapMode;
+    std::vector<std::shared_ptr<VROData>> levelData = { data };
+
+    // Replacing the substrate releases the previous level's GPU memory
+    _substrates[0] = std::unique_ptr<VROTextureSubstrate>(driver->newTextureSubstrate(_type, VROTextureFormat::RGBA8, _internalFormat, _sRGB, mipmapMode,
+                                                                                      levelData, width, height, std::vector<uint32_t>(), _wrapS, _wrapT,
+                                                                                      _minificationFilter, _magnificationFilter, _mipFilter));
+    _streamingLevel = level;
+}
+
+#pragma mark - Residency
+
+bool VROTexture::isReloadable() const {
+    return _type == VROTextureType::Texture2D && _substrates.size() == 1 &&
+           (_streamingSource || _reloadSource);
+}
+
+int64_t VROTexture::evict() {
+    if (!isHydrated() || !isReloadable() || _pendingSubstrate || _streamingPendingLevel >= 0) {
+        return -1;
+    }
+    int64_t bytes = _substrates[0]->getMemoryBytes();
+    _substrates[0].reset();
+    _streamingLevel = -1;
+    return bytes;
+}
+
+void VROTexture::reload(std::shared_ptr<VRODriver> &driver, bool immediate) {
+    std::function<std::shared_ptr<VROImage>()> source = _streamingSource ? _streamingSource : _reloadSource;
+    if (immediate) {
+        std::shared_ptr<VROImage> image = source();
+        if (image) {
+            _images = { image };
+        }
+        else {
+            pwarn("Failed to reload evicted texture %s", _name.c_str());
+            _reloadSource = nullptr;
+            _streamingSource = nullptr;
+        }
+        hydrate(driver);
+        return;
+    }
+    
+    if (_reloadPending) {
+        return;
+    }
+    _reloadPending = true;
+    
+    std::weak_ptr<VROTexture> texture_w = shared_from_this();
+    std::weak_ptr<VRODriver> driver_w = driver;
+    VROPlatformDispatchAsyncBackground([source, texture_w, driver_w] {
+        std::shared_ptr<VROImage> image = source();
+        
+        VROPlatformDispatchAsyncRenderer([image, texture_w, driver_w] {
+            std::shared_ptr<VROTexture> texture = texture_w.lock();
+            std::shared_ptr<VRODriver> driver = driver_w.lock();
+            if (!texture) {
+                return;
+            }
+            texture->_reloadPending = false;
+            
+            // Without its image the texture can't be reloaded again, and renders blank
+            if (!image) {
+                pwarn("Failed to reload evicted texture %s", texture->getName().c_str());
+                texture->_reloadSource = nullptr;
+                texture->_streamingSource = nullptr;
+                return;
+            }
+            if (driver && !texture->isHydrated()) {
+                texture->_images = { image };
+                texture->scheduleHydrationTask(driver);
+            }
+        });
+    });
+}
+
 int VROTexture::getNumSubstratesForFormat(VROTextureInternalFormat format) const {
     if (format == VROTextureInternalFormat::YCBCR) {
         return 2;
@@ -286,7 +723,8 @@ int VROTexture::getNumSubstratesForFormat(VROTextureInternalFormat format) const
 }
 
 bool VROTexture::hasAlpha() const {
-    return _format != VROTextureFormat::RGB565 && _format != VROTextureFormat::RGB8;
+    return _format != VROTextureFormat::RGB565 && _format != VROTextureFormat::RGB8 &&
+           _format != VROTextureFormat::RG16F;
 }
 
 void VROTexture::setWrapS(VROWrapMode wrapMode) {
@@ -32,6 +32,7 @@
 #include <string>
 #include <functional>
 #include "VRODefines.h"
+#include "VROVector4f.h"
 
 // Constants for ETC2 ripped from NDKr9 headers
 #define GL_COMPRESSED_RGB8_ETC2                          0x9274
@@ -42,6 +43,13 @@ class VRODriver;
 class VROImage;
 class VROData;
 class VROFrameScheduler;
+enum class VROResourceType;
+
+/*
+ Textures larger than this in either dimension are never packed onto a texture
+ atlas (see VROTexture::setAtlasPackingEnabled).
+ */
+static const int kTextureAtlasMaxImageSize = 256;
 
 enum class VROTextureType {
     None = 1,
@@ -59,6 +67,8 @@ enum class VROTextureFormat {
     RGB8,
     RGB9_E5,
     RGB16F,
+    RGBA16F,
+    RG16F,
 };
 
 // Texture formats for storage on the GPU
@@ -74,6 +84,8 @@ enum class VROTextureInternalFormat {
     YCBCR,
     RGB9_E5,
     RGB16F,
+    RGBA16F,
+    RG16F,
     RG8,
 };
 
@@ -161,8 +173,9 @@ public:
     
     /*
      Upload this texture to the GPU asynchronously (on the rendering thread). Invoke
-     the given callback when hydration is complete. No-op if the texture is already
-     hydrated.
+     the given callback when the texture is fully resident; the callback is invoked
+     immediately if the texture is already hydrated. Large uncompressed textures are
+     uploaded a band of rows per frame.
      */
     void hydrateAsync(std::function<void()> callback,
                       std::shared_ptr<VRODriver> &driver);
@@ -187,6 +200,156 @@ public:
     void setName(std::string name) {
         _name = name;
     }
+    
+    /*
+     Hash of the source data this texture was loaded from, or 0 if unknown. Used
+     to key on-disk caches of data derived from the texture (e.g. VROIBLCache).
+     */
+    uint64_t getContentHash() const { return _contentHash; }
+    void setContentHash(uint64_t hash) {
+        _contentHash = hash;
+    }
+
+    /*
+     The resource (file path or URL) this texture was loaded from, if known, and
+     its type. Lets VROSceneArchive reference the texture instead of storing it.
+     */
+    const std::string &getSourceResource() const { return _sourceResource; }
+    VROResourceType getSourceResourceType() const { return _sourceResourceType; }
+    void setSourceResource(std::string resource, VROResourceType type) {
+        _sourceResource = resource;
+        _sourceResourceType = type;
+    }
+
+    /*
+     True if the texture is gamma-uncorrected from sRGB when sampled.
+     */
+    bool isSRGB() const { return _sRGB; }
+
+    /*
+     Stream this texture. A streamed texture is first uploaded at low resolution;
+     afterward the driver's VROTextureStreamer raises or lowers its resolution to
+     match the on-screen size of the geometry using it, within the GPU memory
+     budget for streamed textures. The source is invoked on a background thread
+     each time a different resolution is needed, and must return the full
+     resolution image. Only 2D textures created from 8-bit RGB(A) images are streamed.
+     */
+    void setStreamingSource(std::function<std::shared_ptr<VROImage>()> source);
+    bool isStreamed() const {
+        return _streamingSource != nullptr;
+    }
+
+    /*
+     Record the on-screen size, in pixels, of geometry that rendered with this
+     texture during the given frame. The size is ignored for textures that are
+     not streamed, but the frame is recorded for all textures (see
+     getLastRenderedFrame).
+     */
+    void updateScreenSize(float pixels, int frame);
+
+    /*
+     Provide the image this texture was created from, so that the texture can be
+     evicted under memory pressure and reloaded when next rendered (see
+     VROResidencyManager). The source is invoked on a background thread, and must
+     return an image of the same format as the original. Streamed textures reload
+     from their streaming source instead. Only 2D textures with a single substrate
+     are evicted.
+     */
+    void setReloadSource(std::function<std::shared_ptr<VROImage>()> source) {
+        _reloadSource = source;
+    }
+    bool isReloadable() const;
+
+    /*
+     Release the substrate of this texture, to be reloaded from its source the
+     next time it is rendered. Returns the estimated GPU memory released, in
+     bytes, or -1 if the texture could not be evicted.
+     */
+    int64_t evict();
+
+    /*
+     The last frame in which geometry was rendered with this texture, or -1 if
+     it has not been rendered.
+     */
+    int getLastRenderedFrame() const {
+        return _lastRenderedFrame;
+    }
+
+    /*
+     Streaming state, used by the VROTextureStreamer. A level is the number of
+     mip levels dropped from full resolution: level 0 is full resolution, and
+     level getStreamingLevelCount() - 1 the lowest resolution streamed. The
+     resident level is -1 until the texture is first uploaded.
+     */
+    int getStreamingLevelCount() const;
+    int getStreamingLevel() const {
+        return _streamingLevel;
+    }
+    bool isStreamingLevelPending() const {
+        return _streamingPendingLevel >= 0;
+    }
+    uint32_t getStreamingBytes(int level) const;
+    float getScreenSize() const {
+        return _screenSize;
+    }
+    int getScreenSizeFrame() const {
+        return _screenSizeFrame;
+    }
+
+    /*
+     Pack this texture into a texture array shared with other textures of the
+     same size, format, and sampling state. Materials whose diffuse textures
+     share an array can be instanced and multi-drawn together, so this is best
+     enabled for the textures that distinguish otherwise identical materials
+     (e.g. the variants of a product catalog). Only uncompressed 2D textures
+     with a single image are packed, and the wrap modes of packed textures are
+     fixed once hydrated. Must be set before the texture is hydrated.
+     */
+    void setArrayPackingEnabled(bool enabled) {
+        _arrayPackingEnabled = enabled;
+    }
+    bool isArrayPackingEnabled() const {
+        return _arrayPackingEnabled;
+    }
+
+    /*
+     The ID of the texture array this texture was packed into and its layer
+     within that array, or 0 and -1 if the texture is not packed (or not yet
+     hydrated).
+     */
+    uint32_t getTextureArrayId() const;
+    int getTextureArrayLayer() const;
+
+    /*
+     Pack this texture onto a texture atlas page shared with other small
+     textures. As with array packing, materials whose diffuse textures share a
+     page can be multi-drawn together, which suits the many small images of
+     2D UI (e.g. VROSurface-based HUDs). Only uncompressed 2D RGB(A) textures
+     with a single image of at most kTextureAtlasMaxImageSize pixels on a side,
+     and clamped wrap modes, are packed. Atlased textures are stored without
+     mipmaps, and may only be used as diffuse textures. Must be set before the
+     texture is hydrated.
+     */
+    void setAtlasPackingEnabled(bool enabled) {
+        _atlasPackingEnabled = enabled;
+    }
+    bool isAtlasPackingEnabled() const {
+        return _atlasPackingEnabled;
+    }
+
+    /*
+     The ID of the atlas page this texture was packed onto, and the region it
+     occupies as a texture coordinate offset (x, y) and scale (z, w). Returns 0
+     and the full texture if this texture is not atlased (or not yet hydrated).
+     */
+    uint32_t getTextureAtlasId() const;
+    VROVector4f getTextureAtlasRect() const;
+
+    /*
+     Load the given level from the streaming source in the background, and swap
+     it in once uploaded.
+     */
+    void requestStreamingLevel(int level, std::shared_ptr<VRODriver> driver);
 
     /*
      Get the texture ready for usage now, in advance of when it's visible. If not invoked,
@@ -349,16 +512,97 @@ private:
      */
     std::vector<std::function<void()>> _hydrationCallbacks;
 
+    /*
+     State of an incremental upload: the substrate being filled (which only
+     becomes visible in _substrates once complete), its source data, and the
+     number of rows uploaded so far.
+     */
+    std::unique_ptr<VROTextureSubstrate> _pendingSubstrate;
+    std::shared_ptr<VROData> _pendingData;
+    int _pendingRowsUploaded;
+    
+    /*
+     Hash of the source data, see getContentHash().
+     */
+    uint64_t _contentHash;
+
+    /*
+     Source of the texture, see getSourceResource().
+     */
+    std::string _sourceResource;
+    VROResourceType _sourceResourceType = (VROResourceType) 0;
+
+    /*
+     Streaming state: see setStreamingSource(). The screen size is the largest
+     recorded during _screenSizeFrame.
+     */
+    std::function<std::shared_ptr<VROImage>()> _streamingSource;
+    int _streamingLevel = -1;
+    int _streamingPendingLevel = -1;
+    float _screenSize = 0;
+    int _screenSizeFrame = -1;
+
+    /*
+     Residency state: see setReloadSource(). The texture is registered with the
+     VROResidencyManager when first hydrated, and a reload of its image is
+     pending while being re-hydrated in the background.
+     */
+    std::function<std::shared_ptr<VROImage>()> _reloadSource;
+    int _lastRenderedFrame = -1;
+    bool _residencyTracked = false;
+    bool _reloadPending = false;
+
+    /*
+     True if this texture should be packed into a texture array when hydrated.
+     */
+    bool _arrayPackingEnabled = false;
+    bool isArrayPackable() const;
+
+    /*
+     True if this texture should be packed onto an atlas page when hydrated.
+     */
+    bool _atlasPackingEnabled = false;
+    bool isAtlasPackable() const;
+
+    /*
+     Create the substrate for the given data, packing it into a texture array
+     if enabled and possible.
+     */
+    VROTextureSubstrate *newSubstrate(std::vector<std::shared_ptr<VROData>> &data, std::shared_ptr<VRODriver> &driver);
+
+    /*
+     Upload the lowest streamed level from the retained image, and register the
+     texture with the streamer. Returns false if the image can't be streamed.
+     */
+    bool hydrateStreamed(std::shared_ptr<VRODriver> &driver);
+    void installStreamingLevel(int level, std::shared_ptr<VROData> data, int width, int height,
+                               std::shared_ptr<VRODriver> &driver);
+
     /*
      Converts the image(s) into a substrate. May be asynchronously executed.
      */
     void hydrate(std::shared_ptr<VRODriver> &driver);
+
+    /*
+     Perform one slice of an incremental hydration, uploading a band of rows
+     to the GPU. Returns true when the texture is hydrated. Textures that can't
+     be uploaded incrementally are hydrated in full on the first slice.
+     */
+    bool hydrateSlice(std::shared_ptr<VRODriver> &driver);
+    bool isIncrementalHydrationSupported() const;
+    void onHydrated(std::shared_ptr<VRODriver> &driver);
+
+    /*
+     Load the image of an evicted texture from its source and hydrate it. If
+     immediate is false, the image is loaded in the background.
+     */
+    void reload(std::shared_ptr<VRODriver> &driver, bool immediate);
     
     /*
-     Create a task to hydrate the texture.
+     Schedule a task on the frame scheduler to hydrate the texture.
      */
     std::string getHydrationTaskKey() const;
-    std::function<void()> createHydrationTask(std::shared_ptr<VRODriver> &driver);
+    void scheduleHydrationTask(std::shared_ptr<VRODriver> &driver);
     
     /*
      Set the number of substrates to be used by this texture.
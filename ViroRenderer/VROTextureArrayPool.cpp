@@ -0,0 +1,282 @@
+//
+//  VROTextureArrayPool.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROTextureArrayPool.h"
+#include "VROTextureSubstrateOpenGL.h"
+#include "VROTexture.h"
+#include "VRODriverOpenGL.h"
+#include "VROData.h"
+#include "VROLog.h"
+#include "VROAllocationTracker.h"
+#include <algorithm>
+
+static uint32_t sTextureArrayId = 1;
+
+/*
+ Saves the framebuffer bindings and scissor test, which layer blits would
+ otherwise disturb, and restores them when destroyed.
+ */
+class VROTextureArrayBlitState {
+public:
+    VROTextureArrayBlitState() {
+        GL( glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &_readFramebuffer) );
+        GL( glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &_drawFramebuffer) );
+        _scissorEnabled = glIsEnabled(GL_SCISSOR_TEST);
+        if (_scissorEnabled) {
+            GL( glDisable(GL_SCISSOR_TEST) );
+        }
+    }
+    ~VROTextureArrayBlitState() {
+        GL( glBindFramebuffer(GL_READ_FRAMEBUFFER, _readFramebuffer) );
+        GL( glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _drawFramebuffer) );
+        if (_scissorEnabled) {
+            GL( glEnable(GL_SCISSOR_TEST) );
+        }
+    }
+private:
+    GLint _readFramebuffer, _drawFramebuffer;
+    GLboolean _scissorEnabled;
+};
+
+#pragma mark - VROTextureArray
+
+VROTextureArray::VROTextureArray(VROTextureArrayFormat format, int maxLayers, std::shared_ptr<VRODriverOpenGL> driver) :
+    _arrayId(sTextureArrayId++),
+    _format(format),
+    _maxLayers(maxLayers),
+    _readFramebuffer(0),
+    _drawFramebuffer(0),
+    _driver(driver) {
+    
+    int numLayers = std::min(kInitialTextureArrayLayers, maxLayers);
+    _texture = createTexture(numLayers);
+    _usedLayers.resize(numLayers, false);
+    ALLOCATION_TRACKER_ADD(TextureMemory, getMemoryBytes(numLayers));
+}
+
+VROTextureArray::~VROTextureArray() {
+    ALLOCATION_TRACKER_SUB(TextureMemory, getMemoryBytes((int) _usedLayers.size()));
+    std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
+    if (driver) {
+        driver->deleteTexture(_texture);
+        if (_readFramebuffer != 0) {
+            driver->deleteFramebuffer(_readFramebuffer);
+            driver->deleteFramebuffer(_drawFramebuffer);
+        }
+    }
+}
+
+GLuint VROTextureArray::createTexture(int numLayers) {
+    std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
+    passert (driver != nullptr);
+    
+    GLuint texture;
+    GL( glGenTextures(1, &texture) );
+    driver->bindTexture(GL_TEXTURE0, GL_TEXTURE_2D_ARRAY, texture);
+    
+    GL( glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, _format.minFilter) );
+    GL( glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, _format.magFilter) );
+    GL( glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, _format.wrapS) );
+    GL( glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, _format.wrapT) );
+    GL( glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, _format.levels - 1) );
+    
+#if VRO_SUPPORTS_TEXTURE_STORAGE
+    GL( glTexStorage3D(GL_TEXTURE_2D_ARRAY, _format.levels, _format.internalFormat,
+                       _format.width, _format.height, numLayers) );
+#else
+    for (int level = 0; level < _format.levels; level++) {
+        GL( glTexImage3D(GL_TEXTURE_2D_ARRAY, level, _format.internalFormat,
+                         std::max(_format.width >> level, 1), std::max(_format.height >> level, 1), numLayers, 0,
+                         _format.pixelFormat, _format.pixelType, nullptr) );
+    }
+#endif
+    return texture;
+}
+
+int VROTextureArray::allocateLayer(const void *pixels) {
+    auto freeLayer = std::find(_usedLayers.begin(), _usedLayers.end(), false);
+    int layer = (int) (freeLayer - _usedLayers.begin());
+    if (freeLayer == _usedLayers.end()) {
+        if (_usedLayers.size() >= _maxLayers) {
+            return -1;
+        }
+        grow(std::min((int) _usedLayers.size() * 2, _maxLayers));
+    }
+    _usedLayers[layer] = true;
+    
+    std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
+    driver->bindTexture(GL_TEXTURE0, GL_TEXTURE_2D_ARRAY, _texture);
+    GL( glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, _format.width, _format.height, 1,
+                        _format.pixelFormat, _format.pixelType, pixels) );
+    if (_format.levels > 1) {
+        generateMipmaps(layer);
+    }
+    return layer;
+}
+
+void VROTextureArray::freeLayer(int layer) {
+    passert (layer >= 0 && layer < _usedLayers.size());
+    _usedLayers[layer] = false;
+}
+
+void VROTextureArray::grow(int numLayers) {
+    pinfo("Growing texture array %d (%dx%d) to %d layers", _arrayId, _format.width, _format.height, numLayers);
+    GLuint texture = createTexture(numLayers);
+    
+    // Copy every level of each used layer, so the layers' mipmaps aren't rebuilt
+    for (int layer = 0; layer < _usedLayers.size(); layer++) {
+        if (!_usedLayers[layer]) {
+            continue;
+        }
+        for (int level = 0; level < _format.levels; level++) {
+            blit(_texture, level, texture, level, layer, GL_NEAREST);
+        }
+    }
+    
+    std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
+    driver->deleteTexture(_texture);
+    _texture = texture;
+    ALLOCATION_TRACKER_RESIZE(TextureMemory, getMemoryBytes((int) _usedLayers.size()), getMemoryBytes(numLayers));
+    _usedLayers.resize(numLayers, false);
+}
+
+int64_t VROTextureArray::getMemoryBytes(int numLayers) const {
+    int bytesPerPixel = (_format.pixelType == GL_UNSIGNED_SHORT_5_6_5 ||
+                         _format.pixelType == GL_UNSIGNED_SHORT_4_4_4_4) ? 2 : 4;
+    int64_t bytes = (int64_t) _format.width * _format.height * bytesPerPixel * numLayers;
+    if (_format.levels > 1) {
+        bytes += bytes / 3;
+    }
+    return bytes;
+}
+
+void VROTextureArray::generateMipmaps(int layer) {
+    for (int level = 1; level < _format.levels; level++) {
+        blit(_texture, level - 1, _texture, level, layer, GL_LINEAR);
+    }
+}
+
+void VROTextureArray::blit(GLuint source, int sourceLevel, GLuint destination, int destinationLevel, int layer,
+                           GLenum filter) {
+    if (_readFramebuffer == 0) {
+        GL( glGenFramebuffers(1, &_readFramebuffer) );
+        GL( glGenFramebuffers(1, &_drawFramebuffer) );
+    }
+    VROTextureArrayBlitState state;
+    
+    GL( glBindFramebuffer(GL_READ_FRAMEBUFFER, _readFramebuffer) );
+    GL( glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, source, sourceLevel, layer) );
+    GL( glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _drawFramebuffer) );
+    GL( glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, destination, destinationLevel, layer) );
+    
+    GL( glBlitFramebuffer(0, 0, std::max(_format.width >> sourceLevel, 1), std::max(_format.height >> sourceLevel, 1),
+                          0, 0, std::max(_format.width >> destinationLevel, 1), std::max(_format.height >> destinationLevel, 1),
+                          GL_COLOR_BUFFER_BIT, filter) );
+    
+    // Detach the layers, so the framebuffers don't keep the arrays' storage alive
+    GL( glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, 0, 0, 0) );
+    GL( glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, 0, 0, 0) );
+}
+
+#pragma mark - VROTextureArrayPool
+
+VROTextureArrayPool::VROTextureArrayPool(std::shared_ptr<VRODriverOpenGL> driver) :
+    _driver(driver) {
+    
+    GLint maxLayers = kMaxTextureArrayLayers;
+    GL( glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers) );
+    _maxLayers = std::max(1, std::min((int) maxLayers, kMaxTextureArrayLayers));
+}
+
+VROTextureArrayPool::~VROTextureArrayPool() {
+    
+}
+
+VROTextureSubstrateOpenGL *VROTextureArrayPool::newLayerSubstrate(VROTextureFormat format,
+                                                                  VROTextureInternalFormat internalFormat, bool sRGB,
+                                                                  VROMipmapMode mipmapMode,
+                                                                  std::shared_ptr<VROData> data,
+                                                                  int width, int height,
+                                                                  VROWrapMode wrapS, VROWrapMode wrapT,
+                                                                  VROFilterMode minFilter, VROFilterMode magFilter,
+                                                                  VROFilterMode mipFilter) {
+    std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
+    if (!driver || !data || data->getData() == nullptr || mipmapMode == VROMipmapMode::Pregenerated) {
+        return nullptr;
+    }
+    
+    // Only uncompressed, color-renderable formats are packed, since layers are
+    // copied and downsampled by blitting
+    VROTextureArrayFormat arrayFormat;
+    if ((format == VROTextureFormat::RGBA8 || format == VROTextureFormat::RGB8) &&
+        (internalFormat == VROTextureInternalFormat::RGBA8 || internalFormat == VROTextureInternalFormat::RGBA4)) {
+        arrayFormat.pixelFormat = GL_RGBA;
+        arrayFormat.pixelType = GL_UNSIGNED_BYTE;
+    }
+    else if (format == VROTextureFormat::RGB565 && internalFormat == VROTextureInternalFormat::RGB565) {
+        arrayFormat.pixelFormat = GL_RGB;
+        arrayFormat.pixelType = GL_UNSIGNED_SHORT_5_6_5;
+    }
+    else {
+        return nullptr;
+    }
+    
+    // Array storage is immutable, so the unsized RGBA format is given its size
+    GLuint glInternalFormat = VROTextureSubstrateOpenGL::getInternalFormat(internalFormat,
+                                                                           sRGB && driver->isLinearRenderingEnabled());
+    arrayFormat.internalFormat = (glInternalFormat == GL_RGBA) ? GL_RGBA8 : glInternalFormat;
+    arrayFormat.width = width;
+    arrayFormat.height = height;
+    arrayFormat.levels = 1;
+    if (mipmapMode == VROMipmapMode::Runtime) {
+        while ((std::max(width, height) >> arrayFormat.levels) > 0) {
+            arrayFormat.levels++;
+        }
+    }
+    arrayFormat.wrapS = VROTextureSubstrateOpenGL::convertWrapMode(wrapS);
+    arrayFormat.wrapT = VROTextureSubstrateOpenGL::convertWrapMode(wrapT);
+    arrayFormat.minFilter = VROTextureSubstrateOpenGL::convertMinFilter(mipmapMode, minFilter, mipFilter);
+    arrayFormat.magFilter = VROTextureSubstrateOpenGL::convertMagFilter(magFilter);
+    
+    // Drop the arrays whose layers have all been freed
+    _arrays.erase(std::remove_if(_arrays.begin(), _arrays.end(),
+                                 [](const std::weak_ptr<VROTextureArray> &array) {
+                                     return array.expired();
+                                 }), _arrays.end());
+    
+    for (std::weak_ptr<VROTextureArray> &array_w : _arrays) {
+        std::shared_ptr<VROTextureArray> array = array_w.lock();
+        if (array->getFormat() == arrayFormat) {
+            int layer = array->allocateLayer(data->getData());
+            if (layer >= 0) {
+                return new VROTextureSubstrateOpenGL(array, layer, driver);
+            }
+        }
+    }
+    
+    std::shared_ptr<VROTextureArray> array = std::make_shared<VROTextureArray>(arrayFormat, _maxLayers, driver);
+    _arrays.push_back(array);
+    return new VROTextureSubstrateOpenGL(array, array->allocateLayer(data->getData()), driver);
+}
@@ -0,0 +1,170 @@
+//
+//  VROTextureArrayPool.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROTextureArrayPool_h
+#define VROTextureArrayPool_h
+
+#include <vector>
+#include <memory>
+#include "VROOpenGL.h"
+
+class VRODriverOpenGL;
+class VROTextureSubstrateOpenGL;
+class VROData;
+enum class VROTextureFormat;
+enum class VROTextureInternalFormat;
+enum class VROMipmapMode;
+enum class VROWrapMode;
+enum class VROFilterMode;
+
+/*
+ Texture arrays start with this many layers, and double in size each time
+ they fill, up to kMaxTextureArrayLayers (or the device's limit, if lower).
+ */
+static const int kInitialTextureArrayLayers = 4;
+static const int kMaxTextureArrayLayers = 64;
+
+/*
+ The size, storage format, and sampling state shared by every layer of a
+ texture array.
+ */
+struct VROTextureArrayFormat {
+    int width, height;
+    int levels;
+    GLenum internalFormat;
+    GLenum pixelFormat, pixelType;
+    GLenum wrapS, wrapT;
+    GLenum minFilter, magFilter;
+    
+    bool operator== (const VROTextureArrayFormat &r) const {
+        return width == r.width && height == r.height && levels == r.levels &&
+               internalFormat == r.internalFormat && pixelFormat == r.pixelFormat && pixelType == r.pixelType &&
+               wrapS == r.wrapS && wrapT == r.wrapT &&
+               minFilter == r.minFilter && magFilter == r.magFilter;
+    }
+};
+
+/*
+ A GL_TEXTURE_2D_ARRAY whose layers each hold one texture. The array is shared
+ by the substrates of its layers, and is deleted when the last is freed.
+ 
+ Growing the array reallocates it, so its GL name may change: substrates must
+ read it through getTexture() each time they're bound.
+ */
+class VROTextureArray {
+public:
+    
+    VROTextureArray(VROTextureArrayFormat format, int maxLayers, std::shared_ptr<VRODriverOpenGL> driver);
+    virtual ~VROTextureArray();
+    
+    uint32_t getArrayId() const {
+        return _arrayId;
+    }
+    GLuint getTexture() const {
+        return _texture;
+    }
+    const VROTextureArrayFormat &getFormat() const {
+        return _format;
+    }
+    
+    /*
+     Upload the given pixels, in the array's pixel format, to a free layer, and
+     build the layer's mipmaps. Returns the layer, or -1 if the array is full and
+     cannot grow.
+     */
+    int allocateLayer(const void *pixels);
+    void freeLayer(int layer);
+    
+private:
+    
+    uint32_t _arrayId;
+    VROTextureArrayFormat _format;
+    GLuint _texture;
+    int _maxLayers;
+    
+    /*
+     One entry per layer of the current storage; true if the layer is in use.
+     */
+    std::vector<bool> _usedLayers;
+    
+    /*
+     Framebuffers through which layers are copied and their mipmaps built.
+     */
+    GLuint _readFramebuffer, _drawFramebuffer;
+    std::weak_ptr<VRODriverOpenGL> _driver;
+    
+    GLuint createTexture(int numLayers);
+    void grow(int numLayers);
+    
+    /*
+     Estimated GPU memory of the array's storage with the given number of layers.
+     */
+    int64_t getMemoryBytes(int numLayers) const;
+    
+    /*
+     Build the mipmaps of a single layer by successively downsampling its
+     levels. glGenerateMipmap would rebuild every layer of the array.
+     */
+    void generateMipmaps(int layer);
+    void blit(GLuint source, int sourceLevel, GLuint destination, int destinationLevel, int layer, GLenum filter);
+    
+};
+
+/*
+ VROTextureArrayPool packs textures that may be batched together (see
+ VROTexture::setArrayPackingEnabled) into texture arrays, one set of arrays per
+ VROTextureArrayFormat. Materials whose diffuse textures share an array differ
+ only in the layer they sample, so they can be instanced and multi-drawn
+ together, passing each draw's layer through the instanced transforms.
+ */
+class VROTextureArrayPool {
+public:
+    
+    VROTextureArrayPool(std::shared_ptr<VRODriverOpenGL> driver);
+    virtual ~VROTextureArrayPool();
+    
+    /*
+     Upload the given 2D texture data into a layer of a texture array, returning
+     the substrate of that layer. Returns nullptr if the data cannot be packed,
+     in which case a regular texture should be created.
+     */
+    VROTextureSubstrateOpenGL *newLayerSubstrate(VROTextureFormat format,
+                                                 VROTextureInternalFormat internalFormat, bool sRGB,
+                                                 VROMipmapMode mipmapMode,
+                                                 std::shared_ptr<VROData> data,
+                                                 int width, int height,
+                                                 VROWrapMode wrapS, VROWrapMode wrapT,
+                                                 VROFilterMode minFilter, VROFilterMode magFilter,
+                                                 VROFilterMode mipFilter);
+    
+private:
+    
+    int _maxLayers;
+    std::vector<std::weak_ptr<VROTextureArray>> _arrays;
+    std::weak_ptr<VRODriverOpenGL> _driver;
+    
+};
+
+#endif /* VROTextureArrayPool_h */
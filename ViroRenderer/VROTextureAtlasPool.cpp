@@ -0,0 +1,170 @@
+//
+//  VROTextureAtlasPool.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROTextureAtlasPool.h"
+#include "VROTextureSubstrateOpenGL.h"
+#include "VROTexture.h"
+#include "VRODriverOpenGL.h"
+#include "VROAllocationTracker.h"
+#include "VROData.h"
+#include "VROLog.h"
+#include <algorithm>
+
+static uint32_t sTextureAtlasId = 1;
+
+#pragma mark - VROTextureAtlas
+
+VROTextureAtlas::VROTextureAtlas(GLenum internalFormat, GLenum minFilter, GLenum magFilter,
+                                 std::shared_ptr<VRODriverOpenGL> driver, int size) :
+    _atlasId(sTextureAtlasId++),
+    _size(size),
+    _internalFormat(internalFormat),
+    _minFilter(minFilter),
+    _magFilter(magFilter),
+    _shelfU(0),
+    _shelfTopV(0),
+    _shelfBottomV(0),
+    _driver(driver) {
+    
+    GL( glGenTextures(1, &_texture) );
+    driver->bindTexture(GL_TEXTURE0, GL_TEXTURE_2D, _texture);
+    
+    GL( glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter) );
+    GL( glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magFilter) );
+    GL( glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE) );
+    GL( glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE) );
+    GL( glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, _size, _size, 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, nullptr) );
+    ALLOCATION_TRACKER_ADD(TextureMemory, (int64_t) _size * _size * 4);
+}
+
+VROTextureAtlas::~VROTextureAtlas() {
+    ALLOCATION_TRACKER_SUB(TextureMemory, (int64_t) _size * _size * 4);
+    std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
+    if (driver) {
+        driver->deleteTexture(_texture);
+    }
+}
+
+bool VROTextureAtlas::insert(const void *pixels, int width, int height, VROVector4f *outRect) {
+    int paddedWidth  = width  + kTextureAtlasPadding * 2;
+    int paddedHeight = height + kTextureAtlasPadding * 2;
+    
+    // Start a new shelf if this one is out of room, and fail if there's no room for one
+    if (_shelfU + paddedWidth > _size) {
+        _shelfU = 0;
+        _shelfTopV = _shelfBottomV;
+    }
+    if (_shelfTopV + paddedHeight > _size || paddedWidth > _size) {
+        return false;
+    }
+    int minU = _shelfU;
+    int minV = _shelfTopV;
+    _shelfU += paddedWidth;
+    _shelfBottomV = std::max(_shelfBottomV, minV + paddedHeight);
+    
+    // Surround the image with copies of its edge pixels
+    const uint32_t *source = (const uint32_t *) pixels;
+    std::vector<uint32_t> padded(paddedWidth * paddedHeight);
+    for (int y = 0; y < paddedHeight; y++) {
+        int sourceY = std::min(std::max(y - kTextureAtlasPadding, 0), height - 1);
+        for (int x = 0; x < paddedWidth; x++) {
+            int sourceX = std::min(std::max(x - kTextureAtlasPadding, 0), width - 1);
+            padded[y * paddedWidth + x] = source[sourceY * width + sourceX];
+        }
+    }
+    
+    std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
+    driver->bindTexture(GL_TEXTURE0, GL_TEXTURE_2D, _texture);
+    GL( glTexSubImage2D(GL_TEXTURE_2D, 0, minU, minV, paddedWidth, paddedHeight,
+                        GL_RGBA, GL_UNSIGNED_BYTE, padded.data()) );
+    
+    *outRect = VROVector4f((float) (minU + kTextureAtlasPadding) / _size,
+                           (float) (minV + kTextureAtlasPadding) / _size,
+                           (float) width  / _size,
+                           (float) height / _size);
+    return true;
+}
+
+#pragma mark - VROTextureAtlasPool
+
+VROTextureAtlasPool::VROTextureAtlasPool(std::shared_ptr<VRODriverOpenGL> driver) :
+    _driver(driver) {
+    
+}
+
+VROTextureAtlasPool::~VROTextureAtlasPool() {
+    
+}
+
+VROTextureSubstrateOpenGL *VROTextureAtlasPool::newRegionSubstrate(VROTextureFormat format,
+                                                                   VROTextureInternalFormat internalFormat, bool sRGB,
+                                                                   std::shared_ptr<VROData> data,
+                                                                   int width, int height,
+                                                                   VROFilterMode minFilter, VROFilterMode magFilter) {
+    std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
+    if (!driver || !data || data->getData() == nullptr) {
+        return nullptr;
+    }
+    if (width <= 0 || height <= 0 || width > kTextureAtlasMaxImageSize || height > kTextureAtlasMaxImageSize) {
+        return nullptr;
+    }
+    
+    // Atlased images are uploaded as 8-bit RGBA, and are stored without mipmaps
+    if ((format != VROTextureFormat::RGBA8 && format != VROTextureFormat::RGB8) ||
+        internalFormat != VROTextureInternalFormat::RGBA8) {
+        return nullptr;
+    }
+    GLenum glInternalFormat = VROTextureSubstrateOpenGL::getInternalFormat(internalFormat,
+                                                                           sRGB && driver->isLinearRenderingEnabled());
+    if (glInternalFormat == GL_RGBA) {
+        glInternalFormat = GL_RGBA8;
+    }
+    GLenum glMinFilter = VROTextureSubstrateOpenGL::convertMinFilter(VROMipmapMode::None, minFilter, VROFilterMode::None);
+    GLenum glMagFilter = VROTextureSubstrateOpenGL::convertMagFilter(magFilter);
+    
+    // Drop the atlases whose images have all been freed
+    _atlases.erase(std::remove_if(_atlases.begin(), _atlases.end(),
+                                  [](const std::weak_ptr<VROTextureAtlas> &atlas) {
+                                      return atlas.expired();
+                                  }), _atlases.end());
+    
+    VROVector4f rect;
+    for (std::weak_ptr<VROTextureAtlas> &atlas_w : _atlases) {
+        std::shared_ptr<VROTextureAtlas> atlas = atlas_w.lock();
+        if (atlas->isCompatible(glInternalFormat, glMinFilter, glMagFilter) &&
+            atlas->insert(data->getData(), width, height, &rect)) {
+            return new VROTextureSubstrateOpenGL(atlas, rect, driver);
+        }
+    }
+    
+    std::shared_ptr<VROTextureAtlas> atlas = std::make_shared<VROTextureAtlas>(glInternalFormat, glMinFilter, glMagFilter,
+                                                                               driver);
+    _atlases.push_back(atlas);
+    if (!atlas->insert(data->getData(), width, height, &rect)) {
+        return nullptr;
+    }
+    return new VROTextureSubstrateOpenGL(atlas, rect, driver);
+}
@@ -0,0 +1,126 @@
+//
+//  VROTextureAtlasPool.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROTextureAtlasPool_h
+#define VROTextureAtlasPool_h
+
+#include <vector>
+#include <memory>
+#include "VROOpenGL.h"
+#include "VROVector4f.h"
+
+class VRODriverOpenGL;
+class VROTextureSubstrateOpenGL;
+class VROData;
+enum class VROTextureFormat;
+enum class VROTextureInternalFormat;
+enum class VROFilterMode;
+
+/*
+ Pooled atlas pages are square, kTextureAtlasSize pixels on a side. Each image is
+ surrounded by kTextureAtlasPadding pixels replicating its edges, so that
+ filtering at its borders doesn't bleed in its neighbors.
+ */
+static const int kTextureAtlasSize = 1024;
+static const int kTextureAtlasPadding = 1;
+
+/*
+ A GL_TEXTURE_2D page onto which small RGBA images are packed. Images are
+ placed left to right in rows (shelves), in the same manner as glyphs in a
+ VROGlyphAtlas. Space is not reclaimed as images are freed: the page is shared
+ by the substrates of its images, and is deleted once they are all freed.
+ */
+class VROTextureAtlas {
+public:
+    
+    VROTextureAtlas(GLenum internalFormat, GLenum minFilter, GLenum magFilter,
+                    std::shared_ptr<VRODriverOpenGL> driver, int size = kTextureAtlasSize);
+    virtual ~VROTextureAtlas();
+    
+    uint32_t getAtlasId() const {
+        return _atlasId;
+    }
+    GLuint getTexture() const {
+        return _texture;
+    }
+    bool isCompatible(GLenum internalFormat, GLenum minFilter, GLenum magFilter) const {
+        return _internalFormat == internalFormat && _minFilter == minFilter && _magFilter == magFilter;
+    }
+    
+    /*
+     Pack the given RGBA pixels into this atlas. Returns false if the image does
+     not fit. Otherwise returns true, and sets outRect to the region the image
+     occupies, as a texture coordinate offset (x, y) and scale (z, w).
+     */
+    bool insert(const void *pixels, int width, int height, VROVector4f *outRect);
+    
+private:
+    
+    uint32_t _atlasId;
+    GLuint _texture;
+    int _size;
+    GLenum _internalFormat;
+    GLenum _minFilter, _magFilter;
+    
+    /*
+     The current shelf: the left edge of its free space, and its top and bottom.
+     */
+    int _shelfU, _shelfTopV, _shelfBottomV;
+    std::weak_ptr<VRODriverOpenGL> _driver;
+    
+};
+
+/*
+ VROTextureAtlasPool packs small textures that opt in to atlasing (see
+ VROTexture::setAtlasPackingEnabled) onto shared atlas pages. Materials whose
+ diffuse textures share a page differ only in the region they sample, so
+ they can be multi-drawn together, passing each draw's region through the
+ instanced transforms.
+ */
+class VROTextureAtlasPool {
+public:
+    
+    VROTextureAtlasPool(std::shared_ptr<VRODriverOpenGL> driver);
+    virtual ~VROTextureAtlasPool();
+    
+    /*
+     Pack the given 2D texture data onto an atlas page, returning a substrate
+     for its region of the page. Returns nullptr if the data cannot be packed,
+     in which case a regular texture should be created.
+     */
+    VROTextureSubstrateOpenGL *newRegionSubstrate(VROTextureFormat format,
+                                                  VROTextureInternalFormat internalFormat, bool sRGB,
+                                                  std::shared_ptr<VROData> data,
+                                                  int width, int height,
+                                                  VROFilterMode minFilter, VROFilterMode magFilter);
+    
+private:
+    
+    std::vector<std::weak_ptr<VROTextureAtlas>> _atlases;
+    std::weak_ptr<VRODriverOpenGL> _driver;
+    
+};
+
+#endif /* VROTextureAtlasPool_h */
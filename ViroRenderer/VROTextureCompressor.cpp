@@ -0,0 +1,460 @@
+//
+//  VROTextureCompressor.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include "VROTextureCompressor.h"
+#include "VROImage.h"
+#include "VROTexture.h"
+#include "VROData.h"
+#include "VROJobSystem.h"
+#include "VROLog.h"
+#include <algorithm>
+#include <atomic>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Each 4x4 block is compressed to 8 bytes of EAC alpha followed by 8 bytes of ETC color
+static const int kETC2BlockBytes = 16;
+
+// Rows of blocks are compressed in batches of this many
+static const int kCompressionBatchRows = 4;
+
+static std::atomic<bool> sCompressionEnabled(false);
+
+/*
+ ETC intensity modifiers, indexed by table codeword and then by pixel index.
+ */
+static const int kETCModifiers[8][4] = {
+    {  2,   8,  -2,   -8 },
+    {  5,  17,  -5,  -17 },
+    {  9,  29,  -9,  -29 },
+    { 13,  42, -13,  -42 },
+    { 18,  60, -18,  -60 },
+    { 24,  80, -24,  -80 },
+    { 33, 106, -33, -106 },
+    { 47, 183, -47, -183 },
+};
+
+/*
+ EAC alpha modifiers, indexed by table codeword and then by pixel index. The
+ most negative modifier of each table is at index 3, and the most positive at
+ index 7.
+ */
+static const int kEACModifiers[16][8] = {
+    { -3, -6,  -9, -15, 2, 5, 8, 14 },
+    { -3, -7, -10, -13, 2, 6, 9, 12 },
+    { -2, -5,  -8, -13, 1, 4, 7, 12 },
+    { -2, -4,  -6, -13, 1, 3, 5, 12 },
+    { -3, -6,  -8, -12, 2, 5, 7, 11 },
+    { -3, -7,  -9, -11, 2, 6, 8, 10 },
+    { -4, -7,  -8, -11, 3, 6, 7, 10 },
+    { -3, -5,  -8, -11, 2, 4, 7, 10 },
+    { -2, -6,  -8, -10, 1, 5, 7,  9 },
+    { -2, -5,  -8, -10, 1, 4, 7,  9 },
+    { -2, -4,  -8, -10, 1, 3, 7,  9 },
+    { -2, -5,  -7, -10, 1, 4, 6,  9 },
+    { -3, -4,  -7, -10, 2, 3, 6,  9 },
+    { -1, -2,  -3, -10, 0, 1, 2,  9 },
+    { -4, -6,  -8,  -9, 3, 5, 7,  8 },
+    { -3, -5,  -7,  -9, 2, 4, 6,  8 },
+};
+
+// The EAC table and pixel index whose modifier is zero, used for blocks of constant alpha
+static const int kEACConstantTable = 13;
+static const int kEACConstantIndex = 4;
+
+/*
+ The pixels of each ETC subblock, as indices into a block's pixels (which are
+ in column-major order, like ETC pixel indices). Indexed by the flip bit and
+ then the subblock: unflipped subblocks are 2x4 and side by side, flipped
+ subblocks are 4x2 and stacked.
+ */
+static const int kETCSubblockPixels[2][2][8] = {
+    { { 0, 1, 2, 3, 4, 5, 6, 7 }, { 8, 9, 10, 11, 12, 13, 14, 15 } },
+    { { 0, 1, 4, 5, 8, 9, 12, 13 }, { 2, 3, 6, 7, 10, 11, 14, 15 } },
+};
+
+/*
+ The encoding of one ETC subblock: its quantized base color, and the modifier
+ table and pixel indices that best fit its pixels to that color.
+ */
+struct VROETCSubblock {
+    int color[3];
+    int table;
+    int indices[8];
+    int error;
+};
+
+static inline int VROClamp255(int value) {
+    return std::min(255, std::max(0, value));
+}
+
+static inline void VROWriteBigEndian(uint64_t value, uint8_t *out) {
+    for (int i = 0; i < 8; i++) {
+        out[i] = (uint8_t) (value >> (56 - i * 8));
+    }
+}
+
+#pragma mark - Blocks
+
+/*
+ Read the 4x4 block at the given block coordinates into RGBA pixels in
+ column-major order, repeating the edge pixels of the image past its bounds.
+ */
+static void VROReadBlock(const uint8_t *pixels, int width, int height, int blockX, int blockY, uint8_t block[16][4]) {
+    for (int x = 0; x < 4; x++) {
+        int px = std::min(blockX * 4 + x, width - 1);
+        for (int y = 0; y < 4; y++) {
+            int py = std::min(blockY * 4 + y, height - 1);
+            memcpy(block[x * 4 + y], pixels + ((size_t) py * width + px) * 4, 4);
+        }
+    }
+}
+
+/*
+ Fit the given pixels of a subblock to the given expanded base color, choosing
+ the modifier table and pixel indices with the least squared error.
+ */
+static void VROFitETCSubblock(const uint8_t block[16][4], const int *pixels, const int base[3],
+                              VROETCSubblock *subblock) {
+    subblock->error = INT_MAX;
+    for (int table = 0; table < 8; table++) {
+        int error = 0;
+        int indices[8];
+        for (int p = 0; p < 8 && error < subblock->error; p++) {
+            const uint8_t *pixel = block[pixels[p]];
+            int bestError = INT_MAX;
+            for (int m = 0; m < 4; m++) {
+                int modifier = kETCModifiers[table][m];
+                int dr = VROClamp255(base[0] + modifier) - pixel[0];
+                int dg = VROClamp255(base[1] + modifier) - pixel[1];
+                int db = VROClamp255(base[2] + modifier) - pixel[2];
+                int pixelError = dr * dr + dg * dg + db * db;
+                if (pixelError < bestError) {
+                    bestError = pixelError;
+                    indices[p] = m;
+                }
+            }
+            error += bestError;
+        }
+        if (error < subblock->error) {
+            subblock->error = error;
+            subblock->table = table;
+            memcpy(subblock->indices, indices, sizeof(indices));
+        }
+    }
+}
+
+/*
+ Encode the color of a block in the ETC1-compatible individual (4-bit base
+ colors) or differential (5-bit base colors, 3-bit delta) mode, whichever
+ orientation and mode fits best. Both are valid ETC2.
+ */
+static uint64_t VROEncodeETCBlock(const uint8_t block[16][4]) {
+    bool bestFlip = false;
+    bool bestDifferential = false;
+    VROETCSubblock best[2];
+    int bestError = INT_MAX;
+    
+    for (int flip = 0; flip < 2; flip++) {
+        float average[2][3];
+        for (int s = 0; s < 2; s++) {
+            int sum[3] = { 0, 0, 0 };
+            for (int p = 0; p < 8; p++) {
+                const uint8_t *pixel = block[kETCSubblockPixels[flip][s][p]];
+                sum[0] += pixel[0];
+                sum[1] += pixel[1];
+                sum[2] += pixel[2];
+            }
+            for (int c = 0; c < 3; c++) {
+                average[s][c] = sum[c] / 8.0f;
+            }
+        }
+        
+        for (int differential = 0; differential < 2; differential++) {
+            VROETCSubblock subblocks[2];
+            int colors[2][3];
+            for (int s = 0; s < 2; s++) {
+                for (int c = 0; c < 3; c++) {
+                    int levels = differential ? 31 : 15;
+                    colors[s][c] = std::min(levels, std::max(0, (int) (average[s][c] * levels / 255.0f + 0.5f)));
+                }
+            }
+            
+            // The differential mode requires each component of the second color to be within
+            // [-4, 3] of the first
+            if (differential) {
+                bool representable = true;
+                for (int c = 0; c < 3; c++) {
+                    int delta = colors[1][c] - colors[0][c];
+                    representable &= (delta >= -4 && delta <= 3);
+                }
+                if (!representable) {
+                    continue;
+                }
+            }
+            
+            int error = 0;
+            for (int s = 0; s < 2; s++) {
+                int expanded[3];
+                for (int c = 0; c < 3; c++) {
+                    expanded[c] = differential ? (colors[s][c] << 3) | (colors[s][c] >> 2) : colors[s][c] * 17;
+                }
+                memcpy(subblocks[s].color, colors[s], sizeof(colors[s]));
+                VROFitETCSubblock(block, kETCSubblockPixels[flip][s], expanded, &subblocks[s]);
+                error += subblocks[s].error;
+            }
+            
+            if (error < bestError) {
+                bestError = error;
+                bestFlip = flip;
+                bestDifferential = differential;
+                best[0] = subblocks[0];
+                best[1] = subblocks[1];
+            }
+        }
+    }
+    
+    uint64_t bits = 0;
+    if (bestDifferential) {
+        for (int c = 0; c < 3; c++) {
+            int delta = best[1].color[c] - best[0].color[c];
+            bits |= (uint64_t) best[0].color[c] << (59 - c * 8);
+            bits |= (uint64_t) (delta & 7) << (56 - c * 8);
+        }
+    }
+    else {
+        for (int c = 0; c < 3; c++) {
+            bits |= (uint64_t) best[0].color[c] << (60 - c * 8);
+            bits |= (uint64_t) best[1].color[c] << (56 - c * 8);
+        }
+    }
+    bits |= (uint64_t) best[0].table << 37;
+    bits |= (uint64_t) best[1].table << 34;
+    bits |= (uint64_t) bestDifferential << 33;
+    bits |= (uint64_t) bestFlip << 32;
+    
+    for (int s = 0; s < 2; s++) {
+        for (int p = 0; p < 8; p++) {
+            int pixel = kETCSubblockPixels[bestFlip][s][p];
+            int index = best[s].indices[p];
+            bits |= (uint64_t) (index >> 1) << (16 + pixel);
+            bits |= (uint64_t) (index & 1) << pixel;
+        }
+    }
+    return bits;
+}
+
+/*
+ Encode the alpha of a block with EAC, searching each modifier table with the
+ multipliers that best span the block's range of alpha.
+ */
+static uint64_t VROEncodeEACBlock(const uint8_t block[16][4]) {
+    int minAlpha = 255, maxAlpha = 0;
+    for (int p = 0; p < 16; p++) {
+        minAlpha = std::min(minAlpha, (int) block[p][3]);
+        maxAlpha = std::max(maxAlpha, (int) block[p][3]);
+    }
+    
+    int bestBase = minAlpha;
+    int bestMultiplier = 1;
+    int bestTable = kEACConstantTable;
+    int bestIndices[16];
+    std::fill(bestIndices, bestIndices + 16, kEACConstantIndex);
+    
+    if (minAlpha != maxAlpha) {
+        int bestError = INT_MAX;
+        for (int table = 0; table < 16 && bestError > 0; table++) {
+            int tableMin = kEACModifiers[table][3];
+            int tableMax = kEACModifiers[table][7];
+            int spanMultiplier = (maxAlpha - minAlpha + (tableMax - tableMin) / 2) / (tableMax - tableMin);
+            
+            for (int multiplier = std::max(1, spanMultiplier - 1); multiplier <= std::min(15, spanMultiplier + 1); multiplier++) {
+                float center = (minAlpha + maxAlpha) / 2.0f - (tableMax + tableMin) * multiplier / 2.0f;
+                int base = VROClamp255((int) (center + 0.5f));
+                
+                int error = 0;
+                int indices[16];
+                for (int p = 0; p < 16 && error < bestError; p++) {
+                    int bestPixelError = INT_MAX;
+                    for (int i = 0; i < 8; i++) {
+                        int delta = VROClamp255(base + kEACModifiers[table][i] * multiplier) - block[p][3];
+                        if (delta * delta < bestPixelError) {
+                            bestPixelError = delta * delta;
+                            indices[p] = i;
+                        }
+                    }
+                    error += bestPixelError;
+                }
+                if (error < bestError) {
+                    bestError = error;
+                    bestBase = base;
+                    bestMultiplier = multiplier;
+                    bestTable = table;
+                    memcpy(bestIndices, indices, sizeof(indices));
+                }
+            }
+        }
+    }
+    
+    uint64_t bits = (uint64_t) bestBase << 56;
+    bits |= (uint64_t) bestMultiplier << 52;
+    bits |= (uint64_t) bestTable << 48;
+    for (int p = 0; p < 16; p++) {
+        bits |= (uint64_t) bestIndices[p] << (45 - p * 3);
+    }
+    return bits;
+}
+
+#pragma mark - Compression
+
+/*
+ Filter the given RGBA8 level down to the next level of its mip chain, with a
+ 2x2 box filter.
+ */
+static std::vector<uint8_t> VRODownsample(const uint8_t *pixels, int width, int height, int *outWidth, int *outHeight) {
+    int levelWidth = std::max(1, width / 2);
+    int levelHeight = std::max(1, height / 2);
+    std::vector<uint8_t> level((size_t) levelWidth * levelHeight * 4);
+    
+    for (int y = 0; y < levelHeight; y++) {
+        int y0 = std::min(y * 2, height - 1);
+        int y1 = std::min(y * 2 + 1, height - 1);
+        for (int x = 0; x < levelWidth; x++) {
+            int x0 = std::min(x * 2, width - 1);
+            int x1 = std::min(x * 2 + 1, width - 1);
+            for (int c = 0; c < 4; c++) {
+                int sum = pixels[((size_t) y0 * width + x0) * 4 + c] + pixels[((size_t) y0 * width + x1) * 4 + c] +
+                          pixels[((size_t) y1 * width + x0) * 4 + c] + pixels[((size_t) y1 * width + x1) * 4 + c];
+                level[((size_t) y * levelWidth + x) * 4 + c] = (uint8_t) ((sum + 2) / 4);
+            }
+        }
+    }
+    
+    *outWidth = levelWidth;
+    *outHeight = levelHeight;
+    return level;
+}
+
+void VROTextureCompressor::setEnabled(bool enabled) {
+    sCompressionEnabled = enabled;
+}
+
+bool VROTextureCompressor::isEnabled() {
+    return sCompressionEnabled;
+}
+
+bool VROTextureCompressor::compress(std::shared_ptr<VROImage> image, VROCompressedTexture *outTexture) {
+    if (!image || image->getInternalFormat() != VROTextureInternalFormat::RGBA8) {
+        return false;
+    }
+    
+    image->lock();
+    size_t length = 0;
+    const uint8_t *pixels = image->getData(&length);
+    int width = image->getWidth();
+    int height = image->getHeight();
+    if (!pixels || width <= 0 || height <= 0 || length < (size_t) width * height * 4) {
+        image->unlock();
+        return false;
+    }
+    
+    /*
+     Filter the mip chain, down to 1x1.
+     */
+    std::vector<std::vector<uint8_t>> downsampled;
+    std::vector<const uint8_t *> levelPixels = { pixels };
+    std::vector<int> levelWidths = { width };
+    std::vector<int> levelHeights = { height };
+    while (levelWidths.back() > 1 || levelHeights.back() > 1) {
+        int levelWidth, levelHeight;
+        downsampled.push_back(VRODownsample(levelPixels.back(), levelWidths.back(), levelHeights.back(),
+                                            &levelWidth, &levelHeight));
+        levelPixels.push_back(downsampled.back().data());
+        levelWidths.push_back(levelWidth);
+        levelHeights.push_back(levelHeight);
+    }
+    
+    /*
+     Compress each level, splitting the levels into batches of block rows.
+     */
+    struct VROCompressionBatch {
+        int level;
+        int firstRow;
+        int lastRow;
+    };
+    std::vector<VROCompressionBatch> batches;
+    std::vector<uint32_t> mipSizes;
+    std::vector<size_t> mipOffsets;
+    size_t dataLength = 0;
+    for (int level = 0; level < levelPixels.size(); level++) {
+        int blockColumns = (levelWidths[level] + 3) / 4;
+        int blockRows = (levelHeights[level] + 3) / 4;
+        mipSizes.push_back((uint32_t) (blockColumns * blockRows * kETC2BlockBytes));
+        mipOffsets.push_back(dataLength);
+        dataLength += mipSizes.back();
+        
+        for (int row = 0; row < blockRows; row += kCompressionBatchRows) {
+            batches.push_back({ level, row, std::min(blockRows, row + kCompressionBatchRows) });
+        }
+    }
+    
+    // Will be moved to VROData so does not need to be explicitly freed!
+    uint8_t *data = (uint8_t *) malloc(dataLength);
+    VROJobSystem::getShared()->parallelFor(0, (int) batches.size(), 1,
+                           [&batches, &levelPixels, &levelWidths, &levelHeights, &mipOffsets, data](int b) {
+        const VROCompressionBatch &batch = batches[b];
+        int levelWidth = levelWidths[batch.level];
+        int levelHeight = levelHeights[batch.level];
+        int blockColumns = (levelWidth + 3) / 4;
+        
+        uint8_t block[16][4];
+        for (int row = batch.firstRow; row < batch.lastRow; row++) {
+            for (int column = 0; column < blockColumns; column++) {
+                VROReadBlock(levelPixels[batch.level], levelWidth, levelHeight, column, row, block);
+                
+                uint8_t *out = data + mipOffsets[batch.level] + ((size_t) row * blockColumns + column) * kETC2BlockBytes;
+                VROWriteBigEndian(VROEncodeEACBlock(block), out);
+                VROWriteBigEndian(VROEncodeETCBlock(block), out + 8);
+            }
+        }
+    });
+    image->unlock();
+    
+    outTexture->data = std::make_shared<VROData>((void *) data, (int) dataLength, VRODataOwnership::Move);
+    outTexture->mipSizes = mipSizes;
+    outTexture->width = width;
+    outTexture->height = height;
+    return true;
+}
+
+std::shared_ptr<VROTexture> VROTextureCompressor::createTexture(const VROCompressedTexture &texture, bool sRGB) {
+    std::vector<std::shared_ptr<VROData>> data = { texture.data };
+    return std::make_shared<VROTexture>(VROTextureType::Texture2D, VROTextureFormat::ETC2_RGBA8_EAC,
+                                        VROTextureInternalFormat::RGBA8, sRGB,
+                                        texture.mipSizes.size() > 1 ? VROMipmapMode::Pregenerated : VROMipmapMode::None,
+                                        data, texture.width, texture.height, texture.mipSizes);
+}
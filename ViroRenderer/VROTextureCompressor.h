@@ -0,0 +1,87 @@
+//
+//  VROTextureCompressor.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef VROTextureCompressor_h
+#define VROTextureCompressor_h
+
+#include <memory>
+#include <vector>
+#include <stdint.h>
+
+class VROData;
+class VROImage;
+class VROTexture;
+
+/*
+ Texture data compressed for the GPU by VROTextureCompressor: ETC2 RGBA8 data
+ with successive mipmap levels concatenated contiguously together, largest
+ first.
+ */
+struct VROCompressedTexture {
+    std::shared_ptr<VROData> data;
+    std::vector<uint32_t> mipSizes;
+    int width;
+    int height;
+};
+
+/*
+ Compresses decoded images into ETC2 RGBA8 textures on the device, cutting the
+ GPU memory of each texture to a quarter of RGBA8 (one byte per pixel). ETC2 is
+ supported by all OpenGL ES 3.0 devices. Compressed textures can't generate
+ mipmaps at runtime, so a full mip chain is filtered and compressed with each
+ image.
+ 
+ The encoder favors speed over quality: each 4x4 block is encoded in the
+ ETC1-compatible individual or differential mode that best fits its average
+ colors, with alpha encoded by EAC. Blocks are compressed in parallel on a
+ small pool of worker threads dedicated to compression, along with the calling
+ thread.
+ 
+ Compression is off by default, as it is lossy; when enabled, textures that
+ models download over HTTP are compressed, and the result is stored with them
+ in the asset cache (see VROModelIOUtil).
+ */
+class VROTextureCompressor {
+public:
+    
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+    
+    /*
+     Compress the given image. Only images decoded to RGBA8 are compressed;
+     returns false for all others. May be invoked from any thread, but is
+     intended for background threads.
+     */
+    static bool compress(std::shared_ptr<VROImage> image, VROCompressedTexture *outTexture);
+    
+    /*
+     Create a texture from the given compressed data.
+     */
+    static std::shared_ptr<VROTexture> createTexture(const VROCompressedTexture &texture, bool sRGB);
+    
+};
+
+#endif /* VROTextureCompressor_h */
@@ -0,0 +1,180 @@
+//
+//  VROTextureStreamer.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROTextureStreamer.h"
+#include "VROTexture.h"
+#include "VRODriver.h"
+#include "VROAllocationTracker.h"
+#include <algorithm>
+
+// The default budget for streamed textures
+static const size_t kDefaultStreamingBudget = 256 * 1024 * 1024;
+
+// Streaming decisions are made every kStreamingUpdateInterval frames
+static const int kStreamingUpdateInterval = 10;
+
+// Textures not rendered for this many frames drop to their lowest level
+static const int kStreamingIdleFrames = 120;
+
+// The most level changes requested per update
+static const int kMaxStreamingRequestsPerUpdate = 4;
+
+struct VROStreamingCandidate {
+    std::shared_ptr<VROTexture> texture;
+    float screenSize;
+    int maxLevel;
+    int level;
+    bool idle;
+    bool constrained;
+};
+
+VROTextureStreamer::VROTextureStreamer() :
+    _budget(kDefaultStreamingBudget),
+    _residentBytes(0),
+    _requestedBytes(0),
+    _lastUpdateFrame(-kStreamingUpdateInterval) {
+
+}
+
+VROTextureStreamer::~VROTextureStreamer() {
+
+}
+
+void VROTextureStreamer::addTexture(std::shared_ptr<VROTexture> texture) {
+    // Textures evicted by the VROResidencyManager are added again when reloaded
+    for (const std::weak_ptr<VROTexture> &existing : _textures) {
+        if (existing.lock() == texture) {
+            return;
+        }
+    }
+    _textures.push_back(texture);
+}
+
+void VROTextureStreamer::update(int frame, std::shared_ptr<VRODriver> driver) {
+    if (frame - _lastUpdateFrame < kStreamingUpdateInterval) {
+        return;
+    }
+    _lastUpdateFrame = frame;
+
+    /*
+     Find the level each texture's on-screen size calls for: the lowest
+     resolution that is not magnified.
+     */
+    std::vector<VROStreamingCandidate> candidates;
+    size_t resident = 0;
+    size_t requested = 0;
+
+    for (auto it = _textures.begin(); it != _textures.end();) {
+        std::shared_ptr<VROTexture> texture = it->lock();
+        if (!texture) {
+            it = _textures.erase(it);
+            continue;
+        }
+        ++it;
+
+        // Evicted textures stay evicted until rendered again
+        if (!texture->isHydrated()) {
+            continue;
+        }
+
+        VROStreamingCandidate candidate;
+        candidate.texture = texture;
+        candidate.maxLevel = texture->getStreamingLevelCount() - 1;
+        candidate.idle = frame - texture->getScreenSizeFrame() > kStreamingIdleFrames;
+        candidate.screenSize = candidate.idle ? 0 : texture->getScreenSize();
+        candidate.constrained = false;
+
+        int size = std::max(texture->getWidth(), texture->getHeight());
+        candidate.level = 0;
+        while (candidate.level < candidate.maxLevel && (size >> (candidate.level + 1)) >= candidate.screenSize) {
+            candidate.level++;
+        }
+
+        resident += texture->getStreamingBytes(texture->getStreamingLevel());
+        requested += texture->getStreamingBytes(candidate.level);
+        candidates.push_back(candidate);
+    }
+
+    _residentBytes = resident;
+    _requestedBytes = requested;
+    ALLOCATION_TRACKER_SET(StreamedTexturesResident, (int) resident);
+    ALLOCATION_TRACKER_SET(StreamedTexturesRequested, (int) requested);
+
+    /*
+     Fit the budget by lowering the textures that cover the least of the screen,
+     one level at a time.
+     */
+    std::stable_sort(candidates.begin(), candidates.end(),
+                     [](const VROStreamingCandidate &a, const VROStreamingCandidate &b) {
+                         return a.screenSize > b.screenSize;
+                     });
+
+    bool lowered = true;
+    while (requested > _budget && lowered) {
+        lowered = false;
+        for (auto it = candidates.rbegin(); it != candidates.rend() && requested > _budget; ++it) {
+            if (it->level < it->maxLevel) {
+                requested -= it->texture->getStreamingBytes(it->level);
+                it->level++;
+                requested += it->texture->getStreamingBytes(it->level);
+                it->constrained = true;
+                lowered = true;
+            }
+        }
+    }
+
+    /*
+     Request the changes, evictions first so that memory is freed before it's
+     needed. Textures are only lowered by a single level when forced by the
+     budget or idleness, so that textures near a level boundary don't thrash.
+     */
+    std::vector<VROStreamingCandidate *> evictions;
+    std::vector<VROStreamingCandidate *> upgrades;
+    for (VROStreamingCandidate &candidate : candidates) {
+        int current = candidate.texture->getStreamingLevel();
+        if (current < 0 || candidate.texture->isStreamingLevelPending() || candidate.level == current) {
+            continue;
+        }
+        if (candidate.level > current) {
+            if (candidate.level - current >= 2 || candidate.constrained || candidate.idle) {
+                evictions.push_back(&candidate);
+            }
+        }
+        else {
+            upgrades.push_back(&candidate);
+        }
+    }
+
+    int requests = 0;
+    for (std::vector<VROStreamingCandidate *> *changes : { &evictions, &upgrades }) {
+        for (VROStreamingCandidate *candidate : *changes) {
+            if (requests >= kMaxStreamingRequestsPerUpdate) {
+                return;
+            }
+            candidate->texture->requestStreamingLevel(candidate->level, driver);
+            requests++;
+        }
+    }
+}
@@ -0,0 +1,100 @@
+//
+//  VROTextureStreamer.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROTextureStreamer_h
+#define VROTextureStreamer_h
+
+#include <memory>
+#include <vector>
+#include <stdint.h>
+
+class VROTexture;
+class VRODriver;
+
+/*
+ Manages the resolution of streamed textures (see VROTexture::setStreamingSource).
+ Each update, the streamer compares the resolution of each streamed texture
+ with the largest on-screen size of the geometry using it, recorded while the
+ render pass sorts its geometry. Textures that are magnified are raised toward
+ full resolution; textures that are heavily minified, or that have not been
+ rendered recently, are lowered. If the requested resolutions exceed the
+ memory budget, the textures covering the least of the screen are lowered
+ first.
+
+ All methods must be invoked on the rendering thread.
+ */
+class VROTextureStreamer {
+public:
+
+    VROTextureStreamer();
+    virtual ~VROTextureStreamer();
+
+    /*
+     The GPU memory budget, in bytes, for streamed textures. Textures that are
+     not streamed do not count against the budget.
+     */
+    void setBudget(size_t bytes) {
+        _budget = bytes;
+    }
+    size_t getBudget() const {
+        return _budget;
+    }
+
+    /*
+     Begin managing the given texture. Invoked when a streamed texture is first
+     hydrated (or reloaded after eviction). The streamer does not retain its
+     textures.
+     */
+    void addTexture(std::shared_ptr<VROTexture> texture);
+
+    /*
+     Raise or lower the resolution of streamed textures. Invoked at the end of
+     each frame; the work is only performed every few frames.
+     */
+    void update(int frame, std::shared_ptr<VRODriver> driver);
+
+    /*
+     The bytes used by the resident levels of streamed textures, and the bytes
+     they would use at the resolution their on-screen size calls for, before
+     the budget is applied. Also reported to the VROAllocationTracker.
+     */
+    size_t getResidentBytes() const {
+        return _residentBytes;
+    }
+    size_t getRequestedBytes() const {
+        return _requestedBytes;
+    }
+
+private:
+
+    std::vector<std::weak_ptr<VROTexture>> _textures;
+    size_t _budget;
+    size_t _residentBytes;
+    size_t _requestedBytes;
+    int _lastUpdateFrame;
+
+};
+
+#endif /* VROTextureStreamer_h */
@@ -28,6 +28,8 @@
 #define VROTextureSubstrate_h
 
 #include <stdio.h>
+#include <stdint.h>
+#include "VROVector4f.h"
 
 enum class VROWrapMode;
 
@@ -35,6 +37,36 @@ class VROTextureSubstrate {
 public:
     virtual ~VROTextureSubstrate() {}
     virtual void updateWrapMode(VROWrapMode wrapModeS, VROWrapMode wrapModeT) = 0;
+
+    /*
+     Incremental upload, for 2D substrates created without source data: upload
+     the given rows of the base level, then invoke finishUpload() once all rows
+     are uploaded to generate runtime mipmaps. uploadRows returns false if the
+     substrate does not support incremental upload.
+     */
+    virtual bool uploadRows(int startRow, int numRows, const void *rows) { return false; }
+    virtual void finishUpload() {}
+
+    /*
+     Substrates packed into a texture array return the ID of that array and
+     the layer they occupy. Other substrates return 0 and -1.
+     */
+    virtual uint32_t getArrayId() const { return 0; }
+    virtual int getArrayLayer() const { return -1; }
+
+    /*
+     Substrates packed onto a texture atlas page return the ID of that page and
+     the region they occupy, as a texture coordinate offset (x, y) and scale
+     (z, w). Other substrates return 0 and the full texture.
+     */
+    virtual uint32_t getAtlasId() const { return 0; }
+    virtual VROVector4f getAtlasRect() const { return { 0, 0, 1, 1 }; }
+
+    /*
+     Estimated GPU memory allocated by this substrate, in bytes, or 0 if
+     unknown. Packed substrates report 0, since they share their storage.
+     */
+    virtual int64_t getMemoryBytes() const { return 0; }
 };
 
 #endif /* VROTextureSubstrate_h */
@@ -28,7 +28,11 @@
 #include "VROTexture.h"
 #include "VROData.h"
 #include "VRODriverOpenGL.h"
+#include "VROTextureArrayPool.h"
+#include "VROTextureAtlasPool.h"
 #include "VROLog.h"
+#include "VROProfiler.h"
+#include <algorithm>
 
 VROTextureSubstrateOpenGL::VROTextureSubstrateOpenGL(VROTextureType type,
                                                      VROTextureFormat format,
@@ -41,6 +45,13 @@ VROTextureSubstrateOpenGL::VROTextureSubstrateOpenGL(VROTextureType type,
                                                      VROFilterMode minFilter, VROFilterMode magFilter, VROFilterMode mipFilter,
                                                      std::shared_ptr<VRODriverOpenGL> driver) :
     _owned(true),
+    _width(0),
+    _pixelFormat(0),
+    _pixelType(0),
+    _runtimeMipmaps(false),
+    _arrayLayer(-1),
+    _atlasRect(0, 0, 1, 1),
+    _memoryBytes(0),
     _driver(driver) {
     
     bool linearRenderingEnabled = driver->isLinearRenderingEnabled();
@@ -50,16 +61,78 @@ VROTextureSubstrateOpenGL::VROTextureSubstrateOpenGL(VROTextureType type,
     ALLOCATION_TRACKER_ADD(TextureSubstrates, 1);
 }
 
+VROTextureSubstrateOpenGL::VROTextureSubstrateOpenGL(std::shared_ptr<VROTextureArray> array, int layer,
+                                                     std::shared_ptr<VRODriverOpenGL> driver) :
+    _target(GL_TEXTURE_2D_ARRAY),
+    _texture(0),
+    _owned(false),
+    _width(0),
+    _pixelFormat(0),
+    _pixelType(0),
+    _runtimeMipmaps(false),
+    _array(array),
+    _arrayLayer(layer),
+    _atlasRect(0, 0, 1, 1),
+    _memoryBytes(0),
+    _driver(driver) {
+    
+    ALLOCATION_TRACKER_ADD(TextureSubstrates, 1);
+}
+
+VROTextureSubstrateOpenGL::VROTextureSubstrateOpenGL(std::shared_ptr<VROTextureAtlas> atlas, VROVector4f rect,
+                                                     std::shared_ptr<VRODriverOpenGL> driver) :
+    _target(GL_TEXTURE_2D),
+    _texture(atlas->getTexture()),
+    _owned(false),
+    _width(0),
+    _pixelFormat(0),
+    _pixelType(0),
+    _runtimeMipmaps(false),
+    _arrayLayer(-1),
+    _atlas(atlas),
+    _atlasRect(rect),
+    _memoryBytes(0),
+    _driver(driver) {
+    
+    ALLOCATION_TRACKER_ADD(TextureSubstrates, 1);
+}
+
 VROTextureSubstrateOpenGL::~VROTextureSubstrateOpenGL() {
     ALLOCATION_TRACKER_SUB(TextureSubstrates, 1);
+    if (_memoryBytes > 0) {
+        VROAllocationTracker::subtractTextureMemory(_memoryFormat, _memoryBytes);
+    }
 
     std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
     if (_owned && driver) {
         driver->deleteTexture(_texture);
     }
+    if (_array) {
+        _array->freeLayer(_arrayLayer);
+    }
+}
+
+std::pair<GLenum, GLuint> VROTextureSubstrateOpenGL::getTexture() const {
+    if (_array) {
+        return std::pair<GLenum, GLuint>(GL_TEXTURE_2D_ARRAY, _array->getTexture());
+    }
+    return std::pair<GLenum, GLuint>(_target, _texture);
+}
+
+uint32_t VROTextureSubstrateOpenGL::getArrayId() const {
+    return _array ? _array->getArrayId() : 0;
+}
+
+uint32_t VROTextureSubstrateOpenGL::getAtlasId() const {
+    return _atlas ? _atlas->getAtlasId() : 0;
 }
 
 void VROTextureSubstrateOpenGL::updateWrapMode(VROWrapMode wrapModeS, VROWrapMode wrapModeT) {
+    // Layers and regions share the sampling state of their array or atlas, fixed
+    // when the texture was packed
+    if (_array || _atlas) {
+        return;
+    }
     GL( glActiveTexture(GL_TEXTURE0) );
     GL( glBindTexture(_target, _texture) );
     GL( glTexParameteri(_target, GL_TEXTURE_WRAP_S, convertWrapMode(wrapModeS)) );
@@ -67,6 +140,56 @@ void VROTextureSubstrateOpenGL::updateWrapMode(VROWrapMode wrapModeS, VROWrapMod
     GL( glBindTexture(_target, 0) );
 }
 
+bool VROTextureSubstrateOpenGL::uploadRows(int startRow, int numRows, const void *rows) {
+    if (_target != GL_TEXTURE_2D || _pixelFormat == 0) {
+        return false;
+    }
+    VRO_PROFILE_COUNT(TextureUploads, 1);
+    GL( glActiveTexture(GL_TEXTURE0) );
+    GL( glBindTexture(GL_TEXTURE_2D, _texture) );
+
+#if VRO_SUPPORTS_PIXEL_BUFFER_UPLOAD
+    /*
+     Stage the rows in a pixel unpack buffer so that glTexSubImage2D returns
+     without waiting on the driver to copy and transfer the pixels. The buffer's
+     storage is orphaned each upload, so the write never waits on the GPU to
+     finish reading the previous slice.
+     */
+    std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
+    if (driver) {
+        GLsizeiptr length = (GLsizeiptr) _width * numRows * (_pixelType == GL_UNSIGNED_BYTE ? 4 : 2);
+        GL( glBindBuffer(GL_PIXEL_UNPACK_BUFFER, driver->getPixelUnpackBuffer()) );
+        GL( glBufferData(GL_PIXEL_UNPACK_BUFFER, length, nullptr, GL_STREAM_DRAW) );
+
+        void *staging = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, length,
+                                         GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if (staging != nullptr) {
+            memcpy(staging, rows, length);
+            GL( glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) );
+            GL( glTexSubImage2D(GL_TEXTURE_2D, 0, 0, startRow, _width, numRows, _pixelFormat, _pixelType, nullptr) );
+            GL( glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0) );
+            GL( glBindTexture(GL_TEXTURE_2D, 0) );
+            return true;
+        }
+        GL( glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0) );
+    }
+#endif
+
+    GL( glTexSubImage2D(GL_TEXTURE_2D, 0, 0, startRow, _width, numRows, _pixelFormat, _pixelType, rows) );
+    GL( glBindTexture(GL_TEXTURE_2D, 0) );
+    return true;
+}
+
+void VROTextureSubstrateOpenGL::finishUpload() {
+    if (!_runtimeMipmaps) {
+        return;
+    }
+    GL( glActiveTexture(GL_TEXTURE0) );
+    GL( glBindTexture(GL_TEXTURE_2D, _texture) );
+    GL( glGenerateMipmap(GL_TEXTURE_2D) );
+    GL( glBindTexture(GL_TEXTURE_2D, 0) );
+}
+
 void VROTextureSubstrateOpenGL::loadTexture(VROTextureType type,
                                             VROTextureFormat format,
                                             VROTextureInternalFormat internalFormat, bool sRGB,
@@ -93,8 +216,8 @@ void VROTextureSubstrateOpenGL::loadTexture(VROTextureType type,
                  mipmapMode, data.front(), width, height, mipSizes);
     }
     else if (type == VROTextureType::TextureCube) {
-        passert_msg (mipmapMode == VROMipmapMode::None,
-                     "Cube textures should not be mipmapped!");
+        passert_msg (mipmapMode != VROMipmapMode::Runtime,
+                     "Cube textures can only use pregenerated mipmaps!");
         passert_msg (data.size() == 6,
                      "Cube textures can only be created from exactly six images");
         
@@ -111,10 +234,71 @@ void VROTextureSubstrateOpenGL::loadTexture(VROTextureType type,
             loadFace(GL_TEXTURE_CUBE_MAP_POSITIVE_X + slice, format, internalFormat, sRGB,
                      mipmapMode, data[slice], width, height, mipSizes);
         }
+        
+        // Pregenerated chains may stop short of 1x1; limit sampling to the levels provided
+        if (mipmapMode == VROMipmapMode::Pregenerated && !mipSizes.empty()) {
+            GL( glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, (GLint) mipSizes.size() - 1) );
+        }
     }
     else {
         pabort("Invalid texture data received, could not convert to OpenGL");
     }
+    
+    VRO_PROFILE_COUNT(TextureUploads, 1);
+    int numFaces = (type == VROTextureType::TextureCube) ? 6 : 1;
+    _memoryBytes = numFaces * estimateFaceMemory(format, internalFormat, mipmapMode, data.front(),
+                                                 width, height, mipSizes);
+    _memoryFormat = format;
+    if (_memoryBytes > 0) {
+        VROAllocationTracker::addTextureMemory(_memoryFormat, _memoryBytes);
+    }
+}
+
+int64_t VROTextureSubstrateOpenGL::estimateFaceMemory(VROTextureFormat format,
+                                                      VROTextureInternalFormat internalFormat,
+                                                      VROMipmapMode mipmapMode,
+                                                      std::shared_ptr<VROData> &faceData,
+                                                      int width, int height,
+                                                      const std::vector<uint32_t> &mipSizes) {
+    // Compressed data is stored on the GPU as-is
+    if (format == VROTextureFormat::ETC2_RGBA8_EAC || format == VROTextureFormat::ASTC_4x4_LDR) {
+        if (mipSizes.empty()) {
+            return faceData->getDataLength();
+        }
+        if (mipmapMode != VROMipmapMode::Pregenerated) {
+            return mipSizes.front();
+        }
+        int64_t bytes = 0;
+        for (uint32_t mipSize : mipSizes) {
+            bytes += mipSize;
+        }
+        return bytes;
+    }
+    
+    int bytesPerPixel;
+    switch (internalFormat) {
+        case VROTextureInternalFormat::RGBA4:
+        case VROTextureInternalFormat::RGB565:
+        case VROTextureInternalFormat::RG8:
+            bytesPerPixel = 2;
+            break;
+        case VROTextureInternalFormat::RGB16F:
+            bytesPerPixel = 6;
+            break;
+        case VROTextureInternalFormat::RGBA16F:
+            bytesPerPixel = 8;
+            break;
+        default:
+            bytesPerPixel = 4;
+            break;
+    }
+    
+    // A full mip chain adds a third to the base level
+    int64_t bytes = (int64_t) width * height * bytesPerPixel;
+    if (mipmapMode != VROMipmapMode::None) {
+        bytes += bytes / 3;
+    }
+    return bytes;
 }
 
 void VROTextureSubstrateOpenGL::loadFace(GLenum target,
@@ -136,7 +320,7 @@ void VROTextureSubstrateOpenGL::loadFace(GLenum target,
             for (int level = 0; level < mipSizes.size(); level++) {
                 uint32_t mipSize = mipSizes[level];
                 GL( glCompressedTexImage2D(target, level, internalFormat,
-                                           width >> level, height >> level, 0,
+                                           std::max(width >> level, 1), std::max(height >> level, 1), 0,
                                            mipSize, ((const char *)faceData->getData()) + offset) );
                 offset += mipSize;
             }
@@ -156,10 +340,24 @@ void VROTextureSubstrateOpenGL::loadFace(GLenum target,
         }
     }
     else if (format == VROTextureFormat::ASTC_4x4_LDR) {
-        passert (mipmapMode == VROMipmapMode::None);
+        passert (mipmapMode != VROMipmapMode::Runtime);
         GLenum internalFormat = sRGB ? GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR : GL_COMPRESSED_RGBA_ASTC_4x4_KHR;
-        GL( glCompressedTexImage2D(target, 0, internalFormat, width, height, 0,
-                                   faceData->getDataLength(), faceData->getData()) );
+        
+        if (mipmapMode == VROMipmapMode::Pregenerated) {
+            uint32_t offset = 0;
+            for (int level = 0; level < mipSizes.size(); level++) {
+                uint32_t mipSize = mipSizes[level];
+                GL( glCompressedTexImage2D(target, level, internalFormat,
+                                           std::max(width >> level, 1), std::max(height >> level, 1), 0,
+                                           mipSize, ((const char *)faceData->getData()) + offset) );
+                offset += mipSize;
+            }
+        }
+        else {
+            GL( glCompressedTexImage2D(target, 0, internalFormat, width, height, 0,
+                                       mipSizes.empty() ? faceData->getDataLength() : mipSizes.front(),
+                                       faceData->getData()) );
+        }
     }
     else if (format == VROTextureFormat::RGBA8 || format == VROTextureFormat::RGB8) {
         // We write format RGB8 into internal format RGBA8, because sRGB8 does not work
@@ -168,11 +366,22 @@ void VROTextureSubstrateOpenGL::loadFace(GLenum target,
         passert_msg (internalFormat != VROTextureInternalFormat::RGB565,
                      "RGB565 internal format requires RGB565 or RGB8 source data!");
         
-        GL( glTexImage2D(target, 0, getInternalFormat(internalFormat, sRGB), width, height, 0,
-                         GL_RGBA, GL_UNSIGNED_BYTE, faceData->getData()) );
-        if (mipmapMode == VROMipmapMode::Runtime) {
-            GL( glGenerateMipmap(GL_TEXTURE_2D) );
+        // Without data only the storage is allocated; mipmaps are generated in finishUpload()
+        if (faceData->getData() == nullptr) {
+            allocateStorage(target, getInternalFormat(internalFormat, sRGB), mipmapMode, width, height,
+                            GL_RGBA, GL_UNSIGNED_BYTE);
+        }
+        else {
+            GL( glTexImage2D(target, 0, getInternalFormat(internalFormat, sRGB), width, height, 0,
+                             GL_RGBA, GL_UNSIGNED_BYTE, faceData->getData()) );
+            if (mipmapMode == VROMipmapMode::Runtime) {
+                GL( glGenerateMipmap(GL_TEXTURE_2D) );
+            }
         }
+        _width = width;
+        _pixelFormat = GL_RGBA;
+        _pixelType = GL_UNSIGNED_BYTE;
+        _runtimeMipmaps = mipmapMode == VROMipmapMode::Runtime;
     }
     else if (format == VROTextureFormat::RGB9_E5) {
         // RGB9_E5 is not color renderable so automatic mipmap generation is not
@@ -191,21 +400,70 @@ void VROTextureSubstrateOpenGL::loadFace(GLenum target,
         GL( glTexImage2D(target, 0, GL_RGB16F, width, height, 0,
                          GL_RGB, GL_FLOAT, faceData->getData()) );
     }
+    else if (format == VROTextureFormat::RGBA16F || format == VROTextureFormat::RG16F) {
+        bool rgba = (format == VROTextureFormat::RGBA16F);
+        passert_msg (internalFormat == (rgba ? VROTextureInternalFormat::RGBA16F : VROTextureInternalFormat::RG16F),
+                     "RGBA16F and RG16F internal formats require matching float source data!");
+        passert (mipmapMode != VROMipmapMode::Runtime);
+        
+        // Pregenerated mipmaps are stored consecutively in the data, largest first
+        int numLevels = (mipmapMode == VROMipmapMode::Pregenerated) ? (int) mipSizes.size() : 1;
+        uint32_t offset = 0;
+        for (int level = 0; level < numLevels; level++) {
+            GL( glTexImage2D(target, level, rgba ? GL_RGBA16F : GL_RG16F,
+                             std::max(1, width >> level), std::max(1, height >> level), 0,
+                             rgba ? GL_RGBA : GL_RG, GL_FLOAT, ((const char *) faceData->getData()) + offset) );
+            if (level < (int) mipSizes.size()) {
+                offset += mipSizes[level];
+            }
+        }
+    }
     else if (format == VROTextureFormat::RGB565) {
         passert_msg (internalFormat == VROTextureInternalFormat::RGB565,
                      "RGB565 source format is only compatible with RGB565 internal format!");
 
-        GL( glTexImage2D(target, 0, getInternalFormat(internalFormat, sRGB), width, height, 0,
-                         GL_RGB, GL_UNSIGNED_SHORT_5_6_5, faceData->getData()) );
-        if (mipmapMode == VROMipmapMode::Runtime) {
-            GL( glGenerateMipmap(GL_TEXTURE_2D) );
+        if (faceData->getData() == nullptr) {
+            allocateStorage(target, getInternalFormat(internalFormat, sRGB), mipmapMode, width, height,
+                            GL_RGB, GL_UNSIGNED_SHORT_5_6_5);
         }
+        else {
+            GL( glTexImage2D(target, 0, getInternalFormat(internalFormat, sRGB), width, height, 0,
+                             GL_RGB, GL_UNSIGNED_SHORT_5_6_5, faceData->getData()) );
+            if (mipmapMode == VROMipmapMode::Runtime) {
+                GL( glGenerateMipmap(GL_TEXTURE_2D) );
+            }
+        }
+        _width = width;
+        _pixelFormat = GL_RGB;
+        _pixelType = GL_UNSIGNED_SHORT_5_6_5;
+        _runtimeMipmaps = mipmapMode == VROMipmapMode::Runtime;
     }
     else {
         pabort();
     }
 }
 
+void VROTextureSubstrateOpenGL::allocateStorage(GLenum target, GLuint internalFormat, VROMipmapMode mipmapMode,
+                                                int width, int height, GLenum pixelFormat, GLenum pixelType) {
+#if VRO_SUPPORTS_TEXTURE_STORAGE
+    /*
+     Immutable storage allocates the full mip chain up front, so generating
+     mipmaps once the rows are uploaded doesn't reallocate the texture.
+     */
+    if (target == GL_TEXTURE_2D) {
+        int levels = 1;
+        if (mipmapMode == VROMipmapMode::Runtime) {
+            while ((std::max(width, height) >> levels) > 0) {
+                levels++;
+            }
+        }
+        GL( glTexStorage2D(target, levels, internalFormat == GL_RGBA ? GL_RGBA8 : internalFormat, width, height) );
+        return;
+    }
+#endif
+    GL( glTexImage2D(target, 0, internalFormat, width, height, 0, pixelFormat, pixelType, nullptr) );
+}
+
 GLuint VROTextureSubstrateOpenGL::getInternalFormat(VROTextureInternalFormat format, bool sRGB) {
     switch (format) {
         case VROTextureInternalFormat::RGBA8:
@@ -35,6 +35,8 @@
 
 class VROData;
 class VRODriver;
+class VROTextureArray;
+class VROTextureAtlas;
 class VRODriverOpenGL;
 enum class VROTextureType;
 enum class VROTextureFormat;
@@ -58,6 +60,13 @@ public:
         _target(target),
         _texture(name),
         _owned(owned),
+        _width(0),
+        _pixelFormat(0),
+        _pixelType(0),
+        _runtimeMipmaps(false),
+        _arrayLayer(-1),
+        _atlasRect(0, 0, 1, 1),
+        _memoryBytes(0),
         _driver(driver) {
         
         ALLOCATION_TRACKER_ADD(TextureSubstrates, 1);
@@ -79,11 +88,22 @@ public:
                               VROWrapMode wrapS, VROWrapMode wrapT,
                               VROFilterMode minFilter, VROFilterMode magFilter, VROFilterMode mipFilter,
                               std::shared_ptr<VRODriverOpenGL> driver);
+    
+    /*
+     Create a substrate for the given layer of a texture array. The layer is
+     freed when this substrate is deleted.
+     */
+    VROTextureSubstrateOpenGL(std::shared_ptr<VROTextureArray> array, int layer,
+                              std::shared_ptr<VRODriverOpenGL> driver);
+    
+    /*
+     Create a substrate for the given region of a texture atlas page.
+     */
+    VROTextureSubstrateOpenGL(std::shared_ptr<VROTextureAtlas> atlas, VROVector4f rect,
+                              std::shared_ptr<VRODriverOpenGL> driver);
     virtual ~VROTextureSubstrateOpenGL();
     
-    std::pair<GLenum, GLuint> getTexture() const {
-        return std::pair<GLenum, GLuint>(_target, _texture);
-    }
+    std::pair<GLenum, GLuint> getTexture() const;
     void setTexture(GLuint texture) {
         _texture = texture;
     }
@@ -93,12 +113,72 @@ public:
      */
     void updateWrapMode(VROWrapMode wrapModeS, VROWrapMode wrapModeT);
 
+    bool uploadRows(int startRow, int numRows, const void *rows);
+    void finishUpload();
+    
+    int64_t getMemoryBytes() const {
+        return _memoryBytes;
+    }
+
+    uint32_t getArrayId() const;
+    int getArrayLayer() const {
+        return _arrayLayer;
+    }
+    uint32_t getAtlasId() const;
+    VROVector4f getAtlasRect() const {
+        return _atlasRect;
+    }
+    
+    /*
+     Move this substrate to another region of its atlas page. Used by sprite
+     sheets, whose frames are all on the same page.
+     */
+    void setAtlasRect(VROVector4f rect) {
+        _atlasRect = rect;
+    }
+
+    static GLuint getInternalFormat(VROTextureInternalFormat format, bool sRGB);
+    static GLenum convertWrapMode(VROWrapMode wrapMode);
+    static GLenum convertMagFilter(VROFilterMode magFilter);
+    static GLenum convertMinFilter(VROMipmapMode mipmapMode, VROFilterMode minFilter, VROFilterMode mipFilter);
+
 private:
     
     GLenum _target;
     GLuint _texture;
     bool _owned;
 
+    /*
+     Width and pixel transfer format of the base level, for incremental
+     uploads. The format is zero if incremental upload is not supported
+     for this substrate's format.
+     */
+    int _width;
+    GLenum _pixelFormat, _pixelType;
+    bool _runtimeMipmaps;
+
+    /*
+     The texture array and layer holding this substrate's texture, if it was
+     packed into an array. The array's GL name is read on each bind, since it
+     changes when the array grows.
+     */
+    std::shared_ptr<VROTextureArray> _array;
+    int _arrayLayer;
+
+    /*
+     The atlas page and region holding this substrate's texture, if it was
+     packed onto an atlas.
+     */
+    std::shared_ptr<VROTextureAtlas> _atlas;
+    VROVector4f _atlasRect;
+
+    /*
+     Estimated GPU memory of the texture this substrate allocated, and the
+     source format it is attributed to in VROAllocationTracker.
+     */
+    int64_t _memoryBytes;
+    VROTextureFormat _memoryFormat;
+
     /*
      Weak reference to the driver that created this program. The driver's lifecycle
      is tied to the parent EGL context, so we only delete GL objects if the driver
@@ -106,6 +186,13 @@ private:
     */
     std::weak_ptr<VRODriverOpenGL> _driver;
     
+    /*
+     Allocate uninitialized storage for the base level of a face that will be
+     uploaded incrementally.
+     */
+    void allocateStorage(GLenum target, GLuint internalFormat, VROMipmapMode mipmapMode,
+                         int width, int height, GLenum pixelFormat, GLenum pixelType);
+
     void loadTexture(VROTextureType type,
                      VROTextureFormat format,
                      VROTextureInternalFormat internalFormat, bool sRGB,
@@ -115,6 +202,12 @@ private:
                      const std::vector<uint32_t> &mipSizes,
                      VROWrapMode wrapS, VROWrapMode wrapT,
                      VROFilterMode minFilter, VROFilterMode magFilter, VROFilterMode mipFilter);
+    static int64_t estimateFaceMemory(VROTextureFormat format,
+                                      VROTextureInternalFormat internalFormat,
+                                      VROMipmapMode mipmapMode,
+                                      std::shared_ptr<VROData> &faceData,
+                                      int width, int height,
+                                      const std::vector<uint32_t> &mipSizes);
     void loadFace(GLenum target,
                   VROTextureFormat format,
                   VROTextureInternalFormat internalFormat, bool sRGB,
@@ -123,11 +216,6 @@ private:
                   int width, int height,
                   const std::vector<uint32_t> &mipSizes);
     
-    GLuint getInternalFormat(VROTextureInternalFormat format, bool sRGB);
-    GLenum convertWrapMode(VROWrapMode wrapMode);
-    GLenum convertMagFilter(VROFilterMode magFilter);
-    GLenum convertMinFilter(VROMipmapMode mipmapMode, VROFilterMode minFilter, VROFilterMode mipFilter);
-    
 };
 
 #endif /* VROTextureSubstrateOpenGL_h */
@@ -29,6 +29,7 @@
 #include "VROByteBuffer.h"
 #include "VROData.h"
 #include "VROLog.h"
+#include <algorithm>
 
 static const int kASTCHeaderLength = 16;
 static const int kASTCBlockXOffset = 4;
@@ -156,6 +157,294 @@ std::shared_ptr<VROData> VROTextureUtil::readKTXHeader(const uint8_t *data, uint
     return std::make_shared<VROData>(buffer.getData(), buffer.getPosition(), VRODataOwnership::Move);
 }
 
+static const uint8_t kKTXIdentifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+static const uint32_t kKTXEndianness = 0x04030201;
+static const uint32_t kKTXBaseInternalFormatRGBA = 0x1908;
+
+std::shared_ptr<VROData> VROTextureUtil::writeKTX(std::shared_ptr<VROData> data, int width, int height,
+                                                  const std::vector<uint32_t> &mipSizes) {
+    VROKTXData ktxHeader;
+    memset(&ktxHeader, 0, sizeof(VROKTXData));
+    memcpy(ktxHeader.m_au8Identifier, kKTXIdentifier, sizeof(kKTXIdentifier));
+    ktxHeader.m_u32Endianness = kKTXEndianness;
+    ktxHeader.m_u32GlTypeSize = 1;
+    ktxHeader.m_u32GlInternalFormat = GL_COMPRESSED_RGBA8_ETC2_EAC;
+    ktxHeader.m_u32GlBaseInternalFormat = kKTXBaseInternalFormatRGBA;
+    ktxHeader.m_u32PixelWidth = width;
+    ktxHeader.m_u32PixelHeight = height;
+    ktxHeader.m_u32NumberOfFaces = 1;
+    ktxHeader.m_u32NumberOfMipmapLevels = (uint32_t) mipSizes.size();
+    
+    size_t length = sizeof(VROKTXData);
+    for (uint32_t mipSize : mipSizes) {
+        length += sizeof(uint32_t) + ((mipSize + 3) & ~(uint32_t)3);
+    }
+    
+    VROByteBuffer buffer(length);
+    buffer.writeBytes(&ktxHeader, sizeof(VROKTXData));
+    
+    uint32_t offset = 0;
+    for (uint32_t mipSize : mipSizes) {
+        buffer.writeInt(mipSize);
+        buffer.writeBytes(((const char *) data->getData()) + offset, mipSize);
+        
+        // Each level is padded to a multiple of four bytes
+        uint32_t padding = ((mipSize + 3) & ~(uint32_t)3) - mipSize;
+        for (uint32_t i = 0; i < padding; i++) {
+            buffer.writeByte(0);
+        }
+        offset += mipSize;
+    }
+    
+    buffer.releaseBytes();
+    return std::make_shared<VROData>(buffer.getData(), buffer.getPosition(), VRODataOwnership::Move);
+}
+
+typedef struct {
+    uint8_t identifier[12];
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+} VROKTX2Data;
+
+typedef struct {
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+} VROKTX2Level;
+
+static const uint8_t kKTX2Identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+// The Vulkan formats of KTX2 that we can upload; undefined marks Basis Universal data
+static const uint32_t kVkFormatUndefined = 0;
+static const uint32_t kVkFormatETC2RGBA8Unorm = 151;
+static const uint32_t kVkFormatETC2RGBA8SRGB = 152;
+static const uint32_t kVkFormatASTC4x4Unorm = 157;
+static const uint32_t kVkFormatASTC4x4SRGB = 158;
+
+bool VROTextureUtil::isKTX2(const uint8_t *data, uint32_t length) {
+    return length >= sizeof(kKTX2Identifier) && memcmp(data, kKTX2Identifier, sizeof(kKTX2Identifier)) == 0;
+}
+
+std::shared_ptr<VROData> VROTextureUtil::readKTX2Header(const uint8_t *data, uint32_t length, VROTextureFormat *outFormat,
+                                                        int *outWidth, int *outHeight, std::vector<uint32_t> *outMipSizes) {
+    if (!isKTX2(data, length) || length < sizeof(VROKTX2Data)) {
+        perr("Invalid KTX2 texture data");
+        return nullptr;
+    }
+    
+    VROKTX2Data ktxHeader;
+    memcpy(&ktxHeader, data, sizeof(VROKTX2Data));
+    
+    if (ktxHeader.vkFormat == kVkFormatUndefined) {
+        perr("KTX2 texture holds Basis Universal data, which requires transcoding and is not supported");
+        return nullptr;
+    }
+    if (ktxHeader.supercompressionScheme != 0) {
+        perr("KTX2 texture uses unsupported supercompression scheme %d", ktxHeader.supercompressionScheme);
+        return nullptr;
+    }
+    if (ktxHeader.pixelDepth > 1 || ktxHeader.layerCount > 1 || ktxHeader.faceCount != 1) {
+        perr("Only 2D KTX2 textures are supported");
+        return nullptr;
+    }
+    
+    if (ktxHeader.vkFormat == kVkFormatETC2RGBA8Unorm || ktxHeader.vkFormat == kVkFormatETC2RGBA8SRGB) {
+        *outFormat = VROTextureFormat::ETC2_RGBA8_EAC;
+    }
+    else if (ktxHeader.vkFormat == kVkFormatASTC4x4Unorm || ktxHeader.vkFormat == kVkFormatASTC4x4SRGB) {
+        *outFormat = VROTextureFormat::ASTC_4x4_LDR;
+    }
+    else {
+        perr("KTX2 texture has unsupported format %d", ktxHeader.vkFormat);
+        return nullptr;
+    }
+    
+    *outWidth  = ktxHeader.pixelWidth;
+    *outHeight = ktxHeader.pixelHeight;
+    
+    // A level count of 0 requests runtime mipmap generation; there is one level of data
+    uint32_t numMipLevels = std::max(ktxHeader.levelCount, (uint32_t) 1);
+    if (length < sizeof(VROKTX2Data) + numMipLevels * sizeof(VROKTX2Level)) {
+        perr("Invalid KTX2 level index");
+        return nullptr;
+    }
+    
+    // The level index is ordered largest level first, though the level data itself is
+    // stored smallest first
+    VROByteBuffer buffer;
+    for (uint32_t i = 0; i < numMipLevels; i++) {
+        VROKTX2Level level;
+        memcpy(&level, data + sizeof(VROKTX2Data) + i * sizeof(VROKTX2Level), sizeof(VROKTX2Level));
+        if (level.byteOffset + level.byteLength > length) {
+            perr("Invalid KTX2 level %d", i);
+            return nullptr;
+        }
+        
+        uint32_t mipSize = (uint32_t) level.byteLength;
+        outMipSizes->push_back(mipSize);
+        
+        buffer.grow(mipSize);
+        buffer.writeBytes(((const char *)data) + level.byteOffset, mipSize);
+    }
+    
+    buffer.releaseBytes();
+    return std::make_shared<VROData>(buffer.getData(), buffer.getPosition(), VRODataOwnership::Move);
+}
+
+// The OpenGL internal formats of KTX cube maps that we can upload
+static const uint32_t kGLInternalFormatETC2RGBA8 = 0x9278;
+static const uint32_t kGLInternalFormatETC2SRGB8Alpha8 = 0x9279;
+static const uint32_t kGLInternalFormatASTC4x4 = 0x93B0;
+static const uint32_t kGLInternalFormatASTC4x4SRGB = 0x93D0;
+static const int kNumCubeFaces = 6;
+
+std::vector<std::shared_ptr<VROData>> VROTextureUtil::readCubeKTXHeader(const uint8_t *data, uint32_t length,
+                                                                        VROTextureFormat *outFormat,
+                                                                        int *outWidth, int *outHeight,
+                                                                        std::vector<uint32_t> *outMipSizes) {
+    VROByteBuffer faces[kNumCubeFaces];
+    
+    if (isKTX2(data, length)) {
+        if (length < sizeof(VROKTX2Data)) {
+            perr("Invalid KTX2 texture data");
+            return {};
+        }
+        VROKTX2Data ktxHeader;
+        memcpy(&ktxHeader, data, sizeof(VROKTX2Data));
+        
+        if (ktxHeader.supercompressionScheme != 0 || ktxHeader.faceCount != kNumCubeFaces ||
+            ktxHeader.pixelDepth > 1 || ktxHeader.layerCount > 1) {
+            perr("KTX2 texture is not a cube map without supercompression");
+            return {};
+        }
+        if (ktxHeader.vkFormat == kVkFormatETC2RGBA8Unorm || ktxHeader.vkFormat == kVkFormatETC2RGBA8SRGB) {
+            *outFormat = VROTextureFormat::ETC2_RGBA8_EAC;
+        }
+        else if (ktxHeader.vkFormat == kVkFormatASTC4x4Unorm || ktxHeader.vkFormat == kVkFormatASTC4x4SRGB) {
+            *outFormat = VROTextureFormat::ASTC_4x4_LDR;
+        }
+        else {
+            perr("KTX2 cube map has unsupported format %d", ktxHeader.vkFormat);
+            return {};
+        }
+        *outWidth  = ktxHeader.pixelWidth;
+        *outHeight = ktxHeader.pixelHeight;
+        
+        uint32_t numMipLevels = std::max(ktxHeader.levelCount, (uint32_t) 1);
+        if (length < sizeof(VROKTX2Data) + numMipLevels * sizeof(VROKTX2Level)) {
+            perr("Invalid KTX2 level index");
+            return {};
+        }
+        
+        // Each level holds its faces contiguously, in face order; block compressed
+        // faces need no padding between them
+        for (uint32_t i = 0; i < numMipLevels; i++) {
+            VROKTX2Level level;
+            memcpy(&level, data + sizeof(VROKTX2Data) + i * sizeof(VROKTX2Level), sizeof(VROKTX2Level));
+            if (level.byteOffset + level.byteLength > length || level.byteLength % kNumCubeFaces != 0) {
+                perr("Invalid KTX2 level %d", i);
+                return {};
+            }
+            
+            uint32_t faceSize = (uint32_t) (level.byteLength / kNumCubeFaces);
+            outMipSizes->push_back(faceSize);
+            for (int f = 0; f < kNumCubeFaces; f++) {
+                faces[f].grow(faceSize);
+                faces[f].writeBytes(((const char *)data) + level.byteOffset + f * faceSize, faceSize);
+            }
+        }
+    }
+    else {
+        if (length < sizeof(VROKTXData)) {
+            perr("Invalid KTX texture data");
+            return {};
+        }
+        VROKTXData ktxHeader;
+        memcpy(&ktxHeader, data, sizeof(VROKTXData));
+        
+        if (ktxHeader.m_u32NumberOfFaces != kNumCubeFaces || ktxHeader.m_u32NumberOfArrayElements > 1) {
+            perr("KTX texture is not a cube map");
+            return {};
+        }
+        uint32_t internalFormat = ktxHeader.m_u32GlInternalFormat;
+        if (internalFormat == kGLInternalFormatETC2RGBA8 || internalFormat == kGLInternalFormatETC2SRGB8Alpha8) {
+            *outFormat = VROTextureFormat::ETC2_RGBA8_EAC;
+        }
+        else if (internalFormat == kGLInternalFormatASTC4x4 || internalFormat == kGLInternalFormatASTC4x4SRGB) {
+            *outFormat = VROTextureFormat::ASTC_4x4_LDR;
+        }
+        else {
+            perr("KTX cube map has unsupported internal format %x", internalFormat);
+            return {};
+        }
+        *outWidth  = ktxHeader.m_u32PixelWidth;
+        *outHeight = ktxHeader.m_u32PixelHeight;
+        
+        // Each level is preceded by the size of one face, and each face is padded to
+        // a multiple of four bytes
+        uint32_t numMipLevels = std::max(ktxHeader.m_u32NumberOfMipmapLevels, (uint32_t) 1);
+        uint32_t offset = sizeof(VROKTXData) + ktxHeader.m_u32BytesOfKeyValueData;
+        for (uint32_t i = 0; i < numMipLevels; i++) {
+            if (offset + sizeof(uint32_t) > length) {
+                perr("Invalid KTX level %d", i);
+                return {};
+            }
+            uint32_t faceSize;
+            memcpy(&faceSize, ((const char *)data) + offset, sizeof(uint32_t));
+            offset += sizeof(uint32_t);
+            
+            uint32_t faceSizeRounded = (faceSize + 3) & ~(uint32_t)3;
+            if (offset + faceSizeRounded * kNumCubeFaces > length) {
+                perr("Invalid KTX level %d", i);
+                return {};
+            }
+            outMipSizes->push_back(faceSize);
+            for (int f = 0; f < kNumCubeFaces; f++) {
+                faces[f].grow(faceSize);
+                faces[f].writeBytes(((const char *)data) + offset, faceSize);
+                offset += faceSizeRounded;
+            }
+        }
+    }
+    
+    std::vector<std::shared_ptr<VROData>> faceData;
+    for (int f = 0; f < kNumCubeFaces; f++) {
+        faces[f].releaseBytes();
+        faceData.push_back(std::make_shared<VROData>(faces[f].getData(), faces[f].getPosition(), VRODataOwnership::Move));
+    }
+    return faceData;
+}
+
+std::shared_ptr<VROTexture> VROTextureUtil::createCompressedCubeTexture(const uint8_t *data, uint32_t length, bool sRGB) {
+    VROTextureFormat format;
+    int width;
+    int height;
+    std::vector<uint32_t> mipSizes;
+    std::vector<std::shared_ptr<VROData>> faces = readCubeKTXHeader(data, length, &format, &width, &height, &mipSizes);
+    if (faces.empty()) {
+        return nullptr;
+    }
+    
+    // Cube textures always upload pregenerated mipmaps, even if there is only one level
+    return std::make_shared<VROTexture>(VROTextureType::TextureCube, format,
+                                        VROTextureInternalFormat::RGBA8, sRGB,
+                                        VROMipmapMode::Pregenerated,
+                                        faces, width, height, mipSizes);
+}
+
 typedef struct {
     uint32_t width;
     uint32_t height;
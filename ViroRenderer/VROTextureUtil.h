@@ -58,6 +58,52 @@ public:
     static std::shared_ptr<VROData> readKTXHeader(const uint8_t *data, uint32_t length, VROTextureFormat *outFormat,
                                                   int *outWidth, int *outHeight, std::vector<uint32_t> *outMipSizes);
     
+    /*
+     Write ETC2 RGBA8 texture data, with successive mipmap levels concatenated contiguously
+     together, to a KTX file readable by readKTXHeader.
+     */
+    static std::shared_ptr<VROData> writeKTX(std::shared_ptr<VROData> data, int width, int height,
+                                             const std::vector<uint32_t> &mipSizes);
+    
+    /*
+     Read a KTX2 texture file. Read the width and height from the header, and return the
+     texture data with successive mipmap levels concatenated contiguously together, largest
+     first. Only 2D textures holding ETC2 RGBA8 or ASTC 4x4 data without supercompression
+     are supported: returns nullptr for all others, including Basis Universal textures,
+     which require transcoding.
+
+     The size of each mipmap level is returned in the outMipmaps vector.
+     */
+    static std::shared_ptr<VROData> readKTX2Header(const uint8_t *data, uint32_t length, VROTextureFormat *outFormat,
+                                                   int *outWidth, int *outHeight, std::vector<uint32_t> *outMipSizes);
+    
+    /*
+     Read a cube map KTX or KTX2 texture file holding ETC2 RGBA8 or ASTC 4x4 data. Returns
+     the data of each of the six faces, in the order +X, -X, +Y, -Y, +Z, -Z, with the
+     successive mipmap levels of each face concatenated contiguously together, largest
+     first; or an empty vector if the file is not a supported cube map.
+     
+     The size of each mipmap level of a single face is returned in the outMipmaps vector.
+     The faces can be passed directly to the VROTexture constructor for TextureCube.
+     */
+    static std::vector<std::shared_ptr<VROData>> readCubeKTXHeader(const uint8_t *data, uint32_t length,
+                                                                   VROTextureFormat *outFormat,
+                                                                   int *outWidth, int *outHeight,
+                                                                   std::vector<uint32_t> *outMipSizes);
+    
+    /*
+     Create a compressed cube texture from the given cube map KTX or KTX2 file data (see
+     readCubeKTXHeader). Compressed cube maps take a quarter (or less) of the memory and
+     bandwidth of RGBA8 cube maps, which suits large background skyboxes. Returns nullptr
+     if the data is not a supported cube map.
+     */
+    static std::shared_ptr<VROTexture> createCompressedCubeTexture(const uint8_t *data, uint32_t length, bool sRGB);
+
+    /*
+     Returns true if the given data begins with the KTX2 file identifier.
+     */
+    static bool isKTX2(const uint8_t *data, uint32_t length);
+
     /*
      Read a texture file with a VHD header. Read the width and height from the header then
      strip it out and return the raw texture data, with successive mipmap levels concatenated
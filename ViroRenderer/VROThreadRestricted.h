@@ -75,6 +75,9 @@ public:
     void setThreadRestrictionEnabled(bool enabled) {
         _enabled = enabled;
     }
+    bool isThreadRestrictionEnabled() const {
+        return _enabled;
+    }
     
 private:
 
@@ -0,0 +1,474 @@
+//
+//  VROTiledVideoSphere.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROTiledVideoSphere.h"
+#include "VROVideoTexture.h"
+#include "VROFrameSynchronizer.h"
+#include "VROGeometrySource.h"
+#include "VROGeometryElement.h"
+#include "VROMaterial.h"
+#include "VRORenderContext.h"
+#include "VROCamera.h"
+#include "VROData.h"
+#include "VROTime.h"
+#include "VROMath.h"
+#include "VROLog.h"
+#include <algorithm>
+
+static const float kTiledSphereRadius = 1;
+
+// Segments across the whole sphere; each tile gets its share of these
+static const int kTiledSphereNumSegments = 60;
+
+static const float kDefaultViewMargin = M_PI / 12;
+
+// A tile is drawn once it has been playing this long, so its first frames have
+// been decoded; until then the base shows through
+static const double kTileWarmupSeconds = 0.25;
+
+// A tile that leaves the view keeps decoding for this long, so looking back and
+// forth does not restart it
+static const double kTileDeactivationDelay = 1.0;
+
+// How often active tiles are checked against the base stream's clock, and the drift
+// beyond which they are resynchronized
+static const double kTileSyncInterval = 1.0;
+static const float kMaxTileDrift = 0.1;
+
+VROTiledVideoSphere::VROTiledVideoSphere(std::shared_ptr<VROVideoTexture> baseVideo,
+                                         std::vector<std::shared_ptr<VROVideoTexture>> tileVideos,
+                                         int columns, int rows, int maxActiveTiles) :
+    _baseVideo(baseVideo),
+    _columns(std::max(columns, 1)),
+    _rows(std::max(rows, 1)),
+    _maxActiveTiles(maxActiveTiles),
+    _loaded(false),
+    _paused(true),
+    _viewMargin(kDefaultViewMargin),
+    _lastSyncTime(0) {
+
+    passert (tileVideos.size() == _columns * _rows);
+    for (std::shared_ptr<VROVideoTexture> &video : tileVideos) {
+        Tile tile;
+        tile.video = video;
+        tile.radius = 0;
+        tile.active = false;
+        tile.shown = false;
+        tile.activationTime = 0;
+        tile.lastVisibleTime = 0;
+        _tiles.push_back(tile);
+    }
+
+    setCameraEnclosure(true);
+    setName("Background");
+    buildGeometry();
+}
+
+VROTiledVideoSphere::~VROTiledVideoSphere() {
+
+}
+
+#pragma mark - Geometry
+
+void VROTiledVideoSphere::buildGeometry() {
+    std::vector<VROShapeVertexLayout> vertices;
+    std::vector<int> baseIndices = appendPatch(0, 1, 0, 1, kTiledSphereNumSegments, kTiledSphereNumSegments, vertices);
+
+    int tileWidthSegments = std::max(2, kTiledSphereNumSegments / _columns);
+    int tileHeightSegments = std::max(2, kTiledSphereNumSegments / _rows);
+
+    std::vector<std::vector<int>> tileIndices;
+    for (int row = 0; row < _rows; row++) {
+        for (int column = 0; column < _columns; column++) {
+            float u0 = (float) column / _columns;
+            float u1 = (float) (column + 1) / _columns;
+            float v0 = (float) row / _rows;
+            float v1 = (float) (row + 1) / _rows;
+            tileIndices.push_back(appendPatch(u0, u1, v0, v1, tileWidthSegments, tileHeightSegments, vertices));
+
+            // Bound the tile by the cone around its center that contains its edges
+            Tile &tile = _tiles[row * _columns + column];
+            auto direction = [](float u, float v) {
+                float phi = (1 - u) * M_PI * 2.0;
+                float theta = v * M_PI;
+                return VROVector3f(-cos(phi) * sin(theta), cos(theta), sin(phi) * sin(theta));
+            };
+            tile.center = direction((u0 + u1) / 2, (v0 + v1) / 2).normalize();
+            tile.radius = 0;
+            for (int i = 0; i <= 2; i++) {
+                for (int j = 0; j <= 2; j++) {
+                    VROVector3f edge = direction(u0 + (u1 - u0) * i / 2, v0 + (v1 - v0) * j / 2);
+                    tile.radius = std::max(tile.radius, tile.center.angleWithNormedVector(edge.normalize()));
+                }
+            }
+        }
+    }
+
+    VROVector3f *tangents = VROShapeUtilStartTangents(vertices.data(), vertices.size());
+    VROShapeUtilComputeTangentsForIndices(vertices.data(), vertices.size(), baseIndices.data(), baseIndices.size(), tangents);
+    for (std::vector<int> &indices : tileIndices) {
+        VROShapeUtilComputeTangentsForIndices(vertices.data(), vertices.size(), indices.data(), indices.size(), tangents);
+    }
+    VROShapeUtilEndTangents(vertices.data(), vertices.size(), tangents);
+
+    auto createElement = [](std::vector<int> &indices) {
+        std::shared_ptr<VROData> indexData = std::make_shared<VROData>((void *) indices.data(), sizeof(int) * indices.size());
+        return std::make_shared<VROGeometryElement>(indexData, VROGeometryPrimitiveType::Triangle,
+                                                    indices.size() / 3, sizeof(int));
+    };
+    _baseElement = createElement(baseIndices);
+    for (int i = 0; i < _tiles.size(); i++) {
+        _tiles[i].element = createElement(tileIndices[i]);
+        _tiles[i].material = createMaterial(_tiles[i].video);
+    }
+
+    std::shared_ptr<VROData> vertexData = std::make_shared<VROData>((void *) vertices.data(),
+                                                                    sizeof(VROShapeVertexLayout) * vertices.size());
+    setSources(VROShapeUtilBuildGeometrySources(vertexData, vertices.size()));
+
+    // Every material is installed up front, so that VROPortal prepares each of them
+    // as a background; elements are swapped in and out as tiles are shown
+    std::vector<std::shared_ptr<VROMaterial>> materials = { createMaterial(_baseVideo) };
+    for (Tile &tile : _tiles) {
+        materials.push_back(tile.material);
+    }
+    setMaterials(materials);
+    setElements({ _baseElement });
+    updateBoundingBox();
+}
+
+std::vector<int> VROTiledVideoSphere::appendPatch(float u0, float u1, float v0, float v1,
+                                                  int widthSegments, int heightSegments,
+                                                  std::vector<VROShapeVertexLayout> &vertices) {
+    /*
+     Builds the part of an inward-facing VROSphere that shows texture coordinates
+     [u0, u1] x [v0, v1] of the equirectangular frame, with texture coordinates
+     spanning [0, 1] across the patch.
+     */
+    int start = (int) vertices.size();
+    for (int y = 0; y <= heightSegments; y++) {
+        float v = (float) y / (float) heightSegments;
+        float theta = (v0 + (v1 - v0) * v) * M_PI;
+
+        for (int x = 0; x <= widthSegments; x++) {
+            float u = (float) x / (float) widthSegments;
+            float phi = (1 - (u0 + (u1 - u0) * u)) * M_PI * 2.0;
+
+            VROShapeVertexLayout vertex;
+            vertex.x = -kTiledSphereRadius * cos(phi) * sin(theta);
+            vertex.y =  kTiledSphereRadius * cos(theta);
+            vertex.z =  kTiledSphereRadius * sin(phi) * sin(theta);
+            vertex.u = u;
+            vertex.v = v;
+
+            VROVector3f normal = VROVector3f(vertex.x, vertex.y, vertex.z).normalize().scale(-1);
+            vertex.nx = normal.x;
+            vertex.ny = normal.y;
+            vertex.nz = normal.z;
+            vertices.push_back(vertex);
+        }
+    }
+
+    // Phi decreases with x here, where it increases in VROSphere, so the winding of
+    // each quad is reversed relative to it. Triangles that collapse at a pole are skipped.
+    std::vector<int> indices;
+    int stride = widthSegments + 1;
+    for (int y = 0; y < heightSegments; y++) {
+        for (int x = 0; x < widthSegments; x++) {
+            int i1 = start + y * stride + x + 1;
+            int i2 = start + y * stride + x;
+            int i3 = start + (y + 1) * stride + x;
+            int i4 = start + (y + 1) * stride + x + 1;
+
+            if (y != 0 || v0 > 0) {
+                indices.insert(indices.end(), { i1, i2, i4 });
+            }
+            if (y != heightSegments - 1 || v1 < 1) {
+                indices.insert(indices.end(), { i2, i3, i4 });
+            }
+        }
+    }
+    return indices;
+}
+
+std::shared_ptr<VROMaterial> VROTiledVideoSphere::createMaterial(std::shared_ptr<VROVideoTexture> video) {
+    std::shared_ptr<VROMaterial> material = std::make_shared<VROMaterial>();
+    material->setLightingModel(VROLightingModel::Constant);
+    material->getDiffuse().setTexture(video);
+    material->setWritesToDepthBuffer(false);
+    material->setNeedsToneMapping(false);
+    return material;
+}
+
+#pragma mark - Playback
+
+void VROTiledVideoSphere::loadVideo(std::string baseURL, std::vector<std::string> tileURLs,
+                                    std::shared_ptr<VROFrameSynchronizer> frameSynchronizer,
+                                    std::shared_ptr<VRODriver> driver) {
+    passert (tileURLs.size() == _tiles.size());
+
+    _baseVideo->loadVideo(baseURL, frameSynchronizer, driver);
+    for (int i = 0; i < _tiles.size(); i++) {
+        Tile &tile = _tiles[i];
+        deactivateTile(tile);
+        tile.video->loadVideo(tileURLs[i], frameSynchronizer, driver);
+        tile.video->setMuted(true);
+    }
+    updateElements();
+    _loaded = true;
+
+    std::shared_ptr<VROFrameListener> listener = std::dynamic_pointer_cast<VROFrameListener>(std::dynamic_pointer_cast<VROTiledVideoSphere>(shared_from_this()));
+    frameSynchronizer->removeFrameListener(listener);
+    frameSynchronizer->addFrameListener(listener);
+}
+
+void VROTiledVideoSphere::play() {
+    _paused = false;
+    _baseVideo->play();
+
+    float time = _baseVideo->getCurrentTimeInSeconds();
+    for (Tile &tile : _tiles) {
+        if (tile.active) {
+            tile.video->seekToTime(time);
+            tile.video->play();
+        }
+    }
+}
+
+void VROTiledVideoSphere::pause() {
+    _paused = true;
+    _baseVideo->pause();
+    for (Tile &tile : _tiles) {
+        if (tile.active) {
+            tile.video->pause();
+        }
+    }
+}
+
+bool VROTiledVideoSphere::isPaused() {
+    return _baseVideo->isPaused();
+}
+
+void VROTiledVideoSphere::seekToTime(float seconds) {
+    _baseVideo->seekToTime(seconds);
+    for (Tile &tile : _tiles) {
+        if (tile.active) {
+            tile.video->seekToTime(seconds);
+        }
+    }
+}
+
+float VROTiledVideoSphere::getCurrentTimeInSeconds() {
+    return _baseVideo->getCurrentTimeInSeconds();
+}
+
+float VROTiledVideoSphere::getVideoDurationInSeconds() {
+    return _baseVideo->getVideoDurationInSeconds();
+}
+
+void VROTiledVideoSphere::setMuted(bool muted) {
+    _baseVideo->setMuted(muted);
+}
+
+void VROTiledVideoSphere::setVolume(float volume) {
+    _baseVideo->setVolume(volume);
+}
+
+void VROTiledVideoSphere::setLoop(bool loop) {
+    _baseVideo->setLoop(loop);
+    for (Tile &tile : _tiles) {
+        tile.video->setLoop(loop);
+    }
+}
+
+void VROTiledVideoSphere::setDelegate(std::shared_ptr<VROVideoDelegateInternal> delegate) {
+    _baseVideo->setDelegate(delegate);
+}
+
+int VROTiledVideoSphere::getNumActiveTiles() const {
+    int numActiveTiles = 0;
+    for (const Tile &tile : _tiles) {
+        if (tile.active) {
+            numActiveTiles++;
+        }
+    }
+    return numActiveTiles;
+}
+
+#pragma mark - Tile Selection
+
+void VROTiledVideoSphere::onFrameWillRender(const VRORenderContext &context) {
+    if (!_loaded) {
+        return;
+    }
+    updateTiles(context);
+
+    double now = VROTimeCurrentSeconds();
+    if (!_paused && now - _lastSyncTime > kTileSyncInterval) {
+        syncTiles();
+        _lastSyncTime = now;
+    }
+}
+
+void VROTiledVideoSphere::onFrameDidRender(const VRORenderContext &context) {
+
+}
+
+void VROTiledVideoSphere::updateTiles(const VRORenderContext &context) {
+    /*
+     The camera for this frame has not been computed yet when frame listeners run, so
+     tiles are chosen against the last frame's camera; the margin covers the difference.
+     The view is bounded by the cone through the corners of the frustum.
+     */
+    const VROCamera &camera = context.getCamera();
+    VROQuaternion inverseRotation = _backgroundRotation;
+    inverseRotation.makeInverse();
+    VROVector3f forward = (inverseRotation * camera.getForward()).normalize();
+
+    VROMatrix4f projection = camera.getProjection();
+    float tanX = projection[0] != 0 ? 1.0 / projection[0] : 1.0;
+    float tanY = projection[5] != 0 ? 1.0 / projection[5] : 1.0;
+    float viewRadius = atan(sqrt(tanX * tanX + tanY * tanY));
+
+    std::vector<std::pair<float, int>> visible;
+    for (int i = 0; i < _tiles.size(); i++) {
+        float angle = forward.angleWithNormedVector(_tiles[i].center);
+        if (angle - _tiles[i].radius < viewRadius + _viewMargin) {
+            visible.push_back({ angle, i });
+        }
+    }
+
+    // The tiles nearest the center of the view win when there are more than the
+    // decoders can handle
+    std::sort(visible.begin(), visible.end());
+    if (visible.size() > _maxActiveTiles) {
+        visible.resize(_maxActiveTiles);
+    }
+
+    double now = VROTimeCurrentSeconds();
+    for (std::pair<float, int> &entry : visible) {
+        _tiles[entry.second].lastVisibleTime = now;
+    }
+
+    int numActiveTiles = 0;
+    for (Tile &tile : _tiles) {
+        if (tile.active && now - tile.lastVisibleTime > kTileDeactivationDelay) {
+            deactivateTile(tile);
+        }
+        if (tile.active) {
+            numActiveTiles++;
+        }
+    }
+
+    float time = -1;
+    for (std::pair<float, int> &entry : visible) {
+        Tile &tile = _tiles[entry.second];
+        if (tile.active) {
+            continue;
+        }
+
+        // Make room by retiring the tile that has been out of view the longest
+        if (numActiveTiles >= _maxActiveTiles) {
+            Tile *oldest = nullptr;
+            for (Tile &candidate : _tiles) {
+                if (candidate.active && candidate.lastVisibleTime < now &&
+                    (oldest == nullptr || candidate.lastVisibleTime < oldest->lastVisibleTime)) {
+                    oldest = &candidate;
+                }
+            }
+            if (oldest == nullptr) {
+                break;
+            }
+            deactivateTile(*oldest);
+            numActiveTiles--;
+        }
+
+        if (time < 0) {
+            time = _baseVideo->getCurrentTimeInSeconds();
+        }
+        activateTile(tile, time, now);
+        numActiveTiles++;
+    }
+
+    bool elementsChanged = false;
+    for (Tile &tile : _tiles) {
+        bool shown = tile.active && now - tile.activationTime > kTileWarmupSeconds;
+        if (shown != tile.shown) {
+            tile.shown = shown;
+            elementsChanged = true;
+        }
+    }
+    if (elementsChanged) {
+        updateElements();
+    }
+}
+
+void VROTiledVideoSphere::activateTile(Tile &tile, float time, double now) {
+    tile.active = true;
+    tile.activationTime = now;
+    tile.video->seekToTime(time);
+    if (!_paused) {
+        tile.video->play();
+    }
+}
+
+void VROTiledVideoSphere::deactivateTile(Tile &tile) {
+    if (tile.active) {
+        tile.video->pause();
+    }
+    tile.active = false;
+    tile.shown = false;
+}
+
+void VROTiledVideoSphere::updateElements() {
+    // Elements and materials correspond by index, and the tiles draw in order over
+    // the base
+    std::vector<std::shared_ptr<VROGeometryElement>> elements = { _baseElement };
+    std::vector<std::shared_ptr<VROMaterial>> materials = { getMaterials().front() };
+    std::vector<std::shared_ptr<VROMaterial>> hidden;
+    for (Tile &tile : _tiles) {
+        if (tile.shown) {
+            elements.push_back(tile.element);
+            materials.push_back(tile.material);
+        } else {
+            hidden.push_back(tile.material);
+        }
+    }
+
+    // Hidden tiles' materials stay installed after the shown ones, so they keep the
+    // background shader modifier without being drawn
+    materials.insert(materials.end(), hidden.begin(), hidden.end());
+    setMaterials(materials);
+    setElements(elements);
+}
+
+void VROTiledVideoSphere::syncTiles() {
+    float time = _baseVideo->getCurrentTimeInSeconds();
+    for (Tile &tile : _tiles) {
+        if (tile.active && fabs(tile.video->getCurrentTimeInSeconds() - time) > kMaxTileDrift) {
+            tile.video->seekToTime(time);
+        }
+    }
+}
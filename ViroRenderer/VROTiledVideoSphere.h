@@ -0,0 +1,152 @@
+//
+//  VROTiledVideoSphere.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROTiledVideoSphere_h
+#define VROTiledVideoSphere_h
+
+#include "VROGeometry.h"
+#include "VROFrameListener.h"
+#include "VROQuaternion.h"
+#include "VROVector3f.h"
+#include "VROShapeUtils.h"
+
+class VROVideoTexture;
+class VROFrameSynchronizer;
+class VRODriver;
+class VROGeometryElement;
+class VROVideoDelegateInternal;
+
+/*
+ Background sphere for tiled 360 video. The video is split into a low-resolution
+ base stream covering the whole sphere, and a grid of high-resolution tile streams
+ that each cover one cell of the equirectangular frame (columns x rows, row-major
+ from the top left). Only the tiles that intersect the view, plus a margin, are
+ decoded and drawn over the base; the rest are paused. With four active tiles out of
+ a 4x4 grid, an 8K video needs no more decoding than a 4K one.
+
+ Each stream is an ordinary VROVideoTexture, created by the platform, with the stereo
+ mode of the source (tiles of a stereo video carry both eyes, laid out as in the full
+ frame). Tiles are muted, and are kept in step with the base stream, which drives
+ playback and audio and receives the delegate. Install the sphere with
+ VROPortal::setBackground, and register it with the frame synchronizer through
+ loadVideo.
+ */
+class VROTiledVideoSphere : public VROGeometry, public VROFrameListener {
+
+public:
+
+    VROTiledVideoSphere(std::shared_ptr<VROVideoTexture> baseVideo,
+                        std::vector<std::shared_ptr<VROVideoTexture>> tileVideos,
+                        int columns, int rows, int maxActiveTiles);
+    virtual ~VROTiledVideoSphere();
+
+    /*
+     Load the base stream and one stream per tile, in the order of the tile videos.
+     */
+    void loadVideo(std::string baseURL, std::vector<std::string> tileURLs,
+                   std::shared_ptr<VROFrameSynchronizer> frameSynchronizer,
+                   std::shared_ptr<VRODriver> driver);
+
+    void play();
+    void pause();
+    bool isPaused();
+    void seekToTime(float seconds);
+    float getCurrentTimeInSeconds();
+    float getVideoDurationInSeconds();
+    void setMuted(bool muted);
+    void setVolume(float volume);
+    void setLoop(bool loop);
+    void setDelegate(std::shared_ptr<VROVideoDelegateInternal> delegate);
+
+    /*
+     The rotation of the background, if set through VROPortal::setBackgroundRotation,
+     so tiles are chosen against the rotated sphere.
+     */
+    void setBackgroundRotation(VROQuaternion rotation) {
+        _backgroundRotation = rotation;
+    }
+
+    /*
+     Angle in radians beyond the edges of the view within which tiles are decoded,
+     so they are ready by the time they scroll into view. Defaults to kDefaultViewMargin.
+     */
+    void setViewMargin(float radians) {
+        _viewMargin = radians;
+    }
+
+    /*
+     The number of tiles decoded and drawn in the last frame.
+     */
+    int getNumActiveTiles() const;
+
+    void onFrameWillRender(const VRORenderContext &context);
+    void onFrameDidRender(const VRORenderContext &context);
+    bool isAnimating() { return !isPaused(); }
+    const char *getFrameListenerName() const { return "tiledVideoSphere"; }
+
+private:
+
+    struct Tile {
+        std::shared_ptr<VROVideoTexture> video;
+        std::shared_ptr<VROMaterial> material;
+        std::shared_ptr<VROGeometryElement> element;
+
+        // Direction to the center of the tile, and the angle from there to its farthest edge
+        VROVector3f center;
+        float radius;
+
+        bool active;
+        bool shown;
+        double activationTime;
+        double lastVisibleTime;
+    };
+
+    std::shared_ptr<VROVideoTexture> _baseVideo;
+    std::shared_ptr<VROGeometryElement> _baseElement;
+    std::vector<Tile> _tiles;
+    int _columns, _rows;
+    int _maxActiveTiles;
+
+    bool _loaded;
+    bool _paused;
+    VROQuaternion _backgroundRotation;
+    float _viewMargin;
+    double _lastSyncTime;
+
+    void buildGeometry();
+    std::vector<int> appendPatch(float u0, float u1, float v0, float v1,
+                                 int widthSegments, int heightSegments,
+                                 std::vector<VROShapeVertexLayout> &vertices);
+    std::shared_ptr<VROMaterial> createMaterial(std::shared_ptr<VROVideoTexture> video);
+
+    void updateTiles(const VRORenderContext &context);
+    void activateTile(Tile &tile, float time, double now);
+    void deactivateTile(Tile &tile);
+    void updateElements();
+    void syncTiles();
+
+};
+
+#endif /* VROTiledVideoSphere_h */
@@ -27,6 +27,7 @@
 #include "VROTime.h"
 #include "VRODefines.h"
 #include <map>
+#include <atomic>
 #include <sys/time.h>
 #include <math.h>
 
@@ -35,11 +36,17 @@
 #include <mach/mach_time.h>
 #endif
 
+static std::atomic<bool> sFixedClockEnabled { false };
+static std::atomic<double> sFixedClockSeconds { 0 };
+
 uint64_t VROTimeGetCalendarTime() {
      return time(nullptr);
 }
 
 double VROTimeCurrentSeconds() {
+    if (sFixedClockEnabled.load(std::memory_order_relaxed)) {
+        return sFixedClockSeconds.load(std::memory_order_relaxed);
+    }
 #if VRO_PLATFORM_ANDROID || VRO_PLATFORM_WASM
     return VROTimeCurrentMillis() / 1000.0;
 #elif VRO_PLATFORM_IOS || VRO_PLATFORM_MACOS
@@ -48,6 +55,9 @@ double VROTimeCurrentSeconds() {
 }
 
 double VROTimeCurrentMillis() {
+    if (sFixedClockEnabled.load(std::memory_order_relaxed)) {
+        return sFixedClockSeconds.load(std::memory_order_relaxed) * 1000.0;
+    }
 #if VRO_PLATFORM_ANDROID || VRO_PLATFORM_WASM
     struct timespec time;
     clock_gettime(CLOCK_MONOTONIC, &time);
@@ -69,3 +79,13 @@ uint64_t VRONanoTime() {
     return ((mach_absolute_time() * info.numer) / info.denom);
 #endif
 }
+
+void VROTimeSetFixedClock(bool enabled, double startSeconds) {
+    sFixedClockSeconds.store(startSeconds, std::memory_order_relaxed);
+    sFixedClockEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+void VROTimeAdvanceFixedClock(double seconds) {
+    sFixedClockSeconds.store(sFixedClockSeconds.load(std::memory_order_relaxed) + seconds,
+                             std::memory_order_relaxed);
+}
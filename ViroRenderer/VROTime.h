@@ -44,4 +44,14 @@ uint64_t VROTimeGetCalendarTime();
 
 uint64_t VRONanoTime();
 
+/*
+ Replace the clock behind VROTimeCurrentSeconds and VROTimeCurrentMillis with a
+ fixed clock that only moves when VROTimeAdvanceFixedClock is called, so that
+ animations and simulations step deterministically (e.g. for benchmarks). The
+ fixed clock starts at the given time. VRONanoTime always reads the real clock,
+ so profiling is unaffected.
+ */
+void VROTimeSetFixedClock(bool enabled, double startSeconds = 0);
+void VROTimeAdvanceFixedClock(double seconds);
+
 #endif /* VROTIME_H_ */
@@ -34,6 +34,7 @@
 #include "VROOpenGL.h"
 #include "VROMaterial.h"
 #include "VRORenderTarget.h"
+#include "VROProfiler.h"
 
 VROToneMappingRenderPass::VROToneMappingRenderPass(VROToneMappingMethod method, bool gammaCorrectSoftware,
                                                    std::shared_ptr<VRODriver> driver) :
@@ -49,7 +50,9 @@ VROToneMappingRenderPass::~VROToneMappingRenderPass() {
 }
 
 std::shared_ptr<VROImagePostProcess> VROToneMappingRenderPass::createPostProcess(std::shared_ptr<VRODriver> driver,
-                                                                                 VROToneMappingMethod method) {
+                                                                                 VROToneMappingMethod method,
+                                                                                 const std::vector<std::string> &colorTransform,
+                                                                                 bool compositeTransparency) {
     std::vector<std::string> samplers = { "hdr_texture", "tone_mapping_mask" };
     std::vector<std::string> code = {
         "uniform sampler2D hdr_texture;",
@@ -59,6 +62,41 @@ std::shared_ptr<VROImagePostProcess> VROToneMappingRenderPass::createPostProcess
         "highp vec3 mapped;",
     };
     
+    /*
+     Composite the accumulated transparency over the HDR color. The average color of the
+     transparent fragments is their weighted color sum over their weight sum, and their
+     coverage is one minus the revealage. The tone mapping mask is resolved the same way,
+     so transparent surfaces keep their own tone mapping setting. See
+     VROShaderFactory::createWeightedTransparencyModifier.
+     */
+    if (compositeTransparency) {
+        samplers.push_back("transparency_texture");
+        samplers.push_back("transparency_weight_texture");
+        
+        std::vector<std::string> compositeCode = {
+            "uniform sampler2D transparency_texture;",
+            "uniform sampler2D transparency_weight_texture;",
+            "highp vec4 accumulation = texture(transparency_texture, v_texcoord);",
+            "highp vec4 weights = texture(transparency_weight_texture, v_texcoord);",
+            "highp float total_weight = max(weights.r, 1e-5);",
+            "highp float coverage = clamp(1.0 - accumulation.a, 0.0, 1.0);",
+            "highp float composite_alpha = coverage + hdr_color.a * (1.0 - coverage);",
+            "hdr_color.rgb = ((accumulation.rgb / total_weight) * coverage + hdr_color.rgb * hdr_color.a * (1.0 - coverage)) / max(composite_alpha, 1e-5);",
+            "hdr_color.a = composite_alpha;",
+            "tone_mapped = mix(tone_mapped, weights.g / total_weight, coverage);",
+        };
+        code.insert(code.end(), compositeCode.begin(), compositeCode.end());
+    }
+    
+    /*
+     Apply any post-process color effects that were folded into this pass.
+     */
+    if (!colorTransform.empty()) {
+        code.push_back("frag_color = hdr_color;");
+        code.insert(code.end(), colorTransform.begin(), colorTransform.end());
+        code.push_back("hdr_color = frag_color;");
+    }
+    
     /*
      Perform tone-mapping.
      */
@@ -188,28 +226,44 @@ void VROToneMappingRenderPass::render(std::shared_ptr<VROScene> scene,
                                       std::shared_ptr<VROScene> outgoingScene,
                                       VRORenderPassInputOutput &inputs,
                                       VRORenderContext *context, std::shared_ptr<VRODriver> &driver) {
-    
-    if (!_postProcess) {
-        _postProcess = createPostProcess(driver, _method);
-    }
+    VRO_PROFILE_GPU_SCOPE("toneMappingPass", driver);
     
     std::shared_ptr<VROTexture> hdrInput = inputs.textures[kToneMappingHDRInput];
     std::shared_ptr<VROTexture> toneMappingMask = inputs.textures[kToneMappingMaskInput];
+    std::shared_ptr<VROTexture> transparency = inputs.textures[kToneMappingTransparencyInput];
+    std::shared_ptr<VROTexture> transparencyWeight = inputs.textures[kToneMappingTransparencyWeightInput];
     std::shared_ptr<VRORenderTarget> target = inputs.outputTarget;
+    
+    bool compositeTransparency = transparency && transparencyWeight;
+    std::shared_ptr<VROImagePostProcess> &postProcess = _postProcesses[compositeTransparency ? _colorTransformKey + "|oit" :
+                                                                                               _colorTransformKey];
+    if (!postProcess) {
+        postProcess = createPostProcess(driver, _method, _colorTransform, compositeTransparency);
+    }
 
     pglpush("Tone Mapping");
-    driver->bindRenderTarget(target, VRORenderTargetUnbindOp::Invalidate);
-    _postProcess->blit({ hdrInput, toneMappingMask }, driver);
+    driver->bindRenderTarget(target, VRORenderTargetActions::clearAll(), VRORenderTargetUnbindOp::Invalidate);
+    if (compositeTransparency) {
+        postProcess->blit({ hdrInput, toneMappingMask, transparency, transparencyWeight }, driver);
+    }
+    else {
+        postProcess->blit({ hdrInput, toneMappingMask }, driver);
+    }
     pglpop();
 }
 
 void VROToneMappingRenderPass::setMethod(VROToneMappingMethod method) {
     if (_method != method) {
         _method = method;
-        _postProcess = nullptr;
+        _postProcesses.clear();
     }
 }
 
+void VROToneMappingRenderPass::setColorTransform(std::string key, const std::vector<std::string> &code) {
+    _colorTransformKey = key;
+    _colorTransform = code;
+}
+
 void VROToneMappingRenderPass::setExposure(float exposure) {
     animate(std::make_shared<VROAnimationFloat>([](VROAnimatable *const animatable, float e) {
         ((VROToneMappingRenderPass *)animatable)->_exposure = e;
@@ -27,6 +27,8 @@
 #ifndef VROToneMappingRenderPass_h
 #define VROToneMappingRenderPass_h
 
+#include <map>
+#include <vector>
 #include "VRORenderPass.h"
 #include "VROAnimatable.h"
 
@@ -35,6 +37,8 @@ class VROImagePostProcess;
 
 const std::string kToneMappingHDRInput = "TM_Input";
 const std::string kToneMappingMaskInput = "TM_Mask";
+const std::string kToneMappingTransparencyInput = "TM_Transparency";
+const std::string kToneMappingTransparencyWeightInput = "TM_TransparencyWeight";
 const float kToneMappingDefaultExposure = 1.5;
 const float kToneMappingDefaultWhitePoint = 5.0;
 
@@ -51,6 +55,10 @@ enum class VROToneMappingMethod {
  maps floating point color values into the RGB [0,1] range in a
  manner that preserves image details in both bright and dark
  regions.
+
+ If the transparency inputs are provided, the weighted blended
+ transparency accumulated by VROPortalTreeRenderPass is first
+ composited over the HDR color.
  */
 class VROToneMappingRenderPass : public VRORenderPass, public VROAnimatable {
 public:
@@ -86,6 +94,17 @@ public:
      */
     void setWhitePoint(float whitePoint);
     
+    /*
+     Set a per-pixel color transform to apply to the HDR color before it is tone-mapped.
+     The code reads and writes frag_color, and is identified by the given key. This is
+     used by VROPostProcessEffectFactory to fold trailing color effects into this pass.
+     An empty key removes the transform. The shader for each key is cached.
+     */
+    void setColorTransform(std::string key, const std::vector<std::string> &code);
+    const std::string &getColorTransformKey() const {
+        return _colorTransformKey;
+    }
+    
 private:
 
     VROToneMappingMethod _method;
@@ -93,9 +112,18 @@ private:
     float _whitePoint;
     bool _gammaCorrectionEnabled;
     
-    std::shared_ptr<VROImagePostProcess> _postProcess;
+    std::string _colorTransformKey;
+    std::vector<std::string> _colorTransform;
+    
+    /*
+     Tone-mapping programs cached by the key of the color transform they include,
+     suffixed for programs that composite transparency.
+     */
+    std::map<std::string, std::shared_ptr<VROImagePostProcess>> _postProcesses;
     std::shared_ptr<VROImagePostProcess> createPostProcess(std::shared_ptr<VRODriver> driver,
-                                                           VROToneMappingMethod method);
+                                                           VROToneMappingMethod method,
+                                                           const std::vector<std::string> &colorTransform,
+                                                           bool compositeTransparency);
     
 };
 
@@ -29,9 +29,13 @@
 #include "VROLog.h"
 #include "VROTimingFunctionLinear.h"
 #include "VROMath.h"
+#include "VRONode.h"
+#include "VRORenderContext.h"
+#include "VROJobSystem.h"
 #include <stack>
 #include <vector>
 #include <algorithm>
+#include <limits>
 
 #pragma mark - Transaction Management
 
@@ -92,6 +96,14 @@ void VROTransaction::setFinishCallback(std::function<void (bool terminate)> fini
     animation->_finishCallback = finishCallback;
 }
 
+void VROTransaction::setPrepareCallback(std::function<void(float t)> prepareCallback) {
+    std::shared_ptr<VROTransaction> animation = get();
+    if (!animation) {
+        pabort();
+    }
+    animation->_prepareCallback = prepareCallback;
+}
+
 void VROTransaction::setTimingFunction(VROTimingFunctionType timingFunctionType) {
     setTimingFunction(VROTimingFunction::forType(timingFunctionType));
 }
@@ -140,6 +152,14 @@ void VROTransaction::setAnimationLoop(bool loop) {
     animation->_loop = loop;
 }
 
+void VROTransaction::setAnimationLODNode(std::shared_ptr<VRONode> node) {
+    std::shared_ptr<VROTransaction> animation = get();
+    if (!animation) {
+        pabort();
+    }
+    animation->_lodNode = node;
+}
+
 float VROTransaction::getAnimationDuration() {
     std::shared_ptr<VROTransaction> animation = get();
     if (!animation) {
@@ -213,7 +233,16 @@ void VROTransaction::terminate(std::shared_ptr<VROTransaction> transaction, bool
     committedTransactions.erase(transactionToTerminate);
 }
 
-void VROTransaction::update() {
+bool VROTransaction::hasRunningAnimations() {
+    for (const std::shared_ptr<VROTransaction> &transaction : committedTransactions) {
+        if (!transaction->_paused) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void VROTransaction::update(const VRORenderContext &context) {
     double time = VROTimeCurrentSeconds();
 
     /*
@@ -223,6 +252,29 @@ void VROTransaction::update() {
     std::vector<std::shared_ptr<VROTransaction>>::iterator it;
     std::vector<std::shared_ptr<VROTransaction>> runningTransactions = committedTransactions;
 
+    /*
+     Let the transactions that will process a frame prepare it first, in parallel.
+     */
+    std::vector<std::pair<VROTransaction *, float>> preparing;
+    for (const std::shared_ptr<VROTransaction> &transaction : runningTransactions) {
+        if (transaction->_prepareCallback) {
+            float t = transaction->getFrameT(time, context);
+            if (t >= 0) {
+                preparing.push_back({ transaction.get(), transaction->_timingFunction->getT(t) });
+            }
+        }
+    }
+    std::shared_ptr<VROJobSystem> jobs = context.getJobSystem();
+    if (jobs && preparing.size() > 1) {
+        jobs->parallelFor(0, (int) preparing.size(), 1, [&preparing](int i) {
+            preparing[i].first->_prepareCallback(preparing[i].second);
+        });
+    } else {
+        for (std::pair<VROTransaction *, float> &prepare : preparing) {
+            prepare.first->_prepareCallback(prepare.second);
+        }
+    }
+
     for (it = runningTransactions.begin(); it != runningTransactions.end(); ++it) {
         std::shared_ptr<VROTransaction> transaction = *it;
         float passedTime = time - (transaction->_startTimeSeconds);
@@ -250,6 +302,23 @@ void VROTransaction::update() {
             }
         }
         else {
+            /*
+             Throttled transactions sample their animations at the current time
+             whenever they do update, so they never fall behind. Paused (invisible)
+             transactions update as soon as they become visible again.
+             */
+            std::shared_ptr<VRONode> lodNode = transaction->_lodNode.lock();
+            if (lodNode) {
+                int interval = lodNode->getAnimationUpdateInterval(context);
+                if (interval <= 0) {
+                    transaction->_framesSinceUpdate = std::numeric_limits<int>::max() - 1;
+                    continue;
+                }
+                if (++transaction->_framesSinceUpdate < interval) {
+                    continue;
+                }
+                transaction->_framesSinceUpdate = 0;
+            }
             transaction->processAnimations(percent);
         }
     }
@@ -263,6 +332,30 @@ void VROTransaction::update() {
             }), committedTransactions.end());
 }
 
+float VROTransaction::getFrameT(double time, const VRORenderContext &context) const {
+    float passedTime = time - _startTimeSeconds;
+    passedTime = passedTime * _speed + _currentSpeedModulatedTime;
+
+    float passedTimeInSeconds = passedTime + _offsetTimeSeconds;
+    if (_paused || passedTimeInSeconds <= _delayTimeSeconds) {
+        return -1;
+    }
+
+    float percent = (passedTimeInSeconds - _delayTimeSeconds) / _durationSeconds;
+    if (isinf(percent) || percent > 1.0 - kEpsilon) {
+        return -1;
+    }
+
+    std::shared_ptr<VRONode> lodNode = _lodNode.lock();
+    if (lodNode) {
+        int interval = lodNode->getAnimationUpdateInterval(context);
+        if (interval <= 0 || _framesSinceUpdate + 1 < interval) {
+            return -1;
+        }
+    }
+    return percent;
+}
+
 #pragma mark - Transaction Class
 
 VROTransaction::VROTransaction() :
@@ -274,7 +367,8 @@ VROTransaction::VROTransaction() :
         _startTimeSeconds(0),
         _delayTimeSeconds(0),
         _currentSpeedModulatedTime(0),
-        _loop(false) {
+        _loop(false),
+        _framesSinceUpdate(0) {
     _timingFunction = std::unique_ptr<VROTimingFunction>(new VROTimingFunctionLinear());
 }
 
@@ -285,6 +379,7 @@ void VROTransaction::processAnimations(float t) {
     for (std::shared_ptr<VROAnimation> animation : _animations) {
         animation->processAnimationFrame(transformedT);
     }
+    _batch.process(transformedT);
 }
 
 void VROTransaction::onTermination() {
@@ -292,6 +387,7 @@ void VROTransaction::onTermination() {
     for (std::shared_ptr<VROAnimation> animation : _animations) {
         animation->onTermination();
     }
+    _batch.finish();
 
     if (_finishCallback) {
         _finishCallback(true);
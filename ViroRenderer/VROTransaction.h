@@ -34,6 +34,10 @@
 #include "VROAnimation.h"
 #include "VROTimingFunction.h"
 #include "VROExecutableAnimation.h"
+#include "VROAnimationBatch.h"
+
+class VRONode;
+class VRORenderContext;
 
 class VROTransaction {
 
@@ -54,9 +58,17 @@ public:
     static bool isActive();
 
     /*
-     Update the T values for all committed animation transactions.
+     Update the T values for all committed animation transactions. The context
+     holds the camera of the last frame rendered, against which transactions
+     with an LOD node are throttled.
      */
-    static void update();
+    static void update(const VRORenderContext &context);
+
+    /*
+     Return true if any committed transaction on this thread is not paused; that
+     is, if animations will change the scene on the next update.
+     */
+    static bool hasRunningAnimations();
 
     /*
      Begin a new VROTransaction on this thread, and make this the active animation
@@ -140,12 +152,29 @@ public:
       */
     static void setAnimationSpeed(std::shared_ptr<VROTransaction> transaction, float speed);
 
+    /*
+     Set the node whose visibility and screen size determine how often the active
+     transaction updates its animations (see VRONode::setAnimationLODEnabled). The
+     transaction still starts, loops, and finishes on time; only the frames in
+     between are skipped.
+     */
+    static void setAnimationLODNode(std::shared_ptr<VRONode> node);
+
     /*
      Set a callback to invoke when the active transaction completes (after duration
      seconds).
      */
     static void setFinishCallback(std::function<void(bool terminate)> finishCallback);
 
+    /*
+     Set a callback to invoke before the active transaction processes each frame of
+     its animations, with the (timing function transformed) T value of that frame.
+     Prepare callbacks of all running transactions are invoked in parallel on the
+     renderer's job system, so they may only touch state owned by the animation
+     that set them. Use this to compute expensive poses ahead of their animations.
+     */
+    static void setPrepareCallback(std::function<void(float t)> prepareCallback);
+
     /*
      Set a timing function, which defines the curve of the animation (ease in, ease out,
      etc.)
@@ -179,6 +208,14 @@ public:
     void addAnimation(std::shared_ptr<VROAnimation> animation) {
         _animations.push_back(animation);
     }
+
+    /*
+     Get the batch that holds this transaction's bulk-evaluated property
+     animations (see VROAnimatable::animateFloats).
+     */
+    VROAnimationBatch &getAnimationBatch() {
+        return _batch;
+    }
     
     /*
      Hold a reference to an executable animation. This is used to keep executable
@@ -195,6 +232,13 @@ public:
      */
     void processAnimations(float t);
 
+    /*
+     Return the T value (prior to timing function transformation) that update()
+     will process for this transaction at the given time, or -1 if update() will
+     not process animations for this transaction.
+     */
+    float getFrameT(double time, const VRORenderContext &context) const;
+
     /*
      Invoked when the transaction is finished.
      */
@@ -214,8 +258,17 @@ private:
     bool _loop;
     std::unique_ptr<VROTimingFunction> _timingFunction;
 
+    /*
+     The node that throttles this transaction, and the number of frames since
+     its animations were last processed.
+     */
+    std::weak_ptr<VRONode> _lodNode;
+    int _framesSinceUpdate;
+
     std::function<void(bool terminate)> _finishCallback;
+    std::function<void(float t)> _prepareCallback;
     std::vector<std::shared_ptr<VROAnimation>> _animations;
+    VROAnimationBatch _batch;
     std::vector<std::shared_ptr<VROExecutableAnimation>> _executableAnimations;
 
 };
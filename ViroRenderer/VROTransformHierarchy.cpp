@@ -0,0 +1,311 @@
+//
+//  VROTransformHierarchy.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include "VROTransformHierarchy.h"
+#include "VRONode.h"
+#include "VROGeometry.h"
+#include "VROSound.h"
+#include "VROAtomic.h"
+#include "VROFrustum.h"
+#include "VROCamera.h"
+#include "VRORenderContext.h"
+#include "VROProfiler.h"
+#include "VRORenderInvalidation.h"
+#include <algorithm>
+
+static VROAtomic<uint32_t> sGraphStructureVersion(0);
+
+void VROTransformHierarchy::notifyGraphStructureChanged() {
+    ++sGraphStructureVersion;
+    VRORenderInvalidation::invalidate();
+}
+
+uint32_t VROTransformHierarchy::getGraphStructureVersion() {
+    return sGraphStructureVersion;
+}
+
+VROTransformHierarchy::VROTransformHierarchy() :
+    _root(nullptr),
+    _structureVersion(0),
+    _numNodesUpdated(0) {
+    
+}
+
+VROTransformHierarchy::~VROTransformHierarchy() {
+    
+}
+
+#pragma mark - Flattening
+
+void VROTransformHierarchy::flatten(VRONode *root) {
+    _root = root;
+    _nodes.clear();
+    _parents.clear();
+    _subtreeEnds.clear();
+    _localTransforms.clear();
+    _worldTransforms.clear();
+    _worldRotations.clear();
+    
+    if (root != nullptr) {
+        flatten(root, -1);
+    }
+    
+    size_t numNodes = _nodes.size();
+    _updated.assign(numNodes, 0);
+    _umbrellaDirty.assign(numNodes, 0);
+    _umbrellaSet.assign(numNodes, 0);
+    
+    // We have no transforms stored for a newly flattened graph, so every
+    // node has to be recomputed
+    for (VRONode *node : _nodes) {
+        node->_transformsDirty = true;
+    }
+}
+
+void VROTransformHierarchy::flatten(VRONode *node, int parent) {
+    int index = (int) _nodes.size();
+    _nodes.push_back(node);
+    _parents.push_back(parent);
+    _subtreeEnds.push_back(index + 1);
+    _localTransforms.push_back(VROMatrix4f::identity());
+    _worldTransforms.push_back(VROMatrix4f::identity());
+    _worldRotations.push_back(VROMatrix4f::identity());
+    
+    for (const std::shared_ptr<VRONode> &child : node->_subnodes) {
+        flatten(child.get(), index);
+    }
+    _subtreeEnds[index] = (int) _nodes.size();
+}
+
+#pragma mark - Update
+
+bool VROTransformHierarchy::isDirty(int index) const {
+    VRONode *node = _nodes[index];
+    if (node->_transformsDirty) {
+        return true;
+    }
+    
+    // Constraints and particle emitters overwrite the node's transforms or
+    // bounds every frame, outside of the node's setters
+    if (!node->_constraints.empty() || node->_particleEmitter) {
+        return true;
+    }
+    
+    // Instanced and morphing geometry can change bounds without notifying
+    // the node
+    if (node->_geometry) {
+        if (node->_geometry->getInstancedUBO() != nullptr) {
+            return true;
+        }
+        const VROBoundingBox &box = node->_geometry->getBoundingBox();
+        const VROBoundingBox &last = node->_geometryBoundingBox;
+        if (box.getMinX() != last.getMinX() || box.getMaxX() != last.getMaxX() ||
+            box.getMinY() != last.getMinY() || box.getMaxY() != last.getMaxY() ||
+            box.getMinZ() != last.getMinZ() || box.getMaxZ() != last.getMaxZ()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void VROTransformHierarchy::update(std::shared_ptr<VRONode> root) {
+    uint32_t version = sGraphStructureVersion;
+    if (root.get() != _root || version != _structureVersion) {
+        flatten(root.get());
+        _structureVersion = version;
+    }
+    
+    _numNodesUpdated = 0;
+    std::fill(_updated.begin(), _updated.end(), 0);
+    
+    int numNodes = (int) _nodes.size();
+    int i = 0;
+    while (i < numNodes) {
+        VRONode *node = _nodes[i];
+        if (!isDirty(i)) {
+            // Sounds can move within a node without dirtying it
+            for (std::shared_ptr<VROSound> &sound : node->_sounds) {
+                sound->setTransformedPosition(_worldTransforms[i].multiply(sound->getPosition()));
+            }
+            ++i;
+            continue;
+        }
+        
+        // The node is dirty, so its entire subtree (the contiguous range
+        // [i, end)) has to be recomputed. Parents always precede their
+        // children, so each node can read its parent's fresh transforms
+        // from the arrays
+        int end = _subtreeEnds[i];
+        for (int j = i; j < end; j++) {
+            VRONode *n = _nodes[j];
+            int parent = _parents[j];
+            
+            VROMatrix4f parentTransform = parent >= 0 ? _worldTransforms[parent] : VROMatrix4f::identity();
+            VROMatrix4f parentRotation  = parent >= 0 ? _worldRotations[parent]  : VROMatrix4f::identity();
+            n->doComputeTransform(parentTransform);
+            n->_worldRotation = parentRotation.multiply(n->_rotation.getMatrix());
+            
+            for (std::shared_ptr<VROSound> &sound : n->_sounds) {
+                sound->setTransformedPosition(n->_worldTransform.multiply(sound->getPosition()));
+            }
+            n->_transformsDirty = false;
+            
+            _localTransforms[j] = n->_localTransform;
+            _worldTransforms[j] = n->_worldTransform;
+            _worldRotations[j] = n->_worldRotation;
+            _updated[j] = 1;
+            _umbrellaDirty[j] = 1;
+        }
+        _numNodesUpdated += end - i;
+        
+        // Every ancestor of the subtree needs its umbrella bounds recomputed.
+        // If an ancestor is already marked, so is the rest of the path up
+        int ancestor = _parents[i];
+        while (ancestor >= 0 && !_umbrellaDirty[ancestor]) {
+            _umbrellaDirty[ancestor] = 1;
+            ancestor = _parents[ancestor];
+        }
+        i = end;
+    }
+    
+    // Children always follow their parents, so walking backward computes the
+    // umbrella bounds bottom-up
+    for (int j = numNodes - 1; j >= 0; j--) {
+        if (_umbrellaDirty[j]) {
+            computeUmbrellaBounds(j);
+            _umbrellaDirty[j] = 0;
+        }
+    }
+}
+
+#pragma mark - Visibility
+
+bool VROTransformHierarchy::updateVisibility(std::shared_ptr<VRONode> root, const VRORenderContext &context) {
+    uint32_t version = sGraphStructureVersion;
+    if (root.get() != _root || version != _structureVersion) {
+        return false;
+    }
+    VRO_PROFILE_SCOPE("batchedFrustumCulling");
+    
+    int numNodes = (int) _nodes.size();
+    _umbrellaBounds.resize(numNodes);
+    for (int i = 0; i < numNodes; i++) {
+        _umbrellaBounds[i] = _nodes[i]->_worldUmbrellaBoundingBox;
+    }
+    
+    int maskSize = VROFrustum::getBatchMaskSize(numNodes);
+    _intersectingMask.resize(maskSize);
+    _insideMask.resize(maskSize);
+    
+    const VROCamera &camera = context.getCamera();
+    camera.getFrustum().intersectBatch(_umbrellaBounds.data(), numNodes,
+                                       _intersectingMask.data(), _insideMask.data());
+    
+    VROVector3f cameraPosition = camera.getPosition();
+    int i = 0;
+    while (i < numNodes) {
+        VRONode *node = _nodes[i];
+        
+        // As in VRONode::computeNodeVisibility, bounds that enclose the camera
+        // are always treated as intersecting the frustum
+        VROFrustumResult result;
+        if (_umbrellaBounds[i].containsPoint(cameraPosition)) {
+            result = VROFrustumResult::Intersects;
+        }
+        else if (!VROFrustum::isBatchMaskSet(_intersectingMask.data(), i)) {
+            result = VROFrustumResult::Outside;
+        }
+        else if (VROFrustum::isBatchMaskSet(_insideMask.data(), i)) {
+            result = VROFrustumResult::Inside;
+        }
+        else {
+            result = VROFrustumResult::Intersects;
+        }
+        result = node->applyOcclusionResult(result, context);
+        
+        // Descend into intersecting nodes; otherwise the entire subtree (the
+        // range [i, end)) shares this node's visibility
+        if (result == VROFrustumResult::Intersects) {
+            node->_visible = true;
+            ++i;
+        }
+        else {
+            bool visible = (result == VROFrustumResult::Inside);
+            int end = _subtreeEnds[i];
+            for (int j = i; j < end; j++) {
+                _nodes[j]->_visible = visible;
+            }
+            i = end;
+        }
+    }
+    return true;
+}
+
+void VROTransformHierarchy::computeUmbrellaBounds(int index) {
+    /*
+     Unlike VRONode::computeUmbrellaBounds, which walks the entire subtree,
+     we build the umbrella bounds from those of the direct children. The
+     world umbrella bounds are identical. The local umbrella bounds are
+     conservative: the child's local umbrella box is itself axis-aligned
+     before being transformed into this node's coordinate system, so the
+     result may be slightly larger than the exact box.
+     */
+    VRONode *node = _nodes[index];
+    VROBoundingBox &localBounds = node->_localUmbrellaBoundingBox;
+    VROBoundingBox &worldBounds = node->_worldUmbrellaBoundingBox;
+    
+    bool isSet = false;
+    if (node->_geometry) {
+        localBounds = node->_geometryBoundingBox;
+        worldBounds = node->_worldBoundingBox;
+        isSet = true;
+    }
+    
+    int end = _subtreeEnds[index];
+    for (int c = index + 1; c < end; c = _subtreeEnds[c]) {
+        if (!_umbrellaSet[c]) {
+            continue;
+        }
+        VRONode *child = _nodes[c];
+        VROBoundingBox childLocalBounds = child->_localUmbrellaBoundingBox.transform(_localTransforms[c]);
+        if (!isSet) {
+            localBounds = childLocalBounds;
+            worldBounds = child->_worldUmbrellaBoundingBox;
+            isSet = true;
+        } else {
+            localBounds.unionDestructive(childLocalBounds);
+            worldBounds.unionDestructive(child->_worldUmbrellaBoundingBox);
+        }
+    }
+    
+    // If there is no geometry all the way down, set the bounds to the position
+    if (!isSet) {
+        worldBounds.set(node->_worldPosition.x, node->_worldPosition.x, node->_worldPosition.y,
+                        node->_worldPosition.y, node->_worldPosition.z, node->_worldPosition.z);
+        localBounds.set(0, 0, 0, 0, 0, 0);
+    }
+    _umbrellaSet[index] = isSet;
+}
@@ -0,0 +1,170 @@
+//
+//  VROTransformHierarchy.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROTransformHierarchy_h
+#define VROTransformHierarchy_h
+
+#include <stdio.h>
+#include <vector>
+#include <memory>
+#include "VROMatrix4f.h"
+#include "VROBoundingBox.h"
+
+class VRONode;
+class VRORenderContext;
+
+/*
+ Flat, data-oriented alternative to the recursive VRONode::computeTransforms
+ pass. The scene graph is flattened into depth-first order, with each node's
+ parent index, the extent of its subtree, and its local and world matrices
+ stored in parallel arrays.
+
+ Nodes mark themselves dirty when their position, rotation, scale, pivots,
+ or geometry change. On update, only dirty subtrees have their transforms
+ recomputed (a subtree is one contiguous range in depth-first order), and
+ umbrella bounding boxes are recomputed bottom-up along the paths from those
+ subtrees to the root. Static content is therefore nearly free.
+
+ Nodes whose transforms are modified outside of their setters every frame
+ (nodes with constraints, particle emitters, instanced geometry, or changing
+ geometry bounds) are treated as always dirty.
+
+ The flattened graph is rebuilt whenever the structure of any scene graph
+ changes (see notifyGraphStructureChanged()).
+ */
+class VROTransformHierarchy {
+public:
+
+    /*
+     Invoked by VRONode whenever a node is added to or removed from a
+     parent. Invalidates all flattened hierarchies.
+     */
+    static void notifyGraphStructureChanged();
+    
+    /*
+     Returns the current graph structure version, which is incremented by
+     each notifyGraphStructureChanged().
+     */
+    static uint32_t getGraphStructureVersion();
+
+    VROTransformHierarchy();
+    virtual ~VROTransformHierarchy();
+
+    /*
+     Recompute the transforms and bounds of all dirty nodes in the graph
+     rooted at the given node, flattening the graph first if its structure
+     has changed. Must be invoked on the rendering thread.
+     */
+    void update(std::shared_ptr<VRONode> root);
+
+    /*
+     Compute the visibility of every node in the graph rooted at the given
+     node, equivalent to VRONode::updateVisibility. The umbrella bounds of all
+     nodes are tested against the camera frustum in a single batch, and the
+     results are applied in depth-first order, skipping the subtrees of nodes
+     wholly inside or outside the frustum. Returns false without updating
+     anything if the graph has changed since it was last flattened, in which
+     case the recursive visibility pass should be used instead.
+     */
+    bool updateVisibility(std::shared_ptr<VRONode> root, const VRORenderContext &context);
+
+    /*
+     Statistics: the number of nodes in the flattened graph, and the number
+     of nodes whose transforms were recomputed in the last update.
+     */
+    int getNumNodes() const {
+        return (int) _nodes.size();
+    }
+    int getNumNodesUpdated() const {
+        return _numNodesUpdated;
+    }
+    
+    /*
+     Invoke the given function on each node whose transforms were
+     recomputed in the last update.
+     */
+    template<typename F>
+    void forEachUpdatedNode(F &&function) const {
+        for (size_t i = 0; i < _nodes.size(); i++) {
+            if (_updated[i]) {
+                function(_nodes[i]);
+            }
+        }
+    }
+
+private:
+
+    /*
+     The root of the flattened graph, and the graph structure version at
+     the time it was flattened.
+     */
+    VRONode *_root;
+    uint32_t _structureVersion;
+
+    /*
+     Flattened graph in depth-first order. For each node we store its
+     parent's index (-1 for the root) and the index one past the last node
+     in its subtree.
+     */
+    std::vector<VRONode *> _nodes;
+    std::vector<int> _parents;
+    std::vector<int> _subtreeEnds;
+
+    /*
+     Transforms output by the last update, used by children to read their
+     parent's transforms (and by parents to read their children's local
+     transforms) without touching the other node.
+     */
+    std::vector<VROMatrix4f> _localTransforms;
+    std::vector<VROMatrix4f> _worldTransforms;
+    std::vector<VROMatrix4f> _worldRotations;
+
+    /*
+     Per-node flags: true if the transforms of the node were recomputed
+     this update, and true if its umbrella bounds need recomputation. The
+     umbrella set flag is true if the node's subtree contains any geometry.
+     */
+    std::vector<uint8_t> _updated;
+    std::vector<uint8_t> _umbrellaDirty;
+    std::vector<uint8_t> _umbrellaSet;
+
+    /*
+     Contiguous copy of the world umbrella bounds of each node, and the
+     resulting frustum intersection bitmasks, used by updateVisibility.
+     */
+    std::vector<VROBoundingBox> _umbrellaBounds;
+    std::vector<uint32_t> _intersectingMask;
+    std::vector<uint32_t> _insideMask;
+
+    int _numNodesUpdated;
+
+    void flatten(VRONode *root);
+    void flatten(VRONode *node, int parent);
+    bool isDirty(int index) const;
+    void computeUmbrellaBounds(int index);
+
+};
+
+#endif /* VROTransformHierarchy_h */
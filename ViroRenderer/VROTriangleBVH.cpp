@@ -0,0 +1,242 @@
+//
+//  VROTriangleBVH.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROTriangleBVH.h"
+#include "VROLog.h"
+#include <algorithm>
+#include <numeric>
+#include <limits>
+
+// Maximum number of triangles in a leaf node
+static const int kMaxTrianglesPerLeaf = 4;
+
+// Median splits halve each node, so the traversal stack never exceeds log2 of
+// the triangle count (plus one)
+static const int kMaxTraversalStack = 64;
+
+struct VROTriangleBVHStackEntry {
+    int node;
+    
+    // Distance at which the ray enters the node
+    float tNear;
+};
+
+static inline float component(const VROVector3f &v, int axis) {
+    return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+VROTriangleBVH::VROTriangleBVH(std::vector<VROTriangle> triangles) :
+    _numTriangles((int) triangles.size()) {
+    VROClearBoxPacket(&_rootBounds);
+    if (triangles.empty()) {
+        return;
+    }
+    
+    std::vector<VROVector3f> centroids;
+    centroids.reserve(triangles.size());
+    for (const VROTriangle &triangle : triangles) {
+        centroids.push_back(triangle.barycenter());
+    }
+    
+    _triangles = std::move(triangles);
+    _nodes.reserve(2 * _triangles.size() / kMaxTrianglesPerLeaf + 1);
+    build(centroids, 0, (int) _triangles.size());
+    pack();
+}
+
+VROTriangleBVH::~VROTriangleBVH() {
+    
+}
+
+void VROTriangleBVH::build(std::vector<VROVector3f> &centroids, int start, int end) {
+    int nodeIndex = (int) _nodes.size();
+    _nodes.push_back({});
+    
+    VROTriangleBVHNode node;
+    node.childBounds = -1;
+    float centroidMin[3], centroidMax[3];
+    for (int a = 0; a < 3; a++) {
+        node.min[a] = centroidMin[a] =  std::numeric_limits<float>::max();
+        node.max[a] = centroidMax[a] = -std::numeric_limits<float>::max();
+    }
+    
+    for (int i = start; i < end; i++) {
+        const VROTriangle &triangle = _triangles[i];
+        for (int v = 0; v < 3; v++) {
+            VROVector3f vertex = triangle.vertexWithIndex(v);
+            node.min[0] = std::min(node.min[0], vertex.x);
+            node.min[1] = std::min(node.min[1], vertex.y);
+            node.min[2] = std::min(node.min[2], vertex.z);
+            node.max[0] = std::max(node.max[0], vertex.x);
+            node.max[1] = std::max(node.max[1], vertex.y);
+            node.max[2] = std::max(node.max[2], vertex.z);
+        }
+        
+        const VROVector3f &centroid = centroids[i];
+        centroidMin[0] = std::min(centroidMin[0], centroid.x);
+        centroidMin[1] = std::min(centroidMin[1], centroid.y);
+        centroidMin[2] = std::min(centroidMin[2], centroid.z);
+        centroidMax[0] = std::max(centroidMax[0], centroid.x);
+        centroidMax[1] = std::max(centroidMax[1], centroid.y);
+        centroidMax[2] = std::max(centroidMax[2], centroid.z);
+    }
+    
+    int count = end - start;
+    int axis = 0;
+    for (int a = 1; a < 3; a++) {
+        if (centroidMax[a] - centroidMin[a] > centroidMax[axis] - centroidMin[axis]) {
+            axis = a;
+        }
+    }
+    
+    // Make a leaf if there are few triangles, or if they can't be separated
+    if (count <= kMaxTrianglesPerLeaf || centroidMax[axis] <= centroidMin[axis]) {
+        node.start = start;
+        node.count = count;
+        _nodes[nodeIndex] = node;
+        return;
+    }
+    
+    // Partition the triangles (and their centroids) about the median centroid
+    std::vector<int> order(count);
+    std::iota(order.begin(), order.end(), start);
+    int mid = count / 2;
+    std::nth_element(order.begin(), order.begin() + mid, order.end(), [&centroids, axis](int a, int b) {
+        return component(centroids[a], axis) < component(centroids[b], axis);
+    });
+    
+    std::vector<VROTriangle> sortedTriangles;
+    std::vector<VROVector3f> sortedCentroids;
+    sortedTriangles.reserve(count);
+    sortedCentroids.reserve(count);
+    for (int index : order) {
+        sortedTriangles.push_back(_triangles[index]);
+        sortedCentroids.push_back(centroids[index]);
+    }
+    std::copy(sortedTriangles.begin(), sortedTriangles.end(), _triangles.begin() + start);
+    std::copy(sortedCentroids.begin(), sortedCentroids.end(), centroids.begin() + start);
+    
+    build(centroids, start, start + mid);
+    node.start = (int) _nodes.size();
+    node.count = 0;
+    build(centroids, start + mid, end);
+    _nodes[nodeIndex] = node;
+}
+
+void VROTriangleBVH::pack() {
+    VROSetBoxPacketLane(&_rootBounds, 0, _nodes[0].min, _nodes[0].max);
+    
+    for (int i = 0; i < _nodes.size(); i++) {
+        VROTriangleBVHNode &node = _nodes[i];
+        if (node.count > 0) {
+            int packetStart = (int) _packets.size();
+            for (int t = node.start; t < node.start + node.count; t += kIntersectionPacketWidth) {
+                _packets.emplace_back();
+                VROPackTriangles(&_triangles[t], std::min(kIntersectionPacketWidth, node.start + node.count - t),
+                                 &_packets.back());
+            }
+            node.start = packetStart;
+            node.count = (int) _packets.size() - packetStart;
+        }
+        else {
+            _childBounds.emplace_back();
+            VROBoxPacket &bounds = _childBounds.back();
+            VROClearBoxPacket(&bounds);
+            VROSetBoxPacketLane(&bounds, 0, _nodes[i + 1].min, _nodes[i + 1].max);
+            VROSetBoxPacketLane(&bounds, 1, _nodes[node.start].min, _nodes[node.start].max);
+            node.childBounds = (int) _childBounds.size() - 1;
+        }
+    }
+    std::vector<VROTriangle>().swap(_triangles);
+}
+
+bool VROTriangleBVH::intersectsRay(VROVector3f ray, VROVector3f origin, VROVector3f *intPt) const {
+    if (_nodes.empty() || ray.dot(ray) == 0) {
+        return false;
+    }
+    VROPacketRay packetRay(origin, ray);
+    
+    // Parametric distance (in units of the ray direction) to the closest hit so far
+    float closestT = std::numeric_limits<float>::max();
+    bool hit = false;
+    
+    float tNear[kIntersectionPacketWidth];
+    if (!VROIntersectRayBoxPacket(packetRay, _rootBounds, closestT, tNear)) {
+        return false;
+    }
+    
+    VROTriangleBVHStackEntry stack[kMaxTraversalStack];
+    int stackSize = 0;
+    stack[stackSize++] = { 0, tNear[0] };
+    
+    while (stackSize > 0) {
+        VROTriangleBVHStackEntry entry = stack[--stackSize];
+        
+        // Skip nodes that begin beyond a hit found since they were pushed
+        if (entry.tNear > closestT) {
+            continue;
+        }
+        const VROTriangleBVHNode &node = _nodes[entry.node];
+        
+        if (node.count > 0) {
+            for (int i = node.start; i < node.start + node.count; i++) {
+                float t;
+                if (VROIntersectRayTrianglePacket(packetRay, _packets[i], closestT, &t) >= 0 && t < closestT) {
+                    closestT = t;
+                    hit = true;
+                }
+            }
+        }
+        else {
+            int hitChildren = VROIntersectRayBoxPacket(packetRay, _childBounds[node.childBounds], closestT, tNear);
+            int left = entry.node + 1;
+            int right = node.start;
+            
+            passert (stackSize + 2 <= kMaxTraversalStack);
+            if (hitChildren == 3) {
+                // Push the farther child first, so the nearer is visited first
+                if (tNear[0] <= tNear[1]) {
+                    stack[stackSize++] = { right, tNear[1] };
+                    stack[stackSize++] = { left,  tNear[0] };
+                }
+                else {
+                    stack[stackSize++] = { left,  tNear[0] };
+                    stack[stackSize++] = { right, tNear[1] };
+                }
+            }
+            else if (hitChildren == 1) {
+                stack[stackSize++] = { left, tNear[0] };
+            }
+            else if (hitChildren == 2) {
+                stack[stackSize++] = { right, tNear[1] };
+            }
+        }
+    }
+    
+    if (hit) {
+        *intPt = origin + ray * closestT;
+    }
+    return hit;
+}
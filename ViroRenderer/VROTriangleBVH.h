@@ -0,0 +1,101 @@
+//
+//  VROTriangleBVH.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROTriangleBVH_h
+#define VROTriangleBVH_h
+
+#include <vector>
+#include "VROIntersectionKernels.h"
+#include "VROTriangle.h"
+#include "VROVector3f.h"
+
+/*
+ Bounding volume hierarchy over a set of triangles, used to accelerate ray
+ intersection (hit testing) against large meshes. The triangles are stored in
+ the coordinate system they were given in (for geometries, model space), so
+ the BVH remains valid as the owning node moves; rays are instead transformed
+ into the same coordinate system before testing.
+ 
+ The hierarchy is built top-down by splitting each node's triangles at the
+ median centroid along the longest axis of the centroid bounds, and is stored
+ as a flat array in depth-first order (each node's left child immediately
+ follows it). Once built, leaves hold their triangles in four-wide packets and
+ interior nodes hold the bounds of both children in a box packet, so each
+ traversal step is a single packet test (see VROIntersectionKernels).
+ */
+class VROTriangleBVH {
+public:
+    
+    VROTriangleBVH(std::vector<VROTriangle> triangles);
+    virtual ~VROTriangleBVH();
+    
+    /*
+     Find the closest intersection of the given ray with the triangles in this
+     BVH. Returns false if there is no intersection. The ray direction need not
+     be normalized.
+     */
+    bool intersectsRay(VROVector3f ray, VROVector3f origin, VROVector3f *intPt) const;
+    
+    int getNumTriangles() const {
+        return _numTriangles;
+    }
+    int getNumNodes() const {
+        return (int) _nodes.size();
+    }
+    
+private:
+    
+    struct VROTriangleBVHNode {
+        float min[3];
+        float max[3];
+        
+        /*
+         For leaves, the range of triangles in _triangles while building, and
+         the range of packets in _packets once built. For interior nodes, count
+         is 0, start is the index of the right child, and childBounds is the
+         index of the children's bounds in _childBounds.
+         */
+        int start;
+        int count;
+        int childBounds;
+    };
+    
+    int _numTriangles;
+    std::vector<VROTriangle> _triangles;
+    std::vector<VROTriangleBVHNode> _nodes;
+    std::vector<VROTrianglePacket> _packets;
+    std::vector<VROBoxPacket> _childBounds;
+    VROBoxPacket _rootBounds;
+    
+    void build(std::vector<VROVector3f> &centroids, int start, int end);
+    
+    /*
+     Convert the built hierarchy to packets, and release the triangles.
+     */
+    void pack();
+    
+};
+
+#endif /* VROTriangleBVH_h */
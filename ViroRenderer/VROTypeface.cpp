@@ -32,9 +32,29 @@
 #include "VROStringUtil.h"
 #include "VROGlyphAtlas.h"
 #include "VROGlyph.h"
+#include "VROPlatformUtil.h"
 
 #include FT_FREETYPE_H
 #include FT_TRUETYPE_TABLES_H
+#include <mutex>
+
+/*
+ Distance field glyphs rasterized for one face, keyed by code point and
+ variant selector.
+ */
+class VRODistanceFieldGlyphs {
+public:
+    std::mutex mutex;
+    std::vector<std::shared_ptr<VROGlyphAtlas>> atlases;
+    std::map<std::string, VROGlyphBitmap> bitmaps;
+};
+
+/*
+ Distance field glyphs of each face, shared by all typefaces of the face
+ regardless of their size. Entries expire with their last typeface.
+ */
+static std::mutex sDistanceFieldGlyphsMutex;
+static std::map<std::string, std::weak_ptr<VRODistanceFieldGlyphs>> sDistanceFieldGlyphs;
 
 template <typename T>
 T swap_endian(T u) {
@@ -55,7 +75,8 @@ VROTypeface::VROTypeface(std::string name, int size, VROFontStyle style, VROFont
     _name(name),
     _size(size),
     _style(style),
-    _weight(weight) {
+    _weight(weight),
+    _lineHeight(0) {
     
     ALLOCATION_TRACKER_ADD(Typefaces, 1);
 }
@@ -66,6 +87,9 @@ VROTypeface::~VROTypeface() {
 
 void VROTypeface::loadFace() {
     FT_FaceRec_ *face = loadFTFace();
+    if (face && face->size) {
+        _lineHeight = face->size->metrics.height >> 6;
+    }
     computeCoverage(face);
 }
 
@@ -105,9 +129,13 @@ void VROTypeface::computeCoverage(FT_FaceRec_* face) {
     VROByteBuffer buffer(cmapLength);
     error = FT_Load_Sfnt_Table(face, cmapTag, 0, (FT_Byte *)buffer.getData(), &cmapLength);
     if (error) {
-        pinfo("Failed to load 'meta' table");
+        // Never cache coverage parsed from a partially loaded table
+        pinfo("Failed to load 'cmap' table");
+        return;
     }
-    _coverage = VROCharmapCoverage::getCoverage((uint8_t *) buffer.getData(), buffer.capacity(), &_variationCoverage);
+    _coverage = VROCharmapCoverage::getCachedCoverage((uint8_t *) buffer.getData(), buffer.capacity(),
+                                                      VROPlatformGetCacheDirectory() + "/viro_fonts",
+                                                      &_variationCoverage);
 }
 
 std::pair<std::string, std::string> VROTypeface::getLanguages(FT_FaceRec_* face) {
@@ -156,13 +184,20 @@ std::pair<std::string, std::string> VROTypeface::getLanguages(FT_FaceRec_* face)
     return std::make_pair(dlng, slng);
 }
 
-std::shared_ptr<VROGlyph> VROTypeface::getGlyph(uint32_t codePoint, uint32_t variantSelector,
-                                                uint32_t outlineWidth, VROGlyphRenderMode renderMode) {
+static std::string getGlyphKey(uint32_t codePoint, uint32_t variantSelector,
+                               uint32_t outlineWidth, VROGlyphRenderMode renderMode) {
     std::string key = VROStringUtil::toString(codePoint) + "_V" +
                       VROStringUtil::toString(variantSelector) + "_S" +
                       VROStringUtil::toString(outlineWidth);
-    
-    if (renderMode == VROGlyphRenderMode::Bitmap || renderMode == VROGlyphRenderMode::None) {
+    if (renderMode == VROGlyphRenderMode::DistanceField) {
+        key += "_D";
+    }
+    return key;
+}
+
+std::shared_ptr<VROGlyph> VROTypeface::findCachedGlyph(const std::string &key, VROGlyphRenderMode renderMode) {
+    if (renderMode == VROGlyphRenderMode::Bitmap || renderMode == VROGlyphRenderMode::None ||
+        renderMode == VROGlyphRenderMode::DistanceField) {
         auto kv = _bitmapGlyphCache.find(key);
         if (kv != _bitmapGlyphCache.end()) {
             return kv->second;
@@ -173,9 +208,21 @@ std::shared_ptr<VROGlyph> VROTypeface::getGlyph(uint32_t codePoint, uint32_t var
             return kv->second;
         }
     }
+    return nullptr;
+}
+
+std::shared_ptr<VROGlyph> VROTypeface::getGlyph(uint32_t codePoint, uint32_t variantSelector,
+                                                uint32_t outlineWidth, VROGlyphRenderMode renderMode) {
+    std::string key = getGlyphKey(codePoint, variantSelector, outlineWidth, renderMode);
+    
+    std::lock_guard<std::mutex> lock(_glyphMutex);
+    std::shared_ptr<VROGlyph> cached = findCachedGlyph(key, renderMode);
+    if (cached) {
+        return cached;
+    }
     
     std::shared_ptr<VROGlyph> glyph = loadGlyph(codePoint, variantSelector, outlineWidth, renderMode);
-    if (renderMode == VROGlyphRenderMode::Bitmap) {
+    if (renderMode == VROGlyphRenderMode::Bitmap || renderMode == VROGlyphRenderMode::DistanceField) {
         _bitmapGlyphCache.insert(std::make_pair(key, glyph));
     } else if (renderMode == VROGlyphRenderMode::Vector) {
         _vectorGlyphCache.insert(std::make_pair(key, glyph));
@@ -183,13 +230,36 @@ std::shared_ptr<VROGlyph> VROTypeface::getGlyph(uint32_t codePoint, uint32_t var
     return glyph;
 }
 
+bool VROTypeface::isGlyphLoaded(uint32_t codePoint, uint32_t variantSelector,
+                                uint32_t outlineWidth, VROGlyphRenderMode renderMode) {
+    std::string key = getGlyphKey(codePoint, variantSelector, outlineWidth, renderMode);
+    
+    std::lock_guard<std::mutex> lock(_glyphMutex);
+    return findCachedGlyph(key, renderMode) != nullptr;
+}
+
 void VROTypeface::preloadGlyphs(std::string chars) {
     for (std::string::const_iterator c = chars.begin(); c != chars.end(); ++c) {
         getGlyph(*c, 0, 0, VROGlyphRenderMode::Bitmap);
     }
 }
 
+void VROTypeface::preloadGlyphsAsync(std::shared_ptr<VROTypeface> typeface,
+                                     std::vector<uint32_t> codePoints,
+                                     uint32_t outlineWidth, VROGlyphRenderMode renderMode,
+                                     std::function<void()> callback) {
+    VROPlatformDispatchAsyncBackground([typeface, codePoints, outlineWidth, renderMode, callback] {
+        for (uint32_t codePoint : codePoints) {
+            typeface->getGlyph(codePoint, 0, outlineWidth, renderMode);
+        }
+        VROPlatformDispatchAsyncRenderer([callback] {
+            callback();
+        });
+    });
+}
+
 void VROTypeface::refreshGlyphAtlases(std::shared_ptr<VRODriver> driver) {
+    std::lock_guard<std::mutex> lock(_glyphMutex);
     for (std::shared_ptr<VROGlyphAtlas> atlas : _glyphAtlases) {
         atlas->refreshTexture(driver);
     }
@@ -198,4 +268,55 @@ void VROTypeface::refreshGlyphAtlases(std::shared_ptr<VRODriver> driver) {
             atlas->refreshTexture(driver);
         }
     }
+    if (_distanceFieldGlyphs) {
+        std::lock_guard<std::mutex> distanceFieldLock(_distanceFieldGlyphs->mutex);
+        for (std::shared_ptr<VROGlyphAtlas> atlas : _distanceFieldGlyphs->atlases) {
+            atlas->refreshTexture(driver);
+        }
+    }
+}
+
+void VROTypeface::loadDistanceFieldGlyph(std::shared_ptr<VROGlyph> glyph, FT_FaceRec_ *face,
+                                         uint32_t charCode, uint32_t variantSelector,
+                                         std::shared_ptr<VRODriver> driver) {
+    if (!_distanceFieldGlyphs) {
+        std::string faceKey = _name + "_" + VROStringUtil::toString((int) _style) + "_" +
+                              VROStringUtil::toString((int) _weight);
+        
+        std::lock_guard<std::mutex> lock(sDistanceFieldGlyphsMutex);
+        _distanceFieldGlyphs = sDistanceFieldGlyphs[faceKey].lock();
+        if (!_distanceFieldGlyphs) {
+            _distanceFieldGlyphs = std::make_shared<VRODistanceFieldGlyphs>();
+            sDistanceFieldGlyphs[faceKey] = _distanceFieldGlyphs;
+        }
+    }
+    
+    std::string key = VROStringUtil::toString(charCode) + "_V" + VROStringUtil::toString(variantSelector);
+    
+    // Typefaces of other sizes may be loading into the same atlases on other threads
+    std::lock_guard<std::mutex> distanceFieldLock(_distanceFieldGlyphs->mutex);
+    auto it = _distanceFieldGlyphs->bitmaps.find(key);
+    
+    VROGlyphBitmap bitmap;
+    if (it == _distanceFieldGlyphs->bitmaps.end()) {
+        FT_Set_Pixel_Sizes(face, 0, kDistanceFieldGlyphSize);
+        bool loaded = glyph->loadDistanceFieldBitmap(face, charCode, variantSelector,
+                                                     &_distanceFieldGlyphs->atlases, driver);
+        FT_Set_Pixel_Sizes(face, 0, _size);
+        if (!loaded) {
+            return;
+        }
+        bitmap = glyph->getBitmap(0);
+        _distanceFieldGlyphs->bitmaps[key] = bitmap;
+    } else {
+        bitmap = it->second;
+    }
+    
+    // Advance at this typeface's size
+    glyph->loadMetrics(face, charCode, variantSelector);
+    
+    float scale = (float) _size / (float) kDistanceFieldGlyphSize;
+    bitmap.size = bitmap.size * scale;
+    bitmap.bearing = bitmap.bearing * scale;
+    glyph->setBitmap(0, bitmap);
 }
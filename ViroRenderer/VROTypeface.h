@@ -33,6 +33,8 @@
 #include <vector>
 #include <climits>
 #include <map>
+#include <mutex>
+#include <functional>
 #include "VROLog.h"
 #include "VROAllocationTracker.h"
 #include "VROSparseBitSet.h"
@@ -40,6 +42,7 @@
 class VROGlyph;
 class VRODriver;
 class VROGlyphAtlas;
+class VRODistanceFieldGlyphs;
 struct FT_FaceRec_;
 
 enum class VROGlyphRenderMode;
@@ -98,6 +101,13 @@ public:
      */
     bool hasCharacter(uint32_t codePoint, uint32_t variationSelector) const;
     
+    /*
+     Get the code points this typeface supports, without variations.
+     */
+    const VROSparseBitSet &getCoverage() const {
+        return _coverage;
+    }
+    
     /*
      Get the glyph for the given character. If renderMode is Bitmap, then the
      texture (and related bitmap properties) in the VROGlyph will be populated;
@@ -110,12 +120,24 @@ public:
      
      The outlineWidth parameter determines the size of the outline to use. This is
      only valid for VROGlyphRenderMode::OutlinedBitmap.
+     
+     If renderMode is DistanceField, the glyph's bitmap is a signed distance field
+     taken from an atlas shared by all sizes of this typeface's face. Its bitmap
+     serves every outline width, so outlineWidth is ignored.
      */
     std::shared_ptr<VROGlyph> getGlyph(uint32_t codePoint, uint32_t variantSelector,
                                        uint32_t outlineWidth, VROGlyphRenderMode renderMode);
     
     /*
-     Refresh the texture of all glyph atlases used by this typeface.
+     Returns true if the given glyph has already been loaded and cached, so that
+     getGlyph will not have to rasterize it.
+     */
+    bool isGlyphLoaded(uint32_t codePoint, uint32_t variantSelector,
+                       uint32_t outlineWidth, VROGlyphRenderMode renderMode);
+    
+    /*
+     Refresh the texture of all glyph atlases used by this typeface. Only the
+     regions written since the last refresh are uploaded.
      */
     void refreshGlyphAtlases(std::shared_ptr<VRODriver> driver);
     
@@ -125,9 +147,24 @@ public:
     void preloadGlyphs(std::string chars);
     
     /*
-     Get the line height of this typeface.
+     Load and cache the glyphs for the given code points on a background thread,
+     then invoke the callback on the rendering thread. The glyphs are written to the
+     atlases in memory; their textures are updated by the next refreshGlyphAtlases.
+     The typeface is only locked while each glyph loads, so the rendering thread can
+     continue to retrieve other glyphs in the meantime.
+     */
+    static void preloadGlyphsAsync(std::shared_ptr<VROTypeface> typeface,
+                                   std::vector<uint32_t> codePoints,
+                                   uint32_t outlineWidth, VROGlyphRenderMode renderMode,
+                                   std::function<void()> callback);
+    
+    /*
+     Get the line height of this typeface. This is read when the face is loaded, so
+     that it remains valid while glyphs load on other threads.
      */
-    virtual float getLineHeight() const = 0;
+    float getLineHeight() const {
+        return _lineHeight;
+    }
     
 protected:
     
@@ -139,6 +176,16 @@ protected:
     std::vector<std::shared_ptr<VROGlyphAtlas>> _glyphAtlases;
     std::map<int, std::vector<std::shared_ptr<VROGlyphAtlas>>> _outlineAtlases;
     
+    /*
+     Load the distance field bitmap of the given glyph. Distance fields are
+     rasterized at kDistanceFieldGlyphSize, once per face, and the glyph's bitmap
+     is scaled to this typeface's size. The given face is returned to this
+     typeface's size afterward.
+     */
+    void loadDistanceFieldGlyph(std::shared_ptr<VROGlyph> glyph, FT_FaceRec_ *face,
+                                uint32_t charCode, uint32_t variantSelector,
+                                std::shared_ptr<VRODriver> driver);
+    
     // TODO VIRO-3239 Move these to VROFont. VROTypeface is essentially a "font family"
     int _size;
     VROFontStyle _style;
@@ -152,10 +199,29 @@ protected:
     
 private:
     
+    float _lineHeight;
     VROSparseBitSet _coverage;
     std::vector<std::unique_ptr<VROSparseBitSet>> _variationCoverage;
     std::map<std::string, std::shared_ptr<VROGlyph>> _bitmapGlyphCache, _vectorGlyphCache;
     
+    /*
+     Guards the face, the glyph caches, and the glyph atlases, which are written
+     by preloadGlyphsAsync on a background thread.
+     */
+    std::mutex _glyphMutex;
+    
+    /*
+     Return the cached glyph for the given key and render mode, or null if it
+     has not been loaded. The glyph mutex must be held.
+     */
+    std::shared_ptr<VROGlyph> findCachedGlyph(const std::string &key, VROGlyphRenderMode renderMode);
+    
+    /*
+     Distance field glyphs and atlases of this typeface's face, shared with the
+     typefaces of the same face at other sizes. Created on first use.
+     */
+    std::shared_ptr<VRODistanceFieldGlyphs> _distanceFieldGlyphs;
+    
     /*
      Compute the charmap coverage of this typeface.
      */
@@ -27,6 +27,8 @@
 #include "VROTypefaceCollection.h"
 #include "VROTypeface.h"
 #include "VROFontUtil.h"
+#include "VROSparseBitSet.h"
+#include <algorithm>
 
 VROTypefaceCollection::VROTypefaceCollection(std::shared_ptr<VROTypeface> typeface) {
     _typefaces = { typeface };
@@ -64,6 +66,71 @@ uint32_t VROTypefaceCollection::computeCoverageScore(std::shared_ptr<VROTypeface
     }
 }
 
+int VROTypefaceCollection::findBestTypeface(uint32_t codePoint, uint32_t variationSelector) {
+    uint64_t key = ((uint64_t) codePoint << 32) | variationSelector;
+    auto it = _bestTypefaces.find(key);
+    if (it != _bestTypefaces.end()) {
+        return it->second;
+    }
+    
+    int bestTypeface = -1;
+    uint32_t bestTypefaceScore = 0;
+    for (int i = 0; i < _typefaces.size(); i++) {
+        uint32_t score = computeCoverageScore(_typefaces[i], codePoint, variationSelector);
+        if (score > bestTypefaceScore) {
+            bestTypeface = i;
+            bestTypefaceScore = score;
+        }
+    }
+    _bestTypefaces[key] = bestTypeface;
+    return bestTypeface;
+}
+
+const VROTypefaceCollection::VROTypefacePage &VROTypefaceCollection::getPage(uint32_t codePoint) {
+    static_assert(VROSparseBitSet::kPageValues == 256, "Typeface pages must match coverage pages");
+    uint32_t pageIndex = codePoint >> 8;
+    if (pageIndex >= _pages.size()) {
+        _pages.resize(pageIndex + 1);
+    }
+    std::unique_ptr<VROTypefacePage> &page = _pages[pageIndex];
+    if (page) {
+        return *page;
+    }
+    
+    // The best typeface is the first that covers each code point: each typeface
+    // claims every code point it covers that no earlier typeface has
+    page.reset(new VROTypefacePage());
+    std::fill(std::begin(page->bestTypefaces), std::end(page->bestTypefaces), -1);
+    uint32_t unclaimed[VROSparseBitSet::kPageElements];
+    std::fill(std::begin(unclaimed), std::end(unclaimed), ~0u);
+    
+    uint32_t bits[VROSparseBitSet::kPageElements];
+    for (int i = 0; i < _typefaces.size(); i++) {
+        if (!_typefaces[i]->getCoverage().getPage(pageIndex, bits)) {
+            continue;
+        }
+        for (int e = 0; e < VROSparseBitSet::kPageElements; e++) {
+            uint32_t claimed = bits[e] & unclaimed[e];
+            unclaimed[e] &= ~claimed;
+            while (claimed != 0) {
+                // Value 0 of each element is its most significant bit
+                int bit = __builtin_clz(claimed);
+                page->bestTypefaces[e * 32 + bit] = i;
+                claimed &= ~(0x80000000u >> bit);
+            }
+        }
+    }
+    
+    for (int c = 0; c < 256; c++) {
+        uint32_t codePointInPage = (pageIndex << 8) | c;
+        if (VROFontUtil::charDoesNotNeedFontSupport(codePointInPage) ||
+            VROFontUtil::charIsStickyWhitelisted(codePointInPage)) {
+            page->slowPath[c >> 5] |= 0x80000000u >> (c & 31);
+        }
+    }
+    return *page;
+}
+
 std::vector<VROFontRun> VROTypefaceCollection::computeRuns(std::wstring text) {
     std::vector<VROFontRun> runs;
     
@@ -90,6 +157,9 @@ std::vector<VROFontRun> VROTypefaceCollection::computeRuns(std::wstring text) {
     //    are supported by Viro.
     //
     // TODO VIRO-3240 Support surrogate pairs
+    //
+    // Most characters are neither of these nor need the rules below, and their best
+    // typeface is read straight from the page table.
     std::shared_ptr<VROTypeface> lastTypeface = nullptr;
     int start = 0;
     
@@ -102,41 +172,40 @@ std::vector<VROFontRun> VROTypefaceCollection::computeRuns(std::wstring text) {
         if (n != text.end()) {
             nextCodePoint = *n;
         }
+        bool isVariation = VROFontUtil::isVariationSelector(nextCodePoint);
         
         bool shouldContinueRun = false;
-        if (VROFontUtil::charDoesNotNeedFontSupport(codePoint)) {
-            // Always continue if the code point is a format character not needed to be in the font
-            shouldContinueRun = true;
-        }
-        else if (lastTypeface != nullptr && VROFontUtil::charIsStickyWhitelisted(codePoint)) {
-            // Continue using existing font as long as it has coverage and is whitelisted
-            shouldContinueRun = lastTypeface->hasCharacter(codePoint, 0);
+        int bestTypefaceIndex = -1;
+        const VROTypefacePage *page = nullptr;
+        if (!isVariation && codePoint <= MAX_UNICODE_CODE_POINT) {
+            page = &getPage(codePoint);
         }
         
-        // If the last typeface does not have the code point (or if the last typeface was null)
-        // then find the best typeface
-        if (!shouldContinueRun) {
-            std::shared_ptr<VROTypeface> bestTypeface;
-            int bestTypefaceScore = 0;
+        if (page && (page->slowPath[(codePoint & 0xFF) >> 5] & (0x80000000u >> (codePoint & 31))) == 0) {
+            bestTypefaceIndex = page->bestTypefaces[codePoint & 0xFF];
+        }
+        else {
+            if (VROFontUtil::charDoesNotNeedFontSupport(codePoint)) {
+                // Always continue if the code point is a format character not needed to be in the font
+                shouldContinueRun = true;
+            }
+            else if (lastTypeface != nullptr && VROFontUtil::charIsStickyWhitelisted(codePoint)) {
+                // Continue using existing font as long as it has coverage and is whitelisted
+                shouldContinueRun = lastTypeface->hasCharacter(codePoint, 0);
+            }
             
-            for (std::shared_ptr<VROTypeface> &typeface : _typefaces) {
-                bool isVariation = VROFontUtil::isVariationSelector(nextCodePoint);
-                
-                int score = 0;
-                if (isVariation) {
-                    score = computeCoverageScore(typeface, codePoint, nextCodePoint);
-                } else {
-                    score = computeCoverageScore(typeface, codePoint, 0);
-                }
-                
-                if (score > bestTypefaceScore) {
-                    bestTypeface = typeface;
-                    bestTypefaceScore = score;
-                }
+            // If the last typeface does not have the code point (or if the last typeface was null)
+            // then find the best typeface
+            if (!shouldContinueRun) {
+                bestTypefaceIndex = findBestTypeface(codePoint, isVariation ? nextCodePoint : 0);
             }
+        }
+        
+        if (!shouldContinueRun) {
+            VROTypeface *bestTypeface = bestTypefaceIndex >= 0 ? _typefaces[bestTypefaceIndex].get() : nullptr;
             
             // The best typeface to use has changed
-            if (position == 0 || bestTypeface.get() != lastTypeface.get()) {
+            if (position == 0 || bestTypeface != lastTypeface.get()) {
                 // Close out the last run and start a new range for the new typeface
                 if (lastTypeface != nullptr) {
                     runs.push_back({ start, position, lastTypeface });
@@ -149,7 +218,7 @@ std::vector<VROFontRun> VROTypefaceCollection::computeRuns(std::wstring text) {
                     // start to be 0 to include those characters)
                     start = 0;
                 }
-                lastTypeface = bestTypeface;
+                lastTypeface = bestTypefaceIndex >= 0 ? _typefaces[bestTypefaceIndex] : nullptr;
             }
         }
         ++position;
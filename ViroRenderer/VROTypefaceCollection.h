@@ -30,6 +30,7 @@
 #include <stdio.h>
 #include <memory>
 #include <vector>
+#include <unordered_map>
 
 class VROTypeface;
 
@@ -84,6 +85,38 @@ private:
      */
     std::vector<std::shared_ptr<VROTypeface>> _typefaces;
     
+    /*
+     The index of the best typeface for each code point and variation selector
+     pair seen so far, or -1 if no typeface covers it. Coverage never changes, so
+     once a character is cached, choosing its typeface is a table lookup.
+     */
+    std::unordered_map<uint64_t, int> _bestTypefaces;
+    
+    /*
+     The best typeface of each code point without variation, in pages of the
+     code points sharing all but their low 8 bits. Pages are filled when first
+     used, 32 code points at a time from the typefaces' coverage pages. Code
+     points with the slowPath bit set (those that need no font support or may
+     continue a run) are chosen by the full rules in computeRuns instead.
+     */
+    struct VROTypefacePage {
+        int16_t bestTypefaces[256];
+        uint32_t slowPath[8];
+    };
+    std::vector<std::unique_ptr<VROTypefacePage>> _pages;
+    
+    /*
+     Return the page holding the given code point, which must be a valid
+     Unicode code point.
+     */
+    const VROTypefacePage &getPage(uint32_t codePoint);
+    
+    /*
+     Return the index of the typeface best suited to the given code point and
+     variation selector, or -1 if no typeface supports it.
+     */
+    int findBestTypeface(uint32_t codePoint, uint32_t variationSelector);
+    
     /*
      Compute the coverage 'score' the typeface earns for the provided glyph.
      The typeface with the highest score will render the glyph.
@@ -35,6 +35,7 @@
 #include "VROMatrix4f.h"
 #include "VROLog.h"
 #include "VROOpenGL.h"
+#include "VROProfiler.h"
 
 static const float kInitialValue = -9999;
 
@@ -99,7 +100,7 @@ public:
         //sublcass to reset any cached value
     }
     
-    void setVec3(VROVector3f value) {
+    void setVec3(const VROVector3f &value) {
         if (_location == -1) {
             return;
         }
@@ -115,7 +116,7 @@ public:
         set(array);
     }
     
-    void setMat4(VROMatrix4f value) {
+    void setMat4(const VROMatrix4f &value) {
         if (_location == -1) {
             return;
         }
@@ -401,6 +402,9 @@ public:
             GL( glUniformMatrix4fv(_location, 1, GL_FALSE, (GLfloat *) value) );
             memcpy(_curValue, value, sizeof(GLfloat) * 16);
         }
+        else {
+            VRO_PROFILE_COUNT(StateChangesAvoided, 1);
+        }
     }
     
 private:
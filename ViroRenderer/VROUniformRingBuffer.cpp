@@ -0,0 +1,222 @@
+//
+//  VROUniformRingBuffer.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROUniformRingBuffer.h"
+#include "VROShaderProgram.h"
+#include "VRODriverOpenGL.h"
+#include "VROMatrix4f.h"
+#include "VROVector3f.h"
+#include "VROProfiler.h"
+#include "VROLog.h"
+
+// Initial size of each frame's region; enough for ~2000 draws at 128-byte alignment
+static const GLsizeiptr kInitialRegionSize = 256 * 1024;
+
+// Maximum number of distinct camera blocks remembered per frame
+static const size_t kMaxCameraEntries = 16;
+
+// Maximum time to wait for the GPU to release a region, in nanoseconds
+static const GLuint64 kFenceTimeoutNs = 100 * 1000 * 1000;
+
+VROUniformRingBuffer::VROUniformRingBuffer(PFNGLBUFFERSTORAGEEXTPROC bufferStorage,
+                                           std::shared_ptr<VRODriverOpenGL> driver) :
+    _bufferStorage(bufferStorage),
+    _driver(driver),
+    _buffer(0),
+    _mapping(nullptr),
+    _regionSize(0),
+    _alignment(256),
+    _region(0),
+    _head(0),
+    _lastDrawOffset(-1),
+    _boundCameraOffset(-1),
+    _boundDrawOffset(-1) {
+    
+    for (int i = 0; i < kUniformRingFramesInFlight; i++) {
+        _fences[i] = nullptr;
+    }
+    GL( glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &_alignment) );
+    allocate(kInitialRegionSize);
+}
+
+VROUniformRingBuffer::~VROUniformRingBuffer() {
+    for (int i = 0; i < kUniformRingFramesInFlight; i++) {
+        if (_fences[i]) {
+            GL( glDeleteSync(_fences[i]) );
+        }
+    }
+    std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
+    if (driver && _buffer != 0) {
+        driver->deleteBuffer(_buffer);
+    }
+}
+
+void VROUniformRingBuffer::allocate(GLsizeiptr regionSize) {
+    /*
+     In-flight draws keep the old buffer alive until the GPU is done with it, so
+     it can be released immediately. The regions of the new buffer have never
+     been read by the GPU, so the old fences no longer apply.
+     */
+    std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
+    if (driver && _buffer != 0) {
+        driver->deleteBuffer(_buffer);
+    }
+    for (int i = 0; i < kUniformRingFramesInFlight; i++) {
+        if (_fences[i]) {
+            GL( glDeleteSync(_fences[i]) );
+            _fences[i] = nullptr;
+        }
+    }
+    
+    _regionSize = regionSize;
+    GLsizeiptr size = _regionSize * kUniformRingFramesInFlight;
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT_EXT | GL_MAP_COHERENT_BIT_EXT;
+    
+    GL( glGenBuffers(1, &_buffer) );
+    GL( glBindBuffer(GL_UNIFORM_BUFFER, _buffer) );
+    GL( _bufferStorage(GL_UNIFORM_BUFFER, size, nullptr, flags) );
+    _mapping = (char *) GL( glMapBufferRange(GL_UNIFORM_BUFFER, 0, size, flags) );
+    GL( glBindBuffer(GL_UNIFORM_BUFFER, 0) );
+    
+    if (!_mapping) {
+        pwarn("Failed to map uniform ring buffer of size %d", (int) size);
+    }
+    
+    _head = 0;
+    _cameras.clear();
+    _lastDrawOffset = -1;
+    _boundCameraOffset = -1;
+    _boundDrawOffset = -1;
+}
+
+void VROUniformRingBuffer::beginFrame(int frame) {
+    _region = frame % kUniformRingFramesInFlight;
+    
+    GLsync fence = _fences[_region];
+    if (fence) {
+        GLenum result = GL( glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, kFenceTimeoutNs) );
+        if (result == GL_TIMEOUT_EXPIRED) {
+            pwarn("Timed out waiting for the GPU to release uniform ring region %d", _region);
+        }
+        GL( glDeleteSync(fence) );
+        _fences[_region] = nullptr;
+    }
+    
+    _head = 0;
+    _cameras.clear();
+    _lastDrawOffset = -1;
+    _boundCameraOffset = -1;
+    _boundDrawOffset = -1;
+}
+
+void VROUniformRingBuffer::endFrame() {
+    if (_fences[_region]) {
+        GL( glDeleteSync(_fences[_region]) );
+    }
+    _fences[_region] = GL( glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) );
+}
+
+void *VROUniformRingBuffer::reserve(GLsizeiptr size, GLintptr *outOffset) {
+    GLintptr start = ((_head + _alignment - 1) / _alignment) * _alignment;
+    if (start + size > _regionSize) {
+        pinfo("Uniform ring region full, growing to %d KB", (int) (_regionSize * 2 / 1024));
+        allocate(_regionSize * 2);
+        start = 0;
+    }
+    if (!_mapping) {
+        return nullptr;
+    }
+    
+    _head = start + size;
+    *outOffset = _region * _regionSize + start;
+    return _mapping + *outOffset;
+}
+
+void VROUniformRingBuffer::bindCameraData(const VROMatrix4f &viewMatrix, const VROMatrix4f &projectionMatrix,
+                                          const VROVector3f &cameraPosition) {
+    VROCameraUBOData data;
+    memcpy(data.view_matrix, viewMatrix.getArray(), sizeof(data.view_matrix));
+    memcpy(data.projection_matrix, projectionMatrix.getArray(), sizeof(data.projection_matrix));
+    data.camera_position[0] = cameraPosition.x;
+    data.camera_position[1] = cameraPosition.y;
+    data.camera_position[2] = cameraPosition.z;
+    data.camera_position[3] = 0;
+    
+    // Reuse the block if this view was already written this frame
+    GLintptr offset = -1;
+    for (auto it = _cameras.rbegin(); it != _cameras.rend(); ++it) {
+        if (memcmp(&it->data, &data, sizeof(VROCameraUBOData)) == 0) {
+            offset = it->offset;
+            break;
+        }
+    }
+    if (offset < 0) {
+        void *dest = reserve(sizeof(VROCameraUBOData), &offset);
+        if (!dest) {
+            return;
+        }
+        memcpy(dest, &data, sizeof(VROCameraUBOData));
+        
+        if (_cameras.size() >= kMaxCameraEntries) {
+            _cameras.erase(_cameras.begin());
+        }
+        _cameras.push_back({ data, offset });
+    }
+    
+    if (offset == _boundCameraOffset) {
+        VRO_PROFILE_COUNT(StateChangesAvoided, 1);
+        return;
+    }
+    GL( glBindBufferRange(GL_UNIFORM_BUFFER, VROShaderProgram::sCameraUBOBindingPoint, _buffer,
+                          offset, sizeof(VROCameraUBOData)) );
+    _boundCameraOffset = offset;
+}
+
+void VROUniformRingBuffer::bindDrawData(const VROMatrix4f &modelMatrix, const VROMatrix4f &normalMatrix) {
+    // Consecutive draws of the same node (e.g. its other elements, or other
+    // passes) share the previous draw's data
+    if (_lastDrawOffset < 0 ||
+        memcmp(_lastDraw.model_matrix, modelMatrix.getArray(), sizeof(_lastDraw.model_matrix)) != 0 ||
+        memcmp(_lastDraw.normal_matrix, normalMatrix.getArray(), sizeof(_lastDraw.normal_matrix)) != 0) {
+        
+        GLintptr offset;
+        VRODrawUBOData *dest = (VRODrawUBOData *) reserve(sizeof(VRODrawUBOData), &offset);
+        if (!dest) {
+            return;
+        }
+        memcpy(_lastDraw.model_matrix, modelMatrix.getArray(), sizeof(_lastDraw.model_matrix));
+        memcpy(_lastDraw.normal_matrix, normalMatrix.getArray(), sizeof(_lastDraw.normal_matrix));
+        memcpy(dest, &_lastDraw, sizeof(VRODrawUBOData));
+        _lastDrawOffset = offset;
+    }
+    
+    if (_lastDrawOffset == _boundDrawOffset) {
+        VRO_PROFILE_COUNT(StateChangesAvoided, 1);
+        return;
+    }
+    GL( glBindBufferRange(GL_UNIFORM_BUFFER, VROShaderProgram::sDrawUBOBindingPoint, _buffer,
+                          _lastDrawOffset, sizeof(VRODrawUBOData)) );
+    _boundDrawOffset = _lastDrawOffset;
+}
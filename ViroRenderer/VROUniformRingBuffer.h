@@ -0,0 +1,168 @@
+//
+//  VROUniformRingBuffer.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROUniformRingBuffer_h
+#define VROUniformRingBuffer_h
+
+#include "VROOpenGL.h"
+#include <vector>
+#include <memory>
+
+class VRODriverOpenGL;
+class VROMatrix4f;
+class VROVector3f;
+
+/*
+ Number of frames whose uniform data may be in flight at once. Each frame
+ writes to its own region of the ring.
+ */
+static const int kUniformRingFramesInFlight = 3;
+
+// Grouped in 4N slots, matching the camera_data block injected by
+// VROShaderProgram::enableUniformRing
+typedef struct {
+    float view_matrix[16];
+    float projection_matrix[16];
+    float camera_position[4];
+} VROCameraUBOData;
+
+// Grouped in 4N slots, matching the draw_data block injected by
+// VROShaderProgram::enableUniformRing
+typedef struct {
+    float model_matrix[16];
+    float normal_matrix[16];
+} VRODrawUBOData;
+
+/*
+ VROUniformRingBuffer streams per-draw and per-view uniform data through a single
+ uniform buffer, persistently mapped via EXT_buffer_storage. Instead of setting
+ the model, normal, view and projection matrices of every draw with glUniform*,
+ each draw writes its data into the next free slice of the ring, and binds that
+ slice with glBindBufferRange.
+ 
+ The buffer is split into kUniformRingFramesInFlight regions, one per frame,
+ in the same way VROConcurrentBuffer triple-buffers on Metal. A fence guards
+ each region so the CPU never overwrites data the GPU has yet to read. If a
+ frame outgrows its region, the ring is reallocated at twice the size.
+ 
+ Camera data is written once per distinct view (e.g. once per eye, and again for
+ camera enclosures and screen space geometry), and shared by every draw that
+ uses it. Per-draw data is skipped when it matches that of the previous draw.
+ */
+class VROUniformRingBuffer {
+    
+public:
+    
+    /*
+     Create a ring that allocates its buffer with the given glBufferStorageEXT.
+     Persistent mapping is required: without it, each write would cost as much
+     as the uniform calls it replaces.
+     */
+    VROUniformRingBuffer(PFNGLBUFFERSTORAGEEXTPROC bufferStorage,
+                         std::shared_ptr<VRODriverOpenGL> driver);
+    virtual ~VROUniformRingBuffer();
+    
+    /*
+     Begin writing the given frame, waiting if the GPU is still reading the
+     region it will write to.
+     */
+    void beginFrame(int frame);
+    
+    /*
+     Fence the current frame's region.
+     */
+    void endFrame();
+    
+    /*
+     Write (or reuse) the camera data for the given view and bind it to
+     VROShaderProgram::sCameraUBOBindingPoint.
+     */
+    void bindCameraData(const VROMatrix4f &viewMatrix, const VROMatrix4f &projectionMatrix,
+                        const VROVector3f &cameraPosition);
+    
+    /*
+     Write the draw data for the next draw and bind it to
+     VROShaderProgram::sDrawUBOBindingPoint.
+     */
+    void bindDrawData(const VROMatrix4f &modelMatrix, const VROMatrix4f &normalMatrix);
+    
+private:
+    
+    /*
+     A camera block written this frame, and its offset into the buffer.
+     */
+    struct VROCameraEntry {
+        VROCameraUBOData data;
+        GLintptr offset;
+    };
+    
+    PFNGLBUFFERSTORAGEEXTPROC _bufferStorage;
+    std::weak_ptr<VRODriverOpenGL> _driver;
+    
+    /*
+     The buffer, its persistent mapping, and the size of each frame's region.
+     */
+    GLuint _buffer;
+    char *_mapping;
+    GLsizeiptr _regionSize;
+    
+    /*
+     Offsets are aligned to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT.
+     */
+    GLint _alignment;
+    
+    /*
+     The region being written, the write head within it, and the fence of each
+     region's last frame.
+     */
+    int _region;
+    GLintptr _head;
+    GLsync _fences[kUniformRingFramesInFlight];
+    
+    /*
+     Camera blocks written this frame, most recent last. Few distinct views are
+     rendered per frame, so these are searched linearly.
+     */
+    std::vector<VROCameraEntry> _cameras;
+    
+    /*
+     The last draw data written, and the ranges bound to each binding point.
+     */
+    VRODrawUBOData _lastDraw;
+    GLintptr _lastDrawOffset;
+    GLintptr _boundCameraOffset;
+    GLintptr _boundDrawOffset;
+    
+    void allocate(GLsizeiptr regionSize);
+    
+    /*
+     Reserve size bytes in the current region, returning a pointer to write to
+     and the offset of the reservation. Grows the ring if the region is full.
+     */
+    void *reserve(GLsizeiptr size, GLintptr *outOffset);
+    
+};
+
+#endif /* VROUniformRingBuffer_h */
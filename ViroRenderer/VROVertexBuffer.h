@@ -34,7 +34,8 @@ class VROVertexBuffer {
 public:
     
     VROVertexBuffer(std::shared_ptr<VROData> data) :
-        _data(data) {}
+        _data(data),
+        _releasesDataOnHydrate(false) {}
     virtual ~VROVertexBuffer() {}
     
     /*
@@ -43,13 +44,24 @@ public:
     virtual void hydrate() = 0;
     
     /*
-     Get the data (on the CPU) underlying this vertex buffer.
+     Get the data (on the CPU) underlying this vertex buffer. Returns nullptr once
+     the data has been released (see setReleasesDataOnHydrate).
      */
     std::shared_ptr<VROData> getData() const { return _data; }
+
+    /*
+     If true, the CPU data is released once it has been uploaded to the GPU, so
+     that (for example) the mapped file or model buffer it slices can be freed.
+     Only for buffers that are never read back on the CPU.
+     */
+    void setReleasesDataOnHydrate(bool releases) {
+        _releasesDataOnHydrate = releases;
+    }
     
 protected:
     
     std::shared_ptr<VROData> _data;
+    bool _releasesDataOnHydrate;
     
 };
 
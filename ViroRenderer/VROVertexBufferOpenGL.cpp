@@ -32,6 +32,7 @@ VROVertexBufferOpenGL::VROVertexBufferOpenGL(std::shared_ptr<VROData> data,
                                              std::shared_ptr<VRODriverOpenGL> driver) :
     VROVertexBuffer(data),
     _buffer(0),
+    _bufferLength(0),
     _driver(driver) {
     
 }
@@ -47,17 +48,24 @@ VROVertexBufferOpenGL::~VROVertexBufferOpenGL() {
         // Even if the driver was released we subtract the VBO, because a released
         // driver implies the entire GL context (including all VBOs) were released.
         ALLOCATION_TRACKER_SUB(VBO, 1);
+        ALLOCATION_TRACKER_SUB(VertexBufferMemory, _bufferLength);
     }
 }
 
 void VROVertexBufferOpenGL::hydrate() {
-    if (_buffer != 0) {
+    if (_buffer != 0 || !_data) {
         return;
     }
     
+    _bufferLength = _data->getDataLength();
     GL( glGenBuffers(1, &_buffer) );
     GL( glBindBuffer(GL_ARRAY_BUFFER, _buffer) );
-    GL( glBufferData(GL_ARRAY_BUFFER, _data->getDataLength(), _data->getData(), GL_STATIC_DRAW) );
+    GL( glBufferData(GL_ARRAY_BUFFER, _bufferLength, _data->getData(), GL_STATIC_DRAW) );
     
     ALLOCATION_TRACKER_ADD(VBO, 1);
+    ALLOCATION_TRACKER_ADD(VertexBufferMemory, _bufferLength);
+
+    if (_releasesDataOnHydrate) {
+        _data.reset();
+    }
 }
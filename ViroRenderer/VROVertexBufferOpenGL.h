@@ -46,6 +46,7 @@ public:
 private:
     
     GLuint _buffer;
+    int _bufferLength;
     std::weak_ptr<VRODriverOpenGL> _driver;
     
 };
@@ -72,6 +72,8 @@ public:
     virtual void pause() = 0;
     virtual void play() = 0;
     virtual bool isPaused() = 0;
+    virtual bool isAnimating() { return !isPaused(); }
+    virtual const char *getFrameListenerName() const { return "videoTexture"; }
 
     virtual void seekToTime(float seconds) = 0;
     virtual float getCurrentTimeInSeconds() = 0;
@@ -0,0 +1,23 @@
+// Samples the bone-animation textures baked by VROBakedSkeletalAnimation. Each row is a
+// frame, and each bone occupies three texels of it, holding the first three rows of the
+// bone's model transform. Keep in sync with VROBakedSkeletalAnimation.h.
+highp mat3x4 get_baked_bone_rows(int bone_index, int frame) {
+    return mat3x4(texelFetch(baked_bone_texture, ivec2(bone_index * 3 + 0, frame), 0),
+                  texelFetch(baked_bone_texture, ivec2(bone_index * 3 + 1, frame), 0),
+                  texelFetch(baked_bone_texture, ivec2(bone_index * 3 + 2, frame), 0));
+}
+
+// Interpolates the bone's transform between the frames around the given frame position
+highp mat3x4 get_baked_bone_rows_at(int bone_index, highp float frame) {
+    int frame0 = int(frame);
+    highp float t = frame - float(frame0);
+    return get_baked_bone_rows(bone_index, frame0) * (1.0 - t) +
+           get_baked_bone_rows(bone_index, frame0 + 1) * t;
+}
+
+highp mat3x4 get_baked_blended_bone_rows(ivec4 bone_indices, vec4 bone_weights, highp float frame) {
+    return get_baked_bone_rows_at(bone_indices.x, frame) * bone_weights.x +
+           get_baked_bone_rows_at(bone_indices.y, frame) * bone_weights.y +
+           get_baked_bone_rows_at(bone_indices.z, frame) * bone_weights.z +
+           get_baked_bone_rows_at(bone_indices.w, frame) * bone_weights.w;
+}
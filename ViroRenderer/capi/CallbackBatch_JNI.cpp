@@ -0,0 +1,150 @@
+//
+//  CallbackBatch_JNI.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "CallbackBatch_JNI.h"
+#include "VROPlatformUtil.h"
+#include <cstring>
+
+std::mutex CallbackBatch_JNI::sMutex;
+CallbackBatch_JNI::Batch CallbackBatch_JNI::sQueued;
+CallbackBatch_JNI::Batch CallbackBatch_JNI::sDelivering;
+
+void CallbackBatch_JNI::enqueue(const void *delegateKey, VRO_OBJECT javaObject, const CallbackRecord &record,
+                                bool coalesce) {
+    std::lock_guard<std::mutex> lock(sMutex);
+    bool dispatch = sQueued.records.empty();
+
+    auto it = sQueued.delegates.find(delegateKey);
+    if (it == sQueued.delegates.end()) {
+        VRO_ENV env = VROPlatformGetJNIEnv();
+        sQueued.objects.push_back(VRO_NEW_WEAK_GLOBAL_REF(javaObject));
+        it = sQueued.delegates.insert({ delegateKey, { (int) sQueued.objects.size() - 1, -1 } }).first;
+    } else if (coalesce && it->second.second >= 0) {
+        CallbackRecord &previous = sQueued.records[it->second.second];
+        if (previous.type == record.type && memcmp(previous.ints, record.ints, sizeof(record.ints)) == 0) {
+            memcpy(previous.floats, record.floats, sizeof(record.floats));
+            return;
+        }
+    }
+
+    sQueued.records.push_back(record);
+    sQueued.records.back().object = it->second.first;
+    it->second.second = (int) sQueued.records.size() - 1;
+
+    if (dispatch) {
+        VROPlatformDispatchAsyncApplication([] {
+            deliverQueued();
+        });
+    }
+}
+
+void CallbackBatch_JNI::deliverQueued() {
+    // Delivery runs only on the application thread, so sDelivering is never
+    // swapped while in use; new callbacks queue into the next batch meanwhile
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        std::swap(sQueued.records, sDelivering.records);
+        std::swap(sQueued.objects, sDelivering.objects);
+        sQueued.delegates.clear();
+    }
+
+    VRO_ENV env = VROPlatformGetJNIEnv();
+    for (const CallbackRecord &record : sDelivering.records) {
+        VRO_OBJECT localObj = VRO_NEW_LOCAL_REF(sDelivering.objects[record.object]);
+        if (VRO_IS_OBJECT_NULL(localObj)) {
+            continue;
+        }
+        deliver(env, localObj, record);
+        VRO_DELETE_LOCAL_REF(localObj);
+    }
+
+    for (VRO_WEAK &weakObj : sDelivering.objects) {
+        VRO_DELETE_WEAK_GLOBAL_REF(weakObj);
+    }
+    sDelivering.records.clear();
+    sDelivering.objects.clear();
+}
+
+static VRO_FLOAT_ARRAY CallbackBatch_newPositionArray(VRO_ENV env, const CallbackRecord &record) {
+    // ints[3] is set if the callback carries a position in floats[0..2]
+    if (!record.ints[3]) {
+        return nullptr;
+    }
+    VRO_FLOAT_ARRAY positionArray = VRO_NEW_FLOAT_ARRAY(3);
+    VRO_FLOAT_ARRAY_SET(positionArray, 0, 3, record.floats);
+    return positionArray;
+}
+
+void CallbackBatch_JNI::deliver(VRO_ENV env, VRO_OBJECT object, const CallbackRecord &record) {
+    const int *i = record.ints;
+    const float *f = record.floats;
+
+    switch (record.type) {
+        case CallbackType::PositionUpdate:
+            VROPlatformCallHostFunction(object, "onPositionUpdate", "(FFF)V", f[0], f[1], f[2]);
+            break;
+        case CallbackType::Hover: {
+            VRO_FLOAT_ARRAY positionArray = CallbackBatch_newPositionArray(env, record);
+            VROPlatformCallHostFunction(object, "onHover", "(IIZ[F)V", i[0], i[1], (VRO_BOOL) i[2], positionArray);
+            VRO_DELETE_LOCAL_REF(positionArray);
+            break;
+        }
+        case CallbackType::Click: {
+            VRO_FLOAT_ARRAY positionArray = CallbackBatch_newPositionArray(env, record);
+            VROPlatformCallHostFunction(object, "onClick", "(III[F)V", i[0], i[1], i[2], positionArray);
+            VRO_DELETE_LOCAL_REF(positionArray);
+            break;
+        }
+        case CallbackType::Touch:
+            VROPlatformCallHostFunction(object, "onTouch", "(IIIFF)V", i[0], i[1], i[2], f[0], f[1]);
+            break;
+        case CallbackType::ControllerStatus:
+            VROPlatformCallHostFunction(object, "onControllerStatus", "(II)V", i[0], i[2]);
+            break;
+        case CallbackType::Swipe:
+            VROPlatformCallHostFunction(object, "onSwipe", "(III)V", i[0], i[1], i[2]);
+            break;
+        case CallbackType::Scroll:
+            VROPlatformCallHostFunction(object, "onScroll", "(IIFF)V", i[0], i[1], f[0], f[1]);
+            break;
+        case CallbackType::Drag:
+            VROPlatformCallHostFunction(object, "onDrag", "(IIFFF)V", i[0], i[1], f[0], f[1], f[2]);
+            break;
+        case CallbackType::Fuse:
+            VROPlatformCallHostFunction(object, "onFuse", "(II)V", i[0], i[1]);
+            break;
+        case CallbackType::Pinch:
+            VROPlatformCallHostFunction(object, "onPinch", "(IIFI)V", i[0], i[1], f[0], i[2]);
+            break;
+        case CallbackType::Rotate:
+            VROPlatformCallHostFunction(object, "onRotate", "(IIFI)V", i[0], i[1], f[0], i[2]);
+            break;
+        case CallbackType::CameraTransformUpdate:
+            VROPlatformCallHostFunction(object, "onCameraTransformUpdate", "(FFFFFFFFFFFF)V",
+                                        f[0], f[1], f[2], f[3], f[4], f[5],
+                                        f[6], f[7], f[8], f[9], f[10], f[11]);
+            break;
+    }
+}
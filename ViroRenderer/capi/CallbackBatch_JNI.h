@@ -0,0 +1,111 @@
+//
+//  CallbackBatch_JNI.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef CallbackBatch_JNI_H
+#define CallbackBatch_JNI_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <unordered_map>
+#include "VRODefines.h"
+#include VRO_C_INCLUDE
+
+/*
+ The delegate callbacks that can be batched, one per host method.
+ */
+enum class CallbackType {
+    PositionUpdate,
+    Hover,
+    Click,
+    Touch,
+    ControllerStatus,
+    Swipe,
+    Scroll,
+    Drag,
+    Fuse,
+    Pinch,
+    Rotate,
+    CameraTransformUpdate
+};
+
+/*
+ A single callback with its arguments packed into primitive arrays. The meaning
+ of each argument is defined by the callback type (see CallbackBatch_JNI::deliver).
+ */
+struct CallbackRecord {
+    CallbackType type;
+    int object;
+    int ints[4];
+    float floats[12];
+};
+
+/*
+ CallbackBatch_JNI coalesces the callbacks made by the JNI delegates (transform
+ updates and input events) into a single application thread task per batch, in place
+ of a task and a weak global reference per callback.
+
+ Callbacks queued on the rendering thread are appended to the current batch; the first
+ callback in a batch dispatches the task that delivers it, so a batch holds whatever
+ accumulated before the application thread got to it (typically one frame). Each
+ delegate receives its callbacks in the order they were queued. Continuous callbacks (position updates,
+ drags, pinch and rotate moves, and so on) may be coalesced: if the delegate's previous
+ callback in the batch has the same type and integer arguments, it is replaced by the
+ new one, so during a drag each delegate receives only the latest position per frame.
+ */
+class CallbackBatch_JNI {
+public:
+
+    /*
+     Queue a callback on the given host delegate. The delegate key identifies the
+     native delegate making the callback, and must remain unique for its lifetime.
+     */
+    static void enqueue(const void *delegateKey, VRO_OBJECT javaObject, const CallbackRecord &record,
+                        bool coalesce);
+
+private:
+
+    struct Batch {
+        std::vector<CallbackRecord> records;
+
+        /*
+         A weak global reference to each host delegate in the batch, indexed by
+         CallbackRecord::object, and for each delegate key, the index of its
+         object and of its last record.
+         */
+        std::vector<VRO_WEAK> objects;
+        std::unordered_map<const void *, std::pair<int, int>> delegates;
+    };
+
+    static std::mutex sMutex;
+    static Batch sQueued;
+    static Batch sDelivering;
+
+    static void deliverQueued();
+    static void deliver(VRO_ENV env, VRO_OBJECT object, const CallbackRecord &record);
+
+};
+
+#endif /* CallbackBatch_JNI_H */
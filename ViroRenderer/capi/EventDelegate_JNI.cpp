@@ -24,6 +24,7 @@
 //  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "EventDelegate_JNI.h"
+#include "CallbackBatch_JNI.h"
 #include "Node_JNI.h"
 #include "ViroUtils_JNI.h"
 #include "VROARPointCloud.h"
@@ -93,88 +94,47 @@ VRO_METHOD(void, nativeSetTimeToFuse)(VRO_ARGS
  */
 static int sNullNodeID = -1;
 
-void EventDelegate_JNI::onHover(int source, std::shared_ptr<VRONode> node, bool isHovering, std::vector<float> position) {
-    VRO_ENV env = VROPlatformGetJNIEnv();
-    VRO_WEAK weakObj = VRO_NEW_WEAK_GLOBAL_REF(_javaObject);
+static int EventDelegate_getNodeId(const std::shared_ptr<VRONode> &node) {
+    return node != nullptr ? node->getUniqueID() : sNullNodeID;
+}
 
-    VROPlatformDispatchAsyncApplication([weakObj, source, node, isHovering, position] {
-        VRO_ENV env = VROPlatformGetJNIEnv();
-        VRO_OBJECT localObj = VRO_NEW_LOCAL_REF(weakObj);
-        if (VRO_IS_OBJECT_NULL(localObj)) {
-            return;
-        }
+static CallbackRecord EventDelegate_newRecord(CallbackType type, int source, const std::shared_ptr<VRONode> &node) {
+    CallbackRecord record = {};
+    record.type = type;
+    record.ints[0] = source;
+    record.ints[1] = EventDelegate_getNodeId(node);
+    return record;
+}
 
-        VRO_FLOAT_ARRAY positionArray;
-        if (position.size() == 3) {
-            int returnLength = 3;
-            positionArray = VRO_NEW_FLOAT_ARRAY(returnLength);
-
-            VRO_FLOAT tempArr[returnLength];
-            tempArr[0] = position.at(0);
-            tempArr[1] = position.at(1);
-            tempArr[2] = position.at(2);
-            VRO_FLOAT_ARRAY_SET(positionArray, 0, 3, tempArr);
-        } else {
-            positionArray = nullptr;
-        }
+static void EventDelegate_setPosition(CallbackRecord &record, const std::vector<float> &position) {
+    if (position.size() == 3) {
+        record.ints[3] = 1;
+        record.floats[0] = position[0];
+        record.floats[1] = position[1];
+        record.floats[2] = position[2];
+    }
+}
 
-        int nodeId = node != nullptr ? node->getUniqueID() : sNullNodeID;
-        VROPlatformCallHostFunction(localObj,
-                                    "onHover", "(IIZ[F)V", source, nodeId, isHovering, positionArray);
-        VRO_DELETE_LOCAL_REF(localObj);
-        VRO_DELETE_WEAK_GLOBAL_REF(weakObj);
-    });
+void EventDelegate_JNI::onHover(int source, std::shared_ptr<VRONode> node, bool isHovering, std::vector<float> position) {
+    CallbackRecord record = EventDelegate_newRecord(CallbackType::Hover, source, node);
+    record.ints[2] = isHovering;
+    EventDelegate_setPosition(record, position);
+    CallbackBatch_JNI::enqueue(this, _javaObject, record, false);
 }
 
 void EventDelegate_JNI::onClick(int source, std::shared_ptr<VRONode> node, ClickState clickState, std::vector<float> position) {
-    VRO_ENV env = VROPlatformGetJNIEnv();
-    VRO_WEAK weakObj = VRO_NEW_WEAK_GLOBAL_REF(_javaObject);
-
-    VROPlatformDispatchAsyncApplication([weakObj, source, node, clickState, position] {
-        VRO_ENV env = VROPlatformGetJNIEnv();
-        VRO_OBJECT localObj = VRO_NEW_LOCAL_REF(weakObj);
-        if (VRO_IS_OBJECT_NULL(localObj)) {
-            return;
-        }
-
-        VRO_FLOAT_ARRAY positionArray;
-        if (position.size() == 3) {
-            int returnLength = 3;
-            positionArray = VRO_NEW_FLOAT_ARRAY(returnLength);
-            VRO_FLOAT tempArr[returnLength];
-            tempArr[0] = position.at(0);
-            tempArr[1] = position.at(1);
-            tempArr[2] = position.at(2);
-            VRO_FLOAT_ARRAY_SET(positionArray, 0, 3, tempArr);
-        } else {
-            positionArray = nullptr;
-        }
-
-        int nodeId = node != nullptr ? node->getUniqueID() : sNullNodeID;
-        VROPlatformCallHostFunction(localObj,
-                                    "onClick", "(III[F)V", source, nodeId, clickState, positionArray);
-        VRO_DELETE_LOCAL_REF(localObj);
-        VRO_DELETE_WEAK_GLOBAL_REF(weakObj);
-    });
+    CallbackRecord record = EventDelegate_newRecord(CallbackType::Click, source, node);
+    record.ints[2] = clickState;
+    EventDelegate_setPosition(record, position);
+    CallbackBatch_JNI::enqueue(this, _javaObject, record, false);
 }
 
 void EventDelegate_JNI::onTouch(int source, std::shared_ptr<VRONode> node, TouchState touchState, float x, float y){
-    VRO_ENV env = VROPlatformGetJNIEnv();
-    VRO_WEAK weakObj = VRO_NEW_WEAK_GLOBAL_REF(_javaObject);
-
-    VROPlatformDispatchAsyncApplication([weakObj, source, node, touchState, x, y] {
-        VRO_ENV env = VROPlatformGetJNIEnv();
-        VRO_OBJECT localObj = VRO_NEW_LOCAL_REF(weakObj);
-        if (VRO_IS_OBJECT_NULL(localObj)) {
-            return;
-        }
-
-        int nodeId = node != nullptr ? node->getUniqueID() : sNullNodeID;
-        VROPlatformCallHostFunction(localObj,
-                                    "onTouch", "(IIIFF)V", source, nodeId, touchState, x, y);
-        VRO_DELETE_LOCAL_REF(localObj);
-        VRO_DELETE_WEAK_GLOBAL_REF(weakObj);
-    });
+    CallbackRecord record = EventDelegate_newRecord(CallbackType::Touch, source, node);
+    record.ints[2] = touchState;
+    record.floats[0] = x;
+    record.floats[1] = y;
+    CallbackBatch_JNI::enqueue(this, _javaObject, record, touchState == TouchDownMove);
 }
 
 void EventDelegate_JNI::onMove(int source, std::shared_ptr<VRONode> node, VROVector3f rotation, VROVector3f position, VROVector3f forwardVec) {
@@ -182,21 +142,9 @@ void EventDelegate_JNI::onMove(int source, std::shared_ptr<VRONode> node, VROVec
 }
 
 void EventDelegate_JNI::onControllerStatus(int source, ControllerStatus status) {
-    VRO_ENV env = VROPlatformGetJNIEnv();
-    VRO_WEAK weakObj = VRO_NEW_WEAK_GLOBAL_REF(_javaObject);
-
-    VROPlatformDispatchAsyncApplication([weakObj, source, status] {
-        VRO_ENV env = VROPlatformGetJNIEnv();
-        VRO_OBJECT localObj = VRO_NEW_LOCAL_REF(weakObj);
-        if (VRO_IS_OBJECT_NULL(localObj)) {
-            return;
-        }
-
-        VROPlatformCallHostFunction(localObj,
-                                    "onControllerStatus", "(II)V", source, status);
-        VRO_DELETE_LOCAL_REF(localObj);
-        VRO_DELETE_WEAK_GLOBAL_REF(weakObj);
-    });
+    CallbackRecord record = EventDelegate_newRecord(CallbackType::ControllerStatus, source, nullptr);
+    record.ints[2] = status;
+    CallbackBatch_JNI::enqueue(this, _javaObject, record, false);
 }
 
 void EventDelegate_JNI::onGazeHit(int source, std::shared_ptr<VRONode> node, float distance, VROVector3f hitLocation) {
@@ -204,61 +152,24 @@ void EventDelegate_JNI::onGazeHit(int source, std::shared_ptr<VRONode> node, flo
 }
 
 void EventDelegate_JNI::onSwipe(int source, std::shared_ptr<VRONode> node, SwipeState swipeState) {
-    VRO_ENV env = VROPlatformGetJNIEnv();
-    VRO_WEAK weakObj = VRO_NEW_WEAK_GLOBAL_REF(_javaObject);
-
-    VROPlatformDispatchAsyncApplication([weakObj, source, node, swipeState] {
-        VRO_ENV env = VROPlatformGetJNIEnv();
-        VRO_OBJECT localObj = VRO_NEW_LOCAL_REF(weakObj);
-        if (VRO_IS_OBJECT_NULL(localObj)) {
-            return;
-        }
-
-        int nodeId = node != nullptr ? node->getUniqueID() : sNullNodeID;
-        VROPlatformCallHostFunction(localObj,
-                                    "onSwipe", "(III)V", source, nodeId, swipeState);
-        VRO_DELETE_LOCAL_REF(localObj);
-        VRO_DELETE_WEAK_GLOBAL_REF(weakObj);
-    });
+    CallbackRecord record = EventDelegate_newRecord(CallbackType::Swipe, source, node);
+    record.ints[2] = swipeState;
+    CallbackBatch_JNI::enqueue(this, _javaObject, record, false);
 }
 
 void EventDelegate_JNI::onScroll(int source, std::shared_ptr<VRONode> node, float x, float y) {
-    VRO_ENV env = VROPlatformGetJNIEnv();
-    VRO_WEAK weakObj = VRO_NEW_WEAK_GLOBAL_REF(_javaObject);
-
-    VROPlatformDispatchAsyncApplication([weakObj, source, node, x, y] {
-        VRO_ENV env = VROPlatformGetJNIEnv();
-        VRO_OBJECT localObj = VRO_NEW_LOCAL_REF(weakObj);
-        if (VRO_IS_OBJECT_NULL(localObj)) {
-            return;
-        }
-
-        int nodeId = node != nullptr ? node->getUniqueID() : sNullNodeID;
-        VROPlatformCallHostFunction(localObj,
-                                    "onScroll", "(IIFF)V", source, nodeId, x, y);
-        VRO_DELETE_LOCAL_REF(localObj);
-        VRO_DELETE_WEAK_GLOBAL_REF(weakObj);
-    });
+    CallbackRecord record = EventDelegate_newRecord(CallbackType::Scroll, source, node);
+    record.floats[0] = x;
+    record.floats[1] = y;
+    CallbackBatch_JNI::enqueue(this, _javaObject, record, true);
 }
 
 void EventDelegate_JNI::onDrag(int source, std::shared_ptr<VRONode> node, VROVector3f newPosition) {
-    VRO_ENV env = VROPlatformGetJNIEnv();
-    VRO_WEAK weakObj = VRO_NEW_WEAK_GLOBAL_REF(_javaObject);
-
-    VROPlatformDispatchAsyncApplication([weakObj, source, node, newPosition] {
-        VRO_ENV env = VROPlatformGetJNIEnv();
-        VRO_OBJECT localObj = VRO_NEW_LOCAL_REF(weakObj);
-        if (VRO_IS_OBJECT_NULL(localObj)) {
-            return;
-        }
-
-        int nodeId = node != nullptr ? node->getUniqueID() : sNullNodeID;
-        VROPlatformCallHostFunction(localObj,
-                                    "onDrag", "(IIFFF)V", source, nodeId, newPosition.x, newPosition.y,
-                                    newPosition.z);
-        VRO_DELETE_LOCAL_REF(localObj);
-        VRO_DELETE_WEAK_GLOBAL_REF(weakObj);
-    });
+    CallbackRecord record = EventDelegate_newRecord(CallbackType::Drag, source, node);
+    record.floats[0] = newPosition.x;
+    record.floats[1] = newPosition.y;
+    record.floats[2] = newPosition.z;
+    CallbackBatch_JNI::enqueue(this, _javaObject, record, true);
 }
 
 void EventDelegate_JNI::onFuse(int source, std::shared_ptr<VRONode> node, float timeToFuseRatio){
@@ -271,60 +182,22 @@ void EventDelegate_JNI::onFuse(int source, std::shared_ptr<VRONode> node, float
         return;
     }
 
-    VRO_ENV env = VROPlatformGetJNIEnv();
-    VRO_WEAK weakObj = VRO_NEW_WEAK_GLOBAL_REF(_javaObject);
-
-    VROPlatformDispatchAsyncApplication([weakObj, source, node, timeToFuseRatio] {
-        VRO_ENV env = VROPlatformGetJNIEnv();
-        VRO_OBJECT localObj = VRO_NEW_LOCAL_REF(weakObj);
-        if (VRO_IS_OBJECT_NULL(localObj)) {
-            return;
-        }
-
-        int nodeId = node != nullptr ? node->getUniqueID() : sNullNodeID;
-        VROPlatformCallHostFunction(localObj,
-                                    "onFuse", "(II)V", source, nodeId, timeToFuseRatio);
-        VRO_DELETE_LOCAL_REF(localObj);
-        VRO_DELETE_WEAK_GLOBAL_REF(weakObj);
-    });
+    CallbackRecord record = EventDelegate_newRecord(CallbackType::Fuse, source, node);
+    CallbackBatch_JNI::enqueue(this, _javaObject, record, false);
 }
 
 void EventDelegate_JNI::onPinch(int source, std::shared_ptr<VRONode> node, float scaleFactor, PinchState pinchState) {
-    VRO_ENV env = VROPlatformGetJNIEnv();
-    VRO_WEAK weakObj = VRO_NEW_WEAK_GLOBAL_REF(_javaObject);
-
-    VROPlatformDispatchAsyncApplication([weakObj, source, node, scaleFactor, pinchState] {
-        VRO_ENV env = VROPlatformGetJNIEnv();
-        VRO_OBJECT localObj = VRO_NEW_LOCAL_REF(weakObj);
-        if (VRO_IS_OBJECT_NULL(localObj)) {
-            return;
-        }
-
-        int nodeId = node != nullptr ? node->getUniqueID() : sNullNodeID;
-        VROPlatformCallHostFunction(localObj,
-                                    "onPinch", "(IIFI)V", source, nodeId, scaleFactor, pinchState);
-        VRO_DELETE_LOCAL_REF(localObj);
-        VRO_DELETE_WEAK_GLOBAL_REF(weakObj);
-    });
+    CallbackRecord record = EventDelegate_newRecord(CallbackType::Pinch, source, node);
+    record.ints[2] = pinchState;
+    record.floats[0] = scaleFactor;
+    CallbackBatch_JNI::enqueue(this, _javaObject, record, pinchState == PinchMove);
 }
 
 void EventDelegate_JNI::onRotate(int source, std::shared_ptr<VRONode> node, float rotationRadians, RotateState rotateState) {
-    VRO_ENV env = VROPlatformGetJNIEnv();
-    VRO_WEAK weakObj = VRO_NEW_WEAK_GLOBAL_REF(_javaObject);
-
-    VROPlatformDispatchAsyncApplication([weakObj, source, node, rotationRadians, rotateState] {
-        VRO_ENV env = VROPlatformGetJNIEnv();
-        VRO_OBJECT localObj = VRO_NEW_LOCAL_REF(weakObj);
-        if (VRO_IS_OBJECT_NULL(localObj)) {
-            return;
-        }
-
-        int nodeId = node != nullptr ? node->getUniqueID() : sNullNodeID;
-        VROPlatformCallHostFunction(localObj,
-                                    "onRotate", "(IIFI)V", source, nodeId, rotationRadians, rotateState);
-        VRO_DELETE_LOCAL_REF(localObj);
-        VRO_DELETE_WEAK_GLOBAL_REF(weakObj);
-    });
+    CallbackRecord record = EventDelegate_newRecord(CallbackType::Rotate, source, node);
+    record.ints[2] = rotateState;
+    record.floats[0] = rotationRadians;
+    CallbackBatch_JNI::enqueue(this, _javaObject, record, rotateState == RotateMove);
 }
 
 void EventDelegate_JNI::onCameraARHitTest(std::vector<std::shared_ptr<VROARHitTestResult>> results) {
@@ -383,20 +256,13 @@ void EventDelegate_JNI::onARPointCloudUpdate(std::shared_ptr<VROARPointCloud> po
 
 
 void EventDelegate_JNI::onCameraTransformUpdate(VROVector3f position, VROVector3f rotation, VROVector3f forward, VROVector3f up) {
-    VRO_ENV env = VROPlatformGetJNIEnv();
-    VRO_WEAK weakObj = VRO_NEW_WEAK_GLOBAL_REF(_javaObject);
-
-    VROPlatformDispatchAsyncApplication([weakObj, position, rotation, forward, up] {
-        VRO_ENV env = VROPlatformGetJNIEnv();
-        VRO_OBJECT localObj = VRO_NEW_LOCAL_REF(weakObj);
-        if (VRO_IS_OBJECT_NULL(localObj)) {
-            return;
-        }
-
-        VROPlatformCallHostFunction(localObj, "onCameraTransformUpdate", "(FFFFFFFFFFFF)V",
-                                    position.x, position.y, position.z, rotation.x, rotation.y, rotation.z,
-                                    forward.x, forward.y, forward.z, up.x, up.y, up.z);
-        VRO_DELETE_LOCAL_REF(localObj);
-        VRO_DELETE_WEAK_GLOBAL_REF(weakObj);
-    });
+    CallbackRecord record = {};
+    record.type = CallbackType::CameraTransformUpdate;
+    VROVector3f vectors[4] = { position, rotation, forward, up };
+    for (int v = 0; v < 4; v++) {
+        record.floats[v * 3] = vectors[v].x;
+        record.floats[v * 3 + 1] = vectors[v].y;
+        record.floats[v * 3 + 2] = vectors[v].z;
+    }
+    CallbackBatch_JNI::enqueue(this, _javaObject, record, true);
 }
\ No newline at end of file
@@ -51,6 +51,10 @@ public:
         // do nothing
     }
 
+    virtual const char *getFrameListenerName() const {
+        return "appFrameListener";
+    }
+
     virtual void onFrameDidRender(const VRORenderContext &context) {
         VRO_ENV env = VROPlatformGetJNIEnv();
         VRO_WEAK jObjWeak = VRO_NEW_WEAK_GLOBAL_REF(_javaObject);
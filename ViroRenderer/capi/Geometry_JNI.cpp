@@ -25,6 +25,8 @@
 #include "Material_JNI.h"
 #include "VROPlatformUtil.h"
 #include "VROGeometry.h"
+#include "VROVertexBuffer.h"
+#include "ViroContext_JNI.h"
 
 #if VRO_PLATFORM_ANDROID
 #define VRO_METHOD(return_type, method_name) \
@@ -35,6 +37,47 @@
     return_type Geometry_##method_name
 #endif
 
+/*
+ Sets the geometry source for the given semantic from float data in a direct ByteBuffer,
+ without copying it. If a context is provided, the data is also uploaded to a GPU vertex
+ buffer on the rendering thread, ahead of the first frame that draws it.
+ */
+static void Geometry_setSourceFromBuffer(VRO_ENV env, VRO_REF(VROGeometry) geo_j, VRO_REF(ViroContext) context_j,
+                                         VRO_OBJECT buffer_j, VROGeometrySourceSemantic semantic,
+                                         int componentsPerVertex) {
+    std::shared_ptr<VROData> data = Geometry::wrapDirectBuffer(env, buffer_j);
+    if (!data) {
+        return;
+    }
+    int numVertices = data->getDataLength() / (componentsPerVertex * sizeof(float));
+
+    std::weak_ptr<VROGeometry> geo_w = VRO_REF_GET(VROGeometry, geo_j);
+    std::weak_ptr<ViroContext> context_w;
+    if (!VRO_REF_NULL(context_j)) {
+        context_w = VRO_REF_GET(ViroContext, context_j);
+    }
+
+    VROPlatformDispatchAsyncRenderer([geo_w, context_w, data, semantic, numVertices, componentsPerVertex] {
+        std::shared_ptr<VROGeometry> geo = geo_w.lock();
+        if (!geo) {
+            return;
+        }
+
+        std::shared_ptr<VROGeometrySource> source;
+        std::shared_ptr<ViroContext> context = context_w.lock();
+        if (context) {
+            std::shared_ptr<VROVertexBuffer> vbo = context->getDriver()->newVertexBuffer(data);
+            vbo->hydrate();
+            source = std::make_shared<VROGeometrySource>(vbo, semantic, numVertices, true, componentsPerVertex,
+                                                         sizeof(float), 0, sizeof(float) * componentsPerVertex);
+        } else {
+            source = std::make_shared<VROGeometrySource>(data, semantic, numVertices, true, componentsPerVertex,
+                                                         sizeof(float), 0, sizeof(float) * componentsPerVertex);
+        }
+        geo->setGeometrySourceForSemantic(semantic, source);
+    });
+}
+
 extern "C" {
 
 VRO_METHOD(VRO_REF(VROGeometry), nativeCreateGeometry)(VRO_NO_ARGS) {
@@ -197,4 +240,28 @@ VRO_METHOD(void, nativeSetTextureCoordinates)(VRO_ARGS
     VRO_FLOAT_ARRAY_RELEASE_ELEMENTS(texCoords_j, texcoords_c);
 }
 
-}
\ No newline at end of file
+VRO_METHOD(void, nativeSetVerticesBuffer)(VRO_ARGS
+                                          VRO_REF(VROGeometry) nativeRef,
+                                          VRO_REF(ViroContext) context_j,
+                                          VRO_OBJECT vertices_j) {
+    VRO_METHOD_PREAMBLE;
+    Geometry_setSourceFromBuffer(env, nativeRef, context_j, vertices_j, VROGeometrySourceSemantic::Vertex, 3);
+}
+
+VRO_METHOD(void, nativeSetNormalsBuffer)(VRO_ARGS
+                                         VRO_REF(VROGeometry) nativeRef,
+                                         VRO_REF(ViroContext) context_j,
+                                         VRO_OBJECT normals_j) {
+    VRO_METHOD_PREAMBLE;
+    Geometry_setSourceFromBuffer(env, nativeRef, context_j, normals_j, VROGeometrySourceSemantic::Normal, 3);
+}
+
+VRO_METHOD(void, nativeSetTextureCoordinatesBuffer)(VRO_ARGS
+                                                    VRO_REF(VROGeometry) nativeRef,
+                                                    VRO_REF(ViroContext) context_j,
+                                                    VRO_OBJECT texCoords_j) {
+    VRO_METHOD_PREAMBLE;
+    Geometry_setSourceFromBuffer(env, nativeRef, context_j, texCoords_j, VROGeometrySourceSemantic::Texcoord, 2);
+}
+
+}
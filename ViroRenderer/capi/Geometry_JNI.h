@@ -30,6 +30,7 @@
 #include <VROPlatformUtil.h>
 #include "VRONode.h"
 #include "VROGeometry.h"
+#include "VROData.h"
 #include "VRODefines.h"
 #include VRO_C_INCLUDE
 #include "Material_JNI.h"
@@ -59,6 +60,28 @@ public:
         VRO_DELETE_LOCAL_REF(arrayList);
         return jGeom;
     }
+
+    /*
+     Wrap the memory of the given direct ByteBuffer in a VROData, without copying it.
+     A global reference keeps the buffer alive until the VROData is destroyed, so the
+     host must not write to the buffer after passing it in. Returns nullptr if the
+     buffer is not direct.
+     */
+    static std::shared_ptr<VROData> wrapDirectBuffer(VRO_ENV env, VRO_OBJECT buffer_j) {
+        void *address = VRO_BUFFER_GET_ADDRESS(buffer_j);
+        VRO_LONG capacity = VRO_BUFFER_GET_CAPACITY(buffer_j);
+        if (address == nullptr || capacity <= 0) {
+            perr("Geometry data must be provided in a direct ByteBuffer");
+            return nullptr;
+        }
+
+        VRO_OBJECT bufferRef = VRO_NEW_GLOBAL_REF(buffer_j);
+        std::shared_ptr<const void> owner(address, [bufferRef](const void *address) {
+            VRO_ENV env = VROPlatformGetJNIEnv();
+            VRO_DELETE_GLOBAL_REF(bufferRef);
+        });
+        return std::make_shared<VROData>(address, (int) capacity, owner);
+    }
 };
 
 #endif //ANDROID_GEOMETRY_JNI_H
@@ -375,6 +375,38 @@ VRO_METHOD(void, nativeSetScalePivot)(VRO_ARGS
     VRO_REF_GET(VRONode, native_node_ref)->setScalePivotAtomic(pivotMatrix);
 }
 
+/*
+ Sets the position, rotation (quaternion), and scale of many nodes at once. The
+ transforms array holds 10 floats per node: position XYZ, rotation XYZW, and scale
+ XYZ. Equivalent to invoking nativeSetPosition, nativeSetRotationQuaternion and
+ nativeSetScale on each node, without a JNI transition per property.
+ */
+VRO_METHOD(void, nativeSetTransforms)(VRO_ARGS
+                                      VRO_REF_ARRAY(VRONode) nodes_j,
+                                      VRO_FLOAT_ARRAY transforms_j) {
+    int numNodes = VRO_ARRAY_LENGTH(nodes_j);
+    if (VRO_ARRAY_LENGTH(transforms_j) < numNodes * 10) {
+        perr("Transforms array too short for %d nodes", numNodes);
+        return;
+    }
+
+    VRO_REF(VRONode) *nodes_c = VRO_REF_ARRAY_GET_ELEMENTS(nodes_j);
+    VRO_FLOAT *transforms_c = VRO_FLOAT_ARRAY_GET_ELEMENTS(transforms_j);
+    for (int i = 0; i < numNodes; i++) {
+        if (VRO_REF_NULL(nodes_c[i])) {
+            continue;
+        }
+
+        std::shared_ptr<VRONode> node = VRO_REF_GET(VRONode, nodes_c[i]);
+        const VRO_FLOAT *t = transforms_c + i * 10;
+        node->setPositionAtomic({ t[0], t[1], t[2] });
+        node->setRotationAtomic(VROQuaternion(t[3], t[4], t[5], t[6]));
+        node->setScaleAtomic({ t[7], t[8], t[9] });
+    }
+    VRO_FLOAT_ARRAY_RELEASE_ELEMENTS(transforms_j, transforms_c);
+    VRO_REF_ARRAY_RELEASE_ELEMENTS(nodes_j, nodes_c);
+}
+
 VRO_METHOD(void, nativeUpdateWorldTransforms)(VRO_ARGS
                                               VRO_REF(VRONode) node_j,
                                               VRO_REF(VRONode) parent_j) {
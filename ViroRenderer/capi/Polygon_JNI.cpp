@@ -37,13 +37,8 @@
     return_type Polygon_##method_name
 #endif
 
-extern "C" {
-
-VRO_METHOD(VRO_REF(VROPolygon), nativeCreatePolygon)(VRO_ARGS
-                                                     VRO_ARRAY(VRO_FLOAT_ARRAY) points_j,
-                                                     VRO_ARRAY(VRO_ARRAY(VRO_FLOAT_ARRAY)) holes_j,
-                                                     VRO_FLOAT u0, VRO_FLOAT v0,
-                                                     VRO_FLOAT u1, VRO_FLOAT v1) {
+static std::vector<VROVector3f> Polygon_loadPath(VRO_ARRAY(VRO_FLOAT_ARRAY) points_j) {
+    VRO_ENV env = VROPlatformGetJNIEnv();
     std::vector<VROVector3f> path;
     int pathSize = VRO_ARRAY_LENGTH(points_j);
     for (int i = 0; i < pathSize; i++) {
@@ -54,30 +49,50 @@ VRO_METHOD(VRO_REF(VROPolygon), nativeCreatePolygon)(VRO_ARGS
 
         VRO_FLOAT_ARRAY_RELEASE_ELEMENTS(point_j, point_c);
     }
+    return path;
+}
 
+static std::vector<std::vector<VROVector3f>> Polygon_loadHoles(VRO_ARRAY(VRO_ARRAY(VRO_FLOAT_ARRAY)) holes_j) {
+    VRO_ENV env = VROPlatformGetJNIEnv();
     std::vector<std::vector<VROVector3f>> holes;
     if (holes_j != nullptr) {
         int numHoles = VRO_ARRAY_LENGTH(holes_j);
         for (int i = 0; i < numHoles; i++) {
-            std::vector<VROVector3f> hole;
             VRO_ARRAY(VRO_FLOAT_ARRAY) hole_j = (VRO_ARRAY(VRO_FLOAT_ARRAY)) VRO_ARRAY_GET(holes_j, i);
-            int holeSize = VRO_ARRAY_LENGTH(hole_j);
-
-            for (int i = 0; i < holeSize; i++) {
-                VRO_FLOAT_ARRAY point_j = (VRO_FLOAT_ARRAY) VRO_ARRAY_GET(hole_j, i);
-                VRO_FLOAT *point_c = VRO_FLOAT_ARRAY_GET_ELEMENTS(point_j);
-                VROVector3f point = VROVector3f(point_c[0], point_c[1]);
-                hole.push_back(point);
-
-                VRO_FLOAT_ARRAY_RELEASE_ELEMENTS(point_j, point_c);
-            }
-
-            holes.push_back(hole);
+            holes.push_back(Polygon_loadPath(hole_j));
         }
     }
+    return holes;
+}
+
+extern "C" {
+
+VRO_METHOD(VRO_REF(VROPolygon), nativeCreatePolygon)(VRO_ARGS
+                                                     VRO_ARRAY(VRO_FLOAT_ARRAY) points_j,
+                                                     VRO_ARRAY(VRO_ARRAY(VRO_FLOAT_ARRAY)) holes_j,
+                                                     VRO_FLOAT u0, VRO_FLOAT v0,
+                                                     VRO_FLOAT u1, VRO_FLOAT v1) {
+    std::vector<VROVector3f> path = Polygon_loadPath(points_j);
+    std::vector<std::vector<VROVector3f>> holes = Polygon_loadHoles(holes_j);
 
     std::shared_ptr<VROPolygon> surface  = VROPolygon::createPolygon(path, holes, u0, v0, u1, v1);
     return VRO_REF_NEW(VROPolygon, surface);
 }
 
+VRO_METHOD(void, nativeSetPath)(VRO_ARGS
+                                VRO_REF(VROPolygon) polygon_j,
+                                VRO_ARRAY(VRO_FLOAT_ARRAY) points_j,
+                                VRO_ARRAY(VRO_ARRAY(VRO_FLOAT_ARRAY)) holes_j) {
+    std::weak_ptr<VROPolygon> polygon_w = VRO_REF_GET(VROPolygon, polygon_j);
+    std::vector<VROVector3f> path = Polygon_loadPath(points_j);
+    std::vector<std::vector<VROVector3f>> holes = Polygon_loadHoles(holes_j);
+
+    VROPlatformDispatchAsyncRenderer([polygon_w, path, holes] {
+        std::shared_ptr<VROPolygon> polygon = polygon_w.lock();
+        if (polygon) {
+            polygon->setPath(path, holes);
+        }
+    });
+}
+
 }  // extern "C"
\ No newline at end of file
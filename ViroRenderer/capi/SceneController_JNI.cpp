@@ -45,6 +45,44 @@
     return_type Scene_##method_name
 #endif
 
+/*
+ Run the given spatial query on the renderer thread, and return the unique IDs
+ of the resulting nodes to the callback's onQueryComplete(int[]) on the
+ application thread.
+ */
+static void dispatchSpatialQuery(VRO_ENV env, VRO_REF(VROSceneController) sceneRef, VRO_OBJECT callback,
+                                 std::function<std::vector<std::shared_ptr<VRONode>>(std::shared_ptr<VROScene>)> query) {
+    VRO_WEAK weakCallback = VRO_NEW_WEAK_GLOBAL_REF(callback);
+    std::weak_ptr<VROSceneController> sceneController_w = VRO_REF_GET(VROSceneController, sceneRef);
+
+    VROPlatformDispatchAsyncRenderer([sceneController_w, weakCallback, query] {
+        std::shared_ptr<VROSceneController> sceneController = sceneController_w.lock();
+        if (!sceneController) {
+            return;
+        }
+
+        std::vector<int> nodeIds;
+        for (const std::shared_ptr<VRONode> &node : query(sceneController->getScene())) {
+            nodeIds.push_back(node->getUniqueID());
+        }
+
+        VROPlatformDispatchAsyncApplication([nodeIds, weakCallback] {
+            VRO_ENV env = VROPlatformGetJNIEnv();
+            VRO_OBJECT jCallback = VRO_NEW_LOCAL_REF(weakCallback);
+            if (VRO_IS_OBJECT_NULL(jCallback)) {
+                return;
+            }
+
+            VRO_INT_ARRAY jNodeIds = VRO_NEW_INT_ARRAY((int) nodeIds.size());
+            VRO_INT_ARRAY_SET(jNodeIds, 0, (int) nodeIds.size(), nodeIds.data());
+            VROPlatformCallHostFunction(jCallback, "onQueryComplete", "([I)V", jNodeIds);
+            VRO_DELETE_LOCAL_REF(jNodeIds);
+            VRO_DELETE_LOCAL_REF(jCallback);
+            VRO_DELETE_WEAK_GLOBAL_REF(weakCallback);
+        });
+    });
+}
+
 extern "C" {
 
 VRO_METHOD(VRO_REF(VROSceneController), nativeCreateSceneController)(VRO_ARGS
@@ -310,6 +348,62 @@ VRO_METHOD(void, findCollisionsWithRayAsync)(VRO_ARGS
     });
 }
 
+VRO_METHOD(void, findNodesInRadiusAsync)(VRO_ARGS
+                                         VRO_REF(VROSceneController) sceneRef,
+                                         VRO_FLOAT_ARRAY center,
+                                         VRO_FLOAT radius,
+                                         VRO_OBJECT callback) {
+    VRO_METHOD_PREAMBLE;
+
+    VRO_FLOAT *centerf = VRO_FLOAT_ARRAY_GET_ELEMENTS(center);
+    VROVector3f c = VROVector3f(centerf[0], centerf[1], centerf[2]);
+    VRO_FLOAT_ARRAY_RELEASE_ELEMENTS(center, centerf);
+
+    dispatchSpatialQuery(env, sceneRef, callback, [c, radius](std::shared_ptr<VROScene> scene) {
+        return scene->findNodesInRadius(c, radius);
+    });
+}
+
+VRO_METHOD(void, findNodesInBoxAsync)(VRO_ARGS
+                                      VRO_REF(VROSceneController) sceneRef,
+                                      VRO_FLOAT_ARRAY minPos,
+                                      VRO_FLOAT_ARRAY maxPos,
+                                      VRO_OBJECT callback) {
+    VRO_METHOD_PREAMBLE;
+
+    VRO_FLOAT *minf = VRO_FLOAT_ARRAY_GET_ELEMENTS(minPos);
+    VRO_FLOAT *maxf = VRO_FLOAT_ARRAY_GET_ELEMENTS(maxPos);
+    VROBoundingBox box(minf[0], maxf[0], minf[1], maxf[1], minf[2], maxf[2]);
+    VRO_FLOAT_ARRAY_RELEASE_ELEMENTS(minPos, minf);
+    VRO_FLOAT_ARRAY_RELEASE_ELEMENTS(maxPos, maxf);
+
+    dispatchSpatialQuery(env, sceneRef, callback, [box](std::shared_ptr<VROScene> scene) {
+        return scene->findNodesInBox(box);
+    });
+}
+
+VRO_METHOD(void, findNearestNodeAsync)(VRO_ARGS
+                                       VRO_REF(VROSceneController) sceneRef,
+                                       VRO_FLOAT_ARRAY point,
+                                       VRO_FLOAT maxDistance,
+                                       VRO_OBJECT callback) {
+    VRO_METHOD_PREAMBLE;
+
+    VRO_FLOAT *pointf = VRO_FLOAT_ARRAY_GET_ELEMENTS(point);
+    VROVector3f p = VROVector3f(pointf[0], pointf[1], pointf[2]);
+    VRO_FLOAT_ARRAY_RELEASE_ELEMENTS(point, pointf);
+
+    // Returned as an array of at most one node
+    dispatchSpatialQuery(env, sceneRef, callback, [p, maxDistance](std::shared_ptr<VROScene> scene) {
+        std::vector<std::shared_ptr<VRONode>> nodes;
+        std::shared_ptr<VRONode> nearest = scene->findNearestNode(p, maxDistance);
+        if (nearest) {
+            nodes.push_back(nearest);
+        }
+        return nodes;
+    });
+}
+
 VRO_METHOD(void, findCollisionsWithShapeAsync)(VRO_ARGS
                                                VRO_REF(VROSceneController) sceneRef,
                                                VRO_FLOAT_ARRAY posStart,
@@ -24,6 +24,7 @@
 #include "Submesh_JNI.h"
 #include "VROPlatformUtil.h"
 #include "VROGeometryUtil.h"
+#include "Geometry_JNI.h"
 
 #if VRO_PLATFORM_ANDROID
 #define VRO_METHOD(return_type, method_name) \
@@ -63,4 +64,34 @@ VRO_METHOD(void, nativeSetTriangleIndices)(VRO_ARGS
     VRO_INT_ARRAY_RELEASE_ELEMENTS(indices_j, indices_c);
 }
 
+VRO_METHOD(void, nativeSetTriangleIndicesBuffer)(VRO_ARGS
+                                                 VRO_REF(VROGeometryElement) nativeRef,
+                                                 VRO_OBJECT indices_j,
+                                                 VRO_INT bytesPerIndex) {
+    VRO_METHOD_PREAMBLE;
+    if (bytesPerIndex != 2 && bytesPerIndex != 4) {
+        perr("Triangle indices must be 2 or 4 bytes, not %d", bytesPerIndex);
+        return;
+    }
+
+    // Wrap the buffer directly, without copying
+    std::shared_ptr<VROData> indicesData = Geometry::wrapDirectBuffer(env, indices_j);
+    if (!indicesData) {
+        return;
+    }
+    int numIndices = indicesData->getDataLength() / bytesPerIndex;
+    int indexSize = bytesPerIndex;
+
+    std::weak_ptr<VROGeometryElement> element_w = VRO_REF_GET(VROGeometryElement, nativeRef);
+    VROPlatformDispatchAsyncRenderer([element_w, indicesData, numIndices, indexSize] {
+        std::shared_ptr<VROGeometryElement> element = element_w.lock();
+        if (element) {
+            element->setPrimitiveType(VROGeometryPrimitiveType::Triangle);
+            element->setPrimitiveCount(VROGeometryUtilGetPrimitiveCount(numIndices, VROGeometryPrimitiveType::Triangle));
+            element->setBytesPerIndex(indexSize);
+            element->setData(indicesData);
+        }
+    });
+}
+
 }
\ No newline at end of file
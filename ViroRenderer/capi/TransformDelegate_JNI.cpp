@@ -26,6 +26,7 @@
 #include <memory>
 #include <VROPlatformUtil.h>
 #include "TransformDelegate_JNI.h"
+#include "CallbackBatch_JNI.h"
 
 TransformDelegate_JNI::TransformDelegate_JNI(VRO_OBJECT javaDelegateObject, double distanceFilter) :
         VROTransformDelegate(distanceFilter),
@@ -41,19 +42,10 @@ TransformDelegate_JNI::~TransformDelegate_JNI() {
 
 
 void TransformDelegate_JNI::onPositionUpdate(VROVector3f position){
-    VRO_ENV env = VROPlatformGetJNIEnv();
-    VRO_WEAK weakObj = VRO_NEW_WEAK_GLOBAL_REF(_javaObject);
-
-    VROPlatformDispatchAsyncApplication([weakObj, position] {
-        VRO_ENV env = VROPlatformGetJNIEnv();
-        VRO_OBJECT localObj = VRO_NEW_LOCAL_REF(weakObj);
-        if (VRO_IS_OBJECT_NULL(localObj)) {
-            return;
-        }
-
-        VROPlatformCallHostFunction(localObj, "onPositionUpdate", "(FFF)V",
-                                    position.x, position.y, position.z);
-        VRO_DELETE_LOCAL_REF(localObj);
-        VRO_DELETE_WEAK_GLOBAL_REF(weakObj);
-    });
-}
\ No newline at end of file
+    CallbackRecord record = {};
+    record.type = CallbackType::PositionUpdate;
+    record.floats[0] = position.x;
+    record.floats[1] = position.y;
+    record.floats[2] = position.z;
+    CallbackBatch_JNI::enqueue(this, _javaObject, record, true);
+}
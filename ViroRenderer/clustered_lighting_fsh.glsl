@@ -0,0 +1,39 @@
+// Grouped in 4N slots, should match VROClusteredLightingData defined in VROLightClusterUBO.h,
+// and the grid limits defined in VROLightClusterGrid.h
+layout (std140) uniform clustered_lighting {
+    highp mat4 cluster_view_projection;
+    highp vec4 cluster_depth_params;
+    ivec4 cluster_dimensions;
+    VROLightUniforms clustered_lights[128];
+};
+
+// One header per cluster, packed four to each uvec4: the offset of the cluster's
+// first light index shifted left by 8 bits, OR'd with the number of lights
+layout (std140) uniform cluster_headers_data {
+    highp uvec4 cluster_headers[512];
+};
+
+// 8-bit light indices, packed sixteen to each uvec4
+layout (std140) uniform cluster_indices_data {
+    highp uvec4 cluster_indices[1024];
+};
+
+highp uint cluster_header(highp vec3 position) {
+    highp vec4 clip = cluster_view_projection * vec4(position, 1.0);
+    if (clip.w <= 0.0) {
+        return 0u;
+    }
+    
+    ivec2 tile = ivec2(floor((clip.xy / clip.w * 0.5 + 0.5) * vec2(cluster_dimensions.xy)));
+    tile = clamp(tile, ivec2(0), cluster_dimensions.xy - 1);
+    int slice = int(floor(log(clip.w) * cluster_depth_params.x + cluster_depth_params.y));
+    slice = clamp(slice, 0, cluster_dimensions.z - 1);
+    
+    int cluster = (slice * cluster_dimensions.y + tile.y) * cluster_dimensions.x + tile.x;
+    return cluster_headers[cluster >> 2][cluster & 3];
+}
+
+VROLightUniforms clustered_light(int index) {
+    highp uint word = cluster_indices[index >> 4][(index >> 2) & 3];
+    return clustered_lights[int((word >> uint((index & 3) * 8)) & 0xFFu)];
+}
@@ -0,0 +1,112 @@
+// Grouped in 4N slots, should match VROGPUParticleData defined in VROGPUParticleUBO.h. The
+// gpu_particles_data block itself is declared by VROGPUParticleUBO, since its size
+// depends on the device.
+struct VROGPUParticle {
+    highp vec4 position_spawn;
+    highp vec4 velocity_lifetime;
+    highp vec4 accel_alpha;
+    highp vec4 color_fixed;
+    highp vec4 scale;
+    highp vec4 rotation;
+};
+
+// Should match VROGPUParticleEmitterData defined in VROGPUParticleUBO.h
+layout (std140) uniform gpu_particle_emitter_data {
+    highp mat4 gpu_emitter_transform;
+    highp vec4 gpu_emitter_params;
+    highp ivec4 gpu_modifier_headers[6];
+    highp vec4 gpu_modifier_intervals[48];
+};
+
+const int kGPUModifierAlpha = 0;
+const int kGPUModifierColor = 1;
+const int kGPUModifierScale = 2;
+const int kGPUModifierRotation = 3;
+const int kGPUModifierVelocity = 4;
+const int kGPUModifierAcceleration = 5;
+const int kGPUMaxModifierIntervals = 4;
+
+// Evaluates the curve of the given modifier, as VROParticleModifier::getFinalValue does on
+// the CPU: the value is interpolated within each interval, and holds the target of the
+// last interval passed between intervals.
+highp vec3 gpu_particle_modify(int modifier, highp vec3 initial, highp float time_ms,
+                               highp float distance, highp float velocity) {
+    int factor_type = gpu_modifier_headers[modifier].x;
+    int count = gpu_modifier_headers[modifier].y;
+    highp float factor = factor_type == 1 ? distance : (factor_type == 2 ? velocity : time_ms);
+
+    highp vec3 value = initial;
+    for (int i = 0; i < kGPUMaxModifierIntervals; i++) {
+        if (i >= count) {
+            break;
+        }
+        int index = (modifier * kGPUMaxModifierIntervals + i) * 2;
+        highp vec3 target = gpu_modifier_intervals[index].xyz;
+        highp vec2 range = gpu_modifier_intervals[index + 1].xy;
+
+        if (factor < range.x) {
+            break;
+        }
+        if (factor < range.y) {
+            return mix(value, target, (factor - range.x) / (range.y - range.x));
+        }
+        value = target;
+    }
+    return value;
+}
+
+// Derives the model matrix and color of the given particle from its spawn state and
+// the emitter's current time. Dead particles collapse to a point.
+highp mat4 gpu_particle_transform(VROGPUParticle p, highp mat4 view_matrix, out highp vec4 color) {
+    highp float age = gpu_emitter_params.x - p.position_spawn.w;
+    if (age < 0.0 || age > p.velocity_lifetime.w) {
+        color = vec4(0.0);
+        return mat4(0.0);
+    }
+
+    highp float t = age;
+    if (gpu_emitter_params.y >= 0.0) {
+        t = min(t, gpu_emitter_params.y);
+    }
+    highp float age_ms = age * 1000.0;
+
+    // Physics modifiers that interpolate against distance or velocity use the values
+    // implied by the initial state
+    highp vec3 v0 = p.velocity_lifetime.xyz;
+    highp vec3 a0 = p.accel_alpha.xyz;
+    highp float distance = length(v0 * t + a0 * (0.5 * t * t));
+    highp float velocity = length(v0 + a0 * t);
+
+    highp vec3 v = gpu_particle_modify(kGPUModifierVelocity, v0, age_ms, distance, velocity);
+    highp vec3 a = gpu_particle_modify(kGPUModifierAcceleration, a0, age_ms, distance, velocity);
+    highp vec3 displacement = v * t + a * (0.5 * t * t);
+    distance = length(displacement);
+    velocity = length(v + a * t);
+
+    highp float alpha = gpu_particle_modify(kGPUModifierAlpha, vec3(p.accel_alpha.w), age_ms, distance, velocity).x;
+    highp vec3 rgb = gpu_particle_modify(kGPUModifierColor, p.color_fixed.xyz, age_ms, distance, velocity);
+    highp vec3 scale = gpu_particle_modify(kGPUModifierScale, p.scale.xyz, age_ms, distance, velocity);
+    highp vec3 rotation = gpu_particle_modify(kGPUModifierRotation, p.rotation.xyz, age_ms, distance, velocity);
+    color = vec4(rgb, alpha);
+
+    highp vec3 position = p.position_spawn.xyz + displacement;
+    if (p.color_fixed.w > 0.5) {
+        position = (gpu_emitter_transform * vec4(position, 1.0)).xyz;
+        scale *= vec3(length(gpu_emitter_transform[0].xyz),
+                      length(gpu_emitter_transform[1].xyz),
+                      length(gpu_emitter_transform[2].xyz));
+    }
+
+    // Rotate the particle about X, then Y, then Z, then billboard it to the view plane
+    highp vec3 c = cos(rotation);
+    highp vec3 s = sin(rotation);
+    highp mat3 rx = mat3(1.0, 0.0, 0.0, 0.0, c.x, s.x, 0.0, -s.x, c.x);
+    highp mat3 ry = mat3(c.y, 0.0, -s.y, 0.0, 1.0, 0.0, s.y, 0.0, c.y);
+    highp mat3 rz = mat3(c.z, s.z, 0.0, -s.z, c.z, 0.0, 0.0, 0.0, 1.0);
+    highp mat3 basis = transpose(mat3(view_matrix)) * rz * ry * rx;
+
+    return mat4(vec4(basis[0] * scale.x, 0.0),
+                vec4(basis[1] * scale.y, 0.0),
+                vec4(basis[2] * scale.z, 0.0),
+                vec4(position, 1.0));
+}
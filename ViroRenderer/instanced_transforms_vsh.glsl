@@ -0,0 +1,5 @@
+// Grouped in 4N slots, should match VROInstancedTransformsUBOData structure defined in VROInstancedTransformUBO.h
+layout(std140) uniform instanced_transforms_data {
+   mat4 instanced_model_matrix[120];
+   mat4 instanced_normal_matrix[120];
+};
\ No newline at end of file
@@ -21,7 +21,8 @@ struct VROLightUniforms {
     lowp float shadow_bias;
     
     lowp float shadow_opacity;
-    lowp float light_padding0, light_padding1, light_padding2;
+    int shadow_cascade_count;
+    lowp float light_padding1, light_padding2;
 };
 
 layout (std140) uniform lighting_fragment {
@@ -30,6 +31,13 @@ layout (std140) uniform lighting_fragment {
     
     highp vec4 ambient_light_color;
     VROLightUniforms lights[8];
+    
+    highp vec4 shadow_cascade_splits[8];
+    highp vec4 shadow_cascade_scales[8];
+    highp vec4 shadow_cascade_offsets_x[8];
+    highp vec4 shadow_cascade_offsets_y[8];
+    highp vec4 shadow_cascade_layers[8];
+    highp vec4 shadow_caster_bounds[8];
 };
 
 struct VROLightingContribution {
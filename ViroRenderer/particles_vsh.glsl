@@ -1,4 +1,27 @@
-// Grouped in 4N slots, should match VROParticlesUBOVertexData structure defined in VROParticleUBO.h
-layout(std140) uniform particles_vertex_data{
-   mat4 particles_vertex_transform[180];
-};
\ No newline at end of file
+// Each particle is three vec4s of particles_vertex_instance: position, scale, and rotation
+// (radians), each in xyz. The particles_vertex_data block itself is declared by
+// VROParticleUBO, since its size depends on the device.
+
+// Derives the model matrix of the given particle: it is rotated about X, then Y, then Z,
+// scaled, and billboarded to the view plane using the camera's right and up vectors, which
+// are the first two rows of the view matrix.
+highp mat4 particle_transform(int instance_id, highp mat4 view_matrix) {
+    highp vec3 position = particles_vertex_instance[instance_id * 3].xyz;
+    highp vec3 scale = particles_vertex_instance[instance_id * 3 + 1].xyz;
+    highp vec3 rotation = particles_vertex_instance[instance_id * 3 + 2].xyz;
+
+    highp mat3 basis = transpose(mat3(view_matrix));
+    if (rotation != vec3(0.0)) {
+        highp vec3 c = cos(rotation);
+        highp vec3 s = sin(rotation);
+        highp mat3 rx = mat3(1.0, 0.0, 0.0, 0.0, c.x, s.x, 0.0, -s.x, c.x);
+        highp mat3 ry = mat3(c.y, 0.0, -s.y, 0.0, 1.0, 0.0, s.y, 0.0, c.y);
+        highp mat3 rz = mat3(c.z, s.z, 0.0, -s.z, c.z, 0.0, 0.0, 0.0, 1.0);
+        basis = basis * rz * ry * rx;
+    }
+
+    return mat4(vec4(basis[0] * scale.x, 0.0),
+                vec4(basis[1] * scale.y, 0.0),
+                vec4(basis[2] * scale.z, 0.0),
+                vec4(position, 1.0));
+}
@@ -0,0 +1,8 @@
+#version 300 es
+
+// Rasterization is discarded while skinning, so this is never run
+layout (location = 0) out highp vec4 frag_color;
+
+void main() {
+    frag_color = vec4(0.0);
+}
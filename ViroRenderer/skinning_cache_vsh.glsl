@@ -0,0 +1,19 @@
+#version 300 es
+#include skinning_vsh
+
+in vec3 position;
+in ivec4 bone_indices;
+in vec4 bone_weights;
+
+// Captured by transform feedback into the VROSkinningCache buffer
+out highp vec3 skinned_position;
+
+void main() {
+    vec4 pos_h = vec4(position, 1.0);
+    vec4 pos_blended = (bone_matrices[bone_indices.x] * pos_h) * bone_weights.x +
+                       (bone_matrices[bone_indices.y] * pos_h) * bone_weights.y +
+                       (bone_matrices[bone_indices.z] * pos_h) * bone_weights.z +
+                       (bone_matrices[bone_indices.w] * pos_h) * bone_weights.w;
+    skinned_position = pos_blended.xyz;
+    gl_Position = vec4(0.0, 0.0, 0.0, 1.0);
+}
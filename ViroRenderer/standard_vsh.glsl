@@ -55,6 +55,10 @@ out vec2 v_texcoord;
 out vec3 v_surface_position;
 flat out int v_instance_id;
 
+// Depth must be reproduced exactly by the depth pre-pass, which uses a different
+// fragment shader
+invariant gl_Position;
+
 void main() {
 #inject vertex_assignments
 
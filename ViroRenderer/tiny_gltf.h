@@ -534,6 +534,7 @@ struct BufferView {
   size_t byteStride;  // minimum 4, maximum 252 (multiple of 4), default 0 =
                       // understood to be tightly packed
   int target;         // ["ARRAY_BUFFER", "ELEMENT_ARRAY_BUFFER"]
+  ExtensionMap extensions;
   Value extras;
 
   BufferView() : byteOffset(0), byteStride(0) {}
@@ -711,6 +712,7 @@ struct Buffer {
   std::vector<unsigned char> data;
   std::string
       uri;  // considered as required here but not in the spec (need to clarify)
+  ExtensionMap extensions;
   Value extras;
 };
 
@@ -2154,6 +2156,17 @@ static bool ParseBuffer(Buffer *buffer, std::string *err, const json &o,
   // In glTF 2.0, uri is not mandatory anymore
   buffer->uri.clear();
   ParseStringProperty(&buffer->uri, err, o, "uri", false, "Buffer");
+  ParseStringProperty(&buffer->name, err, o, "name", false);
+  ParseExtensionsProperty(&buffer->extensions, err, o);
+
+  // A fallback buffer of EXT_meshopt_compression only reserves space for the
+  // decompressed data: it has no data of its own when the extension is supported.
+  ExtensionMap::const_iterator meshopt = buffer->extensions.find("EXT_meshopt_compression");
+  if (meshopt != buffer->extensions.end() && meshopt->second.Has("fallback") &&
+      meshopt->second.Get("fallback").IsBool() && meshopt->second.Get("fallback").Get<bool>() &&
+      buffer->uri.empty()) {
+    return true;
+  }
 
   // having an empty uri for a non embedded image should not be valid
   if (!is_binary && buffer->uri.empty()) {
@@ -2286,6 +2299,7 @@ static bool ParseBufferView(BufferView *bufferView, std::string *err,
   bufferView->byteOffset = static_cast<size_t>(byteOffset);
   bufferView->byteLength = static_cast<size_t>(byteLength);
   bufferView->byteStride = static_cast<size_t>(byteStride);
+  ParseExtensionsProperty(&bufferView->extensions, err, o);
 
   return true;
 }
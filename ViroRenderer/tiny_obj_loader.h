@@ -324,6 +324,13 @@ namespace tinyobj {
                       std::string *err,
                       std::shared_ptr<std::istream> inStream, MaterialReader *readMatFn);
     
+    // Load the MTL library named by a single mtllib statement, trying each of
+    // the given file names in turn until one is read
+    bool LoadMTLFiles(std::shared_ptr<std::vector<material_t>> materials,
+                      std::shared_ptr<std::map<std::string, int>> material_map,
+                      std::string *err,
+                      const std::vector<std::string> &filenames, MaterialReader *readMatFn);
+    
     /// Loads object from a std::istream, uses GetMtlIStreamFn to retrieve
     /// std::istream for materials.
     /// Returns true when loading .obj become success.
@@ -1710,35 +1717,7 @@ namespace tinyobj {
                     
                     std::vector<std::string> filenames;
                     SplitString(std::string(token), ' ', filenames);
-                    
-                    if (filenames.empty()) {
-                        if (err) {
-                            (*err) += "WARN: Looks like empty filename for mtllib. Use default material. \n";
-                        }
-                    } else {
-                        bool found = false;
-                        for (size_t s = 0; s < filenames.size(); s++) {
-                            
-                            std::string err_mtl;
-                            bool ok = (*readMatFn)(filenames[s].c_str(), materials, material_map,
-                                                   &err_mtl);
-                            pinfo("   Queued reading of material file [%s]", filenames[s].c_str());
-                            if (err && (!err_mtl.empty())) {
-                                (*err) += err_mtl; // This should be warn message.
-                            }
-                            
-                            if (ok) {
-                                found = true;
-                                break;
-                            }
-                        }
-                        
-                        if (!found) {
-                            if (err) {
-                                (*err) += "WARN: Failed to load material file(s). Use default material.\n";
-                            }
-                        }
-                    }
+                    LoadMTLFiles(materials, material_map, err, filenames, readMatFn);
                 }
                 continue;
             }
@@ -1747,6 +1726,37 @@ namespace tinyobj {
         
         return true;
     }
+    
+    bool LoadMTLFiles(std::shared_ptr<std::vector<material_t>> materials,
+                      std::shared_ptr<std::map<std::string, int>> material_map,
+                      std::string *err,
+                      const std::vector<std::string> &filenames, MaterialReader *readMatFn) {
+        if (filenames.empty()) {
+            if (err) {
+                (*err) += "WARN: Looks like empty filename for mtllib. Use default material. \n";
+            }
+            return false;
+        }
+        
+        for (size_t s = 0; s < filenames.size(); s++) {
+            std::string err_mtl;
+            bool ok = (*readMatFn)(filenames[s].c_str(), materials, material_map,
+                                   &err_mtl);
+            pinfo("   Queued reading of material file [%s]", filenames[s].c_str());
+            if (err && (!err_mtl.empty())) {
+                (*err) += err_mtl; // This should be warn message.
+            }
+            
+            if (ok) {
+                return true;
+            }
+        }
+        
+        if (err) {
+            (*err) += "WARN: Failed to load material file(s). Use default material.\n";
+        }
+        return false;
+    }
 }  // namespace tinyobj
 
 #endif
@@ -31,16 +31,58 @@
 #include "VROImagePostProcess.h"
 #include "VRORecorderEglSurfaceDisplay.h"
 #include "VRORenderToTextureDelegateAndroid.h"
+#include "VROVideoEncoderMediaCodec.h"
+#include "VROTime.h"
 #include "jni/MediaRecorder_JNI.h"
 
+// Frame rate the encoder is configured for, and the largest dimension it encodes;
+// larger frames are scaled down
+static const int kEncoderFrameRate = 60;
+static const int kMaxEncoderDimension = 1920;
+
+// Default bitrate, in bits per pixel per frame, when none is given
+static const float kDefaultBitsPerPixel = 0.1;
+
+// Encoder adaptation is evaluated every kAdaptIntervalFrames frames, against
+// averages weighted kAverageWeight toward the newest frame. The frame budget is
+// tight when the frame interval exceeds kFrameBudgetSeconds, or when submitting a
+// frame to the encoder blocks for more than kMaxSubmitSeconds
+static const int kAdaptIntervalFrames = 30;
+static const double kAverageWeight = 0.1;
+static const double kFrameBudgetSeconds = 1.0 / 50.0;
+static const double kMaxSubmitSeconds = 0.004;
+
+// Under pressure the bitrate is stepped down by kBitrateStep to no lower than
+// kMinBitrateFraction of the target; beyond that, up to kMaxEncodeInterval - 1 of
+// every kMaxEncodeInterval frames are skipped
+static const float kBitrateStep = 0.75;
+static const float kMinBitrateFraction = 0.25;
+static const int kMaxEncodeInterval = 3;
+
 VROAVRecorderAndroid::VROAVRecorderAndroid(std::shared_ptr<MediaRecorder_JNI> jRecorder) {
     _recorderDisplay = nullptr;
     _w_mediaRecorderJNI = jRecorder;
     _isRecording = false;
     _scheduledScreenShot = false;
+    _encoderBitrate = 0;
+    _recordingStartTime = 0;
+    _lastFrameTime = 0;
+    _frameIntervalAverage = 0;
+    _submitTimeAverage = 0;
+    _encodeInterval = 1;
+    _framesSinceEncode = 0;
+    _framesSinceAdapt = 0;
+    _encoding = false;
 }
 
 VROAVRecorderAndroid::~VROAVRecorderAndroid() {
+    for (ScreenshotReadback &readback : _screenshotReadbacks) {
+        glDeleteSync(readback.fence);
+        glDeleteBuffers(1, &readback.buffer);
+    }
+    if (!_freeScreenshotBuffers.empty()) {
+        glDeleteBuffers((GLsizei) _freeScreenshotBuffers.size(), _freeScreenshotBuffers.data());
+    }
 }
 
 void VROAVRecorderAndroid::init(std::shared_ptr<VRODriver> driver) {
@@ -68,6 +110,13 @@ void VROAVRecorderAndroid::setEnableVideoFrameRecording(bool isRecording) {
         return;
     }
 
+    if (isRecording && !_isRecording) {
+        _encoding = !_encoderPath.empty() && VROVideoEncoderMediaCodec::isSupported();
+    } else if (!isRecording) {
+        closeEncoder();
+        _encoding = false;
+    }
+
     _isRecording = isRecording;
     jRecorder->onEnableFrameRecording(isRecording);
 }
@@ -76,45 +125,221 @@ void VROAVRecorderAndroid::scheduleScreenCapture() {
     _scheduledScreenShot = true;
 }
 
+void VROAVRecorderAndroid::setVideoEncoderOutput(std::string path, int bitrate) {
+    _encoderPath = path;
+    _encoderBitrate = bitrate;
+}
+
 bool VROAVRecorderAndroid::onRenderedFrameTexture(std::shared_ptr<VRORenderTarget> input,
                                                   std::shared_ptr<VRODriver> driver) {
     if (_isRecording) {
-        if (_recorderDisplay == nullptr) {
-            std::shared_ptr<VRODriverOpenGL> openGLDriver = std::static_pointer_cast<VRODriverOpenGL>(driver);
-            _recorderDisplay = std::make_shared<VRORecorderEglSurfaceDisplay>(openGLDriver, shared_from_this());
+        recordFrame(input, driver);
+    }
+
+    if (_scheduledScreenShot) {
+        // The input target is LDR and has already been tone-mapped, but may need gamma correction.
+        // We need gamma correction if we're in linear color space.
+        if (driver->getColorRenderingMode() == VROColorRenderingMode::Linear) {
+            std::shared_ptr<VRORenderTarget> ldrTarget = bindScreenshotLDRTarget(input->getWidth(), input->getHeight(), driver);
+            getGammaPostProcess(driver)->blit({ input->getTexture(0) }, driver);
+            ldrTarget->bindRead();
         }
-        _recorderDisplay->setViewport({0, 0, input->getWidth(), input->getHeight()});
+        // Otherwise we can perform a direct read
+        else {
+            input->bindRead();
+        }
+        readScreenshot(input);
+        _scheduledScreenShot = false;
+    }
+
+    deliverScreenshots();
+    return true;
+}
 
-        driver->bindRenderTarget(_recorderDisplay, VRORenderTargetUnbindOp::Invalidate);
+#pragma mark - Recording
+
+void VROAVRecorderAndroid::recordFrame(std::shared_ptr<VRORenderTarget> input,
+                                       std::shared_ptr<VRODriver> driver) {
+    if (_recorderDisplay == nullptr) {
+        std::shared_ptr<VRODriverOpenGL> openGLDriver = std::static_pointer_cast<VRODriverOpenGL>(driver);
+        _recorderDisplay = std::make_shared<VRORecorderEglSurfaceDisplay>(openGLDriver, shared_from_this());
+    }
+
+    if (_encoding && _encoder && _encoder->hasFailed()) {
+        pwarn("Video encoder failed, reverting to recording surface");
+        closeEncoder();
+        _encoding = false;
+    }
+    if (_encoding && !_encoder && !openEncoder(input->getWidth(), input->getHeight())) {
+        pwarn("Failed to open video encoder, reverting to recording surface");
+        _encoding = false;
+    }
+
+    int width = input->getWidth();
+    int height = input->getHeight();
+    if (_encoding) {
+        adaptEncoder(VROTimeCurrentSeconds());
+        if (++_framesSinceEncode < _encodeInterval) {
+            return;
+        }
+        _framesSinceEncode = 0;
+
+        width = _encoder->getWidth();
+        height = _encoder->getHeight();
+    }
+    _recorderDisplay->setViewport({0, 0, width, height});
+    driver->bindRenderTarget(_recorderDisplay, VRORenderTargetActions::overwrite(), VRORenderTargetUnbindOp::Invalidate);
+
+    /*
+     When the input is already gamma corrected (or never needs to be), it is copied to
+     the recording surface with a framebuffer blit, which needs no shader pass. In
+     linear mode the input holds linear color: the encoder's surface needs it gamma
+     corrected, and the Java surface is drawn to as it always has been.
+     */
+    if (driver->getColorRenderingMode() != VROColorRenderingMode::Linear) {
+        copyFrame(input, width, height);
+    } else if (_encoding) {
+        getGammaPostProcess(driver)->blit({ input->getTexture(0) }, driver);
+    } else {
         _recordingPostProcess->blit({ input->getTexture(0) }, driver);
     }
+}
 
-    if (_scheduledScreenShot) {
+bool VROAVRecorderAndroid::openEncoder(int width, int height) {
+    // Encoders require even dimensions and are most efficient with multiples of 16
+    float scale = std::min(1.0f, kMaxEncoderDimension / (float) std::max(width, height));
+    int encoderWidth  = std::max(16, (int) (width * scale) & ~15);
+    int encoderHeight = std::max(16, (int) (height * scale) & ~15);
+    int bitrate = _encoderBitrate > 0 ? _encoderBitrate :
+                  (int) (encoderWidth * encoderHeight * kEncoderFrameRate * kDefaultBitsPerPixel);
+
+    _encoder = std::unique_ptr<VROVideoEncoderMediaCodec>(new VROVideoEncoderMediaCodec());
+    if (!_encoder->open(_encoderPath, encoderWidth, encoderHeight, kEncoderFrameRate, bitrate)) {
+        _encoder.reset();
+        return false;
+    }
+
+    _encoderBitrate = bitrate;
+    _recordingStartTime = VROTimeCurrentSeconds();
+    _lastFrameTime = 0;
+    _frameIntervalAverage = 0;
+    _submitTimeAverage = 0;
+    _encodeInterval = 1;
+    _framesSinceEncode = 0;
+    _framesSinceAdapt = 0;
+    return true;
+}
+
+void VROAVRecorderAndroid::closeEncoder() {
+    if (_encoder) {
+        _encoder->close();
+        _encoder.reset();
+    }
+}
+
+void VROAVRecorderAndroid::adaptEncoder(double now) {
+    if (_lastFrameTime > 0) {
+        _frameIntervalAverage += ((now - _lastFrameTime) - _frameIntervalAverage) * kAverageWeight;
+    }
+    _lastFrameTime = now;
+    if (++_framesSinceAdapt < kAdaptIntervalFrames) {
+        return;
+    }
+    _framesSinceAdapt = 0;
+
+    int bitrate = _encoder->getBitrate();
+    int minBitrate = (int) (_encoderBitrate * kMinBitrateFraction);
+
+    bool tight = _frameIntervalAverage > kFrameBudgetSeconds || _submitTimeAverage > kMaxSubmitSeconds;
+    bool relaxed = _frameIntervalAverage < kFrameBudgetSeconds * 0.8 && _submitTimeAverage < kMaxSubmitSeconds * 0.5;
+
+    // Shed bitrate first, since skipped frames are more noticeable; recover in the
+    // opposite order
+    if (tight) {
+        if (bitrate > minBitrate) {
+            _encoder->setBitrate(std::max(minBitrate, (int) (bitrate * kBitrateStep)));
+        } else if (_encodeInterval < kMaxEncodeInterval) {
+            _encodeInterval++;
+        }
+    } else if (relaxed) {
+        if (_encodeInterval > 1) {
+            _encodeInterval--;
+        } else if (bitrate < _encoderBitrate) {
+            _encoder->setBitrate(std::min(_encoderBitrate, (int) (bitrate / kBitrateStep)));
+        }
+    }
+}
+
+void VROAVRecorderAndroid::copyFrame(std::shared_ptr<VRORenderTarget> input, int width, int height) {
+    input->bindRead();
+    GL( glReadBuffer(GL_COLOR_ATTACHMENT0) );
+    GL( glBlitFramebuffer(0, 0, input->getWidth(), input->getHeight(), 0, 0, width, height,
+                          GL_COLOR_BUFFER_BIT, GL_LINEAR) );
+}
+
+#pragma mark - Screenshots
+
+void VROAVRecorderAndroid::readScreenshot(std::shared_ptr<VRORenderTarget> input) {
+    ScreenshotReadback readback;
+    readback.width = input->getWidth();
+    readback.height = input->getHeight();
+
+    if (!_freeScreenshotBuffers.empty()) {
+        readback.buffer = _freeScreenshotBuffers.back();
+        _freeScreenshotBuffers.pop_back();
+    } else {
+        GL( glGenBuffers(1, &readback.buffer) );
+    }
+
+    // Reading into a pixel buffer returns immediately; the copy happens on the GPU's
+    // timeline, and the fence marks its completion
+    GL( glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer) );
+    GL( glBufferData(GL_PIXEL_PACK_BUFFER, readback.width * readback.height * 4, nullptr, GL_STREAM_READ) );
+    GL( glPixelStorei(GL_PACK_ALIGNMENT, 4) );
+    GL( glReadPixels(0, 0, readback.width, readback.height, GL_RGBA, GL_UNSIGNED_BYTE, 0) );
+    GL( glBindBuffer(GL_PIXEL_PACK_BUFFER, 0) );
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    _screenshotReadbacks.push_back(readback);
+}
+
+void VROAVRecorderAndroid::deliverScreenshots() {
+    while (!_screenshotReadbacks.empty()) {
+        ScreenshotReadback readback = _screenshotReadbacks.front();
+        GLenum status = glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (status == GL_TIMEOUT_EXPIRED) {
+            break;
+        }
+        _screenshotReadbacks.pop_front();
+        glDeleteSync(readback.fence);
+
+        GL( glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer) );
+        int length = readback.width * readback.height * 4;
+        void *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, length, GL_MAP_READ_BIT);
+
+        // The Java side copies the pixels out during the callback, so they are handed
+        // over while still mapped
         std::shared_ptr<MediaRecorder_JNI> jRecorder = _w_mediaRecorderJNI.lock();
-        if (jRecorder) {
-            passert (driver->getRenderTarget() == input);
-
-            // The input target is LDR and has already been tone-mapped, but may need gamma correction.
-            // We need gamma correction if we're in linear color space.
-            if (driver->getColorRenderingMode() == VROColorRenderingMode::Linear) {
-                std::shared_ptr<VRORenderTarget> ldrTarget = bindScreenshotLDRTarget(input->getWidth(), input->getHeight(), driver);
-                getGammaPostProcess(driver)->blit({ input->getTexture(0) }, driver);
-                ldrTarget->bindRead();
+        if (pixels != nullptr) {
+            if (jRecorder) {
+                jRecorder->onTakeScreenshot(pixels, length, readback.width, readback.height);
             }
-            // Otherwise we can perform a direct read or blit
-            else {
-                input->bindRead();
-            }
-
-            // This will call glReadPixels up in Java, reading from the currently bound (READ) framebuffer
-            jRecorder->onTakeScreenshot();
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        } else {
+            pwarn("Failed to map screenshot pixels");
         }
-        _scheduledScreenShot = false;
+        GL( glBindBuffer(GL_PIXEL_PACK_BUFFER, 0) );
+        _freeScreenshotBuffers.push_back(readback.buffer);
     }
-    return true;
 }
 
+#pragma mark - Recording Surface
+
 void VROAVRecorderAndroid::bindToEglSurface() {
+    if (_encoding && _encoder) {
+        _encoder->bindInputSurface();
+        return;
+    }
     std::shared_ptr<MediaRecorder_JNI> jRecorder = _w_mediaRecorderJNI.lock();
     if (!jRecorder) {
         return;
@@ -124,6 +349,10 @@ void VROAVRecorderAndroid::bindToEglSurface() {
 }
 
 void VROAVRecorderAndroid::unbindFromEGLSurface() {
+    // The encoder restores the previous surfaces when the frame is submitted
+    if (_encoding && _encoder) {
+        return;
+    }
     std::shared_ptr<MediaRecorder_JNI> jRecorder = _w_mediaRecorderJNI.lock();
     if (!jRecorder) {
         return;
@@ -133,6 +362,11 @@ void VROAVRecorderAndroid::unbindFromEGLSurface() {
 }
 
 void VROAVRecorderAndroid::eglSwap() {
+    if (_encoding && _encoder) {
+        double submitTime = _encoder->submitFrame(VROTimeCurrentSeconds() - _recordingStartTime);
+        _submitTimeAverage += (submitTime - _submitTimeAverage) * kAverageWeight;
+        return;
+    }
     std::shared_ptr<MediaRecorder_JNI> jRecorder = _w_mediaRecorderJNI.lock();
     if (!jRecorder) {
         return;
@@ -150,7 +384,7 @@ std::shared_ptr<VRORenderTarget> VROAVRecorderAndroid::bindScreenshotLDRTarget(i
     _screenshotLDRTarget->setViewport({0, 0, width, height});
     _screenshotLDRTarget->hydrate();
 
-    driver->bindRenderTarget(_screenshotLDRTarget, VRORenderTargetUnbindOp::Invalidate);
+    driver->bindRenderTarget(_screenshotLDRTarget, VRORenderTargetActions::clearAll(), VRORenderTargetUnbindOp::Invalidate);
     return _screenshotLDRTarget;
 }
 
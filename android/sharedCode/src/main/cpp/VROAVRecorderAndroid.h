@@ -26,6 +26,7 @@
 #ifndef VRO_AVRECORDER_ANDROID_H
 #define VRO_AVRECORDER_ANDROID_H
 
+#include <deque>
 #include "VROVideoTexture.h"
 #include "VROOpenGL.h"
 
@@ -35,6 +36,7 @@ class VRORecorderEglSurfaceDisplay;
 class MediaRecorder_JNI;
 class VRORenderTarget;
 class VRORenderToTextureDelegateAndroid;
+class VROVideoEncoderMediaCodec;
 
 /*
  VROAVRecorderAndroid contains the native implementation of ViroMediaRecorder.java that
@@ -56,6 +58,21 @@ public:
 
     void scheduleScreenCapture();
 
+    /*
+     Record subsequent videos natively to the MP4 file at the given path, at the given
+     target bitrate, instead of to the surface provided by ViroMediaRecorder.java.
+     Frames are then encoded straight from the render thread into an AMediaCodec
+     input surface. An empty path reverts to the Java surface. Falls back to the Java
+     surface on devices without encoder input surfaces (API 26).
+     */
+    void setVideoEncoderOutput(std::string path, int bitrate);
+
+    /*
+     True while a screenshot has been read back but not yet delivered; the render
+     to texture delegate must remain installed until it is.
+     */
+    bool hasPendingScreenCapture() const { return _scheduledScreenShot || !_screenshotReadbacks.empty(); }
+
     /*
      True if this recorder is currently recording video.
      */
@@ -76,7 +93,9 @@ public:
                                 std::shared_ptr<VRODriver> driver);
 
     /*
-     Binds and unbinds the underlying egl _recorderDisplay for recording.
+     Binds and unbinds the underlying egl _recorderDisplay for recording. This is the
+     native encoder's input surface when encoding natively, and the Java surface
+     otherwise.
      */
     void bindToEglSurface();
 
@@ -89,6 +108,18 @@ public:
     void eglSwap();
 
 private:
+
+    /*
+     A screenshot being read back asynchronously: glReadPixels writes into the pixel
+     buffer, and the fence tells us when the GPU is done so it can be mapped without
+     stalling.
+     */
+    struct ScreenshotReadback {
+        GLuint buffer;
+        GLsync fence;
+        int width, height;
+    };
+
     /*
      True if a video recording currently occurring and we are binding egl surfaces and swapping them.
      */
@@ -127,6 +158,32 @@ private:
      */
     std::shared_ptr<VROImagePostProcess> _gammaPostProcess;
 
+    /*
+     The native encoder, and its output file and target bitrate. The encoder is opened
+     on the first frame of each recording, once the frame size is known. When its
+     submissions block or the frame interval stretches past the budget, the bitrate
+     is stepped down toward kMinBitrateFraction of the target, and then frames are
+     skipped; both recover as the pressure clears.
+     */
+    std::unique_ptr<VROVideoEncoderMediaCodec> _encoder;
+    std::string _encoderPath;
+    int _encoderBitrate;
+    double _recordingStartTime;
+    double _lastFrameTime;
+    double _frameIntervalAverage;
+    double _submitTimeAverage;
+    int _encodeInterval;
+    int _framesSinceEncode;
+    int _framesSinceAdapt;
+    bool _encoding;
+
+    /*
+     Screenshots read back but not yet delivered (oldest first), and recycled
+     pixel buffers.
+     */
+    std::deque<ScreenshotReadback> _screenshotReadbacks;
+    std::vector<GLuint> _freeScreenshotBuffers;
+
     /*
      Weak reference to the native-to-java jni interface for triggering java callbacks.
      */
@@ -143,6 +200,28 @@ private:
      */
     std::shared_ptr<VROImagePostProcess> getGammaPostProcess(std::shared_ptr<VRODriver> driver);
 
+    /*
+     Write the given frame to the recording, through the native encoder if there is
+     one and the Java surface otherwise.
+     */
+    void recordFrame(std::shared_ptr<VRORenderTarget> input, std::shared_ptr<VRODriver> driver);
+    bool openEncoder(int width, int height);
+    void closeEncoder();
+    void adaptEncoder(double now);
+
+    /*
+     Copy the color of the given target to the currently bound draw framebuffer, with
+     a framebuffer blit rather than a draw.
+     */
+    void copyFrame(std::shared_ptr<VRORenderTarget> input, int width, int height);
+
+    /*
+     Queue an asynchronous read of the framebuffer bound for reading, which has the
+     size of the given target, and deliver the reads the GPU has finished.
+     */
+    void readScreenshot(std::shared_ptr<VRORenderTarget> input);
+    void deliverScreenshots();
+
 };
 
 #endif //VRO_AVRECORDER_ANDROID_H
@@ -59,7 +59,7 @@ public:
         /*
          Prevent logical buffer load by immediately clearing.
          */
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+        glClear(getLoadClearMask(true));
     }
 
     void setFrameBuffer(ovrFramebuffer *framebuffer) {
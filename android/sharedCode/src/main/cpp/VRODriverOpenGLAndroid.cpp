@@ -34,6 +34,7 @@
 // See here: https://github.com/android-ndk/ndk/issues/533#issuecomment-335977747
 VRODriverOpenGLAndroid::VRODriverOpenGLAndroid(std::shared_ptr<gvr::AudioApi> gvrAudio) :
         _gvrAudio(gvrAudio),
+        _voiceManager(std::make_shared<VROSoundVoiceManager>()),
         _ft(nullptr) {
 }
 
@@ -28,6 +28,7 @@
 #define ANDROID_VRODRIVEROPENGLANDROID_H
 
 #include <VROSoundGVR.h>
+#include "VROSoundVoiceManager.h"
 #include "VRODriverOpenGL.h"
 #include "VROLog.h"
 #include "VROGVRUtil.h"
@@ -37,6 +38,8 @@
 #include "VROPlatformUtil.h"
 #include "VROStringUtil.h"
 #include "VROTypefaceCollection.h"
+#include "VROIBLCache.h"
+#include "VROGeometryCache.h"
 
 class VRODriverOpenGLAndroid : public VRODriverOpenGL {
 
@@ -68,7 +71,29 @@ public:
         }
     }
 
+    virtual std::shared_ptr<VROShaderBinaryCache> getShaderBinaryCache() {
+        if (!_shaderBinaryCache) {
+            _shaderBinaryCache = std::make_shared<VROShaderBinaryCache>(VROPlatformGetCacheDirectory() + "/viro_shaders");
+        }
+        return _shaderBinaryCache;
+    }
+
+    virtual std::shared_ptr<VROIBLCache> getIBLCache() {
+        if (!_iblCache) {
+            _iblCache = std::make_shared<VROIBLCache>(VROPlatformGetCacheDirectory() + "/viro_ibl");
+        }
+        return _iblCache;
+    }
+
+    virtual std::shared_ptr<VROGeometryCache> getGeometryCache() {
+        if (!_geometryCache) {
+            _geometryCache = std::make_shared<VROGeometryCache>(VROPlatformGetCacheDirectory() + "/viro_geometry");
+        }
+        return _geometryCache;
+    }
+
     void willRenderFrame(const VRORenderContext &context) {
+        _voiceManager->updateVoices(context.getCamera().getPosition());
         _gvrAudio->SetHeadPose(VROGVRUtil::toGVRMat4f(context.getCamera().getLookAtMatrix()));
         _gvrAudio->Update();
 
@@ -89,11 +114,11 @@ public:
     }
 
     std::shared_ptr<VROSound> newSound(std::shared_ptr<VROSoundData> data, VROSoundType type) {
-        return VROSoundGVR::create(data, _gvrAudio, type);
+        return VROSoundGVR::create(data, _gvrAudio, type, _voiceManager);
     }
 
     std::shared_ptr<VROSound> newSound(std::string resource, VROResourceType resourceType, VROSoundType type) {
-        return VROSoundGVR::create(resource, resourceType, _gvrAudio, type);
+        return VROSoundGVR::create(resource, resourceType, _gvrAudio, type, _voiceManager);
     }
 
     std::shared_ptr<VROAudioPlayer> newAudioPlayer(std::shared_ptr<VROSoundData> data) {
@@ -182,7 +207,11 @@ private:
 
     bool _sRGBFramebuffer;
     std::shared_ptr<gvr::AudioApi> _gvrAudio;
+    std::shared_ptr<VROSoundVoiceManager> _voiceManager;
     FT_Library _ft;
+    std::shared_ptr<VROShaderBinaryCache> _shaderBinaryCache;
+    std::shared_ptr<VROIBLCache> _iblCache;
+    std::shared_ptr<VROGeometryCache> _geometryCache;
 
 
 };
@@ -0,0 +1,417 @@
+//
+//  VROFramePacerAndroid.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROFramePacerAndroid.h"
+#include "VROPlatformUtil.h"
+#include "VROTime.h"
+#include "VROLog.h"
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <android/looper.h>
+#include <android/native_window_jni.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Vsync period assumed until the first vsyncs are measured
+static const int64_t kDefaultVsyncPeriodNs = 16666667;
+
+// The vsync thread stops listening to vsync once no frame has begun for this long
+static const int64_t kVsyncIdleTimeoutNs = 250000000;
+
+// Weight of each new vsync interval in the measured period, when the refresh rate
+// is not reported directly
+static const double kVsyncPeriodSmoothing = 0.1;
+
+// Relative change in the target work duration that is reported to the hint session
+static const double kHintTargetTolerance = 0.05;
+
+#pragma mark - Runtime Functions
+
+struct AChoreographer;
+struct APerformanceHintManager;
+
+// AChoreographer, ANativeWindow_setFrameRate and APerformanceHint are newer than our
+// minimum API level, so these are resolved at runtime
+typedef void (*VRO_PFN_AChoreographer_frameCallback)(long frameTimeNanos, void *data);
+typedef void (*VRO_PFN_AChoreographer_frameCallback64)(int64_t frameTimeNanos, void *data);
+typedef void (*VRO_PFN_AChoreographer_refreshRateCallback)(int64_t vsyncPeriodNanos, void *data);
+
+typedef AChoreographer *(*VRO_PFN_AChoreographer_getInstance)();
+typedef void (*VRO_PFN_AChoreographer_postFrameCallback)(AChoreographer *choreographer,
+                                                          VRO_PFN_AChoreographer_frameCallback callback, void *data);
+typedef void (*VRO_PFN_AChoreographer_postFrameCallback64)(AChoreographer *choreographer,
+                                                            VRO_PFN_AChoreographer_frameCallback64 callback, void *data);
+typedef void (*VRO_PFN_AChoreographer_registerRefreshRateCallback)(AChoreographer *choreographer,
+                                                                    VRO_PFN_AChoreographer_refreshRateCallback callback, void *data);
+typedef void (*VRO_PFN_AChoreographer_unregisterRefreshRateCallback)(AChoreographer *choreographer,
+                                                                      VRO_PFN_AChoreographer_refreshRateCallback callback, void *data);
+typedef int32_t (*VRO_PFN_ANativeWindow_setFrameRate)(ANativeWindow *window, float frameRate, int8_t compatibility);
+typedef APerformanceHintManager *(*VRO_PFN_APerformanceHint_getManager)();
+typedef APerformanceHintSession *(*VRO_PFN_APerformanceHint_createSession)(APerformanceHintManager *manager,
+                                                                          const int32_t *threadIds, size_t size,
+                                                                          int64_t initialTargetWorkDurationNanos);
+typedef int (*VRO_PFN_APerformanceHint_updateTargetWorkDuration)(APerformanceHintSession *session,
+                                                                 int64_t targetDurationNanos);
+typedef int (*VRO_PFN_APerformanceHint_reportActualWorkDuration)(APerformanceHintSession *session,
+                                                                 int64_t actualDurationNanos);
+typedef void (*VRO_PFN_APerformanceHint_closeSession)(APerformanceHintSession *session);
+
+static VRO_PFN_AChoreographer_getInstance                   sAChoreographerGetInstance = nullptr;
+static VRO_PFN_AChoreographer_postFrameCallback             sAChoreographerPostFrameCallback = nullptr;
+static VRO_PFN_AChoreographer_postFrameCallback64           sAChoreographerPostFrameCallback64 = nullptr;
+static VRO_PFN_AChoreographer_registerRefreshRateCallback   sAChoreographerRegisterRefreshRateCallback = nullptr;
+static VRO_PFN_AChoreographer_unregisterRefreshRateCallback sAChoreographerUnregisterRefreshRateCallback = nullptr;
+static VRO_PFN_ANativeWindow_setFrameRate                   sANativeWindowSetFrameRate = nullptr;
+static VRO_PFN_APerformanceHint_getManager                  sAPerformanceHintGetManager = nullptr;
+static VRO_PFN_APerformanceHint_createSession               sAPerformanceHintCreateSession = nullptr;
+static VRO_PFN_APerformanceHint_updateTargetWorkDuration    sAPerformanceHintUpdateTargetWorkDuration = nullptr;
+static VRO_PFN_APerformanceHint_reportActualWorkDuration    sAPerformanceHintReportActualWorkDuration = nullptr;
+static VRO_PFN_APerformanceHint_closeSession                sAPerformanceHintCloseSession = nullptr;
+
+static PFNEGLPRESENTATIONTIMEANDROIDPROC sEglPresentationTime = nullptr;
+static bool sPresentationTimeSupported = false;
+
+static void loadFunctions() {
+    static std::once_flag loaded;
+    std::call_once(loaded, [] {
+        void *library = dlopen("libandroid.so", RTLD_NOW);
+        if (library != nullptr) {
+            sAChoreographerGetInstance                   = (VRO_PFN_AChoreographer_getInstance)                   dlsym(library, "AChoreographer_getInstance");
+            sAChoreographerPostFrameCallback             = (VRO_PFN_AChoreographer_postFrameCallback)             dlsym(library, "AChoreographer_postFrameCallback");
+            sAChoreographerPostFrameCallback64           = (VRO_PFN_AChoreographer_postFrameCallback64)           dlsym(library, "AChoreographer_postFrameCallback64");
+            sAChoreographerRegisterRefreshRateCallback   = (VRO_PFN_AChoreographer_registerRefreshRateCallback)   dlsym(library, "AChoreographer_registerRefreshRateCallback");
+            sAChoreographerUnregisterRefreshRateCallback = (VRO_PFN_AChoreographer_unregisterRefreshRateCallback) dlsym(library, "AChoreographer_unregisterRefreshRateCallback");
+            sAPerformanceHintGetManager                  = (VRO_PFN_APerformanceHint_getManager)                  dlsym(library, "APerformanceHint_getManager");
+            sAPerformanceHintCreateSession               = (VRO_PFN_APerformanceHint_createSession)               dlsym(library, "APerformanceHint_createSession");
+            sAPerformanceHintUpdateTargetWorkDuration    = (VRO_PFN_APerformanceHint_updateTargetWorkDuration)    dlsym(library, "APerformanceHint_updateTargetWorkDuration");
+            sAPerformanceHintReportActualWorkDuration    = (VRO_PFN_APerformanceHint_reportActualWorkDuration)    dlsym(library, "APerformanceHint_reportActualWorkDuration");
+            sAPerformanceHintCloseSession                = (VRO_PFN_APerformanceHint_closeSession)                dlsym(library, "APerformanceHint_closeSession");
+        }
+
+        void *nativeWindow = dlopen("libnativewindow.so", RTLD_NOW);
+        if (nativeWindow != nullptr) {
+            sANativeWindowSetFrameRate = (VRO_PFN_ANativeWindow_setFrameRate) dlsym(nativeWindow, "ANativeWindow_setFrameRate");
+        }
+
+        // The frame time of the legacy callback is a long, which only holds a full
+        // timestamp on 64-bit devices
+        if (sizeof(long) < sizeof(int64_t)) {
+            sAChoreographerPostFrameCallback = nullptr;
+        }
+    });
+}
+
+static void loadEGLFunctions() {
+    static std::once_flag loaded;
+    std::call_once(loaded, [] {
+        const char *extensions = eglQueryString(eglGetCurrentDisplay(), EGL_EXTENSIONS);
+        sEglPresentationTime = (PFNEGLPRESENTATIONTIMEANDROIDPROC) eglGetProcAddress("eglPresentationTimeANDROID");
+        sPresentationTimeSupported = extensions != nullptr && strstr(extensions, "EGL_ANDROID_presentation_time") != nullptr &&
+                                     sEglPresentationTime != nullptr;
+    });
+}
+
+#pragma mark - Initialization
+
+VROFramePacerAndroid::VROFramePacerAndroid() :
+    _targetFrameRate(0),
+    _swapInterval(1),
+    _eglSwapInterval(1),
+    _lastVsyncNs(0),
+    _vsyncPeriodNs(kDefaultVsyncPeriodNs),
+    _lastFrameBeginNs(0),
+    _looper(nullptr),
+    _running(false),
+    _callbackPosted(false),
+    _lastPresentNs(0),
+    _frameBeginNs(0),
+    _window(nullptr),
+    _hintSession(nullptr),
+    _hintTargetNs(0),
+    _hintSessionFailed(false) {
+
+    loadFunctions();
+    if (sAChoreographerGetInstance && (sAChoreographerPostFrameCallback64 || sAChoreographerPostFrameCallback)) {
+        _running = true;
+        _vsyncThread = std::thread(&VROFramePacerAndroid::runVsyncLoop, this);
+    } else {
+        pinfo("AChoreographer unavailable: frames will not be paced to vsync");
+    }
+}
+
+VROFramePacerAndroid::~VROFramePacerAndroid() {
+    if (_vsyncThread.joinable()) {
+        _running = false;
+        {
+            std::lock_guard<std::mutex> lock(_looperMutex);
+            if (_looper) {
+                ALooper_wake(_looper);
+            }
+        }
+        _vsyncThread.join();
+    }
+    if (_hintSession) {
+        sAPerformanceHintCloseSession(_hintSession);
+    }
+    if (_window) {
+        ANativeWindow_release(_window);
+    }
+}
+
+#pragma mark - Vsync Thread
+
+void VROFramePacerAndroid::runVsyncLoop() {
+    pthread_setname_np(pthread_self(), "Viro Vsync");
+
+    ALooper *looper = ALooper_prepare(0);
+    AChoreographer *choreographer = sAChoreographerGetInstance();
+    if (!choreographer) {
+        pwarn("Failed to get AChoreographer: frames will not be paced to vsync");
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(_looperMutex);
+        ALooper_acquire(looper);
+        _looper = looper;
+    }
+    if (sAChoreographerRegisterRefreshRateCallback) {
+        sAChoreographerRegisterRefreshRateCallback(choreographer, &VROFramePacerAndroid::onRefreshRateCallback, this);
+    }
+
+    // Vsync callbacks are only requested while frames are being rendered; beginFrame()
+    // wakes the looper when rendering resumes
+    while (_running) {
+        if (!_callbackPosted && (int64_t) VRONanoTime() - _lastFrameBeginNs.load() < kVsyncIdleTimeoutNs) {
+            postVsyncCallback(choreographer);
+        }
+        ALooper_pollOnce(-1, nullptr, nullptr, nullptr);
+    }
+
+    if (sAChoreographerUnregisterRefreshRateCallback) {
+        sAChoreographerUnregisterRefreshRateCallback(choreographer, &VROFramePacerAndroid::onRefreshRateCallback, this);
+    }
+    {
+        std::lock_guard<std::mutex> lock(_looperMutex);
+        _looper = nullptr;
+        ALooper_release(looper);
+    }
+}
+
+void VROFramePacerAndroid::postVsyncCallback(void *choreographer) {
+    AChoreographer *c = (AChoreographer *) choreographer;
+    if (sAChoreographerPostFrameCallback64) {
+        sAChoreographerPostFrameCallback64(c, &VROFramePacerAndroid::onVsyncCallback, this);
+    } else {
+        sAChoreographerPostFrameCallback(c, &VROFramePacerAndroid::onVsyncCallbackLegacy, this);
+    }
+    _callbackPosted = true;
+}
+
+void VROFramePacerAndroid::onVsyncCallback(int64_t frameTimeNanos, void *data) {
+    ((VROFramePacerAndroid *) data)->onVsync(frameTimeNanos);
+}
+
+void VROFramePacerAndroid::onVsyncCallbackLegacy(long frameTimeNanos, void *data) {
+    ((VROFramePacerAndroid *) data)->onVsync((int64_t) frameTimeNanos);
+}
+
+void VROFramePacerAndroid::onRefreshRateCallback(int64_t vsyncPeriodNanos, void *data) {
+    ((VROFramePacerAndroid *) data)->onRefreshRateChanged(vsyncPeriodNanos);
+}
+
+void VROFramePacerAndroid::onVsync(int64_t frameTimeNanos) {
+    _callbackPosted = false;
+
+    // Without refresh rate callbacks, measure the period from consecutive vsyncs,
+    // ignoring the gaps left by missed or unrequested callbacks
+    int64_t last = _lastVsyncNs.load();
+    if (!sAChoreographerRegisterRefreshRateCallback && last > 0) {
+        int64_t period = _vsyncPeriodNs.load();
+        int64_t interval = frameTimeNanos - last;
+        if (interval > 0 && interval < period * 3 / 2) {
+            _vsyncPeriodNs = (int64_t) (period + (interval - period) * kVsyncPeriodSmoothing);
+        }
+    }
+    _lastVsyncNs = frameTimeNanos;
+
+    if (_running && (int64_t) VRONanoTime() - _lastFrameBeginNs.load() < kVsyncIdleTimeoutNs) {
+        postVsyncCallback(sAChoreographerGetInstance());
+    }
+}
+
+void VROFramePacerAndroid::onRefreshRateChanged(int64_t vsyncPeriodNanos) {
+    if (vsyncPeriodNanos > 0) {
+        pinfo("Display refresh rate changed to %.1f Hz", 1e9 / (double) vsyncPeriodNanos);
+        _vsyncPeriodNs = vsyncPeriodNanos;
+    }
+}
+
+#pragma mark - Frame Rate
+
+void VROFramePacerAndroid::setTargetFrameRate(int fps) {
+    fps = std::max(0, fps);
+    if (fps == _targetFrameRate) {
+        return;
+    }
+    _targetFrameRate = fps;
+    _lastPresentNs = 0;
+
+    updateSwapInterval();
+    applyFrameRate();
+}
+
+void VROFramePacerAndroid::setSurface(jobject surface) {
+    if (_window) {
+        ANativeWindow_release(_window);
+        _window = nullptr;
+    }
+    if (surface != nullptr && sANativeWindowSetFrameRate) {
+        _window = ANativeWindow_fromSurface(VROPlatformGetJNIEnv(), surface);
+    }
+    _lastPresentNs = 0;
+    applyFrameRate();
+}
+
+void VROFramePacerAndroid::applyFrameRate() {
+    if (!_window || !sANativeWindowSetFrameRate) {
+        return;
+    }
+    // Compatibility 0 is ANATIVEWINDOW_FRAME_RATE_COMPATIBILITY_DEFAULT; a rate of
+    // zero clears our preference
+    int32_t result = sANativeWindowSetFrameRate(_window, (float) _targetFrameRate, 0);
+    if (result != 0) {
+        pwarn("Failed to set surface frame rate to %d [error %d]", _targetFrameRate, result);
+    }
+}
+
+void VROFramePacerAndroid::updateSwapInterval() {
+    if (_targetFrameRate <= 0) {
+        _swapInterval = 1;
+        return;
+    }
+    double displayRate = 1e9 / (double) _vsyncPeriodNs.load();
+    _swapInterval = std::max(1, (int) std::round(displayRate / _targetFrameRate));
+}
+
+#pragma mark - Frames
+
+void VROFramePacerAndroid::beginFrame() {
+    _frameBeginNs = (int64_t) VRONanoTime();
+
+    // Wake the vsync thread if it stopped listening while we were idle
+    int64_t lastBegin = _lastFrameBeginNs.exchange(_frameBeginNs);
+    if (_frameBeginNs - lastBegin >= kVsyncIdleTimeoutNs) {
+        std::lock_guard<std::mutex> lock(_looperMutex);
+        if (_looper) {
+            ALooper_wake(_looper);
+        }
+        _lastPresentNs = 0;
+    }
+    updateSwapInterval();
+}
+
+void VROFramePacerAndroid::endFrame() {
+    int64_t now = (int64_t) VRONanoTime();
+    updateHintSession(now - _frameBeginNs);
+
+    loadEGLFunctions();
+    EGLDisplay display = eglGetCurrentDisplay();
+    EGLSurface surface = eglGetCurrentSurface(EGL_DRAW);
+    if (display == EGL_NO_DISPLAY || surface == EGL_NO_SURFACE) {
+        return;
+    }
+
+    if (sPresentationTimeSupported) {
+        int64_t target = computePresentationTime(now);
+        if (target > 0) {
+            // Request half a period early so small timing errors do not slip the
+            // frame to the following vsync
+            sEglPresentationTime(display, surface, (EGLnsecsANDROID) (target - _vsyncPeriodNs.load() / 2));
+        }
+    } else if (_swapInterval != _eglSwapInterval) {
+        eglSwapInterval(display, _swapInterval);
+        _eglSwapInterval = _swapInterval;
+    }
+}
+
+int64_t VROFramePacerAndroid::computePresentationTime(int64_t now) {
+    int64_t vsync = _lastVsyncNs.load();
+    int64_t period = _vsyncPeriodNs.load();
+    if (vsync <= 0 || period <= 0) {
+        return 0;
+    }
+
+    // The first vsync at which this frame could be displayed
+    int64_t next = vsync + (std::max((int64_t) 0, now - vsync) / period + 1) * period;
+
+    // Hold the frame until swapInterval vsyncs after the previous frame, snapped to
+    // the vsync grid. If we have fallen behind, or queued too far ahead (e.g. after
+    // the rate changed), present at the next vsync and pace from there.
+    int64_t target = next;
+    if (_lastPresentNs > 0) {
+        int64_t earliest = _lastPresentNs + _swapInterval * period;
+        int64_t snapped = vsync + (int64_t) std::llround((double) (earliest - vsync) / (double) period) * period;
+        if (snapped > next && snapped <= next + _swapInterval * period) {
+            target = snapped;
+        }
+    }
+    _lastPresentNs = target;
+    return target;
+}
+
+void VROFramePacerAndroid::updateHintSession(int64_t frameWorkNs) {
+    if (_hintSessionFailed || frameWorkNs <= 0) {
+        return;
+    }
+
+    int64_t targetNs = _swapInterval * _vsyncPeriodNs.load();
+    if (!_hintSession) {
+        if (!sAPerformanceHintGetManager || !sAPerformanceHintCreateSession ||
+            !sAPerformanceHintUpdateTargetWorkDuration || !sAPerformanceHintReportActualWorkDuration ||
+            !sAPerformanceHintCloseSession) {
+            _hintSessionFailed = true;
+            return;
+        }
+        APerformanceHintManager *manager = sAPerformanceHintGetManager();
+        int32_t tid = gettid();
+        _hintSession = manager ? sAPerformanceHintCreateSession(manager, &tid, 1, targetNs) : nullptr;
+        if (!_hintSession) {
+            pinfo("Performance hint sessions unavailable");
+            _hintSessionFailed = true;
+            return;
+        }
+        _hintTargetNs = targetNs;
+    }
+
+    if (std::abs(targetNs - _hintTargetNs) > _hintTargetNs * kHintTargetTolerance) {
+        sAPerformanceHintUpdateTargetWorkDuration(_hintSession, targetNs);
+        _hintTargetNs = targetNs;
+    }
+    sAPerformanceHintReportActualWorkDuration(_hintSession, frameWorkNs);
+}
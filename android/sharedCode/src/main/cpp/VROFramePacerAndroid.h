@@ -0,0 +1,174 @@
+//
+//  VROFramePacerAndroid.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef ANDROID_VROFRAMEPACERANDROID_H
+#define ANDROID_VROFRAMEPACERANDROID_H
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <jni.h>
+
+struct ALooper;
+struct ANativeWindow;
+struct APerformanceHintSession;
+
+/*
+ Paces the frames of a GLSurfaceView-driven renderer to the display's vsync.
+
+ A background thread listens to AChoreographer to track the phase and period of
+ vsync. Each frame is then stamped with an EGL presentation time on the vsync
+ grid, so that frames are composited at an even cadence even when their render
+ time varies, and so that frame rates below the display's refresh rate (e.g. 60
+ FPS on a 120 Hz panel) present every N vsyncs instead of judder between
+ intervals. The target frame rate is also passed to the surface, so the display
+ can switch to a matching refresh rate.
+
+ On devices that support ADPF, the CPU work of each frame is reported to a
+ performance hint session for the rendering thread, so the CPU governor keeps
+ the thread on cores fast enough to meet the target.
+
+ Each facility is loaded at runtime and is skipped when unavailable: AChoreographer
+ requires API 24, ANativeWindow_setFrameRate API 30, and APerformanceHint API 33.
+ All functions other than the constructor and destructor must be invoked on the
+ rendering thread.
+ */
+class VROFramePacerAndroid {
+public:
+
+    VROFramePacerAndroid();
+    virtual ~VROFramePacerAndroid();
+
+    /*
+     Set the target frame rate in frames per second. Zero (the default) targets
+     the display's refresh rate. Rates above the refresh rate are clamped to it.
+     */
+    void setTargetFrameRate(int fps);
+    int getTargetFrameRate() const {
+        return _targetFrameRate;
+    }
+
+    /*
+     Set the surface being rendered to, so the target frame rate can be passed
+     to it. Invoke whenever the surface changes.
+     */
+    void setSurface(jobject surface);
+
+    /*
+     Mark the start and end of the CPU work of a frame. endFrame() must be invoked
+     with the frame's EGL surface current, before it is swapped.
+     */
+    void beginFrame();
+    void endFrame();
+
+    /*
+     The measured vsync period of the display, in nanoseconds.
+     */
+    int64_t getVsyncPeriod() const {
+        return _vsyncPeriodNs.load();
+    }
+
+private:
+
+    /*
+     The frame rate requested by the user, zero for the display rate.
+     */
+    int _targetFrameRate;
+
+    /*
+     The number of vsyncs each frame is presented for.
+     */
+    int _swapInterval;
+
+    /*
+     The swap interval last set through eglSwapInterval, used only when presentation
+     times are unsupported.
+     */
+    int _eglSwapInterval;
+
+    /*
+     Vsync tracking, written by the vsync thread. The timestamp is that of the most
+     recent vsync, in the CLOCK_MONOTONIC time base.
+     */
+    std::atomic<int64_t> _lastVsyncNs;
+    std::atomic<int64_t> _vsyncPeriodNs;
+
+    /*
+     The time of the last beginFrame(), used by the vsync thread to stop listening
+     to vsync while the renderer is idle.
+     */
+    std::atomic<int64_t> _lastFrameBeginNs;
+
+    /*
+     The vsync thread and its looper, which is guarded by _looperMutex so the
+     destructor can wake it.
+     */
+    std::thread _vsyncThread;
+    std::mutex _looperMutex;
+    ALooper *_looper;
+    std::atomic<bool> _running;
+    bool _callbackPosted;
+
+    /*
+     The presentation time given to the last frame, or zero if there was no prior
+     frame to pace against.
+     */
+    int64_t _lastPresentNs;
+
+    /*
+     The start of the current frame's CPU work.
+     */
+    int64_t _frameBeginNs;
+
+    /*
+     The surface's window, retained so the frame rate can be re-applied when the
+     target changes.
+     */
+    ANativeWindow *_window;
+
+    /*
+     The ADPF performance hint session for the rendering thread, and the target
+     work duration last reported to it.
+     */
+    APerformanceHintSession *_hintSession;
+    int64_t _hintTargetNs;
+    bool _hintSessionFailed;
+
+    void runVsyncLoop();
+    void postVsyncCallback(void *choreographer);
+    void onVsync(int64_t frameTimeNanos);
+    void onRefreshRateChanged(int64_t vsyncPeriodNanos);
+    static void onVsyncCallback(int64_t frameTimeNanos, void *data);
+    static void onVsyncCallbackLegacy(long frameTimeNanos, void *data);
+    static void onRefreshRateCallback(int64_t vsyncPeriodNanos, void *data);
+
+    void updateSwapInterval();
+    void applyFrameRate();
+    void updateHintSession(int64_t frameWorkNs);
+    int64_t computePresentationTime(int64_t now);
+
+};
+
+#endif //ANDROID_VROFRAMEPACERANDROID_H
@@ -0,0 +1,482 @@
+//
+//  VROHardwareBufferFramePool.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROHardwareBufferFramePool.h"
+#include "VROLog.h"
+#include <android/hardware_buffer.h>
+#include <dlfcn.h>
+#include <unistd.h>
+#include <mutex>
+#include <algorithm>
+
+std::atomic<uint64_t> VROHardwareBufferFramePool::sNextFrameId(1);
+
+#pragma mark - Runtime Functions
+
+// AHardwareBuffer functions are resolved at runtime so we can run below API 26
+typedef int  (*VRO_PFN_AHardwareBuffer_allocate)(const AHardwareBuffer_Desc *desc, AHardwareBuffer **outBuffer);
+typedef void (*VRO_PFN_AHardwareBuffer_release)(AHardwareBuffer *buffer);
+
+static VRO_PFN_AHardwareBuffer_allocate sAHardwareBufferAllocate = nullptr;
+static VRO_PFN_AHardwareBuffer_release  sAHardwareBufferRelease = nullptr;
+
+static PFNEGLGETNATIVECLIENTBUFFERANDROIDPROC sEglGetNativeClientBuffer = nullptr;
+static PFNEGLCREATEIMAGEKHRPROC sEglCreateImage = nullptr;
+static PFNEGLDESTROYIMAGEKHRPROC sEglDestroyImage = nullptr;
+static PFNEGLCREATESYNCKHRPROC sEglCreateSync = nullptr;
+static PFNEGLDESTROYSYNCKHRPROC sEglDestroySync = nullptr;
+static PFNEGLDUPNATIVEFENCEFDANDROIDPROC sEglDupNativeFenceFD = nullptr;
+static PFNEGLWAITSYNCKHRPROC sEglWaitSync = nullptr;
+static PFNGLEGLIMAGETARGETTEXTURE2DOESPROC sGlEGLImageTargetTexture2D = nullptr;
+
+static bool sNativeFencesSupported = false;
+
+static bool hasExtension(const char *extensions, const char *extension) {
+    return extensions != nullptr && strstr(extensions, extension) != nullptr;
+}
+
+static void loadFunctions() {
+    static std::once_flag loaded;
+    std::call_once(loaded, [] {
+        void *library = dlopen("libnativewindow.so", RTLD_NOW);
+        if (library == nullptr) {
+            library = dlopen("libandroid.so", RTLD_NOW);
+        }
+        if (library != nullptr) {
+            sAHardwareBufferAllocate = (VRO_PFN_AHardwareBuffer_allocate) dlsym(library, "AHardwareBuffer_allocate");
+            sAHardwareBufferRelease  = (VRO_PFN_AHardwareBuffer_release)  dlsym(library, "AHardwareBuffer_release");
+        }
+
+        sEglGetNativeClientBuffer = (PFNEGLGETNATIVECLIENTBUFFERANDROIDPROC) eglGetProcAddress("eglGetNativeClientBufferANDROID");
+        sEglCreateImage = (PFNEGLCREATEIMAGEKHRPROC) eglGetProcAddress("eglCreateImageKHR");
+        sEglDestroyImage = (PFNEGLDESTROYIMAGEKHRPROC) eglGetProcAddress("eglDestroyImageKHR");
+        sEglCreateSync = (PFNEGLCREATESYNCKHRPROC) eglGetProcAddress("eglCreateSyncKHR");
+        sEglDestroySync = (PFNEGLDESTROYSYNCKHRPROC) eglGetProcAddress("eglDestroySyncKHR");
+        sEglDupNativeFenceFD = (PFNEGLDUPNATIVEFENCEFDANDROIDPROC) eglGetProcAddress("eglDupNativeFenceFDANDROID");
+        sEglWaitSync = (PFNEGLWAITSYNCKHRPROC) eglGetProcAddress("eglWaitSyncKHR");
+        sGlEGLImageTargetTexture2D = (PFNGLEGLIMAGETARGETTEXTURE2DOESPROC) eglGetProcAddress("glEGLImageTargetTexture2DOES");
+
+        const char *extensions = eglQueryString(eglGetCurrentDisplay(), EGL_EXTENSIONS);
+        sNativeFencesSupported = hasExtension(extensions, "EGL_ANDROID_native_fence_sync") &&
+                                 hasExtension(extensions, "EGL_KHR_wait_sync") &&
+                                 sEglCreateSync && sEglDestroySync && sEglDupNativeFenceFD && sEglWaitSync;
+    });
+}
+
+bool VROHardwareBufferFramePool::isSupported() {
+    loadFunctions();
+    return sAHardwareBufferAllocate && sAHardwareBufferRelease && sEglGetNativeClientBuffer &&
+           sEglCreateImage && sEglDestroyImage && sGlEGLImageTargetTexture2D;
+}
+
+#pragma mark - Capture Program
+
+static const float kQuadCoords[] = {
+        -1.0f, -1.0f,
+        -1.0f, +1.0f,
+        +1.0f, -1.0f,
+        +1.0f, +1.0f,
+};
+
+static const char *kCaptureVertexShader =
+        "attribute vec4 a_Position;\n"
+        "attribute vec2 a_TexCoord;\n"
+        "varying vec2 v_TexCoord;\n"
+        "void main() {\n"
+        "   gl_Position = a_Position;\n"
+        "   v_TexCoord = a_TexCoord;\n"
+        "}";
+
+static const char *kCaptureFragmentShader =
+        "#extension GL_OES_EGL_image_external : require\n"
+        "precision mediump float;\n"
+        "varying vec2 v_TexCoord;\n"
+        "uniform samplerExternalOES sTexture;\n"
+        "void main() {\n"
+        "    gl_FragColor = texture2D(sTexture, v_TexCoord);\n"
+        "}";
+
+static GLuint compileShader(GLenum type, const char *source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+
+    GLint compileStatus;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compileStatus);
+    if (compileStatus == 0) {
+        pwarn("Hardware buffer frame pool: failed to compile shader");
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+bool VROHardwareBufferFramePool::initProgram() {
+    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, kCaptureVertexShader);
+    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, kCaptureFragmentShader);
+    if (vertexShader == 0 || fragmentShader == 0) {
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        return false;
+    }
+
+    _program = glCreateProgram();
+    glAttachShader(_program, vertexShader);
+    glAttachShader(_program, fragmentShader);
+    glLinkProgram(_program);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    GLint linkStatus;
+    glGetProgramiv(_program, GL_LINK_STATUS, &linkStatus);
+    if (linkStatus == 0) {
+        pwarn("Hardware buffer frame pool: failed to link capture program");
+        return false;
+    }
+
+    _positionAttribute = glGetAttribLocation(_program, "a_Position");
+    _texcoordAttribute = glGetAttribLocation(_program, "a_TexCoord");
+    glUseProgram(_program);
+    glUniform1i(glGetUniformLocation(_program, "sTexture"), 0);
+    glUseProgram(0);
+    return true;
+}
+
+#pragma mark - Lifecycle
+
+VROHardwareBufferFramePool::VROHardwareBufferFramePool(int width, int height, int capacity,
+                                                       VROHardwareBufferFrameSource source) :
+    _width(width),
+    _height(height),
+    _source(source),
+    _initialized(false),
+    _display(EGL_NO_DISPLAY),
+    _frames(std::max(capacity, 1)),
+    _sequence(0),
+    _droppedFrames(0),
+    _program(0),
+    _positionAttribute(-1),
+    _texcoordAttribute(-1) {
+
+    for (Frame &frame : _frames) {
+        frame.buffer = nullptr;
+        frame.image = EGL_NO_IMAGE_KHR;
+        frame.texture = 0;
+        frame.framebuffer = 0;
+        frame.state = FrameState::Free;
+        frame.frameId = 0;
+        frame.sequence = 0;
+        frame.timestamp = 0;
+        frame.captureFenceFd = -1;
+        frame.captureFence = 0;
+        frame.releaseFenceFd = -1;
+    }
+    for (int i = 0; i < 8; i++) {
+        _texcoords[i] = 0;
+    }
+}
+
+VROHardwareBufferFramePool::~VROHardwareBufferFramePool() {
+    // Consumers still holding frames keep their own reference to the buffer
+    for (Frame &frame : _frames) {
+        destroyFrame(frame);
+    }
+    if (_program != 0) {
+        glDeleteProgram(_program);
+    }
+}
+
+bool VROHardwareBufferFramePool::init() {
+    if (!isSupported()) {
+        pwarn("Hardware buffer frame pool: AHardwareBuffer rendering is not supported on this device");
+        return false;
+    }
+    _display = eglGetCurrentDisplay();
+
+    for (Frame &frame : _frames) {
+        AHardwareBuffer_Desc desc = {};
+        desc.width = (uint32_t) _width;
+        desc.height = (uint32_t) _height;
+        desc.layers = 1;
+        desc.format = AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM;
+        desc.usage = AHARDWAREBUFFER_USAGE_GPU_SAMPLED_IMAGE | AHARDWAREBUFFER_USAGE_GPU_COLOR_OUTPUT |
+                     AHARDWAREBUFFER_USAGE_CPU_READ_RARELY;
+        if (sAHardwareBufferAllocate(&desc, &frame.buffer) != 0) {
+            pwarn("Hardware buffer frame pool: failed to allocate %d x %d buffer", _width, _height);
+            frame.buffer = nullptr;
+            return false;
+        }
+
+        EGLint attributes[] = { EGL_IMAGE_PRESERVED_KHR, EGL_TRUE, EGL_NONE };
+        EGLClientBuffer clientBuffer = sEglGetNativeClientBuffer(frame.buffer);
+        frame.image = sEglCreateImage(_display, EGL_NO_CONTEXT, EGL_NATIVE_BUFFER_ANDROID, clientBuffer, attributes);
+        if (frame.image == EGL_NO_IMAGE_KHR) {
+            pwarn("Hardware buffer frame pool: failed to create EGLImage [error %d]", eglGetError());
+            return false;
+        }
+
+        glGenTextures(1, &frame.texture);
+        glBindTexture(GL_TEXTURE_2D, frame.texture);
+        sGlEGLImageTargetTexture2D(GL_TEXTURE_2D, (GLeglImageOES) frame.image);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glGenFramebuffers(1, &frame.framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, frame.framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, frame.texture, 0);
+        GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (status != GL_FRAMEBUFFER_COMPLETE) {
+            pwarn("Hardware buffer frame pool: incomplete framebuffer [status %d]", status);
+            return false;
+        }
+    }
+
+    if (_source == VROHardwareBufferFrameSource::Camera && !initProgram()) {
+        return false;
+    }
+    _initialized = true;
+    return true;
+}
+
+void VROHardwareBufferFramePool::destroyFrame(Frame &frame) {
+    if (frame.captureFence != 0) {
+        glDeleteSync(frame.captureFence);
+        frame.captureFence = 0;
+    }
+    if (frame.captureFenceFd >= 0) {
+        close(frame.captureFenceFd);
+        frame.captureFenceFd = -1;
+    }
+    if (frame.releaseFenceFd >= 0) {
+        close(frame.releaseFenceFd);
+        frame.releaseFenceFd = -1;
+    }
+    if (frame.framebuffer != 0) {
+        glDeleteFramebuffers(1, &frame.framebuffer);
+        frame.framebuffer = 0;
+    }
+    if (frame.texture != 0) {
+        glDeleteTextures(1, &frame.texture);
+        frame.texture = 0;
+    }
+    if (frame.image != EGL_NO_IMAGE_KHR) {
+        sEglDestroyImage(_display, frame.image);
+        frame.image = EGL_NO_IMAGE_KHR;
+    }
+    if (frame.buffer != nullptr) {
+        sAHardwareBufferRelease(frame.buffer);
+        frame.buffer = nullptr;
+    }
+}
+
+#pragma mark - Capture
+
+VROHardwareBufferFramePool::Frame *VROHardwareBufferFramePool::beginCapture() {
+    if (!_initialized) {
+        return nullptr;
+    }
+
+    Frame *frame = nullptr;
+    for (Frame &candidate : _frames) {
+        if (candidate.state == FrameState::Free) {
+            frame = &candidate;
+            break;
+        }
+    }
+    if (frame == nullptr) {
+        ++_droppedFrames;
+        return nullptr;
+    }
+
+    // The GPU, not this thread, waits for the consumer to finish reading
+    if (frame->releaseFenceFd >= 0) {
+        bool waited = false;
+        if (sNativeFencesSupported) {
+            EGLint attributes[] = { EGL_SYNC_NATIVE_FENCE_FD_ANDROID, frame->releaseFenceFd, EGL_NONE };
+            EGLSyncKHR sync = sEglCreateSync(_display, EGL_SYNC_NATIVE_FENCE_ANDROID, attributes);
+            if (sync != EGL_NO_SYNC_KHR) {
+                // EGL owns the descriptor once the sync is created
+                sEglWaitSync(_display, sync, 0);
+                sEglDestroySync(_display, sync);
+                waited = true;
+            }
+        }
+        if (!waited) {
+            close(frame->releaseFenceFd);
+        }
+        frame->releaseFenceFd = -1;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, frame->framebuffer);
+    return frame;
+}
+
+void VROHardwareBufferFramePool::endCapture(Frame *frame, double timestamp) {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    frame->state = FrameState::Captured;
+    frame->sequence = _sequence++;
+    frame->timestamp = timestamp;
+    frame->captureFenceFd = -1;
+
+    if (sNativeFencesSupported) {
+        EGLint attributes[] = { EGL_SYNC_NATIVE_FENCE_FD_ANDROID, EGL_NO_NATIVE_FENCE_FD_ANDROID, EGL_NONE };
+        EGLSyncKHR sync = sEglCreateSync(_display, EGL_SYNC_NATIVE_FENCE_ANDROID, attributes);
+        if (sync != EGL_NO_SYNC_KHR) {
+            // The fence only gets a descriptor once it has been flushed
+            glFlush();
+            frame->captureFenceFd = sEglDupNativeFenceFD(_display, sync);
+            sEglDestroySync(_display, sync);
+        }
+    }
+    if (frame->captureFenceFd < 0) {
+        frame->captureFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+    }
+}
+
+bool VROHardwareBufferFramePool::captureTexture(GLuint textureId, VROVector3f BL, VROVector3f BR,
+                                                VROVector3f TL, VROVector3f TR, double timestamp) {
+    passert (_source == VROHardwareBufferFrameSource::Camera);
+    Frame *frame = beginCapture();
+    if (frame == nullptr) {
+        return false;
+    }
+
+    // Buffer rows are stored top-down, while GL renders bottom-up, so sample the top
+    // of the texture into the first row
+    const VROVector3f corners[4] = { TL, BL, TR, BR };
+    for (int i = 0; i < 4; i++) {
+        _texcoords[i * 2]     = corners[i].x;
+        _texcoords[i * 2 + 1] = corners[i].y;
+    }
+
+    GLint savedViewport[4];
+    glGetIntegerv(GL_VIEWPORT, savedViewport);
+    glViewport(0, 0, _width, _height);
+
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glDisable(GL_SCISSOR_TEST);
+    glDisable(GL_STENCIL_TEST);
+    glDisable(GL_BLEND);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    glUseProgram(_program);
+    glVertexAttribPointer(_positionAttribute, 2, GL_FLOAT, false, 0, kQuadCoords);
+    glVertexAttribPointer(_texcoordAttribute, 2, GL_FLOAT, false, 0, _texcoords);
+    glEnableVertexAttribArray(_positionAttribute);
+    glEnableVertexAttribArray(_texcoordAttribute);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_EXTERNAL_OES, textureId);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindTexture(GL_TEXTURE_EXTERNAL_OES, 0);
+
+    glDisableVertexAttribArray(_positionAttribute);
+    glDisableVertexAttribArray(_texcoordAttribute);
+    glUseProgram(0);
+    glViewport(savedViewport[0], savedViewport[1], savedViewport[2], savedViewport[3]);
+
+    endCapture(frame, timestamp);
+    return true;
+}
+
+bool VROHardwareBufferFramePool::captureFramebuffer(GLuint framebuffer, int width, int height, double timestamp) {
+    Frame *frame = beginCapture();
+    if (frame == nullptr) {
+        return false;
+    }
+
+    // Flip vertically so the first row of the buffer is the top of the image
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, frame->framebuffer);
+    glDisable(GL_SCISSOR_TEST);
+    glBlitFramebuffer(0, 0, width, height, 0, _height, _width, 0, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+    endCapture(frame, timestamp);
+    return true;
+}
+
+#pragma mark - Delivery
+
+void VROHardwareBufferFramePool::collectFrames(std::vector<VROHardwareBufferFrameInfo> *outFrames) {
+    std::vector<Frame *> ready;
+    for (Frame &frame : _frames) {
+        if (frame.state != FrameState::Captured) {
+            continue;
+        }
+        if (frame.captureFence != 0) {
+            GLenum status = glClientWaitSync(frame.captureFence, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+                continue;
+            }
+            glDeleteSync(frame.captureFence);
+            frame.captureFence = 0;
+        }
+        ready.push_back(&frame);
+    }
+
+    std::sort(ready.begin(), ready.end(), [](const Frame *a, const Frame *b) {
+        return a->sequence < b->sequence;
+    });
+
+    for (Frame *frame : ready) {
+        frame->state = FrameState::Delivered;
+        frame->frameId = sNextFrameId++;
+
+        VROHardwareBufferFrameInfo info;
+        info.frameId = frame->frameId;
+        info.buffer = frame->buffer;
+        info.fenceFd = frame->captureFenceFd;
+        info.width = _width;
+        info.height = _height;
+        info.timestamp = frame->timestamp;
+        info.source = _source;
+        info.droppedFrames = _droppedFrames;
+        outFrames->push_back(info);
+
+        // The consumer owns the fence from here on
+        frame->captureFenceFd = -1;
+        _droppedFrames = 0;
+    }
+}
+
+bool VROHardwareBufferFramePool::releaseFrame(uint64_t frameId, int releaseFenceFd) {
+    for (Frame &frame : _frames) {
+        if (frame.state == FrameState::Delivered && frame.frameId == frameId) {
+            frame.state = FrameState::Free;
+            frame.releaseFenceFd = releaseFenceFd;
+            return true;
+        }
+    }
+    return false;
+}
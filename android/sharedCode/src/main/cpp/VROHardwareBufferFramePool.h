@@ -0,0 +1,198 @@
+//
+//  VROHardwareBufferFramePool.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef ANDROID_VROHARDWAREBUFFERFRAMEPOOL_H
+#define ANDROID_VROHARDWAREBUFFERFRAMEPOOL_H
+
+#include <vector>
+#include <atomic>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include "VROOpenGL.h"
+#include "VROVector3f.h"
+
+struct AHardwareBuffer;
+
+enum class VROHardwareBufferFrameSource {
+    Camera,     // The camera image, cropped and rotated to the viewport
+    Rendered    // The rendered scene, including the camera background
+};
+
+/*
+ A frame handed to a consumer. The consumer owns fenceFd, which signals when the
+ GPU has finished writing the buffer (-1 if the buffer is already complete), and
+ must return the frame through VROHardwareBufferFramePool::releaseFrame when it
+ is done reading.
+ */
+struct VROHardwareBufferFrameInfo {
+    uint64_t frameId;
+    AHardwareBuffer *buffer;
+    int fenceFd;
+    int width;
+    int height;
+    double timestamp;
+    VROHardwareBufferFrameSource source;
+
+    /*
+     The number of frames dropped since the previous delivery from this pool because
+     every frame was held by consumers.
+     */
+    int droppedFrames;
+};
+
+/*
+ A bounded pool of AHardwareBuffer-backed frames that the rendering thread writes
+ into without copying on the CPU. Each buffer is bound to a GL texture through an
+ EGLImage, so capturing a frame is a single draw (or blit) followed by a native
+ fence; nothing on the rendering thread waits for the GPU or for consumers.
+
+ The pool never grows. When every frame is held by consumers, captures are dropped
+ and counted, and the count is reported with the next delivered frame so consumers
+ can tell they are falling behind.
+
+ All functions must be invoked on the rendering thread. Requires Android O (API 26)
+ for AHardwareBuffer; the functions are loaded at runtime, so isSupported() returns
+ false on older devices.
+ */
+class VROHardwareBufferFramePool {
+public:
+
+    /*
+     True if AHardwareBuffer and the EGL extensions needed to render into it are
+     available. Must be invoked with the rendering context current.
+     */
+    static bool isSupported();
+
+    VROHardwareBufferFramePool(int width, int height, int capacity,
+                               VROHardwareBufferFrameSource source);
+    virtual ~VROHardwareBufferFramePool();
+
+    /*
+     Allocate the pool's buffers. Returns false on failure.
+     */
+    bool init();
+
+    int getWidth() const {
+        return _width;
+    }
+    int getHeight() const {
+        return _height;
+    }
+    int getCapacity() const {
+        return (int) _frames.size();
+    }
+
+    /*
+     Render the given external (OES) texture, sampled at the given texture coordinates,
+     into the next free frame. Returns false if the frame was dropped.
+     */
+    bool captureTexture(GLuint textureId, VROVector3f BL, VROVector3f BR, VROVector3f TL, VROVector3f TR,
+                        double timestamp);
+
+    /*
+     Blit the color buffer of the given framebuffer into the next free frame, scaling it
+     to the pool's size. Returns false if the frame was dropped.
+     */
+    bool captureFramebuffer(GLuint framebuffer, int width, int height, double timestamp);
+
+    /*
+     Move every captured frame that is ready for consumers into outFrames, oldest first.
+     With native fences frames are ready as soon as they are captured; otherwise they
+     are held until their GL fence signals, which is polled without blocking.
+     */
+    void collectFrames(std::vector<VROHardwareBufferFrameInfo> *outFrames);
+
+    /*
+     Return a delivered frame to the pool. The releaseFenceFd, if not -1, must signal
+     when the consumer is done reading; the GPU waits on it before the frame is
+     written again. Returns false (without taking ownership of the fence) if the
+     frame does not belong to this pool.
+     */
+    bool releaseFrame(uint64_t frameId, int releaseFenceFd);
+
+private:
+
+    enum class FrameState {
+        Free,
+        Captured,
+        Delivered
+    };
+
+    struct Frame {
+        AHardwareBuffer *buffer;
+        EGLImageKHR image;
+        GLuint texture;
+        GLuint framebuffer;
+
+        FrameState state;
+        uint64_t frameId;
+        uint64_t sequence;
+        double timestamp;
+
+        /*
+         The fence signaling the capture is complete: a native fence if supported,
+         otherwise a GL fence polled by collectFrames.
+         */
+        int captureFenceFd;
+        GLsync captureFence;
+
+        /*
+         The consumer's fence, waited on by the GPU before the next capture.
+         */
+        int releaseFenceFd;
+    };
+
+    int _width, _height;
+    VROHardwareBufferFrameSource _source;
+    bool _initialized;
+    EGLDisplay _display;
+    std::vector<Frame> _frames;
+
+    uint64_t _sequence;
+    int _droppedFrames;
+
+    GLuint _program;
+    GLint _positionAttribute;
+    GLint _texcoordAttribute;
+    float _texcoords[8];
+
+    /*
+     Frame IDs are unique across pools, so a released ID identifies its pool.
+     */
+    static std::atomic<uint64_t> sNextFrameId;
+
+    /*
+     Find a free frame, make the GPU wait on its release fence, and bind its
+     framebuffer. Returns nullptr and counts a drop if none is free.
+     */
+    Frame *beginCapture();
+    void endCapture(Frame *frame, double timestamp);
+
+    bool initProgram();
+    void destroyFrame(Frame &frame);
+
+};
+
+#endif //ANDROID_VROHARDWAREBUFFERFRAMEPOOL_H
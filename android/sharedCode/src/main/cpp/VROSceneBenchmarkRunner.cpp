@@ -0,0 +1,188 @@
+//
+//  VROSceneBenchmarkRunner.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROSceneBenchmarkRunner.h"
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include "VRODriverOpenGLAndroid.h"
+#include "VROInputControllerARAndroid.h"
+#include "VRORenderer.h"
+#include "VRORendererConfiguration.h"
+#include "VROSceneBenchmark.h"
+#include "VROFrameCapture.h"
+#include "VROFrameReplay.h"
+#include "VROThreadRestricted.h"
+#include "VROLog.h"
+
+/*
+ Create an offscreen pbuffer context of the given size and make it current on
+ the calling thread.
+ */
+static bool makeOffscreenContext(int width, int height, EGLDisplay *outDisplay, EGLSurface *outSurface,
+                                 EGLContext *outContext) {
+    EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+        perr("Scene benchmark failed to initialize EGL");
+        return false;
+    }
+
+    const EGLint configAttribs[] = {
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT_KHR,
+            EGL_SURFACE_TYPE,    EGL_PBUFFER_BIT,
+            EGL_RED_SIZE,        8,
+            EGL_GREEN_SIZE,      8,
+            EGL_BLUE_SIZE,       8,
+            EGL_ALPHA_SIZE,      8,
+            EGL_DEPTH_SIZE,      24,
+            EGL_STENCIL_SIZE,    8,
+            EGL_NONE
+    };
+    EGLConfig config;
+    EGLint numConfigs = 0;
+    if (!eglChooseConfig(display, configAttribs, &config, 1, &numConfigs) || numConfigs == 0) {
+        perr("Scene benchmark found no pbuffer-capable ES3 config");
+        return false;
+    }
+
+    const EGLint contextAttribs[] = { EGL_CONTEXT_CLIENT_VERSION, 3, EGL_NONE };
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+    if (context == EGL_NO_CONTEXT) {
+        perr("Scene benchmark failed to create EGL context [error %d]", eglGetError());
+        return false;
+    }
+
+    const EGLint surfaceAttribs[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+    EGLSurface surface = eglCreatePbufferSurface(display, config, surfaceAttribs);
+    if (surface == EGL_NO_SURFACE) {
+        perr("Scene benchmark failed to create %dx%d pbuffer [error %d]", width, height, eglGetError());
+        eglDestroyContext(display, context);
+        return false;
+    }
+    if (!eglMakeCurrent(display, surface, surface, context)) {
+        perr("Scene benchmark failed to make context current [error %d]", eglGetError());
+        eglDestroySurface(display, surface);
+        eglDestroyContext(display, context);
+        return false;
+    }
+
+    *outDisplay = display;
+    *outSurface = surface;
+    *outContext = context;
+    return true;
+}
+
+static void destroyOffscreenContext(EGLDisplay display, EGLSurface surface, EGLContext context) {
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroySurface(display, surface);
+    eglDestroyContext(display, context);
+}
+
+bool VROSceneBenchmarkRunner::run(std::shared_ptr<gvr::AudioApi> gvrAudio, int width, int height,
+                                  int warmupFrames, int measuredFrames, std::string outputPath) {
+    EGLDisplay display;
+    EGLSurface surface;
+    EGLContext context;
+    if (!makeOffscreenContext(width, height, &display, &surface, &context)) {
+        return false;
+    }
+
+    VROThreadRestricted::setThread(VROThreadName::Renderer);
+    bool success;
+    {
+        std::shared_ptr<VRODriverOpenGLAndroid> driver = std::make_shared<VRODriverOpenGLAndroid>(gvrAudio);
+        std::shared_ptr<VROInputControllerAR> controller = std::make_shared<VROInputControllerARAndroid>(width, height, driver);
+
+        VRORendererConfiguration config;
+        std::shared_ptr<VRORenderer> renderer = std::make_shared<VRORenderer>(config, controller);
+
+        VROSceneBenchmark benchmark(renderer, driver, width, height);
+        benchmark.setFrameCounts(warmupFrames, measuredFrames);
+        for (const VROSceneBenchmarkScene &scene : VROSceneBenchmark::getStandardScenes()) {
+            benchmark.addScene(scene);
+        }
+        while (benchmark.renderFrame()) {
+            eglSwapBuffers(display, surface);
+        }
+
+        success = benchmark.writeJSON(outputPath);
+        if (success) {
+            pinfo("Wrote scene benchmark results to %s", outputPath.c_str());
+        }
+    }
+    VROThreadRestricted::unsetThread();
+
+    destroyOffscreenContext(display, surface, context);
+    return success;
+}
+
+bool VROSceneBenchmarkRunner::runReplay(std::shared_ptr<gvr::AudioApi> gvrAudio, std::string captureDirectory,
+                                        int warmupFrames, int repetitions, std::string outputPath,
+                                        std::string tracePath) {
+    std::vector<VROFrameCaptureFrame> frames;
+    std::vector<VROFrameCaptureEvent> events;
+    if (!VROFrameCapture::readFrames(captureDirectory, &frames, &events) || frames.empty()) {
+        perr("Frame replay found no capture in %s", captureDirectory.c_str());
+        return false;
+    }
+
+    // The surface covers the captured viewport
+    int width = frames.front().viewport[0] + frames.front().viewport[2];
+    int height = frames.front().viewport[1] + frames.front().viewport[3];
+
+    EGLDisplay display;
+    EGLSurface surface;
+    EGLContext context;
+    if (!makeOffscreenContext(width, height, &display, &surface, &context)) {
+        return false;
+    }
+
+    VROThreadRestricted::setThread(VROThreadName::Renderer);
+    bool success;
+    {
+        std::shared_ptr<VRODriverOpenGLAndroid> driver = std::make_shared<VRODriverOpenGLAndroid>(gvrAudio);
+        std::shared_ptr<VROInputControllerAR> controller = std::make_shared<VROInputControllerARAndroid>(width, height, driver);
+
+        VRORendererConfiguration config;
+        std::shared_ptr<VRORenderer> renderer = std::make_shared<VRORenderer>(config, controller);
+
+        VROFrameReplay replay(renderer, driver, captureDirectory);
+        replay.setFrameCounts(warmupFrames, repetitions);
+        while (replay.renderFrame()) {
+            eglSwapBuffers(display, surface);
+        }
+
+        success = !replay.getFrameTimes().empty() && replay.writeJSON(outputPath);
+        if (success) {
+            pinfo("Wrote frame replay results to %s", outputPath.c_str());
+        }
+        if (success && !tracePath.empty()) {
+            success = replay.writeTrace(tracePath);
+        }
+    }
+    VROThreadRestricted::unsetThread();
+
+    destroyOffscreenContext(display, surface, context);
+    return success;
+}
@@ -0,0 +1,68 @@
+//
+//  VROSceneBenchmarkRunner.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef ANDROID_VROSCENEBENCHMARKRUNNER_H
+#define ANDROID_VROSCENEBENCHMARKRUNNER_H
+
+#include <memory>
+#include <string>
+
+namespace gvr {
+    class AudioApi;
+}
+
+/*
+ Runs the standard scene benchmarks (see VROSceneBenchmark), or replays frame
+ captures (see VROFrameReplay), headlessly: an offscreen EGL pbuffer context
+ of the given size is created on the calling thread, which becomes the
+ rendering thread for the duration of the run. The calling thread must not be
+ the UI thread, since asset loads complete through application thread tasks
+ while the benchmark renders.
+ */
+class VROSceneBenchmarkRunner {
+
+public:
+
+    /*
+     Render every standard scene for the given number of frames and write the
+     results as JSON to the given path. Returns false if the offscreen context
+     could not be created or the results could not be written.
+     */
+    static bool run(std::shared_ptr<gvr::AudioApi> gvrAudio, int width, int height,
+                    int warmupFrames, int measuredFrames, std::string outputPath);
+
+    /*
+     Replay the frame capture in the given directory, at its captured size, and
+     write the results as JSON to the given path and, if a trace path is given,
+     the profiler's Chrome trace of the replayed frames. Returns false if the
+     capture could not be read or replayed, or the results written.
+     */
+    static bool runReplay(std::shared_ptr<gvr::AudioApi> gvrAudio, std::string captureDirectory,
+                          int warmupFrames, int repetitions, std::string outputPath,
+                          std::string tracePath);
+
+};
+
+#endif //ANDROID_VROSCENEBENCHMARKRUNNER_H
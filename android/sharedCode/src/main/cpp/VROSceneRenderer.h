@@ -33,6 +33,7 @@
 #include "VRORenderer.h"
 #include "VRORenderDelegate.h"
 #include "VRODriverOpenGLAndroid.h"
+#include "VROFramePacerAndroid.h"
 
 class VROSceneController;
 
@@ -138,6 +139,18 @@ public:
         _renderer->setClearColor(color, _driver);
     }
 
+    /*
+     Set the frame rate to pace rendering to, in frames per second. Zero targets
+     the display's refresh rate. Only renderers that pace their frames (those
+     driven by a GLSurfaceView) respond to this. Must be invoked on the rendering
+     thread.
+     */
+    void setTargetFrameRate(int fps) {
+        if (_framePacer) {
+            _framePacer->setTargetFrameRate(fps);
+        }
+    }
+
     std::vector<VROHitTestResult> performHitTest(int x, int y, bool boundsOnly);
 
     std::vector<VROHitTestResult> performHitTest(VROVector3f origin, VROVector3f ray, bool boundsOnly);
@@ -148,6 +161,12 @@ protected:
     std::shared_ptr<VRODriverOpenGLAndroid> _driver;
     std::shared_ptr<VROSceneController> _sceneController;
 
+    /*
+     Paces frames to vsync, for renderers that do not rely on a VR runtime to do so.
+     Null for renderers that don't pace their own frames.
+     */
+    std::shared_ptr<VROFramePacerAndroid> _framePacer;
+
 };
 
 #endif //ANDROID_VROSCENERENDERER_H
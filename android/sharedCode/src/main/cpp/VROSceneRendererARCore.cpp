@@ -29,6 +29,7 @@
 #include <android/log.h>
 #include <assert.h>
 #include <stdlib.h>
+#include <unistd.h>
 #include <cmath>
 #include <random>
 #include <VROTime.h>
@@ -49,6 +50,7 @@
 #include "VROSurface.h"
 #include "VRONode.h"
 #include "VROARScene.h"
+#include "VROPortal.h"
 #include "VROInputControllerCardboard.h"
 #include "VROAllocationTracker.h"
 #include "VROInputControllerARAndroid.h"
@@ -62,7 +64,10 @@ VROSceneRendererARCore::VROSceneRendererARCore(VRORendererConfiguration config,
                                                std::shared_ptr<gvr::AudioApi> gvrAudio) :
     _arcoreInstalled(false),
     _destroyed(false),
-    _displayRotation(0) {
+    _displayRotation(0),
+    _frameTapCameraBuffers(false),
+    _frameTapRenderedBuffers(false),
+    _frameTapMaxBuffers(3) {
 
     // BUILD MARKER: Log build timestamp for verification
     __android_log_print(ANDROID_LOG_INFO, "ViroCore",
@@ -86,6 +91,7 @@ VROSceneRendererARCore::VROSceneRendererARCore(VRORendererConfiguration config,
     _pointOfView = std::make_shared<VRONode>();
     _pointOfView->setCamera(std::make_shared<VRONodeCamera>());
     _renderer->setPointOfView(_pointOfView);
+    _framePacer = std::make_shared<VROFramePacerAndroid>();
 }
 
 VROSceneRendererARCore::~VROSceneRendererARCore() {
@@ -112,11 +118,13 @@ void VROSceneRendererARCore::onDrawFrame() {
         return;
     }
 
+    _framePacer->beginFrame();
     if (_arcoreInstalled) {
         renderFrame();
     } else {
         renderNothing();
     }
+    _framePacer->endFrame();
 
     ++_frame;
     ALLOCATION_TRACKER_PRINT();
@@ -175,6 +183,14 @@ void VROSceneRendererARCore::renderFrame() {
      */
     if (camera->getTrackingState() == VROARTrackingState::Normal) {
         renderWithTracking(camera, frame, viewport);
+
+        // Hand the composited frame to the tap listener (if it wants rendered frames)
+        if (_frameTapListener) {
+            VROARFrameARCore *arcoreFrame = dynamic_cast<VROARFrameARCore*>(frame.get());
+            if (arcoreFrame) {
+                _frameTapListener->dispatchRenderedFrame(arcoreFrame, 0, _surfaceSize.width, _surfaceSize.height);
+            }
+        }
     } else {
         renderWaitingForTracking(viewport);
     }
@@ -220,6 +236,11 @@ void VROSceneRendererARCore::renderWithTracking(const std::shared_ptr<VROARCamer
      */
     std::shared_ptr<VROARScene> scene = std::dynamic_pointer_cast<VROARScene>(_session->getScene());
     scene->updateAmbientLight(frame->getAmbientLightIntensity(), frame->getAmbientLightColor());
+
+    std::shared_ptr<VROSphericalHarmonics> sh = frame->getAmbientSphericalHarmonics();
+    if (sh) {
+        scene->getRootNode()->setAmbientSphericalHarmonics(sh);
+    }
 }
 
 void VROSceneRendererARCore::renderWaitingForTracking(VROViewport viewport) {
@@ -280,6 +301,7 @@ void VROSceneRendererARCore::onSurfaceChanged(jobject surface, VRO_INT width, VR
 
     _surfaceSize.width = width;
     _surfaceSize.height = height;
+    _framePacer->setSurface(surface);
 
     if (_cameraBackground) {
         _cameraBackground->setX(width / 2.0);
@@ -448,10 +470,31 @@ void VROSceneRendererARCore::enableTracking(bool shouldTrack) {
 
 void VROSceneRendererARCore::setFrameTapListener(std::shared_ptr<VROFrameTapListener> listener) {
     _frameTapListener = listener;
+    if (_frameTapListener && (_frameTapCameraBuffers || _frameTapRenderedBuffers)) {
+        _frameTapListener->setHardwareBufferFrames(_frameTapCameraBuffers, _frameTapRenderedBuffers,
+                                                   _frameTapMaxBuffers);
+    }
 }
 
 void VROSceneRendererARCore::clearFrameTapListener() {
     _frameTapListener.reset();
 }
 
+void VROSceneRendererARCore::setFrameTapHardwareBuffers(bool cameraFrames, bool renderedFrames, int maxFrames) {
+    _frameTapCameraBuffers = cameraFrames;
+    _frameTapRenderedBuffers = renderedFrames;
+    _frameTapMaxBuffers = maxFrames;
+    if (_frameTapListener) {
+        _frameTapListener->setHardwareBufferFrames(cameraFrames, renderedFrames, maxFrames);
+    }
+}
+
+void VROSceneRendererARCore::releaseFrameTapHardwareBuffer(uint64_t frameId, int releaseFenceFd) {
+    if (_frameTapListener) {
+        _frameTapListener->releaseHardwareBufferFrame(frameId, releaseFenceFd);
+    } else if (releaseFenceFd >= 0) {
+        close(releaseFenceFd);
+    }
+}
+
 
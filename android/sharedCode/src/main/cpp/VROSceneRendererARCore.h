@@ -157,6 +157,19 @@ public:
      */
     void clearFrameTapListener();
 
+    /*
+     Enable zero-copy AHardwareBuffer delivery of camera and/or rendered frames to the
+     frame tap listener, using at most maxFrames buffers per source. The setting persists
+     across frame tap listeners.
+     */
+    void setFrameTapHardwareBuffers(bool cameraFrames, bool renderedFrames, int maxFrames);
+
+    /*
+     Return a hardware buffer frame delivered to the frame tap listener. Takes ownership
+     of the release fence.
+     */
+    void releaseFrameTapHardwareBuffer(uint64_t frameId, int releaseFenceFd);
+
 private:
 
     void renderFrame();
@@ -182,6 +195,11 @@ private:
     // Frame tap listener for pre-viewport frame access
     std::shared_ptr<VROFrameTapListener> _frameTapListener;
     int _displayRotation;
+
+    // Hardware buffer frame settings applied to each frame tap listener
+    bool _frameTapCameraBuffers;
+    bool _frameTapRenderedBuffers;
+    int _frameTapMaxBuffers;
 };
 
 #endif  // VRO_SCENE_RENDERER_ARCORE_H  // NOLINT
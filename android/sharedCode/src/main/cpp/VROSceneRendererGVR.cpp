@@ -182,18 +182,27 @@ void VROSceneRendererGVR::renderStereo(VROMatrix4f &headView) {
         _viewportList->SetBufferViewport(2 + i, _hudViewport);
     }
 
-    // Prepare the frame and render the left eye
+    // Prepare the frame and, where multiview is supported, render the scene for both
+    // eyes in one pass. The renderEye calls below then only post-process each eye
     _renderer->prepareFrame(_frame, viewports[0], fovs[0], headRotation, projectionMatrices[0], _driver);
+    latchHeadPose();
+    VROMatrix4f leftEyeView = eyeFromHeadMatrices[GVR_LEFT_EYE].multiply(_renderer->getLookAtMatrix());
+    VROMatrix4f rightEyeView = eyeFromHeadMatrices[GVR_RIGHT_EYE].multiply(_renderer->getLookAtMatrix());
+    if (_renderer->renderMultiview(leftEyeView, rightEyeView,
+                                   projectionMatrices[GVR_LEFT_EYE], projectionMatrices[GVR_RIGHT_EYE],
+                                   viewports[GVR_LEFT_EYE], _driver)) {
+        frame.BindBuffer(0);
+    }
+
+    // Render the left eye
     clearViewport(viewports[0], false);
-    _renderer->renderEye(VROEyeType::Left,
-                         eyeFromHeadMatrices[GVR_LEFT_EYE].multiply(_renderer->getLookAtMatrix()),
+    _renderer->renderEye(VROEyeType::Left, leftEyeView,
                          projectionMatrices[GVR_LEFT_EYE],
                          viewports[GVR_LEFT_EYE], _driver);
 
     // Render the right eye
     clearViewport(viewports[1], false);
-    _renderer->renderEye(VROEyeType::Right,
-                         eyeFromHeadMatrices[GVR_RIGHT_EYE].multiply(_renderer->getLookAtMatrix()),
+    _renderer->renderEye(VROEyeType::Right, rightEyeView,
                          projectionMatrices[GVR_RIGHT_EYE],
                          viewports[GVR_RIGHT_EYE], _driver);
     frame.Unbind();
@@ -217,6 +226,21 @@ void VROSceneRendererGVR::renderStereo(VROMatrix4f &headView) {
     frame.Submit(*_viewportList, _headView); // Submits all layers (buffer 0, buffer 1, etc.) to the framebuffer
 }
 
+// When late latching, re-sample the head pose now that the scene has been updated and
+// culled, so the eyes render (and GVR reprojects from) the freshest pose
+void VROSceneRendererGVR::latchHeadPose() {
+    if (!_renderer->isLateLatchingEnabled()) {
+        return;
+    }
+    gvr::ClockTimePoint target_time = gvr::GvrApi::GetTimePointNow();
+    target_time.monotonic_system_time_nanos += kPredictionTimeWithoutVsyncNanos;
+
+    gvr::Mat4f headView = _gvr->GetHeadSpaceFromStartSpaceRotation(target_time);
+    if (_renderer->latchHeadRotation(VROGVRUtil::toMatrix4f(headView).invert())) {
+        _headView = headView;
+    }
+}
+
 // For mono rendering we simply render direct to our GLSurfaceView, avoiding
 // the gvr::Frame and its buffers (so long as gvr::Frame.BindBuffer is not
 // called, the GLSurfaceView's primary default framebuffer is bound)
@@ -237,6 +261,7 @@ void VROSceneRendererGVR::renderMono(VROMatrix4f &headView) {
 
     clearViewport(viewport, false);
     _renderer->prepareFrame(_frame, viewport, fov, headRotation, projection, _driver);
+    latchHeadPose();
     _renderer->renderEye(VROEyeType::Monocular, _renderer->getLookAtMatrix(), projection, viewport,  _driver);
     _renderer->renderHUD(VROEyeType::Monocular, eyeFromHeadMatrix, projection, _driver);
     _renderer->endFrame(_driver);
@@ -93,6 +93,7 @@ private:
 
     void renderStereo(VROMatrix4f &headView);
     void renderMono(VROMatrix4f &headView);
+    void latchHeadPose();
 
     std::unique_ptr<gvr::GvrApi> _gvr;
     std::unique_ptr<gvr::BufferViewportList> _viewportList;
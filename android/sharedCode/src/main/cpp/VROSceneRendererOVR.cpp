@@ -731,7 +731,7 @@ static void ovrRenderer_RenderFrame(ovrRenderer *rendererOVR, const ovrJava *jav
                                     std::shared_ptr<VRORenderer> renderer,
                                     std::shared_ptr<VRODriverOpenGLAndroid> driver,
                                     long long frameIndex,
-                                    const ovrTracking2 *tracking, ovrMobile *ovr,
+                                    const ovrTracking2 *tracking, double displayTime, ovrMobile *ovr,
                                     unsigned long long *completionFence,
                                     ovrLayerProjection2 *sceneLayer,
                                     ovrLayerProjection2 *hudLayer)  {
@@ -789,6 +789,44 @@ static void ovrRenderer_RenderFrame(ovrRenderer *rendererOVR, const ovrJava *jav
     VROMatrix4f projection = fov.toPerspectiveProjection(kZNear, renderer->getFarClippingPlane());
     renderer->prepareFrame(frameIndex, leftViewport, fov, headRotation, projection, driver);
 
+    // When late latching, re-sample the tracking for the same display time now that the
+    // scene has been updated and culled; the prediction is shorter, and so more accurate.
+    // The layers carry the latched pose so timewarp reprojects from what was rendered.
+    if (renderer->isLateLatchingEnabled()) {
+        ovrTracking2 latchedTracking = vrapi_GetPredictedTracking2(ovr, displayTime);
+        ovrQuatf orientation = latchedTracking.HeadPose.Pose.Orientation;
+        VROQuaternion latchedQuaternion(orientation.x, orientation.y, orientation.z, orientation.w);
+        if (renderer->latchHeadRotation(latchedQuaternion.getMatrix())) {
+            updatedTracking = latchedTracking;
+            sceneLayer->HeadPose = updatedTracking.HeadPose;
+            hudLayer->HeadPose   = updatedTracking.HeadPose;
+        }
+    }
+
+    // Copy over the values from the OVR eye view matrix into our Viro head view matrix to
+    // get the correct translation (this appears to be the only thing OVR is changing to
+    // derive its eye view matrix from its head view matrix). Note we don't pass the OVR eye
+    // view matrix directly into Viro because we need to take Viro's pointOfView into account,
+    // which is captured in the viroHeadView
+    VROMatrix4f eyeViews[VRAPI_FRAME_LAYER_EYE_MAX];
+    for (int eye = 0; eye < rendererOVR->NumBuffers; eye++) {
+        VROMatrix4f viroHeadView = renderer->getLookAtMatrix();
+        VROMatrix4f ovrEyeView = toMatrix4f(updatedTracking.Eye[eye].ViewMatrix);
+
+        for (int i = 12; i < 15; i++) {
+            viroHeadView[i] += ovrEyeView[i];
+        } //After these additions, viroHeadView is really viroEyeView
+        eyeViews[eye] = viroHeadView;
+    }
+
+    // Where multiview is supported, render the scene for both eyes in one pass; the
+    // renderEye calls below then only post-process each eye into its swapchain
+    if (rendererOVR->NumBuffers == VRAPI_FRAME_LAYER_EYE_MAX) {
+        VROViewport eyeViewport = { 0, 0, rendererOVR->FrameBuffer[0].Width, rendererOVR->FrameBuffer[0].Height };
+        renderer->renderMultiview(eyeViews[VRAPI_FRAME_LAYER_EYE_LEFT], eyeViews[VRAPI_FRAME_LAYER_EYE_RIGHT],
+                                  projection, projection, eyeViewport, driver);
+    }
+
     // Render the scene to the textures in the scene layer
     for (int eye = 0; eye < rendererOVR->NumBuffers; eye++) {
         ovrFramebuffer *frameBuffer = &rendererOVR->FrameBuffer[eye];
@@ -807,22 +845,10 @@ static void ovrRenderer_RenderFrame(ovrRenderer *rendererOVR, const ovrJava *jav
         VROEyeType eyeType = (eye == VRAPI_FRAME_LAYER_EYE_LEFT) ? VROEyeType::Left : VROEyeType::Right;
         VROViewport viewport = { 0, 0, frameBuffer->Width, frameBuffer->Height };
 
-        VROMatrix4f viroHeadView = renderer->getLookAtMatrix();
-        VROMatrix4f ovrEyeView = toMatrix4f(updatedTracking.Eye[eye].ViewMatrix);
-
-        // Copy over the values from the OVR eye view matrix into our Viro head view matrix to
-        // get the correct translation (this appears to be the only thing OVR is changing to
-        // derive its eye view matrix from its head view matrix). Note we don't pass the OVR eye
-        // view matrix directly into Viro because we need to take Viro's pointOfView into account,
-        // which is captured in the viroHeadView
-        for (int i = 12; i < 15; i++) {
-            viroHeadView[i] += ovrEyeView[i];
-        } //After these additions, viroHeadView is really viroEyeView
-
         // We use our projection matrix because the one computed by OVR appears to be identical for
         // left and right, but with fixed NCP and FCP. Our projection uses the correct NCP and FCP.
         renderer->renderEye(eyeType,
-                            viroHeadView,
+                            eyeViews[eye],
                             projection,
                             viewport, driver);
 
@@ -895,6 +921,7 @@ typedef struct
     double				BackButtonDownStartTime;
     ovrRenderer			Renderer;
     bool                UseMultiview;
+    int                 FoveationLevel;
 
     // Viro parameters
     std::shared_ptr<VRORenderer> vroRenderer;
@@ -914,10 +941,28 @@ static void ovrApp_Clear( ovrApp * app )
     app->BackButtonDown = false;
     app->BackButtonDownStartTime = 0.0;
     app->UseMultiview = true;
+    app->FoveationLevel = -1;
     ovrEgl_Clear( &app->Egl );
     ovrRenderer_Clear( &app->Renderer );
 }
 
+// Forward the renderer's foveation level to VrApi, which foveates the swapchain
+// textures (e.g. the base pass when HDR is off) when the device supports it
+static void ovrApp_UpdateFoveation( ovrApp * app )
+{
+    int level = (int) app->vroRenderer->getFoveationLevel();
+    if ( level == app->FoveationLevel )
+    {
+        return;
+    }
+    app->FoveationLevel = level;
+    if ( vrapi_GetSystemPropertyInt( &app->Java, VRAPI_SYS_PROP_FOVEATION_AVAILABLE ) == VRAPI_TRUE )
+    {
+        ALOGV( "        vrapi_SetPropertyInt( VRAPI_FOVEATION_LEVEL, %d )", level );
+        vrapi_SetPropertyInt( &app->Java, VRAPI_FOVEATION_LEVEL, level );
+    }
+}
+
 static void ovrApp_PushBlackFinal( ovrApp * app, const ovrPerformanceParms * perfParms )
 {
     ovrFrameParms frameParms = vrapi_DefaultFrameParms( &app->Java, VRAPI_FRAME_INIT_BLACK_FINAL, vrapi_GetTimeInSeconds(), NULL );
@@ -1387,10 +1432,11 @@ void * AppThreadFunction( void * parm )
         // Render eye images and setup the primary layer using ovrTracking2.
         ovrLayerProjection2 worldLayer;
         ovrLayerProjection2 hudLayer;
+        ovrApp_UpdateFoveation( &appState );
         ovrRenderer_RenderFrame(&appState.Renderer, &appState.Java,
                                 appState.vroRenderer, appState.driver,
                                 appState.FrameIndex,
-                                &tracking,
+                                &tracking, appState.DisplayTime,
                                 appState.Ovr, &completionFence, &worldLayer, &hudLayer );
 
         const ovrLayerHeader2 * layers[] = {
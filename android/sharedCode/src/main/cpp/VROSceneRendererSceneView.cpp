@@ -61,6 +61,7 @@ VROSceneRendererSceneView::VROSceneRendererSceneView(VRORendererConfiguration co
     // instantiate the input controller w/ viewport size (0,0) and update it later.
     std::shared_ptr<VROInputControllerAR> controller = std::make_shared<VROInputControllerARAndroid>(0, 0, _driver);
     _renderer = std::make_shared<VRORenderer>(config, controller);
+    _framePacer = std::make_shared<VROFramePacerAndroid>();
 }
 
 VROSceneRendererSceneView::~VROSceneRendererSceneView() {
@@ -74,7 +75,16 @@ void VROSceneRendererSceneView::initGL() {
 }
 
 void VROSceneRendererSceneView::onDrawFrame() {
+    _framePacer->beginFrame();
+
+    // In render-on-demand mode, idle frames re-present the last rendered image
+    VROViewport viewport(0, 0, _surfaceSize.width, _surfaceSize.height);
+    if (_renderer->presentIdleFrame(viewport, _driver)) {
+        _framePacer->endFrame();
+        return;
+    }
     renderFrame();
+    _framePacer->endFrame();
 
     ++_frame;
     ALLOCATION_TRACKER_PRINT();
@@ -102,6 +112,7 @@ void VROSceneRendererSceneView::onSurfaceChanged(jobject surface, VRO_INT width,
 
     _surfaceSize.width = width;
     _surfaceSize.height = height;
+    _framePacer->setSurface(surface);
 
     std::shared_ptr<VROInputControllerARAndroid> inputControllerAR =
             std::dynamic_pointer_cast<VROInputControllerARAndroid>(_renderer->getInputController());
@@ -115,6 +126,7 @@ void VROSceneRendererSceneView::onTouchEvent(int action, float x, float y) {
     std::shared_ptr<VROInputControllerARAndroid> arTouchController
             = std::dynamic_pointer_cast<VROInputControllerARAndroid>(baseController);
     arTouchController->onTouchEvent(action, x, y);
+    _renderer->requestRender();
 }
 
 void VROSceneRendererSceneView::onPinchEvent(int pinchState, float scaleFactor,
@@ -123,6 +135,7 @@ void VROSceneRendererSceneView::onPinchEvent(int pinchState, float scaleFactor,
     std::shared_ptr<VROInputControllerARAndroid> arTouchController
             = std::dynamic_pointer_cast<VROInputControllerARAndroid>(baseController);
     arTouchController->onPinchEvent(pinchState, scaleFactor, viewportX, viewportY);
+    _renderer->requestRender();
 }
 
 void VROSceneRendererSceneView::onRotateEvent(int rotateState, float rotateRadians, float viewportX,
@@ -131,6 +144,7 @@ void VROSceneRendererSceneView::onRotateEvent(int rotateState, float rotateRadia
     std::shared_ptr<VROInputControllerARAndroid> arTouchController
             = std::dynamic_pointer_cast<VROInputControllerARAndroid>(baseController);
     arTouchController->onRotateEvent(rotateState, rotateRadians, viewportX, viewportY);
+    _renderer->requestRender();
 }
 
 void VROSceneRendererSceneView::onPause() {
@@ -67,6 +67,16 @@ std::string("void main() {\n") +
 std::string("    gl_FragColor = texture2D(sTexture, v_TexCoord);\n") +
 std::string("}");
 
+static const std::string kQuadRenderingFragmentShaderBGRA8 =
+std::string("// Fragment shader that renders to a RGBA texture with red and blue swapped.\n") +
+std::string("#extension GL_OES_EGL_image_external : require\n") +
+std::string("precision mediump float;\n") +
+std::string("varying vec2 v_TexCoord;\n") +
+std::string("uniform samplerExternalOES sTexture;\n") +
+std::string("void main() {\n") +
+std::string("    gl_FragColor = texture2D(sTexture, v_TexCoord).bgra;\n") +
+std::string("}");
+
 static const std::string kQuadRenderingFragmentShaderI8 =
         std::string("// Fragment shader that renders to a grayscale texture.\n") +
 std::string("#extension GL_OES_EGL_image_external : require\n") +
@@ -97,10 +107,10 @@ VROTextureReader::VROTextureReader(int textureId, int textureWidth, int textureH
     _frontIndex(-1),
     _backIndex(-1) {
 
-    if (_imageFormat == VROTextureReaderOutputFormat::RGBA8) {
-        _pixelBufferSize = _outputWidth * _outputHeight * 4;
-    } else if (_imageFormat == VROTextureReaderOutputFormat::I8) {
+    if (_imageFormat == VROTextureReaderOutputFormat::I8) {
         _pixelBufferSize = _outputWidth * _outputHeight;
+    } else {
+        _pixelBufferSize = _outputWidth * _outputHeight * 4;
     }
 
     for (int i = 0; i < 8; i++) {
@@ -145,10 +155,13 @@ bool VROTextureReader::init() {
 
     // Load shader program
     int vertexShader   = loadGLShader(GL_VERTEX_SHADER, kQuadRenderingVertexShader);
-    int fragmentShader = loadGLShader(GL_FRAGMENT_SHADER,
-                                      _imageFormat == VROTextureReaderOutputFormat::I8
-                                      ? kQuadRenderingFragmentShaderI8
-                                      : kQuadRenderingFragmentShaderRGBA8);
+    const std::string *fragmentSource = &kQuadRenderingFragmentShaderRGBA8;
+    if (_imageFormat == VROTextureReaderOutputFormat::I8) {
+        fragmentSource = &kQuadRenderingFragmentShaderI8;
+    } else if (_imageFormat == VROTextureReaderOutputFormat::BGRA8) {
+        fragmentSource = &kQuadRenderingFragmentShaderBGRA8;
+    }
+    int fragmentShader = loadGLShader(GL_FRAGMENT_SHADER, *fragmentSource);
     _quadProgram = glCreateProgram();
     glAttachShader(_quadProgram, vertexShader);
     glAttachShader(_quadProgram, fragmentShader);
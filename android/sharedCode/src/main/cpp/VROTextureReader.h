@@ -38,8 +38,14 @@ class VROFrameSynchronizer;
 
 static const int kTextureReaderBufferCount = 2;
 
+/*
+ BGRA8 writes the same bytes as RGBA8 with red and blue swapped, so that each
+ pixel reads as a little-endian 0xAARRGGBB word (the layout produced by
+ VROYuvImageConverter).
+ */
 enum class VROTextureReaderOutputFormat {
     RGBA8,
+    BGRA8,
     I8
 };
 
@@ -103,6 +109,7 @@ public:
     // Internal
     void onFrameWillRender(const VRORenderContext &context);
     void onFrameDidRender(const VRORenderContext &context);
+    const char *getFrameListenerName() const { return "textureReader"; }
 
 private:
 
@@ -100,6 +100,8 @@ std::shared_ptr<VROGlyph> VROTypefaceAndroid::loadGlyph(uint32_t charCode, uint3
             glyph->loadOutlineBitmap(driver->getFreetype(), _face, charCode, variantSelector, outlineWidth,
                                      &_outlineAtlases[outlineWidth], driver);
         }
+    } else if (renderMode == VROGlyphRenderMode::DistanceField) {
+        loadDistanceFieldGlyph(glyph, _face, charCode, variantSelector, driver);
     } else {
         glyph->loadVector(_face, charCode, variantSelector);
     }
@@ -110,8 +112,4 @@ std::shared_ptr<VROGlyph> VROTypefaceAndroid::loadGlyph(uint32_t charCode, uint3
 std::string VROTypefaceAndroid::getFontPath(std::string fontName, std::string suffix) {
     std::string prefix = "/system/fonts/";
     return prefix + fontName + "." + suffix;
-}
-
-float VROTypefaceAndroid::getLineHeight() const {
-    return _face->size->metrics.height >> 6;
 }
\ No newline at end of file
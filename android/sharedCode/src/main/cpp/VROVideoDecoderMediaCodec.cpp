@@ -0,0 +1,602 @@
+//
+//  VROVideoDecoderMediaCodec.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROVideoDecoderMediaCodec.h"
+#include "VROPlatformUtil.h"
+#include "VROStringUtil.h"
+#include "VROLog.h"
+#include <android/hardware_buffer.h>
+#include <media/NdkMediaCodec.h>
+#include <media/NdkMediaExtractor.h>
+#include <media/NdkImageReader.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifndef EGL_ANDROID_image_crop
+#define EGL_IMAGE_CROP_LEFT_ANDROID   0x3148
+#define EGL_IMAGE_CROP_TOP_ANDROID    0x3149
+#define EGL_IMAGE_CROP_RIGHT_ANDROID  0x314A
+#define EGL_IMAGE_CROP_BOTTOM_ANDROID 0x314B
+#endif
+
+// Frames decoded ahead of presentation
+static const int kDecodeAheadFrames = 4;
+
+// Without native fences, the number of renders a replaced frame is held for before
+// it is returned to the decoder, since the GPU may still be reading it
+static const int kRetireFrames = 2;
+
+// Decode-ahead frames, plus the displayed frame, plus the retired frames, plus one
+// for the decoder to write into
+static const int kMaxImages = kDecodeAheadFrames + 1 + kRetireFrames + 1;
+
+// Codec dequeue timeout, which bounds how quickly the decoding thread responds to
+// seeks and close()
+static const int64_t kCodecTimeoutUs = 5000;
+
+// Gap between the timestamps of consecutive epochs; anything longer than the frames
+// decoded ahead will do
+static const int64_t kEpochGapNs = 1000000000;
+
+// Assumed frame duration for looping sources that do not report their duration
+static const int64_t kDefaultFrameDurationUs = 33333;
+
+static const std::string kAssetURLPrefix = "file:///android_asset/";
+static const std::string kFileURLPrefix = "file://";
+
+#pragma mark - Runtime Functions
+
+// AImageReader hardware buffers require API 26, so these are resolved at runtime
+typedef media_status_t (*VRO_PFN_AImageReader_newWithUsage)(int32_t width, int32_t height, int32_t format,
+                                                            uint64_t usage, int32_t maxImages,
+                                                            AImageReader **reader);
+typedef void           (*VRO_PFN_AImageReader_delete)(AImageReader *reader);
+typedef media_status_t (*VRO_PFN_AImageReader_getWindow)(AImageReader *reader, ANativeWindow **window);
+typedef media_status_t (*VRO_PFN_AImageReader_acquireNextImage)(AImageReader *reader, AImage **image);
+typedef void           (*VRO_PFN_AImage_delete)(AImage *image);
+typedef void           (*VRO_PFN_AImage_deleteAsync)(AImage *image, int releaseFenceFd);
+typedef media_status_t (*VRO_PFN_AImage_getTimestamp)(const AImage *image, int64_t *timestampNs);
+typedef media_status_t (*VRO_PFN_AImage_getCropRect)(const AImage *image, AImageCropRect *rect);
+typedef media_status_t (*VRO_PFN_AImage_getHardwareBuffer)(const AImage *image, AHardwareBuffer **buffer);
+
+static VRO_PFN_AImageReader_newWithUsage     sAImageReaderNewWithUsage = nullptr;
+static VRO_PFN_AImageReader_delete           sAImageReaderDelete = nullptr;
+static VRO_PFN_AImageReader_getWindow        sAImageReaderGetWindow = nullptr;
+static VRO_PFN_AImageReader_acquireNextImage sAImageReaderAcquireNextImage = nullptr;
+static VRO_PFN_AImage_delete                 sAImageDelete = nullptr;
+static VRO_PFN_AImage_deleteAsync            sAImageDeleteAsync = nullptr;
+static VRO_PFN_AImage_getTimestamp           sAImageGetTimestamp = nullptr;
+static VRO_PFN_AImage_getCropRect            sAImageGetCropRect = nullptr;
+static VRO_PFN_AImage_getHardwareBuffer      sAImageGetHardwareBuffer = nullptr;
+
+static PFNEGLGETNATIVECLIENTBUFFERANDROIDPROC sEglGetNativeClientBuffer = nullptr;
+static PFNEGLCREATEIMAGEKHRPROC sEglCreateImage = nullptr;
+static PFNEGLDESTROYIMAGEKHRPROC sEglDestroyImage = nullptr;
+static PFNEGLCREATESYNCKHRPROC sEglCreateSync = nullptr;
+static PFNEGLDESTROYSYNCKHRPROC sEglDestroySync = nullptr;
+static PFNEGLDUPNATIVEFENCEFDANDROIDPROC sEglDupNativeFenceFD = nullptr;
+static PFNGLEGLIMAGETARGETTEXTURE2DOESPROC sGlEGLImageTargetTexture2D = nullptr;
+
+static bool sNativeFencesSupported = false;
+static bool sImageCropSupported = false;
+
+static bool hasExtension(const char *extensions, const char *extension) {
+    return extensions != nullptr && strstr(extensions, extension) != nullptr;
+}
+
+static void loadFunctions() {
+    static std::once_flag loaded;
+    std::call_once(loaded, [] {
+        void *library = dlopen("libmediandk.so", RTLD_NOW);
+        if (library != nullptr) {
+            sAImageReaderNewWithUsage     = (VRO_PFN_AImageReader_newWithUsage)     dlsym(library, "AImageReader_newWithUsage");
+            sAImageReaderDelete           = (VRO_PFN_AImageReader_delete)           dlsym(library, "AImageReader_delete");
+            sAImageReaderGetWindow        = (VRO_PFN_AImageReader_getWindow)        dlsym(library, "AImageReader_getWindow");
+            sAImageReaderAcquireNextImage = (VRO_PFN_AImageReader_acquireNextImage) dlsym(library, "AImageReader_acquireNextImage");
+            sAImageDelete                 = (VRO_PFN_AImage_delete)                 dlsym(library, "AImage_delete");
+            sAImageDeleteAsync            = (VRO_PFN_AImage_deleteAsync)            dlsym(library, "AImage_deleteAsync");
+            sAImageGetTimestamp           = (VRO_PFN_AImage_getTimestamp)           dlsym(library, "AImage_getTimestamp");
+            sAImageGetCropRect            = (VRO_PFN_AImage_getCropRect)            dlsym(library, "AImage_getCropRect");
+            sAImageGetHardwareBuffer      = (VRO_PFN_AImage_getHardwareBuffer)      dlsym(library, "AImage_getHardwareBuffer");
+        }
+
+        sEglGetNativeClientBuffer = (PFNEGLGETNATIVECLIENTBUFFERANDROIDPROC) eglGetProcAddress("eglGetNativeClientBufferANDROID");
+        sEglCreateImage = (PFNEGLCREATEIMAGEKHRPROC) eglGetProcAddress("eglCreateImageKHR");
+        sEglDestroyImage = (PFNEGLDESTROYIMAGEKHRPROC) eglGetProcAddress("eglDestroyImageKHR");
+        sEglCreateSync = (PFNEGLCREATESYNCKHRPROC) eglGetProcAddress("eglCreateSyncKHR");
+        sEglDestroySync = (PFNEGLDESTROYSYNCKHRPROC) eglGetProcAddress("eglDestroySyncKHR");
+        sEglDupNativeFenceFD = (PFNEGLDUPNATIVEFENCEFDANDROIDPROC) eglGetProcAddress("eglDupNativeFenceFDANDROID");
+        sGlEGLImageTargetTexture2D = (PFNGLEGLIMAGETARGETTEXTURE2DOESPROC) eglGetProcAddress("glEGLImageTargetTexture2DOES");
+
+        const char *extensions = eglQueryString(eglGetCurrentDisplay(), EGL_EXTENSIONS);
+        sNativeFencesSupported = hasExtension(extensions, "EGL_ANDROID_native_fence_sync") &&
+                                 sEglCreateSync && sEglDestroySync && sEglDupNativeFenceFD && sAImageDeleteAsync;
+        sImageCropSupported = hasExtension(extensions, "EGL_ANDROID_image_crop");
+    });
+}
+
+bool VROVideoDecoderMediaCodec::isSupported() {
+    loadFunctions();
+    return sAImageReaderNewWithUsage && sAImageReaderDelete && sAImageReaderGetWindow &&
+           sAImageReaderAcquireNextImage && sAImageDelete && sAImageGetTimestamp &&
+           sAImageGetCropRect && sAImageGetHardwareBuffer &&
+           sEglGetNativeClientBuffer && sEglCreateImage && sEglDestroyImage && sGlEGLImageTargetTexture2D;
+}
+
+bool VROVideoDecoderMediaCodec::canOpen(std::string url) {
+    return VROStringUtil::startsWith(url, kFileURLPrefix) ||
+           VROStringUtil::startsWith(url, "/") ||
+           VROStringUtil::startsWith(url, "http://") ||
+           VROStringUtil::startsWith(url, "https://");
+}
+
+#pragma mark - Lifecycle
+
+VROVideoDecoderMediaCodec::VROVideoDecoderMediaCodec() :
+    _fd(-1),
+    _extractor(nullptr),
+    _codec(nullptr),
+    _durationUs(0),
+    _lastPresentationUs(0),
+    _loopOffsetUs(0),
+    _skipUntilUs(0),
+    _decodeEpochNs(0),
+    _inputDone(false),
+    _stopped(true),
+    _loop(false),
+    _seekRequested(false),
+    _seekTargetUs(0),
+    _epochNs(0),
+    _lastTimestampNs(0),
+    _failed(false),
+    _reader(nullptr),
+    _renderEpochNs(0),
+    _display(EGL_NO_DISPLAY) {
+
+    _displayedFrame = { nullptr, 0, 0 };
+}
+
+VROVideoDecoderMediaCodec::~VROVideoDecoderMediaCodec() {
+    close();
+}
+
+void VROVideoDecoderMediaCodec::open(std::string url, bool loop) {
+    close();
+
+    _url = url;
+    _loop = loop;
+    _stopped = false;
+    _failed = false;
+    _seekRequested = false;
+    _epochNs = 0;
+    _lastTimestampNs = 0;
+    _renderEpochNs = 0;
+    _display = eglGetCurrentDisplay();
+
+    _thread = std::thread(&VROVideoDecoderMediaCodec::run, this);
+}
+
+void VROVideoDecoderMediaCodec::close() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopped = true;
+    }
+    _condition.notify_all();
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+
+    // Every image must be returned before its reader is deleted
+    AImageReader *reader = _reader.exchange(nullptr);
+    if (reader == nullptr) {
+        return;
+    }
+    for (Frame &frame : _queuedFrames) {
+        sAImageDelete(frame.image);
+    }
+    _queuedFrames.clear();
+    for (Frame &frame : _retiredFrames) {
+        sAImageDelete(frame.image);
+    }
+    _retiredFrames.clear();
+    if (_displayedFrame.image != nullptr) {
+        sAImageDelete(_displayedFrame.image);
+        _displayedFrame = { nullptr, 0, 0 };
+    }
+    destroyImages();
+    sAImageReaderDelete(reader);
+}
+
+void VROVideoDecoderMediaCodec::seek(double seconds) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _epochNs = _lastTimestampNs + kEpochGapNs;
+        _seekTargetUs = (int64_t) (std::max(seconds, 0.0) * 1000000);
+        _seekRequested = true;
+
+        // Frames are stamped relative to the seek target, so the playback time of
+        // the new epoch starts at the target
+        _renderEpochNs = _epochNs;
+    }
+    _condition.notify_all();
+}
+
+void VROVideoDecoderMediaCodec::setLoop(bool loop) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _loop = loop;
+}
+
+#pragma mark - Decoding Thread
+
+void VROVideoDecoderMediaCodec::run() {
+    if (!openSource()) {
+        pwarn("Video decoder: failed to open %s", _url.c_str());
+        _failed = true;
+        closeSource();
+        return;
+    }
+
+    while (true) {
+        bool seekRequested = false;
+        int64_t targetUs = 0;
+        int64_t epochNs = 0;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_stopped) {
+                break;
+            }
+            if (_seekRequested) {
+                seekRequested = true;
+                targetUs = _seekTargetUs;
+                epochNs = _epochNs;
+                _seekRequested = false;
+            }
+        }
+        if (seekRequested) {
+            applySeek(targetUs, epochNs);
+        }
+
+        // Once the source is finished (or failed) there is nothing to do until the
+        // next seek
+        if (!decode()) {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _condition.wait(lock, [this] { return _stopped || _seekRequested; });
+        }
+    }
+    closeSource();
+}
+
+bool VROVideoDecoderMediaCodec::openSource() {
+    _extractor = AMediaExtractor_new();
+
+    media_status_t status = AMEDIA_ERROR_UNKNOWN;
+    if (VROStringUtil::startsWith(_url, kAssetURLPrefix)) {
+        // Assets are read in place, which only works if they are stored uncompressed
+        std::string name = _url.substr(kAssetURLPrefix.size());
+        AAsset *asset = AAssetManager_open(VROPlatformGetAssetManager(), name.c_str(), AASSET_MODE_UNKNOWN);
+        if (asset == nullptr) {
+            return false;
+        }
+        off64_t start, length;
+        _fd = AAsset_openFileDescriptor64(asset, &start, &length);
+        AAsset_close(asset);
+        if (_fd < 0) {
+            return false;
+        }
+        status = AMediaExtractor_setDataSourceFd(_extractor, _fd, start, length);
+    } else if (VROStringUtil::startsWith(_url, "http://") || VROStringUtil::startsWith(_url, "https://")) {
+        status = AMediaExtractor_setDataSource(_extractor, _url.c_str());
+    } else {
+        std::string path = VROStringUtil::startsWith(_url, kFileURLPrefix) ? _url.substr(kFileURLPrefix.size()) : _url;
+        _fd = ::open(path.c_str(), O_RDONLY);
+        struct stat info;
+        if (_fd < 0 || fstat(_fd, &info) != 0) {
+            return false;
+        }
+        status = AMediaExtractor_setDataSourceFd(_extractor, _fd, 0, info.st_size);
+    }
+    if (status != AMEDIA_OK) {
+        return false;
+    }
+
+    size_t numTracks = AMediaExtractor_getTrackCount(_extractor);
+    for (size_t i = 0; i < numTracks; i++) {
+        AMediaFormat *format = AMediaExtractor_getTrackFormat(_extractor, i);
+        const char *mime = nullptr;
+        if (!AMediaFormat_getString(format, AMEDIAFORMAT_KEY_MIME, &mime) ||
+            !VROStringUtil::startsWith(mime, "video/")) {
+            AMediaFormat_delete(format);
+            continue;
+        }
+
+        int32_t width = 0, height = 0;
+        AMediaFormat_getInt32(format, AMEDIAFORMAT_KEY_WIDTH, &width);
+        AMediaFormat_getInt32(format, AMEDIAFORMAT_KEY_HEIGHT, &height);
+        AMediaFormat_getInt64(format, AMEDIAFORMAT_KEY_DURATION, &_durationUs);
+
+        AImageReader *reader = nullptr;
+        ANativeWindow *window = nullptr;
+        if (width <= 0 || height <= 0 ||
+            sAImageReaderNewWithUsage(width, height, AIMAGE_FORMAT_PRIVATE, AHARDWAREBUFFER_USAGE_GPU_SAMPLED_IMAGE,
+                                      kMaxImages, &reader) != AMEDIA_OK) {
+            AMediaFormat_delete(format);
+            return false;
+        }
+        _reader = reader;
+        sAImageReaderGetWindow(reader, &window);
+
+        AMediaExtractor_selectTrack(_extractor, i);
+        _codec = AMediaCodec_createDecoderByType(mime);
+        bool started = _codec != nullptr &&
+                       AMediaCodec_configure(_codec, format, window, nullptr, 0) == AMEDIA_OK &&
+                       AMediaCodec_start(_codec) == AMEDIA_OK;
+        AMediaFormat_delete(format);
+        return started;
+    }
+    return false;
+}
+
+void VROVideoDecoderMediaCodec::closeSource() {
+    if (_codec != nullptr) {
+        AMediaCodec_stop(_codec);
+        AMediaCodec_delete(_codec);
+        _codec = nullptr;
+    }
+    if (_extractor != nullptr) {
+        AMediaExtractor_delete(_extractor);
+        _extractor = nullptr;
+    }
+    if (_fd >= 0) {
+        ::close(_fd);
+        _fd = -1;
+    }
+}
+
+void VROVideoDecoderMediaCodec::applySeek(int64_t targetUs, int64_t epochNs) {
+    AMediaCodec_flush(_codec);
+    AMediaExtractor_seekTo(_extractor, targetUs, AMEDIAEXTRACTOR_SEEK_PREVIOUS_SYNC);
+
+    // Decoding restarts at the sync frame before the target; the frames between it
+    // and the target are decoded but not shown, so the seek is frame accurate
+    _skipUntilUs = targetUs;
+    _loopOffsetUs = 0;
+    _decodeEpochNs = epochNs;
+    _inputDone = false;
+}
+
+bool VROVideoDecoderMediaCodec::decode() {
+    if (_codec == nullptr) {
+        return false;
+    }
+
+    if (!_inputDone) {
+        ssize_t index = AMediaCodec_dequeueInputBuffer(_codec, kCodecTimeoutUs);
+        if (index >= 0) {
+            size_t capacity = 0;
+            uint8_t *buffer = AMediaCodec_getInputBuffer(_codec, index, &capacity);
+            ssize_t size = AMediaExtractor_readSampleData(_extractor, buffer, capacity);
+            if (size < 0) {
+                AMediaCodec_queueInputBuffer(_codec, index, 0, 0, 0, AMEDIACODEC_BUFFER_FLAG_END_OF_STREAM);
+                _inputDone = true;
+            } else {
+                AMediaCodec_queueInputBuffer(_codec, index, 0, size, AMediaExtractor_getSampleTime(_extractor), 0);
+                AMediaExtractor_advance(_extractor);
+            }
+        }
+    }
+
+    // The codec renders into the reader's buffers, so once the renderer holds every
+    // image the codec stalls here until a frame is released: this is what bounds
+    // decode-ahead
+    AMediaCodecBufferInfo info;
+    ssize_t index = AMediaCodec_dequeueOutputBuffer(_codec, &info, kCodecTimeoutUs);
+    if (index < 0) {
+        return true;
+    }
+
+    if (info.flags & AMEDIACODEC_BUFFER_FLAG_END_OF_STREAM) {
+        AMediaCodec_releaseOutputBuffer(_codec, index, false);
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_loop) {
+                return false;
+            }
+        }
+
+        // Keep the timeline continuous by offsetting the next pass by the duration
+        _loopOffsetUs += _durationUs > 0 ? _durationUs : _lastPresentationUs + kDefaultFrameDurationUs;
+        AMediaCodec_flush(_codec);
+        AMediaExtractor_seekTo(_extractor, 0, AMEDIAEXTRACTOR_SEEK_PREVIOUS_SYNC);
+        _skipUntilUs = 0;
+        _inputDone = false;
+        return true;
+    }
+
+    if (info.presentationTimeUs < _skipUntilUs) {
+        AMediaCodec_releaseOutputBuffer(_codec, index, false);
+        return true;
+    }
+
+    _lastPresentationUs = info.presentationTimeUs;
+    int64_t timestampNs = _decodeEpochNs + (_loopOffsetUs + info.presentationTimeUs) * 1000;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _lastTimestampNs = std::max(_lastTimestampNs, timestampNs);
+    }
+    AMediaCodec_releaseOutputBufferAtTime(_codec, index, timestampNs);
+    return true;
+}
+
+#pragma mark - Rendering Thread
+
+bool VROVideoDecoderMediaCodec::updateTexture(GLuint textureId, double seconds) {
+    if (_reader.load() == nullptr) {
+        return false;
+    }
+    releaseRetiredFrames();
+    acquireFrames();
+
+    int64_t epochNs;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        epochNs = _renderEpochNs;
+    }
+    int64_t targetNs = epochNs + (int64_t) (seconds * 1000000000);
+
+    // Drop every frame from before the last seek, and every frame that is due but
+    // superseded by a later due frame. None of these were bound, so they can be
+    // returned right away.
+    Frame next = { nullptr, 0, 0 };
+    while (!_queuedFrames.empty()) {
+        Frame frame = _queuedFrames.front();
+        if (frame.timestampNs >= epochNs && frame.timestampNs > targetNs) {
+            break;
+        }
+        _queuedFrames.pop_front();
+
+        if (frame.timestampNs < epochNs) {
+            sAImageDelete(frame.image);
+            continue;
+        }
+        if (next.image != nullptr) {
+            sAImageDelete(next.image);
+        }
+        next = frame;
+    }
+    if (next.image == nullptr) {
+        return false;
+    }
+
+    EGLImageKHR image = getImage(next.image);
+    if (image == EGL_NO_IMAGE_KHR) {
+        sAImageDelete(next.image);
+        return false;
+    }
+    glBindTexture(GL_TEXTURE_EXTERNAL_OES, textureId);
+    sGlEGLImageTargetTexture2D(GL_TEXTURE_EXTERNAL_OES, (GLeglImageOES) image);
+
+    if (_displayedFrame.image != nullptr) {
+        retireFrame(_displayedFrame);
+    }
+    _displayedFrame = next;
+    return true;
+}
+
+void VROVideoDecoderMediaCodec::acquireFrames() {
+    AImageReader *reader = _reader.load();
+    while (true) {
+        AImage *image = nullptr;
+        if (sAImageReaderAcquireNextImage(reader, &image) != AMEDIA_OK || image == nullptr) {
+            break;
+        }
+
+        int64_t timestampNs = 0;
+        sAImageGetTimestamp(image, &timestampNs);
+        _queuedFrames.push_back({ image, timestampNs, 0 });
+    }
+}
+
+void VROVideoDecoderMediaCodec::retireFrame(Frame frame) {
+    // The draws that sampled the frame have all been issued, since it has just been
+    // replaced: with native fences the image is returned to the decoder once a fence
+    // issued now signals
+    if (sNativeFencesSupported) {
+        EGLint attributes[] = { EGL_SYNC_NATIVE_FENCE_FD_ANDROID, EGL_NO_NATIVE_FENCE_FD_ANDROID, EGL_NONE };
+        EGLSyncKHR sync = sEglCreateSync(_display, EGL_SYNC_NATIVE_FENCE_ANDROID, attributes);
+        if (sync != EGL_NO_SYNC_KHR) {
+            glFlush();
+            int fenceFd = sEglDupNativeFenceFD(_display, sync);
+            sEglDestroySync(_display, sync);
+
+            if (fenceFd >= 0) {
+                sAImageDeleteAsync(frame.image, fenceFd);
+                return;
+            }
+        }
+    }
+    frame.retireCountdown = kRetireFrames;
+    _retiredFrames.push_back(frame);
+}
+
+void VROVideoDecoderMediaCodec::releaseRetiredFrames() {
+    for (auto it = _retiredFrames.begin(); it != _retiredFrames.end();) {
+        if (--it->retireCountdown <= 0) {
+            sAImageDelete(it->image);
+            it = _retiredFrames.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+EGLImageKHR VROVideoDecoderMediaCodec::getImage(AImage *image) {
+    AHardwareBuffer *buffer = nullptr;
+    if (sAImageGetHardwareBuffer(image, &buffer) != AMEDIA_OK || buffer == nullptr) {
+        return EGL_NO_IMAGE_KHR;
+    }
+
+    // The reader cycles through a fixed set of buffers, so each gets one EGLImage
+    auto it = _images.find(buffer);
+    if (it != _images.end()) {
+        return it->second;
+    }
+
+    // Decoders often pad the buffer (e.g. 1080 lines to 1088), so crop the image to
+    // the rectangle that holds the picture where supported
+    std::vector<EGLint> attributes = { EGL_IMAGE_PRESERVED_KHR, EGL_TRUE };
+    AImageCropRect crop;
+    if (sImageCropSupported && sAImageGetCropRect(image, &crop) == AMEDIA_OK) {
+        attributes.insert(attributes.end(), { EGL_IMAGE_CROP_LEFT_ANDROID, crop.left,
+                                              EGL_IMAGE_CROP_TOP_ANDROID, crop.top,
+                                              EGL_IMAGE_CROP_RIGHT_ANDROID, crop.right,
+                                              EGL_IMAGE_CROP_BOTTOM_ANDROID, crop.bottom });
+    }
+    attributes.push_back(EGL_NONE);
+
+    EGLClientBuffer clientBuffer = sEglGetNativeClientBuffer(buffer);
+    EGLImageKHR eglImage = sEglCreateImage(_display, EGL_NO_CONTEXT, EGL_NATIVE_BUFFER_ANDROID, clientBuffer,
+                                           attributes.data());
+    if (eglImage == EGL_NO_IMAGE_KHR) {
+        pwarn("Video decoder: failed to create EGLImage [error %d]", eglGetError());
+        return EGL_NO_IMAGE_KHR;
+    }
+
+    // A format change reallocates the reader's buffers; start over rather than
+    // accumulating images for buffers that no longer exist
+    if (_images.size() >= kMaxImages * 2) {
+        destroyImages();
+    }
+    _images[buffer] = eglImage;
+    return eglImage;
+}
+
+void VROVideoDecoderMediaCodec::destroyImages() {
+    for (auto &kv : _images) {
+        sEglDestroyImage(_display, kv.second);
+    }
+    _images.clear();
+}
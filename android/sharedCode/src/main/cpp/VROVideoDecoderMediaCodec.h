@@ -0,0 +1,180 @@
+//
+//  VROVideoDecoderMediaCodec.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef ANDROID_VROVIDEODECODERMEDIACODEC_H
+#define ANDROID_VROVIDEODECODERMEDIACODEC_H
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include "VROOpenGL.h"
+
+struct AMediaExtractor;
+struct AMediaCodec;
+struct AImageReader;
+struct AImage;
+struct AHardwareBuffer;
+
+/*
+ Decodes the video track of a file or stream with AMediaCodec, straight into the
+ AHardwareBuffers of an AImageReader. Each decoded buffer is bound to an external
+ (OES) texture through an EGLImage, so frames never pass through a SurfaceTexture
+ or the UI thread, and none are copied.
+
+ Decoding runs on its own thread, up to kDecodeAheadFrames frames ahead of
+ presentation. Frames are stamped with their position on the playback timeline,
+ and updateTexture() binds the last frame due at the given time, so the frame
+ shown on each render is the one the clock calls for, regardless of when it was
+ decoded. Time is continuous across loops: with looping enabled, the second pass
+ through a 10 second video spans times 10 to 20.
+
+ Only the video is decoded; audio is left to the caller. Requires Android O (API 26)
+ for AImageReader hardware buffers; the functions are loaded at runtime, so
+ isSupported() returns false on older devices.
+ */
+class VROVideoDecoderMediaCodec {
+public:
+
+    /*
+     True if hardware buffer decoding is available. Must be invoked with the rendering
+     context current.
+     */
+    static bool isSupported();
+
+    /*
+     True if the given URL is something the decoder can open: a file, an uncompressed
+     asset, or an HTTP(S) stream.
+     */
+    static bool canOpen(std::string url);
+
+    VROVideoDecoderMediaCodec();
+    virtual ~VROVideoDecoderMediaCodec();
+
+    /*
+     Start decoding the given URL from the beginning. The source is opened on the
+     decoding thread; if that fails, hasFailed() turns true.
+     */
+    void open(std::string url, bool loop);
+
+    /*
+     Stop decoding and release all resources. Invoked by the destructor.
+     */
+    void close();
+
+    /*
+     Restart decoding from the given position. The playback timeline is reset as
+     well: the next frame bound is the one at the given time.
+     */
+    void seek(double seconds);
+    void setLoop(bool loop);
+
+    /*
+     True once the source has failed to open or decode.
+     */
+    bool hasFailed() const {
+        return _failed;
+    }
+
+    /*
+     Bind the last decoded frame due at the given time on the playback timeline to
+     the given external texture, and release the frames that are no longer needed.
+     Returns true if a new frame was bound. Must be invoked on the rendering thread,
+     before the frame's draws.
+     */
+    bool updateTexture(GLuint textureId, double seconds);
+
+private:
+
+    struct Frame {
+        AImage *image;
+        int64_t timestampNs;
+        int retireCountdown;
+    };
+
+    /*
+     Decoding thread state, owned by the decoding thread once open() returns.
+     */
+    std::thread _thread;
+    std::string _url;
+    int _fd;
+    AMediaExtractor *_extractor;
+    AMediaCodec *_codec;
+    int64_t _durationUs;
+    int64_t _lastPresentationUs;
+    int64_t _loopOffsetUs;
+    int64_t _skipUntilUs;
+    int64_t _decodeEpochNs;
+    bool _inputDone;
+
+    /*
+     Shared between the decoding and rendering threads. Frame timestamps, in
+     nanoseconds, are the playback time since the last seek plus _epochNs. Each seek
+     starts a new epoch past every timestamp issued so far, so frames decoded before
+     the seek are recognized and dropped.
+     */
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    bool _stopped;
+    bool _loop;
+    bool _seekRequested;
+    int64_t _seekTargetUs;
+    int64_t _epochNs;
+    int64_t _lastTimestampNs;
+    std::atomic<bool> _failed;
+    std::atomic<AImageReader *> _reader;
+
+    /*
+     Rendering thread state. Decoded frames waiting to be shown (oldest first), the
+     frame bound to the texture, and replaced frames the GPU may still be reading.
+     */
+    std::deque<Frame> _queuedFrames;
+    Frame _displayedFrame;
+    std::vector<Frame> _retiredFrames;
+    int64_t _renderEpochNs;
+    EGLDisplay _display;
+    std::map<AHardwareBuffer *, EGLImageKHR> _images;
+
+    void run();
+    bool openSource();
+    void closeSource();
+    bool decode();
+    void applySeek(int64_t targetUs, int64_t epochNs);
+
+    void acquireFrames();
+    void retireFrame(Frame frame);
+    void releaseRetiredFrames();
+    EGLImageKHR getImage(AImage *image);
+    void destroyImages();
+
+};
+
+#endif //ANDROID_VROVIDEODECODERMEDIACODEC_H
@@ -0,0 +1,335 @@
+//
+//  VROVideoEncoderMediaCodec.cpp
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROVideoEncoderMediaCodec.h"
+#include "VROTime.h"
+#include "VROLog.h"
+#include <android/native_window.h>
+#include <media/NdkMediaCodec.h>
+#include <media/NdkMediaMuxer.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <mutex>
+
+#ifndef EGL_ANDROID_recordable
+#define EGL_RECORDABLE_ANDROID 0x3142
+#endif
+
+static const char *kEncoderMimeType = "video/avc";
+
+// MediaCodecInfo.CodecCapabilities.COLOR_FormatSurface
+static const int32_t kColorFormatSurface = 0x7F000789;
+
+// MediaCodec.PARAMETER_KEY_VIDEO_BITRATE
+static const char *kParameterVideoBitrate = "video-bitrate";
+
+// Seconds between key frames
+static const int32_t kKeyFrameInterval = 1;
+
+// Output dequeue timeout, which bounds how quickly the drain thread notices close()
+static const int64_t kCodecTimeoutUs = 10000;
+
+// How long close() waits for the encoder to flush out the end of the stream
+static const double kEndOfStreamTimeoutSeconds = 1.0;
+
+#pragma mark - Runtime Functions
+
+// Encoder input surfaces and runtime parameters require API 26, so these are resolved at runtime
+typedef media_status_t (*VRO_PFN_AMediaCodec_createInputSurface)(AMediaCodec *codec, ANativeWindow **surface);
+typedef media_status_t (*VRO_PFN_AMediaCodec_setParameters)(AMediaCodec *codec, const AMediaFormat *params);
+typedef media_status_t (*VRO_PFN_AMediaCodec_signalEndOfInputStream)(AMediaCodec *codec);
+
+static VRO_PFN_AMediaCodec_createInputSurface     sAMediaCodecCreateInputSurface = nullptr;
+static VRO_PFN_AMediaCodec_setParameters          sAMediaCodecSetParameters = nullptr;
+static VRO_PFN_AMediaCodec_signalEndOfInputStream sAMediaCodecSignalEndOfInputStream = nullptr;
+
+static PFNEGLPRESENTATIONTIMEANDROIDPROC sEglPresentationTime = nullptr;
+
+static void loadFunctions() {
+    static std::once_flag loaded;
+    std::call_once(loaded, [] {
+        void *library = dlopen("libmediandk.so", RTLD_NOW);
+        if (library != nullptr) {
+            sAMediaCodecCreateInputSurface     = (VRO_PFN_AMediaCodec_createInputSurface)     dlsym(library, "AMediaCodec_createInputSurface");
+            sAMediaCodecSetParameters          = (VRO_PFN_AMediaCodec_setParameters)          dlsym(library, "AMediaCodec_setParameters");
+            sAMediaCodecSignalEndOfInputStream = (VRO_PFN_AMediaCodec_signalEndOfInputStream) dlsym(library, "AMediaCodec_signalEndOfInputStream");
+        }
+        sEglPresentationTime = (PFNEGLPRESENTATIONTIMEANDROIDPROC) eglGetProcAddress("eglPresentationTimeANDROID");
+    });
+}
+
+bool VROVideoEncoderMediaCodec::isSupported() {
+    loadFunctions();
+    return sAMediaCodecCreateInputSurface && sAMediaCodecSetParameters &&
+           sAMediaCodecSignalEndOfInputStream && sEglPresentationTime;
+}
+
+#pragma mark - Lifecycle
+
+VROVideoEncoderMediaCodec::VROVideoEncoderMediaCodec() :
+    _codec(nullptr),
+    _muxer(nullptr),
+    _window(nullptr),
+    _fd(-1),
+    _width(0),
+    _height(0),
+    _bitrate(0),
+    _failed(false),
+    _display(EGL_NO_DISPLAY),
+    _context(EGL_NO_CONTEXT),
+    _surface(EGL_NO_SURFACE),
+    _previousDraw(EGL_NO_SURFACE),
+    _previousRead(EGL_NO_SURFACE),
+    _stopping(false) {
+
+}
+
+VROVideoEncoderMediaCodec::~VROVideoEncoderMediaCodec() {
+    close();
+}
+
+bool VROVideoEncoderMediaCodec::open(std::string path, int width, int height, int frameRate, int bitrate) {
+    close();
+    if (!isSupported()) {
+        return false;
+    }
+
+    _width = width;
+    _height = height;
+    _bitrate = bitrate;
+    _failed = false;
+    _stopping = false;
+    _display = eglGetCurrentDisplay();
+    _context = eglGetCurrentContext();
+
+    _fd = ::open(path.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0644);
+    if (_fd < 0) {
+        pwarn("Video encoder: failed to open %s for writing", path.c_str());
+        close();
+        return false;
+    }
+    _muxer = AMediaMuxer_new(_fd, AMEDIAMUXER_OUTPUT_FORMAT_MPEG_4);
+    _codec = AMediaCodec_createEncoderByType(kEncoderMimeType);
+    if (_muxer == nullptr || _codec == nullptr) {
+        pwarn("Video encoder: failed to create encoder");
+        close();
+        return false;
+    }
+
+    AMediaFormat *format = AMediaFormat_new();
+    AMediaFormat_setString(format, AMEDIAFORMAT_KEY_MIME, kEncoderMimeType);
+    AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_WIDTH, width);
+    AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_HEIGHT, height);
+    AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_COLOR_FORMAT, kColorFormatSurface);
+    AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_BIT_RATE, bitrate);
+    AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_FRAME_RATE, frameRate);
+    AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_I_FRAME_INTERVAL, kKeyFrameInterval);
+    media_status_t status = AMediaCodec_configure(_codec, format, nullptr, nullptr, AMEDIACODEC_CONFIGURE_FLAG_ENCODE);
+    AMediaFormat_delete(format);
+
+    if (status != AMEDIA_OK || sAMediaCodecCreateInputSurface(_codec, &_window) != AMEDIA_OK) {
+        pwarn("Video encoder: failed to configure %d x %d encoder", width, height);
+        close();
+        return false;
+    }
+
+    EGLConfig config = chooseConfig();
+    _surface = eglCreateWindowSurface(_display, config, _window, nullptr);
+    if (_surface == EGL_NO_SURFACE) {
+        pwarn("Video encoder: failed to create input surface [error %d]", eglGetError());
+        close();
+        return false;
+    }
+
+    if (AMediaCodec_start(_codec) != AMEDIA_OK) {
+        pwarn("Video encoder: failed to start encoder");
+        close();
+        return false;
+    }
+    _thread = std::thread(&VROVideoEncoderMediaCodec::drain, this);
+
+    pinfo("Video encoder: recording %d x %d at %d bps to %s", width, height, bitrate, path.c_str());
+    return true;
+}
+
+void VROVideoEncoderMediaCodec::close() {
+    if (_thread.joinable()) {
+        sAMediaCodecSignalEndOfInputStream(_codec);
+        _stopping = true;
+        _thread.join();
+    }
+
+    if (_surface != EGL_NO_SURFACE) {
+        eglDestroySurface(_display, _surface);
+        _surface = EGL_NO_SURFACE;
+    }
+    if (_window != nullptr) {
+        ANativeWindow_release(_window);
+        _window = nullptr;
+    }
+    if (_codec != nullptr) {
+        AMediaCodec_stop(_codec);
+        AMediaCodec_delete(_codec);
+        _codec = nullptr;
+    }
+    if (_muxer != nullptr) {
+        AMediaMuxer_delete(_muxer);
+        _muxer = nullptr;
+    }
+    if (_fd >= 0) {
+        ::close(_fd);
+        _fd = -1;
+    }
+}
+
+EGLConfig VROVideoEncoderMediaCodec::chooseConfig() {
+    // Use the rendering context's own config if it can feed an encoder; otherwise
+    // find a recordable config with the same color layout, which is compatible with
+    // the context
+    EGLint configId = 0;
+    eglQueryContext(_display, _context, EGL_CONFIG_ID, &configId);
+
+    EGLConfig config = nullptr;
+    EGLint numConfigs = 0;
+    const EGLint idAttribs[] = { EGL_CONFIG_ID, configId, EGL_NONE };
+    eglChooseConfig(_display, idAttribs, &config, 1, &numConfigs);
+
+    EGLint recordable = EGL_FALSE;
+    if (numConfigs > 0 && eglGetConfigAttrib(_display, config, EGL_RECORDABLE_ANDROID, &recordable) && recordable) {
+        return config;
+    }
+
+    EGLint red = 8, green = 8, blue = 8, renderable = EGL_OPENGL_ES2_BIT;
+    if (numConfigs > 0) {
+        eglGetConfigAttrib(_display, config, EGL_RED_SIZE, &red);
+        eglGetConfigAttrib(_display, config, EGL_GREEN_SIZE, &green);
+        eglGetConfigAttrib(_display, config, EGL_BLUE_SIZE, &blue);
+        eglGetConfigAttrib(_display, config, EGL_RENDERABLE_TYPE, &renderable);
+    }
+    const EGLint recordableAttribs[] = {
+        EGL_RED_SIZE, red,
+        EGL_GREEN_SIZE, green,
+        EGL_BLUE_SIZE, blue,
+        EGL_RENDERABLE_TYPE, renderable,
+        EGL_SURFACE_TYPE, EGL_WINDOW_BIT,
+        EGL_RECORDABLE_ANDROID, EGL_TRUE,
+        EGL_NONE
+    };
+    EGLConfig recordableConfig = nullptr;
+    if (eglChooseConfig(_display, recordableAttribs, &recordableConfig, 1, &numConfigs) && numConfigs > 0) {
+        return recordableConfig;
+    }
+    return config;
+}
+
+#pragma mark - Encoding
+
+bool VROVideoEncoderMediaCodec::bindInputSurface() {
+    if (_surface == EGL_NO_SURFACE || _failed) {
+        return false;
+    }
+    _previousDraw = eglGetCurrentSurface(EGL_DRAW);
+    _previousRead = eglGetCurrentSurface(EGL_READ);
+    if (!eglMakeCurrent(_display, _surface, _surface, _context)) {
+        pwarn("Video encoder: failed to bind input surface [error %d]", eglGetError());
+        _failed = true;
+        return false;
+    }
+    return true;
+}
+
+double VROVideoEncoderMediaCodec::submitFrame(double seconds) {
+    double start = VROTimeCurrentSeconds();
+    sEglPresentationTime(_display, _surface, (EGLnsecsANDROID) (seconds * 1e9));
+    eglSwapBuffers(_display, _surface);
+    double elapsed = VROTimeCurrentSeconds() - start;
+
+    eglMakeCurrent(_display, _previousDraw, _previousRead, _context);
+    return elapsed;
+}
+
+void VROVideoEncoderMediaCodec::setBitrate(int bitrate) {
+    if (_codec == nullptr || bitrate == _bitrate) {
+        return;
+    }
+    AMediaFormat *params = AMediaFormat_new();
+    AMediaFormat_setInt32(params, kParameterVideoBitrate, bitrate);
+    if (sAMediaCodecSetParameters(_codec, params) == AMEDIA_OK) {
+        _bitrate = bitrate;
+    }
+    AMediaFormat_delete(params);
+}
+
+#pragma mark - Drain Thread
+
+void VROVideoEncoderMediaCodec::drain() {
+    ssize_t track = -1;
+    double stopTime = 0;
+
+    while (true) {
+        AMediaCodecBufferInfo info;
+        ssize_t index = AMediaCodec_dequeueOutputBuffer(_codec, &info, kCodecTimeoutUs);
+
+        if (index == AMEDIACODEC_INFO_OUTPUT_FORMAT_CHANGED) {
+            // The output format carries the codec config the muxer needs, so the
+            // track is added (and the muxer started) here rather than in open()
+            AMediaFormat *format = AMediaCodec_getOutputFormat(_codec);
+            track = AMediaMuxer_addTrack(_muxer, format);
+            AMediaFormat_delete(format);
+            if (track < 0 || AMediaMuxer_start(_muxer) != AMEDIA_OK) {
+                pwarn("Video encoder: failed to start muxer");
+                _failed = true;
+                break;
+            }
+        }
+        else if (index >= 0) {
+            size_t size = 0;
+            uint8_t *data = AMediaCodec_getOutputBuffer(_codec, index, &size);
+            bool config = (info.flags & AMEDIACODEC_BUFFER_FLAG_CODEC_CONFIG) != 0;
+            if (data != nullptr && info.size > 0 && !config && track >= 0) {
+                AMediaMuxer_writeSampleData(_muxer, track, data, &info);
+            }
+            AMediaCodec_releaseOutputBuffer(_codec, index, false);
+
+            if (info.flags & AMEDIACODEC_BUFFER_FLAG_END_OF_STREAM) {
+                break;
+            }
+        }
+        else if (index == AMEDIACODEC_INFO_TRY_AGAIN_LATER && _stopping) {
+            // Encoders that never produced a frame may never signal the end of the
+            // stream either
+            if (stopTime == 0) {
+                stopTime = VROTimeCurrentSeconds();
+            } else if (VROTimeCurrentSeconds() - stopTime > kEndOfStreamTimeoutSeconds) {
+                break;
+            }
+        }
+    }
+
+    if (track >= 0 && !_failed) {
+        AMediaMuxer_stop(_muxer);
+    }
+}
@@ -0,0 +1,145 @@
+//
+//  VROVideoEncoderMediaCodec.h
+//  ViroRenderer
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef ANDROID_VROVIDEOENCODERMEDIACODEC_H
+#define ANDROID_VROVIDEOENCODERMEDIACODEC_H
+
+#include <string>
+#include <thread>
+#include <atomic>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include "VROOpenGL.h"
+
+struct AMediaCodec;
+struct AMediaMuxer;
+struct ANativeWindow;
+
+/*
+ Encodes rendered frames to an H.264 MP4 file with AMediaCodec. The encoder's input
+ surface is wrapped in an EGL window surface that shares the rendering context, so
+ frames are rendered (or blitted) straight into the encoder's buffers: there is no
+ intermediate surface and no copy through Java.
+
+ Encoded output is drained into an AMediaMuxer on its own thread. Only video is
+ encoded. Requires Android O (API 26) for encoder input surfaces; the functions
+ are loaded at runtime, so isSupported() returns false on older devices.
+ */
+class VROVideoEncoderMediaCodec {
+public:
+
+    /*
+     True if surface encoding is available. Must be invoked with the rendering
+     context current.
+     */
+    static bool isSupported();
+
+    VROVideoEncoderMediaCodec();
+    virtual ~VROVideoEncoderMediaCodec();
+
+    /*
+     Create the encoder and its input surface, and start writing to the file at the
+     given path. Must be invoked with the rendering context current. Returns false
+     if the encoder could not be created.
+     */
+    bool open(std::string path, int width, int height, int frameRate, int bitrate);
+
+    /*
+     Finish the file and release all resources. Invoked by the destructor.
+     */
+    void close();
+
+    bool isOpen() const {
+        return _surface != EGL_NO_SURFACE;
+    }
+    int getWidth() const {
+        return _width;
+    }
+    int getHeight() const {
+        return _height;
+    }
+
+    /*
+     Make the encoder's input surface current for drawing, so that framebuffer 0
+     refers to the encoder. Returns false if the surface could not be made current.
+     */
+    bool bindInputSurface();
+
+    /*
+     Submit the frame drawn to the input surface, stamped with the given time in
+     seconds, and make the surfaces that were current before bindInputSurface()
+     current again. Returns the time spent submitting, in seconds; this grows when the
+     encoder falls behind, since the swap blocks until an input buffer is free.
+     */
+    double submitFrame(double seconds);
+
+    /*
+     Change the target bitrate of the stream in flight.
+     */
+    void setBitrate(int bitrate);
+    int getBitrate() const {
+        return _bitrate;
+    }
+
+    /*
+     True once the encoder or muxer has failed.
+     */
+    bool hasFailed() const {
+        return _failed;
+    }
+
+private:
+
+    AMediaCodec *_codec;
+    AMediaMuxer *_muxer;
+    ANativeWindow *_window;
+    int _fd;
+    int _width, _height;
+    int _bitrate;
+    std::atomic<bool> _failed;
+
+    /*
+     EGL state: the encoder's window surface, and the surfaces that were current when
+     it was bound, to restore on submit.
+     */
+    EGLDisplay _display;
+    EGLContext _context;
+    EGLSurface _surface;
+    EGLSurface _previousDraw;
+    EGLSurface _previousRead;
+
+    /*
+     The drain thread, which moves encoded buffers into the muxer until it sees the
+     end of the stream.
+     */
+    std::thread _thread;
+    std::atomic<bool> _stopping;
+    void drain();
+
+    EGLConfig chooseConfig();
+
+};
+
+#endif //ANDROID_VROVIDEOENCODERMEDIACODEC_H
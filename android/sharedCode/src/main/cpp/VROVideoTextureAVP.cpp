@@ -28,15 +28,35 @@
 #include "VROTextureSubstrateOpenGL.h"
 #include "VROPlatformUtil.h"
 #include "VRODriverOpenGL.h"
+#include "VROVideoDecoderMediaCodec.h"
+#include "VROTime.h"
+#include <cmath>
+
+// How often the native decoder's clock is checked against the AVPlayer
+static const double kClockSyncInterval = 0.5;
+
+// Drift beyond which the clock is corrected toward the AVPlayer
+static const double kMaxClockDrift = 0.04;
+
+// Drift beyond which the AVPlayer is assumed to have jumped, so the decoder seeks
+static const double kMaxSeekDrift = 1.0;
 
 VROVideoTextureAVP::VROVideoTextureAVP(VROStereoMode stereoMode) :
     VROVideoTexture(VROTextureType::TextureEGLImage, stereoMode),
-    _textureId(0)
+    _textureId(0),
+    _playerRendersVideo(false),
+    _paused(true),
+    _buffering(false),
+    _loop(false),
+    _playbackTime(0),
+    _lastFrameTime(0),
+    _lastClockSyncTime(0)
 {
 
 }
 
 VROVideoTextureAVP::~VROVideoTextureAVP() {
+    _decoder.reset();
     delete (_player);
 
     std::shared_ptr<VRODriverOpenGL> driver = _driver.lock();
@@ -58,33 +78,111 @@ void VROVideoTextureAVP::setDelegate(std::shared_ptr<VROVideoDelegateInternal> d
 void VROVideoTextureAVP::loadVideo(std::string url,
                                    std::shared_ptr<VROFrameSynchronizer> frameSynchronizer,
                                    std::shared_ptr<VRODriver> driver) {
-    _player->setDataSourceURL(url.c_str());
     _driver = std::dynamic_pointer_cast<VRODriverOpenGL>(driver);
+    loadDecoder(url);
+    _player->setDataSourceURL(url.c_str());
 
     frameSynchronizer->removeFrameListener(std::dynamic_pointer_cast<VROVideoTexture>(shared_from_this()));
     frameSynchronizer->addFrameListener(std::dynamic_pointer_cast<VROVideoTexture>(shared_from_this()));
 }
 
 void VROVideoTextureAVP::loadVideoFromURL(std::string url, std::shared_ptr<VRODriver> driver) {
+    // Without a frame synchronizer there is nothing to drive the native decoder
+    _decoder.reset();
+    setPlayerRendersVideo();
     _player->setDataSourceURL(url.c_str());
 }
 
+void VROVideoTextureAVP::loadDecoder(std::string url) {
+    _decoder.reset();
+
+    // Once the AVPlayer has a SurfaceTexture it keeps rendering into it
+    if (!_playerRendersVideo && _textureId != 0 &&
+        VROVideoDecoderMediaCodec::isSupported() && VROVideoDecoderMediaCodec::canOpen(url)) {
+        _decoder = std::unique_ptr<VROVideoDecoderMediaCodec>(new VROVideoDecoderMediaCodec());
+        _decoder->open(url, _loop);
+
+        _playbackTime = 0;
+        _lastFrameTime = 0;
+        _lastClockSyncTime = 0;
+    } else {
+        setPlayerRendersVideo();
+    }
+}
+
+void VROVideoTextureAVP::setPlayerRendersVideo() {
+    if (!_playerRendersVideo && _textureId != 0) {
+        _player->setSurface(_textureId);
+        _playerRendersVideo = true;
+    }
+}
+
 void VROVideoTextureAVP::prewarm() {
 
 }
 
 void VROVideoTextureAVP::onFrameWillRender(const VRORenderContext &context) {
     VROVideoTexture::updateVideoTime();
+    if (!_decoder) {
+        return;
+    }
+    if (_decoder->hasFailed()) {
+        pwarn("Native video decoding failed, falling back to AVPlayer rendering");
+        _decoder.reset();
+        setPlayerRendersVideo();
+        return;
+    }
+
+    double now = VROTimeCurrentSeconds();
+    if (!_paused && !_buffering && _lastFrameTime > 0) {
+        _playbackTime += now - _lastFrameTime;
+    }
+    _lastFrameTime = now;
+
+    if (now - _lastClockSyncTime > kClockSyncInterval) {
+        syncClockWithPlayer();
+        _lastClockSyncTime = now;
+    }
+    _decoder->updateTexture(_textureId, _playbackTime);
+}
+
+void VROVideoTextureAVP::syncClockWithPlayer() {
+    _paused = _player->isPaused();
+    double playerTime = _player->getCurrentTimeInSeconds();
+    double duration = _player->getVideoDurationInSeconds();
+
+    // The decoder's timeline is continuous across loops while the player's wraps,
+    // so compare positions within the video
+    double drift;
+    if (_loop && duration > 0) {
+        drift = playerTime - fmod(_playbackTime, duration);
+        if (drift > duration / 2) {
+            drift -= duration;
+        } else if (drift < -duration / 2) {
+            drift += duration;
+        }
+    } else {
+        drift = playerTime - _playbackTime;
+    }
+
+    if (fabs(drift) > kMaxSeekDrift) {
+        _decoder->seek(playerTime);
+        _playbackTime = playerTime;
+    } else if (fabs(drift) > kMaxClockDrift) {
+        _playbackTime += drift;
+    }
 }
 
 void VROVideoTextureAVP::onFrameDidRender(const VRORenderContext &context) { }
 
 void VROVideoTextureAVP::play() {
     _player->play();
+    _paused = false;
 }
 
 void VROVideoTextureAVP::pause() {
     _player->pause();
+    _paused = true;
 }
 
 bool VROVideoTextureAVP::isPaused() {
@@ -102,6 +200,11 @@ void VROVideoTextureAVP::seekToTime(float seconds) {
         seconds = 0;
     }
     _player->seekToTime(seconds);
+
+    if (_decoder) {
+        _decoder->seek(seconds);
+        _playbackTime = seconds;
+    }
 }
 
 float VROVideoTextureAVP::getCurrentTimeInSeconds() {
@@ -121,7 +224,11 @@ void VROVideoTextureAVP::setVolume(float volume) {
 }
 
 void VROVideoTextureAVP::setLoop(bool loop) {
+    _loop = loop;
     _player->setLoop(loop);
+    if (_decoder) {
+        _decoder->setLoop(loop);
+    }
 }
 
 void VROVideoTextureAVP::bindSurface(std::shared_ptr<VRODriverOpenGL> driver) {
@@ -138,12 +245,14 @@ void VROVideoTextureAVP::bindSurface(std::shared_ptr<VRODriverOpenGL> driver) {
             new VROTextureSubstrateOpenGL(GL_TEXTURE_EXTERNAL_OES, _textureId, driver, true));
     setSubstrate(0, std::move(substrate));
 
-    _player->setSurface(_textureId);
+    // The AVPlayer is given a SurfaceTexture when the video is loaded, and only if
+    // the video can't be decoded natively
 }
 
 #pragma mark - VROAVPlayerDelegate
 
 void VROVideoTextureAVP::willBuffer() {
+    _buffering = true;
     std::shared_ptr<VROVideoDelegateInternal> delegate = _delegate.lock();
     if (delegate) {
         delegate->videoWillBuffer();
@@ -151,6 +260,7 @@ void VROVideoTextureAVP::willBuffer() {
 }
 
 void VROVideoTextureAVP::didBuffer() {
+    _buffering = false;
     std::shared_ptr<VROVideoDelegateInternal> delegate = _delegate.lock();
     if (delegate) {
         delegate->videoDidBuffer();
@@ -162,6 +272,7 @@ void VROVideoTextureAVP::onPrepared() {
 }
 
 void VROVideoTextureAVP::onFinished() {
+    _paused = true;
     std::shared_ptr<VROVideoDelegateInternal> delegate = _delegate.lock();
     if (delegate) {
         delegate->videoDidFinish();
@@ -32,13 +32,21 @@
 #include "VROAVPlayer.h"
 #include <android/native_window_jni.h>
 #include "VROFrameSynchronizer.h"
+#include <atomic>
 
 class VRODriverOpenGL;
+class VROVideoDecoderMediaCodec;
 
 /*
  Renders video to a texture and plays the associated audio.
  The VROVideoLooper is the underlying workhorse class for
  rendering video.
+
+ Where supported, video frames are decoded natively by a
+ VROVideoDecoderMediaCodec and bound to the texture as hardware
+ buffers, while the AVPlayer only plays the audio and drives the
+ clock the decoder follows. Otherwise the AVPlayer renders video
+ through a SurfaceTexture.
  */
 class VROVideoTextureAVP : public VROVideoTexture, public VROAVPlayerDelegate {
 
@@ -106,6 +114,29 @@ private:
     GLuint _textureId;
     std::weak_ptr<VRODriverOpenGL> _driver;
 
+    /*
+     The native decoder, if video frames are decoded natively, and whether the
+     AVPlayer has been given a SurfaceTexture to render video into instead.
+     */
+    std::unique_ptr<VROVideoDecoderMediaCodec> _decoder;
+    bool _playerRendersVideo;
+
+    /*
+     Playback clock for the native decoder. It advances with each frame while
+     playing, and is corrected against the AVPlayer every kClockSyncInterval
+     seconds, which keeps the video in step with the audio.
+     */
+    std::atomic<bool> _paused;
+    std::atomic<bool> _buffering;
+    bool _loop;
+    double _playbackTime;
+    double _lastFrameTime;
+    double _lastClockSyncTime;
+
+    void loadDecoder(std::string url);
+    void setPlayerRendersVideo();
+    void syncClockWithPlayer();
+
 };
 
 #endif //ANDROID_VROVIDEOTEXTUREAVP_H
@@ -28,6 +28,7 @@
 #define ARCORE_API_h
 
 #include <stdint.h>
+#include <vector>
 #include <arcore_c_api.h>
 
 typedef struct AImage AImage;
@@ -125,7 +126,8 @@ namespace arcore {
 
     enum class LightingMode {
         Disabled,
-        AmbientIntensity
+        AmbientIntensity,
+        EnvironmentalHDR
     };
     enum class PlaneFindingMode {
         Disabled,
@@ -158,6 +160,10 @@ namespace arcore {
                                                                       int32_t image_stride_in_pixels, float image_width_in_meters,
                                                                       int32_t *out_index) = 0;
 
+        // Serializes the database, including the features extracted from its images, so that it
+        // can be recreated by Session::createAugmentedImageDatabase without extracting them again.
+        virtual bool serialize(std::vector<uint8_t> *outData) = 0;
+
     };
 
     class Pose {
@@ -232,6 +238,7 @@ namespace arcore {
         virtual ~LightEstimate() {}
         virtual float getPixelIntensity() = 0;
         virtual void getColorCorrection(float *outColorCorrection) = 0;
+        virtual void getEnvironmentalHDRAmbientSphericalHarmonics(float *outCoefficients27) = 0;
         virtual bool isValid() = 0;
     };
 
@@ -308,6 +315,7 @@ namespace arcore {
                                      FocusMode focusMode) = 0;
 
         virtual AugmentedImageDatabase *createAugmentedImageDatabase() = 0;
+        // Returns nullptr if the buffer is not a valid serialized database.
         virtual AugmentedImageDatabase *createAugmentedImageDatabase(uint8_t* raw_buffer, int64_t size) = 0;
         virtual Pose *createPose() = 0;
         virtual Pose *createPose(float px, float py, float pz, float qx, float qy, float qz, float qw) = 0;
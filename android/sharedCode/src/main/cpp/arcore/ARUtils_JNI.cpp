@@ -179,8 +179,8 @@ VRO_OBJECT ARUtilsCreateARHitTestResult(std::shared_ptr<VROARHitTestResult> resu
 VRO_OBJECT ARUtilsCreateARPointCloud(std::shared_ptr<VROARPointCloud> pointCloud) {
     VRO_ENV env = VROPlatformGetJNIEnv();
 
-    std::vector<VROVector4f> points = pointCloud->getPoints();
-    std::vector<uint64_t> identifiers = pointCloud->getIdentifiers();
+    const std::vector<VROVector4f> &points = pointCloud->getPoints();
+    const std::vector<uint64_t> &identifiers = pointCloud->getIdentifiers();
     VRO_FLOAT tempConfidencesArr[points.size() * 4];
     VRO_LONG identifiersArr[identifiers.size()];
 
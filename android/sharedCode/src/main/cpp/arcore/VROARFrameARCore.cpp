@@ -31,6 +31,7 @@
 #include "VROPlatformUtil.h"
 #include "VROVector4f.h"
 #include "VROLight.h"
+#include "VROSphericalHarmonics.h"
 #include "VROARHitTestResultARCore.h"
 
 VROARFrameARCore::VROARFrameARCore(arcore::Frame *frame,
@@ -265,6 +266,33 @@ VROVector3f VROARFrameARCore::getAmbientLightColor() const {
     return VROLight::convertGammaToLinear(gammaColor);
 }
 
+std::shared_ptr<VROSphericalHarmonics> VROARFrameARCore::getAmbientSphericalHarmonics() const {
+    std::shared_ptr<VROARSessionARCore> session = _session.lock();
+    if (!session || session->getLightingMode() != arcore::LightingMode::EnvironmentalHDR) {
+        return nullptr;
+    }
+
+    arcore::LightEstimate *estimate = session->getSessionInternal()->createLightEstimate();
+    _frame->getLightEstimate(estimate);
+
+    std::shared_ptr<VROSphericalHarmonics> sh;
+    if (estimate->isValid()) {
+        float coefficients[kSphericalHarmonicsCoefficients * 3];
+        estimate->getEnvironmentalHDRAmbientSphericalHarmonics(coefficients);
+
+        // ARCore's basis includes the Condon-Shortley phase, which negates the odd
+        // orders (m = -1 and m = 1)
+        for (int i : { 1, 3, 5, 7 }) {
+            for (int c = 0; c < 3; c++) {
+                coefficients[i * 3 + c] = -coefficients[i * 3 + c];
+            }
+        }
+        sh = std::make_shared<VROSphericalHarmonics>(coefficients);
+    }
+    delete (estimate);
+    return sh;
+}
+
 std::shared_ptr<VROARPointCloud> VROARFrameARCore::getPointCloud() {
     if (_pointCloud) {
         return _pointCloud;
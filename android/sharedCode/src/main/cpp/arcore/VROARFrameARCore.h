@@ -52,6 +52,7 @@ public:
     
     float getAmbientLightIntensity() const;
     VROVector3f getAmbientLightColor() const;
+    std::shared_ptr<VROSphericalHarmonics> getAmbientSphericalHarmonics() const;
 
     bool hasDisplayGeometryChanged();
     void getBackgroundTexcoords(VROVector3f *BL, VROVector3f *BR, VROVector3f *TL, VROVector3f *TR);
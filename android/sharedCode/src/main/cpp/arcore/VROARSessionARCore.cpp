@@ -41,9 +41,28 @@
 #include "VROARHitTestResult.h"
 #include "VROFrameSynchronizer.h"
 #include "VROCloudAnchorProviderARCore.h"
+#include "VROGeometryCache.h"
 
 static bool kDebugTracking = false;
 
+// Image target rotations transpose the image in square tiles of this size
+static const int kRotationTileSize = 32;
+
+// Seeds the keys of cached image databases; bump to invalidate them if target preparation changes
+static const uint32_t kImageDatabaseKeyVersion = 1;
+
+/*
+ An image target converted to the upright grayscale image ARCore extracts features from.
+ */
+struct VROPreparedImageTarget {
+    std::string name;
+    uint8_t *grayscaleImage;
+    int width;
+    int height;
+    size_t stride;
+    float physicalWidth;
+};
+
 VROARSessionARCore::VROARSessionARCore(std::shared_ptr<VRODriverOpenGL> driver) :
     VROARSession(VROTrackingType::DOF6, VROWorldAlignment::Gravity),
     _lightingMode(arcore::LightingMode::AmbientIntensity),
@@ -59,6 +78,8 @@ VROARSessionARCore::VROARSessionARCore(std::shared_ptr<VRODriverOpenGL> driver)
     _session = nullptr;
     _frame = nullptr;
     _frameCount = 0;
+    _currentARCoreImageDatabase = nullptr;
+    _imageDatabaseGeneration = 0;
 }
 
 void VROARSessionARCore::setARCoreSession(arcore::Session *session,
@@ -68,6 +89,9 @@ void VROARSessionARCore::setARCoreSession(arcore::Session *session,
 
     if (getImageTrackingImpl() == VROImageTrackingImpl::ARCore) {
         _currentARCoreImageDatabase = _session->createAugmentedImageDatabase();
+        if (_loadedImageDatabase || !_imageTargets.empty()) {
+            rebuildImageDatabase();
+        }
     }
 
     _cloudAnchorProvider = std::make_shared<VROCloudAnchorProviderARCore>(shared_from_this());
@@ -103,6 +127,10 @@ VROARSessionARCore::~VROARSessionARCore() {
         delete (_frame);
     }
 
+    // Drop any trackable updates still in flight; they reference ARCore anchors
+    VROJobSystem::getShared()->wait(_trackableCounter);
+    _trackableUpdates.clear();
+
     // Remove all anchors
     pinfo("Removing all anchors (%d) from session", (int) _anchors.size());
 
@@ -120,9 +148,9 @@ VROARSessionARCore::~VROARSessionARCore() {
         // Deleting the session could take a few seconds, so to prevent blocking the main thread,
         // they recommend pausing the session, then deleting on a background thread!
         _session->pause();
-        VROPlatformDispatchAsyncBackground([this] {
+        VROPlatformDispatchAsyncWorker([this] {
             delete(_session);
-        });
+        }, VROTaskPriority::Low);
 
         if (_currentARCoreImageDatabase != nullptr) {
             delete(_currentARCoreImageDatabase);
@@ -300,57 +328,13 @@ void VROARSessionARCore::setWorldOrigin(VROMatrix4f relativeTransform) {
 #pragma mark - AR Image Targets
 
 void VROARSessionARCore::loadARImageDatabase(std::shared_ptr<VROARImageDatabase> arImageDatabase) {
-    std::weak_ptr<VROARSessionARCore> w_arsession = shared_from_this();
-    VROPlatformDispatchAsyncBackground([arImageDatabase, w_arsession] {
-        std::shared_ptr<VROARSessionARCore> arsession = w_arsession.lock();
-        if (arsession) {
-
-            // load the image database from the given fileBuffer
-            arcore::AugmentedImageDatabase *loadedDatabase =
-                    arsession->_session->createAugmentedImageDatabase(arImageDatabase->getFileData(),
-                                                                      arImageDatabase->getLength());
-
-            // add all the image targets to the database that were added through addARImageTarget
-            for (int i = 0; i < arsession->_imageTargets.size(); i++) {
-                arsession->addTargetToDatabase(arsession->_imageTargets[i], loadedDatabase);
-            }
-
-            // update the ARCore config on the renderer thread
-            VROPlatformDispatchAsyncRenderer([w_arsession, loadedDatabase] {
-                std::shared_ptr<VROARSessionARCore> arsession = w_arsession.lock();
-                if (arsession) {
-                    arsession->_currentARCoreImageDatabase = loadedDatabase;
-                    arsession->updateARCoreConfig();
-                }
-            });
-        }
-    });
+    _loadedImageDatabase = arImageDatabase;
+    rebuildImageDatabase();
 }
 
 void VROARSessionARCore::unloadARImageDatabase() {
-    std::weak_ptr<VROARSessionARCore> w_arsession = shared_from_this();
-    VROPlatformDispatchAsyncBackground([w_arsession] {
-        std::shared_ptr<VROARSessionARCore> arsession = w_arsession.lock();
-        if (arsession) {
-
-            // create an empty image database
-            arcore::AugmentedImageDatabase *database = arsession->_session->createAugmentedImageDatabase();
-
-            // add all the image targets to the database that were added through addARImageTarget
-            for (int i = 0; i < arsession->_imageTargets.size(); i++) {
-                arsession->addTargetToDatabase(arsession->_imageTargets[i], database);
-            }
-
-            // update the ARCore config on the renderer thread
-            VROPlatformDispatchAsyncRenderer([w_arsession, database] {
-                std::shared_ptr<VROARSessionARCore> arsession = w_arsession.lock();
-                if (arsession) {
-                    arsession->_currentARCoreImageDatabase = database;
-                    arsession->updateARCoreConfig();
-                }
-            });
-        }
-    });
+    _loadedImageDatabase = nullptr;
+    rebuildImageDatabase();
 }
 
 void VROARSessionARCore::addARImageTarget(std::shared_ptr<VROARImageTarget> target) {
@@ -358,86 +342,193 @@ void VROARSessionARCore::addARImageTarget(std::shared_ptr<VROARImageTarget> targ
     target->initWithTrackingImpl(getImageTrackingImpl());
     if (getImageTrackingImpl() == VROImageTrackingImpl::ARCore) {
         _imageTargets.push_back(target);
-        std::weak_ptr<VROARSessionARCore> w_arsession = shared_from_this();
-        VROPlatformDispatchAsyncBackground([target, w_arsession] {
-            std::shared_ptr<VROARSessionARCore> arsession = w_arsession.lock();
-            if (arsession) {
-                arsession->addTargetToDatabase(target, arsession->_currentARCoreImageDatabase);
-                // update the ARCore config on the renderer thread
-                VROPlatformDispatchAsyncRenderer([w_arsession] {
-                    std::shared_ptr<VROARSessionARCore> arsession = w_arsession.lock();
-                    if (arsession) {
-                        arsession->updateARCoreConfig();
-                    }
-                });
-            }
-        });
+        rebuildImageDatabase();
     }
 }
 
 void VROARSessionARCore::removeARImageTarget(std::shared_ptr<VROARImageTarget> target) {
     if (getImageTrackingImpl() == VROImageTrackingImpl::ARCore) {
-        // First, we remove the target from the list of targets
         _imageTargets.erase(std::remove_if(_imageTargets.begin(), _imageTargets.end(),
                                            [target](std::shared_ptr<VROARImageTarget> candidate) {
                                                return candidate == target;
                                            }), _imageTargets.end());
+        rebuildImageDatabase();
+    }
+}
 
-        arcore::AugmentedImageDatabase *oldDatabase = _currentARCoreImageDatabase;
-        _currentARCoreImageDatabase = _session->createAugmentedImageDatabase();
-        std::weak_ptr<VROARSessionARCore> w_arsession = shared_from_this();
-        VROPlatformDispatchAsyncBackground([w_arsession, target] {
-            std::shared_ptr<VROARSessionARCore> arsession = w_arsession.lock();
-            if (arsession) {
-                // Now add all the targets back into the database...
-                for (int i = 0; i < arsession->_imageTargets.size(); i++) {
-                    arsession->addTargetToDatabase(arsession->_imageTargets[i],
-                                                   arsession->_currentARCoreImageDatabase);
-                }
+void VROARSessionARCore::rebuildImageDatabase() {
+    if (_session == nullptr) {
+        return;
+    }
+    if (_imageDatabaseCacheDirectory.empty()) {
+        _imageDatabaseCacheDirectory = VROPlatformGetCacheDirectory() + "/viro_ar_images";
+    }
 
-                // update the ARCore config on the renderer thread
-                VROPlatformDispatchAsyncRenderer([w_arsession] {
-                    std::shared_ptr<VROARSessionARCore> arsession = w_arsession.lock();
-                    if (arsession) {
-                        // then "update" the config with the new target database.
-                        arsession->updateARCoreConfig();
-                    }
-                });
+    int generation = ++_imageDatabaseGeneration;
+    std::vector<std::shared_ptr<VROARImageTarget>> targets = _imageTargets;
+    std::shared_ptr<VROARImageDatabase> baseDatabase = _loadedImageDatabase;
+    std::string cacheDirectory = _imageDatabaseCacheDirectory;
+
+    std::weak_ptr<VROARSessionARCore> w_arsession = shared_from_this();
+    VROPlatformDispatchAsyncWorker([w_arsession, targets, baseDatabase, cacheDirectory, generation] {
+        std::shared_ptr<VROARSessionARCore> arsession = w_arsession.lock();
+        if (!arsession || arsession->_imageDatabaseGeneration != generation) {
+            return;
+        }
+
+        arcore::AugmentedImageDatabase *database = arsession->buildImageDatabase(targets, baseDatabase,
+                                                                                 cacheDirectory, generation);
+        if (database == nullptr) {
+            return;
+        }
+
+        // update the ARCore config on the renderer thread
+        VROPlatformDispatchAsyncRenderer([w_arsession, database, generation] {
+            std::shared_ptr<VROARSessionARCore> arsession = w_arsession.lock();
+            if (!arsession || arsession->_imageDatabaseGeneration != generation) {
+                delete (database);
+                return;
             }
-        });
 
-        delete (oldDatabase);
-    }
+            // The config copies the database, so the previous one can be deleted once replaced
+            arcore::AugmentedImageDatabase *oldDatabase = arsession->_currentARCoreImageDatabase;
+            arsession->_currentARCoreImageDatabase = database;
+            arsession->updateARCoreConfig();
+            delete (oldDatabase);
+        });
+    });
 }
 
-// Note: this function should be called on a background thread (as per guidance by ARCore for the
-//       addImageWithPhysicalSize function).
-void VROARSessionARCore::addTargetToDatabase(std::shared_ptr<VROARImageTarget> target,
-                                             arcore::AugmentedImageDatabase *database) {
-    std::shared_ptr<VROARImageTargetAndroid> targetAndroid = std::dynamic_pointer_cast<VROARImageTargetAndroid>(target);
+arcore::AugmentedImageDatabase *VROARSessionARCore::buildImageDatabase(std::vector<std::shared_ptr<VROARImageTarget>> targets,
+                                                                       std::shared_ptr<VROARImageDatabase> baseDatabase,
+                                                                       std::string cacheDirectory, int generation) {
+    std::lock_guard<std::mutex> lock(_imageDatabaseMutex);
+    if (_imageDatabaseGeneration != generation) {
+        return nullptr;
+    }
 
     // a target w/o an image means it came from the database, so do nothing with them!
-    if (!targetAndroid->getImage()) {
-        return;
+    std::vector<std::shared_ptr<VROARImageTargetAndroid>> imageTargets;
+    std::vector<std::shared_ptr<VROImageAndroid>> images;
+    for (std::shared_ptr<VROARImageTarget> &target : targets) {
+        std::shared_ptr<VROARImageTargetAndroid> targetAndroid = std::dynamic_pointer_cast<VROARImageTargetAndroid>(target);
+        if (!targetAndroid || !targetAndroid->getImage()) {
+            continue;
+        }
+        std::shared_ptr<VROImageAndroid> imageAndroid = std::dynamic_pointer_cast<VROImageAndroid>(targetAndroid->getImage());
+        imageTargets.push_back(targetAndroid);
+        if (std::find(images.begin(), images.end(), imageAndroid) == images.end()) {
+            images.push_back(imageAndroid);
+        }
     }
 
-    std::shared_ptr<VROImageAndroid> imageAndroid = std::dynamic_pointer_cast<VROImageAndroid>(targetAndroid->getImage());
+    /*
+     Convert the images to grayscale, then rotate each target upright, in parallel. Images
+     cache their grayscale data, so each is converted once even if shared by several targets.
+     */
+    VROJobSystem::getShared()->parallelFor(0, (int) images.size(), 1, [&images](int i) {
+        size_t length, stride;
+        images[i]->getGrayscaleData(&length, &stride);
+    });
 
-    size_t length;
-    size_t stride;
-    uint8_t *grayscaleImage = imageAndroid->getGrayscaleData(&length, &stride);
-    int32_t outIndex;
+    std::vector<VROPreparedImageTarget> prepared(imageTargets.size());
+    VROJobSystem::getShared()->parallelFor(0, (int) imageTargets.size(), 1, [this, &imageTargets, &prepared](int i) {
+        std::shared_ptr<VROImageAndroid> imageAndroid = std::dynamic_pointer_cast<VROImageAndroid>(imageTargets[i]->getImage());
+
+        VROPreparedImageTarget &target = prepared[i];
+        size_t length;
+        target.grayscaleImage = imageAndroid->getGrayscaleData(&length, &target.stride);
+        target.width = imageAndroid->getWidth();
+        target.height = imageAndroid->getHeight();
+        rotateImageForOrientation(&target.grayscaleImage, &target.width, &target.height, &target.stride,
+                                  imageTargets[i]->getOrientation());
+        target.name = imageTargets[i]->getId();
+        target.physicalWidth = imageTargets[i]->getPhysicalWidth();
+    });
+
+    // Key the database by everything that goes into it
+    uint64_t key = VROGeometryCache::hash(&kImageDatabaseKeyVersion, sizeof(kImageDatabaseKeyVersion));
+    if (baseDatabase) {
+        uint64_t baseHash = baseDatabase->getContentHash();
+        key = VROGeometryCache::hash(&baseHash, sizeof(baseHash), key);
+    }
+    for (VROPreparedImageTarget &target : prepared) {
+        key = VROGeometryCache::hash(target.name.data(), target.name.size(), key);
+        key = VROGeometryCache::hash(&target.width, sizeof(target.width), key);
+        key = VROGeometryCache::hash(&target.height, sizeof(target.height), key);
+        key = VROGeometryCache::hash(&target.physicalWidth, sizeof(target.physicalWidth), key);
+        key = VROGeometryCache::hash(target.grayscaleImage, target.stride * target.height, key);
+    }
 
-    int width = imageAndroid->getWidth();
-    int height = imageAndroid->getHeight();
-    rotateImageForOrientation(&grayscaleImage, &width, &height, &stride, target->getOrientation());
+    // Load the database in one call if it was built before, else extract the features of every target
+    arcore::AugmentedImageDatabase *database = nullptr;
+    std::shared_ptr<VROARImageDatabase> cached = VROARImageDatabase::loadCached(cacheDirectory, key);
+    if (cached) {
+        database = _session->createAugmentedImageDatabase(cached->getFileData(), cached->getLength());
+    }
+
+    if (database == nullptr) {
+        if (baseDatabase) {
+            database = _session->createAugmentedImageDatabase(baseDatabase->getFileData(), baseDatabase->getLength());
+        }
+        if (database == nullptr) {
+            database = _session->createAugmentedImageDatabase();
+        }
+
+        for (VROPreparedImageTarget &target : prepared) {
+            if (_imageDatabaseGeneration != generation) {
+                break;
+            }
+            int32_t outIndex;
+            database->addImageWithPhysicalSize(target.name.c_str(), target.grayscaleImage,
+                                               target.width, target.height, (int32_t) target.stride,
+                                               target.physicalWidth, &outIndex);
+        }
+
+        std::vector<uint8_t> serialized;
+        if (_imageDatabaseGeneration == generation && !prepared.empty() && database->serialize(&serialized)) {
+            VROARImageDatabase::storeCached(cacheDirectory, key,
+                                            std::make_shared<VROARImageDatabase>(std::move(serialized)));
+        }
+    }
+
+    // Free the rotated grayscale images now that we're done with them.
+    for (VROPreparedImageTarget &target : prepared) {
+        delete[] (target.grayscaleImage);
+    }
 
-    database->addImageWithPhysicalSize(targetAndroid->getId().c_str(), grayscaleImage,
-                                       width, height, (int32_t) stride,
-                                       target->getPhysicalWidth(), &outIndex);
+    if (_imageDatabaseGeneration != generation) {
+        delete (database);
+        return nullptr;
+    }
+    return database;
+}
 
-    // Free that grayscaleImage now that we're done with it.
-    free(grayscaleImage);
+/*
+ Rotate the given width x height grayscale image by 90 degrees into dest (which is height
+ pixels wide), clockwise or counterclockwise. The image is walked in square tiles so that
+ both the reads and the writes stay within a few cache lines.
+ */
+static void rotateImageTiled(const uint8_t *source, uint8_t *dest, int width, int height, bool clockwise) {
+    for (int i0 = 0; i0 < width; i0 += kRotationTileSize) {
+        int i1 = std::min(i0 + kRotationTileSize, width);
+        for (int j0 = 0; j0 < height; j0 += kRotationTileSize) {
+            int j1 = std::min(j0 + kRotationTileSize, height);
+
+            for (int i = i0; i < i1; i++) {
+                uint8_t *row = dest + i * height;
+                if (clockwise) {
+                    for (int j = j0; j < j1; j++) {
+                        row[j] = source[(height - 1 - j) * width + i];
+                    }
+                } else {
+                    for (int j = j0; j < j1; j++) {
+                        row[j] = source[width * (j + 1) - i - 1];
+                    }
+                }
+            }
+        }
+    }
 }
 
 void VROARSessionARCore::rotateImageForOrientation(uint8_t **grayscaleImage, int *width, int *height,
@@ -453,23 +544,13 @@ void VROARSessionARCore::rotateImageForOrientation(uint8_t **grayscaleImage, int
         // if the image is "upside down" then just reverse it...
         *stride = (size_t) *width;
         uint8_t *rotatedImage = new uint8_t[length];
-        int index;
-        for (int i = 0; i < *height; i++) {
-            for (int j = 0; j < *width; j++) {
-                index = j + i * *width;
-                rotatedImage[index] = (*grayscaleImage)[length - 1 - index];
-            }
-        }
+        std::reverse_copy(*grayscaleImage, *grayscaleImage + length, rotatedImage);
         *grayscaleImage = rotatedImage;
     } else if (orientation == VROImageOrientation::Left) {
         // if the image is to the "Left" then rotate it CW by 90 degrees
         uint8_t *rotatedImage = new uint8_t[length];
 
-        for (int i = 0; i < *width; i++) {
-            for (int j = 0; j < *height; j++) {
-                rotatedImage[j + i * *height] = (*grayscaleImage)[(*height - 1 - j) * *width + i];
-            }
-        }
+        rotateImageTiled(*grayscaleImage, rotatedImage, *width, *height, true);
 
         // since we rotated, swap the width and height.
         int tempWidth = *width;
@@ -486,11 +567,7 @@ void VROARSessionARCore::rotateImageForOrientation(uint8_t **grayscaleImage, int
         // if the image is to the "Right" then rotate it CCW by 90 degrees
         uint8_t *rotatedImage = new uint8_t[length];
 
-        for (int i = 0; i < *width; i++) {
-            for (int j = 0; j < *height; j++) {
-                rotatedImage[j + i * *height] = (*grayscaleImage)[(*width) * (j + 1) - i - 1];
-            }
-        }
+        rotateImageTiled(*grayscaleImage, rotatedImage, *width, *height, false);
 
         // since we rotated, swap the width and height.
         int tempWidth = *width;
@@ -511,15 +588,18 @@ void VROARSessionARCore::addAnchor(std::shared_ptr<VROARAnchor> anchor) {
     std::shared_ptr<VROARAnchorARCore> vAnchor = std::dynamic_pointer_cast<VROARAnchorARCore>(anchor);
     passert (vAnchor);
 
-    // Add the anchor under both its keys: the top-level anchor key and the trackable key.
-    // The former keeps anchors we've created and attached to trackables from being treated as
-    // "new" anchors in processUpdatedAnchors.
-    _nativeAnchorMap[VROStringUtil::toString64(vAnchor->getAnchorInternal()->getId())] = vAnchor;
-    _nativeAnchorMap[anchor->getId()] = vAnchor;
+    // Add the anchor under its ARCore anchor ID, which keeps anchors we've created and attached
+    // to trackables from being treated as "new" anchors in processUpdatedAnchors. Planes are also
+    // keyed by their handle (see addTrackableAnchor), and images by their name.
+    _nativeAnchorMap[vAnchor->getAnchorInternal()->getId()] = vAnchor;
+    _anchorIdMap[anchor->getId()] = vAnchor;
+    if (std::dynamic_pointer_cast<VROARImageAnchor>(vAnchor->getTrackable())) {
+        _imageAnchorMap[anchor->getId()] = vAnchor;
+    }
 
     if (kDebugTracking) {
-        pinfo("Added new new anchor [%p -- %p]",
-              VROStringUtil::toString64(vAnchor->getAnchorInternal()->getId()).c_str(),
+        pinfo("Added new new anchor [%llu -- %s]",
+              (unsigned long long) vAnchor->getAnchorInternal()->getId(),
               anchor->getId().c_str());
     }
 
@@ -547,6 +627,17 @@ void VROARSessionARCore::removeAnchor(std::shared_ptr<VROARAnchor> anchor) {
             ++it;
         }
     }
+    for (auto it = _imageAnchorMap.begin(); it != _imageAnchorMap.end();) {
+        if (it->second == anchor) {
+            it = _imageAnchorMap.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    auto idIt = _anchorIdMap.find(anchor->getId());
+    if (idIt != _anchorIdMap.end() && idIt->second == anchor) {
+        _anchorIdMap.erase(idIt);
+    }
     if (kDebugTracking) {
         pinfo("   Anchor count after %d, native anchor map size after %d",
               (int) _anchors.size(), (int) _nativeAnchorMap.size());
@@ -613,8 +704,8 @@ std::unique_ptr<VROARFrame> &VROARSessionARCore::getLastFrame() {
 #pragma mark - Internal Methods
 
 std::shared_ptr<VROARAnchor> VROARSessionARCore::getAnchorWithId(std::string anchorId) {
-    auto it = _nativeAnchorMap.find(anchorId);
-    if (it != _nativeAnchorMap.end()) {
+    auto it = _anchorIdMap.find(anchorId);
+    if (it != _anchorIdMap.end()) {
         return it->second;
     } else {
         return nullptr;
@@ -622,8 +713,7 @@ std::shared_ptr<VROARAnchor> VROARSessionARCore::getAnchorWithId(std::string anc
 }
 
 std::shared_ptr<VROARAnchor> VROARSessionARCore::getAnchorForNative(arcore::Anchor *anchor) {
-    std::string key = VROStringUtil::toString(anchor->getHashCode());
-    auto it = _nativeAnchorMap.find(key);
+    auto it = _nativeAnchorMap.find(anchor->getHashCode());
     if (it != _nativeAnchorMap.end()) {
         return it->second;
     } else {
@@ -663,20 +753,29 @@ std::shared_ptr<VROARAnchor> VROARSessionARCore::getAnchorForNative(arcore::Anch
  use a different key:
 
  1. For anchors without a trackable, we key by the anchor's ID.
- 2. For plane trackables, we key by the anchor's ID *and* by the trackable's pointer address.
+ 2. For plane trackables, we key by the anchor's ID *and* by the trackable's handle.
     Inserting keys for both the anchor and the trackable ensures that we don't treat the anchor
     we've created for the trackable as a brand new anchor during the next processUpdatedAnchors
     call.
- 3. For image trackables, key by the anchor's ID *and* the image's name. Note that keying by the
-    image's name has the effect of ensuring we only recognize *one* image of a type at a time.
+ 3. For image trackables, key by the anchor's ID, and by the image's name in the _imageAnchorMap.
+    Keying by the image's name has the effect of ensuring we only recognize *one* image of a type
+    at a time.
 
  Finally, all anchors found are also placed in the _anchors list. As with the _nativeAnchorMap, we
  only place top-level anchors here (not the trackable anchors).
+
+ Only the anchors are synced in the frame they are updated. Trackables are copied out of ARCore
+ here, converted on the shared job system while the frame renders, and applied to their Viro anchors
+ at the start of the next frame (see finishTrackableUpdates). Trackable updates therefore trail the
+ camera by one frame.
  */
 void VROARSessionARCore::processUpdatedAnchors(VROARFrameARCore *frameAR) {
-    std::shared_ptr<VROARSessionARCore> session = shared_from_this();
     arcore::Frame *frame = frameAR->getFrameInternal();
 
+    // Apply the trackables updated last frame first, so that the anchors we created for them
+    // are found in the _nativeAnchorMap below
+    finishTrackableUpdates();
+
     arcore::AnchorList *anchorList = _session->createAnchorList();
     frame->getUpdatedAnchors(anchorList);
     int anchorsSize = anchorList->size();
@@ -688,7 +787,7 @@ void VROARSessionARCore::processUpdatedAnchors(VROARFrameARCore *frameAR) {
     // processed afterward as the trackables themselves are updated.
     for (int i = 0; i < anchorsSize; i++) {
         std::shared_ptr<arcore::Anchor> anchor = std::shared_ptr<arcore::Anchor>(anchorList->acquireItem(i));
-        std::string key = VROStringUtil::toString64(anchor->getId());
+        uint64_t key = anchor->getId();
         auto it = _nativeAnchorMap.find(key);
 
         // Previously found anchor: update
@@ -714,97 +813,108 @@ void VROARSessionARCore::processUpdatedAnchors(VROARFrameARCore *frameAR) {
             // Note we ignore anchors that are NotTracking, as this is just ARCore telling us that
             // a managed anchor has been removed in the last frame.
             if (trackingState != arcore::TrackingState::NotTracking) {
-                pinfo("Detected new anchor with no association (may be cloud anchor) [%p]", key.c_str());
+                pinfo("Detected new anchor with no association (may be cloud anchor) [%llu]",
+                      (unsigned long long) key);
             }
         }
     }
+    delete (anchorList);
+
+    snapshotUpdatedTrackables(frame);
+    if (_trackableUpdates.empty()) {
+        return;
+    }
+
+    std::vector<VROARTrackableUpdate> *updates = &_trackableUpdates;
+    VROJobSystem::getShared()->run([updates] {
+        for (VROARTrackableUpdate &update : *updates) {
+            convertTrackableUpdate(update);
+        }
+    }, _trackableCounter);
+}
+
+void VROARSessionARCore::snapshotUpdatedTrackables(arcore::Frame *frame) {
+    passert (_trackableCounter.isComplete());
+    _trackableUpdates.clear();
+
+    arcore::Pose *pose = _session->createPose();
+    float poseMtx[16];
 
     arcore::TrackableList *planeList = _session->createTrackableList();
     frame->getUpdatedTrackables(planeList, arcore::TrackableType::Plane);
     int planeSize = planeList->size();
 
-    // Find all new and updated planes and process them. For new planes we will create a
-    // corresponding anchor. For updated planes we will update the planes and the anchor.
-    // Finally, we remove subsumed planes.
+    // Copy out all new, updated, and subsumed planes. For new planes we create the
+    // corresponding ARCore anchor now, while we have the plane; the Viro anchors are
+    // created when the update is applied.
     for (int i = 0; i < planeSize; i++) {
         arcore::Trackable *trackable = planeList->acquireItem(i);
-        arcore::Plane * plane = (arcore::Plane *) trackable;
-        arcore::Plane * subsumingPlane = plane->acquireSubsumedBy();
+        arcore::Plane *plane = (arcore::Plane *) trackable;
+        arcore::Plane *subsumingPlane = plane->acquireSubsumedBy();
 
-        arcore::TrackingState state = trackable->getTrackingState();
-        bool currentPlaneIsTracked = (state == arcore::TrackingState::Tracking);
+        VROARTrackableUpdate update;
+        update.type = arcore::TrackableType::Plane;
+        update.hasCenter = false;
+        update.subsumed = (subsumingPlane != NULL);
+        update.tracked = (trackable->getTrackingState() == arcore::TrackingState::Tracking);
 
         // ARCore doesn't use ID for planes, but rather they simply return the same object, so
         // the hashcodes (which in this case are pointer addresses) should be reliable
-        std::string key = getKeyForTrackable(plane);
-
-        // The plane was *NOT* subsumed by a new plane and is still tracking:
-        // either add or update it
-        if (subsumingPlane == NULL && currentPlaneIsTracked) {
-            auto it = _nativeAnchorMap.find(key);
-
-            // The plane is old: update it
-            if (it != _nativeAnchorMap.end()) {
-                std::shared_ptr<VROARAnchorARCore> vAnchor = it->second;
-
-                if (vAnchor) {
-                    std::shared_ptr<VROARPlaneAnchor> vPlane = std::dynamic_pointer_cast<VROARPlaneAnchor>(
-                            vAnchor->getTrackable());
-                    syncPlaneWithARCore(vPlane, plane);
-                    vAnchor->sync();
-                    updateAnchor(vAnchor);
-                } else {
-                    pwarn("Anchor processing error: expected to find a plane");
-                }
-
-            // The plane is new: add it
-            } else {
-                pinfo("Detected new anchor tied to plane");
+        update.handle = plane->getHashCode();
 
-                std::shared_ptr<VROARPlaneAnchor> vPlane = std::make_shared<VROARPlaneAnchor>();
-                syncPlaneWithARCore(vPlane, plane);
-
-                // Create a new anchor to correspond with the found plane
-                arcore::Pose *pose = _session->createPose();
-                plane->getCenterPose(pose);
-                std::shared_ptr<arcore::Anchor> anchor = std::shared_ptr<arcore::Anchor>(plane->acquireAnchor(pose));
+        auto it = _nativeAnchorMap.find(update.handle);
+        if (it != _nativeAnchorMap.end()) {
+            update.existingAnchor = it->second;
+        }
 
-                // If the anchor could not be created, just continue. We'll try again when this trackable
-                // is update next frame
-                if (anchor) {
-                    std::shared_ptr<VROARAnchorARCore> vAnchor = std::make_shared<VROARAnchorARCore>(key, anchor, vPlane, session);
-                    vAnchor->sync();
-                    addAnchor(vAnchor);
-                } else {
-                    pinfo("Failed to create anchor for trackable plane: will try again later");
-                }
-                delete (pose);
+        if (!update.subsumed && update.tracked) {
+            plane->getCenterPose(pose);
+            pose->toMatrix(poseMtx);
+            update.centerPose = VROMatrix4f(poseMtx);
+            update.planeType = plane->getPlaneType();
+            update.extentX = plane->getExtentX();
+            update.extentZ = plane->getExtentZ();
+
+            int polygonSize = plane->getPolygonSize();
+            if (polygonSize > 0) {
+                float *polygonArray = plane->getPolygon();
+                update.polygon.assign(polygonArray, polygonArray + polygonSize);
+                delete [] polygonArray;
             }
 
-        // The plane has been subsumed or is no longer tracked: remove it
-        } else {
-            auto it = _nativeAnchorMap.find(key);
-            if (it != _nativeAnchorMap.end()) {
-                if (subsumingPlane) {
-                    pinfo("Plane %s subsumed: removing", key.c_str());
-                } else {
-                    pinfo("Plane %s no longer tracked: removing", key.c_str());
+            if (update.existingAnchor) {
+                std::shared_ptr<VROARAnchor> vPlane = update.existingAnchor->getTrackable();
+                if (vPlane) {
+                    update.previousTransform = vPlane->getTransform();
                 }
+            } else {
+                pinfo("Detected new anchor tied to plane");
 
-                std::shared_ptr<VROARAnchorARCore> vAnchor = it->second;
-                if (vAnchor) {
-                    removeAnchor(vAnchor);
+                // If the anchor could not be created, just continue. We'll try again when this
+                // trackable is updated next frame
+                update.newAnchor = std::shared_ptr<arcore::Anchor>(plane->acquireAnchor(pose));
+                if (!update.newAnchor) {
+                    pinfo("Failed to create anchor for trackable plane: will try again later");
+                    delete (subsumingPlane);
+                    delete (trackable);
+                    continue;
                 }
+                update.key = getKeyForTrackable(plane);
             }
-            delete (subsumingPlane);
+            _trackableUpdates.push_back(std::move(update));
+
+        } else if (update.existingAnchor) {
+            _trackableUpdates.push_back(std::move(update));
         }
+
+        delete (subsumingPlane);
         delete (trackable);
     }
+    delete (planeList);
 
-    // Process updated/new images if the tracking implementation is ARCore. This process
+    // Copy out updated/new images if the tracking implementation is ARCore. This process
     // is virtually identical to how we handle planes above.
     if (getImageTrackingImpl() == VROImageTrackingImpl::ARCore) {
-
         arcore::TrackableList *imageList = _session->createTrackableList();
         frame->getUpdatedTrackables(imageList, arcore::TrackableType::Image);
         int imageSize = imageList->size();
@@ -813,97 +923,89 @@ void VROARSessionARCore::processUpdatedAnchors(VROARFrameARCore *frameAR) {
             arcore::Trackable *trackable = imageList->acquireItem(i);
             arcore::AugmentedImage *image = (arcore::AugmentedImage *) trackable;
 
+            VROARTrackableUpdate update;
+            update.type = arcore::TrackableType::Image;
+            update.hasCenter = false;
+            update.handle = 0;
+            update.subsumed = false;
+            update.tracked = (trackable->getTrackingState() == arcore::TrackingState::Tracking);
+
             // The name of the image is used for image anchors. This enforces the condition
             // that we only detect each image once
-            std::string key = getKeyForTrackable(image);
-
-            arcore::TrackingMethod arTrackingMethod = image->getTrackingMethod();
-            VROARImageTrackingMethod trackingMethod = VROARImageTrackingMethod::NotTracking;
-            if (arTrackingMethod == arcore::TrackingMethod::Tracking) {
-                trackingMethod = VROARImageTrackingMethod::Tracking;
-            } else if (arTrackingMethod == arcore::TrackingMethod::LastKnownPose) {
-                trackingMethod = VROARImageTrackingMethod::LastKnownPose;
+            update.key = getKeyForTrackable(image);
+
+            auto it = _imageAnchorMap.find(update.key);
+            if (it != _imageAnchorMap.end()) {
+                update.existingAnchor = it->second;
             }
 
-            bool imageIsTracked = (trackable->getTrackingState() == arcore::TrackingState::Tracking);
-            if (imageIsTracked) {
-                auto it = _nativeAnchorMap.find(key);
-
-                // Old image tracking target: update it
-                if (it != _nativeAnchorMap.end()) {
-                    std::shared_ptr<VROARAnchorARCore> vAnchor = it->second;
-                    std::shared_ptr<VROARImageAnchor> imageAnchor = std::dynamic_pointer_cast<VROARImageAnchor>(
-                            vAnchor->getTrackable());
-
-                    if (vAnchor) {
-                        imageAnchor->setTrackingMethod(trackingMethod);
-                        syncImageAnchorWithARCore(imageAnchor, image);
-                        vAnchor->sync();
-                        updateAnchor(vAnchor);
-                    } else {
-                        pwarn("Anchor processing error: expected to find an image anchor");
-                    }
+            if (update.tracked) {
+                arcore::TrackingMethod arTrackingMethod = image->getTrackingMethod();
+                update.trackingMethod = VROARImageTrackingMethod::NotTracking;
+                if (arTrackingMethod == arcore::TrackingMethod::Tracking) {
+                    update.trackingMethod = VROARImageTrackingMethod::Tracking;
+                } else if (arTrackingMethod == arcore::TrackingMethod::LastKnownPose) {
+                    update.trackingMethod = VROARImageTrackingMethod::LastKnownPose;
+                }
 
-                // New image tracking target: add it
-                } else {
-                    std::shared_ptr<VROARImageTargetAndroid> target;
-
-                    bool haveFoundTarget = false;
-                    // first, loop over all targets to see if the target matches the found ImageAnchor
-                    for (int j = 0; j < _imageTargets.size(); j++) {
-                        target = std::dynamic_pointer_cast<VROARImageTargetAndroid>(_imageTargets[j]);
-                        if (key == target->getId()) {
-                            pinfo("Detected new anchor tied to image target [%s]", key.c_str());
-                            haveFoundTarget = true;
-                            // break out of the loop since we found a target id that matches the key
-                            break;
-                        }
-                    }
-                    // No target found means that the AR system found an ImageAnchor w/o us knowing
-                    // the target, this probably means that it was loaded from an ARImageDatabase, so
-                    // lets create a new target
-                    if (!haveFoundTarget) {
-                        target = std::make_shared<VROARImageTargetAndroid>(key);
-                    }
+                image->getCenterPose(pose);
+                pose->toMatrix(poseMtx);
+                update.centerPose = VROMatrix4f(poseMtx);
 
-                    std::shared_ptr<VROARImageAnchor> vImage = std::make_shared<VROARImageAnchor>(
-                            target, trackingMethod);
-                    syncImageAnchorWithARCore(vImage, image);
-
-                    // Create a new anchor to correspond with the found image
-                    arcore::Pose *pose = _session->createPose();
-                    image->getCenterPose(pose);
-
-                    std::shared_ptr<arcore::Anchor> anchor = std::shared_ptr<arcore::Anchor>(
-                            image->acquireAnchor(pose));
-                    if (anchor) {
-                        std::shared_ptr<VROARAnchorARCore> vAnchor = std::make_shared<VROARAnchorARCore>(
-                                key, anchor, vImage, session);
-                        vAnchor->sync();
-                        addAnchor(vAnchor);
-                    } else {
+                if (!update.existingAnchor) {
+                    update.newAnchor = std::shared_ptr<arcore::Anchor>(image->acquireAnchor(pose));
+                    if (!update.newAnchor) {
                         pinfo("Failed to create anchor for trackable image target: will try again later");
+                        delete (trackable);
+                        continue;
                     }
-                    delete (pose);
                 }
-            // The image is no longer being tracked: remove it
-            } else {
-                auto it = _nativeAnchorMap.find(key);
-                if (it != _nativeAnchorMap.end()) {
-                    pinfo("Image target [%s] has lost tracking, removing", key.c_str());
+                _trackableUpdates.push_back(std::move(update));
 
-                    std::shared_ptr<VROARAnchorARCore> vAnchor = it->second;
-                    if (vAnchor) {
-                        removeAnchor(vAnchor);
-                    }
-                }
+            } else if (update.existingAnchor) {
+                _trackableUpdates.push_back(std::move(update));
             }
+            delete (trackable);
         }
         delete (imageList);
     }
 
-    delete (anchorList);
-    delete (planeList);
+    delete (pose);
+}
+
+void VROARSessionARCore::finishTrackableUpdates() {
+    if (_trackableUpdates.empty()) {
+        return;
+    }
+    VROJobSystem::getShared()->wait(_trackableCounter);
+
+    // Applying may add or remove anchors, which in turn invokes the delegate; move the
+    // batch out first so that it can't be modified as we iterate
+    std::vector<VROARTrackableUpdate> updates;
+    updates.swap(_trackableUpdates);
+
+    for (VROARTrackableUpdate &update : updates) {
+        // The anchor may have been detached by the application since the update was copied
+        if (update.existingAnchor) {
+            auto it = _nativeAnchorMap.find(update.existingAnchor->getAnchorInternal()->getId());
+            if (it == _nativeAnchorMap.end() || it->second != update.existingAnchor) {
+                continue;
+            }
+        }
+
+        if (update.type == arcore::TrackableType::Plane) {
+            applyPlaneUpdate(update);
+        } else {
+            applyImageUpdate(update);
+        }
+    }
+}
+
+void VROARSessionARCore::addTrackableAnchor(std::shared_ptr<VROARAnchorARCore> anchor, uint64_t handle) {
+    if (handle != 0) {
+        _nativeAnchorMap[handle] = anchor;
+    }
+    addAnchor(anchor);
 }
 
 std::string VROARSessionARCore::getKeyForTrackable(arcore::Trackable *trackable) {
@@ -923,95 +1025,157 @@ std::string VROARSessionARCore::getKeyForTrackable(arcore::Trackable *trackable)
 }
 
 std::shared_ptr<VROARAnchorARCore> VROARSessionARCore::getAnchorForTrackable(arcore::Trackable *trackable) {
-    std::string key = getKeyForTrackable(trackable);
-    if (key.empty()) {
-        return nullptr;
+    arcore::TrackableType type = trackable->getType();
+    if (type == arcore::TrackableType::Plane) {
+        auto it = _nativeAnchorMap.find(((arcore::Plane *) trackable)->getHashCode());
+        return it != _nativeAnchorMap.end() ? it->second : nullptr;
     }
-    auto it = _nativeAnchorMap.find(key);
-    if (it == _nativeAnchorMap.end()) {
-        return nullptr;
+    else if (type == arcore::TrackableType::Image) {
+        auto it = _imageAnchorMap.find(getKeyForTrackable(trackable));
+        return it != _imageAnchorMap.end() ? it->second : nullptr;
     }
-    return it->second;
+    return nullptr;
 }
 
-void VROARSessionARCore::syncPlaneWithARCore(std::shared_ptr<VROARPlaneAnchor> plane,
-                                             arcore::Plane *planeAR) {
-    arcore::Pose *pose = _session->createPose();
-    planeAR->getCenterPose(pose);
+void VROARSessionARCore::convertTrackableUpdate(VROARTrackableUpdate &update) {
+    if (update.type != arcore::TrackableType::Plane || !update.tracked || update.subsumed) {
+        return;
+    }
 
-    float newTransformMtx[16];
-    pose->toMatrix(newTransformMtx);
-    VROMatrix4f newTransform(newTransformMtx);
+    VROMatrix4f newTransform = update.centerPose;
     VROVector3f newTranslation = newTransform.extractTranslation();
-
-    VROMatrix4f oldTransform = plane->getTransform();
-    VROVector3f oldTranslation = oldTransform.extractTranslation();
+    VROVector3f oldTranslation = update.previousTransform.extractTranslation();
 
     // Update our plane's transform if it has been previously set.
     if (!oldTranslation.isEqual(VROVector3f())) {
         // Calculate our new center.
         VROVector3f offsetRelativeToPlane = newTranslation - oldTranslation;
-        VROVector3f localCenter = VROVector3f(offsetRelativeToPlane.x, 0.0f, offsetRelativeToPlane.z);
-        plane->setCenter(localCenter);
+        update.center = VROVector3f(offsetRelativeToPlane.x, 0.0f, offsetRelativeToPlane.z);
+        update.hasCenter = true;
 
         // Calculate the plane's new transform.
-        newTransform.translate(localCenter.scale(-1.0));
+        newTransform.translate(update.center.scale(-1.0));
+    }
+    update.transform = newTransform;
+
+    // Parse out the boundary vertices from the polygon, which ARCore provides as (x, z) pairs
+    update.boundaryVertices.reserve(update.polygon.size() / 2);
+    for (size_t i = 0; i + 1 < update.polygon.size(); i = i + 2) {
+        update.boundaryVertices.push_back({ update.polygon[i], 0, update.polygon[i + 1] });
+    }
+}
+
+void VROARSessionARCore::applyPlaneUpdate(VROARTrackableUpdate &update) {
+    // The plane has been subsumed or is no longer tracked: remove it
+    if (update.subsumed || !update.tracked) {
+        if (update.subsumed) {
+            pinfo("Plane %s subsumed: removing", update.existingAnchor->getId().c_str());
+        } else {
+            pinfo("Plane %s no longer tracked: removing", update.existingAnchor->getId().c_str());
+        }
+        removeAnchor(update.existingAnchor);
+        return;
     }
 
-    plane->setTransform(newTransform);
+    std::shared_ptr<VROARPlaneAnchor> vPlane;
+    if (update.existingAnchor) {
+        vPlane = std::dynamic_pointer_cast<VROARPlaneAnchor>(update.existingAnchor->getTrackable());
+        if (!vPlane) {
+            pwarn("Anchor processing error: expected to find a plane");
+            return;
+        }
+    } else {
+        vPlane = std::make_shared<VROARPlaneAnchor>();
+    }
+
+    if (update.hasCenter) {
+        vPlane->setCenter(update.center);
+    }
+    vPlane->setTransform(update.transform);
 
-    switch (planeAR->getPlaneType()) {
+    switch (update.planeType) {
         case arcore::PlaneType::HorizontalUpward :
-            plane->setAlignment(VROARPlaneAlignment::HorizontalUpward);
+            vPlane->setAlignment(VROARPlaneAlignment::HorizontalUpward);
             break;
         case arcore::PlaneType::HorizontalDownward :
-            plane->setAlignment(VROARPlaneAlignment::HorizontalDownward);
+            vPlane->setAlignment(VROARPlaneAlignment::HorizontalDownward);
             break;
         case arcore::PlaneType ::Vertical :
-            plane->setAlignment(VROARPlaneAlignment::Vertical);
+            vPlane->setAlignment(VROARPlaneAlignment::Vertical);
             break;
         default:
-            plane->setAlignment(VROARPlaneAlignment::Horizontal);
+            vPlane->setAlignment(VROARPlaneAlignment::Horizontal);
     }
+    vPlane->setExtent(VROVector3f(update.extentX, 0, update.extentZ));
+    vPlane->setBoundaryVertices(std::move(update.boundaryVertices));
 
-    float extentX = planeAR->getExtentX();
-    float extentZ = planeAR->getExtentZ();
-    plane->setExtent(VROVector3f(extentX, 0, extentZ));
+    // The plane is old: update its anchor
+    if (update.existingAnchor) {
+        update.existingAnchor->sync();
+        updateAnchor(update.existingAnchor);
 
-    delete (pose);
-
-    // Grab the polygon points from ARCore,
-    std::vector<VROVector3f> boundaryVertices;
-    float* polygonArray = planeAR->getPolygon();
-    int polygonArraySize = planeAR->getPolygonSize();
-
-    if (polygonArraySize > 0) {
-        // Parse out polygons from the shape.
-        for (int i = 0; i < polygonArraySize; i = i + 2) {
-            VROVector3f newPoint;
-            newPoint.x = polygonArray[i];
-            newPoint.y = 0;
-            newPoint.z = polygonArray[i+1];
-            boundaryVertices.push_back(newPoint);
-        }
+    // The plane is new: create a Viro anchor for the ARCore anchor we attached to it
+    } else {
+        std::shared_ptr<VROARAnchorARCore> vAnchor = std::make_shared<VROARAnchorARCore>(update.key, update.newAnchor,
+                                                                                         vPlane, shared_from_this());
+        vAnchor->sync();
+        addTrackableAnchor(vAnchor, update.handle);
+    }
+}
 
-        delete [] polygonArray;
+void VROARSessionARCore::applyImageUpdate(VROARTrackableUpdate &update) {
+    // The image is no longer being tracked: remove it
+    if (!update.tracked) {
+        pinfo("Image target [%s] has lost tracking, removing", update.key.c_str());
+        removeAnchor(update.existingAnchor);
+        return;
     }
 
-    plane->setBoundaryVertices(boundaryVertices);
-}
+    // Old image tracking target: update it
+    if (update.existingAnchor) {
+        std::shared_ptr<VROARImageAnchor> imageAnchor = std::dynamic_pointer_cast<VROARImageAnchor>(
+                update.existingAnchor->getTrackable());
+        if (!imageAnchor) {
+            pwarn("Anchor processing error: expected to find an image anchor");
+            return;
+        }
 
-void VROARSessionARCore::syncImageAnchorWithARCore(std::shared_ptr<VROARImageAnchor> imageAnchor,
-                                                   arcore::AugmentedImage *imageAR) {
-    arcore::Pose *pose = _session->createPose();
-    imageAR->getCenterPose(pose);
+        imageAnchor->setTrackingMethod(update.trackingMethod);
+        imageAnchor->setTransform(update.centerPose);
+        update.existingAnchor->sync();
+        updateAnchor(update.existingAnchor);
+
+    // New image tracking target: add it
+    } else {
+        std::shared_ptr<VROARImageTargetAndroid> target;
+
+        bool haveFoundTarget = false;
+        // first, loop over all targets to see if the target matches the found ImageAnchor
+        for (int j = 0; j < _imageTargets.size(); j++) {
+            target = std::dynamic_pointer_cast<VROARImageTargetAndroid>(_imageTargets[j]);
+            if (update.key == target->getId()) {
+                pinfo("Detected new anchor tied to image target [%s]", update.key.c_str());
+                haveFoundTarget = true;
+                // break out of the loop since we found a target id that matches the key
+                break;
+            }
+        }
+        // No target found means that the AR system found an ImageAnchor w/o us knowing
+        // the target, this probably means that it was loaded from an ARImageDatabase, so
+        // lets create a new target
+        if (!haveFoundTarget) {
+            target = std::make_shared<VROARImageTargetAndroid>(update.key);
+        }
 
-    float newTransformMtx[16];
-    pose->toMatrix(newTransformMtx);
-    VROMatrix4f newTransform(newTransformMtx);
-    imageAnchor->setTransform(newTransform);
+        std::shared_ptr<VROARImageAnchor> vImage = std::make_shared<VROARImageAnchor>(
+                target, update.trackingMethod);
+        vImage->setTransform(update.centerPose);
 
-    delete (pose);
+        std::shared_ptr<VROARAnchorARCore> vAnchor = std::make_shared<VROARAnchorARCore>(
+                update.key, update.newAnchor, vImage, shared_from_this());
+        vAnchor->sync();
+        addAnchor(vAnchor);
+    }
 }
 
 uint8_t *VROARSessionARCore::getRotatedCameraImageData(int size) {
@@ -32,12 +32,16 @@
 #include "VROViewport.h"
 #include "VROOpenGL.h"
 #include "ARCore_API.h"
+#include <atomic>
 #include <map>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 #include <VROCameraTexture.h>
 #include <VROARPlaneAnchor.h>
 #include <VROARImageAnchor.h>
 #include <VROARImageDatabase.h>
+#include <VROJobSystem.h>
 
 enum class VROARDisplayRotation {
     R0,
@@ -135,6 +139,9 @@ public:
     arcore::Session *getSessionInternal() {
         return _session;
     }
+    arcore::LightingMode getLightingMode() const {
+        return _lightingMode;
+    }
 
 #pragma mark - [Internal] Camera Background
 
@@ -208,11 +215,43 @@ private:
     std::vector<std::shared_ptr<VROARImageTarget>> _imageTargets;
 
     /*
-     This is a helper function that synchronously adds the target to the database. This function
-     should not be called on the rendering thread (as per ARCore guidance).
+     The database most recently loaded through loadARImageDatabase, if any. Targets added
+     through addARImageTarget are added on top of it.
+     */
+    std::shared_ptr<VROARImageDatabase> _loadedImageDatabase;
+
+    /*
+     Incremented each time the image targets or the loaded database change. Builds started
+     for an earlier generation are abandoned, so that a burst of changes (e.g. adding every
+     target of a scene) only extracts features once.
+     */
+    std::atomic<int> _imageDatabaseGeneration;
+
+    /*
+     Serializes database builds, which share the grayscale images of the targets.
+     */
+    std::mutex _imageDatabaseMutex;
+
+    /*
+     Directory in which built databases are cached, resolved on the rendering thread.
+     */
+    std::string _imageDatabaseCacheDirectory;
+
+    /*
+     Rebuild the ARCore image database from _loadedImageDatabase and _imageTargets on a
+     worker thread, and install it on the rendering thread once built. Databases built
+     from the same targets before are loaded from the on-disk cache in one call.
+     */
+    void rebuildImageDatabase();
+
+    /*
+     Synchronously build the ARCore image database for the given generation. Returns nullptr
+     if the build was abandoned because a newer generation started. This function should not
+     be called on the rendering thread (as per ARCore guidance).
      */
-    void addTargetToDatabase(std::shared_ptr<VROARImageTarget> target,
-                             arcore::AugmentedImageDatabase *database);
+    arcore::AugmentedImageDatabase *buildImageDatabase(std::vector<std::shared_ptr<VROARImageTarget>> targets,
+                                                       std::shared_ptr<VROARImageDatabase> baseDatabase,
+                                                       std::string cacheDirectory, int generation);
 
     /*
      This function rotates the given grayscaleImage so that the image is "Up" based on the given
@@ -232,27 +271,81 @@ private:
     /*
      Map of ARCore anchors ("native" anchors) to their Viro representation.
      Required so we can update VROARAnchors when their ARCore counterparts are
-     updated.
+     updated. Keyed by the ARCore anchor ID, and for planes also by the plane's
+     handle, so per-frame lookups don't have to format string keys.
+     */
+    std::unordered_map<uint64_t, std::shared_ptr<VROARAnchorARCore>> _nativeAnchorMap;
+
+    /*
+     Image anchors are keyed by image name, so that we only recognize one image
+     of each name at a time.
+     */
+    std::unordered_map<std::string, std::shared_ptr<VROARAnchorARCore>> _imageAnchorMap;
+
+    /*
+     Map of the string IDs of our anchors to the anchors, for lookups from the
+     application (getAnchorWithId). Only changes when anchors are added or removed.
      */
-    std::map<std::string, std::shared_ptr<VROARAnchorARCore>> _nativeAnchorMap;
+    std::map<std::string, std::shared_ptr<VROARAnchorARCore>> _anchorIdMap;
 
     /*
      Hosts and resolves cloud anchors.
      */
     std::shared_ptr<VROCloudAnchorProviderARCore> _cloudAnchorProvider;
 
+    /*
+     Data copied out of an updated ARCore trackable on the rendering thread. The
+     polygon is converted into boundary vertices on the trackable worker, and the
+     result is applied to the Viro anchors at the start of the next frame.
+     */
+    struct VROARTrackableUpdate {
+        arcore::TrackableType type;
+        uint64_t handle;
+        std::string key;
+        bool tracked;
+        bool subsumed;
+        std::shared_ptr<VROARAnchorARCore> existingAnchor;
+        std::shared_ptr<arcore::Anchor> newAnchor;
+        VROMatrix4f centerPose;
+        VROMatrix4f previousTransform;
+        arcore::PlaneType planeType;
+        float extentX;
+        float extentZ;
+        std::vector<float> polygon;
+        VROARImageTrackingMethod trackingMethod;
+
+        // Computed on the worker
+        VROMatrix4f transform;
+        VROVector3f center;
+        bool hasCenter;
+        std::vector<VROVector3f> boundaryVertices;
+    };
+
+    /*
+     Tracks trackable conversion, which runs off the rendering thread as a single
+     job on the shared job system. Each frame's batch is submitted after
+     ArSession_update, and joined (normally already complete) at the start of
+     the next frame.
+     */
+    VROJobCounter _trackableCounter;
+    std::vector<VROARTrackableUpdate> _trackableUpdates;
+
     /*
      Per-frame anchor and trackable update handling.
      */
     void processUpdatedAnchors(VROARFrameARCore *frame);
+    void snapshotUpdatedTrackables(arcore::Frame *frame);
+    void finishTrackableUpdates();
+    void addTrackableAnchor(std::shared_ptr<VROARAnchorARCore> anchor, uint64_t handle);
 
     /*
-     These methods sync Viro anchors (representing ARCore *trackables*) with their corresponding
-     ARCore objects. The ARCore objects contain all the updated information.
+     These methods sync Viro anchors (representing ARCore *trackables*) with the data copied
+     from their corresponding ARCore objects. The conversion runs on the trackable worker,
+     and the apply methods run on the rendering thread.
      */
-    void syncPlaneWithARCore(std::shared_ptr<VROARPlaneAnchor> plane, arcore::Plane *planeAR);
-    void syncImageAnchorWithARCore(std::shared_ptr<VROARImageAnchor> imageAnchor,
-                                   arcore::AugmentedImage *imageAR);
+    static void convertTrackableUpdate(VROARTrackableUpdate &update);
+    void applyPlaneUpdate(VROARTrackableUpdate &update);
+    void applyImageUpdate(VROARTrackableUpdate &update);
 
 #pragma mark - [Private] Camera Background
 
@@ -27,9 +27,22 @@
 #include "VROCloudAnchorProviderARCore.h"
 #include "VROARSessionARCore.h"
 #include "VROARAnchorARCore.h"
+#include "VRORenderContext.h"
+#include "VROCamera.h"
+#include "VROTime.h"
+#include "VROLog.h"
+#include <algorithm>
 
 VROCloudAnchorProviderARCore::VROCloudAnchorProviderARCore(std::shared_ptr<VROARSessionARCore> session) :
-    _session(session) {
+    _session(session),
+    _lastPollTimeMs(0),
+    _numHosted(0),
+    _numResolved(0),
+    _numFailed(0),
+    _totalQueueTimeMs(0),
+    _totalHostTimeMs(0),
+    _totalResolveTimeMs(0),
+    _maxResolveTimeMs(0) {
 
 }
 
@@ -40,33 +53,45 @@ VROCloudAnchorProviderARCore::~VROCloudAnchorProviderARCore() {
 void VROCloudAnchorProviderARCore::hostCloudAnchor(std::shared_ptr<VROARAnchor> anchor,
                                                    std::function<void(std::shared_ptr<VROARAnchor>)> onSuccess,
                                                    std::function<void(std::string error)> onFailure) {
+    VROCloudAnchorHostTask task;
+    task.originalAnchor = anchor;
+    task.onSuccess = onSuccess;
+    task.onFailure = onFailure;
+    task.queuedTimeMs = VROTimeCurrentMillis();
+    task.issuedTimeMs = 0;
+
+    _pendingHosting.push_back(task);
+}
+
+bool VROCloudAnchorProviderARCore::issueHostTask(VROCloudAnchorHostTask &task, double nowMs) {
     std::shared_ptr<VROARSessionARCore> session = _session.lock();
     if (!session) {
-        return;
+        return true;
     }
     arcore::Session *session_arc = session->getSessionInternal();
 
-    std::shared_ptr<VROARAnchorARCore> anchor_v = std::dynamic_pointer_cast<VROARAnchorARCore>(anchor);
+    std::shared_ptr<VROARAnchorARCore> anchor_v = std::dynamic_pointer_cast<VROARAnchorARCore>(task.originalAnchor);
 
     arcore::AnchorAcquireStatus status;
     std::shared_ptr<arcore::Anchor> anchor_arc = std::shared_ptr<arcore::Anchor>(
             session_arc->hostAndAcquireNewCloudAnchor(anchor_v->getAnchorInternal().get(), &status));
     if (!anchor_arc) {
+        if (status == arcore::AnchorAcquireStatus::ErrorResourceExhausted) {
+            return false;
+        }
+
         // ARCore can immediately fail to host a cloud anchor for a number of reasons
-        onFailure("Failed to host cloud anchor [error: " + getAnchorStatusErrorMessage(status) + "]");
-        return;
+        recordTask(task.queuedTimeMs, nowMs, nowMs, true, false);
+        task.onFailure("Failed to host cloud anchor [error: " + getAnchorStatusErrorMessage(status) + "]");
+        return true;
     }
 
     std::string key = VROStringUtil::toString64(anchor_arc->getId());
-    std::shared_ptr<VROARAnchorARCore> cloudAnchor = std::make_shared<VROARAnchorARCore>(key, anchor_arc, nullptr, session);
-
-    VROCloudAnchorHostTask task;
-    task.originalAnchor = anchor;
-    task.cloudAnchor = cloudAnchor;
-    task.onSuccess = onSuccess;
-    task.onFailure = onFailure;
+    task.cloudAnchor = std::make_shared<VROARAnchorARCore>(key, anchor_arc, nullptr, session);
+    task.issuedTimeMs = nowMs;
 
     _queuedHosting.push_back(task);
+    return true;
 }
 
 void VROCloudAnchorProviderARCore::onHostTaskSuccessful(VROCloudAnchorHostTask &task) {
@@ -94,31 +119,43 @@ void VROCloudAnchorProviderARCore::onHostTaskFailed(VROCloudAnchorHostTask &task
 void VROCloudAnchorProviderARCore::resolveCloudAnchor(std::string cloudAnchorId,
                                                       std::function<void(std::shared_ptr<VROARAnchor> anchor)> onSuccess,
                                                       std::function<void(std::string error)> onFailure) {
+    VROCloudAnchorResolveTask task;
+    task.cloudAnchorId = cloudAnchorId;
+    task.onSuccess = onSuccess;
+    task.onFailure = onFailure;
+    task.queuedTimeMs = VROTimeCurrentMillis();
+    task.issuedTimeMs = 0;
+
+    _pendingResolving.push_back(task);
+}
+
+bool VROCloudAnchorProviderARCore::issueResolveTask(VROCloudAnchorResolveTask &task, double nowMs) {
     std::shared_ptr<VROARSessionARCore> session = _session.lock();
     if (!session) {
-        return;
+        return true;
     }
     arcore::Session *session_arc = session->getSessionInternal();
 
     arcore::AnchorAcquireStatus status;
     std::shared_ptr<arcore::Anchor> anchor_arc = std::shared_ptr<arcore::Anchor>(
-            session_arc->resolveAndAcquireNewCloudAnchor(cloudAnchorId.c_str(), &status));
+            session_arc->resolveAndAcquireNewCloudAnchor(task.cloudAnchorId.c_str(), &status));
     if (!anchor_arc) {
+        if (status == arcore::AnchorAcquireStatus::ErrorResourceExhausted) {
+            return false;
+        }
+
         // ARCore can immediately fail to resolve a cloud anchor for a number of reasons
-        onFailure("Failed to resolve cloud anchor [error: " + getAnchorStatusErrorMessage(status) + "]");
-        return;
+        recordTask(task.queuedTimeMs, nowMs, nowMs, false, false);
+        task.onFailure("Failed to resolve cloud anchor [error: " + getAnchorStatusErrorMessage(status) + "]");
+        return true;
     }
 
     std::string key = VROStringUtil::toString64(anchor_arc->getId());
-    std::shared_ptr<VROARAnchorARCore> cloudAnchor = std::make_shared<VROARAnchorARCore>(key, anchor_arc, nullptr, session);
-
-    VROCloudAnchorResolveTask task;
-    task.cloudAnchorId = cloudAnchorId;
-    task.cloudAnchor = cloudAnchor;
-    task.onSuccess = onSuccess;
-    task.onFailure = onFailure;
+    task.cloudAnchor = std::make_shared<VROARAnchorARCore>(key, anchor_arc, nullptr, session);
+    task.issuedTimeMs = nowMs;
 
     _queuedResolving.push_back(task);
+    return true;
 }
 
 void VROCloudAnchorProviderARCore::onResolveTaskSuccessful(VROCloudAnchorResolveTask &task) {
@@ -138,7 +175,122 @@ void VROCloudAnchorProviderARCore::onResolveTaskFailed(VROCloudAnchorResolveTask
     task.onFailure(error);
 }
 
+/*
+ Distance from the camera to the given position, weighted so that positions behind
+ the camera count as up to three times as far as those straight ahead.
+ */
+static float getViewDistance(const VROCamera &camera, VROVector3f position) {
+    VROVector3f toPosition = position - camera.getPosition();
+    float distance = toPosition.magnitude();
+    if (distance < kEpsilon) {
+        return 0;
+    }
+    float cosAngle = toPosition.dot(camera.getForward()) / distance;
+    return distance * (2 - cosAngle);
+}
+
 void VROCloudAnchorProviderARCore::onFrameWillRender(const VRORenderContext &context) {
+    if (_pendingHosting.empty() && _pendingResolving.empty() &&
+        _queuedHosting.empty() && _queuedResolving.empty()) {
+        return;
+    }
+
+    // ARCore is only queried on the rendering thread (as with trackables, see
+    // VROARSessionARCore), but all tasks are polled together at a fixed interval
+    double nowMs = VROTimeCurrentMillis();
+    if (nowMs - _lastPollTimeMs < kCloudAnchorPollIntervalMs) {
+        return;
+    }
+    _lastPollTimeMs = nowMs;
+
+    pollTasks(nowMs);
+    issueTasks(context.getCamera(), nowMs);
+
+    if (_pendingHosting.empty() && _pendingResolving.empty() &&
+        _queuedHosting.empty() && _queuedResolving.empty()) {
+        VROCloudAnchorMetrics metrics = getMetrics();
+        pinfo("Cloud anchor tasks complete [hosted %d, resolved %d, failed %d, avg queue %.0f ms, avg host %.0f ms, avg resolve %.0f ms, max resolve %.0f ms]",
+              metrics.numHosted, metrics.numResolved, metrics.numFailed, metrics.averageQueueTimeMs,
+              metrics.averageHostTimeMs, metrics.averageResolveTimeMs, metrics.maxResolveTimeMs);
+    }
+}
+
+void VROCloudAnchorProviderARCore::issueTasks(const VROCamera &camera, double nowMs) {
+    int numAvailable = kMaxConcurrentCloudAnchorTasks - (int) (_queuedHosting.size() + _queuedResolving.size());
+    if (numAvailable <= 0) {
+        return;
+    }
+
+    // Host the anchors nearest the user's view first; the order is kept for equal distances
+    if (_pendingHosting.size() > 1) {
+        std::vector<std::pair<float, VROCloudAnchorHostTask>> sorted;
+        for (VROCloudAnchorHostTask &task : _pendingHosting) {
+            float distance = getViewDistance(camera, task.originalAnchor->getTransform().extractTranslation());
+            sorted.push_back({ distance, task });
+        }
+        std::stable_sort(sorted.begin(), sorted.end(),
+                         [](const std::pair<float, VROCloudAnchorHostTask> &a,
+                            const std::pair<float, VROCloudAnchorHostTask> &b) {
+                             return a.first < b.first;
+                         });
+        _pendingHosting.clear();
+        for (std::pair<float, VROCloudAnchorHostTask> &entry : sorted) {
+            _pendingHosting.push_back(entry.second);
+        }
+    }
+
+    // Stop issuing for this poll once the service is out of resources
+    while (numAvailable > 0 && !_pendingHosting.empty()) {
+        VROCloudAnchorHostTask task = _pendingHosting.front();
+        _pendingHosting.pop_front();
+        if (!issueHostTask(task, nowMs)) {
+            _pendingHosting.push_front(task);
+            return;
+        }
+        numAvailable--;
+    }
+    while (numAvailable > 0 && !_pendingResolving.empty()) {
+        VROCloudAnchorResolveTask task = _pendingResolving.front();
+        _pendingResolving.pop_front();
+        if (!issueResolveTask(task, nowMs)) {
+            _pendingResolving.push_front(task);
+            return;
+        }
+        numAvailable--;
+    }
+}
+
+void VROCloudAnchorProviderARCore::recordTask(double queuedTimeMs, double issuedTimeMs, double nowMs,
+                                              bool host, bool success) {
+    _totalQueueTimeMs += issuedTimeMs - queuedTimeMs;
+    if (!success) {
+        _numFailed++;
+    }
+    else if (host) {
+        _numHosted++;
+        _totalHostTimeMs += nowMs - issuedTimeMs;
+    }
+    else {
+        _numResolved++;
+        _totalResolveTimeMs += nowMs - issuedTimeMs;
+        _maxResolveTimeMs = std::max(_maxResolveTimeMs, nowMs - issuedTimeMs);
+    }
+}
+
+VROCloudAnchorMetrics VROCloudAnchorProviderARCore::getMetrics() const {
+    VROCloudAnchorMetrics metrics;
+    int numTasks = _numHosted + _numResolved + _numFailed;
+    metrics.numHosted = _numHosted;
+    metrics.numResolved = _numResolved;
+    metrics.numFailed = _numFailed;
+    metrics.averageQueueTimeMs = numTasks > 0 ? _totalQueueTimeMs / numTasks : 0;
+    metrics.averageHostTimeMs = _numHosted > 0 ? _totalHostTimeMs / _numHosted : 0;
+    metrics.averageResolveTimeMs = _numResolved > 0 ? _totalResolveTimeMs / _numResolved : 0;
+    metrics.maxResolveTimeMs = _maxResolveTimeMs;
+    return metrics;
+}
+
+void VROCloudAnchorProviderARCore::pollTasks(double nowMs) {
     for (auto it = _queuedHosting.begin(); it != _queuedHosting.end(); ) {
         VROCloudAnchorHostTask &hostTask = *it;
         std::shared_ptr<arcore::Anchor> anchor_arc = hostTask.cloudAnchor->getAnchorInternal();
@@ -151,6 +303,7 @@ void VROCloudAnchorProviderARCore::onFrameWillRender(const VRORenderContext &con
                 break;
 
             case arcore::CloudAnchorState::Success:
+                recordTask(hostTask.queuedTimeMs, hostTask.issuedTimeMs, nowMs, true, true);
                 onHostTaskSuccessful(hostTask);
                 removeFromTaskList = true;
                 break;
@@ -165,6 +318,7 @@ void VROCloudAnchorProviderARCore::onFrameWillRender(const VRORenderContext &con
             case arcore::CloudAnchorState::ErrorResolvingLocalizationNoMatch:
             case arcore::CloudAnchorState::ErrorResolvingSDKVersionTooOld:
             case arcore::CloudAnchorState::ErrorResolvingSDKVersionTooNew:
+                recordTask(hostTask.queuedTimeMs, hostTask.issuedTimeMs, nowMs, true, false);
                 onHostTaskFailed(hostTask, getError(state));
                 removeFromTaskList = true;
                 break;
@@ -187,6 +341,7 @@ void VROCloudAnchorProviderARCore::onFrameWillRender(const VRORenderContext &con
                 break;
 
             case arcore::CloudAnchorState::Success:
+                recordTask(resolveTask.queuedTimeMs, resolveTask.issuedTimeMs, nowMs, false, true);
                 onResolveTaskSuccessful(resolveTask);
                 removeFromTaskList = true;
                 break;
@@ -201,6 +356,7 @@ void VROCloudAnchorProviderARCore::onFrameWillRender(const VRORenderContext &con
             case arcore::CloudAnchorState::ErrorResolvingLocalizationNoMatch:
             case arcore::CloudAnchorState::ErrorResolvingSDKVersionTooOld:
             case arcore::CloudAnchorState::ErrorResolvingSDKVersionTooNew:
+                recordTask(resolveTask.queuedTimeMs, resolveTask.issuedTimeMs, nowMs, false, false);
                 onResolveTaskFailed(resolveTask, getError(state));
                 removeFromTaskList = true;
                 break;
@@ -27,6 +27,7 @@
 #define ANDROID_VROCLOUDANCHORPROVIDERARCORE_H
 
 #include <vector>
+#include <deque>
 #include <string>
 #include <memory>
 #include "VROFrameListener.h"
@@ -35,13 +36,33 @@
 class VROARAnchor;
 class VROARAnchorARCore;
 class VROARSessionARCore;
+class VROCamera;
 
+/*
+ Maximum number of cloud anchor tasks (hosts and resolves) in flight at once. Further
+ requests wait in a queue. If the service runs out of resources first, requests are
+ returned to the queue and retried at the next poll.
+ */
+static const int kMaxConcurrentCloudAnchorTasks = 20;
+
+/*
+ Interval, in milliseconds, at which the states of in-flight tasks are polled and
+ queued tasks are issued.
+ */
+static const double kCloudAnchorPollIntervalMs = 100;
+
+/*
+ Times are in milliseconds (see VROTimeCurrentMillis). The cloud anchor is created
+ once the task is issued to ARCore.
+ */
 class VROCloudAnchorHostTask {
 public:
     std::shared_ptr<VROARAnchor> originalAnchor;
     std::shared_ptr<VROARAnchorARCore> cloudAnchor;
     std::function<void(std::shared_ptr<VROARAnchor> anchor)> onSuccess;
     std::function<void(std::string error)> onFailure;
+    double queuedTimeMs;
+    double issuedTimeMs;
 };
 
 class VROCloudAnchorResolveTask {
@@ -50,10 +71,32 @@ public:
     std::shared_ptr<VROARAnchorARCore> cloudAnchor;
     std::function<void(std::shared_ptr<VROARAnchor> anchor)> onSuccess;
     std::function<void(std::string error)> onFailure;
+    double queuedTimeMs;
+    double issuedTimeMs;
+};
+
+/*
+ Latencies of the cloud anchor tasks completed by a provider, in milliseconds. Queue
+ time is spent waiting for a free slot, and service time in flight, from issuing the
+ task to ARCore until it succeeds or fails.
+ */
+struct VROCloudAnchorMetrics {
+    int numHosted;
+    int numResolved;
+    int numFailed;
+    double averageQueueTimeMs;
+    double averageHostTimeMs;
+    double averageResolveTimeMs;
+    double maxResolveTimeMs;
 };
 
 /*
  Manages the hosting and resolution of cloud anchors from ARCore.
+
+ Up to kMaxConcurrentCloudAnchorTasks requests are in flight at once; their states are
+ polled together every kCloudAnchorPollIntervalMs. Queued resolves are issued in the
+ order requested. Queued hosts are issued nearest the user's view first, since ARCore
+ hosts anchors from the features it has recently seen around them.
  */
 class VROCloudAnchorProviderARCore : public VROFrameListener {
 
@@ -83,10 +126,21 @@ public:
     void onFrameWillRender(const VRORenderContext &context);
     void onFrameDidRender(const VRORenderContext &context);
 
+    /*
+     Latencies of the tasks completed so far.
+     */
+    VROCloudAnchorMetrics getMetrics() const;
+
 private:
 
     std::weak_ptr<VROARSessionARCore> _session;
 
+    /*
+     Requests waiting for a free slot before they are issued to ARCore.
+     */
+    std::deque<VROCloudAnchorHostTask> _pendingHosting;
+    std::deque<VROCloudAnchorResolveTask> _pendingResolving;
+
     /*
      Vector of cloud anchors that we are attempting to host.
      */
@@ -97,6 +151,36 @@ private:
      */
     std::vector<VROCloudAnchorResolveTask> _queuedResolving;
 
+    /*
+     Time of the last poll, and the totals from which metrics are derived.
+     */
+    double _lastPollTimeMs;
+    int _numHosted, _numResolved, _numFailed;
+    double _totalQueueTimeMs, _totalHostTimeMs, _totalResolveTimeMs, _maxResolveTimeMs;
+
+    /*
+     Poll the states of the in-flight tasks, completing those that have finished.
+     */
+    void pollTasks(double nowMs);
+
+    /*
+     Issue queued tasks to ARCore until the in-flight limit is reached.
+     */
+    void issueTasks(const VROCamera &camera, double nowMs);
+
+    /*
+     Issue the given task to ARCore. Returns false if the service is out of resources,
+     in which case the task should be retried later. Other failures are reported to
+     the task's callback.
+     */
+    bool issueHostTask(VROCloudAnchorHostTask &task, double nowMs);
+    bool issueResolveTask(VROCloudAnchorResolveTask &task, double nowMs);
+
+    /*
+     Record the latencies of a finished task.
+     */
+    void recordTask(double queuedTimeMs, double issuedTimeMs, double nowMs, bool host, bool success);
+
     /*
      Retrieve an error string from an ARCore error code.
      */
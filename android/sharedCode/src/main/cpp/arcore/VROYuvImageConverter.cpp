@@ -28,10 +28,19 @@
 #include "ARCore_API.h"
 #include "VROLog.h"
 #include <algorithm>
+#include <vector>
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define VRO_YUV_NEON 1
+#endif
 
 static const int kMaxChannelValue = 262143;
 
-static inline uint32_t YUV2RGB(int nY, int nU, int nV) {
+// Rotated conversions transpose this many rows at a time, so that each
+// column of the output is written in short contiguous runs
+static const int kRotationBlockRows = 8;
+
+static inline uint32_t YUV2RGB(int nY, int nU, int nV, bool rgba) {
     nY -= 16;
     nU -= 128;
     nV -= 128;
@@ -55,103 +64,96 @@ static inline uint32_t YUV2RGB(int nY, int nU, int nV) {
     nG = (nG >> 10) & 0xff;
     nB = (nB >> 10) & 0xff;
 
-    return 0xff000000 | (nR << 16) | (nG << 8) | nB;
-}
-
-void VROYuvImageConverter::convertImage(arcore::Image *image, uint8_t *data) {
-    int left, right, bottom, top;
-    image->getCropRect(&left, &right, &bottom, &top);
-
-    int numPlanes = image->getNumberOfPlanes();
-    if (numPlanes != 3) {
-        pwarn("Cannot convert YCbCr image data to RGBA: detected %d planes instead of 3", numPlanes);
-        return;
+    if (rgba) {
+        return 0xff000000 | (nB << 16) | (nG << 8) | nR;
+    } else {
+        return 0xff000000 | (nR << 16) | (nG << 8) | nB;
     }
-    int32_t yStride  = image->getPlaneRowStride(0);
-    int32_t uvStride = image->getPlaneRowStride(1);
-    int32_t uvPixelStride = image->getPlanePixelStride(1);
-
-    const uint8_t *yPixel = nullptr;
-    int32_t yLen;
-    image->getPlaneData(0, &yPixel, &yLen);
-
-    const uint8_t *vPixel = nullptr;
-    int32_t vLen;
-    image->getPlaneData(1, &vPixel, &vLen);
+}
 
-    const uint8_t *uPixel = nullptr;
-    int32_t uLen;
-    image->getPlaneData(2, &uPixel, &uLen);
+#if VRO_YUV_NEON
 
-    int32_t height = bottom - top;
-    int32_t width = right - left;
+/*
+ Shift a 32-bit fixed point channel down to 8 bits, saturating at 0 and 255. This
+ matches the clamp to [0, kMaxChannelValue] followed by the shift in YUV2RGB.
+ */
+static inline uint8x8_t narrowChannel(int32x4_t lo, int32x4_t hi) {
+    return vqmovn_u16(vcombine_u16(vqshrun_n_s32(lo, 10), vqshrun_n_s32(hi, 10)));
+}
 
-    uint32_t *out = (uint32_t *) data;
-    for (int32_t y = 0; y < height; y++) {
-        const uint8_t *pY = yPixel + yStride * (y + top) + left;
+/*
+ Convert 8 pixels with the same integer math as YUV2RGB. The luma values must
+ already have the 16 offset removed (saturating at 0).
+ */
+static inline void convertPixels8(uint8x8_t y, uint8x8_t u, uint8x8_t v, bool rgba, uint8_t *out) {
+    int16x8_t y16 = vreinterpretq_s16_u16(vmovl_u8(y));
+    int16x8_t u16 = vreinterpretq_s16_u16(vsubl_u8(u, vdup_n_u8(128)));
+    int16x8_t v16 = vreinterpretq_s16_u16(vsubl_u8(v, vdup_n_u8(128)));
+
+    int32x4_t yLo = vmull_n_s16(vget_low_s16(y16), 1192);
+    int32x4_t yHi = vmull_n_s16(vget_high_s16(y16), 1192);
+
+    int32x4_t rLo = vmlal_n_s16(yLo, vget_low_s16(v16), 1634);
+    int32x4_t rHi = vmlal_n_s16(yHi, vget_high_s16(v16), 1634);
+    int32x4_t gLo = vmlsl_n_s16(vmlsl_n_s16(yLo, vget_low_s16(v16), 833), vget_low_s16(u16), 400);
+    int32x4_t gHi = vmlsl_n_s16(vmlsl_n_s16(yHi, vget_high_s16(v16), 833), vget_high_s16(u16), 400);
+    int32x4_t bLo = vmlal_n_s16(yLo, vget_low_s16(u16), 2066);
+    int32x4_t bHi = vmlal_n_s16(yHi, vget_high_s16(u16), 2066);
+
+    uint8x8x4_t pixels;
+    pixels.val[rgba ? 0 : 2] = narrowChannel(rLo, rHi);
+    pixels.val[1] = narrowChannel(gLo, gHi);
+    pixels.val[rgba ? 2 : 0] = narrowChannel(bLo, bHi);
+    pixels.val[3] = vdup_n_u8(0xff);
+    vst4_u8(out, pixels);
+}
 
-        int32_t uv_row_start = uvStride * ((y + top) >> 1);
-        const uint8_t *pU = uPixel + uv_row_start + (left >> 1);
-        const uint8_t *pV = vPixel + uv_row_start + (left >> 1);
+#endif
 
-        for (int32_t x = 0; x < width; x++) {
-            const int32_t uv_offset = (x >> 1) * uvPixelStride;
-            out[x] = YUV2RGB(pY[x], pU[uv_offset], pV[uv_offset]);
+/*
+ Convert one row of the image. Chroma is horizontally subsampled, so each U and V
+ sample covers two pixels.
+ */
+static void convertRow(const uint8_t *pY, const uint8_t *pU, const uint8_t *pV,
+                       int32_t uvPixelStride, int32_t width, bool rgba, uint32_t *out) {
+    int32_t x = 0;
+
+#if VRO_YUV_NEON
+    // Planar (1) and semi-planar (2) chroma are vectorized; semi-planar rows load
+    // one byte past the last chroma sample used, so stop one pair early for those
+    if (uvPixelStride == 1 || uvPixelStride == 2) {
+        int32_t end = width - (uvPixelStride == 2 ? 2 : 0);
+        for (; x + 16 <= end; x += 16) {
+            int32_t uvOffset = (x >> 1) * uvPixelStride;
+            uint8x8_t u, v;
+            if (uvPixelStride == 1) {
+                u = vld1_u8(pU + uvOffset);
+                v = vld1_u8(pV + uvOffset);
+            } else {
+                u = vld2_u8(pU + uvOffset).val[0];
+                v = vld2_u8(pV + uvOffset).val[0];
+            }
+            uint8x8x2_t uu = vzip_u8(u, u);
+            uint8x8x2_t vv = vzip_u8(v, v);
+            uint8x16_t y = vqsubq_u8(vld1q_u8(pY + x), vdupq_n_u8(16));
+
+            convertPixels8(vget_low_u8(y),  uu.val[0], vv.val[0], rgba, (uint8_t *) (out + x));
+            convertPixels8(vget_high_u8(y), uu.val[1], vv.val[1], rgba, (uint8_t *) (out + x + 8));
         }
-        out += width; // width is the int32_t stride
     }
-}
-
-void VROYuvImageConverter::convertImage90(arcore::Image *image, uint8_t *data) {
-    int left, right, bottom, top;
-    image->getCropRect(&left, &right, &bottom, &top);
+#endif
 
-    int numPlanes = image->getNumberOfPlanes();
-    if (numPlanes != 3) {
-        pwarn("Cannot convert YCbCr image data to RGBA: detected %d planes instead of 3", numPlanes);
-        return;
-    }
-    int32_t yStride  = image->getPlaneRowStride(0);
-    int32_t uvStride = image->getPlaneRowStride(1);
-    int32_t uvPixelStride = image->getPlanePixelStride(1);
-
-    const uint8_t *yPixel = nullptr;
-    int32_t yLen;
-    image->getPlaneData(0, &yPixel, &yLen);
-
-    const uint8_t *vPixel = nullptr;
-    int32_t vLen;
-    image->getPlaneData(1, &vPixel, &vLen);
-
-    const uint8_t *uPixel = nullptr;
-    int32_t uLen;
-    image->getPlaneData(2, &uPixel, &uLen);
-
-    int32_t height = bottom - top;
-    int32_t width = right - left;
-
-    uint32_t *out = (uint32_t *) data;
-    out += height - 1;
-    for (int32_t y = 0; y < height; y++) {
-        const uint8_t *pY = yPixel + yStride * (y + top) + left;
-
-        int32_t uv_row_start = uvStride * ((y + top) >> 1);
-        const uint8_t *pU = uPixel + uv_row_start + (left >> 1);
-        const uint8_t *pV = vPixel + uv_row_start + (left >> 1);
-
-        for (int32_t x = 0; x < width; x++) {
-            const int32_t uv_offset = (x >> 1) * uvPixelStride;
-            // [x, y]--> [-y, x]
-            int testb = pU[uv_offset];
-            int testc = pV[uv_offset];
-            int testA = pY[x];
-            out[x * height] = YUV2RGB(testA, testb, testc);
-        }
-        out -= 1;  // move to the next column
+    for (; x < width; x++) {
+        const int32_t uv_offset = (x >> 1) * uvPixelStride;
+        out[x] = YUV2RGB(pY[x], pU[uv_offset], pV[uv_offset], rgba);
     }
 }
 
-void VROYuvImageConverter::convertImage180(arcore::Image *image, uint8_t *data) {
+/*
+ Convert the cropped image, rotating it counterclockwise by the given number of
+ degrees (0, 90, 180, or 270).
+ */
+static void convertImageRotated(arcore::Image *image, uint8_t *data, int rotation, bool rgba) {
     int left, right, bottom, top;
     image->getCropRect(&left, &right, &bottom, &top);
 
@@ -178,69 +180,76 @@ void VROYuvImageConverter::convertImage180(arcore::Image *image, uint8_t *data)
 
     int32_t height = bottom - top;
     int32_t width = right - left;
+    if (width <= 0 || height <= 0) {
+        return;
+    }
 
     uint32_t *out = (uint32_t *) data;
-    out += (height - 1) * width;
-    for (int32_t y = 0; y < height; y++) {
-        const uint8_t *pY = yPixel + yStride * (y + top) + left;
-
-        int32_t uv_row_start = uvStride * ((y + top) >> 1);
-        const uint8_t *pU = uPixel + uv_row_start + (left >> 1);
-        const uint8_t *pV = vPixel + uv_row_start + (left >> 1);
-
-        for (int32_t x = 0; x < width; x++) {
-            const int32_t uv_offset = (x >> 1) * uvPixelStride;
-            // mirror image since we are using front camera
-            out[width - 1 - x] = YUV2RGB(pY[x], pU[uv_offset], pV[uv_offset]);
-            // out[x] = YUV2RGB(pY[x], pU[uv_offset], pV[uv_offset]);
-        }
-        out -= width;
+    std::vector<uint32_t> block;
+    if (rotation == 90 || rotation == 270) {
+        block.resize(kRotationBlockRows * width);
     }
-}
 
-void VROYuvImageConverter::convertImage270(arcore::Image *image, uint8_t *data) {
-    int left, right, bottom, top;
-    image->getCropRect(&left, &right, &bottom, &top);
+    for (int32_t y0 = 0; y0 < height; y0 += kRotationBlockRows) {
+        int32_t rows = std::min(kRotationBlockRows, height - y0);
+
+        for (int32_t r = 0; r < rows; r++) {
+            int32_t y = y0 + r;
+            const uint8_t *pY = yPixel + yStride * (y + top) + left;
+
+            int32_t uv_row_start = uvStride * ((y + top) >> 1);
+            const uint8_t *pU = uPixel + uv_row_start + (left >> 1);
+            const uint8_t *pV = vPixel + uv_row_start + (left >> 1);
+
+            if (rotation == 0) {
+                convertRow(pY, pU, pV, uvPixelStride, width, rgba, out + y * width);
+            } else if (rotation == 180) {
+                // Mirror image since we are using front camera
+                uint32_t *row = out + (height - 1 - y) * width;
+                convertRow(pY, pU, pV, uvPixelStride, width, rgba, row);
+                std::reverse(row, row + width);
+            } else {
+                convertRow(pY, pU, pV, uvPixelStride, width, rgba, &block[r * width]);
+            }
+        }
 
-    int numPlanes = image->getNumberOfPlanes();
-    if (numPlanes != 3) {
-        pwarn("Cannot convert YCbCr image data to RGBA: detected %d planes instead of 3", numPlanes);
-        return;
+        // Transpose the block: each source column becomes a run of 'rows' pixels
+        // in one output row
+        if (rotation == 90) {
+            // [x, y] --> [-y, x]
+            for (int32_t x = 0; x < width; x++) {
+                uint32_t *dst = out + x * height + (height - 1 - y0);
+                for (int32_t r = 0; r < rows; r++) {
+                    dst[-r] = block[r * width + x];
+                }
+            }
+        } else if (rotation == 270) {
+            for (int32_t x = 0; x < width; x++) {
+                uint32_t *dst = out + (width - 1 - x) * height + y0;
+                for (int32_t r = 0; r < rows; r++) {
+                    dst[r] = block[r * width + x];
+                }
+            }
+        }
     }
-    int32_t yStride  = image->getPlaneRowStride(0);
-    int32_t uvStride = image->getPlaneRowStride(1);
-    int32_t uvPixelStride = image->getPlanePixelStride(1);
+}
 
-    const uint8_t *yPixel = nullptr;
-    int32_t yLen;
-    image->getPlaneData(0, &yPixel, &yLen);
+void VROYuvImageConverter::convertImage(arcore::Image *image, uint8_t *data) {
+    convertImageRotated(image, data, 0, false);
+}
 
-    const uint8_t *vPixel = nullptr;
-    int32_t vLen;
-    image->getPlaneData(1, &vPixel, &vLen);
+void VROYuvImageConverter::convertImage90(arcore::Image *image, uint8_t *data) {
+    convertImageRotated(image, data, 90, false);
+}
 
-    const uint8_t *uPixel = nullptr;
-    int32_t uLen;
-    image->getPlaneData(2, &uPixel, &uLen);
+void VROYuvImageConverter::convertImage180(arcore::Image *image, uint8_t *data) {
+    convertImageRotated(image, data, 180, false);
+}
 
-    int32_t height = bottom - top;
-    int32_t width = right - left;
+void VROYuvImageConverter::convertImage270(arcore::Image *image, uint8_t *data) {
+    convertImageRotated(image, data, 270, false);
+}
 
-    uint32_t *out = (uint32_t *) data;
-    for (int32_t y = 0; y < height; y++) {
-        const uint8_t *pY = yPixel + yStride * (y + top) + left;
-
-        int32_t uv_row_start = uvStride * ((y + top) >> 1);
-        const uint8_t *pU = uPixel + uv_row_start + (left >> 1);
-        const uint8_t *pV = vPixel + uv_row_start + (left >> 1);
-
-        for (int32_t x = 0; x < width; x++) {
-            const int32_t uv_offset = (x >> 1) * uvPixelStride;
-            int testb = pU[uv_offset];
-            int testc = pV[uv_offset];
-            int testA = pY[x];
-            out[(width - 1 - x) * height] = YUV2RGB(testA, testb, testc);
-        }
-        out += 1;  // move to the next column
-    }
-}
\ No newline at end of file
+void VROYuvImageConverter::convertImageRGBA(arcore::Image *image, uint8_t *data) {
+    convertImageRotated(image, data, 0, true);
+}
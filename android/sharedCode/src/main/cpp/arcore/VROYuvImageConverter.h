@@ -32,13 +32,18 @@
 class VROYuvImageConverter {
 public:
 
-    // Converts the given arcore::Image from YCbCr to RGBA.
-    // Conversion rotation amounts are counterclockwise
+    // Converts the given arcore::Image from YCbCr to RGBA, writing each pixel as
+    // a 0xAARRGGBB word. Conversion rotation amounts are counterclockwise. Rows
+    // are converted with NEON where available.
     static void convertImage(arcore::Image *image, uint8_t *data);
     static void convertImage90(arcore::Image *image, uint8_t *data);
     static void convertImage180(arcore::Image *image, uint8_t *data);
     static void convertImage270(arcore::Image *image, uint8_t *data);
 
+    // Converts the given arcore::Image from YCbCr to RGBA without rotation,
+    // writing each pixel as R, G, B, A bytes.
+    static void convertImageRGBA(arcore::Image *image, uint8_t *data);
+
 };
 
 
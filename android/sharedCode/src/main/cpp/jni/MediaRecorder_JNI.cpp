@@ -70,6 +70,18 @@ VRO_METHOD(void, nativeScheduleScreenCapture)(VRO_ARGS
         recorder->nativeScheduleScreenCapture();
     });
 }
+
+VRO_METHOD(void, nativeSetVideoEncoderOutput)(VRO_ARGS
+                                              jlong jRecorderRef,
+                                              VRO_STRING path_j,
+                                              jint bitrate_j) {
+    std::shared_ptr<MediaRecorder_JNI> recorder = MediaRecorder::native(jRecorderRef);
+    std::string path = VRO_STRING_STL(path_j);
+    int bitrate = bitrate_j;
+    VROPlatformDispatchAsyncRenderer([recorder, path, bitrate] {
+        recorder->nativeSetVideoEncoderOutput(path, bitrate);
+    });
+}
 } // extern "C"
 
 
@@ -104,7 +116,7 @@ void MediaRecorder_JNI::nativeEnableFrameRecording(bool isRecording) {
         _nativeMediaRecorder->init(driver);
         std::shared_ptr<VRORenderToTextureDelegateAndroid> delegate = _nativeMediaRecorder->getRenderToTextureDelegate();
         choreographer->setRenderToTextureDelegate(delegate);
-    } else {
+    } else if (!_nativeMediaRecorder->hasPendingScreenCapture()) {
         choreographer->setRenderToTextureDelegate(nullptr);
     }
     _nativeMediaRecorder->setEnableVideoFrameRecording(isRecording);
@@ -121,6 +133,10 @@ void MediaRecorder_JNI::nativeScheduleScreenCapture() {
     _nativeMediaRecorder->scheduleScreenCapture();
 }
 
+void MediaRecorder_JNI::nativeSetVideoEncoderOutput(std::string path, int bitrate) {
+    _nativeMediaRecorder->setVideoEncoderOutput(path, bitrate);
+}
+
 /*
  * Native to Java calls.
  */
@@ -140,8 +156,14 @@ void MediaRecorder_JNI::onEglSwap() {
     VROPlatformCallHostFunction(_javaMediaRecorder, "onNativeSwapEGLSurface","()V");
 }
 
-void MediaRecorder_JNI::onTakeScreenshot() {
-    VROPlatformCallHostFunction(_javaMediaRecorder, "onNativeTakeScreenshot","()V");
+void MediaRecorder_JNI::onTakeScreenshot(void *pixels, int length, int width, int height) {
+    // The pixels are RGBA rows, bottom row first, and are only valid for the duration
+    // of the call
+    JNIEnv *env = VROPlatformGetJNIEnv();
+    jobject jbuffer = env->NewDirectByteBuffer(pixels, length);
+    VROPlatformCallHostFunction(_javaMediaRecorder, "onNativeTakeScreenshot", "(Ljava/nio/ByteBuffer;II)V",
+                                jbuffer, width, height);
+    env->DeleteLocalRef(jbuffer);
 
     // If we're not recording video, then go ahead and remove the delegate. There's a
     // performance penalty for leaving the RTT delegate in place in the choreographer.
@@ -149,7 +171,7 @@ void MediaRecorder_JNI::onTakeScreenshot() {
     if (!choreographer) {
         return;
     }
-    if (!_nativeMediaRecorder->isRecordingVideo()) {
+    if (!_nativeMediaRecorder->isRecordingVideo() && !_nativeMediaRecorder->hasPendingScreenCapture()) {
         choreographer->setRenderToTextureDelegate(nullptr);
     }
 }
\ No newline at end of file
@@ -58,13 +58,14 @@ public:
     void nativeCreateRecorder(std::shared_ptr<VROSceneRenderer> renderer);
     void nativeEnableFrameRecording(bool isRecording);
     void nativeScheduleScreenCapture();
+    void nativeSetVideoEncoderOutput(std::string path, int bitrate);
 
     // Native to java calls
     void onBindToEGLSurface();
     void onUnbindFromEGLSurface();
     void onEnableFrameRecording(bool enabled);
     void onEglSwap();
-    void onTakeScreenshot();
+    void onTakeScreenshot(void *pixels, int length, int width, int height);
 
 private:
     std::shared_ptr<VROAVRecorderAndroid> _nativeMediaRecorder;
@@ -26,12 +26,15 @@
 #include "VROPlatformUtil.h"
 #include "VROSceneRendererARCore.h"
 #include "VROSceneController.h"
+#include "VROTextureReader.h"
+#include "arcore/VROARFrameARCore.h"
 
 // +---------------------------------------------------------------------------+
 // | Camera Image Frame Listener
 // +---------------------------------------------------------------------------+
 
 void VROCameraImageFrameListener::onFrameWillRender(const VRORenderContext &context) {
+    _readerActive = false;
     VRO_ENV env = VROPlatformGetJNIEnv();
     std::shared_ptr<VROSceneRendererARCore> renderer = _renderer.lock();
     if (!renderer) {
@@ -63,9 +66,6 @@ void VROCameraImageFrameListener::onFrameWillRender(const VRORenderContext &cont
     if (camera->getTrackingState() != VROARTrackingState::Normal) {
         return;
     }
-    int bufferIndex = _bufferIndex;
-    _bufferIndex = (_bufferIndex + 1) % 3;
-
     VROVector3f size = camera->getImageSize();
     int width = (int) size.x;
     int height = (int) size.y;
@@ -73,19 +73,81 @@ void VROCameraImageFrameListener::onFrameWillRender(const VRORenderContext &cont
         return;
     }
 
-    int dataLength = width * height * 4;
-    if (!_data[bufferIndex] || _data[bufferIndex]->getDataLength() < dataLength) {
-        uint8_t *data = (uint8_t *) malloc(dataLength);
-        _data[bufferIndex] = std::make_shared<VROData>(data, dataLength, VRODataOwnership::Move);
-        _buffers[bufferIndex] = VRO_NEW_GLOBAL_REF(env->NewDirectByteBuffer(data, dataLength));
+    float outFx, outFy, outCx, outCy;
+    camera->getImageIntrinsics(&outFx, &outFy, &outCx, &outCy);
+
+    // On the GPU path the image is read after this frame renders, and delivered from
+    // onFrameDidRender once the read completes
+    _readerActive = _gpuConversionEnabled && updateReader(renderer, frame.get(), width, height);
+    if (_readerActive) {
+        _readerIntrinsics[0] = outFx;
+        _readerIntrinsics[1] = outFy;
+        _readerIntrinsics[2] = outCx;
+        _readerIntrinsics[3] = outCy;
+        return;
     }
 
+    int bufferIndex = prepareBuffer(env, width * height * 4);
     camera->getImageData((uint8_t *) _data[bufferIndex]->getData());
+    dispatchImage(bufferIndex, width, height, outFx, outFy, outCx, outCy);
+}
 
+bool VROCameraImageFrameListener::updateReader(std::shared_ptr<VROSceneRendererARCore> renderer,
+                                               VROARFrame *frame, int width, int height) {
+    VROARFrameARCore *frameARCore = dynamic_cast<VROARFrameARCore *>(frame);
+    if (!frameARCore) {
+        return false;
+    }
 
-    float outFx, outFy, outCx, outCy;
-    camera->getImageIntrinsics(&outFx, &outFy, &outCx, &outCy);
+    if (!_reader || _readerWidth != width || _readerHeight != height) {
+        _reader = std::make_shared<VROTextureReader>((int) renderer->getCameraTextureId(),
+                                                     width, height, width, height, 1,
+                                                     VROTextureReaderOutputFormat::BGRA8,
+                [this] (std::shared_ptr<VROData> data) {
+                    VRO_ENV env = VROPlatformGetJNIEnv();
+                    int bufferIndex = prepareBuffer(env, (int) data->getDataLength());
+                    memcpy(_data[bufferIndex]->getData(), data->getData(), data->getDataLength());
+                    dispatchImage(bufferIndex, _readerWidth, _readerHeight,
+                                  _readerIntrinsics[0], _readerIntrinsics[1],
+                                  _readerIntrinsics[2], _readerIntrinsics[3]);
+                });
+        if (!_reader->init()) {
+            pwarn("Failed to create camera image reader, falling back to CPU image conversion");
+            _reader.reset();
+            _gpuConversionEnabled = false;
+            return false;
+        }
+        _readerWidth = width;
+        _readerHeight = height;
+    }
 
+    // The background texture coordinates crop and rotate the camera texture to the
+    // viewport. glReadPixels returns rows bottom-up, so flip them vertically to
+    // produce the same top-down image as the CPU path.
+    VROVector3f BL, BR, TL, TR;
+    frameARCore->getBackgroundTexcoords(&BL, &BR, &TL, &TR);
+    _reader->setTextureCoordinates(TL, TR, BL, BR);
+    return true;
+}
+
+int VROCameraImageFrameListener::prepareBuffer(VRO_ENV env, int dataLength) {
+    int bufferIndex = _bufferIndex;
+    _bufferIndex = (_bufferIndex + 1) % 3;
+
+    if (!_data[bufferIndex] || _data[bufferIndex]->getDataLength() < dataLength) {
+        if (_buffers[bufferIndex] != NULL) {
+            VRO_DELETE_GLOBAL_REF(_buffers[bufferIndex]);
+        }
+        uint8_t *data = (uint8_t *) malloc(dataLength);
+        _data[bufferIndex] = std::make_shared<VROData>(data, dataLength, VRODataOwnership::Move);
+        _buffers[bufferIndex] = VRO_NEW_GLOBAL_REF(env->NewDirectByteBuffer(data, dataLength));
+    }
+    return bufferIndex;
+}
+
+void VROCameraImageFrameListener::dispatchImage(int bufferIndex, int width, int height,
+                                                float outFx, float outFy, float outCx, float outCy) {
+    VRO_ENV env = VROPlatformGetJNIEnv();
     VRO_OBJECT intrinsics = VROPlatformConstructHostObject("com/viro/core/CameraIntrinsics",
                                                            "(FFFF)V", outFx, outFy, outCx, outCy);
 
@@ -128,5 +190,7 @@ void VROCameraImageFrameListener::onFrameWillRender(const VRORenderContext &cont
 }
 
 void VROCameraImageFrameListener::onFrameDidRender(const VRORenderContext &context) {
-
+    if (_readerActive && _reader) {
+        _reader->onFrameDidRender(context);
+    }
 }
\ No newline at end of file
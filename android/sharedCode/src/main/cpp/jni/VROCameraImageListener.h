@@ -33,13 +33,26 @@
 #include "VROARScene.h"
 
 class VROSceneRendererARCore;
+class VROTextureReader;
+class VROARFrame;
 
+/*
+ Delivers the camera image to the Java listener each frame. By default the image is
+ converted and rotated on the GPU: the camera texture is rendered into a target that
+ VROTextureReader reads back asynchronously, so each image is delivered one frame
+ after it was captured. If the reader cannot be created, the listener falls back to
+ converting the ARCore CPU image with VROYuvImageConverter.
+ */
 class VROCameraImageFrameListener : public VROFrameListener {
 public:
     VROCameraImageFrameListener(VRO_OBJECT listener_j, std::shared_ptr<VROSceneRendererARCore> renderer, VRO_ENV env) :
             _listener_j(VRO_NEW_WEAK_GLOBAL_REF(listener_j)),
             _renderer(renderer),
-            _bufferIndex(0) {
+            _bufferIndex(0),
+            _gpuConversionEnabled(true),
+            _readerActive(false),
+            _readerWidth(0),
+            _readerHeight(0) {
 
         for (int i = 0; i < 3; i++) {
             _buffers[i] = NULL;
@@ -60,12 +73,49 @@ public:
     void onFrameWillRender(const VRORenderContext &context);
     void onFrameDidRender(const VRORenderContext &context);
 
+    /*
+     Enable or disable GPU conversion of the camera image. When disabled, the image
+     is converted from the ARCore CPU image on the rendering thread.
+     */
+    void setGPUConversionEnabled(bool enabled) {
+        _gpuConversionEnabled = enabled;
+    }
+
 private:
     VRO_OBJECT _listener_j;
     std::weak_ptr<VROSceneRendererARCore> _renderer;
     int _bufferIndex;
     std::shared_ptr<VROData> _data[3];
     jobject _buffers[3];
+
+    /*
+     GPU conversion state. The reader is recreated whenever the image size changes.
+     The intrinsics are those of the most recent frame.
+     */
+    bool _gpuConversionEnabled;
+    bool _readerActive;
+    std::shared_ptr<VROTextureReader> _reader;
+    int _readerWidth, _readerHeight;
+    float _readerIntrinsics[4];
+
+    /*
+     Point the reader at the camera texture for the given frame, creating it if
+     needed. Returns false if the GPU path is unavailable.
+     */
+    bool updateReader(std::shared_ptr<VROSceneRendererARCore> renderer, VROARFrame *frame,
+                      int width, int height);
+
+    /*
+     Advance to the next of the three image buffers, growing it to fit dataLength
+     bytes, and return its index.
+     */
+    int prepareBuffer(VRO_ENV env, int dataLength);
+
+    /*
+     Send the image in the given buffer to the Java listener.
+     */
+    void dispatchImage(int bufferIndex, int width, int height,
+                       float fx, float fy, float cx, float cy);
 };
 
 
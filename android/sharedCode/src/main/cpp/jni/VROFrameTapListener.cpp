@@ -11,15 +11,41 @@
 #include "arcore/VROARFrameARCore.h"
 #include "arcore/VROARCameraARCore.h"
 #include "arcore/VROARSessionARCore.h"
+#include "arcore/VROYuvImageConverter.h"
 #include "VROLog.h"
 #include <android/log.h>
+#include <android/hardware_buffer_jni.h>
+#include <dlfcn.h>
+#include <unistd.h>
+#include <mutex>
 
 #define FRAME_TAP_TAG "ViroFrameTap"
 
+// AHardwareBuffer_toHardwareBuffer is API 26, so it is resolved at runtime
+typedef jobject (*VRO_PFN_AHardwareBuffer_toHardwareBuffer)(JNIEnv *env, AHardwareBuffer *buffer);
+
+static jobject toHardwareBuffer(JNIEnv *env, AHardwareBuffer *buffer) {
+    static VRO_PFN_AHardwareBuffer_toHardwareBuffer sToHardwareBuffer = nullptr;
+    static std::once_flag loaded;
+    std::call_once(loaded, [] {
+        void *library = dlopen("libandroid.so", RTLD_NOW);
+        if (library != nullptr) {
+            sToHardwareBuffer = (VRO_PFN_AHardwareBuffer_toHardwareBuffer) dlsym(library, "AHardwareBuffer_toHardwareBuffer");
+        }
+    });
+    return sToHardwareBuffer ? sToHardwareBuffer(env, buffer) : nullptr;
+}
+
 VROFrameTapListener::VROFrameTapListener(VRO_OBJECT listener_j, bool enableCpuImages, VRO_ENV env) :
     _enableCpuImages(enableCpuImages),
     _isProcessing(false),
-    _frameCounter(0) {
+    _frameCounter(0),
+    _hardwareBufferCameraFrames(false),
+    _hardwareBufferRenderedFrames(false),
+    _hardwareBufferMaxFrames(0),
+    _hardwareBufferFrameClass(nullptr),
+    _hardwareBufferFrameConstructor(nullptr),
+    _onHardwareBufferFrameMethod(nullptr) {
 
     // Create weak global ref to listener (will be checked for validity)
     _listener_j = VRO_NEW_WEAK_GLOBAL_REF(listener_j);
@@ -72,6 +98,9 @@ VROFrameTapListener::~VROFrameTapListener() {
     if (_cpuImageClass) {
         VRO_DELETE_GLOBAL_REF(_cpuImageClass);
     }
+    if (_hardwareBufferFrameClass) {
+        VRO_DELETE_GLOBAL_REF(_hardwareBufferFrameClass);
+    }
 
     __android_log_print(ANDROID_LOG_DEBUG, FRAME_TAP_TAG, "VROFrameTapListener destroyed");
 }
@@ -139,6 +168,17 @@ void VROFrameTapListener::dispatchFrame(VROARFrameARCore *frame,
         __android_log_print(ANDROID_LOG_ERROR, FRAME_TAP_TAG, "Unexpected exception in onTextureFrame");
     }
 
+    // Zero-copy camera frame (optional), rendered into the next free hardware buffer
+    if (_hardwareBufferCameraFrames) {
+        VROVector3f size = camera->getImageSize();
+        if (preparePool(_cameraFramePool, (int) size.x, (int) size.y, VROHardwareBufferFrameSource::Camera)) {
+            VROVector3f BL, BR, TL, TR;
+            frame->getBackgroundTexcoords(&BL, &BR, &TL, &TR);
+            _cameraFramePool->captureTexture(cameraTextureId, BL, BR, TL, TR, frame->getTimestamp());
+            deliverHardwareBufferFrames(env, listenerRef, _cameraFramePool.get());
+        }
+    }
+
     // CPU image path (optional)
     if (_enableCpuImages) {
         jobject cpuImage = createCpuImage(env, frame, camera, displayRotation);
@@ -162,6 +202,148 @@ void VROFrameTapListener::dispatchFrame(VROARFrameARCore *frame,
     _isProcessing = false;
 }
 
+void VROFrameTapListener::dispatchRenderedFrame(VROARFrameARCore *frame,
+                                                GLuint framebuffer,
+                                                int width, int height) {
+    if (!_hardwareBufferRenderedFrames || width <= 0 || height <= 0) {
+        return;
+    }
+    if (!preparePool(_renderedFramePool, width, height, VROHardwareBufferFrameSource::Rendered)) {
+        return;
+    }
+
+    VRO_ENV env = VROPlatformGetJNIEnv();
+    VRO_OBJECT listenerRef = VRO_NEW_LOCAL_REF(_listener_j);
+    if (!listenerRef) {
+        return;
+    }
+    _renderedFramePool->captureFramebuffer(framebuffer, width, height, frame->getTimestamp());
+    deliverHardwareBufferFrames(env, listenerRef, _renderedFramePool.get());
+    VRO_DELETE_LOCAL_REF(listenerRef);
+}
+
+void VROFrameTapListener::setHardwareBufferFrames(bool cameraFrames, bool renderedFrames, int maxFrames) {
+    VRO_ENV env = VROPlatformGetJNIEnv();
+
+    if ((cameraFrames || renderedFrames) && !_onHardwareBufferFrameMethod) {
+        jclass frameTapListenerClass = env->FindClass("com/viro/core/FrameTapListener");
+        jclass hardwareBufferFrameClass = env->FindClass("com/viro/core/HardwareBufferFrame");
+        if (env->ExceptionCheck() || !frameTapListenerClass || !hardwareBufferFrameClass) {
+            env->ExceptionClear();
+            __android_log_print(ANDROID_LOG_ERROR, FRAME_TAP_TAG, "HardwareBufferFrame API not available");
+            return;
+        }
+        _hardwareBufferFrameClass = (jclass) VRO_NEW_GLOBAL_REF(hardwareBufferFrameClass);
+        _hardwareBufferFrameConstructor = env->GetMethodID(_hardwareBufferFrameClass, "<init>",
+            "(JJLandroid/hardware/HardwareBuffer;IIIII)V");
+        // (long frameId, long timestampNs, HardwareBuffer buffer, int fenceFd,
+        //  int width, int height, int source, int droppedFrames)
+        _onHardwareBufferFrameMethod = env->GetMethodID(frameTapListenerClass, "onHardwareBufferFrame",
+            "(Lcom/viro/core/HardwareBufferFrame;)V");
+        if (env->ExceptionCheck()) {
+            env->ExceptionClear();
+            _hardwareBufferFrameConstructor = nullptr;
+            _onHardwareBufferFrameMethod = nullptr;
+            __android_log_print(ANDROID_LOG_ERROR, FRAME_TAP_TAG, "HardwareBufferFrame API not available");
+            return;
+        }
+    }
+
+    _hardwareBufferCameraFrames = cameraFrames;
+    _hardwareBufferRenderedFrames = renderedFrames;
+    _hardwareBufferMaxFrames = std::max(maxFrames, 1);
+
+    // Buffers still held by consumers stay alive through their own references
+    if (!cameraFrames || (_cameraFramePool && _hardwareBufferMaxFrames != _cameraFramePool->getCapacity())) {
+        _cameraFramePool.reset();
+    }
+    if (!renderedFrames || (_renderedFramePool && _hardwareBufferMaxFrames != _renderedFramePool->getCapacity())) {
+        _renderedFramePool.reset();
+    }
+}
+
+void VROFrameTapListener::releaseHardwareBufferFrame(uint64_t frameId, int releaseFenceFd) {
+    if (_cameraFramePool && _cameraFramePool->releaseFrame(frameId, releaseFenceFd)) {
+        return;
+    }
+    if (_renderedFramePool && _renderedFramePool->releaseFrame(frameId, releaseFenceFd)) {
+        return;
+    }
+    // The frame's pool was recreated or destroyed
+    if (releaseFenceFd >= 0) {
+        close(releaseFenceFd);
+    }
+}
+
+bool VROFrameTapListener::preparePool(std::unique_ptr<VROHardwareBufferFramePool> &pool,
+                                      int width, int height,
+                                      VROHardwareBufferFrameSource source) {
+    if (width <= 0 || height <= 0) {
+        return false;
+    }
+    if (pool && pool->getWidth() == width && pool->getHeight() == height) {
+        return true;
+    }
+
+    pool.reset(new VROHardwareBufferFramePool(width, height, _hardwareBufferMaxFrames, source));
+    if (!pool->init()) {
+        __android_log_print(ANDROID_LOG_ERROR, FRAME_TAP_TAG,
+            "Failed to create hardware buffer frame pool, disabling hardware buffer frames");
+        pool.reset();
+        _hardwareBufferCameraFrames = false;
+        _hardwareBufferRenderedFrames = false;
+        return false;
+    }
+    return true;
+}
+
+void VROFrameTapListener::deliverHardwareBufferFrames(VRO_ENV env, jobject listenerRef,
+                                                      VROHardwareBufferFramePool *pool) {
+    std::vector<VROHardwareBufferFrameInfo> frames;
+    pool->collectFrames(&frames);
+
+    for (VROHardwareBufferFrameInfo &info : frames) {
+        jobject buffer = toHardwareBuffer(env, info.buffer);
+        jobject frameObject = nullptr;
+        if (buffer) {
+            frameObject = env->NewObject(_hardwareBufferFrameClass, _hardwareBufferFrameConstructor,
+                (jlong) info.frameId,
+                (jlong) (info.timestamp * 1e9),
+                buffer,
+                (jint) info.fenceFd,
+                (jint) info.width,
+                (jint) info.height,
+                (jint) info.source,
+                (jint) info.droppedFrames);
+        }
+        if (env->ExceptionCheck()) {
+            env->ExceptionDescribe();
+            env->ExceptionClear();
+            frameObject = nullptr;
+        }
+
+        // If the frame cannot be delivered, return it to the pool immediately
+        if (!frameObject) {
+            if (info.fenceFd >= 0) {
+                close(info.fenceFd);
+            }
+            pool->releaseFrame(info.frameId, -1);
+        } else {
+            // The Java frame owns the fence and must release the frame
+            env->CallVoidMethod(listenerRef, _onHardwareBufferFrameMethod, frameObject);
+            if (env->ExceptionCheck()) {
+                env->ExceptionDescribe();
+                env->ExceptionClear();
+                __android_log_print(ANDROID_LOG_ERROR, FRAME_TAP_TAG, "Exception in onHardwareBufferFrame callback");
+            }
+            VRO_DELETE_LOCAL_REF(frameObject);
+        }
+        if (buffer) {
+            VRO_DELETE_LOCAL_REF(buffer);
+        }
+    }
+}
+
 jobject VROFrameTapListener::createTextureInfo(VRO_ENV env,
                                                 VROARFrameARCore *frame,
                                                 VROARCameraARCore *camera,
@@ -309,40 +491,7 @@ jobject VROFrameTapListener::createCpuImage(VRO_ENV env,
     // Create RGBA buffer and convert YUV→RGBA
     int rgbaSize = width * height * 4;
     uint8_t *rgbaBuffer = new uint8_t[rgbaSize];
-
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            // Get Y value
-            int yValue = yData[y * yStride + x];
-
-            // Get U/V values (subsampled 2x2)
-            int uvY = y / 2;
-            int uvX = x / 2;
-            int uValue = uData[uvY * uvStride + uvX * uvPixelStride];
-            int vValue = vData[uvY * uvStride + uvX * uvPixelStride];
-
-            // YUV to RGB conversion
-            int C = yValue - 16;
-            int D = uValue - 128;
-            int E = vValue - 128;
-
-            int R = (298 * C + 409 * E + 128) >> 8;
-            int G = (298 * C - 100 * D - 208 * E + 128) >> 8;
-            int B = (298 * C + 516 * D + 128) >> 8;
-
-            // Clamp to [0, 255]
-            R = (R < 0) ? 0 : ((R > 255) ? 255 : R);
-            G = (G < 0) ? 0 : ((G > 255) ? 255 : G);
-            B = (B < 0) ? 0 : ((B > 255) ? 255 : B);
-
-            // Write RGBA pixel
-            int rgbaIdx = (y * width + x) * 4;
-            rgbaBuffer[rgbaIdx + 0] = R;
-            rgbaBuffer[rgbaIdx + 1] = G;
-            rgbaBuffer[rgbaIdx + 2] = B;
-            rgbaBuffer[rgbaIdx + 3] = 255; // Alpha
-        }
-    }
+    VROYuvImageConverter::convertImageRGBA(image, rgbaBuffer);
 
     // Create Java ByteBuffers (direct buffers for native memory)
     jobject yBuffer = env->NewDirectByteBuffer((void*)yData, yLength);
@@ -33,6 +33,7 @@
 #include VRO_C_INCLUDE
 #include "VROMatrix4f.h"
 #include "VROVector3f.h"
+#include "VROHardwareBufferFramePool.h"
 
 class VROARFrameARCore;
 class VROARCameraARCore;
@@ -65,6 +66,29 @@ public:
                        int cameraTextureId,
                        int displayRotation);
 
+    /**
+     * Dispatch the rendered frame to the Java listener as a hardware buffer, if rendered
+     * hardware buffer frames are enabled. This should be called from the render thread
+     * after the scene has rendered into the given framebuffer.
+     */
+    void dispatchRenderedFrame(VROARFrameARCore *frame,
+                               GLuint framebuffer,
+                               int width, int height);
+
+    /**
+     * Enable zero-copy delivery of camera and/or rendered frames as AHardwareBuffers.
+     * Frames come from a pool of at most maxFrames buffers per source; when the
+     * consumer holds all of them, frames are dropped and the drop count is reported
+     * with the next delivered frame. Requires Android O (API 26).
+     */
+    void setHardwareBufferFrames(bool cameraFrames, bool renderedFrames, int maxFrames);
+
+    /**
+     * Return a hardware buffer frame to its pool. The consumer's release fence (or -1)
+     * is owned by this listener from here on.
+     */
+    void releaseHardwareBufferFrame(uint64_t frameId, int releaseFenceFd);
+
     /**
      * Check if this listener is still valid (Java object not garbage collected).
      */
@@ -86,6 +110,16 @@ private:
     jmethodID _onCpuImageFrameMethod;
     jmethodID _executorExecuteMethod;
 
+    // Zero-copy hardware buffer frames
+    bool _hardwareBufferCameraFrames;
+    bool _hardwareBufferRenderedFrames;
+    int _hardwareBufferMaxFrames;
+    std::unique_ptr<VROHardwareBufferFramePool> _cameraFramePool;
+    std::unique_ptr<VROHardwareBufferFramePool> _renderedFramePool;
+    jclass _hardwareBufferFrameClass;
+    jmethodID _hardwareBufferFrameConstructor;
+    jmethodID _onHardwareBufferFrameMethod;
+
     /**
      * Create a Java TextureInfo object from ARCore frame data.
      */
@@ -103,6 +137,20 @@ private:
                            VROARCameraARCore *camera,
                            int displayRotation);
 
+    /**
+     * Ensure the given pool exists at the given size, recreating it if the size changed.
+     * Returns false if hardware buffer frames are unavailable.
+     */
+    bool preparePool(std::unique_ptr<VROHardwareBufferFramePool> &pool,
+                     int width, int height,
+                     VROHardwareBufferFrameSource source);
+
+    /**
+     * Deliver every frame the pool has ready to the Java listener.
+     */
+    void deliverHardwareBufferFrames(VRO_ENV env, jobject listenerRef,
+                                     VROHardwareBufferFramePool *pool);
+
     /**
      * Extract texture transform matrix from ARCore background texture coordinates.
      */
@@ -26,6 +26,7 @@
 
 #include <jni.h>
 #include <memory>
+#include <unistd.h>
 #include "VRORenderer_JNI.h"
 #include <PersistentRef.h>
 #include "VROSceneRendererARCore.h"
@@ -393,6 +394,40 @@ VRO_METHOD(void, nativeSetFrameTapListener) (VRO_ARGS
     }
 }
 
+VRO_METHOD(void, nativeSetFrameTapHardwareBuffers) (VRO_ARGS
+                                                    jlong nativeRenderer,
+                                                    jboolean cameraFrames,
+                                                    jboolean renderedFrames,
+                                                    jint maxFrames) {
+    std::shared_ptr<VROSceneRenderer> renderer = Renderer::native(nativeRenderer);
+    std::weak_ptr<VROSceneRendererARCore> arRenderer_w = std::dynamic_pointer_cast<VROSceneRendererARCore>(renderer);
+
+    VROPlatformDispatchAsyncRenderer([arRenderer_w, cameraFrames, renderedFrames, maxFrames] {
+        std::shared_ptr<VROSceneRendererARCore> arRenderer = arRenderer_w.lock();
+        if (arRenderer) {
+            arRenderer->setFrameTapHardwareBuffers(cameraFrames, renderedFrames, maxFrames);
+        }
+    });
+}
+
+VRO_METHOD(void, nativeReleaseFrameTapHardwareBuffer) (VRO_ARGS
+                                                       jlong nativeRenderer,
+                                                       jlong frameId,
+                                                       jint releaseFenceFd) {
+    std::shared_ptr<VROSceneRenderer> renderer = Renderer::native(nativeRenderer);
+    std::weak_ptr<VROSceneRendererARCore> arRenderer_w = std::dynamic_pointer_cast<VROSceneRendererARCore>(renderer);
+
+    // Frames may be released from any thread; the pools live on the rendering thread
+    VROPlatformDispatchAsyncRenderer([arRenderer_w, frameId, releaseFenceFd] {
+        std::shared_ptr<VROSceneRendererARCore> arRenderer = arRenderer_w.lock();
+        if (arRenderer) {
+            arRenderer->releaseFrameTapHardwareBuffer((uint64_t) frameId, releaseFenceFd);
+        } else if (releaseFenceFd >= 0) {
+            close(releaseFenceFd);
+        }
+    });
+}
+
 
 }
 
@@ -37,6 +37,8 @@
 #include "VROSceneRendererSceneView.h"
 #include "VROPlatformUtil.h"
 #include "VROSample.h"
+#include "VROSceneBenchmarkRunner.h"
+#include "VROAllocationTracker.h"
 #include "Node_JNI.h"
 #include "VROSceneController.h"
 #include "VRORenderer_JNI.h"
@@ -47,6 +49,7 @@
 #include "Camera_JNI.h"
 #include "VRORenderer.h"
 #include "VROChoreographer.h"
+#include "VROResidencyManager.h"
 #include "ViroUtils_JNI.h"
 
 #if VRO_PLATFORM_ANDROID
@@ -156,6 +159,53 @@ VRO_METHOD(void, nativeDestroyRenderer)(VRO_ARGS
     VROPlatformReleaseEnv();
 }
 
+VRO_METHOD(jboolean, nativeRunSceneBenchmark)(VRO_ARGS
+                                              jobject class_loader,
+                                              jobject android_context,
+                                              jobject asset_mgr,
+                                              jobject platform_util,
+                                              jint width,
+                                              jint height,
+                                              jint warmupFrames,
+                                              jint measuredFrames,
+                                              jstring outputPath) {
+    VROPlatformSetType(VROPlatformType::AndroidSceneView);
+
+    std::shared_ptr<gvr::AudioApi> gvrAudio = std::make_shared<gvr::AudioApi>();
+    gvrAudio->Init(env, android_context, class_loader, GVR_AUDIO_RENDERING_BINAURAL_HIGH_QUALITY);
+    VROPlatformSetEnv(env, android_context, asset_mgr, platform_util);
+
+    // Runs to completion on the calling thread, which becomes the renderer thread
+    bool success = VROSceneBenchmarkRunner::run(gvrAudio, width, height, warmupFrames, measuredFrames,
+                                                VRO_STRING_STL(outputPath));
+    VROPlatformReleaseEnv();
+    return success;
+}
+
+VRO_METHOD(jboolean, nativeRunFrameReplay)(VRO_ARGS
+                                           jobject class_loader,
+                                           jobject android_context,
+                                           jobject asset_mgr,
+                                           jobject platform_util,
+                                           jstring captureDirectory,
+                                           jint warmupFrames,
+                                           jint repetitions,
+                                           jstring outputPath,
+                                           jstring tracePath) {
+    VROPlatformSetType(VROPlatformType::AndroidSceneView);
+
+    std::shared_ptr<gvr::AudioApi> gvrAudio = std::make_shared<gvr::AudioApi>();
+    gvrAudio->Init(env, android_context, class_loader, GVR_AUDIO_RENDERING_BINAURAL_HIGH_QUALITY);
+    VROPlatformSetEnv(env, android_context, asset_mgr, platform_util);
+
+    // Runs to completion on the calling thread, which becomes the renderer thread
+    bool success = VROSceneBenchmarkRunner::runReplay(gvrAudio, VRO_STRING_STL(captureDirectory),
+                                                      warmupFrames, repetitions, VRO_STRING_STL(outputPath),
+                                                      VRO_STRING_STL(tracePath));
+    VROPlatformReleaseEnv();
+    return success;
+}
+
 VRO_METHOD(void, nativeInitializeGL)(VRO_ARGS
                                      jlong native_renderer,
                                      jboolean sRGBFramebuffer,
@@ -260,6 +310,18 @@ VRO_METHOD(void, nativeSetVRModeEnabled)(VRO_ARGS
     });
 }
 
+VRO_METHOD(void, nativeSetTargetFrameRate)(VRO_ARGS
+                                           jlong nativeRenderer, VRO_INT fps) {
+    std::weak_ptr<VROSceneRenderer> renderer_w = Renderer::native(nativeRenderer);
+    VROPlatformDispatchAsyncRenderer([renderer_w, fps] {
+        std::shared_ptr<VROSceneRenderer> renderer = renderer_w.lock();
+        if (!renderer) {
+            return;
+        }
+        renderer->setTargetFrameRate(fps);
+    });
+}
+
 VRO_METHOD(void, nativeOnStart)(VRO_ARGS
                                 jlong native_renderer) {
         Renderer::native(native_renderer)->onStart();
@@ -280,6 +342,28 @@ VRO_METHOD(void, nativeOnStop)(VRO_ARGS
         Renderer::native(native_renderer)->onStop();
 }
 
+VRO_METHOD(void, nativeOnTrimMemory)(VRO_ARGS
+                                     jlong native_renderer, VRO_INT level) {
+    // Map ComponentCallbacks2 trim levels: RUNNING_CRITICAL (15) and above,
+    // which include the UI being hidden, evict everything not on screen
+    VROMemoryPressure pressure = VROMemoryPressure::Low;
+    if (level >= 15) {
+        pressure = VROMemoryPressure::Critical;
+    }
+    else if (level >= 10) {
+        pressure = VROMemoryPressure::Moderate;
+    }
+
+    std::weak_ptr<VROSceneRenderer> renderer_w = Renderer::native(native_renderer);
+    VROPlatformDispatchAsyncRenderer([renderer_w, pressure] {
+        std::shared_ptr<VROSceneRenderer> renderer = renderer_w.lock();
+        if (!renderer) {
+            return;
+        }
+        renderer->getDriver()->onMemoryPressure(pressure);
+    });
+}
+
 VRO_METHOD(void, nativeSetSceneController)(VRO_ARGS
                                            jlong native_renderer,
                                            jlong native_scene_controller_ref) {
@@ -377,12 +461,120 @@ VRO_METHOD(VRO_STRING, nativeGetHeadset)(VRO_ARGS
     return VRO_NEW_STRING(headset.c_str());
 }
 
+VRO_METHOD(VRO_STRING, nativeGetMemoryStats)(VRO_ARGS
+                                             jlong nativeRenderer) {
+    std::string stats = VROAllocationTracker::toJSON();
+    return VRO_NEW_STRING(stats.c_str());
+}
+
+/*
+ Returns the manifest of shader capabilities built so far, for the app to ship
+ and pass to nativePrewarmShaders on later launches.
+ */
+VRO_METHOD(VRO_STRING, nativeGetShaderManifest)(VRO_ARGS
+                                                jlong native_renderer) {
+    std::shared_ptr<VROSceneRenderer> renderer = Renderer::native(native_renderer);
+    std::string manifest = renderer->getDriver()->getShaderManifest();
+    return VRO_NEW_STRING(manifest.c_str());
+}
+
+VRO_METHOD(void, nativePrewarmShaders)(VRO_ARGS
+                                       jlong native_renderer,
+                                       VRO_STRING manifest_j) {
+    std::weak_ptr<VROSceneRenderer> sceneRenderer_w = Renderer::native(native_renderer);
+    std::string manifest = VRO_STRING_STL(manifest_j);
+
+    VROPlatformDispatchAsyncRenderer([sceneRenderer_w, manifest] {
+        std::shared_ptr<VROSceneRenderer> sceneRenderer = sceneRenderer_w.lock();
+        if (!sceneRenderer) {
+            return;
+        }
+        sceneRenderer->getDriver()->prewarmShaders(manifest);
+    });
+}
+
+VRO_METHOD(void, nativeSetRenderStatisticsEnabled)(VRO_ARGS
+                                                   jlong native_renderer,
+                                                   jboolean enabled,
+                                                   VRO_INT gpuSampleInterval) {
+    std::shared_ptr<VROSceneRenderer> renderer = Renderer::native(native_renderer);
+    renderer->getRenderer()->setRenderStatisticsEnabled(enabled, gpuSampleInterval);
+}
+
+VRO_METHOD(void, nativeResetRenderStatistics)(VRO_ARGS
+                                              jlong native_renderer) {
+    std::shared_ptr<VROSceneRenderer> renderer = Renderer::native(native_renderer);
+    renderer->getRenderer()->resetRenderStatistics();
+}
+
+/*
+ Returns the n most expensive nodes and materials as JSON, ranked by draw calls
+ (0), triangles (1), or GPU time (2).
+ */
+VRO_METHOD(VRO_STRING, nativeGetRenderStatistics)(VRO_ARGS
+                                                  jlong native_renderer,
+                                                  VRO_INT n,
+                                                  VRO_INT sortBy) {
+    std::shared_ptr<VROSceneRenderer> renderer = Renderer::native(native_renderer);
+    VRORenderStatisticsSort sort = VRORenderStatisticsSort::DrawCalls;
+    if (sortBy == 1) {
+        sort = VRORenderStatisticsSort::Triangles;
+    }
+    else if (sortBy == 2) {
+        sort = VRORenderStatisticsSort::GPUTime;
+    }
+    std::string stats = renderer->getRenderer()->getRenderStatisticsJSON(n, sort);
+    return VRO_NEW_STRING(stats.c_str());
+}
+
+VRO_METHOD(void, nativeSetFrameTelemetryEnabled)(VRO_ARGS
+                                                 jlong native_renderer,
+                                                 jboolean enabled,
+                                                 VRO_FLOAT refreshRate,
+                                                 VRO_DOUBLE jankThreshold) {
+    std::shared_ptr<VROSceneRenderer> renderer = Renderer::native(native_renderer);
+    renderer->getRenderer()->setFrameTelemetryEnabled(enabled, refreshRate, jankThreshold);
+}
+
+VRO_METHOD(void, nativeResetFrameTelemetry)(VRO_ARGS
+                                            jlong native_renderer) {
+    std::shared_ptr<VROSceneRenderer> renderer = Renderer::native(native_renderer);
+    renderer->getRenderer()->resetFrameTelemetry();
+}
+
+/*
+ Returns the frame telemetry as JSON (see VROFrameTelemetry). If reset is
+ true the telemetry is cleared with the same call, so polls lose no frames.
+ */
+VRO_METHOD(VRO_STRING, nativeGetFrameTelemetry)(VRO_ARGS
+                                                jlong native_renderer,
+                                                jboolean reset) {
+    std::shared_ptr<VROSceneRenderer> renderer = Renderer::native(native_renderer);
+    std::string telemetry = renderer->getRenderer()->getFrameTelemetryJSON(reset);
+    return VRO_NEW_STRING(telemetry.c_str());
+}
+
 VRO_METHOD(VRO_STRING, nativeGetController)(VRO_ARGS
                                             jlong nativeRenderer) {
     std::string controller = Renderer::native(nativeRenderer)->getRenderer()->getInputController()->getController();
     return VRO_NEW_STRING(controller.c_str());
 }
 
+VRO_METHOD(void, nativeCaptureFrames)(VRO_ARGS
+                                      jlong native_renderer,
+                                      jstring directory,
+                                      jint frameCount) {
+    std::weak_ptr<VROSceneRenderer> renderer_w = Renderer::native(native_renderer);
+    std::string directory_s = VRO_STRING_STL(directory);
+    VROPlatformDispatchAsyncRenderer([renderer_w, directory_s, frameCount] {
+        std::shared_ptr<VROSceneRenderer> renderer = renderer_w.lock();
+        if (!renderer) {
+            return;
+        }
+        renderer->getRenderer()->captureFrames(directory_s, frameCount);
+    });
+}
+
 VRO_METHOD(void, nativeSetDebugHUDEnabled)(VRO_ARGS
                                            jlong native_renderer,
                                            jboolean enabled) {
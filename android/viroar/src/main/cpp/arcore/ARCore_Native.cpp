@@ -90,6 +90,19 @@ namespace arcore {
         }
     }
 
+    bool AugmentedImageDatabaseNative::serialize(std::vector<uint8_t> *outData) {
+        uint8_t *bytes = nullptr;
+        int64_t size = 0;
+        ArAugmentedImageDatabase_serialize(_session, _database, &bytes, &size);
+        if (bytes == nullptr) {
+            return false;
+        }
+
+        outData->assign(bytes, bytes + size);
+        ArByteArray_release(bytes);
+        return true;
+    }
+
 #pragma mark - Pose
 
     PoseNative::~PoseNative() {
@@ -436,6 +449,10 @@ namespace arcore {
         ArLightEstimate_getColorCorrection(_session, _lightEstimate, outCorrection);
     }
 
+    void LightEstimateNative::getEnvironmentalHDRAmbientSphericalHarmonics(float *outCoefficients27) {
+        ArLightEstimate_getEnvironmentalHdrAmbientSphericalHarmonics(_session, _lightEstimate, outCoefficients27);
+    }
+
     bool LightEstimateNative::isValid() {
         ArLightEstimateState state;
         ArLightEstimate_getState(_session, _lightEstimate, &state);
@@ -854,6 +871,10 @@ namespace arcore {
                 arLightingMode = AR_LIGHT_ESTIMATION_MODE_AMBIENT_INTENSITY;
                 break;
             }
+            case LightingMode::EnvironmentalHDR: {
+                arLightingMode = AR_LIGHT_ESTIMATION_MODE_ENVIRONMENTAL_HDR;
+                break;
+            }
         }
         ArConfig_setLightEstimationMode(_session, config, arLightingMode);
 
@@ -923,12 +944,13 @@ namespace arcore {
     }
 
     AugmentedImageDatabase *SessionNative::createAugmentedImageDatabase(uint8_t* raw_buffer, int64_t size) {
-        ArAugmentedImageDatabase *database;
+        ArAugmentedImageDatabase *database = nullptr;
 
         ArStatus status = ArAugmentedImageDatabase_deserialize(_session, raw_buffer, size, &database);
 
         if (status != AR_SUCCESS) {
             pinfo("[Viro] Failed to load AugmentedImageDatabase, error: %d", status);
+            return nullptr;
         }
 
         return new AugmentedImageDatabaseNative(database, _session);
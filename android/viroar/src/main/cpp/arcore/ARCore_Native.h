@@ -32,6 +32,7 @@ namespace arcore {
                                                                       int32_t image_width_in_pixels, int32_t image_height_in_pixels,
                                                                       int32_t image_stride_in_pixels, float image_width_in_meters,
                                                                       int32_t *out_index);
+        virtual bool serialize(std::vector<uint8_t> *outData);
         ArAugmentedImageDatabase *_database;
         ArSession *_session;
     };
@@ -137,6 +138,7 @@ namespace arcore {
         virtual ~LightEstimateNative();
         virtual float getPixelIntensity();
         virtual void getColorCorrection(float *outColorCorrection);
+        virtual void getEnvironmentalHDRAmbientSphericalHarmonics(float *outCoefficients27);
         virtual bool isValid();
 
         ArLightEstimate *_lightEstimate;
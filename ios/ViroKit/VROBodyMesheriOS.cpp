@@ -166,6 +166,7 @@ std::vector<std::pair<VROVector3f, float>> VROBodyMesheriOS::processVisionOutput
         std::vector<std::shared_ptr<VROGeometrySource>> sources = { vertexSource };
         std::vector<std::shared_ptr<VROGeometryElement>> elements = { buildMeshFaces() };
         _bodyMesh = std::make_shared<VROGeometry>(sources, elements);
+        _bodyMesh->setDynamic(true);
         
         std::shared_ptr<VROMaterial> material = std::make_shared<VROMaterial>();
         material->getDiffuse().setColor({ 1.0, 0.0, 0.0, 1.0 });
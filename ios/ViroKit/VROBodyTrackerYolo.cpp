@@ -27,7 +27,6 @@
 #include "VROBodyTrackerYolo.h"
 #include "VROLog.h"
 #include "VROTime.h"
-#include "VROARFrameiOS.h"
 #import "VRODriverOpenGLiOS.h"
 
 std::map<std::string, VROBodyJointType> VROBodyTrackerYolo::_labelsToJointTypes = {
@@ -51,8 +50,7 @@ std::map<std::string, VROBodyJointType> VROBodyTrackerYolo::_labelsToJointTypes
 };
 
 VROBodyTrackerYolo::VROBodyTrackerYolo() {
-    _currentImage = nil;
-    _visionQueue = dispatch_queue_create("com.viro.bodyTrackerYoloVisionQueue", DISPATCH_QUEUE_SERIAL);
+    
 }
 
 bool VROBodyTrackerYolo::initBodyTracking(VROCameraPosition position,
@@ -79,26 +77,16 @@ void VROBodyTrackerYolo::stopBodyTracking() {
 }
 
 void VROBodyTrackerYolo::update(const VROARFrame *frame) {
-    const VROARFrameiOS *frameiOS = dynamic_cast<const VROARFrameiOS *>(frame);
-    
-    CVPixelBufferRef cameraImage = frameiOS->getImage();
-    VROMatrix4f transform = frameiOS->getViewportToCameraImageTransform().invert();
-    VROCameraOrientation orientation = frameiOS->getOrientation();
-
-    // Only process one image at a time
-    if (_currentImage != nil) {
-        return;
-    }
-    _currentImage = cameraImage;
-    
-    dispatch_async(_visionQueue, ^{
-        trackCurrentImage(transform, orientation);
-    });
+    // The scheduler runs the latest frame once the model is free, dropping any frame
+    // that was waiting
+    std::shared_ptr<VROBodyTrackerYolo> job = std::dynamic_pointer_cast<VROBodyTrackerYolo>(shared_from_this());
+    VROVisionScheduler::getSharedScheduler()->submit(job, frame);
 }
 
-// Invoked on the _visionQueue
-void VROBodyTrackerYolo::trackCurrentImage(VROMatrix4f transform, VROCameraOrientation orientation) {
-    NSDictionary *visionOptions = [NSDictionary dictionary];
+// Invoked on the scheduler's queue
+VROVisionPreprocess VROBodyTrackerYolo::prepareFrame(const VROVisionFrame &frame) {
+    VROMatrix4f transform = frame.viewportToImage.invert();
+    VROCameraOrientation orientation = frame.orientation;
     
     // The logic below derives the _transform matrix, which is used to convert *rotated* image
     // coordinates to viewport coordinates. This matrix is derived from the scale and translation
@@ -121,15 +109,7 @@ void VROBodyTrackerYolo::trackCurrentImage(VROMatrix4f transform, VROCameraOrien
         // iOS always rotates the image right-side up before inputting into a CoreML model for
         // a vision request. We ensure it rotates correctly by specifying the orientation of the
         // image with respect to the device.
-        CGImagePropertyOrientation orientation = kCGImagePropertyOrientationRight;
-        
-        // By wrapping the CVPixelBuffer in a CIImage, iOS will automatically convert from
-        // YCbCr to RGB (note: this is undocumented, but works).
-        CIImage *ciImage = [[CIImage alloc] initWithCVPixelBuffer:_currentImage];
-        VNImageRequestHandler *handler = [[VNImageRequestHandler alloc] initWithCIImage:ciImage
-                                                                            orientation:orientation
-                                                                                options:visionOptions];
-        [handler performRequests:@[_visionRequest] error:nil];
+        return VROVisionPreprocess(kCGImagePropertyOrientationRight);
     }
     else if (orientation == VROCameraOrientation::LandscapeLeft) {
         // Remove rotation from the transformation matrix
@@ -139,26 +119,17 @@ void VROBodyTrackerYolo::trackCurrentImage(VROMatrix4f transform, VROCameraOrien
         _transform[5] = scale.y;
         _transform[12] = (1 - scale.x) / 2.0;
         _transform[13] = (1 - scale.y) / 2.0;
-        
-        CGImagePropertyOrientation orientation = kCGImagePropertyOrientationDown;
-        CIImage *ciImage = [[CIImage alloc] initWithCVPixelBuffer:_currentImage];
-        VNImageRequestHandler *handler = [[VNImageRequestHandler alloc] initWithCIImage:ciImage
-                                                                            orientation:orientation
-                                                                                options:visionOptions];
-        [handler performRequests:@[_visionRequest] error:nil];
+        return VROVisionPreprocess(kCGImagePropertyOrientationDown);
     }
     else if (orientation == VROCameraOrientation::LandscapeRight) {
         // In landscape right, the camera image is already right-side up, and ready for the ML
         // algorithm.
         _transform = transform;
-        
-        CIImage *ciImage = [[CIImage alloc] initWithCVPixelBuffer:_currentImage];
-        VNImageRequestHandler *handler = [[VNImageRequestHandler alloc] initWithCIImage:ciImage options:visionOptions];
-        [handler performRequests:@[_visionRequest] error:nil];
     }
+    return VROVisionPreprocess(kCGImagePropertyOrientationUp);
 }
 
-// Invoked on the _visionQueue
+// Invoked on the scheduler's queue
 void VROBodyTrackerYolo::processVisionResults(VNRequest *request, NSError *error) {
     NSArray *array = [request results];
     NSLog(@"Number of results %d", (int) array.count);
@@ -198,5 +169,4 @@ void VROBodyTrackerYolo::processVisionResults(VNRequest *request, NSError *error
             delegate->onBodyJointsFound(joints);
         }
     });
-    _currentImage = nil;
 }
@@ -35,10 +35,11 @@
 #import <CoreML/CoreML.h>
 #import <Vision/Vision.h>
 #include "VROMatrix4f.h"
+#include "VROVisionScheduler.h"
 
 class VRODriver;
 
-class API_AVAILABLE(ios(11.0)) VROBodyTrackerYolo : public VROBodyTracker {
+class API_AVAILABLE(ios(11.0)) VROBodyTrackerYolo : public VROBodyTracker, public VROVisionJob {
     
 public:
     
@@ -51,6 +52,14 @@ public:
     
     void update(const VROARFrame *frame);
     
+    /*
+     VROVisionJob implementation. Invoked on the scheduler's queue.
+     */
+    VROVisionPreprocess prepareFrame(const VROVisionFrame &frame);
+    VNRequest *getVisionRequest() {
+        return _visionRequest;
+    }
+    
 private:
     
     static std::map<std::string, VROBodyJointType> _labelsToJointTypes;
@@ -59,11 +68,8 @@ private:
     VNCoreMLModel *_coreMLModel;
     VNCoreMLRequest *_visionRequest;
     
-    dispatch_queue_t _visionQueue;
     VROMatrix4f _transform;
-    CVPixelBufferRef _currentImage;
     
-    void trackCurrentImage(VROMatrix4f transform, VROCameraOrientation orientation);
     void processVisionResults(VNRequest *request, NSError *error);
     
 };
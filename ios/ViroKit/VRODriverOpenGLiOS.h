@@ -29,6 +29,7 @@
 
 #include "VRODriverOpenGL.h"
 #include "VROSoundGVR.h"
+#include "VROSoundVoiceManager.h"
 #include "VROAudioPlayeriOS.h"
 #include "VROVideoTextureCacheOpenGL.h"
 #include "VROTypefaceiOS.h"
@@ -68,12 +69,14 @@ public:
         if (!_gvrAudio) {
             _gvrAudio = std::make_shared<gvr::AudioApi>();
             _gvrAudio->Init(GVR_AUDIO_RENDERING_BINAURAL_HIGH_QUALITY);
+            _voiceManager = std::make_shared<VROSoundVoiceManager>();
         }
         return _gvrAudio;
     }
     
     void willRenderFrame(const VRORenderContext &context) {
         if (_gvrAudio) {
+            _voiceManager->updateVoices(context.getCamera().getPosition());
             _gvrAudio->SetHeadPose(VROGVRUtil::toGVRMat4f(context.getCamera().getLookAtMatrix()));
             _gvrAudio->Update();
         }
@@ -116,13 +119,13 @@ public:
 
     std::shared_ptr<VROSound> newSound(std::string resource, VROResourceType resourceType, VROSoundType type) {
         std::shared_ptr<gvr::AudioApi> gvrAudio = activateGVRAudio();
-        std::shared_ptr<VROSound> sound = VROSoundGVR::create(resource, resourceType, gvrAudio, type);
+        std::shared_ptr<VROSound> sound = VROSoundGVR::create(resource, resourceType, gvrAudio, type, _voiceManager);
         return sound;
     }
 
     std::shared_ptr<VROSound> newSound(std::shared_ptr<VROSoundData> data, VROSoundType type) {
         std::shared_ptr<gvr::AudioApi> gvrAudio = activateGVRAudio();
-        std::shared_ptr<VROSound> sound = VROSoundGVR::create(data, gvrAudio, type);
+        std::shared_ptr<VROSound> sound = VROSoundGVR::create(data, gvrAudio, type, _voiceManager);
         return sound;
     }
 
@@ -148,6 +151,7 @@ protected:
     
     __weak GLKView *_viewGL;
     std::shared_ptr<gvr::AudioApi> _gvrAudio;
+    std::shared_ptr<VROSoundVoiceManager> _voiceManager;
     EAGLContext *_eaglContext;
     std::map<std::string, std::weak_ptr<VROTypeface>> _typefaces;
     FT_Library _ft;
@@ -35,10 +35,11 @@
 #import <CoreML/CoreML.h>
 #import <Vision/Vision.h>
 #include "VROMatrix4f.h"
+#include "VROVisionScheduler.h"
 
 class VRODriver;
 
-class VROObjectRecognizeriOS : public VROObjectRecognizer {
+class VROObjectRecognizeriOS : public VROObjectRecognizer, public VROVisionJob {
     
 public:
     
@@ -51,17 +52,22 @@ public:
 
     void update(const VROARFrame *frame);
     
+    /*
+     VROVisionJob implementation. Invoked on the scheduler's queue.
+     */
+    VROVisionPreprocess prepareFrame(const VROVisionFrame &frame);
+    VNRequest *getVisionRequest() {
+        return _visionRequest;
+    }
+    
 private:
     
     MLModel *_model;
     VNCoreMLModel *_coreMLModel;
     VNCoreMLRequest *_visionRequest;
     
-    dispatch_queue_t _visionQueue;
     VROMatrix4f _transform;
-    CVPixelBufferRef _currentImage;
     
-    void trackCurrentImage(VROMatrix4f transform, VROCameraOrientation orientation);
     void processVisionResults(VNRequest *request, NSError *error);
     
 };
@@ -166,6 +166,8 @@ std::shared_ptr<VROGlyph> VROTypefaceiOS::loadGlyph(uint32_t charCode, uint32_t
             glyph->loadOutlineBitmap(driver->getFreetype(), _face, charCode, variantSelector, outlineWidth,
                                      &_outlineAtlases[outlineWidth], driver);
         }
+    } else if (renderMode == VROGlyphRenderMode::DistanceField) {
+        loadDistanceFieldGlyph(glyph, _face, charCode, variantSelector, driver);
     } else {
         glyph->loadVector(_face, charCode, variantSelector);
     }
@@ -173,10 +175,6 @@ std::shared_ptr<VROGlyph> VROTypefaceiOS::loadGlyph(uint32_t charCode, uint32_t
     return glyph;
 }
 
-float VROTypefaceiOS::getLineHeight() const {
-    return _face->size->metrics.height >> 6;
-}
-
 static uint32_t CalcTableCheckSum(const uint32_t *table, uint32_t numberOfBytesInTable) {
     uint32_t sum = 0;
     uint32_t nLongs = (numberOfBytesInTable + 3) / 4;
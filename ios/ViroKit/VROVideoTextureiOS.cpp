@@ -45,7 +45,8 @@ VROVideoTextureiOS::VROVideoTextureiOS(VROStereoMode stereoMode,
                                        bool enableCMSampleBuffer) :
     VROVideoTexture(VROTextureType::Texture2D, stereoMode),
     _paused(true),
-    _isCMSampleBuffered(enableCMSampleBuffer) {
+    _isCMSampleBuffered(enableCMSampleBuffer),
+    _contentFrameRate(0) {
     ALLOCATION_TRACKER_ADD(VideoTextures, 1);
 }
 
@@ -187,11 +188,13 @@ void VROVideoTextureiOS::initVideoDimensions() {
     NSArray<AVAssetTrack *> * audioTracks = [_player.currentItem.asset
                                         tracksWithMediaType:AVMediaTypeAudio];
     if (tracks.count == 0) {
+        _contentFrameRate = 0;
         return;
     }
 
     // Step 1: Create our mainComposition containing the original video feed.
     AVAssetTrack *videoTrack = [tracks firstObject];
+    _contentFrameRate = videoTrack.nominalFrameRate;
     CMTime trackDuration = [[videoTrack asset] duration];
     CMTime insertionPoint = kCMTimeZero;
     NSError *error = nil;
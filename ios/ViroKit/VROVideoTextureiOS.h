@@ -89,6 +89,9 @@ public:
     void pause();
     void play();
     bool isPaused();
+    float getContentFrameRate() {
+        return _contentFrameRate;
+    }
     
     void seekToTime(float seconds);
     float getCurrentTimeInSeconds();
@@ -137,6 +140,11 @@ private:
     bool _paused;
     bool _loop;
     bool _isCMSampleBuffered;
+
+    /*
+     The nominal frame rate of the current video's track, or 0 if unknown.
+     */
+    float _contentFrameRate;
     VROAVPlayerDelegate *_avPlayerDelegate;
     VROVideoNotificationListener *_videoNotificationListener;
 
@@ -90,6 +90,19 @@ enum class VROTimingFunctionType;
 - (NSString *)getHeadset;
 - (NSString *)getController;
 
+/*
+ Returns the renderer's memory counters and high-water marks as a JSON
+ string (see VROAllocationTracker).
+ */
+- (NSString *)getMemoryStats;
+
+/*
+ Enable frame telemetry (see VRORenderer::setFrameTelemetryEnabled), and
+ return it as a JSON string, clearing it with the same call if reset is YES.
+ */
+- (void)setFrameTelemetryEnabled:(BOOL)enabled refreshRate:(float)refreshRate jankThreshold:(double)jankThreshold;
+- (NSString *)getFrameTelemetry:(BOOL)reset;
+
 /*
  Calling setVrMode allows switching to and from VR mode.
  When set to NO, it transitions back to pre-VR (mono) mode.
@@ -52,6 +52,9 @@
 
 static VROVector3f const kZeroVector = VROVector3f();
 
+// ARKit delivers camera frames at this rate; in AR the display never drops below it
+static const float kARCameraFramesPerSecond = 60;
+
 @interface VROViewAR () {
     std::shared_ptr<VRORenderer> _renderer;
     std::shared_ptr<VROARSceneController> _sceneController;
@@ -64,6 +67,7 @@ static VROVector3f const kZeroVector = VROVector3f();
     VROViewport _viewport;
     
     CADisplayLink *_displayLink;
+    VROFrameRateRange _frameRateRange;
     int _frame;
     VROWorldAlignment _worldAlignment;
 }
@@ -210,6 +214,10 @@ static VROVector3f const kZeroVector = VROVector3f();
                                              selector:@selector(applicationDidBecomeActive:)
                                                  name:UIApplicationDidBecomeActiveNotification
                                                object:nil];
+    [[NSNotificationCenter defaultCenter] addObserver:self
+                                             selector:@selector(applicationDidReceiveMemoryWarning:)
+                                                 name:UIApplicationDidReceiveMemoryWarningNotification
+                                               object:nil];
     
     /*
      Create Viro renderer objects.
@@ -291,6 +299,7 @@ static VROVector3f const kZeroVector = VROVector3f();
 }
 
 - (void)handleRotate:(UIRotationGestureRecognizer *)recognizer {
+    _renderer->notifyUserInteraction();
     // locationInView was `recognizer.self` but if view is created after app initialization, then it location x and y is 0
     CGPoint location = [recognizer locationInView:nil];
     VROVector3f viewportTouchPos = VROVector3f(location.x * self.contentScaleFactor, location.y * self.contentScaleFactor);
@@ -306,6 +315,7 @@ static VROVector3f const kZeroVector = VROVector3f();
 }
 
 - (void)handlePinch:(UIPinchGestureRecognizer *)recognizer {
+    _renderer->notifyUserInteraction();
     // locationInView was `recognizer.self` but if view is created after app initialization, then it location x and y is 0
     CGPoint location = [recognizer locationInView:nil];
     VROVector3f viewportTouchPos = VROVector3f(location.x * self.contentScaleFactor, location.y * self.contentScaleFactor);
@@ -320,6 +330,7 @@ static VROVector3f const kZeroVector = VROVector3f();
 }
 
 - (void)handleLongPress:(UIPanGestureRecognizer *)recognizer {
+    _renderer->notifyUserInteraction();
     // locationInView was `recognizer.self` but if view is created after app initialization, then it location x and y is 0
     CGPoint location = [recognizer locationInView:nil];
     
@@ -335,6 +346,7 @@ static VROVector3f const kZeroVector = VROVector3f();
 }
 
 - (void)handleTap:(UITapGestureRecognizer *)recognizer {
+    _renderer->notifyUserInteraction();
     // locationInView was `recognizer.self` but if view is created after app initialization, then it location x and y is 0
     CGPoint location = [recognizer locationInView:nil];
     
@@ -486,6 +498,11 @@ static VROVector3f const kZeroVector = VROVector3f();
     _arSession->run(); 
 }
 
+- (void)applicationDidReceiveMemoryWarning:(NSNotification *)notification {
+    // Memory warnings are delivered on the main thread, which is also the rendering thread
+    _driver->onMemoryPressure(VROMemoryPressure::Critical);
+}
+
 - (void)setRenderDelegate:(id<VRORenderDelegate>)renderDelegate {
     _renderDelegateWrapper = std::make_shared<VRORenderDelegateiOS>(renderDelegate);
     _renderer->setDelegate(_renderDelegateWrapper);
@@ -515,6 +532,18 @@ static VROVector3f const kZeroVector = VROVector3f();
     return [NSString stringWithUTF8String:_inputController->getController().c_str()];
 }
 
+- (NSString *)getMemoryStats {
+    return [NSString stringWithUTF8String:VROAllocationTracker::toJSON().c_str()];
+}
+
+- (void)setFrameTelemetryEnabled:(BOOL)enabled refreshRate:(float)refreshRate jankThreshold:(double)jankThreshold {
+    _renderer->setFrameTelemetryEnabled(enabled, refreshRate, jankThreshold);
+}
+
+- (NSString *)getFrameTelemetry:(BOOL)reset {
+    return [NSString stringWithUTF8String:_renderer->getFrameTelemetryJSON(reset).c_str()];
+}
+
 - (void)setDebugDrawDelegate:(NSObject<VRODebugDrawDelegate> *)debugDrawDelegate {
     self.glassView = [[VROGlassView alloc] initWithFrame:self.bounds delegate:debugDrawDelegate];
     [self addSubview:self.glassView];
@@ -576,6 +605,7 @@ static VROVector3f const kZeroVector = VROVector3f();
     @autoreleasepool {
         [self renderFrame];
     }
+    [self updateFrameRate];
 
     if (_glassView) {
         [_glassView setNeedsDisplay];
@@ -585,6 +615,27 @@ static VROVector3f const kZeroVector = VROVector3f();
     ALLOCATION_TRACKER_PRINT();
 }
 
+/*
+ On adaptive refresh rate displays, follow the refresh rate range the renderer
+ prefers for what is on screen.
+ */
+- (void)updateFrameRate {
+    if (!_renderer->isAdaptiveFrameRateEnabled()) {
+        return;
+    }
+    float maximumRate = (float) [UIScreen mainScreen].maximumFramesPerSecond;
+    VROFrameRateRange range = _renderer->getPreferredFrameRateRange(kARCameraFramesPerSecond, maximumRate, _driver);
+    if (range == _frameRateRange) {
+        return;
+    }
+    _frameRateRange = range;
+    if (@available(iOS 15.0, *)) {
+        _displayLink.preferredFrameRateRange = CAFrameRateRangeMake(range.minimum, range.maximum, range.preferred);
+    } else {
+        _displayLink.preferredFramesPerSecond = (NSInteger) range.preferred;
+    }
+}
+
 - (void)renderFrame {
     if (!_arSession) {
         return;
@@ -834,7 +834,7 @@ void VROViewRecorderRTTDelegate::didRenderFrame(std::shared_ptr<VRORenderTarget>
     }
 
     // Flip/render the image to the RTT target
-    driver->bindRenderTarget(_renderToTextureTarget, VRORenderTargetUnbindOp::Invalidate);
+    driver->bindRenderTarget(_renderToTextureTarget, VRORenderTargetActions::clearAll(), VRORenderTargetUnbindOp::Invalidate);
     target->blitColor(_renderToTextureTarget, true, driver);
     [recorder lockPixelBuffer];
 }
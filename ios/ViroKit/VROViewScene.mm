@@ -49,6 +49,7 @@ static VROVector3f const kZeroVector = VROVector3f();
     std::shared_ptr<VROInputControllerAR> _inputController;
     
     CADisplayLink *_displayLink;
+    VROFrameRateRange _frameRateRange;
     int _frame;
 }
 
@@ -135,6 +136,10 @@ static VROVector3f const kZeroVector = VROVector3f();
                                              selector:@selector(applicationDidBecomeActive:)
                                                  name:UIApplicationDidBecomeActiveNotification
                                                object:nil];
+    [[NSNotificationCenter defaultCenter] addObserver:self
+                                             selector:@selector(applicationDidReceiveMemoryWarning:)
+                                                 name:UIApplicationDidReceiveMemoryWarningNotification
+                                               object:nil];
     
     /*
      Create Viro renderer objects.
@@ -201,6 +206,7 @@ static VROVector3f const kZeroVector = VROVector3f();
 }
 
 - (void)handleRotate:(UIRotationGestureRecognizer *)recognizer {
+    _renderer->notifyUserInteraction();
     CGPoint location = [recognizer locationInView:recognizer.view];
     VROVector3f viewportTouchPos = VROVector3f(location.x * self.contentScaleFactor, location.y * self.contentScaleFactor);
     
@@ -215,6 +221,7 @@ static VROVector3f const kZeroVector = VROVector3f();
 }
 
 - (void)handlePinch:(UIPinchGestureRecognizer *)recognizer {
+    _renderer->notifyUserInteraction();
     CGPoint location = [recognizer locationInView:recognizer.view];
     VROVector3f viewportTouchPos = VROVector3f(location.x * self.contentScaleFactor, location.y * self.contentScaleFactor);
   
@@ -228,6 +235,7 @@ static VROVector3f const kZeroVector = VROVector3f();
 }
 
 - (void)handleLongPress:(UIPanGestureRecognizer *)recognizer {
+    _renderer->notifyUserInteraction();
     CGPoint location = [recognizer locationInView:recognizer.view];
     
     VROVector3f viewportTouchPos = VROVector3f(location.x * self.contentScaleFactor, location.y * self.contentScaleFactor);
@@ -242,6 +250,7 @@ static VROVector3f const kZeroVector = VROVector3f();
 }
 
 - (void)handleTap:(UITapGestureRecognizer *)recognizer {
+    _renderer->notifyUserInteraction();
     CGPoint location = [recognizer locationInView:recognizer.view];
     VROVector3f viewportTouchPos = VROVector3f(location.x * self.contentScaleFactor, location.y * self.contentScaleFactor);
     
@@ -347,6 +356,11 @@ static VROVector3f const kZeroVector = VROVector3f();
     _displayLink.paused = NO;
 }
 
+- (void)applicationDidReceiveMemoryWarning:(NSNotification *)notification {
+    // Memory warnings are delivered on the main thread, which is also the rendering thread
+    _driver->onMemoryPressure(VROMemoryPressure::Critical);
+}
+
 - (void)setRenderDelegate:(id<VRORenderDelegate>)renderDelegate {
     _renderDelegateWrapper = std::make_shared<VRORenderDelegateiOS>(renderDelegate);
     _renderer->setDelegate(_renderDelegateWrapper);
@@ -372,6 +386,18 @@ static VROVector3f const kZeroVector = VROVector3f();
     return [NSString stringWithUTF8String:_inputController->getController().c_str()];
 }
 
+- (NSString *)getMemoryStats {
+    return [NSString stringWithUTF8String:VROAllocationTracker::toJSON().c_str()];
+}
+
+- (void)setFrameTelemetryEnabled:(BOOL)enabled refreshRate:(float)refreshRate jankThreshold:(double)jankThreshold {
+    _renderer->setFrameTelemetryEnabled(enabled, refreshRate, jankThreshold);
+}
+
+- (NSString *)getFrameTelemetry:(BOOL)reset {
+    return [NSString stringWithUTF8String:_renderer->getFrameTelemetryJSON(reset).c_str()];
+}
+
 #pragma mark - Camera
 
 - (void)setPointOfView:(std::shared_ptr<VRONode>)node {
@@ -412,11 +438,33 @@ static VROVector3f const kZeroVector = VROVector3f();
     @autoreleasepool {
         [self renderFrame];
     }
+    [self updateFrameRate];
     
     ++_frame;
     ALLOCATION_TRACKER_PRINT();
 }
 
+/*
+ On adaptive refresh rate displays, follow the refresh rate range the renderer
+ prefers for what is on screen.
+ */
+- (void)updateFrameRate {
+    if (!_renderer->isAdaptiveFrameRateEnabled()) {
+        return;
+    }
+    float maximumRate = (float) [UIScreen mainScreen].maximumFramesPerSecond;
+    VROFrameRateRange range = _renderer->getPreferredFrameRateRange(0, maximumRate, _driver);
+    if (range == _frameRateRange) {
+        return;
+    }
+    _frameRateRange = range;
+    if (@available(iOS 15.0, *)) {
+        _displayLink.preferredFrameRateRange = CAFrameRateRangeMake(range.minimum, range.maximum, range.preferred);
+    } else {
+        _displayLink.preferredFramesPerSecond = (NSInteger) range.preferred;
+    }
+}
+
 - (void)renderFrame {
     glEnable(GL_DEPTH_TEST);    
     _driver->setCullMode(VROCullMode::Back);
@@ -28,10 +28,6 @@
 #include "VROLog.h"
 #include "VROTime.h"
 #include "VROMath.h"
-#include <Accelerate/Accelerate.h>
-#include "VROImagePreprocessor.h"
-#include "VROARFrameiOS.h"
-#include "VROARFrameInertial.h"
 #include "VROOneEuroFilter.h"
 
 // For deriving dynamic crop box from joints
@@ -42,11 +38,6 @@
 
 static const float kConfidenceThreshold = 0.15;
 
-// Set to true to save the crop and padding result of one of the early
-// frames to the Photo Library, for debubbing.
-static bool kDebugCropAndPadResult = false;
-static const int kDebugCropAndPadResultFrame = 30;
-
 // Parameterization for the One Euro filter used when dynamic cropping.
 static const double kCropEuroFilterFrequency = 60;
 static const double kCropEuroFilterDCutoff = 1;
@@ -80,16 +71,10 @@ static const double kRegionOfInterestRoundingEpsilon = 0.05;
 
 VROVisionEngine::VROVisionEngine(MLModel *model, int imageSize, VROCameraPosition position,
                                  VROCropAndScaleOption cropAndScaleOption) {
-    _visionQueue = dispatch_queue_create("com.viro.visionQueue", DISPATCH_QUEUE_SERIAL);
-
     _imageSize = imageSize;
     _fpsTickIndex = 0;
     _fpsTickSum = 0;
     _neuralEngineInitialized = false;
-    _processingImage = nil;
-    _nextImage = nil;
-    _cropScratchBuffer = nil;
-    _cropScratchBufferLength = 0;
     
     _dynamicCropBox = CGRectNull;
     _dynamicCropXFilter = std::make_shared<VROOneEuroFilterF>(kCropEuroFilterFrequency, kCropEuroFilterFCMin,
@@ -136,103 +121,35 @@ VROVisionEngine::VROVisionEngine(MLModel *model, int imageSize, VROCameraPositio
 }
 
 VROVisionEngine::~VROVisionEngine() {
-    if (_cropScratchBuffer != nullptr) {
-        free(_cropScratchBuffer);
-    }
+    
 }
 
 #pragma mark - Renderer Thread
 
 void VROVisionEngine::update(const VROARFrame *frame) {
-    const VROARFrameiOS *frameiOS = dynamic_cast<const VROARFrameiOS *>(frame);
-    
-    // Store the given image, which we'll run when the neural engine
-    // is done processing its current image
-    {
-        std::lock_guard<std::mutex> lock(_imageMutex);
-        _nextTransform = frame->getViewportToCameraImageTransform().invert();
-        
-        if (_nextImage) {
-            CVBufferRelease(_nextImage);
-        }
-        if (frameiOS) {
-            _nextImage = CVBufferRetain(frameiOS->getImage());
-            _nextOrientation = frameiOS->getImageOrientation();
-        } else {
-            const VROARFrameInertial *frameInertial = dynamic_cast<const VROARFrameInertial *>(frame);
-            CMSampleBufferRef sampleBuffer = frameInertial->getImage();
-            _nextImage = CVBufferRetain(CMSampleBufferGetImageBuffer(sampleBuffer));
-            _nextOrientation = frameInertial->getImageOrientation();
-        }
-    }
-    
     // Start tracking images if we haven't yet initialized
     if (!_neuralEngineInitialized) {
         _neuralEngineInitialized = true;
         _nanosecondsLastFrame = VRONanoTime();
     }
     
-    // Try to process the next image (this will no-op if the neural
-    // engine is already processing an image)
-    std::weak_ptr<VROVisionEngine> tracker_w = std::dynamic_pointer_cast<VROVisionEngine>(shared_from_this());
-    dispatch_async(_visionQueue, ^{
-        std::shared_ptr<VROVisionEngine> tracker = tracker_w.lock();
-        if (tracker) {
-            tracker->nextImage();
-        }
-    });
+    // The scheduler runs the latest frame once the model is free (and due), dropping
+    // any frame that was waiting
+    VROVisionScheduler::getSharedScheduler()->submit(shared_from_this(), frame);
 }
 
-#pragma mark - Vision Queue (pre-processing for CoreML)
-
-// Invoked on the _visionQueue
-void VROVisionEngine::nextImage() {
-#if VRO_PROFILE_NEURAL_ENGINE
-    NSLog(@"Starting neural engine frame");
-#endif
-    
-    VROMatrix4f transform;
-    CGImagePropertyOrientation orientation;
-    {
-        std::lock_guard<std::mutex> lock(_imageMutex);
-        // Only process one image at a time
-        if (_processingImage || !_nextImage) {
-            return;
-        }
-        
-        _processingImage = CVBufferRetain(_nextImage);
-        CVBufferRelease(_nextImage);
-        _nextImage = nil;
-        
-        transform = _nextTransform;
-        orientation = _nextOrientation;
-    }
-    
-#if VRO_PROFILE_NEURAL_ENGINE
-    NSLog(@"   Idle time %f", VROTimeCurrentMillis() - _betweenImageTime);
-#endif
-    
-    trackImage(_processingImage, transform, orientation);
-    {
-        std::lock_guard<std::mutex> lock(_imageMutex);
-        CVBufferRelease(_processingImage);
-        _processingImage = nil;
-    }
-    _betweenImageTime = VROTimeCurrentMillis();
-    
-    // Use dispatch_async to prevent recursion overflow
-    std::weak_ptr<VROVisionEngine> tracker_w = std::dynamic_pointer_cast<VROVisionEngine>(shared_from_this());
-    dispatch_async(_visionQueue, ^{
-        std::shared_ptr<VROVisionEngine> tracker = tracker_w.lock();
-        if (tracker) {
-            tracker->nextImage();
-        }
-    });
+void VROVisionEngine::setFrameRate(double framesPerSecond) {
+    VROVisionScheduler::getSharedScheduler()->setFrameRate(shared_from_this(), framesPerSecond);
 }
 
-// Invoked on the _visionQueue
-void VROVisionEngine::trackImage(CVPixelBufferRef image, VROMatrix4f transform, CGImagePropertyOrientation orientation) {
-    NSDictionary *visionOptions = [NSDictionary dictionary];
+#pragma mark - Scheduler Queue (pre-processing for CoreML)
+
+// Invoked on the scheduler's queue
+VROVisionPreprocess VROVisionEngine::prepareFrame(const VROVisionFrame &frame) {
+    CVPixelBufferRef image = frame.image;
+    VROMatrix4f transform = frame.viewportToImage.invert();
+    CGImagePropertyOrientation orientation = frame.imageOrientation;
+    VROVisionPreprocess preprocess(orientation);
     
     // The logic below derives the _transform matrix, which is used to convert *rotated* image
     // coordinates to viewport coordinates. This matrix is derived from the scale and translation
@@ -244,7 +161,6 @@ void VROVisionEngine::trackImage(CVPixelBufferRef image, VROMatrix4f transform,
     
     float width = (float) CVPixelBufferGetWidth(image);
     float height = (float) CVPixelBufferGetHeight(image);
-    bool needsRelease = false;
     
     // Derive the toViewport matrix, which moves coordinates from image space
     // to viewport space.
@@ -307,9 +223,18 @@ void VROVisionEngine::trackImage(CVPixelBufferRef image, VROMatrix4f transform,
         toImage[12] = (1 - height / width) / 2.0;
     }
     else if (_cropAndScaleOption == VROCropAndScaleOption::Viro_FitCropPad) {
+        int imageWidth = (int) CVPixelBufferGetWidth(image);
+        int imageHeight = (int) CVPixelBufferGetHeight(image);
         int cropX, cropY, cropWidth, cropHeight;
-        image = performCropAndPad(image, &cropX, &cropY, &cropWidth, &cropHeight);
-        needsRelease = true;
+        deriveCropRect(imageWidth, imageHeight, &cropX, &cropY, &cropWidth, &cropHeight);
+        
+        // The scheduler crops, then fits the long side into the model's input
+        // square, on the GPU
+        if (!CGRectIsNull(_dynamicCropBox)) {
+            preprocess.crop = CGRectMake((float) cropX / imageWidth, (float) cropY / imageHeight,
+                                         (float) cropWidth / imageWidth, (float) cropHeight / imageHeight);
+            preprocess.size = _imageSize;
+        }
         
         // Derive the transform from vision space to *cropped* image space.
         // This is similar logic to CoreML_Fit.
@@ -400,48 +325,17 @@ void VROVisionEngine::trackImage(CVPixelBufferRef image, VROMatrix4f transform,
     _visionToImageSpace = toImage;
     _imageToViewportSpace = toViewport;
     _startNeural = VROTimeCurrentMillis();
-    
-    // By wrapping the CVPixelBuffer in a CIImage, iOS will automatically convert from
-    // YCbCr to RGB (note: this is undocumented, but works).
-    CIImage *ciImage = [[CIImage alloc] initWithCVPixelBuffer:image];
-    VNImageRequestHandler *handler = [[VNImageRequestHandler alloc] initWithCIImage:ciImage
-                                                                        orientation:orientation
-                                                                            options:visionOptions];
-    [handler performRequests:@[_visionRequest] error:nil];
-    
-    if (needsRelease) {
-        CVBufferRelease(image);
-    }
+    return preprocess;
 }
 
-// Invoked on the _visionQueue
-static int debugCropAndPadCurrentFrame = 0;
-CVPixelBufferRef VROVisionEngine::performCropAndPad(CVPixelBufferRef image,
-                                                    int *outCropX, int *outCropY,
-                                                    int *outCropWidth, int *outCropHeight) {
-    size_t width = CVPixelBufferGetWidth(image);
-    size_t height = CVPixelBufferGetHeight(image);
-    
+void VROVisionEngine::deriveCropRect(int width, int height, int *outCropX, int *outCropY,
+                                     int *outCropWidth, int *outCropHeight) {
     if (CGRectIsNull(_dynamicCropBox)) {
         *outCropX = 0;
         *outCropY = 0;
-        *outCropWidth  = (int) width;
-        *outCropHeight = (int) height;
-        
-        // This method either returns a +1 retained pixelbuffer, or a new
-        // pixelbuffer entirely
-        CVBufferRetain(image);
-        return image;
-    }
-    
-    int bufferSize = (int) width * (int) height * 4;
-    if (_cropScratchBuffer == nullptr || _cropScratchBufferLength < bufferSize) {
-        pinfo("Creating new crop scratch buffer of size %d", bufferSize);
-        if (_cropScratchBuffer != nullptr) {
-            free(_cropScratchBuffer);
-        }
-        _cropScratchBuffer = (uint8_t *) malloc(bufferSize);
-        _cropScratchBufferLength = bufferSize;
+        *outCropWidth  = width;
+        *outCropHeight = height;
+        return;
     }
     
     *outCropX = _dynamicCropBox.origin.x * width;
@@ -451,26 +345,13 @@ CVPixelBufferRef VROVisionEngine::performCropAndPad(CVPixelBufferRef image,
     
     *outCropX = clamp(*outCropX, 0, width);
     *outCropY = clamp(*outCropY, 0, height);
-    *outCropWidth  = clamp(*outCropWidth,  0, (int) width  - *outCropX);
-    *outCropHeight = clamp(*outCropHeight, 0, (int) height - *outCropY);
-    
-    CVPixelBufferRef cropped = VROImagePreprocessor::cropAndResize(image, *outCropX, *outCropY, *outCropWidth, *outCropHeight,
-                                                                   _imageSize, _cropScratchBuffer);
-    if (kDebugCropAndPadResult) {
-        if (debugCropAndPadCurrentFrame >= kDebugCropAndPadResultFrame &&
-            debugCropAndPadCurrentFrame < kDebugCropAndPadResultFrame + 1) {
-            
-            VROImagePreprocessor::writeImageToPhotos(VROImagePreprocessor::convertYCbCrToRGB(image));
-            VROImagePreprocessor::writeImageToPhotos(VROImagePreprocessor::convertYCbCrToRGB(cropped));
-        }
-        ++debugCropAndPadCurrentFrame;
-    }
-    return cropped;
+    *outCropWidth  = clamp(*outCropWidth,  0, width  - *outCropX);
+    *outCropHeight = clamp(*outCropHeight, 0, height - *outCropY);
 }
 
-#pragma mark - Vision Queue (post-processing CoreML output)
+#pragma mark - Scheduler Queue (post-processing CoreML output)
 
-// Invoked on the _visionQueue
+// Invoked on the scheduler's queue
 void VROVisionEngine::processVisionResults(VNRequest *request, NSError *error) {
 #if VRO_PROFILE_NEURAL_ENGINE
     NSLog(@"   Neural engine time %f", VROTimeCurrentMillis() - _startNeural);
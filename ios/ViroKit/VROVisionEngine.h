@@ -37,6 +37,7 @@
 #import <CoreML/CoreML.h>
 #import <Vision/Vision.h>
 #include "VROMatrix4f.h"
+#include "VROVisionScheduler.h"
 
 // Number of samples to collect when computing FPS
 static const int kNeuralFPSMaxSamples = 100;
@@ -73,9 +74,10 @@ public:
 };
 
 /*
- Interfaces CoreML models with AR frames.
+ Interfaces CoreML models with AR frames. Frames are run through the shared
+ VROVisionScheduler.
  */
-class API_AVAILABLE(ios(11.0)) VROVisionEngine : public std::enable_shared_from_this<VROVisionEngine> {
+class API_AVAILABLE(ios(11.0)) VROVisionEngine : public VROVisionJob, public std::enable_shared_from_this<VROVisionEngine> {
 public:
     
     VROVisionEngine(MLModel *model, int imageSize, VROCameraPosition position,
@@ -85,9 +87,24 @@ public:
     /*
      Process a new frame with the vision engine. This will crop and scale the frame
      appropriately, run it through the ML model, and send the results to the delegate.
+     The frame is skipped if the engine is not yet due for another frame.
      */
     void update(const VROARFrame *frame);
     
+    /*
+     Run the model on at most this many frames per second. Zero (the default) runs it
+     on every frame it can keep up with.
+     */
+    void setFrameRate(double framesPerSecond);
+    
+    /*
+     VROVisionJob implementation. Invoked on the scheduler's queue.
+     */
+    VROVisionPreprocess prepareFrame(const VROVisionFrame &frame);
+    VNRequest *getVisionRequest() {
+        return _visionRequest;
+    }
+    
     /*
      Set the delegate that will receive the Core ML output each frame.
      */
@@ -113,8 +130,6 @@ private:
     VNCoreMLRequest *_visionRequest;
     
     VROCropAndScaleOption _cropAndScaleOption;
-    uint8_t *_cropScratchBuffer;
-    int _cropScratchBufferLength;
     
     /*
      Delegate that will process finished vision requests.
@@ -126,11 +141,6 @@ private:
      */
     VROCameraPosition _cameraPosition;
     
-    /*
-     Queue on which CoreML is run.
-     */
-    dispatch_queue_t _visionQueue;
-    
     /*
      Transforms used to convert points from vision space (the CoreML input image
      space) into viewport points.
@@ -142,24 +152,6 @@ private:
      */
     VROMatrix4f _visionToImageSpace, _imageToViewportSpace;
     
-    /*
-     The image being processed now. Null if no image is currently being processed.
-     */
-    CVPixelBufferRef _processingImage;
-    
-    /*
-     The image (along with its ARKit transform and orientation) that is queued to be
-     fed into the CoreML model. The ARKit transform moves from image to viewport
-     space.
-     
-     These are all protected by _imageMutex, as they are modified on the rendering thread
-     but utlized on the _visionQueue thread.
-     */
-    CVPixelBufferRef _nextImage;
-    VROMatrix4f _nextTransform;
-    CGImagePropertyOrientation _nextOrientation;
-    std::mutex _imageMutex;
-    
     /*
      Variables for neural engine FPS computation. Array of samples taken, index of
      next sample, and sum of samples so far.
@@ -194,35 +186,21 @@ private:
     CGRect _dynamicCropBox, _dynamicCropBoxViewport;
     std::shared_ptr<VROOneEuroFilterF> _dynamicCropXFilter, _dynamicCropYFilter, _dynamicCropWidthFilter, _dynamicCropHeightFilter;
     
-    /*
-     Move to track the next image, if one is available.
-     */
-    void nextImage();
-    
-    /*
-     Initiate a VNImageRequest on the provided image, using the given inverse display transform.
-     This method also derives the transform that will be needed to go back from vision space [0, 1] to
-     viewport space [0, 1].
-     
-     Invoked on the visionQueue.
-     */
-    void trackImage(CVPixelBufferRef image, VROMatrix4f transform, CGImagePropertyOrientation orientation);
-    
     /*
      Process the result of the last call to trackImage. This will convert the raw output from
      CoreML into the body joints, and then pass the joints through a filter and finally invoke the delegate
      on the rendering thread.
      
-     Invoked on the visionQueue.
+     Invoked on the scheduler's queue.
      */
     void processVisionResults(VNRequest *request, NSError *error);
     
     /*
-     Perform a crop and pad of the given image using the dynamic crop box,
-     and return the result.
+     Derive the crop rectangle, in pixels, of an image of the given size from the
+     dynamic crop box. The crop and pad itself is performed by the scheduler on the GPU.
      */
-    CVPixelBufferRef performCropAndPad(CVPixelBufferRef image, int *outCropX, int *outCropY,
-                                       int *outCropWidth, int *outCropHeight);
+    void deriveCropRect(int width, int height, int *outCropX, int *outCropY,
+                        int *outCropWidth, int *outCropHeight);
     
     /*
      Derive the full body bounds from the given pose. This will be used as the dynamic crop
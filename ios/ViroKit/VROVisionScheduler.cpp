@@ -0,0 +1,356 @@
+//
+//  VROVisionScheduler.cpp
+//  ViroKit
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "VROVisionScheduler.h"
+#include "VROLog.h"
+#include "VROTime.h"
+#include "VROARFrameiOS.h"
+#include "VROARFrameInertial.h"
+#import <Metal/Metal.h>
+
+// Frames older than this when the queue reaches them are dropped rather than run,
+// since their results would arrive too late to line up with the camera
+static const double kMaxFrameAgeSeconds = 0.25;
+
+// Weight of the newest sample in each averaged metric
+static const double kMetricsAverageWeight = 0.1;
+
+// Number of preprocessed images kept ready in each pool
+static const int kPoolMinimumBuffers = 2;
+
+#pragma mark - Initialization
+
+std::shared_ptr<VROVisionScheduler> VROVisionScheduler::getSharedScheduler() {
+    static std::shared_ptr<VROVisionScheduler> sScheduler = std::make_shared<VROVisionScheduler>();
+    return sScheduler;
+}
+
+VROVisionScheduler::VROVisionScheduler() :
+    _drainScheduled(false) {
+    _queue = dispatch_queue_create("com.viro.visionSchedulerQueue", DISPATCH_QUEUE_SERIAL);
+    
+    id<MTLDevice> device = MTLCreateSystemDefaultDevice();
+    if (device) {
+        _context = [CIContext contextWithMTLDevice:device];
+    } else {
+        _context = [CIContext contextWithOptions:nil];
+    }
+}
+
+VROVisionScheduler::~VROVisionScheduler() {
+    for (auto &kv : _jobs) {
+        if (kv.second.hasPendingFrame) {
+            CVBufferRelease(kv.second.pendingFrame.image);
+        }
+    }
+    for (auto &kv : _pools) {
+        CVPixelBufferPoolRelease(kv.second);
+    }
+}
+
+#pragma mark - Renderer Thread
+
+VROVisionScheduler::JobState &VROVisionScheduler::getState(std::shared_ptr<VROVisionJob> job) {
+    JobState &state = _jobs[job.get()];
+    if (state.job.lock() != job) {
+        if (state.hasPendingFrame) {
+            CVBufferRelease(state.pendingFrame.image);
+        }
+        state.job = job;
+        state.interval = 0;
+        state.lastDispatchTime = 0;
+        state.lastResultTime = 0;
+        state.hasPendingFrame = false;
+        memset(&state.metrics, 0, sizeof(state.metrics));
+    }
+    return state;
+}
+
+void VROVisionScheduler::setFrameRate(std::shared_ptr<VROVisionJob> job, double framesPerSecond) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    getState(job).interval = framesPerSecond > 0 ? 1.0 / framesPerSecond : 0;
+}
+
+void VROVisionScheduler::submit(std::shared_ptr<VROVisionJob> job, const VROARFrame *frame) {
+    VROVisionFrame visionFrame;
+    visionFrame.time = VROTimeCurrentSeconds();
+    visionFrame.orientation = frame->getOrientation();
+    visionFrame.viewportToImage = frame->getViewportToCameraImageTransform();
+    
+    const VROARFrameiOS *frameiOS = dynamic_cast<const VROARFrameiOS *>(frame);
+    if (frameiOS) {
+        visionFrame.image = frameiOS->getImage();
+        visionFrame.imageOrientation = frameiOS->getImageOrientation();
+    } else {
+        const VROARFrameInertial *frameInertial = dynamic_cast<const VROARFrameInertial *>(frame);
+        if (!frameInertial) {
+            return;
+        }
+        visionFrame.image = CMSampleBufferGetImageBuffer(frameInertial->getImage());
+        visionFrame.imageOrientation = frameInertial->getImageOrientation();
+    }
+    if (!visionFrame.image) {
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(_mutex);
+    JobState &state = getState(job);
+    
+    // Skip frames until the job is due
+    if (state.interval > 0 && visionFrame.time - state.lastDispatchTime < state.interval) {
+        return;
+    }
+    
+    // Replace, rather than queue behind, the frame already waiting for this job
+    if (state.hasPendingFrame) {
+        CVBufferRelease(state.pendingFrame.image);
+        state.metrics.framesDropped++;
+    }
+    visionFrame.image = CVBufferRetain(visionFrame.image);
+    state.pendingFrame = visionFrame;
+    state.hasPendingFrame = true;
+    
+    scheduleDrain();
+}
+
+void VROVisionScheduler::remove(std::shared_ptr<VROVisionJob> job) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _jobs.find(job.get());
+    if (it == _jobs.end()) {
+        return;
+    }
+    if (it->second.hasPendingFrame) {
+        CVBufferRelease(it->second.pendingFrame.image);
+    }
+    _jobs.erase(it);
+}
+
+VROVisionMetrics VROVisionScheduler::getMetrics(std::shared_ptr<VROVisionJob> job) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return getState(job).metrics;
+}
+
+void VROVisionScheduler::scheduleDrain() {
+    // Only one drain is queued at a time; it picks up whatever is pending when it
+    // runs, so frames are never queued behind each other
+    if (_drainScheduled) {
+        return;
+    }
+    _drainScheduled = true;
+    
+    std::weak_ptr<VROVisionScheduler> scheduler_w = shared_from_this();
+    dispatch_async(_queue, ^{
+        std::shared_ptr<VROVisionScheduler> scheduler = scheduler_w.lock();
+        if (scheduler) {
+            scheduler->drain();
+        }
+    });
+}
+
+#pragma mark - Scheduler Queue
+
+void VROVisionScheduler::drain() {
+    struct Batch {
+        VROVisionFrame frame;
+        VROVisionPreprocess preprocess;
+        std::vector<std::shared_ptr<VROVisionJob>> jobs;
+    };
+    
+    // Take the pending frames, dropping the stale ones
+    std::vector<std::pair<std::shared_ptr<VROVisionJob>, VROVisionFrame>> pending;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _drainScheduled = false;
+        
+        double now = VROTimeCurrentSeconds();
+        for (auto it = _jobs.begin(); it != _jobs.end();) {
+            JobState &state = it->second;
+            std::shared_ptr<VROVisionJob> job = state.job.lock();
+            if (!job) {
+                if (state.hasPendingFrame) {
+                    CVBufferRelease(state.pendingFrame.image);
+                }
+                it = _jobs.erase(it);
+                continue;
+            }
+            if (state.hasPendingFrame) {
+                state.hasPendingFrame = false;
+                if (now - state.pendingFrame.time > kMaxFrameAgeSeconds) {
+                    CVBufferRelease(state.pendingFrame.image);
+                    state.metrics.framesDropped++;
+                } else {
+                    state.lastDispatchTime = now;
+                    pending.push_back({ job, state.pendingFrame });
+                }
+            }
+            ++it;
+        }
+    }
+    
+    // Batch the jobs that share a frame and preprocessing
+    std::vector<Batch> batches;
+    for (auto &jobFrame : pending) {
+        VROVisionPreprocess preprocess = jobFrame.first->prepareFrame(jobFrame.second);
+        
+        bool batched = false;
+        for (Batch &batch : batches) {
+            if (batch.frame.image == jobFrame.second.image && batch.preprocess == preprocess) {
+                batch.jobs.push_back(jobFrame.first);
+                CVBufferRelease(jobFrame.second.image);
+                batched = true;
+                break;
+            }
+        }
+        if (!batched) {
+            batches.push_back({ jobFrame.second, preprocess, { jobFrame.first } });
+        }
+    }
+    
+    for (Batch &batch : batches) {
+        double startTime = VROTimeCurrentSeconds();
+        CVPixelBufferRef image = batch.frame.image;
+        CVPixelBufferRef processed = nullptr;
+        if (batch.preprocess.requiresProcessing()) {
+            processed = preprocess(image, batch.preprocess);
+            if (processed) {
+                image = processed;
+            }
+        }
+        double preprocessTime = VROTimeCurrentSeconds();
+        
+        NSMutableArray<VNRequest *> *requests = [NSMutableArray arrayWithCapacity:batch.jobs.size()];
+        for (std::shared_ptr<VROVisionJob> &job : batch.jobs) {
+            [requests addObject:job->getVisionRequest()];
+        }
+        
+        // By wrapping the CVPixelBuffer in a CIImage, iOS will automatically convert from
+        // YCbCr to RGB (note: this is undocumented, but works).
+        CIImage *ciImage = [[CIImage alloc] initWithCVPixelBuffer:image];
+        VNImageRequestHandler *handler = [[VNImageRequestHandler alloc] initWithCIImage:ciImage
+                                                                            orientation:batch.preprocess.orientation
+                                                                                options:[NSDictionary dictionary]];
+        [handler performRequests:requests error:nil];
+        double endTime = VROTimeCurrentSeconds();
+        
+        if (processed) {
+            CVBufferRelease(processed);
+        }
+        CVBufferRelease(batch.frame.image);
+        
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (std::shared_ptr<VROVisionJob> &job : batch.jobs) {
+            auto it = _jobs.find(job.get());
+            if (it == _jobs.end()) {
+                continue;
+            }
+            JobState &state = it->second;
+            VROVisionMetrics &metrics = state.metrics;
+            double weight = metrics.framesProcessed == 0 ? 1.0 : kMetricsAverageWeight;
+            
+            metrics.preprocessMs += ((preprocessTime - startTime) * 1000 - metrics.preprocessMs) * weight;
+            metrics.inferenceMs  += ((endTime - preprocessTime) * 1000 - metrics.inferenceMs) * weight;
+            metrics.latencyMs    += ((endTime - batch.frame.time) * 1000 - metrics.latencyMs) * weight;
+            if (state.lastResultTime > 0 && endTime > state.lastResultTime) {
+                metrics.throughput += (1.0 / (endTime - state.lastResultTime) - metrics.throughput) * weight;
+            }
+            state.lastResultTime = endTime;
+            metrics.framesProcessed++;
+        }
+    }
+    
+    // Frames that arrived while this drain ran are picked up by the drain they
+    // scheduled
+}
+
+CVPixelBufferRef VROVisionScheduler::preprocess(CVPixelBufferRef pixelBuffer, const VROVisionPreprocess &preprocess) {
+    CIImage *image = [[CIImage alloc] initWithCVPixelBuffer:pixelBuffer];
+    float width = (float) CVPixelBufferGetWidth(pixelBuffer);
+    float height = (float) CVPixelBufferGetHeight(pixelBuffer);
+    
+    // Core Image has a bottom-left origin
+    if (!CGRectIsNull(preprocess.crop)) {
+        CGRect crop = CGRectMake(preprocess.crop.origin.x * width,
+                                 (1 - preprocess.crop.origin.y - preprocess.crop.size.height) * height,
+                                 preprocess.crop.size.width * width,
+                                 preprocess.crop.size.height * height);
+        crop = CGRectIntegral(CGRectIntersection(crop, image.extent));
+        if (CGRectIsEmpty(crop)) {
+            return nullptr;
+        }
+        image = [[image imageByCroppingToRect:crop] imageByApplyingTransform:CGAffineTransformMakeTranslation(-crop.origin.x, -crop.origin.y)];
+    }
+    
+    // Fit the long side, and pad the short side with grey
+    int outputWidth = (int) image.extent.size.width;
+    int outputHeight = (int) image.extent.size.height;
+    if (preprocess.size > 0) {
+        float scale = preprocess.size / fmax(image.extent.size.width, image.extent.size.height);
+        float tx = (preprocess.size - image.extent.size.width  * scale) / 2.0;
+        float ty = (preprocess.size - image.extent.size.height * scale) / 2.0;
+        image = [image imageByApplyingTransform:CGAffineTransformTranslate(CGAffineTransformMakeScale(scale, scale), tx / scale, ty / scale)];
+        
+        CIImage *padding = [[CIImage imageWithColor:[CIColor colorWithRed:0.5 green:0.5 blue:0.5]]
+                            imageByCroppingToRect:CGRectMake(0, 0, preprocess.size, preprocess.size)];
+        image = [image imageByCompositingOverImage:padding];
+        outputWidth = preprocess.size;
+        outputHeight = preprocess.size;
+    }
+    
+    if (preprocess.normalizeScale != 1 || preprocess.normalizeBias != 0) {
+        float s = preprocess.normalizeScale;
+        float b = preprocess.normalizeBias;
+        image = [image imageByApplyingFilter:@"CIColorMatrix"
+                         withInputParameters:@{ @"inputRVector"    : [CIVector vectorWithX:s Y:0 Z:0 W:0],
+                                                @"inputGVector"    : [CIVector vectorWithX:0 Y:s Z:0 W:0],
+                                                @"inputBVector"    : [CIVector vectorWithX:0 Y:0 Z:s W:0],
+                                                @"inputAVector"    : [CIVector vectorWithX:0 Y:0 Z:0 W:1],
+                                                @"inputBiasVector" : [CIVector vectorWithX:b Y:b Z:b W:0] }];
+    }
+    
+    std::pair<int, int> key = { outputWidth, outputHeight };
+    CVPixelBufferPoolRef pool = _pools[key];
+    if (!pool) {
+        NSDictionary *poolAttributes = @{ (id) kCVPixelBufferPoolMinimumBufferCountKey : @(kPoolMinimumBuffers) };
+        NSDictionary *bufferAttributes = @{ (id) kCVPixelBufferPixelFormatTypeKey : @(kCVPixelFormatType_32BGRA),
+                                            (id) kCVPixelBufferWidthKey : @(outputWidth),
+                                            (id) kCVPixelBufferHeightKey : @(outputHeight),
+                                            (id) kCVPixelBufferIOSurfacePropertiesKey : @{},
+                                            (id) kCVPixelBufferMetalCompatibilityKey : @YES };
+        CVPixelBufferPoolCreate(kCFAllocatorDefault, (__bridge CFDictionaryRef) poolAttributes,
+                                (__bridge CFDictionaryRef) bufferAttributes, &pool);
+        if (!pool) {
+            pwarn("Failed to create vision preprocessing pool of size %d x %d", outputWidth, outputHeight);
+            return nullptr;
+        }
+        _pools[key] = pool;
+    }
+    
+    CVPixelBufferRef output = nullptr;
+    if (CVPixelBufferPoolCreatePixelBuffer(kCFAllocatorDefault, pool, &output) != kCVReturnSuccess) {
+        return nullptr;
+    }
+    [_context render:image toCVPixelBuffer:output bounds:CGRectMake(0, 0, outputWidth, outputHeight) colorSpace:nil];
+    return output;
+}
@@ -0,0 +1,245 @@
+//
+//  VROVisionScheduler.h
+//  ViroKit
+//
+//  Copyright © 2019 Viro Media. All rights reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining
+//  a copy of this software and associated documentation files (the
+//  "Software"), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so, subject to
+//  the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included
+//  in all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+//  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef VROVisionScheduler_h
+#define VROVisionScheduler_h
+
+#include <map>
+#include <mutex>
+#include <memory>
+#include <vector>
+#import <Foundation/Foundation.h>
+#import <AVFoundation/AVFoundation.h>
+#import <CoreImage/CoreImage.h>
+#import <Vision/Vision.h>
+#include "VROMatrix4f.h"
+#include "VROCameraTexture.h"
+
+class VROARFrame;
+
+/*
+ A camera frame submitted for inference. The image is retained for as long as the
+ frame is held by the scheduler.
+ */
+struct VROVisionFrame {
+    CVPixelBufferRef image;
+    CGImagePropertyOrientation imageOrientation;
+    VROCameraOrientation orientation;
+    
+    /*
+     Transform from viewport space to camera image space, as given by the AR frame.
+     */
+    VROMatrix4f viewportToImage;
+    
+    /*
+     Time the frame was submitted, in VROTimeCurrentSeconds.
+     */
+    double time;
+};
+
+/*
+ How a frame is prepared before it is given to Vision. Cropping, scaling, and
+ normalization are performed by Core Image on the GPU, reading the camera image in
+ place. Jobs that are given the same frame and ask for the same preprocessing share
+ one preprocessed image and one Vision request handler.
+ */
+struct VROVisionPreprocess {
+    /*
+     Orientation of the image with respect to the model's upright, applied by Vision.
+     */
+    CGImagePropertyOrientation orientation;
+    
+    /*
+     Region of the image to keep, normalized with a top-left origin. CGRectNull keeps
+     the entire image.
+     */
+    CGRect crop;
+    
+    /*
+     If nonzero, the (cropped) image is aspect-fit into a square of this size, with
+     grey bars. If zero, the image is not scaled, and Vision scales it as configured
+     in the request.
+     */
+    int size;
+    
+    /*
+     Each color channel becomes (color * scale + bias), for models that take raw input
+     and expect normalized color.
+     */
+    float normalizeScale;
+    float normalizeBias;
+    
+    VROVisionPreprocess(CGImagePropertyOrientation orientation = kCGImagePropertyOrientationUp) :
+        orientation(orientation), crop(CGRectNull), size(0), normalizeScale(1), normalizeBias(0) {}
+    
+    bool requiresProcessing() const {
+        return !CGRectIsNull(crop) || size > 0 || normalizeScale != 1 || normalizeBias != 0;
+    }
+    bool operator==(const VROVisionPreprocess &other) const {
+        return orientation == other.orientation && CGRectEqualToRect(crop, other.crop) && size == other.size &&
+               normalizeScale == other.normalizeScale && normalizeBias == other.normalizeBias;
+    }
+};
+
+/*
+ Per-job timings, averaged over recent frames, in milliseconds.
+ */
+struct VROVisionMetrics {
+    /*
+     Frames run through the model, and frames the job was due for but that were
+     superseded by a newer frame before they could run (or were too old when they
+     could).
+     */
+    int framesProcessed;
+    int framesDropped;
+    
+    /*
+     GPU preprocessing time, time in Vision (inference plus the request's completion
+     handler), and the time from submission until the results were delivered.
+     */
+    double preprocessMs;
+    double inferenceMs;
+    double latencyMs;
+    
+    /*
+     Results delivered per second.
+     */
+    double throughput;
+};
+
+/*
+ A model run by the VROVisionScheduler.
+ */
+class API_AVAILABLE(ios(11.0)) VROVisionJob {
+public:
+    
+    virtual ~VROVisionJob() {}
+    
+    /*
+     Prepare to run the given frame: configure the request (e.g. its region of
+     interest) and return the preprocessing the model needs. Invoked on the scheduler's
+     queue, immediately before the request is performed.
+     */
+    virtual VROVisionPreprocess prepareFrame(const VROVisionFrame &frame) = 0;
+    
+    /*
+     The request to perform on each frame. Results are delivered through the
+     request's completion handler, on the scheduler's queue.
+     */
+    virtual VNRequest *getVisionRequest() = 0;
+    
+};
+
+/*
+ Schedules the vision models of the app on camera frames. Each job runs at its own
+ cadence, on the latest frame only: a frame that arrives while the job's previous
+ frame is still being processed replaces any frame waiting for that job, so frames
+ are dropped instead of queued, and results are never older than one inference.
+ 
+ All jobs run on one serial queue, which keeps the Neural Engine (or GPU) fed with
+ one model at a time. Jobs waiting on the same frame with the same preprocessing are
+ batched into a single Vision request handler.
+ */
+class API_AVAILABLE(ios(11.0)) VROVisionScheduler : public std::enable_shared_from_this<VROVisionScheduler> {
+public:
+    
+    /*
+     The scheduler shared by all jobs.
+     */
+    static std::shared_ptr<VROVisionScheduler> getSharedScheduler();
+    
+    VROVisionScheduler();
+    virtual ~VROVisionScheduler();
+    
+    /*
+     Run the given job on at most this many frames per second. Zero (the default)
+     runs it on every frame it can keep up with.
+     */
+    void setFrameRate(std::shared_ptr<VROVisionJob> job, double framesPerSecond);
+    
+    /*
+     Offer the given frame to the job. Invoked on the rendering thread for each AR
+     frame; returns immediately. The frame is skipped if the job is not yet due.
+     */
+    void submit(std::shared_ptr<VROVisionJob> job, const VROARFrame *frame);
+    
+    /*
+     Stop running the given job, discarding any frame waiting for it.
+     */
+    void remove(std::shared_ptr<VROVisionJob> job);
+    
+    /*
+     Timings for the given job.
+     */
+    VROVisionMetrics getMetrics(std::shared_ptr<VROVisionJob> job);
+    
+private:
+    
+    struct JobState {
+        std::weak_ptr<VROVisionJob> job;
+        double interval;
+        double lastDispatchTime;
+        double lastResultTime;
+        bool hasPendingFrame;
+        VROVisionFrame pendingFrame;
+        VROVisionMetrics metrics;
+    };
+    
+    /*
+     Jobs keyed by address. Entries whose job has been destroyed are reset when the
+     address is reused, or removed when found by the queue.
+     */
+    std::map<VROVisionJob *, JobState> _jobs;
+    std::mutex _mutex;
+    
+    /*
+     True while a drain of the pending frames is queued but has not yet started.
+     */
+    bool _drainScheduled;
+    dispatch_queue_t _queue;
+    
+    /*
+     GPU-backed Core Image context, and pools of preprocessed images by size.
+     */
+    CIContext *_context;
+    std::map<std::pair<int, int>, CVPixelBufferPoolRef> _pools;
+    
+    JobState &getState(std::shared_ptr<VROVisionJob> job);
+    void scheduleDrain();
+    
+    /*
+     Run every job with a pending frame. Invoked on the _queue.
+     */
+    void drain();
+    
+    /*
+     Crop, scale, and normalize the given image on the GPU. Returns a +1 retained
+     buffer, or null on failure. Invoked on the _queue.
+     */
+    CVPixelBufferRef preprocess(CVPixelBufferRef image, const VROVisionPreprocess &preprocess);
+    
+};
+
+#endif /* VROVisionScheduler_h */
@@ -55,7 +55,7 @@ public:
         /*
          Prevent logical buffer load by immediately clearing.
          */
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+        glClear(getLoadClearMask(true));
     }
     
     void setFrame(gvr::Frame &frame) {
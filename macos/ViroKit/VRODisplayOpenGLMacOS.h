@@ -35,7 +35,7 @@ public:
         /*
          Prevent logical buffer loads.
          */
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+        glClear(getLoadClearMask(true));
     }
     
 private:
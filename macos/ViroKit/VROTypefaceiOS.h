@@ -27,7 +27,6 @@ public:
                    std::shared_ptr<VRODriver> driver);
     virtual ~VROTypefaceiOS();
     
-    float getLineHeight() const;
     std::shared_ptr<VROGlyph> loadGlyph(uint32_t charCode, uint32_t variantSelector,
                                         uint32_t outlineWidth, VROGlyphRenderMode renderMode);
 
@@ -1,27 +1,16 @@
+// Both blocks alias the same bone UBO, which holds either 192 matrices or 384 dual
+// quaternions depending on the skinner's skinning mode. Keep in sync with VROBoneUBO.h.
 layout (std140) uniform bones {
     mat4 bone_matrices[192];
 };
 
 layout (std140) uniform bones_dq {
-    vec4 bone_transforms_dq[192 * 3];
+    vec4 bone_transforms_dq[384 * 2];
 };
 
-vec4 get_blended_scale(ivec4 bone_indices, vec4 bone_weights) {
-    vec4 s0 = bone_transforms_dq[bone_indices.x * 3 + 2];
-    vec4 s1 = bone_transforms_dq[bone_indices.y * 3 + 2];
-    vec4 s2 = bone_transforms_dq[bone_indices.z * 3 + 2];
-    vec4 s3 = bone_transforms_dq[bone_indices.w * 3 + 2];
-    
-    vec4 blended_s = s0 * bone_weights.x +
-                     s1 * bone_weights.y +
-                     s2 * bone_weights.z +
-                     s3 * bone_weights.w;
-    return blended_s;
-}
-
 mat2x4 get_bone_dual_quaternion(int bone_index) {
-    return mat2x4(bone_transforms_dq[bone_index * 3 + 0],
-                  bone_transforms_dq[bone_index * 3 + 1]);
+    return mat2x4(bone_transforms_dq[bone_index * 2 + 0],
+                  bone_transforms_dq[bone_index * 2 + 1]);
 }
 
 mat2x4 get_blended_dual_quaternion(ivec4 bone_indices, vec4 bone_weights) {
@@ -44,7 +33,7 @@ mat2x4 get_blended_dual_quaternion(ivec4 bone_indices, vec4 bone_weights) {
 }
 
 vec3 quat_rotate_vector(vec3 v, vec4 real_dq) {
-    return v + 2.0 * cross(real_dq.w * v + cross(v, real_dq.xyz), real_dq.xyz);
+    return v + 2.0 * cross(real_dq.xyz, cross(real_dq.xyz, v) + real_dq.w * v);
 }
 
 vec3 dual_quat_transform_point(vec3 p, vec4 real_dq, vec4 dual_dq) {
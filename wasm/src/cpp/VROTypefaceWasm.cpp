@@ -47,10 +47,6 @@ FT_FaceRec_ *VROTypefaceWasm::loadFTFace() {
     return _face;
 }
 
-float VROTypefaceWasm::getLineHeight() const {
-    return _face->size->metrics.height >> 6;
-}
-
 std::shared_ptr<VROGlyph> VROTypefaceWasm::loadGlyph(uint32_t charCode, uint32_t variantSelector,
                                                      uint32_t outlineWidth, VROGlyphRenderMode renderMode) {
     std::shared_ptr<VROGlyph> glyph = std::make_shared<VROGlyphOpenGL>();
@@ -67,6 +63,8 @@ std::shared_ptr<VROGlyph> VROTypefaceWasm::loadGlyph(uint32_t charCode, uint32_t
             glyph->loadOutlineBitmap(driver->getFreetype(), _face, charCode, variantSelector, outlineWidth,
                                      &_outlineAtlases[outlineWidth], driver);
         }
+    } else if (renderMode == VROGlyphRenderMode::DistanceField) {
+        loadDistanceFieldGlyph(glyph, _face, charCode, variantSelector, driver);
     } else {
         glyph->loadVector(_face, charCode, variantSelector);
     }
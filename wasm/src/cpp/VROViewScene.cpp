@@ -16,6 +16,9 @@
 #include "VRORendererTestHarness.h"
 #include "VROPlatformUtil.h"
 #include "VRORendererTest.h"
+#include "VROSceneBenchmark.h"
+#include "VROFrameReplay.h"
+#include "VROAllocationTracker.h"
 
 static VROViewScene *sInstance = nullptr;
 
@@ -23,8 +26,59 @@ void VROMainLoop() {
     sInstance->drawFrame();
 }
 
-VROViewScene::VROViewScene(VRORendererTestType test) :
+/*
+ Exported for telemetry from JavaScript: returns the renderer's memory counters
+ and high-water marks as JSON. The string is valid until the next call.
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE const char *VROGetMemoryStats() {
+    static std::string sStats;
+    sStats = VROAllocationTracker::toJSON();
+    return sStats.c_str();
+}
+
+/*
+ Exported for telemetry from JavaScript: enables frame telemetry, and returns
+ it as JSON (see VROFrameTelemetry), clearing it if reset is non-zero. The
+ string is valid until the next call.
+ */
+extern "C" EMSCRIPTEN_KEEPALIVE void VROSetFrameTelemetryEnabled(int enabled, float refreshRate,
+                                                                 double jankThreshold) {
+    if (sInstance) {
+        sInstance->getRenderer()->setFrameTelemetryEnabled(enabled != 0, refreshRate, jankThreshold);
+    }
+}
+
+extern "C" EMSCRIPTEN_KEEPALIVE const char *VROGetFrameTelemetry(int reset) {
+    static std::string sTelemetry;
+    sTelemetry = sInstance ? sInstance->getRenderer()->getFrameTelemetryJSON(reset != 0) : "{}";
+    return sTelemetry.c_str();
+}
+
+VROViewScene::VROViewScene(VRORendererTestType test, bool benchmark) :
     _testType(test) {
+    initRenderer();
+    if (benchmark) {
+        _benchmark = std::make_shared<VROSceneBenchmark>(_renderer, _driver, _width, _height);
+        for (const VROSceneBenchmarkScene &scene : VROSceneBenchmark::getStandardScenes()) {
+            _benchmark->addScene(scene);
+        }
+    }
+    else {
+        buildTestScene();
+    }
+    emscripten_set_main_loop(VROMainLoop, 0, 0);
+}
+
+VROViewScene::VROViewScene(std::string replayDirectory) {
+    initRenderer();
+    _replay = std::make_shared<VROFrameReplay>(_renderer, _driver, replayDirectory);
+    if (_replay->getWidth() > _width || _replay->getHeight() > _height) {
+        pwarn("Canvas is smaller than the captured %dx%d viewport", _replay->getWidth(), _replay->getHeight());
+    }
+    emscripten_set_main_loop(VROMainLoop, 0, 0);
+}
+
+void VROViewScene::initRenderer() {
     sInstance = this;
     VROThreadRestricted::setThread(VROThreadName::Renderer);
     
@@ -38,6 +92,14 @@ VROViewScene::VROViewScene(VRORendererTestType test) :
     attribs.depth = 1;
     attribs.stencil = 1;
     attribs.antialias = 1;
+#if VRO_THREADS
+    // With pthreads we render from a worker into the OffscreenCanvas transferred
+    // to it (OFFSCREENCANVASES_TO_PTHREAD). Browsers without OffscreenCanvas WebGL
+    // fall back to proxying GL calls to the main thread, which needs an offscreen
+    // back buffer to present from
+    attribs.proxyContextToMainThread = EMSCRIPTEN_WEBGL_CONTEXT_PROXY_FALLBACK;
+    attribs.renderViaOffscreenBackBuffer = EM_TRUE;
+#endif
     
     _context = emscripten_webgl_create_context("viroCanvas", &attribs);
     emscripten_webgl_make_context_current(_context);
@@ -57,8 +119,6 @@ VROViewScene::VROViewScene(VRORendererTestType test) :
     _renderer = std::make_shared<VRORenderer>(config, std::dynamic_pointer_cast<VROInputControllerBase>(_inputController));
     
     update();
-    buildTestScene();
-    emscripten_set_main_loop(VROMainLoop, 0, 0);
 }
 
 void VROViewScene::buildTestScene() {
@@ -78,6 +138,23 @@ VROViewScene::~VROViewScene() {
 void VROViewScene::drawFrame() {
     emscripten_webgl_make_context_current(_context);
     
+    if (_benchmark) {
+        if (!_benchmark->renderFrame()) {
+            pinfo("%s", _benchmark->toJSON().c_str());
+            _benchmark.reset();
+            emscripten_cancel_main_loop();
+        }
+        return;
+    }
+    if (_replay) {
+        if (!_replay->renderFrame()) {
+            pinfo("%s", _replay->toJSON().c_str());
+            _replay.reset();
+            emscripten_cancel_main_loop();
+        }
+        return;
+    }
+    
     VROViewport viewport(0, 0, _width, _height);
     if (viewport.getWidth() == 0 || viewport.getHeight() == 0) {
         return;
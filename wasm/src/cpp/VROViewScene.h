@@ -7,6 +7,7 @@
 //
 
 #include <memory>
+#include <string>
 #include "emscripten.h"
 #include "emscripten/html5.h"
 
@@ -14,11 +15,24 @@ class VRORenderer;
 class VROInputControllerWasm;
 class VRODriverOpenGLWasm;
 class VRORendererTestHarness;
+class VROSceneBenchmark;
+class VROFrameReplay;
 enum class VRORendererTestType;
 
 class VROViewScene {
 public:
-    VROViewScene(VRORendererTestType test);
+    /*
+     Display the given test scene. If benchmark is true, the standard benchmark
+     scenes are run instead (see VROSceneBenchmark), with the results logged as
+     JSON when they complete.
+     */
+    VROViewScene(VRORendererTestType test, bool benchmark = false);
+    
+    /*
+     Replay the frame capture in the given directory (see VROFrameReplay),
+     logging the results as JSON when it completes.
+     */
+    VROViewScene(std::string replayDirectory);
     virtual ~VROViewScene();
     
     void drawFrame();
@@ -29,6 +43,10 @@ public:
     void onBlur();
     void onFocus();
     
+    std::shared_ptr<VRORenderer> getRenderer() const {
+        return _renderer;
+    }
+    
 private:
     
     int _frame;
@@ -41,6 +59,10 @@ private:
     std::shared_ptr<VRODriverOpenGLWasm> _driver;
     VRORendererTestType _testType;
     std::shared_ptr<VRORendererTestHarness> _harness;
+    std::shared_ptr<VROSceneBenchmark> _benchmark;
+    std::shared_ptr<VROFrameReplay> _replay;
+    
+    void initRenderer();
     
     EMSCRIPTEN_WEBGL_CONTEXT_HANDLE _context;
     
@@ -0,0 +1,11 @@
+#include <stdio.h>
+#include "VROViewScene.h"
+#include "VRORendererTestHarness.h"
+
+int main(int argc, char ** argv) {
+#ifdef WASM_PLATFORM
+    VROViewScene *view = new VROViewScene(VRORendererTestType::Benchmark, true);
+#else
+    printf("ESM is not defined! Startup canceled");
+#endif
+}
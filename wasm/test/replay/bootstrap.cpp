@@ -0,0 +1,12 @@
+#include <stdio.h>
+#include "VROViewScene.h"
+#include "VRORendererTestHarness.h"
+
+int main(int argc, char ** argv) {
+#ifdef WASM_PLATFORM
+    // Replays the capture preloaded at products/preload/capture
+    VROViewScene *view = new VROViewScene(std::string("/capture"));
+#else
+    printf("ESM is not defined! Startup canceled");
+#endif
+}